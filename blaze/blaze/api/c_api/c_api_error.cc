@@ -4,6 +4,7 @@
 #include "blaze/api/c_api/c_api_error.h"
 
 #include <stdarg.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string>
 
@@ -25,7 +26,6 @@ void Blaze_SetLastErrorString(const char* format, ...) {
   va_list val;
   va_start(val, format);
   char* buf = ThreadLocalStringStore::Get()->last_string;
-  int len = snprintf(buf, kMaxBufSize, format, val);
-  buf[len] = '\0';
+  vsnprintf(buf, kMaxBufSize, format, val);
   va_end(val);
 }
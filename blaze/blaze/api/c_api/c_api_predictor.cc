@@ -3,8 +3,21 @@
  */
 #include "blaze/api/c_api/c_api_predictor.h"
 
+#include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
 #include "blaze/api/c_api/c_api_error.h"
 #include "blaze/api/cpp_api/predictor.h"
 #include "blaze/common/log.h"
@@ -14,6 +27,178 @@ using blaze::Predictor;
 using blaze::PredictDeviceType;
 using blaze::PredictorManager;
 
+namespace {
+
+// The state of a batched forward, shared by the handle and the callbacks
+struct BatchForwardState {
+  BatchForwardState(Blaze_PredictRequest* requests, size_t num,
+                    Blaze_PredictCallback done, void* user_data) :
+      requests(requests, requests + num), status(num, BLAZE_REQUEST_PENDING),
+      done(done), user_data(user_data), finished(0) { }
+
+  void Finish(size_t idx, int request_status) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      status[idx] = request_status;
+      ++finished;
+    }
+    cv.notify_all();
+    if (done != nullptr) done(user_data, idx, request_status);
+  }
+
+  std::vector<Blaze_PredictRequest> requests;
+  std::vector<int> status;
+  Blaze_PredictCallback done;
+  void* user_data;
+  size_t finished;
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
+bool FeedRequest(const Blaze_PredictRequest& request) {
+  Predictor* predictor = reinterpret_cast<Predictor*>(request.predictor);
+  const int* dims = request.input_shapes;
+  for (size_t i = 0; i < request.input_num; ++i) {
+    const char* name = request.input_names[i];
+    if (request.input_ndims != nullptr) {
+      std::vector<size_t> shape(dims, dims + request.input_ndims[i]);
+      dims += request.input_ndims[i];
+      if (!predictor->ReshapeInput(name, shape)) {
+        LOG_ERROR("Reshape input: %s failed", name);
+        return false;
+      }
+    }
+    if (!predictor->FeedRef(name, request.input_data[i], request.input_lens[i])) {
+      LOG_ERROR("Feed %s failed", name);
+      return false;
+    }
+  }
+  return true;
+}
+
+int FetchRequest(const Blaze_PredictRequest& request) {
+  Predictor* predictor = reinterpret_cast<Predictor*>(request.predictor);
+  if (predictor->DeadlineExceeded()) return BLAZE_REQUEST_DEADLINE_EXCEEDED;
+  for (size_t i = 0; i < request.output_num; ++i) {
+    const char* name = request.output_names[i];
+    size_t slen = 0;
+    void* dptr = nullptr;
+    if (!predictor->Output(name, &dptr, &slen)) {
+      LOG_ERROR("Output %s failed", name);
+      return BLAZE_REQUEST_FAILED;
+    }
+    if (slen > request.output_lens[i]) {
+      LOG_ERROR("Output %s needs %lu bytes, the buffer has %lu",
+                name, slen, request.output_lens[i]);
+      return BLAZE_REQUEST_FAILED;
+    }
+    memcpy(request.output_data[i], dptr, slen);
+    request.output_lens[i] = slen;
+  }
+  return BLAZE_REQUEST_OK;
+}
+
+// The shards of a PredictMany, taken by the predictors in turn
+struct PredictManyState {
+  size_t rows;
+  size_t shard_rows;
+  size_t input_num;
+  const char** input_names;
+  std::vector<std::vector<size_t>> input_shapes;
+  std::vector<size_t> input_row_bytes;
+  void** input_data;
+  size_t output_num;
+  const char** output_names;
+  void** output_data;
+  const size_t* output_lens;
+  // the row bytes of the outputs, set by the first shard finished
+  std::unique_ptr<std::atomic<size_t>[]> output_row_bytes;
+
+  std::atomic<size_t> next_shard;
+  std::atomic<bool> failed;
+  std::mutex mutex;
+  std::string error;
+
+  // keeps the error of the first failed shard
+  void Fail(const char* format, ...) {
+    char buf[1024];
+    va_list val;
+    va_start(val, format);
+    vsnprintf(buf, sizeof(buf), format, val);
+    va_end(val);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!failed.exchange(true)) error = buf;
+  }
+};
+
+// fed_rows is the rows of the last shard of the predictor, a reshape
+// drops the fed reference and allocates the input, only a change of the
+// rows reshapes.
+bool PredictShard(Predictor* predictor, PredictManyState* state,
+                  size_t begin, size_t end, size_t* fed_rows) {
+  size_t num = end - begin;
+  for (size_t i = 0; i < state->input_num; ++i) {
+    const char* name = state->input_names[i];
+    if (num != *fed_rows) {
+      std::vector<size_t> shape = state->input_shapes[i];
+      shape[0] = num;
+      if (!predictor->ReshapeInput(name, shape)) {
+        state->Fail("Reshape input: %s to %lu rows failed", name, num);
+        return false;
+      }
+    }
+    char* data = reinterpret_cast<char*>(state->input_data[i]) + begin * state->input_row_bytes[i];
+    if (!predictor->FeedRef(name, data, num * state->input_row_bytes[i])) {
+      state->Fail("Feed %s of the rows from %lu failed", name, begin);
+      return false;
+    }
+  }
+  *fed_rows = num;
+  if (!predictor->Forward()) {
+    state->Fail("Forward of the rows from %lu failed", begin);
+    return false;
+  }
+  for (size_t i = 0; i < state->output_num; ++i) {
+    const char* name = state->output_names[i];
+    size_t len = 0;
+    void* dptr = nullptr;
+    if (!predictor->Output(name, &dptr, &len)) {
+      state->Fail("Output %s of the rows from %lu failed", name, begin);
+      return false;
+    }
+    size_t row_bytes = len / num;
+    if (row_bytes * num != len) {
+      state->Fail("Output %s of %lu bytes is not by the %lu rows", name, len, num);
+      return false;
+    }
+    size_t expected = 0;
+    if (!state->output_row_bytes[i].compare_exchange_strong(expected, row_bytes) &&
+        expected != row_bytes) {
+      state->Fail("Output %s rows are %lu and %lu bytes", name, expected, row_bytes);
+      return false;
+    }
+    if (state->rows * row_bytes > state->output_lens[i]) {
+      state->Fail("Output %s needs %lu bytes, the buffer has %lu",
+                  name, state->rows * row_bytes, state->output_lens[i]);
+      return false;
+    }
+    memcpy(reinterpret_cast<char*>(state->output_data[i]) + begin * row_bytes, dptr, len);
+  }
+  return true;
+}
+
+void PredictShards(Predictor* predictor, PredictManyState* state) {
+  size_t fed_rows = 0;
+  while (!state->failed) {
+    size_t begin = state->next_shard.fetch_add(1) * state->shard_rows;
+    if (begin >= state->rows) return;
+    size_t end = std::min(begin + state->shard_rows, state->rows);
+    if (!PredictShard(predictor, state, begin, end, &fed_rows)) return;
+  }
+}
+
+}  // namespace
+
 int Blaze_InitScheduler(int enable_batching,
                         int max_batch_size,
                         int batch_timeout_micros,
@@ -170,6 +355,22 @@ int Blaze_PredictorFeed(PredictorHandle handle,
   return 0;
 }
 
+int Blaze_PredictorFeedRef(PredictorHandle handle,
+                           const char* name,
+                           void* data,
+                           size_t len) {
+  Predictor* predictor = reinterpret_cast<Predictor*>(handle);
+  if (predictor == nullptr) {
+    Blaze_SetLastErrorString("The predictor is nullptr");
+    return -1;
+  }
+  if (!predictor->FeedRef(name, data, len)) {
+    Blaze_SetLastErrorString("Feed %s failed", name);
+    return -1;
+  }
+  return 0;
+}
+
 int Blaze_PredictorForward(PredictorHandle handle) {
   Predictor* predictor = reinterpret_cast<Predictor*>(handle);
   if (predictor == nullptr) return -1;
@@ -214,6 +415,19 @@ int Blaze_PredictorOutput(PredictorHandle handle,
   return 0;
 }
 
+int Blaze_PredictorOutputRef(PredictorHandle handle,
+                             const char* name,
+                             void** data,
+                             size_t* len) {
+  Predictor* predictor = reinterpret_cast<Predictor*>(handle);
+  if (predictor == nullptr) return -1;
+  if (!predictor->Output(name, data, len)) {
+    Blaze_SetLastErrorString("Output %s failed", name);
+    return -1;
+  }
+  return 0;
+}
+
 int Blaze_PredictorParamShape(PredictorHandle handle,
                               const char* name,
                               size_t* ndim,
@@ -379,3 +593,183 @@ int Blaze_PredictorDumpObservers(PredictorHandle handle,
   return 0;
 }
 
+
+int Blaze_PredictorBatchForward(Blaze_PredictRequest* requests,
+                                size_t num,
+                                Blaze_PredictCallback done,
+                                void* user_data,
+                                BatchForwardHandle* handle) {
+  if (requests == nullptr && num > 0) {
+    Blaze_SetLastErrorString("The requests is nullptr");
+    return -1;
+  }
+  // a predictor holds the inputs and outputs of one request at a time
+  std::unordered_set<PredictorHandle> predictors;
+  for (size_t i = 0; i < num; ++i) {
+    if (requests[i].predictor == nullptr) {
+      Blaze_SetLastErrorString("The predictor of request %lu is nullptr", i);
+      return -1;
+    }
+    if (!predictors.insert(requests[i].predictor).second) {
+      Blaze_SetLastErrorString("The predictor of request %lu is shared", i);
+      return -1;
+    }
+  }
+
+  std::shared_ptr<BatchForwardState> state =
+      std::make_shared<BatchForwardState>(requests, num, done, user_data);
+  if (handle != nullptr) *handle = new std::shared_ptr<BatchForwardState>(state);
+  // the forwards are issued back to back, so that the batching queues
+  // merge the requests of the same model
+  for (size_t i = 0; i < num; ++i) {
+    const Blaze_PredictRequest& request = state->requests[i];
+    Predictor* predictor = reinterpret_cast<Predictor*>(request.predictor);
+    if (!FeedRequest(request)) {
+      state->Finish(i, BLAZE_REQUEST_FAILED);
+      continue;
+    }
+    bool ret = predictor->Forward([state, i]() {
+      state->Finish(i, FetchRequest(state->requests[i]));
+    });
+    if (!ret) {
+      state->Finish(i, predictor->DeadlineExceeded() ?
+                    BLAZE_REQUEST_DEADLINE_EXCEEDED : BLAZE_REQUEST_FAILED);
+    }
+  }
+  return 0;
+}
+
+int Blaze_BatchForwardPoll(BatchForwardHandle handle,
+                           size_t* finished) {
+  auto state = reinterpret_cast<std::shared_ptr<BatchForwardState>*>(handle);
+  if (state == nullptr) return -1;
+  std::lock_guard<std::mutex> lock((*state)->mutex);
+  *finished = (*state)->finished;
+  return 0;
+}
+
+int Blaze_BatchForwardWait(BatchForwardHandle handle,
+                           long long timeout_micros) {
+  auto state = reinterpret_cast<std::shared_ptr<BatchForwardState>*>(handle);
+  if (state == nullptr) return -1;
+  BatchForwardState* s = state->get();
+  std::unique_lock<std::mutex> lock(s->mutex);
+  auto all_finished = [s]() { return s->finished == s->status.size(); };
+  if (timeout_micros <= 0) {
+    s->cv.wait(lock, all_finished);
+  } else if (!s->cv.wait_for(lock, std::chrono::microseconds(timeout_micros), all_finished)) {
+    Blaze_SetLastErrorString("BatchForward timeout, %lu of %lu finished",
+                             s->finished, s->status.size());
+    return -1;
+  }
+  return 0;
+}
+
+int Blaze_BatchForwardStatus(BatchForwardHandle handle,
+                             size_t num,
+                             int* status) {
+  auto state = reinterpret_cast<std::shared_ptr<BatchForwardState>*>(handle);
+  if (state == nullptr) return -1;
+  std::lock_guard<std::mutex> lock((*state)->mutex);
+  const std::vector<int>& request_status = (*state)->status;
+  if (num > request_status.size()) {
+    Blaze_SetLastErrorString("BatchForward has %lu requests", request_status.size());
+    return -1;
+  }
+  memcpy(status, request_status.data(), num * sizeof(int));
+  return 0;
+}
+
+int Blaze_BatchForwardDelete(BatchForwardHandle handle) {
+  auto state = reinterpret_cast<std::shared_ptr<BatchForwardState>*>(handle);
+  if (state == nullptr) return -1;
+  delete state;
+  return 0;
+}
+
+int Blaze_PredictorPredictMany(PredictorHandle* predictors,
+                               size_t predictor_num,
+                               size_t rows,
+                               size_t shard_rows,
+                               size_t input_num,
+                               const char** input_names,
+                               const size_t* input_ndims,
+                               const int* input_shapes,
+                               void** input_data,
+                               const size_t* input_lens,
+                               size_t output_num,
+                               const char** output_names,
+                               void** output_data,
+                               size_t* output_lens) {
+  if (predictors == nullptr || predictor_num == 0) {
+    Blaze_SetLastErrorString("PredictMany needs at least one predictor");
+    return -1;
+  }
+  if (shard_rows == 0) {
+    Blaze_SetLastErrorString("PredictMany needs shard_rows > 0");
+    return -1;
+  }
+  std::unordered_set<PredictorHandle> unique_predictors;
+  for (size_t i = 0; i < predictor_num; ++i) {
+    if (predictors[i] == nullptr) {
+      Blaze_SetLastErrorString("The predictor %lu is nullptr", i);
+      return -1;
+    }
+    if (!unique_predictors.insert(predictors[i]).second) {
+      Blaze_SetLastErrorString("The predictor %lu is shared", i);
+      return -1;
+    }
+  }
+
+  PredictManyState state;
+  state.rows = rows;
+  state.shard_rows = shard_rows;
+  state.input_num = input_num;
+  state.input_names = input_names;
+  state.input_data = input_data;
+  state.output_num = output_num;
+  state.output_names = output_names;
+  state.output_data = output_data;
+  state.output_lens = output_lens;
+  state.output_row_bytes.reset(new std::atomic<size_t>[output_num]);
+  for (size_t i = 0; i < output_num; ++i) state.output_row_bytes[i] = 0;
+  state.next_shard = 0;
+  state.failed = false;
+  const int* dims = input_shapes;
+  for (size_t i = 0; i < input_num; ++i) {
+    std::vector<size_t> shape(dims, dims + input_ndims[i]);
+    dims += input_ndims[i];
+    if (shape.empty() || shape[0] != rows) {
+      Blaze_SetLastErrorString("The first dim of input %s is not the %lu rows",
+                               input_names[i], rows);
+      return -1;
+    }
+    if (rows > 0 && input_lens[i] % rows != 0) {
+      Blaze_SetLastErrorString("Input %s of %lu bytes is not by the rows",
+                               input_names[i], input_lens[i]);
+      return -1;
+    }
+    state.input_shapes.push_back(shape);
+    state.input_row_bytes.push_back(rows == 0 ? 0 : input_lens[i] / rows);
+  }
+
+  // no more threads than shards, the caller's thread takes the first
+  // predictor
+  size_t shards = (rows + shard_rows - 1) / shard_rows;
+  size_t thread_num = std::min(predictor_num, shards);
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < thread_num; ++i) {
+    threads.emplace_back(PredictShards, reinterpret_cast<Predictor*>(predictors[i]), &state);
+  }
+  if (thread_num > 0) PredictShards(reinterpret_cast<Predictor*>(predictors[0]), &state);
+  for (auto& thread : threads) thread.join();
+
+  if (state.failed) {
+    Blaze_SetLastErrorString("%s", state.error.c_str());
+    return -1;
+  }
+  for (size_t i = 0; i < output_num; ++i) {
+    output_lens[i] = rows * state.output_row_bytes[i];
+  }
+  return 0;
+}
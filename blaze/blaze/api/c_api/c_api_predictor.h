@@ -12,6 +12,7 @@ extern "C" {
 
 typedef void* PredictorManagerHandle;
 typedef void* PredictorHandle;
+typedef void* BatchForwardHandle;
 
 // Init Scheduler
 int Blaze_InitScheduler(int enable_batching,
@@ -56,6 +57,12 @@ int Blaze_PredictorFeed(PredictorHandle handle,
                         const char* name,
                         void* data,
                         int len);
+// Feed the caller's buffer without a copy, it must be kept unchanged until
+// the Forward is finished.
+int Blaze_PredictorFeedRef(PredictorHandle handle,
+                           const char* name,
+                           void* data,
+                           size_t len);
 int Blaze_PredictorForward(PredictorHandle handle);
 
 // about output
@@ -70,6 +77,12 @@ int Blaze_PredictorOutput(PredictorHandle handle,
                           const char* name,
                           void* data,
                           size_t len);
+// The host memory of the output without a copy, valid until the next
+// Feed or Forward of the predictor.
+int Blaze_PredictorOutputRef(PredictorHandle handle,
+                             const char* name,
+                             void** data,
+                             size_t* len);
 
 // about internal param
 int Blaze_PredictorParamName(PredictorHandle handle,
@@ -104,6 +117,77 @@ int Blaze_PredictorDumpObservers(PredictorHandle handle,
                                  const char*** key,
                                  const char*** value);
 
+// about batched forward
+#define BLAZE_REQUEST_OK 0
+#define BLAZE_REQUEST_PENDING 1
+#define BLAZE_REQUEST_DEADLINE_EXCEEDED 2
+#define BLAZE_REQUEST_FAILED -1
+
+// One request of a batched forward. The inputs are fed by reference, the
+// input buffers must be kept unchanged until the request is finished. The
+// outputs are copied to the caller's buffers, output_lens holds the buffer
+// sizes and is set to the lengths written.
+typedef struct {
+  PredictorHandle predictor;
+  size_t input_num;
+  const char** input_names;
+  // The ndim of each input and their shapes concatenated, NULL keeps the
+  // shapes of the last Reshape.
+  const size_t* input_ndims;
+  const int* input_shapes;
+  void** input_data;
+  const size_t* input_lens;
+  size_t output_num;
+  const char** output_names;
+  void** output_data;
+  size_t* output_lens;
+} Blaze_PredictRequest;
+
+// Invoked once for each finished request, on the thread of the scheduler
+typedef void (*Blaze_PredictCallback)(void* user_data, size_t request_idx, int status);
+
+// Forward the requests in one call, the requests of the same model are
+// batched by the shared batch scheduler if batching is enabled. Each
+// request takes its own predictor. done may be NULL, handle may be NULL if
+// the completion is taken from done only.
+int Blaze_PredictorBatchForward(Blaze_PredictRequest* requests,
+                                size_t num,
+                                Blaze_PredictCallback done,
+                                void* user_data,
+                                BatchForwardHandle* handle);
+int Blaze_BatchForwardPoll(BatchForwardHandle handle,
+                           size_t* finished);
+// Wait the requests to be finished, returns -1 on timeout, 0 waits forever
+int Blaze_BatchForwardWait(BatchForwardHandle handle,
+                           long long timeout_micros);
+int Blaze_BatchForwardStatus(BatchForwardHandle handle,
+                             size_t num,
+                             int* status);
+// Free the handle, the unfinished requests still run to the end
+int Blaze_BatchForwardDelete(BatchForwardHandle handle);
+
+// Score the rows of a large batch on a pool of predictors, one thread each.
+// The inputs are row major with the rows as the first dim of their shapes,
+// the batch is cut into shards of shard_rows rows and every predictor takes
+// the next shard when it is done with its last. The shards are fed by
+// reference and their outputs are copied into the rows of the caller's
+// output buffers, output_lens holds the buffer sizes and is set to the
+// lengths written. The predictors must be distinct.
+int Blaze_PredictorPredictMany(PredictorHandle* predictors,
+                               size_t predictor_num,
+                               size_t rows,
+                               size_t shard_rows,
+                               size_t input_num,
+                               const char** input_names,
+                               const size_t* input_ndims,
+                               const int* input_shapes,
+                               void** input_data,
+                               const size_t* input_lens,
+                               size_t output_num,
+                               const char** output_names,
+                               void** output_data,
+                               size_t* output_lens);
+
 #ifdef __cplusplus
 }
 #endif
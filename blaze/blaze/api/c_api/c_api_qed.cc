@@ -7,6 +7,8 @@
 
 using blaze::store::EmbeddingBuilder;
 using blaze::float16;
+using blaze::store::qint8;
+using blaze::store::qint4;
 
 int Blaze_QuickEmbeddingBuildFp32(const char* path,
                                   const char* meta,
@@ -35,3 +37,31 @@ int Blaze_QuickEmbeddingBuildFp16(const char* path,
   }
   return 0;
 }
+
+int Blaze_QuickEmbeddingBuildInt8(const char* path,
+                                  const char* meta,
+                                  const char* output_file,
+                                  int thread_num) {
+  EmbeddingBuilder<qint8> builder;
+  try {
+    builder.Build(path, meta, output_file, thread_num);
+  } catch (std::exception& e) {
+    LOG_ERROR("failed: %s", e.what());
+    return -1;
+  }
+  return 0;
+}
+
+int Blaze_QuickEmbeddingBuildInt4(const char* path,
+                                  const char* meta,
+                                  const char* output_file,
+                                  int thread_num) {
+  EmbeddingBuilder<qint4> builder;
+  try {
+    builder.Build(path, meta, output_file, thread_num);
+  } catch (std::exception& e) {
+    LOG_ERROR("failed: %s", e.what());
+    return -1;
+  }
+  return 0;
+}
@@ -20,6 +20,17 @@ int Blaze_QuickEmbeddingBuildFp16(const char* path,
                                   const char* output_file,
                                   int thread_num);
 
+// row-wise quantized int8 and int4 dicts
+int Blaze_QuickEmbeddingBuildInt8(const char* path,
+                                  const char* meta,
+                                  const char* output_file,
+                                  int thread_num);
+
+int Blaze_QuickEmbeddingBuildInt4(const char* path,
+                                  const char* meta,
+                                  const char* output_file,
+                                  int thread_num);
+
 #ifdef __cplusplus
 }
 #endif
@@ -12,6 +12,7 @@
 #include "blaze/common/common_defines.h"
 #include "blaze/common/exception.h"
 #include "blaze/common/string_util.h"
+#include "blaze/graph/observer/op_latency_observer.h"
 #include "blaze/operator/common_helper.h"
 #include "blaze/optimizer/optimizer.h"
 #include "blaze/scheduler/scheduler_manager.h"
@@ -48,6 +49,14 @@ bool Predictor::Feed(size_t idx, const void* data, size_t len) {
   return this->impl_->Feed(idx, data, len);
 }
 
+bool Predictor::FeedRef(const char* name, void* data, size_t len) {
+  return this->impl_->FeedRef(name, data, len);
+}
+
+bool Predictor::FeedRef(size_t idx, void* data, size_t len) {
+  return this->impl_->FeedRef(idx, data, len);
+}
+
 PredictDataType Predictor::InputDataType(const char* name) const {
   return this->impl_->InputDataType(name);
 }
@@ -72,6 +81,22 @@ bool Predictor::Forward(const PredictorCallback&& cb) {
   }
 }
 
+void Predictor::SetForwardTimeout(int64_t timeout_micros) {
+  this->impl_->SetForwardTimeout(timeout_micros);
+}
+
+void Predictor::SetIntraOpThreads(int intra_op_threads) {
+  this->impl_->SetIntraOpThreads(intra_op_threads);
+}
+
+void Predictor::SetCommonReused(bool reused) {
+  this->impl_->SetCommonReused(reused);
+}
+
+bool Predictor::DeadlineExceeded() const {
+  return this->impl_->DeadlineExceeded();
+}
+
 bool Predictor::Output(const char* name, void** data, size_t* len) {
   return this->impl_->Output(name, data, len);
 }
@@ -92,6 +117,10 @@ size_t Predictor::OutputSize() const {
   return this->impl_->OutputSize();
 }
 
+bool Predictor::OutputRef(size_t idx, void** data, size_t* len, bool* on_device) {
+  return this->impl_->OutputRef(idx, data, len, on_device);
+}
+
 const std::vector<size_t>& Predictor::OutputShape(size_t idx) const {
   return this->impl_->OutputShape(idx);
 }
@@ -146,10 +175,26 @@ void PredictorManager::SetRunMode(const char* run_mode) {
   this->impl_->SetRunMode(run_mode);
 }
 
+bool PredictorManager::LoadAotNet(const char* library) {
+  return this->impl_->LoadAotNet(library);
+}
+
 bool PredictorManager::LoadSparseModelWeight(const char* uri, const char* ps_puller_type) {
   return this->impl_->LoadSparseModelWeight(uri, ps_puller_type);
 }
 
+bool PredictorManager::LoadSparseModelWeightDelta(const char* uri) {
+  return this->impl_->LoadSparseModelWeightDelta(uri);
+}
+
+void PredictorManager::EnableSparseResultCache(size_t capacity_mb, int ttl_seconds) {
+  this->impl_->EnableSparseResultCache(capacity_mb, ttl_seconds);
+}
+
+void PredictorManager::SetModelCacheDir(const char* dir) {
+  this->impl_->SetModelCacheDir(dir);
+}
+
 bool PredictorManager::LoadModel(const char* filename, bool optimization_pass) {
   return this->impl_->LoadModel(filename, "", kBlaze, optimization_pass);
 }
@@ -163,10 +208,19 @@ bool PredictorManager::LoadModel(const char* conf_file, const char* data_file,
   return this->impl_->LoadModel(conf_file, data_file, model_type, optimization_pass);
 }
 
+void PredictorManager::EnableReplicas(bool cpu_replica) {
+  this->impl_->EnableReplicas(cpu_replica);
+}
+
 Predictor* PredictorManager::CreatePredictor(PredictDeviceType predict_device, int device_id) {
   return this->impl_->CreatePredictor(predict_device, device_id);
 }
 
+bool PredictorManager::WarmUp(const std::vector<size_t>& batch_sizes, const WarmUpFeeder& feeder,
+                              int concurrency) {
+  return this->impl_->WarmUp(batch_sizes, feeder, concurrency);
+}
+
 std::string FeedNameUtility::SparseFeatureName2FeedName(const std::string& sparse_feature_name,
                                                         SparseFeatureType sft) {
   switch (sft) {
@@ -183,12 +237,56 @@ std::string FeedNameUtility::IndicatorLevel2FeedName(int level) {
   return blaze::kIndicatorPrefix + blaze::kSparseFeatureSep + std::to_string(level);
 }
 
+bool RegisterPinnedMemory(void* data, size_t len) {
+#ifdef USE_CUDA
+  cudaError_t error = cudaHostRegister(data, len, cudaHostRegisterPortable);
+  if (error != cudaSuccess) {
+    LOG_ERROR("register pinned memory failed, %s", cudaGetErrorString(error));
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool UnregisterPinnedMemory(void* data) {
+#ifdef USE_CUDA
+  cudaError_t error = cudaHostUnregister(data);
+  if (error != cudaSuccess) {
+    LOG_ERROR("unregister pinned memory failed, %s", cudaGetErrorString(error));
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+std::string DumpOpLatencyMetrics() {
+  return OpLatencyRegistry::Instance()->Dump();
+}
+
+void VisitOpLatency(const OpLatencyVisitor& visitor) {
+  OpLatencyRegistry::Instance()->Visit([&visitor](const std::string& net, const std::string& op,
+                                                  const OpLatencyHistogram& histogram) {
+    std::vector<uint64_t> buckets = histogram.buckets();
+    uint64_t count = 0;
+    for (auto bucket : buckets) count += bucket;
+    visitor(net, op, histogram.type(), count, histogram.sum_micros(), buckets);
+  });
+}
+
 bool InitScheduler(bool enable_batching,
                    int max_batch_size,
                    int batch_timeout_micros,
                    int num_threads_for_cpu,
                    int num_threads_for_cuda,
-                   int num_threads_for_pipe) {
+                   int num_threads_for_pipe,
+                   int latency_target_micros,
+                   bool numa_aware,
+                   int intra_op_threads,
+                   bool pin_cores) {
   auto scheduler_manager = SchedulerManager<AsyncTask>::Instance();
   SchedulerManager<AsyncTask>::Options options;
   options.enable_batching = enable_batching;
@@ -197,6 +295,10 @@ bool InitScheduler(bool enable_batching,
   options.num_threads_for_cpu = num_threads_for_cpu;
   options.num_threads_for_cuda = num_threads_for_cuda;
   options.num_threads_for_pipe = num_threads_for_pipe;
+  options.latency_target_micros = latency_target_micros;
+  options.numa_aware = numa_aware;
+  options.intra_op_threads = intra_op_threads;
+  options.pin_cores = pin_cores;
 
   return scheduler_manager->Init(options);
 }
@@ -121,6 +121,22 @@ class Predictor {
   // @param len: The tensor's length in byte.
   // @Return True: success False: failed
   bool Feed(size_t idx, const void* data, size_t len);
+
+  // Feed the input tensor with the caller's memory without a copy, should
+  // Reshape the input tensor first. The memory must be kept unchanged until
+  // the Forward is done. The copies of the inputs to gpu are issued together
+  // on Forward, asynchronously if the memory is pinned by RegisterPinnedMemory.
+  // @param name: The tensor name
+  // @param data: The tensor's host memory address
+  // @param len: The tensor's length in byte.
+  // @Return True: success False: failed
+  bool FeedRef(const char* name, void* data, size_t len);
+  // Feed the idx-th input tensor with the caller's memory without a copy.
+  // @param idx: The idx-th input tensor
+  // @param data: The tensor's host memory address
+  // @param len: The tensor's length in byte.
+  // @Return True: success False: failed
+  bool FeedRef(size_t idx, void* data, size_t len);
  
   // Return the input tensor count
   size_t InputSize() const;
@@ -141,6 +157,24 @@ class Predictor {
   // @Return True: success False: failed
   bool Forward(const PredictorCallback&& cb = nullptr);
 
+  // Set the timeout of the next Forwards, the batching queues run the
+  // requests by earliest deadline and drop the ones which can not finish
+  // in time.
+  // @param timeout_micros: The timeout in microseconds, 0 for none
+  void SetForwardTimeout(int64_t timeout_micros);
+  // Set the intra op threads budget of the next Forwards, such as 1 for the
+  // small requests, at most the share of the scheduler thread running them.
+  // @param intra_op_threads: The openmp and mkl threads, 0 for the share
+  void SetIntraOpThreads(int intra_op_threads);
+  // Keep the outputs of the ops computed from the common (level 1) inputs
+  // only, such as the user side of the levels of a tree search, across the
+  // Forwards which do not feed or reshape the common inputs again.
+  // @param reused: True to skip the common ops while their inputs are kept
+  void SetCommonReused(bool reused);
+  // Return True if the last Forward was dropped for its deadline, whose
+  // callback is invoked without outputs.
+  bool DeadlineExceeded() const;
+
   // Get the raw data of output tensor.
   // @param name: The output tensor name
   // @param data: The address
@@ -154,6 +188,16 @@ class Predictor {
   // @Return True: success False: failed
   bool Output(size_t idx, void** data, size_t* len); 
 
+  // Get the raw data of idx-th output tensor where the net wrote it, without
+  // the copy to host. The first Output of a gpu net copies all the outputs
+  // to pinned host memory at once, which the gpu consumers can skip.
+  // @param idx: The index
+  // @param data: The address, valid until the next Forward
+  // @param len: The raw data length in byte.
+  // @param on_device: True if data is on the gpu of the net
+  // @Return True: success False: failed
+  bool OutputRef(size_t idx, void** data, size_t* len, bool* on_device);
+
   // Get the shape of idx-th output tensor
   // @param idx: The index
   // @Return The shape of idx-th output tensor
@@ -201,7 +245,10 @@ class Predictor {
   int InternalDataType(const char* name) const;
 
   // Register obersers for internal observer,
-  // Supported observer names: profile/cost 
+  // Supported observer names: profile/cost/calibration/placement/sparse_cache
+  // and op_latency[:sample_rate[:label]], which records the op latency of one
+  // in sample_rate runs, 100 by default, into the histograms shared by the
+  // predictors of the label, the net name by default, see DumpOpLatencyMetrics.
   // @param observer_names: The obersver name list
   void RegisterObservers(const std::vector<std::string>& oberver_names);
 
@@ -216,6 +263,11 @@ class Predictor {
   friend class PredictorManagerImpl;
 };
 
+// The feeder of the warm up, which reshapes and feeds the inputs of the
+// predictor with a synthetic batch of batch_size, such as replicated from a
+// recorded request. Return False if failed.
+using WarmUpFeeder = std::function<bool(Predictor* predictor, size_t batch_size)>;
+
 // The predictor manager for managing one model's multiple predict handle.
 // It doesn't support model hot switch, When model update, you should create
 // a new PredictorManager instance.
@@ -230,11 +282,47 @@ class PredictorManager {
   // Set the run mode
   void SetRunMode(const char* run_mode);
 
+  // load the shared library of a net generated by AotCodegen and run the
+  // model with it. The net checks that the model is the one it was
+  // generated from when the predictors are created. Call it after
+  // LoadModel.
+  // @param library: The path of the shared library
+  bool LoadAotNet(const char* library);
+
   // set large-scale sparse model's weight.
   // @param uri: The sparse model uri
   // @param type: The sparse model storage backend type
   bool LoadSparseModelWeight(const char* uri, const char* type = "qed_sparse_puller");
 
+  // apply the changed rows of a sparse model refresh over the loaded weight,
+  // the running predictors see the new rows without reloading the model.
+  // @param uri: The delta sparse model uri, built in the sparse model format
+  bool LoadSparseModelWeightDelta(const char* uri);
+
+  // cache the pooled embedding results of the repeated sparse inputs, such
+  // as the user side features of the candidate batches of a user, across the
+  // predictors of the manager. The cache is cleared when the weights change,
+  // and its hits are dumped by the sparse_cache observer. Call it before
+  // CreatePredictor.
+  // @param capacity_mb: The memory bound of the cache
+  // @param ttl_seconds: The results older than the ttl are pulled again
+  void EnableSparseResultCache(size_t capacity_mb, int ttl_seconds);
+
+  // balance the predictors created with kPDT_Unkown across a replica per
+  // gpu, and per numa node of cpu if cpu_replica or no gpu is found. The
+  // predictor goes to the replica with the fewest forwards in flight. The
+  // replicas of a device share the read-only weights, and the cpu replicas
+  // are per numa node only if InitScheduler is numa aware. Call it before
+  // CreatePredictor.
+  // @param cpu_replica: Whether to serve on cpu besides the gpus
+  void EnableReplicas(bool cpu_replica = false);
+
+  // cache the models imported from other formats in dir as blaze binary
+  // nets, which load without the import when the model files are unchanged.
+  // Call it before LoadModel.
+  // @param dir: The directory of the cached models
+  void SetModelCacheDir(const char* dir);
+
   // load model of blaze format for online-serving.
   //
   // NOTE: if the model contains sparse model op, such as: Embedding,
@@ -273,17 +361,58 @@ class PredictorManager {
   // @Return return the predictor handle, the caller should manage the handle.
   Predictor* CreatePredictor(PredictDeviceType predict_device_type = kPDT_Unkown, int device_id = 0);
 
+  // Forward the synthetic batches of the feeder at each batch size on every
+  // device the predictors may be created on, so that the weights, the device
+  // contexts and handles of the scheduler threads, the placed nets and the
+  // batching queues are built before the first request, rather than on the
+  // first requests of each batch size. Call it after LoadModel and
+  // InitScheduler, and serve the model only if it returns True.
+  // @param batch_sizes: The batch sizes to run, such as the batch buckets
+  // @param feeder: Feeds a predictor with a batch of batch_size
+  // @param concurrency: The predictors forwarded at once on each device
+  bool WarmUp(const std::vector<size_t>& batch_sizes, const WarmUpFeeder& feeder,
+              int concurrency = 4);
+
  protected:
   PredictorManagerImpl* impl_;
 };
 
-// Init Scheduler
+// Pin the caller's host memory, such as of FeedRef, so that the copies from
+// and to gpu are asynchronous. Return False if failed, or without gpu.
+// @param data: The host memory address
+// @param len: The memory length in byte.
+bool RegisterPinnedMemory(void* data, size_t len);
+// Unpin the host memory of RegisterPinnedMemory.
+bool UnregisterPinnedMemory(void* data);
+
+// The op latency histograms of the op_latency observers in the prometheus
+// text format, as blaze_op_latency_micros{net,op,type} in micros.
+std::string DumpOpLatencyMetrics();
+// visitor(net, op, type, count, sum_micros, buckets), bucket i counts the
+// sampled runs faster than 2^i micros and the last one the slower runs.
+typedef std::function<void(const std::string&, const std::string&, const std::string&,
+                           uint64_t, uint64_t, const std::vector<uint64_t>&)> OpLatencyVisitor;
+void VisitOpLatency(const OpLatencyVisitor& visitor);
+
+// Init Scheduler, a positive latency_target_micros adapts the batch size and
+// timeout of each model under the p99 target. If numa_aware, there are
+// num_threads_for_cpu threads bound to each numa node, which is the device id
+// of the cpu predictors, and the gpu threads are bound to the node of the gpu.
+// Each cpu thread runs the ops on intra_op_threads openmp and mkl threads, 0
+// for its share of the cores of its node, or of the process, so that the cpu
+// threads and their intra op threads do not oversubscribe the cores, and the
+// gpu and pipe threads run them single threaded. If pin_cores, each cpu
+// thread and its intra op threads are bound to their own cores.
 bool InitScheduler(bool enable_batching,
                    int max_batch_size,
                    int batch_timeout_micros,
                    int num_threads_for_cpu,
                    int num_threads_for_cuda,
-                   int num_threads_for_pipe);
+                   int num_threads_for_pipe,
+                   int latency_target_micros = 0,
+                   bool numa_aware = false,
+                   int intra_op_threads = 0,
+                   bool pin_cores = false);
 
 }  // namespace blaze
 
@@ -4,13 +4,37 @@
  */
 #include "blaze/api/cpp_api/predictor_impl.h"
 
+#include "blaze/batching/env.h"
 #include "blaze/common/exception.h"
+#include "blaze/common/intra_op.h"
 #include "blaze/common/string_util.h"
 #include "blaze/operator/common_helper.h"
 #include "blaze/graph/net.h"
 
 namespace blaze {
 
+PinnedBuffer::~PinnedBuffer() {
+  if (data_ == nullptr) return;
+#ifdef USE_CUDA
+  cudaFreeHost(data_);
+#else
+  free(data_);
+#endif
+}
+
+void* PinnedBuffer::Reserve(size_t bytes) {
+  if (bytes <= capacity_ && data_ != nullptr) return data_;
+#ifdef USE_CUDA
+  if (data_ != nullptr) cudaFreeHost(data_);
+  CUDA_CHECK(cudaMallocHost(&data_, bytes));
+#else
+  free(data_);
+  data_ = malloc(bytes);
+#endif
+  capacity_ = bytes;
+  return data_;
+}
+
 PredictorImpl::PredictorImpl(std::shared_ptr<Net>& net) : net_(net) {
   // init external output index and blob vector.
   external_output_blob_.clear();
@@ -30,7 +54,11 @@ PredictorImpl::PredictorImpl(std::shared_ptr<Net>& net) : net_(net) {
     external_output_blob_cpu_.push_back(std::shared_ptr<Blob>(new Blob(device_option)));
     external_output_blob_cpu_[external_output_blob_cpu_.size() - 1]->set_data_type(
         static_cast<DataType>(iter->second->data_type()));
+    external_output_pinned_.emplace_back(new PinnedBuffer());
   }
+  DeviceOption cpu_device_option;
+  cpu_device_option.set_device_type(kCPU);
+  internal_blob_cpu_.reset(new Blob(cpu_device_option));
 
   // init external input index and blob vector
   external_input_blob_.clear();
@@ -44,6 +72,11 @@ PredictorImpl::PredictorImpl(std::shared_ptr<Net>& net) : net_(net) {
     external_input_blob_index_[external_input] = external_input_blob_.size();
     external_input_blob_.push_back(iter->second);
   }
+  external_input_ref_.resize(external_input_blob_.size(), false);
+  for (const auto& external_input : net_->external_input()) {
+    external_input_common_.push_back(net_->has_external_input_info(external_input) &&
+        NetDefHelper::IsCommonInput(net_->external_input_info(external_input)));
+  }
 }
 
 FeedNameConfig PredictorImpl::GetFeedNameConfig(const std::string& feed_name) {
@@ -94,6 +127,8 @@ bool PredictorImpl::ReshapeInput(size_t idx, const std::vector<size_t>& shape) {
     LOG_ERROR("The blob is null, idx=%u", idx);
     return false;
   }
+  OwnInput(idx);
+  InputFed(idx);
   blob->Reshape(shape);
   return true;
 }
@@ -108,33 +143,93 @@ bool PredictorImpl::Feed(const char* name, const void* data, size_t len) {
 }
 
 bool PredictorImpl::Feed(size_t idx, const void* data, size_t len) {
+  Blob* blob = FeedBlob(idx, len);
+  if (blob == nullptr) return false;
+  OwnInput(idx);
+  InputFed(idx);
+  const DeviceOption& device_option = blob->device_option();
+  if (device_option.device_type() == kCUDA) {
+#ifdef USE_CUDA
+    CUDAContext context(device_option);
+    CUDA_CHECK(cudaMemcpyAsync(blob->as<char>(), data, blob->size() * DataTypeSize(blob->data_type()),
+                               cudaMemcpyHostToDevice, context.cuda_stream()));
+    context.FinishDeviceComputation();
+#endif
+  } else {
+    memcpy(blob->as<char>(), data, blob->size() * DataTypeSize(blob->data_type()));
+  }
+  return true;
+}
+
+bool PredictorImpl::FeedRef(const char* name, void* data, size_t len) {
+  int idx = InputName2Idx(name);
+  if (idx < 0) {
+    LOG_ERROR("The name: %s is not The input of net", name);
+    return false;
+  }
+  return FeedRef(idx, data, len);
+}
+
+bool PredictorImpl::FeedRef(size_t idx, void* data, size_t len) {
+  Blob* blob = FeedBlob(idx, len);
+  if (blob == nullptr) return false;
+  InputFed(idx);
+  if (blob->device_option().device_type() == kCUDA) {
+    OwnInput(idx);
+    pending_feed_.push_back({ idx, data });
+  } else {
+    // the bridge of a hybrid net copies from the memory directly
+    std::vector<TIndex> shape = blob->shape();
+    blob->RefReshape(shape, data);
+    external_input_ref_[idx] = true;
+  }
+  return true;
+}
+
+Blob* PredictorImpl::FeedBlob(size_t idx, size_t len) {
   if (idx >= external_input_blob_.size()) {
     LOG_ERROR("The idx=%u exceed size=%u", idx, external_input_blob_.size());
-    return false;
+    return nullptr;
   }
   Blob* blob = external_input_blob_[idx];
   if (blob == nullptr) {
     LOG_ERROR("The blob is null, idx=%u", idx);
-    return false;
+    return nullptr;
   }
   if (len != blob->size() * DataTypeSize(blob->data_type())) {
     LOG_ERROR("The len=%u need size=%u blob->size()=%u",
               len, blob->size() * DataTypeSize(blob->data_type()),
               blob->size());
-    return false;
+    return nullptr;
   }
-  const DeviceOption& device_option = blob->device_option();
-  if (device_option.device_type() == kCUDA) {
+  return blob;
+}
+
+void PredictorImpl::OwnInput(size_t idx) {
+  // a later feed replaces the pending copy
+  for (auto iter = pending_feed_.begin(); iter != pending_feed_.end();) {
+    iter = iter->idx == idx ? pending_feed_.erase(iter) : iter + 1;
+  }
+  if (!external_input_ref_[idx]) return;
+  Blob* blob = external_input_blob_[idx];
+  std::vector<TIndex> shape = blob->shape();
+  blob->Release();
+  blob->Reshape(shape);
+  external_input_ref_[idx] = false;
+}
+
+void PredictorImpl::FlushFeeds() {
+  if (pending_feed_.empty()) return;
 #ifdef USE_CUDA
-    CUDAContext context(device_option);
-    CUDA_CHECK(cudaMemcpyAsync(blob->as<char>(), data, blob->size() * DataTypeSize(blob->data_type()),
+  CUDAContext context(external_input_blob_[pending_feed_[0].idx]->device_option());
+  for (const auto& feed : pending_feed_) {
+    Blob* blob = external_input_blob_[feed.idx];
+    CUDA_CHECK(cudaMemcpyAsync(blob->as<char>(), feed.data, blob->size() * DataTypeSize(blob->data_type()),
                                cudaMemcpyHostToDevice, context.cuda_stream()));
-    context.FinishDeviceComputation();
-#endif
-  } else {
-    memcpy(blob->as<char>(), data, blob->size() * DataTypeSize(blob->data_type()));
   }
-  return true;
+  context.FinishDeviceComputation();
+#endif
+  pending_feed_.clear();
 }
 
 size_t PredictorImpl::InputSize() const {
@@ -170,7 +265,40 @@ const std::vector<std::string>& PredictorImpl::ListInputName() const {
 }
 
 bool PredictorImpl::Forward(const PredictorCallback&& cb) {
+  if (load_ == nullptr) return Run(std::move(cb));
+
+  std::shared_ptr<std::atomic<int>> load = load_;
+  ++(*load);
+  if (nullptr == cb) {
+    bool ret = Run(nullptr);
+    --(*load);
+    return ret;
+  }
+  // the callback is not invoked if the run fails
+  PredictorCallback inner_cb = std::move(cb);
+  bool ret = Run([load, inner_cb]() {
+    --(*load);
+    inner_cb();
+  });
+  if (!ret) --(*load);
+  return ret;
+}
+
+bool PredictorImpl::Run(const PredictorCallback&& cb) {
   try {
+    FlushFeeds();
+    output_copied_ = false;
+    if (common_fed_) {
+      // a dropped run leaves the common outputs invalid as well
+      net_->InvalidateCommon();
+      common_fed_ = false;
+    }
+    net_->set_deadline_micros(timeout_micros_ > 0 ?
+        batching::Env::NowMicros() + timeout_micros_ : 0);
+    // the hybrid nets carry the budget to the scheduler threads, the other
+    // nets run on the calling thread
+    net_->set_intra_op_threads(intra_op_threads_);
+    IntraOpThreadsGuard intra_op_guard(intra_op_threads_);
     if (nullptr == cb) {
       return net_->Run();
     } else {
@@ -182,6 +310,14 @@ bool PredictorImpl::Forward(const PredictorCallback&& cb) {
   }
 }
 
+void PredictorImpl::SetCommonReused(bool reused) {
+  net_->set_common_reused(reused);
+}
+
+bool PredictorImpl::DeadlineExceeded() const {
+  return net_->deadline_exceeded();
+}
+
 bool PredictorImpl::Output(const char* name, void** data, size_t* len) {
   int idx = OutputName2Idx(name);
   if (idx < 0) {
@@ -192,6 +328,19 @@ bool PredictorImpl::Output(const char* name, void** data, size_t* len) {
 }
 
 bool PredictorImpl::Output(size_t idx, void** data, size_t* len) {
+  bool on_device = false;
+  if (!OutputRef(idx, data, len, &on_device)) return false;
+  if (on_device) {
+    if (!output_copied_) {
+      CopyOutputs();
+      output_copied_ = true;
+    }
+    *data = external_output_blob_cpu_[idx]->as<char>();
+  }
+  return true;
+}
+
+bool PredictorImpl::OutputRef(size_t idx, void** data, size_t* len, bool* on_device) {
   if (idx >= external_output_blob_.size()) {
     LOG_ERROR("The idx=%u exceed size=%u", idx, external_output_blob_.size());
     return false;
@@ -201,27 +350,31 @@ bool PredictorImpl::Output(size_t idx, void** data, size_t* len) {
     LOG_ERROR("The blob is null, idx=%u", idx);
     return false;
   }
-  std::shared_ptr<Blob>& cpu_blob = external_output_blob_cpu_[idx];
-  cpu_blob->Reshape(blob->shape());
+  *data = blob->as<char>();
+  if (len) *len = blob->size() * DataTypeSize(blob->data_type());
+  if (on_device) *on_device = blob->device_option().device_type() == kCUDA;
+  return true;
+}
 
-  const DeviceOption& device_option = blob->device_option();
-  if (device_option.device_type() == kCUDA) {
+void PredictorImpl::CopyOutputs() {
 #ifdef USE_CUDA
-    CUDAContext context(device_option);
+  std::unique_ptr<CUDAContext> context;
+  for (size_t idx = 0; idx < external_output_blob_.size(); ++idx) {
+    Blob* blob = external_output_blob_[idx];
+    if (blob == nullptr || blob->device_option().device_type() != kCUDA) continue;
+    if (context == nullptr) context.reset(new CUDAContext(blob->device_option()));
+
+    size_t bytes = blob->size() * DataTypeSize(blob->data_type());
+    std::shared_ptr<Blob>& cpu_blob = external_output_blob_cpu_[idx];
+    cpu_blob->RefReshape(blob->shape(), external_output_pinned_[idx]->Reserve(bytes));
     CUDA_CHECK(cudaMemcpyAsync(cpu_blob->as<char>(),
                                blob->as<char>(),
-                               blob->size() * DataTypeSize(blob->data_type()),
+                               bytes,
                                cudaMemcpyDeviceToHost,
-                               context.cuda_stream()));
-    context.FinishDeviceComputation();
-#endif
-    *data = cpu_blob->as<char>();
-    if (len) *len = cpu_blob->size() * DataTypeSize(blob->data_type());
-  } else {
-    *data = blob->as<char>();
-    if (len) *len = blob->size() * DataTypeSize(blob->data_type());
+                               context->cuda_stream()));
   }
-  return true;
+  if (context != nullptr) context->FinishDeviceComputation();
+#endif
 }
 
 const std::vector<size_t>& PredictorImpl::OutputShape(size_t idx) const {
@@ -278,7 +431,8 @@ bool PredictorImpl::InternalParam(const char* name, void** data, size_t* len) {
     LOG_ERROR("The blob is null, name=%s", name);
     return false;
   }
-  std::shared_ptr<Blob>& cpu_blob = external_output_blob_cpu_[0]; // Borrow output[0]'s memory
+  std::shared_ptr<Blob>& cpu_blob = internal_blob_cpu_;
+  cpu_blob->set_data_type(static_cast<DataType>(blob->data_type()));
   cpu_blob->Reshape(blob->shape());
 
   const DeviceOption& device_option = blob->device_option();
@@ -4,6 +4,7 @@
  */
 #pragma once
 
+#include <atomic>
 #include <memory>
 
 #include "blaze/api/cpp_api/predictor.h"
@@ -13,6 +14,21 @@
 
 namespace blaze {
 
+// The pinned host memory of the outputs copied from gpu, which grows only.
+class PinnedBuffer {
+ public:
+  PinnedBuffer() : data_(nullptr), capacity_(0) { }
+  ~PinnedBuffer();
+
+  // The memory of at least bytes
+  void* Reserve(size_t bytes);
+
+ protected:
+  void* data_;
+  size_t capacity_;
+  DISABLE_COPY_AND_ASSIGN(PinnedBuffer);
+};
+
 class PredictorImpl {
  public:
   PredictorImpl(std::shared_ptr<Net>& net); 
@@ -24,15 +40,24 @@ class PredictorImpl {
 
   bool Feed(const char* name, const void* data, size_t len);
   bool Feed(size_t idx, const void* data, size_t len);
+  bool FeedRef(const char* name, void* data, size_t len);
+  bool FeedRef(size_t idx, void* data, size_t len);
   size_t InputSize() const;
   PredictDataType InputDataType(const char* name) const;
   PredictDataType InputDataType(size_t idx) const;
   const std::vector<std::string>& ListInputName() const; 
 
   bool Forward(const PredictorCallback&& cb); 
+  // Count the forwards in flight on load, such as of its replica
+  void SetLoadCounter(const std::shared_ptr<std::atomic<int>>& load) { load_ = load; }
+  void SetForwardTimeout(int64_t timeout_micros) { timeout_micros_ = timeout_micros; }
+  void SetIntraOpThreads(int intra_op_threads) { intra_op_threads_ = intra_op_threads; }
+  void SetCommonReused(bool reused);
+  bool DeadlineExceeded() const;
 
   bool Output(const char* name, void** data, size_t* len);
   bool Output(size_t idx, void** data, size_t* len);
+  bool OutputRef(size_t idx, void** data, size_t* len, bool* on_device);
   const std::vector<size_t>& OutputShape(size_t idx) const;
   const std::vector<size_t>& OutputShape(const char* name) const;
   PredictDataType OutputDataType(size_t idx) const;
@@ -51,15 +76,46 @@ class PredictorImpl {
  protected:
   int InputName2Idx(const char* name) const;
   int OutputName2Idx(const char* name) const;
+  bool Run(const PredictorCallback&& cb);
+  // Check the input blob of idx and the len fed to it
+  Blob* FeedBlob(size_t idx, size_t len);
+  // Mark the input of idx fed, the common ops of the next run are computed
+  // if it is common
+  void InputFed(size_t idx) { if (external_input_common_[idx]) common_fed_ = true; }
+  // Let the input blob of idx own its memory again after FeedRef
+  void OwnInput(size_t idx);
+  // Issue the pending copies of FeedRef to gpu, and wait for them once
+  void FlushFeeds();
+  // Copy all the gpu outputs to their pinned host memory, and wait once
+  void CopyOutputs();
 
   std::vector<std::shared_ptr<Blob>> external_output_blob_cpu_;
+  std::vector<std::unique_ptr<PinnedBuffer>> external_output_pinned_;
+  // Whether the gpu outputs of the last Forward are copied to host
+  bool output_copied_ = false;
+  std::shared_ptr<Blob> internal_blob_cpu_;
   std::vector<Blob*> external_output_blob_;
   std::unordered_map<std::string, int> external_output_blob_index_;
 
   std::vector<Blob*> external_input_blob_;
   std::unordered_map<std::string, int> external_input_blob_index_;
+  // Whether the cpu input blob refers to the memory of FeedRef
+  std::vector<bool> external_input_ref_;
+  // The gpu inputs fed by FeedRef, copied on Forward
+  struct PendingFeed {
+    size_t idx;
+    const void* data;
+  };
+  std::vector<PendingFeed> pending_feed_;
+  // Whether the input is common, and whether some common input is fed after
+  // the last Forward
+  std::vector<bool> external_input_common_;
+  bool common_fed_ = false;
 
   std::shared_ptr<Net> net_;
+  int64_t timeout_micros_ = 0;
+  int intra_op_threads_ = 0;
+  std::shared_ptr<std::atomic<int>> load_;
 };
 
 }  // namespace blaze
@@ -4,25 +4,148 @@
  */
 #include "blaze/api/cpp_api/predictor_manager_impl.h"
 
+#include <dlfcn.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+
 #include "blaze/api/cpp_api/predictor_impl.h"
+#include "blaze/common/exception.h"
+#include "blaze/common/numa.h"
 #include "blaze/common/proto_helper.h"
+#include "blaze/common/semaphore.h"
 #include "blaze/model_importer/ulf_importer.h"
 #include "blaze/model_importer/onnx_importer.h"
 #include "blaze/model_importer/mxnet_importer.h"
 #include "blaze/model_importer/tensorflow_importer.h"
 #include "blaze/model_importer/xdl_importer.h"
 #include "blaze/model_importer/xdl_ulf_importer.h"
+#include "blaze/scheduler/scheduler_manager.h"
 
 namespace blaze {
 
+namespace {
+
+// The sparse models loaded, which the managers loading the same unchanged
+// sparse model share, such as the model versions of an A/B test
+struct SharedSparseModels {
+  std::mutex mutex;
+  std::unordered_map<std::string, std::weak_ptr<SparsePuller>> pullers;
+};
+
+SharedSparseModels* GetSharedSparseModels() {
+  static SharedSparseModels shared;
+  return &shared;
+}
+
+// The key of the sparse model files, empty if they are not local
+std::string SparseModelKey(const std::string& uri, const std::string& ps_puller_type) {
+  struct stat st;
+  if (stat(uri.c_str(), &st) != 0) return "";
+  std::stringstream ss;
+  ss << ps_puller_type << ":" << uri << ":" << st.st_size << ":" << st.st_mtime;
+  return ss.str();
+}
+
+}  // namespace
+
+std::shared_ptr<SparsePuller> PredictorManagerImpl::LoadSparsePuller() {
+  std::shared_ptr<SparsePuller> sparse_puller(
+      SparsePullerCreationRegisterer::Get()->CreateSparsePuller(ps_puller_type_));
+  if (sparse_puller == nullptr) {
+    LOG_ERROR("unknown sparse puller type %s", ps_puller_type_.c_str());
+    return nullptr;
+  }
+  if (store::kOK != sparse_puller->Load(sparse_db_uri_)) {
+    LOG_ERROR("load sparse model %s failed", sparse_db_uri_.c_str());
+    return nullptr;
+  }
+  return sparse_puller;
+}
+
 bool PredictorManagerImpl::LoadSparseModelWeight(const char* uri, const char* ps_puller_type) {
   sparse_db_uri_ = uri;
   ps_puller_type_ = ps_puller_type;
 
-  sparse_puller_.reset(
-      SparsePullerCreationRegisterer::Get()->CreateSparsePuller(ps_puller_type_));
-  if (store::kOK != sparse_puller_->Load(sparse_db_uri_)) {
-    LOG_ERROR("load sparse model %s failed", sparse_db_uri_.c_str());
+  std::string key = SparseModelKey(sparse_db_uri_, ps_puller_type_);
+  sparse_puller_.reset();
+  if (!key.empty()) {
+    SharedSparseModels* shared = GetSharedSparseModels();
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    std::weak_ptr<SparsePuller>& entry = shared->pullers[key];
+    sparse_puller_ = entry.lock();
+    if (sparse_puller_ == nullptr) {
+      sparse_puller_ = LoadSparsePuller();
+      entry = sparse_puller_;
+    } else {
+      LOG_INFO("share the sparse model %s loaded", sparse_db_uri_.c_str());
+    }
+  } else {
+    sparse_puller_ = LoadSparsePuller();
+  }
+  if (sparse_puller_ == nullptr) return false;
+  shared_sparse_model_ = !key.empty();
+  if (sparse_result_cache_) {
+    sparse_puller_.reset(new store::CachedSparsePuller(sparse_puller_, sparse_result_cache_options_));
+  }
+  return true;
+}
+
+void PredictorManagerImpl::EnableSparseResultCache(size_t capacity_mb, int ttl_seconds) {
+  sparse_result_cache_ = true;
+  sparse_result_cache_options_.capacity_bytes = capacity_mb << 20;
+  sparse_result_cache_options_.ttl_micros = static_cast<uint64_t>(ttl_seconds) * 1000 * 1000;
+  // the predictors created share the sparse puller of the workspaces
+  if (sparse_puller_ != nullptr &&
+      dynamic_cast<store::CachedSparsePuller*>(sparse_puller_.get()) == nullptr) {
+    sparse_puller_.reset(new store::CachedSparsePuller(sparse_puller_, sparse_result_cache_options_));
+  }
+}
+
+bool PredictorManagerImpl::LoadAotNet(const char* library) {
+  // The library stays loaded, its net is registered for the process
+  void* handle = dlopen(library, RTLD_NOW | RTLD_GLOBAL);
+  if (handle == nullptr) {
+    LOG_ERROR("load aot net %s failed, msg=%s", library, dlerror());
+    return false;
+  }
+  auto net_name = reinterpret_cast<const char* (*)()>(dlsym(handle, "BlazeAotNetName"));
+  if (net_name == nullptr) {
+    LOG_ERROR("%s is not an aot net", library);
+    return false;
+  }
+  net_def_.set_run_mode(net_name());
+  return true;
+}
+
+bool PredictorManagerImpl::LoadSparseModelWeightDelta(const char* uri) {
+  if (sparse_puller_ == nullptr) {
+    LOG_ERROR("load sparse model delta %s before sparse model", uri);
+    return false;
+  }
+  if (shared_sparse_model_) {
+    // the delta applies to a copy of its own, the predictors created
+    // before keep pulling the shared sparse model
+    std::shared_ptr<SparsePuller> sparse_puller = LoadSparsePuller();
+    if (sparse_puller == nullptr) return false;
+    if (sparse_result_cache_) {
+      sparse_puller.reset(new store::CachedSparsePuller(sparse_puller, sparse_result_cache_options_));
+    }
+    sparse_puller_ = sparse_puller;
+    shared_sparse_model_ = false;
+    for (auto& workspaces : workspace_) {
+      for (auto& workspace : workspaces) {
+        if (workspace != nullptr) workspace->SetSparsePuller(sparse_puller_);
+      }
+    }
+  }
+  if (store::kOK != sparse_puller_->LoadDelta(uri)) {
+    LOG_ERROR("load sparse model delta %s failed", uri);
     return false;
   }
   return true;
@@ -32,78 +155,24 @@ bool PredictorManagerImpl::LoadModel(
     const char* model_conf, const char* model_data, ModelType model_type, bool optimization_pass) {
   model_conf_ = model_conf;
   model_data_ = model_data;
+  optimization_pass_ = optimization_pass;
 
   try {
-    switch (model_type) {
-      case kUlf:
-        // load unified layer format model defined in blaze, for manaually
-        // optimization.
-        {
-          ULFImporter ulf_importer;
-          ulf_importer.set_data_type(data_type_);
-          ulf_importer.LoadModel(model_conf_.c_str(), model_data_.c_str());
-          net_def_ = ulf_importer.net_def();
-        }
-        break;
-      case kBlaze:
-        {
-          bool success = NetDefHelper::LoadNetDefFromBinaryFile(model_conf, &net_def_);
-          if (!success) {
-            LOG_ERROR("Load model %s failed", model_conf);
-            return false;
-          }
-        }
-        break;
-      case kOnnx:
-        // load onnx model
-        {
-          ONNXImporter onnx_importer;
-          onnx_importer.set_data_type(data_type_);
-          onnx_importer.LoadModel(model_conf, model_data);
-          net_def_ = onnx_importer.net_def();
-        }
-        break;
-      case kMxnet:
-        // load mxnet model
-        {
-          MXNetImporter mxnet_importer;
-          mxnet_importer.set_data_type(data_type_);
-          mxnet_importer.LoadModel(model_conf, model_data);
-          net_def_ = mxnet_importer.net_def();
-        }
-        break;
-      case kTensorFlow:
-        // load tensorflow model
-        {
-          TensorFlowImporter tensorflow_importer;
-          tensorflow_importer.set_data_type(data_type_);
-          tensorflow_importer.LoadModel(model_conf, model_data);
-          net_def_ = tensorflow_importer.net_def();
-        }
-        break;
-      case kXDL:
-        // load xdl model
-        {
-          XdlImporter xdl_importer;
-          xdl_importer.set_data_type(data_type_);
-          xdl_importer.LoadModel(model_conf, model_data);
-          net_def_ = xdl_importer.net_def();
-        }
-        break;
-      case kXDLUlf:
-        // load xdl ulf model
-        {
-          XdlULFImporter xdl_ulf_importer;
-          xdl_ulf_importer.set_data_type(data_type_);
-          xdl_ulf_importer.LoadModel(model_conf, model_data);
-          net_def_ = xdl_ulf_importer.net_def();
-        }
-        break;
-      default:
-        {
-          LOG_FATAL("Unkown model_type: %d", model_type);
+    std::string cache_file = ModelCacheFile(model_type);
+    struct stat st;
+    if (!cache_file.empty() && stat(cache_file.c_str(), &st) == 0 &&
+        NetDefHelper::LoadNetDefFromBinaryFile(cache_file.c_str(), &net_def_)) {
+      LOG_INFO("load model conf=%s from cache %s", model_conf, cache_file.c_str());
+    } else {
+      if (!ImportModel(model_type)) return false;
+      if (!cache_file.empty()) {
+        // renamed once written, the cache is never seen partially
+        std::string tmp_file = cache_file + ".tmp";
+        if (!NetDefHelper::SaveNetDefToBinaryFile(tmp_file.c_str(), &net_def_) ||
+            rename(tmp_file.c_str(), cache_file.c_str()) != 0) {
+          LOG_ERROR("save model cache %s failed", cache_file.c_str());
         }
-        break;
+      }
     }
     if (optimization_pass) {
       // pass optimization.
@@ -117,6 +186,124 @@ bool PredictorManagerImpl::LoadModel(
   return true;
 }
 
+bool PredictorManagerImpl::ImportModel(ModelType model_type) {
+  switch (model_type) {
+    case kUlf:
+      // load unified layer format model defined in blaze, for manaually
+      // optimization.
+      {
+        ULFImporter ulf_importer;
+        ulf_importer.set_data_type(data_type_);
+        ulf_importer.LoadModel(model_conf_.c_str(), model_data_.c_str());
+        net_def_.Swap(ulf_importer.mutable_net_def());
+      }
+      break;
+    case kBlaze:
+      {
+        bool success = NetDefHelper::LoadNetDefFromBinaryFile(model_conf_.c_str(), &net_def_);
+        if (!success) {
+          LOG_ERROR("Load model %s failed", model_conf_.c_str());
+          return false;
+        }
+      }
+      break;
+    case kOnnx:
+      // load onnx model
+      {
+        ONNXImporter onnx_importer;
+        onnx_importer.set_data_type(data_type_);
+        onnx_importer.LoadModel(model_conf_.c_str(), model_data_.c_str());
+        net_def_.Swap(onnx_importer.mutable_net_def());
+      }
+      break;
+    case kMxnet:
+      // load mxnet model
+      {
+        MXNetImporter mxnet_importer;
+        mxnet_importer.set_data_type(data_type_);
+        mxnet_importer.LoadModel(model_conf_.c_str(), model_data_.c_str());
+        net_def_.Swap(mxnet_importer.mutable_net_def());
+      }
+      break;
+    case kTensorFlow:
+      // load tensorflow model
+      {
+        TensorFlowImporter tensorflow_importer;
+        tensorflow_importer.set_data_type(data_type_);
+        tensorflow_importer.LoadModel(model_conf_.c_str(), model_data_.c_str());
+        net_def_.Swap(tensorflow_importer.mutable_net_def());
+      }
+      break;
+    case kXDL:
+      // load xdl model
+      {
+        XdlImporter xdl_importer;
+        xdl_importer.set_data_type(data_type_);
+        xdl_importer.LoadModel(model_conf_.c_str(), model_data_.c_str());
+        net_def_.Swap(xdl_importer.mutable_net_def());
+      }
+      break;
+    case kXDLUlf:
+      // load xdl ulf model
+      {
+        XdlULFImporter xdl_ulf_importer;
+        xdl_ulf_importer.set_data_type(data_type_);
+        xdl_ulf_importer.LoadModel(model_conf_.c_str(), model_data_.c_str());
+        net_def_.Swap(xdl_ulf_importer.mutable_net_def());
+      }
+      break;
+    default:
+      {
+        LOG_FATAL("Unkown model_type: %d", model_type);
+      }
+      break;
+  }
+  return true;
+}
+
+std::string PredictorManagerImpl::ModelCacheFile(ModelType model_type) const {
+  if (model_cache_dir_.empty() || model_type == kBlaze) return "";
+  // keyed by the files and their versions, a changed model misses the cache
+  std::stringstream key;
+  key << model_type << ':' << data_type_;
+  for (const auto& file : { model_conf_, model_data_ }) {
+    struct stat st;
+    if (file.empty()) continue;
+    if (stat(file.c_str(), &st) != 0) return "";
+    key << ':' << file << ':' << st.st_size << ':' << st.st_mtime;
+  }
+  std::string name = model_conf_.substr(model_conf_.rfind('/') + 1);
+  std::stringstream ss;
+  ss << model_cache_dir_ << '/' << name << '.' << std::hex
+     << std::hash<std::string>()(key.str()) << ".blaze";
+  return ss.str();
+}
+
+void PredictorManagerImpl::EnableReplicas(bool cpu_replica) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  replicas_.clear();
+  int gpu_count = 0;
+#ifdef USE_CUDA
+  CUDA_CHECK(cudaGetDeviceCount(&gpu_count));
+  for (int i = 0; i < gpu_count && i < kMaxNumDeviceId; ++i) {
+    DeviceOption device_option;
+    device_option.set_device_type(kCUDA);
+    device_option.set_device_id(i);
+    replicas_.push_back(device_option);
+  }
+#endif
+  if (cpu_replica || gpu_count == 0) {
+    // a cpu replica per numa node if the cpu schedulers are per node
+    int node_num = SchedulerManager<AsyncTask>::Instance()->numa_aware() ? NumaNodeNum() : 1;
+    for (int i = 0; i < node_num && i < kMaxNumDeviceId; ++i) {
+      DeviceOption device_option;
+      device_option.set_device_type(kCPU);
+      device_option.set_device_id(i);
+      replicas_.push_back(device_option);
+    }
+  }
+}
+
 Predictor* PredictorManagerImpl::CreatePredictor(PredictDeviceType predict_device, int device_id) {
   std::lock_guard<std::mutex> lock(mutex_);
   try {
@@ -126,32 +313,58 @@ Predictor* PredictorManagerImpl::CreatePredictor(PredictDeviceType predict_devic
     switch (predict_device) {
       case kPDT_CPU:
         device_option.set_device_type(kCPU);
-        device_option.set_device_id(0);
+        device_option.set_device_id(
+            SchedulerManager<AsyncTask>::Instance()->numa_aware() && device_id < NumaNodeNum() ?
+            device_id : 0);
         break;
       case kPDT_CUDA:
         device_option.set_device_type(kCUDA);
         device_option.set_device_id(device_id);
         break;
       default:
-        ProbeDevice(&device_option);
+        if (replicas_.empty()) {
+          ProbeDevice(&device_option);
+        } else {
+          LeastLoadedReplica(&device_option);
+        }
         break;
     }
     int device_type = device_option.device_type();
     int device_id = device_option.device_id();
+    BLAZE_CONDITION_THROW(device_id < kMaxNumDeviceId,
+                          "device_id=", device_id, " kMaxNumDeviceId=", kMaxNumDeviceId);
 
+    // the weights and the blobs of the nets are first touched on the numa
+    // node of the device
+    NumaNodeGuard numa_guard(NumaNode(device_option));
     if (workspace_[device_type][device_id].get() == nullptr) {
       workspace_[device_type][device_id].reset(new Workspace());
       workspace_[device_type][device_id]->Init(net_def_);
 
-      auto mutable_device_option =
-          workspace_[device_type][device_id]->net_def()->mutable_device_option();
+      NetDef* net_def = workspace_[device_type][device_id]->net_def().get();
+      auto mutable_device_option = net_def->mutable_device_option();
       mutable_device_option->set_device_type(device_type);
       mutable_device_option->set_device_id(device_id);
+      if (device_type == kCUDA && SchedulerManager<AsyncTask>::Instance()->numa_aware()) {
+        // the cpu ops of the gpu net run on the scheduler of the local node
+        for (auto& op : *net_def->mutable_op()) {
+          if (op.has_device_option() && op.device_option().device_type() == kCPU) {
+            op.mutable_device_option()->set_device_id(NumaNode(device_option));
+          }
+        }
+      }
+      if (optimization_pass_) {
+        // the memory plan depends on the device of the workspace.
+        *net_def = Optimizer::Get()->RunPass(*net_def, workspace_[device_type][device_id].get());
+      }
 
       workspace_[device_type][device_id]->SetSparsePuller(sparse_puller_);
+      load_[device_type][device_id].reset(new std::atomic<int>(0));
     }
     std::shared_ptr<Net> net = workspace_[device_type][device_id]->CreateNet();
-    return new Predictor(new PredictorImpl(net));
+    PredictorImpl* predictor_impl = new PredictorImpl(net);
+    predictor_impl->SetLoadCounter(load_[device_type][device_id]);
+    return new Predictor(predictor_impl);
   } catch (std::exception& e) {
     LOG_ERROR("Create Model Predictor failed, %s msg=%s",
               model_conf_.c_str(), e.what());
@@ -159,6 +372,93 @@ Predictor* PredictorManagerImpl::CreatePredictor(PredictDeviceType predict_devic
   }
 }
 
+bool PredictorManagerImpl::WarmUp(const std::vector<size_t>& batch_sizes,
+                                  const WarmUpFeeder& feeder, int concurrency) {
+  if (concurrency < 1) concurrency = 1;
+  for (const auto& device_option : ServedDevices()) {
+    PredictDeviceType predict_device = device_option.device_type() == kCUDA ? kPDT_CUDA : kPDT_CPU;
+    for (size_t batch_size : batch_sizes) {
+      std::vector<std::unique_ptr<Predictor>> predictors;
+      for (int i = 0; i < concurrency; ++i) {
+        Predictor* predictor = CreatePredictor(predict_device, device_option.device_id());
+        if (predictor == nullptr) return false;
+        predictors.emplace_back(predictor);
+        if (!feeder(predictor, batch_size)) {
+          LOG_ERROR("feed warm up batch_size=%u device_type=%d device_id=%d failed",
+                    batch_size, device_option.device_type(), device_option.device_id());
+          return false;
+        }
+      }
+      // forwarded at once, each scheduler thread builds its device handles
+      Semaphore done;
+      int forwarded = 0;
+      bool success = true;
+      for (auto& predictor : predictors) {
+        if (!predictor->Forward([&done]() { done.notify(); })) {
+          success = false;
+          break;
+        }
+        ++forwarded;
+      }
+      for (int i = 0; i < forwarded; ++i) done.wait();
+      if (!success) {
+        LOG_ERROR("forward warm up batch_size=%u device_type=%d device_id=%d failed",
+                  batch_size, device_option.device_type(), device_option.device_id());
+        return false;
+      }
+    }
+    LOG_INFO("warm up device_type=%d device_id=%d done",
+             device_option.device_type(), device_option.device_id());
+  }
+  return true;
+}
+
+std::vector<DeviceOption> PredictorManagerImpl::ServedDevices() {
+  std::vector<DeviceOption> devices;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    devices = replicas_;
+  }
+  if (!devices.empty()) return devices;
+
+  // the devices ProbeDevice takes in turn
+  int gpu_count = 0;
+#ifdef USE_CUDA
+  CUDA_CHECK(cudaGetDeviceCount(&gpu_count));
+#endif
+  DeviceOption device_option;
+  device_option.set_device_type(gpu_count > 0 ? kCUDA : kCPU);
+  for (int i = 0; i < std::max(gpu_count, 1) && i < kMaxNumDeviceId; ++i) {
+    device_option.set_device_id(i);
+    devices.push_back(device_option);
+  }
+  return devices;
+}
+
+void PredictorManagerImpl::LeastLoadedReplica(DeviceOption* device_option) {
+  // the scan starts after the last pick, so the equally loaded replicas
+  // take the predictors in turn
+  size_t picked = next_replica_ % replicas_.size();
+  int min_load = -1;
+  for (size_t i = 0; i < replicas_.size(); ++i) {
+    size_t idx = (next_replica_ + i) % replicas_.size();
+    const auto& load = load_[replicas_[idx].device_type()][replicas_[idx].device_id()];
+    // the replica not created yet is idle
+    int cur_load = load == nullptr ? 0 : load->load();
+    if (min_load >= 0 && cur_load >= min_load) continue;
+    picked = idx;
+    min_load = cur_load;
+  }
+  *device_option = replicas_[picked];
+  next_replica_ = picked + 1;
+}
+
+int PredictorManagerImpl::NumaNode(const DeviceOption& device_option) const {
+  if (!SchedulerManager<AsyncTask>::Instance()->numa_aware()) return -1;
+  if (device_option.device_type() == kCUDA) return GpuNumaNode(device_option.device_id());
+  return device_option.device_id();
+}
+
 void PredictorManagerImpl::ProbeDevice(DeviceOption* device_option) {
 #ifdef USE_CUDA
   static int current_device_id = 0;
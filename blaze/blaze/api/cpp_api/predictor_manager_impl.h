@@ -4,44 +4,88 @@
  */
 #include "blaze/api/cpp_api/predictor.h"
 
+#include <atomic>
 #include <string>
 #include <mutex>
+#include <vector>
 
 #include "blaze/common/common_defines.h"
 #include "blaze/optimizer/optimizer.h"
+#include "blaze/store/cached_sparse_puller.h"
 #include "blaze/store/sparse_puller.h"
 
 namespace blaze {
 
 class PredictorManagerImpl {
  public:
-  PredictorManagerImpl() : data_type_(kFloat) { }
+  PredictorManagerImpl() :
+      data_type_(kFloat), optimization_pass_(false), shared_sparse_model_(false),
+      sparse_result_cache_(false), next_replica_(0) { }
 
   // Set DataType
   void SetDataType(DataType data_type) { data_type_ = data_type; }
   // Set run mode
   void SetRunMode(const char* run_mode) { net_def_.set_run_mode(run_mode); }
-  // load sparse model weight
+  // Load the library of an aot net and run the net
+  bool LoadAotNet(const char* library);
+  // load sparse model weight, which is shared with the other managers
+  // loading the same sparse model files
   bool LoadSparseModelWeight(const char* uri, const char* ps_puller_type);
+  // apply sparse model weight delta
+  bool LoadSparseModelWeightDelta(const char* uri);
+  // cache the pooled results of the sparse puller
+  void EnableSparseResultCache(size_t capacity_mb, int ttl_seconds);
+  // Cache the imported models in dir
+  void SetModelCacheDir(const char* dir) { model_cache_dir_ = dir; }
   // Load model
   bool LoadModel(const char* model_conf, const char* model_data, ModelType model_type, bool optimization_pass);
+  // Balance the probed predictors across the replicas
+  void EnableReplicas(bool cpu_replica);
   // Create new predictor handle
   Predictor* CreatePredictor(PredictDeviceType predict_device, int device_id);
+  // Forward the synthetic batches on the devices served
+  bool WarmUp(const std::vector<size_t>& batch_sizes, const WarmUpFeeder& feeder, int concurrency);
 
  protected:
+  // Create and load the sparse puller of the sparse model, nullptr if failed
+  std::shared_ptr<SparsePuller> LoadSparsePuller();
+  // Import the model of model_type into net_def_
+  bool ImportModel(ModelType model_type);
+  // The cache file of the imported model, empty if not cached
+  std::string ModelCacheFile(ModelType model_type) const;
+  // The devices the probed predictors may be created on
+  std::vector<DeviceOption> ServedDevices();
   // Probe the available device.
   void ProbeDevice(DeviceOption* device_option);
+  // The replica with the fewest forwards in flight
+  void LeastLoadedReplica(DeviceOption* device_option);
+  // The numa node the workspace of the device is local to
+  int NumaNode(const DeviceOption& device_option) const;
 
   static const int kMaxNumDevice = 4;
   static const int kMaxNumDeviceId = 8;
+  // The cpu device id is the numa node if the schedulers are numa aware
   std::shared_ptr<Workspace> workspace_[kMaxNumDevice][kMaxNumDeviceId];
+  // The forwards in flight on each workspace
+  std::shared_ptr<std::atomic<int>> load_[kMaxNumDevice][kMaxNumDeviceId];
 
   DataType data_type_;
+  // Whether to run the workspace passes on the net of a device
+  bool optimization_pass_;
   NetDef net_def_;  // The model graph
 
   std::string model_conf_, model_data_;
+  std::string model_cache_dir_;
   std::string sparse_db_uri_, ps_puller_type_;
   std::shared_ptr<SparsePuller> sparse_puller_;  // The sparse puller.
+  // Whether the sparse puller is shared with the other managers
+  bool shared_sparse_model_;
+  // Whether to cache the pooled results of the sparse puller
+  bool sparse_result_cache_;
+  store::CachedSparsePuller::Options sparse_result_cache_options_;
+  // The devices the probed predictors are balanced across, none if disabled
+  std::vector<DeviceOption> replicas_;
+  size_t next_replica_;
   std::mutex mutex_;
 };
 
@@ -0,0 +1,168 @@
+// Adaptive Batch Policy
+//
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include "blaze/common/log.h"
+
+namespace blaze {
+namespace batching {
+
+/// The recent batches of a queue
+struct BatchStats {
+  /// The current limits of the queue
+  int max_batch_size = 0;
+  int64_t batch_timeout_micros = 0;
+
+  /// The number of batches processed
+  int64_t num_batches = 0;
+  /// The mean of batch size / max_batch_size
+  double fill_ratio = 0;
+  /// The mean time the first task of a batch waits before processing
+  double queueing_delay_micros = 0;
+  /// The mean processing time of a batch
+  double service_micros = 0;
+  /// The p99 of queueing delay + processing time
+  double p99_latency_micros = 0;
+  /// The number of tasks dropped as they could not meet their deadline
+  int64_t num_dropped = 0;
+};
+
+/// Tunes the max batch size and the batch timeout of a queue to keep the p99
+/// latency of its batches under a target. The batch size moves along the
+/// buckets, the shapes the model serves fast, such as the precompiled ones,
+/// halves when the target is missed, goes to the next bucket when the
+/// batches are full and there is room, and the timeout follows.
+class AdaptiveBatchPolicy {
+ public:
+  /// The batches of each adjustment, and of the latency window
+  static const size_t kAdjustBatches = 64;
+  static const size_t kWindowBatches = 512;
+
+  /// max_batch_size and batch_timeout_micros are the upper bounds,
+  /// latency_target_micros of 0 keeps them static.
+  AdaptiveBatchPolicy(int max_batch_size, int64_t batch_timeout_micros,
+                      int64_t latency_target_micros, const std::vector<int>& buckets)
+      : max_timeout_micros_(batch_timeout_micros),
+        latency_target_micros_(latency_target_micros),
+        batch_size_(max_batch_size), timeout_micros_(batch_timeout_micros) {
+    for (int bucket : buckets) {
+      if (bucket > 0 && bucket < max_batch_size) buckets_.push_back(bucket);
+    }
+    if (buckets_.empty()) {
+      for (int bucket = 1; bucket < max_batch_size; bucket *= 2) buckets_.push_back(bucket);
+    }
+    buckets_.push_back(max_batch_size);
+    std::sort(buckets_.begin(), buckets_.end());
+    buckets_.erase(std::unique(buckets_.begin(), buckets_.end()), buckets_.end());
+  }
+
+  bool adaptive() const { return latency_target_micros_ > 0; }
+  int max_batch_size() const { return batch_size_; }
+  int64_t batch_timeout_micros() const { return timeout_micros_; }
+  /// The moving average of the processing time, to tell the tasks which can
+  /// still meet their deadline
+  int64_t expected_service_micros() const { return service_ewma_micros_; }
+
+  /// Records a processed batch
+  void Record(size_t size, int64_t queueing_micros, int64_t service_micros) {
+    ++num_batches_;
+    service_ewma_micros_ = num_batches_ == 1 ? service_micros :
+        (service_ewma_micros_ * 7 + service_micros) / 8;
+    records_.push_back({ static_cast<double>(size) / batch_size_, queueing_micros,
+                         service_micros });
+    if (records_.size() > kWindowBatches) records_.pop_front();
+    if (adaptive() && ++since_adjust_ >= kAdjustBatches) {
+      since_adjust_ = 0;
+      Adjust();
+    }
+  }
+
+  /// Records the tasks dropped for their deadline
+  void RecordDrop(size_t num_tasks) { num_dropped_ += num_tasks; }
+
+  BatchStats stats() const {
+    BatchStats stats;
+    stats.num_dropped = num_dropped_;
+    stats.max_batch_size = batch_size_;
+    stats.batch_timeout_micros = timeout_micros_;
+    stats.num_batches = num_batches_;
+    if (records_.empty()) return stats;
+    std::vector<double> latency;
+    for (const auto& record : records_) {
+      stats.fill_ratio += record.fill_ratio;
+      stats.queueing_delay_micros += record.queueing_micros;
+      stats.service_micros += record.service_micros;
+      latency.push_back(record.queueing_micros + record.service_micros);
+    }
+    stats.fill_ratio /= records_.size();
+    stats.queueing_delay_micros /= records_.size();
+    stats.service_micros /= records_.size();
+    size_t p99 = latency.size() * 99 / 100;
+    std::nth_element(latency.begin(), latency.begin() + p99, latency.end());
+    stats.p99_latency_micros = latency[p99];
+    return stats;
+  }
+
+ protected:
+  struct BatchRecord {
+    double fill_ratio;
+    int64_t queueing_micros;
+    int64_t service_micros;
+  };
+
+  void Adjust() {
+    // The p99 below kHeadroom of the target leaves room to grow, the batch
+    // size grows if the batches are kFullRatio full.
+    const double kHeadroom = 0.8;
+    const double kFullRatio = 0.8;
+    const int64_t kTimeoutStepMicros = 50;
+
+    BatchStats stats = this->stats();
+    int batch_size = batch_size_;
+    int64_t timeout_micros = timeout_micros_;
+    auto iter = std::lower_bound(buckets_.begin(), buckets_.end(), batch_size_);
+    if (stats.p99_latency_micros > latency_target_micros_) {
+      // Multiplicative decrease of the batch size and timeout
+      int half = std::max(1, batch_size_ / 2);
+      auto below = std::upper_bound(buckets_.begin(), buckets_.end(), half);
+      batch_size_ = below == buckets_.begin() ? buckets_.front() : *(below - 1);
+      timeout_micros_ /= 2;
+    } else if (stats.p99_latency_micros < latency_target_micros_ * kHeadroom) {
+      if (stats.fill_ratio >= kFullRatio && iter + 1 < buckets_.end()) {
+        batch_size_ = *(iter + 1);
+      }
+      // Waiting longer fills the batches, as long as the wait fits the target
+      int64_t room = latency_target_micros_ - static_cast<int64_t>(stats.p99_latency_micros);
+      int64_t step = std::min(std::max(kTimeoutStepMicros, timeout_micros_), room / 2);
+      timeout_micros_ = std::min(max_timeout_micros_, timeout_micros_ + step);
+    }
+    if (batch_size == batch_size_ && timeout_micros == timeout_micros_) return;
+    // The window measures the new limits
+    records_.clear();
+    LOG_DEBUG("adaptive batching: p99=%.0fus fill=%.2f queueing=%.0fus -> "
+              "max_batch_size=%d batch_timeout_micros=%ld",
+              stats.p99_latency_micros, stats.fill_ratio, stats.queueing_delay_micros,
+              batch_size_, static_cast<long>(timeout_micros_));
+  }
+
+  const int64_t max_timeout_micros_;
+  const int64_t latency_target_micros_;
+  std::vector<int> buckets_;
+
+  int batch_size_;
+  int64_t timeout_micros_;
+  int64_t num_batches_ = 0;
+  int64_t num_dropped_ = 0;
+  int64_t service_ewma_micros_ = 0;
+  size_t since_adjust_ = 0;
+  std::deque<BatchRecord> records_;
+};
+
+}  // namespace batching
+}  // namespace blaze
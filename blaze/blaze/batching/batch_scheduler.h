@@ -4,6 +4,7 @@
 
 #include <vector>
 
+#include "blaze/batching/adaptive_batch_policy.h"
 #include "blaze/batching/mutex.h"
 #include "blaze/batching/notification.h"
 
@@ -86,6 +87,7 @@ enum Status {
   kOk = 0,
   kUnavailable = 1,
   kError = 2,
+  kDeadlineExceeded = 3,
 };
 
 /// An abstract batch scheduler class. Collects individial tasks into batches.
@@ -115,6 +117,9 @@ class BatchScheduler {
   /// Returns a guaranteed number of size 1 tasks that can be Schedule()d
   /// without getting an UNAVAILABLE error
   virtual size_t SchedulingCapacity() const = 0;
+
+  /// Returns the stats of the recent batches
+  virtual BatchStats stats() const { return BatchStats(); }
 };
 
 /// Implemation
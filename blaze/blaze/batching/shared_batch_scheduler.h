@@ -2,13 +2,18 @@
 //
 #pragma once
 
-#include <deque>
-#include <string>
+#include <limits>
 #include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "blaze/scheduler/scheduler.h"
 #include "blaze/common/common_defines.h"
 #include "blaze/common/exception.h"
+#include "blaze/batching/adaptive_batch_policy.h"
 #include "blaze/batching/batch_scheduler.h"
 #include "blaze/batching/periodic_function.h"
 
@@ -54,6 +59,19 @@ class SharedBatchScheduler : public std::enable_shared_from_this<SharedBatchSche
     /// maximum allowable number of enqueued tasks in terms of batches.
     /// if this limit is reached, Schedule will return an Unavailable error.
     int64_t max_enqueued_batches = 10;
+
+    /// The p99 latency target of the batches, max_batch_size and
+    /// batch_timeout_micros are adapted under it when positive.
+    int64_t latency_target_micros = 0;
+
+    /// The batch sizes the adaptive max_batch_size takes, powers of two if empty
+    std::vector<int> batch_size_buckets;
+
+    /// Called with the tasks which can no longer meet their deadline, the
+    /// batches are formed by earliest deadline first. Schedule returns a
+    /// DeadlineExceeded error for the tasks late at arrival. Late tasks are
+    /// kept and processed if empty.
+    std::function<void(std::unique_ptr<TaskType>)> drop_task_callback;
   };
   /// Add Queue
   bool AddQueue(const QueueOptions& options,
@@ -86,10 +104,22 @@ class SharedBatchScheduler : public std::enable_shared_from_this<SharedBatchSche
 
 namespace internal {
 
+/// The absolute deadline of the task in micros of Env::NowMicros, read from
+/// its deadline_micros member, 0 if it has none.
+template <typename TaskType>
+auto TaskDeadlineMicros(const TaskType& task, int) -> decltype(uint64_t(task.deadline_micros)) {
+  return task.deadline_micros;
+}
+template <typename TaskType>
+uint64_t TaskDeadlineMicros(const TaskType& task, long) {
+  return 0;
+}
+
 /// A task queue for SharedBatchScheduler. Accepts tasks and accumulates them
 /// into batches, and dispenses those batches to be processed via a "pull"
 /// interface. The queue's behavior is governed by maximum batch size, timeout
-/// and maximum queue length parameters
+/// and maximum queue length parameters. The batches take the tasks by
+/// earliest deadline, then by arrival.
 template <typename TaskType>
 class Queue {
  public:
@@ -116,9 +146,17 @@ class Queue {
   /// Called by a thread that is ready to process a batch
   std::unique_ptr<Batch<TaskType>> ScheduleBatch();
 
-  /// Processes a batch that has been returned earlier by ScheduleBatch()
+  /// Processes a batch that has been returned earlier by ScheduleBatch(),
+  /// after handing the dropped tasks to the drop callback. The batch is empty
+  /// if all its tasks were dropped.
   void ProcessBatch(std::unique_ptr<Batch<TaskType>> batch);
 
+  /// The stats of the recent batches
+  BatchStats stats() const {
+    mutex_lock l(mu_);
+    return policy_.stats();
+  }
+
   /// Determines whether the queue is empty
   bool IsEmpty() const;
 
@@ -132,16 +170,22 @@ class Queue {
   }
 
  private:
+  /// The enqueued tasks and their enqueue time, keyed by (deadline, arrival)
+  /// where the tasks without a deadline take the max deadline.
+  using TaskMap = std::map<std::pair<uint64_t, uint64_t>, std::pair<std::unique_ptr<TaskType>, uint64_t>>;
+
   /// Same as IsEmpty, but assume the caller already holds a lock on mu_
   bool IsEmptyInternal() const;
 
-  /// Closes the open batch residing at the back of 'batches_', and inserts a
-  /// fresh open batch behind it
-  void StartNewBatch();
+  /// Determines whether the enqueued tasks make a batch schedulable at
+  /// now_micros: full, timed out, or due to meet the earliest deadline.
+  bool IsBatchSchedulable(uint64_t now_micros) const;
+
+  /// Moves the tasks which can not finish by their deadline to 'dropped_tasks_'
+  void DropLateTasks(uint64_t now_micros);
 
-  /// Determines whether the open batch residing at the back of 'batches_' is
-  /// currently schedulable.
-  bool IsOpenBatchSchedulable();
+  /// Removes the task at iter from the enqueued tasks
+  std::unique_ptr<TaskType> TakeTask(typename TaskMap::iterator iter);
 
   /// queue options
   const typename SharedBatchScheduler<TaskType>::QueueOptions options_;
@@ -157,11 +201,21 @@ class Queue {
   /// for the duration of this object's life.
   bool closed_ = false;
 
-  /// The enqueued batches
-  std::deque<std::unique_ptr<Batch<TaskType>>> batches_;
-  /// The time at which the first task was added to the open (back-most) batch
-  /// in 'batches_'. Valid iff that batch contains at least one task
-  int64_t open_batch_start_time_micros_;
+  /// The enqueued tasks
+  TaskMap tasks_;
+  /// The enqueue time of the enqueued tasks by arrival, the oldest first
+  std::map<uint64_t, uint64_t> arrival_micros_;
+  uint64_t num_arrivals_ = 0;
+  /// The total size of the enqueued tasks
+  size_t tasks_size_ = 0;
+  /// The tasks to be handed to the drop callback by ProcessBatch()
+  std::vector<std::unique_ptr<TaskType>> dropped_tasks_;
+
+  /// The start time of the scheduled batches
+  std::unordered_map<const Batch<TaskType>*, uint64_t> scheduled_batch_start_micros_;
+
+  /// The current max batch size and timeout
+  AdaptiveBatchPolicy policy_;
 
   /// Whether this queue contains a batch that is eligible to be scheduled
   bool schedulable_batch_ = false;
@@ -185,6 +239,7 @@ class QueueHandle : public BatchScheduler<TaskType> {
   Status Schedule(std::unique_ptr<TaskType>* task) override;
   size_t NumEnqueuedTasks() const override;
   size_t SchedulingCapacity() const override;
+  BatchStats stats() const override;
 
  private:
   std::shared_ptr<SharedBatchScheduler<TaskType>> scheduler_;
@@ -328,17 +383,12 @@ Queue<TaskType>::Queue(const typename SharedBatchScheduler<TaskType>::QueueOptio
                        SchedulableBatchCallback schedulable_batch_callback) :
     options_(options),
     process_batch_callback_(process_batch_callback),
-    schedulable_batch_callback_(schedulable_batch_callback) {
-  /// Create an initial, open batch
-  batches_.emplace_back(new Batch<TaskType>);
-}
+    schedulable_batch_callback_(schedulable_batch_callback),
+    policy_(options.max_batch_size, options.batch_timeout_micros,
+            options.latency_target_micros, options.batch_size_buckets) { }
 
 template <typename TaskType>
-Queue<TaskType>::~Queue() {
-  mutex_lock l(mu_);
-  /// Close the (empty) open batch, so its destructor doesn't block.
-  batches_.back()->Close();
-}
+Queue<TaskType>::~Queue() { }
 
 template <typename TaskType>
 Status Queue<TaskType>::Schedule(std::unique_ptr<TaskType>* task) {
@@ -346,22 +396,26 @@ Status Queue<TaskType>::Schedule(std::unique_ptr<TaskType>* task) {
   {
     mutex_lock l(mu_);
 
-    if (batches_.back()->size() + (*task)->size() > options_.max_batch_size) {
-      if (batches_.size() >= options_.max_enqueued_batches) {
-        return kUnavailable;
-      }
-      StartNewBatch();
+    const size_t size = (*task)->size();
+    if (!tasks_.empty() &&
+        tasks_size_ + size > options_.max_enqueued_batches * policy_.max_batch_size()) {
+      return kUnavailable;
     }
-    if (batches_.back()->empty()) {
-      open_batch_start_time_micros_ = Env::NowMicros();
+    const uint64_t now_micros = Env::NowMicros();
+    const uint64_t deadline_micros = TaskDeadlineMicros(**task, 0);
+    if (deadline_micros != 0 && options_.drop_task_callback &&
+        now_micros + policy_.expected_service_micros() > deadline_micros) {
+      policy_.RecordDrop(1);
+      return kDeadlineExceeded;
     }
-    batches_.back()->AddTask(std::move(*task));
-
-    if (!schedulable_batch_) {
-      if (batches_.size() > 1 || IsOpenBatchSchedulable()) {
-        schedulable_batch_ = true;
-        notify_of_schedulable_batch = true;
-      }
+    const uint64_t key = deadline_micros != 0 ? deadline_micros : std::numeric_limits<uint64_t>::max();
+    tasks_[std::make_pair(key, num_arrivals_)] = std::make_pair(std::move(*task), now_micros);
+    arrival_micros_[num_arrivals_++] = now_micros;
+    tasks_size_ += size;
+
+    if (!schedulable_batch_ && IsBatchSchedulable(now_micros)) {
+      schedulable_batch_ = true;
+      notify_of_schedulable_batch = true;
     }
   }
   if (notify_of_schedulable_batch) {
@@ -373,22 +427,14 @@ Status Queue<TaskType>::Schedule(std::unique_ptr<TaskType>* task) {
 template <typename TaskType>
 size_t Queue<TaskType>::NumEnqueuedTasks() const {
   mutex_lock l(mu_);
-  size_t num_enqueued_tasks = 0;
-  for (const auto& batch : batches_) {
-    num_enqueued_tasks += batch->num_tasks();
-  }
-  return num_enqueued_tasks;
+  return tasks_.size();
 }
 
 template <typename TaskType>
 size_t Queue<TaskType>::SchedulingCapacity() const {
   mutex_lock l(mu_);
-  const int num_new_batches_schedulable =
-      options_.max_enqueued_batches - batches_.size();
-  const int open_batch_capacity =
-      options_.max_batch_size - batches_.back()->size();
-  return (num_new_batches_schedulable * options_.max_batch_size) +
-      open_batch_capacity;
+  const int64_t capacity = options_.max_enqueued_batches * policy_.max_batch_size();
+  return std::max<int64_t>(0, capacity - static_cast<int64_t>(tasks_size_));
 }
 
 template <typename TaskType>
@@ -399,26 +445,57 @@ std::unique_ptr<Batch<TaskType>> Queue<TaskType>::ScheduleBatch() {
   {
     mutex_lock l(mu_);
 
-    /// Consider closeing the open batch at this time, to schedule it
-    if (batches_.size() == 1 && IsOpenBatchSchedulable()) {
-      StartNewBatch();
-    }
-    if (batches_.size() >= 2) {
-      ++num_batches_being_processed_;
-      batch_to_schedule = std::move(batches_.front());
-      batches_.pop_front();
-    } else {
+    const uint64_t now_micros = Env::NowMicros();
+    DropLateTasks(now_micros);
+    if (!IsBatchSchedulable(now_micros) && dropped_tasks_.empty()) {
       schedulable_batch_ = false;
+      return batch_to_schedule;
     }
+    /// Take the tasks by earliest deadline, the batch is empty if only late
+    /// tasks are to be dropped
+    batch_to_schedule.reset(new Batch<TaskType>);
+    uint64_t start_micros = now_micros;
+    while (IsBatchSchedulable(now_micros) || !batch_to_schedule->empty()) {
+      auto iter = tasks_.begin();
+      if (iter == tasks_.end() || (!batch_to_schedule->empty() &&
+          batch_to_schedule->size() + iter->second.first->size() > policy_.max_batch_size())) {
+        break;
+      }
+      start_micros = std::min(start_micros, iter->second.second);
+      batch_to_schedule->AddTask(TakeTask(iter));
+    }
+    batch_to_schedule->Close();
+    ++num_batches_being_processed_;
+    scheduled_batch_start_micros_[batch_to_schedule.get()] = start_micros;
   }
   return batch_to_schedule;
 }
 
 template <typename TaskType>
 void Queue<TaskType>::ProcessBatch(std::unique_ptr<Batch<TaskType>> batch) {
-  process_batch_callback_(std::move(batch));
+  std::vector<std::unique_ptr<TaskType>> dropped_tasks;
+  {
+    mutex_lock l(mu_);
+    dropped_tasks.swap(dropped_tasks_);
+  }
+  for (auto& task : dropped_tasks) {
+    options_.drop_task_callback(std::move(task));
+  }
+
+  const Batch<TaskType>* key = batch.get();
+  const size_t size = batch->size();
+  const uint64_t process_start_micros = Env::NowMicros();
+  if (!batch->empty()) {
+    process_batch_callback_(std::move(batch));
+  }
   {
     mutex_lock l(mu_);
+    const uint64_t now_micros = Env::NowMicros();
+    auto iter = scheduled_batch_start_micros_.find(key);
+    if (size > 0) {
+      policy_.Record(size, process_start_micros - iter->second, now_micros - process_start_micros);
+    }
+    scheduled_batch_start_micros_.erase(iter);
     --num_batches_being_processed_;
     if (empty_notification_ != nullptr && IsEmptyInternal()) {
       empty_notification_->Notify();
@@ -450,24 +527,44 @@ void Queue<TaskType>::CloseAndWaitUntilEmpty() {
 
 template <typename TaskType>
 bool Queue<TaskType>::IsEmptyInternal() const {
-  return num_batches_being_processed_ == 0 && batches_.size() == 1 &&
-      batches_.back()->empty();
+  return num_batches_being_processed_ == 0 && tasks_.empty() && dropped_tasks_.empty();
 }
 
 template <typename TaskType>
-void Queue<TaskType>::StartNewBatch() {
-  batches_.back()->Close();
-  batches_.emplace_back(new Batch<TaskType>);
+bool Queue<TaskType>::IsBatchSchedulable(uint64_t now_micros) const {
+  if (tasks_.empty()) {
+    return false;
+  }
+  if (closed_ || tasks_size_ >= policy_.max_batch_size() ||
+      now_micros >= arrival_micros_.begin()->second + policy_.batch_timeout_micros()) {
+    return true;
+  }
+  /// Waiting for the timeout would miss the earliest deadline
+  const uint64_t deadline_micros = tasks_.begin()->first.first;
+  return deadline_micros != std::numeric_limits<uint64_t>::max() &&
+      now_micros + policy_.batch_timeout_micros() + policy_.expected_service_micros() >= deadline_micros;
 }
 
 template <typename TaskType>
-bool Queue<TaskType>::IsOpenBatchSchedulable() {
-  Batch<TaskType>* open_batch = batches_.back().get();
-  if (open_batch->empty()) {
-    return false;
+void Queue<TaskType>::DropLateTasks(uint64_t now_micros) {
+  if (!options_.drop_task_callback) {
+    return;
+  }
+  /// The late tasks have the earliest deadlines
+  const uint64_t finish_micros = now_micros + policy_.expected_service_micros();
+  while (!tasks_.empty() && tasks_.begin()->first.first < finish_micros) {
+    dropped_tasks_.push_back(TakeTask(tasks_.begin()));
+    policy_.RecordDrop(1);
   }
-  return closed_ || open_batch->size() >= options_.max_batch_size ||
-      Env::NowMicros() >= open_batch_start_time_micros_ + options_.batch_timeout_micros;
+}
+
+template <typename TaskType>
+std::unique_ptr<TaskType> Queue<TaskType>::TakeTask(typename TaskMap::iterator iter) {
+  std::unique_ptr<TaskType> task = std::move(iter->second.first);
+  tasks_size_ -= task->size();
+  arrival_micros_.erase(iter->first.second);
+  tasks_.erase(iter);
+  return task;
 }
 
 /// Interface of SharedBatchScheduler like as BatchScheduler.
@@ -496,6 +593,11 @@ size_t QueueHandle<TaskType>::SchedulingCapacity() const {
   return queue_->SchedulingCapacity();
 }
 
+template <typename TaskType>
+BatchStats QueueHandle<TaskType>::stats() const {
+  return queue_->stats();
+}
+
 }  // namespace internal
 
 }  // namespace batching
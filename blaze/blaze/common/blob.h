@@ -28,6 +28,9 @@ class Blob {
 
   inline void Release() {
     Destroy();
+    // the memory of RefReshape is dropped as well
+    data_ = nullptr;
+    own_handle_ = true;
     size_ = capacity_ = 0;
     dims_.clear();
   }
@@ -41,13 +44,26 @@ class Blob {
     if (size_ > capacity_) {
       const int device_id = device_option_.device_id();
       const int device_type = device_option_.device_type();
-      blaze::Free(data_, capacity_ * DataTypeSize(data_type_), device_type, device_id);
+      // the memory of RefReshape is not freed, but replaced by an owned one
+      if (own_handle_) {
+        blaze::Free(data_, capacity_ * DataTypeSize(data_type_), device_type, device_id);
+      }
       capacity_ = size_;
       data_ = blaze::Alloc(capacity_ * DataTypeSize(data_type_), device_type, device_id);
+      own_handle_ = true;
     }
     dims_ = dims;
   }
 
+  // Allocate the memory of count elements, the shape is kept
+  inline void Reserve(TIndex count) {
+    TIndex size = size_;
+    std::vector<TIndex> dims = dims_;
+    Reshape({ count });
+    size_ = size;
+    dims_ = dims;
+  }
+
   inline void RefReshape(const std::vector<TIndex>& dims, void* handle) {
     Destroy();
 
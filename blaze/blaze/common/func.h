@@ -23,6 +23,10 @@ struct AsyncTask {
   Net* net;
   Net* parent_net;
   PredictorCallback cb; 
+  // The absolute deadline in micros of batching::Env::NowMicros, 0 if none
+  uint64_t deadline_micros = 0;
+  // The intra op threads budget of the run, 0 for the share of the thread
+  int intra_op_threads = 0;
 };
 
 } // namespace blaze
@@ -0,0 +1,56 @@
+/*
+ * \file intra_op.cc
+ * \brief The intra op threads of the openmp and mkl kernels
+ */
+#include "blaze/common/intra_op.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef USE_MKL
+#include <mkl.h>
+#endif
+
+namespace blaze {
+
+namespace {
+
+// 0 if the calling thread never set them
+thread_local int intra_op_threads = 0;
+
+}  // namespace
+
+int IntraOpThreads() {
+  if (intra_op_threads > 0) return intra_op_threads;
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+void SetIntraOpThreads(int num) {
+  if (num <= 0) return;
+  intra_op_threads = num;
+#ifdef _OPENMP
+  // nthreads-var is the icv of the calling thread
+  omp_set_num_threads(num);
+#endif
+#ifdef USE_MKL
+  mkl_set_num_threads_local(num);
+#endif
+}
+
+IntraOpThreadsGuard::IntraOpThreadsGuard(int num) : former_num_(0) {
+  if (num <= 0) return;
+  int former_num = IntraOpThreads();
+  if (num >= former_num) return;
+  former_num_ = former_num;
+  SetIntraOpThreads(num);
+}
+
+IntraOpThreadsGuard::~IntraOpThreadsGuard() {
+  if (former_num_ > 0) SetIntraOpThreads(former_num_);
+}
+
+}  // namespace blaze
@@ -0,0 +1,30 @@
+/*
+ * \file intra_op.h
+ * \brief The intra op threads of the openmp and mkl kernels
+ */
+#pragma once
+
+namespace blaze {
+
+// The threads the openmp and mkl kernels of the calling thread fork, which
+// are per thread, so that each scheduler thread runs its ops on its own
+// share of the cores rather than on all the cores of the host.
+int IntraOpThreads();
+// Set the intra op threads of the calling thread, a non positive num keeps
+// them.
+void SetIntraOpThreads(int num);
+
+// The intra op threads of the calling thread in the scope, at most the
+// former ones, which are restored on destruction. The budget of a request
+// only shrinks the share of its scheduler thread so that it can not
+// oversubscribe the cores. A non positive num keeps them.
+class IntraOpThreadsGuard {
+ public:
+  explicit IntraOpThreadsGuard(int num);
+  ~IntraOpThreadsGuard();
+
+ protected:
+  int former_num_;
+};
+
+}  // namespace blaze
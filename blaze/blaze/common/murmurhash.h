@@ -5,29 +5,36 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
 
 namespace blaze {
 
-static inline uint64_t MurmurHash64A(const char *key, uint64_t len, uint64_t seed = 0) {
-  const uint64_t m = 0xc6a4a7935bd1e995;
-  const int r = 47;
+namespace murmurhash_internal {
 
-  uint64_t h = seed ^ (len * m);
+const uint64_t kM = 0xc6a4a7935bd1e995;
+const int kR = 47;
 
-  const uint64_t* data = (const uint64_t *)key;
-  const uint64_t* end  = data + (len / 8);
+inline uint64_t MixBlock(uint64_t h, const char* data) {
+  uint64_t k;
+  memcpy(&k, data, sizeof(k));
 
-  while (data != end) {
-    uint64_t k = *data++;
+  k *= kM;
+  k ^= k >> kR;
+  k *= kM;
 
-    k *= m;
-    k ^= k >> r;
-    k *= m;
+  h ^= k;
+  h *= kM;
+  return h;
+}
 
-    h ^= k;
-    h *= m;
-  }
-  const unsigned char * data2 = (const unsigned char*)data;
+// Mixes the remaining len bytes of key into h and finalizes it
+inline uint64_t Finish(uint64_t h, const char* key, uint64_t len) {
+  const char* end = key + (len / 8) * 8;
+  for (; key != end; key += 8) h = MixBlock(h, key);
+
+  const unsigned char * data2 = (const unsigned char*)key;
 
   switch (len & 7) {
     case 7: h ^= (uint64_t)((uint64_t)data2[6] << (uint64_t)48);
@@ -37,14 +44,46 @@ static inline uint64_t MurmurHash64A(const char *key, uint64_t len, uint64_t see
     case 3: h ^= (uint64_t)((uint64_t)data2[2] << (uint64_t)16);
     case 2: h ^= (uint64_t)((uint64_t)data2[1] << (uint64_t)8 );
     case 1: h ^= (uint64_t)((uint64_t)data2[0]                );
-      h *= m;
+      h *= kM;
   }
 
-  h ^= h >> r;
-  h *= m;
-  h ^= h >> r;
+  h ^= h >> kR;
+  h *= kM;
+  h ^= h >> kR;
 
   return h;
 }
 
-}  // namespace blaze
\ No newline at end of file
+}  // namespace murmurhash_internal
+
+static inline uint64_t MurmurHash64A(const char *key, uint64_t len, uint64_t seed = 0) {
+  using namespace murmurhash_internal;
+  return Finish(seed ^ (len * kM), key, len);
+}
+
+// Hashes the n keys into out as MurmurHash64A does. The blocks the keys of a
+// group of four have in common are mixed in lock step, so that the multiplies
+// of the keys overlap rather than wait on each other.
+static inline void MurmurHash64ABatch(const char* const* keys, const uint64_t* lens, size_t n,
+                                      uint64_t* out, uint64_t seed = 0) {
+  using namespace murmurhash_internal;
+  const int kLanes = 4;
+  size_t i = 0;
+  for (; i + kLanes <= n; i += kLanes) {
+    uint64_t h[kLanes];
+    uint64_t blocks = lens[i] / 8;
+    for (int l = 0; l < kLanes; ++l) {
+      h[l] = seed ^ (lens[i + l] * kM);
+      blocks = std::min(blocks, lens[i + l] / 8);
+    }
+    for (uint64_t b = 0; b < blocks * 8; b += 8) {
+      for (int l = 0; l < kLanes; ++l) h[l] = MixBlock(h[l], keys[i + l] + b);
+    }
+    for (int l = 0; l < kLanes; ++l) {
+      out[i + l] = Finish(h[l], keys[i + l] + blocks * 8, lens[i + l] - blocks * 8);
+    }
+  }
+  for (; i < n; ++i) out[i] = MurmurHash64A(keys[i], lens[i], seed);
+}
+
+}  // namespace blaze
@@ -0,0 +1,131 @@
+/*
+ * \file numa.cc
+ * \brief The numa nodes of the host from sysfs
+ */
+#include "blaze/common/numa.h"
+
+#include <ctype.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef USE_CUDA
+#include <cuda_runtime.h>
+#endif
+
+#include "blaze/common/log.h"
+
+namespace blaze {
+
+namespace {
+
+// Parse the cpu list of sysfs, such as 0-3,8-11
+std::vector<int> ParseCpuList(const std::string& cpulist) {
+  std::vector<int> cpus;
+  std::stringstream ss(cpulist);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty() || !isdigit(range[0])) continue;
+    size_t pos = range.find('-');
+    int first = atoi(range.c_str());
+    int last = pos == std::string::npos ? first : atoi(range.c_str() + pos + 1);
+    for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+bool SetThreadCpus(const std::vector<int>& cpus) {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    if (cpu < CPU_SETSIZE) CPU_SET(cpu, &cpu_set);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+}
+
+}  // namespace
+
+int NumaNodeNum() {
+  static int node_num = [] {
+    int num = 0;
+    while (true) {
+      std::ifstream is("/sys/devices/system/node/node" + std::to_string(num) + "/cpulist");
+      if (!is.good()) break;
+      ++num;
+    }
+    return num > 0 ? num : 1;
+  }();
+  return node_num;
+}
+
+std::vector<int> NumaNodeCpus(int node) {
+  std::ifstream is("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+  std::string cpulist;
+  if (!is.good() || !std::getline(is, cpulist)) return std::vector<int>();
+  return ParseCpuList(cpulist);
+}
+
+std::vector<int> ProcessCpus() {
+  std::vector<int> cpus;
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0) return cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &cpu_set)) cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+int GpuNumaNode(int device_id) {
+#ifdef USE_CUDA
+  char bus_id[64];
+  if (cudaDeviceGetPCIBusId(bus_id, sizeof(bus_id), device_id) != cudaSuccess) return 0;
+  std::string path = "/sys/bus/pci/devices/";
+  for (const char* p = bus_id; *p; ++p) path.push_back(tolower(*p));
+  std::ifstream is(path + "/numa_node");
+  int node = 0;
+  if (is >> node && node >= 0 && node < NumaNodeNum()) return node;
+#endif
+  return 0;
+}
+
+bool BindThreadToNumaNode(int node) {
+  std::vector<int> cpus = NumaNodeCpus(node);
+  if (cpus.empty()) return false;
+  if (!SetThreadCpus(cpus)) {
+    LOG_ERROR("bind thread to numa node %d failed", node);
+    return false;
+  }
+  return true;
+}
+
+bool BindThreadToCpus(const std::vector<int>& cpus) {
+  if (cpus.empty()) return false;
+  if (!SetThreadCpus(cpus)) {
+    LOG_ERROR("bind thread to %u cpus from cpu %d failed", cpus.size(), cpus[0]);
+    return false;
+  }
+  return true;
+}
+
+NumaNodeGuard::NumaNodeGuard(int node) : bound_(false) {
+  if (node < 0 || NumaNodeNum() <= 1) return;
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (pthread_getaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) return;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &cpu_set)) former_cpus_.push_back(cpu);
+  }
+  bound_ = BindThreadToNumaNode(node);
+}
+
+NumaNodeGuard::~NumaNodeGuard() {
+  if (bound_) SetThreadCpus(former_cpus_);
+}
+
+}  // namespace blaze
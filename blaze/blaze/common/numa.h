@@ -0,0 +1,42 @@
+/*
+ * \file numa.h
+ * \brief The numa nodes of the host from sysfs
+ */
+#pragma once
+
+#include <vector>
+
+namespace blaze {
+
+// The number of numa nodes, 1 if the host is not numa
+int NumaNodeNum();
+
+// The cpus of the numa node, empty if unknown
+std::vector<int> NumaNodeCpus(int node);
+
+// The cpus the process may run on
+std::vector<int> ProcessCpus();
+
+// The numa node of the gpu, 0 if unknown
+int GpuNumaNode(int device_id);
+
+// Bind the calling thread to the cpus of the numa node, whose first touched
+// pages then come from the node. Return false if failed.
+bool BindThreadToNumaNode(int node);
+// Bind the calling thread to the cpus, such as the cores of a scheduler
+// thread and its intra op threads, which inherit them. Return false if failed.
+bool BindThreadToCpus(const std::vector<int>& cpus);
+
+// Keeps the calling thread on the cpus of the numa node in the scope, the
+// former affinity is restored on destruction. A negative node keeps it.
+class NumaNodeGuard {
+ public:
+  explicit NumaNodeGuard(int node);
+  ~NumaNodeGuard();
+
+ protected:
+  bool bound_;
+  std::vector<int> former_cpus_;
+};
+
+}  // namespace blaze
@@ -45,6 +45,8 @@ class ProtoConfigure {
   const std::string& conf_name() const { return conf_name_; }
   const std::string& type_name() const { return type_name_; }
   const google::protobuf::Message* config() const { return config_; }
+  // The config may be swapped out to avoid a copy
+  google::protobuf::Message* mutable_config() { return config_; }
 
  private:
   // disable copy and assign
@@ -4,7 +4,10 @@
  */
 #include "blaze/common/proto_helper.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <utility>
 #include <vector>
 
@@ -24,21 +27,27 @@ namespace blaze {
 
 // Load netdef from binary file
 bool NetDefHelper::LoadNetDefFromBinaryFile(const char* filename, NetDef* net_def) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    LOG_ERROR("open model file: %s failed", filename);
+    return false;
+  }
   struct stat st;
-  if (stat(filename, &st)) {
+  if (fstat(fd, &st)) {
     LOG_ERROR("model file: %s not exist", filename);
+    close(fd);
     return false;
   }
-  std::string content;
-  content.resize(st.st_size);
-  FILE* fp = fopen(filename, "r");
-  if (fp == nullptr) {
-    LOG_ERROR("open model file: %s failed", filename);
+  // parsed from the page cache, the weights are not read into a buffer first
+  void* content = st.st_size > 0 ? mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+  close(fd);
+  if (content == MAP_FAILED) {
+    LOG_ERROR("mmap model file: %s failed", filename);
     return false;
   }
-  fread(const_cast<char*>(content.c_str()), 1, content.length(), fp);
-  fclose(fp);
-  bool success = net_def->ParseFromArray(content.c_str(), content.length());
+  if (content != nullptr) madvise(content, st.st_size, MADV_SEQUENTIAL);
+  bool success = net_def->ParseFromArray(content, st.st_size);
+  if (content != nullptr) munmap(content, st.st_size);
   if (!success) {
     LOG_ERROR("parse NetDef from %s failed", filename);
     return false;
@@ -85,6 +94,69 @@ bool NetDefHelper::SaveNetDefToTextFile(const char* filename, NetDef* net_def) {
   return true;
 }
 
+bool NetDefHelper::IsCommonInput(const ValueInfo& value_info) {
+  return value_info.level() == 1 && value_info.input_type() != kInputIndicator;
+}
+
+std::vector<bool> NetDefHelper::CommonOps(const NetDef& net_def,
+                                          std::unordered_set<std::string>* common) {
+  for (const auto& input : net_def.external_input()) {
+    if (IsCommonInput(input)) common->insert(input.name());
+  }
+  std::unordered_set<std::string> constant;
+  std::vector<bool> common_ops(net_def.op_size(), false);
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    const OperatorDef& op = net_def.op(i);
+    if (op.type() == "ConstantFill") {
+      for (const auto& name : op.output()) constant.insert(name);
+      continue;
+    }
+    bool has_common = false, all_common = true;
+    for (const auto& name : op.input()) {
+      if (common->count(name)) {
+        has_common = true;
+      } else if (constant.count(name) == 0) {
+        all_common = false;
+        break;
+      }
+    }
+    if (!has_common || !all_common) {
+      for (const auto& name : op.output()) common->erase(name);
+      continue;
+    }
+    common_ops[i] = true;
+    for (const auto& name : op.output()) common->insert(name);
+  }
+  return common_ops;
+}
+
+std::unordered_set<std::string> NetDefHelper::ExternalOutputs(const NetDef& net_def) {
+  std::unordered_set<std::string> external_output;
+  for (const auto& output : net_def.external_output()) {
+    external_output.insert(output.name());
+  }
+  return external_output;
+}
+
+std::unordered_map<std::string, int> NetDefHelper::SingleConsumers(const NetDef& net_def) {
+  std::unordered_map<std::string, int> consumer;
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    for (const auto& name : net_def.op(i).input()) {
+      const auto& iter = consumer.find(name);
+      consumer[name] = iter == consumer.end() ? i : -1;
+    }
+  }
+  return consumer;
+}
+
+std::unordered_map<std::string, int> NetDefHelper::ReadCounts(const NetDef& net_def) {
+  std::unordered_map<std::string, int> reads;
+  for (const auto& op : net_def.op()) {
+    for (const auto& name : op.input()) ++reads[name];
+  }
+  return reads;
+}
+
 // ArgumentHelper implementation
 ArgumentHelper::ArgumentHelper(const OperatorDef& def) {
   for (auto& arg : def.arg()) {
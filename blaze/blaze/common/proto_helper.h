@@ -4,6 +4,9 @@
  */
 #pragma once
 
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "blaze/common/common_defines.h"
@@ -23,6 +26,20 @@ class NetDefHelper {
   static bool SaveNetDefToBinaryFile(const char* filename, NetDef* net_def);
   // save netdef as text format file
   static bool SaveNetDefToTextFile(const char* filename, NetDef* net_def);
+  // True for the common (level 1) inputs, such as the user features which
+  // are the same for the items of a request
+  static bool IsCommonInput(const ValueInfo& value_info);
+  // Mark the ops of net_def computed from the common blobs and the constants
+  // only. The common inputs of net_def are added to common, followed by the
+  // outputs of the marked ops.
+  static std::vector<bool> CommonOps(const NetDef& net_def,
+                                     std::unordered_set<std::string>* common);
+  // The names of the external outputs of net_def
+  static std::unordered_set<std::string> ExternalOutputs(const NetDef& net_def);
+  // The op reading each blob of net_def, -1 for the blobs read more than once
+  static std::unordered_map<std::string, int> SingleConsumers(const NetDef& net_def);
+  // The number of reads of each blob of net_def
+  static std::unordered_map<std::string, int> ReadCounts(const NetDef& net_def);
 };
 
 class ArgumentHelper {
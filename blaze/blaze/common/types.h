@@ -284,6 +284,12 @@ inline DataType DataType2PassDataType(int data_type) {
         {__VA_ARGS__}                                  \
       }                                                \
       break;                                           \
+     case kInt8:                                       \
+      {                                                \
+        typedef int8_t DType;                          \
+        {__VA_ARGS__}                                  \
+      }                                                \
+      break;                                           \
      default:                                          \
       {                                                \
         BLAZE_THROW("Unsupported type", type);         \
@@ -0,0 +1,231 @@
+/*
+ * \file aot_codegen.cc
+ * \brief The generator of the nets compiled ahead of time.
+ */
+#include "blaze/graph/aot_codegen.h"
+
+#include <ctype.h>
+
+#include <algorithm>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "blaze/common/proto_helper.h"
+#include "blaze/graph/aot_net.h"
+
+namespace blaze {
+
+namespace {
+
+struct AotOp {
+  const char* type;
+  const char* header;
+};
+
+// The cpu operator classes of the op types, by their headers
+const std::unordered_map<std::string, AotOp> kAotOps = {
+  { "BatchNormalization", { "BatchNormalizationOp", "op/batch_normalization_op.h" } },
+  { "Cast", { "CastOp", "op/cast_op.h" } },
+  { "Concat", { "ConcatOp", "op/concat_op.h" } },
+  { "ConstantFill", { "ConstantFillOp", "op/constant_fill_op.h" } },
+  { "Dice", { "DiceOp", "op/dice_op.h" } },
+  { "Add", { "ElementwiseAddOp", "op/elementwise_op.h" } },
+  { "Sub", { "ElementwiseSubOp", "op/elementwise_op.h" } },
+  { "Mul", { "ElementwiseMulOp", "op/elementwise_op.h" } },
+  { "Div", { "ElementwiseDivOp", "op/elementwise_op.h" } },
+  { "Equal", { "ElementwiseEqualOp", "op/elementwise_op.h" } },
+  { "NotEqual", { "ElementwiseNotEqualOp", "op/elementwise_op.h" } },
+  { "Max", { "ElementwiseMaxOp", "op/elementwise_op.h" } },
+  { "Min", { "ElementwiseMinOp", "op/elementwise_op.h" } },
+  { "BroadcastTo", { "BroadcastToOp", "op/elementwise_op.h" } },
+  { "Where", { "WhereOp", "op/elementwise_op.h" } },
+  { "Flatten", { "FlattenOp", "op/flatten_op.h" } },
+  { "Fuse", { "FuseOp", "op/fuse_op.h" } },
+  { "Gather", { "GatherOp", "op/gather_op.h" } },
+  { "Gemm", { "GemmOp", "op/gemm_op.h" } },
+  { "GRU", { "GRUOp", "op/gru_op.h" } },
+  { "AUGRU", { "GRUOp", "op/gru_op.h" } },
+  { "LeakyRelu", { "LeakyReluOp", "op/leaky_relu_op.h" } },
+  { "MatMul", { "MatMulOp", "op/matmul_op.h" } },
+  { "MultiSlice", { "MultiSliceOp", "op/multi_slice_op.h" } },
+  { "Not", { "NotOp", "op/not_op.h" } },
+  { "PRelu", { "PReluOp", "op/prelu_op.h" } },
+  { "PrunedGemm", { "PrunedGemmOp", "op/pruned_gemm_op.h" } },
+  { "QuantizedGemm", { "QuantizedGemmOp", "op/quantized_gemm_op.h" } },
+  { "ReduceSum", { "ReduceSumOp", "op/reduce_sum_op.h" } },
+  { "Reshape", { "ReshapeOp", "op/reshape_op.h" } },
+  { "Sigmoid", { "SigmoidOp", "op/sigmoid_op.h" } },
+  { "Slice", { "SliceOp", "op/slice_op.h" } },
+  { "Softmax", { "SoftmaxOp", "op/softmax_op.h" } },
+  { "SparseGemm", { "SparseGemmOp", "op/sparse_gemm_op.h" } },
+  { "Split", { "SplitOp", "op/split_op.h" } },
+  { "Tanh", { "TanhOp", "op/tanh_op.h" } },
+  { "FusedElementwise", { "FusedElementwiseOp", "fused_op/fused_elementwise_op.h" } },
+  { "FusedGemmEpilogue", { "FusedGemmEpilogueOp", "fused_op/fused_gemm_epilogue_op.h" } },
+  { "FusedParallelGemm", { "FusedParallelGemmOp", "fused_op/fused_parallel_gemm_op.h" } },
+  { "FusedParallelMatMul", { "FusedParallelMatMulOp", "fused_op/fused_parallel_matmul_op.h" } },
+  { "FusedParallelMul", { "FusedParallelMulOp", "fused_op/fused_parallel_mul_op.h" } },
+  { "FusedParallelMulReduceSum",
+    { "FusedParallelMulReduceSumOp", "fused_op/fused_parallel_mul_reducesum_op.h" } },
+  { "FusedParallelSlice", { "FusedParallelSliceOp", "fused_op/fused_parallel_slice_op.h" } },
+  { "FusedSliceConcat", { "FusedSliceConcatOp", "fused_op/fused_slice_concat_op.h" } },
+  { "FusedTargetAttention", { "FusedTargetAttentionOp", "fused_op/fused_target_attention_op.h" } },
+};
+
+std::string Quote(const std::string& str) {
+  std::string ret = "\"";
+  for (char c : str) {
+    if (c == '"' || c == '\\') ret += '\\';
+    ret += c;
+  }
+  return ret + "\"";
+}
+
+std::string Dims(const std::vector<TIndex>& shape) {
+  std::stringstream ss;
+  ss << "{ ";
+  for (size_t k = 0; k < shape.size(); ++k) ss << (k ? ", " : "") << shape[k];
+  // the zero length arrays are not standard
+  if (shape.empty()) ss << "0";
+  ss << " }";
+  return ss.str();
+}
+
+TIndex Size(const std::vector<TIndex>& shape) {
+  TIndex size = 1;
+  for (auto dim : shape) size *= dim;
+  return size;
+}
+
+}  // namespace
+
+AotCodegen::AotCodegen(const NetDef& net_def) : net_def_(net_def) { }
+
+void AotCodegen::AddBucket(Net* net) {
+  std::map<std::string, BlobInfo> bucket;
+  for (const auto& item : net->net_blob_map()) {
+    Blob* blob = item.second;
+    bucket[item.first] = BlobInfo{ static_cast<DataType>(blob->data_type()), blob->shape() };
+  }
+  buckets_.push_back(bucket);
+}
+
+std::string AotCodegen::Generate(const std::string& name) const {
+  BLAZE_CONDITION_THROW(!buckets_.empty(), "aot net ", name, " has no bucket");
+  BLAZE_CONDITION_THROW(!name.empty() && !isdigit(name[0]), "aot net name ", name);
+  for (char c : name) {
+    BLAZE_CONDITION_THROW(isalnum(c) || c == '_', "aot net name ", name);
+  }
+  for (const auto& op : net_def_.op()) {
+    const DeviceOption& device_option =
+        op.has_device_option() ? op.device_option() : net_def_.device_option();
+    BLAZE_CONDITION_THROW(device_option.device_type() == kCPU,
+                          "aot net ", name, " op ", op.name(), " is not on cpu");
+  }
+
+  std::string class_name = "AotNet_" + name;
+  std::unordered_set<std::string> common;
+  std::vector<bool> common_op = NetDefHelper::CommonOps(net_def_, &common);
+  std::set<std::string> headers = { "blaze/graph/aot_net.h" };
+  for (const auto& op : net_def_.op()) {
+    auto iter = kAotOps.find(op.type());
+    if (iter != kAotOps.end()) headers.insert(std::string("blaze/operator/") + iter->second.header);
+  }
+
+  std::stringstream ss;
+  ss << "/*\n"
+     << " * \\file " << name << "_aot_net.cc\n"
+     << " * \\brief Generated by AotCodegen"
+     << (net_def_.name().empty() ? "" : " from net " + net_def_.name()) << ", do not edit.\n"
+     << " */\n";
+  for (const auto& header : headers) ss << "#include \"" << header << "\"\n";
+  ss << "\nnamespace blaze {\n\nnamespace {\n\n";
+
+  // The shapes of the external inputs of each bucket
+  std::vector<std::string> inputs;
+  for (const auto& input : net_def_.external_input()) inputs.push_back(input.name());
+  for (size_t b = 0; b < buckets_.size(); ++b) {
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      auto iter = buckets_[b].find(inputs[i]);
+      BLAZE_CONDITION_THROW(iter != buckets_[b].end(), "aot net ", name, " bucket ", b,
+                            " has no input ", inputs[i]);
+      ss << "const TIndex kBucket" << b << "Input" << i << "[] = "
+         << Dims(iter->second.shape) << ";\n";
+    }
+  }
+
+  ss << "\nclass " << class_name << " final : public AotNet {\n"
+     << " public:\n"
+     << "  " << class_name << "(const std::shared_ptr<const NetDef>& net_def, Workspace* ws) :\n"
+     << "      AotNet(net_def, ws, " << AotNet::Signature(net_def_) << "ull) {\n";
+  for (int i = 0; i < net_def_.op_size(); ++i) {
+    auto iter = kAotOps.find(net_def_.op(i).type());
+    if (iter == kAotOps.end()) continue;
+    ss << "    op" << i << "_ = TypedOperator<" << iter->second.type << "<CPUContext>>(" << i << ");\n";
+  }
+  // The buffers of the largest bucket
+  std::map<std::string, BlobInfo> largest;
+  for (const auto& bucket : buckets_) {
+    for (const auto& item : bucket) {
+      auto iter = largest.find(item.first);
+      if (iter == largest.end() ||
+          Size(item.second.shape) * DataTypeSize(item.second.data_type) >
+          Size(iter->second.shape) * DataTypeSize(iter->second.data_type)) {
+        largest[item.first] = item.second;
+      }
+    }
+  }
+  for (const auto& item : largest) {
+    ss << "    Reserve(" << Quote(item.first) << ", static_cast<DataType>("
+       << item.second.data_type << "), " << Size(item.second.shape) << ");\n";
+  }
+  ss << "  }\n\n"
+     << " protected:\n"
+     << "  int Bucket() override {\n";
+  for (size_t b = 0; b < buckets_.size(); ++b) {
+    ss << "    if (";
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      ss << (i ? " &&\n        " : "") << "InputShapeIs(" << i << ", kBucket" << b << "Input" << i
+         << ", " << buckets_[b].at(inputs[i]).shape.size() << ")";
+    }
+    if (inputs.empty()) ss << "true";
+    ss << ") {\n      return " << b << ";\n    }\n";
+  }
+  ss << "    return -1;\n"
+     << "  }\n\n"
+     << "  bool RunCompiled(bool skip_common) override {\n";
+  for (int i = 0; i < net_def_.op_size(); ++i) {
+    const OperatorDef& op = net_def_.op(i);
+    auto iter = kAotOps.find(op.type());
+    std::string call = iter == kAotOps.end()
+        ? "operators_[" + std::to_string(i) + "]->Run()"
+        : "op" + std::to_string(i) + "_->" + iter->second.type + "<CPUContext>::RunOnDevice()";
+    ss << "    // " << op.type() << " " << op.name() << "\n";
+    if (common_op[i]) {
+      ss << "    if ((!skip_common || !common_op_[" << i << "]) && !" << call << ") return false;\n";
+    } else {
+      ss << "    if (!" << call << ") return false;\n";
+    }
+  }
+  ss << "    return true;\n"
+     << "  }\n\n"
+     << " private:\n";
+  for (int i = 0; i < net_def_.op_size(); ++i) {
+    auto iter = kAotOps.find(net_def_.op(i).type());
+    if (iter == kAotOps.end()) continue;
+    ss << "  " << iter->second.type << "<CPUContext>* op" << i << "_;\n";
+  }
+  ss << "};\n\n"
+     << "}  // namespace\n\n"
+     << "REGISTER_NET(aot_" << name << ", " << class_name << ");\n\n"
+     << "}  // namespace blaze\n\n"
+     << "// The run mode of the net, for PredictorManager::LoadAotNet\n"
+     << "extern \"C\" const char* BlazeAotNetName() {\n"
+     << "  return \"aot_" << name << "\";\n"
+     << "}\n";
+  return ss.str();
+}
+
+}  // namespace blaze
@@ -0,0 +1,43 @@
+/*
+ * \file aot_codegen.h
+ * \brief The generator of the nets compiled ahead of time.
+ */
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "blaze/graph/net.h"
+
+namespace blaze {
+
+// Generates the c++ unit of an AotNet for a cpu net with a few fixed batch
+// buckets. The shapes of a bucket are profiled from a run of the net, such
+// as a simple net created by a predictor and fed with the batch size of
+// the bucket. The unit is built into a shared library linking blaze, which
+// registers the net as the run mode aot_<name>, see
+// PredictorManager::LoadAotNet. The operators without a generated type,
+// such as the sparse ones, run through their virtual Run.
+class AotCodegen {
+ public:
+  explicit AotCodegen(const NetDef& net_def);
+
+  // Add the bucket of the shapes of the blobs of net after a run, net is
+  // created from the net_def of the codegen.
+  void AddBucket(Net* net);
+  // The unit of the net, throws if the net is not on cpu or there is no
+  // bucket. name is a c++ identifier.
+  std::string Generate(const std::string& name) const;
+
+ protected:
+  struct BlobInfo {
+    DataType data_type;
+    std::vector<TIndex> shape;
+  };
+
+  NetDef net_def_;
+  std::vector<std::map<std::string, BlobInfo>> buckets_;
+};
+
+}  // namespace blaze
@@ -0,0 +1,76 @@
+/*
+ * \file aot_net.cc
+ * \brief The base of the nets compiled ahead of time by AotCodegen.
+ */
+#include "blaze/graph/aot_net.h"
+
+#include <sstream>
+
+#include "blaze/common/murmurhash.h"
+
+namespace blaze {
+
+AotNet::AotNet(const std::shared_ptr<const NetDef>& net_def, Workspace* ws, uint64_t signature) :
+    SimpleNet(net_def, ws) {
+  BLAZE_CONDITION_THROW(Signature(*net_def) == signature,
+                        "aot net ", name_, " is generated from another net");
+  for (const auto& name : external_input_) {
+    input_blobs_.push_back(external_input_blob(name));
+  }
+}
+
+uint64_t AotNet::Signature(const NetDef& net_def) {
+  std::stringstream ss;
+  for (const auto& op : net_def.op()) {
+    ss << op.type() << "(";
+    for (const auto& name : op.input()) ss << name << ",";
+    ss << ")";
+    for (const auto& name : op.output()) ss << name << ",";
+    ss << ";";
+  }
+  std::string str = ss.str();
+  return MurmurHash64A(str.data(), str.size());
+}
+
+bool AotNet::RunImpl() {
+  if (Bucket() < 0) return RunOperators();
+
+  bool skip_common = common_reused_ && common_valid_;
+  common_valid_ = false;
+  if (!RunCompiled(skip_common)) {
+    LOG_ERROR("aot net %s failed", name_.c_str());
+    return false;
+  }
+  common_valid_ = true;
+  // The net waits the event of the last operator, which RunOnDevice doesn't
+  // finish, unless the operator ran through its Run.
+  if (!operators_.empty() && !operators_.back()->IsEventDisabled()) {
+    Event& event = operators_.back()->event();
+    EventStatus status = event.Query();
+    if (status != EventStatus::kEventSuccess && status != EventStatus::kEventFailed) {
+      event.SetFinished();
+    }
+  }
+  return true;
+}
+
+void AotNet::Reserve(const char* name, DataType data_type, TIndex count) {
+  Blob* blob = net_blob(name);
+  if (blob == nullptr || blob->capacity() >= count) return;
+  // the data type of the profiled runs, which the operators set again
+  blob->set_data_type(data_type);
+  blob->Reserve(count);
+}
+
+bool AotNet::InputShapeIs(int idx, const TIndex* dims, size_t rank) const {
+  const Blob* blob = input_blobs_[idx];
+  if (blob == nullptr) return false;
+  const std::vector<TIndex>& shape = blob->shape();
+  if (shape.size() != rank) return false;
+  for (size_t k = 0; k < rank; ++k) {
+    if (shape[k] != dims[k]) return false;
+  }
+  return true;
+}
+
+}  // namespace blaze
@@ -0,0 +1,53 @@
+/*
+ * \file aot_net.h
+ * \brief The base of the nets compiled ahead of time by AotCodegen.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "blaze/graph/simple_net.h"
+
+namespace blaze {
+
+// The net generated by AotCodegen for a cpu net and the batch buckets it
+// was profiled with. The operators are created as SimpleNet does, the
+// generated unit keeps them by their concrete types and calls their
+// RunOnDevice directly in order, with the buffers of the blobs allocated
+// for the largest bucket at construction. The runs whose input shapes are
+// not of a bucket fall back to SimpleNet. The observers of the operators
+// are not invoked on the compiled runs.
+class AotNet : public SimpleNet {
+ public:
+  // signature is of the net the unit was generated from, a different net
+  // throws.
+  AotNet(const std::shared_ptr<const NetDef>& net_def, Workspace* ws, uint64_t signature);
+
+  // The hash of the operators and the blob names of net_def
+  static uint64_t Signature(const NetDef& net_def);
+
+ protected:
+  bool RunImpl() override;
+
+  // The bucket of the shapes of the external inputs, -1 if none
+  virtual int Bucket() = 0;
+  // Run the operators, skip_common skips the common ops
+  virtual bool RunCompiled(bool skip_common) = 0;
+
+  // The operator idx as its concrete type Op
+  template <typename Op>
+  Op* TypedOperator(int idx) {
+    Op* op = dynamic_cast<Op*>(operators_[idx].get());
+    BLAZE_CONDITION_THROW(op != nullptr, "aot net ", name_, " op ", idx, " is not of the generated type");
+    return op;
+  }
+  // Allocate count elements of data_type for the blob of name
+  void Reserve(const char* name, DataType data_type, TIndex count);
+  // Whether the shape of the external input idx is dims
+  bool InputShapeIs(int idx, const TIndex* dims, size_t rank) const;
+
+  std::vector<Blob*> input_blobs_;
+};
+
+}  // namespace blaze
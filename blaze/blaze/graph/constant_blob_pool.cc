@@ -0,0 +1,61 @@
+/*
+ * \file constant_blob_pool.cc
+ * \desc The constant blobs shared by the workspaces of the loaded models
+ */
+#include "blaze/graph/constant_blob_pool.h"
+
+#include <sstream>
+
+#include "blaze/common/murmurhash.h"
+
+namespace blaze {
+
+namespace {
+
+// The second seed of the 128 bits hash
+const uint64_t kConstantBlobSeed = 0x9e3779b97f4a7c15;
+
+}  // namespace
+
+ConstantBlobPool* ConstantBlobPool::Get() {
+  static std::shared_ptr<ConstantBlobPool> inst(new ConstantBlobPool());
+  return inst.get();
+}
+
+std::shared_ptr<Blob> ConstantBlobPool::Acquire(const DeviceOption& device_option,
+                                                DataType data_type,
+                                                const std::vector<TIndex>& shape,
+                                                const void* data, size_t size,
+                                                const std::function<void(Blob*)>& fill) {
+  const char* bytes = reinterpret_cast<const char*>(data);
+  std::stringstream ss;
+  ss << device_option.device_type() << ":" << device_option.device_id() << ":" << data_type;
+  for (auto dim : shape) ss << "," << dim;
+  ss << ":" << size << ":" << MurmurHash64A(bytes, size)
+     << ":" << MurmurHash64A(bytes, size, kConstantBlobSeed);
+  std::string key = ss.str();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::weak_ptr<Blob>& entry = blobs_[key];
+  std::shared_ptr<Blob> blob = entry.lock();
+  if (blob != nullptr) return blob;
+
+  // the expired entry of an unloaded model is replaced
+  blob = std::make_shared<Blob>(device_option);
+  blob->set_data_type(data_type);
+  blob->Reshape(shape);
+  fill(blob.get());
+  entry = blob;
+  return blob;
+}
+
+size_t ConstantBlobPool::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t alive = 0;
+  for (const auto& item : blobs_) {
+    if (!item.second.expired()) ++alive;
+  }
+  return alive;
+}
+
+}  // namespace blaze
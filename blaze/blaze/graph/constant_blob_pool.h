@@ -0,0 +1,41 @@
+/*
+ * \file constant_blob_pool.h
+ * \desc The constant blobs shared by the workspaces of the loaded models
+ */
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "blaze/common/blob.h"
+
+namespace blaze {
+
+// The identical constant blobs of the workspaces, such as the weights of the
+// model versions loaded side by side, are stored once. A blob is keyed by its
+// device, type, shape and the 128 bits murmur hash of its data, and is freed
+// when the last workspace holding it is cleared. The shared blobs are read
+// only.
+class ConstantBlobPool {
+ public:
+  static ConstantBlobPool* Get();
+
+  // The blob of the data, fill fills a new one reshaped to shape
+  std::shared_ptr<Blob> Acquire(const DeviceOption& device_option, DataType data_type,
+                                const std::vector<TIndex>& shape, const void* data,
+                                size_t size, const std::function<void(Blob*)>& fill);
+  // The number of the shared blobs alive
+  size_t size();
+
+ protected:
+  ConstantBlobPool() { }
+
+  std::unordered_map<std::string, std::weak_ptr<Blob>> blobs_;
+  std::mutex mutex_;
+};
+
+}  // namespace blaze
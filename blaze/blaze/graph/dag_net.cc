@@ -6,10 +6,31 @@
 
 #include "blaze/graph/dag_net.h"
 
+#include <unordered_set>
+
+#include "blaze/common/intra_op.h"
+#include "blaze/common/semaphore.h"
+#include "blaze/common/thread_pool.h"
 #include "blaze/graph/graph.h"
 
 namespace blaze {
 
+namespace {
+
+// The operators of the sparse lookups, which run asynchronously
+const std::unordered_set<std::string> kAsyncOpTypes = { "Embedding" };
+
+const size_t kSparsePullThreads = 8;
+
+// The threads of the sparse lookups of all the dag nets, never destroyed as
+// its threads are not shut down
+ThreadExecutor* SparsePullExecutor() {
+  static ThreadExecutor* executor = new ThreadExecutor(kSparsePullThreads);
+  return executor;
+}
+
+}  // namespace
+
 DagNet::DagNet(const std::shared_ptr<const NetDef>& net_def, Workspace* ws) :
     Net(net_def, ws) {
   bool net_has_device_option = net_def->has_device_option();
@@ -28,78 +49,183 @@ DagNet::DagNet(const std::shared_ptr<const NetDef>& net_def, Workspace* ws) :
     set_output_blob(operator_def, op);
     operators_.emplace_back(std::move(op));
   }
+  AssignStreams();
+
+  async_op_.resize(operators_.size(), false);
+  for (int idx = 0; idx < operators_.size(); ++idx) {
+    OperatorBase* op = operators_[idx].get();
+    if (kAsyncOpTypes.count(op->type()) && op->device_option().device_type() == kCPU) {
+      async_op_[idx] = true;
+      has_async_op_ = true;
+    }
+  }
+
+  // Put the output node's event to the net's wait events, which end all
+  // the branches.
+  for (auto idx : this->graph_->not_be_dependent_idx()) {
+    const Event* event = &(operators_[idx]->event());
+    this->events_.push_back(event);
+  }
+}
+
+void DagNet::WaitParents(int idx) {
+  OperatorBase* op = operators_[idx].get();
+  const Node& node = this->graph_->node(idx);
+  for (const auto& item : node.parents) {
+    int parent_idx = item.first;
+    if (stream_id_[parent_idx] != stream_id_[idx] ||
+        operators_[parent_idx]->device_option().device_type() !=
+        op->device_option().device_type()) {
+      op->Wait(*operators_[parent_idx], stream_id_[idx]);
+    }
+  }
 }
 
 bool DagNet::RunImpl() {
-  const std::vector<int> starts = graph_->not_dependency_idx();
-  std::list<int> ready_list;
-  std::vector<bool> visited(graph_->size(), false);
-  std::vector<int> stream_id(graph_->size(), 0);
-
-  // Concurrently schedule the tasks
-  int prob_stream_id = -1;
-  for (auto idx : starts) {
+  // The operators are launched in topological order without waiting on the
+  // host, the dependencies across streams are event waits on the device.
+  for (int idx = 0; idx < operators_.size(); ++idx) {
     OperatorBase* op = operators_[idx].get();
-    stream_id[idx] = AvailableStreamId(op, &prob_stream_id);
-    op->Run(stream_id[idx]);
-    // Make The op's successor into ready task queue.
-    const Node& node = this->graph_->node(idx);
-    for (const auto& item : node.children) {
-      if (!visited[item.first]) {
-        visited[item.first] = true;
-        ready_list.push_back(item.first);
-      }
+    WaitParents(idx);
+    LOG_DEBUG("run:%s %s stream_id=%d", op->operator_def().type().c_str(),
+              op->operator_def().name().c_str(), stream_id_[idx]);
+    bool res = op->Run(stream_id_[idx]);
+    if (!res) {
+      LOG_ERROR("Operator failed, name=%s type=%s", op->name().c_str(), op->type().c_str());
+      return false;
     }
   }
-  
-  // Check the ready queue.
-  while (!ready_list.empty()) {
-    for (auto it = ready_list.begin(); it != ready_list.end(); ) {
-      // Check the dependency
-      int idx = *it;
-      const Node& node = this->graph_->node(idx);
-      OperatorBase* op = operators_[idx].get();
-      int remaining = 0, last_stream_id = 0;
-      for (const auto& item : node.parents) {
-        int parent_idx = item.first;
-        OperatorBase* parent_op = operators_[parent_idx].get();
-        if (parent_op->event().Query() != EventStatus::kEventSuccess) {
-          remaining++;
-          last_stream_id = stream_id[parent_idx];
-        }
-      }
-      if (remaining > 0) {
-        ++it;
-      } else {
-        // Start to schedule it.
-        stream_id[idx] = AvailableStreamId(op, &prob_stream_id);
-        op->Run(stream_id[idx]);
-        for (const auto& item : node.children) {
-          if (!visited[item.first]) {
-            visited[item.first] = true;
-            ready_list.push_back(item.first);
-          }
+  return true;
+}
+
+bool DagNet::Run() {
+  if (!has_async_op_) return Net::Run();
+  Semaphore semaphore;
+  if (!Run([&semaphore] { semaphore.notify(); })) {
+    return false;
+  }
+  semaphore.wait();
+  return !run_failed_;
+}
+
+bool DagNet::Run(const PredictorCallback&& cb) {
+  if (!has_async_op_) return Net::Run(std::move(cb));
+  for (auto& op : GetOperators()) {
+    op->ResetEvent();
+  }
+  StartAllObservers();
+
+  std::unique_lock<std::mutex> lock(run_mutex_);
+  run_cb_ = std::move(cb);
+  run_failed_ = false;
+  remaining_ = operators_.size();
+  pending_parents_.resize(operators_.size());
+  ready_.clear();
+  for (int idx = 0; idx < operators_.size(); ++idx) {
+    pending_parents_[idx] = this->graph_->node(idx).parents.size();
+    if (pending_parents_[idx] == 0) ready_.insert(idx);
+  }
+  LaunchReady();
+  bool finished = remaining_ == 0;
+  lock.unlock();
+  if (finished) FinishRun();
+  return true;
+}
+
+void DagNet::LaunchReady() {
+  while (!ready_.empty()) {
+    int idx = *ready_.begin();
+    ready_.erase(ready_.begin());
+    OperatorBase* op = operators_[idx].get();
+    if (run_failed_) {
+      // the operators after a failure are skipped
+      if (!op->IsEventDisabled()) op->event().SetFinished("skipped after a failed operator");
+      Complete(idx);
+      continue;
+    }
+    if (async_op_[idx]) {
+      int intra_op_threads = intra_op_threads_;
+      SparsePullExecutor()->commit([this, idx, intra_op_threads]() {
+        IntraOpThreadsGuard intra_op_guard(intra_op_threads);
+        bool res = false;
+        try {
+          WaitParents(idx);
+          res = operators_[idx]->Run(stream_id_[idx]);
+        } catch (std::exception& e) {
+          LOG_ERROR("Operator failed, name=%s msg=%s", operators_[idx]->name().c_str(), e.what());
+          if (!operators_[idx]->IsEventDisabled()) operators_[idx]->event().SetFinished(e.what());
         }
-        it = ready_list.erase(it);
-      }
+        OnAsyncDone(idx, res);
+      });
+      continue;
+    }
+    LOG_DEBUG("run:%s %s stream_id=%d", op->operator_def().type().c_str(),
+              op->operator_def().name().c_str(), stream_id_[idx]);
+    bool res = false;
+    try {
+      WaitParents(idx);
+      res = op->Run(stream_id_[idx]);
+    } catch (std::exception& e) {
+      LOG_ERROR("Operator failed, name=%s msg=%s", op->name().c_str(), e.what());
+      if (!op->IsEventDisabled()) op->event().SetFinished(e.what());
+    }
+    if (!res) {
+      LOG_ERROR("Operator failed, name=%s type=%s", op->name().c_str(), op->type().c_str());
+      run_failed_ = true;
     }
+    Complete(idx);
   }
+}
 
-  // Put the output node's event to the net's wait events.
-  const std::vector<int>& final_node = this->graph_->not_be_dependent_idx();
-  for (auto idx : final_node) {
-    const Event* event = &(operators_[idx]->event());
-    this->events_.push_back(event);
+void DagNet::Complete(int idx) {
+  --remaining_;
+  for (const auto& item : this->graph_->node(idx).children) {
+    if (--pending_parents_[item.first] == 0) ready_.insert(item.first);
   }
+}
 
-  return true;
+void DagNet::OnAsyncDone(int idx, bool success) {
+  std::unique_lock<std::mutex> lock(run_mutex_);
+  if (!success) {
+    LOG_ERROR("Operator failed, name=%s type=%s", operators_[idx]->name().c_str(),
+              operators_[idx]->type().c_str());
+    run_failed_ = true;
+  }
+  Complete(idx);
+  LaunchReady();
+  bool finished = remaining_ == 0;
+  lock.unlock();
+  if (finished) FinishRun();
 }
 
-int DagNet::AvailableStreamId(OperatorBase* op, int* stream_id) {
-  do {
-    *stream_id = (*stream_id + 1) % kMaxStreamNum;
-  } while (!op->StreamIsFree(*stream_id));
-  return *stream_id;
+void DagNet::FinishRun() {
+  Wait();  // Wait the net compuatation to be finished.
+  StopAllObservers();
+  HandleRunError();
+  PredictorCallback cb = std::move(run_cb_);
+  if (cb) cb();
+}
+
+void DagNet::AssignStreams() {
+  stream_id_.resize(operators_.size(), 0);
+  std::vector<bool> continued(operators_.size(), false);
+  int next_stream_id = 0;
+  for (int idx = 0; idx < operators_.size(); ++idx) {
+    const Node& node = this->graph_->node(idx);
+    int stream_id = -1;
+    for (const auto& item : node.parents) {
+      if (!continued[item.first]) {
+        continued[item.first] = true;
+        stream_id = stream_id_[item.first];
+        break;
+      }
+    }
+    if (stream_id < 0) {
+      stream_id = next_stream_id;
+      next_stream_id = (next_stream_id + 1) % kMaxStreamNum;
+    }
+    stream_id_[idx] = stream_id;
+  }
 }
 
 REGISTER_NET(dag, DagNet);
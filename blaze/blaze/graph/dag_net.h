@@ -10,6 +10,8 @@
 
 #include <queue>
 #include <list>
+#include <mutex>
+#include <set>
 
 namespace blaze {
 
@@ -26,11 +28,50 @@ class DagNet : public Net {
     return op_list;
   }
 
+  // The nets with sparse lookups run asynchronously, the lookups run on the
+  // sparse pull threads and the operators not depending on them are
+  // launched meanwhile. The callback is invoked once the net finishes, after
+  // a failed operator as well.
+  bool Run() override;
+  bool Run(const PredictorCallback&& cb) override;
+
  protected:
   bool RunImpl() override;
 
-  // Return the stream id.
-  int AvailableStreamId(OperatorBase* op, int* stream_id);
+  // Wait the parents of the operator idx on other streams or devices.
+  void WaitParents(int idx);
+  // Launch the ready operators, the async ones are put onto the sparse pull
+  // threads. Requires run_mutex_ to be held.
+  void LaunchReady();
+  // The operator has been launched or the async one has finished, its
+  // children become ready once all their parents are done.
+  void Complete(int idx);
+  // The async operator idx finished.
+  void OnAsyncDone(int idx, bool success);
+  // Wait the net and invoke the callback of the run.
+  void FinishRun();
+
+  // Assign the streams of the operators, a chain of operators stays on the
+  // stream of its head and the independent branches are spread over the
+  // streams of the device.
+  void AssignStreams();
+
+  // The stream id of each operator
+  std::vector<int> stream_id_;
+  // Whether the operator runs on the sparse pull threads
+  std::vector<bool> async_op_;
+  bool has_async_op_ = false;
+
+  // The state of the asynchronous run
+  std::mutex run_mutex_;
+  // The parents not done of each operator
+  std::vector<int> pending_parents_;
+  // The ready operators in topological order
+  std::set<int> ready_;
+  // The operators not done
+  size_t remaining_ = 0;
+  bool run_failed_ = false;
+  PredictorCallback run_cb_;
 
   DISABLE_COPY_AND_ASSIGN(DagNet);
 };
@@ -4,6 +4,12 @@
  */
 
 #include "blaze/graph/hybrid_net.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include "blaze/common/intra_op.h"
+#include "blaze/common/proto_helper.h"
 #include "blaze/graph/transform/cross_device_graph_manager.h"
 #include "blaze/graph/simple_net.h"
 
@@ -11,8 +17,69 @@ using std::vector;
 
 namespace blaze {
 
+namespace {
+
+struct PlacedNetDefs {
+  std::weak_ptr<const NetDef> net_def;
+  vector<std::shared_ptr<const NetDef>> placed;
+};
+
+// The net defs placed for the buckets, which the hybrid nets of a net def
+// share, so the placement runs once per workspace
+vector<std::shared_ptr<const NetDef>> GetPlacedNetDefs(
+    const std::shared_ptr<const NetDef>& net_def, const CostPlacement& placement) {
+  static std::mutex mutex;
+  static std::unordered_map<const NetDef*, PlacedNetDefs> cache;
+  std::lock_guard<std::mutex> lock(mutex);
+  PlacedNetDefs& item = cache[net_def.get()];
+  if (item.net_def.lock() != net_def) {
+    item.net_def = net_def;
+    item.placed.clear();
+    for (size_t bucket = 0; bucket < placement.bucket_num(); ++bucket) {
+      item.placed.push_back(std::make_shared<const NetDef>(placement.Place(bucket)));
+    }
+  }
+  return item.placed;
+}
+
+}  // namespace
+
 HybridNet::HybridNet(const std::shared_ptr<const NetDef>& net_def,
     Workspace* ws) : Net(net_def, ws) {
+  // the profiled gpu nets are placed for each batch bucket
+  std::unique_ptr<CostPlacement> placement(new CostPlacement(*net_def));
+  if (placement->bucket_num() > 0 && net_def->device_option().device_type() == kCUDA) {
+    CreateInputBlobs(placement->input_device(), ws);
+    for (const auto& placed : GetPlacedNetDefs(net_def, *placement)) {
+      BuildPartition(placed, ws);
+    }
+    placement_ = std::move(placement);
+  } else {
+    BuildPartition(net_def, ws);
+  }
+  LOG_DEBUG("HybridNet, partition size:%u sub net size:%u",
+      partition_heads_.size(), sub_nets_.size());
+
+  // merge external_input_blob and external_output_blob
+  MergeInputBlobs();
+  MergeOutputBlobs();
+  MergeTotalBlobs();
+  MarkCommonOps();
+
+  // NOTE: SchedulerManager.Init should be invoked at first
+  // when current process starts
+  scheduler_manager_ = SchedulerManager<AsyncTask>::Instance();
+
+  // construct hybrid net's input and output blob map
+  for (auto& net : sub_nets_) {
+    for (auto& op : net->operators()) {
+      set_input_blob(op->operator_def(), op);
+      set_output_blob(op->operator_def(), op);
+    }
+  }
+}
+
+void HybridNet::BuildPartition(const std::shared_ptr<const NetDef>& net_def, Workspace* ws) {
   // build all sub nets
   CrossDeviceGraphManager manager(*net_def);  
   // rewrite graph and split graph
@@ -21,38 +88,71 @@ HybridNet::HybridNet(const std::shared_ptr<const NetDef>& net_def,
   LOG_DEBUG("HybridNet, net def size:%u", net_defs.size());
   //TODO
   //NetDefHelper::SaveNetDefToTextFile("sub_graph", &(net_defs[0]));
+  size_t first = sub_nets_.size();
   for (auto& sub_net_def : net_defs) {
     // iterate all sub net_def to build sub net
     // use SimpleNet by default   
     auto cur_net_def = std::make_shared<const NetDef>(sub_net_def);
     sub_nets_.emplace_back(new SimpleNet(std::move(cur_net_def), ws));     
+    batch_queue_key_[sub_nets_.back().get()] = net_def.get();
   }
-  
+  if (first == sub_nets_.size()) return;
+
   // build sub net dependency
-  if (sub_nets_.size() > 1) {
-    for (size_t i = 0; i < sub_nets_.size() - 1; ++i) {
-      topo_next_net_.emplace(sub_nets_[i].get(), sub_nets_[i + 1].get());
-    }
+  for (size_t i = first; i + 1 < sub_nets_.size(); ++i) {
+    topo_next_net_.emplace(sub_nets_[i].get(), sub_nets_[i + 1].get());
   }
+  partition_heads_.push_back(sub_nets_[first].get());
+}
 
-  // merge external_input_blob and external_output_blob
-  MergeInputBlobs();
-  MergeOutputBlobs();
-  MergeTotalBlobs();
+void HybridNet::CreateInputBlobs(
+    const std::unordered_map<std::string, DeviceOption>& input_device, Workspace* ws) {
+  for (const auto& item : input_device) {
+    bool newblob = false;
+    Blob* blob = ws->CreateBlob(item.first, item.second, &newblob);
+    if (newblob) {
+      blob->set_data_type(ws->input_data_type(item.first));
+    }
+  }
+}
 
-  // NOTE: SchedulerManager.Init should be invoked at first
-  // when current process starts
-  scheduler_manager_ = SchedulerManager<AsyncTask>::Instance();
+size_t HybridNet::BatchSize() const {
+  size_t batch_size = 0;
+  for (const auto& item : external_input_blob_) {
+    const auto& shape = item.second->shape();
+    if (!shape.empty()) batch_size = std::max<size_t>(batch_size, shape[0]);
+  }
+  return batch_size;
+}
 
-  // construct hybrid net's input and output blob map
-  for (auto& net : sub_nets_) {
-    for (auto& op : net->operators()) {
-      set_input_blob(op->operator_def(), op);
-      set_output_blob(op->operator_def(), op);
+void HybridNet::MarkCommonOps() {
+  std::unordered_set<std::string> common;
+  NetDefHelper::CommonOps(*net_def_, &common);
+  for (auto head : partition_heads_) {
+    std::unordered_set<std::string> partition_common = common;
+    for (Net* net = head; net != nullptr; ) {
+      SimpleNet* simple_net = dynamic_cast<SimpleNet*>(net);
+      if (simple_net != nullptr) simple_net->MarkCommonOps(&partition_common);
+      auto it = topo_next_net_.find(net);
+      net = it == topo_next_net_.end() ? nullptr : it->second;
     }
   }
 }
 
+void HybridNet::set_common_reused(bool common_reused) {
+  common_reused_ = common_reused;
+  for (auto& net : sub_nets_) net->set_common_reused(common_reused);
+}
+
+void HybridNet::InvalidateCommon() {
+  for (auto& net : sub_nets_) net->InvalidateCommon();
+}
+
+bool HybridNet::IsPartitionHead(Net* net) const {
+  return std::find(partition_heads_.begin(), partition_heads_.end(), net) !=
+      partition_heads_.end();
+}
+
 std::vector<std::string> HybridNet::GetTopoBlobName() const {
   std::vector<std::string> names;
   std::set<std::string> sets;
@@ -106,6 +206,8 @@ bool HybridNet::DoRun(Net* net, const PredictorCallback&& cb) {
   
   // build AsyncTask
   std::unique_ptr<AsyncTask> async_task(new AsyncTask(net, this, std::move(cb)));
+  async_task->deadline_micros = deadline_micros_;
+  async_task->intra_op_threads = intra_op_threads_;
   auto& device_option = net->device_option();
   LOG_DEBUG("Net device type:%d device id:%d is pipe:%d",
       device_option.device_type(), device_option.device_id(), device_option.is_pipe());
@@ -126,7 +228,7 @@ bool HybridNet::DoRun(Net* net, const PredictorCallback&& cb) {
       return false;
     }
     // invoke Schedule of BatchScheduler
-    auto queue = scheduler_manager_->GetBatchedQueue(&(net_def()),
+    auto queue = scheduler_manager_->GetBatchedQueue(batch_queue_key_[net],
         [] (std::unique_ptr<batching::Batch<AsyncTask>> batch_tasks) {
             if (0 == batch_tasks->num_tasks()) {
               LOG_ERROR("None task to process");
@@ -142,6 +244,17 @@ bool HybridNet::DoRun(Net* net, const PredictorCallback&& cb) {
               nets.push_back(task->net);
             }
 
+            // the merged run takes the largest budget of its tasks
+            int intra_op_threads = 0;
+            for (int i = 0; i < batch_tasks->num_tasks(); ++i) {
+              int budget = batch_tasks->mutable_task(i)->intra_op_threads;
+              if (budget <= 0) {
+                intra_op_threads = 0;
+                break;
+              }
+              intra_op_threads = std::max(intra_op_threads, budget);
+            }
+
             Net* merged_net;
             bool is_success = first_task_parent_net->batching_.Merge(nets,
                 &merged_net);
@@ -151,7 +264,10 @@ bool HybridNet::DoRun(Net* net, const PredictorCallback&& cb) {
             }
             
             // only running the merged net 
-            merged_net->Run();
+            {
+              IntraOpThreadsGuard intra_op_guard(intra_op_threads);
+              merged_net->Run();
+            }
 
             // split nets
             is_success = first_task_parent_net->batching_.Split(
@@ -165,12 +281,25 @@ bool HybridNet::DoRun(Net* net, const PredictorCallback&& cb) {
               AsyncTask* task = batch_tasks->mutable_task(i);
               (task->cb)(); 
             }
-          }, batch_scheduler);
+          }, batch_scheduler,
+        [] (std::unique_ptr<AsyncTask> task) {
+            // the run can not meet its deadline, finish it unprocessed
+            HybridNet* task_parent_net = dynamic_cast<HybridNet*>(task->parent_net);
+            task_parent_net->deadline_exceeded_ = true;
+            (task->cb)();
+          });
     if (nullptr == queue) {
       LOG_ERROR("GetBatchedQueue failed");
       return false;
     }
-    if (batching::Status::kOk != queue->Schedule(&async_task)) {
+    batching::Status status = queue->Schedule(&async_task);
+    if (batching::Status::kDeadlineExceeded == status) {
+      LOG_DEBUG("Shared batching dropped the task, its deadline can not be met");
+      deadline_exceeded_ = true;
+      // the later sub nets have no caller to tell, finish the run here
+      if (!IsPartitionHead(net)) (async_task->cb)();
+      return false;
+    } else if (batching::Status::kOk != status) {
       LOG_ERROR("Shared batching schedule failed");
       return false;
     }
@@ -181,7 +310,10 @@ bool HybridNet::DoRun(Net* net, const PredictorCallback&& cb) {
       ([] (std::unique_ptr<AsyncTask> task) {
         HybridNet* task_parent_net = dynamic_cast<HybridNet*>(task->parent_net);
         // invoke synchronous interface net.Run 
-        task->net->Run();
+        {
+          IntraOpThreadsGuard intra_op_guard(task->intra_op_threads);
+          task->net->Run();
+        }
 
         // invoke next scheduler.Schedule if such scheduler exists
         auto it = task_parent_net->topo_next_net_.find(task->net);
@@ -198,9 +330,17 @@ bool HybridNet::DoRun(Net* net, const PredictorCallback&& cb) {
 }
 
 bool HybridNet::Run(const PredictorCallback&& cb) {
-  // always use the first sub net as starting point
-  // because sub_nets_ has been topological sorted
-  return DoRun(sub_nets_[0].get(), std::move(cb)); 
+  deadline_exceeded_ = false;
+  // always use the first sub net of the partition as starting point
+  // because the sub nets of a partition have been topological sorted
+  size_t bucket = placement_ ? placement_->Bucket(BatchSize()) : 0;
+  bucket = std::min(bucket, partition_heads_.size() - 1);
+  // the common outputs of the other partitions are of the older inputs
+  if (common_reused_ && partition_heads_.size() > 1 && bucket != last_bucket_) {
+    InvalidateCommon();
+  }
+  last_bucket_ = bucket;
+  return DoRun(partition_heads_[bucket], std::move(cb)); 
 }
 
 bool HybridNet::Run() {
@@ -209,7 +349,7 @@ bool HybridNet::Run() {
     return false;
   }
   semaphore.wait();
-  return true;
+  return !deadline_exceeded_;
 }
 
 REGISTER_NET(hybrid, HybridNet);
@@ -11,6 +11,7 @@
 #include <unordered_set>
 #include <string>
 #include "blaze/graph/net.h"
+#include "blaze/graph/transform/cost_placement.h"
 #include "blaze/scheduler/scheduler_manager.h"
 #include "blaze/scheduler/structured_batching.h"
 
@@ -29,6 +30,9 @@ class HybridNet : public Net {
   // async interface, just put the cb, first sub net and process func into scheduler 
   virtual bool Run(const PredictorCallback&& cb) override;
   virtual std::vector<std::string> GetTopoBlobName() const override;
+  // the sub nets keep their common outputs
+  virtual void set_common_reused(bool common_reused) override;
+  virtual void InvalidateCommon() override;
 
  protected:
   DISABLE_COPY_AND_ASSIGN(HybridNet);
@@ -39,8 +43,29 @@ class HybridNet : public Net {
   void MergeInputBlobs();
   void MergeOutputBlobs();
   void MergeTotalBlobs();
+  // split the net across devices and build its sub nets as a partition
+  void BuildPartition(const std::shared_ptr<const NetDef>& net_def, Workspace* ws);
+  // create the inputs on the devices shared by the partitions
+  void CreateInputBlobs(const std::unordered_map<std::string, DeviceOption>& input_device,
+                        Workspace* ws);
+  // the rows of the largest input
+  size_t BatchSize() const;
+  bool IsPartitionHead(Net* net) const;
+  // mark the common ops of the sub nets, whose inputs are the outputs of the
+  // sub nets before them
+  void MarkCommonOps();
 
+  // the sub nets of all the partitions
   std::vector<std::unique_ptr<Net>> sub_nets_;
+  // the first sub net of the partition of each batch bucket
+  std::vector<Net*> partition_heads_;
+  // the partition of the last run
+  size_t last_bucket_ = 0;
+  // the cost placement of the profiled nets, nullptr if not profiled
+  std::unique_ptr<CostPlacement> placement_;
+  // the net def of the partition of each sub net, shared by the hybrid
+  // nets of a workspace as the key of the batched queue
+  std::unordered_map<Net*, const NetDef*> batch_queue_key_;
   // <cur Net, next Net>
   std::unordered_map<Net*, Net*> topo_next_net_;
   std::shared_ptr<SchedulerManager<AsyncTask>> scheduler_manager_; 
@@ -6,6 +6,10 @@
 
 #include "blaze/graph/observer/profile_observer.h"
 #include "blaze/graph/observer/cost_observer.h"
+#include "blaze/graph/observer/calibration_observer.h"
+#include "blaze/graph/observer/placement_observer.h"
+#include "blaze/graph/observer/sparse_cache_observer.h"
+#include "blaze/graph/observer/op_latency_observer.h"
 
 namespace blaze {
 
@@ -129,6 +133,30 @@ void Net::RegisterObservers(const std::vector<std::string>& observer_names) {
     } else if (name == "cost") {
       std::unique_ptr<CostObserver> cost_ob = blaze::make_unique<CostObserver>(this);
       this->AttachObserver(std::move(cost_ob));
+    } else if (name == "calibration") {
+      std::unique_ptr<CalibrationObserver> calibration_ob =
+          blaze::make_unique<CalibrationObserver>(this);
+      this->AttachObserver(std::move(calibration_ob));
+    } else if (name == "placement") {
+      std::unique_ptr<PlacementObserver> placement_ob = blaze::make_unique<PlacementObserver>(this);
+      this->AttachObserver(std::move(placement_ob));
+    } else if (name == "sparse_cache") {
+      std::unique_ptr<SparseCacheObserver> sparse_cache_ob =
+          blaze::make_unique<SparseCacheObserver>(this);
+      this->AttachObserver(std::move(sparse_cache_ob));
+    } else if (name.compare(0, 10, "op_latency") == 0 &&
+               (name.size() == 10 || name[10] == ':')) {
+      // op_latency[:sample_rate[:label]]
+      int sample_rate = kDefaultOpLatencySampleRate;
+      std::string label;
+      if (name.size() > 10) {
+        size_t pos = name.find(':', 11);
+        sample_rate = atoi(name.substr(11, pos - 11).c_str());
+        if (pos != std::string::npos) label = name.substr(pos + 1);
+      }
+      std::unique_ptr<OpLatencyObserver> op_latency_ob =
+          blaze::make_unique<OpLatencyObserver>(this, sample_rate, label);
+      this->AttachObserver(std::move(op_latency_ob));
     } else {
       LOG_ERROR("Unkown observer name: %s", name.c_str());
     }
@@ -110,6 +110,8 @@ class Net : public Observable<Net> {
   // Return the device option
   const DeviceOption& device_option() const { return net_def_->device_option(); }
   const NetDef& net_def() const { return *(net_def_.get()); }
+  // Return the workspace of the net
+  Workspace* workspace() const { return workspace_; }
 
   // Register all the observers
   void RegisterObservers();
@@ -118,6 +120,24 @@ class Net : public Observable<Net> {
   // Return the operators
   std::vector<std::unique_ptr<OperatorBase>>& operators() { return operators_; }
 
+  // The deadline of the next runs in micros of batching::Env::NowMicros, 0 if
+  // none. The batching queues drop the runs which can not meet it.
+  void set_deadline_micros(uint64_t deadline_micros) { deadline_micros_ = deadline_micros; }
+  uint64_t deadline_micros() const { return deadline_micros_; }
+  // Whether the last run was dropped for its deadline
+  bool deadline_exceeded() const { return deadline_exceeded_; }
+  // The intra op threads budget of the next runs on the scheduler threads,
+  // 0 for the share of the scheduler thread
+  void set_intra_op_threads(int intra_op_threads) { intra_op_threads_ = intra_op_threads; }
+  int intra_op_threads() const { return intra_op_threads_; }
+  // Skip the ops computed from the common inputs only in the next runs,
+  // which keep their outputs of the last run, while the common inputs are
+  // not fed again. The nets without the support run all the ops.
+  virtual void set_common_reused(bool common_reused) { common_reused_ = common_reused; }
+  // Let the next run compute the common ops again, such as after the net
+  // ran the merged inputs of a batch
+  virtual void InvalidateCommon() { common_valid_ = false; }
+
  protected:
   virtual bool RunImpl() {
     LOG_ERROR("Not implemented!");
@@ -177,6 +197,12 @@ class Net : public Observable<Net> {
 
   std::vector<std::unique_ptr<OperatorBase>> operators_;
   Workspace* workspace_;
+  uint64_t deadline_micros_ = 0;
+  bool deadline_exceeded_ = false;
+  int intra_op_threads_ = 0;
+  bool common_reused_ = false;
+  // Whether the outputs of the common ops are of the last run's inputs
+  bool common_valid_ = false;
 
   DISABLE_COPY_AND_ASSIGN(Net);
 };
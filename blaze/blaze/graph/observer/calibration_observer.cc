@@ -0,0 +1,79 @@
+/*
+ * \file calibration_observer.cc
+ * \brief The calibration observer implementation
+ */
+#include "blaze/graph/observer/calibration_observer.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "blaze/common/proto_helper.h"
+
+namespace blaze {
+
+void CalibrationOperatorObserver::Stop() {
+  OperatorBase* op = subject();
+  if (op->type() != "Gemm" || op->InputSize() == 0) return;
+  Blob* blob = op->Input(0);
+  if (blob->data_type() != kFloat || blob->size() == 0) return;
+
+  const float* data = blob->as<float>();
+  std::vector<float> host;
+  if (calibration_observer_->device_option().device_type() == kCUDA) {
+#ifdef USE_CUDA
+    auto cuda_op = dynamic_cast<const Operator<CUDAContext>*>(op);
+    BLAZE_CONDITION_THROW(cuda_op != nullptr, "op is not on cuda");
+    const auto& context = cuda_op->context();
+    CUDADeviceGuard(context.device_id());
+    host.resize(blob->size());
+    CUDA_CHECK(cudaStreamSynchronize(context.cuda_stream()));
+    CUDA_CHECK(cudaMemcpy(host.data(), data, blob->size() * sizeof(float),
+                          cudaMemcpyDeviceToHost));
+    data = host.data();
+#endif
+  }
+  auto range = std::minmax_element(data, data + blob->size());
+  if (!recorded_) {
+    min_ = *range.first;
+    max_ = *range.second;
+    recorded_ = true;
+  } else {
+    min_ = std::min(min_, *range.first);
+    max_ = std::max(max_, *range.second);
+  }
+}
+
+void CalibrationOperatorObserver::Dump(std::string* out) {
+  if (!recorded_) return;
+  std::stringstream ss;
+  ss << subject_->name() << " " << min_ << " " << max_;
+  *out = ss.str();
+}
+
+void CalibrationObserver::Dump(std::string* out) {
+  std::stringstream ss;
+  for (auto operator_observer : operator_observers_) {
+    std::string str;
+    operator_observer->Dump(&str);
+    if (!str.empty()) ss << str << "\n";
+  }
+  *out = ss.str();
+}
+
+void CalibrationObserver::ApplyCalibration(const std::string& dump, NetDef* net_def) {
+  std::unordered_map<std::string, std::vector<float>> ranges;
+  std::stringstream ss(dump);
+  std::string name;
+  float min, max;
+  while (ss >> name >> min >> max) {
+    ranges[name] = { min, max };
+  }
+  for (auto& op : *(net_def->mutable_op())) {
+    auto iter = ranges.find(op.name());
+    if (iter != ranges.end()) {
+      ArgumentHelper::SetRepeatedArgument(op, "x_range", iter->second);
+    }
+  }
+}
+
+}  // namespace blaze
@@ -0,0 +1,50 @@
+/*
+ * \file calibration_observer.h
+ * \brief The calibration observer, records the activation ranges of the
+ * ops the int8 path quantizes.
+ */
+#pragma once
+
+#include <sstream>
+
+#include "blaze/graph/observer/net_observer.h"
+
+namespace blaze {
+
+class CalibrationObserver;
+
+class CalibrationOperatorObserver : public ObserverBase<OperatorBase> {
+ public:
+  explicit CalibrationOperatorObserver(OperatorBase* op) = delete;
+  explicit CalibrationOperatorObserver(OperatorBase* op, CalibrationObserver* calibration_observer) :
+      ObserverBase<OperatorBase>(op), calibration_observer_(calibration_observer) { }
+
+ protected:
+  void Start() override { }
+  void Stop() override;
+  void Dump(std::string* out) override;
+  const char* Name() const override { return "calibration_operator"; }
+
+  bool recorded_ = false;
+  float min_ = 0;
+  float max_ = 0;
+  CalibrationObserver* calibration_observer_;
+  friend class CalibrationObserver;
+};
+
+// Run the calibration samples with the observer, its dump is a line of
+// "name min max" for each Gemm's input, which ApplyCalibration sets as the
+// x_range argument of the ops for QuantizationPass.
+class CalibrationObserver : public NetObserver<CalibrationOperatorObserver, CalibrationObserver> {
+ public:
+  explicit CalibrationObserver(Net* net) :
+      NetObserver<CalibrationOperatorObserver, CalibrationObserver>(net, this) { }
+
+  void Dump(std::string* out) override;
+  const char* Name() const override { return "calibration"; }
+
+  // Set the ranges of a dump on the ops of net_def
+  static void ApplyCalibration(const std::string& dump, NetDef* net_def);
+};
+
+}  // namespace blaze
@@ -0,0 +1,147 @@
+/*
+ * \file op_latency_observer.cc
+ * \brief The op latency observer, samples the op latency into the histograms
+ * shared by the predictors, which is low overhead enough for production.
+ */
+#include "blaze/graph/observer/op_latency_observer.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "blaze/common/timer.h"
+
+namespace blaze {
+
+const int OpLatencyHistogram::kBucketNum;
+
+void OpLatencyHistogram::Record(uint64_t micros) {
+  int bucket = 0;
+  while (bucket < kBucketNum - 1 && micros >= (1ull << bucket)) ++bucket;
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  sum_micros_.fetch_add(micros, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void OpLatencyHistogram::Reset() {
+  for (auto& bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+  sum_micros_.store(0, std::memory_order_relaxed);
+  count_.store(0, std::memory_order_relaxed);
+}
+
+std::vector<uint64_t> OpLatencyHistogram::buckets() const {
+  std::vector<uint64_t> buckets(kBucketNum);
+  for (int i = 0; i < kBucketNum; ++i) {
+    buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+  return buckets;
+}
+
+OpLatencyHistogram* OpLatencyRegistry::NetLatency::Get(const std::string& name,
+                                                       const std::string& type) {
+  auto& histogram = ops[name];
+  if (histogram == nullptr) histogram.reset(new OpLatencyHistogram(type));
+  return histogram.get();
+}
+
+OpLatencyRegistry* OpLatencyRegistry::Instance() {
+  static OpLatencyRegistry instance;
+  return &instance;
+}
+
+OpLatencyRegistry::NetLatency* OpLatencyRegistry::Get(const std::string& label) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto& latency = nets_[label];
+  if (latency == nullptr) latency.reset(new NetLatency());
+  return latency.get();
+}
+
+void OpLatencyRegistry::Visit(const Visitor& visitor) {
+  std::vector<std::pair<std::string, NetLatency*>> nets;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (const auto& iter : nets_) nets.emplace_back(iter.first, iter.second.get());
+  }
+  std::sort(nets.begin(), nets.end());
+  for (const auto& net : nets) {
+    std::vector<std::pair<std::string, const OpLatencyHistogram*>> ops;
+    {
+      std::unique_lock<std::mutex> lock(net.second->mutex);
+      for (const auto& iter : net.second->ops) ops.emplace_back(iter.first, iter.second.get());
+    }
+    std::sort(ops.begin(), ops.end());
+    for (const auto& op : ops) {
+      visitor(net.first, op.first, *op.second);
+    }
+  }
+}
+
+std::string OpLatencyRegistry::Dump() {
+  std::stringstream ss;
+  ss << "# TYPE blaze_op_latency_micros histogram\n";
+  Visit([&ss](const std::string& net, const std::string& op, const OpLatencyHistogram& histogram) {
+    std::string labels = "net=\"" + net + "\",op=\"" + op + "\",type=\"" + histogram.type() + "\"";
+    // the count is summed from the buckets read, which keeps the dump
+    // consistent under the concurrent runs
+    std::vector<uint64_t> buckets = histogram.buckets();
+    uint64_t cumulative = 0;
+    for (int i = 0; i < OpLatencyHistogram::kBucketNum - 1; ++i) {
+      cumulative += buckets[i];
+      ss << "blaze_op_latency_micros_bucket{" << labels << ",le=\"" << (1ull << i) << "\"} "
+         << cumulative << "\n";
+    }
+    cumulative += buckets[OpLatencyHistogram::kBucketNum - 1];
+    ss << "blaze_op_latency_micros_bucket{" << labels << ",le=\"+Inf\"} " << cumulative << "\n";
+    ss << "blaze_op_latency_micros_sum{" << labels << "} " << histogram.sum_micros() << "\n";
+    ss << "blaze_op_latency_micros_count{" << labels << "} " << cumulative << "\n";
+  });
+  return ss.str();
+}
+
+void OpLatencyRegistry::Clear() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (const auto& net : nets_) {
+    std::unique_lock<std::mutex> net_lock(net.second->mutex);
+    for (const auto& op : net.second->ops) op.second->Reset();
+  }
+}
+
+void OpLatencyOperatorObserver::Start() {
+  if (!op_latency_observer_->sampled_) return;
+  Synchronize();
+  start_time_ = GetTime();
+}
+
+void OpLatencyOperatorObserver::Stop() {
+  if (!op_latency_observer_->sampled_) return;
+  Synchronize();
+  histogram_->Record((GetTime() - start_time_) * 1000 * 1000);
+}
+
+void OpLatencyOperatorObserver::Synchronize() {
+#ifdef USE_CUDA
+  auto op = dynamic_cast<const Operator<CUDAContext>*>(subject_);
+  if (op) {
+    const auto& context = op->context();
+    CUDADeviceGuard guard(context.device_id());
+    CUDA_CHECK(cudaStreamSynchronize(context.cuda_stream()));
+  }
+#endif
+}
+
+OpLatencyObserver::OpLatencyObserver(Net* net, int sample_rate, const std::string& label) :
+    NetObserver<OpLatencyOperatorObserver, OpLatencyObserver>(net, this),
+    sample_rate_(std::max(sample_rate, 1)) {
+  latency_ = OpLatencyRegistry::Instance()->Get(label.empty() ? net->name() : label);
+  std::unique_lock<std::mutex> lock(latency_->mutex);
+  for (auto operator_observer : operator_observers_) {
+    OperatorBase* op = operator_observer->subject();
+    operator_observer->histogram_ = latency_->Get(op->name(), op->type());
+  }
+}
+
+void OpLatencyObserver::Start() {
+  // the counter is shared by the predictors of the net, which may only run once
+  sampled_ = latency_->runs.fetch_add(1, std::memory_order_relaxed) % sample_rate_ == 0;
+}
+
+}  // namespace blaze
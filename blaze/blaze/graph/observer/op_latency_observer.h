@@ -0,0 +1,132 @@
+/*
+ * \file op_latency_observer.h
+ * \brief The op latency observer, samples the op latency into the histograms
+ * shared by the predictors, which is low overhead enough for production.
+ */
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "blaze/graph/observer/net_observer.h"
+
+namespace blaze {
+
+// The runs sampled by the op_latency observer without a rate
+const int kDefaultOpLatencySampleRate = 100;
+
+// The log2 latency histogram of an op, bucket i counts the runs faster than
+// 2^i micros, the last one the slower runs. Recorded without lock.
+class OpLatencyHistogram {
+ public:
+  static const int kBucketNum = 24;
+
+  OpLatencyHistogram(const std::string& type) : type_(type), count_(0), sum_micros_(0) {
+    for (auto& bucket : buckets_) bucket = 0;
+  }
+
+  void Record(uint64_t micros);
+  void Reset();
+
+  const std::string& type() const { return type_; }
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  uint64_t sum_micros() const { return sum_micros_.load(std::memory_order_relaxed); }
+  // The run count of each bucket, not cumulative
+  std::vector<uint64_t> buckets() const;
+
+ protected:
+  std::string type_;
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_micros_;
+  std::atomic<uint64_t> buckets_[kBucketNum];
+};
+
+// The op latency histograms of the nets, keyed by the net label and the op
+// name, so that the predictors of a net aggregate into the same histograms.
+class OpLatencyRegistry {
+ public:
+  // The histograms of a net and the run counter sampling the runs
+  struct NetLatency {
+    std::atomic<uint64_t> runs;
+    std::mutex mutex;
+    std::unordered_map<std::string, std::unique_ptr<OpLatencyHistogram>> ops;
+
+    NetLatency() : runs(0) { }
+    // The histogram of op, created if absent, which lives as the registry.
+    // The caller holds mutex.
+    OpLatencyHistogram* Get(const std::string& name, const std::string& type);
+  };
+
+  // visitor(net, op, type, histogram)
+  typedef std::function<void(const std::string&, const std::string&,
+                             const OpLatencyHistogram&)> Visitor;
+
+  static OpLatencyRegistry* Instance();
+
+  // The latency of the net of label, which lives as the registry
+  NetLatency* Get(const std::string& label);
+
+  // Visit the histograms ordered by the net label and the op name
+  void Visit(const Visitor& visitor);
+  // The histograms in the prometheus text format, the buckets of
+  // blaze_op_latency_micros are cumulative as the format requires.
+  std::string Dump();
+  // Reset the recorded runs of all the nets, the histograms are kept
+  void Clear();
+
+ protected:
+  OpLatencyRegistry() { }
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::unique_ptr<NetLatency>> nets_;
+};
+
+class OpLatencyObserver;
+
+class OpLatencyOperatorObserver : public ObserverBase<OperatorBase> {
+ public:
+  explicit OpLatencyOperatorObserver(OperatorBase* op) = delete;
+  explicit OpLatencyOperatorObserver(OperatorBase* op, OpLatencyObserver* op_latency_observer) :
+      ObserverBase<OperatorBase>(op), op_latency_observer_(op_latency_observer) { }
+
+ protected:
+  void Start() override;
+  void Stop() override;
+  const char* Name() const override { return "op_latency_operator"; }
+
+  // Wait the kernels of the op on gpu
+  void Synchronize();
+
+  double start_time_ = 0;
+  OpLatencyHistogram* histogram_ = nullptr;
+  OpLatencyObserver* op_latency_observer_;
+  friend class OpLatencyObserver;
+};
+
+// Records the latency of the ops of one in sample_rate runs of the net. The
+// gpu ops are synchronized on the sampled runs only, and the other runs cost
+// a relaxed atomic increment. The histograms export by DumpOpLatencyMetrics.
+class OpLatencyObserver : public NetObserver<OpLatencyOperatorObserver, OpLatencyObserver> {
+ public:
+  // label names the net in the histograms, the net name if empty
+  OpLatencyObserver(Net* net, int sample_rate, const std::string& label);
+
+  const char* Name() const override { return "op_latency"; }
+  bool sampled() const { return sampled_; }
+
+ protected:
+  void Start() override;
+  void Stop() override { }
+
+  int sample_rate_;
+  bool sampled_ = false;
+  OpLatencyRegistry::NetLatency* latency_;
+  friend class OpLatencyOperatorObserver;
+};
+
+}  // namespace blaze
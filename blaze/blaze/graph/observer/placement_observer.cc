@@ -0,0 +1,75 @@
+/*
+ * \file placement_observer.cc
+ * \brief The placement observer, profiles the ops for the cost placement
+ */
+#include "blaze/graph/observer/placement_observer.h"
+
+#include "blaze/common/timer.h"
+
+namespace blaze {
+
+void PlacementOperatorObserver::Start() {
+  Synchronize();
+  start_time_ = GetTime();
+}
+
+void PlacementOperatorObserver::Stop() {
+  Synchronize();
+  total_micros_ += (GetTime() - start_time_) * 1000 * 1000;
+  ++iterations_;
+
+  OperatorBase* op = subject();
+  const OperatorDef& def = op->operator_def();
+  input_bytes_ = 0;
+  for (size_t k = 0; k < op->InputSize(); ++k) {
+    if (!placement_observer_->external_input_.count(def.input(k))) continue;
+    Blob* blob = op->Input(k);
+    input_bytes_ += blob->size() * DataTypeSize(blob->data_type());
+  }
+  output_bytes_ = 0;
+  for (size_t k = 0; k < op->OutputSize(); ++k) {
+    Blob* blob = op->Output(k);
+    output_bytes_ += blob->size() * DataTypeSize(blob->data_type());
+  }
+}
+
+void PlacementOperatorObserver::Synchronize() {
+#ifdef USE_CUDA
+  auto op = dynamic_cast<const Operator<CUDAContext>*>(subject_);
+  if (op) {
+    const auto& context = op->context();
+    CUDADeviceGuard guard(context.device_id());
+    CUDA_CHECK(cudaStreamSynchronize(context.cuda_stream()));
+  }
+#endif
+}
+
+void PlacementOperatorObserver::Dump(std::string* out) {
+  if (iterations_ == 0) {
+    out->clear();
+    return;
+  }
+  std::stringstream ss;
+  ss << subject_->name() << " " << subject_->device_option().device_type() << " "
+     << total_micros_ / iterations_ << " " << input_bytes_ << " " << output_bytes_;
+  *out = ss.str();
+}
+
+PlacementObserver::PlacementObserver(Net* net) :
+    NetObserver<PlacementOperatorObserver, PlacementObserver>(net, this) {
+  for (const auto& name : net->external_input()) {
+    external_input_.insert(name);
+  }
+}
+
+void PlacementObserver::Dump(std::string* out) {
+  std::stringstream ss;
+  for (auto operator_observer : operator_observers_) {
+    std::string str;
+    operator_observer->Dump(&str);
+    if (!str.empty()) ss << str << "\n";
+  }
+  *out = ss.str();
+}
+
+}  // namespace blaze
@@ -0,0 +1,59 @@
+/*
+ * \file placement_observer.h
+ * \brief The placement observer, profiles the ops for the cost placement
+ */
+#pragma once
+
+#include <sstream>
+#include <unordered_set>
+
+#include "blaze/graph/observer/net_observer.h"
+
+namespace blaze {
+
+class PlacementObserver;
+
+class PlacementOperatorObserver : public ObserverBase<OperatorBase> {
+ public:
+  explicit PlacementOperatorObserver(OperatorBase* op) = delete;
+  explicit PlacementOperatorObserver(OperatorBase* op, PlacementObserver* placement_observer) :
+      ObserverBase<OperatorBase>(op), placement_observer_(placement_observer) { }
+
+ protected:
+  void Start() override;
+  void Stop() override;
+  void Dump(std::string* out) override;
+  const char* Name() const override { return "placement_operator"; }
+
+  // Wait the kernels of the op on gpu
+  void Synchronize();
+
+  double start_time_ = 0;
+  double total_micros_ = 0;
+  size_t iterations_ = 0;
+  int64_t input_bytes_ = 0;
+  int64_t output_bytes_ = 0;
+  PlacementObserver* placement_observer_;
+  friend class PlacementObserver;
+};
+
+// Measures the average micros and the blob bytes of each op of a simple net,
+// the dump is the profile of CostPlacement::AddProfile for the batch size of
+// the runs. The gpu ops are synchronized, so the runs are only for profiling.
+class PlacementObserver : public NetObserver<PlacementOperatorObserver, PlacementObserver> {
+ public:
+  explicit PlacementObserver(Net* net);
+
+  void Dump(std::string* out) override;
+  const char* Name() const override { return "placement"; }
+
+ protected:
+  void Start() override { };
+  void Stop() override { };
+
+  // the inputs of the net, which are fed on the host
+  std::unordered_set<std::string> external_input_;
+  friend class PlacementOperatorObserver;
+};
+
+}  // namespace blaze
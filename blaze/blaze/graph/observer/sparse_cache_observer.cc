@@ -0,0 +1,45 @@
+/*
+ * \file sparse_cache_observer.cc
+ * \brief The sparse cache observer, counts the hits of the pooled results
+ * cache of the sparse puller.
+ */
+#include "blaze/graph/observer/sparse_cache_observer.h"
+
+namespace blaze {
+
+SparseCacheObserver::SparseCacheObserver(Net* net) : ObserverBase<Net>(net) {
+  const auto& sparse_puller = net->workspace()->GetSparsePuller();
+  cache_ = dynamic_cast<const store::CachedSparsePuller*>(sparse_puller.get());
+}
+
+void SparseCacheObserver::Start() {
+  if (cache_ != nullptr) start_ = cache_->GetStats();
+}
+
+void SparseCacheObserver::Stop() {
+  if (cache_ == nullptr) return;
+  store::CachedSparsePuller::Stats stats = cache_->GetStats();
+  hit_ += stats.hit - start_.hit;
+  miss_ += stats.miss - start_.miss;
+}
+
+void SparseCacheObserver::Dump(std::string* out) {
+  std::stringstream ss;
+  if (cache_ == nullptr) {
+    ss << "no sparse cache";
+  } else {
+    store::CachedSparsePuller::Stats stats = cache_->GetStats();
+    uint64_t total = hit_ + miss_;
+    ss << "Hit: " << hit_ << " Miss: " << miss_
+       << " HitRate: " << (total == 0 ? 0.0 : static_cast<double>(hit_) / total) << "\n";
+    ss << "Entries: " << stats.entry_num
+       << " Bytes: " << stats.bytes / (1024.0 * 1024.0) << " MB";
+  }
+  *out = ss.str();
+
+#ifndef PROFILE_EXPORT
+  LOG_INFO("\n%s", ss.str().c_str());
+#endif
+}
+
+}  // namespace blaze
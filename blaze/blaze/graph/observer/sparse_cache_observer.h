@@ -0,0 +1,36 @@
+/*
+ * \file sparse_cache_observer.h
+ * \brief The sparse cache observer, counts the hits of the pooled results
+ * cache of the sparse puller.
+ */
+#pragma once
+
+#include <sstream>
+
+#include "blaze/common/observer.h"
+#include "blaze/graph/net.h"
+#include "blaze/store/cached_sparse_puller.h"
+
+namespace blaze {
+
+// Counts the cache hits and misses of the routes pulled in the runs of the
+// net. The cache is shared by the predictors of a predictor manager, so the
+// counts of the concurrent runs of other predictors are included.
+class SparseCacheObserver : public ObserverBase<Net> {
+ public:
+  explicit SparseCacheObserver(Net* net);
+
+  void Start() override;
+  void Stop() override;
+  void Dump(std::string* out) override;
+  const char* Name() const override { return "sparse_cache"; }
+
+ protected:
+  // nullptr if the sparse puller of the net has no cache
+  const store::CachedSparsePuller* cache_;
+  store::CachedSparsePuller::Stats start_;
+  uint64_t hit_ = 0;
+  uint64_t miss_ = 0;
+};
+
+}  // namespace blaze
@@ -0,0 +1,71 @@
+/*
+ * \file parallel_slice_fusion_pattern_impl.cc 
+ * \brief The parallel slice fusion pattern implementation
+ * Such as: op->Slice/Slice/Slice/... -> FusedParallelSlice
+ */
+#include "blaze/graph/pattern/in_parallel/parallel_slice_fusion_pattern_impl.h"
+
+#include "blaze/operator/common_helper.h"
+
+namespace blaze {
+
+void ParallelSliceFusionPatternImpl::Init() {
+  slice_idx_.clear();
+  starts_.clear();
+  ends_.clear();
+}
+
+bool ParallelSliceFusionPatternImpl::Match(const std::vector<ArgumentHelper*>& args,
+                                           const std::vector<Node*>& nodes,
+                                           Graph* graph) {
+  Node* node0 = nodes[0];
+  BLAZE_CONDITION_THROW(node0->op.input_size() == 1, "node0->op.input_size()=", node0->op.input_size());
+  const std::string& iname = node0->op.input(0);
+  auto axis0 = CommonHelper::GetSliceAxis(args[0]);
+  std::string device0 = graph->DeviceStr(graph->device_option(*node0));
+
+  // The Slices of the same input along the same axis on the same device are
+  // fused, the input may be an external input, so all the nodes are visited.
+  for (size_t idx = 0; idx < graph->size(); ++idx) {
+    if (!graph->is_node_active(idx)) continue;
+    Node& slice_node = graph->node(idx);
+    if (slice_node.op.type() != "Slice") continue;
+    if (slice_node.op.input_size() != 1 || slice_node.op.input(0) != iname) continue;
+    if (graph->DeviceStr(graph->device_option(slice_node)) != device0) continue;
+    ArgumentHelper argument_helper(slice_node.op);
+    if (CommonHelper::GetSliceAxis(&argument_helper) != axis0) continue;
+
+    slice_idx_.push_back(idx);
+    starts_.push_back(CommonHelper::GetSliceStart(&argument_helper));
+    ends_.push_back(CommonHelper::GetSliceEnd(&argument_helper));
+  }
+  return slice_idx_.size() > 1;
+}
+
+void ParallelSliceFusionPatternImpl::GraphRewrite(const std::vector<ArgumentHelper*>& args,
+                                                  std::vector<Node*>& nodes,
+                                                  Graph* graph) {
+  Node* node0 = nodes[0];
+
+  // prepare the inserted node
+  OperatorDef new_op;
+  new_op.set_type(this->pattern->fusion_op_name());
+  new_op.set_name(node0->op.name());
+  if (node0->op.has_device_option()) {
+    new_op.mutable_device_option()->CopyFrom(node0->op.device_option());
+  }
+  new_op.add_input(node0->op.input(0));
+  for (auto idx : slice_idx_) {
+    new_op.add_output(graph->node(idx).op.output(0));
+  }
+
+  // set attributes
+  ArgumentHelper::SetSingleArgument<size_t>(new_op, "axis", CommonHelper::GetSliceAxis(args[0]));
+  ArgumentHelper::SetRepeatedArgument<size_t>(new_op, "start", starts_);
+  ArgumentHelper::SetRepeatedArgument<size_t>(new_op, "end", ends_);
+
+  graph->DeactivateSubgraph(slice_idx_);
+  graph->InsertNode(new_op);
+}
+
+}  // namespace blaze
@@ -6,6 +6,7 @@
 
 #include "blaze/graph/pattern/in_parallel/parallel_gemm_fusion_pattern_impl.h"
 #include "blaze/graph/pattern/in_parallel/parallel_slice_concat_fusion_pattern_impl.h"
+#include "blaze/graph/pattern/in_parallel/parallel_slice_fusion_pattern_impl.h"
 #include "blaze/graph/pattern/in_parallel/parallel_split_reducesum_fusion_pattern_impl.h"
 #include "blaze/graph/pattern/in_parallel/parallel_split_matmul_fusion_pattern_impl.h"
 #include "blaze/graph/pattern/in_parallel/parallel_split_mul_fusion_pattern_impl.h"
@@ -23,6 +24,15 @@ REGISTER_FUSION_PATTERN(FusedSliceConcat)
     .SetFusionPatternImpl(new ParallelSliceConcatFusionPatternImpl())
     .Init();
 
+// op->Slice/Slice/Slice/... -> FusedParallelSlice, the slices left by
+// FusedSliceConcat run as one MultiCopy.
+REGISTER_FUSION_PATTERN(FusedParallelSlice)
+    .Type(kInParallel)
+    .FusionOpName("FusedParallelSlice")
+    .AddOpNode("slice", "Slice")
+    .SetFusionPatternImpl(new ParallelSliceFusionPatternImpl())
+    .Init();
+
 // op->Gemm/Gemm/Gemm/... -> FusedParallelGemm.
 REGISTER_FUSION_PATTERN(FusedGemm)
     .Type(kInParallel)
@@ -4,6 +4,15 @@
  */
 #include "blaze/graph/simple_net.h"
 
+#include <set>
+
+#include "blaze/common/proto_helper.h"
+
+namespace {
+// The maximum captured cuda graphs of a net
+const size_t kMaxCudaGraphNum = 32;
+}  // namespace
+
 namespace blaze {
 
 SimpleNet::SimpleNet(const std::shared_ptr<const NetDef>& net_def, Workspace* ws) : Net(net_def, ws) {
@@ -30,10 +39,59 @@ SimpleNet::SimpleNet(const std::shared_ptr<const NetDef>& net_def, Workspace* ws
     const Event* event = &(operators_[idx]->event());
     this->events_.push_back(event);
   }
+
+#ifdef USE_CUDA_GRAPH
+  cuda_graph_enabled_ = ArgumentHelper::GetSingleArgument<NetDef, bool>(*net_def, "cuda_graph", false);
+  for (auto& op : operators_) {
+    if (op->device_option().device_type() != kCUDA) cuda_graph_enabled_ = false;
+  }
+  std::set<Blob*> blobs;
+  for (auto& op : operators_) {
+    for (auto blob : op->Inputs()) blobs.insert(blob);
+    for (auto blob : op->Outputs()) blobs.insert(blob);
+  }
+  blobs_.assign(blobs.begin(), blobs.end());
+#endif
+
+  std::unordered_set<std::string> common;
+  MarkCommonOps(&common);
+}
+
+SimpleNet::~SimpleNet() noexcept {
+#ifdef USE_CUDA_GRAPH
+  for (auto& item : cuda_graphs_) {
+    ReleaseCudaGraph(&item.second);
+  }
+#endif
+}
+
+void SimpleNet::MarkCommonOps(std::unordered_set<std::string>* common) {
+  common_op_ = NetDefHelper::CommonOps(*net_def_, common);
+  // the captured cuda graphs replay all the ops, and the event of the
+  // net is of the last op
+  bool reusable = !common_op_.empty() && !common_op_.back();
+#ifdef USE_CUDA_GRAPH
+  if (cuda_graph_enabled_) reusable = false;
+#endif
+  if (!reusable) common_op_.assign(common_op_.size(), false);
+  common_valid_ = false;
 }
 
 bool SimpleNet::RunImpl() {
-  for (auto& op : operators_) {
+#ifdef USE_CUDA_GRAPH
+  if (cuda_graph_enabled_ && operators_.size()) {
+    return RunCudaGraph();
+  }
+#endif
+  return RunOperators();
+}
+
+bool SimpleNet::RunOperators() {
+  bool skip_common = common_reused_ && common_valid_;
+  common_valid_ = false;
+  for (size_t i = 0; i < operators_.size(); ++i) {
+    if (skip_common && common_op_[i]) continue;
+    auto& op = operators_[i];
     LOG_DEBUG("run:%s %s", op->operator_def().type().c_str(),
               op->operator_def().name().c_str());
     bool res = op->Run();
@@ -42,9 +100,117 @@ bool SimpleNet::RunImpl() {
       return false;
     }
   }
+  common_valid_ = true;
   return true;
 }
 
+#ifdef USE_CUDA_GRAPH
+bool SimpleNet::RunCudaGraph() {
+  std::vector<std::vector<TIndex>> shapes;
+  for (const auto& name : external_input_) {
+    Blob* blob = external_input_blob(name);
+    if (blob) shapes.push_back(blob->shape());
+  }
+  std::vector<const void*> data;
+  BlobData(&data);
+
+  auto iter = cuda_graphs_.find(shapes);
+  if (iter != cuda_graphs_.end() && iter->second.data == data) {
+    // Restore the shapes set by the operators when captured, the blobs
+    // already hold them.
+    const CudaGraph& cuda_graph = iter->second;
+    for (size_t k = 0; k < blobs_.size(); ++k) {
+      blobs_[k]->Reshape(cuda_graph.shapes[k]);
+    }
+    OperatorBase* last_op = operators_.back().get();
+    int device_id = last_op->device_option().device_id();
+    CUDADeviceGuard guard(device_id);
+    CUDA_CHECK(cudaGraphLaunch(cuda_graph.exec, CUDAContext::cuda_stream(device_id, 0)));
+    last_op->RecordEvent();
+    return true;
+  }
+
+  // The blobs are reallocated or the shapes are new, run the operators to
+  // allocate them and capture the graph for the next runs.
+  if (iter != cuda_graphs_.end()) {
+    ReleaseCudaGraph(&iter->second);
+    cuda_graphs_.erase(iter);
+  }
+  if (!RunOperators()) return false;
+  if (cuda_graphs_.size() >= kMaxCudaGraphNum) return true;
+  Wait();
+
+  CudaGraph cuda_graph;
+  if (CaptureCudaGraph(&cuda_graph)) {
+    cuda_graphs_[shapes] = cuda_graph;
+  } else {
+    LOG_INFO("net %s is not capturable, run without cuda graph", name_.c_str());
+    cuda_graph_enabled_ = false;
+  }
+  // The events recorded in the capture are not waitable.
+  for (auto& op : operators_) {
+    op->ResetEvent();
+  }
+  operators_.back()->RecordEvent();
+  return true;
+}
+
+bool SimpleNet::CaptureCudaGraph(CudaGraph* cuda_graph) {
+  int device_id = operators_.back()->device_option().device_id();
+  CUDADeviceGuard guard(device_id);
+  cudaStream_t stream = CUDAContext::cuda_stream(device_id, 0);
+  if (cudaStreamBeginCapture(stream, cudaStreamCaptureModeThreadLocal) != cudaSuccess) {
+    cudaGetLastError();
+    return false;
+  }
+  bool captured = true;
+  try {
+    for (auto& op : operators_) {
+      op->ResetEvent();
+      if (!op->Run()) {
+        captured = false;
+        break;
+      }
+    }
+  } catch (std::exception& e) {
+    LOG_DEBUG("capture failed, msg=%s", e.what());
+    captured = false;
+  }
+  cudaGraph_t graph = nullptr;
+  cudaError_t error = cudaStreamEndCapture(stream, &graph);
+  if (captured && error == cudaSuccess) {
+    error = cudaGraphInstantiate(&cuda_graph->exec, graph, nullptr, nullptr, 0);
+  }
+  if (graph) cudaGraphDestroy(graph);
+  if (!captured || error != cudaSuccess) {
+    // Clear the capture error
+    cudaGetLastError();
+    cuda_graph->exec = nullptr;
+    return false;
+  }
+
+  BlobData(&cuda_graph->data);
+  for (auto blob : blobs_) {
+    cuda_graph->shapes.push_back(blob->shape());
+  }
+  return true;
+}
+
+void SimpleNet::BlobData(std::vector<const void*>* data) {
+  data->clear();
+  for (auto blob : blobs_) {
+    data->push_back(blob->data());
+  }
+}
+
+void SimpleNet::ReleaseCudaGraph(CudaGraph* cuda_graph) {
+  if (cuda_graph->exec) {
+    cudaGraphExecDestroy(cuda_graph->exec);
+    cuda_graph->exec = nullptr;
+  }
+}
+#endif
+
 REGISTER_NET(simple, SimpleNet);
 
 }  // namespace blaze
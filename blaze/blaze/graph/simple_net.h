@@ -4,13 +4,24 @@
  */
 #pragma once
 
+#include <map>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
 #include "blaze/graph/net.h"
 
+#if defined(USE_CUDA) && CUDART_VERSION >= 10010
+// The stream capture of cuda graphs needs cuda 10.1
+#define USE_CUDA_GRAPH
+#endif
+
 namespace blaze {
 
 class SimpleNet : public Net {
  public:
   SimpleNet(const std::shared_ptr<const NetDef>& net_def, Workspace* ws);
+  ~SimpleNet() noexcept override;
 
   std::vector<OperatorBase*> GetOperators() override {
     std::vector<OperatorBase*> op_list;
@@ -20,8 +31,43 @@ class SimpleNet : public Net {
     return op_list;
   }
 
+  // Mark the ops computed from the common blobs only, which are skipped by
+  // set_common_reused, and add their outputs to common
+  void MarkCommonOps(std::unordered_set<std::string>* common);
+
  protected:
   bool RunImpl() override; 
+  // Run the operators one by one.
+  bool RunOperators();
+
+  // Whether the op of each index is computed from the common blobs only
+  std::vector<bool> common_op_;
+
+#ifdef USE_CUDA_GRAPH
+  // The cuda graph captured for the shapes of the inputs, it is replayed
+  // while the blobs keep their data.
+  struct CudaGraph {
+    cudaGraphExec_t exec = nullptr;
+    std::vector<const void*> data;
+    std::vector<std::vector<TIndex>> shapes;
+  };
+
+  // Replay the cuda graph of the input shapes, which is captured after an
+  // eager run of the shapes.
+  bool RunCudaGraph();
+  // Capture the operators of the net into cuda_graph, false if they are not
+  // capturable, e.g. synchronize with the host.
+  bool CaptureCudaGraph(CudaGraph* cuda_graph);
+  // The data of the blobs of the net.
+  void BlobData(std::vector<const void*>* data);
+  void ReleaseCudaGraph(CudaGraph* cuda_graph);
+
+  // Set by the cuda_graph argument of the net, for nets whose operators are
+  // all on the gpu.
+  bool cuda_graph_enabled_ = false;
+  std::vector<Blob*> blobs_;
+  std::map<std::vector<std::vector<TIndex>>, CudaGraph> cuda_graphs_;
+#endif
 
   DISABLE_COPY_AND_ASSIGN(SimpleNet);
 };
@@ -0,0 +1,440 @@
+/*
+ * \file cost_placement.cc
+ * \brief The cost driven placement of the ops across cpu and gpu
+ */
+#include "blaze/graph/transform/cost_placement.h"
+
+#include <algorithm>
+#include <queue>
+#include <sstream>
+#include <unordered_set>
+
+#include "blaze/common/log.h"
+#include "blaze/common/proto_helper.h"
+
+using std::string;
+using std::vector;
+
+namespace blaze {
+
+namespace {
+
+const double kInfinity = 1e18;
+
+const char* kBatchSize = "placement_batch_size";
+const char* kBandwidth = "placement_bandwidth_mbps";
+const char* kLatency = "placement_latency_micros";
+const char* kCPUMicros = "placement_cpu_micros";
+const char* kGPUMicros = "placement_gpu_micros";
+const char* kInputBytes = "placement_input_bytes";
+const char* kOutputBytes = "placement_output_bytes";
+
+// The max flow of the op graph, Dinic's algorithm
+class MinCut {
+ public:
+  explicit MinCut(int node_num) : graph_(node_num), level_(node_num), iter_(node_num) { }
+
+  void AddEdge(int from, int to, double capacity) {
+    graph_[from].push_back(edges_.size());
+    edges_.push_back({ to, capacity });
+    graph_[to].push_back(edges_.size());
+    edges_.push_back({ from, 0 });
+  }
+
+  double MaxFlow(int s, int t) {
+    double flow = 0;
+    while (Bfs(s, t)) {
+      std::fill(iter_.begin(), iter_.end(), 0);
+      double f;
+      while ((f = Dfs(s, t, kInfinity)) > 0) flow += f;
+    }
+    return flow;
+  }
+
+  // The nodes reachable from s in the residual graph
+  vector<bool> SourceSide(int s) {
+    Bfs(s, -1);
+    vector<bool> side(graph_.size());
+    for (size_t i = 0; i < graph_.size(); ++i) side[i] = level_[i] >= 0;
+    return side;
+  }
+
+ protected:
+  struct Edge {
+    int to;
+    double capacity;
+  };
+
+  bool Bfs(int s, int t) {
+    std::fill(level_.begin(), level_.end(), -1);
+    std::queue<int> queue;
+    level_[s] = 0;
+    queue.push(s);
+    while (!queue.empty()) {
+      int v = queue.front();
+      queue.pop();
+      for (int e : graph_[v]) {
+        if (edges_[e].capacity > 0 && level_[edges_[e].to] < 0) {
+          level_[edges_[e].to] = level_[v] + 1;
+          queue.push(edges_[e].to);
+        }
+      }
+    }
+    return t >= 0 && level_[t] >= 0;
+  }
+
+  double Dfs(int v, int t, double f) {
+    if (v == t) return f;
+    for (int& i = iter_[v]; i < static_cast<int>(graph_[v].size()); ++i) {
+      Edge& edge = edges_[graph_[v][i]];
+      if (edge.capacity <= 0 || level_[v] >= level_[edge.to]) continue;
+      double d = Dfs(edge.to, t, std::min(f, edge.capacity));
+      if (d > 0) {
+        edge.capacity -= d;
+        edges_[graph_[v][i] ^ 1].capacity += d;
+        return d;
+      }
+    }
+    return 0;
+  }
+
+  vector<Edge> edges_;
+  vector<vector<int>> graph_;
+  vector<int> level_;
+  vector<int> iter_;
+};
+
+// The suffix of the blobs moved to device
+string DeviceSuffix(const DeviceOption& device_option) {
+  if (device_option.device_type() == kCPU) return "_cpu";
+  return "_cuda" + std::to_string(device_option.device_id());
+}
+
+bool SameDevice(const DeviceOption& a, const DeviceOption& b) {
+  return a.device_type() == b.device_type() && a.device_id() == b.device_id();
+}
+
+template <typename T>
+T Value(const vector<T>& values, size_t bucket, T default_value) {
+  return bucket < values.size() ? values[bucket] : default_value;
+}
+
+template <typename T>
+void Resize(vector<T>* values, size_t size, size_t insert_idx, bool insert, T default_value) {
+  values->resize(size, default_value);
+  if (insert) values->insert(values->begin() + insert_idx, default_value);
+}
+
+void SetNetArgument(NetDef* net_def, const string& name, const vector<int>& values) {
+  Argument* arg = nullptr;
+  for (auto& item : *(net_def->mutable_arg())) {
+    if (item.name() == name) arg = &item;
+  }
+  if (arg == nullptr) {
+    arg = net_def->add_arg();
+    arg->set_name(name);
+  }
+  arg->clear_ints();
+  for (const auto& value : values) arg->add_ints(value);
+}
+
+}  // namespace
+
+CostPlacement::CostPlacement(const NetDef& net_def) : net_def_(net_def) {
+  cpu_device_.set_device_type(kCPU);
+  cpu_device_.set_device_id(0);
+  // the moved ops run with the cpu ops of the net, such as on its numa node
+  for (const auto& op : net_def_.op()) {
+    if (op.has_device_option() && op.device_option().device_type() == kCPU) {
+      cpu_device_ = op.device_option();
+      break;
+    }
+  }
+  batch_size_ = ArgumentHelper::GetRepeatedArgument<NetDef, int>(net_def_, kBatchSize);
+  bandwidth_mbps_ = ArgumentHelper::GetSingleArgument<NetDef, float>(net_def_, kBandwidth, 6000);
+  latency_micros_ = ArgumentHelper::GetSingleArgument<NetDef, float>(net_def_, kLatency, 10);
+
+  // The inputs are created on the device of their first consumer
+  for (const auto& input : net_def_.external_input()) {
+    input_device_[input.name()] = net_def_.device_option();
+  }
+  std::unordered_set<string> consumed;
+  for (int i = 0; i < net_def_.op_size(); ++i) {
+    for (const auto& name : net_def_.op(i).input()) {
+      const auto& iter = input_device_.find(name);
+      if (iter == input_device_.end() || consumed.count(name)) continue;
+      iter->second = OpDevice(i);
+      consumed.insert(name);
+    }
+  }
+}
+
+size_t CostPlacement::Bucket(size_t batch_size) const {
+  for (size_t i = 0; i < batch_size_.size(); ++i) {
+    if (batch_size <= static_cast<size_t>(batch_size_[i])) return i;
+  }
+  return batch_size_.empty() ? 0 : batch_size_.size() - 1;
+}
+
+float CostPlacement::OpMicros(int op_idx, const char* name, size_t bucket) const {
+  return Value(ArgumentHelper::GetRepeatedArgument<OperatorDef, float>(net_def_.op(op_idx), name),
+               bucket, -1.0f);
+}
+
+double CostPlacement::TransferMicros(int64_t bytes) const {
+  if (bytes <= 0) return latency_micros_;
+  return latency_micros_ + bytes / bandwidth_mbps_;
+}
+
+const DeviceOption& CostPlacement::OpDevice(int op_idx) const {
+  const OperatorDef& op = net_def_.op(op_idx);
+  return op.has_device_option() ? op.device_option() : net_def_.device_option();
+}
+
+vector<bool> CostPlacement::Cut(size_t bucket) const {
+  const int n = net_def_.op_size();
+  vector<bool> on_cpu(n);
+  for (int i = 0; i < n; ++i) on_cpu[i] = OpDevice(i).device_type() == kCPU;
+
+  std::unordered_set<string> external_output;
+  for (const auto& output : net_def_.external_output()) {
+    external_output.insert(output.name());
+  }
+  // The op i is node i, and the copy of its outputs node n + i. The cpu ops
+  // are the source side of the cut.
+  const int s = 2 * n, t = 2 * n + 1;
+  MinCut cut(2 * n + 2);
+  std::unordered_map<string, int> producer;
+  for (int i = 0; i < n; ++i) {
+    const OperatorDef& op = net_def_.op(i);
+    if (op.type() == "ConstantFill") continue;
+    float cpu_micros = OpMicros(i, kCPUMicros, bucket);
+    float gpu_micros = OpMicros(i, kGPUMicros, bucket);
+    bool pinned = cpu_micros < 0 || gpu_micros < 0;
+    for (const auto& name : op.output()) {
+      if (external_output.count(name)) pinned = true;
+    }
+    for (const auto& name : op.input()) {
+      const auto& iter = input_device_.find(name);
+      if (!producer.count(name) && iter != input_device_.end() &&
+          iter->second.device_type() != kCPU) pinned = true;
+    }
+    if (pinned) {
+      if (on_cpu[i]) {
+        cut.AddEdge(s, i, kInfinity);
+      } else {
+        cut.AddEdge(i, t, kInfinity);
+      }
+    } else {
+      // the inputs of the net fed on cpu are copied for the gpu ops
+      int64_t input_bytes = Value(ArgumentHelper::GetRepeatedArgument<OperatorDef, int64_t>(
+          op, kInputBytes), bucket, static_cast<int64_t>(0));
+      double input_micros = input_bytes > 0 ? TransferMicros(input_bytes) : 0;
+      cut.AddEdge(s, i, gpu_micros + input_micros);
+      cut.AddEdge(i, t, cpu_micros);
+    }
+    int64_t output_bytes = Value(ArgumentHelper::GetRepeatedArgument<OperatorDef, int64_t>(
+        op, kOutputBytes), bucket, static_cast<int64_t>(0));
+    cut.AddEdge(i, n + i, TransferMicros(output_bytes));
+    for (const auto& name : op.input()) {
+      const auto& iter = producer.find(name);
+      if (iter == producer.end()) continue;
+      // a cpu op can not consume a gpu blob
+      cut.AddEdge(i, iter->second, kInfinity);
+      // a gpu op consuming a cpu blob pays the copy of its producer once
+      cut.AddEdge(n + iter->second, i, kInfinity);
+    }
+    for (const auto& name : op.output()) producer[name] = i;
+  }
+
+  double micros = cut.MaxFlow(s, t);
+  if (micros >= kInfinity / 2) {
+    LOG_ERROR("placement of bucket %u is infeasible, keep the devices", bucket);
+    return on_cpu;
+  }
+  vector<bool> side = cut.SourceSide(s);
+  for (int i = 0; i < n; ++i) {
+    if (net_def_.op(i).type() != "ConstantFill") on_cpu[i] = side[i];
+  }
+  LOG_DEBUG("placement of bucket %u, estimated micros=%f", bucket, micros);
+  return on_cpu;
+}
+
+NetDef CostPlacement::Place(size_t bucket) const {
+  if (net_def_.device_option().device_type() != kCUDA || bucket >= batch_size_.size()) {
+    return net_def_;
+  }
+  const int n = net_def_.op_size();
+  vector<bool> on_cpu = Cut(bucket);
+  vector<DeviceOption> device(n);
+  std::unordered_map<string, int> constant;
+  for (int i = 0; i < n; ++i) {
+    const DeviceOption& origin = OpDevice(i);
+    if (on_cpu[i] == (origin.device_type() == kCPU)) {
+      device[i] = origin;
+    } else {
+      device[i] = on_cpu[i] ? cpu_device_ : net_def_.device_option();
+    }
+    if (net_def_.op(i).type() == "ConstantFill") {
+      for (const auto& name : net_def_.op(i).output()) constant[name] = i;
+    }
+  }
+
+  // The constants are cloned to the other devices of their consumers
+  std::unordered_set<string> external_output;
+  for (const auto& output : net_def_.external_output()) {
+    external_output.insert(output.name());
+  }
+  vector<vector<DeviceOption>> clone(n);
+  vector<bool> keep(n, true);
+  for (int i = 0; i < n; ++i) {
+    if (net_def_.op(i).type() != "ConstantFill") continue;
+    bool used = false, external = false;
+    for (const auto& name : net_def_.op(i).output()) {
+      if (external_output.count(name)) external = true;
+    }
+    for (int u = 0; u < n; ++u) {
+      for (const auto& name : net_def_.op(u).input()) {
+        const auto& iter = constant.find(name);
+        if (iter == constant.end() || iter->second != i) continue;
+        if (SameDevice(device[u], device[i])) {
+          used = true;
+        } else if (std::find_if(clone[i].begin(), clone[i].end(), [&](const DeviceOption& d) {
+              return SameDevice(d, device[u]); }) == clone[i].end()) {
+          clone[i].push_back(device[u]);
+        }
+      }
+    }
+    keep[i] = used || external || clone[i].empty();
+  }
+
+  NetDef ret = net_def_;
+  ret.clear_op();
+  std::unordered_map<string, string> rename;
+  std::unordered_set<string> bridged;
+  size_t moved_num = 0;
+  for (int i = 0; i < n; ++i) {
+    const OperatorDef& op = net_def_.op(i);
+    if (op.type() == "ConstantFill") {
+      if (keep[i]) *ret.add_op() = op;
+      for (const auto& device_option : clone[i]) {
+        OperatorDef* cloned = ret.add_op();
+        *cloned = op;
+        cloned->set_name(op.name() + DeviceSuffix(device_option));
+        *(cloned->mutable_device_option()) = device_option;
+        for (int k = 0; k < op.output_size(); ++k) {
+          cloned->set_output(k, op.output(k) + DeviceSuffix(device_option));
+        }
+      }
+      continue;
+    }
+
+    OperatorDef placed = op;
+    for (int k = 0; k < op.input_size(); ++k) {
+      const string& name = op.input(k);
+      const auto& constant_iter = constant.find(name);
+      const auto& input_iter = input_device_.find(name);
+      if (constant_iter != constant.end()) {
+        if (!SameDevice(device[constant_iter->second], device[i])) {
+          placed.set_input(k, name + DeviceSuffix(device[i]));
+        }
+      } else if (rename.count(name)) {
+        placed.set_input(k, rename[name]);
+      } else if (input_iter != input_device_.end() && input_iter->second.device_type() == kCPU &&
+                 device[i].device_type() != kCPU) {
+        // the gpu op of a net input fed on cpu
+        if (!bridged.count(name)) {
+          OperatorDef* bridge = ret.add_op();
+          bridge->set_name("bridge_" + name);
+          bridge->set_type("Bridge");
+          bridge->mutable_device_option()->set_device_type(device[i].device_type());
+          bridge->mutable_device_option()->set_device_id(device[i].device_id());
+          bridge->mutable_device_option()->set_is_pipe(true);
+          bridge->add_input(name);
+          bridge->add_output(name + "_bridge");
+          bridged.insert(name);
+        }
+        placed.set_input(k, name + "_bridge");
+      }
+    }
+    bool moved = !SameDevice(device[i], OpDevice(i));
+    if (moved) {
+      *(placed.mutable_device_option()) = device[i];
+      ++moved_num;
+    }
+    for (int k = 0; k < op.output_size(); ++k) {
+      const string& name = op.output(k);
+      if (moved && !external_output.count(name)) {
+        rename[name] = name + DeviceSuffix(device[i]);
+        placed.set_output(k, rename[name]);
+      } else {
+        rename.erase(name);
+      }
+    }
+    *ret.add_op() = placed;
+  }
+  LOG_DEBUG("placement of bucket %u, %u ops moved", bucket, moved_num);
+  return ret;
+}
+
+void CostPlacement::AddProfile(const std::string& profile, size_t batch_size, NetDef* net_def) {
+  // name device_type micros input_bytes output_bytes per line
+  struct Record {
+    int device_type;
+    float micros;
+    int64_t input_bytes;
+    int64_t output_bytes;
+  };
+  std::unordered_map<string, Record> records;
+  std::istringstream is(profile);
+  string line;
+  while (std::getline(is, line)) {
+    std::istringstream ls(line);
+    string name;
+    Record record;
+    if (ls >> name >> record.device_type >> record.micros >>
+        record.input_bytes >> record.output_bytes) {
+      records[name] = record;
+    }
+  }
+
+  vector<int> batch = ArgumentHelper::GetRepeatedArgument<NetDef, int>(*net_def, kBatchSize);
+  const size_t bucket_num = batch.size();
+  auto iter = std::lower_bound(batch.begin(), batch.end(), static_cast<int>(batch_size));
+  const size_t idx = iter - batch.begin();
+  const bool insert = iter == batch.end() || *iter != static_cast<int>(batch_size);
+  if (insert) {
+    batch.insert(iter, static_cast<int>(batch_size));
+    SetNetArgument(net_def, kBatchSize, batch);
+  }
+
+  for (auto& op : *(net_def->mutable_op())) {
+    if (op.type() == "ConstantFill") continue;
+    vector<float> cpu_micros = ArgumentHelper::GetRepeatedArgument<OperatorDef, float>(op, kCPUMicros);
+    vector<float> gpu_micros = ArgumentHelper::GetRepeatedArgument<OperatorDef, float>(op, kGPUMicros);
+    vector<int64_t> input_bytes = ArgumentHelper::GetRepeatedArgument<OperatorDef, int64_t>(op, kInputBytes);
+    vector<int64_t> output_bytes = ArgumentHelper::GetRepeatedArgument<OperatorDef, int64_t>(op, kOutputBytes);
+    Resize(&cpu_micros, bucket_num, idx, insert, -1.0f);
+    Resize(&gpu_micros, bucket_num, idx, insert, -1.0f);
+    Resize(&input_bytes, bucket_num, idx, insert, static_cast<int64_t>(0));
+    Resize(&output_bytes, bucket_num, idx, insert, static_cast<int64_t>(0));
+
+    const auto& record_iter = records.find(op.name());
+    if (record_iter != records.end()) {
+      const Record& record = record_iter->second;
+      if (record.device_type == kCPU) {
+        cpu_micros[idx] = record.micros;
+      } else {
+        gpu_micros[idx] = record.micros;
+      }
+      input_bytes[idx] = record.input_bytes;
+      output_bytes[idx] = record.output_bytes;
+    }
+    ArgumentHelper::SetRepeatedArgument<float>(op, kCPUMicros, cpu_micros);
+    ArgumentHelper::SetRepeatedArgument<float>(op, kGPUMicros, gpu_micros);
+    ArgumentHelper::SetRepeatedArgument<int64_t>(op, kInputBytes, input_bytes);
+    ArgumentHelper::SetRepeatedArgument<int64_t>(op, kOutputBytes, output_bytes);
+  }
+}
+
+}  // namespace blaze
@@ -0,0 +1,75 @@
+/*
+ * \file cost_placement.h
+ * \brief The cost driven placement of the ops across cpu and gpu
+ */
+#ifndef BLAZE_BLAZE_GRAPH_TRANSFORM_COST_PLACEMENT_
+#define BLAZE_BLAZE_GRAPH_TRANSFORM_COST_PLACEMENT_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "blaze/proto/blaze.pb.h"
+
+namespace blaze {
+
+// Places the ops of a gpu net on cpu or on the gpu of the net for each
+// profiled batch bucket, minimizing the measured op latency plus the copies
+// of the blobs crossing to the gpu. The bridges only copy from cpu to gpu, so
+// the cpu ops are closed under their producers, which makes the placement a
+// minimum cut of the op graph.
+//
+// The profile is stored with the model as arguments:
+//   NetDef      placement_batch_size    ints, the ascending bucket bounds
+//   NetDef      placement_bandwidth_mbps float, the copy bandwidth
+//   NetDef      placement_latency_micros float, the latency of a copy
+//   OperatorDef placement_cpu_micros    floats per bucket, <0 if unmeasured
+//   OperatorDef placement_gpu_micros    floats per bucket, <0 if unmeasured
+//   OperatorDef placement_input_bytes   ints per bucket, of the net inputs
+//   OperatorDef placement_output_bytes  ints per bucket
+// The ops unmeasured on a device, the producers of the net outputs and the
+// consumers of the inputs fed on gpu keep their device.
+class CostPlacement {
+ public:
+  explicit CostPlacement(const NetDef& net_def);
+
+  // The number of profiled buckets, 0 if the net is not profiled
+  size_t bucket_num() const { return batch_size_.size(); }
+  // The bucket of batch_size, the last one if larger than all the bounds
+  size_t Bucket(size_t batch_size) const;
+
+  // The net placed for the bucket. The moved ops write to the blobs renamed
+  // with their device, and the constants are cloned to the devices of their
+  // consumers, so a blob name keeps one device across the buckets.
+  NetDef Place(size_t bucket) const;
+
+  // The devices the net inputs are fed on, which all the buckets share
+  const std::unordered_map<std::string, DeviceOption>& input_device() const {
+    return input_device_;
+  }
+
+  // Add the dump of the placement observer of a run of batch_size to the
+  // profile of net_def
+  static void AddProfile(const std::string& profile, size_t batch_size, NetDef* net_def);
+
+ protected:
+  // The cost of op_idx on the device of the bucket, <0 if unmeasured
+  float OpMicros(int op_idx, const char* name, size_t bucket) const;
+  // The copy micros of bytes
+  double TransferMicros(int64_t bytes) const;
+  // The device of op_idx in the net
+  const DeviceOption& OpDevice(int op_idx) const;
+  // Whether op_idx is placed on cpu for the bucket
+  std::vector<bool> Cut(size_t bucket) const;
+
+  NetDef net_def_;
+  DeviceOption cpu_device_;
+  std::vector<int> batch_size_;
+  float bandwidth_mbps_;
+  float latency_micros_;
+  std::unordered_map<std::string, DeviceOption> input_device_;
+};
+
+}  // namespace blaze
+
+#endif  // BLAZE_BLAZE_GRAPH_TRANSFORM_COST_PLACEMENT_
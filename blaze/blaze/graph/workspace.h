@@ -13,6 +13,7 @@
 #include "blaze/proto/blaze.pb.h"
 #include "blaze/store/sparse_puller.h"
 #include "blaze/common/func.h"
+#include "blaze/graph/constant_blob_pool.h"
 #include "blaze/scheduler/scheduler_manager.h"
 
 namespace blaze {
@@ -41,6 +42,20 @@ class Workspace {
     return reinterpret_cast<Blob*>(GetConstantBlob(name));
   }
 
+  // Create a constant fill blob of the data, which is shared with the
+  // identical constants of the other workspaces, fill fills a new one.
+  Blob* CreateSharedConstantBlob(const std::string& name, const DeviceOption& device_option,
+                                 DataType data_type, const std::vector<TIndex>& shape,
+                                 const void* data, size_t size,
+                                 const std::function<void(Blob*)>& fill) {
+    if (HasConstantBlob(name)) return GetConstantBlob(name);
+    std::shared_ptr<Blob> blob = ConstantBlobPool::Get()->Acquire(device_option, data_type,
+                                                                  shape, data, size, fill);
+    shared_constant_blob_map_[name] = blob;
+    constant_fill_blob_map_[name] = blob.get();
+    return blob.get();
+  }
+
   // Create or get the blob of name.
   Blob* CreateBlob(const std::string& name, const DeviceOption& device_option,
                    bool* newblob = nullptr) {
@@ -157,9 +172,11 @@ class Workspace {
     blob_map_.clear();
     // delete the graphs's total fill blob
     for (auto& item : constant_fill_blob_map_) {
-      delete item.second;
+      if (shared_constant_blob_map_.count(item.first) == 0) delete item.second;
     }
     constant_fill_blob_map_.clear();
+    // the shared ones are released to the pool
+    shared_constant_blob_map_.clear();
     // delete the previous created blobs
     for (auto& item : blob_recycle_bins_) {
       delete item;
@@ -176,6 +193,8 @@ class Workspace {
 
   // The constant fill blob map is shared by all predict threads.
   std::map<std::string, Blob*> constant_fill_blob_map_;
+  // The constant fill blobs shared with the other workspaces.
+  std::map<std::string, std::shared_ptr<Blob>> shared_constant_blob_map_;
   // Each threads has it's own blob map.
   std::map<std::string, Blob*> blob_map_;
 
@@ -0,0 +1,205 @@
+/*
+ * \file activation_kernel.cc
+ * \brief The vectorized cpu kernels of the activation and normalization ops
+ */
+#include "blaze/math/activation_kernel.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace blaze {
+
+namespace {
+
+#ifdef __AVX2__
+// exp of 8 floats, as the cephes expf, max relative error is about 2e-7.
+inline __m256 Exp256(__m256 x) {
+  const __m256 kMax = _mm256_set1_ps(88.3762626647949f);
+  const __m256 kMin = _mm256_set1_ps(-88.3762626647949f);
+  const __m256 kLog2e = _mm256_set1_ps(1.44269504088896341f);
+  const __m256 kC1 = _mm256_set1_ps(0.693359375f);
+  const __m256 kC2 = _mm256_set1_ps(-2.12194440e-4f);
+  const __m256 kHalf = _mm256_set1_ps(0.5f);
+  const __m256 kOne = _mm256_set1_ps(1.0f);
+
+  x = _mm256_max_ps(_mm256_min_ps(x, kMax), kMin);
+  // x = n * ln2 + r, |r| <= ln2 / 2
+  __m256 n = _mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(x, kLog2e), kHalf));
+  x = _mm256_sub_ps(x, _mm256_mul_ps(n, kC1));
+  x = _mm256_sub_ps(x, _mm256_mul_ps(n, kC2));
+
+  __m256 r2 = _mm256_mul_ps(x, x);
+  __m256 p = _mm256_set1_ps(1.9875691500e-4f);
+  p = _mm256_add_ps(_mm256_mul_ps(p, x), _mm256_set1_ps(1.3981999507e-3f));
+  p = _mm256_add_ps(_mm256_mul_ps(p, x), _mm256_set1_ps(8.3334519073e-3f));
+  p = _mm256_add_ps(_mm256_mul_ps(p, x), _mm256_set1_ps(4.1665795894e-2f));
+  p = _mm256_add_ps(_mm256_mul_ps(p, x), _mm256_set1_ps(1.6666665459e-1f));
+  p = _mm256_add_ps(_mm256_mul_ps(p, x), kHalf);
+  p = _mm256_add_ps(_mm256_mul_ps(p, r2), _mm256_add_ps(x, kOne));
+
+  // p * 2^n
+  __m256i e = _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(0x7f));
+  return _mm256_mul_ps(p, _mm256_castsi256_ps(_mm256_slli_epi32(e, 23)));
+}
+#endif
+
+// The scale and shift of each channel normalizing (x - mean) / std
+void NormalizeParam(const float* mean, const float* var, size_t c, bool nosqrt, float eps,
+                    std::vector<float>* scale, std::vector<float>* shift) {
+  scale->resize(c);
+  shift->resize(c);
+  for (size_t k = 0; k < c; ++k) {
+    (*scale)[k] = 1.0f / (nosqrt ? var[k] : sqrtf(var[k] + eps));
+    (*shift)[k] = -mean[k] * (*scale)[k];
+  }
+}
+
+}  // namespace
+
+void DiceKernel(const float* x, size_t size, const float* gamma, const float* mean,
+                const float* var, size_t c, bool nosqrt, float eps, float* y) {
+  std::vector<float> scale, shift;
+  NormalizeParam(mean, var, c, nosqrt, eps, &scale, &shift);
+  const float* s = scale.data();
+  const float* b = shift.data();
+  long rows = size / c;
+
+#pragma omp parallel for if (size >= kActivationParallelSize)
+  for (long row = 0; row < rows; ++row) {
+    const float* xr = x + row * c;
+    float* yr = y + row * c;
+    size_t k = 0;
+#ifdef __AVX2__
+    const __m256 kOne = _mm256_set1_ps(1.0f);
+    const __m256 kZero = _mm256_setzero_ps();
+    for (; k + 8 <= c; k += 8) {
+      __m256 xv = _mm256_loadu_ps(xr + k);
+      __m256 xn = _mm256_add_ps(_mm256_mul_ps(xv, _mm256_loadu_ps(s + k)), _mm256_loadu_ps(b + k));
+      __m256 p = _mm256_div_ps(kOne, _mm256_add_ps(kOne, Exp256(_mm256_sub_ps(kZero, xn))));
+      __m256 g = _mm256_loadu_ps(gamma + k);
+      __m256 f = _mm256_add_ps(g, _mm256_mul_ps(p, _mm256_sub_ps(kOne, g)));
+      _mm256_storeu_ps(yr + k, _mm256_mul_ps(xv, f));
+    }
+#endif
+    for (; k < c; ++k) {
+      float p = 1.0f / (1.0f + expf(-(xr[k] * s[k] + b[k])));
+      yr[k] = xr[k] * (gamma[k] + p * (1.0f - gamma[k]));
+    }
+  }
+}
+
+void PReluKernel(const float* x, size_t size, const float* w, size_t inner_size, float* y) {
+  // A shared slope is a row of all the elements.
+  std::vector<float> shared;
+  if (inner_size == 1 && size > 1) {
+    shared.assign(size, w[0]);
+    w = shared.data();
+    inner_size = size;
+  }
+  long rows = size / inner_size;
+
+#pragma omp parallel for if (size >= kActivationParallelSize)
+  for (long row = 0; row < rows; ++row) {
+    const float* xr = x + row * inner_size;
+    float* yr = y + row * inner_size;
+    size_t k = 0;
+#ifdef __AVX2__
+    const __m256 kZero = _mm256_setzero_ps();
+    for (; k + 8 <= inner_size; k += 8) {
+      __m256 xv = _mm256_loadu_ps(xr + k);
+      __m256 neg = _mm256_mul_ps(_mm256_min_ps(xv, kZero), _mm256_loadu_ps(w + k));
+      _mm256_storeu_ps(yr + k, _mm256_add_ps(_mm256_max_ps(xv, kZero), neg));
+    }
+#endif
+    for (; k < inner_size; ++k) {
+      yr[k] = xr[k] > 0 ? xr[k] : xr[k] * w[k];
+    }
+  }
+}
+
+void BatchNormalizationKernel(const float* x, size_t size, const float* gamma,
+                              const float* beta, const float* mean, const float* var,
+                              size_t c, bool nosqrt, float eps, float* y) {
+  std::vector<float> scale, shift;
+  NormalizeParam(mean, var, c, nosqrt, eps, &scale, &shift);
+  for (size_t k = 0; k < c; ++k) {
+    scale[k] *= gamma[k];
+    shift[k] = shift[k] * gamma[k] + beta[k];
+  }
+  const float* s = scale.data();
+  const float* b = shift.data();
+  long rows = size / c;
+
+#pragma omp parallel for if (size >= kActivationParallelSize)
+  for (long row = 0; row < rows; ++row) {
+    const float* xr = x + row * c;
+    float* yr = y + row * c;
+    size_t k = 0;
+#ifdef __AVX2__
+    for (; k + 8 <= c; k += 8) {
+      __m256 xv = _mm256_loadu_ps(xr + k);
+      _mm256_storeu_ps(yr + k, _mm256_add_ps(_mm256_mul_ps(xv, _mm256_loadu_ps(s + k)),
+                                             _mm256_loadu_ps(b + k)));
+    }
+#endif
+    for (; k < c; ++k) {
+      yr[k] = xr[k] * s[k] + b[k];
+    }
+  }
+}
+
+void SoftmaxKernel(const float* x, size_t n, size_t c, float* y) {
+  long rows = n;
+
+#pragma omp parallel for if (n * c >= kActivationParallelSize)
+  for (long row = 0; row < rows; ++row) {
+    const float* xr = x + row * c;
+    float* yr = y + row * c;
+    float max_value = xr[0];
+    size_t k = 0;
+#ifdef __AVX2__
+    __m256 max_v = _mm256_set1_ps(max_value);
+    for (; k + 8 <= c; k += 8) max_v = _mm256_max_ps(max_v, _mm256_loadu_ps(xr + k));
+    float lanes[8];
+    _mm256_storeu_ps(lanes, max_v);
+    for (int l = 0; l < 8; ++l) max_value = std::max(max_value, lanes[l]);
+#endif
+    for (; k < c; ++k) max_value = std::max(max_value, xr[k]);
+
+    float sum = 0;
+    k = 0;
+#ifdef __AVX2__
+    max_v = _mm256_set1_ps(max_value);
+    __m256 sum_v = _mm256_setzero_ps();
+    for (; k + 8 <= c; k += 8) {
+      __m256 e = Exp256(_mm256_sub_ps(_mm256_loadu_ps(xr + k), max_v));
+      _mm256_storeu_ps(yr + k, e);
+      sum_v = _mm256_add_ps(sum_v, e);
+    }
+    _mm256_storeu_ps(lanes, sum_v);
+    for (int l = 0; l < 8; ++l) sum += lanes[l];
+#endif
+    for (; k < c; ++k) {
+      yr[k] = expf(xr[k] - max_value);
+      sum += yr[k];
+    }
+
+    float inv_sum = 1.0f / sum;
+    k = 0;
+#ifdef __AVX2__
+    __m256 inv_v = _mm256_set1_ps(inv_sum);
+    for (; k + 8 <= c; k += 8) {
+      _mm256_storeu_ps(yr + k, _mm256_mul_ps(_mm256_loadu_ps(yr + k), inv_v));
+    }
+#endif
+    for (; k < c; ++k) yr[k] *= inv_sum;
+  }
+}
+
+}  // namespace blaze
@@ -0,0 +1,34 @@
+/*
+ * \file activation_kernel.h
+ * \brief The vectorized cpu kernels of the activation and normalization ops
+ *
+ * The kernels are one pass over each row, vectorized with AVX2 when the
+ * build enables it, and run the rows on omp threads for large inputs.
+ */
+#pragma once
+
+#include <stddef.h>
+
+namespace blaze {
+
+// The input size above which the rows run on omp threads.
+const size_t kActivationParallelSize = 1 << 16;
+
+// y = x * (p + (1 - p) * gamma), p = sigmoid((x - mean) / std), the
+// parameters are of the c channels of each row.
+void DiceKernel(const float* x, size_t size, const float* gamma, const float* mean,
+                const float* var, size_t c, bool nosqrt, float eps, float* y);
+
+// y = x > 0 ? x : x * w, w is of the inner_size channels of each row.
+void PReluKernel(const float* x, size_t size, const float* w, size_t inner_size, float* y);
+
+// y = gamma * (x - mean) / std + beta, the parameters are of the c channels
+// of each row.
+void BatchNormalizationKernel(const float* x, size_t size, const float* gamma,
+                              const float* beta, const float* mean, const float* var,
+                              size_t c, bool nosqrt, float eps, float* y);
+
+// The softmax of each row of c elements.
+void SoftmaxKernel(const float* x, size_t n, size_t c, float* y);
+
+}  // namespace blaze
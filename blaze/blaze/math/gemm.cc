@@ -4,6 +4,9 @@
  */
 #include "blaze/math/gemm.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "blaze/common/exception.h"
 #include "blaze/math/float16.h"
 
@@ -300,6 +303,75 @@ void GemmBatched<double, CPUContext>(const CBLAS_TRANSPOSE TransA,
 #endif
 }
 
+template <>
+void GemmU8S8<CPUContext>(const CBLAS_TRANSPOSE TransB,
+                          const int M,
+                          const int N,
+                          const int K,
+                          const uint8_t* A,
+                          const int8_t* B,
+                          int32_t* C,
+                          CPUContext* ctx) {
+  const int ldb = (TransB == CblasNoTrans) ? N : K;
+#ifdef USE_MKL
+  // VNNI on the hosts which have it, MKL picks the kernel.
+  const MKL_INT32 co = 0;
+  cblas_gemm_s8u8s32(CblasRowMajor, CblasNoTrans, TransB, CblasFixOffset,
+                     M, N, K, 1.0, A, K, 0, B, ldb, 0, 0.0, C, N, &co);
+#else
+  for (int m = 0; m < M; ++m) {
+    const uint8_t* a = A + m * K;
+    int32_t* c = C + m * N;
+    for (int n = 0; n < N; ++n) {
+      int32_t sum = 0;
+      if (TransB == CblasNoTrans) {
+        for (int k = 0; k < K; ++k) sum += a[k] * B[k * ldb + n];
+      } else {
+        const int8_t* b = B + n * ldb;
+        for (int k = 0; k < K; ++k) sum += a[k] * b[k];
+      }
+      c[n] = sum;
+    }
+  }
+#endif
+}
+
+template <>
+void GemmBlockSparse<CPUContext>(const int M,
+                                 const int N,
+                                 const int K,
+                                 const int block_k,
+                                 const int block_n,
+                                 const float alpha,
+                                 const float* A,
+                                 const int32_t* col_ptr,
+                                 const int32_t* row_idx,
+                                 const float* values,
+                                 const float beta,
+                                 float* C,
+                                 CPUContext* ctx) {
+  const int block_size = block_k * block_n;
+  std::vector<float> acc(block_n);
+  for (int m = 0; m < M; ++m) {
+    const float* a = A + m * K;
+    float* c = C + m * N;
+    for (int j = 0; j < N / block_n; ++j) {
+      std::fill(acc.begin(), acc.end(), 0.0f);
+      for (int b = col_ptr[j]; b < col_ptr[j + 1]; ++b) {
+        const float* x = a + row_idx[b] * block_k;
+        const float* v = values + b * block_size;
+        for (int i = 0; i < block_k; ++i) {
+          for (int l = 0; l < block_n; ++l) acc[l] += x[i] * v[i * block_n + l];
+        }
+      }
+      float* y = c + j * block_n;
+      for (int l = 0; l < block_n; ++l) {
+        y[l] = beta == 0 ? alpha * acc[l] : alpha * acc[l] + beta * y[l];
+      }
+    }
+  }
+}
+
 template <>
 void Gemv<float, CPUContext>(const CBLAS_TRANSPOSE TransA,
                              const int M,
@@ -5,6 +5,7 @@
 #include "blaze/math/gemm.h"
 
 #include "blaze/common/common_defines.h"
+#include "blaze/common/cuda_helpers.h"
 #include "blaze/common/exception.h"
 #include "blaze/math/float16.h"
 
@@ -472,6 +473,55 @@ void GemmBatched<double, CUDAContext>(const CBLAS_TRANSPOSE TransA,
 }
 
 
+// One thread per element of C, which sums the blocks of its block column
+__global__ void GemmBlockSparseKernel(const int M,
+                                      const int N,
+                                      const int K,
+                                      const int block_k,
+                                      const int block_n,
+                                      const float alpha,
+                                      const float* A,
+                                      const int32_t* col_ptr,
+                                      const int32_t* row_idx,
+                                      const float* values,
+                                      const float beta,
+                                      float* C) {
+  CUDA_KERNEL_LOOP(index, M * N) {
+    int m = index / N;
+    int n = index % N;
+    int j = n / block_n;
+    int l = n % block_n;
+    const float* a = A + m * K;
+    float sum = 0;
+    for (int b = col_ptr[j]; b < col_ptr[j + 1]; ++b) {
+      const float* x = a + row_idx[b] * block_k;
+      const float* v = values + b * block_k * block_n + l;
+      for (int i = 0; i < block_k; ++i) sum += x[i] * v[i * block_n];
+    }
+    C[index] = beta == 0 ? alpha * sum : alpha * sum + beta * C[index];
+  }
+}
+
+template <>
+void GemmBlockSparse<CUDAContext>(const int M,
+                                  const int N,
+                                  const int K,
+                                  const int block_k,
+                                  const int block_n,
+                                  const float alpha,
+                                  const float* A,
+                                  const int32_t* col_ptr,
+                                  const int32_t* row_idx,
+                                  const float* values,
+                                  const float beta,
+                                  float* C,
+                                  CUDAContext* ctx) {
+  int thread_num = GetThreadsNum(M * N);
+  int block_num = CUDA_GET_BLOCKS(M * N, thread_num);
+  GemmBlockSparseKernel<<<block_num, thread_num, 0, ctx->cuda_stream()>>>(
+      M, N, K, block_k, block_n, alpha, A, col_ptr, row_idx, values, beta, C);
+}
+
 template <>
 void Gemv<float16, CUDAContext>(const CBLAS_TRANSPOSE TransA,
                                 const int M,
@@ -78,6 +78,41 @@ void GemmBatched(const CBLAS_TRANSPOSE TransA,
                  int batch_count,
                  Context* ctx);
 
+// C = A * op(B) accumulated in int32, for the int8 inference path.
+// A: [M, K] uint8
+// B: [K, N] int8
+// C: [M, N]
+template <class Context>
+void GemmU8S8(const CBLAS_TRANSPOSE TransB,
+              const int M,
+              const int N,
+              const int K,
+              const uint8_t* A,
+              const int8_t* B,
+              int32_t* C,
+              Context* ctx);
+
+// C = alpha * A * B + beta * C, B is block sparse, see SparseGemmPass.
+// The blocks of the block column j of B are [col_ptr[j], col_ptr[j + 1]),
+// block b is the block_k x block_n row major values[b * block_k * block_n]
+// at the rows [row_idx[b] * block_k, (row_idx[b] + 1) * block_k) of B.
+// A: [M, K]
+// C: [M, N]
+template <class Context>
+void GemmBlockSparse(const int M,
+                     const int N,
+                     const int K,
+                     const int block_k,
+                     const int block_n,
+                     const float alpha,
+                     const float* A,
+                     const int32_t* col_ptr,
+                     const int32_t* row_idx,
+                     const float* values,
+                     const float beta,
+                     float* C,
+                     Context* ctx);
+
 // y = alpha * op(A) * x + beta * y
 // A: [M, N]
 template <typename T, class Context>
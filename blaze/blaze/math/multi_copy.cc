@@ -0,0 +1,30 @@
+/*
+ * \file multi_copy.cc
+ * \brief The batched copies of the slices, concats and gathers on cpu
+ */
+#include "blaze/math/multi_copy.h"
+
+#include <string.h>
+
+#include "blaze/common/context.h"
+
+namespace blaze {
+
+template <>
+void MultiCopy<CPUContext>(const CopyItem* items, size_t count, const CPUContext* context) {
+  for (size_t i = 0; i < count; ++i) {
+    const CopyItem& item = items[i];
+    for (size_t r = 0; r < item.rows; ++r) {
+      size_t k = r % item.index_num;
+      if (item.index != nullptr) {
+        k = item.index_bytes == 4 ? static_cast<const int32_t*>(item.index)[k] :
+            static_cast<const int64_t*>(item.index)[k];
+      }
+      memcpy(item.dst + r * item.dst_pitch,
+             item.src + (r / item.index_num) * item.src_outer_pitch + k * item.src_pitch,
+             item.row_bytes);
+    }
+  }
+}
+
+}  // namespace blaze
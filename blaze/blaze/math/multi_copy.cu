@@ -0,0 +1,76 @@
+/*
+ * \file multi_copy.cu
+ * \brief The batched copies of the slices, concats and gathers on cuda
+ */
+#include "blaze/math/multi_copy.h"
+
+#include <algorithm>
+
+#include "blaze/common/common_defines.h"
+#include "blaze/common/context.h"
+#include "blaze/common/cuda_helpers.h"
+
+namespace blaze {
+
+struct MultiCopyParam {
+  CopyItem items[kMaxCopyItems];
+  // the bytes each thread copies at once
+  int vec_bytes[kMaxCopyItems];
+};
+
+template <typename VType>
+__device__ __inline__ void CopyRows(const CopyItem& item) {
+  size_t row_vecs = item.row_bytes / sizeof(VType);
+  CUDA_KERNEL_LOOP(index, row_vecs * item.rows) {
+    size_t r = index / row_vecs;
+    size_t c = index % row_vecs;
+    size_t k = r % item.index_num;
+    if (item.index != nullptr) {
+      k = item.index_bytes == 4 ? static_cast<const int32_t*>(item.index)[k] :
+          static_cast<const int64_t*>(item.index)[k];
+    }
+    const VType* src = reinterpret_cast<const VType*>(
+        item.src + (r / item.index_num) * item.src_outer_pitch + k * item.src_pitch);
+    VType* dst = reinterpret_cast<VType*>(item.dst + r * item.dst_pitch);
+    dst[c] = src[c];
+  }
+}
+
+// blockIdx.y is the copy item
+__global__ void MultiCopyKernel(MultiCopyParam param) {
+  const CopyItem& item = param.items[blockIdx.y];
+  switch (param.vec_bytes[blockIdx.y]) {
+    case 16: CopyRows<uint4>(item); break;
+    case 8: CopyRows<uint2>(item); break;
+    case 4: CopyRows<uint32_t>(item); break;
+    case 2: CopyRows<uint16_t>(item); break;
+    default: CopyRows<uint8_t>(item); break;
+  }
+}
+
+template <>
+void MultiCopy<CUDAContext>(const CopyItem* items, size_t count, const CUDAContext* context) {
+  cudaStream_t stream = context->cuda_stream();
+  for (size_t offset = 0; offset < count; offset += kMaxCopyItems) {
+    size_t num = std::min<size_t>(count - offset, kMaxCopyItems);
+    MultiCopyParam param;
+    size_t max_vecs = 0;
+    for (size_t i = 0; i < num; ++i) {
+      const CopyItem& item = items[offset + i];
+      param.items[i] = item;
+      uintptr_t bits = reinterpret_cast<uintptr_t>(item.src) |
+          reinterpret_cast<uintptr_t>(item.dst) | item.src_pitch | item.src_outer_pitch |
+          item.dst_pitch | item.row_bytes;
+      int vec_bytes = 16;
+      while (vec_bytes > 1 && bits % vec_bytes != 0) vec_bytes /= 2;
+      param.vec_bytes[i] = vec_bytes;
+      max_vecs = std::max(max_vecs, item.row_bytes / vec_bytes * item.rows);
+    }
+    if (max_vecs == 0) continue;
+    // the blocks of an item are bounded, each thread copies several vectors
+    dim3 grid(GetBlockNum(CUDA_GET_BLOCKS(max_vecs, CUDA_NUM_THREADS), 4), num);
+    MultiCopyKernel<<<grid, CUDA_NUM_THREADS, 0, stream>>>(param);
+  }
+}
+
+}  // namespace blaze
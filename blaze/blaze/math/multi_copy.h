@@ -0,0 +1,51 @@
+/*
+ * \file multi_copy.h
+ * \brief The batched copies of the slices, concats and gathers
+ */
+#ifndef BLAZE_MATH_MULTI_COPY_H_
+#define BLAZE_MATH_MULTI_COPY_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace blaze {
+
+// The copies of a MultiCopy launch
+const int kMaxCopyItems = 32;
+
+// The copy of rows of row_bytes between strided buffers, which covers a
+// slice, a concat input and a gather. The row r of dst is at r * dst_pitch,
+// and of src at (r / index_num) * src_outer_pitch + i * src_pitch, where i is
+// index[r % index_num] if index, else r % index_num.
+struct CopyItem {
+  const char* src;
+  size_t src_pitch;
+  size_t src_outer_pitch;
+  char* dst;
+  size_t dst_pitch;
+  size_t row_bytes;
+  size_t rows;
+  // the row indices of a gather on the device of the copy, int32 if
+  // index_bytes is 4 else int64, or nullptr
+  const void* index;
+  int index_bytes;
+  size_t index_num;
+
+  CopyItem() : src(nullptr), src_pitch(0), src_outer_pitch(0), dst(nullptr), dst_pitch(0),
+      row_bytes(0), rows(0), index(nullptr), index_bytes(0), index_num(1) { }
+  // The contiguous rows copy
+  CopyItem(const void* src, size_t src_pitch, void* dst, size_t dst_pitch,
+           size_t row_bytes, size_t rows) :
+      src(static_cast<const char*>(src)), src_pitch(src_pitch), src_outer_pitch(0),
+      dst(static_cast<char*>(dst)), dst_pitch(dst_pitch), row_bytes(row_bytes), rows(rows),
+      index(nullptr), index_bytes(0), index_num(rows) { }
+};
+
+// Run the copies of count items, kMaxCopyItems a launch on gpu, whose rows
+// are copied by 16, 8 or 4 bytes when the addresses and pitches are aligned.
+template <class Context>
+void MultiCopy(const CopyItem* items, size_t count, const Context* context);
+
+}  // namespace blaze
+
+#endif  // BLAZE_MATH_MULTI_COPY_H_
@@ -6,13 +6,36 @@
 
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <vector>
+
 #include "blaze/common/log.h"
 #include "blaze/common/common_defines.h"
+#include "blaze/common/thread_pool.h"
 
 namespace blaze {
 
 ModelImporter::ModelImporter() : data_type_(kFloat) {
   net_def_.set_version(BLAZE_VERSION_MAJOR * 1000 + BLAZE_VERSION_MINOR);
+  thread_num_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ModelImporter::ParallelFor(size_t n, const std::function<void(size_t)>& func) {
+  if (thread_num_ <= 1 || n <= 1) {
+    for (size_t i = 0; i < n; ++i) func(i);
+    return;
+  }
+  std::vector<std::future<void>> results;
+  {
+    ThreadExecutor thread_executor(std::min(static_cast<size_t>(thread_num_), n));
+    for (size_t i = 0; i < n; ++i) {
+      results.emplace_back(thread_executor.commit(func, i));
+    }
+    thread_executor.shutdown();
+  }
+  for (auto& result : results) result.get();
 }
 
 bool ModelImporter::SaveToTextFile(const char* blaze_model_file) {
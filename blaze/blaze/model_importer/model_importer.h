@@ -45,9 +45,19 @@ class ModelImporter {
     else return weight_type_;
   }
 
+  // The threads converting the weights, must set before LoadModel interface.
+  void set_thread_num(int thread_num) { thread_num_ = thread_num > 0 ? thread_num : 1; }
+  int thread_num() const { return thread_num_; }
+
   const NetDef& net_def() const { return net_def_; }
+  // The imported net may be swapped out to avoid a copy of the weights
+  NetDef* mutable_net_def() { return &net_def_; }
 
  protected:
+  // Run func(0) ... func(n - 1) on the threads of thread_num, the first
+  // exception is rethrown after all are done.
+  void ParallelFor(size_t n, const std::function<void(size_t)>& func);
+
   bool ReadFileContent(const char* filename, std::string* content);
   bool SaveFileContent(const char* filename, const std::string& content);
   std::string GetParentPath(const std::string& path);
@@ -55,6 +65,7 @@ class ModelImporter {
   std::unordered_map<std::string, DataType> op_weight_type_; 
   DataType weight_type_ = kFloat; // The model weight type
   DataType data_type_ = kFloat; // The model calculation input/output type
+  int thread_num_; // The threads converting the weights
   
   NetDef net_def_;
 };
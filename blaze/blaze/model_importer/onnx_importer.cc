@@ -6,6 +6,8 @@
 
 #include <sys/stat.h>
 
+#include <vector>
+
 #include "blaze/common/exception.h"
 #include "blaze/common/log.h"
 #include "google/protobuf/message.h"
@@ -108,12 +110,15 @@ ONNXImporter::ONNXImporter() : ModelImporter() { }
 void ONNXImporter::LoadModel(const char* model_conf, const char* model_data) {
   bool success = false;
   
-  std::string content;
-  success = ReadFileContent(model_conf, &content);
-  CHECK_TRUE(success, "read model_conf=", model_conf, " failed");
+  {
+    // the file content is dropped once parsed
+    std::string content;
+    success = ReadFileContent(model_conf, &content);
+    CHECK_TRUE(success, "read model_conf=", model_conf, " failed");
 
-  success = onnx_model_.ParseFromArray(content.c_str(), content.length());
-  CHECK_TRUE(success, "parse onnx failed");
+    success = onnx_model_.ParseFromArray(content.c_str(), content.length());
+    CHECK_TRUE(success, "parse onnx failed");
+  }
 
   success = ONNX2Blaze();
   CHECK_TRUE("onnx2blaze failed");
@@ -127,13 +132,17 @@ bool ONNXImporter::ONNX2Blaze() {
   //net_def_.set_run_mode(run_mode_);
 
   std::unordered_set<std::string> initialized_inputs;
-  for (const auto& tp : onnx_model_.graph().initializer()) {
+  auto* initializer = onnx_model_.mutable_graph()->mutable_initializer();
+  std::vector<OperatorDef*> constant_fill_ops;
+  for (const auto& tp : *initializer) {
     initialized_inputs.emplace(tp.name());
-    if (!BuildConstantFillOp(tp)) {
-      return false;
-    }
+    constant_fill_ops.push_back(net_def_.add_op());
     LOG_DEBUG("initializer name=%s", tp.name().c_str());
   }
+  // the initializers are converted in parallel
+  ParallelFor(constant_fill_ops.size(), [&](size_t k) {
+    BuildConstantFillOp(initializer->Mutable(k), constant_fill_ops[k]);
+  });
 
   std::unordered_set<std::string> uninitialized_inputs;
   for (const auto& input : onnx_model_.graph().input()) {
@@ -166,33 +175,34 @@ bool ONNXImporter::ONNX2Blaze() {
 }
 
 template <typename T>
-bool TryConvertingTensorRawValues(const onnx::TensorProto& onnx_tensor,
+bool TryConvertingTensorRawValues(onnx::TensorProto* onnx_tensor,
                                   google::protobuf::RepeatedField<T>* field) {
-  if (!onnx_tensor.has_raw_data()) {
+  if (!onnx_tensor->has_raw_data()) {
     return false;
   }
-  size_t raw_size = onnx_tensor.raw_data().size();
+  size_t raw_size = onnx_tensor->raw_data().size();
   CHECK(raw_size % sizeof(T) == 0, "raw_size=%u sizeof(T)=%u", raw_size, sizeof(T));
 
   size_t num_elements = raw_size / sizeof(T);
-  const void* src_ptr = static_cast<const void*>(onnx_tensor.raw_data().data());
+  const void* src_ptr = static_cast<const void*>(onnx_tensor->raw_data().data());
   field->Resize(num_elements, 0);
   void* target_ptr = static_cast<void*>(field->mutable_data());
   memcpy(target_ptr, src_ptr, raw_size);
+  // release the raw values, which are not used any more
+  std::string().swap(*onnx_tensor->mutable_raw_data());
 
   return true;
 }
 
-bool ONNXImporter::BuildConstantFillOp(const onnx::TensorProto& onnx_tensor) {
-  auto* op = net_def_.add_op();
-  op->set_name(onnx_tensor.name());
-  op->add_output(onnx_tensor.name());
+void ONNXImporter::BuildConstantFillOp(onnx::TensorProto* onnx_tensor, OperatorDef* op) {
+  op->set_name(onnx_tensor->name());
+  op->add_output(onnx_tensor->name());
   op->set_type("ConstantFill");
 
   // set shape/dtype/value
   auto* shape = op->add_arg();
   shape->set_name("shape");
-  for (const auto d : onnx_tensor.dims()) {
+  for (const auto d : onnx_tensor->dims()) {
     shape->add_ints(d);
   }
   auto* dtype = op->add_arg();
@@ -200,49 +210,54 @@ bool ONNXImporter::BuildConstantFillOp(const onnx::TensorProto& onnx_tensor) {
   auto* value = op->add_arg();
   value->set_name("value");
   
-  if (onnx_tensor.data_type() == onnx::TensorProto::FLOAT) {  
+  if (onnx_tensor->data_type() == onnx::TensorProto::FLOAT) {  
     dtype->set_i(kFloat);
     auto* floats = value->mutable_floats();
     if (!TryConvertingTensorRawValues<float>(onnx_tensor, floats)) {
-      floats->CopyFrom(onnx_tensor.float_data());
+      floats->Swap(onnx_tensor->mutable_float_data());
     }
-  } else if (onnx_tensor.data_type() == onnx::TensorProto::FLOAT16) {
+  } else if (onnx_tensor->data_type() == onnx::TensorProto::FLOAT16) {
     dtype->set_i(kFloat16);
+    auto* ints = value->mutable_ints();
     ::google::protobuf::RepeatedField<::google::protobuf::int32> tmp;
     const ::google::protobuf::RepeatedField<::google::protobuf::int32>* src = &tmp;
     if (!TryConvertingTensorRawValues<::google::protobuf::int32>(onnx_tensor, &tmp)) {
-      src = &onnx_tensor.int32_data();
+      src = &onnx_tensor->int32_data();
     }
+    ints->Reserve(src->size());
     for (const auto i : *src) {
-      value->add_ints(i);
+      ints->AddAlreadyReserved(i);
     }
-  } else if (onnx_tensor.data_type() == onnx::TensorProto::DOUBLE) {
+  } else if (onnx_tensor->data_type() == onnx::TensorProto::DOUBLE) {
     dtype->set_i(kDouble);
+    auto* floats = value->mutable_floats();
     google::protobuf::RepeatedField<double> tmp;
     const ::google::protobuf::RepeatedField<double>* src = &tmp;
     if (!TryConvertingTensorRawValues<double>(onnx_tensor, &tmp)) {
-      src = &onnx_tensor.double_data();
+      src = &onnx_tensor->double_data();
     }
+    floats->Reserve(src->size());
     for (const auto i : *src) {
-      value->add_floats(i);
+      floats->AddAlreadyReserved(i);
     }
-  } else if (onnx_tensor.data_type() == onnx::TensorProto::INT32) {
+  } else if (onnx_tensor->data_type() == onnx::TensorProto::INT32) {
     dtype->set_i(kInt32);
+    auto* ints = value->mutable_ints();
     google::protobuf::RepeatedField<int32_t> tmp;
     const ::google::protobuf::RepeatedField<int32_t>* src = &tmp;
     if (!TryConvertingTensorRawValues<int32_t>(onnx_tensor, &tmp)) {
-      src = &onnx_tensor.int32_data();
+      src = &onnx_tensor->int32_data();
     }
+    ints->Reserve(src->size());
     for (const auto i : *src) {
-      value->add_ints(i);
+      ints->AddAlreadyReserved(i);
     }
   } else {
     BLAZE_THROW("Not supported data_type =",
-                onnx_tensor.data_type(),
-                " name = ", onnx_tensor.name().c_str(),
+                onnx_tensor->data_type(),
+                " name = ", onnx_tensor->name().c_str(),
                 " please upgrade onnx importer");
   }
-  return true;
 }
 
 bool ONNXImporter::ONNXNode2BlazeNode(OnnxNode* onnx_node, int index) {
@@ -43,7 +43,9 @@ class ONNXImporter : public ModelImporter {
 
  protected:
   bool ONNX2Blaze();
-  bool BuildConstantFillOp(const onnx::TensorProto& onnx_tensor);
+  // Convert the initializer into the ConstantFill op, whose raw values are
+  // released once converted
+  void BuildConstantFillOp(onnx::TensorProto* onnx_tensor, OperatorDef* op);
   bool ONNXNode2BlazeNode(OnnxNode* onnx_node, int index);
   void RewriteOpDeviceOption();
 
@@ -6,6 +6,8 @@
 
 #include <sstream>
 #include <set>
+#include <utility>
+#include <vector>
 
 #include "blaze/common/exception.h"
 #include "blaze/common/proto_configure.h"
@@ -98,14 +100,15 @@ void ULFImporter::LoadModel(const char* conf_file, const char* data_file) {
   if (rc != ProtoConfigure::kOK) {
     BLAZE_THROW("load model ulf.NetParameter from fila:", conf_file, " failed");
   }
-  net_conf_ = *(reinterpret_cast<const ulf::NetParameter*>(config.config()));
+  net_conf_.Swap(reinterpret_cast<ulf::NetParameter*>(config.mutable_config()));
 
   ProtoConfigure param;
   rc = param.Init("ulf.NetWeightsParameter", data_file);
   if (rc != ProtoConfigure::kOK) {
     BLAZE_THROW("load model ulf.NetWeightParameter from file:", data_file, " failed");
   }
-  net_param_ = *(reinterpret_cast<const ulf::NetWeightsParameter*>(param.config()));
+  // the weights are swapped rather than copied out of the parsed config
+  net_param_.Swap(reinterpret_cast<ulf::NetWeightsParameter*>(param.mutable_config()));
 
   if (!Ulf2Blaze()) {
     BLAZE_THROW("ulf2blaze failed");
@@ -132,6 +135,7 @@ void ULFImporter::InitLayerMap() {
 }
 
 bool ULFImporter::CreateConstantFillNode() {
+  std::vector<std::pair<const ulf::BlobData*, OperatorDef*>> constant_fill_ops;
   for (size_t k = 0; k < net_param_.layer_weights_params_size(); ++k) {
     const auto& name = net_param_.layer_weights_params(k).name();
     const auto& lwp = net_param_.layer_weights_params(k);
@@ -152,26 +156,30 @@ bool ULFImporter::CreateConstantFillNode() {
       op->set_name(ss.str());
       op->set_type("ConstantFill");
       op->add_output(ss.str());
-      
-      // add arguments, includes: dtype/shape/value
-      const auto& blob_data = lwp.blob_datas(z);
-      Argument* arg = op->add_arg();
-      arg->set_name("dtype");
-      arg->set_i(data_type_);
-      
-      arg = op->add_arg();
-      arg->set_name("shape");
-      for (size_t j = 0; j < blob_data.shape_size(); ++j) {
-        arg->add_ints(blob_data.shape(j));
-      }
-
-      arg = op->add_arg();
-      arg->set_name("value");
-      for (size_t j = 0; j < blob_data.data_size(); ++j) {
-        arg->add_floats(blob_data.data(j));
-      }
+      constant_fill_ops.emplace_back(&lwp.blob_datas(z), op);
     }
   }
+
+  // the weights are converted in parallel
+  ParallelFor(constant_fill_ops.size(), [&](size_t k) {
+    const auto& blob_data = *constant_fill_ops[k].first;
+    OperatorDef* op = constant_fill_ops[k].second;
+
+    // add arguments, includes: dtype/shape/value
+    Argument* arg = op->add_arg();
+    arg->set_name("dtype");
+    arg->set_i(data_type_);
+    
+    arg = op->add_arg();
+    arg->set_name("shape");
+    for (size_t j = 0; j < blob_data.shape_size(); ++j) {
+      arg->add_ints(blob_data.shape(j));
+    }
+
+    arg = op->add_arg();
+    arg->set_name("value");
+    arg->mutable_floats()->CopyFrom(blob_data.data());
+  });
   return true;
 }
 
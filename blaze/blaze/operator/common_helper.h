@@ -19,6 +19,8 @@ class CommonHelper {
 };
 
 static const std::string kAttrIsElementWise = "is_element_wise";
+// The outputs point into the data of input 0 instead of owning their own.
+static const std::string kAttrIsAliasOutput = "is_alias_output";
 
 //--- A usefull AttrMap used in OperatorSchema
 #define INSTANTIATE_SET_ATTRIBUTE(T, field_name)               \
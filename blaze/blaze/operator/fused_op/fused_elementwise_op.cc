@@ -0,0 +1,43 @@
+/*
+ * \file fused_elementwise_op.cc
+ * \brief The fused elementwise operation
+ */
+#include "blaze/operator/fused_op/fused_elementwise_op.h"
+
+namespace blaze {
+
+template <typename DType>
+void FusedElementwiseKernel(const FusedElementwiseParam<DType>& params) {
+  for (size_t i = 0; i < params.size; ++i) {
+    params.y[i] = FusedElementwiseEval(params, i);
+  }
+}
+
+template <>
+bool FusedElementwiseOp<CPUContext>::RunOnDevice() {
+  Blob* x = this->Input(0);
+
+  TYPE_SWITCH(x->data_type(), DType, {
+    FusedElementwiseParam<DType> params;
+    Setup<DType>(&params);
+    FusedElementwiseKernel(params);
+  });
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(FusedElementwise, FusedElementwiseOp<CPUContext>);
+
+// Input: X, the other operands Output: Y
+OPERATOR_SCHEMA(FusedElementwise)
+  .NumInputs(1, kMaxFusedElementwiseInputs)
+  .NumOutputs(1)
+  .IdenticalTypeOfInput(0)
+  .SetAttr<bool>(kAttrIsElementWise, true)
+  .SetDoc(R"DOC(
+FusedElementwise runs a chain of elementwise and activation ops in one pass,
+the steps are given by step_type, step_operand, step_swap and step_arg.
+  )DOC")
+  .Input(0, "X", "N-D Input tensor")
+  .Output(0, "Y", "N-D output tensor");
+
+}  // namespace blaze
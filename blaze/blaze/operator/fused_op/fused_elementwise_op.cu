@@ -0,0 +1,43 @@
+/*
+ * \file fused_elementwise_op.cu
+ * \brief The fused elementwise operation on gpu
+ */
+#include "blaze/operator/fused_op/fused_elementwise_op.h"
+
+namespace blaze {
+
+template <typename DType>
+__global__ void FusedElementwiseKernel(FusedElementwiseParam<DType> params) {
+  CUDA_KERNEL_LOOP(index, params.size) {
+    params.y[index] = FusedElementwiseEval(params, index);
+  }
+}
+
+template <>
+bool FusedElementwiseOp<CUDAContext>::RunOnDevice() {
+  Blob* x = this->Input(0);
+
+  TYPE_SWITCH_ON_CUDA(x->data_type(), DType, {
+  FusedElementwiseParam<DType> params;
+  Setup<DType>(&params);
+
+  // Lauch the kernel
+  dim3 grid, block;
+  block.x = GetThreadsNum(params.size);
+  grid.x = GetBlockNum(CUDA_GET_BLOCKS(params.size, block.x));
+
+  cudaStream_t stream = this->context_.cuda_stream();
+  void* params_dptr = reinterpret_cast<void*>(&params);
+  CUDA_CHECK(cudaLaunchKernel(reinterpret_cast<void*>(FusedElementwiseKernel<DType>),
+                              grid,
+                              block,
+                              reinterpret_cast<void**>(&params_dptr),
+                              0,
+                              stream));
+  });
+  return true;
+}
+
+REGISTER_CUDA_OPERATOR(FusedElementwise, FusedElementwiseOp<CUDAContext>);
+
+}  // namespace blaze
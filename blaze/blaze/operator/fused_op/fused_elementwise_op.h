@@ -0,0 +1,257 @@
+/*
+ * \file fused_elementwise_op.h
+ * \brief The fused elementwise op, a chain of elementwise ops in one pass
+ *
+ * Such as:
+ *
+ *     X    B
+ *     |   /
+ *     Add
+ *     |
+ *     Sigmoid   C
+ *     |        /
+ *     Mul ----
+ *
+ * The running value of each element goes through the steps in registers,
+ * the other operands are broadcast to the output.
+ */
+#pragma once
+
+#include <math.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "blaze/operator/operator.h"
+#include "blaze/operator/common_helper.h"
+#include "blaze/common/exception.h"
+#include "blaze/common/types.h"
+#include "blaze/math/elementwise/broadcast_elementwise.h"
+
+namespace blaze {
+
+enum FusedElementwiseStepType {
+  kFusedAdd = 0,
+  kFusedSub,
+  kFusedMul,
+  kFusedDiv,
+  kFusedMax,
+  kFusedMin,
+  kFusedSigmoid,
+  kFusedTanh,
+  kFusedLeakyRelu,
+  kFusedPRelu,
+  kFusedDice,
+};
+
+const int kMaxFusedElementwiseSteps = 16;
+const int kMaxFusedElementwiseInputs = 16;
+
+struct FusedElementwiseProgram {
+  int step_num;
+  int type[kMaxFusedElementwiseSteps];
+  // The inputs of the step besides the running value, binary steps use the
+  // first one, PRelu the slope, Dice gamma, mean and var.
+  int operand[kMaxFusedElementwiseSteps][3];
+  // The running value is the rhs of the binary step
+  bool swap[kMaxFusedElementwiseSteps];
+  // LeakyRelu alpha, Dice nosqrt
+  float arg[kMaxFusedElementwiseSteps];
+};
+
+template <typename DType>
+struct FusedElementwiseParam {
+  FusedElementwiseProgram program;
+  const DType* x[kMaxFusedElementwiseInputs];
+  // The input has the shape of the output
+  bool full[kMaxFusedElementwiseInputs];
+  // The strides of the inputs on the output dims, zero if broadcast
+  TIndex stride[kMaxFusedElementwiseInputs][broadcast::MAX_DIM];
+  TIndex y_shape[broadcast::MAX_DIM];
+  int ndim;
+  size_t size;
+  DType* y;
+};
+
+// The value of input k at output element i
+template <typename DType>
+BLAZE_INLINE_X float FusedElementwiseLoad(const FusedElementwiseParam<DType>& params, int k, size_t i) {
+  if (params.full[k]) return static_cast<float>(params.x[k][i]);
+  TIndex offset = 0;
+  for (int d = params.ndim - 1; d >= 0; --d) {
+    offset += (i % params.y_shape[d]) * params.stride[k][d];
+    i /= params.y_shape[d];
+  }
+  return static_cast<float>(params.x[k][offset]);
+}
+
+template <typename DType>
+BLAZE_INLINE_X DType FusedElementwiseEval(const FusedElementwiseParam<DType>& params, size_t i) {
+  const FusedElementwiseProgram& program = params.program;
+  float v = FusedElementwiseLoad(params, 0, i);
+  for (int s = 0; s < program.step_num; ++s) {
+    const int* operand = program.operand[s];
+    switch (program.type[s]) {
+      case kFusedAdd:
+        v = v + FusedElementwiseLoad(params, operand[0], i);
+        break;
+      case kFusedSub:
+        {
+          float b = FusedElementwiseLoad(params, operand[0], i);
+          v = program.swap[s] ? b - v : v - b;
+        }
+        break;
+      case kFusedMul:
+        v = v * FusedElementwiseLoad(params, operand[0], i);
+        break;
+      case kFusedDiv:
+        {
+          float b = FusedElementwiseLoad(params, operand[0], i);
+          v = program.swap[s] ? b / v : v / b;
+        }
+        break;
+      case kFusedMax:
+        {
+          float b = FusedElementwiseLoad(params, operand[0], i);
+          v = v > b ? v : b;
+        }
+        break;
+      case kFusedMin:
+        {
+          float b = FusedElementwiseLoad(params, operand[0], i);
+          v = v > b ? b : v;
+        }
+        break;
+      case kFusedSigmoid:
+        v = 1.0f / (1.0f + expf(-v));
+        break;
+      case kFusedTanh:
+        v = tanhf(v);
+        break;
+      case kFusedLeakyRelu:
+        v = v >= 0 ? v : program.arg[s] * v;
+        break;
+      case kFusedPRelu:
+        v = v > 0 ? v : v * FusedElementwiseLoad(params, operand[0], i);
+        break;
+      case kFusedDice:
+        {
+          float gamma = FusedElementwiseLoad(params, operand[0], i);
+          float mean = FusedElementwiseLoad(params, operand[1], i);
+          float var = FusedElementwiseLoad(params, operand[2], i);
+          float x_normed = (v - mean) / (program.arg[s] != 0 ? var : sqrtf(var + kDiceEpsilon));
+          float x_p = 1.0f / (1.0f + expf(-x_normed));
+          v = (1 - x_p) * gamma * v + x_p * v;
+        }
+        break;
+    }
+  }
+  return static_cast<DType>(v);
+}
+
+// The step type of the elementwise op type, -1 if not fusable
+inline int FusedElementwiseStep(const std::string& op_type) {
+  static const char* kTypes[] = {
+    "Add", "Sub", "Mul", "Div", "Max", "Min", "Sigmoid", "Tanh", "LeakyRelu", "PRelu", "Dice",
+  };
+  for (int k = 0; k < sizeof(kTypes) / sizeof(kTypes[0]); ++k) {
+    if (op_type == kTypes[k]) return k;
+  }
+  return -1;
+}
+
+// Parse the step_type, step_operand, step_swap and step_arg of the op
+inline void ParseFusedElementwiseProgram(const OperatorBase& op,
+                                         FusedElementwiseProgram* program) {
+  std::vector<std::string> types = op.GetRepeatedArgument<std::string>("step_type");
+  std::vector<int> operand = op.GetRepeatedArgument<int>("step_operand");
+  std::vector<int> swap = op.GetRepeatedArgument<int>("step_swap");
+  std::vector<float> arg = op.GetRepeatedArgument<float>("step_arg");
+  BLAZE_CONDITION_THROW(types.size() <= kMaxFusedElementwiseSteps,
+                        "types.size()=", types.size());
+  BLAZE_CONDITION_THROW(operand.size() == types.size() * 3 && swap.size() == types.size() &&
+                        arg.size() == types.size(), "def=", op.operator_def().DebugString());
+  BLAZE_CONDITION_THROW(op.InputSize() <= kMaxFusedElementwiseInputs,
+                        "op.InputSize()=", op.InputSize());
+  program->step_num = types.size();
+  for (size_t s = 0; s < types.size(); ++s) {
+    program->type[s] = FusedElementwiseStep(types[s]);
+    BLAZE_CONDITION_THROW(program->type[s] >= 0, "step_type=", types[s]);
+    for (size_t k = 0; k < 3; ++k) {
+      program->operand[s][k] = operand[s * 3 + k];
+      BLAZE_CONDITION_THROW(program->operand[s][k] < op.InputSize(),
+                            "operand=", program->operand[s][k]);
+    }
+    program->swap[s] = swap[s];
+    program->arg[s] = arg[s];
+  }
+}
+
+// Set input k of the params, whose output shape is set
+template <typename DType>
+void SetFusedElementwiseInput(FusedElementwiseParam<DType>* params, int k, Blob* x) {
+  const std::vector<TIndex>& shape = x->shape();
+  BLAZE_CONDITION_THROW(shape.size() <= params->ndim, "input ", k, " ndim=", shape.size());
+  size_t offset = params->ndim - shape.size();
+  TIndex stride = 1;
+  for (int d = params->ndim - 1; d >= 0; --d) {
+    TIndex dim = d >= static_cast<int>(offset) ? shape[d - offset] : 1;
+    BLAZE_CONDITION_THROW(dim == 1 || dim == params->y_shape[d],
+                          "input ", k, " can not be broadcast, dim=", dim);
+    params->stride[k][d] = dim == 1 ? 0 : stride;
+    stride *= dim;
+  }
+  params->full[k] = x->size() == params->size;
+  params->x[k] = x->as<DType>();
+}
+
+template <class Context>
+class FusedElementwiseOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_FUNCTIONS(Context);
+
+  FusedElementwiseOp(const OperatorDef& def, Workspace* workspace) :
+      Operator<Context>(def, workspace) {
+    ParseFusedElementwiseProgram(*this, &program_);
+  }
+
+  bool RunOnDevice() override;
+
+ protected:
+  template <typename DType>
+  void Setup(FusedElementwiseParam<DType>* params) {
+    // The output shape broadcasts all the inputs
+    size_t ndim = 0;
+    for (int k = 0; k < this->InputSize(); ++k) {
+      ndim = std::max(ndim, this->Input(k)->shape().size());
+    }
+    BLAZE_CONDITION_THROW(ndim <= broadcast::MAX_DIM, "ndim=", ndim);
+    std::vector<TIndex> y_shape(ndim, 1);
+    for (int k = 0; k < this->InputSize(); ++k) {
+      const std::vector<TIndex>& shape = this->Input(k)->shape();
+      size_t offset = ndim - shape.size();
+      for (size_t d = 0; d < shape.size(); ++d) {
+        TIndex& dim = y_shape[offset + d];
+        BLAZE_CONDITION_THROW(shape[d] == dim || shape[d] == 1 || dim == 1,
+                              "input ", k, " can not be broadcast, dim=", shape[d]);
+        if (dim == 1) dim = shape[d];
+      }
+    }
+    Blob* y = this->Output(0);
+    y->Reshape(y_shape);
+
+    params->program = program_;
+    params->ndim = ndim;
+    params->size = y->size();
+    for (size_t d = 0; d < ndim; ++d) params->y_shape[d] = y_shape[d];
+    for (int k = 0; k < this->InputSize(); ++k) {
+      SetFusedElementwiseInput(params, k, this->Input(k));
+    }
+    params->y = y->as<DType>();
+  }
+
+  FusedElementwiseProgram program_;
+};
+
+}  // namespace blaze
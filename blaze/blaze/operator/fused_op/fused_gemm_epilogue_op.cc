@@ -0,0 +1,50 @@
+/*
+ * \file fused_gemm_epilogue_op.cc
+ * \brief The gemm operation with the bias and activations as its epilogue
+ */
+#include "blaze/operator/fused_op/fused_gemm_epilogue_op.h"
+
+namespace blaze {
+
+// The output rows of a block, which stays in the cache for its epilogue.
+const size_t kGemmEpilogueBlockBytes = 256 * 1024;
+
+template <>
+bool FusedGemmEpilogueOp<CPUContext>::RunOnDevice() {
+  CheckValid();
+
+  Blob* a = this->Input(0);
+  TYPE_SWITCH(a->data_type(), DType, {
+    FusedElementwiseParam<DType> params;
+    Setup<DType>(&params);
+
+    // The rows of A must be contiguous to be split.
+    TIndex block_m = M_;
+    if (batch_ == 1 && !transa_) {
+      block_m = std::max<TIndex>(1, kGemmEpilogueBlockBytes / (N_ * sizeof(DType)));
+    }
+    for (TIndex m = 0; m < M_; m += block_m) {
+      TIndex m_end = std::min(M_, m + block_m);
+      RunGemm<DType>(m, m_end);
+      size_t end = batch_ == 1 ? m_end * N_ : params.size;
+      for (size_t i = m * N_; i < end; ++i) {
+        params.y[i] = FusedElementwiseEval(params, i);
+      }
+    }
+  });
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(FusedGemmEpilogue, FusedGemmEpilogueOp<CPUContext>);
+
+// Input: A, W, the epilogue operands Output: C
+OPERATOR_SCHEMA(FusedGemmEpilogue)
+    .NumInputs(2, kMaxFusedElementwiseInputs)
+    .NumOutputs(1)
+    .IdenticalTypeOfInput(0)
+    .SetDoc(R"DOC(
+FusedGemmEpilogue operator C=epilogue(alpha*A*B), the epilogue adds the bias
+and runs the activations given as a FusedElementwise program.
+    )DOC");
+
+}  // namespace blaze
@@ -0,0 +1,45 @@
+/*
+ * \file fused_gemm_epilogue_op.cu
+ * \brief The gemm operation with the bias and activations as its epilogue on gpu
+ */
+#include "blaze/operator/fused_op/fused_gemm_epilogue_op.h"
+
+namespace blaze {
+
+template <typename DType>
+__global__ void FusedGemmEpilogueKernel(FusedElementwiseParam<DType> params) {
+  CUDA_KERNEL_LOOP(index, params.size) {
+    params.y[index] = FusedElementwiseEval(params, index);
+  }
+}
+
+template <>
+bool FusedGemmEpilogueOp<CUDAContext>::RunOnDevice() {
+  CheckValid();
+
+  Blob* a = this->Input(0);
+  TYPE_SWITCH_ON_CUDA(a->data_type(), DType, {
+  FusedElementwiseParam<DType> params;
+  Setup<DType>(&params);
+  RunGemm<DType>(0, M_);
+
+  // Lauch the epilogue kernel on the gemm output
+  dim3 grid, block;
+  block.x = GetThreadsNum(params.size);
+  grid.x = GetBlockNum(CUDA_GET_BLOCKS(params.size, block.x));
+
+  cudaStream_t stream = this->context_.cuda_stream();
+  void* params_dptr = reinterpret_cast<void*>(&params);
+  CUDA_CHECK(cudaLaunchKernel(reinterpret_cast<void*>(FusedGemmEpilogueKernel<DType>),
+                              grid,
+                              block,
+                              reinterpret_cast<void**>(&params_dptr),
+                              0,
+                              stream));
+  });
+  return true;
+}
+
+REGISTER_CUDA_OPERATOR(FusedGemmEpilogue, FusedGemmEpilogueOp<CUDAContext>);
+
+}  // namespace blaze
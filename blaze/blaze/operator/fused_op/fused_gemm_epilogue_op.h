@@ -0,0 +1,152 @@
+/*
+ * \file fused_gemm_epilogue_op.h
+ * \brief The gemm operation with the bias and activations as its epilogue
+ *
+ *  Y = epilogue(alpha * A * B), such as:
+ *
+ *     A    W
+ *     |   /
+ *     Gemm   Bias
+ *     |      /
+ *     Add ---
+ *     |
+ *     Dice
+ *
+ *  The epilogue is a FusedElementwise program on the gemm output, which is
+ *  applied to the output rows while they are hot.
+ */
+#pragma once
+
+#include <vector>
+
+#include "blaze/operator/operator.h"
+#include "blaze/operator/fused_op/fused_elementwise_op.h"
+#include "blaze/common/exception.h"
+#include "blaze/common/types.h"
+
+#include "blaze/math/gemm.h"
+
+namespace blaze {
+
+template <class Context>
+class FusedGemmEpilogueOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_FUNCTIONS(Context);
+
+  FusedGemmEpilogueOp(const OperatorDef& def, Workspace* workspace) :
+      Operator<Context>(def, workspace) {
+    transa_ = OperatorBase::GetSingleArgument<bool>("transA", false);
+    transb_ = OperatorBase::GetSingleArgument<bool>("transB", false);
+    alpha_ = OperatorBase::GetSingleArgument<float>("alpha", 1.0);
+    ParseFusedElementwiseProgram(*this, &program_);
+    for (int s = 0; s < program_.step_num; ++s) {
+      for (int k = 0; k < 3; ++k) {
+        // The operands 0 and 1 are A and B, the running value is the gemm output.
+        BLAZE_CONDITION_THROW(program_.operand[s][k] < 0 || program_.operand[s][k] >= 2,
+                              "operand=", program_.operand[s][k]);
+      }
+    }
+  }
+
+  bool RunOnDevice() override;
+
+ protected:
+  void CheckValid() {
+    Blob* a = this->Input(0);
+    Blob* b = this->Input(1);
+
+    BLAZE_CONDITION_THROW(a->shape().size() == 2 || a->shape().size() == 3,
+                          "a->shape.size()=", a->shape().size());
+    BLAZE_CONDITION_THROW(b->shape().size() == 2,
+                          "b->shape.size()=", b->shape().size(), this->def_.DebugString());
+    TIndex a_k = a->shape().size() == 3 ? a->shape()[2] : a->shape()[1];
+    if (transa_) a_k = a->shape().size() == 3 ? a->shape()[1] : a->shape()[0];
+    TIndex b_k = transb_ ? b->shape()[1] : b->shape()[0];
+    BLAZE_CONDITION_THROW(a_k == b_k, "a_k=", a_k, " b_k=", b_k, this->def_.DebugString());
+  }
+
+  // Reshape the output and set the params of the epilogue, as the Gemm op
+  // does, a 3D gemm of a single row is a 2D one.
+  template <typename DType>
+  void Setup(FusedElementwiseParam<DType>* params) {
+    Blob* a = this->Input(0);
+    Blob* b = this->Input(1);
+    Blob* y = this->Output(0);
+
+    const auto& a_shape = a->shape();
+    M_ = a_shape.size() == 3 ? a_shape[1] : a_shape[0];
+    K_ = a_shape.size() == 3 ? a_shape[2] : a_shape[1];
+    if (transa_) std::swap(M_, K_);
+    N_ = transb_ ? b->shape()[0] : b->shape()[1];
+    batch_ = 1;
+    if (a_shape.size() == 3) {
+      y->Reshape({ a_shape[0], M_, N_ });
+      if (M_ == 1) {
+        M_ = a_shape[0];
+      } else {
+        batch_ = a_shape[0];
+      }
+    } else {
+      y->Reshape({ M_, N_ });
+    }
+
+    params->program = program_;
+    params->ndim = y->shape().size();
+    params->size = y->size();
+    for (size_t d = 0; d < y->shape().size(); ++d) params->y_shape[d] = y->shape()[d];
+    params->y = y->as<DType>();
+    params->x[0] = params->y;
+    params->full[0] = true;
+    params->x[1] = nullptr;
+    params->full[1] = true;
+    for (int k = 2; k < this->InputSize(); ++k) {
+      SetFusedElementwiseInput(params, k, this->Input(k));
+    }
+  }
+
+  // Y[m_begin, m_end) = alpha * A[m_begin, m_end) * B of a 2D gemm
+  template <typename DType>
+  void RunGemm(TIndex m_begin, TIndex m_end) {
+    Blob* a = this->Input(0);
+    Blob* b = this->Input(1);
+    Blob* y = this->Output(0);
+    if (batch_ > 1) {
+      GemmStridedBatched<DType, Context>(transa_ ? CblasTrans : CblasNoTrans,
+                                         transb_ ? CblasTrans : CblasNoTrans,
+                                         M_,
+                                         N_,
+                                         K_,
+                                         alpha_,
+                                         a->as<DType>(),
+                                         M_ * K_,
+                                         b->as<DType>(),
+                                         0,
+                                         0,
+                                         y->as<DType>(),
+                                         M_ * N_,
+                                         batch_,
+                                         &this->context_);
+    } else {
+      Gemm<DType, Context>(transa_ ? CblasTrans : CblasNoTrans,
+                           transb_ ? CblasTrans : CblasNoTrans,
+                           m_end - m_begin,
+                           N_,
+                           K_,
+                           alpha_,
+                           a->as<DType>() + m_begin * K_,
+                           b->as<DType>(),
+                           0,
+                           y->as<DType>() + m_begin * N_,
+                           &this->context_);
+    }
+  }
+
+  bool transa_;
+  bool transb_;
+  float alpha_;
+  FusedElementwiseProgram program_;
+
+  TIndex M_, N_, K_, batch_;
+};
+
+}  // namespace blaze
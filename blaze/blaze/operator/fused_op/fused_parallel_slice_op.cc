@@ -0,0 +1,21 @@
+/*
+ * \file fused_parallel_slice_op.cc 
+ * \brief The fused parallel slice operation on cpu
+ */
+#include "blaze/operator/fused_op/fused_parallel_slice_op.h"
+
+namespace blaze {
+
+REGISTER_CPU_OPERATOR(FusedParallelSlice, FusedParallelSliceOp<CPUContext>);
+
+// Input: X Output: Y1, Y2, ...
+OPERATOR_SCHEMA(FusedParallelSlice)
+    .NumInputs(1)
+    .NumOutputs(1, INT_MAX)
+    .IdenticalTypeOfInput(0)
+    .SetDoc(R"DOC(
+FusedParallelSlice takes the slices of one input along one axis into one operation.
+    )DOC")
+    .Input(0, "X", "N-D input tensor");
+
+}  // namespace blaze
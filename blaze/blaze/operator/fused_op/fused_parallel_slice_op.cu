@@ -0,0 +1,11 @@
+/*
+ * \file fused_parallel_slice_op.cu 
+ * \brief The fused parallel slice operation on cuda
+ */
+#include "blaze/operator/fused_op/fused_parallel_slice_op.h"
+
+namespace blaze {
+
+REGISTER_CUDA_OPERATOR(FusedParallelSlice, FusedParallelSliceOp<CUDAContext>);
+
+}  // namespace blaze
@@ -0,0 +1,80 @@
+/*
+ * \file fused_parallel_slice_op.h 
+ * \brief The fused parallel slice operation
+ *
+ * Such as:
+ *
+ *             Input
+ *      |        |        |
+ *    Slice    Slice    Slice
+ *      |        |        |
+ *     Y0       Y1       Y2
+ */
+#pragma once
+
+#include <vector>
+
+#include "blaze/operator/operator.h"
+#include "blaze/common/exception.h"
+#include "blaze/common/types.h"
+#include "blaze/math/multi_copy.h"
+
+namespace blaze {
+
+// Runs the slices of an input along one axis, the i-th output is the slice
+// [start[i], end[i]), as one MultiCopy.
+template <class Context>
+class FusedParallelSliceOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_FUNCTIONS(Context);
+
+  FusedParallelSliceOp(const OperatorDef& def, Workspace* workspace) :
+      Operator<Context>(def, workspace) {
+    axis_ = OperatorBase::GetSingleArgument<size_t>("axis", 0);
+    start_ = OperatorBase::GetRepeatedArgument<size_t>("start");
+    end_ = OperatorBase::GetRepeatedArgument<size_t>("end");
+    BLAZE_CONDITION_THROW(start_.size() == end_.size() && start_.size() == def.output_size(),
+                          "start_.size()=", start_.size(),
+                          " end_.size()=", end_.size(),
+                          " output_size=", def.output_size());
+    for (size_t k = 0; k < start_.size(); ++k) {
+      BLAZE_CONDITION_THROW(start_[k] < end_[k], "start[", k, "]=", start_[k],
+                            " end[", k, "]=", end_[k]);
+    }
+    items_.resize(start_.size());
+  }
+
+  bool RunOnDevice() override {
+    Blob* x = this->Input(0);
+    const std::vector<size_t>& shape = x->shape();
+    BLAZE_CONDITION_THROW(axis_ < shape.size(), "axis_=", axis_,
+                          " shape.size()=", shape.size(), " ", this->def_.name());
+    size_t outer_size = 1, inner_size = 1;
+    for (size_t k = 0; k < axis_; ++k) outer_size *= shape[k];
+    for (size_t k = axis_ + 1; k < shape.size(); ++k) inner_size *= shape[k];
+
+    size_t inner_bytes = inner_size * DataTypeSize(x->data_type());
+    const char* x_data = x->as<char>();
+    for (size_t k = 0; k < start_.size(); ++k) {
+      BLAZE_CONDITION_THROW(end_[k] <= shape[axis_], "end[", k, "]=", end_[k],
+                            " shape[axis]=", shape[axis_]);
+      Blob* y = this->Output(k);
+      std::vector<size_t> y_shape = shape;
+      y_shape[axis_] = end_[k] - start_[k];
+      y->Reshape(y_shape);
+      size_t row_bytes = (end_[k] - start_[k]) * inner_bytes;
+      items_[k] = CopyItem(x_data + start_[k] * inner_bytes, shape[axis_] * inner_bytes,
+                           y->as<char>(), row_bytes, row_bytes, outer_size);
+    }
+    MultiCopy<Context>(items_.data(), items_.size(), &this->context_);
+    return true;
+  }
+
+ protected:
+  size_t axis_;
+  std::vector<size_t> start_;
+  std::vector<size_t> end_;
+  std::vector<CopyItem> items_;
+};
+
+}  // namespace blaze
@@ -4,46 +4,9 @@
  */
 #include "blaze/operator/fused_op/fused_slice_concat_op.h"
 
-namespace blaze {
-
-__device__ __inline__ void GetSliceItemInfo(
-        const SliceItem* slice_item,
-        size_t concat_input_size,
-        size_t axis_idx,
-        size_t* slice_item_index,
-        size_t* off) {
-  size_t i = 0;
-  for (; i < concat_input_size; ++i) {
-    if (axis_idx >= slice_item[i].len) axis_idx -= slice_item[i].len;
-    else break;
-  }
-  *slice_item_index = i;
-  *off = axis_idx;
-}
+#include "blaze/math/multi_copy.h"
 
-// SliceAxis == ConcatAxis
-template <typename DType>
-__device__ __inline__ void FusedSliceConcatEqual(const FusedSliceConcatParam<DType>& params) {
-  size_t size0 = params.concat_axis_size * params.concat_inner_size;
-  size_t outer_idx, axis_idx, inner_idx;
-  // [Outer, Axis(Concat/Slice), Inner]
-  CUDA_KERNEL_LOOP(index, params.y_size) {
-    // The concat outer index
-    outer_idx = index / size0;
-    auto remaining = index % size0;
-    // The axis_idx is the axis's position, and inner_idx is the inner's position.
-    axis_idx = remaining / params.concat_inner_size;
-    inner_idx = remaining % params.concat_inner_size;
-    size_t slice_item_index, off;
-    // TODO: Can optimize the function, when all the slice item's len are equal.
-    GetSliceItemInfo(params.slice_item, params.concat_input_size, axis_idx, &slice_item_index, &off);
-    // Calculate the x' offset
-    auto x_offset = outer_idx * size0 +
-        (params.slice_item[slice_item_index].start + off) * params.concat_inner_size +
-        inner_idx;
-    params.y[index] = params.x[x_offset];
-  }
-}
+namespace blaze {
 
 // SliceAxis < ConcatAxis
 template <typename DType>
@@ -128,11 +91,10 @@ __device__ __inline__ void FusedSliceConcatGreater(const FusedSliceConcatParam<D
   }
 }
 
+// SliceAxis == ConcatAxis runs on MultiCopy
 template <typename DType>
 __global__ void RunFusedSliceConcat(FusedSliceConcatParam<DType> params) {
-  if (params.slice_axis == params.concat_axis) {
-    FusedSliceConcatEqual(params);
-  } else if (params.slice_axis < params.concat_axis) {
+  if (params.slice_axis < params.concat_axis) {
     FusedSliceConcatLesser(params);
   } else {
     FusedSliceConcatGreater(params);
@@ -150,6 +112,24 @@ bool FusedSliceConcatOp<CUDAContext>::RunOnDevice() {
   FusedSliceConcatParam<DType> params;
   // Prepare params and reshape
   Setup<DType>(&params);
+
+  if (params.slice_axis == params.concat_axis) {
+    // each slice is copied to its columns of y in one launch
+    CopyItem items[kMaxInputSize];
+    size_t inner_bytes = params.slice_inner_size * sizeof(DType);
+    size_t offset = 0;
+    for (size_t k = 0; k < params.concat_input_size; ++k) {
+      const SliceItem& slice = params.slice_item[k];
+      items[k] = CopyItem(params.x + slice.start * params.slice_inner_size,
+                          params.slice_axis_size * inner_bytes,
+                          params.y + offset * params.slice_inner_size,
+                          params.concat_axis_size * inner_bytes,
+                          slice.len * inner_bytes, params.slice_outer_size);
+      offset += slice.len;
+    }
+    MultiCopy<CUDAContext>(items, params.concat_input_size, &this->context_);
+    return true;
+  }
   
   // Start to execute slice/concat fused kernel
   dim3 grid, block;
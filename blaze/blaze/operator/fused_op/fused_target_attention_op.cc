@@ -0,0 +1,165 @@
+/*
+ * \file fused_target_attention_op.cc
+ * \brief The target attention of DIN/DIEN in one operation
+ */
+#include "blaze/operator/fused_op/fused_target_attention_op.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace blaze {
+
+// The rows of a block of sequences, whose layer outputs stay in the cache.
+const size_t kTargetAttentionBlockBytes = 256 * 1024;
+
+// y[d] = sum_t w[t] * k[t][d] of the masked softmax w of the scores of a
+// sequence, which pools to zero if all the keys are masked.
+template <typename DType, typename IType>
+static void TargetAttentionPool(DType* score, const IType* mask, const DType* k, TIndex T,
+                                TIndex D, bool softmax, DType* y) {
+  memset(y, 0, D * sizeof(DType));
+  DType max_score = 0;
+  bool valid = false;
+  for (TIndex t = 0; t < T; ++t) {
+    if (mask != nullptr && mask[t] == 0) continue;
+    if (!valid || score[t] > max_score) max_score = score[t];
+    valid = true;
+  }
+  if (!valid) return;
+  DType sum = 0;
+  for (TIndex t = 0; t < T; ++t) {
+    if (mask != nullptr && mask[t] == 0) {
+      score[t] = 0;
+    } else if (softmax) {
+      score[t] = expf(score[t] - max_score);
+      sum += score[t];
+    }
+  }
+  DType scale = softmax ? 1 / sum : 1;
+  for (TIndex t = 0; t < T; ++t) {
+    DType w = score[t] * scale;
+    if (w == 0) continue;
+    const DType* kt = k + t * D;
+    for (TIndex d = 0; d < D; ++d) y[d] += w * kt[d];
+  }
+}
+
+template <>
+bool FusedTargetAttentionOp<CPUContext>::RunOnDevice() {
+  CheckValid();
+
+  Blob* q = this->Input(0);
+  Blob* k = this->Input(1);
+  Blob* y = this->Output(0);
+  TYPE_SWITCH(q->data_type(), DType, {
+  if (B_ * T_ * D_ == 0) {
+    memset(y->as<DType>(), 0, y->size() * sizeof(DType));
+    return true;
+  }
+  TargetAttentionWeightParam<DType> weight_params;
+  SetWeightParams<DType>(&weight_params);
+  for (size_t i = 0; i < weight_params.size; ++i) {
+    weight_params.y[i] = TargetAttentionWeight(weight_params, i);
+  }
+  const TIndex H0 = width_[0];
+  const TIndex xw = InteractionWidth();
+  const DType* wq = weight_params.y + (weight_params.block_num - 1) * D_ * H0;
+  if (!row_query_) {
+    // The query part of the first layer, once per sequence
+    qh_->Reshape({ B_, H0 });
+    Gemm<DType, CPUContext>(CblasNoTrans, CblasNoTrans, B_, H0, D_, 1.0,
+                            q->as<DType>(), wq, 0, qh_->as<DType>(), &this->context_);
+  }
+
+  TIndex max_width = xw;
+  for (TIndex width : width_) max_width = std::max(max_width, width);
+  TIndex block_b = std::max<TIndex>(1, kTargetAttentionBlockBytes /
+                                    (T_ * max_width * sizeof(DType)));
+  block_b = std::min(block_b, B_);
+  x_->Reshape({ block_b * T_, xw });
+  h_[0]->Reshape({ block_b * T_, max_width });
+  h_[1]->Reshape({ block_b * T_, max_width });
+
+  const DType* q_data = q->as<DType>();
+  const DType* k_data = k->as<DType>();
+  for (TIndex b_begin = 0; b_begin < B_; b_begin += block_b) {
+    TIndex b_end = std::min(B_, b_begin + block_b);
+    TIndex rows = (b_end - b_begin) * T_;
+    TIndex row_begin = b_begin * T_;
+
+    // The interaction rows [K, Q*K, Q]
+    DType* x = x_->as<DType>();
+    for (TIndex r = 0; r < rows; ++r) {
+      TIndex row = row_begin + r;
+      const DType* kr = k_data + row * D_;
+      const DType* qr = q_data + (row_query_ ? row : row / T_) * D_;
+      DType* xr = x + r * xw;
+      memcpy(xr, kr, D_ * sizeof(DType));
+      xr += D_;
+      if (has_mul_) {
+        for (TIndex d = 0; d < D_; ++d) xr[d] = qr[d] * kr[d];
+        xr += D_;
+      }
+      if (row_query_) memcpy(xr, qr, D_ * sizeof(DType));
+    }
+
+    // The first layer adds the projected query before its epilogue
+    DType* h = h_[0]->as<DType>();
+    Gemm<DType, CPUContext>(CblasNoTrans, CblasNoTrans, rows, H0, xw, 1.0,
+                            x, weight_params.y, 0, h, &this->context_);
+    FusedElementwiseParam<DType> params;
+    SetLayerParams<DType>(0, h, rows, &params);
+    for (TIndex r = 0; r < rows; ++r) {
+      DType* hr = h + r * H0;
+      if (!row_query_) {
+        const DType* qh = qh_->as<DType>() + (row_begin + r) / T_ * H0;
+        for (TIndex j = 0; j < H0; ++j) hr[j] += qh[j];
+      }
+      for (size_t i = r * H0; i < (r + 1) * H0; ++i) {
+        h[i] = FusedElementwiseEval(params, i);
+      }
+    }
+    for (size_t l = 1; l < programs_.size(); ++l) {
+      DType* next = h_[l % 2]->as<DType>();
+      RunLayerGemm<DType>(l, rows, h, next);
+      h = next;
+      SetLayerParams<DType>(l, h, rows, &params);
+      for (size_t i = 0; i < params.size; ++i) {
+        h[i] = FusedElementwiseEval(params, i);
+      }
+    }
+
+    // The scores of the block are the last layer of width 1
+    for (TIndex b = b_begin; b < b_end; ++b) {
+      DType* score = h + (b - b_begin) * T_;
+      const DType* kb = k_data + b * T_ * D_;
+      DType* yb = y->as<DType>() + b * D_;
+      if (masked_) {
+        Blob* mask = this->Input(2);
+        ID_TYPE_SWITCH(mask->data_type(), IType, {
+          TargetAttentionPool(score, mask->as<IType>() + b * T_, kb, T_, D_, softmax_, yb);
+        });
+      } else {
+        TargetAttentionPool<DType, int32_t>(score, nullptr, kb, T_, D_, softmax_, yb);
+      }
+    }
+  }
+  });
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(FusedTargetAttention, FusedTargetAttentionOp<CPUContext>);
+
+// Input: Q, K, mask(optional), the weight and the epilogue operands of each
+// layer Output: Y
+OPERATOR_SCHEMA(FusedTargetAttention)
+    .NumInputs(3, INT_MAX)
+    .NumOutputs(1)
+    .IdenticalTypeOfInput(0)
+    .SetDoc(R"DOC(
+FusedTargetAttention operator, Y = sum_t softmax(mlp(concat(Q, K_t, Q-K_t, Q*K_t)))_t * K_t,
+the layers of the mlp are gemms with a FusedElementwise epilogue, the last one
+of width 1. The masked keys are excluded from the softmax and the pooling.
+    )DOC");
+
+}  // namespace blaze
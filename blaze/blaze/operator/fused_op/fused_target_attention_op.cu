@@ -0,0 +1,197 @@
+/*
+ * \file fused_target_attention_op.cu
+ * \brief The target attention of DIN/DIEN in one operation on gpu
+ */
+#include "blaze/operator/fused_op/fused_target_attention_op.h"
+
+namespace blaze {
+
+const int kTargetAttentionPoolThreads = 256;
+
+template <typename DType>
+__global__ void TargetAttentionWeightKernel(TargetAttentionWeightParam<DType> params) {
+  CUDA_KERNEL_LOOP(index, params.size) {
+    params.y[index] = TargetAttentionWeight(params, index);
+  }
+}
+
+// The interaction rows [K, Q*K, Q] of the B * T keys
+template <typename DType>
+__global__ void TargetAttentionInteractionKernel(const DType* q, const DType* k, DType* x,
+                                                 TIndex T, TIndex D, bool has_mul,
+                                                 bool row_query, size_t size) {
+  TIndex xw = D * (1 + (has_mul ? 1 : 0) + (row_query ? 1 : 0));
+  CUDA_KERNEL_LOOP(index, size) {
+    TIndex row = index / xw;
+    TIndex col = index % xw;
+    TIndex d = col % D;
+    int part = col / D;
+    DType kv = k[row * D + d];
+    DType qv = q[(row_query ? row : row / T) * D + d];
+    if (part == 0) {
+      x[index] = kv;
+    } else if (part == 1 && has_mul) {
+      x[index] = static_cast<DType>(static_cast<float>(qv) * static_cast<float>(kv));
+    } else {
+      x[index] = qv;
+    }
+  }
+}
+
+// The epilogue of a layer, the first one adds the projected query qh
+template <typename DType>
+__global__ void TargetAttentionLayerKernel(FusedElementwiseParam<DType> params, const DType* qh,
+                                           TIndex T) {
+  TIndex H = params.y_shape[1];
+  CUDA_KERNEL_LOOP(index, params.size) {
+    if (qh != nullptr) {
+      TIndex b = index / H / T;
+      params.y[index] = static_cast<DType>(static_cast<float>(params.y[index]) +
+                                           static_cast<float>(qh[b * H + index % H]));
+    }
+    params.y[index] = FusedElementwiseEval(params, index);
+  }
+}
+
+// A block per sequence, the masked softmax of the scores is written in place
+// and pools the keys.
+template <typename DType, typename IType>
+__global__ void TargetAttentionPoolKernel(DType* score, const IType* mask, const DType* k,
+                                          TIndex B, TIndex T, TIndex D, bool softmax, DType* y) {
+  __shared__ float reduce[kTargetAttentionPoolThreads];
+  for (TIndex b = blockIdx.x; b < B; b += gridDim.x) {
+    DType* sb = score + b * T;
+    const IType* mb = mask == nullptr ? nullptr : mask + b * T;
+
+    // The max score of the valid keys
+    float max_score = -INFINITY;
+    for (TIndex t = threadIdx.x; t < T; t += blockDim.x) {
+      if (mb != nullptr && mb[t] == 0) continue;
+      max_score = fmaxf(max_score, static_cast<float>(sb[t]));
+    }
+    reduce[threadIdx.x] = max_score;
+    __syncthreads();
+    for (int s = blockDim.x / 2; s > 0; s >>= 1) {
+      if (threadIdx.x < s) reduce[threadIdx.x] = fmaxf(reduce[threadIdx.x], reduce[threadIdx.x + s]);
+      __syncthreads();
+    }
+    max_score = reduce[0];
+    __syncthreads();
+
+    float sum = 0;
+    for (TIndex t = threadIdx.x; t < T; t += blockDim.x) {
+      float w = static_cast<float>(sb[t]);
+      if (mb != nullptr && mb[t] == 0) {
+        w = 0;
+      } else if (softmax) {
+        w = expf(w - max_score);
+      }
+      sum += w;
+      sb[t] = static_cast<DType>(w);
+    }
+    reduce[threadIdx.x] = sum;
+    __syncthreads();
+    for (int s = blockDim.x / 2; s > 0; s >>= 1) {
+      if (threadIdx.x < s) reduce[threadIdx.x] += reduce[threadIdx.x + s];
+      __syncthreads();
+    }
+    // All the keys masked pools to zero
+    float scale = max_score == -INFINITY ? 0 : (softmax ? 1 / reduce[0] : 1);
+    __syncthreads();
+
+    const DType* kb = k + b * T * D;
+    for (TIndex d = threadIdx.x; d < D; d += blockDim.x) {
+      float v = 0;
+      for (TIndex t = 0; t < T; ++t) {
+        v += static_cast<float>(sb[t]) * static_cast<float>(kb[t * D + d]);
+      }
+      y[b * D + d] = static_cast<DType>(v * scale);
+    }
+    __syncthreads();
+  }
+}
+
+template <>
+bool FusedTargetAttentionOp<CUDAContext>::RunOnDevice() {
+  CheckValid();
+
+  Blob* q = this->Input(0);
+  Blob* k = this->Input(1);
+  Blob* y = this->Output(0);
+  cudaStream_t stream = this->context_.cuda_stream();
+  TYPE_SWITCH_ON_CUDA(q->data_type(), DType, {
+  if (B_ * T_ * D_ == 0) {
+    CUDA_CHECK(cudaMemsetAsync(y->as<DType>(), 0, y->size() * sizeof(DType), stream));
+    return true;
+  }
+  for (auto blob : { qh_.get(), x_.get(), h_[0].get(), h_[1].get() }) {
+    blob->set_data_type(static_cast<DataType>(q->data_type()));
+  }
+  dim3 grid, block;
+
+  TargetAttentionWeightParam<DType> weight_params;
+  SetWeightParams<DType>(&weight_params);
+  block.x = GetThreadsNum(weight_params.size);
+  grid.x = GetBlockNum(CUDA_GET_BLOCKS(weight_params.size, block.x));
+  TargetAttentionWeightKernel<DType><<<grid, block, 0, stream>>>(weight_params);
+
+  const TIndex H0 = width_[0];
+  const TIndex xw = InteractionWidth();
+  const TIndex rows = B_ * T_;
+  const DType* wq = weight_params.y + (weight_params.block_num - 1) * D_ * H0;
+  const DType* qh = nullptr;
+  if (!row_query_) {
+    qh_->Reshape({ B_, H0 });
+    Gemm<DType, CUDAContext>(CblasNoTrans, CblasNoTrans, B_, H0, D_, 1.0,
+                             q->as<DType>(), wq, 0, qh_->as<DType>(), &this->context_);
+    qh = qh_->as<DType>();
+  }
+
+  TIndex max_width = 1;
+  for (TIndex width : width_) max_width = std::max(max_width, width);
+  x_->Reshape({ rows, xw });
+  h_[0]->Reshape({ rows, max_width });
+  h_[1]->Reshape({ rows, max_width });
+
+  size_t size = rows * xw;
+  block.x = GetThreadsNum(size);
+  grid.x = GetBlockNum(CUDA_GET_BLOCKS(size, block.x));
+  TargetAttentionInteractionKernel<DType><<<grid, block, 0, stream>>>(
+      q->as<DType>(), k->as<DType>(), x_->as<DType>(), T_, D_, has_mul_, row_query_, size);
+
+  DType* h = h_[0]->as<DType>();
+  Gemm<DType, CUDAContext>(CblasNoTrans, CblasNoTrans, rows, H0, xw, 1.0,
+                           x_->as<DType>(), weight_params.y, 0, h, &this->context_);
+  for (size_t l = 0; l < programs_.size(); ++l) {
+    if (l > 0) {
+      DType* next = h_[l % 2]->as<DType>();
+      RunLayerGemm<DType>(l, rows, h, next);
+      h = next;
+    }
+    FusedElementwiseParam<DType> params;
+    SetLayerParams<DType>(l, h, rows, &params);
+    block.x = GetThreadsNum(params.size);
+    grid.x = GetBlockNum(CUDA_GET_BLOCKS(params.size, block.x));
+    TargetAttentionLayerKernel<DType><<<grid, block, 0, stream>>>(params, l == 0 ? qh : nullptr,
+                                                                  T_);
+  }
+
+  block.x = kTargetAttentionPoolThreads;
+  grid.x = std::min<TIndex>(B_, 65535);
+  if (masked_) {
+    Blob* mask = this->Input(2);
+    ID_TYPE_SWITCH(mask->data_type(), IType, {
+      TargetAttentionPoolKernel<DType, IType><<<grid, block, 0, stream>>>(
+          h, mask->as<IType>(), k->as<DType>(), B_, T_, D_, softmax_, y->as<DType>());
+    });
+  } else {
+    TargetAttentionPoolKernel<DType, int32_t><<<grid, block, 0, stream>>>(
+        h, nullptr, k->as<DType>(), B_, T_, D_, softmax_, y->as<DType>());
+  }
+  });
+  return true;
+}
+
+REGISTER_CUDA_OPERATOR(FusedTargetAttention, FusedTargetAttentionOp<CUDAContext>);
+
+}  // namespace blaze
@@ -0,0 +1,328 @@
+/*
+ * \file fused_target_attention_op.h
+ * \brief The target attention of DIN/DIEN, the query-key interaction mlp and
+ * the weighted pooling of the behaviour sequence in one operation
+ *
+ *     Q    K
+ *     |\  /|
+ *     | Sub Mul
+ *     | |   |
+ *     Concat(Q, K, Q-K, Q*K)
+ *     |
+ *     Gemm + Dice ... Gemm     (the attention mlp, the last one of width 1)
+ *     |
+ *     Where(mask)              (optional)
+ *     |
+ *     Softmax                  (optional)
+ *     |
+ *     MatMul(score, K)
+ *
+ *  As the first gemm is linear on the concat, its weight is folded into the
+ *  weights of K and Q*K, and the one of Q, which is projected once per query
+ *  instead of once per key.
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "blaze/operator/operator.h"
+#include "blaze/operator/fused_op/fused_elementwise_op.h"
+#include "blaze/common/exception.h"
+#include "blaze/common/types.h"
+
+#include "blaze/math/gemm.h"
+
+namespace blaze {
+
+// The parts of the concat of the attention mlp input
+enum TargetAttentionInteraction {
+  kAttentionQuery = 0,
+  kAttentionKey,
+  kAttentionQuerySubKey,
+  kAttentionKeySubQuery,
+  kAttentionQueryMulKey,
+};
+
+const int kMaxAttentionInteractions = 8;
+
+// The interaction of its name, -1 if unknown
+inline int TargetAttentionInteractionOf(const std::string& name) {
+  static const char* kNames[] = {
+    "query", "key", "query_sub_key", "key_sub_query", "query_mul_key",
+  };
+  for (int k = 0; k < sizeof(kNames) / sizeof(kNames[0]); ++k) {
+    if (name == kNames[k]) return k;
+  }
+  return -1;
+}
+
+// The folded weights of the first gemm, the blocks of D rows are the
+// weights of K, Q*K if any and Q, whose coef columns are 1, 2 and 0.
+template <typename DType>
+struct TargetAttentionWeightParam {
+  const DType* w;
+  DType* y;
+  int interaction_num;
+  // The coefs of Q, K and Q*K of each interaction
+  float coef[kMaxAttentionInteractions][3];
+  int block_num;
+  int block_coef[3];
+  TIndex D;
+  TIndex H;
+  bool transb;
+  size_t size;
+};
+
+// The folded weight element i
+template <typename DType>
+BLAZE_INLINE_X DType TargetAttentionWeight(const TargetAttentionWeightParam<DType>& params,
+                                           size_t i) {
+  TIndex j = i % params.H;
+  TIndex d = (i / params.H) % params.D;
+  int c = params.block_coef[i / (params.H * params.D)];
+  TIndex rows = params.interaction_num * params.D;
+  float v = 0;
+  for (int s = 0; s < params.interaction_num; ++s) {
+    if (params.coef[s][c] == 0) continue;
+    TIndex row = s * params.D + d;
+    float w = static_cast<float>(params.transb ? params.w[j * rows + row] : params.w[row * params.H + j]);
+    v += params.coef[s][c] * w;
+  }
+  return static_cast<DType>(v);
+}
+
+template <class Context>
+class FusedTargetAttentionOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_FUNCTIONS(Context);
+
+  FusedTargetAttentionOp(const OperatorDef& def, Workspace* workspace) :
+      Operator<Context>(def, workspace) {
+    masked_ = OperatorBase::GetSingleArgument<bool>("masked", false);
+    softmax_ = OperatorBase::GetSingleArgument<bool>("softmax", true);
+    keepdims_ = OperatorBase::GetSingleArgument<bool>("keepdims", false);
+    ParseInteraction();
+    ParseLayers();
+    weight_.reset(new Blob(this->device_option_));
+    qh_.reset(new Blob(this->device_option_));
+    x_.reset(new Blob(this->device_option_));
+    h_[0].reset(new Blob(this->device_option_));
+    h_[1].reset(new Blob(this->device_option_));
+  }
+
+  bool RunOnDevice() override;
+
+ protected:
+  void ParseInteraction() {
+    std::vector<std::string> names = OperatorBase::GetRepeatedArgument<std::string>(
+        "interaction", { "query", "key", "query_sub_key", "query_mul_key" });
+    BLAZE_CONDITION_THROW(!names.empty() && names.size() <= kMaxAttentionInteractions,
+                          "interaction.size()=", names.size());
+    static const float kCoef[][3] = {
+      { 1, 0, 0 }, { 0, 1, 0 }, { 1, -1, 0 }, { -1, 1, 0 }, { 0, 0, 1 },
+    };
+    has_mul_ = false;
+    for (const auto& name : names) {
+      int interaction = TargetAttentionInteractionOf(name);
+      BLAZE_CONDITION_THROW(interaction >= 0, "interaction=", name);
+      interaction_.push_back(interaction);
+      std::vector<float> coef(kCoef[interaction], kCoef[interaction] + 3);
+      coef_.push_back(coef);
+      if (interaction == kAttentionQueryMulKey) has_mul_ = true;
+    }
+  }
+
+  // The layers take the inputs after Q, K and the mask, the weight first.
+  // The epilogue operand k >= 2 of a layer is its input k - 1, as the ones
+  // of FusedGemmEpilogue.
+  void ParseLayers() {
+    std::vector<int> layer_inputs = OperatorBase::GetRepeatedArgument<int>("layer_inputs");
+    std::vector<int> layer_steps = OperatorBase::GetRepeatedArgument<int>("layer_steps");
+    std::vector<int> layer_transb = OperatorBase::GetRepeatedArgument<int>(
+        "layer_transb", std::vector<int>(layer_inputs.size(), 0));
+    std::vector<std::string> types = OperatorBase::GetRepeatedArgument<std::string>("step_type");
+    std::vector<int> operand = OperatorBase::GetRepeatedArgument<int>("step_operand");
+    std::vector<int> swap = OperatorBase::GetRepeatedArgument<int>("step_swap");
+    std::vector<float> arg = OperatorBase::GetRepeatedArgument<float>("step_arg");
+    BLAZE_CONDITION_THROW(!layer_inputs.empty() && layer_steps.size() == layer_inputs.size() &&
+                          layer_transb.size() == layer_inputs.size(),
+                          "def=", this->def_.DebugString());
+    BLAZE_CONDITION_THROW(operand.size() == types.size() * 3 && swap.size() == types.size() &&
+                          arg.size() == types.size(), "def=", this->def_.DebugString());
+
+    int input = masked_ ? 3 : 2;
+    size_t step = 0;
+    for (size_t l = 0; l < layer_inputs.size(); ++l) {
+      BLAZE_CONDITION_THROW(layer_inputs[l] >= 1 && layer_inputs[l] < kMaxFusedElementwiseInputs,
+                            "layer_inputs[", l, "]=", layer_inputs[l]);
+      BLAZE_CONDITION_THROW(layer_steps[l] >= 0 && layer_steps[l] <= kMaxFusedElementwiseSteps &&
+                            step + layer_steps[l] <= types.size(),
+                            "layer_steps[", l, "]=", layer_steps[l]);
+      FusedElementwiseProgram program;
+      program.step_num = layer_steps[l];
+      for (int s = 0; s < program.step_num; ++s, ++step) {
+        program.type[s] = FusedElementwiseStep(types[step]);
+        BLAZE_CONDITION_THROW(program.type[s] >= 0, "step_type=", types[step]);
+        for (int k = 0; k < 3; ++k) {
+          program.operand[s][k] = operand[step * 3 + k];
+          BLAZE_CONDITION_THROW(program.operand[s][k] < 0 ||
+                                (program.operand[s][k] >= 2 &&
+                                 program.operand[s][k] <= layer_inputs[l]),
+                                "layer ", l, " operand=", program.operand[s][k]);
+        }
+        program.swap[s] = swap[step];
+        program.arg[s] = arg[step];
+      }
+      programs_.push_back(program);
+      layer_begin_.push_back(input);
+      layer_inputs_.push_back(layer_inputs[l]);
+      transb_.push_back(layer_transb[l] != 0);
+      input += layer_inputs[l];
+    }
+    BLAZE_CONDITION_THROW(step == types.size(), "step_type.size()=", types.size());
+    BLAZE_CONDITION_THROW(input == this->InputSize(), "InputSize()=", this->InputSize(),
+                          " expected=", input);
+  }
+
+  // Check the shapes and reshape the output and the buffers of rows
+  void CheckValid() {
+    Blob* q = this->Input(0);
+    Blob* k = this->Input(1);
+    BLAZE_CONDITION_THROW(k->shape().size() == 3, "k->shape().size()=", k->shape().size());
+    B_ = k->shape()[0];
+    T_ = k->shape()[1];
+    D_ = k->shape()[2];
+    const std::vector<TIndex>& q_shape = q->shape();
+    BLAZE_CONDITION_THROW(q->data_type() == k->data_type(), "q->data_type()=", q->data_type());
+    BLAZE_CONDITION_THROW((q_shape.size() == 2 || q_shape.size() == 3) && q_shape[0] == B_ &&
+                          q_shape.back() == D_, "q_shape.size()=", q_shape.size());
+    // The query of each key, such as the broadcast ones
+    row_query_ = q_shape.size() == 3 && q_shape[1] != 1;
+    BLAZE_CONDITION_THROW(!row_query_ || q_shape[1] == T_, "q_shape[1]=", q_shape[1]);
+    if (masked_) {
+      BLAZE_CONDITION_THROW(this->Input(2)->size() == B_ * T_,
+                            "mask->size()=", this->Input(2)->size());
+    }
+
+    width_.clear();
+    TIndex K = interaction_.size() * D_;
+    for (size_t l = 0; l < programs_.size(); ++l) {
+      Blob* w = this->Input(layer_begin_[l]);
+      BLAZE_CONDITION_THROW(w->shape().size() == 2, "layer ", l, " w->shape().size()=",
+                            w->shape().size());
+      TIndex w_k = transb_[l] ? w->shape()[1] : w->shape()[0];
+      TIndex w_n = transb_[l] ? w->shape()[0] : w->shape()[1];
+      BLAZE_CONDITION_THROW(w_k == K, "layer ", l, " w_k=", w_k, " K=", K);
+      // The epilogue operands are per column
+      for (int k = 1; k < layer_inputs_[l]; ++k) {
+        TIndex size = this->Input(layer_begin_[l] + k)->size();
+        BLAZE_CONDITION_THROW(size == 1 || size == w_n, "layer ", l, " input ", k,
+                              " size=", size);
+      }
+      width_.push_back(w_n);
+      K = w_n;
+    }
+    BLAZE_CONDITION_THROW(width_.back() == 1, "score width=", width_.back());
+
+    Blob* y = this->Output(0);
+    if (keepdims_) {
+      y->Reshape({ B_, 1, D_ });
+    } else {
+      y->Reshape({ B_, D_ });
+    }
+  }
+
+  // The params of the folded weights of the first layer
+  template <typename DType>
+  void SetWeightParams(TargetAttentionWeightParam<DType>* params) {
+    params->w = this->Input(layer_begin_[0])->template as<DType>();
+    params->interaction_num = interaction_.size();
+    for (size_t s = 0; s < interaction_.size(); ++s) {
+      for (int c = 0; c < 3; ++c) params->coef[s][c] = coef_[s][c];
+    }
+    params->block_num = 0;
+    params->block_coef[params->block_num++] = 1;
+    if (has_mul_) params->block_coef[params->block_num++] = 2;
+    params->block_coef[params->block_num++] = 0;
+    params->D = D_;
+    params->H = width_[0];
+    params->transb = transb_[0];
+    params->size = params->block_num * D_ * width_[0];
+    weight_->set_data_type(static_cast<DataType>(this->Input(0)->data_type()));
+    weight_->Reshape({ params->block_num * D_, width_[0] });
+    params->y = weight_->template as<DType>();
+  }
+
+  // The width of the interaction rows, which are K, Q*K if any and Q if
+  // each key has its query.
+  TIndex InteractionWidth() const {
+    return D_ * (1 + (has_mul_ ? 1 : 0) + (row_query_ ? 1 : 0));
+  }
+
+  // The epilogue params of layer l on the rows of y
+  template <typename DType>
+  void SetLayerParams(int l, DType* y, TIndex rows, FusedElementwiseParam<DType>* params) {
+    params->program = programs_[l];
+    params->ndim = 2;
+    params->y_shape[0] = rows;
+    params->y_shape[1] = width_[l];
+    params->size = rows * width_[l];
+    params->y = y;
+    params->x[0] = y;
+    params->full[0] = true;
+    params->x[1] = nullptr;
+    params->full[1] = true;
+    for (int k = 2; k <= layer_inputs_[l]; ++k) {
+      Blob* x = this->Input(layer_begin_[l] + k - 1);
+      params->x[k] = x->template as<DType>();
+      params->full[k] = false;
+      params->stride[k][0] = 0;
+      params->stride[k][1] = x->size() == 1 ? 0 : 1;
+    }
+  }
+
+  // The gemm of layer l > 0 on the rows of the last layer
+  template <typename DType>
+  void RunLayerGemm(int l, TIndex rows, const DType* x, DType* y) {
+    Gemm<DType, Context>(CblasNoTrans,
+                         transb_[l] ? CblasTrans : CblasNoTrans,
+                         rows,
+                         width_[l],
+                         width_[l - 1],
+                         1.0,
+                         x,
+                         this->Input(layer_begin_[l])->template as<DType>(),
+                         0,
+                         y,
+                         &this->context_);
+  }
+
+  bool masked_;
+  bool softmax_;
+  bool keepdims_;
+  bool has_mul_;
+  std::vector<int> interaction_;
+  std::vector<std::vector<float>> coef_;
+
+  std::vector<FusedElementwiseProgram> programs_;
+  std::vector<int> layer_begin_;
+  std::vector<int> layer_inputs_;
+  std::vector<bool> transb_;
+  std::vector<TIndex> width_;
+
+  TIndex B_, T_, D_;
+  bool row_query_;
+
+  // The folded weights of the first layer
+  std::unique_ptr<Blob> weight_;
+  // The projected queries
+  std::unique_ptr<Blob> qh_;
+  // The interaction rows
+  std::unique_ptr<Blob> x_;
+  // The outputs of the layers
+  std::unique_ptr<Blob> h_[2];
+};
+
+}  // namespace blaze
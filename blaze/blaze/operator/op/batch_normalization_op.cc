@@ -6,20 +6,11 @@
 
 #include <math.h>
 
+#include "blaze/math/activation_kernel.h"
 #include "blaze/operator/common_helper.h"
 
 namespace blaze {
 
-template <typename DType>
-void BatchNormalizationKernel(BatchNormalizationParam<DType>& params) {
-  for (size_t i = 0; i < params.size; ++i) {
-    size_t offset = i % params.c;
-    DType x_normed = (params.x[i] - params.mean[offset]) /
-        (params.nosqrt ? params.var[offset] : sqrtf(params.var[offset] + params.eps));
-    params.y[i] = params.gamma[offset] * x_normed + params.beta[offset];
-  }
-}
-
 template <>
 bool BatchNormalizationOp<CPUContext>::RunOnDevice() {
   Blob* x = this->Input(0);
@@ -36,17 +27,16 @@ bool BatchNormalizationOp<CPUContext>::RunOnDevice() {
     // Reshape
     y->Reshape(x->shape());
     // Launch cpu kernel
-    BatchNormalizationParam<DType> params(x->as<DType>(),
-                                          x->size(),
-                                          gamma->as<DType>(),
-                                          beta->as<DType>(),
-                                          mean->as<DType>(),
-                                          var->as<DType>(),
-                                          gamma->size(),
-                                          y->as<DType>(),
-                                          nosqrt_,
-                                          eps_);
-    BatchNormalizationKernel<DType>(params);
+    BatchNormalizationKernel(x->as<DType>(),
+                             x->size(),
+                             gamma->as<DType>(),
+                             beta->as<DType>(),
+                             mean->as<DType>(),
+                             var->as<DType>(),
+                             gamma->size(),
+                             nosqrt_,
+                             eps_,
+                             y->as<DType>());
   });
 
   return true;
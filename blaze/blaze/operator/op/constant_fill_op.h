@@ -21,18 +21,16 @@ class ConstantFillOp final : public Operator<Context> {
       Operator<Context>(def, ws, false),  // We create constant blob by hand.
     shape_(OperatorBase::GetRepeatedArgument<TIndex>("shape")) {
     DataType dtype = static_cast<DataType>(OperatorBase::GetSingleArgument<int>("dtype", kFloat));
-    
-    for (const std::string& output_str : def.output()) {
-      Blob* blob = ws->CreateConstantBlob(output_str, this->device_option_);
-      this->outputs_.push_back(blob);
-    }
- 
-    auto* output = Operator<Context>::Output(0);
-    output->set_data_type(dtype);
-    output->Reshape(shape_);
 
     CONSTANT_FILL_TYPE_SWITCH(dtype, DType, {
-      FillWithType<DType>(output);
+      const std::vector<DType> value = OperatorBase::GetRepeatedArgument<DType>("value");
+      // the identical constants of the models loaded are stored once
+      Blob* blob = ws->CreateSharedConstantBlob(def.output(0), this->device_option_, dtype,
+                                                shape_, value.data(), value.size() * sizeof(DType),
+                                                [this, &value](Blob* output) {
+        FillWithType<DType>(value, output);
+      });
+      this->outputs_.push_back(blob);
     });
   }
 
@@ -40,8 +38,7 @@ class ConstantFillOp final : public Operator<Context> {
 
  protected:
   template <typename DType>
-  void FillWithType(Blob* output) {
-    const std::vector<DType> value = OperatorBase::GetRepeatedArgument<DType>("value");
+  void FillWithType(const std::vector<DType>& value, Blob* output) {
     BLAZE_CONDITION_THROW(value.size() == output->size(),
                           "value.size()=",
                           value.size(),
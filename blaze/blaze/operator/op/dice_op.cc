@@ -6,33 +6,11 @@
 
 #include <math.h>
 
-#include "blaze/math/vml.h"
+#include "blaze/math/activation_kernel.h"
 #include "blaze/operator/common_helper.h"
 
 namespace blaze {
 
-template <typename DType>
-void DiceKernel(DiceParam<DType>& params) {
-  size_t batch_size = params.size / params.c;
-  size_t offset = 0;
-
-  for (size_t row = 0; row < batch_size; ++row) {
-    for (size_t col = 0; col < params.c; ++col) {
-      params.y[offset + col] = -1 * (params.x[offset + col] - params.mean[col]) /
-          (params.nosqrt ? params.var[col] : sqrtf(params.var[col] + kDiceEpsilon));
-    }
-    VML_Exp<DType, CPUContext>(params.c, params.y + offset, params.y + offset, nullptr);
-    for (size_t col = 0; col < params.c; ++col) {
-      params.y[offset + col] = 1 / (1 + params.y[offset + col]);
-    }
-    for (size_t col = 0; col < params.c; ++col) {
-      params.y[offset + col] = (1 - params.y[offset + col]) * params.gamma[col] * params.x[offset + col]
-          + params.y[offset + col] * params.x[offset + col];
-    }
-    offset += params.c;
-  }
-}
-
 template <>
 bool DiceOp<CPUContext>::RunOnDevice() {
   Blob* x = this->Input(0);
@@ -48,15 +26,15 @@ bool DiceOp<CPUContext>::RunOnDevice() {
   // Reshape
   y->Reshape(x->shape());
   // Launch cpu kernel
-  DiceParam<DType> params(x->as<DType>(),
-                          x->size(),
-                          gamma->as<DType>(),
-                          mean->as<DType>(),
-                          var->as<DType>(),
-                          gamma->size(),
-                          y->as<DType>(),
-                          nosqrt_);
-  DiceKernel<DType>(params);
+  DiceKernel(x->as<DType>(),
+             x->size(),
+             gamma->as<DType>(),
+             mean->as<DType>(),
+             var->as<DType>(),
+             gamma->size(),
+             nosqrt_,
+             kDiceEpsilon,
+             y->as<DType>());
   });
 
   return true;
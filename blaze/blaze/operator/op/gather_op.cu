@@ -4,21 +4,9 @@
  */
 #include "blaze/operator/op/gather_op.h"
 
-namespace blaze {
+#include "blaze/math/multi_copy.h"
 
-template <typename ValueType, typename IDType>
-__global__ void GatherKernel(GatherParam<ValueType, IDType> params) {
-  CUDA_KERNEL_LOOP(index, params.y_size) {
-    size_t outer_index = index / params.y_inner_size;
-    size_t inner_offset = index % params.y_inner_size;
-    size_t axis_index = params.indices[inner_offset / params.inner_size];
-    size_t offset = inner_offset % params.inner_size;
-
-    size_t src_offset = outer_index * params.axis_size * params.inner_size +
-        axis_index * params.inner_size + offset;
-    params.y[index] = params.data[src_offset];
-  }
-}
+namespace blaze {
 
 template <>
 bool GatherOp<CUDAContext>::RunOnDevice() {
@@ -35,19 +23,20 @@ bool GatherOp<CUDAContext>::RunOnDevice() {
   // Prepare params and reshape
   Setup<ValueType, IDType>(&params);
 
-  // Start to execute gather kernel
-  dim3 grid, block;
-  block.x = GetThreadsNum(params.y_size);
-  grid.x = GetBlockNum(CUDA_GET_BLOCKS(params.y_size, block.x));
-
-  cudaStream_t stream = this->context_.cuda_stream();
-  void* params_dptr = reinterpret_cast<void*>(&params);
-  CUDA_CHECK(cudaLaunchKernel(reinterpret_cast<void*>(&GatherKernel<ValueType, IDType>),
-                              grid,
-                              block,
-                              reinterpret_cast<void**>(&params_dptr),
-                              0,
-                              stream));
+  // gather the inner rows of each outer row by the indices
+  size_t row_bytes = params.inner_size * sizeof(ValueType);
+  CopyItem item;
+  item.src = reinterpret_cast<const char*>(params.data);
+  item.src_pitch = row_bytes;
+  item.src_outer_pitch = params.axis_size * row_bytes;
+  item.dst = reinterpret_cast<char*>(params.y);
+  item.dst_pitch = row_bytes;
+  item.row_bytes = row_bytes;
+  item.index = params.indices;
+  item.index_bytes = sizeof(IDType);
+  item.index_num = indices->size();
+  item.rows = params.inner_size == 0 ? 0 : params.y_size / params.inner_size;
+  MultiCopy<CUDAContext>(&item, 1, &this->context_);
   });
   });
   return true;
@@ -2,34 +2,57 @@
  * \file gru_op.cc
  * \brief The gru operation
  */
+#include <vector>
+
 #include "blaze/math/gemm.h"
 #include "blaze/math/vml.h"
 #include "blaze/operator/op/gru_op.h"
 
 namespace blaze {
 
+// One step of the sequences started, the gates are
+//   r = sigmoid(x_r + h_r), z = sigmoid(x_z + h_z), n = tanh(x_n + r * h_n)
+//   y = n + z * (h - n)
+// and AUGRU scales the update gate 1 - z by the attention score.
 template <typename DType, typename Context>
-inline void VML_Sigmoid(const size_t n, const DType* x, DType* y,
-                        Context* ctx) {
-  for (int i = 0; i < n; i++) { y[i] = -x[i]; }
-  VML_Exp<DType, Context>(n, y, y, ctx);
-  for (int i = 0; i < n; i++) { y[i] = 1.0 / (1 + y[i]); }
-}
+void GRUStep(const GRUParam<DType>& params, TIndex i, const std::vector<bool>& started,
+             Context* ctx) {
+  const auto round = params.round;
+  const auto elts = params.elts;
+  const auto h2h_bias = params.h2h_bias;
+  const auto i2h_bias = params.i2h_bias;
+  for (TIndex b = 0; b < params.batch_size; b++) {
+    if (!started[b]) continue;
+    const DType* preact = &params.preact[(b * round + i) * elts * 3];
+    DType* act = &params.act[b * elts * 3];
+    DType* h = &params.state[b * elts];
+    DType* y = &params.y[(b * round + i) * elts];
 
-template <typename DType, typename Context>
-inline void VML_AddMul(const size_t n, const DType* a, const DType* b,
-                       const DType* c, DType* z, Context* ctx) {
-  for (int i = 0; i < n; i++) { z[i] = a[i] + b[i] * c[i]; }
-}
+    // The negative gate inputs of r and z, and h_n
+    for (TIndex k = 0; k < elts * 2; k++) {
+      act[k] = -(preact[k] + i2h_bias[k] + act[k] + h2h_bias[k]);
+    }
+    VML_Exp<DType, Context>(elts * 2, act, act, ctx);
+    for (TIndex k = 0; k < elts; k++) {
+      DType r = 1.0 / (1 + act[k]);
+      act[elts * 2 + k] = preact[elts * 2 + k] + i2h_bias[elts * 2 + k] +
+          r * (act[elts * 2 + k] + h2h_bias[elts * 2 + k]);
+    }
+    VML_Tanh<DType, Context>(elts, &act[elts * 2], &act[elts * 2], ctx);
 
-template <typename DType>
-inline void SetOutput(const size_t n, const DType* z, const DType* h,
-                      const DType* last_output, DType* output) {
-  for (int i = 0; i < n; i++) {
-    output[i] = h[i] + z[i] * (last_output[i] - h[i]);
+    DType score = params.attention == nullptr ? 1.0 : params.attention[b * round + i];
+    for (TIndex k = 0; k < elts; k++) {
+      DType u = score * (1 - 1.0 / (1 + act[elts + k]));
+      DType n = act[elts * 2 + k];
+      h[k] = n + (1 - u) * (h[k] - n);
+      y[k] = h[k];
+    }
   }
 }
 
+// The input projection of all the steps is one gemm, the recurrent one is a
+// gemm of the batch in each step. A sequence starts at its first step of
+// nonzero input, the padded steps before output zero.
 template <typename DType, typename Context>
 void GRUKernel(const GRUParam<DType>& params, Context* ctx) {
   const auto batch_size = params.batch_size;
@@ -40,55 +63,31 @@ void GRUKernel(const GRUParam<DType>& params, Context* ctx) {
                        batch_size * round, elts * 3, elts, 1.0,
                        params.x, params.i2h, 0.0, params.preact, ctx);
   memset(params.y, 0, batch_size * round * elts * sizeof(DType));
-  auto act = params.act;
-  const auto h2h = params.h2h;
-  const auto h2h_bias = params.h2h_bias;
-  const auto i2h_bias = params.i2h_bias;
-  DType alpha = 1.0;
-  DType beta = 0.0;
-  for (int b = 0; b < batch_size; b++) {
-    DType* y = &params.y[b * round * elts];
-    DType* preact = &params.preact[b * round * elts * 3];
-    bool preact_nonzero = false;
-    for (int i = 0; i < round; i++) {
+  memset(params.state, 0, batch_size * elts * sizeof(DType));
+
+  std::vector<bool> started(batch_size, false);
+  bool state_nonzero = false;
+  for (TIndex i = 0; i < round; i++) {
+    bool any_started = false;
+    for (TIndex b = 0; b < batch_size; b++) {
       // Recheck zeroness in this round if the check failed in the
       // last round
-      if (!preact_nonzero) {
-        for (int k = 0; k < elts; k++) {
-          if (preact[k] != 0) {
-            preact_nonzero = true;
-            break;
-          }
-        }
+      const DType* preact = &params.preact[(b * round + i) * elts * 3];
+      for (TIndex k = 0; k < elts && !started[b]; k++) {
+        if (preact[k] != 0) started[b] = true;
       }
-      if (preact_nonzero) {
-        if (i > 0) {
-          DType* prev_y = y - elts;
-          Gemm(CblasNoTrans, CblasNoTrans, 1, elts * 3, elts, 1.0,
-               prev_y, h2h, 0.0, act, ctx);
-          VML_Add(elts * 3, act, h2h_bias, act, ctx);
-          VML_Add(elts * 3, preact, i2h_bias, preact, ctx);
-          VML_Add(elts * 2, preact, act, preact, ctx);
-          VML_Sigmoid(elts * 2, preact, preact, ctx);
-          VML_AddMul(elts, &preact[elts * 2], preact, &act[elts * 2],
-                     &preact[elts * 2], ctx);
-          VML_Tanh(elts, &preact[elts * 2], &preact[elts * 2], ctx);
-          SetOutput(elts, &preact[elts], &preact[elts * 2], prev_y, y);
-        } else {
-          VML_Add(elts * 3, preact, i2h_bias, preact, ctx);
-          VML_Add(elts * 2, preact, h2h_bias, preact, ctx);
-          VML_Sigmoid(elts * 2, preact, preact, ctx);
-          VML_AddMul(elts, &preact[elts * 2], preact, &h2h_bias[elts * 2],
-                     &preact[elts * 2], ctx);
-          VML_Tanh(elts, &preact[elts * 2], &preact[elts * 2], ctx);
-          SetOutput(elts, &preact[elts], &preact[elts * 2], y, y);
-        }
-      } else {
-        memset(y, 0, elts * sizeof(DType));
-      }
-      preact += elts * 3;
-      y += elts;
+      any_started = any_started || started[b];
+    }
+    if (!any_started) continue;
+
+    if (state_nonzero) {
+      Gemm<DType, Context>(CblasNoTrans, CblasNoTrans, batch_size, elts * 3, elts, 1.0,
+                           params.state, params.h2h, 0.0, params.act, ctx);
+    } else {
+      memset(params.act, 0, batch_size * elts * 3 * sizeof(DType));
     }
+    GRUStep(params, i, started, ctx);
+    state_nonzero = true;
   }
 }
 
@@ -104,6 +103,7 @@ bool GRUOp<CPUContext>::RunOnDevice() {
 }
 
 REGISTER_CPU_OPERATOR(GRU, GRUOp<CPUContext>);
+REGISTER_CPU_OPERATOR(AUGRU, GRUOp<CPUContext>);
 
 // For ONNX: Input: X, W, R, B Output: Y
 // For Ulf: Input: X, h2hweight, i2hweight, h2hBias, i2hbias
@@ -116,4 +116,15 @@ Cast the input to another type Tensor.
     .Input(0, "X", "1D input tensor")
     .Output(0, "Y", "1D output tensor");
 
+// Input: the inputs of GRU, Attention Output: Y
+OPERATOR_SCHEMA(AUGRU)
+    .NumInputs(4, 6)
+    .IdenticalTypeOfInput(0)
+    .SetDoc(R"DOC(
+GRU with the attentional update gate of DIEN, the update gate of each step is
+scaled by the attention score of the step.
+    )DOC")
+    .Input(0, "X", "3D input tensor")
+    .Output(0, "Y", "3D output tensor");
+
 }  // namespace blaze
@@ -32,6 +32,10 @@ struct GRUParam {
   DType* y;
   DType* preact;
   DType* act;
+  // The attention scores of AUGRU, [batch_size, round], null for GRU
+  DType* attention;
+  // The hidden state of each sequence on cpu, [batch_size, elts]
+  DType* state;
   unsigned int* finished;
   TIndex batch_size;
   TIndex round;
@@ -46,7 +50,9 @@ class GRUOp final : public Operator<Context> {
   GRUOp(const OperatorDef& def, Workspace* workspace) :
       Operator<Context>(def, workspace) {
     mask_ = OperatorBase::GetSingleArgument<bool>("mask", true);
+    attention_ = def.type() == "AUGRU";
     preact_ = std::unique_ptr<Blob>(new Blob(this->device_option_));
+    state_ = std::unique_ptr<Blob>(new Blob(this->device_option_));
     act_ = std::unique_ptr<Blob>(new Blob(this->device_option_));
     finished_ = std::unique_ptr<Blob>(new Blob(this->device_option_));
     from_deepnet_ =
@@ -90,6 +96,7 @@ class GRUOp final : public Operator<Context> {
           elts * (alignN(elts, gru_weights_per_thread)
                   / gru_weights_per_thread) * 3 * 2 });
       finished_->Reshape({ round });
+      state_->Reshape({ batch_size, elts });
 
       // x, h2hweight, i2hweight, h2hBias, i2hbias, preact
       param->x = this->Input(0)->template as<DType>();
@@ -100,6 +107,8 @@ class GRUOp final : public Operator<Context> {
       param->y = this->Output(0)->template as<DType>();
       param->preact = preact_->template as<DType>();
       param->act = act_->template as<DType>();
+      param->attention = Attention<DType>(batch_size * round);
+      param->state = state_->template as<DType>();
       param->finished = finished_->template as<unsigned int>();
       param->batch_size = batch_size;
       param->round = round;
@@ -131,6 +140,7 @@ class GRUOp final : public Operator<Context> {
           elts * (alignN(elts, gru_weights_per_thread)
                   / gru_weights_per_thread) * 3 * 2});
       finished_->Reshape({ round });
+      state_->Reshape({ batch_size, elts });
 
       param->x = x->template as<DType>();
       param->h2h = h2h->template as<DType>();
@@ -140,6 +150,8 @@ class GRUOp final : public Operator<Context> {
       param->y = y->template as<DType>();
       param->preact = preact_->template as<DType>();
       param->act = act_->template as<DType>();
+      param->attention = Attention<DType>(batch_size * round);
+      param->state = state_->template as<DType>();
       param->finished = finished_->template as<unsigned int>();
       param->batch_size = batch_size;
       param->round = round;
@@ -147,11 +159,23 @@ class GRUOp final : public Operator<Context> {
     }
   }
 
+  // The attention scores, the last input of AUGRU
+  template <typename DType>
+  DType* Attention(TIndex size) {
+    if (!attention_) return nullptr;
+    Blob* attention = this->Input(this->InputSize() - 1);
+    BLAZE_CONDITION_THROW(attention->size() == size, "attention->size()=", attention->size(),
+                          " size=", size);
+    return attention->template as<DType>();
+  }
+
   bool mask_;
+  bool attention_;
   bool from_deepnet_;
   std::unique_ptr<Blob> preact_;
   std::unique_ptr<Blob> act_;
   std::unique_ptr<Blob> finished_;
+  std::unique_ptr<Blob> state_;
 #ifdef USE_CUDA
   cudaDeviceProp* device_prop_;
 #endif
@@ -5,6 +5,7 @@
 #include "blaze/operator/op/multi_slice_op.h"
 
 #include "blaze/common/common_defines.h"
+#include "blaze/math/multi_copy.h"
 
 namespace blaze {
 
@@ -23,12 +24,17 @@ bool MultiSliceOp<CUDAContext>::RunOnDevice() {
   TYPE_SWITCH_ON_CUDA(x->data_type(), DType, {
     MultiSliceParam<DType> param;
     Setup(&param);
-    // copy data
-    if (use_memcpy2d_) {
-      SliceMemcpy2D<DType>();
-    } else {
-      MultiSliceMemcpy<DType>(); 
+    // copy the slices of all the rows in one launch per kMaxCopyItems
+    Blob* y = this->Output(0);
+    TIndex batch_size = y->shape()[0];
+    TIndex x_stride = x->size(1, x->shape().size());
+    std::vector<CopyItem> items;
+    for (const auto& slice : slice_param_) {
+      items.emplace_back(x->as<DType>() + slice.src_idx, x_stride * sizeof(DType),
+                         y->as<DType>() + slice.dst_idx, total_step_ * sizeof(DType),
+                         slice.step_size * sizeof(DType), batch_size);
     }
+    MultiCopy<CUDAContext>(items.data(), items.size(), &this->context_);
   });
   return true;
 }
@@ -3,32 +3,10 @@
  * \desc The prelu operator.
  */
 #include "blaze/operator/op/prelu_op.h"
-#include "blaze/math/activation.h"
+#include "blaze/math/activation_kernel.h"
 
 namespace blaze {
 
-template <typename DType, typename WDType>
-void RunPRelu(PReluParam<DType, WDType>& params) {
-  size_t inner_size = params.inner_size;
-  size_t outer_size = params.size / inner_size;
-
-  //
-  // NOTE: we not fully implement ONNX standerd, just simply deems
-  // The W_Tensor is the inner prelu.
-  //
-  // https://github.com/onnx/onnx/blob/master/docs/Broadcasting.md.
-  // PRelu fully support Unidirectional Broadcasting
-  //
-  Activation<kPRelu> activation;
-  size_t offset = 0;
-  for (size_t i = 0; i < outer_size; ++i) {
-    for (size_t j = 0; j < inner_size; ++j, ++offset) {
-      // TODO: Add AVX SIMD support
-      activation(params.x + offset, params.w + j, params.y + offset);
-    }
-  }
-}
-
 template <>
 bool PReluOp<CPUContext>::RunOnDevice() {
   Blob* X = this->Input(0);
@@ -42,10 +20,8 @@ bool PReluOp<CPUContext>::RunOnDevice() {
     TYPE_SWITCH(W->data_type(), WDType, {
       // Reshape
       Y->Reshape(X->shape());
-      // launch cpu kernel
-      PReluParam<DType, WDType> params(X->as<DType>(), W->as<WDType>(), Y->as<DType>(),
-                                       X->size(), W->size());
-      RunPRelu(params);
+      // launch cpu kernel, the slope W is the inner dims of X.
+      PReluKernel(X->as<DType>(), X->size(), W->as<WDType>(), W->size(), Y->as<DType>());
     });
   });
 
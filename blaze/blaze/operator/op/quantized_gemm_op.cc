@@ -0,0 +1,22 @@
+/*
+ * \file quantized_gemm_op.cc
+ * \brief The int8 gemm operation
+ */
+#include "blaze/operator/op/quantized_gemm_op.h"
+
+#include <math.h>
+
+namespace blaze {
+
+REGISTER_CPU_OPERATOR(QuantizedGemm, QuantizedGemmOp<CPUContext>);
+
+// Input: A, Wq, WScale, Bias(Optional) Output: C
+OPERATOR_SCHEMA(QuantizedGemm)
+    .NumInputs(3, 4)
+    .NumOutputs(1)
+    .IdenticalTypeOfInput(0)
+    .SetDoc(R"DOC(
+Int8 Gemm operator C=dequant(quant(A)*Wq)+Bias, Wq is per output channel quantized.
+    )DOC");
+
+}  // namespace blaze
@@ -0,0 +1,133 @@
+/*
+ * \file quantized_gemm_op.h
+ * \brief The int8 gemm operation
+ *
+ *  Y = alpha * dequant(quant(A) x Bq) + beta * Bias
+ *
+ *  A is quantized to uint8 with the calibrated x_scale/x_zero_point, Bq is
+ *  the int8 weight with one scale per output channel, see QuantizationPass.
+ */
+#pragma once
+
+#include <math.h>
+
+#include <vector>
+
+#include "blaze/operator/operator.h"
+#include "blaze/common/exception.h"
+#include "blaze/common/types.h"
+
+#include "blaze/math/gemm.h"
+
+namespace blaze {
+
+template <class Context>
+class QuantizedGemmOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_FUNCTIONS(Context);
+
+  QuantizedGemmOp(const OperatorDef& def, Workspace* workspace) :
+      Operator<Context>(def, workspace) {
+    transb_ = OperatorBase::GetSingleArgument<bool>("transB", false);
+    alpha_ = OperatorBase::GetSingleArgument<float>("alpha", 1.0);
+    beta_ = OperatorBase::GetSingleArgument<float>("beta", 1.0);
+    x_scale_ = OperatorBase::GetSingleArgument<float>("x_scale", 1.0);
+    x_zero_point_ = OperatorBase::GetSingleArgument<int>("x_zero_point", 0);
+  }
+
+  bool RunOnDevice() override {
+    CheckValid();
+
+    Blob* a = this->Input(0);
+    Blob* b = this->Input(1);
+    Blob* w_scale = this->Input(2);
+    Blob* c = this->InputSize() > 3 ? this->Input(3) : nullptr;
+    Blob* y = this->Output(0);
+
+    // A 3D gemm shares B, so it is a 2D one of the rows of A.
+    const auto& a_shape = a->shape();
+    TIndex K = a_shape.back();
+    TIndex M = a->size() / K;
+    TIndex N = transb_ ? b->shape()[0] : b->shape()[1];
+    std::vector<TIndex> y_shape = a_shape;
+    y_shape.back() = N;
+    y->Reshape(y_shape);
+
+    const int8_t* bq = b->as<int8_t>();
+    if (col_sum_.empty()) {
+      // The weight is constant, its column sums cancel the zero point.
+      col_sum_.assign(N, 0);
+      for (TIndex k = 0; k < K; ++k) {
+        for (TIndex n = 0; n < N; ++n) {
+          col_sum_[n] += transb_ ? bq[n * K + k] : bq[k * N + n];
+        }
+      }
+    }
+
+    xq_.resize(M * K);
+    const float* x = a->as<float>();
+    float inv_scale = 1.0 / x_scale_;
+    for (TIndex i = 0; i < M * K; ++i) {
+      int q = static_cast<int>(nearbyintf(x[i] * inv_scale)) + x_zero_point_;
+      xq_[i] = static_cast<uint8_t>(q < 0 ? 0 : (q > 255 ? 255 : q));
+    }
+
+    acc_.resize(M * N);
+    GemmU8S8<Context>(transb_ ? CblasTrans : CblasNoTrans,
+                      M, N, K, xq_.data(), bq, acc_.data(), &this->context_);
+
+    const float* scale = w_scale->as<float>();
+    const float* bias = c == nullptr ? nullptr : c->as<float>();
+    bool bias_row = c != nullptr && c->size() == N;
+    float* out = y->as<float>();
+    for (TIndex m = 0; m < M; ++m) {
+      for (TIndex n = 0; n < N; ++n) {
+        int32_t v = acc_[m * N + n] - x_zero_point_ * col_sum_[n];
+        float r = alpha_ * x_scale_ * scale[n] * v;
+        if (bias != nullptr) {
+          r += beta_ * (bias_row ? bias[n] : bias[m * N + n]);
+        }
+        out[m * N + n] = r;
+      }
+    }
+    return true;
+  }
+
+ protected:
+  void CheckValid() {
+    Blob* a = this->Input(0);
+    Blob* b = this->Input(1);
+    Blob* w_scale = this->Input(2);
+    Blob* c = this->InputSize() > 3 ? this->Input(3) : nullptr;
+
+    BLAZE_CONDITION_THROW(a->shape().size() == 2 || a->shape().size() == 3,
+                          "a->shape.size()=", a->shape().size());
+    BLAZE_CONDITION_THROW(a->data_type() == kFloat, "a->data_type()=", a->data_type());
+    BLAZE_CONDITION_THROW(b->shape().size() == 2,
+                          "b->shape.size()=", b->shape().size(), this->def_.DebugString());
+    BLAZE_CONDITION_THROW(b->data_type() == kInt8, "b->data_type()=", b->data_type());
+
+    TIndex b_k = transb_ ? b->shape()[1] : b->shape()[0];
+    TIndex b_n = transb_ ? b->shape()[0] : b->shape()[1];
+    BLAZE_CONDITION_THROW(a->shape().back() == b_k, "a_k=", a->shape().back(), " b_k=", b_k,
+                          this->def_.DebugString());
+    BLAZE_CONDITION_THROW(w_scale->size() == b_n, "w_scale->size()=", w_scale->size(),
+                          " b_n=", b_n);
+    if (c != nullptr) {
+      BLAZE_CONDITION_THROW(c->size() == b_n || c->size() == a->size() / b_k * b_n,
+                            "c->size()=", c->size(), " b_n=", b_n);
+    }
+  }
+
+  bool transb_;
+  float alpha_;
+  float beta_;
+  float x_scale_;
+  int x_zero_point_;
+
+  std::vector<int32_t> col_sum_;
+  std::vector<uint8_t> xq_;
+  std::vector<int32_t> acc_;
+};
+
+}  // namespace blaze
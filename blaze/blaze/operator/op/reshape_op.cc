@@ -12,6 +12,7 @@ REGISTER_CPU_OPERATOR(Reshape, ReshapeOp<CPUContext>);
 OPERATOR_SCHEMA(Reshape)
     .NumInputs(2)
     .NumOutputs(1)
+    .SetAttr<bool>(kAttrIsAliasOutput, true)
     .SetDoc(R"DOC(
 Reshape the input tensor
     )DOC")
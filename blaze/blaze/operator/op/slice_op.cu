@@ -4,21 +4,9 @@
  */
 #include "blaze/operator/op/slice_op.h"
 
-namespace blaze {
+#include "blaze/math/multi_copy.h"
 
-template <typename DType>
-__global__ void RunSlice(SliceParam<DType> params) {
-  size_t width = params.sci.end - params.sci.start;
-  size_t count = width * params.sci.inner_size * params.sci.outer_size;
-  size_t const_off = params.sci.start * params.sci.inner_size; 
-  size_t const_width = (params.sci.size - width) * params.sci.inner_size;
-  
-  CUDA_KERNEL_LOOP(index, count) {
-    size_t out_idx = index / (width * params.sci.inner_size);
-    size_t src_index = index + out_idx * const_width + const_off;
-    params.y[index] = params.x[src_index];
-  }
-}
+namespace blaze {
 
 template <>
 bool SliceOp<CUDAContext>::RunOnDevice() {
@@ -32,20 +20,12 @@ bool SliceOp<CUDAContext>::RunOnDevice() {
   SliceParam<DType> params;
   Setup<DType>(&params);
   
-  // launch the kernel
-  dim3 grid, block;
-  size_t count = params.sci.outer_size * (params.sci.end - params.sci.start) * params.sci.inner_size;
-  block.x = GetThreadsNum(count);
-  grid.x = GetBlockNum(CUDA_GET_BLOCKS(count, block.x));
-  cudaStream_t stream = this->context_.cuda_stream();
- 
-  void* params_dptr = reinterpret_cast<void*>(&params);
-  CUDA_CHECK(cudaLaunchKernel(reinterpret_cast<void*>(&RunSlice<DType>),
-                              grid,
-                              block,
-                              reinterpret_cast<void**>(&params_dptr),
-                              0,
-                              stream));
+  // copy the slice of each outer row
+  size_t row_bytes = (params.sci.end - params.sci.start) * params.sci.inner_size * sizeof(DType);
+  CopyItem item(params.x + params.sci.start * params.sci.inner_size,
+                params.sci.size * params.sci.inner_size * sizeof(DType),
+                params.y, row_bytes, row_bytes, params.sci.outer_size);
+  MultiCopy<CUDAContext>(&item, 1, &this->context_);
 
   });  // TYPE_SWITCH(X->data_type(), DType, {
   return true;
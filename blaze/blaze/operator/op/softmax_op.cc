@@ -7,6 +7,7 @@
 #include <omp.h>
 #include <math.h>
 
+#include "blaze/math/activation_kernel.h"
 #include "blaze/math/vml.h"
 
 namespace blaze {
@@ -25,6 +26,11 @@ static void LauchKernel(Blob* X, Blob* Y, Blob* iblob, int axis) {
   size_t C = X->shape()[axis];
   size_t W = X->size(axis + 1, X->shape().size());
 
+  if (W == 1) {
+    // The softmax of the last dim is in rows
+    SoftmaxKernel(X->as<DType>(), N, C, Y->as<DType>());
+    return;
+  }
   iblob->Reshape({ N, W });
   
   // Calculate max values
@@ -0,0 +1,20 @@
+/*
+ * \file sparse_gemm_op.cc
+ * \brief The block sparse weight gemm operation
+ */
+#include "blaze/operator/op/sparse_gemm_op.h"
+
+namespace blaze {
+
+REGISTER_CPU_OPERATOR(SparseGemm, SparseGemmOp<CPUContext>);
+
+// Input: A, WValues, WColPtr, WRowIdx, Bias(Optional) Output: C
+OPERATOR_SCHEMA(SparseGemm)
+    .NumInputs(4, 5)
+    .NumOutputs(1)
+    .IdenticalTypeOfInput(0)
+    .SetDoc(R"DOC(
+Block sparse weight Gemm operator C=A*W+Bias, W is compressed by its nonzero blocks.
+    )DOC");
+
+}  // namespace blaze
@@ -0,0 +1,11 @@
+/*
+ * \file sparse_gemm_op.cu
+ * \brief The block sparse weight gemm operation
+ */
+#include "blaze/operator/op/sparse_gemm_op.h"
+
+namespace blaze {
+
+REGISTER_CUDA_OPERATOR(SparseGemm, SparseGemmOp<CUDAContext>);
+
+}  // namespace blaze
@@ -0,0 +1,102 @@
+/*
+ * \file sparse_gemm_op.h
+ * \brief The block sparse weight gemm operation
+ *
+ *  Y = alpha * A x W + beta * Bias
+ *
+ *  W is the block sparse constant weight compressed by SparseGemmPass, as
+ *  the values, col_ptr and row_idx of its nonzero block_k x block_n blocks.
+ */
+#pragma once
+
+#include <vector>
+
+#include "blaze/operator/operator.h"
+#include "blaze/common/exception.h"
+#include "blaze/common/types.h"
+
+#include "blaze/math/broadcast.h"
+#include "blaze/math/gemm.h"
+
+namespace blaze {
+
+template <class Context>
+class SparseGemmOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_FUNCTIONS(Context);
+
+  SparseGemmOp(const OperatorDef& def, Workspace* workspace) :
+      Operator<Context>(def, workspace) {
+    block_k_ = OperatorBase::GetSingleArgument<int>("block_k", 1);
+    block_n_ = OperatorBase::GetSingleArgument<int>("block_n", 1);
+    alpha_ = OperatorBase::GetSingleArgument<float>("alpha", 1.0);
+    beta_ = OperatorBase::GetSingleArgument<float>("beta", 1.0);
+  }
+
+  bool RunOnDevice() override {
+    CheckValid();
+
+    Blob* a = this->Input(0);
+    Blob* values = this->Input(1);
+    Blob* col_ptr = this->Input(2);
+    Blob* row_idx = this->Input(3);
+    Blob* c = this->InputSize() > 4 ? this->Input(4) : nullptr;
+    Blob* y = this->Output(0);
+
+    // A 3D gemm shares W, so it is a 2D one of the rows of A.
+    const auto& a_shape = a->shape();
+    TIndex K = a_shape.back();
+    TIndex M = a->size() / K;
+    TIndex N = (col_ptr->size() - 1) * block_n_;
+    std::vector<TIndex> y_shape = a_shape;
+    y_shape.back() = N;
+    y->Reshape(y_shape);
+
+    float beta = beta_;
+    if (c == nullptr) {
+      beta = 0;
+    } else {
+      DimEqualBroadcastAssign<float, Context>(y->as<float>(), y->shape(),
+                                              c->as<float>(), c->shape(), &this->context_);
+    }
+    GemmBlockSparse<Context>(M, N, K, block_k_, block_n_, alpha_, a->as<float>(),
+                             col_ptr->as<int32_t>(), row_idx->as<int32_t>(),
+                             values->as<float>(), beta, y->as<float>(), &this->context_);
+    return true;
+  }
+
+ protected:
+  void CheckValid() {
+    Blob* a = this->Input(0);
+    Blob* values = this->Input(1);
+    Blob* col_ptr = this->Input(2);
+    Blob* row_idx = this->Input(3);
+    Blob* c = this->InputSize() > 4 ? this->Input(4) : nullptr;
+
+    BLAZE_CONDITION_THROW(a->shape().size() == 2 || a->shape().size() == 3,
+                          "a->shape.size()=", a->shape().size());
+    BLAZE_CONDITION_THROW(a->data_type() == kFloat, "a->data_type()=", a->data_type());
+    BLAZE_CONDITION_THROW(values->data_type() == kFloat,
+                          "values->data_type()=", values->data_type());
+    BLAZE_CONDITION_THROW(col_ptr->data_type() == kInt32 && row_idx->data_type() == kInt32,
+                          "col_ptr->data_type()=", col_ptr->data_type(),
+                          " row_idx->data_type()=", row_idx->data_type());
+    BLAZE_CONDITION_THROW(col_ptr->size() >= 2, "col_ptr->size()=", col_ptr->size());
+    BLAZE_CONDITION_THROW(values->size() == row_idx->size() * block_k_ * block_n_,
+                          "values->size()=", values->size(), " row_idx->size()=",
+                          row_idx->size(), this->def_.DebugString());
+    BLAZE_CONDITION_THROW(a->shape().back() % block_k_ == 0, "a_k=", a->shape().back(),
+                          " block_k=", block_k_, this->def_.DebugString());
+    if (c != nullptr) {
+      TIndex b_n = (col_ptr->size() - 1) * block_n_;
+      BLAZE_CONDITION_THROW(c->size() == b_n, "c->size()=", c->size(), " b_n=", b_n);
+    }
+  }
+
+  int block_k_;
+  int block_n_;
+  float alpha_;
+  float beta_;
+};
+
+}  // namespace blaze
@@ -48,6 +48,7 @@ OPERATOR_SCHEMA(Split)
     .NumInputs(1)
     .NumOutputs(1, INT_MAX)
     .IdenticalTypeOfInput(0)
+    .SetAttr<bool>(kAttrIsAliasOutput, true)
     .SetDoc(R"DOC(
 Split a tensor into many tensors.
     )DOC");
@@ -158,6 +158,7 @@ class OpSchema {
   // Set attribute for The op global attributes
   // Such as:
   //   kAttrIsElementWise
+  //   kAttrIsAliasOutput
   template <typename T>
   OpSchema& SetAttr(const std::string& name, T value) {
     attrs_.SetAttr(name, value);
@@ -6,99 +6,114 @@
 
 namespace {
 const int kMaxHashCodeLen = 20;
+// The compound keys hashed by a MurmurHash64ABatch
+const int kHashBatch = 64;
+
+// Writes the decimal of id as "%lld" does, returns the length
+inline size_t FormatDecimal(int64_t id, char* buf) {
+  char digits[kMaxHashCodeLen];
+  uint64_t u = id < 0 ? 0 - static_cast<uint64_t>(id) : static_cast<uint64_t>(id);
+  size_t n = 0;
+  do {
+    digits[n++] = '0' + u % 10;
+    u /= 10;
+  } while (u != 0);
+  size_t len = 0;
+  if (id < 0) buf[len++] = '-';
+  while (n > 0) buf[len++] = digits[--n];
+  return len;
+}
 }  // namespace
 
 namespace blaze {
 
 template <typename K_DType, typename V_DType, typename N_DType>
 void RunCartesianProduct(CartesianProductParam<K_DType, V_DType, N_DType>& params) {
+  const size_t item_size = params.input_items.size();
+  // the decimal keys of the ids of the current row, formatted once per id
+  std::vector<char> keys;
+  std::vector<size_t> key_offsets;
+  std::vector<size_t> item_offsets(item_size);
+  // the id index of each item in the current candidate
+  std::vector<N_DType> index(item_size);
+  // the compound keys of a batch of candidates, stride bytes apart
+  const size_t stride = (kMaxHashCodeLen + 1) * item_size;
+  std::vector<char> convert(stride * kHashBatch);
+  const char* batch_keys[kHashBatch];
+  uint64_t batch_lens[kHashBatch];
+  uint64_t batch_hashes[kHashBatch];
+
   N_DType output_index = 0;
   for (auto i = 0; i < params.cartesian_output.num_size; ++i) {
-    auto candidates_size = params.cartesian_output.nums[i];
-
-    // no cartesian product result, skip current process index
-    if (candidates_size == 0) {
-      for (auto& input_item : params.input_items) {
-        if (input_item.num_size != 1 ) {  // is uncommon input
-          input_item.process_start = input_item.process_end;
-          input_item.process_end = input_item.process_start + input_item.nums[i];
-        }
+    for (auto& input_item : params.input_items) {
+      if (input_item.num_size == 1) {  // is common input
+        input_item.process_start = 0;
+        input_item.process_end = input_item.nums[0];
+      } else {  // is uncommon input
+        input_item.process_start = input_item.process_end;
+        input_item.process_end = input_item.process_start + input_item.nums[i];
       }
-      continue;
-    }
-
-    K_DType candidates_id[candidates_size][params.input_items.size()];
-    V_DType candidates_value[candidates_size];
-    N_DType candidates_num[candidates_size];
-    memset(candidates_num, 0, sizeof(N_DType) * candidates_size);
-
-    // Step 1: generate the base
-    N_DType pos = 0, size = 0;
-
-    auto &base_item = params.input_items[pos++];
-    if (base_item.num_size == 1) {  // is common input
-      base_item.process_start = 0;
-      base_item.process_end = base_item.nums[0];
-    } else {  // is uncommon input
-      base_item.process_start = base_item.process_end;
-      base_item.process_end = base_item.process_start + base_item.nums[i];
-    }
-
-    for (auto j = base_item.process_start; j < base_item.process_end; ++j) {
-      auto sp = candidates_num[size];
-      candidates_num[size] += 1;
-      candidates_id[size][sp] = base_item.ids[j];
-      candidates_value[size++] = base_item.values[j];
     }
 
-    // Step 2: process continue for each result
-    for (; pos < params.input_items.size(); ++pos) {
-      auto& continue_item = params.input_items[pos];
-      auto pre_size = size;
-
-      if (continue_item.num_size == 1) {  // is common input
-        continue_item.process_start = 0;
-        continue_item.process_end = continue_item.nums[0];
-      } else {  // is uncommon input
-        continue_item.process_start = continue_item.process_end;
-        continue_item.process_end = continue_item.process_start + continue_item.nums[i];
+    // no cartesian product result, skip current process index
+    auto candidates_size = params.cartesian_output.nums[i];
+    if (candidates_size == 0) continue;
+
+    // Step 1: format the ids of the row
+    keys.clear();
+    key_offsets.clear();
+    for (size_t p = 0; p < item_size; ++p) {
+      const auto& input_item = params.input_items[p];
+      item_offsets[p] = key_offsets.size();
+      index[p] = 0;
+      for (auto j = input_item.process_start; j < input_item.process_end; ++j) {
+        size_t len = keys.size();
+        key_offsets.push_back(len);
+        keys.resize(len + kMaxHashCodeLen);
+        keys.resize(len + FormatDecimal(static_cast<int64_t>(input_item.ids[j]), keys.data() + len));
       }
-
-      for (auto j = continue_item.process_start + 1; j < continue_item.process_end; ++j) {
-        for (auto k = 0; k < pre_size; ++k) {
-          candidates_num[size] = candidates_num[k];
-          memcpy(candidates_id[size], candidates_id[k], sizeof(K_DType) * candidates_num[size]);
-          auto sp = candidates_num[size]++;
-          candidates_id[size][sp] = continue_item.ids[j];
-          candidates_value[size++] = candidates_value[k] * continue_item.values[j];
+    }
+    key_offsets.push_back(keys.size());
+
+    // Step 2: concat compound key & write result, the candidates are
+    // enumerated with the first item varying fastest, and the keys are
+    // hashed by the batch of kHashBatch candidates
+    for (N_DType j = 0; j < candidates_size; ++j) {
+      const int b = j % kHashBatch;
+      char* key = convert.data() + stride * b;
+      size_t len = 0;
+      V_DType value = params.input_items[0].values[params.input_items[0].process_start + index[0]];
+      for (size_t p = 0; p < item_size; ++p) {
+        const auto& input_item = params.input_items[p];
+        size_t offset = item_offsets[p] + index[p];
+        if (p != 0) {
+          key[len++] = '+';
+          value *= input_item.values[input_item.process_start + index[p]];
         }
+        size_t key_len = key_offsets[offset + 1] - key_offsets[offset];
+        memcpy(key + len, keys.data() + key_offsets[offset], key_len);
+        len += key_len;
       }
+      batch_keys[b] = key;
+      batch_lens[b] = len;
+      params.cartesian_output.values[output_index + j] = value;
+      LOG_DEBUG("output_value = %.4f", params.cartesian_output.values[output_index + j]);
 
-      for (auto k = 0; k < pre_size; ++k) {
-        auto sp = candidates_num[k]++;
-        candidates_id[k][sp] = continue_item.ids[continue_item.process_start];
-        candidates_value[k] *= continue_item.values[continue_item.process_start];
+      // write the ids of the batch
+      if (b == kHashBatch - 1 || j == candidates_size - 1) {
+        blaze::MurmurHash64ABatch(batch_keys, batch_lens, b + 1, batch_hashes);
+        for (int k = 0; k <= b; ++k) {
+          params.cartesian_output.ids[output_index + j - b + k] =
+              static_cast<K_DType>(batch_hashes[k]);
+        }
       }
-    }
 
-    // Step 3: concat compound key & write result
-    size_t max_key_length = (kMaxHashCodeLen + 1) * params.input_items.size();
-    char convert[max_key_length];
-    for (auto j = 0; j < candidates_size; ++j) {
-      auto len = snprintf(convert, sizeof(convert), "%lld", candidates_id[j][0]);
-      for (auto k = 1; k < params.input_items.size(); ++k) {
-        convert[len++] = '+';
-        auto strlen = snprintf(convert + len, sizeof(convert) - len, "%lld", candidates_id[j][k]);
-        len += strlen;
+      // the next candidate
+      for (size_t p = 0; p < item_size; ++p) {
+        const auto& input_item = params.input_items[p];
+        if (++index[p] < input_item.process_end - input_item.process_start) break;
+        index[p] = 0;
       }
-      LOG_DEBUG("concat result = %s", convert);
-      auto hash_code = blaze::MurmurHash64A(convert, len);
-
-      // write output blob
-      params.cartesian_output.ids[output_index + j] = static_cast<K_DType>(hash_code);
-      params.cartesian_output.values[output_index + j] = candidates_value[j];
-      LOG_DEBUG("output_id = %lld", params.cartesian_output.ids[output_index + j]);
-      LOG_DEBUG("output_value = %.4f", params.cartesian_output.values[output_index + j]);
     }
     output_index += candidates_size;
   }
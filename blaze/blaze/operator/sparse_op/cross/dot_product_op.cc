@@ -11,6 +11,7 @@ template <typename K_DType, typename V_DType, typename N_DType>
 void RunDotProduct(DotProductParam<K_DType, V_DType, N_DType>& params, bool need_partial_sort) {
   N_DType input_offset = 0;
   N_DType output_offset = 0;
+  std::vector<K_DType> result_index;
   for (auto i = 0; i < params.num_size; ++i) {
     N_DType start = input_offset;
     N_DType end = input_offset + params.x_nums[i];
@@ -21,9 +22,9 @@ void RunDotProduct(DotProductParam<K_DType, V_DType, N_DType>& params, bool need
     }
 
     // Step 2: binary search
-    K_DType result_index[params.y_nums[i]];
+    result_index.resize(params.y_nums[i]);
     BinarySearch<K_DType>(params.x_ids + input_offset, params.x_nums[i],
-                          params.y_ids + input_offset, params.y_nums[i], result_index);
+                          params.y_ids + input_offset, params.y_nums[i], result_index.data());
 
     // Step 3: calc dot product params
     float sum_aa = 0.0f;
@@ -0,0 +1,149 @@
+/*!
+ * \file broadcast_sink_pass.cc
+ * \brief The pass sinking the indicator broadcasts of the user side inputs
+ */
+#include "blaze/optimizer/passes/broadcast_sink_pass.h"
+
+#include <vector>
+
+#include "blaze/common/proto_helper.h"
+
+namespace blaze {
+
+BroadcastSinkPass& BroadcastSinkPass::Name(std::string name) {
+  this->name_ = name;
+  return *this;
+}
+
+BroadcastSinkPass& BroadcastSinkPass::Type(PassType pass_type) {
+  this->pass_type_ = pass_type;
+  return *this;
+}
+
+NetDef BroadcastSinkPass::RunPass(const NetDef& net_def) {
+  std::unordered_set<std::string> indicators, constants, names;
+  for (const auto& input : net_def.external_input()) {
+    if (input.has_input_type() && input.input_type() == kInputIndicator) {
+      indicators.insert(input.name());
+    }
+    names.insert(input.name());
+  }
+  for (const auto& op : net_def.op()) {
+    for (const auto& name : op.output()) {
+      if (op.type() == "ConstantFill") constants.insert(name);
+      names.insert(name);
+    }
+  }
+  if (indicators.empty()) return net_def;
+
+  Broadcast broadcast;
+  std::vector<OperatorDef> ops;
+  size_t sink_num = 0;
+  for (const auto& op : net_def.op()) {
+    if (op.type() == "Gather" && op.input_size() == 2 && op.output_size() == 1 &&
+        indicators.count(op.input(1)) &&
+        ArgumentHelper(op).GetSingleArgument<int>("axis", 0) == 0) {
+      broadcast[op.output(0)] = std::make_pair(op.input(0), op.input(1));
+      ops.push_back(op);
+      continue;
+    }
+    std::string indicator;
+    if (!Sinkable(op, constants, broadcast, &indicator)) {
+      ops.push_back(op);
+      continue;
+    }
+
+    // op runs on the user level inputs, and its output is broadcast
+    OperatorDef user_op = op;
+    for (int i = 0; i < user_op.input_size(); ++i) {
+      const auto& iter = broadcast.find(user_op.input(i));
+      if (iter != broadcast.end()) user_op.set_input(i, iter->second.first);
+    }
+    const std::string user_output = UniqueName(op.output(0) + "_user", &names);
+    user_op.set_output(0, user_output);
+
+    OperatorDef gather;
+    gather.set_type("Gather");
+    gather.set_name(op.name() + "_broadcast");
+    gather.add_input(user_output);
+    gather.add_input(indicator);
+    gather.add_output(op.output(0));
+    if (op.has_device_option()) {
+      gather.mutable_device_option()->CopyFrom(op.device_option());
+    }
+    ops.push_back(user_op);
+    ops.push_back(gather);
+    broadcast[op.output(0)] = std::make_pair(user_output, indicator);
+    ++sink_num;
+  }
+  if (sink_num == 0) return net_def;
+
+  // The broadcasts sunk past all their consumers are removed
+  std::unordered_set<std::string> consumed;
+  for (const auto& output : net_def.external_output()) {
+    consumed.insert(output.name());
+  }
+  for (const auto& op : ops) {
+    for (const auto& name : op.input()) consumed.insert(name);
+  }
+  NetDef ret = net_def;
+  ret.clear_op();
+  for (const auto& op : ops) {
+    if (op.type() == "Gather" && broadcast.count(op.output(0)) && !consumed.count(op.output(0))) {
+      continue;
+    }
+    *ret.add_op() = op;
+  }
+  LOG_DEBUG("broadcast sink: %u ops moved to the user level", sink_num);
+  return ret;
+}
+
+bool BroadcastSinkPass::RowWise(const OperatorDef& op) {
+  static const std::unordered_set<std::string> kElementwise = {
+    "Sigmoid", "Tanh", "LeakyRelu", "PRelu", "Dice", "BatchNormalization", "Cast",
+    "Add", "Sub", "Mul", "Div", "Max", "Min",
+  };
+  if (kElementwise.count(op.type())) return true;
+  ArgumentHelper argument_helper(op);
+  if (op.type() == "Gemm") {
+    return !argument_helper.GetSingleArgument<bool>("transA", false);
+  } else if (op.type() == "Concat" || op.type() == "Softmax") {
+    return argument_helper.GetSingleArgument<int>("axis", 1) != 0;
+  } else if (op.type() == "Slice" || op.type() == "ReduceSum") {
+    return argument_helper.GetSingleArgument<int>("axis", 0) != 0;
+  }
+  return false;
+}
+
+bool BroadcastSinkPass::Sinkable(const OperatorDef& op,
+                                 const std::unordered_set<std::string>& constants,
+                                 const Broadcast& broadcast,
+                                 std::string* indicator) {
+  indicator->clear();
+  if (op.output_size() != 1 || !RowWise(op)) return false;
+  for (int i = 0; i < op.input_size(); ++i) {
+    const auto& iter = broadcast.find(op.input(i));
+    if (iter == broadcast.end()) {
+      // the item level inputs stay after the broadcast
+      if (!constants.count(op.input(i))) return false;
+      continue;
+    }
+    // the weights of gemm are not rows
+    if (op.type() == "Gemm" && i != 0) return false;
+    if (!indicator->empty() && *indicator != iter->second.second) return false;
+    *indicator = iter->second.second;
+  }
+  return !indicator->empty();
+}
+
+std::string BroadcastSinkPass::UniqueName(const std::string& name,
+                                          std::unordered_set<std::string>* names) {
+  std::string unique_name = name;
+  for (int i = 1; names->count(unique_name); ++i) {
+    unique_name = name + std::to_string(i);
+  }
+  names->insert(unique_name);
+  return unique_name;
+}
+
+}  // namespace blaze
@@ -0,0 +1,44 @@
+/*!
+ * \file broadcast_sink_pass.h
+ * \brief The pass sinking the indicator broadcasts of the user side inputs
+ */
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "blaze/optimizer/pass.h"
+#include "blaze/graph/graph.h"
+
+namespace blaze {
+
+// The user side inputs of a request are broadcast to the rows of its items
+// by the Gathers of the indicators, which the structured batching fills.
+// The row-wise ops on the broadcast rows and constants are moved before the
+// broadcast, so the user side subgraph runs once per user instead of once
+// per item, and only its result is gathered into the item side graph.
+class BroadcastSinkPass : public Pass {
+ public:
+  BroadcastSinkPass& Name(std::string name);
+  BroadcastSinkPass& Type(PassType pass_type);
+
+  virtual NetDef RunPass(const NetDef& net_def);
+
+ protected:
+  // The user level blob and the indicator of a broadcast blob
+  using Broadcast = std::unordered_map<std::string, std::pair<std::string, std::string>>;
+
+  // Whether each row of the output depends only on the same row of the inputs
+  bool RowWise(const OperatorDef& op);
+  // Whether op runs on the broadcast inputs of indicator and the constants
+  bool Sinkable(const OperatorDef& op,
+                const std::unordered_set<std::string>& constants,
+                const Broadcast& broadcast,
+                std::string* indicator);
+  // The blob name not used in names
+  std::string UniqueName(const std::string& name, std::unordered_set<std::string>* names);
+};
+
+}  // namespace blaze
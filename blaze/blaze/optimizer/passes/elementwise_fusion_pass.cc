@@ -0,0 +1,155 @@
+/*!
+ * \file elementwise_fusion_pass.cc
+ * \brief The elementwise fusion pass for chains of elementwise ops
+ */
+#include "blaze/optimizer/passes/elementwise_fusion_pass.h"
+
+#include "blaze/common/proto_helper.h"
+#include "blaze/operator/fused_op/fused_elementwise_op.h"
+
+namespace blaze {
+
+ElementwiseFusionPass& ElementwiseFusionPass::Name(std::string name) {
+  this->name_ = name;
+  return *this;
+}
+
+ElementwiseFusionPass& ElementwiseFusionPass::Type(PassType pass_type) {
+  this->pass_type_ = pass_type;
+  return *this;
+}
+
+NetDef ElementwiseFusionPass::RunPass(const NetDef& net_def) {
+  const auto external_output = NetDefHelper::ExternalOutputs(net_def);
+  // The consumer of the blobs, -1 if consumed more than once
+  const auto consumer = NetDefHelper::SingleConsumers(net_def);
+
+  // The chains, keyed by their last op
+  std::unordered_map<int, std::vector<int>> chains;
+  std::vector<bool> fused(net_def.op_size(), false);
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    const OperatorDef& head = net_def.op(i);
+    if (fused[i] || RunningInput(head, head.input_size() ? head.input(0) : "") != 0) continue;
+
+    std::vector<int> chain(1, i);
+    std::unordered_set<std::string> inputs(head.input().begin(), head.input().end());
+    while (chain.size() < kMaxFusedElementwiseSteps) {
+      const OperatorDef& op = net_def.op(chain.back());
+      if (op.output_size() != 1 || external_output.count(op.output(0))) break;
+      const auto& iter = consumer.find(op.output(0));
+      if (iter == consumer.end() || iter->second < 0 || fused[iter->second]) break;
+      const OperatorDef& next = net_def.op(iter->second);
+      if (next.device_option().SerializeAsString() != head.device_option().SerializeAsString()) break;
+      int running = RunningInput(next, op.output(0));
+      if (running < 0) break;
+      std::unordered_set<std::string> next_inputs = inputs;
+      for (int k = 0; k < next.input_size(); ++k) {
+        if (k != running) next_inputs.insert(next.input(k));
+      }
+      if (next_inputs.size() > kMaxFusedElementwiseInputs) break;
+      inputs.swap(next_inputs);
+      chain.push_back(iter->second);
+    }
+    if (chain.size() < 2) continue;
+    for (int idx : chain) fused[idx] = true;
+    chains[chain.back()] = chain;
+  }
+  if (chains.empty()) return net_def;
+
+  NetDef ret = net_def;
+  ret.clear_op();
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    const auto& iter = chains.find(i);
+    if (iter != chains.end()) {
+      *ret.add_op() = FusedOp(net_def, iter->second);
+    } else if (!fused[i]) {
+      *ret.add_op() = net_def.op(i);
+    }
+  }
+  LOG_DEBUG("elementwise fusion: %u chains fused", chains.size());
+  return ret;
+}
+
+int ElementwiseFusionPass::RunningInput(const OperatorDef& op, const std::string& name) {
+  int type = FusedElementwiseStep(op.type());
+  if (type < 0 || op.output_size() != 1) return -1;
+  int running = -1;
+  for (int k = 0; k < op.input_size(); ++k) {
+    if (op.input(k) != name) continue;
+    // The running value is used once by the step
+    if (running >= 0) return -1;
+    running = k;
+  }
+  switch (type) {
+    case kFusedAdd:
+    case kFusedSub:
+    case kFusedMul:
+    case kFusedDiv:
+    case kFusedMax:
+    case kFusedMin:
+      return op.input_size() == 2 ? running : -1;
+    case kFusedSigmoid:
+    case kFusedTanh:
+    case kFusedLeakyRelu:
+      return op.input_size() == 1 ? running : -1;
+    case kFusedPRelu:
+      return op.input_size() == 2 && running == 0 ? 0 : -1;
+    case kFusedDice:
+      return op.input_size() == 4 && running == 0 ? 0 : -1;
+  }
+  return -1;
+}
+
+OperatorDef ElementwiseFusionPass::FusedOp(const NetDef& net_def, const std::vector<int>& chain) {
+  const OperatorDef& head = net_def.op(chain.front());
+  OperatorDef fused_op;
+  fused_op.set_type("FusedElementwise");
+  fused_op.set_name(net_def.op(chain.back()).name());
+  if (head.has_device_option()) {
+    fused_op.mutable_device_option()->CopyFrom(head.device_option());
+  }
+  fused_op.add_input(head.input(0));
+  fused_op.add_output(net_def.op(chain.back()).output(0));
+
+  std::unordered_map<std::string, int> input_idx;
+  input_idx[head.input(0)] = 0;
+  std::vector<std::string> types;
+  std::vector<int> operands, swaps;
+  std::vector<float> args;
+  std::string running_name = head.input(0);
+  for (int idx : chain) {
+    const OperatorDef& op = net_def.op(idx);
+    int running = RunningInput(op, running_name);
+    types.push_back(op.type());
+    std::vector<int> operand(3, -1);
+    int n = 0;
+    for (int k = 0; k < op.input_size(); ++k) {
+      if (k == running) continue;
+      const std::string& name = op.input(k);
+      if (!input_idx.count(name)) {
+        input_idx[name] = fused_op.input_size();
+        fused_op.add_input(name);
+      }
+      operand[n++] = input_idx[name];
+    }
+    operands.insert(operands.end(), operand.begin(), operand.end());
+    swaps.push_back(running == 1 ? 1 : 0);
+
+    ArgumentHelper argument_helper(op);
+    if (op.type() == "LeakyRelu") {
+      args.push_back(argument_helper.GetSingleArgument<float>("alpha", 0.01));
+    } else if (op.type() == "Dice") {
+      args.push_back(argument_helper.GetSingleArgument<bool>("nosqrt", false) ? 1 : 0);
+    } else {
+      args.push_back(0);
+    }
+    running_name = op.output(0);
+  }
+  ArgumentHelper::SetRepeatedArgument<std::string>(fused_op, "step_type", types);
+  ArgumentHelper::SetRepeatedArgument<int>(fused_op, "step_operand", operands);
+  ArgumentHelper::SetRepeatedArgument<int>(fused_op, "step_swap", swaps);
+  ArgumentHelper::SetRepeatedArgument<float>(fused_op, "step_arg", args);
+  return fused_op;
+}
+
+}  // namespace blaze
@@ -0,0 +1,33 @@
+/*!
+ * \file elementwise_fusion_pass.h
+ * \brief The elementwise fusion pass for chains of elementwise ops
+ */
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "blaze/optimizer/pass.h"
+#include "blaze/graph/graph.h"
+
+namespace blaze {
+
+// Fuses chains of elementwise and activation ops into FusedElementwise ops,
+// each op of a chain is the only consumer of the output of the previous one.
+class ElementwiseFusionPass : public Pass {
+ public:
+  ElementwiseFusionPass& Name(std::string name);
+  ElementwiseFusionPass& Type(PassType pass_type);
+
+  virtual NetDef RunPass(const NetDef& net_def);
+
+  // The index of the running value in the inputs of op, -1 if op can not take
+  // it from there
+  int RunningInput(const OperatorDef& op, const std::string& name);
+  // The FusedElementwise op of the chain
+  OperatorDef FusedOp(const NetDef& net_def, const std::vector<int>& chain);
+};
+
+}  // namespace blaze
@@ -0,0 +1,170 @@
+/*!
+ * \file embedding_concat_fusion_pass.cc
+ * \brief The fusion pass of the embeddings concatenated as the dense input
+ */
+#include "blaze/optimizer/passes/embedding_concat_fusion_pass.h"
+
+#include <algorithm>
+
+#include "blaze/common/proto_configure.h"
+#include "blaze/common/proto_helper.h"
+
+namespace blaze {
+
+EmbeddingConcatFusionPass& EmbeddingConcatFusionPass::Name(std::string name) {
+  this->name_ = name;
+  return *this;
+}
+
+EmbeddingConcatFusionPass& EmbeddingConcatFusionPass::Type(PassType pass_type) {
+  this->pass_type_ = pass_type;
+  return *this;
+}
+
+NetDef EmbeddingConcatFusionPass::RunPass(const NetDef& net_def) {
+  const auto external_output = NetDefHelper::ExternalOutputs(net_def);
+  // The consumer of the blobs, -1 if consumed more than once
+  auto consumer = NetDefHelper::SingleConsumers(net_def);
+  std::unordered_map<std::string, int> producer;
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    for (const auto& name : net_def.op(i).output()) {
+      producer[name] = i;
+    }
+  }
+
+  // The fused ops take the place of the last op of their run
+  std::unordered_map<int, OperatorDef> replaced;
+  std::vector<bool> removed(net_def.op_size(), false);
+  size_t run_num = 0;
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    const OperatorDef& op = net_def.op(i);
+    if (op.type() != "Concat" || op.output_size() != 1) continue;
+    ArgumentHelper argument_helper(op);
+    if (argument_helper.GetSingleArgument<int>("axis", 1) != 1) continue;
+
+    OperatorDef concat = op;
+    concat.clear_input();
+    bool changed = false, whole = false;
+    int k = 0;
+    while (k < op.input_size()) {
+      // The run of the fusable Embedding ops from input k
+      std::vector<int> run;
+      EmbeddingConfig merged;
+      int j = k;
+      for (; j < op.input_size(); ++j) {
+        const std::string& name = op.input(j);
+        const auto& iter = producer.find(name);
+        if (iter == producer.end()) break;
+        const OperatorDef& embedding = net_def.op(iter->second);
+        if (embedding.type() != "Embedding" || embedding.output_size() != 1 ||
+            removed[iter->second] || external_output.count(name) || consumer[name] != i) break;
+        if (!run.empty() && embedding.device_option().SerializeAsString() !=
+            net_def.op(run[0]).device_option().SerializeAsString()) break;
+        EmbeddingConfig embedding_config;
+        if (!ParseEmbeddingConfig(embedding, &embedding_config)) break;
+        EmbeddingConfig next = merged;
+        if (!MergeEmbeddingConfig(embedding_config, &next)) break;
+        merged.Swap(&next);
+        run.push_back(iter->second);
+      }
+      if (run.size() < 2) {
+        concat.add_input(op.input(k++));
+        continue;
+      }
+
+      const OperatorDef& head = net_def.op(run[0]);
+      OperatorDef fused_op;
+      fused_op.set_type("Embedding");
+      fused_op.set_name(head.name());
+      if (head.has_device_option()) {
+        fused_op.mutable_device_option()->CopyFrom(head.device_option());
+      }
+      int last = run[0];
+      for (int idx : run) {
+        MergeInputs(net_def.op(idx), &fused_op);
+        removed[idx] = true;
+        last = std::max(last, idx);
+      }
+      whole = k == 0 && j == op.input_size();
+      fused_op.add_output(whole ? op.output(0) : head.output(0));
+      ArgumentHelper::SetSingleArgument<std::string>(fused_op, "embedding_config",
+                                                     merged.DebugString());
+      replaced[last] = fused_op;
+      concat.add_input(head.output(0));
+      changed = true;
+      ++run_num;
+      k = j;
+    }
+    if (!changed) continue;
+    if (whole) {
+      removed[i] = true;
+    } else {
+      replaced[i] = concat;
+    }
+  }
+  if (run_num == 0) return net_def;
+
+  NetDef ret = net_def;
+  ret.clear_op();
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    const auto& iter = replaced.find(i);
+    if (iter != replaced.end()) {
+      *ret.add_op() = iter->second;
+    } else if (!removed[i]) {
+      *ret.add_op() = net_def.op(i);
+    }
+  }
+  LOG_DEBUG("embedding concat fusion: %u runs fused", run_num);
+  return ret;
+}
+
+bool EmbeddingConcatFusionPass::ParseEmbeddingConfig(const OperatorDef& op,
+                                                     EmbeddingConfig* embedding_config) {
+  ArgumentHelper argument_helper(op);
+  std::string embedding_config_str =
+      argument_helper.GetSingleArgument<std::string>("embedding_config", "");
+  ProtoConfigure proto_conf;
+  if (proto_conf.InitByTextConf("blaze.EmbeddingConfig", embedding_config_str) != ProtoConfigure::kOK) {
+    return false;
+  }
+  const EmbeddingConfig* config = dynamic_cast<const EmbeddingConfig*>(proto_conf.config());
+  if (config == nullptr || config->block_config_size() != 1) return false;
+  embedding_config->CopyFrom(*config);
+  return true;
+}
+
+bool EmbeddingConcatFusionPass::MergeEmbeddingConfig(const EmbeddingConfig& embedding_config,
+                                                     EmbeddingConfig* merged) {
+  for (const auto& fg_config : embedding_config.feature_group_config()) {
+    bool exist = false;
+    for (const auto& merged_fg_config : merged->feature_group_config()) {
+      if (merged_fg_config.feature_group() != fg_config.feature_group()) continue;
+      if (merged_fg_config.table_name() != fg_config.table_name() ||
+          merged_fg_config.dim() != fg_config.dim()) return false;
+      exist = true;
+    }
+    if (!exist) merged->add_feature_group_config()->CopyFrom(fg_config);
+  }
+  // The offsets and the stride are set by the op
+  if (merged->block_config_size() == 0) merged->add_block_config();
+  EmbeddingBlockConfig* block_config = merged->mutable_block_config(0);
+  for (const auto& item : embedding_config.block_config(0).embedding_block_config_item()) {
+    block_config->add_embedding_block_config_item()->CopyFrom(item);
+  }
+  return true;
+}
+
+void EmbeddingConcatFusionPass::MergeInputs(const OperatorDef& op, OperatorDef* fused_op) {
+  for (int i = 0; i + 2 < op.input_size(); i += 3) {
+    bool exist = false;
+    for (int j = 0; j < fused_op->input_size(); j += 3) {
+      if (fused_op->input(j) == op.input(i)) exist = true;
+    }
+    if (exist) continue;
+    for (int k = 0; k < 3; ++k) {
+      fused_op->add_input(op.input(i + k));
+    }
+  }
+}
+
+}  // namespace blaze
@@ -0,0 +1,41 @@
+/*!
+ * \file embedding_concat_fusion_pass.h
+ * \brief The fusion pass of the embeddings concatenated as the dense input
+ */
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "blaze/optimizer/pass.h"
+#include "blaze/graph/graph.h"
+#include "blaze/proto/embedding.pb.h"
+
+namespace blaze {
+
+// Fuses the runs of Embedding ops concatenated along axis 1 into one
+// Embedding op, whose single block lays out the items of the run in the
+// concat order. The feature groups of the run are pulled in one request,
+// and the pooled rows are written to the concatenated layout without the
+// intermediate blobs. The Concat is removed if the run covers its inputs.
+class EmbeddingConcatFusionPass : public Pass {
+ public:
+  EmbeddingConcatFusionPass& Name(std::string name);
+  EmbeddingConcatFusionPass& Type(PassType pass_type);
+
+  virtual NetDef RunPass(const NetDef& net_def);
+
+ protected:
+  // The embedding config of the Embedding op of a single block, false if
+  // the op can not be fused
+  bool ParseEmbeddingConfig(const OperatorDef& op, EmbeddingConfig* embedding_config);
+  // Merge the embedding config of a run, false if the feature groups of the
+  // run conflict
+  bool MergeEmbeddingConfig(const EmbeddingConfig& embedding_config, EmbeddingConfig* merged);
+  // Add the inputs of the feature groups of op not in fused op
+  void MergeInputs(const OperatorDef& op, OperatorDef* fused_op);
+};
+
+}  // namespace blaze
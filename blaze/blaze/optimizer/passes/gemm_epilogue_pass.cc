@@ -0,0 +1,152 @@
+/*!
+ * \file gemm_epilogue_pass.cc
+ * \brief The gemm epilogue pass for the bias and activations after gemm
+ */
+#include "blaze/optimizer/passes/gemm_epilogue_pass.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "blaze/common/proto_helper.h"
+#include "blaze/operator/fused_op/fused_elementwise_op.h"
+#include "blaze/optimizer/passes/elementwise_fusion_pass.h"
+
+namespace blaze {
+
+GemmEpiloguePass& GemmEpiloguePass::Name(std::string name) {
+  this->name_ = name;
+  return *this;
+}
+
+GemmEpiloguePass& GemmEpiloguePass::Type(PassType pass_type) {
+  this->pass_type_ = pass_type;
+  return *this;
+}
+
+NetDef GemmEpiloguePass::RunPass(const NetDef& net_def) {
+  const auto external_output = NetDefHelper::ExternalOutputs(net_def);
+  // The consumer of the blobs, -1 if consumed more than once
+  const auto consumer = NetDefHelper::SingleConsumers(net_def);
+
+  // The fused ops, keyed by the position of the epilogue
+  std::unordered_map<int, OperatorDef> fused_ops;
+  std::vector<bool> removed(net_def.op_size(), false);
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    const OperatorDef& gemm = net_def.op(i);
+    if (gemm.type() != "Gemm" || gemm.output_size() != 1) continue;
+    const std::string& output = gemm.output(0);
+    if (external_output.count(output)) continue;
+    ArgumentHelper argument_helper(gemm);
+    if (gemm.input_size() > 2 && argument_helper.GetSingleArgument<float>("beta", 1.0) != 1.0) {
+      continue;
+    }
+    const auto& iter = consumer.find(output);
+    if (iter == consumer.end() || iter->second < 0 || removed[iter->second]) continue;
+    const OperatorDef& op = net_def.op(iter->second);
+    if (op.device_option().SerializeAsString() != gemm.device_option().SerializeAsString()) {
+      continue;
+    }
+    OperatorDef epilogue;
+    if (!Epilogue(net_def, iter->second, output, &epilogue)) continue;
+    OperatorDef fused_op = FusedOp(gemm, epilogue);
+    if (fused_op.input_size() > kMaxFusedElementwiseInputs) continue;
+    ArgumentHelper fused_helper(fused_op);
+    if (fused_helper.GetRepeatedArgument<std::string>("step_type").size() >
+        kMaxFusedElementwiseSteps) {
+      continue;
+    }
+    removed[i] = removed[iter->second] = true;
+    fused_ops[iter->second] = fused_op;
+  }
+  if (fused_ops.empty()) return net_def;
+
+  NetDef ret = net_def;
+  ret.clear_op();
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    const auto& iter = fused_ops.find(i);
+    if (iter != fused_ops.end()) {
+      *ret.add_op() = iter->second;
+    } else if (!removed[i]) {
+      *ret.add_op() = net_def.op(i);
+    }
+  }
+  LOG_DEBUG("gemm epilogue: %u gemms fused", fused_ops.size());
+  return ret;
+}
+
+bool GemmEpiloguePass::Epilogue(const NetDef& net_def, int op_idx, const std::string& gemm_output,
+                                OperatorDef* epilogue) {
+  const OperatorDef& op = net_def.op(op_idx);
+  if (op.input_size() == 0 || op.input(0) != gemm_output ||
+      std::count(op.input().begin(), op.input().end(), gemm_output) != 1) {
+    return false;
+  }
+  if (op.type() == "FusedElementwise") {
+    // The gemm output is only the running value
+    ArgumentHelper argument_helper(op);
+    for (int operand : argument_helper.GetRepeatedArgument<int>("step_operand")) {
+      if (operand == 0) return false;
+    }
+    *epilogue = op;
+    return true;
+  }
+  ElementwiseFusionPass elementwise_fusion_pass;
+  if (elementwise_fusion_pass.RunningInput(op, gemm_output) != 0) return false;
+  *epilogue = elementwise_fusion_pass.FusedOp(net_def, std::vector<int>(1, op_idx));
+  return true;
+}
+
+OperatorDef GemmEpiloguePass::FusedOp(const OperatorDef& gemm, const OperatorDef& epilogue) {
+  OperatorDef fused_op;
+  fused_op.set_type("FusedGemmEpilogue");
+  fused_op.set_name(epilogue.name());
+  if (gemm.has_device_option()) {
+    fused_op.mutable_device_option()->CopyFrom(gemm.device_option());
+  }
+  fused_op.add_input(gemm.input(0));
+  fused_op.add_input(gemm.input(1));
+  fused_op.add_output(epilogue.output(0));
+  for (const auto& arg : gemm.arg()) {
+    if (arg.name() == "transA" || arg.name() == "transB" || arg.name() == "alpha") {
+      *fused_op.add_arg() = arg;
+    }
+  }
+
+  ArgumentHelper argument_helper(epilogue);
+  std::vector<std::string> types;
+  std::vector<int> operands, swaps;
+  std::vector<float> args;
+  if (gemm.input_size() > 2) {
+    fused_op.add_input(gemm.input(2));
+    types.push_back("Add");
+    operands.insert(operands.end(), { 2, -1, -1 });
+    swaps.push_back(0);
+    args.push_back(0);
+  }
+  // The epilogue operands follow A, W and the bias
+  int offset = fused_op.input_size() - 1;
+  for (int k = 1; k < epilogue.input_size(); ++k) {
+    fused_op.add_input(epilogue.input(k));
+  }
+  for (const auto& type : argument_helper.GetRepeatedArgument<std::string>("step_type")) {
+    types.push_back(type);
+  }
+  for (int operand : argument_helper.GetRepeatedArgument<int>("step_operand")) {
+    operands.push_back(operand < 0 ? operand : operand + offset);
+  }
+  for (int swap : argument_helper.GetRepeatedArgument<int>("step_swap")) {
+    swaps.push_back(swap);
+  }
+  for (float arg : argument_helper.GetRepeatedArgument<float>("step_arg")) {
+    args.push_back(arg);
+  }
+  ArgumentHelper::SetRepeatedArgument<std::string>(fused_op, "step_type", types);
+  ArgumentHelper::SetRepeatedArgument<int>(fused_op, "step_operand", operands);
+  ArgumentHelper::SetRepeatedArgument<int>(fused_op, "step_swap", swaps);
+  ArgumentHelper::SetRepeatedArgument<float>(fused_op, "step_arg", args);
+  return fused_op;
+}
+
+}  // namespace blaze
@@ -0,0 +1,33 @@
+/*!
+ * \file gemm_epilogue_pass.h
+ * \brief The gemm epilogue pass for the bias and activations after gemm
+ */
+#pragma once
+
+#include <string>
+
+#include "blaze/optimizer/pass.h"
+#include "blaze/graph/graph.h"
+
+namespace blaze {
+
+// Fuses a Gemm and the elementwise ops consuming its output, as fused by the
+// ElementwiseFusionPass, into a FusedGemmEpilogue op. The bias of the Gemm
+// becomes the first step of the epilogue.
+class GemmEpiloguePass : public Pass {
+ public:
+  GemmEpiloguePass& Name(std::string name);
+  GemmEpiloguePass& Type(PassType pass_type);
+
+  virtual NetDef RunPass(const NetDef& net_def);
+
+ protected:
+  // The epilogue program of op, as a FusedElementwise op taking the gemm
+  // output as input 0, false if op is not fusable
+  bool Epilogue(const NetDef& net_def, int op_idx, const std::string& gemm_output,
+                OperatorDef* epilogue);
+  // The FusedGemmEpilogue op of the gemm and the epilogue
+  OperatorDef FusedOp(const OperatorDef& gemm, const OperatorDef& epilogue);
+};
+
+}  // namespace blaze
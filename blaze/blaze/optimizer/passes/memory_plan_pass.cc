@@ -0,0 +1,229 @@
+/*!
+ * \file memory_plan_pass.cc
+ * \brief The memory plan pass for sharing the blobs of intermediates
+ */
+#include "blaze/optimizer/passes/memory_plan_pass.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "blaze/common/proto_helper.h"
+#include "blaze/operator/operator_schema.h"
+
+namespace {
+const char* kSlotPrefix = "memory_plan_slot_";
+}  // namespace
+
+namespace blaze {
+
+MemoryPlanPass& MemoryPlanPass::Name(std::string name) {
+  this->name_ = name;
+  return *this;
+}
+
+MemoryPlanPass& MemoryPlanPass::Type(PassType pass_type) {
+  this->pass_type_ = pass_type;
+  return *this;
+}
+
+NetDef MemoryPlanPass::RunPass(const NetDef& net_def, Workspace* ws) {
+  // The ops of the other nets may run concurrently or be split across
+  // devices, the aot nets run in order as the simple ones.
+  if (net_def.run_mode() != "simple" && net_def.run_mode().compare(0, 4, "aot_") != 0) {
+    return net_def;
+  }
+
+  std::unordered_map<std::string, DataType> dtype;
+  if (!InferDataType(net_def, &dtype)) return net_def;
+
+  std::unordered_set<std::string> names;
+  std::unordered_set<std::string> pinned;
+  for (const auto& input : net_def.external_input()) {
+    pinned.insert(input.name());
+  }
+  for (const auto& output : net_def.external_output()) {
+    pinned.insert(output.name());
+  }
+  // The common outputs are kept across the runs which reuse them
+  std::unordered_set<std::string> common;
+  NetDefHelper::CommonOps(net_def, &common);
+  pinned.insert(common.begin(), common.end());
+
+  // The producer of the blobs, -1 if produced more than once
+  std::unordered_map<std::string, int> producer;
+  std::unordered_map<std::string, int> last_use;
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    const OperatorDef& op = net_def.op(i);
+    for (const auto& name : op.input()) {
+      last_use[name] = i;
+      names.insert(name);
+    }
+    for (const auto& name : op.output()) {
+      const auto& iter = producer.find(name);
+      producer[name] = iter == producer.end() ? i : -1;
+      last_use.emplace(name, i);
+      names.insert(name);
+      if (op.type() == "ConstantFill") pinned.insert(name);
+    }
+  }
+
+  // The input of an alias op lives as long as its outputs, which keep their
+  // own blobs.
+  for (int i = net_def.op_size() - 1; i >= 0; --i) {
+    const OperatorDef& op = net_def.op(i);
+    OpSchema* schema = OpSchemaRegistry::Schema(op.type());
+    if (!schema->GetAttr<bool>(kAttrIsAliasOutput, false)) continue;
+    const std::string& x = op.input(0);
+    for (const auto& y : op.output()) {
+      if (pinned.count(y)) {
+        pinned.insert(x);
+      } else {
+        last_use[x] = std::max(last_use[x], last_use[y]);
+      }
+      pinned.insert(y);
+    }
+  }
+
+  // The blobs whose slot is released after the op
+  std::vector<std::vector<std::string>> dying(net_def.op_size());
+  for (const auto& item : producer) {
+    if (item.second < 0 || pinned.count(item.first)) continue;
+    dying[last_use[item.first]].push_back(item.first);
+  }
+
+  // Free slots of each device and data type, in the release order
+  std::map<std::string, std::vector<std::string>> free_slots;
+  std::unordered_map<std::string, std::string> slot;
+  std::unordered_map<std::string, std::string> slot_key;
+  size_t slot_num = 0, blob_num = 0;
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    const OperatorDef& op = net_def.op(i);
+    const DeviceOption& device_option =
+        op.has_device_option() ? op.device_option() : net_def.device_option();
+    std::unordered_set<std::string> taken;
+    for (int k = 0; k < op.output_size(); ++k) {
+      const std::string& name = op.output(k);
+      if (producer[name] < 0 || pinned.count(name)) continue;
+      ++blob_num;
+
+      std::string key = std::to_string(device_option.device_type()) + "/" +
+          std::to_string(device_option.device_id()) + "/" + std::to_string(dtype[name]);
+      int j = InplaceInput(net_def, i, k, dtype, last_use, slot, taken);
+      if (j >= 0 && slot_key[slot[op.input(j)]] == key) {
+        taken.insert(op.input(j));
+        slot[name] = slot[op.input(j)];
+        continue;
+      }
+      auto& slots = free_slots[key];
+      if (!slots.empty()) {
+        slot[name] = slots.back();
+        slots.pop_back();
+      } else {
+        std::string slot_name;
+        do {
+          slot_name = kSlotPrefix + std::to_string(slot_num++);
+        } while (names.count(slot_name));
+        slot[name] = slot_name;
+        slot_key[slot_name] = key;
+      }
+    }
+    for (const auto& name : dying[i]) {
+      if (taken.count(name)) continue;
+      const std::string& slot_name = slot[name];
+      free_slots[slot_key[slot_name]].push_back(slot_name);
+    }
+  }
+
+  NetDef ret = net_def;
+  for (int i = 0; i < ret.op_size(); ++i) {
+    OperatorDef* op = ret.mutable_op(i);
+    for (int k = 0; k < op->input_size(); ++k) {
+      const auto& iter = slot.find(op->input(k));
+      if (iter != slot.end()) op->set_input(k, iter->second);
+    }
+    for (int k = 0; k < op->output_size(); ++k) {
+      const auto& iter = slot.find(op->output(k));
+      if (iter != slot.end()) op->set_output(k, iter->second);
+    }
+  }
+  LOG_INFO("memory plan: %u intermediate blobs -> %u slots", blob_num, slot_key.size());
+  return ret;
+}
+
+bool MemoryPlanPass::InferDataType(const NetDef& net_def,
+                                   std::unordered_map<std::string, DataType>* dtype) {
+  for (const auto& input : net_def.external_input()) {
+    (*dtype)[input.name()] = input.dtype();
+  }
+  for (const auto& op : net_def.op()) {
+    OpSchema* schema = OpSchemaRegistry::Schema(op.type());
+    if (schema == nullptr) return false;
+    std::vector<DataType> output_types;
+    if (op.type() == "ConstantFill") {
+      ArgumentHelper argument_helper(op);
+      output_types.push_back(
+          static_cast<DataType>(argument_helper.GetSingleArgument<int>("dtype", kFloat)));
+    } else {
+      std::vector<DataType> input_types;
+      for (const auto& name : op.input()) {
+        const auto& iter = dtype->find(name);
+        if (iter == dtype->end()) {
+          LOG_INFO("memory plan skipped, input %s of op %s is unknown",
+                   name.c_str(), op.name().c_str());
+          return false;
+        }
+        input_types.push_back(iter->second);
+      }
+      if (input_types.empty()) return false;
+      output_types = schema->InferType(op, input_types);
+    }
+    if (output_types.size() < op.output_size()) return false;
+    for (int k = 0; k < op.output_size(); ++k) {
+      (*dtype)[op.output(k)] = output_types[k];
+    }
+  }
+  return true;
+}
+
+int MemoryPlanPass::InplaceInput(const NetDef& net_def, int op_idx, int k,
+                                 const std::unordered_map<std::string, DataType>& dtype,
+                                 const std::unordered_map<std::string, int>& last_use,
+                                 const std::unordered_map<std::string, std::string>& slot,
+                                 const std::unordered_set<std::string>& taken) {
+  const OperatorDef& op = net_def.op(op_idx);
+  OpSchema* schema = OpSchemaRegistry::Schema(op.type());
+  std::vector<int> allowed;
+  for (int j = 0; j < op.input_size(); ++j) {
+    if (schema->allow_inplace(j, k)) allowed.push_back(j);
+  }
+  for (int j : allowed) {
+    const std::string& name = op.input(j);
+    if (!slot.count(name) || taken.count(name) || last_use.at(name) != op_idx) continue;
+    if (std::count(op.input().begin(), op.input().end(), name) != 1) continue;
+    if (dtype.at(name) != dtype.at(op.output(k))) continue;
+    // The inputs broadcast to the output, which keeps the shape of the
+    // input only if the others are constant rows, as in bias adds.
+    bool same_shape = true;
+    for (int other : allowed) {
+      if (other != j && !IsConstantRow(net_def, op.input(other))) same_shape = false;
+    }
+    if (same_shape) return j;
+  }
+  return -1;
+}
+
+bool MemoryPlanPass::IsConstantRow(const NetDef& net_def, const std::string& name) {
+  for (const auto& op : net_def.op()) {
+    if (op.type() != "ConstantFill" || op.output(0) != name) continue;
+    ArgumentHelper argument_helper(op);
+    std::vector<TIndex> shape = argument_helper.GetRepeatedArgument<TIndex>("shape");
+    for (size_t i = 0; i + 1 < shape.size(); ++i) {
+      if (shape[i] != 1) return false;
+    }
+    return true;
+  }
+  return false;
+}
+
+}  // namespace blaze
@@ -0,0 +1,42 @@
+/*!
+ * \file memory_plan_pass.h
+ * \brief The memory plan pass for sharing the blobs of intermediates
+ */
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "blaze/optimizer/pass.h"
+#include "blaze/graph/graph.h"
+
+namespace blaze {
+
+// Renames the intermediate blobs of a simple net to shared slots by their
+// lifetime in op order, the workspace then creates one blob per slot which
+// keeps the capacity of its largest member. An output takes the slot of an
+// input dying at its op when the schema allows inplace. Runs on the workspace
+// net, whose device is known.
+class MemoryPlanPass : public Pass {
+ public:
+  MemoryPlanPass& Name(std::string name);
+  MemoryPlanPass& Type(PassType pass_type);
+
+  virtual NetDef RunPass(const NetDef& net_def, Workspace* ws);
+
+ protected:
+  // Infer the data type of the blobs, false if some input is unknown
+  bool InferDataType(const NetDef& net_def,
+                     std::unordered_map<std::string, DataType>* dtype);
+  // The input of op_idx whose slot output k can take, -1 if none
+  int InplaceInput(const NetDef& net_def, int op_idx, int k,
+                   const std::unordered_map<std::string, DataType>& dtype,
+                   const std::unordered_map<std::string, int>& last_use,
+                   const std::unordered_map<std::string, std::string>& slot,
+                   const std::unordered_set<std::string>& taken);
+  // True if name is the output of a ConstantFill with a single row
+  bool IsConstantRow(const NetDef& net_def, const std::string& name);
+};
+
+}  // namespace blaze
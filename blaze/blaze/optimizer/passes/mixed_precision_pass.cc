@@ -0,0 +1,186 @@
+/*!
+ * \file mixed_precision_pass.cc
+ * \brief The float16 mixed precision pass for the cuda nets
+ */
+#include "blaze/optimizer/passes/mixed_precision_pass.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "blaze/common/proto_helper.h"
+
+namespace blaze {
+
+namespace {
+
+// The largest finite float16
+const float kFloat16Max = 65504.0f;
+
+// The ops which run in float16 on cuda, all of their inputs are float
+const std::unordered_set<std::string> kFloat16Ops = {
+  "Gemm", "MatMul", "FusedGemmEpilogue", "FusedElementwise", "Add", "Sub", "Mul", "Div",
+  "Max", "Min", "Tanh", "LeakyRelu", "PRelu", "Concat"
+};
+
+// The ops whose output is float if their first input is
+const std::unordered_set<std::string> kFloatOps = {
+  "Softmax", "Sigmoid", "BatchNormalization", "Dice", "ReduceSum", "Reshape", "Flatten",
+  "BroadcastTo", "Slice", "Split"
+};
+
+const DeviceOption& OpDeviceOption(const NetDef& net_def, const OperatorDef& op) {
+  return op.has_device_option() ? op.device_option() : net_def.device_option();
+}
+
+OperatorDef CastOpDef(const std::string& input, const std::string& output, int to,
+                      const DeviceOption& device_option) {
+  OperatorDef op;
+  op.set_type("Cast");
+  op.set_name(output + "_cast");
+  op.add_input(input);
+  op.add_output(output);
+  *(op.mutable_device_option()) = device_option;
+  ArgumentHelper::SetSingleArgument<int>(op, "to", to);
+  return op;
+}
+
+}  // namespace
+
+MixedPrecisionPass& MixedPrecisionPass::Name(std::string name) {
+  this->name_ = name;
+  return *this;
+}
+
+MixedPrecisionPass& MixedPrecisionPass::Type(PassType pass_type) {
+  this->pass_type_ = pass_type;
+  return *this;
+}
+
+bool MixedPrecisionPass::Float16Op(const NetDef& net_def, const OperatorDef& op) const {
+  if (kFloat16Ops.count(op.type()) == 0) return false;
+  if (OpDeviceOption(net_def, op).device_type() != kCUDA) return false;
+  for (const auto& iname : op.input()) {
+    if (float_blobs_.count(iname) == 0) return false;
+  }
+  ArgumentHelper argument_helper(op);
+  // the statistics of dice stay in float
+  for (const auto& type : argument_helper.GetRepeatedArgument<std::string>("step_type")) {
+    if (type == "Dice") return false;
+  }
+  std::vector<float> range = argument_helper.GetRepeatedArgument<float>("x_range");
+  if (range.size() == 2 && std::max(fabsf(range[0]), fabsf(range[1])) > kFloat16Max) {
+    return false;
+  }
+  return true;
+}
+
+const std::string& MixedPrecisionPass::Float16Blob(const std::string& blob,
+                                                   const DeviceOption& device_option,
+                                                   NetDef* ret) {
+  auto iter = float16_name_.find(blob);
+  if (iter != float16_name_.end()) return iter->second;
+  std::string name = blob + "_fp16";
+  *(ret->add_op()) = CastOpDef(blob, name, kFloat16, device_option);
+  float_name_[blob] = blob;
+  return float16_name_[blob] = name;
+}
+
+const std::string& MixedPrecisionPass::FloatBlob(const std::string& blob,
+                                                 const DeviceOption& device_option,
+                                                 NetDef* ret) {
+  auto iter = float_name_.find(blob);
+  if (iter != float_name_.end()) return iter->second;
+  // the float of a float16 op output takes the original name
+  *(ret->add_op()) = CastOpDef(float16_name_[blob], blob, kFloat, device_option);
+  return float_name_[blob] = blob;
+}
+
+NetDef MixedPrecisionPass::RunPass(const NetDef& net_def) {
+  if (net_def.device_option().device_type() != kCUDA) return net_def;
+  if (!ArgumentHelper(net_def).GetSingleArgument<bool>("mixed_precision", false)) {
+    return net_def;
+  }
+
+  float_blobs_.clear();
+  float16_name_.clear();
+  float_name_.clear();
+  for (const auto& input : net_def.external_input()) {
+    if (input.dtype() == kFloat) float_blobs_.insert(input.name());
+  }
+  const auto external_output = NetDefHelper::ExternalOutputs(net_def);
+
+  // The ops to run in float16, and the float consumers of the blobs
+  std::vector<bool> float16(net_def.op_size(), false);
+  std::unordered_set<std::string> float_read;
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    const OperatorDef& op = net_def.op(i);
+    bool float_output = false;
+    if (op.type() == "ConstantFill") {
+      float_output = ArgumentHelper(op).GetSingleArgument<int>("dtype", kFloat) == kFloat;
+    } else if (Float16Op(net_def, op)) {
+      float16[i] = true;
+      float_output = true;
+    } else if (kFloat16Ops.count(op.type()) || kFloatOps.count(op.type())) {
+      float_output = op.input_size() > 0 && float_blobs_.count(op.input(0)) > 0;
+    }
+    if (float_output) {
+      for (const auto& oname : op.output()) float_blobs_.insert(oname);
+    }
+    if (!float16[i]) {
+      for (const auto& iname : op.input()) float_read.insert(iname);
+    }
+  }
+  if (std::find(float16.begin(), float16.end(), true) == float16.end()) return net_def;
+
+  NetDef ret = net_def;
+  ret.clear_op();
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    const OperatorDef& op = net_def.op(i);
+    const DeviceOption& device_option = OpDeviceOption(net_def, op);
+    if (op.type() == "ConstantFill" && float_blobs_.count(op.output(0)) &&
+        float_read.count(op.output(0)) == 0 && external_output.count(op.output(0)) == 0) {
+      // the weights read by the float16 ops only are filled as float16
+      OperatorDef fill_op = op;
+      ArgumentHelper::SetSingleArgument<int>(fill_op, "dtype", kFloat16);
+      *(ret.add_op()) = fill_op;
+      float16_name_[op.output(0)] = op.output(0);
+      continue;
+    }
+
+    OperatorDef new_op = op;
+    for (int k = 0; k < op.input_size(); ++k) {
+      const std::string& iname = op.input(k);
+      if (float16[i]) {
+        new_op.set_input(k, Float16Blob(iname, device_option, &ret));
+      } else if (float16_name_.count(iname)) {
+        new_op.set_input(k, FloatBlob(iname, device_option, &ret));
+      }
+    }
+    if (float16[i]) {
+      for (int k = 0; k < op.output_size(); ++k) {
+        std::string name = op.output(k) + "_fp16";
+        new_op.set_output(k, name);
+        float16_name_[op.output(k)] = name;
+        float_name_.erase(op.output(k));
+      }
+    } else {
+      for (const auto& oname : op.output()) {
+        float_name_[oname] = oname;
+        float16_name_.erase(oname);
+      }
+    }
+    *(ret.add_op()) = new_op;
+  }
+
+  // the external outputs stay float
+  for (const auto& output : net_def.external_output()) {
+    if (float16_name_.count(output.name())) {
+      FloatBlob(output.name(), net_def.device_option(), &ret);
+    }
+  }
+  return ret;
+}
+
+}  // namespace blaze
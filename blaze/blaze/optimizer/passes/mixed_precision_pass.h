@@ -0,0 +1,46 @@
+/*!
+ * \file mixed_precision_pass.h
+ * \brief The float16 mixed precision pass for the cuda nets
+ */
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "blaze/optimizer/pass.h"
+#include "blaze/graph/graph.h"
+
+namespace blaze {
+
+// Runs the gemms and the elementwise ops of a cuda net in float16 when the
+// net carries the mixed_precision argument. The numerically sensitive ops,
+// such as softmax, batchnorm, dice and sigmoid, stay in float, Cast ops are
+// inserted on the boundaries and the external outputs are cast back to float.
+// The float weights read by the float16 ops only are filled as float16. The
+// gemms whose calibrated x_range overflows float16 stay in float as well.
+class MixedPrecisionPass : public Pass {
+ public:
+  MixedPrecisionPass& Name(std::string name);
+  MixedPrecisionPass& Type(PassType pass_type);
+
+  virtual NetDef RunPass(const NetDef& net_def);
+
+ protected:
+  // Whether op runs in float16, which requires its inputs to be float
+  bool Float16Op(const NetDef& net_def, const OperatorDef& op) const;
+  // The name of the float16 of blob, which is cast if not yet
+  const std::string& Float16Blob(const std::string& blob, const DeviceOption& device_option,
+                                 NetDef* ret);
+  // The name of the float of blob, which is cast back if not yet
+  const std::string& FloatBlob(const std::string& blob, const DeviceOption& device_option,
+                               NetDef* ret);
+
+  // The blobs known to be float or float16
+  std::unordered_set<std::string> float_blobs_;
+  // The names holding the float16 and the float value of the blobs
+  std::unordered_map<std::string, std::string> float16_name_;
+  std::unordered_map<std::string, std::string> float_name_;
+};
+
+}  // namespace blaze
@@ -7,7 +7,16 @@
 #include "blaze/optimizer/passes/concat_reduce_swap_pass.h"
 #include "blaze/optimizer/passes/constant_pre_compute_pass.h"
 #include "blaze/optimizer/passes/xdl_sparse_fusion_pass.h"
+#include "blaze/optimizer/passes/embedding_concat_fusion_pass.h"
+#include "blaze/optimizer/passes/broadcast_sink_pass.h"
 #include "blaze/optimizer/passes/gemm_pass.h"
+#include "blaze/optimizer/passes/quantization_pass.h"
+#include "blaze/optimizer/passes/sparse_gemm_pass.h"
+#include "blaze/optimizer/passes/elementwise_fusion_pass.h"
+#include "blaze/optimizer/passes/gemm_epilogue_pass.h"
+#include "blaze/optimizer/passes/target_attention_fusion_pass.h"
+#include "blaze/optimizer/passes/mixed_precision_pass.h"
+#include "blaze/optimizer/passes/memory_plan_pass.h"
 
 namespace blaze {
 
@@ -15,8 +24,14 @@ namespace blaze {
 // xdl sparse fusion pass
 REGISTER_PASS(XdlSparseFusionPass).Name("XdlSparseFusionPass")
     .Type(kGraph);
+// embedding concat fusion pass, on the embeddings of the xdl sparse fusion
+REGISTER_PASS(EmbeddingConcatFusionPass).Name("EmbeddingConcatFusionPass")
+    .Type(kGraph);
 
 // ----- The following are dense pass optimization ----
+// broadcast sink pass, runs the user side subgraph once per user
+REGISTER_PASS(BroadcastSinkPass).Name("BroadcastSinkPass")
+    .Type(kGraph);
 // constant pre compute pass
 REGISTER_PASS(ConstantPreComputePass).Name("ConstantPreCompute")
     .Type(kGraph);
@@ -29,9 +44,32 @@ REGISTER_PASS(ConcatReduceSwapPass).Name("ConcatReduceSwapPass")
 // gemm pass
 REGISTER_PASS(GemmPass).Name("GemmPass")
     .Type(kGraph);
+// int8 quantization pass, for the calibrated gemms
+REGISTER_PASS(QuantizationPass).Name("QuantizationPass")
+    .Type(kGraph);
+// block sparse weight pass, for the pruned gemms
+REGISTER_PASS(SparseGemmPass).Name("SparseGemmPass")
+    .Type(kGraph);
 // Fusion pass
 REGISTER_PASS(FusionPass).Name("FusionPass")
     .Type(kGraph);
+// elementwise fusion pass, on the chains left by the fusion pass
+REGISTER_PASS(ElementwiseFusionPass).Name("ElementwiseFusionPass")
+    .Type(kGraph);
+// gemm epilogue pass, folds the bias and the fused activations into gemm
+REGISTER_PASS(GemmEpiloguePass).Name("GemmEpiloguePass")
+    .Type(kGraph);
+// target attention fusion pass, on the gemm epilogues of the attention mlp
+REGISTER_PASS(TargetAttentionFusionPass).Name("TargetAttentionFusionPass")
+    .Type(kGraph);
+// float16 mixed precision pass, on the fused ops of the cuda nets
+REGISTER_PASS(MixedPrecisionPass).Name("MixedPrecisionPass")
+    .Type(kGraph);
+
+// ----- The following are workspace pass optimization ----
+// memory plan pass, on the fused net of the workspace
+REGISTER_PASS(MemoryPlanPass).Name("MemoryPlanPass")
+    .Type(kWorkspace);
 
 }  // namespace blaze
 
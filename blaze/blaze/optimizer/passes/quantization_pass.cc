@@ -0,0 +1,167 @@
+/*!
+ * \file quantization_pass.cc
+ * \brief The int8 quantization pass for calibrated Gemm ops
+ */
+#include "blaze/optimizer/passes/quantization_pass.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "blaze/common/proto_helper.h"
+
+namespace blaze {
+
+QuantizationPass& QuantizationPass::Name(std::string name) {
+  this->name_ = name;
+  return *this;
+}
+
+QuantizationPass& QuantizationPass::Type(PassType pass_type) {
+  this->pass_type_ = pass_type;
+  return *this;
+}
+
+void QuantizationPass::RangeQuantParam(float min, float max, float* scale, int* zero_point) {
+  min = std::min(min, 0.0f);
+  max = std::max(max, 0.0f);
+  *scale = (max - min) / 255;
+  if (*scale == 0) *scale = 1;
+  int zp = static_cast<int>(nearbyintf(-min / *scale));
+  *zero_point = std::min(255, std::max(0, zp));
+}
+
+NetDef QuantizationPass::RunPass(const NetDef& net_def) {
+  if (net_def.device_option().device_type() != kCPU) return net_def;
+
+  std::unordered_map<std::string, int> producer;
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    for (const auto& oname : net_def.op(i).output()) producer[oname] = i;
+  }
+  auto consumers = NetDefHelper::ReadCounts(net_def);
+  const auto external_output = NetDefHelper::ExternalOutputs(net_def);
+
+  // The gemms to rewrite, and the weights left without other consumers
+  std::unordered_map<int, int> gemm_weight;
+  std::unordered_map<int, int> weight_users;
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    int weight_idx = QuantizableWeight(net_def, net_def.op(i), producer);
+    if (weight_idx >= 0) {
+      gemm_weight[i] = weight_idx;
+      weight_users[weight_idx]++;
+    }
+  }
+  if (gemm_weight.empty()) return net_def;
+
+  NetDef ret = net_def;
+  ret.clear_op();
+  std::unordered_set<int> quantized;
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    const OperatorDef& op = net_def.op(i);
+    auto iter = gemm_weight.find(i);
+    if (iter == gemm_weight.end()) {
+      bool unused = weight_users.count(i) &&
+          weight_users[i] == consumers[op.output(0)] &&
+          external_output.count(op.output(0)) == 0;
+      if (!unused) *(ret.add_op()) = op;
+      continue;
+    }
+    ArgumentHelper argument_helper(op);
+    bool transb = argument_helper.GetSingleArgument<bool>("transB", false);
+    OperatorDef weight_q_op, scale_op;
+    QuantizeWeight(net_def.op(iter->second), transb, &weight_q_op, &scale_op);
+    if (quantized.insert(iter->second).second) {
+      *(ret.add_op()) = weight_q_op;
+      *(ret.add_op()) = scale_op;
+    }
+
+    std::vector<float> range = argument_helper.GetRepeatedArgument<float>("x_range");
+    float x_scale;
+    int x_zero_point;
+    RangeQuantParam(range[0], range[1], &x_scale, &x_zero_point);
+
+    OperatorDef qop = op;
+    qop.set_type("QuantizedGemm");
+    qop.clear_input();
+    qop.add_input(op.input(0));
+    qop.add_input(weight_q_op.output(0));
+    qop.add_input(scale_op.output(0));
+    if (op.input_size() > 2) qop.add_input(op.input(2));
+    qop.clear_arg();
+    for (const auto& arg : op.arg()) {
+      if (arg.name() != "x_range" && arg.name() != "transA") *(qop.add_arg()) = arg;
+    }
+    ArgumentHelper::SetSingleArgument<float>(qop, "x_scale", x_scale);
+    ArgumentHelper::SetSingleArgument<int>(qop, "x_zero_point", x_zero_point);
+    *(ret.add_op()) = qop;
+  }
+  return ret;
+}
+
+int QuantizationPass::QuantizableWeight(const NetDef& net_def, const OperatorDef& op,
+                                        const std::unordered_map<std::string, int>& producer) {
+  if (op.type() != "Gemm" || op.input_size() < 2) return -1;
+  ArgumentHelper argument_helper(op);
+  if (argument_helper.GetRepeatedArgument<float>("x_range").size() != 2) return -1;
+  if (argument_helper.GetSingleArgument<bool>("transA", false)) return -1;
+  if (op.has_device_option() && op.device_option().device_type() != kCPU) return -1;
+
+  auto iter = producer.find(op.input(1));
+  if (iter == producer.end()) return -1;
+  const OperatorDef& weight_op = net_def.op(iter->second);
+  if (weight_op.type() != "ConstantFill") return -1;
+  ArgumentHelper weight_helper(weight_op);
+  int dtype = weight_helper.GetSingleArgument<int>("dtype", kFloat);
+  if (dtype != kFloat) return -1;
+  if (weight_helper.GetRepeatedArgument<TIndex>("shape").size() != 2) return -1;
+  return iter->second;
+}
+
+void QuantizationPass::QuantizeWeight(const OperatorDef& weight_op, bool transb,
+                                      OperatorDef* weight_q_op, OperatorDef* scale_op) {
+  ArgumentHelper weight_helper(weight_op);
+  auto shape = weight_helper.GetRepeatedArgument<TIndex>("shape");
+  auto value = weight_helper.GetRepeatedArgument<float>("value");
+  TIndex K = transb ? shape[1] : shape[0];
+  TIndex N = transb ? shape[0] : shape[1];
+  auto index = [K, N, transb](TIndex k, TIndex n) { return transb ? n * K + k : k * N + n; };
+
+  std::vector<float> scale(N, 0);
+  for (TIndex k = 0; k < K; ++k) {
+    for (TIndex n = 0; n < N; ++n) {
+      scale[n] = std::max(scale[n], fabsf(value[index(k, n)]));
+    }
+  }
+  for (auto& s : scale) s = s == 0 ? 1 : s / 127;
+  std::vector<int8_t> quantized(value.size());
+  for (TIndex k = 0; k < K; ++k) {
+    for (TIndex n = 0; n < N; ++n) {
+      float q = nearbyintf(value[index(k, n)] / scale[n]);
+      quantized[index(k, n)] = static_cast<int8_t>(std::min(127.0f, std::max(-127.0f, q)));
+    }
+  }
+
+  *weight_q_op = weight_op;
+  weight_q_op->set_name(weight_op.name() + "_int8");
+  weight_q_op->clear_output();
+  weight_q_op->add_output(weight_op.output(0) + "_int8");
+  ArgumentHelper::SetSingleArgument<int>(*weight_q_op, "dtype", kInt8);
+  for (auto i = 0; i < weight_q_op->arg_size(); ++i) {
+    if (weight_q_op->arg(i).name() == "value") {
+      weight_q_op->mutable_arg(i)->clear_floats();
+      break;
+    }
+  }
+  ArgumentHelper::SetRepeatedArgument<int8_t>(*weight_q_op, "value", quantized);
+
+  *scale_op = weight_op;
+  scale_op->set_name(weight_op.name() + "_scale");
+  scale_op->clear_output();
+  scale_op->add_output(weight_op.output(0) + "_scale");
+  ArgumentHelper::SetRepeatedArgument<TIndex>(*scale_op, "shape", std::vector<TIndex>{ N });
+  ArgumentHelper::SetRepeatedArgument<float>(*scale_op, "value", scale);
+}
+
+}  // namespace blaze
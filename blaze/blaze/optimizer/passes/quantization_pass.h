@@ -0,0 +1,36 @@
+/*!
+ * \file quantization_pass.h
+ * \brief The int8 quantization pass for calibrated Gemm ops
+ */
+#pragma once
+
+#include <unordered_map>
+
+#include "blaze/optimizer/pass.h"
+#include "blaze/graph/graph.h"
+
+namespace blaze {
+
+// Rewrites the Gemm ops carrying the x_range argument of the calibration
+// observer into QuantizedGemm ones, the constant weight is quantized to int8
+// with a scale per output channel. Nets off the cpu are left alone.
+class QuantizationPass : public Pass {
+ public:
+  QuantizationPass& Name(std::string name);
+  QuantizationPass& Type(PassType pass_type);
+
+  virtual NetDef RunPass(const NetDef& net_def);
+
+  // uint8 scale and zero point of the range, which is widened to hold zero
+  static void RangeQuantParam(float min, float max, float* scale, int* zero_point);
+
+ protected:
+  // The weight ConstantFill of a Gemm which can be quantized, -1 if none
+  int QuantizableWeight(const NetDef& net_def, const OperatorDef& op,
+                        const std::unordered_map<std::string, int>& producer);
+  // The int8 weight and the scale ConstantFill ops of the weight op
+  void QuantizeWeight(const OperatorDef& weight_op, bool transb,
+                      OperatorDef* weight_q_op, OperatorDef* scale_op);
+};
+
+}  // namespace blaze
@@ -0,0 +1,312 @@
+/*!
+ * \file sparse_gemm_pass.cc
+ * \brief The block sparse weight pass for pruned Gemm ops
+ */
+#include "blaze/optimizer/passes/sparse_gemm_pass.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "blaze/common/proto_helper.h"
+
+namespace blaze {
+
+namespace {
+
+// Above this ratio of nonzero blocks the dense gemm is faster
+const float kMaxBlockDensity = 0.6;
+
+// Set the repeated value argument of the ConstantFill op
+template <typename T>
+void SetConstantValue(OperatorDef* op, const std::string& name, int dtype,
+                      const std::vector<TIndex>& shape, const std::vector<T>& value) {
+  op->set_name(name + "_fill");
+  op->clear_output();
+  op->add_output(name);
+  op->clear_arg();
+  ArgumentHelper::SetSingleArgument<int>(*op, "dtype", dtype);
+  ArgumentHelper::SetRepeatedArgument<TIndex>(*op, "shape", shape);
+  ArgumentHelper::SetRepeatedArgument<T>(*op, "value", value);
+}
+
+}  // namespace
+
+SparseGemmPass::AccuracyCheck SparseGemmPass::accuracy_check_;
+
+SparseGemmPass& SparseGemmPass::Name(std::string name) {
+  this->name_ = name;
+  return *this;
+}
+
+SparseGemmPass& SparseGemmPass::Type(PassType pass_type) {
+  this->pass_type_ = pass_type;
+  return *this;
+}
+
+void SparseGemmPass::SetAccuracyCheck(const AccuracyCheck& accuracy_check) {
+  accuracy_check_ = accuracy_check;
+}
+
+NetDef SparseGemmPass::RunPass(const NetDef& net_def) {
+  std::unordered_map<std::string, int> producer;
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    for (const auto& oname : net_def.op(i).output()) producer[oname] = i;
+  }
+  auto consumers = NetDefHelper::ReadCounts(net_def);
+  const auto external_output = NetDefHelper::ExternalOutputs(net_def);
+
+  // The compressed weights of the gemms to rewrite, and the weights left
+  // without other consumers
+  struct Compressed {
+    int weight_idx;
+    OperatorDef values_op, col_ptr_op, row_idx_op;
+  };
+  std::unordered_map<int, Compressed> gemm_weight;
+  std::unordered_map<int, int> weight_users;
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    const OperatorDef& op = net_def.op(i);
+    int weight_idx = SparseWeight(net_def, op, producer);
+    if (weight_idx < 0) continue;
+    ArgumentHelper argument_helper(op);
+    std::vector<int> block = argument_helper.GetRepeatedArgument<int>("sparse_block");
+    bool transb = argument_helper.GetSingleArgument<bool>("transB", false);
+    Compressed compressed;
+    compressed.weight_idx = weight_idx;
+    float density = CompressWeight(net_def.op(weight_idx), transb, block[0], block[1],
+                                   &compressed.values_op, &compressed.col_ptr_op,
+                                   &compressed.row_idx_op);
+    if (density > kMaxBlockDensity) continue;
+    gemm_weight[i] = compressed;
+    weight_users[weight_idx]++;
+  }
+  if (gemm_weight.empty()) return net_def;
+
+  NetDef ret = net_def;
+  ret.clear_op();
+  std::unordered_set<int> compressed;
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    const OperatorDef& op = net_def.op(i);
+    auto iter = gemm_weight.find(i);
+    if (iter == gemm_weight.end()) {
+      bool unused = weight_users.count(i) &&
+          weight_users[i] == consumers[op.output(0)] &&
+          external_output.count(op.output(0)) == 0;
+      if (!unused) *(ret.add_op()) = op;
+      continue;
+    }
+    const Compressed& weight = iter->second;
+    if (compressed.insert(weight.weight_idx).second) {
+      *(ret.add_op()) = weight.values_op;
+      *(ret.add_op()) = weight.col_ptr_op;
+      *(ret.add_op()) = weight.row_idx_op;
+    }
+
+    ArgumentHelper argument_helper(op);
+    std::vector<int> block = argument_helper.GetRepeatedArgument<int>("sparse_block");
+    OperatorDef sop = op;
+    sop.set_type("SparseGemm");
+    sop.clear_input();
+    sop.add_input(op.input(0));
+    sop.add_input(weight.values_op.output(0));
+    sop.add_input(weight.col_ptr_op.output(0));
+    sop.add_input(weight.row_idx_op.output(0));
+    if (op.input_size() > 2) sop.add_input(op.input(2));
+    sop.clear_arg();
+    for (const auto& arg : op.arg()) {
+      if (arg.name() != "sparse_block" && arg.name() != "transA" &&
+          arg.name() != "transB") {
+        *(sop.add_arg()) = arg;
+      }
+    }
+    ArgumentHelper::SetSingleArgument<int>(sop, "block_k", block[0]);
+    ArgumentHelper::SetSingleArgument<int>(sop, "block_n", block[1]);
+    *(ret.add_op()) = sop;
+  }
+
+  if (accuracy_check_ && !accuracy_check_(net_def, ret)) {
+    LOG_INFO("the sparse gemms fail the accuracy check, keep the dense net");
+    return net_def;
+  }
+  return ret;
+}
+
+int SparseGemmPass::SparseWeight(const NetDef& net_def, const OperatorDef& op,
+                                 const std::unordered_map<std::string, int>& producer) {
+  if (op.type() != "Gemm" || op.input_size() < 2) return -1;
+  ArgumentHelper argument_helper(op);
+  std::vector<int> block = argument_helper.GetRepeatedArgument<int>("sparse_block");
+  if (block.size() != 2 || block[0] <= 0 || block[1] <= 0) return -1;
+  if (argument_helper.GetSingleArgument<bool>("transA", false)) return -1;
+
+  auto iter = producer.find(op.input(1));
+  if (iter == producer.end()) return -1;
+  const OperatorDef& weight_op = net_def.op(iter->second);
+  if (weight_op.type() != "ConstantFill") return -1;
+  ArgumentHelper weight_helper(weight_op);
+  int dtype = weight_helper.GetSingleArgument<int>("dtype", kFloat);
+  if (dtype != kFloat) return -1;
+  std::vector<TIndex> shape = weight_helper.GetRepeatedArgument<TIndex>("shape");
+  if (shape.size() != 2) return -1;
+  bool transb = argument_helper.GetSingleArgument<bool>("transB", false);
+  TIndex K = transb ? shape[1] : shape[0];
+  TIndex N = transb ? shape[0] : shape[1];
+  if (K % block[0] != 0 || N % block[1] != 0) return -1;
+
+  // SparseGemm only broadcasts a bias of the output channels
+  if (op.input_size() > 2) {
+    auto bias_iter = producer.find(op.input(2));
+    if (bias_iter == producer.end()) return -1;
+    const OperatorDef& bias_op = net_def.op(bias_iter->second);
+    if (bias_op.type() != "ConstantFill") return -1;
+    ArgumentHelper bias_helper(bias_op);
+    TIndex bias_size = 1;
+    for (auto dim : bias_helper.GetRepeatedArgument<TIndex>("shape")) bias_size *= dim;
+    if (bias_size != N) return -1;
+  }
+  return iter->second;
+}
+
+float SparseGemmPass::CompressWeight(const OperatorDef& weight_op, bool transb,
+                                     int block_k, int block_n, OperatorDef* values_op,
+                                     OperatorDef* col_ptr_op, OperatorDef* row_idx_op) {
+  ArgumentHelper weight_helper(weight_op);
+  auto shape = weight_helper.GetRepeatedArgument<TIndex>("shape");
+  auto value = weight_helper.GetRepeatedArgument<float>("value");
+  TIndex K = transb ? shape[1] : shape[0];
+  TIndex N = transb ? shape[0] : shape[1];
+  auto index = [K, N, transb](TIndex k, TIndex n) { return transb ? n * K + k : k * N + n; };
+
+  std::vector<float> values;
+  std::vector<int> col_ptr(1, 0);
+  std::vector<int> row_idx;
+  for (TIndex j = 0; j < N / block_n; ++j) {
+    for (TIndex r = 0; r < K / block_k; ++r) {
+      bool nonzero = false;
+      for (TIndex i = 0; i < block_k && !nonzero; ++i) {
+        for (TIndex l = 0; l < block_n && !nonzero; ++l) {
+          nonzero = value[index(r * block_k + i, j * block_n + l)] != 0;
+        }
+      }
+      if (!nonzero) continue;
+      row_idx.push_back(r);
+      for (TIndex i = 0; i < block_k; ++i) {
+        for (TIndex l = 0; l < block_n; ++l) {
+          values.push_back(value[index(r * block_k + i, j * block_n + l)]);
+        }
+      }
+    }
+    col_ptr.push_back(row_idx.size());
+  }
+
+  const std::string& name = weight_op.output(0);
+  *values_op = weight_op;
+  SetConstantValue<float>(values_op, name + "_values", kFloat,
+                          std::vector<TIndex>{ static_cast<TIndex>(row_idx.size()),
+                                               block_k, block_n }, values);
+  *col_ptr_op = weight_op;
+  SetConstantValue<int>(col_ptr_op, name + "_col_ptr", kInt32,
+                        std::vector<TIndex>{ static_cast<TIndex>(col_ptr.size()) }, col_ptr);
+  *row_idx_op = weight_op;
+  SetConstantValue<int>(row_idx_op, name + "_row_idx", kInt32,
+                        std::vector<TIndex>{ static_cast<TIndex>(row_idx.size()) }, row_idx);
+  return static_cast<float>(row_idx.size()) / ((K / block_k) * (N / block_n));
+}
+
+bool SparseGemmPass::PruneWeight(TIndex K, TIndex N, bool transb, const std::string& pattern,
+                                 float ratio, std::vector<float>* value,
+                                 int* block_k, int* block_n) {
+  auto index = [K, N, transb](TIndex k, TIndex n) { return transb ? n * K + k : k * N + n; };
+  std::vector<float>& w = *value;
+
+  int keep, group;
+  if (sscanf(pattern.c_str(), "%d:%d", &keep, &group) == 2) {
+    if (keep <= 0 || group <= keep || K % group != 0) return false;
+    std::vector<TIndex> order(group);
+    for (TIndex n = 0; n < N; ++n) {
+      for (TIndex k = 0; k < K; k += group) {
+        for (int i = 0; i < group; ++i) order[i] = k + i;
+        std::sort(order.begin(), order.end(), [&](TIndex x, TIndex y) {
+          return fabsf(w[index(x, n)]) > fabsf(w[index(y, n)]);
+        });
+        for (int i = keep; i < group; ++i) w[index(order[i], n)] = 0;
+      }
+    }
+    *block_k = 1;
+    *block_n = 1;
+    return true;
+  }
+
+  int rows, cols;
+  if (sscanf(pattern.c_str(), "%dx%d", &rows, &cols) != 2) return false;
+  if (rows <= 0 || cols <= 0 || K % rows != 0 || N % cols != 0) return false;
+  TIndex block_rows = K / rows;
+  TIndex block_num = block_rows * (N / cols);
+  std::vector<float> norm(block_num, 0);
+  for (TIndex k = 0; k < K; ++k) {
+    for (TIndex n = 0; n < N; ++n) {
+      float v = w[index(k, n)];
+      norm[(n / cols) * block_rows + k / rows] += v * v;
+    }
+  }
+  std::vector<TIndex> order(block_num);
+  for (TIndex b = 0; b < block_num; ++b) order[b] = b;
+  TIndex pruned = std::min(block_num, static_cast<TIndex>(ratio * block_num));
+  std::nth_element(order.begin(), order.begin() + pruned, order.end(),
+                   [&norm](TIndex x, TIndex y) { return norm[x] < norm[y]; });
+  for (TIndex p = 0; p < pruned; ++p) {
+    TIndex r = order[p] % block_rows;
+    TIndex j = order[p] / block_rows;
+    for (TIndex i = 0; i < rows; ++i) {
+      for (TIndex l = 0; l < cols; ++l) w[index(r * rows + i, j * cols + l)] = 0;
+    }
+  }
+  *block_k = rows;
+  *block_n = cols;
+  return true;
+}
+
+int SparseGemmPass::PruneNet(NetDef* net_def, const std::string& pattern, float ratio,
+                             size_t min_size) {
+  std::unordered_map<std::string, int> producer;
+  for (int i = 0; i < net_def->op_size(); ++i) {
+    for (const auto& oname : net_def->op(i).output()) producer[oname] = i;
+  }
+
+  int pruned = 0;
+  for (int i = 0; i < net_def->op_size(); ++i) {
+    OperatorDef* op = net_def->mutable_op(i);
+    if (op->type() != "Gemm" || op->input_size() < 2) continue;
+    auto iter = producer.find(op->input(1));
+    if (iter == producer.end()) continue;
+    OperatorDef* weight_op = net_def->mutable_op(iter->second);
+    if (weight_op->type() != "ConstantFill") continue;
+    ArgumentHelper weight_helper(*weight_op);
+    if (weight_helper.GetSingleArgument<int>("dtype", kFloat) != kFloat) continue;
+    std::vector<TIndex> shape = weight_helper.GetRepeatedArgument<TIndex>("shape");
+    if (shape.size() != 2 || static_cast<size_t>(shape[0] * shape[1]) < min_size) continue;
+
+    bool transb = ArgumentHelper::GetSingleArgument<OperatorDef, bool>(*op, "transB", false);
+    TIndex K = transb ? shape[1] : shape[0];
+    TIndex N = transb ? shape[0] : shape[1];
+    std::vector<float> value = weight_helper.GetRepeatedArgument<float>("value");
+    int block_k, block_n;
+    if (!PruneWeight(K, N, transb, pattern, ratio, &value, &block_k, &block_n)) continue;
+    for (auto j = 0; j < weight_op->arg_size(); ++j) {
+      if (weight_op->arg(j).name() == "value") {
+        weight_op->mutable_arg(j)->clear_floats();
+        break;
+      }
+    }
+    ArgumentHelper::SetRepeatedArgument<float>(*weight_op, "value", value);
+    ArgumentHelper::SetRepeatedArgument<int>(*op, "sparse_block",
+                                             std::vector<int>{ block_k, block_n });
+    ++pruned;
+  }
+  return pruned;
+}
+
+}  // namespace blaze
@@ -0,0 +1,58 @@
+/*!
+ * \file sparse_gemm_pass.h
+ * \brief The block sparse weight pass for pruned Gemm ops
+ */
+#pragma once
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "blaze/optimizer/pass.h"
+#include "blaze/graph/graph.h"
+
+namespace blaze {
+
+// Rewrites the Gemm ops carrying the sparse_block argument of PruneNet into
+// SparseGemm ones, the constant weight is compressed to its nonzero blocks.
+// The gemms whose weight is too dense for the block kernel to beat the dense
+// one are left alone, as is the whole net if the accuracy check rejects it.
+class SparseGemmPass : public Pass {
+ public:
+  // Whether the sparse net is accurate enough to replace the dense one
+  typedef std::function<bool(const NetDef& dense, const NetDef& sparse)> AccuracyCheck;
+
+  SparseGemmPass& Name(std::string name);
+  SparseGemmPass& Type(PassType pass_type);
+
+  virtual NetDef RunPass(const NetDef& net_def);
+
+  // The check run on the rewritten nets, none by default
+  static void SetAccuracyCheck(const AccuracyCheck& accuracy_check);
+
+  // Offline pruning of the constant weights of the Gemm ops which have at
+  // least min_size elements. The pattern is either "RxC", the ratio of the
+  // blocks of R rows along K by C columns with the smallest l2 norm are
+  // zeroed, or "N:M", N of every M rows of a column are kept and ratio is
+  // ignored. Returns the number of gemms pruned.
+  static int PruneNet(NetDef* net_def, const std::string& pattern, float ratio,
+                      size_t min_size);
+  // Prune the K x N weight to pattern, false if pattern does not tile it
+  static bool PruneWeight(TIndex K, TIndex N, bool transb, const std::string& pattern,
+                          float ratio, std::vector<float>* value, int* block_k, int* block_n);
+
+ protected:
+  // The weight ConstantFill of a pruned Gemm, -1 if none
+  int SparseWeight(const NetDef& net_def, const OperatorDef& op,
+                   const std::unordered_map<std::string, int>& producer);
+  // The values, col_ptr and row_idx ConstantFill ops of the nonzero blocks
+  // of the weight op, returns the ratio of the nonzero blocks
+  float CompressWeight(const OperatorDef& weight_op, bool transb, int block_k, int block_n,
+                       OperatorDef* values_op, OperatorDef* col_ptr_op,
+                       OperatorDef* row_idx_op);
+
+  static AccuracyCheck accuracy_check_;
+};
+
+}  // namespace blaze
@@ -0,0 +1,295 @@
+/*!
+ * \file target_attention_fusion_pass.cc
+ * \brief The target attention fusion pass for the DIN/DIEN attention subgraph
+ */
+#include "blaze/optimizer/passes/target_attention_fusion_pass.h"
+
+#include <algorithm>
+
+#include "blaze/common/proto_helper.h"
+#include "blaze/operator/fused_op/fused_target_attention_op.h"
+
+namespace blaze {
+
+TargetAttentionFusionPass& TargetAttentionFusionPass::Name(std::string name) {
+  this->name_ = name;
+  return *this;
+}
+
+TargetAttentionFusionPass& TargetAttentionFusionPass::Type(PassType pass_type) {
+  this->pass_type_ = pass_type;
+  return *this;
+}
+
+NetDef TargetAttentionFusionPass::RunPass(const NetDef& net_def) {
+  external_output_ = NetDefHelper::ExternalOutputs(net_def);
+  consumer_ = NetDefHelper::SingleConsumers(net_def);
+  reads_ = NetDefHelper::ReadCounts(net_def);
+  producer_.clear();
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    for (const auto& name : net_def.op(i).output()) producer_[name] = i;
+  }
+
+  // The fused ops, keyed by the position of the last op of the attention
+  std::unordered_map<int, OperatorDef> fused_ops;
+  std::vector<bool> removed(net_def.op_size(), false);
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    if (net_def.op(i).type() != "Concat" || removed[i]) continue;
+    std::vector<int> ops;
+    OperatorDef fused_op;
+    if (!Fuse(net_def, i, &ops, &fused_op)) continue;
+    bool overlapped = false;
+    for (int idx : ops) overlapped = overlapped || removed[idx];
+    if (overlapped) continue;
+    for (int idx : ops) removed[idx] = true;
+    fused_ops[*std::max_element(ops.begin(), ops.end())] = fused_op;
+  }
+  if (fused_ops.empty()) return net_def;
+
+  NetDef ret = net_def;
+  ret.clear_op();
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    const auto& iter = fused_ops.find(i);
+    if (iter != fused_ops.end()) {
+      *ret.add_op() = iter->second;
+    } else if (!removed[i]) {
+      *ret.add_op() = net_def.op(i);
+    }
+  }
+  LOG_DEBUG("target attention fusion: %u attentions fused", fused_ops.size());
+  return ret;
+}
+
+int TargetAttentionFusionPass::Consumer(const std::string& blob) const {
+  if (external_output_.count(blob)) return -1;
+  const auto& iter = consumer_.find(blob);
+  return iter == consumer_.end() ? -1 : iter->second;
+}
+
+int TargetAttentionFusionPass::Producer(const std::string& blob) const {
+  const auto& iter = producer_.find(blob);
+  return iter == producer_.end() ? -1 : iter->second;
+}
+
+bool TargetAttentionFusionPass::MatchTail(const NetDef& net_def,
+                                          const std::string& concat_output, Match* match) {
+  std::string blob = concat_output;
+  int idx = Consumer(blob);
+  // The gemms of the mlp, on the output of the last one
+  while (idx >= 0) {
+    const OperatorDef& op = net_def.op(idx);
+    if (op.type() != "Gemm" && op.type() != "FusedGemmEpilogue") break;
+    if (op.input_size() < 2 || op.input(0) != blob || op.output_size() != 1) return false;
+    ArgumentHelper argument_helper(op);
+    if (argument_helper.GetSingleArgument<bool>("transA", false) ||
+        argument_helper.GetSingleArgument<float>("alpha", 1.0) != 1.0) {
+      return false;
+    }
+    if (op.type() == "Gemm" && op.input_size() > 2 &&
+        argument_helper.GetSingleArgument<float>("beta", 1.0) != 1.0) {
+      return false;
+    }
+    match->layers.push_back(idx);
+    match->ops.push_back(idx);
+    blob = op.output(0);
+    idx = Consumer(blob);
+  }
+  if (match->layers.empty() || idx < 0) return false;
+
+  // The score [B, T, 1] may be reshaped to [B, 1, T]
+  bool reshaped = false;
+  if (net_def.op(idx).type() == "Reshape") {
+    if (net_def.op(idx).input(0) != blob) return false;
+    reshaped = true;
+    match->ops.push_back(idx);
+    blob = net_def.op(idx).output(0);
+    idx = Consumer(blob);
+    if (idx < 0) return false;
+  }
+  if (net_def.op(idx).type() == "Where") {
+    const OperatorDef& op = net_def.op(idx);
+    if (op.input_size() != 3 || op.input(1) != blob || op.input(0) == blob ||
+        op.input(2) == blob) {
+      return false;
+    }
+    match->mask = op.input(0);
+    match->ops.push_back(idx);
+    blob = op.output(0);
+    idx = Consumer(blob);
+    if (idx < 0) return false;
+  }
+  if (net_def.op(idx).type() == "Softmax") {
+    ArgumentHelper argument_helper(net_def.op(idx));
+    if (argument_helper.GetSingleArgument<size_t>("axis", 1) == 0) return false;
+    match->softmax = true;
+    match->ops.push_back(idx);
+    blob = net_def.op(idx).output(0);
+    idx = Consumer(blob);
+    if (idx < 0) return false;
+  }
+
+  // The weighted pooling of the keys
+  const OperatorDef& op = net_def.op(idx);
+  if (op.input_size() != 2 || op.input(0) == op.input(1)) return false;
+  if (op.type() == "MatMul") {
+    ArgumentHelper argument_helper(op);
+    bool transa = argument_helper.GetSingleArgument<bool>("transA", false);
+    if (op.input(0) != blob || transa == reshaped ||
+        argument_helper.GetSingleArgument<bool>("transB", false)) {
+      return false;
+    }
+    match->key = op.input(1);
+    match->keepdims = true;
+    match->ops.push_back(idx);
+    return true;
+  }
+  if (op.type() != "Mul" || reshaped) return false;
+  match->key = op.input(0) == blob ? op.input(1) : op.input(0);
+  match->ops.push_back(idx);
+  idx = Consumer(op.output(0));
+  if (idx < 0 || net_def.op(idx).type() != "ReduceSum") return false;
+  ArgumentHelper argument_helper(net_def.op(idx));
+  std::vector<int> axes = argument_helper.GetRepeatedArgument<int>("axes");
+  if (axes.empty()) axes.push_back(argument_helper.GetSingleArgument<int>("axis", 0));
+  if (axes.size() != 1 || axes[0] != 1) return false;
+  match->keepdims = argument_helper.GetSingleArgument<int>("keepdims", 1) != 0;
+  match->ops.push_back(idx);
+  return true;
+}
+
+bool TargetAttentionFusionPass::Fuse(const NetDef& net_def, int concat_idx,
+                                     std::vector<int>* ops, OperatorDef* fused_op) {
+  const OperatorDef& concat = net_def.op(concat_idx);
+  ArgumentHelper concat_helper(concat);
+  int axis = concat_helper.GetSingleArgument<int>("axis", 1);
+  if ((axis != 2 && axis != -1) || concat.input_size() < 2 ||
+      concat.input_size() > kMaxAttentionInteractions || concat.output_size() != 1) {
+    return false;
+  }
+
+  // The Sub and Mul of the query and the key, read by the concat only
+  std::vector<int> interactions(concat.input_size(), -1);
+  std::string a, b;
+  for (int k = 0; k < concat.input_size(); ++k) {
+    int idx = Producer(concat.input(k));
+    if (idx < 0 || Consumer(concat.input(k)) != concat_idx) continue;
+    const OperatorDef& op = net_def.op(idx);
+    if ((op.type() != "Sub" && op.type() != "Mul") || op.input_size() != 2 ||
+        op.input(0) == op.input(1)) {
+      continue;
+    }
+    if (a.empty()) {
+      a = op.input(0);
+      b = op.input(1);
+    } else if (!((op.input(0) == a && op.input(1) == b) ||
+                 (op.input(0) == b && op.input(1) == a))) {
+      return false;
+    }
+    interactions[k] = idx;
+  }
+  if (a.empty()) return false;
+
+  Match match;
+  if (!MatchTail(net_def, concat.output(0), &match)) return false;
+  if (match.key != a && match.key != b) return false;
+  const std::string& key = match.key;
+  const std::string& query = match.key == a ? b : a;
+
+  std::vector<std::string> names;
+  int query_reads = 0;
+  ops->clear();
+  ops->push_back(concat_idx);
+  for (int k = 0; k < concat.input_size(); ++k) {
+    const std::string& input = concat.input(k);
+    if (interactions[k] >= 0) {
+      const OperatorDef& op = net_def.op(interactions[k]);
+      if (op.type() == "Mul") {
+        names.push_back("query_mul_key");
+      } else {
+        names.push_back(op.input(0) == query ? "query_sub_key" : "key_sub_query");
+      }
+      ops->push_back(interactions[k]);
+      ++query_reads;
+    } else if (input == query) {
+      names.push_back("query");
+      ++query_reads;
+    } else if (input == key) {
+      names.push_back("key");
+    } else {
+      return false;
+    }
+  }
+  ops->insert(ops->end(), match.ops.begin(), match.ops.end());
+
+  // The query broadcast to the keys is read by the attention only
+  std::string query_input = query;
+  int broadcast_idx = Producer(query);
+  if (broadcast_idx >= 0 && net_def.op(broadcast_idx).type() == "BroadcastTo" &&
+      !external_output_.count(query) && reads_[query] == query_reads) {
+    query_input = net_def.op(broadcast_idx).input(0);
+    ops->push_back(broadcast_idx);
+  }
+
+  const std::string device = concat.device_option().SerializeAsString();
+  for (int idx : *ops) {
+    if (net_def.op(idx).device_option().SerializeAsString() != device) return false;
+  }
+
+  const OperatorDef& last = net_def.op(match.ops.back());
+  fused_op->Clear();
+  fused_op->set_type("FusedTargetAttention");
+  fused_op->set_name(last.name());
+  if (concat.has_device_option()) {
+    fused_op->mutable_device_option()->CopyFrom(concat.device_option());
+  }
+  fused_op->add_input(query_input);
+  fused_op->add_input(key);
+  if (!match.mask.empty()) fused_op->add_input(match.mask);
+  fused_op->add_output(last.output(0));
+
+  // The layers with the gemm bias as the first step, as FusedGemmEpilogue
+  std::vector<int> layer_inputs, layer_steps, layer_transb;
+  std::vector<std::string> types;
+  std::vector<int> operands, swaps;
+  std::vector<float> args;
+  for (int idx : match.layers) {
+    const OperatorDef& op = net_def.op(idx);
+    ArgumentHelper argument_helper(op);
+    for (int k = 1; k < op.input_size(); ++k) fused_op->add_input(op.input(k));
+    layer_inputs.push_back(op.input_size() - 1);
+    layer_transb.push_back(argument_helper.GetSingleArgument<bool>("transB", false));
+    if (op.type() == "Gemm") {
+      layer_steps.push_back(op.input_size() > 2 ? 1 : 0);
+      if (op.input_size() > 2) {
+        types.push_back("Add");
+        operands.insert(operands.end(), { 2, -1, -1 });
+        swaps.push_back(0);
+        args.push_back(0);
+      }
+      continue;
+    }
+    std::vector<std::string> step_type = argument_helper.GetRepeatedArgument<std::string>("step_type");
+    std::vector<int> step_operand = argument_helper.GetRepeatedArgument<int>("step_operand");
+    std::vector<int> step_swap = argument_helper.GetRepeatedArgument<int>("step_swap");
+    std::vector<float> step_arg = argument_helper.GetRepeatedArgument<float>("step_arg");
+    layer_steps.push_back(step_type.size());
+    types.insert(types.end(), step_type.begin(), step_type.end());
+    operands.insert(operands.end(), step_operand.begin(), step_operand.end());
+    swaps.insert(swaps.end(), step_swap.begin(), step_swap.end());
+    args.insert(args.end(), step_arg.begin(), step_arg.end());
+  }
+  ArgumentHelper::SetRepeatedArgument<std::string>(*fused_op, "interaction", names);
+  ArgumentHelper::SetSingleArgument<bool>(*fused_op, "masked", !match.mask.empty());
+  ArgumentHelper::SetSingleArgument<bool>(*fused_op, "softmax", match.softmax);
+  ArgumentHelper::SetSingleArgument<bool>(*fused_op, "keepdims", match.keepdims);
+  ArgumentHelper::SetRepeatedArgument<int>(*fused_op, "layer_inputs", layer_inputs);
+  ArgumentHelper::SetRepeatedArgument<int>(*fused_op, "layer_steps", layer_steps);
+  ArgumentHelper::SetRepeatedArgument<int>(*fused_op, "layer_transb", layer_transb);
+  ArgumentHelper::SetRepeatedArgument<std::string>(*fused_op, "step_type", types);
+  ArgumentHelper::SetRepeatedArgument<int>(*fused_op, "step_operand", operands);
+  ArgumentHelper::SetRepeatedArgument<int>(*fused_op, "step_swap", swaps);
+  ArgumentHelper::SetRepeatedArgument<float>(*fused_op, "step_arg", args);
+  return true;
+}
+
+}  // namespace blaze
@@ -0,0 +1,60 @@
+/*!
+ * \file target_attention_fusion_pass.h
+ * \brief The target attention fusion pass for the DIN/DIEN attention subgraph
+ */
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "blaze/optimizer/pass.h"
+#include "blaze/graph/graph.h"
+
+namespace blaze {
+
+// Fuses the target attention subgraph into a FusedTargetAttention op:
+//
+//   BroadcastTo(Q) -> Sub/Mul(Q, K) -> Concat(axis=-1)
+//     -> Gemm/FusedGemmEpilogue ... -> [Reshape] -> [Where(mask)] -> [Softmax]
+//     -> MatMul(score, K) or ReduceSum(Mul(score, K), axis=1)
+//
+// The mlp is the gemms as fused by the GemmEpiloguePass.
+class TargetAttentionFusionPass : public Pass {
+ public:
+  TargetAttentionFusionPass& Name(std::string name);
+  TargetAttentionFusionPass& Type(PassType pass_type);
+
+  virtual NetDef RunPass(const NetDef& net_def);
+
+ protected:
+  // The layers of the mlp and the tail of the attention on the concat op
+  struct Match {
+    std::vector<int> ops;
+    std::vector<int> layers;
+    std::string key;
+    std::string mask;
+    bool softmax = false;
+    bool keepdims = false;
+  };
+
+  // The FusedTargetAttention op of the attention on concat_idx, false if
+  // the subgraph is not a target attention
+  bool Fuse(const NetDef& net_def, int concat_idx, std::vector<int>* ops, OperatorDef* fused_op);
+  // The mlp and the tail after the concat output
+  bool MatchTail(const NetDef& net_def, const std::string& concat_output, Match* match);
+  // The sole consumer of blob, -1 if it is an output or read more than once
+  int Consumer(const std::string& blob) const;
+  // The producer of blob, -1 if it is an input
+  int Producer(const std::string& blob) const;
+
+  std::unordered_set<std::string> external_output_;
+  // The consumer of the blobs, -1 if consumed more than once
+  std::unordered_map<std::string, int> consumer_;
+  std::unordered_map<std::string, int> producer_;
+  // The reads of the blobs
+  std::unordered_map<std::string, int> reads_;
+};
+
+}  // namespace blaze
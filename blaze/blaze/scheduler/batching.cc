@@ -4,6 +4,9 @@
  */
 
 #include "blaze/scheduler/batching.h"
+
+#include <algorithm>
+
 #include "blaze/common/log.h"
 #include "blaze/common/context.h"
 
@@ -65,88 +68,100 @@ TIndex Batching::CalcSumOfFirstDim(std::vector<Net*>& nets,
   return first_dim_sum;
 }
 
-void Batching::BackupData(const Net* net, const std::string& blob_name,
-    Blob* backup_blob) {
-#if USE_CUDA
-  auto blob = net->external_input_blob(blob_name);
-  TIndex data_size = blob->size() * DataTypeSize(blob->data_type());
-  backup_blob->Reshape(blob->shape());
-  CUDAContext context(net->device_option()); 
-  cudaStream_t stream = context.cuda_stream();
-  CUDA_CHECK(cudaMemcpyAsync(backup_blob->data(), blob->data(),
-      data_size, cudaMemcpyDeviceToDevice, stream));
-  context.FinishDeviceComputation();
-#endif // USE_CUDA
+TIndex Batching::OriginalFirstDim(Net* net, const std::string& blob_name,
+    bool merged_net) {
+  if (merged_net) {
+    auto iter = blob_first_dim_.find(blob_name);
+    if (iter != blob_first_dim_.end()) {
+      return iter->second;
+    }
+  }
+  return net->external_input_blob(blob_name)->dim(0);
 }
 
-void Batching::ReshapeMergedNet(std::vector<Net*>& nets,
-    const std::string& blob_name, Net* merged_net) {
-  TIndex first_dim_sum = CalcSumOfFirstDim(nets, blob_name); 
-  auto blob = merged_net->external_input_blob(blob_name);
-  auto merged_dims = blob->shape();
-  merged_dims[0] = first_dim_sum;
-  blob->Reshape(merged_dims);
-} 
-
-void Batching::RestoreData(const Blob& backup_blob, Net* net,
-    const std::string& blob_name, TIndex* offset) {
-#if USE_CUDA
-  auto blob = net->external_input_blob(blob_name);
-  CUDAContext context(net->device_option()); 
-  cudaStream_t stream = context.cuda_stream();
-  TIndex data_size = backup_blob.size() * DataTypeSize(backup_blob.data_type());
-  CUDA_CHECK(cudaMemcpyAsync(blob->data(), backup_blob.data(),
-      data_size, cudaMemcpyDeviceToDevice, stream));
-  *offset = data_size;
-  context.FinishDeviceComputation();
-#endif // USE_CUDA
+Blob* Batching::BatchedInput(const std::string& blob_name, const Blob& like,
+    TIndex size, std::vector<std::unique_ptr<Blob>>* retired) {
+  auto& batched = batched_input_[blob_name];
+  TIndex capacity = size;
+  if (batched != nullptr) {
+    if (batched->data_type() == like.data_type() && batched->capacity() >= size) {
+      return batched.get();
+    }
+    // grow geometrically, so that the batches of similar sizes reuse it
+    if (batched->data_type() == like.data_type()) {
+      capacity = std::max(size, 2 * batched->capacity());
+    }
+    // the merged net's blob may still be a view of the replaced one
+    retired->push_back(std::move(batched));
+  }
+  batched.reset(new Blob(like.device_option()));
+  batched->set_data_type(static_cast<DataType>(like.data_type()));
+  batched->Reshape({ capacity });
+  return batched.get();
 }
 
-void Batching::CopyDataToMergedNet(const Net* net, const std::string& blob_name,
-      CUDAContext& context, Net* merged_net, TIndex* offset) {
+Blob* Batching::GatherInput(std::vector<Net*>& nets, const std::string& blob_name,
+    CUDAContext& context, std::vector<std::unique_ptr<Blob>>* retired) {
+  auto merged_blob = nets[0]->external_input_blob(blob_name);
+  TIndex size = merged_blob->size(1, merged_blob->shape().size()) *
+      CalcSumOfFirstDim(nets, blob_name);
+  Blob* batched = BatchedInput(blob_name, *merged_blob, size, retired);
 #if USE_CUDA
-  auto src_blob = net->external_input_blob(blob_name);
   cudaStream_t stream = context.cuda_stream();
-  auto dst_blob = merged_net->external_input_blob(blob_name); 
-  TIndex data_size = src_blob->size() * DataTypeSize(src_blob->data_type());
-  CUDA_CHECK(cudaMemcpyAsync(dst_blob->as<char>() + *offset, src_blob->data(),
-      data_size, cudaMemcpyDeviceToDevice, stream));
-  *offset += data_size;
+  TIndex offset = 0;
+  for (auto net : nets) {
+    auto blob = net->external_input_blob(blob_name);
+    TIndex data_size = blob->size() * DataTypeSize(blob->data_type());
+    char* slice = batched->as<char>() + offset;
+    // the view of the merged net of last batch is fed in place
+    if (blob->data() != slice) {
+      CUDA_CHECK(cudaMemcpyAsync(slice, blob->data(), data_size,
+          cudaMemcpyDeviceToDevice, stream));
+    }
+    offset += data_size;
+  }
 #endif // USE_CUDA
+  return batched;
 }
 
 bool Batching::Merge(std::vector<Net*>& src_nets, Net** dst_net) {
 #if USE_CUDA
   // always choose first net as dst_net  
-  if (0 == src_nets.size() && nullptr == dst_net) {
+  if (0 == src_nets.size() || nullptr == dst_net) {
     LOG_ERROR("Input src nets is empty, or dst_net is nullptr");
     return false;
   }
   *dst_net = src_nets[0];  
 
   BackupFirstDim(*dst_net); 
+  level_lens_.clear();
+  // a single net runs as it is
+  if (1 == src_nets.size()) {
+    return true;
+  }
+  // the common ops run on the merged inputs, none of the nets keeps its own
+  for (auto net : src_nets) net->InvalidateCommon();
 
   std::unordered_map<std::string, Blob*> non_indicator_blobs_map;
   GetNonIndicatorBlobs(*dst_net, &non_indicator_blobs_map); 
   CUDAContext context((*dst_net)->device_option()); 
-  Blob backup_blob((*dst_net)->device_option());
+  std::vector<std::unique_ptr<Blob>> retired;
+  std::unordered_map<std::string, Blob*> batched_blobs_map;
   for (auto& blob_pair : non_indicator_blobs_map) {
-    // backup old data of dst net
-    BackupData(*dst_net, blob_pair.first, &backup_blob);
-    // reshape dst net 
-    ReshapeMergedNet(src_nets, blob_pair.first, *dst_net);
-    // restore data of dst net
-    TIndex dst_data_offset;
-    RestoreData(backup_blob, *dst_net,
-        blob_pair.first, &dst_data_offset);  
-    // copy data from nets except the first net to dst net
-    for (int i = 1; i < src_nets.size(); ++i) {
-      CopyDataToMergedNet(src_nets[i], blob_pair.first, context,
-          *dst_net, &dst_data_offset); 
-    }
+    // copy data of the nets into the slices of the batched input
+    batched_blobs_map[blob_pair.first] = GatherInput(src_nets,
+        blob_pair.first, context, &retired);
   }
   context.FinishDeviceComputation();
 
+  // the inputs of dst net are views of the batched inputs
+  for (auto& blob_pair : non_indicator_blobs_map) {
+    auto merged_dims = blob_pair.second->shape();
+    merged_dims[0] = CalcSumOfFirstDim(src_nets, blob_pair.first);
+    blob_pair.second->RefReshape(merged_dims,
+        batched_blobs_map[blob_pair.first]->data());
+  }
+
   // specially handle some inputs, such as: indicators
   HandleIndicators(src_nets);
 #endif // USE_CUDA
@@ -166,6 +181,7 @@ bool Batching::Split(Net* src_net, std::vector<Net*>* dst_nets) {
     // NOTE: empty level_lens_ means that there is no need to split
     return true;
   }
+  src_net->InvalidateCommon();
   // for output blobs: always split src net by the lens of level 0 
   auto& lens = level_lens_[0];
   auto& output_blobs_map = src_net->external_output_blob();
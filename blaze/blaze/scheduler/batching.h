@@ -6,6 +6,8 @@
 #ifndef BLAZE_SCHEDULER_BATCHING_H_
 #define BLAZE_SCHEDULER_BATCHING_H_
 
+#include <memory>
+#include <string>
 #include <vector>
 #include <unordered_map>
 #include "blaze/graph/net.h"
@@ -40,22 +42,25 @@ class Batching {
   // get the sum of first dim 
   TIndex CalcSumOfFirstDim(std::vector<Net*>& nets,
       const std::string& blob_name);
-  // Backup the data of the first net's blob
-  void BackupData(const Net* net, const std::string& blob_name,
-      Blob* backup_blob);
-  // Reshape merged net 
-  void ReshapeMergedNet(std::vector<Net*>& nets, const std::string& blob_name, Net* merged_net); 
-  // Restore the data from backup space
-  void RestoreData(const Blob& backup_blob, Net* net,
-      const std::string& blob_name, TIndex* offset);
-  // Copy the data of some net to the specified location of merged net   
-  void CopyDataToMergedNet(const Net* net, const std::string& blob_name,
-      CUDAContext& context, Net* merged_net, TIndex* offset);
+  // the first dim of the blob before merging, as the merged net's
+  // blob has been expanded
+  TIndex OriginalFirstDim(Net* net, const std::string& blob_name, bool merged_net);
+  // the batched input blob of blob_name which holds size elements,
+  // the replaced one is kept in retired until the gathering completes
+  Blob* BatchedInput(const std::string& blob_name, const Blob& like, TIndex size,
+      std::vector<std::unique_ptr<Blob>>* retired);
+  // gather the blob of the nets into the slices of the batched input blob
+  Blob* GatherInput(std::vector<Net*>& nets, const std::string& blob_name,
+      CUDAContext& context, std::vector<std::unique_ptr<Blob>>* retired);
 
   // lens of each layer    
   std::vector<std::vector<TIndex>> level_lens_;
   // blob & net's first dim
   std::unordered_map<std::string, TIndex> blob_first_dim_; 
+  // the pre-allocated batched input blobs, the merged net's input blob stays
+  // a view of the head of it after the split, so the next feed of that net
+  // writes into its slice directly
+  std::unordered_map<std::string, std::unique_ptr<Blob>> batched_input_;
 }; 
 
 } // namespace blaze
@@ -25,11 +25,10 @@ bool FlattenedBatching::HandleIndicators(std::vector<Net*>& nets) {
 
   level_lens_.resize(1u);
   // update lens of each net      
-  for (auto& net : nets) {
+  for (size_t i = 0; i < nets.size(); ++i) {
     // NOTE: use input blob here instead of output blob,
     // since output blob of first net has been expanded
-    auto input_blob = net->external_input_blob(one_name); 
-    level_lens_[0].push_back(input_blob->dim(0)); 
+    level_lens_[0].push_back(OriginalFirstDim(nets[i], one_name, i == 0)); 
   } 
 
   return true;
@@ -5,12 +5,15 @@
 #ifndef BLAZE_SCHEDULER_SCHEDULER_MANAGER_H_
 #define BLAZE_SCHEDULER_SCHEDULER_MANAGER_H_
 
+#include <algorithm>
 #include <unordered_map>
 #include <memory>
 #include <mutex>
+#include <vector>
 #include "blaze/scheduler/scheduler.h"
 #include "blaze/batching/shared_batch_scheduler.h"
 #include "blaze/scheduler/simple_scheduler.h"
+#include "blaze/common/numa.h"
 #include "blaze/proto/blaze.pb.h"
 
 namespace blaze {
@@ -48,6 +51,21 @@ class SchedulerManager {
     // maximum allowable number of enqueued tasks in terms of batches
     // if this limit is reached, Schedule will return an Unavailable error
     int max_enqueued_batches = 500;
+    // p99 latency target of each model (microseconds), the batch size and
+    // timeout above are adapted under it if positive
+    int latency_target_micros = 0;
+    // batch sizes the adaptive batch size takes, such as the precompiled shapes
+    std::vector<int> batch_size_buckets;
+    // create a cpu scheduler per numa node, whose device id is the node,
+    // and bind the threads of the cpu and gpu schedulers to their node
+    bool numa_aware = false;
+    // the openmp and mkl threads of each cpu scheduler thread, 0 for its
+    // share of the cores of its node, or of the process if not numa aware,
+    // so that the scheduler threads and their intra op threads add up to the
+    // cores. The cuda and pipe scheduler threads run their ops single threaded.
+    int intra_op_threads = 0;
+    // bind each cpu scheduler thread to its own intra_op_threads cores
+    bool pin_cores = false;
   };
 
   // Singleton instance
@@ -67,6 +85,9 @@ class SchedulerManager {
   // Init schedulers for all devices, thread safe 
   bool Init(const Options& options);
 
+  // Whether the cpu schedulers are per numa node
+  bool numa_aware() const { return options_.numa_aware; }
+
   inline Scheduler* GetScheduler(const DeviceOption& device_option) const {
     if (device_option.device_type() == kCUDA && !device_option.is_pipe()) {
       // for cuda
@@ -93,7 +114,8 @@ class SchedulerManager {
   // each net_def is mapped to a BatchedQueue
   batching::BatchScheduler<TaskType>* GetBatchedQueue(const NetDef* net_def,
       std::function<void(std::unique_ptr<batching::Batch<TaskType>>)> process_cb,
-      batching::SharedBatchScheduler<TaskType>* batch_scheduler) {
+      batching::SharedBatchScheduler<TaskType>* batch_scheduler,
+      std::function<void(std::unique_ptr<TaskType>)> drop_cb = nullptr) {
     auto it = net_def_batched_queue_.find(net_def);
     if (it != net_def_batched_queue_.end()) {
       return it->second.get();
@@ -107,12 +129,23 @@ class SchedulerManager {
     queue_options.max_batch_size = options_.max_batch_size;
     queue_options.batch_timeout_micros = options_.batch_timeout_micros;
     queue_options.max_enqueued_batches = options_.max_enqueued_batches;
+    queue_options.latency_target_micros = options_.latency_target_micros;
+    queue_options.batch_size_buckets = options_.batch_size_buckets;
+    queue_options.drop_task_callback = drop_cb;
     std::unique_ptr<batching::BatchScheduler<TaskType>> queue; 
     batch_scheduler->AddQueue(queue_options, process_cb, &queue);
     net_def_batched_queue_[net_def] = std::move(queue);
     return net_def_batched_queue_[net_def].get();
   }
 
+  // the batch stats of the net_def, empty if it has no BatchedQueue
+  batching::BatchStats GetBatchStats(const NetDef* net_def) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = net_def_batched_queue_.find(net_def);
+    if (it == net_def_batched_queue_.end()) return batching::BatchStats();
+    return it->second->stats();
+  }
+
   // when a workspace is destroyed
   // its corresponding batchedQueue should be released as well
   void ReleaseBatchedQueue(const NetDef* net_def) {
@@ -125,7 +158,8 @@ class SchedulerManager {
   using DeviceOptionScheduler = std::unordered_map<int, DeviceIdScheduler>;
   
   bool InitOneScheduler(int num_threads, int queue_capacity,
-      int device_count, int device_type, DeviceOptionScheduler* schedulers);
+      int device_count, int device_type, DeviceOptionScheduler* schedulers,
+      int intra_op_threads = 1, bool pin_cores = false);
 
   SchedulerManager() : has_init_(false) {
   }
@@ -145,11 +179,22 @@ class SchedulerManager {
 
 template <typename TaskType>
 bool SchedulerManager<TaskType>::InitOneScheduler(int num_threads, int queue_capacity,
-    int device_count, int device_type, DeviceOptionScheduler* schedulers) {
+    int device_count, int device_type, DeviceOptionScheduler* schedulers,
+    int intra_op_threads, bool pin_cores) {
   typename SimpleScheduler<TaskType>::Options options;
   options.num_threads = num_threads;
   options.queue_capacity = queue_capacity;
+  options.pin_cores = pin_cores;
   for (int i = 0; i < device_count; ++i) {
+    if (options_.numa_aware) {
+      options.numa_node = device_type == kCPU ? i : GpuNumaNode(i);
+    }
+    options.intra_op_threads = intra_op_threads;
+    if (intra_op_threads <= 0) {
+      size_t cpu_num = options.numa_node >= 0 ? NumaNodeCpus(options.numa_node).size() :
+          ProcessCpus().size();
+      options.intra_op_threads = std::max<int>(1, cpu_num / std::max(num_threads, 1));
+    }
     std::shared_ptr<SimpleScheduler<TaskType>> scheduler;
     RET_IF_FAILED(SimpleScheduler<TaskType>::Create(options, &scheduler),
         "Create simple scheduler failed");
@@ -201,7 +246,8 @@ bool SchedulerManager<TaskType>::Init(const Options& options) {
 
   // for cpu 
   RET_IF_FAILED(InitOneScheduler(options.num_threads_for_cpu,
-        options.queue_capacity, 1, kCPU, &schedulers_),
+        options.queue_capacity, options.numa_aware ? NumaNodeNum() : 1, kCPU, &schedulers_,
+        options.intra_op_threads, options.pin_cores),
       "Create simple scheduler for cpu failed");
 
   has_init_ = true;
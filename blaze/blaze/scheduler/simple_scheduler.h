@@ -5,6 +5,7 @@
 #ifndef BLAZE_SCHEDULER_SIMPLE_SCHEDULER_H_
 #define BLAZE_SCHEDULER_SIMPLE_SCHEDULER_H_
 
+#include <algorithm>
 #include <memory>
 #include <queue>
 #include <vector>
@@ -12,7 +13,9 @@
 #include <mutex>
 #include <condition_variable>
 #include "blaze/scheduler/scheduler.h"
+#include "blaze/common/intra_op.h"
 #include "blaze/common/log.h"
+#include "blaze/common/numa.h"
 #include "blaze/common/semaphore.h"
 
 namespace blaze {
@@ -31,6 +34,13 @@ class SimpleScheduler : public Scheduler {
     int num_threads = 10;
     // The queue capacity for pending tasks
     int queue_capacity = 100;
+    // The numa node the threads are bound to, unbound if negative
+    int numa_node = -1;
+    // The intra op threads of each thread, kept if not positive
+    int intra_op_threads = 0;
+    // Bind each thread to its own intra_op_threads cores of the numa node,
+    // or of the process if unbound, which its intra op threads inherit
+    bool pin_cores = false;
   };
 
   static bool Create(const Options& options,
@@ -54,6 +64,9 @@ class SimpleScheduler : public Scheduler {
 
   explicit SimpleScheduler(const Options& options);
   
+  // The cores of the idx-th thread if the cores are pinned
+  static std::vector<int> ThreadCpus(const Options& options, int idx);
+
   void ProcessBody();
 
   std::queue<QueueNode> queue_;
@@ -81,13 +94,41 @@ SimpleScheduler<TaskType>::SimpleScheduler(const Options& options)
     : stop_running_(false) {
   // init queue and thread pool by input options 
   queue_capacity_ = options.queue_capacity;
+  const int numa_node = options.numa_node;
+  const int intra_op_threads = options.intra_op_threads;
   for (int i = 0; i < options.num_threads; ++i) {
+    std::vector<int> cpus;
+    if (options.pin_cores) cpus = ThreadCpus(options, i);
     thread_pool_.emplace_back(new std::thread(
-          [this] {this->ProcessBody();}));
+          [this, numa_node, intra_op_threads, cpus] {
+            if (!cpus.empty()) {
+              BindThreadToCpus(cpus);
+            } else if (numa_node >= 0) {
+              BindThreadToNumaNode(numa_node);
+            }
+            SetIntraOpThreads(intra_op_threads);
+            this->ProcessBody();
+          }));
   }
   empty_.Init(queue_capacity_);
 }
 
+template <typename TaskType>
+std::vector<int> SimpleScheduler<TaskType>::ThreadCpus(const Options& options, int idx) {
+  std::vector<int> cpus = options.numa_node >= 0 ? NumaNodeCpus(options.numa_node) :
+      ProcessCpus();
+  if (cpus.empty()) return cpus;
+  int cores = options.intra_op_threads > 0 ? options.intra_op_threads :
+      std::max<int>(1, cpus.size() / options.num_threads);
+  cores = std::min<int>(cores, cpus.size());
+  // the threads beyond the cores share them round robin
+  std::vector<int> thread_cpus;
+  for (int k = 0; k < cores; ++k) {
+    thread_cpus.push_back(cpus[(idx * cores + k) % cpus.size()]);
+  }
+  return thread_cpus;
+}
+
 template <typename TaskType>
 SimpleScheduler<TaskType>::~SimpleScheduler() {
   stop_running_ = true;
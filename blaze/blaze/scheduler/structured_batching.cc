@@ -120,9 +120,8 @@ bool StructuredBatching::HandleIndicators(std::vector<Net*>& nets) {
     string one_name = blob_map.begin()->first;
     level_lens_.resize(1u);
     // update lens of each net      
-    for (auto& net : nets) {
-      auto input_blob = net->external_input_blob(one_name); 
-      level_lens_[0].push_back(input_blob->dim(0)); 
+    for (size_t i = 0; i < nets.size(); ++i) {
+      level_lens_[0].push_back(OriginalFirstDim(nets[i], one_name, i == 0)); 
     }
   } else {
     level_lens_.resize(level_indicators_map.size());
@@ -0,0 +1,258 @@
+/*!
+ * \file cached_sparse_puller.cc
+ * \desc The sparse puller caching the pooled results across requests
+ */
+#include "blaze/store/cached_sparse_puller.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "blaze/common/exception.h"
+#include "blaze/common/log.h"
+#include "blaze/common/murmurhash.h"
+#include "blaze/math/float16.h"
+#include "blaze/store/defines.h"
+
+namespace blaze {
+namespace store {
+
+namespace {
+
+template <typename T>
+void Append(std::string* signature, const T& v) {
+  signature->append(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+size_t ValueSize(int value_type) {
+  size_t value_size = 0;
+  EMBEDDING_VALUE_TYPE_SWITCH(value_type, ValueType, {
+    value_size = sizeof(ValueType);
+  });
+  return value_size;
+}
+
+}  // namespace
+
+size_t CachedSparsePuller::Entry::bytes() const {
+  size_t bytes = sizeof(Entry) + signature.size();
+  for (const auto& result : results) bytes += result.size();
+  return bytes;
+}
+
+CachedSparsePuller::CachedSparsePuller(std::shared_ptr<SparsePuller> sparse_puller,
+                                       const Options& options) :
+    sparse_puller_(sparse_puller), options_(options), hit_(0), miss_(0) {
+  size_t shard_num = std::max<size_t>(options_.shard_num, 1);
+  shard_capacity_bytes_ = options_.capacity_bytes / shard_num;
+  for (size_t i = 0; i < shard_num; ++i) {
+    shards_.emplace_back(new Shard());
+  }
+}
+
+Status CachedSparsePuller::Load(const std::string& url) {
+  Status status = sparse_puller_->Load(url);
+  Clear();
+  return status;
+}
+
+Status CachedSparsePuller::LoadDelta(const std::string& url) {
+  Status status = sparse_puller_->LoadDelta(url);
+  Clear();
+  return status;
+}
+
+Status CachedSparsePuller::Get(const std::vector<SparsePullerInput>& input,
+                               std::vector<SparsePullerOutput>& output) {
+  if (input.size() != output.size()) return kFail;
+  const uint64_t now_micros = NowMicros();
+
+  // [STEP1]: copy the cached routes
+  std::vector<SparsePullerInput> miss_input;
+  std::vector<SparsePullerOutput> miss_output;
+  std::vector<std::string> miss_signature;
+  std::vector<uint64_t> miss_hash;
+  for (size_t i = 0; i < input.size(); ++i) {
+    std::string signature;
+    uint64_t hash = 0;
+    if (Signature(input[i], &signature)) {
+      hash = MurmurHash64A(signature.data(), signature.size());
+      if (Lookup(signature, hash, input[i], output[i], now_micros)) {
+        ++hit_;
+        continue;
+      }
+      ++miss_;
+    }
+    miss_input.push_back(input[i]);
+    miss_output.push_back(output[i]);
+    miss_signature.push_back(std::move(signature));
+    miss_hash.push_back(hash);
+  }
+  if (miss_input.empty()) return kOK;
+
+  // [STEP2]: pull the missed routes in one request, and cache them
+  Status status = sparse_puller_->Get(miss_input, miss_output);
+  if (status != kOK) return status;
+  for (size_t i = 0; i < miss_input.size(); ++i) {
+    if (miss_signature[i].empty()) continue;
+    Insert(std::move(miss_signature[i]), miss_hash[i], miss_input[i], miss_output[i], now_micros);
+  }
+  return kOK;
+}
+
+void CachedSparsePuller::Clear() {
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->index.clear();
+    shard->lru.clear();
+    shard->bytes = 0;
+  }
+}
+
+CachedSparsePuller::Stats CachedSparsePuller::GetStats() const {
+  Stats stats;
+  stats.hit = hit_.load();
+  stats.miss = miss_.load();
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    stats.entry_num += shard->lru.size();
+    stats.bytes += shard->bytes;
+  }
+  return stats;
+}
+
+bool CachedSparsePuller::Signature(const SparsePullerInput& input, std::string* signature) const {
+  signature->clear();
+  if (input.in_item.empty() || input.key_num_size == 0) return false;
+  if (input.key_type != kInt64 || input.num_type != kInt32 ||
+      (input.value_type != kFloat && input.value_type != kFloat16)) return false;
+
+  size_t key_count = 0;
+  EMBEDDING_NUM_TYPE_SWITCH(input.num_type, NumType, {
+    const NumType* key_num = reinterpret_cast<const NumType*>(input.key_num);
+    for (size_t i = 0; i < input.key_num_size; ++i) {
+      key_count += static_cast<size_t>(key_num[i]);
+    }
+  });
+  if (key_count > options_.max_key_num) return false;
+
+  signature->append(input.name);
+  signature->push_back('\0');
+  Append(signature, input.dim);
+  Append(signature, input.value_type);
+  Append(signature, input.in_item.size());
+  for (const auto& param : input.in_item) {
+    Append(signature, param.udf_type);
+    Append(signature, param.trunc_direction);
+    Append(signature, param.trunc_num);
+  }
+  Append(signature, input.key_num_size);
+  EMBEDDING_NUM_TYPE_SWITCH(input.num_type, NumType, {
+    signature->append(reinterpret_cast<const char*>(input.key_num),
+                      sizeof(NumType) * input.key_num_size);
+  });
+  EMBEDDING_KEY_TYPE_SWITCH(input.key_type, KeyType, {
+    signature->append(reinterpret_cast<const char*>(input.key), sizeof(KeyType) * key_count);
+  });
+  EMBEDDING_VALUE_TYPE_SWITCH(input.value_type, ValueType, {
+    signature->append(reinterpret_cast<const char*>(input.value), sizeof(ValueType) * key_count);
+  });
+  return true;
+}
+
+std::vector<size_t> CachedSparsePuller::RowBytes(const SparsePullerInput& input) {
+  const size_t value_size = ValueSize(input.value_type);
+  std::vector<size_t> row_bytes(input.in_item.size());
+  for (size_t k = 0; k < input.in_item.size(); ++k) {
+    size_t width = input.in_item[k].udf_type == kAssign ?
+        static_cast<size_t>(input.dim) * input.in_item[k].trunc_num : input.dim;
+    row_bytes[k] = width * value_size;
+  }
+  return row_bytes;
+}
+
+bool CachedSparsePuller::Lookup(const std::string& signature, uint64_t hash,
+                                const SparsePullerInput& input,
+                                SparsePullerOutput& output, uint64_t now_micros) {
+  Shard& shard = GetShard(hash);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  const auto& iter = shard.index.find(hash);
+  if (iter == shard.index.end()) return false;
+  auto entry = iter->second;
+  // a collision of the hashes misses, and is replaced on insert
+  if (entry->signature != signature) return false;
+  if (now_micros - entry->insert_micros > options_.ttl_micros) {
+    shard.bytes -= entry->bytes();
+    shard.index.erase(iter);
+    shard.lru.erase(entry);
+    return false;
+  }
+  shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+
+  const std::vector<size_t> row_bytes = RowBytes(input);
+  const size_t value_size = ValueSize(input.value_type);
+  for (size_t k = 0; k < output.out_item.size(); ++k) {
+    const char* result = entry->results[k].data();
+    char* out = reinterpret_cast<char*>(output.out_item[k].out);
+    for (size_t i = 0; i < input.key_num_size; ++i) {
+      memcpy(out, result, row_bytes[k]);
+      result += row_bytes[k];
+      out += output.out_item[k].stride * value_size;
+    }
+  }
+  return true;
+}
+
+void CachedSparsePuller::Insert(std::string signature, uint64_t hash,
+                                const SparsePullerInput& input,
+                                const SparsePullerOutput& output, uint64_t now_micros) {
+  const std::vector<size_t> row_bytes = RowBytes(input);
+  const size_t value_size = ValueSize(input.value_type);
+  Entry entry;
+  entry.insert_micros = now_micros;
+  entry.results.resize(output.out_item.size());
+  for (size_t k = 0; k < output.out_item.size(); ++k) {
+    std::string& result = entry.results[k];
+    result.reserve(row_bytes[k] * input.key_num_size);
+    const char* out = reinterpret_cast<const char*>(output.out_item[k].out);
+    for (size_t i = 0; i < input.key_num_size; ++i) {
+      result.append(out, row_bytes[k]);
+      out += output.out_item[k].stride * value_size;
+    }
+  }
+  entry.signature = std::move(signature);
+  entry.hash = hash;
+  const size_t bytes = entry.bytes();
+  if (bytes > shard_capacity_bytes_) return;
+
+  Shard& shard = GetShard(hash);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  const auto& iter = shard.index.find(hash);
+  if (iter != shard.index.end()) {
+    shard.bytes -= iter->second->bytes();
+    shard.lru.erase(iter->second);
+    shard.index.erase(iter);
+  }
+  while (!shard.lru.empty() && shard.bytes + bytes > shard_capacity_bytes_) {
+    Entry& last = shard.lru.back();
+    shard.bytes -= last.bytes();
+    shard.index.erase(last.hash);
+    shard.lru.pop_back();
+  }
+  shard.lru.push_front(std::move(entry));
+  shard.index[hash] = shard.lru.begin();
+  shard.bytes += bytes;
+}
+
+CachedSparsePuller::Shard& CachedSparsePuller::GetShard(uint64_t hash) {
+  return *shards_[hash % shards_.size()];
+}
+
+uint64_t CachedSparsePuller::NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace store
+}  // namespace blaze
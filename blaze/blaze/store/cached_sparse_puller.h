@@ -0,0 +1,109 @@
+/*!
+ * \file cached_sparse_puller.h
+ * \desc The sparse puller caching the pooled results across requests
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "blaze/store/sparse_puller.h"
+
+namespace blaze {
+namespace store {
+
+// Caches the pooled outputs of the routes over the sparse puller of a
+// predictor manager, keyed by the table, the block params and the keys,
+// key nums and values of the route. The routes of the user side features,
+// which repeat across the candidate batches of a user, are pooled once and
+// copied afterwards. The memory is bounded by the bytes of the signatures
+// and the results, the results older than the ttl are pulled again.
+class CachedSparsePuller : public SparsePuller {
+ public:
+  struct Options {
+    // the bytes of the cached signatures and results of all the shards
+    size_t capacity_bytes = 256 << 20;
+    // the results older than the ttl are pulled again
+    uint64_t ttl_micros = 60 * 1000 * 1000;
+    size_t shard_num = 16;
+    // the routes of more keys are not cached
+    size_t max_key_num = 4096;
+  };
+
+  struct Stats {
+    uint64_t hit = 0;
+    uint64_t miss = 0;
+    size_t entry_num = 0;
+    size_t bytes = 0;
+  };
+
+  CachedSparsePuller(std::shared_ptr<SparsePuller> sparse_puller, const Options& options);
+
+  // load the weights of the sparse puller, the cache is cleared
+  Status Load(const std::string& url) override;
+  // apply the delta of the sparse puller, the cache is cleared
+  Status LoadDelta(const std::string& url) override;
+
+  // pull embedding data, the cached routes are copied, kOK if success
+  Status Get(const std::vector<SparsePullerInput>& input,
+             std::vector<SparsePullerOutput>& output) override;
+
+  // drop the cached results
+  void Clear();
+
+  // the hit counters and the usage of the cache
+  Stats GetStats() const;
+
+  const std::shared_ptr<SparsePuller>& sparse_puller() const { return sparse_puller_; }
+
+ protected:
+  struct Entry {
+    std::string signature;
+    uint64_t hash;
+    uint64_t insert_micros;
+    // the rows of each out item
+    std::vector<std::string> results;
+    size_t bytes() const;
+  };
+  // the entries of a shard, the most recent first
+  struct Shard {
+    mutable std::mutex mutex;
+    std::list<Entry> lru;
+    // indexed by the hash of the signature
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    size_t bytes = 0;
+  };
+
+  // the signature of the route, false if the route is not cached
+  bool Signature(const SparsePullerInput& input, std::string* signature) const;
+  // the bytes of a row of each out item
+  static std::vector<size_t> RowBytes(const SparsePullerInput& input);
+
+  // copy the fresh results of signature to output, false if miss
+  bool Lookup(const std::string& signature, uint64_t hash, const SparsePullerInput& input,
+              SparsePullerOutput& output, uint64_t now_micros);
+  // cache the results of the route written to output
+  void Insert(std::string signature, uint64_t hash, const SparsePullerInput& input,
+              const SparsePullerOutput& output, uint64_t now_micros);
+
+  Shard& GetShard(uint64_t hash);
+  static uint64_t NowMicros();
+
+  std::shared_ptr<SparsePuller> sparse_puller_;
+  Options options_;
+  size_t shard_capacity_bytes_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  std::atomic<uint64_t> hit_;
+  std::atomic<uint64_t> miss_;
+};
+
+}  // namespace store
+}  // namespace blaze
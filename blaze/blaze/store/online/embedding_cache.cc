@@ -0,0 +1,81 @@
+/*!
+ * \file embedding_cache.cc
+ * \desc The LRU cache of the online embedding rows
+ */
+#include "blaze/store/online/embedding_cache.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace blaze {
+namespace store {
+
+EmbeddingCache::EmbeddingCache(size_t capacity, uint64_t ttl_micros, size_t shard_num) :
+    ttl_micros_(ttl_micros) {
+  shard_num = std::max<size_t>(shard_num, 1);
+  shard_capacity_ = std::max<size_t>((capacity + shard_num - 1) / shard_num, 1);
+  for (size_t i = 0; i < shard_num; ++i) {
+    shards_.emplace_back(new Shard());
+  }
+}
+
+EmbeddingCache::Result EmbeddingCache::Lookup(uint32_t table, int64_t key, int dim,
+                                              uint64_t now_micros, float* row) {
+  Key k = { table, key };
+  Shard& shard = GetShard(k);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  const auto& iter = shard.index.find(k);
+  if (iter == shard.index.end()) return kMiss;
+  auto entry = iter->second;
+  // stale or pulled with another dim
+  if (now_micros - entry->insert_micros > ttl_micros_ ||
+      (!entry->missing && entry->row.size() != static_cast<size_t>(dim))) {
+    shard.index.erase(iter);
+    shard.lru.erase(entry);
+    return kMiss;
+  }
+  shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+  if (entry->missing) return kHitMissing;
+  memcpy(row, entry->row.data(), sizeof(float) * dim);
+  return kHit;
+}
+
+void EmbeddingCache::Insert(uint32_t table, int64_t key, const float* row, int dim,
+                            uint64_t now_micros) {
+  Key k = { table, key };
+  Shard& shard = GetShard(k);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  const auto& iter = shard.index.find(k);
+  if (iter != shard.index.end()) {
+    shard.lru.erase(iter->second);
+    shard.index.erase(iter);
+  }
+  // reuse the row of the least recent entry when full
+  std::vector<float> weights;
+  if (shard.lru.size() >= shard_capacity_) {
+    Entry& last = shard.lru.back();
+    weights.swap(last.row);
+    shard.index.erase(last.key);
+    shard.lru.pop_back();
+  }
+  if (row != nullptr) {
+    weights.assign(row, row + dim);
+  } else {
+    weights.clear();
+  }
+  shard.lru.push_front(Entry{ k, now_micros, row == nullptr, std::move(weights) });
+  shard.index[k] = shard.lru.begin();
+}
+
+size_t EmbeddingCache::size() const {
+  size_t size = 0;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    size += shard->lru.size();
+  }
+  return size;
+}
+
+}  // namespace store
+}  // namespace blaze
@@ -0,0 +1,78 @@
+/*!
+ * \file embedding_cache.h
+ * \desc The LRU cache of the online embedding rows
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace blaze {
+namespace store {
+
+// A sharded LRU cache of the rows pulled from an online source, keyed by
+// table id and key. The rows older than ttl_micros miss and are pulled
+// again, the keys missing in the source are cached as missing.
+class EmbeddingCache {
+ public:
+  enum Result {
+    kMiss = 0,
+    kHit,
+    // the key is missing in the source
+    kHitMissing,
+  };
+
+  // capacity is the row count of all the shards
+  EmbeddingCache(size_t capacity, uint64_t ttl_micros, size_t shard_num = 16);
+
+  // copy the fresh row of dim of key to row
+  Result Lookup(uint32_t table, int64_t key, int dim, uint64_t now_micros, float* row);
+
+  // cache the row of key, nullptr if missing in the source
+  void Insert(uint32_t table, int64_t key, const float* row, int dim, uint64_t now_micros);
+
+  // the cached row count
+  size_t size() const;
+
+ protected:
+  struct Key {
+    uint32_t table;
+    int64_t key;
+    bool operator==(const Key& rhs) const {
+      return table == rhs.table && key == rhs.key;
+    }
+  };
+  struct KeyHash {
+    size_t operator()(const Key& k) const {
+      return static_cast<size_t>(k.key * 0x9E3779B97F4A7C15ULL) ^ k.table;
+    }
+  };
+  struct Entry {
+    Key key;
+    uint64_t insert_micros;
+    bool missing;
+    std::vector<float> row;
+  };
+  // the entries of a shard, the most recent first
+  struct Shard {
+    mutable std::mutex mutex;
+    std::list<Entry> lru;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+  };
+
+  Shard& GetShard(const Key& key) {
+    return *shards_[KeyHash()(key) % shards_.size()];
+  }
+
+  size_t shard_capacity_;
+  uint64_t ttl_micros_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+}  // namespace store
+}  // namespace blaze
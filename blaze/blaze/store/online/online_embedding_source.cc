@@ -0,0 +1,31 @@
+/*!
+ * \file online_embedding_source.cc
+ * \desc The online source of the embedding rows, such as a parameter server
+ */
+#include "blaze/store/online/online_embedding_source.h"
+
+#include "blaze/common/exception.h"
+
+namespace blaze {
+namespace store {
+
+bool OnlineEmbeddingSourceRegisterer::Register(const std::string& protocol,
+                                               FCreateOnlineEmbeddingSource fcs) {
+  const auto& iter = fcs_map_.find(protocol);
+  if (iter != fcs_map_.end()) {
+    BLAZE_THROW("OnlineEmbeddingSource protocol=", protocol, " is already registered");
+  }
+  fcs_map_[protocol] = fcs;
+  return true;
+}
+
+OnlineEmbeddingSource* OnlineEmbeddingSourceRegisterer::CreateSource(const std::string& url) {
+  size_t pos = url.find("://");
+  if (pos == std::string::npos) return nullptr;
+  const auto& iter = fcs_map_.find(url.substr(0, pos));
+  if (iter == fcs_map_.end()) return nullptr;
+  return iter->second();
+}
+
+}  // namespace store
+}  // namespace blaze
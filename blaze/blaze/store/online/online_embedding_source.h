@@ -0,0 +1,61 @@
+/*!
+ * \file online_embedding_source.h
+ * \desc The online source of the embedding rows, such as a parameter server
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "blaze/store/store.h"
+
+namespace blaze {
+namespace store {
+
+// The source of the embedding rows of the online sparse puller, created by
+// the protocol of its url, such as ps://scheduler_addr
+class OnlineEmbeddingSource {
+ public:
+  virtual ~OnlineEmbeddingSource() { }
+  // connect the source, kOK if success
+  virtual Status Open(const std::string& url) = 0;
+  // pull the rows of dim of the keys of table to rows in one request,
+  // found[i] is set false if key i is missing in the source, kOK if success
+  virtual Status MultiGet(const std::string& table,
+                          const int64_t* keys,
+                          size_t key_num,
+                          int dim,
+                          float* rows,
+                          std::vector<bool>* found) = 0;
+};
+
+using FCreateOnlineEmbeddingSource = std::function<OnlineEmbeddingSource*(void)>;
+
+// Online embedding source creation register
+struct OnlineEmbeddingSourceRegisterer {
+  static OnlineEmbeddingSourceRegisterer* Get() {
+    static std::shared_ptr<OnlineEmbeddingSourceRegisterer> inst(new OnlineEmbeddingSourceRegisterer());
+    return inst.get();
+  }
+  bool Register(const std::string& protocol, FCreateOnlineEmbeddingSource fcs);
+  // create the source of the protocol of url, nullptr if unknown
+  OnlineEmbeddingSource* CreateSource(const std::string& url);
+
+ protected:
+  OnlineEmbeddingSourceRegisterer() { }
+  OnlineEmbeddingSourceRegisterer(const OnlineEmbeddingSourceRegisterer&) = delete;
+  OnlineEmbeddingSourceRegisterer& operator=(const OnlineEmbeddingSourceRegisterer&) = delete;
+
+  std::unordered_map<std::string, FCreateOnlineEmbeddingSource> fcs_map_;
+};
+
+#define REGISTER_ONLINE_EMBEDDING_SOURCE(protocol, fcs) \
+    static bool source_status = OnlineEmbeddingSourceRegisterer::Get()->Register(protocol, fcs);
+
+}  // namespace store
+}  // namespace blaze
@@ -0,0 +1,169 @@
+/*!
+ * \file online_sparse_puller.cc
+ * \desc The sparse puller of an online embedding source
+ */
+#include "blaze/store/online/online_sparse_puller.h"
+
+#include <string.h>
+
+#include <chrono>
+
+#include "blaze/common/log.h"
+#include "blaze/store/defines.h"
+#include "blaze/store/quick_embedding/udf_processor.h"
+
+namespace blaze {
+namespace store {
+
+Status OnlineSparsePuller::Load(const std::string& url) {
+  std::unique_ptr<OnlineEmbeddingSource> source(
+      OnlineEmbeddingSourceRegisterer::Get()->CreateSource(url));
+  if (source == nullptr) {
+    LOG_ERROR("unknown online embedding source! url: %s", url.c_str());
+    return kFail;
+  }
+  if (source->Open(url) != kOK) {
+    LOG_ERROR("open online embedding source failed! url: %s", url.c_str());
+    return kFail;
+  }
+  source_ = std::move(source);
+  return kOK;
+}
+
+Status OnlineSparsePuller::Get(const std::vector<SparsePullerInput>& input,
+                               std::vector<SparsePullerOutput>& output) {
+  if (input.size() != output.size()) return kFail;
+  for (size_t i = 0; i < input.size(); ++i) {
+    Status status = Get(input[i], output[i]);
+    if (status != kOK) return status;
+  }
+  return kOK;
+}
+
+size_t OnlineSparsePuller::KeyCount(const SparsePullerInput& input) {
+  size_t key_count = 0;
+  EMBEDDING_NUM_TYPE_SWITCH(input.num_type, NumType, {
+    const NumType* key_num = reinterpret_cast<const NumType*>(input.key_num);
+    for (size_t i = 0; i < input.key_num_size; ++i) {
+      key_count += static_cast<size_t>(key_num[i]);
+    }
+  });
+  return key_count;
+}
+
+uint32_t OnlineSparsePuller::TableId(const std::string& name) {
+  std::lock_guard<std::mutex> lock(table_mutex_);
+  return table_ids_.emplace(name, table_ids_.size()).first->second;
+}
+
+uint64_t OnlineSparsePuller::NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Status OnlineSparsePuller::Get(const SparsePullerInput& input,
+                               SparsePullerOutput& output) {
+  if (input.in_item.size() != output.out_item.size()) return kFail;
+  if (source_ == nullptr) return kFail;
+
+  const uint32_t table = TableId(input.name);
+  const size_t key_count = KeyCount(input);
+  const int dim = input.dim;
+  const uint64_t now_micros = NowMicros();
+
+  // [STEP1]: the unique keys of the route, and their rows in the cache
+  std::vector<size_t> slot(key_count);
+  std::vector<int64_t> unique_keys;
+  EMBEDDING_KEY_TYPE_SWITCH(input.key_type, KeyType, {
+    const KeyType* key = reinterpret_cast<const KeyType*>(input.key);
+    std::unordered_map<int64_t, size_t> slots;
+    for (size_t j = 0; j < key_count; ++j) {
+      const auto& ret = slots.emplace(key[j], unique_keys.size());
+      if (ret.second) unique_keys.push_back(key[j]);
+      slot[j] = ret.first->second;
+    }
+  });
+  std::vector<float> rows(unique_keys.size() * dim);
+  std::vector<bool> found(unique_keys.size(), true);
+  std::vector<int64_t> miss_keys;
+  std::vector<size_t> miss_slots;
+  for (size_t s = 0; s < unique_keys.size(); ++s) {
+    switch (cache_.Lookup(table, unique_keys[s], dim, now_micros, rows.data() + s * dim)) {
+      case EmbeddingCache::kHit:
+        break;
+      case EmbeddingCache::kHitMissing:
+        found[s] = false;
+        break;
+      default:
+        miss_keys.push_back(unique_keys[s]);
+        miss_slots.push_back(s);
+        break;
+    }
+  }
+
+  // [STEP2]: pull the missed keys in one request
+  if (!miss_keys.empty()) {
+    std::vector<float> miss_rows(miss_keys.size() * dim);
+    std::vector<bool> miss_found(miss_keys.size(), true);
+    Status status = source_->MultiGet(input.name, miss_keys.data(), miss_keys.size(),
+                                      dim, miss_rows.data(), &miss_found);
+    if (status != kOK) {
+      LOG_ERROR("pull %lu keys of table %s failed", miss_keys.size(), input.name.c_str());
+      return status;
+    }
+    for (size_t i = 0; i < miss_keys.size(); ++i) {
+      const float* row = miss_rows.data() + i * dim;
+      size_t s = miss_slots[i];
+      found[s] = miss_found[i];
+      if (found[s]) memcpy(rows.data() + s * dim, row, sizeof(float) * dim);
+      cache_.Insert(table, miss_keys[i], found[s] ? row : nullptr, dim, now_micros);
+    }
+  }
+
+  // [STEP3]: gather and reduce the rows of each batch
+  std::vector<const float*> weights(key_count, nullptr);
+  for (size_t j = 0; j < key_count; ++j) {
+    if (found[slot[j]]) weights[j] = rows.data() + slot[j] * dim;
+  }
+  EMBEDDING_VALUE_TYPE_SWITCH(input.value_type, ValueType, {
+    EMBEDDING_NUM_TYPE_SWITCH(input.num_type, NumType, {
+      const ValueType* value = reinterpret_cast<const ValueType*>(input.value);
+      const NumType* key_num = reinterpret_cast<const NumType*>(input.key_num);
+      std::vector<ValueType*> out(output.out_item.size());
+      std::vector<UdfProcessor<float, ValueType>*> processors(input.in_item.size());
+      for (size_t k = 0; k < output.out_item.size(); ++k) {
+        out[k] = reinterpret_cast<ValueType*>(output.out_item[k].out);
+        processors[k] = UdfProcessorFactory<float, ValueType>::Create(input.in_item[k].udf_type);
+      }
+      const float** weight = weights.data();
+      for (size_t i = 0; i < input.key_num_size; ++i) {
+        size_t num = static_cast<size_t>(key_num[i]);
+        for (size_t k = 0; k < input.in_item.size(); ++k) {
+          processors[k]->InitProcess(dim, input.in_item[k], out[k]);
+        }
+        for (size_t j = 0; j < num; ++j) {
+          if (weight[j] == nullptr) continue;
+          for (size_t k = 0; k < input.in_item.size(); ++k) {
+            processors[k]->ElementProcess(value[j], weight[j], dim, j, num,
+                                          input.in_item[k], out[k]);
+          }
+        }
+        for (size_t k = 0; k < input.in_item.size(); ++k) {
+          processors[k]->ReduceProcess(dim, num, input.in_item[k], out[k]);
+          out[k] += output.out_item[k].stride;
+        }
+        weight += num;
+        value += num;
+      }
+    });
+  });
+  return kOK;
+}
+
+OnlineSparsePuller* CreateOnlineSparsePuller() {
+  return new OnlineSparsePuller();
+}
+REGISTER_SPARSE_PULLER_CREATION("online_sparse_puller", CreateOnlineSparsePuller);
+
+}  // namespace store
+}  // namespace blaze
@@ -0,0 +1,74 @@
+/*!
+ * \file online_sparse_puller.h
+ * \desc The sparse puller of an online embedding source
+ */
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "blaze/store/sparse_puller.h"
+#include "blaze/store/online/embedding_cache.h"
+#include "blaze/store/online/online_embedding_source.h"
+
+namespace blaze {
+namespace store {
+
+// Pulls the embedding rows from an online source, such as the parameter
+// servers of an online learning model, so that the serving follows the
+// training without offline exports. The unique keys of a route missing in
+// the local LRU cache are pulled in one request, the cached rows are fresh
+// within the ttl.
+class OnlineSparsePuller : public SparsePuller {
+ public:
+  struct Options {
+    // the cached row count
+    size_t cache_capacity = 1 << 20;
+    // the rows older than the ttl are pulled again
+    uint64_t ttl_micros = 60 * 1000 * 1000;
+    size_t cache_shard_num = 16;
+  };
+
+  OnlineSparsePuller() : OnlineSparsePuller(Options()) { }
+
+  explicit OnlineSparsePuller(const Options& options) :
+      cache_(options.cache_capacity, options.ttl_micros, options.cache_shard_num) { }
+
+  // open the source of the protocol of url, kOK if success
+  Status Load(const std::string& url) override;
+
+  // pull embedding data, kOK if success
+  Status Get(const std::vector<SparsePullerInput>& input,
+             std::vector<SparsePullerOutput>& output) override;
+
+  // use the opened source, such as a shared client of the servers
+  void SetSource(std::unique_ptr<OnlineEmbeddingSource> source) {
+    source_ = std::move(source);
+  }
+
+  const EmbeddingCache& cache() const { return cache_; }
+
+ protected:
+  // pull embedding data of single route, kOK if success
+  Status Get(const SparsePullerInput& input, SparsePullerOutput& output);
+
+  // the total key count of the batches of the route
+  static size_t KeyCount(const SparsePullerInput& input);
+
+  // the id of the table in the cache
+  uint32_t TableId(const std::string& name);
+
+  static uint64_t NowMicros();
+
+  std::unique_ptr<OnlineEmbeddingSource> source_;
+  EmbeddingCache cache_;
+
+  std::mutex table_mutex_;
+  std::unordered_map<std::string, uint32_t> table_ids_;
+};
+
+}  // namespace store
+}  // namespace blaze
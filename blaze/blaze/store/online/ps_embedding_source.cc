@@ -0,0 +1,84 @@
+/*!
+ * \file ps_embedding_source.cc
+ * \desc The online embedding source of the ps-plus parameter servers
+ */
+#ifdef USE_PS_PLUS
+
+#include <string.h>
+
+#include <future>
+
+#include "blaze/common/log.h"
+#include "blaze/store/online/online_embedding_source.h"
+
+#include "ps-plus/client/client.h"
+#include "ps-plus/client/client_wrapper_impl.h"
+#include "ps-plus/client/raw_client.h"
+#include "ps-plus/common/initializer/none_initializer.h"
+
+namespace blaze {
+namespace store {
+
+// Pulls the rows of the hash variables named by the tables from the servers
+// of the scheduler of ps://scheduler_addr. The keys not trained yet get the
+// rows of the filtered keys, so no key is missing.
+class PsEmbeddingSource : public OnlineEmbeddingSource {
+ public:
+  Status Open(const std::string& url) override {
+    ps::client::ClientArgs args;
+    args.scheduler_addr = url.substr(url.find("://") + 3);
+    args.client_wrapper_creator = []() { return new ps::client::ClientWrapperImpl(); };
+    client_.reset(new ps::client::Client(new ps::client::RawClient(args)));
+    ps::Status status = client_->Init();
+    if (!status.IsOk()) {
+      LOG_ERROR("connect ps-plus scheduler failed! url: %s status: %s",
+                url.c_str(), status.ToString().c_str());
+      client_.reset();
+      return kFail;
+    }
+    return kOK;
+  }
+
+  Status MultiGet(const std::string& table,
+                  const int64_t* keys,
+                  size_t key_num,
+                  int dim,
+                  float* rows,
+                  std::vector<bool>* found) override {
+    ps::Tensor ids(ps::types::kInt64, ps::TensorShape({ key_num }),
+                   new ps::initializer::NoneInitializer());
+    memcpy(ids.Raw<int64_t>(), keys, sizeof(int64_t) * key_num);
+    ps::Tensor result;
+    std::promise<ps::Status> done;
+    // save ratio 0 admits no new keys to the servers on serving pulls
+    client_->HashPull(table, ids, 0.0f, &result, [&done](const ps::Status& status) {
+      done.set_value(status);
+    });
+    ps::Status status = done.get_future().get();
+    if (!status.IsOk()) {
+      LOG_ERROR("ps-plus pull table %s failed! status: %s", table.c_str(), status.ToString().c_str());
+      return kFail;
+    }
+    if (result.Type() != ps::types::kFloat ||
+        result.Shape().NumElements() != key_num * static_cast<size_t>(dim)) {
+      LOG_ERROR("ps-plus table %s has no float rows of dim %d", table.c_str(), dim);
+      return kFail;
+    }
+    memcpy(rows, result.Raw<float>(), sizeof(float) * key_num * dim);
+    found->assign(key_num, true);
+    return kOK;
+  }
+
+ protected:
+  std::unique_ptr<ps::client::Client> client_;
+};
+
+OnlineEmbeddingSource* CreatePsEmbeddingSource() {
+  return new PsEmbeddingSource();
+}
+REGISTER_ONLINE_EMBEDDING_SOURCE("ps", CreatePsEmbeddingSource);
+
+}  // namespace store
+}  // namespace blaze
+
+#endif  // USE_PS_PLUS
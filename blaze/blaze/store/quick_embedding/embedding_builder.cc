@@ -86,7 +86,7 @@ bool EmbeddingBuilder<T>::DoBuild(const std::string &filename,
   if (dim < 0) {
     return false;
   }
-  if (!weight_blob->AllocateMemory(line_count * dim)) {
+  if (!weight_blob->AllocateRows(line_count, dim)) {
     LOG_ERROR("bad allocate memory of weight blob, filename: %s", filename.c_str());
     return false;
   }
@@ -123,9 +123,7 @@ bool EmbeddingBuilder<T>::DoBuild(const std::string &filename,
 
         hashtable->PreInsert(key, offset);
 
-        for (int i = 0; i < dim; ++i) {
-          dict_weights[i] = weights[i];
-        }
+        WeightRow<T>::Encode(weights, dim, dict_weights);
       } catch (std::exception& e) {
         LOG_ERROR("lexical cast failed! %s", buff.c_str());
       }
@@ -253,6 +251,8 @@ bool EmbeddingBuilder<T>::SaveToFile(const std::string &output_file) {
 
 template class EmbeddingBuilder<float>;
 template class EmbeddingBuilder<float16>;
+template class EmbeddingBuilder<qint8>;
+template class EmbeddingBuilder<qint4>;
 
 }  // namespace store
 }  // namespace blaze
\ No newline at end of file
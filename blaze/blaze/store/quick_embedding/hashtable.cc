@@ -35,9 +35,11 @@ HashTable::HashTable() :
     bucket_size_(0),
     bucket_(nullptr),
     byte_size_(0),
-    bytes_(nullptr) {}
+    bytes_(nullptr),
+    owned_(true) {}
 
 HashTable::~HashTable() {
+  if (!owned_) return;
   if (bucket_) free(bucket_);
   if (bytes_) free(bytes_);
 }
@@ -94,6 +96,11 @@ bool HashTable::Dump(std::ostream *os) const {
 }
 
 bool HashTable::Load(std::istream *is) {
+  if (!owned_) {
+    bucket_ = nullptr;
+    bytes_ = nullptr;
+    owned_ = true;
+  }
   // [STEP1]: load bucket size
   is->read((char *) &bucket_size_, sizeof(bucket_size_));
   if (!is->good()) return false;
@@ -117,6 +124,30 @@ bool HashTable::Load(std::istream *is) {
   return true;
 }
 
+bool HashTable::Attach(const char *bytes, uint64_t size, uint64_t *pos) {
+  // [STEP1]: read bucket size and point to the buckets
+  uint32_t bucket_size;
+  if (!ReadBytes(bytes, size, pos, &bucket_size)) return false;
+  uint64_t bucket_pos = *pos;
+  *pos += sizeof(Bucket) * bucket_size;
+  // [STEP2]: read byte size and point to the bytes
+  size_t byte_size;
+  if (!ReadBytes(bytes, size, pos, &byte_size)) return false;
+  if (*pos + byte_size > size) return false;
+
+  if (owned_) {
+    if (bucket_) free(bucket_);
+    if (bytes_) free(bytes_);
+  }
+  bucket_size_ = bucket_size;
+  bucket_ = (Bucket *) (bytes + bucket_pos);
+  byte_size_ = byte_size;
+  bytes_ = const_cast<char *>(bytes + *pos);
+  owned_ = false;
+  *pos += byte_size;
+  return true;
+}
+
 float HashTable::AvgLength() const {
   size_t count = 0;
   float len = 0;
@@ -24,6 +24,21 @@ class HashTable : public Serializable {
   // lookup value by key
   bool Lookup(const Key &key, Value *value) const;
 
+  // prefetch the bucket of key, ahead of its lookup
+  void PrefetchBucket(const Key &key) const {
+    if (bucket_ == nullptr) return;
+    uint32_t hash_code = key;
+    __builtin_prefetch(&bucket_[hash_code % bucket_size_]);
+  }
+
+  // prefetch the items of the bucket of key, whose bucket is prefetched
+  void PrefetchItems(const Key &key) const {
+    if (bucket_ == nullptr || bytes_ == nullptr) return;
+    uint32_t hash_code = key;
+    const Bucket &bucket = bucket_[hash_code % bucket_size_];
+    if (bucket.size) __builtin_prefetch(bytes_ + bucket.offset);
+  }
+
   // hash table byte array size
   uint64_t ByteArraySize() const override;
 
@@ -33,6 +48,9 @@ class HashTable : public Serializable {
   // load
   bool Load(std::istream *is) override;
 
+  // attach to mapped bytes
+  bool Attach(const char *bytes, uint64_t size, uint64_t *pos) override;
+
   // get avg length
   float AvgLength() const;
 
@@ -53,6 +71,8 @@ class HashTable : public Serializable {
   size_t byte_size_;
   // byte array
   char *bytes_;
+  // whether bucket_ and bytes_ are owned, or attached to mapped bytes
+  bool owned_;
 };
 
 // batch build HashTable.
@@ -0,0 +1,115 @@
+/*!
+ * \file quantized_weight.h
+ * \desc Row-wise quantized embedding weights
+ */
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace blaze {
+namespace store {
+
+// The row-wise quantized weight types. A row of dim weights is stored as
+// [float scale][float bias][codes], and weight = scale * code + bias.
+// qint4 packs two codes in a byte, the low nibble first.
+struct qint8 {
+  uint8_t x;
+};
+
+struct qint4 {
+  uint8_t x;
+};
+
+// The layout of a weight row of type T
+template<typename T>
+struct WeightRow {
+  static const bool kQuantized = false;
+
+  // byte size of a row of dim weights
+  static size_t Bytes(int dim) {
+    return sizeof(T) * dim;
+  }
+
+  // store the dim weights in the row
+  static void Encode(const float *weights, int dim, T *row) {
+    for (int i = 0; i < dim; ++i) {
+      row[i] = weights[i];
+    }
+  }
+};
+
+// The quantized rows, whose codes take kBits
+template<typename T, int kBits>
+struct QuantizedWeightRow {
+  static const bool kQuantized = true;
+  static const int kLevels = (1 << kBits) - 1;
+  static const size_t kHeaderBytes = 2 * sizeof(float);
+
+  static size_t Bytes(int dim) {
+    return kHeaderBytes + (static_cast<size_t>(dim) * kBits + 7) / 8;
+  }
+
+  static void Encode(const float *weights, int dim, T *row) {
+    float min = dim > 0 ? *std::min_element(weights, weights + dim) : 0;
+    float max = dim > 0 ? *std::max_element(weights, weights + dim) : 0;
+    float scale = (max - min) / kLevels;
+    char *bytes = reinterpret_cast<char *>(row);
+    memcpy(bytes, &scale, sizeof(scale));
+    memcpy(bytes + sizeof(scale), &min, sizeof(min));
+    uint8_t *codes = Codes(row);
+    memset(codes, 0, Bytes(dim) - kHeaderBytes);
+    for (int i = 0; i < dim; ++i) {
+      int code = scale > 0 ? static_cast<int>(std::lround((weights[i] - min) / scale)) : 0;
+      code = std::min(std::max(code, 0), kLevels);
+      if (kBits == 8) {
+        codes[i] = code;
+      } else {
+        codes[i / 2] |= code << (4 * (i % 2));
+      }
+    }
+  }
+
+  static float Scale(const T *row) {
+    float scale;
+    memcpy(&scale, row, sizeof(scale));
+    return scale;
+  }
+
+  static float Bias(const T *row) {
+    float bias;
+    memcpy(&bias, reinterpret_cast<const char *>(row) + sizeof(float), sizeof(bias));
+    return bias;
+  }
+
+  static const uint8_t *Codes(const T *row) {
+    return reinterpret_cast<const uint8_t *>(row) + kHeaderBytes;
+  }
+
+  static uint8_t *Codes(T *row) {
+    return reinterpret_cast<uint8_t *>(row) + kHeaderBytes;
+  }
+
+  // the code of weight i
+  static int Code(const T *row, int i) {
+    const uint8_t *codes = Codes(row);
+    return kBits == 8 ? codes[i] : (codes[i / 2] >> (4 * (i % 2))) & 0xF;
+  }
+
+  // the dequantized weight i
+  static float Get(const T *row, int i) {
+    return Scale(row) * Code(row, i) + Bias(row);
+  }
+};
+
+template<>
+struct WeightRow<qint8> : public QuantizedWeightRow<qint8, 8> {};
+
+template<>
+struct WeightRow<qint4> : public QuantizedWeightRow<qint4, 4> {};
+
+}  // namespace store
+}  // namespace blaze
@@ -7,6 +7,12 @@
 #include "blaze/store/quick_embedding/udf_processor.h"
 #include "blaze/store/defines.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <exception>
 #include <fstream>
 
 namespace blaze {
@@ -26,7 +32,17 @@ bool QuickEmbeddingDict::SelfCheck(const std::string &url) {
   return true;
 }
 
+QuickEmbeddingDict::~QuickEmbeddingDict() {
+  // the tables attached to the mapping do not touch it when destroyed
+  if (mapped_ != nullptr) {
+    munmap(mapped_, mapped_size_);
+  }
+}
+
 Status QuickEmbeddingDict::Load(const std::string &url) {
+  if (mmap_options_.enable) {
+    return LoadMapped(url);
+  }
   std::ifstream is(url, std::ios::binary);
   if (!is.is_open()) {
     LOG_ERROR("load quick embedding dict failed! url: %s", url.c_str());
@@ -70,6 +86,110 @@ Status QuickEmbeddingDict::Load(const std::string &url) {
     }
   }
   is.close();
+  loaded_ = true;
+  return kOK;
+}
+
+Status QuickEmbeddingDict::LoadMapped(const std::string &url) {
+  if (mapped_ != nullptr) {
+    LOG_ERROR("quick embedding dict is mapped already, url: %s", url.c_str());
+    return kFail;
+  }
+  int fd = open(url.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG_ERROR("load quick embedding dict failed! url: %s", url.c_str());
+    return kFail;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    LOG_ERROR("stat quick embedding dict failed! url: %s", url.c_str());
+    close(fd);
+    return kFail;
+  }
+  int flags = MAP_SHARED;
+  if (mmap_options_.populate) flags |= MAP_POPULATE;
+  void* addr = mmap(nullptr, st.st_size, PROT_READ, flags, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    LOG_ERROR("mmap quick embedding dict failed! url: %s", url.c_str());
+    return kFail;
+  }
+  mapped_ = addr;
+  mapped_size_ = st.st_size;
+#ifdef MADV_HUGEPAGE
+  if (mmap_options_.hugepage) madvise(addr, mapped_size_, MADV_HUGEPAGE);
+#endif
+  // lookups are random, readahead only wastes the page cache
+  if (!mmap_options_.populate) madvise(addr, mapped_size_, MADV_RANDOM);
+
+  const char* bytes = reinterpret_cast<const char*>(addr);
+  uint64_t pos = 0;
+  if (!verifier_.Attach(bytes, mapped_size_, &pos)) {
+    LOG_ERROR("load verifier failed! url: %s", url.c_str());
+    return kFail;
+  }
+  if (verifier_.value_type() == DictValueType::unknown) {
+    LOG_ERROR("unknown value type of dict url: %s version: %d", url.c_str(), verifier_.version());
+    return kFail;
+  }
+  if (!trie_.Attach(bytes, mapped_size_, &pos)) {
+    LOG_ERROR("load trie failed! url: %s", url.c_str());
+    return kFail;
+  }
+  uint16_t gid;
+  while (ReadBytes(bytes, mapped_size_, &pos, &gid)) {
+    if (gid >= kMaxGidSize || !hashtables_[gid].Attach(bytes, mapped_size_, &pos)) {
+      LOG_ERROR("load hashtable failed! url: %s gid: %d", url.c_str(), gid);
+      return kFail;
+    }
+    if (weight_blobs_[gid] == nullptr) {
+      SWITCHTYPE_DictValueType(verifier_.value_type(), Type, {
+        weight_blobs_[gid].reset(new WeightBlob<Type>());
+      })
+      if (weight_blobs_[gid] == nullptr) {
+        return kFail;
+      }
+    }
+    if (!weight_blobs_[gid]->Attach(bytes, mapped_size_, &pos)) {
+      LOG_ERROR("load weight blob failed! url: %s gid: %d", url.c_str(), gid);
+      return kFail;
+    }
+  }
+  LOG_INFO("quick embedding dict mapped, url: %s size: %lu", url.c_str(), mapped_size_);
+  loaded_ = true;
+  return kOK;
+}
+
+Status QuickEmbeddingDict::LoadDelta(const std::string &url) {
+  if (!loaded_) {
+    LOG_ERROR("load delta before the dict! url: %s", url.c_str());
+    return kFail;
+  }
+  std::shared_ptr<QuickEmbeddingDict> delta(new QuickEmbeddingDict(mmap_options_));
+  if (delta->Load(url) != kOK) {
+    LOG_ERROR("load delta failed! url: %s", url.c_str());
+    return kFail;
+  }
+  if (delta->verifier_.value_type() != verifier_.value_type()) {
+    LOG_ERROR("value type of delta mismatch! url: %s value type: %d dict value type: %d",
+              url.c_str(), delta->verifier_.value_type(), verifier_.value_type());
+    return kFail;
+  }
+
+  std::lock_guard<std::mutex> lock(delta_mutex_);
+  std::shared_ptr<const Deltas> deltas = std::atomic_load(&deltas_);
+  std::shared_ptr<Deltas> updated(new Deltas());
+  updated->push_back(delta);
+  if (deltas != nullptr) {
+    if (deltas->size() >= kMaxDeltaNum) {
+      LOG_ERROR("too many deltas, reload the dict! url: %s", url.c_str());
+      return kFail;
+    }
+    updated->insert(updated->end(), deltas->begin(), deltas->end());
+  }
+  // the replaced deltas are freed by the last reader of them
+  std::atomic_store(&deltas_, std::shared_ptr<const Deltas>(updated));
+  LOG_INFO("quick embedding delta loaded, url: %s delta num: %lu", url.c_str(), updated->size());
   return kOK;
 }
 
@@ -77,66 +197,140 @@ Status QuickEmbeddingDict::Get(const std::vector<SparsePullerInput> &input,
                                std::vector<SparsePullerOutput> &output) {
   if (input.size() != output.size()) return kFail;
 
-  for (auto i = 0; i < input.size(); ++i) {
-    const auto& sparse_puller_input = input[i];
-    auto& sparse_puller_output = output[i];
-    Status status = Get(sparse_puller_input, sparse_puller_output);
-    if (status != kOK) return status;
+  static const Deltas kNoDeltas;
+  std::shared_ptr<const Deltas> deltas = std::atomic_load(&deltas_);
+  const Deltas& route_deltas = deltas != nullptr ? *deltas : kNoDeltas;
+
+  // the tables are looked up in parallel for the large requests
+  size_t key_count = 0;
+  for (const auto& sparse_puller_input : input) {
+    key_count += KeyCount(sparse_puller_input);
+  }
+  std::vector<Status> status(input.size(), kOK);
+  std::vector<std::exception_ptr> errors(input.size());
+#pragma omp parallel for schedule(dynamic) if (input.size() > 1 && key_count >= kParallelLookupKeys)
+  for (size_t i = 0; i < input.size(); ++i) {
+    try {
+      status[i] = Get(input[i], output[i], route_deltas);
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  }
+  for (size_t i = 0; i < input.size(); ++i) {
+    if (errors[i]) std::rethrow_exception(errors[i]);
+    if (status[i] != kOK) return status[i];
   }
   return kOK;
 }
 
+size_t QuickEmbeddingDict::KeyCount(const SparsePullerInput& input) {
+  size_t key_count = 0;
+  EMBEDDING_NUM_TYPE_SWITCH(input.num_type, NumType, {
+    const NumType* key_num = reinterpret_cast<const NumType*>(input.key_num);
+    for (size_t i = 0; i < input.key_num_size; ++i) {
+      key_count += static_cast<size_t>(key_num[i]);
+    }
+  });
+  return key_count;
+}
+
 Status QuickEmbeddingDict::Get(const SparsePullerInput& input,
-                               SparsePullerOutput& output) {
+                               SparsePullerOutput& output,
+                               const Deltas& deltas) {
   if (input.in_item.size() != output.out_item.size()) return kFail;
 
+  // the tables of the route in the deltas, which may add it
+  std::vector<std::pair<const QuickEmbeddingDict*, uint16_t>> layers;
+  for (const auto& delta : deltas) {
+    uint16_t delta_gid = 0;
+    if (!delta->GetGid(input.name, &delta_gid)) continue;
+    if (delta_gid >= kMaxGidSize) return kFail;
+    layers.push_back(std::make_pair(delta.get(), delta_gid));
+  }
+
   // table name miss
   uint16_t gid = 0;
-  if (!GetGid(input.name, &gid)) return kOK;
+  bool has_table = GetGid(input.name, &gid);
+  if (!has_table && layers.empty()) return kOK;
+  if (has_table && gid >= kMaxGidSize) return kFail;
 
+  const size_t key_count = KeyCount(input);
   EMBEDDING_KEY_TYPE_SWITCH(input.key_type, KeyType, {
     EMBEDDING_VALUE_TYPE_SWITCH(input.value_type, ValueType, {
-      EMBEDDING_VALUE_TYPE_SWITCH(GetBlazeDataType(verifier_.value_type()), DictValueType, {
+      SWITCHTYPE_LookupDictValueType(verifier_.value_type(), DictValueType, {
         EMBEDDING_NUM_TYPE_SWITCH(input.num_type, NumType, {
           KeyType * key = reinterpret_cast<KeyType *>(input.key);
           ValueType* value = reinterpret_cast<ValueType*>(input.value);
           NumType* key_num = reinterpret_cast<NumType*>(input.key_num);
           std::vector<ValueType*> out(output.out_item.size());
-          for (size_t i = 0; i < output.out_item.size(); ++i) {
-            out[i] = reinterpret_cast<ValueType *>(output.out_item[i].out);
+          std::vector<UdfProcessor<DictValueType, ValueType>*> processors(input.in_item.size());
+          for (size_t k = 0; k < output.out_item.size(); ++k) {
+            out[k] = reinterpret_cast<ValueType *>(output.out_item[k].out);
+            processors[k] = UdfProcessorFactory<DictValueType, ValueType>::Create(input.in_item[k].udf_type);
+          }
+
+          // [STEP1]: prefetch the buckets of all the keys, then their items,
+          // so that the random reads of the keys overlap
+          if (has_table) {
+            const HashTable& hashtable = hashtables_[gid];
+            for (size_t j = 0; j < key_count; ++j) {
+              hashtable.PrefetchBucket(key[j]);
+            }
+            for (size_t j = 0; j < key_count; ++j) {
+              hashtable.PrefetchItems(key[j]);
+            }
           }
-          DictValueType* weights = nullptr;
 
-          // enumeration on all batch
+          // [STEP2]: look up the weights of all the keys in the latest delta
+          // having them or the dict, prefetching them
+          std::vector<DictValueType*> weights(key_count, nullptr);
+          const size_t weight_bytes = WeightRow<DictValueType>::Bytes(input.dim);
+          for (size_t j = 0; j < key_count; ++j) {
+            bool found = false;
+            for (size_t d = 0; d < layers.size() && !found; ++d) {
+              found = layers[d].first->Lookup<DictValueType>(layers[d].second, key[j], &weights[j]);
+            }
+            if (!found && has_table) {
+              found = Lookup<DictValueType>(gid, key[j], &weights[j]);
+            }
+            if (!found) {
+              weights[j] = nullptr;
+              continue;
+            }
+            const char* row = reinterpret_cast<const char*>(weights[j]);
+            for (size_t b = 0; b < weight_bytes; b += kCacheLineBytes) {
+              __builtin_prefetch(row + b);
+            }
+          }
+
+          // [STEP3]: gather and reduce the weights of each batch
+          DictValueType** weight = weights.data();
           for (size_t i = 0; i < input.key_num_size; ++i) {
             size_t num = static_cast<size_t>(key_num[i]);
             // init process
             for (size_t k = 0; k < input.in_item.size(); ++k) {
-              auto processor = UdfProcessorFactory<DictValueType, ValueType>::Create(input.in_item[k].udf_type);
-              processor->InitProcess(input.dim, input.in_item[k], out[k]);
+              processors[k]->InitProcess(input.dim, input.in_item[k], out[k]);
             }
 
             // element process
             for (size_t j = 0; j < num; ++j) {
-              if (!Lookup<DictValueType>(gid, key[j], &weights)) {
+              if (weight[j] == nullptr) {
                 continue;
               }
               for (size_t k = 0; k < input.in_item.size(); ++k) {
-                auto processor = UdfProcessorFactory<DictValueType, ValueType>::Create(input.in_item[k].udf_type);
-                processor->ElementProcess(value[j], weights, input.dim, j, num, input.in_item[k], out[k]);
+                processors[k]->ElementProcess(value[j], weight[j], input.dim, j, num, input.in_item[k], out[k]);
               }
             }
 
             // reduce process
             for (size_t k = 0; k < input.in_item.size(); ++k) {
-              auto processor = UdfProcessorFactory<DictValueType, ValueType>::Create(input.in_item[k].udf_type);
-              processor->ReduceProcess(input.dim, num, input.in_item[k], out[k]);
+              processors[k]->ReduceProcess(input.dim, num, input.in_item[k], out[k]);
 
               // stride address
               out[k] += output.out_item[k].stride;
             }
 
-            key += num;
+            weight += num;
             value += num;
           }
         });
@@ -152,5 +346,25 @@ QuickEmbeddingDict* CreateQedSparsePuller () {
 }
 REGISTER_SPARSE_PULLER_CREATION("qed_sparse_puller", CreateQedSparsePuller);
 
+// the mapped dicts, shared by the processes, pages fault in on lookups or
+// are populated at load in huge pages
+QuickEmbeddingDict* CreateQedMmapSparsePuller () {
+  QuickEmbeddingDict::MmapOptions mmap_options;
+  mmap_options.enable = true;
+  return new QuickEmbeddingDict(mmap_options);
+}
+
+QuickEmbeddingDict* CreateQedMmapPopulateSparsePuller () {
+  QuickEmbeddingDict::MmapOptions mmap_options;
+  mmap_options.enable = true;
+  mmap_options.populate = true;
+  mmap_options.hugepage = true;
+  return new QuickEmbeddingDict(mmap_options);
+}
+static bool mmap_status = SparsePullerCreationRegisterer::Get()->Register(
+    "qed_mmap_sparse_puller", CreateQedMmapSparsePuller);
+static bool mmap_populate_status = SparsePullerCreationRegisterer::Get()->Register(
+    "qed_mmap_populate_sparse_puller", CreateQedMmapPopulateSparsePuller);
+
 }  // namespace store
 }  // namespace blaze
@@ -7,6 +7,9 @@
 #include <string>
 #include <array>
 #include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 #include "blaze/store/sparse_puller.h"
 #include "blaze/store/quick_embedding/version_verifier.h"
@@ -16,6 +19,11 @@
 
 namespace {
 const uint32_t kMaxGidSize = 1024;
+// the keys of a request above which its tables are looked up in parallel
+const size_t kParallelLookupKeys = 4096;
+const size_t kCacheLineBytes = 64;
+// the deltas kept over a dict, which is reloaded to compact them
+const size_t kMaxDeltaNum = 16;
 }  // namespace
 
 namespace blaze {
@@ -23,13 +31,31 @@ namespace store {
 
 class QuickEmbeddingDict : public SparsePuller {
  public:
+  // mapping the dict file read-only instead of loading it to heap, the
+  // processes serving the same file share its pages in the page cache
+  struct MmapOptions {
+    bool enable = false;
+    // prefault the pages at load by MAP_POPULATE
+    bool populate = false;
+    // hint transparent huge pages for the mapping
+    bool hugepage = false;
+  };
+
   QuickEmbeddingDict() {}
 
-  ~QuickEmbeddingDict() override {}
+  explicit QuickEmbeddingDict(const MmapOptions& mmap_options) : mmap_options_(mmap_options) {}
+
+  ~QuickEmbeddingDict() override;
 
   // load quick embedding, kOK if success
   Status Load(const std::string& url) override;
 
+  // apply a delta dict of the changed and new rows of the tables, built in
+  // the format of the dict, kOK if success. The lookups take a row from the
+  // latest delta having it, so a refresh takes the memory of its rows only,
+  // and the readers keep the deltas they started with until they return.
+  Status LoadDelta(const std::string& url) override;
+
   // pull embedding data, kOK if success
   Status Get(const std::vector<SparsePullerInput>& input,
              std::vector<SparsePullerOutput>& output) override;
@@ -37,8 +63,18 @@ class QuickEmbeddingDict : public SparsePuller {
   bool SelfCheck(const std::string &url);
 
  protected:
-  // pull embedding data of single route, kOK if success
-  Status Get(const SparsePullerInput& input, SparsePullerOutput& output);
+  // the deltas, the latest first
+  using Deltas = std::vector<std::shared_ptr<QuickEmbeddingDict>>;
+
+  // pull embedding data of single route over the deltas, kOK if success
+  Status Get(const SparsePullerInput& input, SparsePullerOutput& output,
+             const Deltas& deltas);
+
+  // the total key count of the batches of the route
+  static size_t KeyCount(const SparsePullerInput& input);
+
+  // map quick embedding and attach the tables to it, kOK if success
+  Status LoadMapped(const std::string& url);
 
   // get gid by route table name, return true if success
   bool GetGid(const std::string &table_name, uint16_t *gid) const {
@@ -70,25 +106,21 @@ class QuickEmbeddingDict : public SparsePuller {
     return true;
   }
 
-  // get blaze data type from dict value type
-  DataType GetBlazeDataType(DictValueType type) {
-    switch (type) {
-      case DictValueType::fp32:
-        return DataType::kFloat;
-      case DictValueType::fp16:
-        return DataType::kFloat16;
-      case DictValueType::int8:
-        return DataType::kInt8;
-      default:
-        BLAZE_THROW("invalid dict value data type");
-    }
-  }
-
  protected:
   VersionVerifier verifier_;
   Trie trie_;
   HashTable hashtables_[kMaxGidSize];
   std::array<std::unique_ptr<Serializable>, kMaxGidSize> weight_blobs_;
+
+  MmapOptions mmap_options_;
+  // the mapped dict file
+  void* mapped_ = nullptr;
+  size_t mapped_size_ = 0;
+  bool loaded_ = false;
+
+  // swapped whole by LoadDelta, the readers take a reference
+  std::shared_ptr<const Deltas> deltas_;
+  std::mutex delta_mutex_;
 };
 
 }  // namespace store
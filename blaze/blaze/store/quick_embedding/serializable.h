@@ -4,6 +4,9 @@
  */
 #pragma once
 
+#include <stdint.h>
+#include <string.h>
+
 #include <iostream>
 
 namespace blaze {
@@ -21,8 +24,21 @@ class Serializable {
 
   // load object from serialized file
   virtual bool Load(std::istream *is) = 0;
+
+  // attach object to its serialized bytes at *pos of a mapped file without
+  // copying, *pos moves past them. The bytes must outlive the object.
+  virtual bool Attach(const char *bytes, uint64_t size, uint64_t *pos) = 0;
 };
 
+// read a value at *pos of the serialized bytes, false if out of range
+template<typename T>
+inline bool ReadBytes(const char *bytes, uint64_t size, uint64_t *pos, T *value) {
+  if (*pos + sizeof(T) > size) return false;
+  memcpy(value, bytes + *pos, sizeof(T));
+  *pos += sizeof(T);
+  return true;
+}
+
 }  // namespace store
 }  // namespace blaze
 
@@ -22,12 +22,13 @@ Trie::Trie() :
     root_(nullptr),
     bytes_(nullptr),
     byte_size_(0),
-    capacity_size_(0) {
+    capacity_size_(0),
+    owned_(true) {
 }
 
 Trie::~Trie() {
   Destroy(root_);
-  if (bytes_) {
+  if (bytes_ && owned_) {
     free(bytes_);
   }
 }
@@ -44,6 +45,9 @@ void Trie::Destroy(TrieNode *root) {
 }
 
 bool Trie::Lookup(const char *key, Value *value) const {
+  if (!owned_) {
+    return LookupBytes(key, value);
+  }
   if (!root_) {
     LOG_ERROR("empty trie tree");
     return false;
@@ -67,6 +71,37 @@ bool Trie::Lookup(const char *key, Value *value) const {
   return true;
 }
 
+bool Trie::LookupBytes(const char *key, Value *value) const {
+  size_t pos = 0;
+  size_t len = strlen(key);
+  for (size_t i = 0; i != len; ++i) {
+    int index = key[i];
+    if (index < 0 || index >= kMaxBranchNum) {
+      LOG_ERROR("key has invalid charactor: %s", key);
+      return false;
+    }
+    // scan the branches of the node, which are sorted by index
+    BranchSize branch_num = *(BranchSize *) (bytes_ + pos + sizeof(Value));
+    const char *branch = bytes_ + pos + sizeof(Value) + sizeof(BranchSize);
+    size_t next = 0;
+    for (int b = 0; b < branch_num; ++b) {
+      TrieNodeIndex branch_index = *(TrieNodeIndex *) branch;
+      if (branch_index >= index) {
+        if (branch_index == index) {
+          next = *(TrieNodeOffset *) (branch + sizeof(TrieNodeIndex));
+        }
+        break;
+      }
+      branch += sizeof(TrieNodeIndex) + sizeof(TrieNodeOffset);
+    }
+    // the root is at offset 0, which no branch points to
+    if (next == 0) return false;
+    pos = next;
+  }
+  *value = *(Value *) (bytes_ + pos);
+  return true;
+}
+
 Trie::TrieNode *Trie::GetTrieNode(const char *bytes, const TrieNodeOffset &offset) const {
   TrieNode *node = new TrieNode();
   size_t pos = offset;
@@ -113,7 +148,9 @@ bool Trie::Load(std::istream *is) {
     LOG_ERROR("bad allocate memory of trie while loading!");
     return false;
   }
+  if (bytes_ && owned_) free(bytes_);
   bytes_ = new_bytes;
+  owned_ = true;
   // [step3]: load bytes
   is->read(bytes_, byte_size_);
   if (!is->good()) return false;
@@ -123,6 +160,23 @@ bool Trie::Load(std::istream *is) {
   return true;
 }
 
+bool Trie::Attach(const char *bytes, uint64_t size, uint64_t *pos) {
+  // [step1]: read byte size
+  uint64_t byte_size;
+  if (!ReadBytes(bytes, size, pos, &byte_size)) return false;
+  if (byte_size == 0 || *pos + byte_size > size) return false;
+  // [step2]: point to the node bytes
+  Destroy(root_);
+  root_ = nullptr;
+  if (bytes_ && owned_) free(bytes_);
+  bytes_ = const_cast<char *>(bytes + *pos);
+  byte_size_ = byte_size;
+  capacity_size_ = byte_size;
+  owned_ = false;
+  *pos += byte_size;
+  return true;
+}
+
 BulkLoadTrie::BulkLoadTrie() : Trie() {}
 
 BulkLoadTrie::~BulkLoadTrie() {}
@@ -53,6 +53,9 @@ class Trie : public Serializable {
   // load from input stream
   bool Load(std::istream *is) override;
 
+  // attach to mapped bytes, lookups walk the node bytes in place
+  bool Attach(const char *bytes, uint64_t size, uint64_t *pos) override;
+
  protected:
   // destroy trie
   void Destroy(TrieNode *root);
@@ -60,11 +63,16 @@ class Trie : public Serializable {
   // create trie node by binary data and offset
   TrieNode *GetTrieNode(const char *bytes, const TrieNodeOffset &offset) const;
 
+  // lookup value by key on the node bytes
+  bool LookupBytes(const char *key, Value *value) const;
+
  protected:
   TrieNode *root_;
   char *bytes_;
   uint64_t byte_size_;
   uint64_t capacity_size_;
+  // whether bytes_ is owned, or attached to mapped bytes
+  bool owned_;
 };
 
 class BulkLoadTrie : public Trie {
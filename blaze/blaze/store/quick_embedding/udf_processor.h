@@ -4,12 +4,129 @@
  */
 #pragma once
 
+#include <immintrin.h>
+
 #include "blaze/store/sparse_puller.h"
 #include "blaze/common/exception.h"
+#include "blaze/common/types.h"
+#include "blaze/store/quick_embedding/quantized_weight.h"
 
 namespace blaze {
 namespace store {
 
+// out = value * weights if assign, or out += value * weights
+template <typename DictValueType, typename ValueType>
+inline void EmbeddingAxpy(ValueType value, const DictValueType* weights, int dim,
+                          bool assign, ValueType* out) {
+  for (auto i = 0; i < dim; ++i) {
+    out[i] = (assign ? ValueType(0) : out[i]) + value * (ValueType)(weights[i]);
+  }
+}
+
+template <>
+inline void EmbeddingAxpy<float, float>(float value, const float* weights, int dim,
+                                         bool assign, float* out) {
+  int i = 0;
+  const __m256 v = _mm256_set1_ps(value);
+  for (; i + 8 <= dim; i += 8) {
+    __m256 y = _mm256_mul_ps(v, _mm256_loadu_ps(weights + i));
+    if (!assign) y = _mm256_add_ps(y, _mm256_loadu_ps(out + i));
+    _mm256_storeu_ps(out + i, y);
+  }
+  for (; i < dim; ++i) {
+    out[i] = (assign ? 0 : out[i]) + value * weights[i];
+  }
+}
+
+// the fp16 dict converts 8 weights at a time
+template <>
+inline void EmbeddingAxpy<float16, float>(float value, const float16* weights, int dim,
+                                           bool assign, float* out) {
+  int i = 0;
+  const __m256 v = _mm256_set1_ps(value);
+  for (; i + 8 <= dim; i += 8) {
+    __m256 w = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i)));
+    __m256 y = _mm256_mul_ps(v, w);
+    if (!assign) y = _mm256_add_ps(y, _mm256_loadu_ps(out + i));
+    _mm256_storeu_ps(out + i, y);
+  }
+  for (; i < dim; ++i) {
+    out[i] = (assign ? 0 : out[i]) + value * (float)(weights[i]);
+  }
+}
+
+// the quantized rows are dequantized in the reduction,
+// out (+)= value * (scale * code + bias) = (value * scale) * code + value * bias
+template <typename DictValueType, typename ValueType>
+inline void QuantizedEmbeddingAxpy(ValueType value, const DictValueType* row, int dim,
+                                   bool assign, ValueType* out) {
+  typedef WeightRow<DictValueType> Row;
+  const float a = (float)(value) * Row::Scale(row);
+  const float b = (float)(value) * Row::Bias(row);
+  for (auto i = 0; i < dim; ++i) {
+    float y = a * Row::Code(row, i) + b;
+    out[i] = assign ? ValueType(y) : ValueType((float)(out[i]) + y);
+  }
+}
+
+template <typename ValueType>
+inline void EmbeddingAxpy(ValueType value, const qint8* row, int dim,
+                          bool assign, ValueType* out) {
+  QuantizedEmbeddingAxpy(value, row, dim, assign, out);
+}
+
+template <typename ValueType>
+inline void EmbeddingAxpy(ValueType value, const qint4* row, int dim,
+                          bool assign, ValueType* out) {
+  QuantizedEmbeddingAxpy(value, row, dim, assign, out);
+}
+
+// the int8 codes of 8 weights widen to floats at a time
+inline void EmbeddingAxpy(float value, const qint8* row, int dim,
+                          bool assign, float* out) {
+  typedef WeightRow<qint8> Row;
+  const float a = value * Row::Scale(row);
+  const float b = value * Row::Bias(row);
+  const uint8_t* codes = Row::Codes(row);
+  const __m256 va = _mm256_set1_ps(a);
+  const __m256 vb = _mm256_set1_ps(b);
+  int i = 0;
+  for (; i + 8 <= dim; i += 8) {
+    __m128i c = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(codes + i));
+    __m256 y = _mm256_add_ps(_mm256_mul_ps(va, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(c))), vb);
+    if (!assign) y = _mm256_add_ps(y, _mm256_loadu_ps(out + i));
+    _mm256_storeu_ps(out + i, y);
+  }
+  for (; i < dim; ++i) {
+    out[i] = (assign ? 0 : out[i]) + a * codes[i] + b;
+  }
+}
+
+// the 8 int4 codes of 4 bytes are shifted out of a broadcast word
+inline void EmbeddingAxpy(float value, const qint4* row, int dim,
+                          bool assign, float* out) {
+  typedef WeightRow<qint4> Row;
+  const float a = value * Row::Scale(row);
+  const float b = value * Row::Bias(row);
+  const uint8_t* codes = Row::Codes(row);
+  const __m256 va = _mm256_set1_ps(a);
+  const __m256 vb = _mm256_set1_ps(b);
+  const __m256i shifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+  const __m256i mask = _mm256_set1_epi32(0xF);
+  int i = 0;
+  for (; i + 8 <= dim; i += 8) {
+    int32_t packed;
+    memcpy(&packed, codes + i / 2, sizeof(packed));
+    __m256i c = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(packed), shifts), mask);
+    __m256 y = _mm256_add_ps(_mm256_mul_ps(va, _mm256_cvtepi32_ps(c)), vb);
+    if (!assign) y = _mm256_add_ps(y, _mm256_loadu_ps(out + i));
+    _mm256_storeu_ps(out + i, y);
+  }
+  for (; i < dim; ++i) {
+    out[i] = (assign ? 0 : out[i]) + a * Row::Code(row, i) + b;
+  }
+}
+
 // basic definition of udf process
 template <typename DictValueType, typename ValueType>
 class UdfProcessor {
@@ -61,11 +178,7 @@ class KSumProcessor : public UdfProcessor<DictValueType, ValueType> {
                       size_t size,
                       const SparsePullerInput::Param& param,
                       ValueType* out) override {
-    auto current_out = out;
-    for (auto i = 0; i < dim; ++i) {
-      *(current_out) = *(current_out) + value * (ValueType)(weights[i]);
-      ++current_out;
-    }
+    EmbeddingAxpy(value, weights, dim, false, out);
     return true;
   }
 };
@@ -123,10 +236,7 @@ class KAssignProcessor : public UdfProcessor<DictValueType, ValueType> {
     } else {
       current_out += dim * (param.trunc_num - (size - index));
     }
-    for (auto i = 0; i < dim; ++i) {
-      *(current_out) = value * (ValueType)(weights[i]);
-      ++current_out;
-    }
+    EmbeddingAxpy(value, weights, dim, true, current_out);
 
     return true;
   }
@@ -49,17 +49,36 @@ bool VersionVerifier::Load(std::istream* is) {
   // [STEP3]: load version
   is->read((char*)&version_, sizeof(version_));
   if (!is->good()) return false;
+  ParseValueType();
+  return true;
+}
+
+bool VersionVerifier::Attach(const char* bytes, uint64_t size, uint64_t* pos) {
+  // [STEP1]: verify check code
+  if (*pos + kCheckCodeLen > size ||
+      strncmp(bytes + *pos, kCheckCode, kCheckCodeLen) != 0) {
+    return false;
+  }
+  *pos += kCheckCodeLen;
+  // [STEP2]: read version
+  if (!ReadBytes(bytes, size, pos, const_cast<uint32_t*>(&version_))) return false;
+  ParseValueType();
+  return true;
+}
+
+void VersionVerifier::ParseValueType() {
 #define QED_SWITCHBW2INT(bw) case static_cast<std::underlying_type<DictValueType>::type>(DictValueType::bw):\
                                type_ = DictValueType::bw; break;
   switch (version_ % 1000) {
     QED_SWITCHBW2INT(fp32)
     QED_SWITCHBW2INT(fp16)
     QED_SWITCHBW2INT(int8)
+    QED_SWITCHBW2INT(int8_rowwise)
+    QED_SWITCHBW2INT(int4_rowwise)
     default:
       type_ = DictValueType::unknown;
   }
 #undef QED_SWITCHBW2INT
-  return true;
 }
 
 bool VersionVerifier::Dump(std::ostream* os) const {
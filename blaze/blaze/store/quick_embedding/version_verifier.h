@@ -5,6 +5,7 @@
 #pragma once
 
 #include "blaze/store/quick_embedding/serializable.h"
+#include "blaze/store/quick_embedding/quantized_weight.h"
 #include "blaze/common/common_defines.h"
 #include "blaze/common/types.h"
 
@@ -17,7 +18,10 @@ enum class DictValueType {
   unknown = -1,
   fp32 = 0,
   fp16 = 1,
-  int8 = 2
+  int8 = 2,
+  // row-wise quantized
+  int8_rowwise = 3,
+  int4_rowwise = 4
 };
 
 #define SWITCHTYPE_DictValueType(vt, t, ...)  \
@@ -25,9 +29,21 @@ switch(vt) { \
 case DictValueType::fp32: {typedef float t; __VA_ARGS__} break; \
 case DictValueType::fp16: {typedef float16 t; __VA_ARGS__} break; \
 case DictValueType::int8: {typedef int8_t t; __VA_ARGS__} break; \
+case DictValueType::int8_rowwise: {typedef qint8 t; __VA_ARGS__} break; \
+case DictValueType::int4_rowwise: {typedef qint4 t; __VA_ARGS__} break; \
 default : LOG_ERROR("unsupported value: %d", static_cast<std::underlying_type<DictValueType>::type>(vt)); break;\
 }
 
+// the value types which the lookups reduce
+#define SWITCHTYPE_LookupDictValueType(vt, t, ...)  \
+switch(vt) { \
+case DictValueType::fp32: {typedef float t; __VA_ARGS__} break; \
+case DictValueType::fp16: {typedef float16 t; __VA_ARGS__} break; \
+case DictValueType::int8_rowwise: {typedef qint8 t; __VA_ARGS__} break; \
+case DictValueType::int4_rowwise: {typedef qint4 t; __VA_ARGS__} break; \
+default : BLAZE_THROW("invalid dict value data type: ", static_cast<std::underlying_type<DictValueType>::type>(vt)); \
+}
+
 template<typename T>
 struct DictValueTypeFromType {
   static DictValueType valueType() {
@@ -56,6 +72,20 @@ struct DictValueTypeFromType<int8_t> {
   }
 };
 
+template<>
+struct DictValueTypeFromType<qint8> {
+  static DictValueType valueType() {
+    return DictValueType::int8_rowwise;
+  }
+};
+
+template<>
+struct DictValueTypeFromType<qint4> {
+  static DictValueType valueType() {
+    return DictValueType::int4_rowwise;
+  }
+};
+
 class VersionVerifier : public Serializable {
  public:
   explicit VersionVerifier(DictValueType valueType = DictValueType::fp32);
@@ -79,10 +109,16 @@ class VersionVerifier : public Serializable {
   // load from istream
   bool Load(std::istream *is) override;
 
+  // attach to mapped bytes
+  bool Attach(const char *bytes, uint64_t size, uint64_t *pos) override;
+
   // dump to ostream
   bool Dump(std::ostream *os) const override;
 
  private:
+  // value type of the version
+  void ParseValueType();
+
   const uint32_t version_;
   DictValueType type_;
 };
@@ -7,6 +7,7 @@
 #include <malloc.h>
 
 #include "blaze/store/quick_embedding/serializable.h"
+#include "blaze/store/quick_embedding/quantized_weight.h"
 #include "blaze/common/log.h"
 
 namespace blaze {
@@ -18,15 +19,25 @@ class WeightBlob : public Serializable {
   WeightBlob() :
       bytes_(nullptr),
       byte_size_(1),
-      capacity_size_(0) {}
+      capacity_size_(0),
+      owned_(true) {}
 
   ~WeightBlob() override {
-    if (bytes_)
+    if (bytes_ && owned_)
       free(bytes_);
   }
 
   bool AllocateMemory(size_t size) {
-    size_t len = sizeof(T) * size + 1;
+    return AllocateBytes(sizeof(T) * size);
+  }
+
+  // allocate memory of rows of dim weights
+  bool AllocateRows(size_t rows, int dim) {
+    return AllocateBytes(WeightRow<T>::Bytes(dim) * rows);
+  }
+
+  bool AllocateBytes(size_t size) {
+    size_t len = size + 1;
     char *new_bytes = reinterpret_cast<char *>(malloc(len));
     if (!new_bytes) {
       LOG_ERROR("bad alloc memory of whole blob!");
@@ -40,7 +51,7 @@ class WeightBlob : public Serializable {
   }
 
   uint64_t InsertWeights(int dim, T **weights) {
-    size_t len = sizeof(T) * dim;
+    size_t len = WeightRow<T>::Bytes(dim);
     if (byte_size_ + len > capacity_size_) {
       return 0;
     }
@@ -73,9 +84,10 @@ class WeightBlob : public Serializable {
       LOG_ERROR("bad allocate memory of weight blob while loading");
       return false;
     }
-    if (bytes_)
+    if (bytes_ && owned_)
       free(bytes_);
     bytes_ = new_bytes;
+    owned_ = true;
     // [step3]: load bytes
     is->read(bytes_, byte_size_);
     if (!is->good()) return false;
@@ -83,6 +95,22 @@ class WeightBlob : public Serializable {
     return true;
   }
 
+  bool Attach(const char *bytes, uint64_t size, uint64_t *pos) override {
+    // [step1]: read byte size
+    uint64_t byte_size;
+    if (!ReadBytes(bytes, size, pos, &byte_size)) return false;
+    if (*pos + byte_size > size) return false;
+    // [step2]: point to the weights
+    if (bytes_ && owned_)
+      free(bytes_);
+    bytes_ = const_cast<char *>(bytes + *pos);
+    byte_size_ = byte_size;
+    capacity_size_ = byte_size;
+    owned_ = false;
+    *pos += byte_size;
+    return true;
+  }
+
   bool Dump(std::ostream *os) const override {
     if (byte_size_ == 0 || bytes_ == nullptr)
       return false;
@@ -101,6 +129,8 @@ class WeightBlob : public Serializable {
   char *bytes_;
   uint64_t byte_size_;
   uint64_t capacity_size_;
+  // whether bytes_ is owned, or attached to mapped bytes
+  bool owned_;
 };
 
 }  // namespace store
@@ -78,6 +78,8 @@ class SparsePuller {
  public:
   virtual ~SparsePuller() { }
   virtual Status Load(const std::string& url) { return kFail; }
+  // apply the changed rows of a refresh over the loaded weights
+  virtual Status LoadDelta(const std::string& url) { return kFail; }
   virtual Status Get(const std::vector<SparsePullerInput>& input,
                      std::vector<SparsePullerOutput>& output) { return kFail; }
 };
@@ -9,6 +9,10 @@
 #include "blaze/proto/blaze.pb.h"
 
 #include <math.h>
+
+#include <atomic>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 namespace blaze {
@@ -188,4 +192,154 @@ TEST(TestPreditorManager, Load) {
   EXPECT_EQ(0, ret);
 }
 
+TEST(TestPreditorManager, BatchForward) {
+  PredictorManagerHandle handle;
+  auto ret = Blaze_PredictorManagerCreate(&handle);
+  EXPECT_EQ(0, ret);
+  ret = Blaze_PredcitorManagerLoadModel(handle, "./dnn.onnx2blaze", 1);
+  EXPECT_EQ(0, ret);
+
+  const size_t kRequestNum = 4;
+  std::vector<PredictorHandle> predictors(kRequestNum, nullptr);
+  for (size_t i = 0; i < kRequestNum; ++i) {
+    ret = Blaze_PredictorCreate(handle, 0, 0, &predictors[i]);
+    EXPECT_EQ(0, ret);
+  }
+
+  const char* input_names[] = { "comm", "ncomm" };
+  size_t input_ndims[] = { 2, 2 };
+  int input_shapes[] = { 10, 540, 10, 360 };
+  std::vector<float> comm(10 * 540, 0.1), ncomm(10 * 360, 0.1);
+  void* input_data[] = { comm.data(), ncomm.data() };
+  size_t input_lens[] = { comm.size() * sizeof(float), ncomm.size() * sizeof(float) };
+  const char* output_names[] = { "out" };
+
+  std::vector<std::vector<float>> outputs(kRequestNum, std::vector<float>(10 * 2));
+  std::vector<void*> output_data(kRequestNum);
+  std::vector<size_t> output_lens(kRequestNum);
+  std::vector<Blaze_PredictRequest> requests(kRequestNum);
+  for (size_t i = 0; i < kRequestNum; ++i) {
+    output_data[i] = outputs[i].data();
+    output_lens[i] = outputs[i].size() * sizeof(float);
+    requests[i] = { predictors[i], 2, input_names, input_ndims, input_shapes,
+                    input_data, input_lens, 1, output_names, &output_data[i], &output_lens[i] };
+  }
+
+  std::atomic<size_t> done_num(0);
+  BatchForwardHandle batch_handle = nullptr;
+  ret = Blaze_PredictorBatchForward(requests.data(), kRequestNum,
+      [](void* user_data, size_t request_idx, int status) {
+        ++(*reinterpret_cast<std::atomic<size_t>*>(user_data));
+      }, &done_num, &batch_handle);
+  EXPECT_EQ(0, ret);
+  ret = Blaze_BatchForwardWait(batch_handle, 0);
+  EXPECT_EQ(0, ret);
+
+  size_t finished = 0;
+  ret = Blaze_BatchForwardPoll(batch_handle, &finished);
+  EXPECT_EQ(0, ret);
+  EXPECT_EQ(kRequestNum, finished);
+  EXPECT_EQ(kRequestNum, done_num.load());
+  std::vector<int> status(kRequestNum, BLAZE_REQUEST_PENDING);
+  ret = Blaze_BatchForwardStatus(batch_handle, kRequestNum, status.data());
+  EXPECT_EQ(0, ret);
+  for (size_t i = 0; i < kRequestNum; ++i) {
+    EXPECT_EQ(BLAZE_REQUEST_OK, status[i]);
+    EXPECT_EQ(10 * 2 * sizeof(float), output_lens[i]);
+    EXPECT_FLOAT_EQ(outputs[0][0], outputs[i][0]);
+  }
+
+  // a predictor takes one request at a time
+  requests[1].predictor = requests[0].predictor;
+  ret = Blaze_PredictorBatchForward(requests.data(), kRequestNum, nullptr, nullptr, nullptr);
+  EXPECT_EQ(-1, ret);
+
+  ret = Blaze_BatchForwardDelete(batch_handle);
+  EXPECT_EQ(0, ret);
+  for (size_t i = 0; i < kRequestNum; ++i) {
+    ret = Blaze_PredictorDelete(predictors[i]);
+    EXPECT_EQ(0, ret);
+  }
+  ret = Blaze_PredictorManagerDelete(handle);
+  EXPECT_EQ(0, ret);
+}
+
+TEST(TestPreditorManager, PredictMany) {
+  PredictorManagerHandle handle;
+  auto ret = Blaze_PredictorManagerCreate(&handle);
+  EXPECT_EQ(0, ret);
+  ret = Blaze_PredcitorManagerLoadModel(handle, "./dnn.onnx2blaze", 1);
+  EXPECT_EQ(0, ret);
+
+  const size_t kPredictorNum = 3;
+  std::vector<PredictorHandle> predictors(kPredictorNum, nullptr);
+  for (size_t i = 0; i < kPredictorNum; ++i) {
+    ret = Blaze_PredictorCreate(handle, 0, 0, &predictors[i]);
+    EXPECT_EQ(0, ret);
+  }
+
+  // one shard fed and fetched by reference
+  const size_t kRows = 25;
+  std::vector<float> comm(kRows * 540, 0.1), ncomm(kRows * 360, 0.1);
+  int comm_shape[] = { 10, 540 };
+  int ncomm_shape[] = { 10, 360 };
+  ret = Blaze_PredictorReshapeInput(predictors[0], "comm", comm_shape, 2);
+  EXPECT_EQ(0, ret);
+  ret = Blaze_PredictorReshapeInput(predictors[0], "ncomm", ncomm_shape, 2);
+  EXPECT_EQ(0, ret);
+  ret = Blaze_PredictorFeedRef(predictors[0], "comm", comm.data(), 10 * 540 * sizeof(float));
+  EXPECT_EQ(0, ret);
+  ret = Blaze_PredictorFeedRef(predictors[0], "ncomm", ncomm.data(), 10 * 360 * sizeof(float));
+  EXPECT_EQ(0, ret);
+  ret = Blaze_PredictorForward(predictors[0]);
+  EXPECT_EQ(0, ret);
+  void* oref = nullptr;
+  size_t olen = 0;
+  ret = Blaze_PredictorOutputRef(predictors[0], "out", &oref, &olen);
+  EXPECT_EQ(0, ret);
+  EXPECT_EQ(10 * 2 * sizeof(float), olen);
+  float expected = reinterpret_cast<float*>(oref)[0];
+
+  // the rows are cut into 3 shards, the last of 5 rows
+  const char* input_names[] = { "comm", "ncomm" };
+  size_t input_ndims[] = { 2, 2 };
+  int input_shapes[] = { kRows, 540, kRows, 360 };
+  void* input_data[] = { comm.data(), ncomm.data() };
+  size_t input_lens[] = { comm.size() * sizeof(float), ncomm.size() * sizeof(float) };
+  const char* output_names[] = { "out" };
+  std::vector<float> out(kRows * 2, -1);
+  void* output_data[] = { out.data() };
+  size_t output_lens[] = { out.size() * sizeof(float) };
+  ret = Blaze_PredictorPredictMany(predictors.data(), kPredictorNum, kRows, 10,
+                                   2, input_names, input_ndims, input_shapes, input_data, input_lens,
+                                   1, output_names, output_data, output_lens);
+  EXPECT_EQ(0, ret);
+  EXPECT_EQ(kRows * 2 * sizeof(float), output_lens[0]);
+  for (size_t i = 0; i < kRows; ++i) {
+    EXPECT_FLOAT_EQ(expected, out[i * 2]);
+  }
+
+  // too small an output buffer
+  output_lens[0] = 10 * 2 * sizeof(float);
+  ret = Blaze_PredictorPredictMany(predictors.data(), kPredictorNum, kRows, 10,
+                                   2, input_names, input_ndims, input_shapes, input_data, input_lens,
+                                   1, output_names, output_data, output_lens);
+  EXPECT_EQ(-1, ret);
+
+  // a predictor runs one shard at a time
+  PredictorHandle shared[] = { predictors[0], predictors[0] };
+  output_lens[0] = out.size() * sizeof(float);
+  ret = Blaze_PredictorPredictMany(shared, 2, kRows, 10,
+                                   2, input_names, input_ndims, input_shapes, input_data, input_lens,
+                                   1, output_names, output_data, output_lens);
+  EXPECT_EQ(-1, ret);
+
+  for (size_t i = 0; i < kPredictorNum; ++i) {
+    ret = Blaze_PredictorDelete(predictors[i]);
+    EXPECT_EQ(0, ret);
+  }
+  ret = Blaze_PredictorManagerDelete(handle);
+  EXPECT_EQ(0, ret);
+}
+
 }  // namespace blaze
@@ -0,0 +1,60 @@
+// Test unit for AdaptiveBatchPolicy
+//
+#include "blaze/batching/adaptive_batch_policy.h"
+
+#include "gtest/gtest.h"
+
+namespace blaze {
+namespace batching {
+
+TEST(AdaptiveBatchPolicy, Static) {
+  AdaptiveBatchPolicy policy(100, 100, 0, {});
+  EXPECT_FALSE(policy.adaptive());
+  for (int i = 0; i < 1000; ++i) policy.Record(100, 100, 10000);
+  EXPECT_EQ(100, policy.max_batch_size());
+  EXPECT_EQ(100, policy.batch_timeout_micros());
+
+  BatchStats stats = policy.stats();
+  EXPECT_EQ(1000, stats.num_batches);
+  EXPECT_DOUBLE_EQ(1.0, stats.fill_ratio);
+  EXPECT_DOUBLE_EQ(100, stats.queueing_delay_micros);
+  EXPECT_DOUBLE_EQ(10100, stats.p99_latency_micros);
+}
+
+TEST(AdaptiveBatchPolicy, Decrease) {
+  AdaptiveBatchPolicy policy(128, 200, 1000, { 16, 32, 64 });
+  EXPECT_EQ(128, policy.max_batch_size());
+  // The latency is over the target, the batch size goes to the bucket under
+  // its half.
+  for (size_t i = 0; i < AdaptiveBatchPolicy::kAdjustBatches; ++i) policy.Record(128, 100, 2000);
+  EXPECT_EQ(64, policy.max_batch_size());
+  EXPECT_EQ(100, policy.batch_timeout_micros());
+  for (size_t i = 0; i < AdaptiveBatchPolicy::kAdjustBatches * 4; ++i) policy.Record(64, 100, 2000);
+  EXPECT_EQ(16, policy.max_batch_size());
+  EXPECT_EQ(6, policy.batch_timeout_micros());
+}
+
+TEST(AdaptiveBatchPolicy, Increase) {
+  AdaptiveBatchPolicy policy(64, 400, 10000, { 8, 32 });
+  for (size_t i = 0; i < AdaptiveBatchPolicy::kAdjustBatches; ++i) policy.Record(64, 100, 20000);
+  EXPECT_EQ(32, policy.max_batch_size());
+  EXPECT_EQ(200, policy.batch_timeout_micros());
+
+  // Full batches under the target grow to the next bucket, bounded by the
+  // configured limits.
+  for (size_t i = 0; i < AdaptiveBatchPolicy::kAdjustBatches; ++i) policy.Record(32, 100, 1000);
+  EXPECT_EQ(64, policy.max_batch_size());
+  EXPECT_EQ(400, policy.batch_timeout_micros());
+  for (size_t i = 0; i < AdaptiveBatchPolicy::kAdjustBatches; ++i) policy.Record(64, 100, 1000);
+  EXPECT_EQ(64, policy.max_batch_size());
+  EXPECT_EQ(400, policy.batch_timeout_micros());
+
+  // Batches which are not full keep their size
+  AdaptiveBatchPolicy partial(64, 400, 10000, { 8, 32 });
+  for (size_t i = 0; i < AdaptiveBatchPolicy::kAdjustBatches; ++i) partial.Record(64, 100, 20000);
+  for (size_t i = 0; i < AdaptiveBatchPolicy::kAdjustBatches; ++i) partial.Record(4, 100, 1000);
+  EXPECT_EQ(32, partial.max_batch_size());
+}
+
+}  // namespace batching
+}  // namespace blaze
@@ -74,5 +74,91 @@ TEST(SharedBatchScheduler, Test) {
   EXPECT_TRUE(callback_called);
 }
 
+class DeadlineTask : public BatchTask {
+ public:
+  DeadlineTask(int id, uint64_t deadline_micros) : id(id), deadline_micros(deadline_micros) { }
+  size_t size() const override { return 1; }
+
+  int id;
+  uint64_t deadline_micros;
+};
+
+TEST(SharedBatchScheduler, EarliestDeadlineFirst) {
+  std::vector<int> ids;
+  auto callback = [&ids](std::unique_ptr<Batch<DeadlineTask>> batch) {
+    for (int i = 0; i < batch->num_tasks(); ++i) ids.push_back(batch->task(i).id);
+  };
+  {
+    SharedBatchScheduler<DeadlineTask>::Options options;
+    options.num_batch_threads = 1;
+    std::shared_ptr<SharedBatchScheduler<DeadlineTask>> scheduler;
+    EXPECT_TRUE(SharedBatchScheduler<DeadlineTask>::Create(options, &scheduler));
+
+    SharedBatchScheduler<DeadlineTask>::QueueOptions queue_options;
+    queue_options.max_batch_size = 3;
+    queue_options.batch_timeout_micros = 1000 * 1000;
+    std::unique_ptr<BatchScheduler<DeadlineTask>> queue;
+    EXPECT_TRUE(scheduler->AddQueue(queue_options, callback, &queue));
+
+    /// the batch is full at the third task
+    uint64_t now = Env::NowMicros();
+    std::unique_ptr<DeadlineTask> task(new DeadlineTask(0, now + 20 * 1000 * 1000));
+    EXPECT_EQ(kOk, queue->Schedule(&task));
+    task.reset(new DeadlineTask(1, 0));
+    EXPECT_EQ(kOk, queue->Schedule(&task));
+    task.reset(new DeadlineTask(2, now + 10 * 1000 * 1000));
+    EXPECT_EQ(kOk, queue->Schedule(&task));
+  }
+  ASSERT_EQ(3, ids.size());
+  EXPECT_EQ(2, ids[0]);
+  EXPECT_EQ(0, ids[1]);
+  EXPECT_EQ(1, ids[2]);
+}
+
+TEST(SharedBatchScheduler, DropLateTasks) {
+  std::vector<int> ids;
+  std::vector<int> dropped;
+  auto callback = [&ids](std::unique_ptr<Batch<DeadlineTask>> batch) {
+    Env::SleepForMicroseconds(100 * 1000);
+    for (int i = 0; i < batch->num_tasks(); ++i) ids.push_back(batch->task(i).id);
+  };
+  {
+    SharedBatchScheduler<DeadlineTask>::Options options;
+    options.num_batch_threads = 1;
+    std::shared_ptr<SharedBatchScheduler<DeadlineTask>> scheduler;
+    EXPECT_TRUE(SharedBatchScheduler<DeadlineTask>::Create(options, &scheduler));
+
+    SharedBatchScheduler<DeadlineTask>::QueueOptions queue_options;
+    queue_options.max_batch_size = 1;
+    queue_options.drop_task_callback = [&dropped](std::unique_ptr<DeadlineTask> task) {
+      dropped.push_back(task->id);
+    };
+    std::unique_ptr<BatchScheduler<DeadlineTask>> queue;
+    EXPECT_TRUE(scheduler->AddQueue(queue_options, callback, &queue));
+
+    /// late at arrival
+    std::unique_ptr<DeadlineTask> task(new DeadlineTask(0, Env::NowMicros() - 1));
+    EXPECT_EQ(kDeadlineExceeded, queue->Schedule(&task));
+    EXPECT_NE(nullptr, task);
+
+    /// the first batch takes 100ms, which the second task can not wait for
+    task.reset(new DeadlineTask(1, 0));
+    EXPECT_EQ(kOk, queue->Schedule(&task));
+    Env::SleepForMicroseconds(10 * 1000);
+    task.reset(new DeadlineTask(2, Env::NowMicros() + 50 * 1000));
+    EXPECT_EQ(kOk, queue->Schedule(&task));
+    task.reset(new DeadlineTask(3, 0));
+    EXPECT_EQ(kOk, queue->Schedule(&task));
+
+    Env::SleepForMicroseconds(500 * 1000);
+    EXPECT_EQ(2, queue->stats().num_dropped);
+  }
+  ASSERT_EQ(2, ids.size());
+  EXPECT_EQ(1, ids[0]);
+  EXPECT_EQ(3, ids[1]);
+  ASSERT_EQ(1, dropped.size());
+  EXPECT_EQ(2, dropped[0]);
+}
+
 }  // namespace batching
 }  // namespace blaze
@@ -38,6 +38,22 @@ TEST(TestBlob, Reshape) {
   EXPECT_EQ(blob.capacity(), 9);
 }
 
+TEST(TestBlob, RefReshape) {
+  DeviceOption device_option;
+  Blob blob(device_option);
+  float data[6] = { 0 };
+  blob.RefReshape({ 2, 3 }, data);
+  EXPECT_EQ(blob.as<float>(), data);
+  EXPECT_EQ(blob.size(), 6);
+
+  // the released blob allocates its own memory again
+  blob.Release();
+  EXPECT_EQ(blob.data(), nullptr);
+  blob.Reshape({ 2, 3 });
+  EXPECT_NE(blob.as<float>(), data);
+  EXPECT_EQ(blob.capacity(), 6);
+}
+
 TEST(TestBlob, Copy) {
   DeviceOption device_option;
   Blob src_blob(device_option);
@@ -0,0 +1,45 @@
+/*
+ * \file intra_op_test.cc
+ * \brief The intra op threads test module
+ */
+#include "gtest/gtest.h"
+
+#include <thread>
+
+#include "blaze/common/intra_op.h"
+
+namespace blaze {
+
+TEST(TestIntraOp, SetIntraOpThreads) {
+  std::thread thread([] {
+    SetIntraOpThreads(3);
+    EXPECT_EQ(3, IntraOpThreads());
+    SetIntraOpThreads(0);
+    EXPECT_EQ(3, IntraOpThreads());
+  });
+  thread.join();
+}
+
+TEST(TestIntraOp, IntraOpThreadsGuard) {
+  std::thread thread([] {
+    SetIntraOpThreads(4);
+    {
+      IntraOpThreadsGuard guard(2);
+      EXPECT_EQ(2, IntraOpThreads());
+    }
+    EXPECT_EQ(4, IntraOpThreads());
+    {
+      // the budget never grows the share of the thread
+      IntraOpThreadsGuard guard(8);
+      EXPECT_EQ(4, IntraOpThreads());
+    }
+    {
+      IntraOpThreadsGuard guard(0);
+      EXPECT_EQ(4, IntraOpThreads());
+    }
+    EXPECT_EQ(4, IntraOpThreads());
+  });
+  thread.join();
+}
+
+}  // namespace blaze
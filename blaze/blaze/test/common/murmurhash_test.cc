@@ -0,0 +1,34 @@
+/*
+ * \file murmurhash_test.cc
+ * \brief The murmurhash test module
+ */
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include "blaze/common/murmurhash.h"
+
+namespace blaze {
+
+TEST(TestMurmurHash, MurmurHash64ABatch) {
+  std::vector<std::string> keys;
+  for (int i = 0; i < 43; ++i) {
+    keys.push_back(std::string(i, 'a' + i % 26) + "+" + std::to_string(i * 7919));
+  }
+  std::vector<const char*> ptrs;
+  std::vector<uint64_t> lens;
+  for (const auto& key : keys) {
+    ptrs.push_back(key.data());
+    lens.push_back(key.size());
+  }
+  for (uint64_t seed : { 0, 7621 }) {
+    std::vector<uint64_t> hashes(keys.size());
+    MurmurHash64ABatch(ptrs.data(), lens.data(), keys.size(), hashes.data(), seed);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      EXPECT_EQ(MurmurHash64A(keys[i].data(), keys[i].size(), seed), hashes[i]);
+    }
+  }
+}
+
+}  // namespace blaze
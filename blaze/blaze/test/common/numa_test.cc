@@ -0,0 +1,60 @@
+/*
+ * \file numa_test.cc
+ * \brief The numa test module
+ */
+#include "gtest/gtest.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <thread>
+
+#include "blaze/common/numa.h"
+
+namespace blaze {
+
+namespace {
+
+int ThreadCpuNum() {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  pthread_getaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  return CPU_COUNT(&cpu_set);
+}
+
+}  // namespace
+
+TEST(TestNuma, NodeCpus) {
+  EXPECT_LE(1, NumaNodeNum());
+  EXPECT_TRUE(NumaNodeCpus(-1).empty());
+  EXPECT_TRUE(NumaNodeCpus(NumaNodeNum()).empty());
+  EXPECT_GT(NumaNodeNum(), GpuNumaNode(0));
+}
+
+TEST(TestNuma, BindThreadToCpus) {
+  std::vector<int> cpus = ProcessCpus();
+  ASSERT_FALSE(cpus.empty());
+  EXPECT_EQ(cpus.size(), ThreadCpuNum());
+  EXPECT_FALSE(BindThreadToCpus(std::vector<int>()));
+  std::thread thread([&cpus] {
+    EXPECT_TRUE(BindThreadToCpus({ cpus[0] }));
+    EXPECT_EQ(1, ThreadCpuNum());
+  });
+  thread.join();
+  EXPECT_EQ(cpus.size(), ThreadCpuNum());
+}
+
+TEST(TestNuma, NumaNodeGuard) {
+  int cpu_num = ThreadCpuNum();
+  {
+    NumaNodeGuard guard(NumaNodeNum() - 1);
+    EXPECT_LE(ThreadCpuNum(), cpu_num);
+  }
+  EXPECT_EQ(cpu_num, ThreadCpuNum());
+  {
+    NumaNodeGuard guard(-1);
+    EXPECT_EQ(cpu_num, ThreadCpuNum());
+  }
+}
+
+}  // namespace blaze
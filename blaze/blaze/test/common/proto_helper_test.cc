@@ -57,6 +57,69 @@ TEST(TestLoadNetDefFromBinaryFile, LoadNetDefFromBinaryFile) {
   EXPECT_TRUE(ret);
 }
 
+TEST(TestNetDefHelper, CommonOps) {
+  // u and w are common, y = Gemm(Gemm(u, w), x) is not
+  NetDef net_def;
+  ValueInfo* u = net_def.add_external_input();
+  u->set_name("u");
+  u->set_level(1);
+  ValueInfo* indicator = net_def.add_external_input();
+  indicator->set_name("indicator");
+  indicator->set_level(1);
+  indicator->set_input_type(kInputIndicator);
+  net_def.add_external_input()->set_name("x");
+
+  std::vector<std::vector<std::string>> ops = {
+    { "ConstantFill", "", "w" }, { "Gemm", "u,w", "h" }, { "BroadcastTo", "h,indicator", "b" },
+    { "Gemm", "b,x", "y" }, { "Sigmoid", "w", "s" }
+  };
+  for (const auto& item : ops) {
+    OperatorDef* op = net_def.add_op();
+    op->set_type(item[0]);
+    size_t begin = 0;
+    while (begin < item[1].size()) {
+      size_t end = item[1].find(',', begin);
+      if (end == std::string::npos) end = item[1].size();
+      op->add_input(item[1].substr(begin, end - begin));
+      begin = end + 1;
+    }
+    op->add_output(item[2]);
+  }
+
+  std::unordered_set<std::string> common;
+  std::vector<bool> common_ops = NetDefHelper::CommonOps(net_def, &common);
+  std::vector<bool> expected = { false, true, false, false, false };
+  EXPECT_EQ(expected, common_ops);
+  EXPECT_EQ(std::unordered_set<std::string>({ "u", "h" }), common);
+}
+
+TEST(TestNetDefHelper, Consumers) {
+  // x is read by two ops, y twice by one op, z once and s is the output
+  NetDef net_def;
+  net_def.add_external_output()->set_name("s");
+  std::vector<std::vector<std::string>> ops = {
+    { "Gemm", "x,w", "y" }, { "Mul", "y,y", "z" }, { "Add", "z,x", "s" }
+  };
+  for (const auto& item : ops) {
+    OperatorDef* op = net_def.add_op();
+    op->set_type(item[0]);
+    size_t begin = 0;
+    while (begin < item[1].size()) {
+      size_t end = item[1].find(',', begin);
+      if (end == std::string::npos) end = item[1].size();
+      op->add_input(item[1].substr(begin, end - begin));
+      begin = end + 1;
+    }
+    op->add_output(item[2]);
+  }
+
+  EXPECT_EQ(std::unordered_set<std::string>({ "s" }), NetDefHelper::ExternalOutputs(net_def));
+  std::unordered_map<std::string, int> consumer = { { "x", -1 }, { "w", 0 }, { "y", -1 }, { "z", 2 } };
+  EXPECT_EQ(consumer, NetDefHelper::SingleConsumers(net_def));
+  std::unordered_map<std::string, int> reads = { { "x", 2 }, { "w", 1 }, { "y", 2 }, { "z", 1 } };
+  EXPECT_EQ(reads, NetDefHelper::ReadCounts(net_def));
+}
+
 }  // namespace blaze
 
 
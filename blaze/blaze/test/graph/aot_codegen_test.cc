@@ -0,0 +1,139 @@
+/*
+ * \file aot_codegen_test.cc
+ * \brief The aot codegen and aot net test
+ */
+#include "gtest/gtest.h"
+
+#include "blaze/graph/aot_codegen.h"
+#include "blaze/graph/aot_net.h"
+#include "blaze/graph/workspace.h"
+#include "blaze/operator/op/sigmoid_op.h"
+
+namespace blaze {
+
+namespace {
+
+// y = Sigmoid(x)
+NetDef SigmoidNet() {
+  NetDef net_def;
+  net_def.set_run_mode("simple");
+  net_def.mutable_device_option()->set_device_type(kCPU);
+  ValueInfo* x = net_def.add_external_input();
+  x->set_name("x");
+  x->set_dtype(kFloat);
+  ValueInfo* y = net_def.add_external_output();
+  y->set_name("y");
+  y->set_dtype(kFloat);
+  OperatorDef* op = net_def.add_op();
+  op->set_type("Sigmoid");
+  op->set_name("sigmoid");
+  op->add_input("x");
+  op->add_output("y");
+  return net_def;
+}
+
+void Feed(Net* net, TIndex batch) {
+  Blob* x = net->external_input_blob("x");
+  x->set_data_type(kFloat);
+  x->Reshape({ batch, 4 });
+  for (TIndex k = 0; k < x->size(); ++k) x->as<float>()[k] = 0;
+}
+
+// The unit AotCodegen generates for SigmoidNet with the bucket { 2, 4 }
+const TIndex kBucket0Input0[] = { 2, 4 };
+
+class SigmoidAotNet final : public AotNet {
+ public:
+  SigmoidAotNet(const std::shared_ptr<const NetDef>& net_def, Workspace* ws) :
+      AotNet(net_def, ws, AotNet::Signature(SigmoidNet())) {
+    op0_ = TypedOperator<SigmoidOp<CPUContext>>(0);
+    Reserve("y", kFloat, 8);
+  }
+
+  int compiled_runs = 0;
+
+ protected:
+  int Bucket() override {
+    if (InputShapeIs(0, kBucket0Input0, 2)) {
+      return 0;
+    }
+    return -1;
+  }
+
+  bool RunCompiled(bool skip_common) override {
+    ++compiled_runs;
+    if (!op0_->SigmoidOp<CPUContext>::RunOnDevice()) return false;
+    return true;
+  }
+
+ private:
+  SigmoidOp<CPUContext>* op0_;
+};
+
+}  // namespace
+
+TEST(TestAotCodegen, Generate) {
+  Workspace workspace;
+  workspace.Init(SigmoidNet());
+  std::shared_ptr<Net> net = workspace.CreateNet();
+  AotCodegen codegen(net->net_def());
+  EXPECT_ANY_THROW(codegen.Generate("sigmoid"));
+  for (TIndex batch : { 1, 8 }) {
+    Feed(net.get(), batch);
+    ASSERT_TRUE(net->Run());
+    codegen.AddBucket(net.get());
+  }
+
+  std::string code = codegen.Generate("sigmoid");
+  for (const char* line : {
+      "#include \"blaze/operator/op/sigmoid_op.h\"",
+      "const TIndex kBucket0Input0[] = { 1, 4 };",
+      "const TIndex kBucket1Input0[] = { 8, 4 };",
+      "op0_ = TypedOperator<SigmoidOp<CPUContext>>(0);",
+      "Reserve(\"y\", static_cast<DataType>(1), 32);",
+      "if (InputShapeIs(0, kBucket1Input0, 2)) {",
+      "if (!op0_->SigmoidOp<CPUContext>::RunOnDevice()) return false;",
+      "REGISTER_NET(aot_sigmoid, AotNet_sigmoid);",
+      "return \"aot_sigmoid\";" }) {
+    EXPECT_NE(std::string::npos, code.find(line)) << line;
+  }
+  EXPECT_ANY_THROW(codegen.Generate("1sigmoid"));
+
+  NetDef gpu_net = SigmoidNet();
+  gpu_net.mutable_device_option()->set_device_type(kCUDA);
+  AotCodegen gpu_codegen(gpu_net);
+  gpu_codegen.AddBucket(net.get());
+  EXPECT_ANY_THROW(gpu_codegen.Generate("sigmoid"));
+}
+
+TEST(TestAotNet, Run) {
+  Workspace workspace;
+  workspace.Init(SigmoidNet());
+  SigmoidAotNet net(workspace.net_def(), &workspace);
+  EXPECT_EQ(8, net.net_blob("y")->capacity());
+
+  Feed(&net, 2);
+  ASSERT_TRUE(net.Run());
+  EXPECT_EQ(1, net.compiled_runs);
+  Blob* y = net.external_output_blob("y");
+  ASSERT_EQ(8, y->size());
+  EXPECT_FLOAT_EQ(0.5, y->as<float>()[7]);
+
+  // the shapes of no bucket run as a simple net
+  Feed(&net, 3);
+  ASSERT_TRUE(net.Run());
+  EXPECT_EQ(1, net.compiled_runs);
+  ASSERT_EQ(12, y->size());
+  EXPECT_FLOAT_EQ(0.5, y->as<float>()[11]);
+}
+
+TEST(TestAotNet, Signature) {
+  NetDef net_def = SigmoidNet();
+  net_def.mutable_op(0)->set_output(0, "z");
+  net_def.mutable_external_output(0)->set_name("z");
+  Workspace workspace;
+  workspace.Init(net_def);
+  EXPECT_ANY_THROW(SigmoidAotNet(workspace.net_def(), &workspace));
+}
+
+}  // namespace blaze
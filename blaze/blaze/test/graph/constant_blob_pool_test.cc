@@ -0,0 +1,49 @@
+/*
+ * \file constant_blob_pool_test.cc
+ * \brief The constant blob pool test
+ */
+#include "gtest/gtest.h"
+
+#include <string.h>
+
+#include "blaze/graph/constant_blob_pool.h"
+
+namespace blaze {
+
+namespace {
+
+std::shared_ptr<Blob> Acquire(const std::vector<float>& value, int* fills) {
+  DeviceOption device_option;
+  device_option.set_device_type(kCPU);
+  device_option.set_device_id(0);
+  std::vector<TIndex> shape = { static_cast<TIndex>(value.size()) };
+  return ConstantBlobPool::Get()->Acquire(device_option, kFloat, shape, value.data(),
+                                          value.size() * sizeof(float),
+                                          [&value, fills](Blob* blob) {
+    memcpy(blob->as<float>(), value.data(), value.size() * sizeof(float));
+    ++(*fills);
+  });
+}
+
+}  // namespace
+
+TEST(TestConstantBlobPool, Share) {
+  int fills = 0;
+  std::shared_ptr<Blob> a = Acquire({ 1, 2, 3 }, &fills);
+  std::shared_ptr<Blob> b = Acquire({ 1, 2, 3 }, &fills);
+  std::shared_ptr<Blob> c = Acquire({ 1, 2, 4 }, &fills);
+  EXPECT_EQ(a.get(), b.get());
+  EXPECT_NE(a.get(), c.get());
+  EXPECT_EQ(2, fills);
+  EXPECT_FLOAT_EQ(4, c->as<float>()[2]);
+  EXPECT_EQ(2u, ConstantBlobPool::Get()->size());
+
+  // the released blobs are filled again
+  a.reset();
+  b.reset();
+  EXPECT_EQ(1u, ConstantBlobPool::Get()->size());
+  a = Acquire({ 1, 2, 3 }, &fills);
+  EXPECT_EQ(3, fills);
+}
+
+}  // namespace blaze
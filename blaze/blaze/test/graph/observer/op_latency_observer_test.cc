@@ -0,0 +1,70 @@
+/*
+ * \file op_latency_observer_test.cc
+ * \brief The op latency observer test unit
+ */
+#include "gtest/gtest.h"
+
+#include "blaze/graph/observer/op_latency_observer.h"
+
+namespace blaze {
+
+TEST(TestOpLatencyHistogram, Record) {
+  OpLatencyHistogram histogram("Gemm");
+  histogram.Record(0);
+  histogram.Record(3);
+  histogram.Record(4);
+  histogram.Record(1ull << 40);
+  EXPECT_EQ(4u, histogram.count());
+  EXPECT_EQ(7u + (1ull << 40), histogram.sum_micros());
+  std::vector<uint64_t> buckets = histogram.buckets();
+  ASSERT_EQ(OpLatencyHistogram::kBucketNum, buckets.size());
+  EXPECT_EQ(1u, buckets[0]);
+  EXPECT_EQ(1u, buckets[2]);
+  EXPECT_EQ(1u, buckets[3]);
+  EXPECT_EQ(1u, buckets[OpLatencyHistogram::kBucketNum - 1]);
+
+  histogram.Reset();
+  EXPECT_EQ(0u, histogram.count());
+  EXPECT_EQ(0u, histogram.buckets()[0]);
+}
+
+TEST(TestOpLatencyRegistry, Dump) {
+  OpLatencyRegistry* registry = OpLatencyRegistry::Instance();
+  OpLatencyRegistry::NetLatency* latency = registry->Get("test_net");
+  EXPECT_EQ(latency, registry->Get("test_net"));
+  OpLatencyHistogram* gemm = nullptr;
+  {
+    std::unique_lock<std::mutex> lock(latency->mutex);
+    gemm = latency->Get("fc1", "Gemm");
+    EXPECT_EQ(gemm, latency->Get("fc1", "Gemm"));
+  }
+  gemm->Record(3);
+  gemm->Record(100);
+
+  size_t visited = 0;
+  registry->Visit([&visited](const std::string& net, const std::string& op,
+                             const OpLatencyHistogram& histogram) {
+    if (net != "test_net") return;
+    EXPECT_EQ("fc1", op);
+    EXPECT_EQ("Gemm", histogram.type());
+    EXPECT_EQ(2u, histogram.count());
+    ++visited;
+  });
+  EXPECT_EQ(1u, visited);
+
+  std::string dump = registry->Dump();
+  const std::string labels = "net=\"test_net\",op=\"fc1\",type=\"Gemm\"";
+  EXPECT_NE(std::string::npos,
+            dump.find("blaze_op_latency_micros_bucket{" + labels + ",le=\"2\"} 0\n"));
+  EXPECT_NE(std::string::npos,
+            dump.find("blaze_op_latency_micros_bucket{" + labels + ",le=\"4\"} 1\n"));
+  EXPECT_NE(std::string::npos,
+            dump.find("blaze_op_latency_micros_bucket{" + labels + ",le=\"+Inf\"} 2\n"));
+  EXPECT_NE(std::string::npos, dump.find("blaze_op_latency_micros_sum{" + labels + "} 103\n"));
+  EXPECT_NE(std::string::npos, dump.find("blaze_op_latency_micros_count{" + labels + "} 2\n"));
+
+  registry->Clear();
+  EXPECT_EQ(0u, gemm->count());
+}
+
+}  // namespace blaze
@@ -0,0 +1,139 @@
+/*
+ * \file cost_placement_test.cc
+ * \brief The cost placement test unit
+ */
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "blaze/graph/transform/cost_placement.h"
+#include "blaze/common/proto_helper.h"
+
+namespace blaze {
+
+namespace {
+
+OperatorDef* AddOp(NetDef* net_def, const std::string& type, const std::string& name,
+                   const std::vector<std::string>& inputs, const std::string& output) {
+  OperatorDef* op = net_def->add_op();
+  op->set_type(type);
+  op->set_name(name);
+  for (const auto& input : inputs) op->add_input(input);
+  op->add_output(output);
+  return op;
+}
+
+// x -> sigmoid(cpu) -> a, mul(a, c) -> b, gemm(b, w) -> y on gpu
+NetDef PlacementNet() {
+  NetDef net_def;
+  net_def.set_run_mode("hybrid");
+  net_def.mutable_device_option()->set_device_type(kCUDA);
+  net_def.mutable_device_option()->set_device_id(0);
+  net_def.add_external_input()->set_name("x");
+  net_def.add_external_output()->set_name("y");
+  Argument* arg = net_def.add_arg();
+  arg->set_name("placement_batch_size");
+  arg->add_ints(1);
+  arg->add_ints(100);
+
+  OperatorDef* sigmoid = AddOp(&net_def, "Sigmoid", "sigmoid", { "x" }, "a");
+  sigmoid->mutable_device_option()->set_device_type(kCPU);
+  ArgumentHelper::SetRepeatedArgument<float>(*sigmoid, "placement_cpu_micros", { 10, 10 });
+  AddOp(&net_def, "ConstantFill", "c_fill", { }, "c");
+  OperatorDef* mul = AddOp(&net_def, "Mul", "mul", { "a", "c" }, "b");
+  ArgumentHelper::SetRepeatedArgument<float>(*mul, "placement_cpu_micros", { 1, 500 });
+  ArgumentHelper::SetRepeatedArgument<float>(*mul, "placement_gpu_micros", { 5, 5 });
+  AddOp(&net_def, "ConstantFill", "w_fill", { }, "w");
+  OperatorDef* gemm = AddOp(&net_def, "Gemm", "gemm", { "b", "w" }, "y");
+  ArgumentHelper::SetRepeatedArgument<float>(*gemm, "placement_cpu_micros", { 100, 100 });
+  ArgumentHelper::SetRepeatedArgument<float>(*gemm, "placement_gpu_micros", { 10, 10 });
+  return net_def;
+}
+
+}  // namespace
+
+TEST(TestCostPlacement, Bucket) {
+  CostPlacement placement(PlacementNet());
+  EXPECT_EQ(2u, placement.bucket_num());
+  EXPECT_EQ(0u, placement.Bucket(1));
+  EXPECT_EQ(1u, placement.Bucket(50));
+  EXPECT_EQ(1u, placement.Bucket(1000));
+  EXPECT_EQ(kCPU, placement.input_device().at("x").device_type());
+}
+
+TEST(TestCostPlacement, Place) {
+  CostPlacement placement(PlacementNet());
+
+  // the small batch runs mul on cpu, with the constant cloned
+  NetDef small = placement.Place(0);
+  ASSERT_EQ(5, small.op_size());
+  EXPECT_EQ("sigmoid", small.op(0).name());
+  EXPECT_EQ("c_fill_cpu", small.op(1).name());
+  EXPECT_EQ(kCPU, small.op(1).device_option().device_type());
+  EXPECT_EQ("c_cpu", small.op(1).output(0));
+  const OperatorDef& mul = small.op(2);
+  EXPECT_EQ(kCPU, mul.device_option().device_type());
+  EXPECT_EQ("c_cpu", mul.input(1));
+  EXPECT_EQ("b_cpu", mul.output(0));
+  EXPECT_EQ("w_fill", small.op(3).name());
+  const OperatorDef& gemm = small.op(4);
+  EXPECT_FALSE(gemm.has_device_option());
+  EXPECT_EQ("b_cpu", gemm.input(0));
+  EXPECT_EQ("y", gemm.output(0));
+
+  // the large batch keeps mul on gpu
+  NetDef large = placement.Place(1);
+  ASSERT_EQ(5, large.op_size());
+  EXPECT_EQ("c_fill", large.op(1).name());
+  EXPECT_EQ("b", large.op(2).output(0));
+  EXPECT_FALSE(large.op(2).has_device_option());
+  EXPECT_EQ("b", large.op(4).input(0));
+}
+
+TEST(TestCostPlacement, InputBridge) {
+  NetDef net_def = PlacementNet();
+  // sigmoid may run on gpu, and is faster there
+  ArgumentHelper::SetRepeatedArgument<float>(*net_def.mutable_op(0), "placement_gpu_micros", { 1, 1 });
+  ArgumentHelper::SetRepeatedArgument<float>(*net_def.mutable_op(2), "placement_cpu_micros", { 500, 500 });
+  CostPlacement placement(net_def);
+
+  NetDef placed = placement.Place(0);
+  ASSERT_EQ(6, placed.op_size());
+  const OperatorDef& bridge = placed.op(0);
+  EXPECT_EQ("Bridge", bridge.type());
+  EXPECT_EQ("x", bridge.input(0));
+  EXPECT_EQ("x_bridge", bridge.output(0));
+  EXPECT_TRUE(bridge.device_option().is_pipe());
+  const OperatorDef& sigmoid = placed.op(1);
+  EXPECT_EQ(kCUDA, sigmoid.device_option().device_type());
+  EXPECT_EQ("x_bridge", sigmoid.input(0));
+  EXPECT_EQ("a_cuda0", sigmoid.output(0));
+  EXPECT_EQ("a_cuda0", placed.op(3).input(0));
+}
+
+TEST(TestCostPlacement, AddProfile) {
+  NetDef net_def = PlacementNet();
+  CostPlacement::AddProfile("mul 0 3.5 0 400\nmul_bridge 1 2 0 0\n", 50, &net_def);
+
+  std::vector<int> batch_size =
+      ArgumentHelper::GetRepeatedArgument<NetDef, int>(net_def, "placement_batch_size");
+  ASSERT_EQ(3u, batch_size.size());
+  EXPECT_EQ(50, batch_size[1]);
+  const OperatorDef& mul = net_def.op(2);
+  std::vector<float> cpu_micros =
+      ArgumentHelper::GetRepeatedArgument<OperatorDef, float>(mul, "placement_cpu_micros");
+  ASSERT_EQ(3u, cpu_micros.size());
+  EXPECT_FLOAT_EQ(1, cpu_micros[0]);
+  EXPECT_FLOAT_EQ(3.5, cpu_micros[1]);
+  EXPECT_FLOAT_EQ(500, cpu_micros[2]);
+  std::vector<float> gpu_micros =
+      ArgumentHelper::GetRepeatedArgument<OperatorDef, float>(mul, "placement_gpu_micros");
+  ASSERT_EQ(3u, gpu_micros.size());
+  EXPECT_FLOAT_EQ(-1, gpu_micros[1]);
+  std::vector<int64_t> output_bytes =
+      ArgumentHelper::GetRepeatedArgument<OperatorDef, int64_t>(mul, "placement_output_bytes");
+  ASSERT_EQ(3u, output_bytes.size());
+  EXPECT_EQ(400, output_bytes[1]);
+}
+
+}  // namespace blaze
@@ -0,0 +1,93 @@
+/*
+ * \file activation_kernel_test.cc
+ * \brief The activation kernel test unit
+ */
+#include "gtest/gtest.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "blaze/math/activation_kernel.h"
+
+namespace blaze {
+
+namespace {
+
+// 37 rows of 21 channels, which leaves a tail after the vectors
+const size_t kRows = 37;
+const size_t kChannels = 21;
+
+struct Data {
+  Data() : x(kRows * kChannels), y(kRows * kChannels), gamma(kChannels),
+           beta(kChannels), mean(kChannels), var(kChannels) {
+    srand(0);
+    for (auto& v : x) v = (rand() % 2000 - 1000) / 50.0;
+    for (size_t k = 0; k < kChannels; ++k) {
+      gamma[k] = rand() % 100 / 100.0;
+      beta[k] = rand() % 100 / 100.0;
+      mean[k] = rand() % 100 / 50.0 - 1;
+      var[k] = rand() % 100 / 20.0 + 0.1;
+    }
+  }
+  std::vector<float> x, y, gamma, beta, mean, var;
+};
+
+}  // namespace
+
+TEST(TestActivationKernel, Dice) {
+  Data d;
+  DiceKernel(d.x.data(), d.x.size(), d.gamma.data(), d.mean.data(), d.var.data(),
+             kChannels, false, 1e-8, d.y.data());
+  for (size_t i = 0; i < d.x.size(); ++i) {
+    size_t k = i % kChannels;
+    float x_normed = (d.x[i] - d.mean[k]) / sqrtf(d.var[k] + 1e-8);
+    float x_p = 1.0 / (1.0 + expf(-x_normed));
+    float expected = (1 - x_p) * d.gamma[k] * d.x[i] + x_p * d.x[i];
+    EXPECT_NEAR(expected, d.y[i], 1e-5 * (1 + fabs(expected)));
+  }
+}
+
+TEST(TestActivationKernel, PRelu) {
+  Data d;
+  PReluKernel(d.x.data(), d.x.size(), d.gamma.data(), kChannels, d.y.data());
+  for (size_t i = 0; i < d.x.size(); ++i) {
+    float expected = d.x[i] > 0 ? d.x[i] : d.x[i] * d.gamma[i % kChannels];
+    EXPECT_FLOAT_EQ(expected, d.y[i]);
+  }
+  // The shared slope
+  PReluKernel(d.x.data(), d.x.size(), d.gamma.data(), 1, d.y.data());
+  for (size_t i = 0; i < d.x.size(); ++i) {
+    float expected = d.x[i] > 0 ? d.x[i] : d.x[i] * d.gamma[0];
+    EXPECT_FLOAT_EQ(expected, d.y[i]);
+  }
+}
+
+TEST(TestActivationKernel, BatchNormalization) {
+  Data d;
+  BatchNormalizationKernel(d.x.data(), d.x.size(), d.gamma.data(), d.beta.data(),
+                           d.mean.data(), d.var.data(), kChannels, false, 1e-5, d.y.data());
+  for (size_t i = 0; i < d.x.size(); ++i) {
+    size_t k = i % kChannels;
+    float expected = d.gamma[k] * (d.x[i] - d.mean[k]) / sqrtf(d.var[k] + 1e-5) + d.beta[k];
+    EXPECT_NEAR(expected, d.y[i], 1e-5 * (1 + fabs(expected)));
+  }
+}
+
+TEST(TestActivationKernel, Softmax) {
+  Data d;
+  SoftmaxKernel(d.x.data(), kRows, kChannels, d.y.data());
+  for (size_t r = 0; r < kRows; ++r) {
+    const float* x = d.x.data() + r * kChannels;
+    double max_value = x[0], sum = 0;
+    for (size_t k = 0; k < kChannels; ++k) max_value = std::max<double>(max_value, x[k]);
+    for (size_t k = 0; k < kChannels; ++k) sum += exp(x[k] - max_value);
+    for (size_t k = 0; k < kChannels; ++k) {
+      EXPECT_NEAR(exp(x[k] - max_value) / sum, d.y[r * kChannels + k], 1e-6);
+    }
+  }
+}
+
+}  // namespace blaze
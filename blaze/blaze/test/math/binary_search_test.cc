@@ -2,6 +2,8 @@
  * \file binary_search_test.cc
  * \brief The binary search test unit
  */
+#include <vector>
+
 #include "gtest/gtest.h"
 
 #include "blaze/math/binary_search.h"
@@ -110,4 +112,44 @@ TEST(TestBinarySearch, BinarySearch) {
   }
 }
 
+TEST(TestBinarySearch, Unaligned) {
+  // The keys and results are views into the buffers off the vector alignment
+  std::vector<int64_t> data_64bit(N_SIZE), key_64bit(M_SIZE + 1);
+  std::vector<int32_t> data(N_SIZE), key(M_SIZE + 1);
+  for (int i = 0; i < N_SIZE; i++) {
+    data_64bit[i] = data[i] = i * 10;
+  }
+  for (int i = 0; i <= M_SIZE; i++) {
+    key_64bit[i] = key[i] = rand() % (N_SIZE * 10);
+  }
+  std::vector<int64_t> simple_result_64bit(M_SIZE + 1), simd_result_64bit(M_SIZE + 1);
+  SimpleBinarySearch<int64_t>(data_64bit.data(), N_SIZE, key_64bit.data() + 1, M_SIZE,
+                              simple_result_64bit.data() + 1);
+  BinarySearch<int64_t>(data_64bit.data(), N_SIZE, key_64bit.data() + 1, M_SIZE,
+                        simd_result_64bit.data() + 1);
+  std::vector<int32_t> simple_result(M_SIZE + 1), simd_result(M_SIZE + 1);
+  SimpleBinarySearch<int32_t>(data.data(), N_SIZE, key.data() + 1, M_SIZE, simple_result.data() + 1);
+  BinarySearch<int32_t>(data.data(), N_SIZE, key.data() + 1, M_SIZE, simd_result.data() + 1);
+  for (int i = 1; i <= M_SIZE; i++) {
+    EXPECT_EQ(simple_result_64bit[i], simd_result_64bit[i]);
+    EXPECT_EQ(simple_result[i], simd_result[i]);
+  }
+}
+
+TEST(TestBinarySearch, SmallN) {
+  int64_t key[M_SIZE];
+  for (int i = 0; i < M_SIZE; i++) {
+    key[i] = i % 3;
+  }
+  for (int n = 0; n <= 3; n++) {
+    int64_t data[3] = { 0, 1, 2 };
+    int64_t simple_result[M_SIZE], simd_result[M_SIZE];
+    SimpleBinarySearch<int64_t>(data, n, key, M_SIZE, simple_result);
+    BinarySearch<int64_t>(data, n, key, M_SIZE, simd_result);
+    for (int i = 0; i < M_SIZE; i++) {
+      EXPECT_EQ(simple_result[i], simd_result[i]);
+    }
+  }
+}
+
 }  // namespace blaze
\ No newline at end of file
@@ -39,6 +39,57 @@ TEST(TestGemm, Gemm) {
   }
 }
 
+TEST(TestGemmU8S8, GemmU8S8) {
+  uint8_t A[M * K];
+  int8_t B[K * N];
+  int8_t BT[N * K];
+  int32_t C[M * N];
+
+  for (int i = 0; i < M * K; ++i) {
+    A[i] = 200;
+  }
+  for (int k = 0; k < K; ++k) {
+    for (int n = 0; n < N; ++n) {
+      B[k * N + n] = n % 2 ? -100 : 100;
+      BT[n * K + k] = B[k * N + n];
+    }
+  }
+  GemmU8S8<CPUContext>(CblasNoTrans, M, N, K, A, B, C, nullptr);
+  for (int i = 0; i < M * N; ++i) {
+    EXPECT_EQ(C[i], (i % N) % 2 ? -200 * 100 * K : 200 * 100 * K);
+  }
+  GemmU8S8<CPUContext>(CblasTrans, M, N, K, A, BT, C, nullptr);
+  for (int i = 0; i < M * N; ++i) {
+    EXPECT_EQ(C[i], (i % N) % 2 ? -200 * 100 * K : 200 * 100 * K);
+  }
+}
+
+TEST(TestGemmBlockSparse, GemmBlockSparse) {
+  float A[M * K];
+  float C[M * N];
+  for (int i = 0; i < M * K; ++i) {
+    A[i] = i % K;
+  }
+  // 2x3 blocks of a K x N weight, the block column 0 holds the block row 1,
+  // the block column 1 the block rows 0 and 3
+  int32_t col_ptr[] = { 0, 1, 3 };
+  int32_t row_idx[] = { 1, 0, 3 };
+  float values[3 * 2 * 3];
+  for (int i = 0; i < 3 * 2 * 3; ++i) {
+    values[i] = 1;
+  }
+  for (int i = 0; i < M * N; ++i) {
+    C[i] = 1;
+  }
+  GemmBlockSparse<CPUContext>(M, N, K, 2, 3, 1.0, A, col_ptr, row_idx, values, 1.0, C, nullptr);
+  for (int m = 0; m < M; ++m) {
+    for (int n = 0; n < N; ++n) {
+      // the rows 2, 3 for the columns 0-2, the rows 0, 1, 6, 7 for 3-5
+      EXPECT_FLOAT_EQ(n < 3 ? 1 + 2 + 3 : 1 + 0 + 1 + 6 + 7, C[m * N + n]);
+    }
+  }
+}
+
 TEST(TestGemmEx, GemmEx) {
   // TODO
 }
@@ -0,0 +1,61 @@
+/*
+ * \file multi_copy_test.cc
+ * \brief The multi copy test unit
+ */
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "blaze/common/context.h"
+#include "blaze/math/multi_copy.h"
+
+namespace blaze {
+
+TEST(TestMultiCopy, SliceConcat) {
+  // x is 2x6, y concats the columns [4, 6) and [0, 2) of x
+  std::vector<float> x = { 0, 1, 2, 3, 4, 5,
+                           6, 7, 8, 9, 10, 11 };
+  std::vector<float> y(8, -1);
+  CopyItem items[2] = {
+    CopyItem(x.data() + 4, 6 * sizeof(float), y.data(), 4 * sizeof(float), 2 * sizeof(float), 2),
+    CopyItem(x.data(), 6 * sizeof(float), y.data() + 2, 4 * sizeof(float), 2 * sizeof(float), 2),
+  };
+  MultiCopy<CPUContext>(items, 2, nullptr);
+  std::vector<float> expected = { 4, 5, 0, 1, 10, 11, 6, 7 };
+  EXPECT_EQ(expected, y);
+}
+
+TEST(TestMultiCopy, Gather) {
+  // x is 2x3x2, y gathers the axis 1 by the indices { 2, 0 }
+  std::vector<float> x = { 0, 1, 2, 3, 4, 5,
+                           6, 7, 8, 9, 10, 11 };
+  std::vector<int64_t> indices = { 2, 0 };
+  std::vector<float> y(8, -1);
+  CopyItem item;
+  item.src = reinterpret_cast<const char*>(x.data());
+  item.src_pitch = 2 * sizeof(float);
+  item.src_outer_pitch = 6 * sizeof(float);
+  item.dst = reinterpret_cast<char*>(y.data());
+  item.dst_pitch = 2 * sizeof(float);
+  item.row_bytes = 2 * sizeof(float);
+  item.rows = 4;
+  item.index = indices.data();
+  item.index_bytes = sizeof(int64_t);
+  item.index_num = indices.size();
+  MultiCopy<CPUContext>(&item, 1, nullptr);
+  std::vector<float> expected = { 4, 5, 0, 1, 10, 11, 6, 7 };
+  EXPECT_EQ(expected, y);
+
+  std::vector<int32_t> indices32 = { 1 };
+  item.index = indices32.data();
+  item.index_bytes = sizeof(int32_t);
+  item.index_num = 1;
+  item.rows = 2;
+  MultiCopy<CPUContext>(&item, 1, nullptr);
+  EXPECT_FLOAT_EQ(2, y[0]);
+  EXPECT_FLOAT_EQ(3, y[1]);
+  EXPECT_FLOAT_EQ(8, y[2]);
+  EXPECT_FLOAT_EQ(9, y[3]);
+}
+
+}  // namespace blaze
@@ -0,0 +1,91 @@
+/*
+ * \file broadcast_sink_pass_test.cc
+ * \brief The broadcast sink pass test
+ */
+#include "gtest/gtest.h"
+
+#include "blaze/common/proto_helper.h"
+#include "blaze/optimizer/passes/broadcast_sink_pass.h"
+
+namespace blaze {
+
+namespace {
+
+// user is of level 1, item of level 0, and indicator.0 maps the items to
+// their user
+NetDef UserItemNet() {
+  NetDef net_def;
+  net_def.set_run_mode("simple");
+  net_def.add_external_input()->set_name("user");
+  net_def.add_external_input()->set_name("item");
+  ValueInfo* indicator = net_def.add_external_input();
+  indicator->set_name("indicator.0");
+  indicator->set_input_type(kInputIndicator);
+  net_def.add_external_output()->set_name("y");
+  return net_def;
+}
+
+OperatorDef* AddOp(NetDef* net_def, const std::string& type,
+                   const std::vector<std::string>& inputs, const std::string& output) {
+  OperatorDef* op = net_def->add_op();
+  op->set_type(type);
+  op->set_name(output + "_op");
+  for (const auto& input : inputs) op->add_input(input);
+  op->add_output(output);
+  return op;
+}
+
+}  // namespace
+
+TEST(TestBroadcastSinkPass, Sink) {
+  NetDef net_def = UserItemNet();
+  AddOp(&net_def, "ConstantFill", { }, "w");
+  AddOp(&net_def, "ConstantFill", { }, "b");
+  AddOp(&net_def, "Gather", { "user", "indicator.0" }, "user_rows");
+  AddOp(&net_def, "Gemm", { "user_rows", "w", "b" }, "fc");
+  AddOp(&net_def, "Tanh", { "fc" }, "t");
+  OperatorDef* concat = AddOp(&net_def, "Concat", { "t", "item" }, "c");
+  ArgumentHelper::SetSingleArgument<int>(*concat, "axis", 1);
+  AddOp(&net_def, "Sigmoid", { "c" }, "y");
+
+  BroadcastSinkPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  // the gathers of user_rows and fc are dead
+  ASSERT_EQ(7, ret.op_size());
+  EXPECT_EQ("Gemm", ret.op(2).type());
+  EXPECT_EQ("user", ret.op(2).input(0));
+  EXPECT_EQ("Tanh", ret.op(3).type());
+  EXPECT_EQ("fc_user", ret.op(3).input(0));
+  const OperatorDef& gather = ret.op(4);
+  EXPECT_EQ("Gather", gather.type());
+  EXPECT_EQ(ret.op(3).output(0), gather.input(0));
+  EXPECT_EQ("indicator.0", gather.input(1));
+  EXPECT_EQ("t", gather.output(0));
+  // the concat with the item rows stays at the item level
+  EXPECT_EQ("Concat", ret.op(5).type());
+  EXPECT_EQ("t", ret.op(5).input(0));
+}
+
+TEST(TestBroadcastSinkPass, ItemInput) {
+  NetDef net_def = UserItemNet();
+  AddOp(&net_def, "Gather", { "user", "indicator.0" }, "user_rows");
+  AddOp(&net_def, "Mul", { "user_rows", "item" }, "y");
+
+  BroadcastSinkPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  EXPECT_EQ(net_def.DebugString(), ret.DebugString());
+}
+
+TEST(TestBroadcastSinkPass, GemmWeight) {
+  NetDef net_def = UserItemNet();
+  AddOp(&net_def, "Gather", { "user", "indicator.0" }, "user_rows");
+  AddOp(&net_def, "ConstantFill", { }, "x");
+  // the broadcast rows are the weight of the gemm
+  AddOp(&net_def, "Gemm", { "x", "user_rows" }, "y");
+
+  BroadcastSinkPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  EXPECT_EQ(3, ret.op_size());
+}
+
+}  // namespace blaze
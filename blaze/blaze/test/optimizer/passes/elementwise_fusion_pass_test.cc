@@ -0,0 +1,97 @@
+/*
+ * \file elementwise_fusion_pass_test.cc
+ * \brief The elementwise fusion pass test
+ */
+#include "gtest/gtest.h"
+
+#include "blaze/common/proto_helper.h"
+#include "blaze/optimizer/passes/elementwise_fusion_pass.h"
+
+namespace blaze {
+
+namespace {
+
+NetDef ChainNet() {
+  NetDef net_def;
+  net_def.set_run_mode("simple");
+  net_def.add_external_input()->set_name("x");
+  net_def.add_external_input()->set_name("b");
+  net_def.add_external_input()->set_name("c");
+  net_def.add_external_output()->set_name("y");
+  return net_def;
+}
+
+OperatorDef* AddOp(NetDef* net_def, const std::string& type,
+                   const std::vector<std::string>& inputs, const std::string& output) {
+  OperatorDef* op = net_def->add_op();
+  op->set_type(type);
+  op->set_name(output + "_op");
+  for (const auto& input : inputs) op->add_input(input);
+  op->add_output(output);
+  return op;
+}
+
+}  // namespace
+
+TEST(TestElementwiseFusionPass, Chain) {
+  NetDef net_def = ChainNet();
+  AddOp(&net_def, "Add", { "x", "b" }, "a");
+  AddOp(&net_def, "Sigmoid", { "a" }, "s");
+  AddOp(&net_def, "Sub", { "c", "s" }, "d");
+  OperatorDef* leaky_relu = AddOp(&net_def, "LeakyRelu", { "d" }, "y");
+  ArgumentHelper::SetSingleArgument<float>(*leaky_relu, "alpha", 0.2);
+
+  ElementwiseFusionPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  ASSERT_EQ(1, ret.op_size());
+  const OperatorDef& op = ret.op(0);
+  EXPECT_EQ("FusedElementwise", op.type());
+  ASSERT_EQ(3, op.input_size());
+  EXPECT_EQ("x", op.input(0));
+  EXPECT_EQ("b", op.input(1));
+  EXPECT_EQ("c", op.input(2));
+  EXPECT_EQ("y", op.output(0));
+
+  ArgumentHelper argument_helper(op);
+  std::vector<std::string> types = argument_helper.GetRepeatedArgument<std::string>("step_type");
+  ASSERT_EQ(4u, types.size());
+  EXPECT_EQ("Sub", types[2]);
+  std::vector<int> operand = argument_helper.GetRepeatedArgument<int>("step_operand");
+  ASSERT_EQ(12u, operand.size());
+  EXPECT_EQ(1, operand[0]);
+  EXPECT_EQ(-1, operand[3]);
+  EXPECT_EQ(2, operand[6]);
+  std::vector<int> swap = argument_helper.GetRepeatedArgument<int>("step_swap");
+  EXPECT_EQ(0, swap[0]);
+  EXPECT_EQ(1, swap[2]);
+  std::vector<float> arg = argument_helper.GetRepeatedArgument<float>("step_arg");
+  EXPECT_FLOAT_EQ(0.2, arg[3]);
+}
+
+TEST(TestElementwiseFusionPass, SharedOutput) {
+  NetDef net_def = ChainNet();
+  AddOp(&net_def, "Add", { "x", "b" }, "a");
+  AddOp(&net_def, "Tanh", { "a" }, "t");
+  AddOp(&net_def, "Mul", { "a", "t" }, "y");
+
+  // a is used by two ops, only Tanh and Mul are fused
+  ElementwiseFusionPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  ASSERT_EQ(2, ret.op_size());
+  EXPECT_EQ("Add", ret.op(0).type());
+  EXPECT_EQ("FusedElementwise", ret.op(1).type());
+  ASSERT_EQ(1, ret.op(1).input_size());
+  EXPECT_EQ("a", ret.op(1).input(0));
+}
+
+TEST(TestElementwiseFusionPass, ExternalOutput) {
+  NetDef net_def = ChainNet();
+  AddOp(&net_def, "Add", { "x", "b" }, "y");
+  AddOp(&net_def, "Tanh", { "y" }, "t");
+
+  ElementwiseFusionPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  EXPECT_EQ(2, ret.op_size());
+}
+
+}  // namespace blaze
@@ -0,0 +1,142 @@
+/*
+ * \file embedding_concat_fusion_pass_test.cc
+ * \brief The embedding concat fusion pass test
+ */
+#include "gtest/gtest.h"
+
+#include "blaze/common/proto_configure.h"
+#include "blaze/common/proto_helper.h"
+#include "blaze/operator/common_helper.h"
+#include "blaze/optimizer/passes/embedding_concat_fusion_pass.h"
+
+namespace blaze {
+
+namespace {
+
+NetDef EmbeddingNet() {
+  NetDef net_def;
+  net_def.set_run_mode("simple");
+  for (const std::string& fg : { "fg1", "fg2" }) {
+    net_def.add_external_input()->set_name(fg + kIdSuffix);
+    net_def.add_external_input()->set_name(fg + kValueSuffix);
+    net_def.add_external_input()->set_name(fg + kIdNumSuffix);
+  }
+  net_def.add_external_input()->set_name("dense");
+  net_def.add_external_output()->set_name("y");
+  return net_def;
+}
+
+void AddEmbedding(NetDef* net_def, const std::string& fg, UDFType udf_type,
+                  const std::string& output) {
+  EmbeddingConfig embedding_config;
+  auto fg_config = embedding_config.add_feature_group_config();
+  fg_config->set_feature_group(fg);
+  fg_config->set_table_name(fg + "_table");
+  fg_config->set_dim(4);
+  auto item = embedding_config.add_block_config()->add_embedding_block_config_item();
+  item->set_feature_group(fg);
+  item->set_udf_type(udf_type);
+  if (udf_type == UDFType::kAssign) {
+    item->set_trunc_direction(TruncDirection::kInorder);
+    item->set_trunc_num(2);
+  }
+
+  OperatorDef* op = net_def->add_op();
+  op->set_type("Embedding");
+  op->set_name(output + "_op");
+  op->add_input(fg + kIdSuffix);
+  op->add_input(fg + kValueSuffix);
+  op->add_input(fg + kIdNumSuffix);
+  op->add_output(output);
+  ArgumentHelper::SetSingleArgument<std::string>(*op, "embedding_config",
+                                                 embedding_config.DebugString());
+}
+
+void AddConcat(NetDef* net_def, const std::vector<std::string>& inputs) {
+  OperatorDef* op = net_def->add_op();
+  op->set_type("Concat");
+  op->set_name("concat");
+  for (const auto& input : inputs) op->add_input(input);
+  op->add_output("concat_out");
+  ArgumentHelper::SetSingleArgument<int>(*op, "axis", 1);
+
+  OperatorDef* tanh = net_def->add_op();
+  tanh->set_type("Tanh");
+  tanh->set_name("tanh");
+  tanh->add_input("concat_out");
+  tanh->add_output("y");
+}
+
+EmbeddingConfig GetEmbeddingConfig(const OperatorDef& op) {
+  ArgumentHelper argument_helper(op);
+  ProtoConfigure proto_conf;
+  EXPECT_EQ(ProtoConfigure::kOK, proto_conf.InitByTextConf(
+      "blaze.EmbeddingConfig", argument_helper.GetSingleArgument<std::string>("embedding_config", "")));
+  return *dynamic_cast<const EmbeddingConfig*>(proto_conf.config());
+}
+
+}  // namespace
+
+TEST(TestEmbeddingConcatFusionPass, Whole) {
+  NetDef net_def = EmbeddingNet();
+  AddEmbedding(&net_def, "fg1", UDFType::kSum, "e1");
+  AddEmbedding(&net_def, "fg2", UDFType::kAvg, "e2");
+  AddEmbedding(&net_def, "fg1", UDFType::kAssign, "e3");
+  AddConcat(&net_def, { "e1", "e2", "e3" });
+
+  EmbeddingConcatFusionPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  ASSERT_EQ(2, ret.op_size());
+  const OperatorDef& op = ret.op(0);
+  EXPECT_EQ("Embedding", op.type());
+  // the inputs of fg1 once
+  ASSERT_EQ(6, op.input_size());
+  EXPECT_EQ(std::string("fg1") + kIdSuffix, op.input(0));
+  EXPECT_EQ(std::string("fg2") + kIdSuffix, op.input(3));
+  ASSERT_EQ(1, op.output_size());
+  EXPECT_EQ("concat_out", op.output(0));
+  EXPECT_EQ("Tanh", ret.op(1).type());
+
+  EmbeddingConfig embedding_config = GetEmbeddingConfig(op);
+  EXPECT_EQ(2, embedding_config.feature_group_config_size());
+  ASSERT_EQ(1, embedding_config.block_config_size());
+  const auto& block_config = embedding_config.block_config(0);
+  ASSERT_EQ(3, block_config.embedding_block_config_item_size());
+  EXPECT_EQ("fg1", block_config.embedding_block_config_item(0).feature_group());
+  EXPECT_EQ(UDFType::kAvg, block_config.embedding_block_config_item(1).udf_type());
+  EXPECT_EQ(UDFType::kAssign, block_config.embedding_block_config_item(2).udf_type());
+  EXPECT_EQ(2, block_config.embedding_block_config_item(2).trunc_num());
+}
+
+TEST(TestEmbeddingConcatFusionPass, Partial) {
+  NetDef net_def = EmbeddingNet();
+  AddEmbedding(&net_def, "fg1", UDFType::kSum, "e1");
+  AddEmbedding(&net_def, "fg2", UDFType::kSum, "e2");
+  AddConcat(&net_def, { "dense", "e1", "e2" });
+
+  EmbeddingConcatFusionPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  ASSERT_EQ(3, ret.op_size());
+  EXPECT_EQ("Embedding", ret.op(0).type());
+  EXPECT_EQ("e1", ret.op(0).output(0));
+  const OperatorDef& concat = ret.op(1);
+  EXPECT_EQ("Concat", concat.type());
+  ASSERT_EQ(2, concat.input_size());
+  EXPECT_EQ("dense", concat.input(0));
+  EXPECT_EQ("e1", concat.input(1));
+}
+
+TEST(TestEmbeddingConcatFusionPass, ExternalOutput) {
+  NetDef net_def = EmbeddingNet();
+  AddEmbedding(&net_def, "fg1", UDFType::kSum, "e1");
+  AddEmbedding(&net_def, "fg2", UDFType::kSum, "e2");
+  AddConcat(&net_def, { "e1", "e2" });
+  // e2 is also an output
+  net_def.add_external_output()->set_name("e2");
+
+  EmbeddingConcatFusionPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  EXPECT_EQ(4, ret.op_size());
+}
+
+}  // namespace blaze
@@ -0,0 +1,89 @@
+/*
+ * \file gemm_epilogue_pass_test.cc
+ * \brief The gemm epilogue pass test
+ */
+#include "gtest/gtest.h"
+
+#include "blaze/common/proto_helper.h"
+#include "blaze/optimizer/passes/gemm_epilogue_pass.h"
+
+namespace blaze {
+
+namespace {
+
+OperatorDef* AddOp(NetDef* net_def, const std::string& type,
+                   const std::vector<std::string>& inputs, const std::string& output) {
+  OperatorDef* op = net_def->add_op();
+  op->set_type(type);
+  op->set_name(output + "_op");
+  for (const auto& input : inputs) op->add_input(input);
+  op->add_output(output);
+  return op;
+}
+
+}  // namespace
+
+TEST(TestGemmEpiloguePass, Dice) {
+  NetDef net_def;
+  net_def.add_external_output()->set_name("y");
+  OperatorDef* gemm = AddOp(&net_def, "Gemm", { "a", "w", "bias" }, "g");
+  ArgumentHelper::SetSingleArgument<bool>(*gemm, "transB", true);
+  AddOp(&net_def, "Dice", { "g", "gamma", "mean", "var" }, "y");
+
+  GemmEpiloguePass pass;
+  NetDef ret = pass.RunPass(net_def);
+  ASSERT_EQ(1, ret.op_size());
+  const OperatorDef& op = ret.op(0);
+  EXPECT_EQ("FusedGemmEpilogue", op.type());
+  ASSERT_EQ(6, op.input_size());
+  EXPECT_EQ("bias", op.input(2));
+  EXPECT_EQ("gamma", op.input(3));
+  EXPECT_EQ("y", op.output(0));
+
+  ArgumentHelper argument_helper(op);
+  EXPECT_TRUE(argument_helper.GetSingleArgument<bool>("transB", false));
+  std::vector<std::string> types = argument_helper.GetRepeatedArgument<std::string>("step_type");
+  ASSERT_EQ(2u, types.size());
+  EXPECT_EQ("Add", types[0]);
+  EXPECT_EQ("Dice", types[1]);
+  std::vector<int> operand = argument_helper.GetRepeatedArgument<int>("step_operand");
+  std::vector<int> expected = { 2, -1, -1, 3, 4, 5 };
+  EXPECT_EQ(expected, operand);
+}
+
+TEST(TestGemmEpiloguePass, FusedElementwise) {
+  NetDef net_def;
+  net_def.add_external_output()->set_name("y");
+  AddOp(&net_def, "Gemm", { "a", "w" }, "g");
+  OperatorDef* op = AddOp(&net_def, "FusedElementwise", { "g", "c" }, "y");
+  ArgumentHelper::SetRepeatedArgument<std::string>(*op, "step_type",
+                                                   std::vector<std::string>{ "Mul", "Sigmoid" });
+  ArgumentHelper::SetRepeatedArgument<int>(*op, "step_operand",
+                                           std::vector<int>{ 1, -1, -1, -1, -1, -1 });
+  ArgumentHelper::SetRepeatedArgument<int>(*op, "step_swap", std::vector<int>{ 0, 0 });
+  ArgumentHelper::SetRepeatedArgument<float>(*op, "step_arg", std::vector<float>{ 0, 0 });
+
+  GemmEpiloguePass pass;
+  NetDef ret = pass.RunPass(net_def);
+  ASSERT_EQ(1, ret.op_size());
+  ASSERT_EQ(3, ret.op(0).input_size());
+  EXPECT_EQ("c", ret.op(0).input(2));
+  ArgumentHelper argument_helper(ret.op(0));
+  std::vector<int> operand = argument_helper.GetRepeatedArgument<int>("step_operand");
+  EXPECT_EQ(2, operand[0]);
+}
+
+TEST(TestGemmEpiloguePass, SharedOutput) {
+  NetDef net_def;
+  net_def.add_external_output()->set_name("y");
+  net_def.add_external_output()->set_name("z");
+  AddOp(&net_def, "Gemm", { "a", "w" }, "g");
+  AddOp(&net_def, "Sigmoid", { "g" }, "y");
+  AddOp(&net_def, "Tanh", { "g" }, "z");
+
+  GemmEpiloguePass pass;
+  NetDef ret = pass.RunPass(net_def);
+  EXPECT_EQ(3, ret.op_size());
+}
+
+}  // namespace blaze
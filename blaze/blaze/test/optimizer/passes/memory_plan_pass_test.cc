@@ -0,0 +1,102 @@
+/*
+ * \file memory_plan_pass_test.cc
+ * \brief The memory plan pass test
+ */
+#include "gtest/gtest.h"
+
+#include "blaze/common/proto_helper.h"
+#include "blaze/optimizer/passes/memory_plan_pass.h"
+
+namespace blaze {
+
+namespace {
+
+NetDef ChainNet() {
+  NetDef net_def;
+  net_def.set_run_mode("simple");
+  net_def.mutable_device_option()->set_device_type(kCPU);
+  ValueInfo* input = net_def.add_external_input();
+  input->set_name("x");
+  input->set_dtype(kFloat);
+  net_def.add_external_output()->set_name("y");
+  return net_def;
+}
+
+void AddOp(NetDef* net_def, const std::string& type,
+           const std::vector<std::string>& inputs, const std::string& output) {
+  OperatorDef* op = net_def->add_op();
+  op->set_type(type);
+  op->set_name(output + "_op");
+  for (const auto& input : inputs) op->add_input(input);
+  op->add_output(output);
+}
+
+}  // namespace
+
+TEST(TestMemoryPlanPass, Reuse) {
+  NetDef net_def = ChainNet();
+  AddOp(&net_def, "Tanh", { "x" }, "a");
+  AddOp(&net_def, "Tanh", { "a" }, "b");
+  AddOp(&net_def, "Tanh", { "b" }, "c");
+  AddOp(&net_def, "Tanh", { "c" }, "y");
+
+  MemoryPlanPass pass;
+  NetDef ret = pass.RunPass(net_def, nullptr);
+  ASSERT_EQ(4, ret.op_size());
+  EXPECT_EQ("x", ret.op(0).input(0));
+  EXPECT_EQ("y", ret.op(3).output(0));
+  // b is live with a, c takes the slot of a
+  EXPECT_NE(ret.op(0).output(0), ret.op(1).output(0));
+  EXPECT_EQ(ret.op(0).output(0), ret.op(2).output(0));
+  EXPECT_EQ(ret.op(1).output(0), ret.op(2).input(0));
+  EXPECT_EQ(ret.op(2).output(0), ret.op(3).input(0));
+}
+
+TEST(TestMemoryPlanPass, Inplace) {
+  NetDef net_def = ChainNet();
+  AddOp(&net_def, "Tanh", { "x" }, "a");
+  AddOp(&net_def, "Sigmoid", { "a" }, "b");
+  AddOp(&net_def, "Tanh", { "b" }, "y");
+
+  MemoryPlanPass pass;
+  NetDef ret = pass.RunPass(net_def, nullptr);
+  EXPECT_EQ(ret.op(1).input(0), ret.op(1).output(0));
+}
+
+TEST(TestMemoryPlanPass, Alias) {
+  NetDef net_def = ChainNet();
+  OperatorDef* shape = net_def.add_op();
+  shape->set_type("ConstantFill");
+  shape->set_name("shape_fill");
+  shape->add_output("shape");
+  ArgumentHelper::SetSingleArgument<int>(*shape, "dtype", kInt64);
+  ArgumentHelper::SetRepeatedArgument<TIndex>(*shape, "shape", std::vector<TIndex>{ 2 });
+  ArgumentHelper::SetRepeatedArgument<int64_t>(*shape, "value", std::vector<int64_t>{ -1, 2 });
+
+  AddOp(&net_def, "Tanh", { "x" }, "a");
+  AddOp(&net_def, "Reshape", { "a", "shape" }, "r");
+  AddOp(&net_def, "Tanh", { "r" }, "b");
+  AddOp(&net_def, "Tanh", { "b" }, "c");
+  AddOp(&net_def, "Tanh", { "c" }, "y");
+
+  MemoryPlanPass pass;
+  NetDef ret = pass.RunPass(net_def, nullptr);
+  // the reshape output keeps its blob, which points into a
+  EXPECT_EQ("shape", ret.op(2).input(1));
+  EXPECT_EQ("r", ret.op(2).output(0));
+  EXPECT_NE(ret.op(1).output(0), ret.op(3).output(0));
+  EXPECT_EQ(ret.op(1).output(0), ret.op(4).output(0));
+}
+
+TEST(TestMemoryPlanPass, DagNet) {
+  NetDef net_def = ChainNet();
+  net_def.set_run_mode("dag");
+  AddOp(&net_def, "Tanh", { "x" }, "a");
+  AddOp(&net_def, "Tanh", { "a" }, "y");
+
+  MemoryPlanPass pass;
+  NetDef ret = pass.RunPass(net_def, nullptr);
+  EXPECT_EQ("a", ret.op(0).output(0));
+}
+
+}  // namespace blaze
@@ -0,0 +1,109 @@
+/*
+ * \file mixed_precision_pass_test.cc
+ * \brief The mixed precision pass test
+ */
+#include "gtest/gtest.h"
+
+#include "blaze/common/proto_helper.h"
+#include "blaze/optimizer/passes/mixed_precision_pass.h"
+
+namespace blaze {
+
+namespace {
+
+OperatorDef* AddOp(NetDef* net_def, const std::string& type,
+                   const std::vector<std::string>& inputs, const std::string& output) {
+  OperatorDef* op = net_def->add_op();
+  op->set_type(type);
+  op->set_name(output + "_op");
+  for (const auto& input : inputs) op->add_input(input);
+  op->add_output(output);
+  return op;
+}
+
+void AddWeight(NetDef* net_def, const std::string& name) {
+  OperatorDef* weight = AddOp(net_def, "ConstantFill", { }, name);
+  ArgumentHelper::SetSingleArgument<int>(*weight, "dtype", kFloat);
+  ArgumentHelper::SetRepeatedArgument<TIndex>(*weight, "shape", std::vector<TIndex>{ 2 });
+  ArgumentHelper::SetRepeatedArgument<float>(*weight, "value", std::vector<float>{ 1, -1 });
+}
+
+// y = Sigmoid(Gemm(x, w, b)), z = Add(h, c)
+NetDef MlpNet() {
+  NetDef net_def;
+  net_def.mutable_device_option()->set_device_type(kCUDA);
+  Argument* arg = net_def.add_arg();
+  arg->set_name("mixed_precision");
+  arg->set_i(1);
+  ValueInfo* x = net_def.add_external_input();
+  x->set_name("x");
+  x->set_dtype(kFloat);
+  net_def.add_external_output()->set_name("y");
+  net_def.add_external_output()->set_name("z");
+
+  AddWeight(&net_def, "w");
+  AddWeight(&net_def, "b");
+  AddWeight(&net_def, "c");
+  AddOp(&net_def, "Gemm", { "x", "w", "b" }, "h");
+  AddOp(&net_def, "Sigmoid", { "h" }, "y");
+  AddOp(&net_def, "Add", { "h", "c" }, "z");
+  return net_def;
+}
+
+}  // namespace
+
+TEST(TestMixedPrecisionPass, Convert) {
+  NetDef net_def = MlpNet();
+  MixedPrecisionPass pass;
+  NetDef ret = pass.RunPass(net_def);
+
+  std::vector<std::string> types = { "ConstantFill", "ConstantFill", "ConstantFill", "Cast",
+                                     "Gemm", "Cast", "Sigmoid", "Add", "Cast" };
+  ASSERT_EQ(types.size(), ret.op_size());
+  for (size_t i = 0; i < types.size(); ++i) EXPECT_EQ(types[i], ret.op(i).type());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(kFloat16, ArgumentHelper(ret.op(i)).GetSingleArgument<int>("dtype", kFloat));
+  }
+
+  EXPECT_EQ("x", ret.op(3).input(0));
+  EXPECT_EQ("x_fp16", ret.op(3).output(0));
+  EXPECT_EQ(kFloat16, ArgumentHelper(ret.op(3)).GetSingleArgument<int>("to", kFloat));
+  EXPECT_EQ("x_fp16", ret.op(4).input(0));
+  EXPECT_EQ("h_fp16", ret.op(4).output(0));
+  // the sigmoid stays in float
+  EXPECT_EQ("h_fp16", ret.op(5).input(0));
+  EXPECT_EQ("h", ret.op(5).output(0));
+  EXPECT_EQ(kFloat, ArgumentHelper(ret.op(5)).GetSingleArgument<int>("to", kFloat16));
+  EXPECT_EQ("h", ret.op(6).input(0));
+  // the add runs in float16, its external output is cast back
+  EXPECT_EQ("h_fp16", ret.op(7).input(0));
+  EXPECT_EQ("z_fp16", ret.op(7).output(0));
+  EXPECT_EQ("z_fp16", ret.op(8).input(0));
+  EXPECT_EQ("z", ret.op(8).output(0));
+}
+
+TEST(TestMixedPrecisionPass, Overflow) {
+  NetDef net_def = MlpNet();
+  ArgumentHelper::SetRepeatedArgument<float>(*net_def.mutable_op(3), "x_range",
+                                             std::vector<float>{ -1, 1e5 });
+  MixedPrecisionPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  for (const auto& op : ret.op()) {
+    if (op.type() == "Gemm") EXPECT_EQ("h", op.output(0));
+  }
+  // the weights of the float gemm stay float
+  EXPECT_EQ(kFloat, ArgumentHelper(ret.op(0)).GetSingleArgument<int>("dtype", kFloat16));
+}
+
+TEST(TestMixedPrecisionPass, Disabled) {
+  NetDef net_def = MlpNet();
+  net_def.clear_arg();
+  MixedPrecisionPass pass;
+  EXPECT_EQ(net_def.op_size(), pass.RunPass(net_def).op_size());
+
+  net_def = MlpNet();
+  net_def.mutable_device_option()->set_device_type(kCPU);
+  EXPECT_EQ(net_def.op_size(), pass.RunPass(net_def).op_size());
+}
+
+}  // namespace blaze
@@ -0,0 +1,102 @@
+/*
+ * \file quantization_pass_test.cc
+ * \brief The quantization pass test
+ */
+#include "gtest/gtest.h"
+
+#include "blaze/common/proto_helper.h"
+#include "blaze/graph/observer/calibration_observer.h"
+#include "blaze/optimizer/passes/quantization_pass.h"
+
+namespace blaze {
+
+namespace {
+
+NetDef GemmNet() {
+  NetDef net_def;
+  net_def.mutable_device_option()->set_device_type(kCPU);
+  net_def.add_external_output()->set_name("y");
+
+  OperatorDef* weight = net_def.add_op();
+  weight->set_type("ConstantFill");
+  weight->set_name("w_fill");
+  weight->add_output("w");
+  ArgumentHelper::SetSingleArgument<int>(*weight, "dtype", kFloat);
+  ArgumentHelper::SetRepeatedArgument<TIndex>(*weight, "shape", std::vector<TIndex>{ 2, 3 });
+  ArgumentHelper::SetRepeatedArgument<float>(*weight, "value",
+                                             std::vector<float>{ 1.2, -0.4, 0, -2.54, 1, 0 });
+
+  OperatorDef* gemm = net_def.add_op();
+  gemm->set_type("Gemm");
+  gemm->set_name("gemm");
+  gemm->add_input("x");
+  gemm->add_input("w");
+  gemm->add_output("y");
+  return net_def;
+}
+
+}  // namespace
+
+TEST(TestQuantizationPass, RangeQuantParam) {
+  float scale;
+  int zero_point;
+  QuantizationPass::RangeQuantParam(0, 2.55, &scale, &zero_point);
+  EXPECT_FLOAT_EQ(0.01, scale);
+  EXPECT_EQ(0, zero_point);
+  QuantizationPass::RangeQuantParam(-1.28, 1.27, &scale, &zero_point);
+  EXPECT_FLOAT_EQ(0.01, scale);
+  EXPECT_EQ(128, zero_point);
+}
+
+TEST(TestQuantizationPass, Uncalibrated) {
+  NetDef net_def = GemmNet();
+  QuantizationPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  ASSERT_EQ(2, ret.op_size());
+  EXPECT_EQ("Gemm", ret.op(1).type());
+}
+
+TEST(TestQuantizationPass, Quantize) {
+  NetDef net_def = GemmNet();
+  CalibrationObserver::ApplyCalibration("gemm 0 2.55\nother -1 1\n", &net_def);
+
+  QuantizationPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  // the float weight is dropped
+  ASSERT_EQ(3, ret.op_size());
+  const OperatorDef& weight_q = ret.op(0);
+  EXPECT_EQ("w_int8", weight_q.output(0));
+  ArgumentHelper weight_helper(weight_q);
+  EXPECT_EQ(kInt8, weight_helper.GetSingleArgument<int>("dtype", kFloat));
+  std::vector<int8_t> value = weight_helper.GetRepeatedArgument<int8_t>("value");
+  std::vector<int8_t> expected = { 60, -51, 0, -127, 127, 0 };
+  EXPECT_EQ(expected, value);
+
+  ArgumentHelper scale_helper(ret.op(1));
+  std::vector<float> scale = scale_helper.GetRepeatedArgument<float>("value");
+  ASSERT_EQ(3u, scale.size());
+  EXPECT_FLOAT_EQ(0.02, scale[0]);
+  EXPECT_FLOAT_EQ(1.0 / 127, scale[1]);
+  EXPECT_FLOAT_EQ(1, scale[2]);
+
+  const OperatorDef& qop = ret.op(2);
+  EXPECT_EQ("QuantizedGemm", qop.type());
+  ASSERT_EQ(3, qop.input_size());
+  EXPECT_EQ("w_int8", qop.input(1));
+  EXPECT_EQ("w_scale", qop.input(2));
+  ArgumentHelper qop_helper(qop);
+  EXPECT_FLOAT_EQ(0.01, qop_helper.GetSingleArgument<float>("x_scale", 0));
+  EXPECT_EQ(0, qop_helper.GetSingleArgument<int>("x_zero_point", -1));
+  EXPECT_FALSE(qop_helper.HasArgument("x_range"));
+}
+
+TEST(TestQuantizationPass, CUDANet) {
+  NetDef net_def = GemmNet();
+  net_def.mutable_device_option()->set_device_type(kCUDA);
+  CalibrationObserver::ApplyCalibration("gemm 0 2.55\n", &net_def);
+  QuantizationPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  EXPECT_EQ("Gemm", ret.op(1).type());
+}
+
+}  // namespace blaze
@@ -0,0 +1,116 @@
+/*
+ * \file sparse_gemm_pass_test.cc
+ * \brief The sparse gemm pass test
+ */
+#include "gtest/gtest.h"
+
+#include "blaze/common/proto_helper.h"
+#include "blaze/optimizer/passes/sparse_gemm_pass.h"
+
+namespace blaze {
+
+namespace {
+
+// y = x * w, w is 4 x 2
+NetDef GemmNet() {
+  NetDef net_def;
+  net_def.mutable_device_option()->set_device_type(kCPU);
+  net_def.add_external_output()->set_name("y");
+
+  OperatorDef* weight = net_def.add_op();
+  weight->set_type("ConstantFill");
+  weight->set_name("w_fill");
+  weight->add_output("w");
+  ArgumentHelper::SetSingleArgument<int>(*weight, "dtype", kFloat);
+  ArgumentHelper::SetRepeatedArgument<TIndex>(*weight, "shape", std::vector<TIndex>{ 4, 2 });
+  ArgumentHelper::SetRepeatedArgument<float>(*weight, "value",
+                                             std::vector<float>{ 1, -5, 2, 6, -3, 0.5, 4, 0.1 });
+
+  OperatorDef* gemm = net_def.add_op();
+  gemm->set_type("Gemm");
+  gemm->set_name("gemm");
+  gemm->add_input("x");
+  gemm->add_input("w");
+  gemm->add_output("y");
+  return net_def;
+}
+
+std::vector<float> WeightValue(const NetDef& net_def) {
+  return ArgumentHelper::GetRepeatedArgument<OperatorDef, float>(net_def.op(0), "value");
+}
+
+}  // namespace
+
+TEST(TestSparseGemmPass, PruneBlock) {
+  NetDef net_def = GemmNet();
+  EXPECT_EQ(0, SparseGemmPass::PruneNet(&net_def, "4x1", 0.5, 100));
+  EXPECT_EQ(1, SparseGemmPass::PruneNet(&net_def, "2x1", 0.5, 1));
+  // the blocks of the rows 0-1 of column 0 and of the rows 2-3 of column 1
+  std::vector<float> expected = { 0, -5, 0, 6, -3, 0, 4, 0 };
+  EXPECT_EQ(expected, WeightValue(net_def));
+  std::vector<int> block =
+      ArgumentHelper::GetRepeatedArgument<OperatorDef, int>(net_def.op(1), "sparse_block");
+  EXPECT_EQ(std::vector<int>({ 2, 1 }), block);
+}
+
+TEST(TestSparseGemmPass, PruneNM) {
+  NetDef net_def = GemmNet();
+  EXPECT_EQ(0, SparseGemmPass::PruneNet(&net_def, "2:3", 0, 1));
+  EXPECT_EQ(1, SparseGemmPass::PruneNet(&net_def, "2:4", 0, 1));
+  std::vector<float> expected = { 0, -5, 0, 6, -3, 0, 4, 0 };
+  EXPECT_EQ(expected, WeightValue(net_def));
+}
+
+TEST(TestSparseGemmPass, Unpruned) {
+  NetDef net_def = GemmNet();
+  SparseGemmPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  ASSERT_EQ(2, ret.op_size());
+  EXPECT_EQ("Gemm", ret.op(1).type());
+}
+
+TEST(TestSparseGemmPass, Compress) {
+  NetDef net_def = GemmNet();
+  SparseGemmPass::PruneNet(&net_def, "2x1", 0.5, 1);
+  SparseGemmPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  // the dense weight is dropped
+  ASSERT_EQ(4, ret.op_size());
+  std::vector<float> values =
+      ArgumentHelper::GetRepeatedArgument<OperatorDef, float>(ret.op(0), "value");
+  EXPECT_EQ(std::vector<float>({ -3, 4, -5, 6 }), values);
+  std::vector<int> col_ptr =
+      ArgumentHelper::GetRepeatedArgument<OperatorDef, int>(ret.op(1), "value");
+  EXPECT_EQ(std::vector<int>({ 0, 1, 2 }), col_ptr);
+  ArgumentHelper col_ptr_helper(ret.op(1));
+  EXPECT_EQ(kInt32, col_ptr_helper.GetSingleArgument<int>("dtype", kFloat));
+  std::vector<int> row_idx =
+      ArgumentHelper::GetRepeatedArgument<OperatorDef, int>(ret.op(2), "value");
+  EXPECT_EQ(std::vector<int>({ 1, 0 }), row_idx);
+
+  const OperatorDef& sop = ret.op(3);
+  EXPECT_EQ("SparseGemm", sop.type());
+  ASSERT_EQ(4, sop.input_size());
+  EXPECT_EQ("w_values", sop.input(1));
+  EXPECT_EQ("w_col_ptr", sop.input(2));
+  EXPECT_EQ("w_row_idx", sop.input(3));
+  ArgumentHelper sop_helper(sop);
+  EXPECT_EQ(2, sop_helper.GetSingleArgument<int>("block_k", 0));
+  EXPECT_EQ(1, sop_helper.GetSingleArgument<int>("block_n", 0));
+  EXPECT_FALSE(sop_helper.HasArgument("sparse_block"));
+}
+
+TEST(TestSparseGemmPass, AccuracyCheck) {
+  NetDef net_def = GemmNet();
+  SparseGemmPass::PruneNet(&net_def, "2x1", 0.5, 1);
+  SparseGemmPass pass;
+  SparseGemmPass::SetAccuracyCheck([](const NetDef& dense, const NetDef& sparse) {
+    return false;
+  });
+  NetDef ret = pass.RunPass(net_def);
+  SparseGemmPass::SetAccuracyCheck(nullptr);
+  ASSERT_EQ(2, ret.op_size());
+  EXPECT_EQ("Gemm", ret.op(1).type());
+}
+
+}  // namespace blaze
@@ -0,0 +1,128 @@
+/*
+ * \file target_attention_fusion_pass_test.cc
+ * \brief The target attention fusion pass test
+ */
+#include "gtest/gtest.h"
+
+#include "blaze/common/proto_helper.h"
+#include "blaze/optimizer/passes/target_attention_fusion_pass.h"
+
+namespace blaze {
+
+namespace {
+
+OperatorDef* AddOp(NetDef* net_def, const std::string& type,
+                   const std::vector<std::string>& inputs, const std::string& output) {
+  OperatorDef* op = net_def->add_op();
+  op->set_type(type);
+  op->set_name(output + "_op");
+  for (const auto& input : inputs) op->add_input(input);
+  op->add_output(output);
+  return op;
+}
+
+// The DIN attention of query q [B, 1, D] and keys k [B, T, D]
+void AddAttention(NetDef* net_def) {
+  AddOp(net_def, "BroadcastTo", { "q", "k" }, "qt");
+  AddOp(net_def, "Sub", { "qt", "k" }, "sub");
+  AddOp(net_def, "Mul", { "qt", "k" }, "mul");
+  OperatorDef* concat = AddOp(net_def, "Concat", { "qt", "k", "sub", "mul" }, "din");
+  ArgumentHelper::SetSingleArgument<int>(*concat, "axis", -1);
+  OperatorDef* fc1 = AddOp(net_def, "FusedGemmEpilogue",
+                           { "din", "w1", "b1", "gamma", "mean", "var" }, "fc1");
+  ArgumentHelper::SetRepeatedArgument<std::string>(*fc1, "step_type",
+                                                   std::vector<std::string>{ "Add", "Dice" });
+  ArgumentHelper::SetRepeatedArgument<int>(*fc1, "step_operand",
+                                           std::vector<int>{ 2, -1, -1, 3, 4, 5 });
+  ArgumentHelper::SetRepeatedArgument<int>(*fc1, "step_swap", std::vector<int>{ 0, 0 });
+  ArgumentHelper::SetRepeatedArgument<float>(*fc1, "step_arg", std::vector<float>{ 0, 0 });
+  OperatorDef* fc2 = AddOp(net_def, "Gemm", { "fc1", "w2", "b2" }, "score");
+  ArgumentHelper::SetSingleArgument<bool>(*fc2, "transB", true);
+  AddOp(net_def, "Reshape", { "score", "shape" }, "score_t");
+  AddOp(net_def, "Where", { "mask", "score_t", "paddings" }, "masked");
+  OperatorDef* softmax = AddOp(net_def, "Softmax", { "masked" }, "weight");
+  ArgumentHelper::SetSingleArgument<size_t>(*softmax, "axis", 2);
+  AddOp(net_def, "MatMul", { "weight", "k" }, "y");
+}
+
+}  // namespace
+
+TEST(TestTargetAttentionFusionPass, Din) {
+  NetDef net_def;
+  net_def.add_external_output()->set_name("y");
+  AddAttention(&net_def);
+
+  TargetAttentionFusionPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  ASSERT_EQ(1, ret.op_size());
+  const OperatorDef& op = ret.op(0);
+  EXPECT_EQ("FusedTargetAttention", op.type());
+  std::vector<std::string> inputs = { "q", "k", "mask", "w1", "b1", "gamma", "mean", "var",
+                                      "w2", "b2" };
+  ASSERT_EQ(inputs.size(), op.input_size());
+  for (size_t k = 0; k < inputs.size(); ++k) EXPECT_EQ(inputs[k], op.input(k));
+  EXPECT_EQ("y", op.output(0));
+
+  ArgumentHelper argument_helper(op);
+  std::vector<std::string> interaction =
+      argument_helper.GetRepeatedArgument<std::string>("interaction");
+  std::vector<std::string> expected_interaction = { "query", "key", "query_sub_key",
+                                                    "query_mul_key" };
+  EXPECT_EQ(expected_interaction, interaction);
+  EXPECT_TRUE(argument_helper.GetSingleArgument<bool>("masked", false));
+  EXPECT_TRUE(argument_helper.GetSingleArgument<bool>("softmax", false));
+  EXPECT_TRUE(argument_helper.GetSingleArgument<bool>("keepdims", false));
+  std::vector<int> layer_inputs = argument_helper.GetRepeatedArgument<int>("layer_inputs");
+  EXPECT_EQ(std::vector<int>({ 5, 2 }), layer_inputs);
+  std::vector<int> layer_steps = argument_helper.GetRepeatedArgument<int>("layer_steps");
+  EXPECT_EQ(std::vector<int>({ 2, 1 }), layer_steps);
+  std::vector<int> layer_transb = argument_helper.GetRepeatedArgument<int>("layer_transb");
+  EXPECT_EQ(std::vector<int>({ 0, 1 }), layer_transb);
+  std::vector<int> operand = argument_helper.GetRepeatedArgument<int>("step_operand");
+  std::vector<int> expected = { 2, -1, -1, 3, 4, 5, 2, -1, -1 };
+  EXPECT_EQ(expected, operand);
+}
+
+TEST(TestTargetAttentionFusionPass, ReduceSum) {
+  NetDef net_def;
+  net_def.add_external_output()->set_name("y");
+  AddOp(&net_def, "Sub", { "k", "q" }, "sub");
+  AddOp(&net_def, "Mul", { "k", "q" }, "mul");
+  OperatorDef* concat = AddOp(&net_def, "Concat", { "sub", "mul", "k" }, "din");
+  ArgumentHelper::SetSingleArgument<int>(*concat, "axis", 2);
+  AddOp(&net_def, "Gemm", { "din", "w1" }, "score");
+  AddOp(&net_def, "Mul", { "k", "score" }, "weighted");
+  OperatorDef* reduce = AddOp(&net_def, "ReduceSum", { "weighted" }, "y");
+  ArgumentHelper::SetSingleArgument<size_t>(*reduce, "axis", 1);
+  ArgumentHelper::SetSingleArgument<int>(*reduce, "keepdims", 0);
+
+  TargetAttentionFusionPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  ASSERT_EQ(1, ret.op_size());
+  const OperatorDef& op = ret.op(0);
+  EXPECT_EQ("FusedTargetAttention", op.type());
+  ASSERT_EQ(3, op.input_size());
+  EXPECT_EQ("q", op.input(0));
+  EXPECT_EQ("k", op.input(1));
+  ArgumentHelper argument_helper(op);
+  std::vector<std::string> interaction =
+      argument_helper.GetRepeatedArgument<std::string>("interaction");
+  std::vector<std::string> expected_interaction = { "key_sub_query", "query_mul_key", "key" };
+  EXPECT_EQ(expected_interaction, interaction);
+  EXPECT_FALSE(argument_helper.GetSingleArgument<bool>("masked", true));
+  EXPECT_FALSE(argument_helper.GetSingleArgument<bool>("softmax", true));
+  EXPECT_FALSE(argument_helper.GetSingleArgument<bool>("keepdims", true));
+}
+
+TEST(TestTargetAttentionFusionPass, SharedScore) {
+  NetDef net_def;
+  net_def.add_external_output()->set_name("y");
+  net_def.add_external_output()->set_name("score");
+  AddAttention(&net_def);
+
+  TargetAttentionFusionPass pass;
+  NetDef ret = pass.RunPass(net_def);
+  EXPECT_EQ(net_def.op_size(), ret.op_size());
+}
+
+}  // namespace blaze
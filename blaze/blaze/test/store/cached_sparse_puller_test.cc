@@ -0,0 +1,151 @@
+/*
+ * \file cached_sparse_puller_test.cc
+ * \brief The cached sparse puller test unit
+ */
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+#include "blaze/common/types.h"
+#include "blaze/store/cached_sparse_puller.h"
+
+namespace blaze {
+namespace store {
+
+namespace {
+
+const int kDim = 2;
+
+// Writes the sum of key * value of a batch to each dim, counts the pulls
+class CountingSparsePuller : public SparsePuller {
+ public:
+  Status Load(const std::string& url) override { return kOK; }
+  Status LoadDelta(const std::string& url) override { ++delta; return kOK; }
+  Status Get(const std::vector<SparsePullerInput>& input,
+             std::vector<SparsePullerOutput>& output) override {
+    for (size_t i = 0; i < input.size(); ++i) {
+      ++route_num;
+      const int64_t* key = reinterpret_cast<const int64_t*>(input[i].key);
+      const int32_t* key_num = reinterpret_cast<const int32_t*>(input[i].key_num);
+      const float* value = reinterpret_cast<const float*>(input[i].value);
+      for (size_t k = 0; k < output[i].out_item.size(); ++k) {
+        float* out = reinterpret_cast<float*>(output[i].out_item[k].out);
+        size_t offset = 0;
+        for (size_t b = 0; b < input[i].key_num_size; ++b) {
+          float sum = k;
+          for (int j = 0; j < key_num[b]; ++j, ++offset) sum += key[offset] * value[offset];
+          for (int d = 0; d < input[i].dim; ++d) out[d] = sum;
+          out += output[i].out_item[k].stride;
+        }
+      }
+    }
+    return kOK;
+  }
+
+  int route_num = 0;
+  int delta = 0;
+};
+
+struct Route {
+  std::vector<int64_t> key = { 1, 2, 3 };
+  std::vector<int32_t> key_num = { 2, 1 };
+  std::vector<float> value = { 1.0f, 1.0f, 2.0f };
+  // two sum items in a block of stride 2 * kDim
+  std::vector<float> out = std::vector<float>(2 * 2 * kDim, 0.0f);
+
+  void Build(SparsePullerInput* input, SparsePullerOutput* output) {
+    input->name = "user_table";
+    input->key = key.data();
+    input->key_num = key_num.data();
+    input->key_num_size = key_num.size();
+    input->value = value.data();
+    input->key_type = blaze::kInt64;
+    input->value_type = blaze::kFloat;
+    input->num_type = blaze::kInt32;
+    input->dim = kDim;
+    input->in_item.resize(2);
+    output->out_item.resize(2);
+    for (size_t k = 0; k < 2; ++k) {
+      input->in_item[k].udf_type = kSum;
+      input->in_item[k].trunc_direction = kOrder;
+      input->in_item[k].trunc_num = 0;
+      output->out_item[k].out = out.data() + k * kDim;
+      output->out_item[k].stride = 2 * kDim;
+    }
+  }
+};
+
+Status Pull(CachedSparsePuller* puller, Route* route) {
+  std::vector<SparsePullerInput> input(1);
+  std::vector<SparsePullerOutput> output(1);
+  route->Build(&input[0], &output[0]);
+  return puller->Get(input, output);
+}
+
+}  // namespace
+
+TEST(TestCachedSparsePuller, Get) {
+  std::shared_ptr<CountingSparsePuller> counting(new CountingSparsePuller());
+  CachedSparsePuller puller(counting, CachedSparsePuller::Options());
+
+  Route first;
+  EXPECT_EQ(kOK, Pull(&puller, &first));
+  EXPECT_EQ(1, counting->route_num);
+  Route second;
+  EXPECT_EQ(kOK, Pull(&puller, &second));
+  EXPECT_EQ(1, counting->route_num);
+  EXPECT_EQ(first.out, second.out);
+  EXPECT_FLOAT_EQ(3.0f, second.out[0]);
+  EXPECT_FLOAT_EQ(4.0f, second.out[kDim]);
+  EXPECT_FLOAT_EQ(6.0f, second.out[2 * kDim]);
+
+  // another value misses
+  Route third;
+  third.value[2] = 3.0f;
+  EXPECT_EQ(kOK, Pull(&puller, &third));
+  EXPECT_EQ(2, counting->route_num);
+  EXPECT_FLOAT_EQ(9.0f, third.out[2 * kDim]);
+
+  CachedSparsePuller::Stats stats = puller.GetStats();
+  EXPECT_EQ(1u, stats.hit);
+  EXPECT_EQ(2u, stats.miss);
+  EXPECT_EQ(2u, stats.entry_num);
+
+  // the delta of the weights clears the cache
+  EXPECT_EQ(kOK, puller.LoadDelta("delta"));
+  EXPECT_EQ(1, counting->delta);
+  EXPECT_EQ(0u, puller.GetStats().entry_num);
+  Route fourth;
+  EXPECT_EQ(kOK, Pull(&puller, &fourth));
+  EXPECT_EQ(3, counting->route_num);
+}
+
+TEST(TestCachedSparsePuller, Capacity) {
+  std::shared_ptr<CountingSparsePuller> counting(new CountingSparsePuller());
+  CachedSparsePuller::Options options;
+  options.capacity_bytes = 64;
+  options.shard_num = 1;
+  CachedSparsePuller puller(counting, options);
+
+  Route route;
+  EXPECT_EQ(kOK, Pull(&puller, &route));
+  EXPECT_EQ(kOK, Pull(&puller, &route));
+  EXPECT_EQ(2, counting->route_num);
+  EXPECT_EQ(0u, puller.GetStats().entry_num);
+}
+
+TEST(TestCachedSparsePuller, Ttl) {
+  std::shared_ptr<CountingSparsePuller> counting(new CountingSparsePuller());
+  CachedSparsePuller::Options options;
+  options.ttl_micros = 0;
+  CachedSparsePuller puller(counting, options);
+
+  Route route;
+  EXPECT_EQ(kOK, Pull(&puller, &route));
+  usleep(10);
+  EXPECT_EQ(kOK, Pull(&puller, &route));
+  EXPECT_EQ(2, counting->route_num);
+}
+
+}  // namespace store
+}  // namespace blaze
@@ -0,0 +1,56 @@
+/*
+ * \file embedding_cache_test.cc
+ * \brief The embedding cache test unit
+ */
+#include "gtest/gtest.h"
+
+#include "blaze/store/online/embedding_cache.h"
+
+namespace blaze {
+namespace store {
+
+TEST(TestEmbeddingCache, LookupInsert) {
+  EmbeddingCache cache(4, 100, 1);
+  float row[2] = { 1.0f, 2.0f };
+  float out[2];
+  EXPECT_EQ(EmbeddingCache::kMiss, cache.Lookup(0, 7, 2, 0, out));
+  cache.Insert(0, 7, row, 2, 0);
+  cache.Insert(0, 8, nullptr, 2, 0);
+  EXPECT_EQ(EmbeddingCache::kHit, cache.Lookup(0, 7, 2, 10, out));
+  EXPECT_FLOAT_EQ(1.0f, out[0]);
+  EXPECT_FLOAT_EQ(2.0f, out[1]);
+  EXPECT_EQ(EmbeddingCache::kHitMissing, cache.Lookup(0, 8, 2, 10, out));
+  // the tables have their own keys
+  EXPECT_EQ(EmbeddingCache::kMiss, cache.Lookup(1, 7, 2, 10, out));
+  // another dim
+  EXPECT_EQ(EmbeddingCache::kMiss, cache.Lookup(0, 7, 4, 10, out));
+  EXPECT_EQ(1u, cache.size());
+}
+
+TEST(TestEmbeddingCache, Ttl) {
+  EmbeddingCache cache(4, 100, 1);
+  float row[1] = { 1.0f };
+  float out[1];
+  cache.Insert(0, 7, row, 1, 0);
+  EXPECT_EQ(EmbeddingCache::kHit, cache.Lookup(0, 7, 1, 100, out));
+  EXPECT_EQ(EmbeddingCache::kMiss, cache.Lookup(0, 7, 1, 101, out));
+  EXPECT_EQ(0u, cache.size());
+}
+
+TEST(TestEmbeddingCache, Evict) {
+  EmbeddingCache cache(2, 100, 1);
+  float row[1] = { 1.0f };
+  float out[1];
+  cache.Insert(0, 1, row, 1, 0);
+  cache.Insert(0, 2, row, 1, 0);
+  // 1 is the most recent
+  EXPECT_EQ(EmbeddingCache::kHit, cache.Lookup(0, 1, 1, 0, out));
+  cache.Insert(0, 3, row, 1, 0);
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_EQ(EmbeddingCache::kHit, cache.Lookup(0, 1, 1, 0, out));
+  EXPECT_EQ(EmbeddingCache::kMiss, cache.Lookup(0, 2, 1, 0, out));
+  EXPECT_EQ(EmbeddingCache::kHit, cache.Lookup(0, 3, 1, 0, out));
+}
+
+}  // namespace store
+}  // namespace blaze
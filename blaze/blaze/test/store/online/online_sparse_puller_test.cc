@@ -0,0 +1,145 @@
+/*
+ * \file online_sparse_puller_test.cc
+ * \brief The online sparse puller test unit
+ */
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <thread>
+
+#include "blaze/common/types.h"
+#include "blaze/store/online/online_sparse_puller.h"
+
+namespace blaze {
+namespace store {
+
+// the row of key k is k + i, the negative keys are missing
+class TestEmbeddingSource : public OnlineEmbeddingSource {
+ public:
+  Status Open(const std::string& url) override { return kOK; }
+  Status MultiGet(const std::string& table,
+                  const int64_t* keys,
+                  size_t key_num,
+                  int dim,
+                  float* rows,
+                  std::vector<bool>* found) override {
+    ++requests;
+    pulled_keys += key_num;
+    for (size_t i = 0; i < key_num; ++i) {
+      (*found)[i] = keys[i] >= 0;
+      for (int d = 0; d < dim; ++d) {
+        rows[i * dim + d] = keys[i] + d;
+      }
+    }
+    return kOK;
+  }
+
+  static int requests;
+  static size_t pulled_keys;
+};
+
+int TestEmbeddingSource::requests = 0;
+size_t TestEmbeddingSource::pulled_keys = 0;
+
+OnlineEmbeddingSource* CreateTestEmbeddingSource() {
+  return new TestEmbeddingSource();
+}
+REGISTER_ONLINE_EMBEDDING_SOURCE("test", CreateTestEmbeddingSource);
+
+TEST(TestOnlineSparsePuller, Load) {
+  std::unique_ptr<SparsePuller> puller(
+      SparsePullerCreationRegisterer::Get()->CreateSparsePuller("online_sparse_puller"));
+  ASSERT_TRUE(puller != nullptr);
+  EXPECT_EQ(kFail, puller->Load("unknown://addr"));
+  EXPECT_EQ(kOK, puller->Load("test://addr"));
+}
+
+TEST(TestOnlineSparsePuller, Get) {
+  OnlineSparsePuller puller;
+  EXPECT_EQ(kOK, puller.Load("test://addr"));
+  TestEmbeddingSource::requests = 0;
+  TestEmbeddingSource::pulled_keys = 0;
+
+  const int dim = 2;
+  std::vector<SparsePullerInput> inputs(1);
+  std::vector<SparsePullerOutput> outputs(1);
+  int64_t keys[5] = { 1, 3, 1, -1, 3 };
+  int32_t key_nums[2] = { 3, 2 };
+  float values[5] = { 1.0f, 1.0f, 2.0f, 1.0f, 1.0f };
+  inputs[0].name = "101";
+  inputs[0].key = keys;
+  inputs[0].key_num = key_nums;
+  inputs[0].key_num_size = 2;
+  inputs[0].value = values;
+  inputs[0].key_type = blaze::kInt64;
+  inputs[0].num_type = blaze::kInt32;
+  inputs[0].value_type = blaze::kFloat;
+  inputs[0].dim = dim;
+  SparsePullerInput::Param in_param;
+  in_param.udf_type = UDFType::kSum;
+  inputs[0].in_item.push_back(in_param);
+  float out[dim * 2];
+  SparsePullerOutput::OutItem out_param;
+  out_param.out = out;
+  out_param.stride = dim;
+  outputs[0].out_item.push_back(out_param);
+
+  EXPECT_EQ(kOK, puller.Get(inputs, outputs));
+  // the unique keys in one request
+  EXPECT_EQ(1, TestEmbeddingSource::requests);
+  EXPECT_EQ(3u, TestEmbeddingSource::pulled_keys);
+  for (int d = 0; d < dim; ++d) {
+    EXPECT_FLOAT_EQ((1 + d) * 3.0f + (3 + d), out[d]);
+    EXPECT_FLOAT_EQ(3.0f + d, out[dim + d]);
+  }
+
+  // served by the cache
+  EXPECT_EQ(kOK, puller.Get(inputs, outputs));
+  EXPECT_EQ(1, TestEmbeddingSource::requests);
+  EXPECT_EQ(3u, puller.cache().size());
+  for (int d = 0; d < dim; ++d) {
+    EXPECT_FLOAT_EQ((1 + d) * 3.0f + (3 + d), out[d]);
+    EXPECT_FLOAT_EQ(3.0f + d, out[dim + d]);
+  }
+}
+
+TEST(TestOnlineSparsePuller, Ttl) {
+  OnlineSparsePuller::Options options;
+  options.ttl_micros = 0;
+  OnlineSparsePuller puller(options);
+  EXPECT_EQ(kOK, puller.Load("test://addr"));
+  TestEmbeddingSource::requests = 0;
+
+  std::vector<SparsePullerInput> inputs(1);
+  std::vector<SparsePullerOutput> outputs(1);
+  int64_t keys[1] = { 5 };
+  int32_t key_nums[1] = { 1 };
+  float values[1] = { 1.0f };
+  inputs[0].name = "101";
+  inputs[0].key = keys;
+  inputs[0].key_num = key_nums;
+  inputs[0].key_num_size = 1;
+  inputs[0].value = values;
+  inputs[0].key_type = blaze::kInt64;
+  inputs[0].num_type = blaze::kInt32;
+  inputs[0].value_type = blaze::kFloat;
+  inputs[0].dim = 1;
+  SparsePullerInput::Param in_param;
+  in_param.udf_type = UDFType::kSum;
+  inputs[0].in_item.push_back(in_param);
+  float out[1];
+  SparsePullerOutput::OutItem out_param;
+  out_param.out = out;
+  out_param.stride = 1;
+  outputs[0].out_item.push_back(out_param);
+
+  EXPECT_EQ(kOK, puller.Get(inputs, outputs));
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_EQ(kOK, puller.Get(inputs, outputs));
+  // the stale rows are pulled again
+  EXPECT_EQ(2, TestEmbeddingSource::requests);
+  EXPECT_FLOAT_EQ(5.0f, out[0]);
+}
+
+}  // namespace store
+}  // namespace blaze
@@ -97,10 +97,7 @@ TEST(TestQuickEmbeddingDict, Load) {
   EXPECT_EQ(dict.Load(url), kOK);
 }
 
-TEST(TestQuickEmbeddingDict, Get) {
-  const std::string url = "test.ut.quickembedding.bin";
-  QuickEmbeddingDict dict;
-  EXPECT_EQ(dict.Load(url), kOK);
+void CheckGet(QuickEmbeddingDict& dict) {
 
   std::vector<SparsePullerInput> sparse_puller_inputs;
   std::vector<SparsePullerOutput> sparse_puller_outputs;
@@ -249,5 +246,192 @@ TEST(TestQuickEmbeddingDict, Get) {
   }*/
 }
 
+TEST(TestQuickEmbeddingDict, Get) {
+  const std::string url = "test.ut.quickembedding.bin";
+  QuickEmbeddingDict dict;
+  EXPECT_EQ(dict.Load(url), kOK);
+  CheckGet(dict);
+}
+
+TEST(TestQuickEmbeddingDict, GetMapped) {
+  const std::string url = "test.ut.quickembedding.bin";
+  MockQuickEmbedding(url);
+  QuickEmbeddingDict::MmapOptions mmap_options;
+  mmap_options.enable = true;
+  QuickEmbeddingDict dict(mmap_options);
+  EXPECT_EQ(dict.Load("no_exist"), kFail);
+  EXPECT_EQ(dict.Load(url), kOK);
+  // mapped once, a new dict maps the new version
+  EXPECT_EQ(dict.Load(url), kFail);
+  CheckGet(dict);
+
+  mmap_options.populate = true;
+  mmap_options.hugepage = true;
+  QuickEmbeddingDict populated_dict(mmap_options);
+  EXPECT_EQ(populated_dict.Load(url), kOK);
+  CheckGet(populated_dict);
+}
+
+TEST(TestQuickEmbeddingDict, GetQuantized) {
+  const std::string url = "test.ut.quickembedding.qint8.bin";
+  VersionVerifier verifier(DictValueType::int8_rowwise);
+  BulkLoadTrie trie;
+  BulkLoadHashTable hashtable;
+  WeightBlob<qint8> weight_blob;
+  trie.PreInsert(table2, 0);
+  trie.BulkLoad();
+  weight_blob.AllocateRows(1, dim2);
+  qint8* weights = nullptr;
+  uint64_t offset = weight_blob.InsertWeights(dim2, &weights);
+  EXPECT_TRUE(weights != nullptr);
+  WeightRow<qint8>::Encode(case2, dim2, weights);
+  hashtable.PreInsert(key2, offset);
+  EXPECT_TRUE(hashtable.BulkLoad());
+
+  std::ofstream os(url, std::ios::binary);
+  EXPECT_TRUE(verifier.Dump(&os));
+  EXPECT_TRUE(trie.Dump(&os));
+  uint16_t gid = 0;
+  EXPECT_TRUE(os.write((char*)&gid, sizeof(gid)));
+  EXPECT_TRUE(hashtable.Dump(&os));
+  EXPECT_TRUE(weight_blob.Dump(&os));
+  os.close();
+
+  QuickEmbeddingDict dict;
+  EXPECT_EQ(dict.Load(url), kOK);
+  std::vector<SparsePullerInput> inputs(1);
+  std::vector<SparsePullerOutput> outputs(1);
+  int64_t keys[2] = {849234344343, 849234344343};
+  int32_t key_nums[1] = {2};
+  float values[2] = {1.2f, 1.0f};
+  inputs[0].name = table2;
+  inputs[0].key = keys;
+  inputs[0].key_num = key_nums;
+  inputs[0].key_num_size = 1;
+  inputs[0].value = values;
+  inputs[0].key_type = blaze::kInt64;
+  inputs[0].num_type = blaze::kInt32;
+  inputs[0].value_type = blaze::kFloat;
+  inputs[0].dim = dim2;
+  SparsePullerInput::Param in_param;
+  in_param.udf_type = UDFType::kAvg;
+  inputs[0].in_item.push_back(in_param);
+  float out[dim2];
+  SparsePullerOutput::OutItem out_param;
+  out_param.out = out;
+  out_param.stride = dim2;
+  outputs[0].out_item.push_back(out_param);
+
+  EXPECT_EQ(dict.Get(inputs, outputs), kOK);
+  for (int i = 0; i < dim2; ++i) {
+    EXPECT_NEAR(case2[i] * (values[0] + values[1]) / 2, out[i], 0.01f);
+  }
+}
+
+// a delta dict of the row of key in table
+void MockDelta(const std::string& url, const Trie::Key& table, HashTable::Key key,
+               const float* row, int dim) {
+  VersionVerifier verifier(DictValueType::fp32);
+  BulkLoadTrie trie;
+  BulkLoadHashTable hashtable;
+  WeightBlob<float> weight_blob;
+  trie.PreInsert(table, 0);
+  trie.BulkLoad();
+  weight_blob.AllocateRows(1, dim);
+  float* weights = nullptr;
+  uint64_t offset = weight_blob.InsertWeights(dim, &weights);
+  EXPECT_TRUE(weights != nullptr);
+  memcpy(weights, row, sizeof(float) * dim);
+  hashtable.PreInsert(key, offset);
+  EXPECT_TRUE(hashtable.BulkLoad());
+
+  std::ofstream os(url, std::ios::binary);
+  EXPECT_TRUE(verifier.Dump(&os));
+  EXPECT_TRUE(trie.Dump(&os));
+  uint16_t gid = 0;
+  EXPECT_TRUE(os.write((char*)&gid, sizeof(gid)));
+  EXPECT_TRUE(hashtable.Dump(&os));
+  EXPECT_TRUE(weight_blob.Dump(&os));
+  os.close();
+}
+
+// sum the rows of keys in table, one key a batch
+void GetRows(QuickEmbeddingDict& dict, const Trie::Key& table, int64_t* keys,
+             size_t key_num, int dim, float* out) {
+  std::vector<SparsePullerInput> inputs(1);
+  std::vector<SparsePullerOutput> outputs(1);
+  std::vector<int32_t> key_nums(key_num, 1);
+  std::vector<float> values(key_num, 1.0f);
+  inputs[0].name = table;
+  inputs[0].key = keys;
+  inputs[0].key_num = key_nums.data();
+  inputs[0].key_num_size = key_num;
+  inputs[0].value = values.data();
+  inputs[0].key_type = blaze::kInt64;
+  inputs[0].num_type = blaze::kInt32;
+  inputs[0].value_type = blaze::kFloat;
+  inputs[0].dim = dim;
+  SparsePullerInput::Param in_param;
+  in_param.udf_type = UDFType::kSum;
+  inputs[0].in_item.push_back(in_param);
+  SparsePullerOutput::OutItem out_param;
+  out_param.out = out;
+  out_param.stride = dim;
+  outputs[0].out_item.push_back(out_param);
+  EXPECT_EQ(dict.Get(inputs, outputs), kOK);
+}
+
+TEST(TestQuickEmbeddingDict, LoadDelta) {
+  const std::string url = "test.ut.quickembedding.bin";
+  const std::string delta_url1 = "test.ut.quickembedding.delta1.bin";
+  const std::string delta_url2 = "test.ut.quickembedding.delta2.bin";
+  const std::string delta_url3 = "test.ut.quickembedding.delta3.bin";
+  HashTable::Key new_key = 12312422;
+  float row1[dim1] = {2.0f, 0.5f, 1.5f, 4.0f};
+  float row2[dim1] = {3.0f, 1.0f, 2.0f, 0.5f};
+  MockQuickEmbedding(url);
+  // a new row, the changed row of the new row, and a new table
+  MockDelta(delta_url1, table1, new_key, row1, dim1);
+  MockDelta(delta_url2, table1, new_key, row2, dim1);
+  MockDelta(delta_url3, "105", key1, case3, dim3);
+
+  QuickEmbeddingDict dict;
+  EXPECT_EQ(dict.LoadDelta(delta_url1), kFail);
+  EXPECT_EQ(dict.Load(url), kOK);
+  EXPECT_EQ(dict.LoadDelta("no_exist"), kFail);
+
+  int64_t keys[2] = {key1, new_key};
+  float out[dim1 * 2];
+  GetRows(dict, table1, keys, 2, dim1, out);
+  for (int i = 0; i < dim1; ++i) {
+    EXPECT_FLOAT_EQ(case1[i], out[i]);
+    EXPECT_FLOAT_EQ(0.0f, out[dim1 + i]);
+  }
+
+  EXPECT_EQ(dict.LoadDelta(delta_url1), kOK);
+  GetRows(dict, table1, keys, 2, dim1, out);
+  for (int i = 0; i < dim1; ++i) {
+    EXPECT_FLOAT_EQ(case1[i], out[i]);
+    EXPECT_FLOAT_EQ(row1[i], out[dim1 + i]);
+  }
+
+  // the latest delta wins
+  EXPECT_EQ(dict.LoadDelta(delta_url2), kOK);
+  GetRows(dict, table1, keys, 2, dim1, out);
+  for (int i = 0; i < dim1; ++i) {
+    EXPECT_FLOAT_EQ(case1[i], out[i]);
+    EXPECT_FLOAT_EQ(row2[i], out[dim1 + i]);
+  }
+
+  EXPECT_EQ(dict.LoadDelta(delta_url3), kOK);
+  float new_table_out[dim3];
+  GetRows(dict, "105", keys, 1, dim3, new_table_out);
+  for (int i = 0; i < dim3; ++i) {
+    EXPECT_FLOAT_EQ(case3[i], new_table_out[i]);
+  }
+  // the rows not in the deltas are kept
+  CheckGet(dict);
+}
+
 }  // namespace store
 }  // namespace blaze
\ No newline at end of file
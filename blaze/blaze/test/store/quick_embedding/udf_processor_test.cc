@@ -291,5 +291,67 @@ TEST(TestKAssignProcessor, NoTrunc) {
   }
 }
 
+TEST(Test, EmbeddingAxpy) {
+  // the vector body and the tail
+  const int dim = 11;
+  float weights[dim];
+  float16 half_weights[dim];
+  for (int i = 0; i < dim; ++i) {
+    weights[i] = 0.5f * i;
+    half_weights[i] = float16(weights[i]);
+  }
+  float out[dim];
+  float half_out[dim];
+  for (int i = 0; i < dim; ++i) {
+    out[i] = half_out[i] = 1.0f;
+  }
+  EmbeddingAxpy(2.0f, weights, dim, false, out);
+  EmbeddingAxpy(2.0f, half_weights, dim, false, half_out);
+  for (int i = 0; i < dim; ++i) {
+    EXPECT_FLOAT_EQ(1.0f + i, out[i]);
+    EXPECT_FLOAT_EQ(1.0f + i, half_out[i]);
+  }
+  EmbeddingAxpy(2.0f, half_weights, dim, true, half_out);
+  for (int i = 0; i < dim; ++i) {
+    EXPECT_FLOAT_EQ(1.0f * i, half_out[i]);
+  }
+}
+
+template <typename T>
+void CheckQuantizedAxpy(float tolerance) {
+  const int dim = 19;
+  float weights[dim];
+  for (int i = 0; i < dim; ++i) {
+    weights[i] = 0.1f * i - 0.7f;
+  }
+  char row[64];
+  ASSERT_LE(WeightRow<T>::Bytes(dim), sizeof(row));
+  WeightRow<T>::Encode(weights, dim, reinterpret_cast<T*>(row));
+  const T* quantized = reinterpret_cast<const T*>(row);
+
+  float out[dim];
+  float16 half_out[dim];
+  for (int i = 0; i < dim; ++i) {
+    out[i] = 1.0f;
+    half_out[i] = float16(1.0f);
+  }
+  EmbeddingAxpy(2.0f, quantized, dim, false, out);
+  EmbeddingAxpy(float16(2.0f), quantized, dim, false, half_out);
+  for (int i = 0; i < dim; ++i) {
+    EXPECT_NEAR(1.0f + 2.0f * weights[i], out[i], 2 * tolerance);
+    EXPECT_NEAR(1.0f + 2.0f * weights[i], (float)half_out[i], 2 * tolerance + 0.01f);
+  }
+  EmbeddingAxpy(1.0f, quantized, dim, true, out);
+  for (int i = 0; i < dim; ++i) {
+    EXPECT_NEAR(weights[i], out[i], tolerance);
+  }
+}
+
+TEST(Test, QuantizedEmbeddingAxpy) {
+  // half of the quantization step
+  CheckQuantizedAxpy<qint8>(1.8f / 255 / 2 + 1e-5f);
+  CheckQuantizedAxpy<qint4>(1.8f / 15 / 2 + 1e-5f);
+}
+
 }  // namespace store
 }  // namespace blaze
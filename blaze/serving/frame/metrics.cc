@@ -0,0 +1,78 @@
+/*
+ * \file metrics.cc
+ * \brief The serving metrics of the qps and the latency
+ */
+#include "serving/frame/metrics.h"
+
+#include <chrono>
+#include <sstream>
+
+namespace serving {
+
+ServingMetrics* ServingMetrics::Instance() {
+  static ServingMetrics g_serving_metrics;
+  return &g_serving_metrics;
+}
+
+ServingMetrics::ServingMetrics() :
+    request_num_(0), failure_num_(0), latency_sum_(0),
+    last_dump_micros_(NowMicros()), last_request_num_(0) {
+  for (int i = 0; i < kBucketNum; ++i) buckets_[i] = 0;
+}
+
+void ServingMetrics::Record(uint64_t latency_micros, bool success) {
+  ++request_num_;
+  if (!success) ++failure_num_;
+  latency_sum_ += latency_micros;
+  int bucket = 0;
+  while (bucket + 1 < kBucketNum && latency_micros >= (1ULL << (bucket + kMinShift))) ++bucket;
+  ++buckets_[bucket];
+}
+
+std::string ServingMetrics::Dump() {
+  uint64_t buckets[kBucketNum];
+  uint64_t total = 0;
+  for (int i = 0; i < kBucketNum; ++i) {
+    buckets[i] = buckets_[i].load();
+    total += buckets[i];
+  }
+  const uint64_t request_num = request_num_.load();
+  double qps = 0.0;
+  {
+    std::lock_guard<std::mutex> lock(dump_mutex_);
+    uint64_t now_micros = NowMicros();
+    if (now_micros > last_dump_micros_) {
+      qps = (request_num - last_request_num_) * 1e6 / (now_micros - last_dump_micros_);
+    }
+    last_dump_micros_ = now_micros;
+    last_request_num_ = request_num;
+  }
+
+  std::stringstream ss;
+  ss << "requests: " << request_num << "\n";
+  ss << "failures: " << failure_num_.load() << "\n";
+  ss << "qps: " << qps << "\n";
+  ss << "latency_avg_ms: " << (total == 0 ? 0.0 : latency_sum_.load() / 1000.0 / total) << "\n";
+  ss << "latency_p50_ms: " << Percentile(buckets, total, 0.5) / 1000.0 << "\n";
+  ss << "latency_p99_ms: " << Percentile(buckets, total, 0.99) / 1000.0 << "\n";
+  return ss.str();
+}
+
+uint64_t ServingMetrics::Percentile(const uint64_t* buckets, uint64_t total,
+                                    double percentile) const {
+  if (total == 0) return 0;
+  uint64_t count = 0;
+  for (int i = 0; i < kBucketNum; ++i) {
+    count += buckets[i];
+    // the upper bound of the bucket
+    if (count >= total * percentile) return 1ULL << (i + kMinShift);
+  }
+  return 1ULL << (kBucketNum - 1 + kMinShift);
+}
+
+uint64_t ServingMetrics::NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace serving
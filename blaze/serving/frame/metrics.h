@@ -0,0 +1,48 @@
+/*
+ * \file metrics.h
+ * \brief The serving metrics of the qps and the latency
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+namespace serving {
+
+// Counts the requests and the latency histogram of the server, dumped at
+// the /metrics path. The qps is of the time since the last dump.
+class ServingMetrics {
+ public:
+  static ServingMetrics* Instance();
+
+  // record a finished request
+  void Record(uint64_t latency_micros, bool success);
+
+  // the text of the counters, the qps and the latency percentiles
+  std::string Dump();
+
+  static uint64_t NowMicros();
+
+ protected:
+  ServingMetrics();
+
+  // the bucket i counts the latency below 2^(i + kMinShift) micros
+  static const int kMinShift = 6;
+  static const int kBucketNum = 18;
+  // the latency of the percentile from the bucket counts
+  uint64_t Percentile(const uint64_t* buckets, uint64_t total, double percentile) const;
+
+  std::atomic<uint64_t> request_num_;
+  std::atomic<uint64_t> failure_num_;
+  std::atomic<uint64_t> latency_sum_;
+  std::atomic<uint64_t> buckets_[kBucketNum];
+
+  std::mutex dump_mutex_;
+  uint64_t last_dump_micros_;
+  uint64_t last_request_num_;
+};
+
+}  // namespace serving
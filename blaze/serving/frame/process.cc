@@ -2,8 +2,11 @@
  * \file process.cc
  * \brief The blaze serving request process function.
  */
-#include "blaze/common/queue.h"
 #include "serving/frame/process.h"
+
+#include <string.h>
+
+#include "blaze/common/queue.h"
 #include "serving/model/model.h"
 #include "serving/model/model_manager.h"
 
@@ -163,23 +166,47 @@ void PredictProcessor::FeedIndicator(size_t batch_size,
                   tensor.aux_size() * sizeof(tensor.aux(0)));
 }
 
-bool PredictProcessor::Process(const std::string &input_str,
-                               ProcessContext* process_context,
-                               std::string* output_str) {
-  Request request;
-  google::protobuf::util::Status status = google::protobuf::util::JsonStringToMessage(input_str, &request);
+bool PredictProcessor::ParseRequest(const char* data,
+                                    size_t len,
+                                    bool binary,
+                                    Request* request,
+                                    std::string* output_str) {
+  if (binary) {
+    if (!request->ParseFromArray(data, static_cast<int>(len))) {
+      *output_str = "Error: parse binary request failed!\n";
+      return false;
+    }
+    return true;
+  }
+  google::protobuf::util::Status status = google::protobuf::util::JsonStringToMessage(
+      google::protobuf::StringPiece(data, len), request);
   if (!status.ok()) {
     *output_str = "Error: parse request failed!\n" + status.ToString();
     return false;
   }
-  //std::cout << request.DebugString() << std::endl;
+  return true;
+}
 
+blaze::Predictor* PredictProcessor::Prepare(const Request& request,
+                                            ProcessContext* process_context,
+                                            std::string* output_str) {
   blaze::Predictor* predictor = ModelManager::Instance()->CreatePredictor(request.model_version());
   if (predictor == nullptr) {
     *output_str = "[ERROR] create predictor for <" + request.model_version() + "> failed.\n";
-    return false;
+    return nullptr;
+  }
+
+  if (!Feed(request, process_context, predictor, output_str)) {
+    delete predictor;
+    return nullptr;
   }
+  return predictor;
+}
 
+bool PredictProcessor::Feed(const Request& request,
+                            ProcessContext* process_context,
+                            blaze::Predictor* predictor,
+                            std::string* output_str) {
   if (!GenerateProcessContext(request, process_context, output_str)) {
     return false;
   }
@@ -215,14 +242,12 @@ bool PredictProcessor::Process(const std::string &input_str,
         break;
     }
   }
+  return true;
+}
 
-  //calculate forward
-  if (!predictor->Forward()) {
-    *output_str = "[ERROR] forward <" + request.model_version() + "> failed.\n";
-    delete(predictor);
-    return false;
-  }
-
+bool PredictProcessor::Respond(blaze::Predictor* predictor,
+                               bool binary,
+                               std::string* output_str) {
   //get outputs
   size_t n = predictor->OutputSize();
   std::vector<float*> output_ptrs(n);
@@ -230,7 +255,6 @@ bool PredictProcessor::Process(const std::string &input_str,
   for(size_t i = 0; i < n; ++i) {
     if (!predictor->Output(i, (void**)&(output_ptrs[i]), &(output_lens[i]))) {
       *output_str = "[ERROR] get output <" + (predictor->ListOutputName()[i]) + "> failed.\n";
-      delete (predictor);
       return false;
     }
   }
@@ -248,16 +272,38 @@ bool PredictProcessor::Process(const std::string &input_str,
       tensor->add_shape(dim);
     }
     //value
-    tensor->mutable_value()->Reserve(static_cast<int>(output_lens[i]));
-    for (size_t j = 0; j < output_lens[i]/sizeof(float); ++j) {
-      tensor->add_value(output_ptrs[i][j]);
-    }
+    size_t value_num = output_lens[i] / sizeof(float);
+    tensor->mutable_value()->Resize(static_cast<int>(value_num), 0.0f);
+    memcpy(tensor->mutable_value()->mutable_data(), output_ptrs[i], value_num * sizeof(float));
   }
 
-  google::protobuf::util::MessageToJsonString(response, output_str);
+  if (binary) {
+    response.SerializeToString(output_str);
+  } else {
+    google::protobuf::util::MessageToJsonString(response, output_str);
+  }
+  return true;
+}
 
+bool PredictProcessor::Process(const std::string &input_str,
+                               ProcessContext* process_context,
+                               std::string* output_str) {
+  Request request;
+  if (!ParseRequest(input_str.data(), input_str.size(), false, &request, output_str)) {
+    return false;
+  }
+  blaze::Predictor* predictor = Prepare(request, process_context, output_str);
+  if (predictor == nullptr) return false;
+
+  //calculate forward
+  if (!predictor->Forward()) {
+    *output_str = "[ERROR] forward <" + request.model_version() + "> failed.\n";
+    delete(predictor);
+    return false;
+  }
+  bool success = Respond(predictor, false, output_str);
   delete(predictor);
-  return true;
+  return success;
 };
 
 } //namespace serving
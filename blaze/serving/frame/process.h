@@ -21,10 +21,36 @@ struct ProcessContext {
 
 class PredictProcessor {
  public:
+  // Process a json request synchronously
   bool Process(const std::string& input_str,
                ProcessContext* process_context,
                std::string* output_str);
-  
+
+  // Parse the request of a json or binary protobuf payload in place
+  bool ParseRequest(const char* data,
+                    size_t len,
+                    bool binary,
+                    Request* request,
+                    std::string* output_str);
+
+  // Create the predictor of the request and feed its inputs, the
+  // process_context can be reused once fed. Return nullptr if failed.
+  blaze::Predictor* Prepare(const Request& request,
+                            ProcessContext* process_context,
+                            std::string* output_str);
+
+  // Feed the inputs of the predictor with the request
+  bool Feed(const Request& request,
+            ProcessContext* process_context,
+            blaze::Predictor* predictor,
+            std::string* output_str);
+
+  // Serialize the outputs of the forwarded predictor as a json or binary
+  // protobuf response
+  bool Respond(blaze::Predictor* predictor,
+               bool binary,
+               std::string* output_str);
+
  protected:
   bool GenerateProcessContext(const Request& request,
                               ProcessContext* process_context,
@@ -0,0 +1,236 @@
+/*
+ * \file server.cc
+ * \brief The asynchronous http serving frame
+ */
+#include "serving/frame/server.h"
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+
+#include <event2/event.h>
+#include <event2/thread.h>
+#include <evhttp.h>
+
+#include "serving/frame/metrics.h"
+#include "serving/frame/process.h"
+#include "serving/frame/thread_local.h"
+
+namespace serving {
+
+typedef ThreadLocalStore<ProcessContext> ThreadLocalProcessContextStore;
+
+namespace {
+
+const char* kBinaryContentType = "application/x-protobuf";
+const char* kJsonContentType = "application/json";
+
+}  // namespace
+
+// The request in flight between the IO thread and the compute threads.
+// evhttp keeps the request and its input buffer alive until the reply,
+// even if the connection is closed meanwhile, so the payload is parsed
+// in place.
+struct RequestContext {
+  HttpServer* server;
+  evhttp_request* req;
+  event_base* base;
+  const char* data;
+  size_t len;
+  bool binary;
+  uint64_t start_micros;
+  bool success = false;
+  std::string output;
+};
+
+HttpServer::HttpServer(const ServerConfig& config) : config_(config), fd_(-1) { }
+
+HttpServer::~HttpServer() {
+  if (compute_executor_) {
+    compute_executor_->shutdown();
+    compute_executor_.reset();
+  }
+  for (auto& io_thread : io_threads_) {
+    if (io_thread.httpd != nullptr) evhttp_free(io_thread.httpd);
+    if (io_thread.base != nullptr) event_base_free(io_thread.base);
+  }
+  if (fd_ >= 0) close(fd_);
+}
+
+bool HttpServer::Start() {
+  // the compute threads post the replies to the bases of the IO threads
+  if (evthread_use_pthreads() != 0) {
+    std::cerr << "[ERROR] evthread_use_pthreads() fail!" << std::endl;
+    return false;
+  }
+  const int io_thread_num = std::max(config_.io_thread_num(), 1);
+  fd_ = BindSocket(config_.port(), config_.backlog());
+  if (fd_ < 0) {
+    std::cerr << "[ERROR] bind port " << config_.port() << " fail!" << std::endl;
+    return false;
+  }
+  compute_executor_.reset(new blaze::ThreadExecutor(config_.compute_thread_num()));
+
+  io_threads_.resize(io_thread_num);
+  for (auto& io_thread : io_threads_) {
+    io_thread.base = event_base_new();
+    if (io_thread.base == nullptr) {
+      std::cerr << "[ERROR] event_base_new() fail!" << std::endl;
+      return false;
+    }
+    io_thread.httpd = evhttp_new(io_thread.base);
+    if (io_thread.httpd == nullptr) {
+      std::cerr << "[ERROR] evhttp_new() fail!" << std::endl;
+      return false;
+    }
+    if (evhttp_accept_socket(io_thread.httpd, fd_) != 0) {
+      std::cerr << "[ERROR] evhttp_accept_socket() fail!" << std::endl;
+      return false;
+    }
+    evhttp_set_timeout(io_thread.httpd, config_.keep_alive_seconds());
+    evhttp_set_gencb(io_thread.httpd, OnRequest, this);
+  }
+  for (auto& io_thread : io_threads_) {
+    io_thread.thread = std::thread(event_base_dispatch, io_thread.base);
+  }
+  return true;
+}
+
+void HttpServer::Join() {
+  for (auto& io_thread : io_threads_) {
+    if (io_thread.thread.joinable()) io_thread.thread.join();
+  }
+}
+
+void HttpServer::OnRequest(evhttp_request* req, void* arg) {
+  HttpServer* server = reinterpret_cast<HttpServer*>(arg);
+  const char* uri = evhttp_request_get_uri(req);
+  if (evhttp_request_get_command(req) == EVHTTP_REQ_GET &&
+      uri != nullptr && strncmp(uri, "/metrics", 8) == 0) {
+    std::string metrics = ServingMetrics::Instance()->Dump() + blaze::DumpOpLatencyMetrics();
+    evbuffer* buf = evbuffer_new();
+    evbuffer_add(buf, metrics.data(), metrics.size());
+    evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type", "text/plain");
+    evhttp_send_reply(req, HTTP_OK, "OK", buf);
+    evbuffer_free(buf);
+    return;
+  }
+
+  RequestContext* ctx = new RequestContext();
+  ctx->server = server;
+  ctx->req = req;
+  ctx->base = evhttp_connection_get_base(evhttp_request_get_connection(req));
+  evbuffer* input = evhttp_request_get_input_buffer(req);
+  ctx->len = evbuffer_get_length(input);
+  ctx->data = reinterpret_cast<const char*>(evbuffer_pullup(input, -1));
+  const char* content_type = evhttp_find_header(evhttp_request_get_input_headers(req),
+                                                "Content-Type");
+  ctx->binary = content_type != nullptr &&
+      strncmp(content_type, kBinaryContentType, strlen(kBinaryContentType)) == 0;
+  ctx->start_micros = ServingMetrics::NowMicros();
+  server->compute_executor_->commit([server, ctx]() { server->Predict(ctx); });
+}
+
+void HttpServer::Predict(RequestContext* ctx) {
+  PredictProcessor predict_processor;
+  Request request;
+  if (!predict_processor.ParseRequest(ctx->data, ctx->len, ctx->binary, &request, &ctx->output)) {
+    PostReply(ctx);
+    return;
+  }
+  blaze::Predictor* predictor = predict_processor.Prepare(
+      request, ThreadLocalProcessContextStore::Get(), &ctx->output);
+  if (predictor == nullptr) {
+    PostReply(ctx);
+    return;
+  }
+
+  // the callback runs on the scheduler threads once the forward is done
+  bool binary = ctx->binary;
+  bool ret = predictor->Forward([predictor, ctx, binary]() {
+    PredictProcessor processor;
+    if (predictor->DeadlineExceeded()) {
+      ctx->output = "[ERROR] forward deadline exceeded.\n";
+    } else {
+      ctx->success = processor.Respond(predictor, binary, &ctx->output);
+    }
+    delete predictor;
+    PostReply(ctx);
+  });
+  if (!ret) {
+    ctx->output = "[ERROR] forward failed.\n";
+    delete predictor;
+    PostReply(ctx);
+  }
+}
+
+void HttpServer::PostReply(RequestContext* ctx) {
+  struct timeval zero = { 0, 0 };
+  if (event_base_once(ctx->base, -1, EV_TIMEOUT, SendReply, ctx, &zero) != 0) {
+    std::cerr << "[ERROR] post reply fail!" << std::endl;
+  }
+}
+
+void HttpServer::SendReply(int fd, short what, void* arg) {
+  RequestContext* ctx = reinterpret_cast<RequestContext*>(arg);
+  evbuffer* buf = evbuffer_new();
+  evbuffer_add(buf, ctx->output.data(), ctx->output.size());
+  if (ctx->success) {
+    evhttp_add_header(evhttp_request_get_output_headers(ctx->req), "Content-Type",
+                      ctx->binary ? kBinaryContentType : kJsonContentType);
+    evhttp_send_reply(ctx->req, HTTP_OK, "OK", buf);
+  } else {
+    std::cerr << "error message: " << ctx->output << std::endl;
+    evhttp_send_reply(ctx->req, HTTP_NOTFOUND, "NotFound", buf);
+  }
+  evbuffer_free(buf);
+  ServingMetrics::Instance()->Record(ServingMetrics::NowMicros() - ctx->start_micros, ctx->success);
+  delete ctx;
+}
+
+int HttpServer::BindSocket(int port, int backlog) {
+  int nfd = socket(AF_INET, SOCK_STREAM, 0);
+  if (nfd < 0) {
+    std::cerr << "[ERROR] socket() fail!" << std::endl;
+    return -1;
+  }
+
+  int one = 1;
+  if (setsockopt(nfd, SOL_SOCKET, SO_REUSEADDR, (char *)&one, sizeof(int)) < 0) {
+    std::cerr << "[ERROR] setsockopt() fail!" << std::endl;
+    close(nfd);
+    return -1;
+  }
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = INADDR_ANY;
+  addr.sin_port = htons(port);
+  if (bind(nfd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    std::cerr << "[ERROR] bind() fail!" << std::endl;
+    close(nfd);
+    return -1;
+  }
+  if (listen(nfd, backlog) < 0) {
+    std::cerr << "[ERROR] listen() fail!" << std::endl;
+    close(nfd);
+    return -1;
+  }
+
+  int flags;
+  if ((flags = fcntl(nfd, F_GETFL, 0)) < 0
+      || fcntl(nfd, F_SETFL, flags | O_NONBLOCK) < 0) {
+    std::cerr << "[ERROR] fcntl() fail!" << std::endl;
+    close(nfd);
+    return -1;
+  }
+  return nfd;
+}
+
+}  // namespace serving
@@ -0,0 +1,62 @@
+/*
+ * \file server.h
+ * \brief The asynchronous http serving frame
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "blaze/common/thread_pool.h"
+#include "predict.pb.h"
+
+struct event_base;
+struct evhttp;
+struct evhttp_request;
+
+namespace serving {
+
+struct RequestContext;
+
+// The IO threads run the evhttp loops on the shared listen socket, and only
+// read the requests and write the replies. The requests are parsed, fed and
+// forwarded on the compute threads, the predictor callback posts the reply
+// back to the loop of its connection, so a slow forward does not stall the
+// other connections of the IO thread. The connections are kept alive for
+// keep_alive_seconds. The payloads of Content-Type application/x-protobuf
+// are binary protobuf, the others json. GET /metrics dumps the metrics.
+class HttpServer {
+ public:
+  explicit HttpServer(const ServerConfig& config);
+  ~HttpServer();
+
+  // Bind the port and start the threads, false if failed
+  bool Start();
+  // Wait the IO threads
+  void Join();
+
+ protected:
+  struct IOThread {
+    event_base* base = nullptr;
+    evhttp* httpd = nullptr;
+    std::thread thread;
+  };
+
+  static void OnRequest(evhttp_request* req, void* arg);
+  // Run on the compute threads
+  void Predict(RequestContext* ctx);
+  // Post the reply to the IO thread of the request
+  static void PostReply(RequestContext* ctx);
+  static void SendReply(int fd, short what, void* arg);
+
+  int BindSocket(int port, int backlog);
+
+  ServerConfig config_;
+  int fd_;
+  std::vector<IOThread> io_threads_;
+  std::unique_ptr<blaze::ThreadExecutor> compute_executor_;
+};
+
+}  // namespace serving
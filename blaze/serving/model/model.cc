@@ -27,9 +27,19 @@ bool Model::Init(const std::string& sparse_model,
 
 Predictor* Model::CreatePredictor( PredictDeviceType device_type,
                                    int device_id) {
-  return pm_.CreatePredictor(device_type, device_id);
+  Predictor* predictor = pm_.CreatePredictor(device_type, device_id);
+  if (predictor != nullptr && !op_latency_observer_.empty()) {
+    predictor->RegisterObservers({ op_latency_observer_ });
+  }
+  return predictor;
 };
 
+bool Model::WarmUp(const std::vector<size_t>& batch_sizes,
+                   const WarmUpFeeder& feeder,
+                   int concurrency) {
+  return pm_.WarmUp(batch_sizes, feeder, concurrency);
+}
+
 
 
 }
@@ -2,6 +2,7 @@
 #define __SERVING_MODEL_H__
 
 #include <string>
+#include <vector>
 
 #include "blaze/api/cpp_api/predictor.h"
 
@@ -24,8 +25,26 @@ public:
   Predictor * CreatePredictor(PredictDeviceType device_type = kPDT_Unkown,
                               int device_id = 0 );
 
+  // Forward the synthetic batches before the model is served
+  bool WarmUp(const std::vector<size_t>& batch_sizes,
+              const WarmUpFeeder& feeder,
+              int concurrency);
+
+  // The model is served only once loaded and warmed up
+  bool ready() const { return ready_; }
+  void set_ready(bool ready) { ready_ = ready; }
+
+  // The predictors sample the op latency of one in sample_rate runs into the
+  // histograms labeled by label, 0 disables it
+  void set_op_latency(int sample_rate, const std::string& label) {
+    op_latency_observer_ = sample_rate > 0 ?
+        "op_latency:" + std::to_string(sample_rate) + ":" + label : "";
+  }
+
 private:
   PredictorManager pm_;
+  bool ready_ = false;
+  std::string op_latency_observer_;
 };
 
 } // namespace serving
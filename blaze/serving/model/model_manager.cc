@@ -1,8 +1,11 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string>
 #include <fcntl.h>
 
 #include "./model_manager.h"
+#include "serving/frame/process.h"
 #include "predict.pb.h"
 #include "google/protobuf/text_format.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
@@ -22,6 +25,7 @@ bool ModelManager::Init(const std::string &config_file) {
   int fd = open(config_file.c_str(), O_RDONLY);
   google::protobuf::io::FileInputStream file_input(fd);
   google::protobuf::TextFormat::Parse(&file_input, &config);
+  server_config_ = config.server();
 
   for(const serving::ModelConfig& model_config: config.models()) {
     Model& model = model_version_map_[model_config.model_version()];
@@ -37,14 +41,69 @@ bool ModelManager::Init(const std::string &config_file) {
         return false;
       };
     }
+    // the warm up runs are not sampled
+    if (!WarmUp(model_config, &model)) {
+      std::cerr << "[Error] warm up <" << model_config.model_version() << "> failed." << std::endl;
+      return false;
+    }
+    model.set_op_latency(model_config.op_latency_sample_rate(), model_config.model_version());
+    model.set_ready(true);
   }
 
   return true;
 }
 
+bool ModelManager::WarmUp(const ModelConfig& model_config, Model* model) {
+  if (!model_config.has_warmup_request()) return true;
+
+  std::ifstream is(model_config.warmup_request());
+  if (!is.good()) {
+    std::cerr << "[Error] open warm up request " << model_config.warmup_request() << " failed." << std::endl;
+    return false;
+  }
+  std::stringstream ss;
+  ss << is.rdbuf();
+  const std::string data = ss.str();
+
+  PredictProcessor processor;
+  Request request;
+  std::string output;
+  if (!processor.ParseRequest(data.data(), data.size(), false, &request, &output)) {
+    std::cerr << "[Error] " << output << std::endl;
+    return false;
+  }
+  if (request.ad_feature_size() == 0) {
+    std::cerr << "[Error] warm up request has no ad_feature." << std::endl;
+    return false;
+  }
+
+  std::vector<size_t> batch_sizes(model_config.warmup_batch_size().begin(),
+                                  model_config.warmup_batch_size().end());
+  if (batch_sizes.empty()) batch_sizes.push_back(request.ad_feature_size());
+
+  // The feeder is called on this thread only
+  ProcessContext process_context;
+  auto feeder = [&](Predictor* predictor, size_t batch_size) {
+    Request batch = request;
+    batch.clear_ad_feature();
+    for (size_t i = 0; i < batch_size; ++i) {
+      *batch.add_ad_feature() = request.ad_feature(i % request.ad_feature_size());
+    }
+    std::string error;
+    if (!processor.Feed(batch, &process_context, predictor, &error)) {
+      std::cerr << "[Error] " << error << std::endl;
+      return false;
+    }
+    return true;
+  };
+  return model->WarmUp(batch_sizes, feeder, model_config.warmup_concurrency());
+}
+
 Predictor* ModelManager::CreatePredictor(const std::string& model_version) {
-  Model& model = model_version_map_[model_version];
-  return model.CreatePredictor();
+  // Read only after Init, the lookups are safe on the compute threads
+  const auto& iter = model_version_map_.find(model_version);
+  if (iter == model_version_map_.end() || !iter->second.ready()) return nullptr;
+  return iter->second.CreatePredictor();
 }
 
 }
@@ -5,6 +5,7 @@
 #include <string>
 
 #include "./model.h"
+#include "predict.pb.h"
 
 
 namespace serving {
@@ -16,9 +17,15 @@ public:
 
 //  bool Release();
 
+  // Return nullptr if the model version is not served
   Predictor* CreatePredictor(const std::string& model_version);
 
+  const ServerConfig& server_config() const { return server_config_; }
+
 private:
+  // Replay the warm up request of the model at its batch sizes
+  bool WarmUp(const ModelConfig& model_config, Model* model);
+
   ModelManager() {};
   virtual ~ModelManager() {};
 
@@ -27,6 +34,7 @@ private:
   ModelManager &operator=(const ModelManager &);
 
   std::map<std::string, Model> model_version_map_;
+  ServerConfig server_config_;
 };
 
 }//namespace serving
@@ -0,0 +1,110 @@
+/*
+ * \file activation_benchmark.cc
+ * \brief The benchmark of the cpu activation kernels against the plain loops
+ *
+ * Usage: activation_benchmark [batch_size] [channels] [iterations]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "blaze/common/timer.h"
+#include "blaze/math/activation_kernel.h"
+
+namespace {
+
+void DiceLoop(const float* x, size_t size, const float* gamma, const float* mean,
+              const float* var, size_t c, float* y) {
+  for (size_t i = 0; i < size; ++i) {
+    size_t k = i % c;
+    float x_normed = (x[i] - mean[k]) / sqrtf(var[k] + 1e-8);
+    float x_p = 1.0 / (1.0 + expf(-x_normed));
+    y[i] = (1 - x_p) * gamma[k] * x[i] + x_p * x[i];
+  }
+}
+
+void PReluLoop(const float* x, size_t size, const float* w, size_t c, float* y) {
+  for (size_t i = 0; i < size; ++i) {
+    y[i] = x[i] * ((x[i] > 0) + ((x[i] < 0) * w[i % c]));
+  }
+}
+
+void BatchNormalizationLoop(const float* x, size_t size, const float* gamma, const float* beta,
+                            const float* mean, const float* var, size_t c, float* y) {
+  for (size_t i = 0; i < size; ++i) {
+    size_t k = i % c;
+    float x_normed = (x[i] - mean[k]) / sqrtf(var[k] + 1e-5);
+    y[i] = gamma[k] * x_normed + beta[k];
+  }
+}
+
+void SoftmaxLoop(const float* x, size_t n, size_t c, float* y) {
+  for (size_t i = 0; i < n; ++i) {
+    float max_value = *std::max_element(x + i * c, x + (i + 1) * c);
+    float sum = 0;
+    for (size_t k = 0; k < c; ++k) {
+      y[i * c + k] = expf(x[i * c + k] - max_value);
+      sum += y[i * c + k];
+    }
+    for (size_t k = 0; k < c; ++k) y[i * c + k] /= sum;
+  }
+}
+
+// The microseconds of each run of func
+double Time(const std::function<void()>& func, int iterations) {
+  func();
+  double start = blaze::GetTime();
+  for (int i = 0; i < iterations; ++i) func();
+  return (blaze::GetTime() - start) * 1e6 / iterations;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t n = argc > 1 ? atoi(argv[1]) : 512;
+  size_t c = argc > 2 ? atoi(argv[2]) : 200;
+  int iterations = argc > 3 ? atoi(argv[3]) : 100;
+  size_t size = n * c;
+
+  std::vector<float> x(size), y(size);
+  std::vector<float> gamma(c), beta(c), mean(c), var(c);
+  for (auto& v : x) v = (rand() % 2000 - 1000) / 100.0;
+  for (size_t k = 0; k < c; ++k) {
+    gamma[k] = rand() % 100 / 100.0;
+    beta[k] = rand() % 100 / 100.0;
+    mean[k] = rand() % 100 / 50.0 - 1;
+    var[k] = rand() % 100 / 20.0 + 0.1;
+  }
+
+  printf("batch_size=%zu channels=%zu iterations=%d\n", n, c, iterations);
+  printf("%-20s %12s %12s\n", "kernel", "loop(us)", "kernel(us)");
+  printf("%-20s %12.2f %12.2f\n", "Dice",
+         Time([&]() { DiceLoop(x.data(), size, gamma.data(), mean.data(), var.data(), c, y.data()); },
+              iterations),
+         Time([&]() {
+                blaze::DiceKernel(x.data(), size, gamma.data(), mean.data(), var.data(), c,
+                                  false, 1e-8, y.data());
+              }, iterations));
+  printf("%-20s %12.2f %12.2f\n", "PRelu",
+         Time([&]() { PReluLoop(x.data(), size, gamma.data(), c, y.data()); }, iterations),
+         Time([&]() { blaze::PReluKernel(x.data(), size, gamma.data(), c, y.data()); },
+              iterations));
+  printf("%-20s %12.2f %12.2f\n", "BatchNormalization",
+         Time([&]() {
+                BatchNormalizationLoop(x.data(), size, gamma.data(), beta.data(), mean.data(),
+                                       var.data(), c, y.data());
+              }, iterations),
+         Time([&]() {
+                blaze::BatchNormalizationKernel(x.data(), size, gamma.data(), beta.data(),
+                                                mean.data(), var.data(), c, false, 1e-5,
+                                                y.data());
+              }, iterations));
+  printf("%-20s %12.2f %12.2f\n", "Softmax",
+         Time([&]() { SoftmaxLoop(x.data(), n, c, y.data()); }, iterations),
+         Time([&]() { blaze::SoftmaxKernel(x.data(), n, c, y.data()); }, iterations));
+  return 0;
+}
@@ -0,0 +1,239 @@
+/*
+ * \file math_benchmark.cc
+ * \brief The microbenchmark of the cpu kernels of blaze/math
+ *
+ * Usage: math_benchmark [filter] [iterations] [--json]
+ *
+ * Runs the kernels whose name contains filter, --json prints a json line per
+ * kernel for the regression tracking instead of the table.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "blaze/common/context.h"
+#include "blaze/common/timer.h"
+#include "blaze/math/binary_search.h"
+#include "blaze/math/broadcast.h"
+#include "blaze/math/float16.h"
+#include "blaze/math/gemm.h"
+#include "blaze/math/reduce.h"
+#include "blaze/math/vml.h"
+
+namespace {
+
+using blaze::CPUContext;
+
+struct Benchmark {
+  std::string name;
+  std::string shape;
+  // the flops of a run, 0 if it is bound by the bytes
+  double flops;
+  // the bytes read and written by a run
+  double bytes;
+  std::function<void()> func;
+};
+
+// The microseconds of each run of func
+double Time(const std::function<void()>& func, int iterations) {
+  func();
+  double start = blaze::GetTime();
+  for (int i = 0; i < iterations; ++i) func();
+  return (blaze::GetTime() - start) * 1e6 / iterations;
+}
+
+std::vector<float> Random(size_t size) {
+  std::vector<float> data(size);
+  for (auto& v : data) v = (rand() % 2000 - 1000) / 1000.0;
+  return data;
+}
+
+std::string Shape(const std::vector<int>& dims) {
+  std::string shape;
+  for (size_t i = 0; i < dims.size(); ++i) {
+    if (i != 0) shape += "x";
+    shape += std::to_string(dims[i]);
+  }
+  return shape;
+}
+
+// The inputs live as long as the benchmarks
+struct Buffers {
+  std::vector<std::vector<float>> floats;
+  std::vector<std::vector<int32_t>> ints;
+  std::vector<std::vector<uint8_t>> uint8s;
+  std::vector<std::vector<int8_t>> int8s;
+  std::vector<std::vector<blaze::float16>> halfs;
+
+  float* Float(size_t size) {
+    floats.push_back(Random(size));
+    return floats.back().data();
+  }
+};
+
+void AddGemm(int M, int N, int K, Buffers* buf, std::vector<Benchmark>* benchmarks) {
+  float* a = buf->Float(M * K);
+  float* b = buf->Float(K * N);
+  float* c = buf->Float(M * N);
+  benchmarks->push_back({ "Gemm", Shape({ M, N, K }), 2.0 * M * N * K,
+                          4.0 * (M * K + K * N + M * N), [=]() {
+    blaze::Gemm<float, CPUContext>(CblasNoTrans, CblasNoTrans, M, N, K, 1.0, a, b, 0, c, nullptr);
+  }});
+  const int batch = 8;
+  float* ba = buf->Float(batch * M * K);
+  float* bc = buf->Float(batch * M * N);
+  benchmarks->push_back({ "GemmStridedBatched", Shape({ batch, M, N, K }),
+                          2.0 * batch * M * N * K, 4.0 * batch * (M * K + M * N) + 4.0 * K * N,
+                          [=]() {
+    blaze::GemmStridedBatched<float, CPUContext>(CblasNoTrans, CblasNoTrans, M, N, K, 1.0,
+                                                 ba, M * K, b, 0, 0, bc, M * N, batch, nullptr);
+  }});
+  float* x = buf->Float(K);
+  float* y = buf->Float(N);
+  float* bt = buf->Float(N * K);
+  benchmarks->push_back({ "Gemv", Shape({ N, K }), 2.0 * N * K, 4.0 * (N * K + N + K), [=]() {
+    blaze::Gemv<float, CPUContext>(CblasNoTrans, N, K, 1.0, bt, x, 0, y, nullptr);
+  }});
+
+  buf->uint8s.push_back(std::vector<uint8_t>(M * K, 100));
+  buf->int8s.push_back(std::vector<int8_t>(K * N, -50));
+  buf->ints.push_back(std::vector<int32_t>(M * N));
+  const uint8_t* qa = buf->uint8s.back().data();
+  const int8_t* qb = buf->int8s.back().data();
+  int32_t* qc = buf->ints.back().data();
+  benchmarks->push_back({ "GemmU8S8", Shape({ M, N, K }), 2.0 * M * N * K,
+                          1.0 * (M * K + K * N) + 4.0 * M * N, [=]() {
+    blaze::GemmU8S8<CPUContext>(CblasNoTrans, M, N, K, qa, qb, qc, nullptr);
+  }});
+
+  // 4x1 blocks at half and a quarter of the blocks
+  for (int keep : { 2, 4 }) {
+    const int block_k = 4;
+    std::vector<int32_t> col_ptr(1, 0), row_idx;
+    for (int j = 0; j < N; ++j) {
+      for (int r = 0; r < K / block_k; r += keep) row_idx.push_back(r);
+      col_ptr.push_back(row_idx.size());
+    }
+    buf->ints.push_back(col_ptr);
+    const int32_t* cp = buf->ints.back().data();
+    buf->ints.push_back(row_idx);
+    const int32_t* ri = buf->ints.back().data();
+    float* values = buf->Float(row_idx.size() * block_k);
+    double nnz = row_idx.size() * block_k;
+    benchmarks->push_back({ "GemmBlockSparse", Shape({ M, N, K }) + "/" + std::to_string(keep),
+                            2.0 * M * nnz, 4.0 * (M * K + M * N + nnz), [=]() {
+      blaze::GemmBlockSparse<CPUContext>(M, N, K, block_k, 1, 1.0, a, cp, ri, values, 0, c,
+                                         nullptr);
+    }});
+  }
+}
+
+void AddElementwise(int size, Buffers* buf, std::vector<Benchmark>* benchmarks) {
+  float* a = buf->Float(size);
+  float* b = buf->Float(size);
+  float* y = buf->Float(size);
+  std::string shape = Shape({ size });
+  const std::vector<std::pair<std::string, void (*)(int, const float*, float*, CPUContext*)>>
+      unary = {
+    { "VML_Exp", &blaze::VML_Exp<float, CPUContext> },
+    { "VML_Log", &blaze::VML_Log<float, CPUContext> },
+    { "VML_Tanh", &blaze::VML_Tanh<float, CPUContext> },
+    { "VML_Sqrt", &blaze::VML_Sqrt<float, CPUContext> },
+    { "VML_Abs", &blaze::VML_Abs<float, CPUContext> },
+  };
+  for (const auto& kernel : unary) {
+    auto func = kernel.second;
+    benchmarks->push_back({ kernel.first, shape, 0, 8.0 * size, [=]() {
+      func(size, a, y, nullptr);
+    }});
+  }
+  const std::vector<std::pair<std::string,
+      void (*)(int, const float*, const float*, float*, CPUContext*)>> binary = {
+    { "VML_Add", &blaze::VML_Add<float, CPUContext> },
+    { "VML_Mul", &blaze::VML_Mul<float, CPUContext> },
+    { "VML_Div", &blaze::VML_Div<float, CPUContext> },
+  };
+  for (const auto& kernel : binary) {
+    auto func = kernel.second;
+    benchmarks->push_back({ kernel.first, shape, 0, 12.0 * size, [=]() {
+      func(size, a, b, y, nullptr);
+    }});
+  }
+
+  buf->halfs.push_back(std::vector<blaze::float16>(size));
+  blaze::float16* h = buf->halfs.back().data();
+  benchmarks->push_back({ "VML_Set<float16,float>", shape, 0, 6.0 * size, [=]() {
+    blaze::VML_Set<blaze::float16, float, CPUContext>(size, h, a, nullptr);
+  }});
+
+  const int dim = 64;
+  benchmarks->push_back({ "ReduceSum", Shape({ size / dim, dim }), 0, 4.0 * size, [=]() {
+    blaze::ReduceSum<float, CPUContext>(a, size / dim, dim, 1, y, nullptr);
+  }});
+  float* bias = buf->Float(dim);
+  std::vector<blaze::TIndex> y_shape = { size / dim, dim };
+  std::vector<blaze::TIndex> x_shape = { dim };
+  benchmarks->push_back({ "DimEqualBroadcastAssign", Shape({ size / dim, dim }), 0,
+                          4.0 * size, [=]() {
+    blaze::DimEqualBroadcastAssign<float, CPUContext>(y, y_shape, bias, x_shape, nullptr);
+  }});
+
+  float* sorted = buf->Float(size);
+  std::sort(sorted, sorted + size);
+  const int keys = 1024;
+  float* key = buf->Float(keys);
+  float* result = buf->Float(keys);
+  benchmarks->push_back({ "BinarySearch", Shape({ size, keys }), 0, 8.0 * keys, [=]() {
+    blaze::BinarySearch<float>(sorted, size, key, keys, result);
+  }});
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* filter = "";
+  int iterations = 100;
+  bool json = false;
+  int positional = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else if (positional++ == 0) {
+      filter = argv[i];
+    } else {
+      iterations = atoi(argv[i]);
+    }
+  }
+
+  Buffers buf;
+  std::vector<Benchmark> benchmarks;
+  AddGemm(128, 256, 512, &buf, &benchmarks);
+  AddGemm(512, 1024, 1024, &buf, &benchmarks);
+  AddElementwise(1 << 16, &buf, &benchmarks);
+  AddElementwise(1 << 20, &buf, &benchmarks);
+
+  if (!json) {
+    printf("iterations=%d\n", iterations);
+    printf("%-28s %-20s %12s %10s %10s\n", "kernel", "shape", "time(us)", "GFlops", "GB/s");
+  }
+  for (const auto& benchmark : benchmarks) {
+    if (strstr(benchmark.name.c_str(), filter) == nullptr) continue;
+    double micros = Time(benchmark.func, iterations);
+    double gflops = benchmark.flops / micros * 1e-3;
+    double gbps = benchmark.bytes / micros * 1e-3;
+    if (json) {
+      printf("{\"kernel\":\"%s\",\"shape\":\"%s\",\"iterations\":%d,\"micros\":%.3f,"
+             "\"gflops\":%.3f,\"gbps\":%.3f}\n", benchmark.name.c_str(),
+             benchmark.shape.c_str(), iterations, micros, gflops, gbps);
+    } else {
+      printf("%-28s %-20s %12.2f %10.2f %10.2f\n", benchmark.name.c_str(),
+             benchmark.shape.c_str(), micros, gflops, gbps);
+    }
+  }
+  return 0;
+}
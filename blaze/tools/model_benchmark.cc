@@ -0,0 +1,379 @@
+/*
+ * \file model_benchmark.cc
+ * \brief The latency and throughput benchmark of a model
+ *
+ * Usage: model_benchmark --model=FILE [--data=FILE] [--type=blaze] [--sparse=URI]
+ *          [--batch_sizes=1,16,128] [--threads=1,4] [--devices=cpu,cuda]
+ *          [--iterations=100] [--warmup=10] [--dense_dim=1] [--dense_dims=name:dim,...]
+ *          [--ids=1] [--profile] [--output=FILE]
+ *
+ * The inputs are synthetic: the per ad (level 0) inputs have batch_size rows
+ * and the common ones a single row, of ids sparse ids or of the dense dim.
+ * Each configuration of device, batch size and thread number prints a json
+ * line of the forward latency percentiles, the qps, the peak memory and,
+ * with --profile, the average micros of each op of an extra profiled run,
+ * which is appended to the output file for the regression tracking.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef USE_CUDA
+#include <cuda_runtime.h>
+#endif
+
+#include "blaze/api/cpp_api/predictor.h"
+#include "blaze/common/timer.h"
+
+namespace {
+
+struct Options {
+  std::string model;
+  std::string data;
+  std::string type = "blaze";
+  std::string sparse;
+  std::vector<size_t> batch_sizes = { 1, 16, 128 };
+  std::vector<size_t> threads = { 1 };
+  std::vector<std::string> devices = { "cpu" };
+  int iterations = 100;
+  int warmup = 10;
+  size_t dense_dim = 1;
+  std::unordered_map<std::string, size_t> dense_dims;
+  size_t ids = 1;
+  bool profile = false;
+  std::string output;
+};
+
+std::vector<std::string> Split(const std::string& str, char sep) {
+  std::vector<std::string> items;
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, sep)) {
+    if (!item.empty()) items.push_back(item);
+  }
+  return items;
+}
+
+std::vector<size_t> SplitSize(const std::string& str) {
+  std::vector<size_t> values;
+  for (const auto& item : Split(str, ',')) values.push_back(atol(item.c_str()));
+  return values;
+}
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    size_t pos = arg.find('=');
+    std::string key = arg.substr(0, pos);
+    std::string value = pos == std::string::npos ? "" : arg.substr(pos + 1);
+    if (key == "--model") options->model = value;
+    else if (key == "--data") options->data = value;
+    else if (key == "--type") options->type = value;
+    else if (key == "--sparse") options->sparse = value;
+    else if (key == "--batch_sizes") options->batch_sizes = SplitSize(value);
+    else if (key == "--threads") options->threads = SplitSize(value);
+    else if (key == "--devices") options->devices = Split(value, ',');
+    else if (key == "--iterations") options->iterations = atoi(value.c_str());
+    else if (key == "--warmup") options->warmup = atoi(value.c_str());
+    else if (key == "--dense_dim") options->dense_dim = atol(value.c_str());
+    else if (key == "--ids") options->ids = atol(value.c_str());
+    else if (key == "--profile") options->profile = true;
+    else if (key == "--output") options->output = value;
+    else if (key == "--dense_dims") {
+      for (const auto& item : Split(value, ',')) {
+        size_t colon = item.rfind(':');
+        if (colon == std::string::npos) return false;
+        options->dense_dims[item.substr(0, colon)] = atol(item.substr(colon + 1).c_str());
+      }
+    } else {
+      fprintf(stderr, "unknown option %s\n", arg.c_str());
+      return false;
+    }
+  }
+  return !options->model.empty() && options->iterations > 0;
+}
+
+bool LoadModel(const Options& options, blaze::PredictorManager* pm) {
+  static const std::map<std::string, blaze::ModelType> kModelType = {
+    { "blaze", blaze::kBlaze }, { "ulf", blaze::kUlf }, { "onnx", blaze::kOnnx },
+    { "xdl", blaze::kXDL }, { "xdl_ulf", blaze::kXDLUlf },
+  };
+  auto iter = kModelType.find(options.type);
+  if (iter == kModelType.end()) {
+    fprintf(stderr, "unknown model type %s\n", options.type.c_str());
+    return false;
+  }
+  if (!options.sparse.empty() && !pm->LoadSparseModelWeight(options.sparse.c_str())) {
+    fprintf(stderr, "load sparse model weight %s failed\n", options.sparse.c_str());
+    return false;
+  }
+  if (iter->second == blaze::kBlaze) return pm->LoadModel(options.model.c_str());
+  return pm->LoadModel(options.model.c_str(), options.data.c_str(), iter->second);
+}
+
+// The synthetic inputs of a batch, kept until the forwards are done
+class SyntheticBatch {
+ public:
+  SyntheticBatch(const Options& options, size_t batch_size) :
+      options_(options), batch_size_(batch_size) { }
+
+  bool Feed(blaze::Predictor* predictor) {
+    for (const auto& name : predictor->ListInputName()) {
+      blaze::FeedNameConfig config = predictor->GetFeedNameConfig(name);
+      size_t rows = config.level == 0 ? batch_size_ : 1;
+      bool ret = true;
+      switch (config.feature_type) {
+        case blaze::kDenseFeature:
+          {
+            auto iter = options_.dense_dims.find(name);
+            size_t dim = iter == options_.dense_dims.end() ? options_.dense_dim : iter->second;
+            const auto& value = Floats(rows * dim, 0.5);
+            ret = predictor->ReshapeInput(name.c_str(), { rows, dim }) &&
+                predictor->Feed(name.c_str(), value.data(), value.size() * sizeof(float));
+          }
+          break;
+        case blaze::kSparseFeature:
+          ret = FeedSparse(name, config.sparse_feature_type, rows, predictor);
+          break;
+        case blaze::kAuxIndicator:
+          {
+            const auto& indicator = Ints(batch_size_, 0);
+            ret = predictor->ReshapeInput(name.c_str(), { indicator.size() }) &&
+                predictor->Feed(name.c_str(), indicator.data(),
+                                indicator.size() * sizeof(int32_t));
+          }
+          break;
+      }
+      if (!ret) {
+        fprintf(stderr, "feed %s failed\n", name.c_str());
+        return false;
+      }
+    }
+    return true;
+  }
+
+ protected:
+  bool FeedSparse(const std::string& name, blaze::SparseFeatureType type, size_t rows,
+                  blaze::Predictor* predictor) {
+    size_t num = rows * options_.ids;
+    switch (type) {
+      case blaze::kSparseFeatureId:
+        {
+          std::vector<int64_t>& ids = ids_[num];
+          if (ids.empty()) {
+            for (size_t i = 0; i < num; ++i) ids.push_back(rand() % 1000000);
+          }
+          return predictor->ReshapeInput(name.c_str(), { num }) &&
+              predictor->Feed(name.c_str(), ids.data(), num * sizeof(int64_t));
+        }
+      case blaze::kSparseFeatureValue:
+        {
+          const auto& values = Floats(num, 1.0);
+          return predictor->ReshapeInput(name.c_str(), { num }) &&
+              predictor->Feed(name.c_str(), values.data(), num * sizeof(float));
+        }
+      case blaze::kAuxSparseFeatureSegment:
+        {
+          const auto& segments = Ints(rows, options_.ids);
+          return predictor->ReshapeInput(name.c_str(), { rows }) &&
+              predictor->Feed(name.c_str(), segments.data(), rows * sizeof(int32_t));
+        }
+    }
+    return false;
+  }
+
+  const std::vector<float>& Floats(size_t size, float value) {
+    std::vector<float>& data = floats_[std::make_pair(size, value)];
+    data.resize(size, value);
+    return data;
+  }
+  const std::vector<int32_t>& Ints(size_t size, int32_t value) {
+    std::vector<int32_t>& data = ints_[std::make_pair(size, value)];
+    data.resize(size, value);
+    return data;
+  }
+
+  const Options& options_;
+  size_t batch_size_;
+  std::map<size_t, std::vector<int64_t>> ids_;
+  std::map<std::pair<size_t, float>, std::vector<float>> floats_;
+  std::map<std::pair<size_t, int32_t>, std::vector<int32_t>> ints_;
+};
+
+struct Result {
+  std::vector<double> latency_micros;
+  double elapsed_seconds = 0;
+  bool success = true;
+  std::string ops;
+};
+
+// The peak resident memory of the process in MB
+double MaxRssMB() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0;
+}
+
+// The used memory of the current gpu in MB, 0 without gpu
+double GpuUsedMB() {
+#ifdef USE_CUDA
+  size_t free_bytes = 0, total_bytes = 0;
+  if (cudaMemGetInfo(&free_bytes, &total_bytes) == cudaSuccess) {
+    return (total_bytes - free_bytes) / (1024.0 * 1024.0);
+  }
+#endif
+  return 0;
+}
+
+// The placement observer dump, of lines "name device micros input output",
+// as a json array of the average micros of the ops
+std::string OpsJson(const std::string& dump) {
+  std::stringstream in(dump);
+  std::stringstream out;
+  std::string line;
+  out << "[";
+  bool first = true;
+  while (std::getline(in, line)) {
+    std::stringstream ls(line);
+    std::string name;
+    int device;
+    double micros;
+    if (!(ls >> name >> device >> micros)) continue;
+    if (!first) out << ",";
+    first = false;
+    out << "{\"name\":\"" << name << "\",\"device\":" << device << ",\"micros\":" << micros << "}";
+  }
+  out << "]";
+  return out.str();
+}
+
+Result Run(const Options& options, blaze::PredictorManager* pm,
+           blaze::PredictDeviceType device, size_t batch_size, size_t thread_num) {
+  std::vector<Result> results(thread_num);
+  std::vector<std::thread> threads;
+  double start = 0;
+  for (size_t t = 0; t < thread_num; ++t) {
+    threads.emplace_back([&, t]() {
+      Result& result = results[t];
+      std::unique_ptr<blaze::Predictor> predictor(pm->CreatePredictor(device));
+      SyntheticBatch batch(options, batch_size);
+      if (predictor == nullptr || !batch.Feed(predictor.get())) {
+        result.success = false;
+        return;
+      }
+      for (int i = 0; i < options.warmup; ++i) predictor->Forward();
+      double begin = blaze::GetTime();
+      for (int i = 0; i < options.iterations; ++i) {
+        double forward_start = blaze::GetTime();
+        if (!predictor->Forward()) {
+          result.success = false;
+          return;
+        }
+        result.latency_micros.push_back((blaze::GetTime() - forward_start) * 1e6);
+      }
+      result.elapsed_seconds = blaze::GetTime() - begin;
+
+      // the observers slow down the forward, so they run once afterwards
+      if (options.profile && t == 0) {
+        predictor->RegisterObservers({ "placement" });
+        predictor->Forward();
+        std::unordered_map<std::string, std::string> dump;
+        predictor->DumpObservers(&dump);
+        result.ops = OpsJson(dump["placement"]);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  Result ret;
+  for (auto& result : results) {
+    ret.success = ret.success && result.success;
+    ret.latency_micros.insert(ret.latency_micros.end(), result.latency_micros.begin(),
+                              result.latency_micros.end());
+    ret.elapsed_seconds = std::max(ret.elapsed_seconds, result.elapsed_seconds);
+    if (!result.ops.empty()) ret.ops = result.ops;
+  }
+  return ret;
+}
+
+double Percentile(std::vector<double>* values, double p) {
+  if (values->empty()) return 0;
+  size_t idx = std::min(values->size() - 1, static_cast<size_t>(p * values->size()));
+  std::nth_element(values->begin(), values->begin() + idx, values->end());
+  return (*values)[idx];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) {
+    fprintf(stderr, "Usage: %s --model=FILE [--data=FILE] [--type=blaze|ulf|onnx|xdl|xdl_ulf] "
+            "[--sparse=URI] [--batch_sizes=1,16,128] [--threads=1,4] [--devices=cpu,cuda] "
+            "[--iterations=100] [--warmup=10] [--dense_dim=1] [--dense_dims=name:dim,...] "
+            "[--ids=1] [--profile] [--output=FILE]\n", argv[0]);
+    return 1;
+  }
+  size_t max_threads = *std::max_element(options.threads.begin(), options.threads.end());
+  blaze::InitScheduler(false, 1000, 100, max_threads, max_threads, 2);
+
+  blaze::PredictorManager pm;
+  if (!LoadModel(options, &pm)) {
+    fprintf(stderr, "load model %s failed\n", options.model.c_str());
+    return 1;
+  }
+  FILE* output = nullptr;
+  if (!options.output.empty()) {
+    output = fopen(options.output.c_str(), "a");
+    if (output == nullptr) {
+      fprintf(stderr, "open %s failed\n", options.output.c_str());
+      return 1;
+    }
+  }
+
+  int ret = 0;
+  for (const auto& device_name : options.devices) {
+    blaze::PredictDeviceType device = device_name == "cuda" ? blaze::kPDT_CUDA : blaze::kPDT_CPU;
+    for (auto batch_size : options.batch_sizes) {
+      for (auto thread_num : options.threads) {
+        Result result = Run(options, &pm, device, batch_size, thread_num);
+        if (!result.success) {
+          fprintf(stderr, "run %s batch_size=%zu threads=%zu failed\n",
+                  device_name.c_str(), batch_size, thread_num);
+          ret = 1;
+          continue;
+        }
+        double requests = static_cast<double>(result.latency_micros.size());
+        double mean = 0;
+        for (auto micros : result.latency_micros) mean += micros;
+        mean /= requests;
+
+        std::stringstream ss;
+        ss << "{\"model\":\"" << options.model << "\",\"type\":\"" << options.type
+           << "\",\"device\":\"" << device_name << "\",\"batch_size\":" << batch_size
+           << ",\"threads\":" << thread_num << ",\"iterations\":" << options.iterations
+           << ",\"mean_us\":" << mean
+           << ",\"p50_us\":" << Percentile(&result.latency_micros, 0.5)
+           << ",\"p99_us\":" << Percentile(&result.latency_micros, 0.99)
+           << ",\"qps\":" << requests / result.elapsed_seconds
+           << ",\"samples_per_sec\":" << requests * batch_size / result.elapsed_seconds
+           << ",\"max_rss_mb\":" << MaxRssMB() << ",\"gpu_used_mb\":" << GpuUsedMB();
+        if (!result.ops.empty()) ss << ",\"ops\":" << result.ops;
+        ss << "}";
+        printf("%s\n", ss.str().c_str());
+        if (output != nullptr) fprintf(output, "%s\n", ss.str().c_str());
+      }
+    }
+  }
+  if (output != nullptr) fclose(output);
+  return ret;
+}
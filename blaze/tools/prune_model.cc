@@ -0,0 +1,39 @@
+/*
+ * \file prune_model.cc
+ * \brief The offline pruning of the gemm weights of a blaze model
+ *
+ * Usage: prune_model input_model output_model [pattern] [ratio] [min_size]
+ *
+ * The pattern is "RxC" blocks (default 4x1) or "N:M" (e.g. 2:4), the pruned
+ * gemms are rewritten to SparseGemm by the SparseGemmPass on loading.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "blaze/common/proto_helper.h"
+#include "blaze/optimizer/passes/sparse_gemm_pass.h"
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    printf("Usage: %s input_model output_model [pattern] [ratio] [min_size]\n", argv[0]);
+    return 1;
+  }
+  std::string pattern = argc > 3 ? argv[3] : "4x1";
+  float ratio = argc > 4 ? atof(argv[4]) : 0.5;
+  size_t min_size = argc > 5 ? atol(argv[5]) : 64 * 64;
+
+  blaze::NetDef net_def;
+  if (!blaze::NetDefHelper::LoadNetDefFromBinaryFile(argv[1], &net_def)) {
+    printf("load %s failed\n", argv[1]);
+    return 1;
+  }
+  int pruned = blaze::SparseGemmPass::PruneNet(&net_def, pattern, ratio, min_size);
+  printf("pruned %d gemms to %s, ratio=%.2f\n", pruned, pattern.c_str(), ratio);
+  if (!blaze::NetDefHelper::SaveNetDefToBinaryFile(argv[2], &net_def)) {
+    printf("save %s failed\n", argv[2]);
+    return 1;
+  }
+  return 0;
+}
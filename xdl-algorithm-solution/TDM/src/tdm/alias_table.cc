@@ -0,0 +1,76 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Copyright 2018 Alibaba Inc. All Rights Reserved.
+
+#include "tdm/alias_table.h"
+
+namespace tdm {
+
+AliasTable::AliasTable() {
+}
+
+void AliasTable::Init(const std::vector<float>& weights) {
+  size_t n = weights.size();
+  prob_.assign(n, 1);
+  alias_.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    alias_[i] = i;
+  }
+
+  double sum = 0;
+  for (size_t i = 0; i < n; ++i) {
+    sum += weights[i];
+  }
+  if (n == 0 || sum <= 0) {
+    return;
+  }
+
+  // scaled to the mean 1, split into the columns under and over it
+  std::vector<double> scaled(n);
+  std::vector<int> small;
+  std::vector<int> large;
+  for (size_t i = 0; i < n; ++i) {
+    scaled[i] = weights[i] * n / sum;
+    if (scaled[i] < 1) {
+      small.push_back(i);
+    } else {
+      large.push_back(i);
+    }
+  }
+
+  while (!small.empty() && !large.empty()) {
+    int s = small.back();
+    small.pop_back();
+    int l = large.back();
+    prob_[s] = scaled[s];
+    alias_[s] = l;
+    scaled[l] -= 1 - scaled[s];
+    if (scaled[l] < 1) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+
+  // the rest are 1 up to the rounding
+  for (auto it = large.begin(); it != large.end(); ++it) {
+    prob_[*it] = 1;
+  }
+  for (auto it = small.begin(); it != small.end(); ++it) {
+    prob_[*it] = 1;
+  }
+}
+
+}  // namespace tdm
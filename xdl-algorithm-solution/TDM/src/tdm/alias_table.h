@@ -0,0 +1,60 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Copyright 2018 Alibaba Inc. All Rights Reserved.
+
+#ifndef TDM_ALIAS_TABLE_H_
+#define TDM_ALIAS_TABLE_H_
+
+#include <stdint.h>
+
+#include <random>
+#include <vector>
+
+namespace tdm {
+
+// Walker alias table, samples an index by its weight in O(1)
+class AliasTable {
+ public:
+  AliasTable();
+
+  // Build by the weights, the indices weighted 0 are never sampled,
+  // and all the indices are equally likely if the weights sum to 0
+  void Init(const std::vector<float>& weights);
+
+  size_t size() const {
+    return prob_.size();
+  }
+
+  // 0 if the table is empty
+  template <class RNG>
+  int Sample(RNG& rng) const {
+    if (prob_.empty()) {
+      return 0;
+    }
+    std::uniform_int_distribution<int> column(0, prob_.size() - 1);
+    std::uniform_real_distribution<float> coin(0, 1);
+    int i = column(rng);
+    return coin(rng) < prob_[i] ? i : alias_[i];
+  }
+
+ private:
+  std::vector<float> prob_;
+  std::vector<int> alias_;
+};
+
+}  // namespace tdm
+
+#endif  // TDM_ALIAS_TABLE_H_
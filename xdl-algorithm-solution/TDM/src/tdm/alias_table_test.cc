@@ -0,0 +1,56 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Copyright 2018 Alibaba Inc. All Rights Reserved.
+
+#include "tdm/alias_table.h"
+
+#include "gtest/gtest.h"
+
+namespace tdm {
+
+TEST(AliasTable, TestSample) {
+  AliasTable table;
+  table.Init({1, 0, 3, 4});
+  ASSERT_EQ(4ul, table.size());
+
+  std::mt19937 rng(0);
+  std::vector<int> counts(4, 0);
+  int sample_num = 80000;
+  for (int i = 0; i < sample_num; ++i) {
+    ++counts[table.Sample(rng)];
+  }
+
+  ASSERT_EQ(0, counts[1]);
+  ASSERT_NEAR(0.125, counts[0] * 1.0 / sample_num, 0.01);
+  ASSERT_NEAR(0.375, counts[2] * 1.0 / sample_num, 0.01);
+  ASSERT_NEAR(0.5, counts[3] * 1.0 / sample_num, 0.01);
+}
+
+TEST(AliasTable, TestZeroWeights) {
+  AliasTable table;
+  std::mt19937 rng(0);
+  ASSERT_EQ(0, table.Sample(rng));
+
+  table.Init({0, 0});
+  std::vector<int> counts(2, 0);
+  for (int i = 0; i < 1000; ++i) {
+    ++counts[table.Sample(rng)];
+  }
+  ASSERT_GT(counts[0], 0);
+  ASSERT_GT(counts[1], 0);
+}
+
+}  // namespace tdm
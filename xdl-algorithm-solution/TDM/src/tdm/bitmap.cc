@@ -24,13 +24,34 @@ limitations under the License.
 
 namespace tdm {
 
-Bitmap::Bitmap(): data_(NULL), capacity_(0) {
+Bitmap::Bitmap(): data_(NULL), capacity_(0), attached_(false) {
 }
 
-Bitmap::Bitmap(const std::string& filename): data_(NULL), capacity_(0) {
+Bitmap::Bitmap(const std::string& filename)
+    : data_(NULL), capacity_(0), attached_(false) {
   Load(filename);
 }
 
+Bitmap::~Bitmap() {
+  Release();
+}
+
+void Bitmap::Release() {
+  if (!attached_) {
+    free(data_);
+  }
+  data_ = NULL;
+  capacity_ = 0;
+  attached_ = false;
+}
+
+void Bitmap::Attach(const void* data, size_t bytes) {
+  Release();
+  data_ = const_cast<void*>(data);
+  capacity_ = bytes;
+  attached_ = true;
+}
+
 bool Bitmap::Load(const std::string& filename) {
   FILE* fp = fopen(filename.c_str(), "r");
   if (fp == NULL) {
@@ -48,59 +69,72 @@ bool Bitmap::Load(const std::string& filename) {
     return false;
   }
 
-  data_ = malloc(file_len);
-  if (data_ == NULL) {
+  // padded to the words tested
+  size_t cap = (file_len + 7) / 8 * 8;
+  void* data = calloc(cap > 0 ? cap : 8, 1);
+  if (data == NULL) {
     fclose(fp);
     return false;
   }
 
   fseek(fp, 0, SEEK_SET);
-  if (fread(data_, 1, file_len, fp) < file_len) {
-    free(data_);
+  if (fread(data, 1, file_len, fp) < static_cast<size_t>(file_len)) {
+    free(data);
     fclose(fp);
     return false;
   }
 
-  capacity_ = file_len;
+  Release();
+  data_ = data;
+  capacity_ = cap;
   fclose(fp);
   return true;
 }
 
-bool Bitmap::is_filtered(size_t index) const {
-  if (data_ == NULL || index >= capacity_) {
+bool Bitmap::Reset(size_t size) {
+  size_t cap = (size + 63) / 64 * 8;
+  void* data = calloc(cap > 0 ? cap : 8, 1);
+  if (data == NULL) {
     return false;
   }
-  uint64_t* ptr = reinterpret_cast<uint64_t*>(data_);
-  uint64_t mask = 1;
-  mask <<= index % 64;
-  return ptr[index / 64] & mask;
+  Release();
+  data_ = data;
+  capacity_ = cap;
+  return true;
 }
 
-bool Bitmap::set_filter(size_t index, bool filter) {
-  if (index >= capacity_) {
-    size_t cap = 1;
-    while (cap <= index) {
+bool Bitmap::set(size_t index, bool value) {
+  if (attached_) {
+    return false;
+  }
+  if (index >= capacity_ * 8) {
+    if (!value) {
+      return true;
+    }
+
+    size_t cap = 8;
+    while (cap * 8 <= index) {
       cap <<= 1;
     }
 
-    void* new_data = NULL;
-    if ((new_data = malloc(cap)) == NULL) {
+    void* new_data = calloc(cap, 1);
+    if (new_data == NULL) {
       return false;
     }
 
     if (data_ != NULL && capacity_ > 0) {
       memcpy(new_data, data_, capacity_);
     }
+    Release();
     data_ = new_data;
     capacity_ = cap;
-    free(data_);
   }
 
   uint64_t* ptr = reinterpret_cast<uint64_t*>(data_);
   uint64_t mask = 1;
   mask <<= index % 64;
 
-  if (filter) {
+  if (value) {
     ptr[index / 64] |= mask;
   } else {
     ptr[index / 64] &= ~mask;
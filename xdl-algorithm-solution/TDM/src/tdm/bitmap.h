@@ -18,25 +18,62 @@ limitations under the License.
 #ifndef TDM_BITMAP_H_
 #define TDM_BITMAP_H_
 
+#include <stdint.h>
 #include <stdio.h>
 
 #include <string>
 
 namespace tdm {
 
+// The bits of the indices, those beyond the capacity are clear
 class Bitmap {
  public:
   Bitmap();
   explicit Bitmap(const std::string& filename);
+  ~Bitmap();
 
   bool Load(const std::string& filename);
-  bool is_filtered(size_t index) const;
-  bool set_filter(size_t index, bool filter);
+  // Clear the bitmap to hold bits of the indices below size
+  bool Reset(size_t size);
+  // Read the bits of data of bytes, a multiple of 8, which outlives the
+  // bitmap and is not set
+  void Attach(const void* data, size_t bytes);
+
+  const void* data() const {
+    return data_;
+  }
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+  bool test(size_t index) const {
+    if (index >= capacity_ * 8) {
+      return false;
+    }
+    const uint64_t* ptr = reinterpret_cast<const uint64_t*>(data_);
+    return (ptr[index / 64] >> (index % 64)) & 1;
+  }
+  bool set(size_t index, bool value);
+
+  bool is_filtered(size_t index) const {
+    return test(index);
+  }
+  bool set_filter(size_t index, bool filter) {
+    return set(index, filter);
+  }
   bool save(const char* filename) const;
 
  private:
+  void Release();
+
+  Bitmap(const Bitmap&) = delete;
+  Bitmap& operator=(const Bitmap&) = delete;
+
+  // the bytes of data_, a multiple of 8
   void* data_;
   size_t capacity_;
+  bool attached_;
 };
 
 }  // namespace tdm
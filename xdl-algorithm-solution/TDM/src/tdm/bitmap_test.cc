@@ -54,4 +54,19 @@ TEST(Bitmap, TestSave) {
   ASSERT_TRUE(bitmap.is_filtered(5000));
 }
 
+TEST(Bitmap, TestReset) {
+  Bitmap bitmap;
+  ASSERT_TRUE(bitmap.set(70000, true));
+  ASSERT_TRUE(bitmap.Reset(100));
+  ASSERT_FALSE(bitmap.test(70000));
+  for (size_t i = 0; i < 100; i += 3) {
+    ASSERT_TRUE(bitmap.set(i, true));
+  }
+  for (size_t i = 0; i < 200; ++i) {
+    ASSERT_EQ(i < 100 && i % 3 == 0, bitmap.test(i));
+  }
+  ASSERT_TRUE(bitmap.set(99, false));
+  ASSERT_FALSE(bitmap.test(99));
+}
+
 }  // namespace tdm
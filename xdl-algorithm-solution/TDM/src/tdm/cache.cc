@@ -22,6 +22,9 @@ limitations under the License.
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#include <functional>
 
 namespace tdm {
 
@@ -75,4 +78,173 @@ void LRUCache::Clear() {
 void LRUCache::Destroy() {
 }
 
+const int ShardedCache::kDefaultShardNum;
+const int ShardedCache::kDefaultSlotBytes;
+
+ShardedCache::ShardedCache(): Cache(), slot_bytes_(0), hits_(0), misses_(0) {
+}
+
+ShardedCache::ShardedCache(int nkb)
+    : Cache(nkb), slot_bytes_(0), hits_(0), misses_(0) {
+  Init(nkb);
+}
+
+ShardedCache::~ShardedCache() {
+  Destroy();
+}
+
+bool ShardedCache::Init(int nkb) {
+  return Init(nkb, kDefaultShardNum, kDefaultSlotBytes);
+}
+
+bool ShardedCache::Init(int nkb, int shard_num, int slot_bytes) {
+  if (initialized_) {
+    return true;
+  }
+  if (nkb <= 0 || shard_num <= 0 || slot_bytes <= 0) {
+    return false;
+  }
+
+  size_in_kbytes_ = nkb;
+  slot_bytes_ = slot_bytes;
+  size_t slot_num = static_cast<size_t>(nkb) * 1024 / slot_bytes / shard_num;
+  if (slot_num == 0) {
+    slot_num = 1;
+  }
+
+  shards_.resize(shard_num);
+  for (int i = 0; i < shard_num; ++i) {
+    Shard* shard = new Shard();
+    shard->index.reserve(slot_num);
+    Slot empty = {"", 0, false, false, 0};
+    shard->slots.assign(slot_num, empty);
+    shard->slab.resize(slot_num * slot_bytes);
+    shard->hand = 0;
+    shards_[i] = shard;
+  }
+
+  initialized_ = true;
+  return true;
+}
+
+ShardedCache::Shard* ShardedCache::GetShard(const std::string& key) const {
+  return shards_[std::hash<std::string>()(key) % shards_.size()];
+}
+
+int ShardedCache::Evict(Shard* shard) const {
+  // a referenced slot is passed once, so a full round finds a victim
+  while (true) {
+    size_t i = shard->hand;
+    shard->hand = (shard->hand + 1) % shard->slots.size();
+    Slot& slot = shard->slots[i];
+    if (!slot.used) {
+      return i;
+    }
+    if (slot.referenced) {
+      slot.referenced = false;
+      continue;
+    }
+    shard->index.erase(slot.key);
+    slot.used = false;
+    return i;
+  }
+}
+
+bool ShardedCache::Get(const std::string& key, std::string* value) const {
+  if (value == NULL || !initialized_) {
+    return false;
+  }
+
+  Shard* shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard->mutex);
+  auto it = shard->index.find(key);
+  if (it == shard->index.end()) {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  Slot& slot = shard->slots[it->second];
+  if (slot.expire_time != 0 && slot.expire_time <= time(NULL)) {
+    shard->index.erase(it);
+    slot.used = false;
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  slot.referenced = true;
+  value->assign(shard->slab.data() + it->second * slot_bytes_, slot.size);
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool ShardedCache::Put(const std::string& key, const std::string& value) {
+  return Put(key, value, 0);
+}
+
+bool ShardedCache::Put(const std::string& key,
+                       const std::string& value, int expire) {
+  if (!initialized_ || value.size() > static_cast<size_t>(slot_bytes_)) {
+    return false;
+  }
+
+  Shard* shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard->mutex);
+  int i = 0;
+  auto it = shard->index.find(key);
+  if (it != shard->index.end()) {
+    i = it->second;
+  } else {
+    i = Evict(shard);
+    shard->index.insert(std::make_pair(key, i));
+  }
+
+  Slot& slot = shard->slots[i];
+  slot.key = key;
+  slot.size = value.size();
+  slot.used = true;
+  slot.referenced = false;
+  slot.expire_time = expire > 0 ? time(NULL) + expire : 0;
+  memcpy(shard->slab.data() + i * slot_bytes_, value.data(), value.size());
+  return true;
+}
+
+bool ShardedCache::Remove(const std::string& key) {
+  if (!initialized_) {
+    return false;
+  }
+
+  Shard* shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard->mutex);
+  auto it = shard->index.find(key);
+  if (it == shard->index.end()) {
+    return false;
+  }
+  shard->slots[it->second].used = false;
+  shard->index.erase(it);
+  return true;
+}
+
+void ShardedCache::Clear() {
+  for (auto it = shards_.begin(); it != shards_.end(); ++it) {
+    Shard* shard = *it;
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->index.clear();
+    for (auto sit = shard->slots.begin(); sit != shard->slots.end(); ++sit) {
+      sit->used = false;
+      sit->referenced = false;
+    }
+    shard->hand = 0;
+  }
+  hits_.store(0, std::memory_order_relaxed);
+  misses_.store(0, std::memory_order_relaxed);
+}
+
+void ShardedCache::Destroy() {
+  for (auto it = shards_.begin(); it != shards_.end(); ++it) {
+    delete *it;
+  }
+  shards_.clear();
+  initialized_ = false;
+}
+
 }  // namespace tdm
@@ -18,7 +18,12 @@ limitations under the License.
 #ifndef TDM_CACHE_H_
 #define TDM_CACHE_H_
 
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace tdm {
@@ -67,6 +72,72 @@ class LRUCache: public Cache {
   void Destroy() override;
 };
 
+// The cache split into shards by the key hash, each shard locks alone and
+// keeps the values in a slab of fixed size slots evicted by CLOCK, so that
+// the concurrent lookups rarely contend and the cache never allocates
+// after Init. A value larger than a slot is not cached.
+class ShardedCache: public Cache {
+ public:
+  static const int kDefaultShardNum = 64;
+  static const int kDefaultSlotBytes = 512;
+
+  ShardedCache();
+  explicit ShardedCache(int nkb);
+  virtual ~ShardedCache();
+
+  // nkb is the total slab size of the shards
+  bool Init(int nkb) override;
+  bool Init(int nkb, int shard_num, int slot_bytes);
+
+  bool Get(const std::string& key, std::string* value) const override;
+  bool Put(const std::string& key, const std::string& value) override;
+  // expire is the seconds the value lives, never expires if <= 0
+  bool Put(const std::string& key,
+           const std::string& value, int expire) override;
+  bool Remove(const std::string& key) override;
+  void Clear() override;
+  void Destroy() override;
+
+  uint64_t hits() const {
+    return hits_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t misses() const {
+    return misses_.load(std::memory_order_relaxed);
+  }
+
+  int shard_num() const {
+    return static_cast<int>(shards_.size());
+  }
+
+ private:
+  struct Slot {
+    std::string key;
+    uint32_t size;
+    bool used;
+    bool referenced;
+    int64_t expire_time;  // 0 is never
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, int> index;
+    std::vector<Slot> slots;
+    std::vector<char> slab;
+    size_t hand;
+  };
+
+  Shard* GetShard(const std::string& key) const;
+  // The slot to put a new key in shard, evicts the one it holds.
+  // The caller holds shard->mutex.
+  int Evict(Shard* shard) const;
+
+  int slot_bytes_;
+  std::vector<Shard*> shards_;
+  mutable std::atomic<uint64_t> hits_;
+  mutable std::atomic<uint64_t> misses_;
+};
+
 }  // namespace tdm
 
 #endif  // TDM_CACHE_H_
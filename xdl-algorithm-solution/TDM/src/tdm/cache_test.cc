@@ -0,0 +1,93 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Copyright 2018 Alibaba Inc. All Rights Reserved.
+
+#include "tdm/cache.h"
+
+#include <thread>
+
+#include "gtest/gtest.h"
+
+namespace tdm {
+
+TEST(ShardedCache, TestPutGet) {
+  ShardedCache cache;
+  ASSERT_TRUE(cache.Init(1, 2, 64));
+  ASSERT_EQ(2, cache.shard_num());
+
+  std::string value;
+  ASSERT_FALSE(cache.Get("key", &value));
+  ASSERT_TRUE(cache.Put("key", "value"));
+  ASSERT_TRUE(cache.Get("key", &value));
+  ASSERT_EQ("value", value);
+  ASSERT_TRUE(cache.Put("key", "value2"));
+  ASSERT_TRUE(cache.Get("key", &value));
+  ASSERT_EQ("value2", value);
+  ASSERT_EQ(2ul, cache.hits());
+  ASSERT_EQ(1ul, cache.misses());
+
+  // larger than a slot
+  ASSERT_FALSE(cache.Put("big", std::string(65, 'x')));
+
+  ASSERT_TRUE(cache.Remove("key"));
+  ASSERT_FALSE(cache.Get("key", &value));
+  ASSERT_FALSE(cache.Remove("key"));
+}
+
+TEST(ShardedCache, TestEvict) {
+  // 16 slots in one shard
+  ShardedCache cache;
+  ASSERT_TRUE(cache.Init(1, 1, 64));
+
+  std::string value;
+  for (int i = 0; i < 16; ++i) {
+    ASSERT_TRUE(cache.Put(std::to_string(i), std::to_string(i)));
+  }
+  // referenced keys survive a round of the clock
+  ASSERT_TRUE(cache.Get("0", &value));
+  ASSERT_TRUE(cache.Put("16", "16"));
+  ASSERT_TRUE(cache.Get("0", &value));
+  ASSERT_FALSE(cache.Get("1", &value));
+  ASSERT_TRUE(cache.Get("16", &value));
+  ASSERT_EQ("16", value);
+
+  cache.Clear();
+  ASSERT_FALSE(cache.Get("16", &value));
+}
+
+TEST(ShardedCache, TestConcurrent) {
+  ShardedCache cache(64);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(std::thread([&cache, t]() {
+      std::string value;
+      for (int i = 0; i < 10000; ++i) {
+        std::string key = std::to_string(t * 10000 + i % 100);
+        if (!cache.Get(key, &value)) {
+          cache.Put(key, key);
+        } else {
+          ASSERT_EQ(key, value);
+        }
+      }
+    }));
+  }
+  for (auto it = threads.begin(); it != threads.end(); ++it) {
+    it->join();
+  }
+  ASSERT_EQ(40000ul, cache.hits() + cache.misses());
+}
+
+}  // namespace tdm
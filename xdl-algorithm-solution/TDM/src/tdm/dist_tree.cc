@@ -17,11 +17,19 @@ limitations under the License.
 
 #include "tdm/dist_tree.h"
 
+#include <dirent.h>
+#include <fcntl.h>
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <set>
 #include <thread>
 
@@ -34,17 +42,56 @@ namespace tdm {
 
 DistTree DistTree::instance_;
 
+namespace {
+
+const char kSharedMagic[8] = {'T', 'D', 'M', 'T', 'R', 'E', 'E', '1'};
+
+struct SharedHeader {
+  char magic[8];
+  uint64_t version;
+  int64_t max_code;
+  int64_t internal_id_start;
+  int64_t leaf_count;
+  int64_t max_level;
+  int64_t branch;
+};
+
+size_t Align8(size_t size) {
+  return (size + 7) & ~static_cast<size_t>(7);
+}
+
+// FNV-1a
+uint64_t Hash(const std::string& data, uint64_t hash) {
+  for (size_t i = 0; i < data.size(); ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+}  // namespace
+
 DistTree::DistTree(): key_prefix_(), branch_(2), store_(NULL),
-                      initialized_(false), max_level_(0) {
+                      initialized_(false), max_level_(0), compact_(false),
+                      code_ids_(NULL), code_probs_(NULL), version_(0),
+                      shared_data_(NULL), shared_length_(0),
+                      shared_leaves_(NULL), shared_leaf_count_(0) {
 }
 
 DistTree::DistTree(const std::string& key_prefix,
                    int branch, Store* store)
     : key_prefix_(key_prefix), branch_(branch), store_(store),
-      initialized_(false), max_level_(0) {
+      initialized_(false), max_level_(0), compact_(false),
+      code_ids_(NULL), code_probs_(NULL), version_(0),
+      shared_data_(NULL), shared_length_(0),
+      shared_leaves_(NULL), shared_leaf_count_(0) {
   Load();
 }
 
+DistTree::~DistTree() {
+  ReleaseShared();
+}
+
 Store* DistTree::store() const {
   return store_;
 }
@@ -75,9 +122,17 @@ int DistTree::max_level() const {
 }
 
 bool DistTree::Load() {
+  ReleaseShared();
   initialized_ = false;
   max_level_ = 0;
   id_code_map_.clear();
+  code_bits_.Reset(0);
+  compact_ = false;
+  compact_ids_.clear();
+  compact_probs_.clear();
+  code_ids_ = NULL;
+  code_probs_ = NULL;
+  version_ = 0;
 
   if (store_ == NULL) {
     std::cerr << "Failed to load tree, store is null" << std::endl;
@@ -97,6 +152,7 @@ bool DistTree::Load() {
     std::cerr << "Parse meta failed" << std::endl;
     return false;
   }
+  version_ = Hash(meta_value, Hash(key_prefix_, 14695981039346656037ULL));
 
   max_level_ = meta.max_level();
   int64_t max_leaf_id = -1;
@@ -116,7 +172,6 @@ bool DistTree::Load() {
     for (auto iit = part.id_code_list().begin();
          iit != part.id_code_list().end(); ++iit) {
       id_code_map_.insert(std::make_pair(iit->id(), iit->code()));
-      codes_.insert(iit->code());
       if (max_leaf_id < iit->id()) {
         max_leaf_id = iit->id();
       }
@@ -126,6 +181,31 @@ bool DistTree::Load() {
     }
   }
 
+  // the leaves mark the nodes of the left deep paths ending at them,
+  // those of the codes past the last level hold nothing
+  size_t max_key_no = 0;
+  for (int i = 0; i < max_level_; ++i) {
+    max_key_no = max_key_no * branch_ + 1;
+  }
+  if (!code_bits_.Reset(max_code_ + 1)) {
+    std::cerr << "Allocate the code bits failed" << std::endl;
+    return false;
+  }
+  for (auto it = id_code_map_.begin(); it != id_code_map_.end(); ++it) {
+    size_t code = it->second;
+    if (it->second < 0 || code >= max_key_no || code_bits_.test(code)) {
+      continue;
+    }
+    code_bits_.set(code, true);
+    while (code > 0 && (code - 1) % branch_ == 0) {
+      code = (code - 1) / branch_;
+      if (code_bits_.test(code)) {
+        break;
+      }
+      code_bits_.set(code, true);
+    }
+  }
+
   internal_id_start_ = max_leaf_id + 1;
   std::cout << "Load successfully, leaf node count:"
             << id_code_map_.size() << ", internal node id start: "
@@ -408,6 +488,14 @@ int DistTree::NodeLevel(size_t key_no) const {
   return level;
 }
 
+void DistTree::RemoveFiltered(std::vector<int64_t>* codes) const {
+  auto end = std::remove_if(codes->begin(), codes->end(),
+                            [this](int64_t code) {
+    return code < 0 || IsFiltered(code);
+  });
+  codes->erase(end, codes->end());
+}
+
 bool DistTree::KeyExists(const std::string& key) const {
   if (key.size() != key_prefix_.size() + sizeof(size_t)) {
     return false;
@@ -432,13 +520,39 @@ std::string DistTree::MakeKey(size_t key_no) const {
   return key;
 }
 
+bool DistTree::LeafCode(int64_t id, int64_t* code) const {
+  if (shared_leaves_ == NULL) {
+    auto it = id_code_map_.find(id);
+    if (it == id_code_map_.end()) {
+      return false;
+    }
+    *code = it->second;
+    return true;
+  }
+
+  size_t low = 0;
+  size_t high = shared_leaf_count_;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (shared_leaves_[2 * mid] < id) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if (low == shared_leaf_count_ || shared_leaves_[2 * low] != id) {
+    return false;
+  }
+  *code = shared_leaves_[2 * low + 1];
+  return true;
+}
+
 int64_t DistTree::NodeIdToCode(int64_t id) {
   int64_t code = -1;
   if (initialized_) {
     if (id < internal_id_start_) {
-      auto it = id_code_map_.find(id);
-      if (it != id_code_map_.end()) {
-        code = it->second;
+      if (!LeafCode(id, &code)) {
+        code = -1;
       }
     } else {
       code = id - internal_id_start_;
@@ -605,9 +719,8 @@ std::vector<int64_t> DistTree::NodeIdToCode(const std::vector<int64_t>& ids) {
   if (initialized_) {
     for (size_t i = 0; i < ids.size(); ++i) {
       if (ids[i] < internal_id_start_) {
-        auto it = id_code_map_.find(ids[i]);
-        if (it != id_code_map_.end()) {
-          codes[i] = it->second;
+        if (!LeafCode(ids[i], &codes[i])) {
+          codes[i] = -1;
         }
       } else {
         codes[i] = ids[i] - internal_id_start_;
@@ -676,6 +789,274 @@ DistTree::NodeByCode(const std::vector<int64_t>& codes) {
   return nodes;
 }
 
+////////////////////////// Compact operation //////////////////////
+
+bool DistTree::BuildCompact() {
+  if (!initialized_) {
+    std::cerr << "Failed to build compact tree, tree is not loaded"
+              << std::endl;
+    return false;
+  }
+  if (compact_) {
+    return true;
+  }
+
+  size_t node_count = static_cast<size_t>(max_code_ + 1);
+  compact_ids_.assign(node_count, -1);
+  compact_probs_.assign(node_count, 0);
+
+  std::vector<std::string> keys;
+  std::vector<size_t> key_nos;
+  keys.reserve(kBatchSize);
+  key_nos.reserve(kBatchSize);
+  size_t valid_count = 0;
+  for (size_t key_no = 0; key_no < node_count; ++key_no) {
+    if (!IsFiltered(key_no)) {
+      keys.push_back(MakeKey(key_no));
+      key_nos.push_back(key_no);
+    }
+    if (keys.size() >= kBatchSize || key_no + 1 == node_count) {
+      std::vector<std::string> values = BatchGet(keys);
+      for (size_t i = 0; i < keys.size(); ++i) {
+        tdm::Node node;
+        if (node.ParseFromString(values[i])) {
+          compact_ids_[key_nos[i]] = node.id();
+          compact_probs_[key_nos[i]] = node.probality();
+          ++valid_count;
+        }
+      }
+      keys.clear();
+      key_nos.clear();
+    }
+  }
+
+  code_ids_ = compact_ids_.data();
+  code_probs_ = compact_probs_.data();
+  compact_ = true;
+  std::cout << "Build compact tree successfully, node count: "
+            << valid_count << std::endl;
+  return true;
+}
+
+bool DistTree::compact() const {
+  return compact_;
+}
+
+bool DistTree::ShareCompact(const std::string& dir) {
+  if (!initialized_) {
+    std::cerr << "Failed to share compact tree, tree is not loaded"
+              << std::endl;
+    return false;
+  }
+  if (shared()) {
+    return true;
+  }
+
+  char version[32];
+  snprintf(version, sizeof(version), "%016llx",
+           static_cast<unsigned long long>(version_));
+  std::string name = key_prefix_.empty() ? "tdm_tree" : key_prefix_;
+  std::string path = dir + "/" + name + "." + version + ".compact";
+  if (AttachShared(path)) {
+    return true;
+  }
+
+  // the processes of the host race to build the file, the first one
+  // holding the lock writes it and the others map it afterwards
+  std::string lock_path = path + ".lock";
+  int lock_fd = open(lock_path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (lock_fd < 0) {
+    std::cerr << "Open lock " << lock_path << " failed" << std::endl;
+    return false;
+  }
+  if (flock(lock_fd, LOCK_EX) != 0) {
+    std::cerr << "Lock " << lock_path << " failed" << std::endl;
+    close(lock_fd);
+    return false;
+  }
+
+  bool ret = AttachShared(path);
+  if (!ret) {
+    ret = BuildCompact() && WriteShared(path) && AttachShared(path);
+    if (ret) {
+      // the files of the older versions of the tree
+      std::string prefix = name + ".";
+      DIR* dp = opendir(dir.c_str());
+      if (dp != NULL) {
+        struct dirent* entry = NULL;
+        while ((entry = readdir(dp)) != NULL) {
+          std::string file = entry->d_name;
+          if (file.size() == prefix.size() + 16 + 8 &&
+              file.compare(0, prefix.size(), prefix) == 0 &&
+              file.compare(file.size() - 8, 8, ".compact") == 0 &&
+              file != name + "." + version + ".compact") {
+            unlink((dir + "/" + file).c_str());
+            unlink((dir + "/" + file + ".lock").c_str());
+          }
+        }
+        closedir(dp);
+      }
+    }
+  }
+
+  flock(lock_fd, LOCK_UN);
+  close(lock_fd);
+  if (ret) {
+    std::cout << "Share compact tree successfully, file: " << path
+              << std::endl;
+  }
+  return ret;
+}
+
+bool DistTree::WriteShared(const std::string& path) const {
+  std::vector<std::pair<int64_t, int64_t> > leaves(id_code_map_.begin(),
+                                                   id_code_map_.end());
+  std::sort(leaves.begin(), leaves.end());
+
+  size_t node_count = compact_ids_.size();
+  SharedHeader header;
+  memcpy(header.magic, kSharedMagic, sizeof(kSharedMagic));
+  header.version = version_;
+  header.max_code = max_code_;
+  header.internal_id_start = internal_id_start_;
+  header.leaf_count = leaves.size();
+  header.max_level = max_level_;
+  header.branch = branch_;
+
+  std::string tmp_path = path + ".tmp";
+  FILE* fp = fopen(tmp_path.c_str(), "wb");
+  if (fp == NULL) {
+    std::cerr << "Open " << tmp_path << " failed" << std::endl;
+    return false;
+  }
+  const char padding[8] = {0};
+  size_t probs_bytes = node_count * sizeof(float);
+  bool ret =
+      fwrite(&header, sizeof(header), 1, fp) == 1 &&
+      fwrite(compact_ids_.data(), sizeof(int64_t), node_count, fp)
+          == node_count &&
+      fwrite(compact_probs_.data(), sizeof(float), node_count, fp)
+          == node_count &&
+      fwrite(padding, 1, Align8(probs_bytes) - probs_bytes, fp)
+          == Align8(probs_bytes) - probs_bytes &&
+      fwrite(code_bits_.data(), 1, code_bits_.capacity(), fp)
+          == code_bits_.capacity() &&
+      fwrite(padding, 1, Align8(code_bits_.capacity()) - code_bits_.capacity(),
+             fp) == Align8(code_bits_.capacity()) - code_bits_.capacity();
+  for (size_t i = 0; ret && i < leaves.size(); ++i) {
+    int64_t pair[2] = {leaves[i].first, leaves[i].second};
+    ret = fwrite(pair, sizeof(pair), 1, fp) == 1;
+  }
+  ret = fclose(fp) == 0 && ret;
+  if (!ret || rename(tmp_path.c_str(), path.c_str()) != 0) {
+    std::cerr << "Write " << path << " failed" << std::endl;
+    unlink(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool DistTree::AttachShared(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(SharedHeader)) {
+    close(fd);
+    return false;
+  }
+  size_t length = st.st_size;
+  void* data = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+
+  const SharedHeader* header = reinterpret_cast<const SharedHeader*>(data);
+  size_t node_count = static_cast<size_t>(header->max_code + 1);
+  size_t ids_bytes = node_count * sizeof(int64_t);
+  size_t probs_bytes = Align8(node_count * sizeof(float));
+  size_t bits_bytes = Align8(code_bits_.capacity());
+  size_t leaves_bytes = header->leaf_count * 2 * sizeof(int64_t);
+  if (memcmp(header->magic, kSharedMagic, sizeof(kSharedMagic)) != 0 ||
+      header->version != version_ || header->max_code != max_code_ ||
+      header->internal_id_start != internal_id_start_ ||
+      header->branch != branch_ ||
+      length != sizeof(SharedHeader) + ids_bytes + probs_bytes +
+                bits_bytes + leaves_bytes) {
+    munmap(data, length);
+    return false;
+  }
+
+  const char* ptr = reinterpret_cast<const char*>(data) + sizeof(SharedHeader);
+  code_ids_ = reinterpret_cast<const int64_t*>(ptr);
+  ptr += ids_bytes;
+  code_probs_ = reinterpret_cast<const float*>(ptr);
+  ptr += probs_bytes;
+  code_bits_.Attach(ptr, code_bits_.capacity());
+  ptr += bits_bytes;
+  shared_leaves_ = reinterpret_cast<const int64_t*>(ptr);
+  shared_leaf_count_ = header->leaf_count;
+  shared_data_ = data;
+  shared_length_ = length;
+
+  // the private copies are read from the mapping from now on
+  std::unordered_map<int64_t, int64_t>().swap(id_code_map_);
+  std::vector<int64_t>().swap(compact_ids_);
+  std::vector<float>().swap(compact_probs_);
+  compact_ = true;
+  return true;
+}
+
+void DistTree::ReleaseShared() {
+  if (shared_data_ == NULL) {
+    return;
+  }
+  code_bits_.Reset(0);
+  munmap(shared_data_, shared_length_);
+  shared_data_ = NULL;
+  shared_length_ = 0;
+  shared_leaves_ = NULL;
+  shared_leaf_count_ = 0;
+  code_ids_ = NULL;
+  code_probs_ = NULL;
+  compact_ = false;
+}
+
+void DistTree::AncestorCodes(int64_t code,
+                             std::vector<int64_t>* codes) const {
+  codes->clear();
+  if (code <= 0 || IsFiltered(code)) {
+    return;
+  }
+
+  while (code != 0) {
+    codes->push_back(code);
+    code = (code - 1) / branch_;
+  }
+}
+
+int64_t DistTree::NeighborCode(int64_t code, int index) const {
+  if (code <= 0) {
+    return -1;
+  }
+
+  int64_t start = 0;
+  while (code != 0) {
+    code = (code - 1) / branch_;
+    start = start * branch_ + 1;
+  }
+
+  int64_t end = start * branch_ + 1;
+  start += index;
+  if (start >= end || IsFiltered(start)) {
+    return -1;
+  }
+  return start;
+}
+
 ////////////////////////// Level operation ////////////////////////
 
 DistTree::Iterator::Iterator():
@@ -855,21 +1236,41 @@ DistTree::Iterator DistTree::LevelEnd(int level) {
 
 std::vector<std::string>
 DistTree::BatchGet(const std::vector<std::string>& keys) const {
-  std::vector<std::string> values;
+  // the ancestors and the neighbors of a batch share many keys, each unique
+  // key is got once, by MGet rounds of kBatchSize keys
+  std::vector<const std::string*> unique_keys;
+  std::vector<size_t> key_index(keys.size());
+  std::unordered_map<std::string, size_t> unique_index;
+  unique_keys.reserve(keys.size());
+  unique_index.reserve(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    auto ret = unique_index.insert(std::make_pair(keys[i],
+                                                  unique_keys.size()));
+    if (ret.second) {
+      unique_keys.push_back(&keys[i]);
+    }
+    key_index[i] = ret.first->second;
+  }
+
+  std::vector<std::string> unique_values;
+  unique_values.reserve(unique_keys.size());
   std::vector<std::string> round_keys;
-  for (auto it = keys.begin(); it != keys.end(); ++it) {
-    round_keys.push_back(*it);
-    if (round_keys.size() >= kBatchSize) {
+  round_keys.reserve(std::min(kBatchSize, unique_keys.size()));
+  for (size_t i = 0; i < unique_keys.size(); ++i) {
+    round_keys.push_back(*unique_keys[i]);
+    if (round_keys.size() >= kBatchSize || i + 1 == unique_keys.size()) {
       std::vector<std::string> round_values(round_keys.size());
       store_->MGet(round_keys, &round_values);
-      values.insert(values.end(), round_values.begin(), round_values.end());
+      for (auto it = round_values.begin(); it != round_values.end(); ++it) {
+        unique_values.push_back(std::move(*it));
+      }
       round_keys.clear();
     }
   }
-  if (!round_keys.empty()) {
-    std::vector<std::string> round_values(round_keys.size());
-    store_->MGet(round_keys, &round_values);
-    values.insert(values.end(), round_values.begin(), round_values.end());
+
+  std::vector<std::string> values(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    values[i] = unique_values[key_index[i]];
   }
   return values;
 }
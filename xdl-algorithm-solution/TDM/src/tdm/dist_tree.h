@@ -24,6 +24,7 @@ limitations under the License.
 #include <unordered_map>
 #include <unordered_set>
 
+#include "tdm/bitmap.h"
 #include "tdm/store.h"
 
 namespace tdm {
@@ -43,6 +44,7 @@ class DistTree {
   DistTree();
   DistTree(const std::string& key_prefix,
            int branch, Store* store);
+  ~DistTree();
 
   bool Load();
   void Persist(int level);  // Persist [0, level) top layer
@@ -107,20 +109,56 @@ class DistTree {
   SelectNeighbors(const std::vector<TreeNode>& nodes,
                   const std::vector<std::vector<int> >& sels);
 
+  // Whether the tree does not hold the node of key_no, a node is held if
+  // a leaf is on its left deep path
   inline bool IsFiltered(size_t key_no) const {
-    size_t max_key_no = 0;
-    for (int i = 0; i < max_level_; ++i) {
-      max_key_no = max_key_no * branch_ + 1;
-    }
+    return !code_bits_.test(key_no);
+  }
 
-    while (key_no < max_key_no) {
-      if (codes_.find(key_no) != codes_.end()) {
-        return false;
-      }
-      key_no = key_no * branch_ + 1;  // Left deep
-    }
+  // Remove the codes the tree does not hold from codes, in order
+  void RemoveFiltered(std::vector<int64_t>* codes) const;
+
+  ////////////////// Compact Operation ///////////////////////
+
+  // Load the node payloads of the store snapshot into flat arrays indexed
+  // by the node code, so that the sampling resolves the nodes without the
+  // string keys, the store lookups and the proto parses. The store path is
+  // only used to build them, and the tree is read only afterwards.
+  bool BuildCompact();
+  bool compact() const;
+
+  // Share the compact tree with the processes of the host through the
+  // file dir/<key_prefix>.<version>.compact, the version being the hash of
+  // the tree meta, so that an updated tree gets a file of its own. The
+  // first process builds the file under a file lock, the others map it read
+  // only. Once mapped, the leaf codes, the node payloads and the code bits
+  // are read from the file, the private copies are dropped, and the files
+  // of the older versions are unlinked.
+  bool ShareCompact(const std::string& dir);
+  bool shared() const {
+    return shared_data_ != NULL;
+  }
+
+  // The code operations below require compact(), and a code the tree
+  // does not hold is -1
+  int64_t ParentCode(int64_t code) const {
+    return code <= 0 ? -1 : (code - 1) / branch_;
+  }
 
-    return true;
+  // The codes from code up to the level 1 without the root as AncestorKeys,
+  // empty if the code is not in the tree
+  void AncestorCodes(int64_t code, std::vector<int64_t>* codes) const;
+
+  // The code of the index-th node of the level of code
+  int64_t NeighborCode(int64_t code, int index) const;
+
+  // The node payloads, -1 and 0 if the node value fails to parse
+  int64_t CodeId(int64_t code) const {
+    return IsFiltered(code) ? -1 : code_ids_[code];
+  }
+
+  float CodeProbality(int64_t code) const {
+    return IsFiltered(code) ? 0 : code_probs_[code];
   }
 
   ////////////////// Level Operation /////////////////////////
@@ -194,6 +232,14 @@ class DistTree {
 
   std::vector<std::string> BatchGet(const std::vector<std::string>& keys) const;
 
+  // The code of the leaf of id, false if the tree does not hold it
+  bool LeafCode(int64_t id, int64_t* code) const;
+
+  bool WriteShared(const std::string& path) const;
+  // Map the file of path, false if it is absent or of another version
+  bool AttachShared(const std::string& path);
+  void ReleaseShared();
+
  private:
   std::string key_prefix_;
   int branch_;
@@ -201,9 +247,23 @@ class DistTree {
   bool initialized_;
   int max_level_;
   std::unordered_map<int64_t, int64_t> id_code_map_;
-  std::unordered_set<int64_t> codes_;
+  // the bit of a code set if the tree holds its node, marked once by Load
+  Bitmap code_bits_;
   int64_t internal_id_start_;
   int64_t max_code_;
+  bool compact_;
+  std::vector<int64_t> compact_ids_;
+  std::vector<float> compact_probs_;
+  // the payloads read, those of compact_ids_ and compact_probs_ or mapped
+  const int64_t* code_ids_;
+  const float* code_probs_;
+  // the hash of the tree meta loaded
+  uint64_t version_;
+  void* shared_data_;
+  size_t shared_length_;
+  // the pairs of (id, code) of the leaves sorted by the id, once mapped
+  const int64_t* shared_leaves_;
+  size_t shared_leaf_count_;
   static DistTree instance_;
 };
 
@@ -0,0 +1,47 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Copyright 2018 Alibaba Inc. All Rights Reserved.
+
+#include <stdio.h>
+
+#include <string>
+
+#include "tdm/tree_builder.h"
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "%s <items> <tree_data> [config]\n", argv[0]);
+    return 1;
+  }
+
+  tdm::TreeBuilder builder;
+  if (!builder.Init(argc > 3 ? argv[3] : "")) {
+    return 2;
+  }
+  if (!builder.LoadItems(argv[1])) {
+    fprintf(stderr, "Load items failed!\n");
+    return 3;
+  }
+  if (!builder.Build()) {
+    fprintf(stderr, "Build tree failed!\n");
+    return 4;
+  }
+  if (!builder.Dump(argv[2])) {
+    fprintf(stderr, "Dump tree failed!\n");
+    return 5;
+  }
+  return 0;
+}
@@ -201,6 +201,54 @@ TEST(DistTree, TestSelectNeighbors) {
   ASSERT_EQ(MakeKey("root", 92), neighbors[3].key);
 }
 
+class CountStore: public MockStore {
+ public:
+  CountStore(): mget_keys(0) {
+  }
+
+  std::vector<bool> MGet(const std::vector<std::string>& keys,
+                         std::vector<std::string>* values) override {
+    mget_keys += keys.size();
+    return MockStore::MGet(keys, values);
+  }
+
+  size_t mget_keys;
+};
+
+TEST(DistTree, TestRemoveFiltered) {
+  MockStore store;
+  DistTree tree("root", 2, &store);
+  // the leaves 1024 until 2048 at the last level, and their left ancestors
+  std::vector<int64_t> codes = {-1, 0, 1, 2, 511, 1023, 1024, 2047, 2048,
+                                1 << 20, (1 << 18) * 2 - 1};
+  tree.RemoveFiltered(&codes);
+  std::vector<int64_t> expected = {0, 1, 2, 511, 1023, 1024, 2047};
+  ASSERT_EQ(expected, codes);
+  ASSERT_FALSE(tree.IsFiltered(0));
+  ASSERT_TRUE(tree.IsFiltered(1 << 20));
+}
+
+TEST(DistTree, TestBatchDedup) {
+  CountStore store;
+  DistTree tree("root", 2, &store);
+
+  std::vector<TreeNode> nodes;
+  nodes.push_back(tree.Node(MakeKey("root", 1500)));
+  nodes.push_back(tree.Node(MakeKey("root", 1499)));
+  nodes.push_back(tree.Node(MakeKey("root", 1500)));
+  store.mget_keys = 0;
+  auto ancestors = tree.Ancestors(nodes);
+  ASSERT_EQ(3ul, ancestors.size());
+  ASSERT_EQ(10ul, ancestors[0].size());
+  ASSERT_EQ(ancestors[0].size(), ancestors[2].size());
+  for (size_t i = 0; i < ancestors[0].size(); ++i) {
+    ASSERT_EQ(ancestors[0][i].key, ancestors[0][i].value);
+    ASSERT_EQ(ancestors[0][i].value, ancestors[2][i].value);
+  }
+  // the silbings 1499 and 1500 share the ancestors
+  ASSERT_EQ(11ul, store.mget_keys);
+}
+
 TEST(DistTree, TestBuild) {
   LocalStore store;
   ASSERT_TRUE(store.Init(""));
@@ -302,4 +350,76 @@ TEST(DistTree, TesLevelTraverse) {
   }
 }
 
+TEST(DistTree, TestCompact) {
+  LocalStore store;
+  ASSERT_TRUE(store.Init(""));
+  store.LoadData("local_store.pb");
+  DistTree tree("root", 2, &store);
+  ASSERT_TRUE(tree.BuildCompact());
+  ASSERT_TRUE(tree.compact());
+
+  TreeNode node = tree.Node(tree.MakeKey(600000));
+  ASSERT_TRUE(tree.Valid(node));
+  std::vector<TreeNode> ancestors = tree.Ancestors(node);
+  std::vector<int64_t> codes;
+  tree.AncestorCodes(600000, &codes);
+  ASSERT_EQ(ancestors.size(), codes.size());
+  for (size_t i = 0; i < codes.size(); ++i) {
+    ASSERT_EQ(tree.KeyNo(ancestors[i].key), codes[i]);
+    Node n;
+    ASSERT_TRUE(n.ParseFromString(ancestors[i].value));
+    ASSERT_EQ(n.id(), tree.CodeId(codes[i]));
+  }
+  ASSERT_EQ(tree.KeyNo(tree.Parent(node).key), tree.ParentCode(600000));
+
+  std::vector<int> indice = {1, 3, 5};
+  std::vector<TreeNode> neighbors = tree.SelectNeighbors(node, indice);
+  ASSERT_EQ(indice.size(), neighbors.size());
+  for (size_t i = 0; i < indice.size(); ++i) {
+    ASSERT_EQ(tree.KeyNo(neighbors[i].key),
+              tree.NeighborCode(600000, indice[i]));
+  }
+
+  ASSERT_EQ(-1, tree.CodeId(1 << 20));
+  ASSERT_EQ(-1, tree.NeighborCode(600000, 1 << 20));
+}
+
+TEST(DistTree, TestShareCompact) {
+  LocalStore store;
+  ASSERT_TRUE(store.Init(""));
+  store.LoadData("local_store.pb");
+  DistTree tree("root", 2, &store);
+  ASSERT_TRUE(tree.BuildCompact());
+
+  // the first one writes the file, the second one maps it
+  DistTree writer("root", 2, &store);
+  ASSERT_TRUE(writer.ShareCompact("."));
+  ASSERT_TRUE(writer.shared());
+  DistTree reader("root", 2, &store);
+  ASSERT_TRUE(reader.ShareCompact("."));
+  ASSERT_TRUE(reader.shared());
+  ASSERT_TRUE(reader.compact());
+
+  for (int64_t code = 0; code < (1 << 21); code += 997) {
+    ASSERT_EQ(tree.IsFiltered(code), reader.IsFiltered(code));
+    ASSERT_EQ(tree.CodeId(code), reader.CodeId(code));
+    ASSERT_EQ(tree.CodeProbality(code), reader.CodeProbality(code));
+  }
+  for (int64_t code = 0; code < (1 << 21); code += 997) {
+    int64_t id = tree.CodeId(code);
+    if (id == -1) {
+      continue;
+    }
+    ASSERT_EQ(tree.NodeIdToCode(id), reader.NodeIdToCode(id));
+    ASSERT_EQ(tree.NodeById(id).key, reader.NodeById(id).key);
+  }
+  ASSERT_EQ(-1, reader.NodeIdToCode(-2));
+
+  // a reload drops the mapping
+  ASSERT_TRUE(reader.Load());
+  ASSERT_FALSE(reader.shared());
+  ASSERT_FALSE(reader.compact());
+  ASSERT_TRUE(reader.Valid(reader.Node(reader.MakeKey(0))));
+}
+
 }  // namespace tdm
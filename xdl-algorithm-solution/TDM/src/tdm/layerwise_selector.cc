@@ -15,9 +15,13 @@ limitations under the License.
 
 // Copyright 2018 Alibaba Inc. All Rights Reserved.
 
+#include <algorithm>
+#include <memory>
 #include <vector>
 #include <thread>
 
+#include "tdm/alias_table.h"
+#include "tdm/cache.h"
 #include "tdm/selector.h"
 #include "tdm/dist_tree.h"
 #include "tdm/tree.pb.h"
@@ -26,6 +30,14 @@ limitations under the License.
 
 namespace tdm {
 
+namespace {
+
+std::string PathKey(int64_t id) {
+  return std::string(reinterpret_cast<const char*>(&id), sizeof(id));
+}
+
+}  // namespace
+
 class LayerWiseSelector: public Selector {
  public:
   LayerWiseSelector();
@@ -38,13 +50,41 @@ class LayerWiseSelector: public Selector {
               int64_t* output_ids, float* weights) override;
 
  private:
+  // Select [begin, end) of input_ids with the compact tree, by the node
+  // codes instead of the store, which is safe to run in parallel
+  void SelectCompact(const std::vector<int64_t>& input_ids,
+                     size_t begin, size_t end,
+                     const std::vector<int>& layer_counts,
+                     int layer_sum, int64_t* output_ids, float* weights);
+
+  // The ancestor codes and ids of the positive path of target id upward,
+  // false if no former sample of id left it in the path cache
+  bool GetPath(int64_t id, std::vector<int64_t>* codes,
+               std::vector<int64_t>* ids) const;
+  void PutPath(int64_t id, const std::vector<int64_t>& codes,
+               const std::vector<int64_t>& ids);
+
+  // Sample count negative neighbor indices in level of key_no
+  void SampleNeighbors(int level, size_t key_no, size_t count,
+                       std::vector<int>* neighbor_indices);
+
+  // The input ids of a compact select thread at least
+  static const size_t kMinIdsPerThread = 256;
+  // The negative samples of a level deduped without a hash set at most
+  static const size_t kMaxScanDedupCount = 32;
+
   bool with_prob_;
-  std::vector<std::discrete_distribution<int> > node_prob_data_;
+  std::vector<AliasTable> node_prob_data_;
+  std::vector<size_t> level_starts_;
   int start_sample_layer_;
+  int thread_num_;
+  // The positive paths by target id, shared by the threads of all the
+  // samples since the tree does not change, null if path_cache_kb is 0
+  std::unique_ptr<ShardedCache> path_cache_;
 };
 
 LayerWiseSelector::LayerWiseSelector(): with_prob_(false), 
-	start_sample_layer_(-1) {
+	start_sample_layer_(-1), thread_num_(1) {
 }
 
 bool LayerWiseSelector::Init(const std::string& config) {
@@ -58,12 +98,34 @@ bool LayerWiseSelector::Init(const std::string& config) {
     start_sample_layer_ = atoi(conf["start_sample_layer"].c_str());
   }
   printf("[INFO] start_sample_layer %d\n", start_sample_layer_);
+
+  if (conf.find("thread_num") != conf.end()) {
+    thread_num_ = std::max(atoi(conf["thread_num"].c_str()), 1);
+  }
+  printf("[INFO] thread_num %d\n", thread_num_);
+
+  path_cache_.reset();
+  if (conf.find("path_cache_kb") != conf.end()) {
+    int nkb = atoi(conf["path_cache_kb"].c_str());
+    if (nkb > 0) {
+      path_cache_.reset(new ShardedCache());
+      if (!path_cache_->Init(nkb)) {
+        printf("[WARN] Init path cache of %d KB failed\n", nkb);
+        path_cache_.reset();
+      } else {
+        printf("[INFO] path_cache_kb %d\n", nkb);
+      }
+    }
+  }
  
+  node_prob_data_.clear();
+  level_starts_.clear();
   for (int level = 0; level < dist_tree_->max_level(); ++level) {
     auto level_itr = dist_tree_->LevelIterator(level);
     auto level_end = dist_tree_->LevelEnd(level);
     size_t level_node_num_start = static_cast<size_t>(
 		pow(dist_tree_->branch(), level)) - 1;
+    level_starts_.push_back(level_node_num_start);
 
     std::vector<float> aux_vec;
     do {
@@ -83,8 +145,8 @@ bool LayerWiseSelector::Init(const std::string& config) {
       }
       ++level_itr;
     } while (level_itr != level_end);
-    std::discrete_distribution<int> dd(aux_vec.begin(), aux_vec.end());
-    node_prob_data_.push_back(dd);
+    node_prob_data_.push_back(AliasTable());
+    node_prob_data_.back().Init(aux_vec);
   }
 
   return true;
@@ -96,9 +158,6 @@ void LayerWiseSelector::Select(
     const std::vector<int>& layer_counts,
     int64_t* output_ids, float* weights) {
   (void) features;
-  auto nodes = dist_tree_->NodeById(input_ids);
-  auto ancestors = dist_tree_->Ancestors(nodes);
-  
   // Sample sum(layer_counts) negative samples
   // and layer_counts.size() positive samples
   int layer_sum = layer_counts.size();
@@ -109,105 +168,279 @@ void LayerWiseSelector::Select(
   memset(output_ids, 0x00, sizeof(int64_t) * layer_sum * input_ids.size());
   memset(weights, 0x00, sizeof(float) * layer_sum * input_ids.size());
 
-  int i = 0;
-  for (auto it = ancestors.begin(); it != ancestors.end(); ++it) {
-    auto& ancs = *it;
-    if (!ancs.empty()) {
-      if (ancs.size() > layer_counts.size()) {
-        ancs.resize(layer_counts.size());
+  if (dist_tree_->compact()) {
+    size_t id_num = input_ids.size();
+    size_t thread_num = std::min(
+        static_cast<size_t>(thread_num_),
+        (id_num + kMinIdsPerThread - 1) / kMinIdsPerThread);
+    if (thread_num <= 1) {
+      SelectCompact(input_ids, 0, id_num, layer_counts, layer_sum,
+                    output_ids, weights);
+      return;
+    }
+
+    // the threads write the disjoint rows of output_ids and weights
+    std::vector<std::thread> threads;
+    size_t part = (id_num + thread_num - 1) / thread_num;
+    for (size_t begin = 0; begin < id_num; begin += part) {
+      size_t end = std::min(begin + part, id_num);
+      threads.push_back(std::thread(
+          &LayerWiseSelector::SelectCompact, this, std::cref(input_ids),
+          begin, end, std::cref(layer_counts), layer_sum,
+          output_ids, weights));
+    }
+    for (auto it = threads.begin(); it != threads.end(); ++it) {
+      it->join();
+    }
+    return;
+  }
+
+  // the positive paths not cached read from the store by a batch
+  std::vector<std::vector<int64_t> > codes(input_ids.size());
+  std::vector<std::vector<int64_t> > anc_ids(input_ids.size());
+  std::vector<int64_t> miss_ids;
+  std::vector<size_t> miss_index;
+  for (size_t i = 0; i < input_ids.size(); ++i) {
+    if (!GetPath(input_ids[i], &codes[i], &anc_ids[i])) {
+      miss_ids.push_back(input_ids[i]);
+      miss_index.push_back(i);
+    }
+  }
+
+  if (!miss_ids.empty()) {
+    auto nodes = dist_tree_->NodeById(miss_ids);
+    auto ancestors = dist_tree_->Ancestors(nodes);
+    for (size_t m = 0; m < miss_index.size(); ++m) {
+      size_t i = miss_index[m];
+      Node node;
+      for (auto it = ancestors[m].begin(); it != ancestors[m].end(); ++it) {
+        codes[i].push_back(dist_tree_->KeyNo(it->key));
+        anc_ids[i].push_back(
+            node.ParseFromString(it->value) ? node.id() : -1);
       }
+      PutPath(miss_ids[m], codes[i], anc_ids[i]);
+    }
+  }
 
-      int64_t* ids = output_ids + i * layer_sum;
-      float* w = weights + i * layer_sum;
+  std::vector<int> neighbor_indices;
+  std::vector<int64_t> neighbor_codes;
+  for (size_t i = 0; i < input_ids.size(); ++i) {
+    auto& ancs = codes[i];
+    if (ancs.empty()) {
+      continue;
+    }
+    if (ancs.size() > layer_counts.size()) {
+      ancs.resize(layer_counts.size());
+    }
 
-      int level = dist_tree_->max_level();
-      for (size_t j = 0; j < ancs.size() 
-				&& level - 1 >= start_sample_layer_; ++j) {
-        --level;  // Upward
+    int64_t* ids = output_ids + i * layer_sum;
+    float* w = weights + i * layer_sum;
 
-        // sample: +
-        Node node;
-        if (!node.ParseFromString(ancs[j].value)) {
-          continue;
-        }
+    int level = dist_tree_->max_level();
+    for (size_t j = 0; j < ancs.size()
+             && level - 1 >= start_sample_layer_; ++j) {
+      --level;  // Upward
+
+      // sample: +
+      int64_t positive_sample_id = anc_ids[i][j];
+      if (positive_sample_id == -1) {
+        continue;
+      }
+
+      ids[0] = positive_sample_id;
+      w[0] = 1;
+      ++ids;
+      ++w;
+
+      // sample: -
+      size_t cur_layer_count = layer_counts.at(level);
+      SampleNeighbors(level, ancs[j], cur_layer_count, &neighbor_indices);
+
+      size_t level_start = level_starts_[level];
+      neighbor_codes.clear();
+      for (size_t k = 0; k < cur_layer_count; ++k) {
+        neighbor_codes.push_back(level_start + neighbor_indices[k]);
+      }
+      auto negative_samples = dist_tree_->NodeByCode(neighbor_codes);
 
-        int64_t positive_sample_id = node.id();
-        ids[0] = node.id();
-        w[0] = 1;
-        ++ids;
-        ++w;
-
-        // sample: -
-        std::unordered_set<int> neighbor_indices_set;
-        std::vector<int> neighbor_indices;
-        size_t cur_layer_count = layer_counts.at(level);
-        neighbor_indices_set.reserve(cur_layer_count);
-        neighbor_indices.reserve(cur_layer_count);
-
-        size_t key_no = dist_tree_->KeyNo(ancs[j].key);
-
-        size_t neighbors_count = static_cast<size_t>(
-            pow(dist_tree_->branch(), level)) - 1;
-        size_t level_node_num_start = static_cast<size_t>(
-            pow(dist_tree_->branch(), level)) - 1;
-
-        static __thread std::hash<std::thread::id> hasher;
-        static __thread std::mt19937 rng(
-            clock() + hasher(std::this_thread::get_id()));
-        std::uniform_int_distribution<int> distrib(0, neighbors_count);
-         
-        if (false == with_prob_) {
-          while (neighbor_indices_set.size() < cur_layer_count) {
-            int q = 0;
-            if (with_prob_) {
-              q = node_prob_data_.at(level)(rng);
-            } else {
-              q = distrib(rng);
-            }
-
-            if (neighbor_indices_set.find(q) != neighbor_indices_set.end()) {
-              continue;
-            }
-
-            // 判定节点是否在tree中存在
-            auto rand_key_no = level_node_num_start + q;
-            if (!dist_tree_->IsFiltered(rand_key_no)
-                && key_no != rand_key_no) {
-              neighbor_indices_set.insert(q);
-              neighbor_indices.push_back(q);
-            }
+      Node node;
+      for (size_t k = 0; k < cur_layer_count; ++k) {
+        if (node.ParseFromString(negative_samples[k].value)) {
+          if (false == with_prob_) {
+            assert(positive_sample_id != node.id());
           }
-        } else {
-           while (neighbor_indices.size() < cur_layer_count) {
-            int q = node_prob_data_.at(level)(rng);
-
-            // 判定节点是否在tree中存在
-            auto rand_key_no = level_node_num_start + q;
-            if (!dist_tree_->IsFiltered(rand_key_no)) {
-              neighbor_indices.push_back(q);
-            }
-          } 
+          ids[k] = node.id();
+          w[k] = 0;
         }
+      }
+
+      ids += cur_layer_count;
+      w += cur_layer_count;
+    }
+  }
+}
+
+void LayerWiseSelector::SelectCompact(const std::vector<int64_t>& input_ids,
+                                      size_t begin, size_t end,
+                                      const std::vector<int>& layer_counts,
+                                      int layer_sum, int64_t* output_ids,
+                                      float* weights) {
+  std::vector<int64_t> ancs;
+  std::vector<int64_t> anc_ids;
+  std::vector<int> neighbor_indices;
+  for (size_t i = begin; i < end; ++i) {
+    if (!GetPath(input_ids[i], &ancs, &anc_ids)) {
+      int64_t code = dist_tree_->NodeIdToCode(input_ids[i]);
+      dist_tree_->AncestorCodes(code, &ancs);
+      anc_ids.resize(ancs.size());
+      for (size_t j = 0; j < ancs.size(); ++j) {
+        anc_ids[j] = dist_tree_->CodeId(ancs[j]);
+      }
+      PutPath(input_ids[i], ancs, anc_ids);
+    }
+    if (ancs.empty()) {
+      continue;
+    }
+    if (ancs.size() > layer_counts.size()) {
+      ancs.resize(layer_counts.size());
+    }
+
+    int64_t* ids = output_ids + i * layer_sum;
+    float* w = weights + i * layer_sum;
+
+    int level = dist_tree_->max_level();
+    for (size_t j = 0; j < ancs.size()
+             && level - 1 >= start_sample_layer_; ++j) {
+      --level;  // Upward
 
-        auto negative_samples =
-            dist_tree_->SelectNeighbors(ancs[j], neighbor_indices);
-        assert(cur_layer_count == negative_samples.size());
-
-        for (int k = 0; k < cur_layer_count; ++k) {
-          if (node.ParseFromString(negative_samples[k].value)) {
-            if (false == with_prob_) {
-              assert(positive_sample_id != node.id());
-            }
-            ids[k] = node.id();
-            w[k] = 0;
+      // sample: +
+      int64_t positive_sample_id = anc_ids[j];
+      if (positive_sample_id == -1) {
+        continue;
+      }
+
+      ids[0] = positive_sample_id;
+      w[0] = 1;
+      ++ids;
+      ++w;
+
+      // sample: -
+      size_t cur_layer_count = layer_counts.at(level);
+      SampleNeighbors(level, ancs[j], cur_layer_count, &neighbor_indices);
+
+      // the sampled indices are in the tree
+      size_t level_start = level_starts_[level];
+      for (size_t k = 0; k < cur_layer_count; ++k) {
+        int64_t id = dist_tree_->CodeId(level_start + neighbor_indices[k]);
+        if (id != -1) {
+          if (false == with_prob_) {
+            assert(positive_sample_id != id);
           }
+          ids[k] = id;
+          w[k] = 0;
+        }
+      }
+
+      ids += cur_layer_count;
+      w += cur_layer_count;
+    }
+  }
+}
+
+bool LayerWiseSelector::GetPath(int64_t id, std::vector<int64_t>* codes,
+                                std::vector<int64_t>* ids) const {
+  codes->clear();
+  ids->clear();
+  std::string value;
+  if (!path_cache_ || !path_cache_->Get(PathKey(id), &value)) {
+    return false;
+  }
+
+  // the (code, id) pairs of the path nodes upward
+  size_t n = value.size() / (2 * sizeof(int64_t));
+  const int64_t* ptr = reinterpret_cast<const int64_t*>(value.data());
+  for (size_t j = 0; j < n; ++j) {
+    codes->push_back(ptr[2 * j]);
+    ids->push_back(ptr[2 * j + 1]);
+  }
+  return true;
+}
+
+void LayerWiseSelector::PutPath(int64_t id,
+                                const std::vector<int64_t>& codes,
+                                const std::vector<int64_t>& ids) {
+  if (!path_cache_) {
+    return;
+  }
+
+  // a path longer than a cache slot is not cached
+  std::string value;
+  value.reserve(codes.size() * 2 * sizeof(int64_t));
+  for (size_t j = 0; j < codes.size(); ++j) {
+    value.append(reinterpret_cast<const char*>(&codes[j]), sizeof(int64_t));
+    value.append(reinterpret_cast<const char*>(&ids[j]), sizeof(int64_t));
+  }
+  path_cache_->Put(PathKey(id), value);
+}
+
+void LayerWiseSelector::SampleNeighbors(int level, size_t key_no,
+                                        size_t count,
+                                        std::vector<int>* neighbor_indices) {
+  neighbor_indices->clear();
+  neighbor_indices->reserve(count);
+
+  size_t level_node_num_start = level_starts_[level];
+  size_t neighbors_count = level_node_num_start;
+
+  static __thread std::hash<std::thread::id> hasher;
+  static __thread std::mt19937 rng(
+      clock() + hasher(std::this_thread::get_id()));
+  std::uniform_int_distribution<int> distrib(0, neighbors_count);
+
+  if (false == with_prob_) {
+    // the few samples of a level dedup by a scan of the sampled ones
+    std::unordered_set<int> neighbor_indices_set;
+    bool use_set = count > kMaxScanDedupCount;
+    if (use_set) {
+      neighbor_indices_set.reserve(count);
+    }
+    while (neighbor_indices->size() < count) {
+      int q = distrib(rng);
+      if (use_set) {
+        if (neighbor_indices_set.find(q) != neighbor_indices_set.end()) {
+          continue;
         }
+      } else if (std::find(neighbor_indices->begin(), neighbor_indices->end(),
+                           q) != neighbor_indices->end()) {
+        continue;
+      }
 
-        ids += cur_layer_count;
-        w += cur_layer_count;
+      // 判定节点是否在tree中存在
+      auto rand_key_no = level_node_num_start + q;
+      if (!dist_tree_->IsFiltered(rand_key_no)
+          && key_no != rand_key_no) {
+        if (use_set) {
+          neighbor_indices_set.insert(q);
+        }
+        neighbor_indices->push_back(q);
+      }
+    }
+  } else {
+    // the samples still missing drawn at once, those not in the tree
+    // filtered by a batch
+    const AliasTable& alias_table = node_prob_data_.at(level);
+    std::vector<int64_t> codes;
+    codes.reserve(count);
+    while (neighbor_indices->size() < count) {
+      codes.clear();
+      for (size_t i = neighbor_indices->size(); i < count; ++i) {
+        codes.push_back(level_node_num_start + alias_table.Sample(rng));
+      }
+      dist_tree_->RemoveFiltered(&codes);
+      for (auto it = codes.begin(); it != codes.end(); ++it) {
+        neighbor_indices->push_back(*it - level_node_num_start);
       }
     }
-    ++i;
   }
 }
 
@@ -26,27 +26,63 @@ limitations under the License.
 
 namespace tdm {
 
-LocalStore::LocalStore(): Store() {
+LocalStore::LocalStore(): Store(), dump_snapshot_(true) {
 }
 
 LocalStore::~LocalStore() {
 }
 
 bool LocalStore::Init(const std::string& config) {
-  (void) config;
+  auto conf = ParseConfig(config);
+  auto it = conf.find("dump_format");
+  if (it != conf.end()) {
+    if (it->second != "snapshot" && it->second != "record") {
+      fprintf(stderr, "Invalid dump format: %s\n", it->second.c_str());
+      return false;
+    }
+    dump_snapshot_ = it->second == "snapshot";
+  }
   return true;
 }
 
+void LocalStore::CollectItems(std::vector<SnapshotItem>* items) const {
+  items->reserve(data_.size());
+  for (auto it = data_.begin(); it != data_.end(); ++it) {
+    items->push_back(SnapshotItem{it->first.data(), it->first.size(),
+                                  it->second.data(), it->second.size()});
+  }
+  for (size_t i = 0; i < snapshots_.size(); ++i) {
+    for (size_t j = 0; j < snapshots_[i]->size(); ++j) {
+      SnapshotItem item = snapshots_[i]->item(j);
+      std::string key(item.key, item.key_len);
+      bool shadowed = data_.find(key) != data_.end() ||
+          removed_.find(key) != removed_.end();
+      for (size_t k = 0; !shadowed && k < i; ++k) {
+        shadowed = snapshots_[k]->Contains(key);
+      }
+      if (!shadowed) {
+        items->push_back(item);
+      }
+    }
+  }
+}
+
 bool LocalStore::Dump(const std::string& filename) {
+  std::vector<SnapshotItem> items;
+  CollectItems(&items);
+  if (dump_snapshot_) {
+    return Snapshot::Write(filename, &items);
+  }
+
   FILE* fp = fopen(filename.c_str(), "wb");
   if (fp == nullptr) {
     return false;
   }
 
-  for (auto it = data_.begin(); it != data_.end(); ++it) {
+  for (auto it = items.begin(); it != items.end(); ++it) {
     KVItem item;
-    item.set_key(it->first);
-    item.set_value(it->second);
+    item.set_key(it->key, it->key_len);
+    item.set_value(it->value, it->value_len);
     std::string content;
     if (!item.SerializeToString(&content)) {
       fclose(fp);
@@ -61,16 +97,49 @@ bool LocalStore::Dump(const std::string& filename) {
   return true;
 }
 
+bool LocalStore::LoadSnapshot(const std::string& filename) {
+  std::unique_ptr<Snapshot> snapshot(new Snapshot());
+  if (!snapshot->Open(filename)) {
+    return false;
+  }
+  snapshots_.push_back(std::move(snapshot));
+  return true;
+}
+
+bool LocalStore::InSnapshots(const std::string& key) const {
+  if (removed_.find(key) != removed_.end()) {
+    return false;
+  }
+  for (auto it = snapshots_.begin(); it != snapshots_.end(); ++it) {
+    if ((*it)->Contains(key)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 bool LocalStore::Get(const std::string& key, std::string* value) {
   auto it = data_.find(key);
-  if (it == data_.end()) {
-  return false;
+  if (it != data_.end()) {
+    *value = it->second;
+    return true;
   }
-  *value = it->second;
-  return true;
+  if (snapshots_.empty() || removed_.find(key) != removed_.end()) {
+    return false;
+  }
+  for (auto sit = snapshots_.begin(); sit != snapshots_.end(); ++sit) {
+    if ((*sit)->Get(key, value)) {
+      return true;
+    }
+  }
+  return false;
 }
 
 bool LocalStore::Put(const std::string& key, const std::string& value) {
+  if (!snapshots_.empty() && InSnapshots(key)) {
+    return false;
+  }
+  removed_.erase(key);
   return data_.insert({key, value}).second;
 }
 
@@ -103,6 +172,9 @@ LocalStore::MPut(const std::vector<std::string>& keys,
 
 bool LocalStore::Remove(const std::string& key) {
   data_.erase(key);
+  if (InSnapshots(key)) {
+    removed_.insert(key);
+  }
   return true;
 }
 
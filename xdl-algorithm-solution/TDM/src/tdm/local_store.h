@@ -18,14 +18,24 @@ limitations under the License.
 #ifndef TDM_LOCAL_STORE_H_
 #define TDM_LOCAL_STORE_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 
+#include "tdm/snapshot.h"
 #include "tdm/store.h"
 
 namespace tdm {
 
+// The store in the memory of the process. The snapshots loaded are read
+// through their mapped files, so that the processes of a host share them,
+// and the puts after go to a map above them.
+//
+// Config, separated by ';':
+//   dump_format=snapshot  Dump writes a Snapshot, or the records of
+//                         (length, KVItem) by record
 class LocalStore: public Store {
  public:
   LocalStore();
@@ -48,8 +58,20 @@ class LocalStore: public Store {
 
   bool Remove(const std::string& key) override;
 
+ protected:
+  bool LoadSnapshot(const std::string& filename) override;
+
  private:
+  bool InSnapshots(const std::string& key) const;
+  // The items of the store, those of data_ and the snapshots not shadowed
+  void CollectItems(std::vector<SnapshotItem>* items) const;
+
+  bool dump_snapshot_;
   std::unordered_map<std::string, std::string> data_;
+  // in the load order, the first of a key wins as Put
+  std::vector<std::unique_ptr<Snapshot> > snapshots_;
+  // the keys of the snapshots removed
+  std::unordered_set<std::string> removed_;
 };
 
 }  // namespace tdm
@@ -0,0 +1,194 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Copyright 2018 Alibaba Inc. All Rights Reserved.
+
+#include "tdm/snapshot.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace tdm {
+
+namespace {
+
+const char kMagic[8] = {'T', 'D', 'M', 'S', 'N', 'A', 'P', '1'};
+const size_t kHeaderSize = sizeof(kMagic) + sizeof(uint64_t);
+
+int Compare(const char* a, size_t a_len, const char* b, size_t b_len) {
+  int ret = memcmp(a, b, std::min(a_len, b_len));
+  if (ret != 0) {
+    return ret;
+  }
+  return a_len < b_len ? -1 : (a_len > b_len ? 1 : 0);
+}
+
+}  // namespace
+
+Snapshot::Snapshot(): data_(NULL), length_(0), count_(0), entries_(NULL) {
+}
+
+Snapshot::~Snapshot() {
+  Close();
+}
+
+bool Snapshot::Open(const std::string& filename) {
+  Close();
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Can not open file: %s\n", filename.c_str());
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < kHeaderSize) {
+    fprintf(stderr, "Invalid snapshot: %s\n", filename.c_str());
+    close(fd);
+    return false;
+  }
+
+  void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    fprintf(stderr, "Map snapshot: %s failed\n", filename.c_str());
+    return false;
+  }
+  // the lookups touch the pages at random
+  madvise(addr, st.st_size, MADV_RANDOM);
+
+  data_ = static_cast<const char*>(addr);
+  length_ = st.st_size;
+  uint64_t count = 0;
+  memcpy(&count, data_ + sizeof(kMagic), sizeof(count));
+  if (memcmp(data_, kMagic, sizeof(kMagic)) != 0 ||
+      count > (length_ - kHeaderSize) / sizeof(Entry)) {
+    fprintf(stderr, "Invalid snapshot: %s\n", filename.c_str());
+    Close();
+    return false;
+  }
+  count_ = count;
+  entries_ = reinterpret_cast<const Entry*>(data_ + kHeaderSize);
+  return true;
+}
+
+void Snapshot::Close() {
+  if (data_ != NULL) {
+    munmap(const_cast<char*>(data_), length_);
+  }
+  data_ = NULL;
+  length_ = 0;
+  count_ = 0;
+  entries_ = NULL;
+}
+
+const Snapshot::Entry* Snapshot::Find(const std::string& key) const {
+  const Entry* end = entries_ + count_;
+  const Entry* it = std::lower_bound(entries_, end, key,
+      [this](const Entry& entry, const std::string& key) {
+    return Compare(data_ + entry.key_offset, entry.key_len,
+                   key.data(), key.size()) < 0;
+  });
+  if (it == end || Compare(data_ + it->key_offset, it->key_len,
+                           key.data(), key.size()) != 0) {
+    return NULL;
+  }
+  return it;
+}
+
+bool Snapshot::Get(const std::string& key, std::string* value) const {
+  const Entry* entry = Find(key);
+  if (entry == NULL ||
+      entry->value_offset + entry->value_len > length_) {
+    return false;
+  }
+  value->assign(data_ + entry->value_offset, entry->value_len);
+  return true;
+}
+
+bool Snapshot::Contains(const std::string& key) const {
+  return Find(key) != NULL;
+}
+
+SnapshotItem Snapshot::item(size_t i) const {
+  const Entry& entry = entries_[i];
+  return SnapshotItem{data_ + entry.key_offset, entry.key_len,
+                      data_ + entry.value_offset, entry.value_len};
+}
+
+bool Snapshot::Write(const std::string& filename,
+                     std::vector<SnapshotItem>* items) {
+  std::stable_sort(items->begin(), items->end(),
+                   [](const SnapshotItem& a, const SnapshotItem& b) {
+    return Compare(a.key, a.key_len, b.key, b.key_len) < 0;
+  });
+  auto last = std::unique(items->begin(), items->end(),
+                          [](const SnapshotItem& a, const SnapshotItem& b) {
+    return Compare(a.key, a.key_len, b.key, b.key_len) == 0;
+  });
+  items->erase(last, items->end());
+
+  // written aside and renamed, the items might be mapped from filename
+  std::string tmp = filename + ".tmp";
+  FILE* fp = fopen(tmp.c_str(), "wb");
+  if (fp == NULL) {
+    return false;
+  }
+
+  uint64_t count = items->size();
+  bool ret = fwrite(kMagic, sizeof(kMagic), 1, fp) == 1 &&
+      fwrite(&count, sizeof(count), 1, fp) == 1;
+  uint64_t offset = kHeaderSize + count * sizeof(Entry);
+  for (auto it = items->begin(); ret && it != items->end(); ++it) {
+    Entry entry;
+    entry.key_offset = offset;
+    entry.value_offset = offset + it->key_len;
+    entry.key_len = it->key_len;
+    entry.value_len = it->value_len;
+    offset += it->key_len + it->value_len;
+    ret = fwrite(&entry, sizeof(entry), 1, fp) == 1;
+  }
+  for (auto it = items->begin(); ret && it != items->end(); ++it) {
+    ret = fwrite(it->key, 1, it->key_len, fp) == it->key_len &&
+        fwrite(it->value, 1, it->value_len, fp) == it->value_len;
+  }
+
+  if (fclose(fp) != 0) {
+    ret = false;
+  }
+  if (!ret || rename(tmp.c_str(), filename.c_str()) != 0) {
+    remove(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool Snapshot::IsSnapshot(const std::string& filename) {
+  FILE* fp = fopen(filename.c_str(), "rb");
+  if (fp == NULL) {
+    return false;
+  }
+  char magic[sizeof(kMagic)];
+  bool ret = fread(magic, sizeof(magic), 1, fp) == 1 &&
+      memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+  fclose(fp);
+  return ret;
+}
+
+}  // namespace tdm
@@ -0,0 +1,89 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Copyright 2018 Alibaba Inc. All Rights Reserved.
+
+#ifndef TDM_SNAPSHOT_H_
+#define TDM_SNAPSHOT_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace tdm {
+
+struct SnapshotItem {
+  const char* key;
+  size_t key_len;
+  const char* value;
+  size_t value_len;
+};
+
+// An immutable key value file read through mmap, so that the processes of
+// a host opening the same file share its pages in the page cache instead
+// of a copy each. The file is
+//   magic[8] | count | entries[count] sorted by key | keys and values
+// where an entry holds the offsets and lengths of its key and value, and a
+// key is found by the binary search of the entries. The integers are of
+// the host byte order.
+class Snapshot {
+ public:
+  Snapshot();
+  ~Snapshot();
+
+  bool Open(const std::string& filename);
+  void Close();
+
+  bool Get(const std::string& key, std::string* value) const;
+  bool Contains(const std::string& key) const;
+
+  size_t size() const {
+    return count_;
+  }
+
+  // The i-th item in the key order, pointing into the mapped file
+  SnapshotItem item(size_t i) const;
+
+  // Write items, sorted here, to filename. The items of the same key
+  // keep the first one
+  static bool Write(const std::string& filename,
+                    std::vector<SnapshotItem>* items);
+
+  // Whether filename starts with the snapshot magic
+  static bool IsSnapshot(const std::string& filename);
+
+ private:
+  struct Entry {
+    uint64_t key_offset;
+    uint64_t value_offset;
+    uint32_t key_len;
+    uint32_t value_len;
+  };
+
+  const Entry* Find(const std::string& key) const;
+
+  Snapshot(const Snapshot&) = delete;
+  Snapshot& operator=(const Snapshot&) = delete;
+
+  const char* data_;
+  size_t length_;
+  size_t count_;
+  const Entry* entries_;
+};
+
+}  // namespace tdm
+
+#endif  // TDM_SNAPSHOT_H_
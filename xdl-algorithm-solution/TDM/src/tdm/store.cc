@@ -18,9 +18,11 @@ limitations under the License.
 #include "tdm/store.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "tdm/common.h"
 #include "tdm/local_store.h"
+#include "tdm/snapshot.h"
 #include "tdm/store_kv.pb.h"
 
 namespace tdm {
@@ -58,6 +60,13 @@ Store* Store::NewStore(const std::string& config) {
 }
 
 void Store::LoadData(const std::string& filename) {
+  if (Snapshot::IsSnapshot(filename)) {
+    if (!LoadSnapshot(filename)) {
+      fprintf(stderr, "Load snapshot: %s failed.\n", filename.c_str());
+    }
+    return;
+  }
+
   FILE* fp = fopen(filename.c_str(), "rb");
   if (fp == NULL) {
     fprintf(stderr, "Can not open file: %s\n", filename.c_str());
@@ -97,6 +106,27 @@ void Store::LoadData(const std::string& filename) {
   fclose(fp);
 }
 
+bool Store::LoadSnapshot(const std::string& filename) {
+  Snapshot snapshot;
+  if (!snapshot.Open(filename)) {
+    return false;
+  }
+
+  std::vector<std::string> keys;
+  std::vector<std::string> values;
+  for (size_t i = 0; i < snapshot.size(); ++i) {
+    SnapshotItem item = snapshot.item(i);
+    keys.push_back(std::string(item.key, item.key_len));
+    values.push_back(std::string(item.value, item.value_len));
+    if (keys.size() >= kBatchSize || i + 1 == snapshot.size()) {
+      MPut(keys, values);
+      keys.clear();
+      values.clear();
+    }
+  }
+  return true;
+}
+
 void Store::DestroyStore(Store* store) {
   delete store;
 }
@@ -106,12 +136,47 @@ void Store::RegisterStoreFactory(const std::string& type,
   factory_.insert({type, factory});
 }
 
-CachedStore::CachedStore(): enable_cache_(true) {
+CachedStore::CachedStore(): enable_cache_(true), cached_kv_(new LRUCache()) {
 }
 
 CachedStore::~CachedStore() {
   persist_kv_.Destroy();
-  cached_kv_.Destroy();
+  cached_kv_->Destroy();
+  delete cached_kv_;
+}
+
+bool CachedStore::InitCache(const std::string& config) {
+  auto conf = ParseConfig(config);
+  auto it = conf.find("cache");
+  if (it == conf.end() || it->second != "sharded") {
+    return true;
+  }
+
+  int nkb = 0;
+  int shard_num = ShardedCache::kDefaultShardNum;
+  int slot_bytes = ShardedCache::kDefaultSlotBytes;
+  if ((it = conf.find("cache_kb")) != conf.end()) {
+    nkb = atoi(it->second.c_str());
+  }
+  if ((it = conf.find("cache_shard_num")) != conf.end()) {
+    shard_num = atoi(it->second.c_str());
+  }
+  if ((it = conf.find("cache_slot_bytes")) != conf.end()) {
+    slot_bytes = atoi(it->second.c_str());
+  }
+
+  ShardedCache* cache = new ShardedCache();
+  if (!cache->Init(nkb, shard_num, slot_bytes)) {
+    fprintf(stderr, "Init sharded cache failed, config: %s\n",
+            config.c_str());
+    delete cache;
+    return false;
+  }
+
+  cached_kv_->Destroy();
+  delete cached_kv_;
+  cached_kv_ = cache;
+  return true;
 }
 
 void CachedStore::Persist(const std::vector<std::string>& keys) {
@@ -125,13 +190,13 @@ void CachedStore::Persist(const std::vector<std::string>& keys) {
 }
 
 void CachedStore::Cache(const std::string& key, const std::string& value) {
-  cached_kv_.Put(key, value);
+  cached_kv_->Put(key, value);
 }
 
 bool CachedStore::FindInCache(const std::string& key, std::string* value) {
   auto ret = persist_kv_.Get(key, value);
   if (!ret) {
-    ret = cached_kv_.Get(key, value);
+    ret = cached_kv_->Get(key, value);
   }
   return ret;
 }
@@ -143,7 +208,7 @@ CachedStore::FindInCache(const std::vector<std::string>& keys,
   for (size_t i = 0; i < keys.size(); ++i) {
     ret[i] = persist_kv_.Get(keys[i], &values->at(i));
     if (!ret[i]) {
-      ret[i] = cached_kv_.Get(keys[i], &values->at(i));
+      ret[i] = cached_kv_->Get(keys[i], &values->at(i));
     }
   }
   return ret;
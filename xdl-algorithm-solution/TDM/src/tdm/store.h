@@ -56,10 +56,14 @@ class Store {
   static void RegisterStoreFactory(const std::string& type,
                                    StoreFactory* factory);
 
+  // Load the records of (length, KVItem) or a Snapshot from filename
   void LoadData(const std::string& filename);
   virtual bool Dump(const std::string& filename) = 0;
 
  protected:
+  // Put the items of the snapshot of filename
+  virtual bool LoadSnapshot(const std::string& filename);
+
   using KVMap = std::unordered_map<std::string, std::string>;
   static KVMap ParseConfig(const std::string& config);
 
@@ -89,6 +93,15 @@ class CachedStore: public Store {
     enable_cache_ = enable_cache;
   }
 
+  // Select the cache of the got values by config, the LRUCache in default:
+  //   cache=sharded;cache_kb=<nkb>;cache_shard_num=<n>;cache_slot_bytes=<n>
+  // for a ShardedCache
+  bool InitCache(const std::string& config);
+
+  const tdm::Cache* cache() const {
+    return cached_kv_;
+  }
+
  protected:
   virtual void Cache(const std::string& key, const std::string& value);
   virtual bool FindInCache(const std::string& key, std::string* value);
@@ -98,7 +111,7 @@ class CachedStore: public Store {
  protected:
   bool enable_cache_;
   LRUCache persist_kv_;
-  LRUCache cached_kv_;
+  tdm::Cache* cached_kv_;
 };
 
 }  // namespace tdm
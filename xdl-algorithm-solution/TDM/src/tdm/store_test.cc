@@ -17,8 +17,13 @@ limitations under the License.
 
 #include "tdm/store.h"
 
+#include <string>
+
 #include "gtest/gtest.h"
 
+#include "tdm/local_store.h"
+#include "tdm/snapshot.h"
+
 namespace tdm {
 
 TEST(Store, StoreCreate) {
@@ -26,4 +31,55 @@ TEST(Store, StoreCreate) {
   ASSERT_TRUE(store != nullptr);
 }
 
-}  // namespace util
+TEST(Store, TestSnapshot) {
+  LocalStore store;
+  ASSERT_TRUE(store.Init(""));
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(store.Put("key" + std::to_string(i), std::to_string(i * 7)));
+  }
+  ASSERT_TRUE(store.Put("", "empty"));
+  ASSERT_TRUE(store.Dump("store_snapshot.pb"));
+  ASSERT_TRUE(Snapshot::IsSnapshot("store_snapshot.pb"));
+
+  LocalStore loaded;
+  ASSERT_TRUE(loaded.Init(""));
+  loaded.LoadData("store_snapshot.pb");
+  std::string value;
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(loaded.Get("key" + std::to_string(i), &value));
+    ASSERT_EQ(std::to_string(i * 7), value);
+  }
+  ASSERT_TRUE(loaded.Get("", &value));
+  ASSERT_EQ("empty", value);
+  ASSERT_FALSE(loaded.Get("key1000", &value));
+  ASSERT_FALSE(loaded.Get("key", &value));
+
+  // the puts and removes above the snapshot
+  ASSERT_FALSE(loaded.Put("key1", "1"));
+  ASSERT_TRUE(loaded.Put("key1000", "7000"));
+  ASSERT_TRUE(loaded.Remove("key2"));
+  ASSERT_FALSE(loaded.Get("key2", &value));
+  ASSERT_TRUE(loaded.Put("key2", "2"));
+  ASSERT_TRUE(loaded.Remove("key3"));
+
+  // dumped over the file mapped, then read by another store as records
+  ASSERT_TRUE(loaded.Dump("store_snapshot.pb"));
+  LocalStore records;
+  ASSERT_TRUE(records.Init("dump_format=record"));
+  records.LoadData("store_snapshot.pb");
+  ASSERT_TRUE(records.Dump("store_records.pb"));
+  ASSERT_FALSE(Snapshot::IsSnapshot("store_records.pb"));
+
+  LocalStore reloaded;
+  ASSERT_TRUE(reloaded.Init(""));
+  reloaded.LoadData("store_records.pb");
+  ASSERT_TRUE(reloaded.Get("key1000", &value));
+  ASSERT_EQ("7000", value);
+  ASSERT_TRUE(reloaded.Get("key2", &value));
+  ASSERT_EQ("2", value);
+  ASSERT_FALSE(reloaded.Get("key3", &value));
+  ASSERT_TRUE(reloaded.Get("key999", &value));
+  ASSERT_EQ("6993", value);
+}
+
+}  // namespace tdm
@@ -52,8 +52,37 @@ bool TDMOP::Init(const std::map<std::string, std::string>& params) {
     select_config += "with_prob=" + params.find("with_prob")->second; 
   }
 
+  if ( params.end() != params.find("thread_num")) {
+    if (select_config.length() >= 1) {
+      select_config += ";";
+    }
+    select_config += "thread_num=" + params.find("thread_num")->second;
+  }
+
+  // the positive paths of the targets kept across the samples and epochs
+  if ( params.end() != params.find("path_cache_kb")) {
+    if (select_config.length() >= 1) {
+      select_config += ";";
+    }
+    select_config += "path_cache_kb=" + params.find("path_cache_kb")->second;
+  }
+
   auto tree = &tdm::DistTree::GetInstance();
   tree_ = tree;
+
+  // sample by the in memory node codes, the store is only read to build,
+  // and the workers of a host map one copy of compact_shm_dir if given
+  if (params.end() == params.find("compact_tree") ||
+      params.find("compact_tree")->second != "false") {
+    if (params.end() != params.find("compact_shm_dir")) {
+      if (!tree->ShareCompact(params.find("compact_shm_dir")->second)) {
+        printf("[WARN] Share compact tree failed, build it privately\n");
+      }
+    }
+    if (!tree->compact() && !tree->BuildCompact()) {
+      printf("[WARN] Build compact tree failed, sample by the store\n");
+    }
+  }
   selector_ = tdm::SelectorMapper::GetSelector(selector_name);
   selector_->set_dist_tree(tree);
   selector_->Init(select_config);
@@ -147,12 +176,21 @@ bool TDMOP::TDMExpandSample(xdl::io::SampleGroup *sg) {
           xdl::io::FeatureValue* new_dense_feature_value =
               new_dense_feature->add_values();
           auto id = output_ids.at(i * layer_counts_sum_ + j);
-          auto node = tree_->NodeById(id);
-          auto level = tree_->NodeLevel(tree_->KeyNo(node.key));
-		  tdm::Node t_n;
-          assert(t_n.ParseFromString(node.value));
+          float probality = 0;
+          int level = 0;
+          if (tree_->compact()) {
+            int64_t code = tree_->NodeIdToCode(id);
+            level = tree_->NodeLevel(code);
+            probality = tree_->CodeProbality(code);
+          } else {
+            auto node = tree_->NodeById(id);
+            level = tree_->NodeLevel(tree_->KeyNo(node.key));
+            tdm::Node t_n;
+            assert(t_n.ParseFromString(node.value));
+            probality = t_n.probality();
+          }
           new_dense_feature_value->set_value(
-				t_n.probality() * 1.0 / level_sample_sum_.at(level) 
+				probality * 1.0 / level_sample_sum_.at(level) 
 				* (layer_counts_.at(level) + 1));
         }
 
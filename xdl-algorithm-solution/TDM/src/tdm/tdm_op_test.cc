@@ -300,4 +300,47 @@ TEST(TdmOp, TestExpand) {
   delete ori_sg;
 }
 
+TEST(TdmOp, TestExpandPathCache) {
+  Store *store = Store::NewStore("");
+  store->LoadData("../../test/test_data/movielens_tree.pb");
+
+  DistTree &dist_tree = tdm::DistTree::GetInstance();
+  dist_tree.set_store(store);
+  ASSERT_TRUE(dist_tree.Load());
+
+  std::vector<std::set<int64_t>> id_sets(dist_tree.max_level());
+  BuildIdSets(dist_tree, id_sets);
+  ASSERT_EQ(dist_tree.max_level(), 16);
+  const int layer_counts[dist_tree.max_level()] =
+    {0, 1, 3, 7, 15, 31, 63, 127, 255, 511, 1023, 2047, 4095, 8191, 16383,
+     20708};
+  int layer_counts_sum = 0;
+  std::string layer_counts_str = "";
+  for (int c = 0; c < dist_tree.max_level(); ++c) {
+    layer_counts_sum += layer_counts[c];
+    layer_counts_str += std::to_string(layer_counts[c]) + std::string(",");
+  }
+  layer_counts_sum += dist_tree.max_level() - 1;
+  layer_counts_str.resize(layer_counts_str.size() - 1);
+  std::map<std::string, std::string> params;
+  params.insert(std::make_pair("layer_counts", layer_counts_str));
+  params.insert(std::make_pair("path_cache_kb", "1024"));
+
+  const int feature_line_num = 31, feature_num = 5, feature_value_num = 1;
+  SampleGroup ori_sg;
+  CreateSampleGroup(feature_line_num, feature_num, feature_value_num,
+      dist_tree, &ori_sg);
+
+  TDMOP tdmop;
+  ASSERT_TRUE(tdmop.Init(params));
+  // the second run reads the positive paths cached by the first
+  for (int i = 0; i < 2; ++i) {
+    SampleGroup sg;
+    sg.CopyFrom(ori_sg);
+    ASSERT_TRUE(tdmop.Run(&sg));
+    CheckResult(&ori_sg, &sg, dist_tree, id_sets, layer_counts,
+                layer_counts_sum);
+  }
+}
+
 }  // namespace tdm
@@ -0,0 +1,679 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Copyright 2018 Alibaba Inc. All Rights Reserved.
+
+#include "tdm/tree_builder.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+#include "tdm/common.h"
+#include "tdm/store_kv.pb.h"
+#include "tdm/tree.pb.h"
+
+namespace tdm {
+
+namespace {
+
+// The ids of a part of the tree meta, as the parts of the python builder
+const size_t kPartSize = 512;
+// The points a split computes in one thread at least
+const size_t kMinParallelPoints = 10000;
+
+// Plain loops over the contiguous floats, vectorized by the compiler
+float L2Distance(const float* a, const float* b, size_t dim) {
+  float sum = 0;
+  for (size_t i = 0; i < dim; ++i) {
+    float d = a[i] - b[i];
+    sum += d * d;
+  }
+  return sum;
+}
+
+void ParallelFor(size_t n, int thread_num,
+                 const std::function<void(size_t, size_t)>& func) {
+  size_t threads = std::min(static_cast<size_t>(thread_num),
+                            n / kMinParallelPoints);
+  if (threads <= 1) {
+    func(0, n);
+    return;
+  }
+
+  std::vector<std::thread> workers;
+  size_t part = (n + threads - 1) / threads;
+  for (size_t begin = 0; begin < n; begin += part) {
+    workers.push_back(std::thread(func, begin, std::min(begin + part, n)));
+  }
+  for (auto it = workers.begin(); it != workers.end(); ++it) {
+    it->join();
+  }
+}
+
+std::string MakeNodeKey(const std::string& prefix, int64_t code) {
+  std::string key(prefix);
+  unsigned char buffer[sizeof(size_t)];
+  size_t key_no = code;
+  for (int i = sizeof(size_t) - 1; i >= 0; --i) {
+    buffer[i] = key_no & 0xFF;
+    key_no >>= 8;
+  }
+  key.append(reinterpret_cast<char*>(buffer), sizeof(size_t));
+  return key;
+}
+
+}  // namespace
+
+// The output files of a worker, the nodes are sharded by the code
+class TreeBuilder::ShardWriter {
+ public:
+  ShardWriter() {
+  }
+
+  ~ShardWriter() {
+    for (auto it = files_.begin(); it != files_.end(); ++it) {
+      fclose(*it);
+    }
+  }
+
+  bool Open(const std::string& filename, int first, int num) {
+    for (int i = 0; i < num; ++i) {
+      std::string name = filename + "." + std::to_string(first + i);
+      FILE* fp = fopen(name.c_str(), "wb");
+      if (fp == NULL) {
+        std::cerr << "Open output " << name << " failed" << std::endl;
+        return false;
+      }
+      files_.push_back(fp);
+    }
+    return true;
+  }
+
+  bool Write(size_t shard, const std::string& key, const std::string& value) {
+    KVItem item;
+    item.set_key(key);
+    item.set_value(value);
+    std::string content;
+    if (!item.SerializeToString(&content)) {
+      return false;
+    }
+    int len = content.size();
+    FILE* fp = files_[shard % files_.size()];
+    return fwrite(&len, sizeof(len), 1, fp) == 1 &&
+        fwrite(content.data(), 1, len, fp) == static_cast<size_t>(len);
+  }
+
+ private:
+  std::vector<FILE*> files_;
+};
+
+TreeBuilder::TreeBuilder()
+    : branch_(2), thread_num_(1), kmeans_iter_(10), batch_size_(1024),
+      key_prefix_(), shard_num_(1), worker_num_(1), worker_id_(0), seed_(0),
+      with_embedding_(true), dim_(0), max_level_(0), worker_level_(0),
+      max_leaf_id_(-1) {
+}
+
+bool TreeBuilder::Init(const std::string& config) {
+  auto conf = ParseConfig(config);
+  auto int_value = [&conf](const std::string& key, int* value) {
+    auto it = conf.find(key);
+    if (it != conf.end()) {
+      *value = atoi(it->second.c_str());
+    }
+  };
+  int_value("branch", &branch_);
+  int_value("thread_num", &thread_num_);
+  int_value("kmeans_iter", &kmeans_iter_);
+  int_value("batch_size", &batch_size_);
+  int_value("shard_num", &shard_num_);
+  int_value("worker_num", &worker_num_);
+  int_value("worker_id", &worker_id_);
+  int seed = 0;
+  int_value("seed", &seed);
+  seed_ = seed;
+  if (conf.find("key_prefix") != conf.end()) {
+    key_prefix_ = conf["key_prefix"];
+  }
+  if (conf.find("with_embedding") != conf.end()) {
+    with_embedding_ = conf["with_embedding"] != "false";
+  }
+
+  if (branch_ < 2 || thread_num_ < 1 || kmeans_iter_ < 0 ||
+      batch_size_ < 1 || shard_num_ < 1 || worker_num_ < 1 ||
+      worker_id_ < 0 || worker_id_ >= worker_num_) {
+    std::cerr << "Invalid tree builder config: " << config << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool TreeBuilder::LoadItems(const std::string& filename) {
+  std::ifstream in(filename.c_str());
+  if (!in) {
+    std::cerr << "Open items " << filename << " failed" << std::endl;
+    return false;
+  }
+
+  std::string line;
+  std::vector<float> embed;
+  size_t line_no = 0;
+  while (std::getline(in, line)) {
+    ++line_no;
+    if (line.empty()) {
+      continue;
+    }
+    auto cols = tdm::Split(line, "\t");
+    if (cols.size() < 2) {
+      std::cerr << "Invalid item line " << line_no << std::endl;
+      return false;
+    }
+    int64_t id = strtoll(cols[0].c_str(), NULL, 10);
+    float probality = cols.size() > 2 ? strtof(cols[2].c_str(), NULL) : 1;
+    auto values = tdm::Split(cols[1], ",");
+    embed.resize(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+      embed[i] = strtof(values[i].c_str(), NULL);
+    }
+    if (!AddItem(id, probality, embed)) {
+      std::cerr << "Invalid item line " << line_no << std::endl;
+      return false;
+    }
+  }
+
+  std::cout << "Load items successfully, item count: " << ids_.size()
+            << ", dimension: " << dim_ << std::endl;
+  return true;
+}
+
+bool TreeBuilder::AddItem(int64_t id, float probality,
+                          const std::vector<float>& embed) {
+  if (embed.empty() || (dim_ != 0 && embed.size() != dim_)) {
+    return false;
+  }
+  dim_ = embed.size();
+  ids_.push_back(id);
+  probs_.push_back(probality);
+  embeddings_.insert(embeddings_.end(), embed.begin(), embed.end());
+  return true;
+}
+
+int64_t TreeBuilder::LevelStart(int level) const {
+  int64_t start = 0;
+  for (int i = 0; i < level; ++i) {
+    start = start * branch_ + 1;
+  }
+  return start;
+}
+
+int64_t TreeBuilder::InternalId(int64_t code) const {
+  return max_leaf_id_ + 1 + code;
+}
+
+bool TreeBuilder::IsOwner(const Task& task) const {
+  if (task.level < worker_level_) {
+    return true;
+  }
+  int64_t code = task.code;
+  for (int level = task.level; level > worker_level_; --level) {
+    code = (code - 1) / branch_;
+  }
+  return (code - LevelStart(worker_level_)) % worker_num_ == worker_id_;
+}
+
+bool TreeBuilder::Build() {
+  size_t n = ids_.size();
+  if (n == 0) {
+    std::cerr << "Build tree failed, no items" << std::endl;
+    return false;
+  }
+
+  int depth = 0;
+  size_t capacity = 1;
+  while (capacity < n) {
+    capacity *= branch_;
+    ++depth;
+  }
+  depth = std::max(depth, 1);
+  max_level_ = depth + 1;
+
+  // the first level of worker_num nodes, and the first of enough nodes for
+  // the threads to build the subtrees apart
+  worker_level_ = 0;
+  int64_t level_nodes = 1;
+  while (worker_level_ < depth && level_nodes < worker_num_) {
+    level_nodes *= branch_;
+    ++worker_level_;
+  }
+  int parallel_level = worker_level_;
+  while (parallel_level < depth && level_nodes < 4 * thread_num_) {
+    level_nodes *= branch_;
+    ++parallel_level;
+  }
+
+  max_leaf_id_ = *std::max_element(ids_.begin(), ids_.end());
+  order_.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    order_[i] = i;
+  }
+  codes_.assign(n, -1);
+  top_tasks_.clear();
+  worker_tasks_.clear();
+
+  // the top levels split by all the threads
+  std::vector<Task> tasks(1, Task{0, 0, 0, n});
+  for (int level = 0; level < parallel_level; ++level) {
+    std::vector<Task> next;
+    for (auto it = tasks.begin(); it != tasks.end(); ++it) {
+      if (level < worker_level_) {
+        top_tasks_.push_back(*it);
+      } else if (level == worker_level_) {
+        worker_tasks_.push_back(*it);
+      }
+      if (IsOwner(*it)) {
+        Split(*it, thread_num_, &next);
+      }
+    }
+    tasks.swap(next);
+    std::cout << "Split level " << level << " successfully" << std::endl;
+  }
+  if (parallel_level == worker_level_) {
+    worker_tasks_ = tasks;
+  }
+
+  // the subtrees below by a thread each
+  std::vector<Task> owned;
+  for (auto it = tasks.begin(); it != tasks.end(); ++it) {
+    if (IsOwner(*it)) {
+      owned.push_back(*it);
+    }
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num_; ++t) {
+    threads.push_back(std::thread([this, t, &owned]() {
+      for (size_t i = t; i < owned.size(); i += thread_num_) {
+        BuildSubtree(owned[i]);
+      }
+    }));
+  }
+  for (auto it = threads.begin(); it != threads.end(); ++it) {
+    it->join();
+  }
+
+  std::cout << "Build tree successfully, max level: " << max_level_
+            << ", worker level: " << worker_level_ << std::endl;
+  return true;
+}
+
+void TreeBuilder::BuildSubtree(const Task& task) {
+  std::vector<Task> stack(1, task);
+  while (!stack.empty()) {
+    Task t = stack.back();
+    stack.pop_back();
+    Split(t, 1, &stack);
+  }
+}
+
+void TreeBuilder::Split(const Task& task, int thread_num,
+                        std::vector<Task>* children) {
+  size_t n = task.end - task.begin;
+  if (task.level == max_level_ - 1) {
+    codes_[order_[task.begin]] = task.code;
+    return;
+  }
+
+  // the children as equal as possible, the larger ones on the left
+  std::vector<size_t> sizes(branch_, n / branch_);
+  for (size_t i = 0; i < n % branch_; ++i) {
+    ++sizes[i];
+  }
+
+  size_t* idx = order_.data() + task.begin;
+  std::vector<int> groups(n);
+  if (n <= static_cast<size_t>(branch_)) {
+    for (size_t i = 0; i < n; ++i) {
+      groups[i] = i;
+    }
+  } else {
+    BalancedCluster(idx, n, sizes, task.code, thread_num, &groups);
+  }
+
+  // the items of the children contiguous
+  std::vector<size_t> offsets(branch_ + 1, 0);
+  for (int i = 0; i < branch_; ++i) {
+    offsets[i + 1] = offsets[i] + sizes[i];
+  }
+  std::vector<size_t> sorted(n);
+  std::vector<size_t> pos(offsets.begin(), offsets.end() - 1);
+  for (size_t i = 0; i < n; ++i) {
+    sorted[pos[groups[i]]++] = idx[i];
+  }
+  std::copy(sorted.begin(), sorted.end(), idx);
+
+  for (int i = 0; i < branch_; ++i) {
+    if (sizes[i] > 0) {
+      children->push_back(Task{task.code * branch_ + 1 + i, task.level + 1,
+                               task.begin + offsets[i],
+                               task.begin + offsets[i + 1]});
+    }
+  }
+}
+
+void TreeBuilder::BalancedCluster(const size_t* idx, size_t n,
+                                  const std::vector<size_t>& sizes,
+                                  int64_t code, int thread_num,
+                                  std::vector<int>* groups) {
+  size_t k = sizes.size();
+  // seeded by the node, the same on all the workers
+  std::mt19937 rng(seed_ ^ static_cast<uint32_t>(code * 2654435761u));
+  std::uniform_int_distribution<size_t> pick(0, n - 1);
+
+  // k-means++ seeds from a sample
+  size_t sample_num = std::min(n, std::max<size_t>(batch_size_, 64 * k));
+  std::vector<size_t> sample(sample_num);
+  for (size_t i = 0; i < sample_num; ++i) {
+    sample[i] = idx[pick(rng)];
+  }
+  std::vector<float> centroids(k * dim_);
+  std::vector<float> min_dist(sample_num, std::numeric_limits<float>::max());
+  size_t chosen = sample[0];
+  for (size_t c = 0; c < k; ++c) {
+    std::copy(Embedding(chosen), Embedding(chosen) + dim_,
+              centroids.begin() + c * dim_);
+    double total = 0;
+    for (size_t i = 0; i < sample_num; ++i) {
+      min_dist[i] = std::min(min_dist[i], L2Distance(
+          Embedding(sample[i]), centroids.data() + c * dim_, dim_));
+      total += min_dist[i];
+    }
+    if (total <= 0) {
+      chosen = sample[pick(rng) % sample_num];
+      continue;
+    }
+    double r = std::uniform_real_distribution<double>(0, total)(rng);
+    size_t i = 0;
+    for (; i + 1 < sample_num && r > min_dist[i]; ++i) {
+      r -= min_dist[i];
+    }
+    chosen = sample[i];
+  }
+
+  // mini-batch updates, each center moves by the inverse of its count
+  auto nearest = [this, &centroids, k](const float* x) {
+    size_t best = 0;
+    float best_dist = std::numeric_limits<float>::max();
+    for (size_t c = 0; c < k; ++c) {
+      float d = L2Distance(x, centroids.data() + c * dim_, dim_);
+      if (d < best_dist) {
+        best_dist = d;
+        best = c;
+      }
+    }
+    return best;
+  };
+  std::vector<size_t> counts(k, 0);
+  size_t batch = std::min(n, static_cast<size_t>(batch_size_));
+  std::vector<size_t> batch_points(batch);
+  std::vector<size_t> batch_groups(batch);
+  for (int iter = 0; iter < kmeans_iter_; ++iter) {
+    for (size_t i = 0; i < batch; ++i) {
+      batch_points[i] = idx[pick(rng)];
+      batch_groups[i] = nearest(Embedding(batch_points[i]));
+    }
+    for (size_t i = 0; i < batch; ++i) {
+      size_t c = batch_groups[i];
+      float eta = 1.0 / ++counts[c];
+      float* center = centroids.data() + c * dim_;
+      const float* x = Embedding(batch_points[i]);
+      for (size_t d = 0; d < dim_; ++d) {
+        center[d] += eta * (x[d] - center[d]);
+      }
+    }
+  }
+
+  // the distances of all the points by the threads
+  std::vector<float> dists(n * k);
+  ParallelFor(n, thread_num, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      for (size_t c = 0; c < k; ++c) {
+        dists[i * k + c] = L2Distance(Embedding(idx[i]),
+                                      centroids.data() + c * dim_, dim_);
+      }
+    }
+  });
+
+  std::vector<size_t> points(n);
+  for (size_t i = 0; i < n; ++i) {
+    points[i] = i;
+  }
+  if (k == 2) {
+    // the points closer to the first center by the most go to it
+    std::nth_element(points.begin(), points.begin() + sizes[0], points.end(),
+                     [&dists](size_t a, size_t b) {
+      return dists[a * 2] - dists[a * 2 + 1] < dists[b * 2] - dists[b * 2 + 1];
+    });
+    for (size_t i = 0; i < n; ++i) {
+      (*groups)[points[i]] = i < sizes[0] ? 0 : 1;
+    }
+    return;
+  }
+
+  // the points preferring their nearest center by the most choose first,
+  // the others take their nearest center with room left
+  std::vector<float> margins(n);
+  for (size_t i = 0; i < n; ++i) {
+    const float* d = dists.data() + i * k;
+    float best = std::numeric_limits<float>::max();
+    float second = std::numeric_limits<float>::max();
+    for (size_t c = 0; c < k; ++c) {
+      if (d[c] < best) {
+        second = best;
+        best = d[c];
+      } else if (d[c] < second) {
+        second = d[c];
+      }
+    }
+    margins[i] = second - best;
+  }
+  std::sort(points.begin(), points.end(), [&margins](size_t a, size_t b) {
+    return margins[a] > margins[b];
+  });
+  std::vector<size_t> room(sizes);
+  std::vector<size_t> centers(k);
+  for (auto it = points.begin(); it != points.end(); ++it) {
+    const float* d = dists.data() + *it * k;
+    for (size_t c = 0; c < k; ++c) {
+      centers[c] = c;
+    }
+    std::sort(centers.begin(), centers.end(), [d](size_t a, size_t b) {
+      return d[a] < d[b];
+    });
+    for (size_t c = 0; c < k; ++c) {
+      if (room[centers[c]] > 0) {
+        --room[centers[c]];
+        (*groups)[*it] = centers[c];
+        break;
+      }
+    }
+  }
+}
+
+bool TreeBuilder::WriteNode(int64_t code, int64_t id, bool is_leaf,
+                            float probality, const std::vector<float>& embed,
+                            ShardWriter* writer) const {
+  Node node;
+  node.set_id(id);
+  node.set_probality(probality);
+  node.set_leaf_cate_id(0);
+  node.set_is_leaf(is_leaf);
+  if (with_embedding_) {
+    for (auto it = embed.begin(); it != embed.end(); ++it) {
+      node.add_embed_vec(*it);
+    }
+  }
+  std::string value;
+  if (!node.SerializeToString(&value)) {
+    return false;
+  }
+  return writer->Write(code % shard_num_, MakeNodeKey(key_prefix_, code),
+                       value);
+}
+
+void TreeBuilder::WriteRange(int64_t code, size_t begin, size_t end,
+                             ShardWriter* writer) const {
+  std::vector<float> embed(dim_, 0);
+  float probality = 0;
+  for (size_t i = begin; i < end; ++i) {
+    const float* x = Embedding(order_[i]);
+    for (size_t d = 0; d < dim_; ++d) {
+      embed[d] += x[d];
+    }
+    probality += probs_[order_[i]];
+  }
+  for (size_t d = 0; d < dim_; ++d) {
+    embed[d] /= end - begin;
+  }
+  WriteNode(code, InternalId(code), false, probality, embed, writer);
+}
+
+bool TreeBuilder::Dump(const std::string& filename) {
+  if (max_level_ == 0) {
+    std::cerr << "Dump tree failed, tree is not built" << std::endl;
+    return false;
+  }
+
+  ShardWriter writer;
+  if (!writer.Open(filename, worker_id_ * shard_num_, shard_num_)) {
+    return false;
+  }
+
+  // the internal nodes of a subtree aggregate its leaves in the code
+  // order, one node of each level at a time
+  struct Aggregate {
+    int64_t code;
+    size_t count;
+    float probality;
+    std::vector<float> embed;
+  };
+  int leaf_level = max_level_ - 1;
+  auto flush = [&](Aggregate* agg) {
+    if (agg->count > 0) {
+      for (size_t d = 0; d < dim_; ++d) {
+        agg->embed[d] /= agg->count;
+      }
+      WriteNode(agg->code, InternalId(agg->code), false, agg->probality,
+                agg->embed, &writer);
+    }
+    agg->count = 0;
+    agg->probality = 0;
+    agg->embed.assign(dim_, 0);
+  };
+
+  IdCodePart part;
+  int part_no = 0;
+  auto flush_part = [&]() {
+    if (part.id_code_list_size() == 0) {
+      return;
+    }
+    part.set_part_id(key_prefix_ + ".part." + std::to_string(worker_id_) +
+                     "." + std::to_string(part_no++));
+    std::string value;
+    part.SerializeToString(&value);
+    writer.Write(0, part.part_id(), value);
+    part.Clear();
+  };
+
+  std::vector<float> leaf_embed(dim_);
+  for (auto it = worker_tasks_.begin(); it != worker_tasks_.end(); ++it) {
+    if (!IsOwner(*it)) {
+      continue;
+    }
+    std::vector<Aggregate> aggs(leaf_level);
+    for (int level = it->level; level < leaf_level; ++level) {
+      aggs[level].code = -1;
+      aggs[level].count = 0;
+      aggs[level].probality = 0;
+      aggs[level].embed.assign(dim_, 0);
+    }
+    for (size_t i = it->begin; i < it->end; ++i) {
+      size_t item = order_[i];
+      int64_t code = codes_[item];
+      const float* x = Embedding(item);
+      leaf_embed.assign(x, x + dim_);
+      WriteNode(code, ids_[item], true, probs_[item], leaf_embed, &writer);
+
+      auto id_code = part.add_id_code_list();
+      id_code->set_id(ids_[item]);
+      id_code->set_code(code);
+      if (static_cast<size_t>(part.id_code_list_size()) >= kPartSize) {
+        flush_part();
+      }
+
+      for (int level = leaf_level - 1; level >= it->level; --level) {
+        code = (code - 1) / branch_;
+        Aggregate& agg = aggs[level];
+        if (agg.code != code) {
+          flush(&agg);
+          agg.code = code;
+        }
+        ++agg.count;
+        agg.probality += probs_[item];
+        for (size_t d = 0; d < dim_; ++d) {
+          agg.embed[d] += x[d];
+        }
+      }
+    }
+    for (int level = it->level; level < leaf_level; ++level) {
+      flush(&aggs[level]);
+    }
+  }
+  flush_part();
+
+  if (worker_id_ == 0) {
+    for (auto it = top_tasks_.begin(); it != top_tasks_.end(); ++it) {
+      WriteRange(it->code, it->begin, it->end, &writer);
+    }
+
+    // the parts of worker w are named by the leaves of its subtrees
+    TreeMeta meta;
+    meta.set_max_level(max_level_);
+    std::vector<size_t> leaf_counts(worker_num_, 0);
+    for (auto it = worker_tasks_.begin(); it != worker_tasks_.end(); ++it) {
+      int64_t index = it->code - LevelStart(worker_level_);
+      leaf_counts[index % worker_num_] += it->end - it->begin;
+    }
+    for (int w = 0; w < worker_num_; ++w) {
+      size_t part_num = (leaf_counts[w] + kPartSize - 1) / kPartSize;
+      for (size_t j = 0; j < part_num; ++j) {
+        meta.add_id_code_part(key_prefix_ + ".part." + std::to_string(w) +
+                              "." + std::to_string(j));
+      }
+    }
+    std::string value;
+    meta.SerializeToString(&value);
+    writer.Write(0, key_prefix_ + ".tree_meta", value);
+  }
+
+  std::cout << "Dump tree successfully, worker " << worker_id_ << std::endl;
+  return true;
+}
+
+}  // namespace tdm
@@ -0,0 +1,147 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Copyright 2018 Alibaba Inc. All Rights Reserved.
+
+#ifndef TDM_TREE_BUILDER_H_
+#define TDM_TREE_BUILDER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace tdm {
+
+// Builds the tree of DistTree from the item embeddings by the balanced
+// hierarchical k-means, each node splits its items into branch clusters of
+// equal size by the mini-batch k-means, so that the leaves are the items at
+// the last level, packed from the left.
+//
+// Config, separated by ';':
+//   branch=2            the children of a node
+//   thread_num=1        the threads clustering the subtrees
+//   kmeans_iter=10      the mini-batch iterations of a split
+//   batch_size=1024     the items of a mini-batch
+//   key_prefix=         the key prefix of the tree in the store
+//   shard_num=1         the output files of a worker
+//   worker_num=1        the workers building the tree together
+//   worker_id=0         the worker of this builder
+//   seed=0              the random seed, the same on all the workers
+//   with_embedding=true whether the nodes keep the embeddings
+//
+// The workers load the same items and split the top levels the same way,
+// then each builds the subtrees of the first level holding worker_num
+// nodes round robin, so that the workers run on different machines and
+// their outputs Store::LoadData into one tree.
+class TreeBuilder {
+ public:
+  TreeBuilder();
+
+  bool Init(const std::string& config);
+
+  // Lines of "item_id<TAB>v1,v2,...[<TAB>probality]", the probality is 1
+  // if absent
+  bool LoadItems(const std::string& filename);
+  bool AddItem(int64_t id, float probality, const std::vector<float>& embed);
+
+  // Assign the codes of the items
+  bool Build();
+
+  // Write the nodes, the id code parts and the tree meta of the worker in
+  // the Store::LoadData format, to filename.<worker_id * shard_num + i>
+  // for each shard i
+  bool Dump(const std::string& filename);
+
+  int max_level() const {
+    return max_level_;
+  }
+
+  size_t item_size() const {
+    return ids_.size();
+  }
+
+  // The code of the i-th item, -1 if it is built by another worker
+  int64_t code(size_t i) const {
+    return codes_[i];
+  }
+
+ private:
+  // The items of order_[begin, end) under the node of code
+  struct Task {
+    int64_t code;
+    int level;
+    size_t begin;
+    size_t end;
+  };
+
+  class ShardWriter;
+
+  // Split the items of task to its children, leave them contiguous in
+  // order_ by the child, append the non empty children to children
+  void Split(const Task& task, int thread_num, std::vector<Task>* children);
+  // Split the subtree of task down to the leaves
+  void BuildSubtree(const Task& task);
+  // Cluster n points of idx into sizes.size() groups of the sizes
+  void BalancedCluster(const size_t* idx, size_t n,
+                       const std::vector<size_t>& sizes, int64_t code,
+                       int thread_num, std::vector<int>* groups);
+
+  bool IsOwner(const Task& task) const;
+  int64_t LevelStart(int level) const;
+  int64_t InternalId(int64_t code) const;
+  const float* Embedding(size_t i) const {
+    return embeddings_.data() + i * dim_;
+  }
+
+  // Write the node of code aggregated from the items of [begin, end)
+  void WriteRange(int64_t code, size_t begin, size_t end,
+                  ShardWriter* writer) const;
+  bool WriteNode(int64_t code, int64_t id, bool is_leaf, float probality,
+                 const std::vector<float>& embed, ShardWriter* writer) const;
+
+  int branch_;
+  int thread_num_;
+  int kmeans_iter_;
+  int batch_size_;
+  std::string key_prefix_;
+  int shard_num_;
+  int worker_num_;
+  int worker_id_;
+  uint32_t seed_;
+  bool with_embedding_;
+
+  size_t dim_;
+  std::vector<int64_t> ids_;
+  std::vector<float> probs_;
+  std::vector<float> embeddings_;
+
+  int max_level_;
+  // the level of the subtrees split among the workers
+  int worker_level_;
+  int64_t max_leaf_id_;
+  std::vector<size_t> order_;
+  std::vector<int64_t> codes_;
+  // the nodes above worker_level_, and those of worker_level_
+  std::vector<Task> top_tasks_;
+  std::vector<Task> worker_tasks_;
+};
+
+}  // namespace tdm
+
+#endif  // TDM_TREE_BUILDER_H_
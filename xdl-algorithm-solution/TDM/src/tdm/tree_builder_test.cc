@@ -0,0 +1,120 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Copyright 2018 Alibaba Inc. All Rights Reserved.
+
+#include "tdm/tree_builder.h"
+
+#include <stdlib.h>
+
+#include "gtest/gtest.h"
+
+#include "tdm/dist_tree.h"
+#include "tdm/local_store.h"
+#include "tdm/tree.pb.h"
+
+namespace tdm {
+
+namespace {
+
+void AddItems(TreeBuilder* builder, size_t count) {
+  srand(7);
+  std::vector<float> embed(8);
+  for (size_t i = 0; i < count; ++i) {
+    for (size_t d = 0; d < embed.size(); ++d) {
+      // two far apart clusters by the first dimension
+      embed[d] = (rand() % 1000) / 1000.0 + (d == 0 && i % 2 ? 10 : 0);
+    }
+    ASSERT_TRUE(builder->AddItem(i + 1, 1.0, embed));
+  }
+}
+
+}  // namespace
+
+TEST(TreeBuilder, TestBuild) {
+  TreeBuilder builder;
+  ASSERT_TRUE(builder.Init("branch=2;thread_num=4;key_prefix=builder;"
+                           "shard_num=2;kmeans_iter=5;batch_size=128"));
+  AddItems(&builder, 1000);
+  ASSERT_TRUE(builder.Build());
+  ASSERT_EQ(11, builder.max_level());
+  ASSERT_TRUE(builder.Dump("tree_builder.pb"));
+
+  // the far apart clusters split at the root
+  int64_t first = (builder.code(0) + 1) >> (builder.max_level() - 2);
+  for (size_t i = 0; i < builder.item_size(); ++i) {
+    ASSERT_GE(builder.code(i), (1 << 10) - 1);
+    int64_t top = (builder.code(i) + 1) >> (builder.max_level() - 2);
+    ASSERT_EQ(i % 2 == 0, top == first);
+  }
+
+  LocalStore store;
+  ASSERT_TRUE(store.Init(""));
+  store.LoadData("tree_builder.pb.0");
+  store.LoadData("tree_builder.pb.1");
+  DistTree tree("builder", 2, &store);
+  ASSERT_EQ(11, tree.max_level());
+  for (int64_t id = 1; id <= 1000; ++id) {
+    TreeNode node = tree.NodeById(id);
+    ASSERT_TRUE(tree.Valid(node));
+    Node n;
+    ASSERT_TRUE(n.ParseFromString(node.value));
+    ASSERT_TRUE(n.is_leaf());
+    ASSERT_EQ(8, n.embed_vec_size());
+    ASSERT_EQ(10u, tree.Ancestors(node).size());
+  }
+
+  Node root;
+  ASSERT_TRUE(root.ParseFromString(tree.Node(tree.MakeKey(0)).value));
+  ASSERT_FALSE(root.is_leaf());
+  ASSERT_FLOAT_EQ(1000.0, root.probality());
+  ASSERT_EQ(1001, root.id());
+}
+
+TEST(TreeBuilder, TestWorkers) {
+  TreeBuilder single;
+  ASSERT_TRUE(single.Init("branch=4;key_prefix=workers;seed=3"));
+  AddItems(&single, 3000);
+  ASSERT_TRUE(single.Build());
+  ASSERT_TRUE(single.Dump("tree_workers.pb"));
+
+  LocalStore store;
+  ASSERT_TRUE(store.Init(""));
+  for (int w = 0; w < 3; ++w) {
+    TreeBuilder builder;
+    ASSERT_TRUE(builder.Init("branch=4;key_prefix=workers;seed=3;"
+                             "worker_num=3;thread_num=2;worker_id=" +
+                             std::to_string(w)));
+    AddItems(&builder, 3000);
+    ASSERT_TRUE(builder.Build());
+    ASSERT_TRUE(builder.Dump("tree_workers.pb"));
+    store.LoadData("tree_workers.pb." + std::to_string(w));
+    for (size_t i = 0; i < builder.item_size(); ++i) {
+      if (builder.code(i) != -1) {
+        ASSERT_EQ(single.code(i), builder.code(i));
+      }
+    }
+  }
+
+  DistTree tree("workers", 4, &store);
+  ASSERT_EQ(single.max_level(), tree.max_level());
+  for (size_t i = 0; i < single.item_size(); ++i) {
+    TreeNode node = tree.NodeById(i + 1);
+    ASSERT_TRUE(tree.Valid(node));
+    ASSERT_EQ(single.code(i), static_cast<int64_t>(tree.KeyNo(node.key)));
+  }
+}
+
+}  // namespace tdm
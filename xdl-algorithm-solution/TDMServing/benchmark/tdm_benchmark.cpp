@@ -14,11 +14,16 @@ limitations under the License.
 ==============================================================================*/
 
 #include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <algorithm>
+#include <random>
 #include <string>
 #include <vector>
 #include <map>
 #include <fstream>
 #include "api/search_manager.h"
+#include "util/stage_stat.h"
 #include "util/str_util.h"
 #include "util/log.h"
 #include "util/timer.h"
@@ -137,39 +142,272 @@ bool MakeRequests(std::vector<SearchParam>* reqs, uint32_t topn) {
   return true;
 }
 
+// Log-linear latency histogram in micros, every power of two range
+// is split into 32 buckets, so that a percentile is within 3%
+class LatencyHistogram {
+ public:
+  static const int kSubBucketBits = 5;
+  static const int kSubBucketNum = 1 << kSubBucketBits;
+  static const int kBucketNum = 64 * kSubBucketNum;
+
+  LatencyHistogram() : buckets_(kBucketNum, 0), count_(0), sum_(0),
+      max_(0) {
+  }
+
+  void Record(uint64_t micros) {
+    buckets_[Index(micros)]++;
+    count_++;
+    sum_ += micros;
+    max_ = std::max(max_, micros);
+  }
+
+  void Merge(const LatencyHistogram& other) {
+    for (int i = 0; i < kBucketNum; ++i) {
+      buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+  }
+
+  // upper bound of the percentile p in [0, 100]
+  uint64_t Percentile(double p) const {
+    uint64_t target = static_cast<uint64_t>(count_ * p / 100);
+    uint64_t cumulative = 0;
+    for (int i = 0; i < kBucketNum; ++i) {
+      cumulative += buckets_[i];
+      if (cumulative > target) {
+        return std::min(UpperBound(i), max_);
+      }
+    }
+    return max_;
+  }
+
+  uint64_t count() const {
+    return count_;
+  }
+
+  double mean() const {
+    return count_ == 0 ? 0 : static_cast<double>(sum_) / count_;
+  }
+
+  uint64_t max() const {
+    return max_;
+  }
+
+ private:
+  static int Index(uint64_t value) {
+    if (value < static_cast<uint64_t>(kSubBucketNum)) {
+      return value;
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - kSubBucketBits;
+    return ((shift + 1) << kSubBucketBits) +
+        ((value >> shift) & (kSubBucketNum - 1));
+  }
+
+  static uint64_t UpperBound(int index) {
+    if (index < kSubBucketNum) {
+      return index;
+    }
+    int shift = (index >> kSubBucketBits) - 1;
+    uint64_t sub = index & (kSubBucketNum - 1);
+    return ((kSubBucketNum + sub + 1) << shift) - 1;
+  }
+
+  std::vector<uint64_t> buckets_;
+  uint64_t count_;
+  uint64_t sum_;
+  uint64_t max_;
+};
+
 struct ThreadInfo {
   pthread_t thread_id;
   std::vector<SearchParam>* reqs;
   SearchManager* search_manager;
   uint32_t topn;
   uint32_t loop_num;
+
+  // open loop, the arrival rate of the thread and the run window
+  double qps;
+  double start_time;
+  double end_time;
+  uint32_t seed;
+
+  LatencyHistogram histogram;
+  uint64_t failed_num;
 };
 
+bool SearchOnce(ThreadInfo* ti, size_t i) {
+  SearchResult res;
+  if (!ti->search_manager->Search(ti->reqs->at(i % ti->reqs->size()),
+                                  &res)) {
+    LOG_ERROR << "search failed";
+    return false;
+  }
+
+  if (res.result_unit_size() > static_cast<int>(ti->topn)) {
+    LOG_ERROR << "result size > topn";
+    return false;
+  }
+  return true;
+}
+
+// Closed loop, issues the next search once the last one returns
 void* BenchThreadProc(void* data) {
   ThreadInfo* ti = reinterpret_cast<ThreadInfo*>(data);
 
   for (size_t i = 0; i < ti->loop_num; i++) {
-    // Search
-    SearchResult res;
-    if (!ti->search_manager->Search(ti->reqs->at(i), &res)) {
-      LOG_ERROR << "search failed";
+    double start = util::GetTime();
+    if (!SearchOnce(ti, i)) {
+      ti->failed_num++;
       return NULL;
     }
+    ti->histogram.Record((util::GetTime() - start) * 1e6);
 
-    if (res.result_unit_size() > static_cast<int>(ti->topn)) {
-      LOG_ERROR << "result size > topn";
-      return NULL;
+    LOG_INFO << "loop count: " << i;
+  }
+
+  return NULL;
+}
+
+// Open loop, the searches arrive by a poisson process of rate qps
+// whether the last one returned or not. The latency is counted from
+// the arrival, so that the queueing is in the tail when it saturates.
+void* OpenLoopThreadProc(void* data) {
+  ThreadInfo* ti = reinterpret_cast<ThreadInfo*>(data);
+
+  std::mt19937 rng(ti->seed);
+  std::exponential_distribution<double> interval(ti->qps);
+
+  double arrival = ti->start_time;
+  for (size_t i = ti->seed; ; i++) {
+    arrival += interval(rng);
+    if (arrival >= ti->end_time) {
+      break;
     }
 
-    LOG_INFO << "loop count: " << i;
+    double now = util::GetTime();
+    if (arrival > now) {
+      usleep(static_cast<useconds_t>((arrival - now) * 1e6));
+    }
+
+    if (!SearchOnce(ti, i)) {
+      ti->failed_num++;
+      continue;
+    }
+    ti->histogram.Record((util::GetTime() - arrival) * 1e6);
   }
 
   return NULL;
 }
 
-void Benchmark(uint32_t topn,
-               uint32_t thread_num,
-               uint32_t loop_num) {
+struct BenchResult {
+  double offered_qps;
+  double achieved_qps;
+  LatencyHistogram histogram;
+  uint64_t failed_num;
+};
+
+void RunThreads(void* (*proc)(void*), std::vector<ThreadInfo>* thread_infos,
+                BenchResult* result) {
+  util::Timer timer;
+  timer.Start();
+
+  for (size_t i = 0; i < thread_infos->size(); i++) {
+    pthread_create(&thread_infos->at(i).thread_id, NULL,
+                   proc, &thread_infos->at(i));
+  }
+
+  for (size_t i = 0; i < thread_infos->size(); i++) {
+    pthread_join(thread_infos->at(i).thread_id, NULL);
+  }
+
+  timer.Stop();
+
+  result->failed_num = 0;
+  for (size_t i = 0; i < thread_infos->size(); i++) {
+    result->histogram.Merge(thread_infos->at(i).histogram);
+    result->failed_num += thread_infos->at(i).failed_num;
+  }
+  result->achieved_qps = result->histogram.count() / timer.GetTotalTime();
+}
+
+void Report(const BenchResult& result) {
+  const LatencyHistogram& histogram = result.histogram;
+  LOG_INFO << "offered qps=" << result.offered_qps
+           << " achieved qps=" << result.achieved_qps
+           << " searches=" << histogram.count()
+           << " failed=" << result.failed_num;
+  LOG_INFO << "latency(us) mean=" << histogram.mean()
+           << " p50=" << histogram.Percentile(50)
+           << " p90=" << histogram.Percentile(90)
+           << " p99=" << histogram.Percentile(99)
+           << " p999=" << histogram.Percentile(99.9)
+           << " max=" << histogram.max();
+}
+
+// Average micros of the stages per search
+void ReportStages(uint64_t search_num) {
+  if (search_num == 0) {
+    return;
+  }
+  util::StageStat& stage_stat = util::StageStat::Instance();
+  for (int stage = 0; stage < util::kSearchStageNum; ++stage) {
+    util::SearchStage search_stage = static_cast<util::SearchStage>(stage);
+    for (uint32_t level = 0; level < util::StageStat::kMaxLevel; ++level) {
+      if (stage_stat.count(search_stage, level) == 0) {
+        continue;
+      }
+      LOG_INFO << "stage " << util::StageStat::StageName(search_stage)
+               << " level " << level << " avg time(us)="
+               << stage_stat.total_time(search_stage, level) * 1e6 /
+                  search_num;
+    }
+  }
+}
+
+struct BenchParam {
+  // closed, open or sweep
+  std::string mode;
+  uint32_t topn;
+  uint32_t thread_num;
+  // closed loop
+  uint32_t loop_num;
+  // open loop and sweep
+  double qps;
+  double duration;
+  double sweep_begin;
+  double sweep_end;
+  double sweep_step;
+  // time the search stages
+  bool stage;
+};
+
+BenchResult OpenLoop(const BenchParam& param, double qps,
+                     std::vector<SearchParam>* reqs,
+                     SearchManager* search_manager) {
+  double start_time = util::GetTime();
+  std::vector<ThreadInfo> thread_infos(param.thread_num);
+  for (size_t i = 0; i < thread_infos.size(); i++) {
+    ThreadInfo& thread_info = thread_infos[i];
+    thread_info.reqs = reqs;
+    thread_info.search_manager = search_manager;
+    thread_info.topn = param.topn;
+    thread_info.qps = qps / param.thread_num;
+    thread_info.start_time = start_time;
+    thread_info.end_time = start_time + param.duration;
+    thread_info.seed = i;
+    thread_info.failed_num = 0;
+  }
+
+  BenchResult result;
+  result.offered_qps = qps;
+  RunThreads(&OpenLoopThreadProc, &thread_infos, &result);
+  return result;
+}
+
+void Benchmark(const BenchParam& param) {
   bool ret = false;
 
   // Init SearchManager
@@ -183,54 +421,152 @@ void Benchmark(uint32_t topn,
 
   // MakeSearchRequests
   std::vector<SearchParam> reqs;
-  if (!MakeRequests(&reqs, topn)) {
+  if (!MakeRequests(&reqs, param.topn)) {
     LOG_ERROR << "Make requests failed";
     return;
   }
+  if (reqs.empty()) {
+    LOG_ERROR << "No requests";
+    return;
+  }
+
+  util::StageStat::Instance().set_enabled(param.stage);
+
+  if (param.mode == "open") {
+    BenchResult result = OpenLoop(param, param.qps, &reqs, &search_manager);
+    Report(result);
+    ReportStages(result.histogram.count());
+    return;
+  }
+
+  if (param.mode == "sweep") {
+    // the knee is the first rate the servers fall behind, or whose p99
+    // is far above the one of the lowest rate
+    double base_p99 = 0;
+    double knee_qps = 0;
+    for (double qps = param.sweep_begin; qps <= param.sweep_end;
+         qps += param.sweep_step) {
+      util::StageStat::Instance().Reset();
+      BenchResult result = OpenLoop(param, qps, &reqs, &search_manager);
+      Report(result);
+      ReportStages(result.histogram.count());
+
+      double p99 = result.histogram.Percentile(99);
+      if (base_p99 == 0) {
+        base_p99 = p99;
+      }
+      if (knee_qps == 0 && (result.achieved_qps < qps * 0.95 ||
+                            p99 > base_p99 * 3)) {
+        knee_qps = qps;
+      }
+    }
+    if (knee_qps > 0) {
+      LOG_INFO << "saturation knee at qps=" << knee_qps;
+    } else {
+      LOG_INFO << "no saturation knee up to qps=" << param.sweep_end;
+    }
+    return;
+  }
 
   // Parallel Search
-  std::vector<ThreadInfo> thread_infos;
-  for (size_t i = 0; i < thread_num; i++) {
-    thread_infos.push_back(ThreadInfo());
-    ThreadInfo& thread_info = thread_infos.back();
+  std::vector<ThreadInfo> thread_infos(param.thread_num);
+  for (size_t i = 0; i < thread_infos.size(); i++) {
+    ThreadInfo& thread_info = thread_infos[i];
     thread_info.reqs = &reqs;
     thread_info.search_manager = &search_manager;
-    thread_info.topn = topn;
-    thread_info.loop_num = loop_num;
+    thread_info.topn = param.topn;
+    thread_info.loop_num = param.loop_num;
+    thread_info.failed_num = 0;
   }
 
-  util::Timer timer;
-  timer.Start();
+  BenchResult result;
+  result.offered_qps = 0;
+  RunThreads(&BenchThreadProc, &thread_infos, &result);
 
-  for (size_t i = 0; i < thread_num; i++) {
-    pthread_create(&thread_infos[i].thread_id, NULL,
-                   &BenchThreadProc, &thread_infos[i]);
-  }
+  LOG_INFO << "query per second" << result.achieved_qps;
+  Report(result);
+  ReportStages(result.histogram.count());
+}
 
-  for (size_t i = 0; i < thread_num; i++) {
-    pthread_join(thread_infos[i].thread_id, NULL);
+// Parse the key=value args into param
+bool ParseArgs(int argc, char** argv, BenchParam* param) {
+  for (int i = 1; i < argc; ++i) {
+    std::vector<std::string> kv;
+    util::StrUtil::Split(argv[i], '=', true, &kv);
+    if (kv.size() != 2) {
+      LOG_ERROR << "illegal arg: " << argv[i];
+      return false;
+    }
+    const std::string& key = kv[0];
+    const char* value = kv[1].c_str();
+    bool ret = false;
+    if (key == "mode") {
+      param->mode = kv[1];
+      ret = true;
+    } else if (key == "topn") {
+      ret = util::StrUtil::StrConvert<uint32_t>(value, &param->topn);
+    } else if (key == "thread_num") {
+      ret = util::StrUtil::StrConvert<uint32_t>(value, &param->thread_num);
+    } else if (key == "loop_num") {
+      ret = util::StrUtil::StrConvert<uint32_t>(value, &param->loop_num);
+    } else if (key == "qps") {
+      ret = util::StrUtil::StrConvert<double>(value, &param->qps);
+    } else if (key == "duration") {
+      ret = util::StrUtil::StrConvert<double>(value, &param->duration);
+    } else if (key == "sweep_begin") {
+      ret = util::StrUtil::StrConvert<double>(value, &param->sweep_begin);
+    } else if (key == "sweep_end") {
+      ret = util::StrUtil::StrConvert<double>(value, &param->sweep_end);
+    } else if (key == "sweep_step") {
+      ret = util::StrUtil::StrConvert<double>(value, &param->sweep_step);
+    } else if (key == "stage") {
+      ret = util::StrUtil::StrConvert<bool>(value, &param->stage);
+    }
+    if (!ret) {
+      LOG_ERROR << "illegal arg: " << argv[i];
+      return false;
+    }
   }
 
-  timer.Stop();
-
-  LOG_INFO << "Elapsed time=" << timer.GetElapsedTime();
-  LOG_INFO << "Avg time=" << timer.GetElapsedTime() / loop_num;
-  LOG_INFO << "query per second" << (loop_num * thread_num) / timer.GetElapsedTime();
+  if (param->mode != "closed" && param->mode != "open" &&
+      param->mode != "sweep") {
+    LOG_ERROR << "illegal mode: " << param->mode;
+    return false;
+  }
+  if (param->thread_num == 0 || param->qps <= 0 || param->duration <= 0 ||
+      param->sweep_step <= 0) {
+    LOG_ERROR << "thread_num, qps, duration and sweep_step must be positive";
+    return false;
+  }
+  return true;
 }
 
 }  // namespace tdm_serving
 
-int main(int /*argc*/, char** /*argv*/) {
+// Usage: tdm_benchmark [key=value]...
+//   mode=closed|open|sweep, topn, thread_num, loop_num (closed),
+//   qps, duration (open), sweep_begin, sweep_end, sweep_step (sweep),
+//   stage=1 to time the search stages
+int main(int argc, char** argv) {
   LOG_CONFIG("tdm_benchmark", ".", 0);
 
-  uint32_t search_topn = 200;
-  uint32_t paralle_thread_num = 2;
-  uint32_t loop_num_per_thread = 1000;
+  tdm_serving::BenchParam param;
+  param.mode = "closed";
+  param.topn = 200;
+  param.thread_num = 2;
+  param.loop_num = 1000;
+  param.qps = 100;
+  param.duration = 10;
+  param.sweep_begin = 100;
+  param.sweep_end = 1000;
+  param.sweep_step = 100;
+  param.stage = false;
+
+  if (!tdm_serving::ParseArgs(argc, argv, &param)) {
+    return 1;
+  }
 
-  tdm_serving::Benchmark(search_topn,
-                         paralle_thread_num,
-                         loop_num_per_thread);
+  tdm_serving::Benchmark(param);
 
   return 0;
 }
-
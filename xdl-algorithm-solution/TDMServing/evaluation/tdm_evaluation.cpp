@@ -13,6 +13,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <pthread.h>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <map>
@@ -20,6 +22,7 @@ limitations under the License.
 #include "api/search_manager.h"
 #include "util/str_util.h"
 #include "util/log.h"
+#include "util/timer.h"
 #include "proto/search.pb.h"
 
 namespace tdm_serving {
@@ -138,17 +141,127 @@ void DoEvaluate(const SearchResult& res,
     *f1_score = 2 * *precision * *recall / (*precision + *recall);
   }
 
-  LOG_INFO << "gt_num: " << gt_num;
-  LOG_INFO << "hit_num: " << hit_num;
+  LOG_DEBUG << "gt_num: " << gt_num << " hit_num: " << hit_num
+            << " precision: " << *precision << " recall: " << *recall
+            << " f1_score: " << *f1_score;
+}
+
+struct EvalParam {
+  uint32_t topn;
+  uint32_t loop_num;
+  uint32_t thread_num;
+  uint32_t batch_size;
+  std::string sample_file_path;
+};
+
+// The samples are read by the threads in turn, each searches and
+// evaluates its samples and sums the metrics of them apart
+struct EvalThreadInfo {
+  pthread_t thread_id;
+  SearchManager* search_manager;
+  std::ifstream* sample_file_handler;
+  std::mutex* sample_mutex;
+  uint32_t* loop_idx;
+  const EvalParam* param;
+
+  double total_precision;
+  double total_recall;
+  double total_f1_score;
+  uint32_t sample_num;
+  bool failed;
+};
+
+// Take the next sample line, false once loop_num samples are taken
+bool NextSample(EvalThreadInfo* ti, std::string* line) {
+  std::unique_lock<std::mutex> lock(*ti->sample_mutex);
+  if (*ti->loop_idx >= ti->param->loop_num ||
+      !std::getline(*ti->sample_file_handler, *line)) {
+    return false;
+  }
+  (*ti->loop_idx)++;
+  if (*ti->loop_idx % 1000 == 0) {
+    LOG_INFO << "loop: " << *ti->loop_idx;
+  }
+  return true;
+}
 
-  LOG_INFO << "precision: " << *precision;
-  LOG_INFO << "recall: " << *recall;
-  LOG_INFO << "f1_score: " << *f1_score;
+// Search for the requests, by one batch search of them
+// if there are more than one
+bool SearchBatch(EvalThreadInfo* ti,
+                 const std::vector<SearchParam>& reqs,
+                 std::vector<SearchResult>* results) {
+  if (reqs.size() == 1) {
+    results->resize(1);
+    return ti->search_manager->Search(reqs[0], &results->at(0));
+  }
+  return ti->search_manager->BatchSearch(reqs, results);
 }
 
+void* EvalThreadProc(void* data) {
+  EvalThreadInfo* ti = reinterpret_cast<EvalThreadInfo*>(data);
+  uint32_t topn = ti->param->topn;
+  uint32_t batch_size = ti->param->batch_size;
+
+  std::string line;
+  std::vector<SearchParam> reqs;
+  std::vector<std::map<std::string, float> > gt_kv_maps;
+  std::vector<SearchResult> results;
+  while (true) {
+    reqs.clear();
+    gt_kv_maps.clear();
+    while (reqs.size() < batch_size && NextSample(ti, &line)) {
+      reqs.resize(reqs.size() + 1);
+      gt_kv_maps.resize(gt_kv_maps.size() + 1);
+      SearchParam& req = reqs.back();
+
+      // Make Search Request
+      if (!SampleToRequest(line, &req, &gt_kv_maps.back())) {
+        LOG_ERROR << "parse sample [" << line << "] to request failed";
+        ti->failed = true;
+        return NULL;
+      }
+
+      req.set_topn(topn);
+      req.set_index_name("item_tree_index");
+
+      LOG_DEBUG << "tdm reqeust: " << req.DebugString();
+    }
+    if (reqs.empty()) {
+      break;
+    }
+
+    // Search
+    if (!SearchBatch(ti, reqs, &results)) {
+      LOG_ERROR << "search failed";
+      ti->failed = true;
+      return NULL;
+    }
+
+    for (size_t i = 0; i < results.size(); ++i) {
+      const SearchResult& res = results[i];
+      if (res.result_unit_size() > static_cast<int>(topn)) {
+        LOG_ERROR << "result size > topn";
+        ti->failed = true;
+        return NULL;
+      }
+
+      // Evaluate
+      float precision;
+      float recall;
+      float f1_score;
+
+      DoEvaluate(res, topn, gt_kv_maps[i], &precision, &recall, &f1_score);
+      ti->total_precision += precision;
+      ti->total_recall += recall;
+      ti->total_f1_score += f1_score;
+      ti->sample_num++;
+    }
+  }
+
+  return NULL;
+}
 
-void SearchEvaluate(uint32_t topn,
-                    uint32_t loop_num) {
+void SearchEvaluate(const EvalParam& param) {
   bool ret = false;
 
   // Init SearchManager
@@ -160,70 +273,69 @@ void SearchEvaluate(uint32_t topn,
     return;
   }
 
-  std::string sample_file_path = "./eval_data/userbehavoir_test_sample.dat";
-  std::ifstream sample_file_handler(sample_file_path.c_str());
+  std::ifstream sample_file_handler(param.sample_file_path.c_str());
 
   if (!sample_file_handler) {
-    LOG_ERROR << "open " << sample_file_path << " failed";
+    LOG_ERROR << "open " << param.sample_file_path << " failed";
     return;
   }
 
-  float total_precision = 0;
-  float total_recall = 0;
-  float total_f1_score = 0;
-
-  size_t loop_idx = 0;
-  std::string line;
-
-  while (std::getline(sample_file_handler, line)) {
-    SearchParam req;
-    std::map<std::string, float> gt_kv_map;
-
-    // Make Search Request
-    if (!SampleToRequest(line, &req, &gt_kv_map)) {
-      LOG_ERROR << "parse sample [" << line << "] to request failed";
-      return;
-    }
-
-    req.set_topn(topn);
-    req.set_index_name("item_tree_index");
-
-    LOG_DEBUG << "tdm reqeust: " << req.DebugString();
-
-    // Search
-    SearchResult res;
-    if (!search_manager.Search(req, &res)) {
-      LOG_ERROR << "search failed";
-      return;
-    }
+  util::Timer timer;
+  timer.Start();
+
+  std::mutex sample_mutex;
+  uint32_t loop_idx = 0;
+  std::vector<EvalThreadInfo> thread_infos(param.thread_num);
+  for (size_t i = 0; i < thread_infos.size(); i++) {
+    EvalThreadInfo& thread_info = thread_infos[i];
+    thread_info.search_manager = &search_manager;
+    thread_info.sample_file_handler = &sample_file_handler;
+    thread_info.sample_mutex = &sample_mutex;
+    thread_info.loop_idx = &loop_idx;
+    thread_info.param = &param;
+    thread_info.total_precision = 0;
+    thread_info.total_recall = 0;
+    thread_info.total_f1_score = 0;
+    thread_info.sample_num = 0;
+    thread_info.failed = false;
+    pthread_create(&thread_info.thread_id, NULL,
+                   &EvalThreadProc, &thread_info);
+  }
 
-    if (res.result_unit_size() > static_cast<int>(topn)) {
-      LOG_ERROR << "result size > topn";
-      return;
+  double total_precision = 0;
+  double total_recall = 0;
+  double total_f1_score = 0;
+  uint32_t sample_num = 0;
+  for (size_t i = 0; i < thread_infos.size(); i++) {
+    EvalThreadInfo& thread_info = thread_infos[i];
+    pthread_join(thread_info.thread_id, NULL);
+    if (thread_info.failed) {
+      ret = false;
     }
+    total_precision += thread_info.total_precision;
+    total_recall += thread_info.total_recall;
+    total_f1_score += thread_info.total_f1_score;
+    sample_num += thread_info.sample_num;
+  }
 
-    // Evaluate
-    float precision;
-    float recall;
-    float f1_score;
-
-    DoEvaluate(res, topn, gt_kv_map, &precision, &recall, &f1_score);
-    total_precision += precision;
-    total_recall += recall;
-    total_f1_score += f1_score;
+  timer.Stop();
 
-    loop_idx++;
-    LOG_INFO << "loop: " << loop_idx;
-    if (loop_idx == loop_num) {
-      break;
-    }
+  if (!ret) {
+    LOG_ERROR << "evaluate failed";
+    return;
+  }
+  if (sample_num == 0) {
+    LOG_ERROR << "no sample evaluated";
+    return;
   }
 
-  // Evaluate
-  float avg_precision = total_precision / loop_num;
-  float avg_recall = total_recall / loop_num;
-  float avg_f1_score = total_f1_score / loop_num;
+  // Evaluate, averaged over the samples evaluated
+  double avg_precision = total_precision / sample_num;
+  double avg_recall = total_recall / sample_num;
+  double avg_f1_score = total_f1_score / sample_num;
 
+  LOG_INFO << "samples: " << sample_num
+           << " samples per second: " << sample_num / timer.GetTotalTime();
   LOG_INFO << "avg_precision: " << avg_precision;
   LOG_INFO << "avg_recall: " << avg_recall;
   LOG_INFO << "avg_f1_score: " << avg_f1_score;
@@ -231,17 +343,66 @@ void SearchEvaluate(uint32_t topn,
   return;
 }
 
+// Parse the key=value args into param
+bool ParseArgs(int argc, char** argv, EvalParam* param) {
+  for (int i = 1; i < argc; ++i) {
+    std::vector<std::string> kv;
+    util::StrUtil::Split(argv[i], '=', true, &kv);
+    if (kv.size() != 2) {
+      LOG_ERROR << "illegal arg: " << argv[i];
+      return false;
+    }
+    const std::string& key = kv[0];
+    const char* value = kv[1].c_str();
+    bool ret = false;
+    if (key == "topn") {
+      ret = util::StrUtil::StrConvert<uint32_t>(value, &param->topn);
+    } else if (key == "loop_num") {
+      ret = util::StrUtil::StrConvert<uint32_t>(value, &param->loop_num);
+    } else if (key == "thread_num") {
+      ret = util::StrUtil::StrConvert<uint32_t>(value, &param->thread_num);
+    } else if (key == "batch_size") {
+      ret = util::StrUtil::StrConvert<uint32_t>(value, &param->batch_size);
+    } else if (key == "sample_file") {
+      param->sample_file_path = kv[1];
+      ret = true;
+    }
+    if (!ret) {
+      LOG_ERROR << "illegal arg: " << argv[i];
+      return false;
+    }
+  }
+  if (param->thread_num == 0) {
+    LOG_ERROR << "thread_num must be positive";
+    return false;
+  }
+  if (param->batch_size == 0) {
+    LOG_ERROR << "batch_size must be positive";
+    return false;
+  }
+  return true;
+}
+
 }  // namespace tdm_serving
 
-int main(int /*argc*/, char** /*argv*/) {
+// Usage: tdm_evaluation [topn=200] [loop_num=10000] [thread_num=1]
+//                       [batch_size=1] [sample_file=...]
+// each thread searches for batch_size samples at once, the candidates
+// of a tree level scored for all of them by one model predict
+int main(int argc, char** argv) {
   LOG_CONFIG("tdm_evaluation", ".", 0);
 
-  uint32_t search_topn = 200;
-  uint32_t loop_num = 10000;
+  tdm_serving::EvalParam param;
+  param.topn = 200;
+  param.loop_num = 10000;
+  param.thread_num = 1;
+  param.batch_size = 1;
+  param.sample_file_path = "./eval_data/userbehavoir_test_sample.dat";
+  if (!tdm_serving::ParseArgs(argc, argv, &param)) {
+    return 1;
+  }
 
-  tdm_serving::SearchEvaluate(search_topn, loop_num);
+  tdm_serving::SearchEvaluate(param);
 
   return 0;
 }
-
-
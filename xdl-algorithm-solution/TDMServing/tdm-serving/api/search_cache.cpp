@@ -0,0 +1,137 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "api/search_cache.h"
+#include <tr1/functional>
+#include "util/timer.h"
+#include "util/log.h"
+
+namespace tdm_serving {
+
+SearchCache::SearchCache() : shard_capacity_(0), ttl_(0) {
+}
+
+SearchCache::~SearchCache() {
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    DELETE_AND_SET_NULL(shards_[i]);
+  }
+  shards_.clear();
+}
+
+bool SearchCache::Init(uint32_t capacity, uint32_t ttl_ms,
+                       uint32_t shard_num) {
+  if (capacity == 0 || ttl_ms == 0 || shard_num == 0) {
+    LOG_ERROR << "Search cache init with illegal capacity: " << capacity
+              << ", ttl_ms: " << ttl_ms << ", shard_num: " << shard_num;
+    return false;
+  }
+
+  if (shard_num > capacity) {
+    shard_num = capacity;
+  }
+  for (uint32_t i = 0; i < shard_num; ++i) {
+    shards_.push_back(new Shard);
+  }
+  shard_capacity_ = (capacity + shard_num - 1) / shard_num;
+  ttl_ = ttl_ms * 1e-3;
+
+  LOG_INFO << "Search cache init, capacity: " << capacity
+           << ", ttl_ms: " << ttl_ms << ", shard_num: " << shard_num;
+  return true;
+}
+
+bool SearchCache::Get(const std::string& key, const std::string& version,
+                      SearchResult* search_result) {
+  Shard* shard = GetShard(key);
+  util::SimpleMutex::Locker slock(&shard->mutex);
+
+  std::tr1::unordered_map<std::string, EntryList::iterator>::iterator iter =
+      shard->key_to_entry.find(key);
+  if (iter == shard->key_to_entry.end()) {
+    return false;
+  }
+
+  EntryList::iterator entry = iter->second;
+  if (entry->version != version || entry->expire_time < util::GetTime()) {
+    shard->entries.erase(entry);
+    shard->key_to_entry.erase(iter);
+    return false;
+  }
+
+  shard->entries.splice(shard->entries.begin(), shard->entries, entry);
+  search_result->CopyFrom(entry->search_result);
+  return true;
+}
+
+void SearchCache::Put(const std::string& key, const std::string& version,
+                      const SearchResult& search_result) {
+  Shard* shard = GetShard(key);
+  util::SimpleMutex::Locker slock(&shard->mutex);
+
+  std::tr1::unordered_map<std::string, EntryList::iterator>::iterator iter =
+      shard->key_to_entry.find(key);
+  if (iter != shard->key_to_entry.end()) {
+    shard->entries.erase(iter->second);
+    shard->key_to_entry.erase(iter);
+  }
+
+  // evict the least recently used
+  while (shard->entries.size() >= shard_capacity_) {
+    shard->key_to_entry.erase(shard->entries.back().key);
+    shard->entries.pop_back();
+  }
+
+  shard->entries.push_front(Entry());
+  Entry& entry = shard->entries.front();
+  entry.key = key;
+  entry.version = version;
+  entry.expire_time = util::GetTime() + ttl_;
+  entry.search_result.CopyFrom(search_result);
+  shard->key_to_entry[key] = shard->entries.begin();
+}
+
+size_t SearchCache::size() {
+  size_t size = 0;
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    util::SimpleMutex::Locker slock(&shards_[i]->mutex);
+    size += shards_[i]->entries.size();
+  }
+  return size;
+}
+
+void SearchCache::Clear() {
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    util::SimpleMutex::Locker slock(&shards_[i]->mutex);
+    shards_[i]->entries.clear();
+    shards_[i]->key_to_entry.clear();
+  }
+}
+
+bool SearchCache::MakeKey(const SearchParam& search_param,
+                          std::string* key) {
+  // the same user features and params serialize to the same bytes
+  if (!search_param.SerializeToString(key)) {
+    LOG_WARN << "Search cache serialize search param failed";
+    return false;
+  }
+  return true;
+}
+
+SearchCache::Shard* SearchCache::GetShard(const std::string& key) {
+  size_t hash = std::tr1::hash<std::string>()(key);
+  return shards_[hash % shards_.size()];
+}
+
+}  // namespace tdm_serving
@@ -0,0 +1,87 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TDM_SERVING_API_SEARCH_CACHE_H_
+#define TDM_SERVING_API_SEARCH_CACHE_H_
+
+#include <list>
+#include <string>
+#include <tr1/unordered_map>
+#include <vector>
+#include "common/common_def.h"
+#include "util/concurrency/mutex.h"
+#include "proto/search.pb.h"
+
+namespace tdm_serving {
+
+// Bounded LRU cache of the search results, sharded by the key hash
+// so that the concurrent searches seldom contend on a lock.
+// An entry misses once it expires, or once the index or model
+// version it is searched with is switched out.
+class SearchCache {
+ public:
+  SearchCache();
+  ~SearchCache();
+
+  // capacity: max entries of all shards, ttl_ms: lifetime of an entry
+  bool Init(uint32_t capacity, uint32_t ttl_ms,
+            uint32_t shard_num = kSearchCacheShardNum);
+
+  // Get the result cached for key and version, false if miss
+  bool Get(const std::string& key, const std::string& version,
+           SearchResult* search_result);
+
+  // Cache the result of key searched with version
+  void Put(const std::string& key, const std::string& version,
+           const SearchResult& search_result);
+
+  // Get cached entry num
+  size_t size();
+
+  void Clear();
+
+  // Get the cache key of a search request
+  static bool MakeKey(const SearchParam& search_param, std::string* key);
+
+ private:
+  struct Entry {
+    std::string key;
+    std::string version;
+    double expire_time;
+    SearchResult search_result;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  struct Shard {
+    util::SimpleMutex mutex;
+    // the recently used first
+    EntryList entries;
+    std::tr1::unordered_map<std::string, EntryList::iterator> key_to_entry;
+  };
+
+  Shard* GetShard(const std::string& key);
+
+ private:
+  std::vector<Shard*> shards_;
+  uint32_t shard_capacity_;
+  double ttl_;
+
+  DISALLOW_COPY_AND_ASSIGN(SearchCache);
+};
+
+}  // namespace tdm_serving
+
+#endif  // TDM_SERVING_API_SEARCH_CACHE_H_
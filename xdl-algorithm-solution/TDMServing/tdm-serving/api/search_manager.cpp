@@ -14,17 +14,22 @@ limitations under the License.
 ==============================================================================*/
 
 #include "api/search_manager.h"
+#include "api/search_cache.h"
 #include "index/index_manager.h"
+#include "index/index.h"
 #include "model/model_manager.h"
+#include "model/model.h"
 #include "biz/filter_manager.h"
+#include "util/conf_parser.h"
 #include "util/log.h"
 
 namespace tdm_serving {
 
-SearchManager::SearchManager() {
+SearchManager::SearchManager() : search_cache_(NULL) {
 }
 
 SearchManager::~SearchManager() {
+  DELETE_AND_SET_NULL(search_cache_);
 }
 
 bool SearchManager::Init(const std::string& index_conf_path,
@@ -52,6 +57,73 @@ bool SearchManager::Init(const std::string& index_conf_path,
     return false;
   }
 
+  ret = InitSearchCache(index_conf_path);
+  if (ret == false) {
+    LOG_ERROR << "Search cache init failed";
+    return false;
+  }
+
+  return true;
+}
+
+bool SearchManager::InitSearchCache(const std::string& index_conf_path) {
+  if (search_cache_ != NULL) {
+    return true;
+  }
+
+  util::ConfParser conf_parser;
+  if (!conf_parser.Init(index_conf_path)) {
+    LOG_ERROR << "Search cache load conf from "
+              << "[" << index_conf_path << "] failed";
+    return false;
+  }
+
+  bool enable = false;
+  uint32_t capacity = 100000;
+  uint32_t ttl_ms = 1000;
+  conf_parser.GetValue<bool>(kSearchCacheSection, kConfigEnable,
+                             false, &enable);
+  conf_parser.GetValue<uint32_t>(kSearchCacheSection, kConfigCacheCapacity,
+                                 100000, &capacity);
+  conf_parser.GetValue<uint32_t>(kSearchCacheSection, kConfigCacheTtlMs,
+                                 1000, &ttl_ms);
+  LOG_INFO << "[" << kSearchCacheSection << "] "
+           << kConfigEnable << ": " << enable << ", "
+           << kConfigCacheCapacity << ": " << capacity << ", "
+           << kConfigCacheTtlMs << ": " << ttl_ms;
+  if (!enable) {
+    return true;
+  }
+
+  SearchCache* search_cache = new SearchCache();
+  if (!search_cache->Init(capacity, ttl_ms)) {
+    delete search_cache;
+    return false;
+  }
+  search_cache_ = search_cache;
+
+  return true;
+}
+
+bool SearchManager::GetSearchVersion(const SearchParam& search_param,
+                                     std::string* version) {
+  IndexHandle index =
+      IndexManager::Instance().GetIndex(search_param.index_name());
+  if (index == NULL) {
+    return false;
+  }
+  *version = index->index_version();
+
+  const std::string& model_name = index->model_name();
+  if (!model_name.empty()) {
+    ModelHandle model = ModelManager::Instance().GetModel(
+        model_name, index->model_version());
+    if (model == NULL) {
+      return false;
+    }
+    version->append("/");
+    version->append(model->model_version());
+  }
   return true;
 }
 
@@ -62,6 +134,18 @@ bool SearchManager::Search(const SearchParam& search_param,
     return false;
   }
 
+  // the repeated requests of a user are served by the cached result
+  std::string cache_key;
+  std::string cache_version;
+  bool use_cache = search_cache_ != NULL &&
+      GetSearchVersion(search_param, &cache_version) &&
+      SearchCache::MakeKey(search_param, &cache_key);
+  if (use_cache &&
+      search_cache_->Get(cache_key, cache_version, search_result)) {
+    LOG_DEBUG << "Search cache hit";
+    return true;
+  }
+
   search_result->set_res_code(RC_SUCCESS);
 
   if (!IndexManager::Instance().Search(search_param, search_result)) {
@@ -70,6 +154,37 @@ bool SearchManager::Search(const SearchParam& search_param,
     return false;
   }
 
+  if (use_cache) {
+    search_cache_->Put(cache_key, cache_version, *search_result);
+  }
+
+  return true;
+}
+
+bool SearchManager::BatchSearch(const std::vector<SearchParam>& search_params,
+                                std::vector<SearchResult>* search_results) {
+  if (search_results == NULL) {
+    LOG_ERROR << "search_results is NULL";
+    return false;
+  }
+
+  search_results->resize(search_params.size());
+  std::vector<const SearchParam*> params;
+  std::vector<SearchResult*> results;
+  for (size_t i = 0; i < search_params.size(); ++i) {
+    search_results->at(i).set_res_code(RC_SUCCESS);
+    params.push_back(&search_params[i]);
+    results.push_back(&search_results->at(i));
+  }
+
+  if (!IndexManager::Instance().BatchSearch(params, results)) {
+    LOG_ERROR << "Index Manager batch search failed";
+    for (size_t i = 0; i < results.size(); ++i) {
+      results[i]->set_res_code(RC_SEARCH_ERROR);
+    }
+    return false;
+  }
+
   return true;
 }
 
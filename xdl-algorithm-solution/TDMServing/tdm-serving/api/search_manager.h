@@ -17,11 +17,13 @@ limitations under the License.
 #define TDM_SERVING_API_SEARCH_MANAGER_H_
 
 #include <string>
+#include <vector>
 
 namespace tdm_serving {
 
 class SearchParam;
 class SearchResult;
+class SearchCache;
 
 // User interface
 class SearchManager {
@@ -38,6 +40,8 @@ class SearchManager {
   // @param index_conf_path: index conf file path
   // @param model_conf_path: model conf file path
   // @param filter_conf_path: filter conf file path
+  // the results are cached if the [search_cache] section
+  // of the index conf is enabled
   // @Return True: success False: failed
   bool Init(const std::string& index_conf_path,
             const std::string& model_conf_path,
@@ -48,6 +52,25 @@ class SearchManager {
   // @param search_result: search response
   bool Search(const SearchParam& search_param,
               SearchResult* search_result);
+
+  // Batch search interface, the searches of the users of one index
+  // score the candidates of a level by one model predict, uncached
+  // @param search_params: search requests
+  // @param search_results: search responses, one for each request
+  bool BatchSearch(const std::vector<SearchParam>& search_params,
+                   std::vector<SearchResult>* search_results);
+
+ private:
+  bool InitSearchCache(const std::string& index_conf_path);
+
+  // Get the index and model versions the request is searched with,
+  // which invalidate the cached results once switched
+  bool GetSearchVersion(const SearchParam& search_param,
+                        std::string* version);
+
+ private:
+  // cache of the recent results, NULL if disabled
+  SearchCache* search_cache_;
 };
 
 }  // namespace tdm_serving
@@ -41,6 +41,9 @@ bool Filter::IsFiltered(const FilterInfo* filter_info,
   return false;
 }
 
+uint64_t Filter::PassCategoryMask(const FilterInfo* /*filter_info*/) {
+  return kAllCategoryMask;
+}
 
 
 }  // namespace tdm_serving
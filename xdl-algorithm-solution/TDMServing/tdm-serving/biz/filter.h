@@ -39,6 +39,11 @@ class Filter {
   virtual bool IsFiltered(const FilterInfo* filter_info,
                           const Item& item);
 
+  // Mask of the category bits of the items which may pass the filter,
+  // the tree search prunes the subtrees whose leaves have none of them.
+  // All by default, a filter not by category prunes nothing.
+  virtual uint64_t PassCategoryMask(const FilterInfo* filter_info);
+
   // Get filter_name
   const std::string& filter_name() {
     return filter_name_;
@@ -18,6 +18,8 @@ limitations under the License.
 namespace tdm_serving {
 
 const std::string kMetaSection = "meta";
+const std::string kBlazeSchedulerSection = "blaze_scheduler";
+const std::string kSearchCacheSection = "search_cache";
 
 const std::string kConfigEnable = "enable";
 const std::string kConfigIndexType = "type";
@@ -28,13 +30,19 @@ const std::string kConfigIndexBuildOmp = "build_thread_num";
 const std::string kConfigModelType = "type";
 const std::string kConfigModelPath = "model_path";
 const std::string kConfigFilterType = "type";
+const std::string kConfigEnableBatching = "enable_batching";
+const std::string kConfigMaxBatchSize = "max_batch_size";
+const std::string kConfigBatchTimeoutMicros = "batch_timeout_micros";
+const std::string kConfigCacheCapacity = "capacity";
+const std::string kConfigCacheTtlMs = "ttl_ms";
 
 const std::string kVersionFile = "version";
 const std::string kIndexVersionTag = "index_version=";
 const std::string kModelVersionTag = "model_version=";
 
-const uint32_t kIndexInstanceNum = 2;
 const uint32_t kModelInstanceNum = 2;
+const uint32_t kPreAllocSearchContextNum = 50;
+const uint32_t kSearchCacheShardNum = 16;
 
 const uint32_t ktObjectPoolInitSize = 50;
 
@@ -22,6 +22,8 @@ limitations under the License.
 namespace tdm_serving {
 
 extern const std::string kMetaSection;
+extern const std::string kBlazeSchedulerSection;
+extern const std::string kSearchCacheSection;
 
 extern const std::string kConfigEnable;
 extern const std::string kConfigIndexType;
@@ -32,13 +34,19 @@ extern const std::string kConfigIndexBuildOmp;
 extern const std::string kConfigModelType;
 extern const std::string kConfigModelPath;
 extern const std::string kConfigFilterType;
+extern const std::string kConfigEnableBatching;
+extern const std::string kConfigMaxBatchSize;
+extern const std::string kConfigBatchTimeoutMicros;
+extern const std::string kConfigCacheCapacity;
+extern const std::string kConfigCacheTtlMs;
 
 extern const std::string kVersionFile;
 extern const std::string kIndexVersionTag;
 extern const std::string kModelVersionTag;
 
-extern const uint32_t kIndexInstanceNum;
 extern const uint32_t kModelInstanceNum;
+extern const uint32_t kPreAllocSearchContextNum;
+extern const uint32_t kSearchCacheShardNum;
 
 extern const uint32_t ktObjectPoolInitSize;
 
@@ -0,0 +1,32 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "index/ann/ann_def.h"
+
+namespace tdm_serving {
+
+const std::string kConfigAnnUserVectorFeatureGroupId =
+    "user_vector_feature_group_id";
+const std::string kConfigAnnListNum = "ann_list_num";
+const std::string kConfigAnnProbeNum = "ann_probe_num";
+const std::string kConfigAnnTrainIter = "ann_train_iter";
+
+const uint32_t kDefaultAnnListNum = 256;
+const uint32_t kDefaultAnnProbeNum = 16;
+const uint32_t kDefaultAnnTrainIter = 10;
+
+const std::string kAnnEmbeddingFileName = "embedding.dat";
+
+}  // namespace tdm_serving
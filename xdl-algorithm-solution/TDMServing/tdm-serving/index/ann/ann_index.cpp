@@ -0,0 +1,236 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "index/ann/ann_index.h"
+#include <fstream>
+#include "biz/filter.h"
+#include "index/ann/ann_def.h"
+#include "index/ann/ann_index_conf.h"
+#include "index/item.h"
+#include "util/str_util.h"
+#include "util/object_free_list.h"
+#include "util/top_k.h"
+#include "util/log.h"
+
+namespace tdm_serving {
+
+namespace {
+
+// a retrieved item for the filters
+class AnnItem : public Item {
+ public:
+  AnnItem(uint64_t id, float score) : id_(id), score_(score) {}
+
+  virtual uint64_t item_id() const {
+    return id_;
+  }
+
+  virtual float score() const {
+    return score_;
+  }
+
+ private:
+  uint64_t id_;
+  float score_;
+};
+
+}  // namespace
+
+AnnIndex::AnnIndex() : ann_index_conf_(NULL) {
+}
+
+AnnIndex::~AnnIndex() {
+}
+
+bool AnnIndex::Init(const IndexConf* index_conf) {
+  ann_index_conf_ = static_cast<const AnnIndexConf*>(index_conf);
+
+  const std::string& section = ann_index_conf_->section();
+
+  if (!Index::Init(index_conf)) {
+    LOG_ERROR << "[" << section << "] Index::Init failed";
+    return false;
+  }
+
+  // load embeddings
+  std::string file_path =
+      ann_index_conf_->latest_index_path() + "/" + kAnnEmbeddingFileName;
+  std::vector<uint64_t> ids;
+  std::vector<float> embeddings;
+  uint32_t dim = 0;
+  if (!LoadEmbeddings(file_path, &ids, &embeddings, &dim)) {
+    LOG_ERROR << "[" << section << "] load embeddings from "
+              << file_path << " failed";
+    return false;
+  }
+
+  // build ivf
+  if (!ivf_.Build(ids, embeddings, dim, ann_index_conf_->list_num(),
+                  ann_index_conf_->train_iter())) {
+    LOG_ERROR << "[" << section << "] build ivf failed";
+    return false;
+  }
+
+  return true;
+}
+
+bool AnnIndex::LoadEmbeddings(const std::string& file_path,
+                              std::vector<uint64_t>* ids,
+                              std::vector<float>* embeddings,
+                              uint32_t* dim) {
+  std::ifstream file_handler(file_path.c_str());
+  if (!file_handler) {
+    LOG_ERROR << "open " << file_path << " failed";
+    return false;
+  }
+
+  std::string line;
+  std::vector<std::string> split_1;
+  std::vector<std::string> split_2;
+  while (std::getline(file_handler, line)) {
+    util::StrUtil::Split(line, '\t', true, &split_1);
+    if (split_1.empty()) {
+      continue;
+    }
+    if (split_1.size() != 2) {
+      LOG_ERROR << "embedding field size != 2, line: " << line;
+      return false;
+    }
+
+    uint64_t id = 0;
+    if (!util::StrUtil::StrConvert<uint64_t>(split_1[0].c_str(), &id)) {
+      LOG_ERROR << "item id is not number, line: " << line;
+      return false;
+    }
+
+    util::StrUtil::Split(split_1[1], ',', true, &split_2);
+    if (ids->empty()) {
+      *dim = split_2.size();
+    }
+    if (split_2.size() != *dim || *dim == 0) {
+      LOG_ERROR << "embedding dim != " << *dim << ", line: " << line;
+      return false;
+    }
+    for (size_t i = 0; i < split_2.size(); ++i) {
+      float value = 0;
+      if (!util::StrUtil::StrConvert<float>(split_2[i].c_str(), &value)) {
+        LOG_ERROR << "embedding value is not float, line: " << line;
+        return false;
+      }
+      embeddings->push_back(value);
+    }
+    ids->push_back(id);
+  }
+
+  return true;
+}
+
+bool AnnIndex::GetUserVector(const SearchParam& search_param,
+                             std::vector<float>* query) {
+  query->assign(ivf_.dim(), 0);
+
+  const FeatureGroupList& user_feature =
+      search_param.user_info().user_feature();
+  for (int i = 0; i < user_feature.feature_group_size(); ++i) {
+    const FeatureGroup& feature_group = user_feature.feature_group(i);
+    if (feature_group.feature_group_id() !=
+        ann_index_conf_->user_vector_feature_group_id()) {
+      continue;
+    }
+    for (int j = 0; j < feature_group.feature_entity_size(); ++j) {
+      const FeatureEntity& feature_entity = feature_group.feature_entity(j);
+      if (feature_entity.id() >= query->size()) {
+        LOG_WARN << "[" << ann_index_conf_->section() << "] "
+                 << "user vector dim " << feature_entity.id()
+                 << " exceeds " << query->size();
+        return false;
+      }
+      (*query)[feature_entity.id()] = feature_entity.value();
+    }
+    return true;
+  }
+
+  LOG_WARN << "[" << ann_index_conf_->section() << "] "
+           << "request has no user vector";
+  return false;
+}
+
+bool AnnIndex::Search(SearchContext* context,
+                      const SearchParam& search_param,
+                      SearchResult* search_result) {
+  if (search_result == NULL) {
+    LOG_WARN << "[" << ann_index_conf_->section() << "] "
+                  << "Index Search find illegal parameters";
+    return false;
+  }
+
+  AnnSearchContext* ann_ctx = static_cast<AnnSearchContext*>(context);
+
+  std::vector<float>* query = ann_ctx->mutable_query();
+  if (!GetUserVector(search_param, query)) {
+    return false;
+  }
+
+  IvfSearchBuffer* buffer = ann_ctx->mutable_ivf_buffer();
+  ivf_.Search(query->data(), ann_index_conf_->probe_num(), buffer);
+
+  // drop the filtered candidates before selecting
+  Filter* filter = ann_ctx->filter();
+  if (filter != NULL) {
+    size_t size = 0;
+    for (size_t i = 0; i < buffer->ids.size(); ++i) {
+      AnnItem item(buffer->ids[i], buffer->scores[i]);
+      if (filter->IsFiltered(&search_param.filter_info(), item)) {
+        continue;
+      }
+      buffer->ids[size] = buffer->ids[i];
+      buffer->scores[size] = buffer->scores[i];
+      size++;
+    }
+    buffer->ids.resize(size);
+    buffer->scores.resize(size);
+  }
+
+  // generate response
+  std::vector<uint32_t>* top_indices = ann_ctx->mutable_top_indices();
+  util::SelectTopK(buffer->scores.data(), buffer->scores.size(),
+                   search_param.topn(), top_indices);
+  for (size_t i = 0; i < top_indices->size(); ++i) {
+    uint32_t index = top_indices->at(i);
+    ResultUnit* unit = search_result->add_result_unit();
+    unit->set_id(buffer->ids[index]);
+    unit->set_score(buffer->scores[index]);
+  }
+
+  return true;
+}
+
+SearchContext* AnnIndex::GetSearchContext() {
+  return util::ObjList<AnnSearchContext>::Instance().Get();
+}
+
+void AnnIndex::ReleaseSearchContext(SearchContext* context) {
+  util::ObjList<AnnSearchContext>::Instance().Free(
+      static_cast<AnnSearchContext*>(context));
+}
+
+IndexConf* AnnIndex::CreateIndexConf() {
+  return new AnnIndexConf();
+}
+
+// register itself
+REGISTER_INDEX(ann_index, AnnIndex);
+
+}  // namespace tdm_serving
@@ -0,0 +1,71 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TDM_SERVING_INDEX_ANN_ANN_INDEX_H_
+#define TDM_SERVING_INDEX_ANN_ANN_INDEX_H_
+
+#include <string>
+#include <vector>
+#include "index/index.h"
+#include "index/ann/ivf.h"
+#include "index/ann/ann_search_context.h"
+
+namespace tdm_serving {
+
+class AnnIndexConf;
+
+// Approximate nearest neighbor index, retrieves the items whose
+// embeddings have the largest inner products with the user vector
+// of the request from an inverted file, without the model
+class AnnIndex : public Index {
+ public:
+  AnnIndex();
+  virtual ~AnnIndex();
+
+  virtual bool Init(const IndexConf* index_conf);
+
+  virtual bool Search(SearchContext* context,
+                      const SearchParam& search_param,
+                      SearchResult* search_result);
+
+  virtual SearchContext* GetSearchContext();
+
+  virtual void ReleaseSearchContext(SearchContext* context);
+
+ protected:
+  virtual IndexConf* CreateIndexConf();
+
+ private:
+  // Load the embedding file, each line is "item_id\tv1,v2,...,vd"
+  bool LoadEmbeddings(const std::string& file_path,
+                      std::vector<uint64_t>* ids,
+                      std::vector<float>* embeddings,
+                      uint32_t* dim);
+
+  // Get the user vector of dim from the feature group of the request
+  bool GetUserVector(const SearchParam& search_param,
+                     std::vector<float>* query);
+
+ private:
+  const AnnIndexConf* ann_index_conf_;
+
+  Ivf ivf_;
+
+  DISALLOW_COPY_AND_ASSIGN(AnnIndex);
+};
+
+}  // namespace tdm_serving
+
+#endif  // TDM_SERVING_INDEX_ANN_ANN_INDEX_H_
@@ -0,0 +1,73 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "index/ann/ann_index_conf.h"
+#include "index/ann/ann_def.h"
+#include "util/log.h"
+
+namespace tdm_serving {
+
+AnnIndexConf::AnnIndexConf()
+  : list_num_(kDefaultAnnListNum),
+    probe_num_(kDefaultAnnProbeNum),
+    train_iter_(kDefaultAnnTrainIter) {
+}
+
+AnnIndexConf::~AnnIndexConf() {
+}
+
+bool AnnIndexConf::Init(const std::string& section,
+                        const util::ConfParser& conf_parser) {
+  // upper init
+  if (!IndexConf::Init(section, conf_parser)) {
+    LOG_ERROR << "[" << section << "] upper Index::Init failed";
+    return false;
+  }
+
+  // user_vector_feature_group_id
+  if (!conf_parser.GetValue<std::string>(
+      section, kConfigAnnUserVectorFeatureGroupId,
+      &user_vector_feature_group_id_) ||
+      user_vector_feature_group_id_.empty()) {
+    LOG_ERROR << "[" << section << "] get config "
+                   << kConfigAnnUserVectorFeatureGroupId << " failed";
+    return false;
+  }
+  LOG_INFO << "[" << section << "] "
+                << kConfigAnnUserVectorFeatureGroupId << ": "
+                << user_vector_feature_group_id_;
+
+  // ann_list_num, ann_probe_num, ann_train_iter
+  conf_parser.GetValue<uint32_t>(section, kConfigAnnListNum,
+      kDefaultAnnListNum, &list_num_);
+  conf_parser.GetValue<uint32_t>(section, kConfigAnnProbeNum,
+      kDefaultAnnProbeNum, &probe_num_);
+  conf_parser.GetValue<uint32_t>(section, kConfigAnnTrainIter,
+      kDefaultAnnTrainIter, &train_iter_);
+  if (list_num_ == 0 || probe_num_ == 0) {
+    LOG_ERROR << "[" << section << "] "
+                   << kConfigAnnListNum << " and "
+                   << kConfigAnnProbeNum << " should be positive";
+    return false;
+  }
+  LOG_INFO << "[" << section << "] "
+                << kConfigAnnListNum << ": " << list_num_ << ", "
+                << kConfigAnnProbeNum << ": " << probe_num_ << ", "
+                << kConfigAnnTrainIter << ": " << train_iter_;
+
+  return true;
+}
+
+}  // namespace tdm_serving
@@ -0,0 +1,79 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TDM_SERVING_INDEX_ANN_ANN_INDEX_CONF_H_
+#define TDM_SERVING_INDEX_ANN_ANN_INDEX_CONF_H_
+
+#include "index/index_conf.h"
+
+namespace tdm_serving {
+
+class AnnIndexConf : public IndexConf {
+ public:
+  AnnIndexConf();
+  virtual ~AnnIndexConf();
+
+  virtual bool Init(
+      const std::string& section,
+      const util::ConfParser& conf_parser);
+
+  void set_user_vector_feature_group_id(
+      const std::string& user_vector_feature_group_id) {
+    user_vector_feature_group_id_ = user_vector_feature_group_id;
+  }
+
+  // Feature group of the user vector in the request,
+  // the entity ids are the dimensions and the values the components
+  const std::string& user_vector_feature_group_id() const {
+    return user_vector_feature_group_id_;
+  }
+
+  void set_list_num(uint32_t list_num) {
+    list_num_ = list_num;
+  }
+
+  // Inverted list num the items are clustered into
+  uint32_t list_num() const {
+    return list_num_;
+  }
+
+  void set_probe_num(uint32_t probe_num) {
+    probe_num_ = probe_num;
+  }
+
+  // Inverted list num scanned by a search
+  uint32_t probe_num() const {
+    return probe_num_;
+  }
+
+  void set_train_iter(uint32_t train_iter) {
+    train_iter_ = train_iter;
+  }
+
+  // K-means iterations clustering the items
+  uint32_t train_iter() const {
+    return train_iter_;
+  }
+
+ private:
+  std::string user_vector_feature_group_id_;
+  uint32_t list_num_;
+  uint32_t probe_num_;
+  uint32_t train_iter_;
+};
+
+}  // namespace tdm_serving
+
+#endif  // TDM_SERVING_INDEX_ANN_ANN_INDEX_CONF_H_
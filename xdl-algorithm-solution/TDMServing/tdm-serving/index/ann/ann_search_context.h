@@ -0,0 +1,62 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TDM_SERVING_INDEX_ANN_ANN_SEARCH_CONTEXT_H_
+#define TDM_SERVING_INDEX_ANN_ANN_SEARCH_CONTEXT_H_
+
+#include <vector>
+#include "index/search_context.h"
+#include "index/ann/ivf.h"
+
+namespace tdm_serving {
+
+// session data used for ann searching
+class AnnSearchContext : public SearchContext {
+ public:
+  AnnSearchContext() {}
+
+  virtual ~AnnSearchContext() {}
+
+  virtual void Clear() {
+    SearchContext::Clear();
+    query_.clear();
+    ivf_buffer_.Clear();
+  }
+
+  std::vector<float>* mutable_query() {
+    return &query_;
+  }
+
+  IvfSearchBuffer* mutable_ivf_buffer() {
+    return &ivf_buffer_;
+  }
+
+  std::vector<uint32_t>* mutable_top_indices() {
+    return &top_indices_;
+  }
+
+ private:
+  // user vector of the request
+  std::vector<float> query_;
+
+  IvfSearchBuffer ivf_buffer_;
+  std::vector<uint32_t> top_indices_;
+
+  DISALLOW_COPY_AND_ASSIGN(AnnSearchContext);
+};
+
+}  // namespace tdm_serving
+
+#endif  // TDM_SERVING_INDEX_ANN_ANN_SEARCH_CONTEXT_H_
@@ -0,0 +1,234 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "index/ann/ivf.h"
+#include <math.h>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include "util/top_k.h"
+#include "util/log.h"
+
+namespace tdm_serving {
+
+namespace {
+
+// the k-means is trained on at most this many sampled items per list
+const uint32_t kTrainSamplePerList = 256;
+
+float Dot(const float* x, const float* y, uint32_t dim) {
+  float sum = 0;
+  for (uint32_t i = 0; i < dim; ++i) {
+    sum += x[i] * y[i];
+  }
+  return sum;
+}
+
+float DotInt8(const float* x, const int8_t* code, uint32_t dim) {
+  float sum = 0;
+  for (uint32_t i = 0; i < dim; ++i) {
+    sum += x[i] * code[i];
+  }
+  return sum;
+}
+
+}  // namespace
+
+Ivf::Ivf() : dim_(0), list_num_(0) {
+}
+
+Ivf::~Ivf() {
+}
+
+bool Ivf::Build(const std::vector<uint64_t>& ids,
+                const std::vector<float>& embeddings,
+                uint32_t dim, uint32_t list_num, uint32_t train_iter) {
+  uint32_t n = ids.size();
+  if (n == 0 || dim == 0 || list_num == 0 ||
+      embeddings.size() != static_cast<size_t>(n) * dim) {
+    LOG_ERROR << "Ivf build with illegal item num: " << n
+              << ", dim: " << dim << ", list_num: " << list_num
+              << ", embedding size: " << embeddings.size();
+    return false;
+  }
+
+  dim_ = dim;
+  list_num_ = std::min(list_num, n);
+  Train(embeddings, n, train_iter);
+
+  // assign the items to lists
+  std::vector<uint32_t> assigns(n);
+#pragma omp parallel for
+  for (uint32_t i = 0; i < n; ++i) {
+    assigns[i] = Assign(&embeddings[static_cast<size_t>(i) * dim_]);
+  }
+
+  list_offsets_.assign(list_num_ + 1, 0);
+  for (uint32_t i = 0; i < n; ++i) {
+    list_offsets_[assigns[i] + 1]++;
+  }
+  for (uint32_t l = 0; l < list_num_; ++l) {
+    list_offsets_[l + 1] += list_offsets_[l];
+  }
+
+  // store by list as the int8 codes
+  ids_.resize(n);
+  scales_.resize(n);
+  codes_.resize(static_cast<size_t>(n) * dim_);
+  std::vector<uint32_t> positions(list_offsets_.begin(),
+                                  list_offsets_.end() - 1);
+  for (uint32_t i = 0; i < n; ++i) {
+    uint32_t pos = positions[assigns[i]]++;
+    const float* embedding = &embeddings[static_cast<size_t>(i) * dim_];
+    float max_abs = 0;
+    for (uint32_t j = 0; j < dim_; ++j) {
+      max_abs = std::max(max_abs, fabsf(embedding[j]));
+    }
+    float scale = max_abs / 127;
+    int8_t* code = &codes_[static_cast<size_t>(pos) * dim_];
+    for (uint32_t j = 0; j < dim_; ++j) {
+      code[j] = scale == 0 ? 0 :
+          static_cast<int8_t>(lrintf(embedding[j] / scale));
+    }
+    ids_[pos] = ids[i];
+    scales_[pos] = scale;
+  }
+
+  LOG_INFO << "Ivf build " << n << " items of dim " << dim_
+           << " into " << list_num_ << " lists";
+  return true;
+}
+
+void Ivf::Train(const std::vector<float>& embeddings, uint32_t n,
+                uint32_t train_iter) {
+  // evenly sampled items
+  uint32_t sample_num =
+      std::min(n, std::max(list_num_, list_num_ * kTrainSamplePerList));
+  std::vector<const float*> samples(sample_num);
+  for (uint32_t i = 0; i < sample_num; ++i) {
+    size_t item = static_cast<uint64_t>(i) * n / sample_num;
+    samples[i] = &embeddings[item * dim_];
+  }
+
+  // the first centroids are seeded by k-means++, each next one
+  // is a sample drawn by its squared distance to the nearest seed
+  std::mt19937 rng(0);
+  centroids_.resize(static_cast<size_t>(list_num_) * dim_);
+  centroid_norms_.resize(list_num_);
+  std::vector<float> distances(sample_num, std::numeric_limits<float>::max());
+  uint32_t seed = 0;
+  for (uint32_t l = 0; l < list_num_; ++l) {
+    std::copy(samples[seed], samples[seed] + dim_, &centroids_[l * dim_]);
+    centroid_norms_[l] =
+        Dot(&centroids_[l * dim_], &centroids_[l * dim_], dim_);
+
+    double total = 0;
+    for (uint32_t i = 0; i < sample_num; ++i) {
+      float distance = 0;
+      for (uint32_t j = 0; j < dim_; ++j) {
+        float diff = samples[i][j] - centroids_[l * dim_ + j];
+        distance += diff * diff;
+      }
+      distances[i] = std::min(distances[i], distance);
+      total += distances[i];
+    }
+
+    // all the samples are seeds already if total is 0
+    double target = std::uniform_real_distribution<double>(0, total)(rng);
+    seed = 0;
+    for (uint32_t i = 0; i < sample_num; ++i) {
+      target -= distances[i];
+      if (target < 0) {
+        seed = i;
+        break;
+      }
+    }
+  }
+
+  std::vector<uint32_t> assigns(sample_num);
+  std::vector<double> sums(static_cast<size_t>(list_num_) * dim_);
+  std::vector<uint32_t> counts(list_num_);
+  for (uint32_t iter = 0; iter < train_iter; ++iter) {
+#pragma omp parallel for
+    for (uint32_t i = 0; i < sample_num; ++i) {
+      assigns[i] = Assign(samples[i]);
+    }
+
+    std::fill(sums.begin(), sums.end(), 0);
+    std::fill(counts.begin(), counts.end(), 0);
+    for (uint32_t i = 0; i < sample_num; ++i) {
+      double* sum = &sums[assigns[i] * dim_];
+      for (uint32_t j = 0; j < dim_; ++j) {
+        sum[j] += samples[i][j];
+      }
+      counts[assigns[i]]++;
+    }
+
+    // an empty list keeps its centroid
+    for (uint32_t l = 0; l < list_num_; ++l) {
+      if (counts[l] == 0) {
+        continue;
+      }
+      for (uint32_t j = 0; j < dim_; ++j) {
+        centroids_[l * dim_ + j] = sums[l * dim_ + j] / counts[l];
+      }
+      centroid_norms_[l] =
+          Dot(&centroids_[l * dim_], &centroids_[l * dim_], dim_);
+    }
+  }
+}
+
+uint32_t Ivf::Assign(const float* embedding) const {
+  // argmin |x - c|^2 = argmin |c|^2 - 2 x.c
+  uint32_t best = 0;
+  float best_distance = 0;
+  for (uint32_t l = 0; l < list_num_; ++l) {
+    float distance = centroid_norms_[l] -
+        2 * Dot(embedding, &centroids_[l * dim_], dim_);
+    if (l == 0 || distance < best_distance) {
+      best = l;
+      best_distance = distance;
+    }
+  }
+  return best;
+}
+
+void Ivf::Search(const float* query, uint32_t probe_num,
+                 IvfSearchBuffer* buffer) const {
+  buffer->Clear();
+  if (list_num_ == 0) {
+    return;
+  }
+
+  std::vector<float>* list_scores = &buffer->list_scores;
+  list_scores->resize(list_num_);
+  for (uint32_t l = 0; l < list_num_; ++l) {
+    (*list_scores)[l] = Dot(query, &centroids_[l * dim_], dim_);
+  }
+  util::SelectTopK(list_scores->data(), list_num_, probe_num,
+                   &buffer->probes);
+
+  for (size_t p = 0; p < buffer->probes.size(); ++p) {
+    uint32_t l = buffer->probes[p];
+    for (uint32_t i = list_offsets_[l]; i < list_offsets_[l + 1]; ++i) {
+      float score = scales_[i] *
+          DotInt8(query, &codes_[static_cast<size_t>(i) * dim_], dim_);
+      buffer->ids.push_back(ids_[i]);
+      buffer->scores.push_back(score);
+    }
+  }
+}
+
+}  // namespace tdm_serving
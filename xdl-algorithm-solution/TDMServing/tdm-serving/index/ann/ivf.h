@@ -0,0 +1,97 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TDM_SERVING_INDEX_ANN_IVF_H_
+#define TDM_SERVING_INDEX_ANN_IVF_H_
+
+#include <stdint.h>
+#include <vector>
+#include "common/common_def.h"
+
+namespace tdm_serving {
+
+// Scratch buffers of an ivf search, reused by the pooled search contexts
+struct IvfSearchBuffer {
+  std::vector<float> list_scores;
+  std::vector<uint32_t> probes;
+
+  // candidates of the probed lists
+  std::vector<uint64_t> ids;
+  std::vector<float> scores;
+
+  void Clear() {
+    ids.clear();
+    scores.clear();
+  }
+};
+
+// Inverted file of the item embeddings for the inner product retrieval.
+// The items are clustered into lists by k-means, and stored contiguous
+// by list as int8 codes with a scale per item, a quarter of the floats.
+class Ivf {
+ public:
+  Ivf();
+  ~Ivf();
+
+  // Build from ids and their embeddings of dim floats each
+  bool Build(const std::vector<uint64_t>& ids,
+             const std::vector<float>& embeddings,
+             uint32_t dim, uint32_t list_num, uint32_t train_iter);
+
+  // Score the items of the probe_num lists whose centroids
+  // have the largest inner products with query
+  void Search(const float* query, uint32_t probe_num,
+              IvfSearchBuffer* buffer) const;
+
+  uint32_t dim() const {
+    return dim_;
+  }
+
+  uint32_t list_num() const {
+    return list_num_;
+  }
+
+  uint32_t size() const {
+    return ids_.size();
+  }
+
+ private:
+  // Cluster the sampled embeddings into the centroids
+  void Train(const std::vector<float>& embeddings, uint32_t n,
+             uint32_t train_iter);
+
+  // Index of the centroid nearest embedding by l2 distance
+  uint32_t Assign(const float* embedding) const;
+
+ private:
+  uint32_t dim_;
+  uint32_t list_num_;
+
+  // list_num_ * dim_ centroids and their squared norms
+  std::vector<float> centroids_;
+  std::vector<float> centroid_norms_;
+
+  // items of list l are [list_offsets_[l], list_offsets_[l + 1])
+  std::vector<uint32_t> list_offsets_;
+  std::vector<uint64_t> ids_;
+  std::vector<float> scales_;
+  std::vector<int8_t> codes_;
+
+  DISALLOW_COPY_AND_ASSIGN(Ivf);
+};
+
+}  // namespace tdm_serving
+
+#endif  // TDM_SERVING_INDEX_ANN_IVF_H_
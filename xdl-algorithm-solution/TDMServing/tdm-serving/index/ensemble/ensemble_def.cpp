@@ -0,0 +1,33 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "index/ensemble/ensemble_def.h"
+
+namespace tdm_serving {
+
+const std::string kConfigEnsembleSubIndexes = "sub_indexes";
+const std::string kConfigEnsembleTimeoutMs = "sub_index_timeout_ms";
+const std::string kConfigEnsembleWeights = "sub_index_weights";
+const std::string kConfigEnsembleScoreNormalize = "score_normalize";
+const std::string kConfigEnsembleWorkerNum = "worker_num";
+
+const uint32_t kDefaultEnsembleTimeoutMs = 50;
+const uint32_t kDefaultEnsembleWorkerNum = 8;
+
+const std::string kScoreNormalizeNoneName = "none";
+const std::string kScoreNormalizeMinMaxName = "min_max";
+const std::string kScoreNormalizeRankName = "rank";
+
+}  // namespace tdm_serving
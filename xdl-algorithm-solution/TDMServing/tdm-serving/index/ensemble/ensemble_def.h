@@ -0,0 +1,50 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TDM_SERVING_INDEX_ENSEMBLE_ENSEMBLE_DEF_H_
+#define TDM_SERVING_INDEX_ENSEMBLE_ENSEMBLE_DEF_H_
+
+#include <inttypes.h>
+#include <string>
+#include "common/common_def.h"
+
+namespace tdm_serving {
+
+extern const std::string kConfigEnsembleSubIndexes;
+extern const std::string kConfigEnsembleTimeoutMs;
+extern const std::string kConfigEnsembleWeights;
+extern const std::string kConfigEnsembleScoreNormalize;
+extern const std::string kConfigEnsembleWorkerNum;
+
+extern const uint32_t kDefaultEnsembleTimeoutMs;
+extern const uint32_t kDefaultEnsembleWorkerNum;
+
+// How the scores of a sub index are normalized before merging
+enum ScoreNormalize {
+  // raw scores, for the sub indexes of the same score range
+  kScoreNormalizeNone = 0,
+  // (score - min) / (max - min) of the sub result
+  kScoreNormalizeMinMax,
+  // 1 / (1 + rank) in the sub result
+  kScoreNormalizeRank
+};
+
+extern const std::string kScoreNormalizeNoneName;
+extern const std::string kScoreNormalizeMinMaxName;
+extern const std::string kScoreNormalizeRankName;
+
+}  // namespace tdm_serving
+
+#endif  // TDM_SERVING_INDEX_ENSEMBLE_ENSEMBLE_DEF_H_
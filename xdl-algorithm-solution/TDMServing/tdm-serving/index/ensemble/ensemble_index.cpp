@@ -0,0 +1,242 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "index/ensemble/ensemble_index.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <tr1/unordered_map>
+#include "index/ensemble/ensemble_index_conf.h"
+#include "index/index_manager.h"
+#include "index/search_context.h"
+#include "util/object_free_list.h"
+#include "util/top_k.h"
+#include "util/log.h"
+
+namespace tdm_serving {
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+enum SubSearchStatus {
+  kSubSearchPending = 0,
+  kSubSearchDone,
+  kSubSearchFailed
+};
+
+// The sub searches of a request, shared with the workers which may
+// finish them after the request has returned
+struct EnsembleSearch {
+  explicit EnsembleSearch(size_t size)
+    : results(size), status(size, kSubSearchPending), abandoned(false) {}
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<SearchResult> results;
+  std::vector<SubSearchStatus> status;
+  // set when the request returns, the late results are dropped
+  bool abandoned;
+};
+
+}  // namespace
+
+EnsembleIndex::EnsembleIndex() : ensemble_index_conf_(NULL) {
+}
+
+EnsembleIndex::~EnsembleIndex() {
+}
+
+bool EnsembleIndex::Init(const IndexConf* index_conf) {
+  ensemble_index_conf_ = static_cast<const EnsembleIndexConf*>(index_conf);
+
+  const std::string& section = ensemble_index_conf_->section();
+
+  if (!Index::Init(index_conf)) {
+    LOG_ERROR << "[" << section << "] Index::Init failed";
+    return false;
+  }
+
+  if (ensemble_index_conf_->sub_index_names().empty()) {
+    LOG_ERROR << "[" << section << "] has no sub index";
+    return false;
+  }
+
+  workers_.reset(new util::ThreadPool(ensemble_index_conf_->worker_num()));
+
+  return true;
+}
+
+bool EnsembleIndex::Search(SearchContext* /*context*/,
+                           const SearchParam& search_param,
+                           SearchResult* search_result) {
+  const std::string& section = ensemble_index_conf_->section();
+  if (search_result == NULL) {
+    LOG_WARN << "[" << section << "] "
+             << "Index Search find illegal parameters";
+    return false;
+  }
+
+  const std::vector<std::string>& names =
+      ensemble_index_conf_->sub_index_names();
+  const std::vector<uint32_t>& timeout_ms =
+      ensemble_index_conf_->timeout_ms();
+
+  Clock::time_point start = Clock::now();
+  std::vector<Clock::time_point> deadlines;
+  std::shared_ptr<EnsembleSearch> ensemble(new EnsembleSearch(names.size()));
+  for (size_t i = 0; i < names.size(); ++i) {
+    deadlines.push_back(start + std::chrono::milliseconds(timeout_ms[i]));
+
+    SearchParam sub_param = search_param;
+    sub_param.set_index_name(names[i]);
+    workers_->Schedule([ensemble, i, sub_param] {
+      SearchResult sub_result;
+      bool ret = IndexManager::Instance().Search(sub_param, &sub_result);
+      {
+        std::lock_guard<std::mutex> lock(ensemble->mutex);
+        if (ensemble->abandoned) {
+          return;
+        }
+        ensemble->status[i] = ret ? kSubSearchDone : kSubSearchFailed;
+        ensemble->results[i].Swap(&sub_result);
+      }
+      ensemble->cv.notify_one();
+    });
+  }
+
+  // wait until each sub search is done or out of its budget
+  std::vector<const SearchResult*> results(names.size(), NULL);
+  {
+    std::unique_lock<std::mutex> lock(ensemble->mutex);
+    while (true) {
+      Clock::time_point now = Clock::now();
+      bool waiting = false;
+      Clock::time_point wake = Clock::time_point::max();
+      for (size_t i = 0; i < names.size(); ++i) {
+        if (ensemble->status[i] == kSubSearchPending && now < deadlines[i]) {
+          waiting = true;
+          wake = std::min(wake, deadlines[i]);
+        }
+      }
+      if (!waiting) {
+        break;
+      }
+      ensemble->cv.wait_until(lock, wake);
+    }
+    ensemble->abandoned = true;
+
+    for (size_t i = 0; i < names.size(); ++i) {
+      if (ensemble->status[i] == kSubSearchDone) {
+        results[i] = &ensemble->results[i];
+      } else if (ensemble->status[i] == kSubSearchPending) {
+        LOG_WARN << "[" << section << "] sub index " << names[i]
+                 << " is not done in " << timeout_ms[i]
+                 << " ms, returns without it";
+      } else {
+        LOG_WARN << "[" << section << "] sub index " << names[i]
+                 << " search failed";
+      }
+    }
+  }
+
+  // the results are not written once abandoned
+  if (std::count(results.begin(), results.end(),
+                 static_cast<const SearchResult*>(NULL)) ==
+      static_cast<std::ptrdiff_t>(results.size())) {
+    LOG_WARN << "[" << section << "] no sub index is done";
+    return false;
+  }
+
+  MergeResults(results, ensemble_index_conf_->weights(),
+               ensemble_index_conf_->score_normalize(),
+               search_param.topn(), search_result);
+
+  return true;
+}
+
+void EnsembleIndex::MergeResults(
+    const std::vector<const SearchResult*>& results,
+    const std::vector<float>& weights,
+    ScoreNormalize score_normalize,
+    uint32_t topn,
+    SearchResult* search_result) {
+  std::vector<uint64_t> ids;
+  std::vector<float> scores;
+  std::tr1::unordered_map<uint64_t, size_t> positions;
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    const SearchResult* result = results[i];
+    if (result == NULL || result->result_unit_size() == 0) {
+      continue;
+    }
+
+    float min_score = result->result_unit(0).score();
+    float max_score = min_score;
+    for (int j = 1; j < result->result_unit_size(); ++j) {
+      min_score = std::min(min_score, result->result_unit(j).score());
+      max_score = std::max(max_score, result->result_unit(j).score());
+    }
+
+    for (int j = 0; j < result->result_unit_size(); ++j) {
+      const ResultUnit& unit = result->result_unit(j);
+      float score = unit.score();
+      if (score_normalize == kScoreNormalizeMinMax) {
+        score = max_score > min_score ?
+            (score - min_score) / (max_score - min_score) : 1.0;
+      } else if (score_normalize == kScoreNormalizeRank) {
+        score = 1.0 / (1 + j);
+      }
+      score *= weights[i];
+
+      std::tr1::unordered_map<uint64_t, size_t>::iterator it =
+          positions.find(unit.id());
+      if (it == positions.end()) {
+        positions[unit.id()] = ids.size();
+        ids.push_back(unit.id());
+        scores.push_back(score);
+      } else {
+        scores[it->second] = std::max(scores[it->second], score);
+      }
+    }
+  }
+
+  std::vector<uint32_t> top_indices;
+  util::SelectTopK(scores.data(), scores.size(), topn, &top_indices);
+  for (size_t i = 0; i < top_indices.size(); ++i) {
+    uint32_t index = top_indices[i];
+    ResultUnit* unit = search_result->add_result_unit();
+    unit->set_id(ids[index]);
+    unit->set_score(scores[index]);
+  }
+}
+
+SearchContext* EnsembleIndex::GetSearchContext() {
+  return util::ObjList<SearchContext>::Instance().Get();
+}
+
+void EnsembleIndex::ReleaseSearchContext(SearchContext* context) {
+  util::ObjList<SearchContext>::Instance().Free(context);
+}
+
+IndexConf* EnsembleIndex::CreateIndexConf() {
+  return new EnsembleIndexConf();
+}
+
+// register itself
+REGISTER_INDEX(ensemble_index, EnsembleIndex);
+
+}  // namespace tdm_serving
@@ -0,0 +1,72 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TDM_SERVING_INDEX_ENSEMBLE_ENSEMBLE_INDEX_H_
+#define TDM_SERVING_INDEX_ENSEMBLE_ENSEMBLE_INDEX_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "index/index.h"
+#include "index/ensemble/ensemble_def.h"
+#include "util/concurrency/thread_pool.h"
+
+namespace tdm_serving {
+
+class EnsembleIndexConf;
+
+// Ensemble of the other indexes, such as several trees or a tree and
+// an ann index. A request searches the sub indexes concurrently on the
+// workers of the ensemble, each within its latency budget, and the
+// results done in time are merged. The sub indexes are looked up by
+// name on each search, and reload on their own.
+class EnsembleIndex : public Index {
+ public:
+  EnsembleIndex();
+  virtual ~EnsembleIndex();
+
+  virtual bool Init(const IndexConf* index_conf);
+
+  virtual bool Search(SearchContext* context,
+                      const SearchParam& search_param,
+                      SearchResult* search_result);
+
+  virtual SearchContext* GetSearchContext();
+
+  virtual void ReleaseSearchContext(SearchContext* context);
+
+ protected:
+  virtual IndexConf* CreateIndexConf();
+
+  // Merge the results of the sub indexes into the topn of search_result,
+  // NULL for the ones not done. The scores of each result are normalized
+  // and weighted, an item found by several keeps its highest score.
+  static void MergeResults(const std::vector<const SearchResult*>& results,
+                           const std::vector<float>& weights,
+                           ScoreNormalize score_normalize,
+                           uint32_t topn,
+                           SearchResult* search_result);
+
+ private:
+  const EnsembleIndexConf* ensemble_index_conf_;
+
+  std::unique_ptr<util::ThreadPool> workers_;
+
+  DISALLOW_COPY_AND_ASSIGN(EnsembleIndex);
+};
+
+}  // namespace tdm_serving
+
+#endif  // TDM_SERVING_INDEX_ENSEMBLE_ENSEMBLE_INDEX_H_
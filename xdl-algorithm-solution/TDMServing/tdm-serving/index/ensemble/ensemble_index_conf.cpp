@@ -0,0 +1,146 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "index/ensemble/ensemble_index_conf.h"
+#include "util/str_util.h"
+#include "util/log.h"
+
+namespace tdm_serving {
+
+EnsembleIndexConf::EnsembleIndexConf()
+  : score_normalize_(kScoreNormalizeMinMax),
+    worker_num_(kDefaultEnsembleWorkerNum) {
+}
+
+EnsembleIndexConf::~EnsembleIndexConf() {
+}
+
+bool EnsembleIndexConf::Init(const std::string& section,
+                             const util::ConfParser& conf_parser) {
+  set_section(section);
+
+  // sub_indexes
+  std::string sub_indexes;
+  if (!conf_parser.GetValue<std::string>(
+      section, kConfigEnsembleSubIndexes, &sub_indexes)) {
+    LOG_ERROR << "[" << section << "] get config "
+              << kConfigEnsembleSubIndexes << " failed";
+    return false;
+  }
+  std::vector<std::string> sub_index_names;
+  util::StrUtil::Split(sub_indexes, ',', true, &sub_index_names);
+  for (size_t i = 0; i < sub_index_names.size(); ++i) {
+    util::StrUtil::Trim(sub_index_names[i]);
+    if (sub_index_names[i] == section) {
+      LOG_ERROR << "[" << section << "] "
+                << kConfigEnsembleSubIndexes << " contains itself";
+      return false;
+    }
+  }
+  if (sub_index_names.empty()) {
+    LOG_ERROR << "[" << section << "] "
+              << kConfigEnsembleSubIndexes << " is empty";
+    return false;
+  }
+  LOG_INFO << "[" << section << "] "
+           << kConfigEnsembleSubIndexes << ": " << sub_indexes;
+
+  // sub_index_timeout_ms, sub_index_weights
+  std::vector<uint32_t> timeout_ms;
+  std::vector<float> weights;
+  if (!GetSubIndexValues<uint32_t>(section, conf_parser,
+                                   kConfigEnsembleTimeoutMs,
+                                   kDefaultEnsembleTimeoutMs,
+                                   sub_index_names.size(), &timeout_ms) ||
+      !GetSubIndexValues<float>(section, conf_parser,
+                                kConfigEnsembleWeights, 1.0,
+                                sub_index_names.size(), &weights)) {
+    return false;
+  }
+
+  // score_normalize
+  std::string score_normalize;
+  conf_parser.GetValue<std::string>(section, kConfigEnsembleScoreNormalize,
+                                    kScoreNormalizeMinMaxName,
+                                    &score_normalize);
+  if (score_normalize == kScoreNormalizeNoneName) {
+    score_normalize_ = kScoreNormalizeNone;
+  } else if (score_normalize == kScoreNormalizeMinMaxName) {
+    score_normalize_ = kScoreNormalizeMinMax;
+  } else if (score_normalize == kScoreNormalizeRankName) {
+    score_normalize_ = kScoreNormalizeRank;
+  } else {
+    LOG_ERROR << "[" << section << "] unknown "
+              << kConfigEnsembleScoreNormalize << ": " << score_normalize;
+    return false;
+  }
+
+  // worker_num
+  conf_parser.GetValue<uint32_t>(section, kConfigEnsembleWorkerNum,
+                                 kDefaultEnsembleWorkerNum, &worker_num_);
+  if (worker_num_ == 0) {
+    LOG_ERROR << "[" << section << "] "
+              << kConfigEnsembleWorkerNum << " should be positive";
+    return false;
+  }
+  LOG_INFO << "[" << section << "] "
+           << kConfigEnsembleScoreNormalize << ": " << score_normalize << ", "
+           << kConfigEnsembleWorkerNum << ": " << worker_num_;
+
+  sub_index_names_ = sub_index_names;
+  timeout_ms_ = timeout_ms;
+  weights_ = weights;
+
+  return true;
+}
+
+template <typename T>
+bool EnsembleIndexConf::GetSubIndexValues(const std::string& section,
+                                          const util::ConfParser& conf_parser,
+                                          const std::string& key,
+                                          const T& default_value,
+                                          size_t size,
+                                          std::vector<T>* values) {
+  std::string str;
+  if (!conf_parser.GetValue<std::string>(section, key, &str)) {
+    values->assign(size, default_value);
+    return true;
+  }
+
+  std::vector<std::string> fields;
+  util::StrUtil::Split(str, ',', true, &fields);
+  for (size_t i = 0; i < fields.size(); ++i) {
+    T value;
+    util::StrUtil::Trim(fields[i]);
+    if (!util::StrUtil::StrConvert<T>(fields[i].c_str(), &value)) {
+      LOG_ERROR << "[" << section << "] " << key
+                << " has illegal value: " << fields[i];
+      return false;
+    }
+    values->push_back(value);
+  }
+  if (values->size() == 1) {
+    values->assign(size, values->at(0));
+  }
+  if (values->size() != size) {
+    LOG_ERROR << "[" << section << "] " << key
+              << " should have one value or one for each sub index";
+    return false;
+  }
+  LOG_INFO << "[" << section << "] " << key << ": " << str;
+  return true;
+}
+
+}  // namespace tdm_serving
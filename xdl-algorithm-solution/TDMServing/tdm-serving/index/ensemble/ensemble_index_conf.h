@@ -0,0 +1,103 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TDM_SERVING_INDEX_ENSEMBLE_ENSEMBLE_INDEX_CONF_H_
+#define TDM_SERVING_INDEX_ENSEMBLE_ENSEMBLE_INDEX_CONF_H_
+
+#include <string>
+#include <vector>
+#include "index/index_conf.h"
+#include "index/ensemble/ensemble_def.h"
+
+namespace tdm_serving {
+
+class EnsembleIndexConf : public IndexConf {
+ public:
+  EnsembleIndexConf();
+  virtual ~EnsembleIndexConf();
+
+  // The ensemble has no data of its own, index_path is not needed.
+  // The sub indexes are left empty if the conf is invalid.
+  virtual bool Init(
+      const std::string& section,
+      const util::ConfParser& conf_parser);
+
+  void set_sub_index_names(const std::vector<std::string>& sub_index_names) {
+    sub_index_names_ = sub_index_names;
+  }
+
+  // Names of the indexes searched by a request
+  const std::vector<std::string>& sub_index_names() const {
+    return sub_index_names_;
+  }
+
+  void set_timeout_ms(const std::vector<uint32_t>& timeout_ms) {
+    timeout_ms_ = timeout_ms;
+  }
+
+  // Latency budget of each sub index, its result is dropped if
+  // it is not done in time
+  const std::vector<uint32_t>& timeout_ms() const {
+    return timeout_ms_;
+  }
+
+  void set_weights(const std::vector<float>& weights) {
+    weights_ = weights;
+  }
+
+  // Weight of the normalized scores of each sub index
+  const std::vector<float>& weights() const {
+    return weights_;
+  }
+
+  void set_score_normalize(ScoreNormalize score_normalize) {
+    score_normalize_ = score_normalize;
+  }
+
+  ScoreNormalize score_normalize() const {
+    return score_normalize_;
+  }
+
+  void set_worker_num(uint32_t worker_num) {
+    worker_num_ = worker_num;
+  }
+
+  // Threads searching the sub indexes
+  uint32_t worker_num() const {
+    return worker_num_;
+  }
+
+ private:
+  // Parse the comma separated values of key for the size sub indexes,
+  // one for all of them or one for each
+  template <typename T>
+  bool GetSubIndexValues(const std::string& section,
+                         const util::ConfParser& conf_parser,
+                         const std::string& key,
+                         const T& default_value,
+                         size_t size,
+                         std::vector<T>* values);
+
+ private:
+  std::vector<std::string> sub_index_names_;
+  std::vector<uint32_t> timeout_ms_;
+  std::vector<float> weights_;
+  ScoreNormalize score_normalize_;
+  uint32_t worker_num_;
+};
+
+}  // namespace tdm_serving
+
+#endif  // TDM_SERVING_INDEX_ENSEMBLE_ENSEMBLE_INDEX_CONF_H_
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "index/index.h"
 #include <algorithm>
+#include <vector>
 #include "omp.h"
 #include "index/search_context.h"
 #include "biz/filter_manager.h"
@@ -65,6 +66,18 @@ bool Index::Init(const IndexConf* /*index_conf*/) {
   return true;
 }
 
+bool Index::Warmup() {
+  // pre-alloc search contexts
+  std::vector<SearchContext*> contexts;
+  for (uint32_t i = 0; i < kPreAllocSearchContextNum; ++i) {
+    contexts.push_back(GetSearchContext());
+  }
+  for (size_t i = 0; i < contexts.size(); ++i) {
+    ReleaseSearchContext(contexts[i]);
+  }
+  return true;
+}
+
 bool Index::Prepare(SearchContext* context,
                     const SearchParam& /*search_param*/) {
   // model name, used to get predict context
@@ -76,4 +89,15 @@ bool Index::Prepare(SearchContext* context,
   return true;
 }
 
+bool Index::BatchSearch(const std::vector<SearchContext*>& contexts,
+                        const std::vector<const SearchParam*>& search_params,
+                        const std::vector<SearchResult*>& search_results) {
+  for (size_t i = 0; i < contexts.size(); ++i) {
+    if (!Search(contexts[i], *search_params[i], search_results[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace tdm_serving
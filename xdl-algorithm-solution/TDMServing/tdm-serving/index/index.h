@@ -16,7 +16,9 @@ limitations under the License.
 #ifndef TDM_SERVING_INDEX_INDEX_H_
 #define TDM_SERVING_INDEX_INDEX_H_
 
+#include <memory>
 #include <string>
+#include <vector>
 #include "common/common_def.h"
 #include "index/index_conf.h"
 #include "util/conf_parser.h"
@@ -50,12 +52,21 @@ class Index {
                       const SearchParam& search_param,
                       SearchResult* search_result) = 0;
 
+  // Do search for several users, contexts[i] prepared for search_params[i]
+  // fills search_results[i], one Search each by default
+  virtual bool BatchSearch(const std::vector<SearchContext*>& contexts,
+                           const std::vector<const SearchParam*>& search_params,
+                           const std::vector<SearchResult*>& search_results);
+
   // Get sesssion data used for searching
   virtual SearchContext* GetSearchContext() = 0;
 
   // Release search context
   virtual void ReleaseSearchContext(SearchContext* context) = 0;
 
+  // Warm the loaded index up before it takes the searches
+  virtual bool Warmup();
+
   // Get paht of version file used for index reloading
   const std::string& version_file_path() {
     return index_conf_->version_file_path();
@@ -66,11 +77,21 @@ class Index {
     return index_conf_->section();
   }
 
+  // Get index_version
+  const std::string& index_version() {
+    return index_conf_->index_version();
+  }
+
   // Get model_name
   const std::string& model_name() {
     return index_conf_->model_name();
   }
 
+  // Get model_version, empty for the latest one
+  const std::string& model_version() {
+    return index_conf_->model_version();
+  }
+
   // Set filter
   void set_filter(Filter* filter) {
     filter_ = filter;
@@ -86,6 +107,10 @@ class Index {
   DISALLOW_COPY_AND_ASSIGN(Index);
 };
 
+// Reference counted handle of an index version, the version is
+// released by the last handle after a newer one is switched in
+typedef std::shared_ptr<Index> IndexHandle;
+
 // define register
 REGISTER_REGISTERER(Index);
 #define REGISTER_INDEX(title, name) \
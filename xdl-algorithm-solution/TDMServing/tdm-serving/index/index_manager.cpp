@@ -69,6 +69,9 @@ bool IndexManager::Init(const std::string& conf_path) {
     }
 
     const std::string& section = conf_section->GetSectionName();
+    if (section == kSearchCacheSection) {
+      continue;
+    }
 
     IndexUnit* index_unit = new IndexUnit();
 
@@ -94,7 +97,8 @@ bool IndexManager::Search(const SearchParam& search_param,
                           SearchResult* search_result) {
   const std::string& index_name = search_param.index_name();
 
-  Index* index = GetIndex(index_name);
+  // hold the version until the search ends, a reload may switch it out
+  IndexHandle index = GetIndex(index_name);
   if (index == NULL) {
     LOG_WARN << "Get NULL index by index_name: " << index_name;
     return false;
@@ -123,6 +127,59 @@ bool IndexManager::Search(const SearchParam& search_param,
   return true;
 }
 
+bool IndexManager::BatchSearch(
+    const std::vector<const SearchParam*>& search_params,
+    const std::vector<SearchResult*>& search_results) {
+  if (search_params.empty()) {
+    return true;
+  }
+  const std::string& index_name = search_params[0]->index_name();
+  for (size_t i = 1; i < search_params.size(); ++i) {
+    if (search_params[i]->index_name() != index_name) {
+      LOG_WARN << "Batch search with index_name: " << index_name
+               << " and " << search_params[i]->index_name();
+      return false;
+    }
+  }
+
+  // hold the version until the search ends, a reload may switch it out
+  IndexHandle index = GetIndex(index_name);
+  if (index == NULL) {
+    LOG_WARN << "Get NULL index by index_name: " << index_name;
+    return false;
+  }
+
+  std::vector<SearchContext*> search_ctxs;
+  bool ret = true;
+  for (size_t i = 0; i < search_params.size(); ++i) {
+    SearchContext* search_ctx = index->GetSearchContext();
+    if (search_ctx == NULL) {
+      LOG_WARN << "Get NULL search context by index_name: " << index_name;
+      ret = false;
+      break;
+    }
+    search_ctxs.push_back(search_ctx);
+
+    if (!index->Prepare(search_ctx, *search_params[i])) {
+      LOG_WARN << "Prepare with index_name: " << index_name << " failed";
+      ret = false;
+      break;
+    }
+  }
+
+  if (ret &&
+      !index->BatchSearch(search_ctxs, search_params, search_results)) {
+    LOG_WARN << "Batch search with index_name: " << index_name << " failed";
+    ret = false;
+  }
+
+  for (size_t i = 0; i < search_ctxs.size(); ++i) {
+    index->ReleaseSearchContext(search_ctxs[i]);
+  }
+
+  return ret;
+}
+
 IndexUnit* IndexManager::GetIndexUnit(const std::string& index_name) {
   IndexMap::iterator iter = index_map_.find(index_name);
   if (iter == index_map_.end()) {
@@ -133,14 +190,14 @@ IndexUnit* IndexManager::GetIndexUnit(const std::string& index_name) {
   return iter->second;
 }
 
-Index* IndexManager::GetIndex(const std::string& index_name) {
+IndexHandle IndexManager::GetIndex(const std::string& index_name) {
   IndexUnit* index_unit = GetIndexUnit(index_name);
   if (index_unit == NULL) {
     LOG_WARN << "Get Index Unit by index_name: "
                   << index_name << " failed";
-    return NULL;
+    return IndexHandle();
   }
-  Index* index = index_unit->GetIndex();
+  IndexHandle index = index_unit->GetIndex();
   if (index == NULL) {
     LOG_WARN << "Get Index by Index Unit with index_name: "
                   << index_name << " failed";
@@ -17,7 +17,9 @@ limitations under the License.
 #define TDM_SERVING_INDEX_INDEX_MANAGER_H_
 
 #include <string>
+#include <vector>
 #include "common/common_def.h"
+#include "index/index.h"
 #include "util/conf_parser.h"
 #include "util/singleton.h"
 #include "util/concurrency/mutex.h"
@@ -26,7 +28,6 @@ limitations under the License.
 namespace tdm_serving {
 
 class IndexUnit;
-class Index;
 class Filter;
 
 // Index Manager manages all index instances,
@@ -46,11 +47,16 @@ class IndexManager : public util::Singleton<IndexManager> {
   bool Search(const SearchParam& search_param,
               SearchResult* search_result);
 
+  // Search for several users of one index at once,
+  // search_params[i] fills search_results[i]
+  bool BatchSearch(const std::vector<const SearchParam*>& search_params,
+                   const std::vector<SearchResult*>& search_results);
+
   // Get index unit by index name
   IndexUnit* GetIndexUnit(const std::string& index_name);
 
-  // Get index by name
-  Index* GetIndex(const std::string& index_name);
+  // Get handle of the current index version by name
+  IndexHandle GetIndex(const std::string& index_name);
 
  private:
   typedef std::map<std::string, IndexUnit*> IndexMap;
@@ -28,10 +28,6 @@ IndexUnit::IndexUnit() : enable_(true) {
 }
 
 IndexUnit::~IndexUnit() {
-  for (uint32_t i = 0; i < index_datas_.size(); ++i) {
-    DELETE_AND_SET_NULL(index_datas_[i]);
-  }
-  index_datas_.clear();
   if (!version_file_path_.empty()) {
     util::FileMonitor::UnWatch(version_file_path_);
   }
@@ -98,17 +94,13 @@ bool IndexUnit::Init(const std::string& section,
   LOG_INFO << "[" << section_ << "] "
                 << kConfigIndexType << ": "<< index_type_;
 
-  for (uint32_t i = 0; i < kIndexInstanceNum; ++i) {
-    index_datas_.push_back(NULL);
-  }
-
   if (!Reload()) {
     LOG_ERROR << "init unit init to reload failed";
     return false;
   }
 
   // register file monitor
-  version_file_path_ = index_datas_[idx_]->version_file_path();
+  version_file_path_ = GetIndex()->version_file_path();
   if (version_file_path_.empty()) {
     LOG_INFO << "[" << section_ << "] need not reload index";
   } else {
@@ -130,27 +122,37 @@ bool IndexUnit::Reload() {
         "[" << section_ << "] get index by type: " << index_type_ << " failed";
     return false;
   }
+  IndexHandle new_index(index);
   if (!index->Init(section_, conf_parser_)) {
     LOG_ERROR << "[" << section_ << "] init index failed";
     return false;
   }
 
-  // switch
-  uint32_t new_idx = (idx_ + 1) % kIndexInstanceNum;
-  Index* old_index = index_datas_[new_idx];
-  index_datas_[new_idx] = index;
-  idx_ = new_idx;
+  // warm up before taking the searches
+  if (!index->Warmup()) {
+    LOG_ERROR << "[" << section_ << "] warm up index failed";
+    return false;
+  }
+
+  // switch, the old version lives on until its searches end
+  IndexHandle old_index;
+  {
+    util::SimpleMutex::Locker slock(&mutex_);
+    old_index = index_;
+    index_ = new_index;
+  }
   if (old_index != NULL) {
-    LOG_INFO << "[" << section_ << "] release old index";
-    delete old_index;
+    LOG_INFO << "[" << section_ << "] release old index, in use by "
+             << old_index.use_count() - 1 << " searches";
   }
   LOG_INFO << "[" << section_ << "] new index switch success";
 
   return true;
 }
 
-Index* IndexUnit::GetIndex() {
-  return index_datas_[idx_];
+IndexHandle IndexUnit::GetIndex() {
+  util::SimpleMutex::Locker slock(&mutex_);
+  return index_;
 }
 
 bool IndexUnit::is_enabled() {
@@ -17,17 +17,18 @@ limitations under the License.
 #define TDM_SERVING_INDEX_INDEX_UNIT_H_
 
 #include <string>
-#include <vector>
 #include "common/common_def.h"
+#include "index/index.h"
 #include "util/conf_parser.h"
+#include "util/concurrency/mutex.h"
 
 namespace tdm_serving {
 
 class Filter;
-class Index;
 
 // Manages index reloading
-// Uses multi-bufferd index for single-write/multi-read
+// The new version is loaded and warmed up aside, then switched in,
+// and the old one is released by the last search holding its handle
 class IndexUnit {
  public:
   IndexUnit();
@@ -37,7 +38,9 @@ class IndexUnit {
 
   bool Reload();
 
-  Index* GetIndex();
+  // Get handle of the current version, the searches hold it
+  // for their whole run across the switch
+  IndexHandle GetIndex();
 
   bool is_enabled();
 
@@ -47,10 +50,12 @@ class IndexUnit {
  private:
   bool enable_;
   std::string index_type_;
-  uint32_t idx_;
-  std::vector<Index*> index_datas_;
   std::string version_file_path_;
 
+  // current version, the mutex guards the handle copy and switch only
+  IndexHandle index_;
+  util::SimpleMutex mutex_;
+
   // config
   std::string section_;
   std::string conf_path_;
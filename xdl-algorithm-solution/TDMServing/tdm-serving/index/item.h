@@ -20,6 +20,20 @@ limitations under the License.
 
 namespace tdm_serving {
 
+// Mask of the categories passing a filter, or of the leaves under a node
+const uint64_t kAllCategoryMask = ~0ull;
+
+// Bit of category in the category masks, bit 0 is for the items without
+// category, and the categories share the others by hash, so that a set
+// bit means the category may be in the mask
+inline uint64_t CategoryBit(bool has_category, int32_t category) {
+  if (!has_category) {
+    return 1ull;
+  }
+  uint32_t hash = static_cast<uint32_t>(category) * 2654435761u;
+  return 1ull << (1 + (hash >> 26) % 63);
+}
+
 // Item interface,
 // user for item filtering and sorting
 class Item {
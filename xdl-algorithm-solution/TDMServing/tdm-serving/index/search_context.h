@@ -17,6 +17,7 @@ limitations under the License.
 #define TDM_SERVING_INDEX_SEARCH_CONTEXT_H_
 
 #include <tr1/unordered_set>
+#include <vector>
 #include "common/common_def.h"
 #include "model/model_manager.h"
 #include "model/predict_context.h"
@@ -42,6 +43,13 @@ class SearchContext {
                                                      predict_ctx_);
       predict_ctx_ = NULL;
     }
+    for (size_t i = 0; i < parallel_predict_ctxs_.size(); ++i) {
+      if (parallel_predict_ctxs_[i] != NULL) {
+        ModelManager::Instance().ReleasePredictContext(
+            model_name_, parallel_predict_ctxs_[i]);
+      }
+    }
+    parallel_predict_ctxs_.clear();
     model_name_.clear();
     filter_ = NULL;
   }
@@ -70,6 +78,23 @@ class SearchContext {
     return predict_ctx_;
   }
 
+  // Get predict context of index for the parallel predicts,
+  // index 0 is the one of mutable_predict_context.
+  // Not thread safe, get them before predicting in parallel.
+  PredictContext* mutable_predict_context(uint32_t index) {
+    if (index == 0) {
+      return mutable_predict_context();
+    }
+    if (parallel_predict_ctxs_.size() < index) {
+      parallel_predict_ctxs_.resize(index, NULL);
+    }
+    PredictContext*& predict_ctx = parallel_predict_ctxs_[index - 1];
+    if (!model_name_.empty() && predict_ctx == NULL) {
+      predict_ctx = ModelManager::Instance().GetPredictContext(model_name_);
+    }
+    return predict_ctx;
+  }
+
  private:
   // used to get predict context
   std::string model_name_;
@@ -77,6 +102,9 @@ class SearchContext {
   // session data used for model processing
   PredictContext* predict_ctx_;
 
+  // extra sessions for the parallel predicts of one request
+  std::vector<PredictContext*> parallel_predict_ctxs_;
+
   // user defined filter
   Filter* filter_;
 
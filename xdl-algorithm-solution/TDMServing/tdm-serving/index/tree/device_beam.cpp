@@ -0,0 +1,125 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "index/tree/device_beam.h"
+#include "index/tree/tree.h"
+#include "util/log.h"
+
+namespace tdm_serving {
+
+void DeviceTree::Flatten(Tree* tree,
+                         std::vector<uint32_t>* first_child,
+                         std::vector<uint32_t>* child_num,
+                         std::vector<uint64_t>* category_mask) {
+  uint32_t node_num = tree->total_node_num();
+  first_child->assign(node_num, 0);
+  child_num->assign(node_num, 0);
+  category_mask->assign(node_num, 0);
+  for (uint32_t pos = 0; pos < node_num; ++pos) {
+    Node* node = tree->node_by_pos(pos);
+    uint32_t sub_node_size = node->sub_node_size();
+    if (sub_node_size != 0) {
+      (*first_child)[pos] = tree->node_pos(node->sub_node(0));
+    }
+    (*child_num)[pos] = sub_node_size;
+    (*category_mask)[pos] = node->category_mask();
+  }
+}
+
+bool DeviceTree::Init(Tree* tree, int device_id) {
+  std::vector<uint32_t> first_child;
+  std::vector<uint32_t> child_num;
+  std::vector<uint64_t> category_mask;
+  Flatten(tree, &first_child, &child_num, &category_mask);
+  if (first_child.empty()) {
+    LOG_ERROR << "device tree of an empty tree";
+    return false;
+  }
+  return Upload(device_id, first_child, child_num, category_mask);
+}
+
+// the kernels are in device_beam.cu, without them the searches are on host
+#ifndef TDM_SERVING_WITH_CUDA
+
+DeviceTree::DeviceTree()
+    : device_id_(0), node_num_(0), first_child_(NULL), child_num_(NULL),
+      category_mask_(NULL) {
+}
+
+DeviceTree::~DeviceTree() {
+}
+
+bool DeviceTree::Upload(int /*device_id*/,
+                        const std::vector<uint32_t>& /*first_child*/,
+                        const std::vector<uint32_t>& /*child_num*/,
+                        const std::vector<uint64_t>& /*category_mask*/) {
+  LOG_WARN << "tdm serving is built without cuda, the tree stays on host";
+  return false;
+}
+
+DeviceBeam::DeviceBeam()
+    : tree_(NULL), capacity_(0), candidate_size_(0), winner_size_(0),
+      leaf_size_(0), stream_(NULL), candidate_pos_(NULL),
+      candidate_score_(NULL), winner_pos_(NULL), winner_score_(NULL),
+      leaf_pos_(NULL), leaf_score_(NULL), sort_score_(NULL),
+      sort_index_(NULL), raw_score_(NULL), raw_score_capacity_(0),
+      sizes_(NULL), host_sizes_(NULL) {
+}
+
+DeviceBeam::~DeviceBeam() {
+}
+
+bool DeviceBeam::Init(const DeviceTree* /*tree*/, uint32_t /*capacity*/) {
+  return false;
+}
+
+bool DeviceBeam::Reset(uint32_t /*root_pos*/) {
+  return false;
+}
+
+bool DeviceBeam::SetScores(uint32_t /*begin*/, uint32_t /*size*/,
+                           const float* /*scores*/, uint32_t /*stride*/,
+                           uint32_t /*offset*/) {
+  return false;
+}
+
+bool DeviceBeam::Select(uint32_t /*k*/) {
+  return false;
+}
+
+bool DeviceBeam::KeepAll() {
+  return false;
+}
+
+bool DeviceBeam::Expand(uint64_t /*pass_category_mask*/,
+                        bool /*keep_leaves*/, bool /*with_leaves*/) {
+  return false;
+}
+
+bool DeviceBeam::FetchCandidates(std::vector<uint32_t>* /*positions*/) {
+  return false;
+}
+
+bool DeviceBeam::FetchWinners(std::vector<uint32_t>* /*positions*/,
+                              std::vector<float>* /*scores*/) {
+  return false;
+}
+
+void DeviceBeam::Free() {
+}
+
+#endif  // TDM_SERVING_WITH_CUDA
+
+}  // namespace tdm_serving
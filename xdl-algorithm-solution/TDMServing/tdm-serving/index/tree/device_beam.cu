@@ -0,0 +1,504 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "index/tree/device_beam.h"
+#include <cuda_runtime.h>
+#include <math.h>
+#include <algorithm>
+#include "util/log.h"
+
+#define DEVICE_BEAM_CHECK(call) do {                                 \
+    cudaError_t error = (call);                                       \
+    if (error != cudaSuccess) {                                       \
+      LOG_ERROR << #call << " failed: " << cudaGetErrorString(error); \
+      return false;                                                   \
+    }                                                                 \
+  } while (0)
+
+namespace tdm_serving {
+
+namespace {
+
+// Select and Expand run in one block of the threads
+const uint32_t kBlockThreads = 1024;
+const uint32_t kGatherThreads = 256;
+
+template <class T>
+bool DeviceAlloc(T** ptr, size_t size) {
+  DEVICE_BEAM_CHECK(cudaMalloc(reinterpret_cast<void**>(ptr),
+                               size * sizeof(T)));
+  return true;
+}
+
+template <class T>
+void DeviceFree(T** ptr) {
+  if (*ptr != NULL) {
+    cudaFree(*ptr);
+    *ptr = NULL;
+  }
+}
+
+uint32_t RoundUpPow2(uint32_t n) {
+  uint32_t pow2 = 1;
+  while (pow2 < n) {
+    pow2 <<= 1;
+  }
+  return pow2;
+}
+
+// a goes before b in the winners
+__device__ bool Before(float score_a, uint32_t a, float score_b, uint32_t b) {
+  return score_a > score_b || (score_a == score_b && a < b);
+}
+
+// Scan values[blockDim.x] inclusively in place
+__device__ void BlockScan(uint32_t* values) {
+  uint32_t tid = threadIdx.x;
+  for (uint32_t d = 1; d < blockDim.x; d <<= 1) {
+    uint32_t value = tid >= d ? values[tid - d] : 0;
+    __syncthreads();
+    values[tid] += value;
+    __syncthreads();
+  }
+}
+
+__global__ void GatherScoreKernel(const float* raw_score, uint32_t size,
+                                  uint32_t stride, uint32_t offset,
+                                  float* score) {
+  for (uint32_t i = blockIdx.x * blockDim.x + threadIdx.x; i < size;
+       i += blockDim.x * gridDim.x) {
+    score[i] = raw_score[i * stride + offset];
+  }
+}
+
+// Bitonic sort the candidates by Before over padded, a power of 2, and
+// take the first k as the winners
+__global__ void SelectKernel(const uint32_t* candidate_pos,
+                             const float* candidate_score,
+                             uint32_t size, uint32_t padded, uint32_t k,
+                             float* sort_score, uint32_t* sort_index,
+                             uint32_t* winner_pos, float* winner_score) {
+  // the padding goes last, after the real scores of -inf too
+  for (uint32_t i = threadIdx.x; i < padded; i += blockDim.x) {
+    sort_score[i] = i < size ? candidate_score[i] : -INFINITY;
+    sort_index[i] = i;
+  }
+  __syncthreads();
+
+  for (uint32_t seq = 2; seq <= padded; seq <<= 1) {
+    for (uint32_t stride = seq >> 1; stride > 0; stride >>= 1) {
+      for (uint32_t i = threadIdx.x; i < padded; i += blockDim.x) {
+        uint32_t j = i ^ stride;
+        if (j <= i) {
+          continue;
+        }
+        float score_i = sort_score[i];
+        float score_j = sort_score[j];
+        uint32_t index_i = sort_index[i];
+        uint32_t index_j = sort_index[j];
+        // the sequences of i & seq == 0 are put in the order of Before,
+        // the others reversed
+        bool forward = (i & seq) == 0;
+        if (Before(score_j, index_j, score_i, index_i) == forward) {
+          sort_score[i] = score_j;
+          sort_score[j] = score_i;
+          sort_index[i] = index_j;
+          sort_index[j] = index_i;
+        }
+      }
+      __syncthreads();
+    }
+  }
+
+  for (uint32_t i = threadIdx.x; i < k; i += blockDim.x) {
+    uint32_t index = sort_index[i];
+    winner_pos[i] = candidate_pos[index];
+    winner_score[i] = candidate_score[index];
+  }
+}
+
+// Each thread expands a contiguous chunk of the winners, at the offsets
+// scanned over the block, so the children keep the order of the winners
+// as SpreadNodes adds them. sizes are the candidate and the kept leaf sizes.
+__global__ void ExpandKernel(const uint32_t* first_child,
+                             const uint32_t* child_num,
+                             const uint64_t* category_mask,
+                             const uint32_t* winner_pos,
+                             const float* winner_score,
+                             uint32_t winner_size,
+                             uint64_t pass_category_mask,
+                             bool keep_leaves, bool with_leaves,
+                             uint32_t capacity,
+                             uint32_t* leaf_pos, float* leaf_score,
+                             uint32_t* sizes,
+                             uint32_t* candidate_pos,
+                             float* candidate_score) {
+  __shared__ uint32_t child_sums[kBlockThreads];
+  __shared__ uint32_t leaf_sums[kBlockThreads];
+
+  uint32_t tid = threadIdx.x;
+  uint32_t chunk = (winner_size + blockDim.x - 1) / blockDim.x;
+  uint32_t begin = min(tid * chunk, winner_size);
+  uint32_t end = min(begin + chunk, winner_size);
+
+  uint32_t children = 0;
+  uint32_t leaves = 0;
+  for (uint32_t i = begin; i < end; ++i) {
+    uint32_t pos = winner_pos[i];
+    uint32_t num = child_num[pos];
+    if (num == 0) {
+      leaves += keep_leaves ? 1 : 0;
+      continue;
+    }
+    for (uint32_t c = first_child[pos]; c < first_child[pos] + num; ++c) {
+      children += (category_mask[c] & pass_category_mask) != 0 ? 1 : 0;
+    }
+  }
+  child_sums[tid] = children;
+  leaf_sums[tid] = leaves;
+  uint32_t kept_leaf_size = sizes[1];
+  __syncthreads();
+
+  BlockScan(child_sums);
+  BlockScan(leaf_sums);
+  uint32_t leaf_size = kept_leaf_size + leaf_sums[blockDim.x - 1];
+  uint32_t child_begin = with_leaves ? leaf_size : 0;
+  uint32_t candidate_size = child_begin + child_sums[blockDim.x - 1];
+
+  uint32_t leaf_at = kept_leaf_size + leaf_sums[tid] - leaves;
+  uint32_t child_at = child_begin + child_sums[tid] - children;
+  for (uint32_t i = begin; i < end; ++i) {
+    uint32_t pos = winner_pos[i];
+    uint32_t num = child_num[pos];
+    if (num == 0) {
+      if (keep_leaves) {
+        if (leaf_at < capacity) {
+          leaf_pos[leaf_at] = pos;
+          leaf_score[leaf_at] = winner_score[i];
+        }
+        ++leaf_at;
+      }
+      continue;
+    }
+    for (uint32_t c = first_child[pos]; c < first_child[pos] + num; ++c) {
+      if ((category_mask[c] & pass_category_mask) == 0) {
+        continue;
+      }
+      if (child_at < capacity) {
+        candidate_pos[child_at] = c;
+        candidate_score[child_at] = 1;
+      }
+      ++child_at;
+    }
+  }
+
+  if (with_leaves) {
+    __syncthreads();
+    for (uint32_t i = tid; i < leaf_size && i < capacity; i += blockDim.x) {
+      candidate_pos[i] = leaf_pos[i];
+      candidate_score[i] = leaf_score[i];
+    }
+  }
+
+  // the sizes are read by all the threads before the first sync
+  if (tid == 0) {
+    sizes[0] = candidate_size;
+    sizes[1] = leaf_size;
+  }
+}
+
+}  // namespace
+
+// ----------------------- DeviceTree -----------------------
+DeviceTree::DeviceTree()
+    : device_id_(0), node_num_(0), first_child_(NULL), child_num_(NULL),
+      category_mask_(NULL) {
+}
+
+DeviceTree::~DeviceTree() {
+  if (first_child_ != NULL || child_num_ != NULL ||
+      category_mask_ != NULL) {
+    cudaSetDevice(device_id_);
+  }
+  DeviceFree(&first_child_);
+  DeviceFree(&child_num_);
+  DeviceFree(&category_mask_);
+}
+
+bool DeviceTree::Upload(int device_id,
+                        const std::vector<uint32_t>& first_child,
+                        const std::vector<uint32_t>& child_num,
+                        const std::vector<uint64_t>& category_mask) {
+  uint32_t node_num = first_child.size();
+  device_id_ = device_id;
+  DEVICE_BEAM_CHECK(cudaSetDevice(device_id_));
+  if (!DeviceAlloc(&first_child_, node_num) ||
+      !DeviceAlloc(&child_num_, node_num) ||
+      !DeviceAlloc(&category_mask_, node_num)) {
+    return false;
+  }
+  DEVICE_BEAM_CHECK(cudaMemcpy(first_child_, first_child.data(),
+                               node_num * sizeof(uint32_t),
+                               cudaMemcpyHostToDevice));
+  DEVICE_BEAM_CHECK(cudaMemcpy(child_num_, child_num.data(),
+                               node_num * sizeof(uint32_t),
+                               cudaMemcpyHostToDevice));
+  DEVICE_BEAM_CHECK(cudaMemcpy(category_mask_, category_mask.data(),
+                               node_num * sizeof(uint64_t),
+                               cudaMemcpyHostToDevice));
+  node_num_ = node_num;
+  LOG_INFO << "device tree of " << node_num_ << " nodes on gpu "
+           << device_id_;
+  return true;
+}
+
+// ----------------------- DeviceBeam -----------------------
+DeviceBeam::DeviceBeam()
+    : tree_(NULL), capacity_(0), candidate_size_(0), winner_size_(0),
+      leaf_size_(0), stream_(NULL), candidate_pos_(NULL),
+      candidate_score_(NULL), winner_pos_(NULL), winner_score_(NULL),
+      leaf_pos_(NULL), leaf_score_(NULL), sort_score_(NULL),
+      sort_index_(NULL), raw_score_(NULL), raw_score_capacity_(0),
+      sizes_(NULL), host_sizes_(NULL) {
+}
+
+DeviceBeam::~DeviceBeam() {
+  Free();
+}
+
+void DeviceBeam::Free() {
+  if (tree_ == NULL) {
+    return;
+  }
+  cudaSetDevice(tree_->device_id());
+  if (stream_ != NULL) {
+    cudaStreamDestroy(static_cast<cudaStream_t>(stream_));
+    stream_ = NULL;
+  }
+  DeviceFree(&candidate_pos_);
+  DeviceFree(&candidate_score_);
+  DeviceFree(&winner_pos_);
+  DeviceFree(&winner_score_);
+  DeviceFree(&leaf_pos_);
+  DeviceFree(&leaf_score_);
+  DeviceFree(&sort_score_);
+  DeviceFree(&sort_index_);
+  DeviceFree(&raw_score_);
+  DeviceFree(&sizes_);
+  if (host_sizes_ != NULL) {
+    cudaFreeHost(host_sizes_);
+    host_sizes_ = NULL;
+  }
+  tree_ = NULL;
+  capacity_ = 0;
+  raw_score_capacity_ = 0;
+}
+
+bool DeviceBeam::Init(const DeviceTree* tree, uint32_t capacity) {
+  if (tree_ == tree && capacity <= capacity_) {
+    return true;
+  }
+  Free();
+  if (tree == NULL || !tree->ready()) {
+    return false;
+  }
+
+  // freed by Free from here on
+  tree_ = tree;
+  DEVICE_BEAM_CHECK(cudaSetDevice(tree_->device_id()));
+  cudaStream_t stream;
+  DEVICE_BEAM_CHECK(cudaStreamCreateWithFlags(&stream,
+                                              cudaStreamNonBlocking));
+  stream_ = stream;
+  uint32_t padded = RoundUpPow2(capacity);
+  if (!DeviceAlloc(&candidate_pos_, capacity) ||
+      !DeviceAlloc(&candidate_score_, capacity) ||
+      !DeviceAlloc(&winner_pos_, capacity) ||
+      !DeviceAlloc(&winner_score_, capacity) ||
+      !DeviceAlloc(&leaf_pos_, capacity) ||
+      !DeviceAlloc(&leaf_score_, capacity) ||
+      !DeviceAlloc(&sort_score_, padded) ||
+      !DeviceAlloc(&sort_index_, padded) ||
+      !DeviceAlloc(&sizes_, 2)) {
+    Free();
+    return false;
+  }
+  if (cudaHostAlloc(reinterpret_cast<void**>(&host_sizes_),
+                    2 * sizeof(uint32_t), cudaHostAllocDefault)
+      != cudaSuccess) {
+    LOG_ERROR << "device beam can not pin the sizes";
+    host_sizes_ = NULL;
+    Free();
+    return false;
+  }
+  capacity_ = capacity;
+  return true;
+}
+
+bool DeviceBeam::Reset(uint32_t root_pos) {
+  if (tree_ == NULL || capacity_ == 0) {
+    return false;
+  }
+  cudaStream_t stream = static_cast<cudaStream_t>(stream_);
+  float root_score = 1;
+  DEVICE_BEAM_CHECK(cudaSetDevice(tree_->device_id()));
+  DEVICE_BEAM_CHECK(cudaMemcpyAsync(candidate_pos_, &root_pos,
+                                    sizeof(uint32_t),
+                                    cudaMemcpyHostToDevice, stream));
+  DEVICE_BEAM_CHECK(cudaMemcpyAsync(candidate_score_, &root_score,
+                                    sizeof(float),
+                                    cudaMemcpyHostToDevice, stream));
+  DEVICE_BEAM_CHECK(cudaMemsetAsync(sizes_, 0, 2 * sizeof(uint32_t),
+                                    stream));
+  // the pageable sources are on the stack
+  DEVICE_BEAM_CHECK(cudaStreamSynchronize(stream));
+  candidate_size_ = 1;
+  winner_size_ = 0;
+  leaf_size_ = 0;
+  return true;
+}
+
+bool DeviceBeam::SetScores(uint32_t begin, uint32_t size,
+                           const float* scores, uint32_t stride,
+                           uint32_t offset) {
+  if (size == 0) {
+    return true;
+  }
+  if (begin + size > candidate_size_ || stride == 0) {
+    LOG_ERROR << "device beam scores [" << begin << ", " << begin + size
+              << ") of " << candidate_size_ << " candidates";
+    return false;
+  }
+
+  cudaStream_t stream = static_cast<cudaStream_t>(stream_);
+  DEVICE_BEAM_CHECK(cudaSetDevice(tree_->device_id()));
+  uint32_t raw_size = (size - 1) * stride + offset + 1;
+  if (raw_size > raw_score_capacity_) {
+    DEVICE_BEAM_CHECK(cudaStreamSynchronize(stream));
+    DeviceFree(&raw_score_);
+    raw_score_capacity_ = 0;
+    if (!DeviceAlloc(&raw_score_, raw_size)) {
+      return false;
+    }
+    raw_score_capacity_ = raw_size;
+  }
+  // the scores may be on host, or on the gpu of another predictor
+  DEVICE_BEAM_CHECK(cudaMemcpyAsync(raw_score_, scores,
+                                    raw_size * sizeof(float),
+                                    cudaMemcpyDefault, stream));
+  uint32_t blocks = (size + kGatherThreads - 1) / kGatherThreads;
+  GatherScoreKernel<<<blocks, kGatherThreads, 0, stream>>>(
+      raw_score_, size, stride, offset, candidate_score_ + begin);
+  DEVICE_BEAM_CHECK(cudaGetLastError());
+  // the host scores may be released after the return
+  DEVICE_BEAM_CHECK(cudaStreamSynchronize(stream));
+  return true;
+}
+
+bool DeviceBeam::Select(uint32_t k) {
+  cudaStream_t stream = static_cast<cudaStream_t>(stream_);
+  k = std::min(k, candidate_size_);
+  if (k == 0) {
+    winner_size_ = 0;
+    return true;
+  }
+
+  DEVICE_BEAM_CHECK(cudaSetDevice(tree_->device_id()));
+  uint32_t padded = RoundUpPow2(candidate_size_);
+  SelectKernel<<<1, kBlockThreads, 0, stream>>>(
+      candidate_pos_, candidate_score_, candidate_size_, padded, k,
+      sort_score_, sort_index_, winner_pos_, winner_score_);
+  DEVICE_BEAM_CHECK(cudaGetLastError());
+  winner_size_ = k;
+  return true;
+}
+
+bool DeviceBeam::KeepAll() {
+  cudaStream_t stream = static_cast<cudaStream_t>(stream_);
+  winner_size_ = candidate_size_;
+  if (winner_size_ == 0) {
+    return true;
+  }
+  DEVICE_BEAM_CHECK(cudaSetDevice(tree_->device_id()));
+  DEVICE_BEAM_CHECK(cudaMemcpyAsync(winner_pos_, candidate_pos_,
+                                    winner_size_ * sizeof(uint32_t),
+                                    cudaMemcpyDeviceToDevice, stream));
+  DEVICE_BEAM_CHECK(cudaMemcpyAsync(winner_score_, candidate_score_,
+                                    winner_size_ * sizeof(float),
+                                    cudaMemcpyDeviceToDevice, stream));
+  return true;
+}
+
+bool DeviceBeam::Expand(uint64_t pass_category_mask, bool keep_leaves,
+                        bool with_leaves) {
+  cudaStream_t stream = static_cast<cudaStream_t>(stream_);
+  DEVICE_BEAM_CHECK(cudaSetDevice(tree_->device_id()));
+  ExpandKernel<<<1, kBlockThreads, 0, stream>>>(
+      tree_->first_child(), tree_->child_num(), tree_->category_mask(),
+      winner_pos_, winner_score_, winner_size_, pass_category_mask,
+      keep_leaves, with_leaves, capacity_, leaf_pos_, leaf_score_, sizes_,
+      candidate_pos_, candidate_score_);
+  DEVICE_BEAM_CHECK(cudaGetLastError());
+  DEVICE_BEAM_CHECK(cudaMemcpyAsync(host_sizes_, sizes_,
+                                    2 * sizeof(uint32_t),
+                                    cudaMemcpyDeviceToHost, stream));
+  DEVICE_BEAM_CHECK(cudaStreamSynchronize(stream));
+
+  // the kernel drops what exceeds the capacity
+  if (host_sizes_[0] > capacity_ || host_sizes_[1] > capacity_) {
+    LOG_ERROR << "device beam of " << host_sizes_[0] << " candidates and "
+              << host_sizes_[1] << " leaves exceeds " << capacity_;
+    return false;
+  }
+  candidate_size_ = host_sizes_[0];
+  leaf_size_ = host_sizes_[1];
+  winner_size_ = 0;
+  return true;
+}
+
+bool DeviceBeam::FetchCandidates(std::vector<uint32_t>* positions) {
+  cudaStream_t stream = static_cast<cudaStream_t>(stream_);
+  positions->resize(candidate_size_);
+  if (candidate_size_ == 0) {
+    return true;
+  }
+  DEVICE_BEAM_CHECK(cudaSetDevice(tree_->device_id()));
+  DEVICE_BEAM_CHECK(cudaMemcpyAsync(positions->data(), candidate_pos_,
+                                    candidate_size_ * sizeof(uint32_t),
+                                    cudaMemcpyDeviceToHost, stream));
+  DEVICE_BEAM_CHECK(cudaStreamSynchronize(stream));
+  return true;
+}
+
+bool DeviceBeam::FetchWinners(std::vector<uint32_t>* positions,
+                              std::vector<float>* scores) {
+  cudaStream_t stream = static_cast<cudaStream_t>(stream_);
+  positions->resize(winner_size_);
+  scores->resize(winner_size_);
+  if (winner_size_ == 0) {
+    return true;
+  }
+  DEVICE_BEAM_CHECK(cudaSetDevice(tree_->device_id()));
+  DEVICE_BEAM_CHECK(cudaMemcpyAsync(positions->data(), winner_pos_,
+                                    winner_size_ * sizeof(uint32_t),
+                                    cudaMemcpyDeviceToHost, stream));
+  DEVICE_BEAM_CHECK(cudaMemcpyAsync(scores->data(), winner_score_,
+                                    winner_size_ * sizeof(float),
+                                    cudaMemcpyDeviceToHost, stream));
+  DEVICE_BEAM_CHECK(cudaStreamSynchronize(stream));
+  return true;
+}
+
+}  // namespace tdm_serving
@@ -0,0 +1,175 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TDM_SERVING_INDEX_TREE_DEVICE_BEAM_H_
+#define TDM_SERVING_INDEX_TREE_DEVICE_BEAM_H_
+
+#include <stdint.h>
+#include <vector>
+#include "common/common_def.h"
+
+namespace tdm_serving {
+
+class Tree;
+
+// The child lists of a tree in the memory of a gpu, by the node pos of
+// the breadth first layout. Built with WITH_CUDA only, Init fails otherwise.
+class DeviceTree {
+ public:
+  DeviceTree();
+  ~DeviceTree();
+
+  // Copy the child lists of tree to gpu device_id
+  bool Init(Tree* tree, int device_id);
+
+  bool ready() const {
+    return node_num_ != 0;
+  }
+
+  int device_id() const {
+    return device_id_;
+  }
+
+  uint32_t node_num() const {
+    return node_num_;
+  }
+
+  // Device arrays of node_num
+  const uint32_t* first_child() const {
+    return first_child_;
+  }
+
+  const uint32_t* child_num() const {
+    return child_num_;
+  }
+
+  const uint64_t* category_mask() const {
+    return category_mask_;
+  }
+
+  // The host arrays copied by Init, the children of the node at pos are
+  // at [first_child[pos], first_child[pos] + child_num[pos])
+  static void Flatten(Tree* tree,
+                      std::vector<uint32_t>* first_child,
+                      std::vector<uint32_t>* child_num,
+                      std::vector<uint64_t>* category_mask);
+
+ private:
+  bool Upload(int device_id,
+              const std::vector<uint32_t>& first_child,
+              const std::vector<uint32_t>& child_num,
+              const std::vector<uint64_t>& category_mask);
+
+ private:
+  int device_id_;
+  uint32_t node_num_;
+  uint32_t* first_child_;
+  uint32_t* child_num_;
+  uint64_t* category_mask_;
+
+  DISALLOW_COPY_AND_ASSIGN(DeviceTree);
+};
+
+// The candidates and the winners of the levels of a search on the gpu of
+// a DeviceTree. The winners are selected from the scores the model left
+// on the gpu, and expanded to the next candidates there, so a level only
+// copies the candidate pos to host for their item features. The buffers
+// are kept across the searches of a context.
+class DeviceBeam {
+ public:
+  DeviceBeam();
+  ~DeviceBeam();
+
+  // Allocate for the levels of at most capacity candidates
+  bool Init(const DeviceTree* tree, uint32_t capacity);
+
+  // Start a search with the node at root_pos the only candidate
+  bool Reset(uint32_t root_pos);
+
+  // Set the scores of the candidates [begin, begin + size) to
+  // scores[i * stride + offset], on host or on any gpu
+  bool SetScores(uint32_t begin, uint32_t size, const float* scores,
+                 uint32_t stride, uint32_t offset);
+
+  // Make the k best candidates by score the winners, ordered by score
+  // descending, and the earlier candidate first of the same score. All of
+  // the candidates sorted if there are at most k.
+  bool Select(uint32_t k);
+
+  // Make all of the candidates the winners, in order
+  bool KeepAll();
+
+  // Set the candidates to the children of the winners which have a leaf
+  // of pass_category_mask, with score 1. The winners without children are
+  // kept for the max level if keep_leaves, and the kept ones go before the
+  // children if with_leaves, for the max level.
+  bool Expand(uint64_t pass_category_mask, bool keep_leaves,
+              bool with_leaves);
+
+  // Copy the pos of the candidates to host
+  bool FetchCandidates(std::vector<uint32_t>* positions);
+
+  // Copy the pos and the scores of the winners to host
+  bool FetchWinners(std::vector<uint32_t>* positions,
+                    std::vector<float>* scores);
+
+  uint32_t candidate_size() const {
+    return candidate_size_;
+  }
+
+  uint32_t winner_size() const {
+    return winner_size_;
+  }
+
+  // The leaves kept for the max level, the first candidates there
+  uint32_t leaf_size() const {
+    return leaf_size_;
+  }
+
+ private:
+  void Free();
+
+ private:
+  const DeviceTree* tree_;
+  uint32_t capacity_;
+  uint32_t candidate_size_;
+  uint32_t winner_size_;
+  uint32_t leaf_size_;
+
+  // cudaStream_t
+  void* stream_;
+  // device buffers of capacity
+  uint32_t* candidate_pos_;
+  float* candidate_score_;
+  uint32_t* winner_pos_;
+  float* winner_score_;
+  uint32_t* leaf_pos_;
+  float* leaf_score_;
+  // the bitonic sort of Select, of capacity rounded up to a power of 2
+  float* sort_score_;
+  uint32_t* sort_index_;
+  // the scores of SetScores, of capacity * stride
+  float* raw_score_;
+  uint32_t raw_score_capacity_;
+  // the candidate and the leaf sizes of Expand, on device and pinned host
+  uint32_t* sizes_;
+  uint32_t* host_sizes_;
+
+  DISALLOW_COPY_AND_ASSIGN(DeviceBeam);
+};
+
+}  // namespace tdm_serving
+
+#endif  // TDM_SERVING_INDEX_TREE_DEVICE_BEAM_H_
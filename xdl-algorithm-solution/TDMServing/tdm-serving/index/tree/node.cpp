@@ -20,26 +20,35 @@ limitations under the License.
 namespace tdm_serving {
 
 Node::Node()
-    : node_info_(NULL),
-    sub_nodes_(NULL),
+    : id_(0),
+    hashid_(0),
+    level_(0),
+    category_mask_(kAllCategoryMask),
     sub_node_num_(0),
-    parent_node_(NULL) {
+    sub_nodes_(NULL),
+    parent_node_(NULL),
+    node_info_(NULL) {
 }
 
 Node::~Node() {
-  DELETE_ARRAY(sub_nodes_);
 }
 
 bool Node::InitNodeStructure(Tree* tree) {
   sub_node_num_ = node_info_->children_size();
-  sub_nodes_ = new Node*[sub_node_num_];
   for (uint32_t i = 0; i < sub_node_num_; ++i) {
-    *(sub_nodes_ + i) = tree->node_by_seq(node_info_->children(i));
-    if (*(sub_nodes_ + i) == NULL) {
+    Node* sub_node = tree->node_by_seq(node_info_->children(i));
+    if (sub_node == NULL) {
       LOG_ERROR << "Get child node: "
                      << node_info_->children(i) << " failed";
       return false;
     }
+    if (i == 0) {
+      sub_nodes_ = sub_node;
+    } else if (sub_node != sub_nodes_ + i) {
+      LOG_ERROR << "child node: " << node_info_->children(i)
+                     << " is not laid out after its sibling";
+      return false;
+    }
   }
 
   if (node_info_->has_parent()) {
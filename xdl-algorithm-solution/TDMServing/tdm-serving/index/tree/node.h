@@ -17,12 +17,15 @@ limitations under the License.
 #define TDM_SERVING_INDEX_TREE_NODE_H_
 
 #include "common/common_def.h"
+#include "index/item.h"
 #include "proto/tree.pb.h"
 
 namespace tdm_serving {
 
 class Tree;
 
+// Tree node, the nodes of a tree are laid out breadth first, so that
+// the children of a node are contiguous and the levels are in order
 class Node {
  public:
   Node();
@@ -34,8 +37,33 @@ class Node {
     return node_info_;
   }
 
+  // Set node info and cache the fields used in tree searching
   void set_node_info(UINode* node_info) {
     node_info_ = node_info;
+    id_ = node_info->id();
+    hashid_ = node_info->hashid();
+    level_ = node_info->level();
+  }
+
+  uint64_t id() const {
+    return id_;
+  }
+
+  uint64_t hashid() const {
+    return hashid_;
+  }
+
+  uint32_t level() const {
+    return level_;
+  }
+
+  // Category bits of the leaves under the node
+  uint64_t category_mask() const {
+    return category_mask_;
+  }
+
+  void set_category_mask(uint64_t category_mask) {
+    category_mask_ = category_mask;
   }
 
   Node* parent() {
@@ -47,21 +75,28 @@ class Node {
   }
 
   Node* sub_node(uint32_t index) {
-    return sub_nodes_[index];
+    return sub_nodes_ + index;
   }
 
   void sub_nodes(Node** sub_nodes, uint32_t* sub_node_num) {
-    *sub_nodes = *(sub_nodes_);
+    *sub_nodes = sub_nodes_;
     *sub_node_num = sub_node_num_;
   }
 
  private:
-  UINode* node_info_;
+  // cached from node info
+  uint64_t id_;
+  uint64_t hashid_;
+  uint32_t level_;
+  uint64_t category_mask_;
 
-  Node** sub_nodes_;
+  // first child, the children are contiguous
   uint32_t sub_node_num_;
+  Node* sub_nodes_;
   Node* parent_node_;
 
+  UINode* node_info_;
+
   DISALLOW_COPY_AND_ASSIGN(Node);
 };
 
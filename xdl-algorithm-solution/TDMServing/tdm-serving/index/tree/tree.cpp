@@ -123,13 +123,10 @@ bool Tree::Init(const TreeIndexConf* index_conf) {
   LOG_INFO << "[" << section << "] "
                 << "tree data load success, size: " << pb_trees_.size();
 
-  // rebuild tree
-  LOG_INFO << "[" << section << "] begin rebuild tree";
-  nodes_ = new Node[tree_meta_.total_node_num_];
+  // check seq
   bool rebuild_st = true;
 #pragma omp parallel for num_threads(index_conf_->build_omp())
   for (size_t i = 0; i < pb_trees_.size(); ++i) {
-    LOG_INFO << "[" << section << "] rebuild tree idx: " << i;
     UITree* pb_tree = pb_trees_[i];
     int32_t pos = pb_meta_.heads(i).offset();
     for (int32_t j = 0; j < pb_tree->nodes_size(); ++j) {
@@ -139,12 +136,28 @@ bool Tree::Init(const TreeIndexConf* index_conf) {
                        << " not equal expected: " << pos + j;
         rebuild_st = false;
       }
-      Node* node = nodes_ + node_info->seq();
-      node->set_node_info(node_info);
-      if (!node->InitNodeStructure(this)) {
-        LOG_ERROR << "InitNodeStructure for node seq: " << i << " failed";
-        rebuild_st = false;
-      }
+      node_info->set_hashid(node_info->id());
+    }
+  }
+  if (!rebuild_st) {
+    LOG_ERROR << "check node seq failed";
+    return false;
+  }
+
+  // rebuild tree breadth first, so that the children and the levels
+  // are contiguous for the tree search
+  LOG_INFO << "[" << section << "] begin rebuild tree";
+  std::vector<uint32_t> pos_to_seq;
+  LayoutNodes(&pos_to_seq);
+  nodes_ = new Node[tree_meta_.total_node_num_];
+#pragma omp parallel for num_threads(index_conf_->build_omp())
+  for (uint32_t i = 0; i < tree_meta_.total_node_num_; ++i) {
+    Node* node = nodes_ + i;
+    node->set_node_info(node_info_by_seq(pos_to_seq[i]));
+    if (!node->InitNodeStructure(this)) {
+      LOG_ERROR << "InitNodeStructure for node seq: "
+                     << pos_to_seq[i] << " failed";
+      rebuild_st = false;
     }
   }
   if (!rebuild_st) {
@@ -152,6 +165,8 @@ bool Tree::Init(const TreeIndexConf* index_conf) {
     return false;
   }
 
+  BuildCategoryMasks();
+
   LOG_INFO << "[" << section << "] tree rebuild success";
 
   // build node maps
@@ -169,6 +184,7 @@ bool Tree::Init(const TreeIndexConf* index_conf) {
       build_node_maps_st = false;
     } {
       uint32_t max_level = 0;
+      uint32_t max_sub_node_num = 0;
       LOG_INFO <<
           "[" << section << "] rebuild node maps, thread idx: " << thread_id;
       for (uint32_t i = 0; i < tree_meta_.total_node_num_; ++i) {
@@ -184,16 +200,18 @@ bool Tree::Init(const TreeIndexConf* index_conf) {
               max_level) {
             max_level = node->node_info()->level();
           }
-
-          std::string node_id = util::ToString(node->node_info()->id());
-          uint64_t node_id_hash = node->node_info()->id();
-          node->node_info()->set_hashid(node_id_hash);
+          if (node->sub_node_size() > max_sub_node_num) {
+            max_sub_node_num = node->sub_node_size();
+          }
         }
       }
       util::SimpleMutex::Locker slock(&mutex_);
       if (max_level > tree_meta_.max_level_) {
         tree_meta_.max_level_ = max_level;
       }
+      if (max_sub_node_num > tree_meta_.max_sub_node_num_) {
+        tree_meta_.max_sub_node_num_ = max_sub_node_num;
+      }
     }
   }
 
@@ -209,4 +227,75 @@ bool Tree::Init(const TreeIndexConf* index_conf) {
   return true;
 }
 
+void Tree::BuildCategoryMasks() {
+  // the children are laid out after their parents, so that
+  // the children masks are ready in the reverse order
+  for (uint32_t i = tree_meta_.total_node_num_; i > 0; --i) {
+    Node* node = nodes_ + i - 1;
+    uint32_t sub_node_size = node->sub_node_size();
+    if (sub_node_size == 0) {
+      UINode* node_info = node->node_info();
+      node->set_category_mask(CategoryBit(node_info->has_leaf_cate_id(),
+                                          node_info->leaf_cate_id()));
+      continue;
+    }
+    uint64_t category_mask = 0;
+    for (uint32_t j = 0; j < sub_node_size; ++j) {
+      category_mask |= node->sub_node(j)->category_mask();
+    }
+    node->set_category_mask(category_mask);
+  }
+}
+
+UINode* Tree::node_info_by_seq(uint32_t seq) {
+  // the heads are sorted by offset
+  int32_t begin = 0;
+  int32_t end = pb_meta_.heads_size();
+  while (end - begin > 1) {
+    int32_t mid = (begin + end) / 2;
+    if (static_cast<uint32_t>(pb_meta_.heads(mid).offset()) <= seq) {
+      begin = mid;
+    } else {
+      end = mid;
+    }
+  }
+  return pb_trees_[begin]->mutable_nodes(seq - pb_meta_.heads(begin).offset());
+}
+
+void Tree::LayoutNodes(std::vector<uint32_t>* pos_to_seq) {
+  static const uint32_t kInvalidPos = static_cast<uint32_t>(-1);
+  uint32_t total_node_num = tree_meta_.total_node_num_;
+
+  seq_to_pos_.assign(total_node_num, kInvalidPos);
+  pos_to_seq->clear();
+  pos_to_seq->reserve(total_node_num);
+  if (total_node_num == 0) {
+    return;
+  }
+
+  // breadth first from root, the children of a node are put together
+  seq_to_pos_[0] = 0;
+  pos_to_seq->push_back(0);
+  for (uint32_t i = 0; i < pos_to_seq->size(); ++i) {
+    const UINode* node_info = node_info_by_seq(pos_to_seq->at(i));
+    for (int32_t j = 0; j < node_info->children_size(); ++j) {
+      uint32_t child = node_info->children(j);
+      // the bad children fail in InitNodeStructure
+      if (child >= total_node_num || seq_to_pos_[child] != kInvalidPos) {
+        continue;
+      }
+      seq_to_pos_[child] = pos_to_seq->size();
+      pos_to_seq->push_back(child);
+    }
+  }
+
+  // the nodes not reachable from root are put last
+  for (uint32_t seq = 0; seq < total_node_num; ++seq) {
+    if (seq_to_pos_[seq] == kInvalidPos) {
+      seq_to_pos_[seq] = pos_to_seq->size();
+      pos_to_seq->push_back(seq);
+    }
+  }
+}
+
 }  // namespace tdm_serving
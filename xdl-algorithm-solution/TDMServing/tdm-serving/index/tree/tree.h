@@ -17,7 +17,11 @@ limitations under the License.
 #define TDM_SERVING_INDEX_TREE_TREE_H_
 
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <unordered_map>
+#include <vector>
 #include "google/protobuf/io/zero_copy_stream_impl.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "common/common_def.h"
@@ -52,13 +56,26 @@ class Tree {
                      << tree_meta_.total_node_num_;
       return NULL;
     }
-    return nodes_ + seq;
+    if (seq_to_pos_.empty()) {
+      return nodes_ + seq;
+    }
+    return nodes_ + seq_to_pos_[seq];
   }
 
   Node* node_by_id(uint64_t node_id) {
     return node_maps_->GetNode(node_id);
   }
 
+  // Node at pos of the breadth first layout, the children of a node
+  // are at contiguous pos
+  Node* node_by_pos(uint32_t pos) {
+    return nodes_ + pos;
+  }
+
+  uint32_t node_pos(const Node* node) const {
+    return node - nodes_;
+  }
+
   // get tree total node num
   uint32_t total_node_num() {
     return tree_meta_.total_node_num_;
@@ -69,13 +86,33 @@ class Tree {
     return tree_meta_.max_level_;
   }
 
+  // Summarize the leaf categories under each node, for pruning the
+  // subtrees of the filtered categories in tree searching
+  void BuildCategoryMasks();
+
+  // get tree max children num of a node
+  uint32_t max_sub_node_size() {
+    return tree_meta_.max_sub_node_num_;
+  }
+
+ private:
+  // Get the node info of seq from the pb trees
+  UINode* node_info_by_seq(uint32_t seq);
+
+  // Lay out the nodes breadth first from root,
+  // fill seq_to_pos_ and the seqs of the positions
+  void LayoutNodes(std::vector<uint32_t>* pos_to_seq);
+
  private:
   // tree index conf
   const TreeIndexConf* index_conf_;
 
-  // tree data info
+  // tree data info, laid out breadth first
   Node* nodes_;
 
+  // node position in nodes_ by seq
+  std::vector<uint32_t> seq_to_pos_;
+
   // tree meta info
   TreeMeta tree_meta_;
 
@@ -104,21 +141,42 @@ bool ParsePbFromBinaryFile(const std::string& file, Pb* pb) {
     LOG_ERROR << "Open " << file << " failed";
     return false;
   }
-  google::protobuf::io::ZeroCopyInputStream* raw_input
-      = new google::protobuf::io::FileInputStream(fd);
-  google::protobuf::io::CodedInputStream* coded_input
-      = new google::protobuf::io::CodedInputStream(raw_input);
-
-  coded_input->SetTotalBytesLimit(INT_MAX, INT_MAX);
-
-  if (!pb->ParseFromCodedStream(coded_input)) {
-    LOG_ERROR << "Parse pb from " << file << " failed";
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size > INT_MAX) {
+    LOG_ERROR << "Stat " << file << " failed or it exceeds 2GB";
+    close(fd);
     return false;
   }
 
-  delete coded_input;
-  delete raw_input;
-  return true;
+  // parse from the mapped file, saves the copies of the stream reads
+  size_t size = file_stat.st_size;
+  void* data = NULL;
+  if (size != 0) {
+    data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      LOG_ERROR << "Mmap " << file << " failed";
+      close(fd);
+      return false;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  bool ret = true;
+  {
+    google::protobuf::io::CodedInputStream coded_input(
+        reinterpret_cast<const uint8_t*>(data), static_cast<int>(size));
+    coded_input.SetTotalBytesLimit(INT_MAX, INT_MAX);
+    if (!pb->ParseFromCodedStream(&coded_input)) {
+      LOG_ERROR << "Parse pb from " << file << " failed";
+      ret = false;
+    }
+  }
+
+  if (data != NULL) {
+    munmap(data, size);
+  }
+  return ret;
 }
 
 template<typename Pb>
@@ -19,8 +19,16 @@ namespace tdm_serving {
 
 const std::string kConfigTreeLevelTopN = "tree_level_topn";
 const std::string kConfigItemFeatureGroupId = "item_feature_group_id";
+const std::string kConfigTreeTwoLevelScoreNum = "tree_two_level_score_num";
+const std::string kConfigTreeParallelScoreNum = "tree_parallel_score_num";
+const std::string kConfigTreeParallelScoreBatch = "tree_parallel_score_batch";
+const std::string kConfigTreeSearchDevice = "tree_search_device";
 
 const uint32_t kDefaultTreeLevelTopN = 512;
+const uint32_t kDefaultTreeTwoLevelScoreNum = 0;
+const uint32_t kDefaultTreeParallelScoreNum = 1;
+const uint32_t kDefaultTreeParallelScoreBatch = 1024;
+const int32_t kDefaultTreeSearchDevice = -1;
 
 const std::string kTreeMetaFileName = "meta.dat";
 const std::string kTreeDataFilePrefix = "tree.dat.";
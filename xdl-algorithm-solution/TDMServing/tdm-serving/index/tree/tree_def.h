@@ -24,8 +24,16 @@ namespace tdm_serving {
 
 extern const std::string kConfigTreeLevelTopN;
 extern const std::string kConfigItemFeatureGroupId;
+extern const std::string kConfigTreeTwoLevelScoreNum;
+extern const std::string kConfigTreeParallelScoreNum;
+extern const std::string kConfigTreeParallelScoreBatch;
+extern const std::string kConfigTreeSearchDevice;
 
 extern const uint32_t kDefaultTreeLevelTopN;
+extern const uint32_t kDefaultTreeTwoLevelScoreNum;
+extern const uint32_t kDefaultTreeParallelScoreNum;
+extern const uint32_t kDefaultTreeParallelScoreBatch;
+extern const int32_t kDefaultTreeSearchDevice;
 
 extern const std::string kTreeMetaFileName;
 extern const std::string kTreeDataFilePrefix;
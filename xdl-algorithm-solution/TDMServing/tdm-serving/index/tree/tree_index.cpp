@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "index/tree/tree_index.h"
 #include <algorithm>
+#include <vector>
 #include "index/tree/tree_def.h"
 #include "index/tree/tree_index_conf.h"
 #include "util/str_util.h"
@@ -51,6 +52,13 @@ bool TreeIndex::Init(const IndexConf* index_conf) {
     return false;
   }
 
+  // the searches expand and select on gpu with the tree there
+  if (tree_index_conf_->search_device() >= 0 &&
+      !tree_searcher()->InitDeviceTree(&tree_)) {
+    LOG_WARN << "[" << section << "] tree can not be kept on gpu "
+             << tree_index_conf_->search_device() << ", search on host";
+  }
+
   return true;
 }
 
@@ -82,6 +90,40 @@ bool TreeIndex::Search(SearchContext* context,
   return true;
 }
 
+bool TreeIndex::BatchSearch(
+    const std::vector<SearchContext*>& contexts,
+    const std::vector<const SearchParam*>& search_params,
+    const std::vector<SearchResult*>& search_results) {
+  std::vector<TreeSearchContext*> tree_ctxs;
+  for (size_t i = 0; i < contexts.size(); ++i) {
+    if (search_results[i] == NULL) {
+      LOG_WARN << "[" << tree_index_conf_->section() << "] "
+                    << "Index BatchSearch find illegal parameters";
+      return false;
+    }
+    tree_ctxs.push_back(static_cast<TreeSearchContext*>(contexts[i]));
+  }
+
+  // do search
+  if (!tree_searcher()->BatchSearch(&tree_, tree_ctxs, search_params)) {
+    LOG_WARN << "[" << tree_index_conf_->section() << "] "
+                  << "Tree batch search failed";
+    return false;
+  }
+
+  // generate response
+  for (size_t i = 0; i < tree_ctxs.size(); ++i) {
+    if (!GenerateResponse(tree_ctxs[i], *search_params[i],
+                          search_results[i])) {
+      LOG_ERROR << "[" << tree_index_conf_->section() << "] "
+                     << "Generate response failed";
+      return false;
+    }
+  }
+
+  return true;
+}
+
 SearchContext* TreeIndex::GetSearchContext() {
   return util::ObjList<TreeSearchContext>::Instance().Get();
 }
@@ -91,6 +133,21 @@ void TreeIndex::ReleaseSearchContext(SearchContext* context) {
       static_cast<TreeSearchContext*>(context));
 }
 
+bool TreeIndex::Warmup() {
+  // pre-alloc search contexts with the node scores for this tree
+  std::vector<TreeSearchContext*> contexts;
+  for (uint32_t i = 0; i < kPreAllocSearchContextNum; ++i) {
+    TreeSearchContext* context =
+        static_cast<TreeSearchContext*>(GetSearchContext());
+    tree_searcher()->ReserveNodes(&tree_, context);
+    contexts.push_back(context);
+  }
+  for (size_t i = 0; i < contexts.size(); ++i) {
+    ReleaseSearchContext(contexts[i]);
+  }
+  return true;
+}
+
 IndexConf* TreeIndex::CreateIndexConf() {
   return new TreeIndexConf();
 }
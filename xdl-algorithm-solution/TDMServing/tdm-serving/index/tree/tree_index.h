@@ -38,10 +38,18 @@ class TreeIndex : public Index {
                       const SearchParam& search_param,
                       SearchResult* search_result);
 
+  // Beam search for all the users together,
+  // the candidates of a level scored by one predict
+  virtual bool BatchSearch(const std::vector<SearchContext*>& contexts,
+                           const std::vector<const SearchParam*>& search_params,
+                           const std::vector<SearchResult*>& search_results);
+
   virtual SearchContext* GetSearchContext();
 
   virtual void ReleaseSearchContext(SearchContext* context);
 
+  virtual bool Warmup();
+
  protected:
   virtual IndexConf* CreateIndexConf();
 
@@ -23,7 +23,11 @@ limitations under the License.
 namespace tdm_serving {
 
 TreeIndexConf::TreeIndexConf()
-  : model_batch_num_(1) {
+  : model_batch_num_(1),
+    two_level_score_num_(kDefaultTreeTwoLevelScoreNum),
+    parallel_score_num_(kDefaultTreeParallelScoreNum),
+    parallel_score_batch_(kDefaultTreeParallelScoreBatch),
+    search_device_(kDefaultTreeSearchDevice) {
 }
 
 TreeIndexConf::~TreeIndexConf() {
@@ -65,6 +69,34 @@ bool TreeIndexConf::Init(const std::string& section,
   LOG_INFO << "[" << section << "] "
                 << kConfigItemFeatureGroupId << ": " << item_feature_group_id_;
 
+  // tree_two_level_score_num
+  conf_parser.GetValue<uint32_t>(section, kConfigTreeTwoLevelScoreNum,
+      kDefaultTreeTwoLevelScoreNum, &two_level_score_num_);
+  LOG_INFO << "[" << section << "] "
+                << kConfigTreeTwoLevelScoreNum << ": " << two_level_score_num_;
+
+  // tree_parallel_score_num, tree_parallel_score_batch
+  conf_parser.GetValue<uint32_t>(section, kConfigTreeParallelScoreNum,
+      kDefaultTreeParallelScoreNum, &parallel_score_num_);
+  conf_parser.GetValue<uint32_t>(section, kConfigTreeParallelScoreBatch,
+      kDefaultTreeParallelScoreBatch, &parallel_score_batch_);
+  if (parallel_score_num_ == 0 || parallel_score_batch_ == 0) {
+    LOG_ERROR << "[" << section << "] "
+                   << kConfigTreeParallelScoreNum << " and "
+                   << kConfigTreeParallelScoreBatch << " should be positive";
+    return false;
+  }
+  LOG_INFO << "[" << section << "] "
+                << kConfigTreeParallelScoreNum << ": " << parallel_score_num_
+                << ", " << kConfigTreeParallelScoreBatch << ": "
+                << parallel_score_batch_;
+
+  // tree_search_device
+  conf_parser.GetValue<int32_t>(section, kConfigTreeSearchDevice,
+      kDefaultTreeSearchDevice, &search_device_);
+  LOG_INFO << "[" << section << "] "
+                << kConfigTreeSearchDevice << ": " << search_device_;
+
   return true;
 }
 
@@ -40,6 +40,44 @@ class TreeIndexConf : public IndexConf {
     return item_feature_group_id_;
   }
 
+  void set_two_level_score_num(uint32_t two_level_score_num) {
+    two_level_score_num_ = two_level_score_num;
+  }
+
+  // Max node num scored by one model predict for a level and its children,
+  // 0 to score level by level
+  uint32_t two_level_score_num() const {
+    return two_level_score_num_;
+  }
+
+  void set_parallel_score_num(uint32_t parallel_score_num) {
+    parallel_score_num_ = parallel_score_num;
+  }
+
+  // Max parallel predicts scoring the nodes of a level for a request
+  uint32_t parallel_score_num() const {
+    return parallel_score_num_;
+  }
+
+  void set_parallel_score_batch(uint32_t parallel_score_batch) {
+    parallel_score_batch_ = parallel_score_batch;
+  }
+
+  // Min node num scored by each of the parallel predicts
+  uint32_t parallel_score_batch() const {
+    return parallel_score_batch_;
+  }
+
+  void set_search_device(int32_t search_device) {
+    search_device_ = search_device;
+  }
+
+  // The gpu keeping the tree, whose searches expand and select the nodes
+  // there, -1 to search on host
+  int32_t search_device() const {
+    return search_device_;
+  }
+
  private:
   bool ParseTreeLevelTopN(const std::string& conf_str);
 
@@ -47,6 +85,10 @@ class TreeIndexConf : public IndexConf {
   std::tr1::unordered_map<uint32_t, uint32_t> level_to_topn_;
   uint32_t model_batch_num_;
   std::string item_feature_group_id_;
+  uint32_t two_level_score_num_;
+  uint32_t parallel_score_num_;
+  uint32_t parallel_score_batch_;
+  int32_t search_device_;
 };
 
 }  // namespace tdm_serving
@@ -25,10 +25,13 @@ struct TreeMeta {
   uint32_t total_node_num_;
   // level starts with 0
   uint32_t max_level_;
+  // max children num of a node
+  uint32_t max_sub_node_num_;
 
   TreeMeta()
       : total_node_num_(0),
-      max_level_(0) {
+      max_level_(0),
+      max_sub_node_num_(0) {
   }
 };
 
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "index/tree/tree_search_context.h"
 #include <stdio.h>
+#include "index/tree/device_beam.h"
 #include "util/str_util.h"
 #include "util/log.h"
 
@@ -22,28 +23,44 @@ namespace tdm_serving {
 
 // ----------------------- NodeScore -----------------------
 NodeScore::NodeScore()
-    : node_(NULL), parent_(NULL), score_(0), is_winner_(true) {
+    : node_(NULL), parent_(NULL), score_(0), is_winner_(true),
+      is_scored_(false) {
 }
 
 NodeScore::NodeScore(Node* node)
-    : node_(node), parent_(NULL), score_(0), is_winner_(true) {
+    : node_(node), parent_(NULL), score_(0), is_winner_(true),
+      is_scored_(false) {
 }
 
 NodeScore::NodeScore(Node* node, float score)
-    : node_(node), parent_(NULL), score_(score), is_winner_(true) {
+    : node_(node), parent_(NULL), score_(score), is_winner_(true),
+      is_scored_(false) {
 }
 
 NodeScore::NodeScore(Node* node, float score, NodeScore* parent)
-    : node_(node), parent_(parent), score_(score), is_winner_(true) {
+    : node_(node), parent_(parent), score_(score), is_winner_(true),
+      is_scored_(false) {
+}
+
+// ----------------------- NodeScoreArena -----------------------
+const uint32_t NodeScoreArena::kBlockSize;
+
+NodeScoreArena::~NodeScoreArena() {
+  for (uint32_t i = 0; i < blocks_.size(); i++) {
+    delete [] blocks_[i];
+  }
 }
 
 // ----------------------- TreeSearchContext -----------------------
 TreeSearchContext::~TreeSearchContext() {
-  for (uint32_t i = 0; i < node_layers_.size(); i++) {
-    for (uint32_t j = 0; j < node_layers_[i].size(); j++) {
-      delete node_layers_[i][j];
-    }
+  DELETE_AND_SET_NULL(device_beam_);
+}
+
+DeviceBeam* TreeSearchContext::mutable_device_beam() {
+  if (device_beam_ == NULL) {
+    device_beam_ = new DeviceBeam();
   }
+  return device_beam_;
 }
 
 void TreeSearchContext::Clear() {
@@ -51,6 +68,9 @@ void TreeSearchContext::Clear() {
     node_score_size_[i] = 0;
   }
   node_layer_size_ = 0;
+  prefetch_node_score_size_ = 0;
+  prefetch_scores_.clear();
+  arena_.Reset();
 
   SearchContext::Clear();
 }
@@ -17,6 +17,10 @@ limitations under the License.
 #define TDM_SERVING_INDEX_TREE_TREE_SEARCH_CONTEXT_H_
 
 #include <tr1/unordered_map>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
 #include "index/search_context.h"
 #include "index/item.h"
 #include "index/tree/tree_def.h"
@@ -25,6 +29,8 @@ limitations under the License.
 
 namespace tdm_serving {
 
+class DeviceBeam;
+
 // Tree node info used in tree searching
 class NodeScore : public Item, public ItemFeature {
  public:
@@ -57,14 +63,22 @@ class NodeScore : public Item, public ItemFeature {
     return is_winner_;
   }
 
+  void set_is_scored(bool is_scored) {
+    is_scored_ = is_scored;
+  }
+
+  bool is_scored() const {
+    return is_scored_;
+  }
+
   uint32_t node_level() const {
-    return node_->node_info()->level();
+    return node_->level();
   }
 
   // item interface
   // used for filter and sort item
   uint64_t item_id() const {
-    return node_->node_info()->id();
+    return node_->id();
   }
 
   void set_score(float score) {
@@ -99,7 +113,7 @@ class NodeScore : public Item, public ItemFeature {
 
   virtual uint64_t feature_entity_id(size_t /*grp_index*/,
                                      size_t /*ent_index*/) const {
-    return node_->node_info()->hashid();
+    return node_->hashid();
   }
 
   virtual float feature_entity_value(size_t /*grp_index*/,
@@ -125,6 +139,10 @@ class NodeScore : public Item, public ItemFeature {
   // set true for default
   bool is_winner_;
 
+  // if the score is calculated by model already,
+  // e.g. prefetched together with the parent level
+  bool is_scored_;
+
   // feature group id, used for item feature interface
   // tree item feature can be of one feature group now 
   const std::string* feature_group_id_;
@@ -133,11 +151,57 @@ class NodeScore : public Item, public ItemFeature {
 typedef std::vector<NodeScore*> NodeScoreVec;
 typedef std::vector<NodeScoreVec> NodeLayers;
 
+// Arena of NodeScores allocated by blocks and reset wholesale,
+// so that the searches of a pooled context reuse the same NodeScores
+class NodeScoreArena {
+ public:
+  NodeScoreArena() : size_(0) {}
+
+  ~NodeScoreArena();
+
+  NodeScore* Alloc() {
+    uint32_t block = size_ / kBlockSize;
+    if (block == blocks_.size()) {
+      blocks_.push_back(new NodeScore[kBlockSize]);
+    }
+    return blocks_[block] + (size_++ % kBlockSize);
+  }
+
+  // Ensure the capacity of size NodeScores
+  void Reserve(uint32_t size) {
+    while (blocks_.size() * kBlockSize < size) {
+      blocks_.push_back(new NodeScore[kBlockSize]);
+    }
+  }
+
+  // Free all the NodeScores, the blocks are kept
+  void Reset() {
+    size_ = 0;
+  }
+
+  uint32_t size() const {
+    return size_;
+  }
+
+  uint32_t capacity() const {
+    return blocks_.size() * kBlockSize;
+  }
+
+ private:
+  static const uint32_t kBlockSize = 1024;
+
+  std::vector<NodeScore*> blocks_;
+  uint32_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(NodeScoreArena);
+};
+
 // Search context used for tree searching
 class TreeSearchContext : public SearchContext {
  public:
   TreeSearchContext()
-    : node_layer_size_(0) {}
+    : node_layer_size_(0), prefetch_node_score_size_(0),
+      device_beam_(NULL) {}
 
   virtual ~TreeSearchContext();
 
@@ -149,14 +213,16 @@ class TreeSearchContext : public SearchContext {
 
     node_score_size_[level]++;
     if (node_score_size_[level] > node_score_vec->size()) {
-      node_score_vec->push_back(new NodeScore());
+      node_score_vec->push_back(NULL);
     }
-    NodeScore* node_score = node_score_vec->at(node_score_size_[level] - 1);
+    NodeScore* node_score = arena_.Alloc();
+    node_score_vec->at(node_score_size_[level] - 1) = node_score;
 
     node_score->set_node(node);
     node_score->set_score(score);
     node_score->set_parent(NULL);
     node_score->set_is_winner(true);
+    node_score->set_is_scored(false);
 
     return node_score;
   }
@@ -168,18 +234,26 @@ class TreeSearchContext : public SearchContext {
 
     node_score_size_[level]++;
     if (node_score_size_[level] > node_score_vec->size()) {
-      node_score_vec->push_back(new NodeScore());
+      node_score_vec->push_back(NULL);
     }
-    NodeScore* node_score = node_score_vec->at(node_score_size_[level] - 1);
+    NodeScore* node_score = arena_.Alloc();
+    node_score_vec->at(node_score_size_[level] - 1) = node_score;
 
     node_score->set_node(node);
     node_score->set_score(score);
     node_score->set_parent(parent);
     node_score->set_is_winner(true);
+    node_score->set_is_scored(false);
 
     return node_score;
   }
 
+  // Drop the candidates of level, the NodeScores are kept until Clear
+  void clear_node_scores(uint32_t level) {
+    layers_node_scores(level);
+    node_score_size_[level] = 0;
+  }
+
   // Get candidate size by tree search level
   uint32_t layer_node_score_size(uint32_t level) {
     return node_score_size_[level];
@@ -222,6 +296,87 @@ class TreeSearchContext : public SearchContext {
     node_layer_size_ = size;
   }
 
+  // Add node to be scored ahead of its level
+  NodeScore* add_prefetch_node_score(Node* node) {
+    prefetch_node_score_size_++;
+    if (prefetch_node_score_size_ > prefetch_node_scores_.size()) {
+      prefetch_node_scores_.push_back(NULL);
+    }
+    NodeScore* node_score = arena_.Alloc();
+    prefetch_node_scores_.at(prefetch_node_score_size_ - 1) = node_score;
+
+    node_score->set_node(node);
+    node_score->set_score(0);
+    node_score->set_parent(NULL);
+    node_score->set_is_winner(true);
+    node_score->set_is_scored(false);
+
+    return node_score;
+  }
+
+  // Get nodes to be scored ahead of their level
+  NodeScoreVec* prefetch_node_scores() {
+    return &prefetch_node_scores_;
+  }
+
+  // Buffers reused by sorting the candidates
+  std::vector<float>* sort_scores() {
+    return &sort_scores_;
+  }
+
+  std::vector<uint32_t>* sort_indices() {
+    return &sort_indices_;
+  }
+
+  NodeScoreVec* sort_node_scores() {
+    return &sort_node_scores_;
+  }
+
+  // Keep the scores of the prefetched nodes, and reuse them for next level
+  void keep_prefetch_scores() {
+    if (prefetch_node_score_size_ == 0) {
+      return;
+    }
+    for (uint32_t i = 0; i < prefetch_node_score_size_; i++) {
+      NodeScore* node_score = prefetch_node_scores_[i];
+      prefetch_scores_.push_back(
+          PrefetchScore(node_score->node(), node_score->score()));
+    }
+    std::sort(prefetch_scores_.begin(), prefetch_scores_.end());
+    prefetch_node_score_size_ = 0;
+  }
+
+  // Get the prefetched score of node, return false if not prefetched
+  bool prefetch_score(const Node* node, float* score) const {
+    std::vector<PrefetchScore>::const_iterator iter = std::lower_bound(
+        prefetch_scores_.begin(), prefetch_scores_.end(),
+        PrefetchScore(node, -std::numeric_limits<float>::infinity()));
+    if (iter == prefetch_scores_.end() || iter->first != node) {
+      return false;
+    }
+    *score = iter->second;
+    return true;
+  }
+
+  // Reserve the candidates of level by the size hint
+  void reserve_node_scores(uint32_t level, uint32_t size) {
+    layers_node_scores(level)->reserve(size);
+  }
+
+  // Reserve the NodeScores of a search by the size hint,
+  // the pooled contexts allocate nothing once reserved
+  void reserve_arena(uint32_t size) {
+    arena_.Reserve(size);
+    prefetch_scores_.reserve(size);
+  }
+
+  uint32_t arena_capacity() const {
+    return arena_.capacity();
+  }
+
+  // The buffers of the searches on gpu, kept with the pooled context
+  DeviceBeam* mutable_device_beam();
+
  private:
   // candidate layers
   NodeLayers node_layers_;
@@ -232,6 +387,25 @@ class TreeSearchContext : public SearchContext {
   // candidate size of each layer
   std::vector<uint32_t> node_score_size_;
 
+  // nodes scored ahead of their level
+  NodeScoreVec prefetch_node_scores_;
+  uint32_t prefetch_node_score_size_;
+
+  // prefetched scores sorted by node
+  typedef std::pair<const Node*, float> PrefetchScore;
+  std::vector<PrefetchScore> prefetch_scores_;
+
+  // all the NodeScores of a search
+  NodeScoreArena arena_;
+
+  // sort buffers
+  std::vector<float> sort_scores_;
+  std::vector<uint32_t> sort_indices_;
+  NodeScoreVec sort_node_scores_;
+
+  // searches on gpu
+  DeviceBeam* device_beam_;
+
   DISALLOW_COPY_AND_ASSIGN(TreeSearchContext);
 };
 
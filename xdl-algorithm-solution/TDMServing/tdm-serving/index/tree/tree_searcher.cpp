@@ -14,30 +14,51 @@ limitations under the License.
 ==============================================================================*/
 
 #include "index/tree/tree_searcher.h"
+#include <algorithm>
 #include <unordered_map>
 #include "biz/filter.h"
 #include "index/tree/tree_index_conf.h"
 #include "index/tree/tree.h"
 #include "index/tree/tree_search_context.h"
+#include "util/stage_stat.h"
 #include "util/str_util.h"
+#include "util/top_k.h"
 #include "util/log.h"
 
 namespace tdm_serving {
 
-bool CompareNodeScoreforParentWinner(const NodeScore* const node_1,
-                                     const NodeScore* const node_2) {
-  bool parent_1_win = node_1->parent() == NULL ||
-      node_1->parent()->is_winner();
-  bool parent_2_win = node_2->parent() == NULL ||
-      node_2->parent()->is_winner();
+bool IsParentWinner(const NodeScore* const node) {
+  return node->parent() == NULL || node->parent()->is_winner();
+}
 
-  if (parent_1_win && !parent_2_win) {
-    return true;
-  } else if (!parent_1_win && parent_2_win) {
-    return false;
-  } else {
-    return node_1->score() > node_2->score();
+// Put the top k of nodes by score first in order, and the others after
+void SelectNodes(TreeSearchContext* context,
+                 NodeScore** nodes, uint32_t size, uint32_t k) {
+  if (size == 0 || k == 0) {
+    return;
+  }
+
+  // select over the contiguous scores rather than the node pointers
+  std::vector<float>* scores = context->sort_scores();
+  scores->resize(size);
+  for (uint32_t i = 0; i < size; ++i) {
+    (*scores)[i] = nodes[i]->score();
+  }
+  std::vector<uint32_t>* indices = context->sort_indices();
+  util::SelectTopK(scores->data(), size, k, indices);
+
+  NodeScoreVec* sorted = context->sort_node_scores();
+  sorted->clear();
+  for (size_t i = 0; i < indices->size(); ++i) {
+    sorted->push_back(nodes[indices->at(i)]);
+    nodes[indices->at(i)] = NULL;
   }
+  for (uint32_t i = 0; i < size; ++i) {
+    if (nodes[i] != NULL) {
+      sorted->push_back(nodes[i]);
+    }
+  }
+  std::copy(sorted->begin(), sorted->end(), nodes);
 }
 
 TreeSearcher::TreeSearcher()
@@ -52,11 +73,23 @@ bool TreeSearcher::Init(const TreeIndexConf* index_conf) {
   return true;
 }
 
+bool TreeSearcher::InitDeviceTree(Tree* tree) {
+  if (index_conf_->search_device() < 0) {
+    return false;
+  }
+  return device_tree_.Init(tree, index_conf_->search_device());
+}
+
 bool TreeSearcher::Search(Tree* tree,
                           TreeSearchContext* context,
                           const SearchParam& search_param) {
+  if (UseDeviceSearch(context)) {
+    return DeviceSearch(tree, context, search_param);
+  }
+
   // resize context node layer to avoid memory reallocation
   context->resize_node_layers(tree->max_level() + 1);
+  ReserveNodes(tree, context);
 
   // add root node, score reset to 1
   context->add_node_score(tree->root(), kRootLevel, 1.0);
@@ -69,13 +102,19 @@ bool TreeSearcher::Search(Tree* tree,
   bool ret = false;
   while (!is_break) {
     // calculate score
-    ret = CalculateNodes(context, search_param, level, max_level);
+    {
+      util::ScopedStageTimer timer(util::kStagePredict, level);
+      ret = CalculateNodes(context, search_param, level, max_level);
+    }
     if (!ret) {
       return false;
     }
 
     // sort
-    SortNodes(context, search_param, level, max_level);
+    {
+      util::ScopedStageTimer timer(util::kStageSort, level);
+      SortNodes(context, search_param, level, max_level);
+    }
 
     // end
     if (level == max_level) {
@@ -83,7 +122,10 @@ bool TreeSearcher::Search(Tree* tree,
     }
 
     // spread nodes
-    SpreadNodes(context, search_param, level);
+    {
+      util::ScopedStageTimer timer(util::kStageSpread, level);
+      SpreadNodes(context, search_param, level);
+    }
 
      // next level
     level++;
@@ -92,11 +134,246 @@ bool TreeSearcher::Search(Tree* tree,
   return true;
 }
 
+void TreeSearcher::ReserveNodes(Tree* tree, TreeSearchContext* context) {
+  // a level has at most the winners of its parent level times the fan-out,
+  // and the max level has the winner leaves of the upper levels too
+  uint32_t max_level = tree->max_level();
+  uint32_t fan_out = tree->max_sub_node_size();
+  uint32_t total_size = 1;
+  uint32_t upper_winner_size = 0;
+  for (uint32_t level = kRootLevel + 1; level <= max_level; ++level) {
+    uint32_t parent_topn = index_conf_->tree_level_topn(level - 1);
+    uint32_t level_size = parent_topn * fan_out;
+    upper_winner_size += parent_topn;
+    if (level == max_level) {
+      level_size += upper_winner_size;
+    }
+    context->reserve_node_scores(level, level_size);
+    total_size += level_size;
+  }
+  total_size += index_conf_->two_level_score_num();
+
+  context->reserve_arena(total_size);
+}
+
+uint32_t TreeSearcher::MaxLevelSize(Tree* tree) const {
+  // as the level sizes of ReserveNodes
+  uint32_t max_level = tree->max_level();
+  uint32_t fan_out = tree->max_sub_node_size();
+  uint32_t max_size = 1;
+  uint32_t upper_winner_size = 0;
+  for (uint32_t level = kRootLevel + 1; level <= max_level; ++level) {
+    uint32_t parent_topn = index_conf_->tree_level_topn(level - 1);
+    uint32_t level_size = parent_topn * fan_out;
+    upper_winner_size += parent_topn;
+    if (level == max_level) {
+      level_size += upper_winner_size;
+    }
+    max_size = std::max(max_size, level_size);
+  }
+  return max_size;
+}
+
+bool TreeSearcher::UseDeviceSearch(TreeSearchContext* context) const {
+  // the filters and the prefetched children are on host
+  return device_tree_.ready() && context->filter() == NULL &&
+      index_conf_->two_level_score_num() == 0;
+}
+
+bool TreeSearcher::DeviceSearch(Tree* tree,
+                                TreeSearchContext* context,
+                                const SearchParam& search_param) {
+  DeviceBeam* beam = context->mutable_device_beam();
+  if (!beam->Init(&device_tree_, MaxLevelSize(tree)) ||
+      !beam->Reset(tree->node_pos(tree->root()))) {
+    LOG_ERROR << "device beam init failed";
+    return false;
+  }
+  context->resize_node_layers(tree->max_level() + 1);
+  ReserveNodes(tree, context);
+
+  uint32_t max_level = tree->max_level();
+  std::vector<uint32_t> positions;
+  std::vector<float> scores;
+  std::vector<ItemFeature*> item_features;
+  for (uint32_t level = kRootLevel; ; ++level) {
+    // the levels of at most topn candidates keep them all unscored,
+    // and the max level is sorted all, as on host
+    uint32_t candidate_size = beam->candidate_size();
+    uint32_t topn = index_conf_->tree_level_topn(level);
+    if (level == max_level) {
+      topn = search_param.topn();
+    }
+    bool select = level != kRootLevel && candidate_size > topn;
+
+    // calculate score, of the children of the winners only, the leaves
+    // kept for the max level go first there
+    if (select) {
+      util::ScopedStageTimer timer(util::kStagePredict, level);
+      if (!beam->FetchCandidates(&positions)) {
+        return false;
+      }
+      uint32_t begin = level == max_level ? beam->leaf_size() : 0;
+      item_features.clear();
+      for (uint32_t i = begin; i < positions.size(); ++i) {
+        NodeScore* node_score = context->add_node_score(
+            tree->node_by_pos(positions[i]), level, 1);
+        node_score->set_feature_group_id(
+            &index_conf_->item_feature_group_id());
+        item_features.push_back(node_score);
+      }
+      LOG_DEBUG << "level " << level << " score " << item_features.size()
+                << " of " << candidate_size << " nodes on device";
+      if (!item_features.empty() &&
+          !CalculateDeviceScore(context, search_param, &item_features,
+                                beam, begin)) {
+        return false;
+      }
+    }
+
+    // sort
+    {
+      util::ScopedStageTimer timer(util::kStageSort, level);
+      bool ret = true;
+      if (!select) {
+        ret = beam->KeepAll();
+      } else if (level == max_level) {
+        ret = beam->Select(candidate_size);
+      } else {
+        ret = beam->Select(topn);
+      }
+      if (!ret) {
+        return false;
+      }
+    }
+
+    // end
+    if (level == max_level) {
+      break;
+    }
+
+    // spread nodes, the winner leaves of the sorted levels go to the max
+    // level as SortNodes puts them
+    {
+      util::ScopedStageTimer timer(util::kStageSpread, level);
+      if (!beam->Expand(kAllCategoryMask, select, level + 1 == max_level)) {
+        return false;
+      }
+    }
+  }
+
+  // the results are the max level
+  if (!beam->FetchWinners(&positions, &scores)) {
+    return false;
+  }
+  context->clear_node_scores(max_level);
+  for (size_t i = 0; i < positions.size(); ++i) {
+    context->add_node_score(tree->node_by_pos(positions[i]), max_level,
+                            scores[i]);
+  }
+
+  return true;
+}
+
+bool TreeSearcher::BatchSearch(
+    Tree* tree,
+    const std::vector<TreeSearchContext*>& contexts,
+    const std::vector<const SearchParam*>& search_params) {
+  if (contexts.empty()) {
+    return true;
+  }
+
+  std::vector<const UserInfo*> user_infos;
+  for (size_t i = 0; i < contexts.size(); ++i) {
+    contexts[i]->resize_node_layers(tree->max_level() + 1);
+    ReserveNodes(tree, contexts[i]);
+    contexts[i]->add_node_score(tree->root(), kRootLevel, 1.0);
+
+    const SearchParam* search_param = search_params[i];
+    if (search_param->has_user_info() &&
+        search_param->user_info().has_user_feature()) {
+      user_infos.push_back(&search_param->user_info());
+    } else {
+      user_infos.push_back(NULL);
+    }
+  }
+
+  uint32_t max_level = tree->max_level();
+  std::vector<NodeScore*> node_scores;
+  std::vector<uint32_t> item_users;
+  for (uint32_t level = kRootLevel; ; ++level) {
+    // calculate score, the candidates of all the users together
+    {
+      util::ScopedStageTimer timer(util::kStagePredict, level);
+      node_scores.clear();
+      item_users.clear();
+      for (size_t i = 0; i < contexts.size(); ++i) {
+        CollectNodes(contexts[i], *search_params[i], level, max_level,
+                     &node_scores);
+        item_users.resize(node_scores.size(), i);
+      }
+      if (!node_scores.empty()) {
+        LOG_DEBUG << "level " << level << " score " << node_scores.size()
+                  << " nodes of " << contexts.size() << " users";
+        std::vector<ItemFeature*> item_features(node_scores.begin(),
+                                                node_scores.end());
+        if (!CalculateBatchScore(contexts[0], user_infos, item_users,
+                                 &item_features, &node_scores)) {
+          return false;
+        }
+        for (size_t i = 0; i < contexts.size(); ++i) {
+          contexts[i]->keep_prefetch_scores();
+        }
+      }
+    }
+
+    // sort
+    {
+      util::ScopedStageTimer timer(util::kStageSort, level);
+      for (size_t i = 0; i < contexts.size(); ++i) {
+        SortNodes(contexts[i], *search_params[i], level, max_level);
+      }
+    }
+
+    // end
+    if (level == max_level) {
+      break;
+    }
+
+    // spread nodes
+    {
+      util::ScopedStageTimer timer(util::kStageSpread, level);
+      for (size_t i = 0; i < contexts.size(); ++i) {
+        SpreadNodes(contexts[i], *search_params[i], level);
+      }
+    }
+  }
+
+  return true;
+}
+
 bool TreeSearcher::CalculateNodes(TreeSearchContext* context,
                                   const SearchParam& search_param,
                                   uint32_t level, uint32_t max_level) {
   std::vector<NodeScore*> node_scores;
+  CollectNodes(context, search_param, level, max_level, &node_scores);
+  if (node_scores.empty()) {
+    return true;
+  }
+
+  // batch process
+  if (!ParallelCalculateScore(context, search_param, &node_scores)) {
+    return false;
+  }
+  context->keep_prefetch_scores();
 
+  return true;
+}
+
+void TreeSearcher::CollectNodes(TreeSearchContext* context,
+                                const SearchParam& search_param,
+                                uint32_t level, uint32_t max_level,
+                                std::vector<NodeScore*>* node_scores) {
   NodeScoreVec* candidates = context->layers_node_scores(level);
   uint32_t candidate_size = context->layer_node_score_size(level);
   uint32_t ltopn = index_conf_->tree_level_topn(level);
@@ -110,12 +387,13 @@ bool TreeSearcher::CalculateNodes(TreeSearchContext* context,
       (level == max_level && candidate_size <= search_param.topn())) {
     LOG_DEBUG << "level " << level <<
         " not need calc, " << candidate_size << " to " << ltopn;
-    return true;
+    return;
   }
   LOG_DEBUG << "level " << level <<
       " need calc, " << candidate_size << " to " << ltopn;
 
   // calculate score
+  size_t score_begin = node_scores->size();
   for (uint32_t i = 0; i < candidate_size; ++i) {
     NodeScore* node_score = candidates->at(i);
 
@@ -125,23 +403,123 @@ bool TreeSearcher::CalculateNodes(TreeSearchContext* context,
 
     // do not recalculate
     if (node_score->node_level() == level) {
-      node_scores.push_back(node_score);
+      if (!node_score->is_scored()) {
+        node_scores->push_back(node_score);
+      }
     } else {
       LOG_WARN << "node level mismatch, layer: " << level <<
           " != node level: " << node_score->node_level() <<
           " for node_id: " << node_score->item_id();
     }
   }
+  uint32_t score_size = node_scores->size() - score_begin;
 
-  // batch process
-  std::vector<ItemFeature*> item_features(node_scores.begin(),
-                                          node_scores.end());
-  if (!CalculateScore(context, search_param,
-                      &item_features, &node_scores)) {
-    return false;
+  // all prefetched with the parent level
+  if (score_size == 0) {
+    LOG_DEBUG << "level " << level << " prefetched";
+    return;
   }
 
-  return true;
+  // score the children together if the beam is narrow
+  uint32_t prefetch_size = 0;
+  if (level != max_level) {
+    prefetch_size = PrefetchNodes(context, level, score_size);
+  }
+  NodeScoreVec* prefetch_node_scores = context->prefetch_node_scores();
+  for (uint32_t i = 0; i < prefetch_size; ++i) {
+    node_scores->push_back(prefetch_node_scores->at(i));
+  }
+}
+
+bool TreeSearcher::ParallelCalculateScore(
+    TreeSearchContext* context,
+    const SearchParam& search_param,
+    std::vector<NodeScore*>* node_scores) {
+  uint32_t node_size = node_scores->size();
+  uint32_t chunk_num = std::min(index_conf_->parallel_score_num(),
+                                node_size / index_conf_->parallel_score_batch());
+
+  if (chunk_num <= 1) {
+    std::vector<ItemFeature*> item_features(node_scores->begin(),
+                                            node_scores->end());
+    return CalculateScore(context, search_param,
+                          &item_features, node_scores, 0);
+  }
+
+  LOG_DEBUG << "score " << node_size << " nodes in "
+            << chunk_num << " parallel chunks";
+
+  // get the predict contexts before predicting in parallel
+  for (uint32_t i = 0; i < chunk_num; ++i) {
+    context->mutable_predict_context(i);
+  }
+
+  uint32_t chunk_size = (node_size + chunk_num - 1) / chunk_num;
+  bool ret = true;
+#pragma omp parallel for num_threads(chunk_num) schedule(static, 1)
+  for (uint32_t i = 0; i < chunk_num; ++i) {
+    uint32_t begin = i * chunk_size;
+    uint32_t end = std::min(begin + chunk_size, node_size);
+    if (begin >= end) {
+      continue;
+    }
+    std::vector<NodeScore*> chunk_node_scores(node_scores->begin() + begin,
+                                              node_scores->begin() + end);
+    std::vector<ItemFeature*> chunk_item_features(
+        chunk_node_scores.begin(), chunk_node_scores.end());
+    if (!CalculateScore(context, search_param, &chunk_item_features,
+                        &chunk_node_scores, i)) {
+      ret = false;
+    }
+  }
+
+  return ret;
+}
+
+uint32_t TreeSearcher::PrefetchNodes(TreeSearchContext* context,
+                                     uint32_t level, uint32_t score_size) {
+  uint32_t max_score_size = index_conf_->two_level_score_num();
+  if (max_score_size == 0) {
+    return 0;
+  }
+
+  NodeScoreVec* candidates = context->layers_node_scores(level);
+  uint32_t candidate_size = context->layer_node_score_size(level);
+
+  // the winners are unknown yet, prefetch the children of all candidates
+  uint32_t prefetch_size = 0;
+  for (uint32_t i = 0; i < candidate_size; ++i) {
+    NodeScore* node_score = candidates->at(i);
+    if (node_score->node_level() == level) {
+      prefetch_size += node_score->node()->sub_node_size();
+    }
+  }
+  if (prefetch_size == 0 || score_size + prefetch_size > max_score_size) {
+    return 0;
+  }
+
+  prefetch_size = 0;
+  for (uint32_t i = 0; i < candidate_size; ++i) {
+    NodeScore* node_score = candidates->at(i);
+    if (node_score->node_level() != level) {
+      continue;
+    }
+    Node* node = node_score->node();
+    for (size_t j = 0; j < node->sub_node_size(); j++) {
+      Node* sub_node = node->sub_node(j);
+      if (sub_node == NULL) {
+        continue;
+      }
+      NodeScore* sub_node_score = context->add_prefetch_node_score(sub_node);
+      sub_node_score->set_feature_group_id(
+          &index_conf_->item_feature_group_id());
+      prefetch_size++;
+    }
+  }
+  LOG_DEBUG << "level " << level << " prefetch " << prefetch_size
+            << " children with " << score_size << " nodes";
+
+  return prefetch_size;
 }
 
 void TreeSearcher::SortNodes(TreeSearchContext* context,
@@ -162,10 +540,17 @@ void TreeSearcher::SortNodes(TreeSearchContext* context,
     LOG_DEBUG << "level " << level <<
         " need sort, " << candidate_size << " to " << sortn;
 
-    std::partial_sort(candidates->begin(),
-                      candidates->begin() + sortn,
-                      candidates->begin() + candidate_size,
-                      CompareNodeScoreforParentWinner);
+    // the candidates whose parent wins go first
+    NodeScore** nodes = &candidates->at(0);
+    uint32_t win_size = std::partition(nodes, nodes + candidate_size,
+                                       IsParentWinner) - nodes;
+    if (win_size >= sortn) {
+      SelectNodes(context, nodes, win_size, sortn);
+    } else {
+      SelectNodes(context, nodes, win_size, win_size);
+      SelectNodes(context, nodes + win_size,
+                  candidate_size - win_size, sortn - win_size);
+    }
 
     // get winner, candidate is winner by default, update here
     for (uint32_t i = sortn; i < candidate_size; i++) {
@@ -209,6 +594,13 @@ void TreeSearcher::SpreadNodes(TreeSearchContext* context,
   NodeScoreVec* candidates = context->layers_node_scores(level);
   uint32_t candidate_size = context->layer_node_score_size(level);
 
+  // the categories which may pass the filter
+  uint64_t pass_category_mask = kAllCategoryMask;
+  if (context->filter() != NULL) {
+    pass_category_mask = context->filter()->PassCategoryMask(
+        &search_param.filter_info());
+  }
+
   for (uint32_t i = 0; i < candidate_size; ++i) {
     NodeScore* node_score = candidates->at(i);
     Node* node = node_score->node();
@@ -227,6 +619,13 @@ void TreeSearcher::SpreadNodes(TreeSearchContext* context,
         continue;
       }
 
+      // none of the leaves under sub node can pass the filter
+      if ((sub_node->category_mask() & pass_category_mask) == 0) {
+        LOG_DEBUG << "node: " << sub_node->id()
+                  << " is pruned by category";
+        continue;
+      }
+
       if (context->filter() != NULL) {
         NodeScore item(sub_node);
         if (context->filter()->IsFiltered(&search_param.filter_info(), item)) {
@@ -236,8 +635,15 @@ void TreeSearcher::SpreadNodes(TreeSearchContext* context,
         }
       }
 
-      context->add_node_score(sub_node,
-          sub_node->node_info()->level(), 1, node_score);
+      NodeScore* sub_node_score = context->add_node_score(sub_node,
+          sub_node->level(), 1, node_score);
+
+      // scored together with this level
+      float score = 0;
+      if (context->prefetch_score(sub_node, &score)) {
+        sub_node_score->set_score(score);
+        sub_node_score->set_is_scored(true);
+      }
     }
   }
 }
@@ -245,7 +651,8 @@ void TreeSearcher::SpreadNodes(TreeSearchContext* context,
 bool TreeSearcher::CalculateScore(TreeSearchContext* context,
                                   const SearchParam& search_param,
                                   std::vector<ItemFeature*>* item_features,
-                                  std::vector<NodeScore*>* node_scores) {
+                                  std::vector<NodeScore*>* node_scores,
+                                  uint32_t predict_index) {
   PredictRequest predict_req;
   PredictResponse predict_res;
 
@@ -261,7 +668,7 @@ bool TreeSearcher::CalculateScore(TreeSearchContext* context,
   }
 
   bool ret = ModelManager::Instance().Predict(
-      context->mutable_predict_context(),
+      context->mutable_predict_context(predict_index),
       predict_req, &predict_res);
   if (!ret) {
     LOG_ERROR << "model predict failed.";
@@ -275,4 +682,89 @@ bool TreeSearcher::CalculateScore(TreeSearchContext* context,
   return true;
 }
 
+bool TreeSearcher::CalculateDeviceScore(
+    TreeSearchContext* context,
+    const SearchParam& search_param,
+    std::vector<ItemFeature*>* item_features,
+    DeviceBeam* beam, uint32_t begin) {
+  PredictRequest predict_req;
+  PredictResponse predict_res;
+
+  predict_req.set_model_name(index_conf_->model_name());
+  predict_req.set_model_version(index_conf_->model_version());
+  predict_req.set_item_features(item_features);
+  predict_req.set_raw_scores(true);
+
+  if (search_param.has_user_info() &&
+      search_param.user_info().has_user_feature()) {
+    predict_req.set_user_info(&search_param.user_info());
+  } else {
+    predict_req.set_user_info(NULL);
+  }
+
+  bool ret = ModelManager::Instance().Predict(
+      context->mutable_predict_context(0), predict_req, &predict_res);
+  if (!ret) {
+    LOG_ERROR << "model predict failed.";
+    return false;
+  }
+
+  // the scores left on gpu by the model, or on host
+  if (predict_res.raw_scores() != NULL) {
+    if (predict_res.raw_score_size() != item_features->size()) {
+      LOG_ERROR << "model predict " << predict_res.raw_score_size()
+                << " raw scores for " << item_features->size() << " nodes";
+      return false;
+    }
+    return beam->SetScores(begin, item_features->size(),
+                           predict_res.raw_scores(),
+                           predict_res.raw_score_stride(),
+                           predict_res.raw_score_offset());
+  }
+  if (predict_res.score_size() != item_features->size()) {
+    LOG_ERROR << "model predict " << predict_res.score_size()
+              << " scores for " << item_features->size() << " nodes";
+    return false;
+  }
+  std::vector<float> scores(item_features->size());
+  for (size_t i = 0; i < scores.size(); i++) {
+    scores[i] = predict_res.score(i);
+  }
+  return beam->SetScores(begin, scores.size(), scores.data(), 1, 0);
+}
+
+bool TreeSearcher::CalculateBatchScore(
+    TreeSearchContext* context,
+    const std::vector<const UserInfo*>& user_infos,
+    const std::vector<uint32_t>& item_users,
+    std::vector<ItemFeature*>* item_features,
+    std::vector<NodeScore*>* node_scores) {
+  PredictRequest predict_req;
+  PredictResponse predict_res;
+
+  predict_req.set_model_name(index_conf_->model_name());
+  predict_req.set_model_version(index_conf_->model_version());
+  predict_req.set_item_features(item_features);
+  predict_req.set_user_infos(&user_infos);
+  predict_req.set_item_users(&item_users);
+
+  bool ret = ModelManager::Instance().Predict(
+      context->mutable_predict_context(0), predict_req, &predict_res);
+  if (!ret) {
+    LOG_ERROR << "model batch predict failed.";
+    return false;
+  }
+  if (predict_res.score_size() != node_scores->size()) {
+    LOG_ERROR << "model batch predict " << predict_res.score_size()
+              << " scores for " << node_scores->size() << " nodes";
+    return false;
+  }
+
+  for (size_t i = 0; i < predict_res.score_size(); i++) {
+    node_scores->at(i)->set_score(predict_res.score(i));
+  }
+
+  return true;
+}
+
 }  // namespace tdm_serving
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <vector>
 #include "common/common_def.h"
+#include "index/tree/device_beam.h"
 #include "proto/search.pb.h"
 
 namespace tdm_serving {
@@ -36,23 +37,86 @@ class TreeSearcher {
 
   bool Init(const TreeIndexConf* index_conf);
 
+  // Keep the child lists of tree on the search device of the conf, so that
+  // the searches without filter and two level score expand the winners and
+  // select the top n of the levels there. False if the tree stays on host.
+  bool InitDeviceTree(Tree* tree);
+
   bool Search(Tree* tree,
               TreeSearchContext* context,
               const SearchParam& search_param);
 
+  // Search for the users of search_params at once, contexts[i] searches
+  // for search_params[i]. The candidates of a level are scored for all the
+  // users by one predict, with the predict context of contexts[0].
+  bool BatchSearch(Tree* tree,
+                   const std::vector<TreeSearchContext*>& contexts,
+                   const std::vector<const SearchParam*>& search_params);
+
+  // Reserve the NodeScores of the search by the level topn and the fan-out
+  void ReserveNodes(Tree* tree, TreeSearchContext* context);
+
  protected:
   // Calculate node scores by accessing model layer
+  // with the predict context of predict_index
   virtual bool CalculateScore(TreeSearchContext* context,
                               const SearchParam& search_param,
                               std::vector<ItemFeature*>* item_features,
-                              std::vector<NodeScore*>* node_scores);
+                              std::vector<NodeScore*>* node_scores,
+                              uint32_t predict_index);
+
+  // Calculate the node scores of several users by one predict,
+  // the user of node i is user_infos[item_users[i]]
+  virtual bool CalculateBatchScore(
+      TreeSearchContext* context,
+      const std::vector<const UserInfo*>& user_infos,
+      const std::vector<uint32_t>& item_users,
+      std::vector<ItemFeature*>* item_features,
+      std::vector<NodeScore*>* node_scores);
+
+  // Calculate the scores of the candidates [begin, begin + item_features
+  // size) of beam by one predict, which stay on gpu if the model leaves
+  // them there
+  virtual bool CalculateDeviceScore(TreeSearchContext* context,
+                                    const SearchParam& search_param,
+                                    std::vector<ItemFeature*>* item_features,
+                                    DeviceBeam* beam, uint32_t begin);
 
  private:
+  // If the search of context selects and expands on the device tree
+  bool UseDeviceSearch(TreeSearchContext* context) const;
+
+  // Search with the beam of the levels on gpu, the candidates come to host
+  // for the item features only, and the winners for the results
+  bool DeviceSearch(Tree* tree,
+                    TreeSearchContext* context,
+                    const SearchParam& search_param);
+
+  // Max candidates of a level, by the level topn and the fan-out
+  uint32_t MaxLevelSize(Tree* tree) const;
+
+  // Add the candidates of level to be scored to node_scores, with the
+  // children prefetched together
+  void CollectNodes(TreeSearchContext* context,
+                    const SearchParam& search_param,
+                    uint32_t level, uint32_t max_level,
+                    std::vector<NodeScore*>* node_scores);
+
   // Calculate score for each candidate node
   bool CalculateNodes(TreeSearchContext* context,
                       const SearchParam& search_param,
                       uint32_t level, uint32_t max_level);
 
+  // Calculate node scores in parallel chunks if there are enough nodes
+  bool ParallelCalculateScore(TreeSearchContext* context,
+                              const SearchParam& search_param,
+                              std::vector<NodeScore*>* node_scores);
+
+  // Add the children of the candidates to be scored with level if
+  // there are at most two_level_score_num nodes, return the prefetch size
+  uint32_t PrefetchNodes(TreeSearchContext* context,
+                         uint32_t level, uint32_t score_size);
+
   // Sort nodes by score
   void SortNodes(TreeSearchContext* context,
                  const SearchParam& search_param,
@@ -66,6 +130,8 @@ class TreeSearcher {
  private:
   const TreeIndexConf* index_conf_;
 
+  DeviceTree device_tree_;
+
   DISALLOW_COPY_AND_ASSIGN(TreeSearcher);
 };
 
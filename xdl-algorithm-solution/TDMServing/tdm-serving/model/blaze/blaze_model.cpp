@@ -24,6 +24,7 @@ limitations under the License.
 #include "util/str_util.h"
 #include "util/log.h"
 #include "util/object_free_list.h"
+#include "util/stage_stat.h"
 
 namespace tdm_serving {
 
@@ -97,6 +98,10 @@ bool BlazeModel::Init(const ModelConf* model_conf) {
   }
   delete predictor;
 
+  return true;
+}
+
+bool BlazeModel::Warmup() {
   // pre-allloc blaze predictors
   std::vector<PredictContext*> predictors;
   for (size_t i = 0; i < kPreAllocPredictorNum; i++) {
@@ -105,7 +110,6 @@ bool BlazeModel::Init(const ModelConf* model_conf) {
   for (size_t i = 0; i < predictors.size(); i++) {
     ReleasePredictContext(predictors[i]);
   }
-
   return true;
 }
 
@@ -120,13 +124,19 @@ bool BlazeModel::Predict(PredictContext* predict_ctx,
   blaze::Predictor* predictor = ctx->predictor();
 
   // set request
-  if (!SetRequest(ctx, predict_req)) {
-    return false;
+  {
+    util::ScopedStageTimer timer(util::kStageFeed, 0);
+    if (!SetRequest(ctx, predict_req)) {
+      return false;
+    }
   }
 
   // predict
-  if (!predictor->Forward()) {
-    return false;
+  {
+    util::ScopedStageTimer timer(util::kStageForward, 0);
+    if (!predictor->Forward()) {
+      return false;
+    }
   }
 
   if (!ParseResponse(ctx, predict_req, predict_res)) {
@@ -141,24 +151,47 @@ PredictContext* BlazeModel::GetPredictContext() {
   if (ctx->predictor() == NULL) {
     blaze::Predictor* predictor = predictor_manager_.CreatePredictor(
         blaze_model_conf_->device_type());
+    if (predictor != NULL && !user_tensor_map_.empty()) {
+      // the levels of a search feed the user features once, the user side
+      // of the model is computed by the first level only
+      predictor->SetCommonReused(true);
+    }
     ctx->set_predictor(predictor);
   }
   return ctx;
 }
 
 void BlazeModel::ReleasePredictContext(PredictContext* context) {
-  obj_pool_.Release(static_cast<BlazePredictContext*>(context),
-                    false);  // false, no erase obj
+  BlazePredictContext* ctx = static_cast<BlazePredictContext*>(context);
+  // the next user of ctx feeds its own user info
+  ctx->Clear();
+  obj_pool_.Release(ctx, false);  // false, no erase obj
 }
 
 bool BlazeModel::SetRequest(BlazePredictContext* ctx,
                             const PredictRequest& predict_req) const {
   blaze::Predictor* predictor = ctx->predictor();
 
-  // indicator
+  // indicator, the user of each ad
+  const std::vector<const UserInfo*>* user_infos = predict_req.user_infos();
+  size_t ad_num = predict_req.item_features()->size();
+  if (user_infos != NULL) {
+    if (predict_req.item_users() == NULL ||
+        predict_req.item_users()->size() != ad_num) {
+      LOG_ERROR << "item users size mismatch item features size " << ad_num;
+      return false;
+    }
+    if (!need_to_feed_indicator_ && user_infos->size() > 1) {
+      LOG_ERROR << "model without indicator can not predict "
+                << user_infos->size() << " users at once";
+      return false;
+    }
+  }
   if (need_to_feed_indicator_ == true) {
-    size_t ad_num = predict_req.item_features()->size();
     std::vector<uint32_t> indicators(ad_num, 0);
+    if (user_infos != NULL) {
+      indicators = *predict_req.item_users();
+    }
 
     std::string indicator_tensor_name =
         blaze::FeedNameUtility::IndicatorLevel2FeedName(0);
@@ -168,30 +201,61 @@ bool BlazeModel::SetRequest(BlazePredictContext* ctx,
     }
   }
 
-  // user feature
-  std::map<std::string, TensorInfo> user_tensor_map = user_tensor_map_;
+  // user feature, kept by the predictor inputs across the predicts
+  // of one search, which feed the same user info or user infos
+  if (user_infos != NULL) {
+    if (ctx->fed_user_infos() != user_infos) {
+      ctx->set_fed_user_info(NULL);
+      ctx->set_fed_user_infos(NULL);
+      if (!SetUserFeature(ctx, *user_infos)) {
+        return false;
+      }
+      ctx->set_fed_user_infos(user_infos);
+    }
+  } else if (ctx->fed_user_info() != predict_req.user_info()) {
+    ctx->set_fed_user_info(NULL);
+    ctx->set_fed_user_infos(NULL);
+    std::vector<const UserInfo*> users(1, predict_req.user_info());
+    if (!SetUserFeature(ctx, users)) {
+      return false;
+    }
+    ctx->set_fed_user_info(predict_req.user_info());
+  }
 
-  const FeatureGroupList& user_feature =
-          predict_req.user_info()->user_feature();
-  for (int i = 0; i < user_feature.feature_group_size(); i++) {
-    const FeatureGroup& feature_group = user_feature.feature_group(i);
-    const std::string& feature_group_id = feature_group.feature_group_id();
+  // ad feature
+  std::map<std::string, TensorInfo> ad_tensor_map = ad_tensor_map_;
+  std::set<std::string> has_filled;
 
-    auto it = user_tensor_map.find(feature_group_id);
-    if (it == user_tensor_map.end()) {
-      continue;
+  const std::vector<ItemFeature*>* item_features = predict_req.item_features();
+  for (size_t i = 0; i < item_features->size(); i++) {
+    const ItemFeature* item_feature = item_features->at(i);
+    has_filled.clear();
+
+    for (size_t j = 0; j < item_feature->feature_group_size(); j++) {
+      const std::string& feature_group_id = item_feature->feature_group_id(j);
+
+      auto it = ad_tensor_map.find(feature_group_id);
+      if (it == ad_tensor_map.end()) {
+        continue;
+      }
+      TensorInfo& ti = it->second;
+
+      for (size_t k = 0; k < item_feature->feature_entity_size(j); k++) {
+        ti.ids.push_back(item_feature->feature_entity_id(j, k));
+        ti.values.push_back(item_feature->feature_entity_value(j, k));
+      }
+      ti.segs.push_back(item_feature->feature_entity_size(j));
+      has_filled.insert(feature_group_id);
     }
-    TensorInfo& ti = it->second;
 
-    for (int j = 0; j < feature_group.feature_entity_size(); j++) {
-      const FeatureEntity& feature_entity = feature_group.feature_entity(j);
-      ti.ids.push_back(feature_entity.id());
-      ti.values.push_back(feature_entity.value());
+    for (auto &ti : ad_tensor_map) {
+      if (has_filled.count(ti.first) == 0) {
+        ti.second.segs.push_back(0);
+      }
     }
-    ti.segs.push_back(feature_group.feature_entity_size());
   }
 
-  for (auto &ti : user_tensor_map) {
+  for (auto &ti : ad_tensor_map) {
     std::string id_tensor_name =
         blaze::FeedNameUtility::SparseFeatureName2FeedName(
             ti.first, blaze::kSparseFeatureId);
@@ -208,10 +272,6 @@ bool BlazeModel::SetRequest(BlazePredictContext* ctx,
       return false;
     }
 
-    if (ti.second.ids.size() == 0) {
-      ti.second.segs.push_back(0);
-    }
-
     std::string seg_tensor_name =
         blaze::FeedNameUtility::SparseFeatureName2FeedName(
             ti.first, blaze::kAuxSparseFeatureSegment);
@@ -221,40 +281,55 @@ bool BlazeModel::SetRequest(BlazePredictContext* ctx,
     }
   }
 
-  // ad feature
-  std::map<std::string, TensorInfo> ad_tensor_map = ad_tensor_map_;
-  std::set<std::string> has_filled;
+  return true;
 
-  const std::vector<ItemFeature*>* item_features = predict_req.item_features();
-  for (size_t i = 0; i < item_features->size(); i++) {
-    const ItemFeature* item_feature = item_features->at(i);
-    has_filled.clear();
+}
 
-    for (size_t j = 0; j < item_feature->feature_group_size(); j++) {
-      const std::string& feature_group_id = item_feature->feature_group_id(j);
+bool BlazeModel::SetUserFeature(
+    BlazePredictContext* ctx,
+    const std::vector<const UserInfo*>& user_infos) const {
+  blaze::Predictor* predictor = ctx->predictor();
 
-      auto it = ad_tensor_map.find(feature_group_id);
-      if (it == ad_tensor_map.end()) {
-        continue;
-      }
-      TensorInfo& ti = it->second;
+  // one row of each feature group per user
+  std::map<std::string, TensorInfo> user_tensor_map = user_tensor_map_;
+  std::set<std::string> has_filled;
 
-      for (size_t k = 0; k < item_feature->feature_entity_size(j); k++) {
-        ti.ids.push_back(item_feature->feature_entity_id(j, k));
-        ti.values.push_back(item_feature->feature_entity_value(j, k));
+  for (size_t u = 0; u < user_infos.size(); u++) {
+    has_filled.clear();
+    if (user_infos[u] != NULL) {
+      const FeatureGroupList& user_feature = user_infos[u]->user_feature();
+      for (int i = 0; i < user_feature.feature_group_size(); i++) {
+        const FeatureGroup& feature_group = user_feature.feature_group(i);
+        const std::string& feature_group_id = feature_group.feature_group_id();
+
+        auto it = user_tensor_map.find(feature_group_id);
+        if (it == user_tensor_map.end()) {
+          continue;
+        }
+        TensorInfo& ti = it->second;
+
+        for (int j = 0; j < feature_group.feature_entity_size(); j++) {
+          const FeatureEntity& feature_entity = feature_group.feature_entity(j);
+          ti.ids.push_back(feature_entity.id());
+          ti.values.push_back(feature_entity.value());
+        }
+        // a group repeated in the user info goes to the same row
+        if (has_filled.insert(feature_group_id).second) {
+          ti.segs.push_back(feature_group.feature_entity_size());
+        } else {
+          ti.segs.back() += feature_group.feature_entity_size();
+        }
       }
-      ti.segs.push_back(item_feature->feature_entity_size(j));
-      has_filled.insert(feature_group_id);
     }
 
-    for (auto &ti : ad_tensor_map) {
+    for (auto &ti : user_tensor_map) {
       if (has_filled.count(ti.first) == 0) {
         ti.second.segs.push_back(0);
       }
     }
   }
 
-  for (auto &ti : ad_tensor_map) {
+  for (auto &ti : user_tensor_map) {
     std::string id_tensor_name =
         blaze::FeedNameUtility::SparseFeatureName2FeedName(
             ti.first, blaze::kSparseFeatureId);
@@ -281,7 +356,6 @@ bool BlazeModel::SetRequest(BlazePredictContext* ctx,
   }
 
   return true;
-
 }
 
 bool BlazeModel::ParseResponse(BlazePredictContext* ctx,
@@ -298,7 +372,26 @@ bool BlazeModel::ParseResponse(BlazePredictContext* ctx,
   size_t len = 0;
   size_t idx = 0;
 
-  if (!predictor->Output(idx, &output, &len)) {
+  // the scores stay on the gpu of the net for the raw scores
+  bool on_device = false;
+  if (predict_req.raw_scores()) {
+    if (!predictor->OutputRef(idx, &output, &len, &on_device)) {
+      LOG_ERROR << "predictor get output ref failed";
+      return false;
+    }
+    if (on_device) {
+      size_t float_len = len / sizeof(float);
+      if (float_len != predict_req.item_features()->size() * 2) {
+        LOG_ERROR << "predictor output tensor len " << float_len
+                       << "!= item feature size "
+                       << predict_req.item_features()->size() << "* 2";
+        return false;
+      }
+      predict_res->set_raw_scores(reinterpret_cast<float*>(output),
+                                  predict_req.item_features()->size(), 2, 1);
+      return true;
+    }
+  } else if (!predictor->Output(idx, &output, &len)) {
     LOG_ERROR << "predictor get output failed";
     return false;
   }
@@ -27,6 +27,7 @@ class BlazeModelConf;
 class BlazePredictContext;
 class PredictRequest;
 class PredictResponse;
+class UserInfo;
 class ItemFeature;
 
 struct TensorInfo {
@@ -51,6 +52,8 @@ class BlazeModel : public Model {
 
   virtual void ReleasePredictContext(PredictContext* context);
 
+  virtual bool Warmup();
+
  protected:
   virtual ModelConf* CreateModelConf();
 
@@ -73,6 +76,9 @@ class BlazeModel : public Model {
   bool SetRequest(BlazePredictContext* ctx,
                   const PredictRequest& predict_req) const;
 
+  bool SetUserFeature(BlazePredictContext* ctx,
+                      const std::vector<const UserInfo*>& user_infos) const;
+
   bool ParseResponse(BlazePredictContext* ctx,
                      const PredictRequest& predict_req,
                      PredictResponse* predict_res) const;
@@ -18,13 +18,14 @@ limitations under the License.
 
 #include "model/predict_context.h"
 #include "blaze/include/predictor.h"
+#include "proto/search.pb.h"
 
 namespace tdm_serving {
 
 class BlazePredictContext : public PredictContext {
  public:
   BlazePredictContext()
-    : predictor_(NULL) {}
+    : predictor_(NULL), fed_user_info_(NULL), fed_user_infos_(NULL) {}
 
   virtual ~BlazePredictContext() {
     delete predictor_;
@@ -38,9 +39,40 @@ class BlazePredictContext : public PredictContext {
     return predictor_;
   }
 
+  virtual void Clear() {
+    fed_user_info_ = NULL;
+    fed_user_infos_ = NULL;
+  }
+
+  // The user info whose features are in the predictor inputs, the levels
+  // of a search predict by the same user info and feed it only once
+  void set_fed_user_info(const UserInfo* user_info) {
+    fed_user_info_ = user_info;
+  }
+
+  const UserInfo* fed_user_info() const {
+    return fed_user_info_;
+  }
+
+  // The user infos of a batched search fed to the predictor, the levels
+  // of the search predict by the same vector of them
+  void set_fed_user_infos(const std::vector<const UserInfo*>* user_infos) {
+    fed_user_infos_ = user_infos;
+  }
+
+  const std::vector<const UserInfo*>* fed_user_infos() const {
+    return fed_user_infos_;
+  }
+
  private:
   // blaze object, stores session data and predicts score
   blaze::Predictor* predictor_;
+
+  // user info fed to predictor, reset when released
+  const UserInfo* fed_user_info_;
+
+  // user infos fed to predictor, reset when released
+  const std::vector<const UserInfo*>* fed_user_infos_;
 };
 
 }  // namespace tdm_serving
@@ -45,4 +45,8 @@ bool Model::Init(const ModelConf* /*model_conf*/) {
   return true;
 }
 
+bool Model::Warmup() {
+  return true;
+}
+
 }  // namespace tdm_serving
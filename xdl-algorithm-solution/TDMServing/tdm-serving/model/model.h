@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TDM_SERVING_MODEL_MODEL_H_
 #define TDM_SERVING_MODEL_MODEL_H_
 
+#include <memory>
 #include <string>
 #include "common/common_def.h"
 #include "model/model_conf.h"
@@ -53,6 +54,9 @@ class Model {
   // Release predict context
   virtual void ReleasePredictContext(PredictContext* context) = 0;
 
+  // Warm the loaded model up before it takes the predicts
+  virtual bool Warmup();
+
   // Get paht of version file used for model reloading
   const std::string& version_file_path() {
     return model_conf_->version_file_path();
@@ -75,6 +79,10 @@ class Model {
   DISALLOW_COPY_AND_ASSIGN(Model);
 };
 
+// Reference counted handle of a model version, the version is
+// released by the last handle after it is switched out
+typedef std::shared_ptr<Model> ModelHandle;
+
 // define register
 REGISTER_REGISTERER(Model);
 #define REGISTER_MODEL(title, name) \
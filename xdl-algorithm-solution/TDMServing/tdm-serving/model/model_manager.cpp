@@ -49,9 +49,6 @@ bool ModelManager::Init(const std::string& conf_path) {
     return true;
   }
 
-  // blaze init scheduler
-  blaze::InitScheduler(false, 1000, 100, 32, 4, 2);
-
   util::ConfParser conf_parser;
   if (!conf_parser.Init(conf_path)) {
     LOG_ERROR <<
@@ -59,6 +56,25 @@ bool ModelManager::Init(const std::string& conf_path) {
     return false;
   }
 
+  // blaze init scheduler, the batching merges the concurrent
+  // tree search levels of the requests into one blaze forward
+  bool enable_batching = false;
+  uint32_t max_batch_size = 1000;
+  uint32_t batch_timeout_micros = 100;
+  conf_parser.GetValue<bool>(kBlazeSchedulerSection, kConfigEnableBatching,
+                             false, &enable_batching);
+  conf_parser.GetValue<uint32_t>(kBlazeSchedulerSection, kConfigMaxBatchSize,
+                                 1000, &max_batch_size);
+  conf_parser.GetValue<uint32_t>(kBlazeSchedulerSection,
+                                 kConfigBatchTimeoutMicros,
+                                 100, &batch_timeout_micros);
+  LOG_INFO << "[" << kBlazeSchedulerSection << "] "
+           << kConfigEnableBatching << ": " << enable_batching << ", "
+           << kConfigMaxBatchSize << ": " << max_batch_size << ", "
+           << kConfigBatchTimeoutMicros << ": " << batch_timeout_micros;
+  blaze::InitScheduler(enable_batching, max_batch_size,
+                       batch_timeout_micros, 32, 4, 2);
+
   const std::vector<util::ConfSection*>& conf_sections =
       conf_parser.GetAllConfSection();
 
@@ -71,6 +87,10 @@ bool ModelManager::Init(const std::string& conf_path) {
     }
 
     const std::string& section = conf_section->GetSectionName();
+    if (section == kBlazeSchedulerSection) {
+      continue;
+    }
+
     ModelUnit* model_unit = new ModelUnit();
     if (!model_unit->Init(section, conf_path)) {
       LOG_ERROR << "[" << section << "] init model unit failed";
@@ -94,8 +114,16 @@ bool ModelManager::Predict(
     PredictContext* predict_ctx,
     const PredictRequest& predict_req,
     PredictResponse* predict_res) {
-  Model* model = GetModel(predict_req.model_name(),
-                          predict_req.model_version());
+  // predict by the version the context is got from,
+  // which may be switched out during the search
+  ModelHandle model;
+  if (predict_ctx != NULL && predict_ctx->model() != NULL &&
+      (predict_req.model_version().empty() ||
+       predict_req.model_version() == predict_ctx->model()->model_version())) {
+    model = predict_ctx->model();
+  } else {
+    model = GetModel(predict_req.model_name(), predict_req.model_version());
+  }
 
   if (model == NULL) {
     LOG_WARN << "get NULL model by model_name: "
@@ -118,18 +146,28 @@ bool ModelManager::Predict(
 
 PredictContext*
 ModelManager::GetPredictContext(const std::string& model_name) {
-  Model* model = GetModel(model_name);
+  ModelHandle model = GetModel(model_name);
   if (model == NULL) {
     LOG_DEBUG << "get predict context failed";
     return NULL;
-  } else {
-    return model->GetPredictContext();
   }
+  PredictContext* context = model->GetPredictContext();
+  if (context != NULL) {
+    context->set_model(model);
+  }
+  return context;
 }
 
 void ModelManager::ReleasePredictContext(const std::string& model_name,
                                          PredictContext* context) {
-  Model* model = GetModel(model_name);
+  // release to the version the context is got from
+  ModelHandle model;
+  if (context != NULL && context->model() != NULL) {
+    model = context->model();
+    context->set_model(ModelHandle());
+  } else {
+    model = GetModel(model_name);
+  }
   if (model != NULL) {
     model->ReleasePredictContext(context);
   } else {
@@ -147,16 +185,16 @@ ModelUnit* ModelManager::GetModelUnit(const std::string& model_name) {
   return iter->second;
 }
 
-Model* ModelManager::GetModel(const std::string& model_name,
-                              const std::string& model_version) {
+ModelHandle ModelManager::GetModel(const std::string& model_name,
+                                   const std::string& model_version) {
   ModelUnit* model_unit = GetModelUnit(model_name);
   if (model_unit == NULL) {
     LOG_WARN << "get model unit by model_name: "
                   << model_name << " failed";
-    return NULL;
+    return ModelHandle();
   }
 
-  Model* model = model_unit->GetModel(model_version);
+  ModelHandle model = model_unit->GetModel(model_version);
   if (model == NULL) {
     LOG_WARN << "get index by model unit with model_name: "
                   << model_name << " failed";
@@ -166,7 +204,7 @@ Model* ModelManager::GetModel(const std::string& model_name,
 
 bool ModelManager::HasModel(const std::string& model_name,
                             const std::string& model_version) {
-  Model* model = GetModel(model_name, model_version);
+  ModelHandle model = GetModel(model_name, model_version);
   if (model == NULL) {
     return false;
   }
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <string>
 #include "common/common_def.h"
+#include "model/model.h"
 #include "util/conf_parser.h"
 #include "util/singleton.h"
 #include "util/concurrency/mutex.h"
@@ -25,7 +26,6 @@ limitations under the License.
 namespace tdm_serving {
 
 class ModelUnit;
-class Model;
 class PredictContext;
 class PredictRequest;
 class PredictResponse;
@@ -62,9 +62,9 @@ class ModelManager : public util::Singleton<ModelManager> {
   bool HasModel(const std::string& model_name,
                 const std::string& model_version = "");
 
-  // Get model by name and version
+  // Get handle of the model by name and version
   // if version is set to empty, get the latest version
-  Model* GetModel(const std::string& model_name,
+  ModelHandle GetModel(const std::string& model_name,
                   const std::string& model_version = "");
 
  private:
@@ -21,14 +21,10 @@ limitations under the License.
 
 namespace tdm_serving {
 
-ModelUnit::ModelUnit() : enable_(true) {
+ModelUnit::ModelUnit() : enable_(true), idx_(0) {
 }
 
 ModelUnit::~ModelUnit() {
-  for (uint32_t i = 0; i < model_datas_.size(); ++i) {
-    DELETE_AND_SET_NULL(model_datas_[i]);
-  }
-  model_datas_.clear();
   if (!version_file_path_.empty()) {
     util::FileMonitor::UnWatch(version_file_path_);
   }
@@ -84,9 +80,7 @@ bool ModelUnit::Init(const std::string& section,
   LOG_INFO << "[" << section_ << "] "
                 << kConfigModelType << ": " << model_type_;
 
-  for (uint32_t i = 0; i < kModelInstanceNum; ++i) {
-    model_datas_.push_back(NULL);
-  }
+  model_datas_.resize(kModelInstanceNum);
 
   if (!Reload()) {
     LOG_ERROR << "model unit init to reload failed";
@@ -94,7 +88,7 @@ bool ModelUnit::Init(const std::string& section,
   }
 
   // register file monitor
-  version_file_path_ = model_datas_[idx_]->version_file_path();
+  version_file_path_ = GetModel()->version_file_path();
   if (version_file_path_.empty()) {
     LOG_INFO << "[" << section_ << "] need not reload model";
   } else {
@@ -116,19 +110,30 @@ bool ModelUnit::Reload() {
         "[" << section_ << "] get model_type: " << model_type_ << " failed";
     return false;
   }
+  ModelHandle new_model(model);
   if (!model->Init(section_, conf_parser_)) {
     LOG_ERROR << "[" << section_ << "] init model failed";
     return false;
   }
 
-  // switch
-  uint32_t new_idx = (idx_ + 1) % kModelInstanceNum;
-  Model* old_model = model_datas_[new_idx];
-  model_datas_[new_idx] = model;
-  idx_ = new_idx;
+  // warm up before taking the predicts
+  if (!model->Warmup()) {
+    LOG_ERROR << "[" << section_ << "] warm up model failed";
+    return false;
+  }
+
+  // switch, the dropped version lives on until its predicts end
+  ModelHandle old_model;
+  {
+    util::SimpleMutex::Locker slock(&mutex_);
+    uint32_t new_idx = (idx_ + 1) % kModelInstanceNum;
+    old_model = model_datas_[new_idx];
+    model_datas_[new_idx] = new_model;
+    idx_ = new_idx;
+  }
   if (old_model != NULL) {
-    LOG_INFO << "[" << section_ << "] release old model";
-    delete old_model;
+    LOG_INFO << "[" << section_ << "] release old model, in use by "
+             << old_model.use_count() - 1 << " predicts";
   }
   LOG_INFO << "[" << section_ << "] new model switch success";
 
@@ -139,7 +144,8 @@ bool ModelUnit::is_enabled() {
   return enable_;
 }
 
-Model* ModelUnit::GetModel(const std::string& model_version) {
+ModelHandle ModelUnit::GetModel(const std::string& model_version) {
+  util::SimpleMutex::Locker slock(&mutex_);
   if (model_version.empty()) {
     return model_datas_[idx_];
   }
@@ -150,7 +156,7 @@ Model* ModelUnit::GetModel(const std::string& model_version) {
       return model_datas_[i];
     }
   }
-  return NULL;
+  return ModelHandle();
 }
 
 }  // namespace tdm_serving
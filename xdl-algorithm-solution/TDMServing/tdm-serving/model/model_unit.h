@@ -19,14 +19,16 @@ limitations under the License.
 #include <string>
 #include <vector>
 #include "common/common_def.h"
+#include "model/model.h"
 #include "util/conf_parser.h"
+#include "util/concurrency/mutex.h"
 
 namespace tdm_serving {
 
-class Model;
-
 // Manages model reloading
-// Uses multi-bufferd model for single-write/multi-read
+// Keeps the latest versions for the versioned predicts, a new version
+// is loaded and warmed up aside, then switched in, and the dropped one
+// is released by the last predict holding its handle
 class ModelUnit {
  public:
   ModelUnit();
@@ -36,17 +38,21 @@ class ModelUnit {
 
   bool Reload();
 
-  Model* GetModel(const std::string& model_version = "");
+  // Get handle of the version, the latest one if version is empty
+  ModelHandle GetModel(const std::string& model_version = "");
 
   bool is_enabled();
 
  private:
   bool enable_;
   std::string model_type_;
-  uint32_t idx_;
-  std::vector<Model*> model_datas_;
   std::string version_file_path_;
 
+  // the mutex guards the handle copies and switches only
+  uint32_t idx_;
+  std::vector<ModelHandle> model_datas_;
+  util::SimpleMutex mutex_;
+
   // config
   std::string section_;
   std::string conf_path_;
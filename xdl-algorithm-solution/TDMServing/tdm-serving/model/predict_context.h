@@ -16,10 +16,13 @@ limitations under the License.
 #ifndef TDM_SERVING_MODEL_PREDICT_CONTEXT_H_
 #define TDM_SERVING_MODEL_PREDICT_CONTEXT_H_
 
+#include <memory>
 #include "common/common_def.h"
 
 namespace tdm_serving {
 
+class Model;
+
 // session data used for predicing
 class PredictContext {
  public:
@@ -27,6 +30,19 @@ class PredictContext {
   virtual ~PredictContext() {}
 
   virtual void Clear() {}
+
+  // The model version the context is got from, held while the
+  // context is in use so that it is released to the same version
+  void set_model(const std::shared_ptr<Model>& model) {
+    model_ = model;
+  }
+
+  const std::shared_ptr<Model>& model() const {
+    return model_;
+  }
+
+ private:
+  std::shared_ptr<Model> model_;
 };
 
 }  // namespace tdm_serving
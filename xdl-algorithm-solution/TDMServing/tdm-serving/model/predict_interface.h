@@ -46,7 +46,9 @@ class ItemFeature {
 // Model layer interface, predict request
 class PredictRequest {
  public:
-  PredictRequest() : user_info_(NULL), item_features_(NULL) {
+  PredictRequest() : user_info_(NULL), item_features_(NULL),
+                     user_infos_(NULL), item_users_(NULL),
+                     raw_scores_(false) {
   }
 
   ~PredictRequest() {}
@@ -83,6 +85,35 @@ class PredictRequest {
     item_features_ = item_features;
   }
 
+  // The users of a request scoring the items of several users at once,
+  // NULL for the requests of user_info only
+  const std::vector<const UserInfo*>* user_infos() const {
+    return user_infos_;
+  }
+
+  void set_user_infos(const std::vector<const UserInfo*>* user_infos) {
+    user_infos_ = user_infos;
+  }
+
+  // The index in user_infos of the user of each item
+  const std::vector<uint32_t>* item_users() const {
+    return item_users_;
+  }
+
+  void set_item_users(const std::vector<uint32_t>* item_users) {
+    item_users_ = item_users;
+  }
+
+  // True to get the scores where the model computed them, such as on the
+  // gpu, by the raw scores of the response
+  bool raw_scores() const {
+    return raw_scores_;
+  }
+
+  void set_raw_scores(bool raw_scores) {
+    raw_scores_ = raw_scores;
+  }
+
  private:
   // name of model, used for locate model
   std::string model_name_;
@@ -95,12 +126,22 @@ class PredictRequest {
 
   // item features
   const std::vector<ItemFeature*>* item_features_;
+
+  // users of the items, set with item_users
+  const std::vector<const UserInfo*>* user_infos_;
+
+  // user index of the items
+  const std::vector<uint32_t>* item_users_;
+
+  // if the scores are kept where the model computed them
+  bool raw_scores_;
 };
 
 // Model layer interface, predict response
 class PredictResponse {
  public:
-  PredictResponse() {}
+  PredictResponse() : raw_scores_(NULL), raw_score_size_(0),
+                      raw_score_stride_(1), raw_score_offset_(0) {}
   ~PredictResponse() {}
 
   size_t score_size() {
@@ -115,9 +156,43 @@ class PredictResponse {
     scores_.push_back(score);
   }
 
+  // The score of item i at raw_scores[i * stride + offset], on host or on
+  // the gpu of the model, valid until the next predict of the context.
+  // Set instead of the scores for the requests of raw_scores, by the models
+  // which can.
+  void set_raw_scores(const float* raw_scores, size_t size,
+                      uint32_t stride, uint32_t offset) {
+    raw_scores_ = raw_scores;
+    raw_score_size_ = size;
+    raw_score_stride_ = stride;
+    raw_score_offset_ = offset;
+  }
+
+  const float* raw_scores() const {
+    return raw_scores_;
+  }
+
+  size_t raw_score_size() const {
+    return raw_score_size_;
+  }
+
+  uint32_t raw_score_stride() const {
+    return raw_score_stride_;
+  }
+
+  uint32_t raw_score_offset() const {
+    return raw_score_offset_;
+  }
+
  private:
   // item scores
   std::vector<float> scores_;
+
+  // item scores left by the model
+  const float* raw_scores_;
+  size_t raw_score_size_;
+  uint32_t raw_score_stride_;
+  uint32_t raw_score_offset_;
 };
 
 }  // namespace tdm_serving
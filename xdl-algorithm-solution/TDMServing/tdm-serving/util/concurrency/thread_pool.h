@@ -0,0 +1,94 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TDM_SERVING_UTIL_CONCURRENCY_THREAD_POOL_H_
+#define TDM_SERVING_UTIL_CONCURRENCY_THREAD_POOL_H_
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "common/common_def.h"
+
+namespace tdm_serving {
+namespace util {
+
+// Fixed number of worker threads running the scheduled closures in order,
+// the remaining closures are run before the pool is destroyed
+class ThreadPool {
+ public:
+  explicit ThreadPool(uint32_t thread_num) : stop_(false) {
+    for (uint32_t i = 0; i < thread_num; ++i) {
+      threads_.push_back(std::thread(&ThreadPool::Loop, this));
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (size_t i = 0; i < threads_.size(); ++i) {
+      threads_[i].join();
+    }
+  }
+
+  void Schedule(const std::function<void()>& closure) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closures_.push_back(closure);
+    }
+    cv_.notify_one();
+  }
+
+  uint32_t thread_num() const {
+    return threads_.size();
+  }
+
+ private:
+  void Loop() {
+    while (true) {
+      std::function<void()> closure;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return stop_ || !closures_.empty(); });
+        if (closures_.empty()) {
+          return;
+        }
+        closure = closures_.front();
+        closures_.pop_front();
+      }
+      closure();
+    }
+  }
+
+ private:
+  std::vector<std::thread> threads_;
+  std::deque<std::function<void()> > closures_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+}  // namespace util
+}  // namespace tdm_serving
+
+#endif  // TDM_SERVING_UTIL_CONCURRENCY_THREAD_POOL_H_
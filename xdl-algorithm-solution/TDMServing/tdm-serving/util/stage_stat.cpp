@@ -0,0 +1,71 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "util/stage_stat.h"
+
+namespace tdm_serving {
+namespace util {
+
+const uint32_t StageStat::kMaxLevel;
+
+StageStat::StageStat() : enabled_(false) {
+  Reset();
+}
+
+void StageStat::Add(SearchStage stage, uint32_t level, double seconds) {
+  if (level >= kMaxLevel) {
+    level = kMaxLevel - 1;
+  }
+  nanos_[stage][level].fetch_add(static_cast<uint64_t>(seconds * 1e9),
+                                 std::memory_order_relaxed);
+  counts_[stage][level].fetch_add(1, std::memory_order_relaxed);
+}
+
+double StageStat::total_time(SearchStage stage, uint32_t level) const {
+  return nanos_[stage][level].load(std::memory_order_relaxed) * 1e-9;
+}
+
+uint64_t StageStat::count(SearchStage stage, uint32_t level) const {
+  return counts_[stage][level].load(std::memory_order_relaxed);
+}
+
+void StageStat::Reset() {
+  for (int i = 0; i < kSearchStageNum; ++i) {
+    for (uint32_t j = 0; j < kMaxLevel; ++j) {
+      nanos_[i][j].store(0, std::memory_order_relaxed);
+      counts_[i][j].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+const char* StageStat::StageName(SearchStage stage) {
+  switch (stage) {
+    case kStagePredict:
+      return "predict";
+    case kStageSort:
+      return "sort";
+    case kStageSpread:
+      return "spread";
+    case kStageFeed:
+      return "feed";
+    case kStageForward:
+      return "forward";
+    default:
+      return "unknown";
+  }
+}
+
+}  // namespace util
+}  // namespace tdm_serving
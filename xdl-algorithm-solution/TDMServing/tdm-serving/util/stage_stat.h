@@ -0,0 +1,100 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TDM_SERVING_UTIL_STAGE_STAT_H_
+#define TDM_SERVING_UTIL_STAGE_STAT_H_
+
+#include <stdint.h>
+#include <atomic>
+#include "util/singleton.h"
+#include "util/timer.h"
+
+namespace tdm_serving {
+namespace util {
+
+// Stages of a search, the tree stages are timed per level,
+// the model stages over all the levels at level 0
+enum SearchStage {
+  kStagePredict = 0,  // feature building and model predict of a level
+  kStageSort,         // top k selection of a level
+  kStageSpread,       // children spreading with filtering of a level
+  kStageFeed,         // model feature feeding
+  kStageForward,      // model forward
+  kSearchStageNum
+};
+
+// Process wide accumulated time of the search stages, for benchmarking.
+// Disabled by default, when the stages cost one flag check each.
+class StageStat : public Singleton<StageStat> {
+ public:
+  static const uint32_t kMaxLevel = 32;
+
+  StageStat();
+
+  void set_enabled(bool enabled) {
+    enabled_ = enabled;
+  }
+
+  bool enabled() const {
+    return enabled_;
+  }
+
+  // levels beyond kMaxLevel are accumulated into the last one
+  void Add(SearchStage stage, uint32_t level, double seconds);
+
+  // total seconds and run count of stage at level
+  double total_time(SearchStage stage, uint32_t level) const;
+  uint64_t count(SearchStage stage, uint32_t level) const;
+
+  void Reset();
+
+  static const char* StageName(SearchStage stage);
+
+ private:
+  volatile bool enabled_;
+  std::atomic<uint64_t> nanos_[kSearchStageNum][kMaxLevel];
+  std::atomic<uint64_t> counts_[kSearchStageNum][kMaxLevel];
+
+  DISALLOW_COPY_AND_ASSIGN(StageStat);
+};
+
+// Times the scope into the stage if the stat is enabled
+class ScopedStageTimer {
+ public:
+  ScopedStageTimer(SearchStage stage, uint32_t level)
+      : stage_(stage), level_(level), start_(0) {
+    if (StageStat::Instance().enabled()) {
+      start_ = GetTime();
+    }
+  }
+
+  ~ScopedStageTimer() {
+    if (start_ > 0) {
+      StageStat::Instance().Add(stage_, level_, GetTime() - start_);
+    }
+  }
+
+ private:
+  SearchStage stage_;
+  uint32_t level_;
+  double start_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedStageTimer);
+};
+
+}  // namespace util
+}  // namespace tdm_serving
+
+#endif  // TDM_SERVING_UTIL_STAGE_STAT_H_
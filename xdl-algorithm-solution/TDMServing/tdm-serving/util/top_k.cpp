@@ -0,0 +1,113 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "util/top_k.h"
+#include <algorithm>
+#include <utility>
+
+// The block compare is built for avx2 whatever the flags of the build, and
+// runs if the cpu supports it. TDM_SERVING_NO_AVX2 leaves it out.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    !defined(TDM_SERVING_NO_AVX2)
+#define TDM_SERVING_TOP_K_AVX2
+#include <immintrin.h>
+#endif
+
+namespace tdm_serving {
+namespace util {
+
+namespace {
+
+typedef std::pair<float, uint32_t> ScoreIndex;
+
+// min heap by score, the lower index wins the equal scores
+inline bool Greater(const ScoreIndex& a, const ScoreIndex& b) {
+  return a.first > b.first || (a.first == b.first && a.second < b.second);
+}
+
+inline void Push(std::vector<ScoreIndex>* heap, float score, uint32_t index) {
+  std::pop_heap(heap->begin(), heap->end(), Greater);
+  heap->back() = ScoreIndex(score, index);
+  std::push_heap(heap->begin(), heap->end(), Greater);
+}
+
+#ifdef TDM_SERVING_TOP_K_AVX2
+// Push the scores of the blocks of 8 from begin that exceed the k-th
+// largest, returns the index of the scores left
+__attribute__((target("avx2")))
+uint32_t PushBlocksAvx2(const float* scores, uint32_t begin, uint32_t n,
+                        std::vector<ScoreIndex>* heap) {
+  uint32_t i = begin;
+  for (; i + 8 <= n; i += 8) {
+    __m256 threshold = _mm256_set1_ps(heap->front().first);
+    __m256 block = _mm256_loadu_ps(scores + i);
+    int mask = _mm256_movemask_ps(
+        _mm256_cmp_ps(block, threshold, _CMP_GT_OQ));
+    while (mask != 0) {
+      uint32_t j = i + __builtin_ctz(mask);
+      mask &= mask - 1;
+      if (scores[j] > heap->front().first) {
+        Push(heap, scores[j], j);
+      }
+    }
+  }
+  return i;
+}
+
+bool SupportsAvx2() {
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+#endif
+
+}  // namespace
+
+void SelectTopK(const float* scores, uint32_t n, uint32_t k,
+                std::vector<uint32_t>* indices) {
+  indices->clear();
+  if (k > n) {
+    k = n;
+  }
+  if (k == 0) {
+    return;
+  }
+
+  std::vector<ScoreIndex> heap(k);
+  for (uint32_t i = 0; i < k; ++i) {
+    heap[i] = ScoreIndex(scores[i], i);
+  }
+  std::make_heap(heap.begin(), heap.end(), Greater);
+
+  uint32_t i = k;
+#ifdef TDM_SERVING_TOP_K_AVX2
+  if (SupportsAvx2()) {
+    i = PushBlocksAvx2(scores, i, n, &heap);
+  }
+#endif
+  for (; i < n; ++i) {
+    if (scores[i] > heap.front().first) {
+      Push(&heap, scores[i], i);
+    }
+  }
+
+  std::sort_heap(heap.begin(), heap.end(), Greater);
+  indices->reserve(k);
+  for (uint32_t j = 0; j < k; ++j) {
+    indices->push_back(heap[j].second);
+  }
+}
+
+}  // namespace util
+}  // namespace tdm_serving
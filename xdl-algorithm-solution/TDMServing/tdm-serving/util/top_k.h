@@ -0,0 +1,35 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TDM_SERVING_UTIL_TOP_K_H_
+#define TDM_SERVING_UTIL_TOP_K_H_
+
+#include <stdint.h>
+#include <vector>
+
+namespace tdm_serving {
+namespace util {
+
+// Select the k largest of scores[0, n) into indices, ordered by the score
+// descending. The scores are contiguous, and a block of them is skipped
+// if none of it exceeds the k-th largest so far, which is the most blocks
+// as the heap of the k largest fills up.
+void SelectTopK(const float* scores, uint32_t n, uint32_t k,
+                std::vector<uint32_t>* indices);
+
+}  // namespace util
+}  // namespace tdm_serving
+
+#endif  // TDM_SERVING_UTIL_TOP_K_H_
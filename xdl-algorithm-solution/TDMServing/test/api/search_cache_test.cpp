@@ -0,0 +1,96 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+#include <string>
+#include "api/search_cache.h"
+
+namespace tdm_serving {
+
+SearchResult MockResult(uint64_t id) {
+  SearchResult search_result;
+  ResultUnit* unit = search_result.add_result_unit();
+  unit->set_id(id);
+  unit->set_score(0.5);
+  return search_result;
+}
+
+TEST(SearchCache, get_and_put) {
+  SearchCache cache;
+  ASSERT_TRUE(cache.Init(100, 10000));
+
+  SearchParam search_param;
+  search_param.set_topn(10);
+  std::string key;
+  ASSERT_TRUE(SearchCache::MakeKey(search_param, &key));
+
+  SearchResult search_result;
+  EXPECT_FALSE(cache.Get(key, "1/1", &search_result));
+
+  cache.Put(key, "1/1", MockResult(7));
+  ASSERT_TRUE(cache.Get(key, "1/1", &search_result));
+  ASSERT_EQ(1, search_result.result_unit_size());
+  EXPECT_EQ(7u, search_result.result_unit(0).id());
+
+  // the same request makes the same key
+  SearchParam same_param;
+  same_param.set_topn(10);
+  std::string same_key;
+  ASSERT_TRUE(SearchCache::MakeKey(same_param, &same_key));
+  EXPECT_EQ(key, same_key);
+
+  search_param.set_topn(20);
+  std::string other_key;
+  ASSERT_TRUE(SearchCache::MakeKey(search_param, &other_key));
+  EXPECT_FALSE(cache.Get(other_key, "1/1", &search_result));
+
+  // a new version invalidates the entry
+  EXPECT_FALSE(cache.Get(key, "2/1", &search_result));
+  EXPECT_EQ(0u, cache.size());
+}
+
+TEST(SearchCache, expire) {
+  SearchCache cache;
+  ASSERT_TRUE(cache.Init(100, 1));
+
+  SearchResult search_result;
+  cache.Put("key", "1", MockResult(7));
+  usleep(5000);
+  EXPECT_FALSE(cache.Get("key", "1", &search_result));
+}
+
+TEST(SearchCache, evict) {
+  SearchCache cache;
+  ASSERT_TRUE(cache.Init(2, 10000, 1));
+
+  SearchResult search_result;
+  cache.Put("a", "1", MockResult(1));
+  cache.Put("b", "1", MockResult(2));
+  // a becomes the recently used, b is evicted
+  ASSERT_TRUE(cache.Get("a", "1", &search_result));
+  cache.Put("c", "1", MockResult(3));
+
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_TRUE(cache.Get("a", "1", &search_result));
+  EXPECT_FALSE(cache.Get("b", "1", &search_result));
+  EXPECT_TRUE(cache.Get("c", "1", &search_result));
+
+  cache.Clear();
+  EXPECT_EQ(0u, cache.size());
+}
+
+}  // namespace tdm_serving
@@ -0,0 +1,85 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+
+#include <stdlib.h>
+#include <vector>
+
+#define protected public
+#define private public
+
+#include "index/ann/ivf.h"
+
+namespace tdm_serving {
+
+// items around the four corners of the plane
+void MockEmbeddings(std::vector<uint64_t>* ids,
+                    std::vector<float>* embeddings) {
+  const float corners[4][2] = { {10, 10}, {-10, 10}, {-10, -10}, {10, -10} };
+  srand(1);
+  for (uint64_t i = 0; i < 400; ++i) {
+    const float* corner = corners[i % 4];
+    ids->push_back(i);
+    embeddings->push_back(corner[0] + (rand() % 100) / 100.0);
+    embeddings->push_back(corner[1] + (rand() % 100) / 100.0);
+  }
+}
+
+TEST(Ivf, build) {
+  std::vector<uint64_t> ids;
+  std::vector<float> embeddings;
+  MockEmbeddings(&ids, &embeddings);
+
+  Ivf ivf;
+  EXPECT_FALSE(ivf.Build(ids, std::vector<float>(3), 2, 4, 10));
+  ASSERT_TRUE(ivf.Build(ids, embeddings, 2, 4, 10));
+  EXPECT_EQ(2u, ivf.dim());
+  EXPECT_EQ(4u, ivf.list_num());
+  EXPECT_EQ(400u, ivf.size());
+
+  // each corner is a list
+  for (uint32_t l = 0; l < ivf.list_num(); ++l) {
+    EXPECT_EQ(100u, ivf.list_offsets_[l + 1] - ivf.list_offsets_[l]);
+  }
+}
+
+TEST(Ivf, search) {
+  std::vector<uint64_t> ids;
+  std::vector<float> embeddings;
+  MockEmbeddings(&ids, &embeddings);
+
+  Ivf ivf;
+  ASSERT_TRUE(ivf.Build(ids, embeddings, 2, 4, 10));
+
+  IvfSearchBuffer buffer;
+  float query[] = { 1, 1 };
+
+  // the list of the corner (10, 10) only
+  ivf.Search(query, 1, &buffer);
+  ASSERT_EQ(100u, buffer.ids.size());
+  for (size_t i = 0; i < buffer.ids.size(); ++i) {
+    EXPECT_EQ(0u, buffer.ids[i] % 4);
+    uint64_t id = buffer.ids[i];
+    float exact = embeddings[id * 2] + embeddings[id * 2 + 1];
+    EXPECT_NEAR(exact, buffer.scores[i], 0.2);
+  }
+
+  // all the lists
+  ivf.Search(query, 10, &buffer);
+  EXPECT_EQ(400u, buffer.ids.size());
+}
+
+}  // namespace tdm_serving
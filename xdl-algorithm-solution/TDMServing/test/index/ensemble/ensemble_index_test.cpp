@@ -0,0 +1,101 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <vector>
+
+#define protected public
+#define private public
+
+#include "index/ensemble/ensemble_index.h"
+#include "proto/search.pb.h"
+#include "util/concurrency/thread_pool.h"
+
+namespace tdm_serving {
+
+namespace {
+
+void AddResult(SearchResult* result, uint64_t id, float score) {
+  ResultUnit* unit = result->add_result_unit();
+  unit->set_id(id);
+  unit->set_score(score);
+}
+
+}  // namespace
+
+TEST(EnsembleIndex, merge_results) {
+  SearchResult first;
+  AddResult(&first, 1, 0.9);
+  AddResult(&first, 2, 0.5);
+  AddResult(&first, 3, 0.1);
+  SearchResult second;
+  AddResult(&second, 4, 30);
+  AddResult(&second, 2, 20);
+  AddResult(&second, 5, 10);
+
+  std::vector<const SearchResult*> results;
+  results.push_back(&first);
+  results.push_back(NULL);
+  results.push_back(&second);
+  std::vector<float> weights(3, 1.0);
+  weights[2] = 0.8;
+
+  // min max, the duplicated item keeps its highest score
+  SearchResult result;
+  EnsembleIndex::MergeResults(results, weights, kScoreNormalizeMinMax,
+                              3, &result);
+  ASSERT_EQ(3, result.result_unit_size());
+  EXPECT_EQ(1u, result.result_unit(0).id());
+  EXPECT_FLOAT_EQ(1.0, result.result_unit(0).score());
+  EXPECT_EQ(4u, result.result_unit(1).id());
+  EXPECT_FLOAT_EQ(0.8, result.result_unit(1).score());
+  EXPECT_EQ(2u, result.result_unit(2).id());
+  EXPECT_FLOAT_EQ(0.5, result.result_unit(2).score());
+
+  // rank
+  result.Clear();
+  EnsembleIndex::MergeResults(results, weights, kScoreNormalizeRank,
+                              10, &result);
+  ASSERT_EQ(5, result.result_unit_size());
+  EXPECT_EQ(1u, result.result_unit(0).id());
+  EXPECT_EQ(4u, result.result_unit(1).id());
+  EXPECT_EQ(2u, result.result_unit(2).id());
+  EXPECT_FLOAT_EQ(0.5, result.result_unit(2).score());
+
+  // none
+  result.Clear();
+  EnsembleIndex::MergeResults(results, weights, kScoreNormalizeNone,
+                              1, &result);
+  ASSERT_EQ(1, result.result_unit_size());
+  EXPECT_EQ(4u, result.result_unit(0).id());
+  EXPECT_FLOAT_EQ(24, result.result_unit(0).score());
+}
+
+TEST(EnsembleIndex, thread_pool) {
+  std::atomic<int> count(0);
+  {
+    util::ThreadPool pool(4);
+    EXPECT_EQ(4u, pool.thread_num());
+    for (int i = 0; i < 100; ++i) {
+      pool.Schedule([&count] { ++count; });
+    }
+  }
+  // the scheduled closures run before the pool is destroyed
+  EXPECT_EQ(100, count.load());
+}
+
+}  // namespace tdm_serving
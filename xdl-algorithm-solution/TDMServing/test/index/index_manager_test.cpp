@@ -30,8 +30,8 @@ TEST(IndexManager, init_and_search) {
   // init
   ASSERT_TRUE(IndexManager::Instance().Init(conf_path));
 
-  Index* index = IndexManager::Instance().GetIndex("mock_index_disable");
-  EXPECT_STREQ(nullptr, reinterpret_cast<const char*>(index));
+  IndexHandle index = IndexManager::Instance().GetIndex("mock_index_disable");
+  EXPECT_STREQ(nullptr, reinterpret_cast<const char*>(index.get()));
 
   index = IndexManager::Instance().GetIndex("mock_index_no_version");
   EXPECT_EQ("mock_index_no_version", index->index_name());
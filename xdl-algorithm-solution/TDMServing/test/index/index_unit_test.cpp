@@ -84,6 +84,9 @@ TEST(IndexUnit, reload) {
   EXPECT_EQ("123456",
             index_unit.GetIndex()->index_conf_->index_version());
 
+  // a search holding the old version across the switch
+  IndexHandle old_index = index_unit.GetIndex();
+
   std::string index_path = index_unit.GetIndex()->index_conf_->index_path();
   std::string version_path = index_path + "/version";
   std::string tmp_version_path = index_path + "/version.tmp";
@@ -100,6 +103,8 @@ TEST(IndexUnit, reload) {
             index_unit.GetIndex()->index_conf_->latest_index_path());
   EXPECT_EQ("223456",
             index_unit.GetIndex()->index_conf_->index_version());
+  EXPECT_EQ("123456", old_index->index_conf_->index_version());
+  EXPECT_EQ(1, old_index.use_count());
 
   cmd = "cp " + tmp_version_path + " " + version_path;
   system(cmd.c_str());
@@ -0,0 +1,155 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+
+#define protected public
+#define private public
+
+#include "index/tree/device_beam.h"
+#include "index/tree/node.h"
+#include "index/tree/tree.h"
+
+namespace tdm_serving {
+
+/*
+ * tree by pos:
+ *        0
+ *      /   \
+ *     1     2
+ *   /  \
+ *  3    4
+ */
+void MockDeviceTree(Tree* tree) {
+  uint32_t total_node_num = 5;
+  tree->tree_meta_.max_level_ = 2;
+  tree->tree_meta_.total_node_num_ = total_node_num;
+  tree->tree_meta_.max_sub_node_num_ = 2;
+
+  tree->nodes_ = new Node[total_node_num];
+  Node* tns = tree->nodes_;
+  for (uint32_t i = 0; i < total_node_num; i++) {
+    tns[i].node_info_ = new UINode;
+    tns[i].node_info_->set_id(i);
+    tns[i].sub_node_num_ = 0;
+  }
+  tns[0].node_info_->set_level(0);
+  tns[0].sub_node_num_ = 2;
+  tns[0].sub_nodes_ = tns + 1;
+  tns[1].node_info_->set_level(1);
+  tns[1].sub_node_num_ = 2;
+  tns[1].sub_nodes_ = tns + 3;
+  tns[2].node_info_->set_level(1);
+  tns[3].node_info_->set_level(2);
+  tns[4].node_info_->set_level(2);
+  for (uint32_t i = 0; i < total_node_num; i++) {
+    tns[i].set_node_info(tns[i].node_info_);
+    tns[i].set_category_mask(1u << i);
+  }
+}
+
+TEST(DeviceTree, flatten) {
+  Tree tree;
+  MockDeviceTree(&tree);
+
+  std::vector<uint32_t> first_child;
+  std::vector<uint32_t> child_num;
+  std::vector<uint64_t> category_mask;
+  DeviceTree::Flatten(&tree, &first_child, &child_num, &category_mask);
+
+  ASSERT_EQ(5u, first_child.size());
+  EXPECT_EQ(1u, first_child[0]);
+  EXPECT_EQ(2u, child_num[0]);
+  EXPECT_EQ(3u, first_child[1]);
+  EXPECT_EQ(2u, child_num[1]);
+  for (uint32_t pos = 2; pos < 5; ++pos) {
+    EXPECT_EQ(0u, child_num[pos]);
+  }
+  for (uint32_t pos = 0; pos < 5; ++pos) {
+    EXPECT_EQ(1u << pos, category_mask[pos]);
+  }
+}
+
+#ifdef TDM_SERVING_WITH_CUDA
+
+TEST(DeviceBeam, select_and_expand) {
+  Tree tree;
+  MockDeviceTree(&tree);
+  DeviceTree device_tree;
+  ASSERT_TRUE(device_tree.Init(&tree, 0));
+
+  DeviceBeam beam;
+  ASSERT_TRUE(beam.Init(&device_tree, 4));
+  ASSERT_TRUE(beam.Reset(0));
+  ASSERT_TRUE(beam.KeepAll());
+  ASSERT_TRUE(beam.Expand(~0ull, false, false));
+  std::vector<uint32_t> positions;
+  ASSERT_TRUE(beam.FetchCandidates(&positions));
+  ASSERT_EQ(2u, positions.size());
+  EXPECT_EQ(1u, positions[0]);
+  EXPECT_EQ(2u, positions[1]);
+
+  // the scores of the second column, the leaf 2 wins and is kept
+  float scores[] = { 0, 0.3, 0, 0.7 };
+  ASSERT_TRUE(beam.SetScores(0, 2, scores, 2, 1));
+  ASSERT_TRUE(beam.Select(1));
+  std::vector<float> winner_scores;
+  ASSERT_TRUE(beam.FetchWinners(&positions, &winner_scores));
+  ASSERT_EQ(1u, positions.size());
+  EXPECT_EQ(2u, positions[0]);
+  EXPECT_FLOAT_EQ(0.7, winner_scores[0]);
+  ASSERT_TRUE(beam.Expand(~0ull, true, true));
+  ASSERT_TRUE(beam.FetchCandidates(&positions));
+  ASSERT_EQ(1u, positions.size());
+  EXPECT_EQ(2u, positions[0]);
+  EXPECT_EQ(1u, beam.leaf_size());
+
+  // the children pruned by category, and the leaf first
+  ASSERT_TRUE(beam.Reset(0));
+  ASSERT_TRUE(beam.KeepAll());
+  ASSERT_TRUE(beam.Expand(~0ull, false, false));
+  ASSERT_TRUE(beam.KeepAll());
+  ASSERT_TRUE(beam.Expand(1u << 4, true, true));
+  ASSERT_TRUE(beam.FetchCandidates(&positions));
+  ASSERT_EQ(2u, positions.size());
+  EXPECT_EQ(2u, positions[0]);
+  EXPECT_EQ(4u, positions[1]);
+
+  // the same scores by the candidate order
+  float tie_scores[] = { 0.5, 0.5 };
+  ASSERT_TRUE(beam.SetScores(0, 2, tie_scores, 1, 0));
+  ASSERT_TRUE(beam.Select(2));
+  ASSERT_TRUE(beam.FetchWinners(&positions, &winner_scores));
+  ASSERT_EQ(2u, positions.size());
+  EXPECT_EQ(2u, positions[0]);
+  EXPECT_EQ(4u, positions[1]);
+}
+
+#else
+
+TEST(DeviceBeam, without_cuda) {
+  Tree tree;
+  MockDeviceTree(&tree);
+  DeviceTree device_tree;
+  EXPECT_FALSE(device_tree.Init(&tree, 0));
+  EXPECT_FALSE(device_tree.ready());
+
+  DeviceBeam beam;
+  EXPECT_FALSE(beam.Init(&device_tree, 4));
+}
+
+#endif  // TDM_SERVING_WITH_CUDA
+
+}  // namespace tdm_serving
@@ -30,7 +30,8 @@ class MockTreeSearcher2 : public TreeSearcher {
   virtual bool CalculateScore(TreeSearchContext* /*context*/,
                               const SearchParam& /*search_param*/,
                               std::vector<ItemFeature*>* /*item_features*/,
-                              std::vector<NodeScore*>* node_scores) {
+                              std::vector<NodeScore*>* node_scores,
+                              uint32_t /*predict_index*/) {
     for (size_t i = 0; i < node_scores->size(); i++) {
       node_scores->at(i)->set_score(i * 10);
     }
@@ -30,11 +30,26 @@ limitations under the License.
 namespace tdm_serving {
 
 class MockTreeSearcher : public TreeSearcher {
+ public:
+  MockTreeSearcher()
+      : calculate_num_(0), predict_indices_(0), batch_calculate_num_(0) {
+  }
+
+  uint32_t calculate_num_;
+  // bit i is set if predict context i is used
+  uint32_t predict_indices_;
+  uint32_t batch_calculate_num_;
+  // the node numbers of each user in the last batch
+  std::vector<uint32_t> batch_user_nodes_;
+
  protected:
   virtual bool CalculateScore(TreeSearchContext* /*context*/,
                               const SearchParam& /*search_param*/,
                               std::vector<ItemFeature*>* /*item_features*/,
-                              std::vector<NodeScore*>* node_scores) {
+                              std::vector<NodeScore*>* node_scores,
+                              uint32_t predict_index) {
+    __sync_fetch_and_add(&calculate_num_, 1);
+    __sync_fetch_and_or(&predict_indices_, 1u << predict_index);
     for (size_t i = 0; i < node_scores->size(); i++) {
       double score = node_scores->at(i)->node()->node_info()->id();
       if (score != 0) {
@@ -44,6 +59,39 @@ class MockTreeSearcher : public TreeSearcher {
     }
     return true;
   }
+
+  virtual bool CalculateBatchScore(
+      TreeSearchContext* context,
+      const std::vector<const UserInfo*>& user_infos,
+      const std::vector<uint32_t>& item_users,
+      std::vector<ItemFeature*>* item_features,
+      std::vector<NodeScore*>* node_scores) {
+    batch_calculate_num_++;
+    batch_user_nodes_.assign(user_infos.size(), 0);
+    for (size_t i = 0; i < item_users.size(); i++) {
+      batch_user_nodes_[item_users[i]]++;
+    }
+    SearchParam search_param;
+    return CalculateScore(context, search_param, item_features,
+                          node_scores, 0);
+  }
+
+  virtual bool CalculateDeviceScore(TreeSearchContext* /*context*/,
+                                    const SearchParam& /*search_param*/,
+                                    std::vector<ItemFeature*>* item_features,
+                                    DeviceBeam* beam, uint32_t begin) {
+    calculate_num_++;
+    std::vector<float> scores;
+    for (size_t i = 0; i < item_features->size(); i++) {
+      NodeScore* node_score = static_cast<NodeScore*>(item_features->at(i));
+      double score = node_score->node()->node_info()->id();
+      if (score != 0) {
+        score = 1 / score;
+      }
+      scores.push_back(score);
+    }
+    return beam->SetScores(begin, scores.size(), scores.data(), 1, 0);
+  }
 };
 
 class TreeMockFilter : public Filter {
@@ -61,6 +109,28 @@ class TreeMockFilter : public Filter {
   }
 };
 
+// passes the items of category 8 and the ones without category
+class TreeMockCategoryFilter : public Filter {
+ public:
+  TreeMockCategoryFilter() : filtered_num_(0) {
+  }
+
+  virtual bool IsFiltered(const FilterInfo* /*filter_info*/,
+                          const Item& item) {
+    if (item.has_category() && item.category() != 8) {
+      filtered_num_++;
+      return true;
+    }
+    return false;
+  }
+
+  virtual uint64_t PassCategoryMask(const FilterInfo* /*filter_info*/) {
+    return CategoryBit(true, 8) | CategoryBit(false, 0);
+  }
+
+  uint32_t filtered_num_;
+};
+
 /*
  * search tree:
  *        0
@@ -92,24 +162,18 @@ void MockTree(Tree* tree) {
   tns[0].node_info_->set_id(0);
   tns[0].node_info_->set_level(0);
   tns[0].sub_node_num_ = 2;
-  tns[0].sub_nodes_ = new Node*[2];
-  tns[0].sub_nodes_[0] = tns + 1;
-  tns[0].sub_nodes_[1] = tns + 2;
+  tns[0].sub_nodes_ = tns + 1;
 
   tns[1].node_info_->set_id(1);
   tns[1].node_info_->set_level(1);
   tns[1].sub_node_num_ = 2;
-  tns[1].sub_nodes_ = new Node*[2];
-  tns[1].sub_nodes_[0] = tns + 3;
-  tns[1].sub_nodes_[1] = tns + 4;
+  tns[1].sub_nodes_ = tns + 3;
 
   tns[2].node_info_->set_id(2);
   tns[2].node_info_->set_level(1);
   tns[2].sub_node_num_ = 0;
   tns[2].sub_node_num_ = 2;
-  tns[2].sub_nodes_ = new Node*[2];
-  tns[2].sub_nodes_[0] = tns + 5;
-  tns[2].sub_nodes_[1] = tns + 6;
+  tns[2].sub_nodes_ = tns + 5;
 
   tns[3].node_info_->set_id(6);
   tns[3].node_info_->set_level(2);
@@ -118,16 +182,12 @@ void MockTree(Tree* tree) {
   tns[4].node_info_->set_id(3);
   tns[4].node_info_->set_level(2);
   tns[4].sub_node_num_ = 2;
-  tns[4].sub_nodes_ = new Node*[2];
-  tns[4].sub_nodes_[0] = tns + 7;
-  tns[4].sub_nodes_[1] = tns + 8;
+  tns[4].sub_nodes_ = tns + 7;
 
   tns[5].node_info_->set_id(4);
   tns[5].node_info_->set_level(2);
   tns[5].sub_node_num_ = 2;
-  tns[5].sub_nodes_ = new Node*[2];
-  tns[5].sub_nodes_[0] = tns + 9;
-  tns[5].sub_nodes_[1] = tns + 10;
+  tns[5].sub_nodes_ = tns + 9;
 
   tns[6].node_info_->set_id(5);
   tns[6].node_info_->set_level(2);
@@ -151,6 +211,10 @@ void MockTree(Tree* tree) {
   tns[10].node_info_->set_level(3);
   tns[10].node_info_->set_leaf_cate_id(16);
   tns[10].sub_node_num_ = 0;
+
+  for (uint32_t i = 0; i < total_node_num; i++) {
+    tns[i].set_node_info(tns[i].node_info_);
+  }
 }
 
 TEST(TreeSearcher, beam_search) {
@@ -268,4 +332,257 @@ TEST(TreeSearcher, beam_search_level_topn) {
   EXPECT_EQ(8u, candidates->at(1)->node()->node_info()->id());
 }
 
+TEST(TreeSearcher, beam_search_two_level_score) {
+  MockTreeSearcher s;
+
+  TreeIndexConf index_conf;
+  index_conf.level_to_topn_[0] = 3;
+  index_conf.level_to_topn_[1] = 3;
+  index_conf.level_to_topn_[2] = 3;
+  index_conf.level_to_topn_[3] = 3;
+  s.index_conf_ = &index_conf;
+
+  Tree tree;
+  MockTree(&tree);
+
+  TreeSearchContext context;
+  SearchParam search_param;
+  search_param.set_topn(3);
+
+  // level 2 and 3 are scored level by level
+  ASSERT_TRUE(s.Search(&tree, &context, search_param));
+  EXPECT_EQ(2u, s.calculate_num_);
+
+  // level 3 is scored together with level 2
+  index_conf.set_two_level_score_num(8);
+  s.calculate_num_ = 0;
+  context.Clear();
+  ASSERT_TRUE(s.Search(&tree, &context, search_param));
+  EXPECT_EQ(1u, s.calculate_num_);
+
+  NodeScoreVec* candidates =
+      context.layers_node_scores(tree.tree_meta_.max_level_);
+
+  ASSERT_EQ(5u, context.layer_node_score_size(tree.tree_meta_.max_level_));
+  EXPECT_EQ(5u, candidates->at(0)->node()->node_info()->id());
+  EXPECT_EQ(7u, candidates->at(1)->node()->node_info()->id());
+  EXPECT_EQ(8u, candidates->at(2)->node()->node_info()->id());
+  EXPECT_EQ(9u, candidates->at(3)->node()->node_info()->id());
+  EXPECT_EQ(10u, candidates->at(4)->node()->node_info()->id());
+
+  // too many nodes to score together
+  index_conf.set_two_level_score_num(7);
+  s.calculate_num_ = 0;
+  context.Clear();
+  ASSERT_TRUE(s.Search(&tree, &context, search_param));
+  EXPECT_EQ(2u, s.calculate_num_);
+}
+
+TEST(TreeSearcher, beam_search_parallel_score) {
+  MockTreeSearcher s;
+
+  TreeIndexConf index_conf;
+  index_conf.level_to_topn_[0] = 3;
+  index_conf.level_to_topn_[1] = 3;
+  index_conf.level_to_topn_[2] = 3;
+  index_conf.level_to_topn_[3] = 3;
+  index_conf.set_parallel_score_num(3);
+  index_conf.set_parallel_score_batch(2);
+  s.index_conf_ = &index_conf;
+
+  Tree tree;
+  MockTree(&tree);
+
+  TreeSearchContext context;
+  SearchParam search_param;
+  search_param.set_topn(3);
+
+  // the 4 nodes of level 2 and 3 are scored by 2 chunks each
+  ASSERT_TRUE(s.Search(&tree, &context, search_param));
+  EXPECT_EQ(4u, s.calculate_num_);
+  EXPECT_EQ(3u, s.predict_indices_);
+
+  NodeScoreVec* candidates =
+      context.layers_node_scores(tree.tree_meta_.max_level_);
+
+  ASSERT_EQ(5u, context.layer_node_score_size(tree.tree_meta_.max_level_));
+  EXPECT_EQ(5u, candidates->at(0)->node()->node_info()->id());
+  EXPECT_EQ(7u, candidates->at(1)->node()->node_info()->id());
+  EXPECT_EQ(8u, candidates->at(2)->node()->node_info()->id());
+  EXPECT_EQ(9u, candidates->at(3)->node()->node_info()->id());
+  EXPECT_EQ(10u, candidates->at(4)->node()->node_info()->id());
+}
+
+TEST(TreeSearcher, beam_search_reuse_arena) {
+  MockTreeSearcher s;
+
+  TreeIndexConf index_conf;
+  index_conf.level_to_topn_[0] = 3;
+  index_conf.level_to_topn_[1] = 3;
+  index_conf.level_to_topn_[2] = 3;
+  index_conf.level_to_topn_[3] = 3;
+  s.index_conf_ = &index_conf;
+
+  Tree tree;
+  MockTree(&tree);
+  tree.tree_meta_.max_sub_node_num_ = 2;
+
+  TreeSearchContext context;
+  SearchParam search_param;
+
+  ASSERT_TRUE(s.Search(&tree, &context, search_param));
+  uint32_t arena_capacity = context.arena_capacity();
+  NodeScore* root = context.layers_node_scores(0)->at(0);
+  context.Clear();
+
+  // the searches of a context reuse the NodeScores
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(s.Search(&tree, &context, search_param));
+    EXPECT_EQ(arena_capacity, context.arena_capacity());
+    EXPECT_EQ(root, context.layers_node_scores(0)->at(0));
+    ASSERT_EQ(5u,
+              context.layer_node_score_size(tree.tree_meta_.max_level_));
+    context.Clear();
+  }
+}
+
+TEST(TreeSearcher, beam_search_batch_users) {
+  MockTreeSearcher s;
+
+  TreeIndexConf index_conf;
+  index_conf.level_to_topn_[0] = 3;
+  index_conf.level_to_topn_[1] = 3;
+  index_conf.level_to_topn_[2] = 3;
+  index_conf.level_to_topn_[3] = 3;
+  s.index_conf_ = &index_conf;
+
+  Tree tree;
+  MockTree(&tree);
+
+  TreeSearchContext context_1;
+  TreeSearchContext context_2;
+  TreeMockFilter filter;
+  context_2.set_filter(&filter);
+  SearchParam search_param_1;
+  SearchParam search_param_2;
+  search_param_1.set_topn(3);
+  search_param_2.set_topn(1);
+
+  std::vector<TreeSearchContext*> contexts;
+  contexts.push_back(&context_1);
+  contexts.push_back(&context_2);
+  std::vector<const SearchParam*> search_params;
+  search_params.push_back(&search_param_1);
+  search_params.push_back(&search_param_2);
+
+  // level 2 and 3 are scored by one predict each,
+  // the leaves of both the users together
+  ASSERT_TRUE(s.BatchSearch(&tree, contexts, search_params));
+  EXPECT_EQ(2u, s.batch_calculate_num_);
+  ASSERT_EQ(2u, s.batch_user_nodes_.size());
+  EXPECT_EQ(4u, s.batch_user_nodes_[0]);
+  EXPECT_EQ(2u, s.batch_user_nodes_[1]);
+
+  uint32_t max_level = tree.tree_meta_.max_level_;
+  NodeScoreVec* candidates = context_1.layers_node_scores(max_level);
+  ASSERT_EQ(5u, context_1.layer_node_score_size(max_level));
+  EXPECT_EQ(5u, candidates->at(0)->node()->node_info()->id());
+  EXPECT_EQ(7u, candidates->at(1)->node()->node_info()->id());
+  EXPECT_EQ(8u, candidates->at(2)->node()->node_info()->id());
+  EXPECT_EQ(9u, candidates->at(3)->node()->node_info()->id());
+  EXPECT_EQ(10u, candidates->at(4)->node()->node_info()->id());
+
+  // the filter of one user does not change the other
+  candidates = context_2.layers_node_scores(max_level);
+  ASSERT_EQ(2u, context_2.layer_node_score_size(max_level));
+  EXPECT_EQ(7u, candidates->at(0)->node()->node_info()->id());
+  EXPECT_EQ(8u, candidates->at(1)->node()->node_info()->id());
+}
+
+TEST(TreeSearcher, beam_search_prune_by_category) {
+  MockTreeSearcher s;
+
+  TreeIndexConf index_conf;
+  index_conf.level_to_topn_[0] = 3;
+  index_conf.level_to_topn_[1] = 3;
+  index_conf.level_to_topn_[2] = 3;
+  index_conf.level_to_topn_[3] = 3;
+  s.index_conf_ = &index_conf;
+
+  Tree tree;
+  MockTree(&tree);
+  tree.BuildCategoryMasks();
+
+  EXPECT_EQ(CategoryBit(false, 0), tree.nodes_[1].category_mask());
+  EXPECT_EQ(CategoryBit(true, 8) | CategoryBit(true, 16) |
+            CategoryBit(true, 32), tree.nodes_[2].category_mask());
+
+  TreeSearchContext context;
+  TreeMockCategoryFilter filter;
+  context.set_filter(&filter);
+  SearchParam search_param;
+
+  ASSERT_TRUE(s.Search(&tree, &context, search_param));
+
+  // the leaves 5 and 10 are pruned before the item filter
+  NodeScoreVec* candidates =
+      context.layers_node_scores(tree.tree_meta_.max_level_);
+  ASSERT_EQ(3u, context.layer_node_score_size(tree.tree_meta_.max_level_));
+  EXPECT_EQ(7u, candidates->at(0)->node()->node_info()->id());
+  EXPECT_EQ(8u, candidates->at(1)->node()->node_info()->id());
+  EXPECT_EQ(9u, candidates->at(2)->node()->node_info()->id());
+  EXPECT_EQ(0u, filter.filtered_num_);
+}
+
+TEST(TreeSearcher, beam_search_on_device) {
+  MockTreeSearcher s;
+
+  TreeIndexConf index_conf;
+  index_conf.level_to_topn_[0] = 3;
+  index_conf.level_to_topn_[1] = 3;
+  index_conf.level_to_topn_[2] = 3;
+  index_conf.level_to_topn_[3] = 3;
+  index_conf.search_device_ = 0;
+  s.index_conf_ = &index_conf;
+
+  Tree tree;
+  MockTree(&tree);
+  tree.tree_meta_.max_sub_node_num_ = 2;
+
+#ifdef TDM_SERVING_WITH_CUDA
+  ASSERT_TRUE(s.InitDeviceTree(&tree));
+#else
+  // the tree stays on host without cuda, and so do the searches
+  EXPECT_FALSE(s.InitDeviceTree(&tree));
+#endif
+
+  TreeSearchContext context;
+  SearchParam search_param;
+
+  // the same winners as on host, and level 2 and 3 are scored
+  ASSERT_TRUE(s.Search(&tree, &context, search_param));
+  EXPECT_EQ(2u, s.calculate_num_);
+
+  uint32_t max_level = tree.tree_meta_.max_level_;
+  NodeScoreVec* candidates = context.layers_node_scores(max_level);
+  ASSERT_EQ(5u, context.layer_node_score_size(max_level));
+  EXPECT_EQ(5u, candidates->at(0)->node()->node_info()->id());
+  EXPECT_EQ(7u, candidates->at(1)->node()->node_info()->id());
+  EXPECT_EQ(8u, candidates->at(2)->node()->node_info()->id());
+  EXPECT_EQ(9u, candidates->at(3)->node()->node_info()->id());
+  EXPECT_EQ(10u, candidates->at(4)->node()->node_info()->id());
+  EXPECT_FLOAT_EQ(1.0 / 5, candidates->at(0)->score());
+  EXPECT_FLOAT_EQ(1.0 / 10, candidates->at(4)->score());
+  context.Clear();
+
+  // the filtered searches are on host
+  TreeMockFilter filter;
+  context.set_filter(&filter);
+  ASSERT_TRUE(s.Search(&tree, &context, search_param));
+  candidates = context.layers_node_scores(max_level);
+  ASSERT_EQ(2u, context.layer_node_score_size(max_level));
+  EXPECT_EQ(7u, candidates->at(0)->node()->node_info()->id());
+  EXPECT_EQ(8u, candidates->at(1)->node()->node_info()->id());
+}
+
 }  // namespace tdm_serving
@@ -70,7 +70,7 @@ TEST(Tree, Good) {
     Node* sub_nodes = NULL;
     node->sub_nodes(&sub_nodes, &sub_node_num);
     ASSERT_EQ(real_sub_node_num, sub_node_num);
-    ASSERT_TRUE(sub_nodes != NULL);
+    ASSERT_TRUE(sub_node_num == 0 || sub_nodes != NULL);
     for (uint32_t j = 0; j < sub_node_num; ++j) {
       Node* sub_node = sub_nodes + j;
       ASSERT_EQ(sub_node->node_info()->seq(), i * 2 + j + 1);
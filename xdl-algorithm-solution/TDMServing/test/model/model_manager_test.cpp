@@ -30,8 +30,8 @@ TEST(ModelManager, init_and_search) {
   // init
   ASSERT_TRUE(ModelManager::Instance().Init(conf_path));
 
-  Model* model = ModelManager::Instance().GetModel("mock_model_disable");
-  EXPECT_STREQ(nullptr, reinterpret_cast<const char*>(model));
+  ModelHandle model = ModelManager::Instance().GetModel("mock_model_disable");
+  EXPECT_STREQ(nullptr, reinterpret_cast<const char*>(model.get()));
 
   model = ModelManager::Instance().GetModel("mock_model_no_version");
   EXPECT_EQ("mock_model_no_version", model->model_name());
@@ -0,0 +1,56 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+#include "util/stage_stat.h"
+
+namespace tdm_serving {
+namespace util {
+
+TEST(StageStat, timer) {
+  StageStat& stage_stat = StageStat::Instance();
+  stage_stat.Reset();
+
+  // disabled by default
+  {
+    ScopedStageTimer timer(kStageSort, 1);
+  }
+  EXPECT_EQ(0u, stage_stat.count(kStageSort, 1));
+
+  stage_stat.set_enabled(true);
+  {
+    ScopedStageTimer timer(kStageSort, 1);
+    usleep(1000);
+  }
+  {
+    ScopedStageTimer timer(kStageSort, 100);
+  }
+  stage_stat.set_enabled(false);
+
+  EXPECT_EQ(1u, stage_stat.count(kStageSort, 1));
+  EXPECT_LT(0.0009, stage_stat.total_time(kStageSort, 1));
+  EXPECT_EQ(0u, stage_stat.count(kStagePredict, 1));
+  // the deep levels go to the last one
+  EXPECT_EQ(1u, stage_stat.count(kStageSort, StageStat::kMaxLevel - 1));
+  EXPECT_STREQ("sort", StageStat::StageName(kStageSort));
+
+  stage_stat.Reset();
+  EXPECT_EQ(0u, stage_stat.count(kStageSort, 1));
+}
+
+}  // namespace util
+}  // namespace tdm_serving
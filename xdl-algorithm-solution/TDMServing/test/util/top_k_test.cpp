@@ -0,0 +1,96 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <vector>
+#include "util/top_k.h"
+
+namespace tdm_serving {
+namespace util {
+
+TEST(TopK, select) {
+  float scores[] = { 0.3, 0.9, 0.1, 0.5, 0.7 };
+  std::vector<uint32_t> indices;
+
+  SelectTopK(scores, 5, 3, &indices);
+  ASSERT_EQ(3u, indices.size());
+  EXPECT_EQ(1u, indices[0]);
+  EXPECT_EQ(4u, indices[1]);
+  EXPECT_EQ(3u, indices[2]);
+
+  // k exceeds n
+  SelectTopK(scores, 5, 10, &indices);
+  ASSERT_EQ(5u, indices.size());
+  EXPECT_EQ(1u, indices[0]);
+  EXPECT_EQ(2u, indices[4]);
+
+  SelectTopK(scores, 5, 0, &indices);
+  EXPECT_EQ(0u, indices.size());
+}
+
+TEST(TopK, select_large) {
+  std::vector<float> scores;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    scores.push_back((i * 7919) % 1000 / 1000.0);
+  }
+  // equal scores keep the lower index
+  scores[10] = scores[20] = 2.0;
+
+  std::vector<uint32_t> indices;
+  SelectTopK(scores.data(), scores.size(), 50, &indices);
+
+  std::vector<uint32_t> expected(scores.size());
+  for (uint32_t i = 0; i < expected.size(); ++i) {
+    expected[i] = i;
+  }
+  std::stable_sort(expected.begin(), expected.end(),
+                   [&scores](uint32_t a, uint32_t b) {
+    return scores[a] > scores[b];
+  });
+  expected.resize(50);
+  EXPECT_EQ(expected, indices);
+  EXPECT_EQ(10u, indices[0]);
+  EXPECT_EQ(20u, indices[1]);
+}
+
+TEST(TopK, select_blocks) {
+  // the sizes and ks around the blocks of 8, with the equal scores of a
+  // block split between the heap and the rest
+  for (uint32_t n = 1; n <= 70; ++n) {
+    std::vector<float> scores;
+    for (uint32_t i = 0; i < n; ++i) {
+      scores.push_back((i * 37) % 11 / 10.0);
+    }
+    std::vector<uint32_t> expected(n);
+    for (uint32_t i = 0; i < n; ++i) {
+      expected[i] = i;
+    }
+    std::stable_sort(expected.begin(), expected.end(),
+                     [&scores](uint32_t a, uint32_t b) {
+      return scores[a] > scores[b];
+    });
+    for (uint32_t k = 1; k <= n; k += 3) {
+      std::vector<uint32_t> indices;
+      SelectTopK(scores.data(), n, k, &indices);
+      std::vector<uint32_t> top(expected.begin(), expected.begin() + k);
+      EXPECT_EQ(top, indices) << "n " << n << " k " << k;
+    }
+  }
+}
+
+}  // namespace util
+}  // namespace tdm_serving
@@ -0,0 +1,281 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/benchmark/zipf_generator.h"
+#include "ps-plus/client/local_client.h"
+#include "ps-plus/common/initializer/constant_initializer.h"
+#include "ps-plus/common/logging.h"
+#include "ps-plus/common/metrics_collector.h"
+#include "ps-plus/common/option_parser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <unordered_set>
+
+// Drives Zipf distributed HashPull and HashPush traffic from M worker
+// threads against N in process servers and reports the throughput, the
+// request latency percentiles and the memory. Every server is a
+// LocalClient owning the ids that hash to it, a request touches the
+// servers of its ids one after the other like a worker with a single
+// connection and reports the time of the whole fan out.
+//   ./ps_benchmark --servers 4 --workers 8 --dim 16 --cardinality 1000000
+//                  --zipf 0.99 --batch 1024 --requests 1000 --push_ratio 50
+//                  --updater adagrad
+
+using ps::Status;
+using ps::Tensor;
+using ps::TensorShape;
+using ps::DataType;
+using ps::Data;
+using ps::VariableInfo;
+using ps::client::LocalClient;
+using ps::common::Histogram;
+using ps::benchmark::ZipfGenerator;
+
+namespace {
+
+struct Options {
+  int servers;
+  int workers;
+  int dim;
+  int cardinality;
+  double zipf;
+  int batch;
+  int requests;
+  int push_ratio;
+  std::string updater;
+  int seed;
+};
+
+const char* kVariable = "benchmark_embedding";
+
+int64_t NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// spreads the hot ranks over the servers
+uint64_t Scramble(uint64_t rank) {
+  return (rank + 1) * 0x9E3779B97F4A7C15ull;
+}
+
+size_t ProcStatusKb(const std::string& key) {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, key.size(), key) == 0) {
+      return atol(line.c_str() + key.size() + 1);
+    }
+  }
+  return 0;
+}
+
+Status Sync(const std::function<void(const LocalClient::Callback&)>& call) {
+  Status result;
+  call([&result](const Status& st) { result = st; });
+  return result;
+}
+
+Status PushArgs(const Options& options, LocalClient* client, size_t rows, std::vector<Data*>* args) {
+  std::vector<Tensor> grads = {
+    Tensor(DataType::kFloat, TensorShape({rows, (size_t)options.dim}), new ps::initializer::ConstantInitializer(0.01))};
+  if (options.updater == "adagrad") {
+    *args = client->Args(grads, std::vector<double>{0.01}, std::vector<double>{0.1});
+  } else if (options.updater == "momentum") {
+    *args = client->Args(grads, std::vector<double>{0.01}, std::vector<double>{0.9}, std::vector<bool>{false});
+  } else if (options.updater == "assign_add") {
+    *args = client->Args(grads);
+  } else {
+    return Status::ArgumentError("updater should be adagrad, momentum or assign_add");
+  }
+  return Status::Ok();
+}
+
+std::string Updater(const std::string& updater) {
+  if (updater == "adagrad") {
+    return "AdagradUpdater";
+  } else if (updater == "momentum") {
+    return "MomentumUpdater";
+  }
+  return "AssignAddUpdater";
+}
+
+Status InitServers(const Options& options, std::vector<std::unique_ptr<LocalClient>>* servers) {
+  for (int i = 0; i < options.servers; i++) {
+    servers->emplace_back(new LocalClient(""));
+    LocalClient* client = servers->back().get();
+    PS_CHECK_STATUS(client->Init());
+    VariableInfo info;
+    info.type = VariableInfo::kHash128;
+    info.name = kVariable;
+    info.shape = {options.cardinality / options.servers + 1, options.dim};
+    info.datatype = DataType::kFloat;
+    PS_CHECK_STATUS(client->RegisterVariable(kVariable, info));
+    PS_CHECK_STATUS(Sync([&](const LocalClient::Callback& cb) {
+      client->HashInitializer(kVariable, new ps::initializer::ConstantInitializer(0), cb);
+    }));
+  }
+  return Status::Ok();
+}
+
+struct WorkerStats {
+  Histogram pull;
+  Histogram push;
+  size_t ids = 0;
+  Status st;
+};
+
+void RunWorker(const Options& options, int id, std::vector<std::unique_ptr<LocalClient>>* servers, WorkerStats* stats) {
+  ZipfGenerator zipf(options.cardinality, options.zipf, options.seed + id);
+  std::mt19937_64 rng(options.seed * 7919 + id);
+  std::uniform_int_distribution<int> percent(0, 99);
+  size_t server_num = servers->size();
+  for (int r = 0; r < options.requests && stats->st.IsOk(); r++) {
+    // workers unique their ids before they go to the servers
+    std::vector<std::unordered_set<uint64_t>> keys(server_num);
+    for (int i = 0; i < options.batch; i++) {
+      uint64_t key = Scramble(zipf.Next());
+      keys[key % server_num].insert(key);
+    }
+    bool push = percent(rng) < options.push_ratio;
+    int64_t begin = NowMicros();
+    for (size_t s = 0; s < server_num && stats->st.IsOk(); s++) {
+      if (keys[s].empty()) {
+        continue;
+      }
+      LocalClient* client = (*servers)[s].get();
+      Tensor ids(DataType::kInt64, TensorShape({keys[s].size(), 2}), new ps::initializer::ConstantInitializer(0));
+      int64_t* raw = ids.Raw<int64_t>();
+      for (auto key : keys[s]) {
+        *raw++ = key >> 1;
+        *raw++ = key;
+      }
+      stats->ids += keys[s].size();
+      // a save ratio of 1 admits every new id
+      if (push) {
+        std::vector<Data*> args;
+        stats->st = PushArgs(options, client, keys[s].size(), &args);
+        if (!stats->st.IsOk()) {
+          break;
+        }
+        stats->st = Sync([&](const LocalClient::Callback& cb) {
+          client->HashPush(kVariable, ids, 1.0, true, Updater(options.updater), args, cb);
+        });
+      } else {
+        Tensor result;
+        stats->st = Sync([&](const LocalClient::Callback& cb) {
+          client->HashPull(kVariable, ids, 1.0, &result, cb);
+        });
+      }
+    }
+    (push ? stats->push : stats->pull).Record(NowMicros() - begin);
+  }
+}
+
+void Report(const std::string& name, const Histogram& h, double seconds) {
+  std::cout << name << ": requests=" << h.Count()
+            << " qps=" << (int64_t)(h.Count() / seconds)
+            << " p50=" << h.Percentile(0.5) << "us"
+            << " p99=" << h.Percentile(0.99) << "us"
+            << " p999=" << h.Percentile(0.999) << "us"
+            << " max=" << h.Max() << "us" << std::endl;
+}
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  ps::OptionParser optParser;
+  optParser.addOption("-s", "--servers", "servers", 4);
+  optParser.addOption("-w", "--workers", "workers", 8);
+  optParser.addOption("-d", "--dim", "dim", 16);
+  optParser.addOption("-c", "--cardinality", "cardinality", 1000000);
+  optParser.addOption("-z", "--zipf", "zipf", "0.99");
+  optParser.addOption("-b", "--batch", "batch", 1024);
+  optParser.addOption("-n", "--requests", "requests", 1000);
+  optParser.addOption("-p", "--push_ratio", "push_ratio", 50);
+  optParser.addOption("-u", "--updater", "updater", "adagrad");
+  optParser.addOption("-e", "--seed", "seed", 1);
+  if (!optParser.parseArgs(argc, argv)) {
+    return false;
+  }
+  std::string zipf;
+  optParser.getOptionValue("servers", options->servers);
+  optParser.getOptionValue("workers", options->workers);
+  optParser.getOptionValue("dim", options->dim);
+  optParser.getOptionValue("cardinality", options->cardinality);
+  optParser.getOptionValue("zipf", zipf);
+  optParser.getOptionValue("batch", options->batch);
+  optParser.getOptionValue("requests", options->requests);
+  optParser.getOptionValue("push_ratio", options->push_ratio);
+  optParser.getOptionValue("updater", options->updater);
+  optParser.getOptionValue("seed", options->seed);
+  options->zipf = atof(zipf.c_str());
+  return options->servers > 0 && options->workers > 0 && options->dim > 0 &&
+         options->cardinality > 0 && options->batch > 0 && options->zipf >= 0 &&
+         options->zipf != 1;
+}
+
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) {
+    LOG(ERROR) << "argument error, zipf should be in [0, 1) or above 1";
+    return -1;
+  }
+  std::vector<std::unique_ptr<LocalClient>> servers;
+  Status st = InitServers(options, &servers);
+  if (!st.IsOk()) {
+    LOG(ERROR) << "init servers: " << st.ToString();
+    return -1;
+  }
+  size_t rss_before = ProcStatusKb("VmRSS:");
+  std::vector<WorkerStats> stats(options.workers);
+  std::vector<std::thread> workers;
+  int64_t begin = NowMicros();
+  for (int i = 0; i < options.workers; i++) {
+    workers.emplace_back(RunWorker, std::cref(options), i, &servers, &stats[i]);
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  double seconds = (NowMicros() - begin) / 1e6;
+
+  Histogram pull, push;
+  size_t ids = 0;
+  for (auto& item : stats) {
+    if (!item.st.IsOk()) {
+      LOG(ERROR) << "worker failed: " << item.st.ToString();
+      return -1;
+    }
+    ids += item.ids;
+  }
+  std::cout << "servers=" << options.servers << " workers=" << options.workers
+            << " dim=" << options.dim << " cardinality=" << options.cardinality
+            << " zipf=" << options.zipf << " batch=" << options.batch
+            << " push_ratio=" << options.push_ratio << "% updater=" << options.updater << std::endl;
+  std::cout << "total: seconds=" << seconds << " ids/s=" << (int64_t)(ids / seconds) << std::endl;
+  for (auto& item : stats) {
+    pull.Merge(item.pull);
+    push.Merge(item.push);
+  }
+  Report("pull", pull, seconds);
+  Report("push", push, seconds);
+  std::cout << "memory: rss=" << ProcStatusKb("VmRSS:") / 1024 << "MB"
+            << " growth=" << ((long)ProcStatusKb("VmRSS:") - (long)rss_before) / 1024 << "MB"
+            << " peak=" << ProcStatusKb("VmHWM:") / 1024 << "MB" << std::endl;
+  return 0;
+}
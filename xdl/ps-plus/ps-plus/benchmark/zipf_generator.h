@@ -0,0 +1,75 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_BENCHMARK_ZIPF_GENERATOR_H_
+#define PS_BENCHMARK_ZIPF_GENERATOR_H_
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+namespace ps {
+namespace benchmark {
+
+// Draws ranks in [0, n) where rank k has probability proportional to
+// 1 / (k + 1)^theta, by the approximation of Gray et al., "Quickly
+// Generating Billion-Record Synthetic Databases". theta = 0 is uniform,
+// theta must not be 1. The setup is O(n), every draw O(1). Not thread
+// safe, use one generator per thread.
+class ZipfGenerator {
+ public:
+  ZipfGenerator(uint64_t n, double theta, uint64_t seed)
+    : n_(n), theta_(theta), rng_(seed), uniform_(0.0, 1.0) {
+    double zeta2 = Zeta(2, theta);
+    zetan_ = Zeta(n, theta);
+    alpha_ = 1.0 / (1.0 - theta);
+    eta_ = (1 - std::pow(2.0 / n, 1 - theta)) / (1 - zeta2 / zetan_);
+  }
+
+  uint64_t Next() {
+    double u = uniform_(rng_);
+    double uz = u * zetan_;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < 1.0 + std::pow(0.5, theta_)) {
+      return 1;
+    }
+    uint64_t rank = (uint64_t)(n_ * std::pow(eta_ * u - eta_ + 1, alpha_));
+    return rank < n_ ? rank : n_ - 1;
+  }
+
+ private:
+  static double Zeta(uint64_t n, double theta) {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; i++) {
+      sum += 1.0 / std::pow((double)i, theta);
+    }
+    return sum;
+  }
+
+  uint64_t n_;
+  double theta_;
+  double zetan_;
+  double alpha_;
+  double eta_;
+  std::mt19937_64 rng_;
+  std::uniform_real_distribution<double> uniform_;
+};
+
+}
+}
+
+#endif // PS_BENCHMARK_ZIPF_GENERATOR_H_
@@ -23,6 +23,7 @@ limitations under the License.
 #include "ps-plus/common/tensor.h"
 #include "ps-plus/message/variable_info.h"
 #include "ps-plus/message/worker_state.h"
+#include "ps-plus/message/variable_stats.h"
 
 #include "ps-plus/client/udf.h"
 #include "ps-plus/client/partitioner.h"
@@ -39,6 +40,9 @@ class BaseClient {
   virtual Status Init() = 0;
   virtual void Save(const std::string& name, const Callback& cb) = 0;
   virtual void Restore(const std::string& name, const Callback& cb) = 0;
+  virtual void ResizeServers(int server_num, const Callback& cb) = 0;
+  // Memory and traffic per server and per variable, see VariableStats.
+  virtual void GetClusterStats(ClusterStats* result, const Callback& cb) = 0;
   virtual void TriggerStreamingModelDense(const std::string& stream_ver, const Callback& cb) = 0;
   virtual void TriggerStreamingModelSparse(const std::string& stream_ver, const Callback& cb) = 0;
   virtual void TriggerStreamingModelHash(const std::string& stream_ver, const Callback& cb) = 0;
@@ -122,6 +126,16 @@ class BaseClient {
                               const std::string& updater,
                               const std::vector<Data*>& data,
                               const Callback& cb) = 0;
+  // One request updating variables of several updaters. groups[g] are the
+  // indices in var_names of the variables updaters[g] updates, data[g] its
+  // arguments as MergedHashPush takes them, starting with their gradients.
+  virtual void MixedHashPush(const std::vector<std::string>& var_names,
+                             const std::vector<Tensor>& ids,
+                             const std::vector<float>& save_ratios,
+                             const std::vector<std::string>& updaters,
+                             const std::vector<std::vector<int64_t>>& groups,
+                             const std::vector<std::vector<Data*>>& data,
+                             const Callback& cb) = 0;
   virtual void MergedHashStatis(const std::vector<std::string>& var_names,
                                 const std::vector<Tensor>& ids,
                                 const std::vector<float>& save_ratios,
@@ -23,8 +23,14 @@ limitations under the License.
 #include "ps-plus/client/partitioner/hash.h"
 #include "ps-plus/client/partitioner/merged_hash.h"
 
+#include "ps-plus/common/initializer/none_initializer.h"
+#include "ps-plus/common/string_utils.h"
+
+#include <algorithm>
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
+#include <mutex>
 
 #define RETURN_ASYNC(STATUS) do { cb(STATUS); return; } while (0)
 
@@ -153,6 +159,24 @@ void Client::IsInitialized(const std::string& variable_name,
 void Client::DensePull(const std::string& variable_name, 
                        Tensor* result, 
                        const Client::Callback& cb) {
+  size_t chunk_rows = DenseChunkRows(variable_name, "", {});
+  if (chunk_rows > 0) {
+    ChunkedDensePull(variable_name, chunk_rows, result, cb);
+  } else {
+    DensePullRemote(variable_name, result, cb);
+  }
+  char* vp_var = std::getenv("vp_method");
+  char* meta_var = std::getenv("meta_dir");
+  std::string vp_string;
+  if (vp_var != NULL) { vp_string = vp_var; }
+  if (vp_string == "anneal" && meta_var != NULL) {
+    CHECK_ASYNC(UpdateVariableVisitInfo(variable_name, -1));
+  }
+}
+
+void Client::DensePullRemote(const std::string& variable_name,
+                             Tensor* result,
+                             const Client::Callback& cb) {
   std::vector<Data*> inputs = Args(false);
   std::vector<std::unique_ptr<Data>>* outputs = 
     new std::vector<std::unique_ptr<Data>>;
@@ -182,21 +206,19 @@ void Client::DensePull(const std::string& variable_name,
     *result = output_ptr->Internal();
     cb(Status::Ok());
   };
-  Process(udf_chain, variable_name, inputs, splitter, 
-          combiner, outputs, realcb);
-  char* vp_var = std::getenv("vp_method");
-  char* meta_var = std::getenv("meta_dir");
-  std::string vp_string;
-  if (vp_var != NULL) { vp_string = vp_var; }
-  if (vp_string == "anneal" && meta_var != NULL) {
-    CHECK_ASYNC(UpdateVariableVisitInfo(variable_name, -1));
-  }
+  raw_->Process(udf_chain, variable_name, inputs, splitter, 
+                combiner, outputs, realcb, true);
 }
 
 void Client::DensePush(const std::string& variable_name, 
                        const std::string& updater, 
                        const std::vector<Data*>& data, 
                        const Client::Callback& cb) {
+  size_t chunk_rows = DenseChunkRows(variable_name, updater, data);
+  if (chunk_rows > 0) {
+    ChunkedDensePush(variable_name, chunk_rows, updater, data, cb);
+    return;
+  }
   std::vector<Data*> inputs = Args(true);
   std::vector<std::unique_ptr<Data>>* outputs = 
     new std::vector<std::unique_ptr<Data>>;
@@ -285,8 +307,8 @@ void Client::SparsePull(const std::string& variable_name,
     *result = output_ptr->Internal();
     cb(Status::Ok());
   };
-  Process(udf_chain, variable_name, inputs, splitter, 
-          combiner, outputs, realcb);
+  raw_->Process(udf_chain, variable_name, inputs, splitter, 
+                combiner, outputs, realcb, true);
   char* vp_var = std::getenv("vp_method");
   char* meta_var = std::getenv("meta_dir");
   std::string vp_string;
@@ -353,19 +375,475 @@ void Client::SparsePush(const std::string& variable_name,
           combiner, outputs, realcb);
 }
 
+namespace {
+
+// Chunks rows are sent as sparse ids, the rows narrower than this are sent
+// whole to keep the ids small beside them.
+const size_t kDenseChunkMinRowBytes = 256;
+
+Tensor SliceRows(const Tensor& src, size_t begin, size_t end) {
+  TensorShape shape = src.Shape();
+  size_t row_bytes = SizeOfType(src.Type()) * shape.NumElements() / shape[0];
+  shape.Set(0, end - begin);
+  Tensor result(src.Type(), shape, new initializer::NoneInitializer);
+  memcpy(result.Raw<char>(), src.Raw<char>() + begin * row_bytes, (end - begin) * row_bytes);
+  return result;
+}
+
+template <typename T>
+bool CloneAs(Data* src, Data** dst) {
+  WrapperData<T>* raw = dynamic_cast<WrapperData<T>*>(src);
+  if (raw == nullptr) {
+    return false;
+  }
+  *dst = new WrapperData<T>(raw->Internal());
+  return true;
+}
+
+// The hyperparameters the dense updaters are pushed with, nullptr for
+// the others
+Data* CloneArg(Data* src) {
+  Data* dst = nullptr;
+  if (CloneAs<std::vector<double>>(src, &dst) || CloneAs<std::vector<float>>(src, &dst) ||
+      CloneAs<std::vector<bool>>(src, &dst) || CloneAs<std::vector<int>>(src, &dst) ||
+      CloneAs<std::vector<int64_t>>(src, &dst) || CloneAs<double>(src, &dst) ||
+      CloneAs<float>(src, &dst) || CloneAs<bool>(src, &dst) || CloneAs<int64_t>(src, &dst)) {
+    return dst;
+  }
+  return nullptr;
+}
+
+struct ChunkRun {
+  std::mutex mu;
+  size_t count;
+  size_t next = 0;
+  size_t running = 0;
+  bool finished = false;
+  Status st;
+  std::function<void(size_t, const Client::Callback&)> issue;
+  Client::Callback cb;
+};
+
+// Issues the next chunk of run, or calls its cb once the last is done
+void StepChunks(const std::shared_ptr<ChunkRun>& run) {
+  size_t index = run->count;
+  bool finish = false;
+  Status st;
+  {
+    std::lock_guard<std::mutex> lock(run->mu);
+    if (run->st.IsOk() && run->next < run->count) {
+      index = run->next++;
+      run->running++;
+    } else if (run->running == 0 && !run->finished) {
+      run->finished = true;
+      finish = true;
+      st = run->st;
+    }
+  }
+  if (index < run->count) {
+    run->issue(index, [run](const Status& st) {
+      {
+        std::lock_guard<std::mutex> lock(run->mu);
+        run->running--;
+        if (!st.IsOk() && run->st.IsOk()) {
+          run->st = st;
+        }
+      }
+      StepChunks(run);
+    });
+  } else if (finish) {
+    run->cb(st);
+  }
+}
+
+// Calls issue for the chunks 0..count-1 in order with at most window of
+// them in flight, and cb once all are done with the first error. No chunk
+// is issued after an error.
+void RunChunks(size_t count, size_t window,
+               const std::function<void(size_t, const Client::Callback&)>& issue,
+               const Client::Callback& cb) {
+  std::shared_ptr<ChunkRun> run(new ChunkRun);
+  run->count = count;
+  run->issue = issue;
+  run->cb = cb;
+  for (size_t i = 0; i < std::max<size_t>(std::min(window, count), 1); i++) {
+    StepChunks(run);
+  }
+}
+
+void ToHashCacheKeys(const Tensor& ids, std::vector<HashCache::Key>* keys) {
+  bool hash128 = ids.Shape().Size() == 2;
+  size_t count = ids.Shape().IsScalar() ? 0 : ids.Shape()[0];
+  keys->resize(count);
+  CASES(ids.Type(), do {
+    T* raw_ids = ids.Raw<T>();
+    for (size_t i = 0; i < count; i++) {
+      HashCache::Key& key = (*keys)[i];
+      key.x = hash128 ? raw_ids[i * 2] : raw_ids[i];
+      key.y = hash128 ? raw_ids[i * 2 + 1] : 0;
+    }
+  } while(0));
+}
+
+// Encoded gradients are decoded on the servers before they reach the
+// updater. decode_inputs holds the codecs and row sizes of every encoded
+// data input, they are appended after the data.
+UdfData GradientInput(size_t index, size_t data_index, size_t data_size, const std::vector<std::pair<size_t, Data*>>& decode_inputs) {
+  for (size_t i = 0; i + 1 < decode_inputs.size(); i += 2) {
+    if (decode_inputs[i].first + data_index == index) {
+      size_t codec_index = data_index + data_size + i;
+      return UdfData("DecodeGradient", UdfData(index), UdfData(codec_index), UdfData(codec_index + 1));
+    }
+  }
+  return UdfData(index);
+}
+
+}
+
+size_t Client::DenseChunkRows(const std::string& name, const std::string& updater, const std::vector<Data*>& data) {
+  size_t chunk_bytes = raw_->GetArgs().dense_chunk_bytes;
+  if (chunk_bytes == 0) {
+    return 0;
+  }
+  // adam and adaptive revision advance their powers once per call, sync
+  // mode aggregates one push per worker
+  if (!updater.empty() && (sync_mode_ || updater == "AdamUpdater" ||
+      updater == "AdaptiveRevisionUpdater" || updater == "AdaptiveRevisionPullUpdater")) {
+    return 0;
+  }
+  VariableInfo info;
+  if (!GetVariableInfo(name, &info).IsOk() || info.type != VariableInfo::kIndex || info.shape.size() < 2) {
+    return 0;
+  }
+  size_t rows = info.shape[0];
+  size_t row_bytes = SizeOfType(info.datatype);
+  for (size_t i = 1; i < info.shape.size(); i++) {
+    row_bytes *= info.shape[i];
+  }
+  if (row_bytes < kDenseChunkMinRowBytes || rows * row_bytes <= chunk_bytes) {
+    return 0;
+  }
+  bool by_rows = updater.empty();
+  for (auto item : data) {
+    if (auto grads = dynamic_cast<WrapperData<std::vector<Tensor>>*>(item)) {
+      for (auto& grad : grads->Internal()) {
+        if (grad.Shape().IsScalar() || grad.Shape()[0] != rows) {
+          return 0;
+        }
+      }
+      by_rows = by_rows || !grads->Internal().empty();
+    } else if (auto grad = dynamic_cast<WrapperData<Tensor>*>(item)) {
+      if (grad->Internal().Shape().IsScalar() || grad->Internal().Shape()[0] != rows) {
+        return 0;
+      }
+      by_rows = true;
+    } else {
+      std::unique_ptr<Data> clone(CloneArg(item));
+      if (clone == nullptr) {
+        return 0;
+      }
+    }
+  }
+  if (!by_rows) {
+    return 0;
+  }
+  return std::max<size_t>(chunk_bytes / row_bytes, 1);
+}
+
+// The chunks are pulled as the sparse rows of the variable.
+void Client::ChunkedDensePull(const std::string& variable_name,
+                              size_t chunk_rows,
+                              Tensor* result,
+                              const Client::Callback& cb) {
+  VariableInfo info;
+  CHECK_ASYNC(GetVariableInfo(variable_name, &info));
+  std::vector<size_t> dims(info.shape.begin(), info.shape.end());
+  *result = Tensor(info.datatype, TensorShape(dims), new initializer::NoneInitializer);
+  size_t rows = dims[0];
+  size_t row_bytes = SizeOfType(info.datatype) * result->Shape().NumElements() / rows;
+  char* raw_result = result->Raw<char>();
+  auto issue = [this, variable_name, chunk_rows, rows, row_bytes, raw_result](size_t chunk, const Callback& done) {
+    size_t begin = chunk * chunk_rows;
+    size_t end = std::min(begin + chunk_rows, rows);
+    Tensor ids(DataType::kInt64, TensorShape({end - begin}), new initializer::NoneInitializer);
+    for (size_t i = begin; i < end; i++) {
+      ids.Raw<int64_t>()[i - begin] = i;
+    }
+    std::vector<Data*> inputs = Args(ids, false);
+    std::vector<std::unique_ptr<Data>>* outputs = new std::vector<std::unique_ptr<Data>>;
+    std::vector<Partitioner*> splitter = {
+      new partitioner::SparseId,
+      new partitioner::Broadcast
+    };
+    std::vector<Partitioner*> combiner = {
+      new partitioner::SparseData
+    };
+    UdfData udf("BuildSparseSlice", UdfData(0), UdfData(1));
+    UdfData udf_chain("TransSlice", udf);
+    Callback realcb = [done, outputs, begin, end, row_bytes, raw_result](const Status& st) {
+      std::unique_ptr<std::vector<std::unique_ptr<Data>>> deleter(outputs);
+      if (!st.IsOk()) {
+        done(st);
+        return;
+      }
+      WrapperData<Tensor>* output_ptr = outputs->size() == 1 ?
+        dynamic_cast<WrapperData<Tensor>*>((*outputs)[0].get()) : nullptr;
+      if (output_ptr == nullptr || output_ptr->Internal().Shape().IsScalar() ||
+          output_ptr->Internal().Shape()[0] != end - begin) {
+        done(Status::ArgumentError("DensePull: chunk output should be a tensor of its rows"));
+        return;
+      }
+      memcpy(raw_result + begin * row_bytes, output_ptr->Internal().Raw<char>(), (end - begin) * row_bytes);
+      done(Status::Ok());
+    };
+    raw_->Process(udf_chain, variable_name, inputs, splitter,
+                  combiner, outputs, realcb, true);
+  };
+  RunChunks((rows + chunk_rows - 1) / chunk_rows, raw_->GetArgs().dense_chunk_window, issue, cb);
+}
+
+// The chunks are pushed as the sparse rows of the variable, every chunk
+// with its rows of the tensors and a copy of the other data.
+void Client::ChunkedDensePush(const std::string& variable_name,
+                              size_t chunk_rows,
+                              const std::string& updater,
+                              const std::vector<Data*>& data,
+                              const Client::Callback& cb) {
+  std::shared_ptr<std::vector<std::unique_ptr<Data>>> origin(new std::vector<std::unique_ptr<Data>>);
+  for (auto item : data) {
+    origin->emplace_back(item);
+  }
+  size_t rows = 0;
+  for (auto item : data) {
+    if (auto grads = dynamic_cast<WrapperData<std::vector<Tensor>>*>(item)) {
+      rows = grads->Internal().empty() ? rows : grads->Internal()[0].Shape()[0];
+    } else if (auto grad = dynamic_cast<WrapperData<Tensor>*>(item)) {
+      rows = grad->Internal().Shape()[0];
+    }
+  }
+  auto issue = [this, variable_name, chunk_rows, rows, updater, origin](size_t chunk, const Callback& done) {
+    size_t begin = chunk * chunk_rows;
+    size_t end = std::min(begin + chunk_rows, rows);
+    Tensor ids(DataType::kInt64, TensorShape({end - begin}), new initializer::NoneInitializer);
+    for (size_t i = begin; i < end; i++) {
+      ids.Raw<int64_t>()[i - begin] = i;
+    }
+    std::vector<Data*> chunk_data;
+    for (auto& item : *origin) {
+      if (auto grads = dynamic_cast<WrapperData<std::vector<Tensor>>*>(item.get())) {
+        std::vector<Tensor> chunk_grads;
+        for (auto& grad : grads->Internal()) {
+          chunk_grads.push_back(SliceRows(grad, begin, end));
+        }
+        chunk_data.push_back(new WrapperData<std::vector<Tensor>>(chunk_grads));
+      } else if (auto grad = dynamic_cast<WrapperData<Tensor>*>(item.get())) {
+        chunk_data.push_back(new WrapperData<Tensor>(SliceRows(grad->Internal(), begin, end)));
+      } else {
+        chunk_data.push_back(CloneArg(item.get()));
+      }
+    }
+    SparsePush(variable_name, ids, updater, chunk_data, done);
+  };
+  RunChunks((rows + chunk_rows - 1) / chunk_rows, raw_->GetArgs().dense_chunk_window, issue,
+            [origin, cb](const Status& st) { cb(st); });
+}
+
 void Client::HashPull(const std::string& variable_name, 
                       const Tensor& ids,
                       const float& save_ratio,
                       Tensor* result,
                       const Client::Callback& cb) {
+  HashCache* cache = GetHashCache(variable_name);
+  if (cache == nullptr) {
+    HashPullRemote(variable_name, ids, save_ratio, result, cb);
+  } else {
+    CachedHashPull(cache, variable_name, ids, save_ratio, result, cb);
+  }
+}
+
+// Serves fresh rows from the cache and pulls only the others, the pulled
+// rows are cached for the later steps.
+void Client::CachedHashPull(HashCache* cache,
+                            const std::string& variable_name,
+                            const Tensor& ids,
+                            const float& save_ratio,
+                            Tensor* result,
+                            const Client::Callback& cb) {
+  VariableInfo info;
+  CHECK_ASYNC(GetVariableInfo(variable_name, &info));
+  std::vector<size_t> dims(info.shape.begin(), info.shape.end());
+  std::shared_ptr<std::vector<HashCache::Key>> keys(new std::vector<HashCache::Key>);
+  ToHashCacheKeys(ids, keys.get());
+  dims[0] = keys->size();
+  *result = Tensor(info.datatype, TensorShape(dims), new initializer::NoneInitializer);
+  char* rows = result->Raw<char>();
+  size_t row_bytes = cache->RowBytes();
+  int64_t step = step_;
+
+  std::shared_ptr<std::vector<size_t>> misses(new std::vector<size_t>);
+  for (size_t i = 0; i < keys->size(); i++) {
+    if (!cache->Get((*keys)[i], step, rows + i * row_bytes)) {
+      misses->push_back(i);
+    }
+  }
+  if (misses->empty()) {
+    RETURN_ASYNC(Status::Ok());
+  }
+
+  std::vector<size_t> miss_dims(ids.Shape().Dims());
+  miss_dims[0] = misses->size();
+  Tensor miss_ids(ids.Type(), TensorShape(miss_dims), new initializer::NoneInitializer);
+  size_t id_bytes = SizeOfType(ids.Type()) * ids.Shape().NumElements() / keys->size();
+  for (size_t i = 0; i < misses->size(); i++) {
+    memcpy(miss_ids.Raw<char>() + i * id_bytes, ids.Raw<char>() + (*misses)[i] * id_bytes, id_bytes);
+  }
+  Tensor* pulled = new Tensor;
+  Tensor output = *result;
+  Callback realcb = [cb, cache, keys, misses, pulled, output, row_bytes, step](const Status& st) {
+    std::unique_ptr<Tensor> deleter(pulled);
+    if (!st.IsOk()) {
+      cb(st);
+      return;
+    }
+    if (pulled->Shape().NumElements() * SizeOfType(pulled->Type()) != misses->size() * row_bytes) {
+      cb(Status::ArgumentError("HashPull result size mismatch with the cache"));
+      return;
+    }
+    char* rows = output.Raw<char>();
+    for (size_t i = 0; i < misses->size(); i++) {
+      size_t index = (*misses)[i];
+      memcpy(rows + index * row_bytes, pulled->Raw<char>() + i * row_bytes, row_bytes);
+      cache->Put((*keys)[index], step, rows + index * row_bytes);
+    }
+    cb(Status::Ok());
+  };
+  HashPullRemote(variable_name, miss_ids, save_ratio, pulled, realcb);
+}
+
+HashCache* Client::GetHashCache(const std::string& name) {
+  std::lock_guard<std::mutex> lock(hash_cache_mu_);
+  auto iter = hash_caches_.find(name);
+  if (iter != hash_caches_.end()) {
+    return iter->second.get();
+  }
+  VariableInfo info;
+  if (!GetVariableInfo(name, &info).IsOk()) {
+    return nullptr;
+  }
+  std::unique_ptr<HashCache>& cache = hash_caches_[name];
+  auto capacity_arg = info.args.find(VariableInfo::HASH_CACHE_CAPACITY);
+  if (capacity_arg == info.args.end() || info.shape.empty()) {
+    return nullptr;
+  }
+  uint64_t capacity = 0;
+  int64_t staleness = 0;
+  auto staleness_arg = info.args.find(VariableInfo::HASH_CACHE_STALENESS);
+  if (!StringUtils::strToUInt64(capacity_arg->second.c_str(), capacity) ||
+      (staleness_arg != info.args.end() && !StringUtils::strToInt64(staleness_arg->second.c_str(), staleness))) {
+    LOG(ERROR) << "Variable[" << name << "] has a bad hash cache config, cache disabled";
+    return nullptr;
+  }
+  if (capacity == 0) {
+    return nullptr;
+  }
+  size_t row_bytes = SizeOfType(info.datatype);
+  for (size_t i = 1; i < info.shape.size(); i++) {
+    row_bytes *= info.shape[i];
+  }
+  cache.reset(new HashCache(name, capacity, staleness, row_bytes));
+  if (step_staleness_ >= 0) {
+    cache->LimitStaleness(step_staleness_);
+  }
+  LOG(INFO) << "HashCache " << name << ": capacity " << capacity << " staleness " << cache->Staleness();
+  return cache.get();
+}
+
+void Client::EraseHashCache(const std::string& name, const Tensor& ids) {
+  HashCache* cache = GetHashCache(name);
+  if (cache == nullptr) {
+    return;
+  }
+  std::vector<HashCache::Key> keys;
+  ToHashCacheKeys(ids, &keys);
+  for (auto& key : keys) {
+    cache->Erase(key);
+  }
+}
+
+Status Client::GetGradientCodec(const std::string& name, GradientCodecState** state) {
+  std::lock_guard<std::mutex> lock(hash_cache_mu_);
+  auto iter = gradient_codecs_.find(name);
+  if (iter != gradient_codecs_.end()) {
+    *state = iter->second.get();
+    return Status::Ok();
+  }
+  VariableInfo info;
+  PS_CHECK_STATUS(GetVariableInfo(name, &info));
+  std::unique_ptr<GradientCodecState> result(new GradientCodecState);
+  auto spec = info.args.find(VariableInfo::GRADIENT_CODEC);
+  PS_CHECK_STATUS(GradientCodec::Parse(spec == info.args.end() ? "" : spec->second, &result->codec));
+  if (result->codec.GetType() == GradientCodec::kTopK) {
+    result->residual.reset(new GradientResidual);
+  }
+  *state = result.get();
+  gradient_codecs_[name] = std::move(result);
+  return Status::Ok();
+}
+
+Status Client::EncodeGradient(const std::string& name, const Tensor& ids, Tensor* grad, int* codec, int64_t* cols) {
+  GradientCodecState* state;
+  PS_CHECK_STATUS(GetGradientCodec(name, &state));
+  *codec = GradientCodec::kNone;
+  *cols = 0;
+  if (state->codec.GetType() == GradientCodec::kNone || grad->Type() != DataType::kFloat ||
+      grad->Shape().IsScalar() || grad->Shape()[0] == 0) {
+    return Status::Ok();
+  }
+  *codec = state->codec.GetType();
+  *cols = grad->Shape().NumElements() / grad->Shape()[0];
+  Tensor input = *grad;
+  std::vector<HashCache::Key> keys;
+  if (state->residual != nullptr) {
+    ToHashCacheKeys(ids, &keys);
+    if (keys.size() != grad->Shape()[0]) {
+      return Status::ArgumentError("Variable[" + name + "] gradient rows mismatch with ids");
+    }
+    state->residual->Apply(keys, *grad, &input);
+  }
+  Tensor residual;
+  PS_CHECK_STATUS(state->codec.Encode(input, grad, state->residual == nullptr ? nullptr : &residual));
+  if (state->residual != nullptr) {
+    state->residual->Store(keys, residual);
+  }
+  return Status::Ok();
+}
+
+void Client::EnterStep(int64_t staleness) {
+  step_++;
+  std::lock_guard<std::mutex> lock(hash_cache_mu_);
+  step_staleness_ = staleness;
+  for (auto& item : hash_caches_) {
+    if (item.second != nullptr) {
+      item.second->LimitStaleness(staleness);
+    }
+  }
+}
+
+void Client::HashPullRemote(const std::string& variable_name,
+                            const Tensor& ids,
+                            const float& save_ratio,
+                            Tensor* result,
+                            const Client::Callback& cb) {
   std::vector<Tensor> ids_vec = {ids};
   std::vector<std::string> name_vec = {variable_name};
   std::vector<float> save_ratio_vec = {save_ratio};  
   std::vector<Data*> inputs = Args(ids_vec, name_vec, save_ratio_vec, false, true);
   std::vector<std::unique_ptr<Data>>* outputs = 
     new std::vector<std::unique_ptr<Data>>;
+  HotIdRouter* router = GetHotIdRouter(variable_name);
+  std::shared_ptr<std::vector<size_t>> promote(new std::vector<size_t>);
   std::vector<Partitioner*> splitter = {
-    new partitioner::HashId, 
+    HashIdSplitter(router, ids, false, promote.get()), 
     new partitioner::Broadcast, 
     new partitioner::Broadcast,
     new partitioner::Broadcast,    
@@ -376,9 +854,17 @@ void Client::HashPull(const std::string& variable_name,
   };
   UdfData udf("BuildHashSlice", UdfData(0), UdfData(1), UdfData(2), UdfData(3), UdfData(4));
   UdfData udf_chain("TransSlice", udf);
-  Callback realcb = [cb, result, outputs](const Status& st) {
+  Callback realcb = [this, cb, result, outputs, router, promote, variable_name, ids, save_ratio](const Status& st) {
     std::unique_ptr<std::vector<std::unique_ptr<Data>>> deleter(outputs);
     if (!st.IsOk()) {
+      if (router != nullptr && !promote->empty()) {
+        std::vector<HashCache::Key> keys, promoted;
+        ToHashCacheKeys(ids, &keys);
+        for (auto i : *promote) {
+          promoted.push_back(keys[i]);
+        }
+        router->Seeded(promoted, false);
+      }
       cb(st);
       return;
     }
@@ -396,11 +882,14 @@ void Client::HashPull(const std::string& variable_name,
     }
 
     *result = output_ptr->Internal();
+    if (router != nullptr && !promote->empty()) {
+      SeedReplicas(router, variable_name, ids, *result, *promote, save_ratio);
+    }
     cb(Status::Ok());
   };
 
-  Process(udf_chain, variable_name, inputs, splitter, 
-          combiner, outputs, realcb);
+  raw_->Process(udf_chain, variable_name, inputs, splitter, 
+                combiner, outputs, realcb, true);
   char* vp_var = std::getenv("vp_method");
   char* meta_var = std::getenv("meta_dir");
   std::string vp_string;
@@ -410,11 +899,147 @@ void Client::HashPull(const std::string& variable_name,
   }
 }
 
+HotIdRouter* Client::GetHotIdRouter(const std::string& name) {
+  if (sync_mode_) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(hash_cache_mu_);
+  auto iter = hot_id_routers_.find(name);
+  if (iter != hot_id_routers_.end()) {
+    return iter->second.get();
+  }
+  VariableInfo info;
+  if (!GetVariableInfo(name, &info).IsOk()) {
+    return nullptr;
+  }
+  std::unique_ptr<HotIdRouter>& router = hot_id_routers_[name];
+  auto replicas_arg = info.args.find(VariableInfo::HOT_ID_REPLICAS);
+  if (replicas_arg == info.args.end()) {
+    return nullptr;
+  }
+  uint64_t replicas = 0;
+  double ratio = 0.001;
+  uint64_t capacity = 1024;
+  auto ratio_arg = info.args.find(VariableInfo::HOT_ID_RATIO);
+  auto capacity_arg = info.args.find(VariableInfo::HOT_ID_CAPACITY);
+  if (!StringUtils::strToUInt64(replicas_arg->second.c_str(), replicas) ||
+      (ratio_arg != info.args.end() && !StringUtils::strToDouble(ratio_arg->second.c_str(), ratio)) ||
+      (capacity_arg != info.args.end() && !StringUtils::strToUInt64(capacity_arg->second.c_str(), capacity))) {
+    LOG(ERROR) << "Variable[" << name << "] has a bad hot id config, replicas disabled";
+    return nullptr;
+  }
+  replicas = std::min<uint64_t>(replicas, info.parts.size());
+  if (replicas <= 1 || capacity == 0) {
+    return nullptr;
+  }
+  router.reset(new HotIdRouter(name, replicas, ratio, capacity));
+  LOG(INFO) << "HotIdRouter " << name << ": replicas " << replicas << " ratio " << ratio << " capacity " << capacity;
+  return router.get();
+}
+
+Partitioner* Client::HashIdSplitter(HotIdRouter* router, const Tensor& ids, bool push, std::vector<size_t>* promote) {
+  if (router == nullptr) {
+    return new partitioner::HashId;
+  }
+  std::vector<HashCache::Key> keys;
+  ToHashCacheKeys(ids, &keys);
+  std::vector<bool> replicated;
+  if (push) {
+    router->RoutePush(keys, &replicated);
+  } else {
+    router->ObservePull(keys, &replicated, promote);
+  }
+  if (std::none_of(replicated.begin(), replicated.end(), [](bool x) { return x; })) {
+    return new partitioner::HashId;
+  }
+  return new partitioner::ReplicatedHashId(
+      replicated, router->Replicas(),
+      push ? partitioner::ReplicatedHashId::kPushAll : partitioner::ReplicatedHashId::kPullAny,
+      hot_id_salt_++);
+}
+
+// The replicas keep their own updater state, only the rows are copied from
+// the owner.
+void Client::SeedReplicas(HotIdRouter* router,
+                          const std::string& variable_name,
+                          const Tensor& ids,
+                          const Tensor& rows,
+                          const std::vector<size_t>& promote,
+                          const float& save_ratio) {
+  std::vector<size_t> id_dims(ids.Shape().Dims());
+  std::vector<size_t> row_dims(rows.Shape().Dims());
+  id_dims[0] = row_dims[0] = promote.size();
+  Tensor seed_ids(ids.Type(), TensorShape(id_dims), new initializer::NoneInitializer);
+  Tensor seed_rows(rows.Type(), TensorShape(row_dims), new initializer::NoneInitializer);
+  size_t id_bytes = SizeOfType(ids.Type()) * ids.Shape().NumElements() / ids.Shape()[0];
+  size_t row_bytes = SizeOfType(rows.Type()) * rows.Shape().NumElements() / rows.Shape()[0];
+  for (size_t i = 0; i < promote.size(); i++) {
+    memcpy(seed_ids.Raw<char>() + i * id_bytes, ids.Raw<char>() + promote[i] * id_bytes, id_bytes);
+    memcpy(seed_rows.Raw<char>() + i * row_bytes, rows.Raw<char>() + promote[i] * row_bytes, row_bytes);
+  }
+  std::shared_ptr<std::vector<HashCache::Key>> keys(new std::vector<HashCache::Key>);
+  ToHashCacheKeys(seed_ids, keys.get());
+
+  std::vector<Tensor> ids_vec = {seed_ids};
+  std::vector<std::string> name_vec = {variable_name};
+  std::vector<float> save_ratio_vec = {save_ratio};
+  std::vector<Data*> inputs = Args(ids_vec, name_vec, save_ratio_vec, true, true);
+  std::vector<Data*> data = Args(std::vector<Tensor>{seed_rows});
+  inputs.insert(inputs.end(), data.begin(), data.end());
+  std::vector<std::unique_ptr<Data>>* outputs =
+    new std::vector<std::unique_ptr<Data>>;
+  std::vector<Partitioner*> splitter = {
+    new partitioner::ReplicatedHashId(std::vector<bool>(promote.size(), true), router->Replicas(),
+                                      partitioner::ReplicatedHashId::kSeedReplicas),
+    new partitioner::Broadcast,
+    new partitioner::Broadcast,
+    new partitioner::Broadcast,
+    new partitioner::Broadcast,
+    new partitioner::HashData
+  };
+  std::vector<Partitioner*> combiner = {};
+  UdfData udf("AssignUpdater",
+              UdfData("BuildHashSlice", UdfData(0), UdfData(1), UdfData(2), UdfData(3), UdfData(4)),
+              UdfData(5));
+  Callback realcb = [router, keys, outputs, variable_name](const Status& st) {
+    std::unique_ptr<std::vector<std::unique_ptr<Data>>> deleter(outputs);
+    if (!st.IsOk()) {
+      LOG(ERROR) << "Variable[" << variable_name << "] seeding the replicas failed, " << st.ToString();
+    }
+    router->Seeded(*keys, st.IsOk());
+  };
+  Process(udf, variable_name, inputs, splitter, combiner, outputs, realcb);
+}
+
 void Client::MergedHashPull(const std::vector<std::string>& var_names, 
                             const std::vector<Tensor>& ids,
                             const std::vector<float>& save_ratios,
                             std::vector<Tensor>* result, 
                             const Client::Callback& cb) {
+  std::shared_ptr<SharedIdMerger> merger(new SharedIdMerger);
+  std::vector<float> merged_ratios;
+  if (!raw_->GetArgs().merge_shared_ids || !merger->Init(var_names, ids) ||
+      !merger->MergeValues(save_ratios, &merged_ratios)) {
+    MergedHashPullRemote(var_names, ids, save_ratios, result, cb);
+    return;
+  }
+  std::vector<Tensor>* merged = new std::vector<Tensor>;
+  Callback realcb = [cb, merger, merged, result](const Status& st) {
+    std::unique_ptr<std::vector<Tensor>> deleter(merged);
+    if (!st.IsOk()) {
+      cb(st);
+      return;
+    }
+    cb(merger->Scatter(*merged, result));
+  };
+  MergedHashPullRemote(merger->VarNames(), merger->Ids(), merged_ratios, merged, realcb);
+}
+
+void Client::MergedHashPullRemote(const std::vector<std::string>& var_names,
+                                  const std::vector<Tensor>& ids,
+                                  const std::vector<float>& save_ratios,
+                                  std::vector<Tensor>* result,
+                                  const Client::Callback& cb) {
   std::vector<Data*> inputs = Args(ids, var_names, save_ratios, false, true);
   std::vector<std::vector<std::unique_ptr<Data>>>* outputs = 
     new std::vector<std::vector<std::unique_ptr<Data>>>;
@@ -457,10 +1082,45 @@ void Client::MergedHashPull(const std::vector<std::string>& var_names,
     cb(Status::Ok());
   };
 
-  Process(udf, var_names, inputs, splitter, 
-          combiner, outputs, realcb);
+  raw_->Process(udf, var_names, inputs, splitter, 
+                combiner, outputs, realcb, true);
 }
 
+Client::GradientAccumulateState* Client::GetGradientAccumulator(const std::string& name) {
+  std::lock_guard<std::mutex> lock(hash_cache_mu_);
+  auto iter = gradient_accumulators_.find(name);
+  if (iter != gradient_accumulators_.end()) {
+    return iter->second.get();
+  }
+  VariableInfo info;
+  if (!GetVariableInfo(name, &info).IsOk()) {
+    return nullptr;
+  }
+  std::unique_ptr<GradientAccumulateState>& state = gradient_accumulators_[name];
+  auto steps_arg = info.args.find(VariableInfo::GRADIENT_ACCUMULATE_STEPS);
+  if (steps_arg == info.args.end()) {
+    return nullptr;
+  }
+  uint64_t steps = 0;
+  uint64_t max_bytes = 64ull << 20;
+  auto bytes_arg = info.args.find(VariableInfo::GRADIENT_ACCUMULATE_BYTES);
+  auto mean_arg = info.args.find(VariableInfo::GRADIENT_ACCUMULATE_MEAN);
+  if (!StringUtils::strToUInt64(steps_arg->second.c_str(), steps) ||
+      (bytes_arg != info.args.end() && !StringUtils::strToUInt64(bytes_arg->second.c_str(), max_bytes))) {
+    LOG(ERROR) << "Variable[" << name << "] has a bad gradient accumulate config, accumulation disabled";
+    return nullptr;
+  }
+  if (steps <= 1) {
+    return nullptr;
+  }
+  bool mean = mean_arg != info.args.end() && (mean_arg->second == "true" || mean_arg->second == "1");
+  state.reset(new GradientAccumulateState(steps, max_bytes, mean));
+  LOG(INFO) << "GradientAccumulator " << name << ": steps " << steps << " bytes " << max_bytes << " mean " << mean;
+  return state.get();
+}
+
+// Sync mode aggregates the gradients of a token on the servers and the
+// updaters count the workers of it, the pushes are never accumulated there.
 void Client::HashPush(const std::string& variable_name, 
                       const Tensor& ids,
                       const float& save_ratio,
@@ -468,6 +1128,141 @@ void Client::HashPush(const std::string& variable_name,
                       const std::string& updater,
                       const std::vector<Data*>& data, 
                       const Client::Callback& cb) {
+  GradientAccumulateState* state = sync_mode_ || data.empty() ? nullptr : GetGradientAccumulator(variable_name);
+  WrapperData<std::vector<Tensor>>* grads =
+    state == nullptr ? nullptr : dynamic_cast<WrapperData<std::vector<Tensor>>*>(data[0]);
+  if (grads == nullptr || grads->Internal().size() != 1 || grads->Internal()[0].Type() != DataType::kFloat) {
+    HashPushRemote(variable_name, ids, save_ratio, insertable, updater, data, cb);
+    return;
+  }
+  Tensor flush_ids;
+  Status st;
+  bool full = false;
+  {
+    std::lock_guard<std::mutex> lock(state->mu);
+    st = state->buffer.Add(ids, grads->Internal()[0], &full);
+    if (st.IsOk() && full) {
+      state->buffer.Take(&flush_ids, &grads->Internal()[0]);
+      state->args.clear();
+    } else if (st.IsOk()) {
+      state->save_ratio = save_ratio;
+      state->insertable = insertable;
+      state->updater = updater;
+      state->args.clear();
+      delete data[0];
+      for (size_t i = 1; i < data.size(); i++) {
+        state->args.emplace_back(data[i]);
+      }
+    }
+  }
+  if (!st.IsOk()) {
+    for (auto one : data) {
+      delete one;
+    }
+    cb(st);
+  } else if (full) {
+    HashPushRemote(variable_name, flush_ids, save_ratio, insertable, updater, data, cb);
+  } else {
+    cb(Status::Ok());
+  }
+}
+
+void Client::FlushGradients(const Client::Callback& cb) {
+  std::vector<std::pair<std::string, GradientAccumulateState*>> states;
+  {
+    std::lock_guard<std::mutex> lock(hash_cache_mu_);
+    for (auto& item : gradient_accumulators_) {
+      if (item.second != nullptr) {
+        states.emplace_back(item.first, item.second.get());
+      }
+    }
+  }
+  struct Flush {
+    std::string name;
+    Tensor ids;
+    float save_ratio;
+    bool insertable;
+    std::string updater;
+    std::vector<Data*> data;
+  };
+  std::vector<Flush> flushes;
+  for (auto& item : states) {
+    GradientAccumulateState* state = item.second;
+    std::lock_guard<std::mutex> lock(state->mu);
+    if (state->buffer.Empty()) {
+      continue;
+    }
+    flushes.emplace_back();
+    Flush& flush = flushes.back();
+    std::vector<Tensor> grads(1);
+    state->buffer.Take(&flush.ids, &grads[0]);
+    flush.name = item.first;
+    flush.save_ratio = state->save_ratio;
+    flush.insertable = state->insertable;
+    flush.updater = state->updater;
+    flush.data.push_back(Args(grads)[0]);
+    for (auto& arg : state->args) {
+      flush.data.push_back(arg.release());
+    }
+    state->args.clear();
+  }
+  if (flushes.empty()) {
+    cb(Status::Ok());
+    return;
+  }
+  struct Join {
+    std::mutex mu;
+    size_t remaining;
+    Status st;
+  };
+  std::shared_ptr<Join> join(new Join);
+  join->remaining = flushes.size();
+  for (auto& flush : flushes) {
+    HashPushRemote(flush.name, flush.ids, flush.save_ratio, flush.insertable, flush.updater, flush.data,
+                   [join, cb](const Status& st) {
+      bool done;
+      Status ret;
+      {
+        std::unique_lock<std::mutex> lock(join->mu);
+        if (!st.IsOk() && join->st.IsOk()) {
+          join->st = st;
+        }
+        done = --join->remaining == 0;
+        ret = join->st;
+      }
+      if (done) {
+        cb(ret);
+      }
+    });
+  }
+}
+
+void Client::HashPushRemote(const std::string& variable_name,
+                            const Tensor& ids,
+                            const float& save_ratio,
+                            const bool& insertable,
+                            const std::string& updater,
+                            const std::vector<Data*>& data,
+                            const Client::Callback& cb) {
+  EraseHashCache(variable_name, ids);
+  std::vector<std::pair<size_t, Data*>> decode_inputs;
+  for (size_t i = 0; i < data.size(); i++) {
+    WrapperData<std::vector<Tensor>>* grads = dynamic_cast<WrapperData<std::vector<Tensor>>*>(data[i]);
+    if (grads == nullptr) {
+      continue;
+    }
+    std::vector<int> codecs;
+    std::vector<int64_t> cols;
+    for (auto& grad : grads->Internal()) {
+      codecs.emplace_back();
+      cols.emplace_back();
+      CHECK_ASYNC(EncodeGradient(variable_name, ids, &grad, &codecs.back(), &cols.back()));
+    }
+    if (std::any_of(codecs.begin(), codecs.end(), [](int codec) { return codec != GradientCodec::kNone; })) {
+      decode_inputs.emplace_back(i, Args(codecs)[0]);
+      decode_inputs.emplace_back(i, Args(cols)[0]);
+    }
+  }
   std::vector<Tensor> ids_vec = {ids};
   std::vector<std::string> name_vec = {variable_name};
   std::vector<float> save_ratio_vec = {save_ratio};  
@@ -476,7 +1271,7 @@ void Client::HashPush(const std::string& variable_name,
   std::vector<std::unique_ptr<Data>>* outputs = 
     new std::vector<std::unique_ptr<Data>>;
   std::vector<Partitioner*> splitter = {
-    new partitioner::HashId, 
+    HashIdSplitter(GetHotIdRouter(variable_name), ids, true, nullptr), 
     new partitioner::Broadcast,
     new partitioner::Broadcast,     
     new partitioner::Broadcast,
@@ -496,7 +1291,7 @@ void Client::HashPush(const std::string& variable_name,
     inputs.push_back(Args(worker_count_)[0]);
     next_udf_inputs.push_back(UdfData(5));
     next_udf_inputs.push_back(UdfData(6));
-    next_udf_inputs.push_back(UdfData(7));    
+    next_udf_inputs.push_back(GradientInput(7, 7, data.size(), decode_inputs));    
     splitter.push_back(new partitioner::Broadcast);
     splitter.push_back(new partitioner::Broadcast);
     splitter.push_back(new partitioner::HashData);    
@@ -505,15 +1300,20 @@ void Client::HashPush(const std::string& variable_name,
     start_index = 8;
   }
   
+  size_t data_index = inputs.size();
   inputs.insert(inputs.end(), data.begin(), data.end());
-  for (size_t i = start_index; i < inputs.size(); i++) {
+  for (size_t i = start_index; i < data_index + data.size(); i++) {
     if (dynamic_cast<WrapperData<Tensor>*>(inputs[i]) != nullptr
       || dynamic_cast<WrapperData<std::vector<Tensor>>*>(inputs[i]) != nullptr) {
       splitter.push_back(new partitioner::HashData);
     } else {
       splitter.push_back(new partitioner::Broadcast);
     }
-    next_udf_inputs.push_back(UdfData(i));
+    next_udf_inputs.push_back(GradientInput(i, data_index, data.size(), decode_inputs));
+  }
+  for (auto& item : decode_inputs) {
+    inputs.push_back(item.second);
+    splitter.push_back(new partitioner::Broadcast);
   }
 
   UdfData udf(updater, next_udf_inputs);
@@ -526,12 +1326,108 @@ void Client::HashPush(const std::string& variable_name,
           combiner, outputs, realcb);
 }
 
+template <typename T>
+bool MergeValueData(const SharedIdMerger& merger, Data* data, Data** merged) {
+  WrapperData<std::vector<T>>* values = dynamic_cast<WrapperData<std::vector<T>>*>(data);
+  if (values == nullptr) {
+    return false;
+  }
+  WrapperData<std::vector<T>>* result = new WrapperData<std::vector<T>>();
+  if (!merger.MergeValues(values->Internal(), &result->Internal())) {
+    delete result;
+    *merged = nullptr;
+    return true;
+  }
+  *merged = result;
+  return true;
+}
+
+// Gradients are summed and the hyperparameters of the entries of a variable
+// must agree, the data of the other types are sent as is.
+bool Client::MergeSharedData(const SharedIdMerger& merger, const std::vector<Data*>& data, std::vector<Data*>* merged) {
+  bool ok = true;
+  for (auto item : data) {
+    Data* result = item;
+    WrapperData<std::vector<Tensor>>* grads = dynamic_cast<WrapperData<std::vector<Tensor>>*>(item);
+    if (grads != nullptr) {
+      WrapperData<std::vector<Tensor>>* sum = new WrapperData<std::vector<Tensor>>();
+      if (merger.Sum(grads->Internal(), &sum->Internal()).IsOk()) {
+        result = sum;
+      } else {
+        delete sum;
+        result = nullptr;
+      }
+    } else if (!MergeValueData<double>(merger, item, &result) &&
+               !MergeValueData<float>(merger, item, &result) &&
+               !MergeValueData<bool>(merger, item, &result) &&
+               !MergeValueData<int64_t>(merger, item, &result)) {
+      result = item;
+    }
+    ok = ok && result != nullptr;
+    merged->push_back(result);
+  }
+  if (!ok) {
+    for (size_t i = 0; i < data.size(); i++) {
+      if ((*merged)[i] != data[i]) {
+        delete (*merged)[i];
+      }
+    }
+    merged->clear();
+  }
+  return ok;
+}
+
 void Client::MergedHashPush(const std::vector<std::string>& var_names,
                             const std::vector<Tensor>& ids,
                             const std::vector<float>& save_ratios,
                             const std::string& updater,
                             const std::vector<Data*>& data,
                             const Client::Callback& cb) {
+  SharedIdMerger merger;
+  std::vector<float> merged_ratios;
+  std::vector<Data*> merged_data;
+  if (!raw_->GetArgs().merge_shared_ids || !merger.Init(var_names, ids) ||
+      !merger.MergeValues(save_ratios, &merged_ratios) ||
+      !MergeSharedData(merger, data, &merged_data)) {
+    MergedHashPushRemote(var_names, ids, save_ratios, updater, data, cb);
+    return;
+  }
+  // the data are owned by the push, the ones replaced are copied
+  for (size_t i = 0; i < data.size(); i++) {
+    if (merged_data[i] != data[i]) {
+      delete data[i];
+    }
+  }
+  MergedHashPushRemote(merger.VarNames(), merger.Ids(), merged_ratios, updater, merged_data, cb);
+}
+
+void Client::MergedHashPushRemote(const std::vector<std::string>& var_names,
+                                  const std::vector<Tensor>& ids,
+                                  const std::vector<float>& save_ratios,
+                                  const std::string& updater,
+                                  const std::vector<Data*>& data,
+                                  const Client::Callback& cb) {
+  for (size_t i = 0; i < var_names.size() && i < ids.size(); i++) {
+    EraseHashCache(var_names[i], ids[i]);
+  }
+  std::vector<std::pair<size_t, Data*>> decode_inputs;
+  for (size_t i = 0; i < data.size(); i++) {
+    WrapperData<std::vector<Tensor>>* grads = dynamic_cast<WrapperData<std::vector<Tensor>>*>(data[i]);
+    if (grads == nullptr || grads->Internal().size() != var_names.size() || ids.size() != var_names.size()) {
+      continue;
+    }
+    std::vector<int> codecs;
+    std::vector<int64_t> cols;
+    for (size_t j = 0; j < var_names.size(); j++) {
+      codecs.emplace_back();
+      cols.emplace_back();
+      CHECK_ASYNC(EncodeGradient(var_names[j], ids[j], &grads->Internal()[j], &codecs.back(), &cols.back()));
+    }
+    if (std::any_of(codecs.begin(), codecs.end(), [](int codec) { return codec != GradientCodec::kNone; })) {
+      decode_inputs.emplace_back(i, Args(codecs)[0]);
+      decode_inputs.emplace_back(i, Args(cols)[0]);
+    }
+  }
   std::vector<Data*> inputs = Args(ids, var_names, save_ratios, true, false);
   size_t start_index = 5;
   std::vector<std::vector<std::unique_ptr<Data>>>* outputs = 
@@ -557,7 +1453,7 @@ void Client::MergedHashPush(const std::vector<std::string>& var_names,
     inputs.push_back(Args(worker_count_)[0]);
     next_udf_inputs.push_back(UdfData(5));
     next_udf_inputs.push_back(UdfData(6));
-    next_udf_inputs.push_back(UdfData(7));    
+    next_udf_inputs.push_back(GradientInput(7, 7, data.size(), decode_inputs));    
     splitter.push_back(new partitioner::MergedBroadcast);
     splitter.push_back(new partitioner::MergedBroadcast);
     splitter.push_back(new partitioner::MergedHashData);    
@@ -566,15 +1462,20 @@ void Client::MergedHashPush(const std::vector<std::string>& var_names,
     start_index = 8;
   }
   
+  size_t data_index = inputs.size();
   inputs.insert(inputs.end(), data.begin(), data.end());
-  for (size_t i = start_index; i < inputs.size(); i++) {
+  for (size_t i = start_index; i < data_index + data.size(); i++) {
     if (dynamic_cast<WrapperData<Tensor>*>(inputs[i]) != nullptr
       || dynamic_cast<WrapperData<std::vector<Tensor>>*>(inputs[i]) != nullptr) {
       splitter.push_back(new partitioner::MergedHashData);
     } else {
       splitter.push_back(new partitioner::MergedBroadcast);
     }
-    next_udf_inputs.push_back(UdfData(i));
+    next_udf_inputs.push_back(GradientInput(i, data_index, data.size(), decode_inputs));
+  }
+  for (auto& item : decode_inputs) {
+    inputs.push_back(item.second);
+    splitter.push_back(new partitioner::MergedBroadcast);
   }
 
   UdfData udf(updater, next_udf_inputs);
@@ -587,6 +1488,146 @@ void Client::MergedHashPush(const std::vector<std::string>& var_names,
           combiner, outputs, realcb);
 }
 
+void Client::MixedHashPush(const std::vector<std::string>& var_names,
+                           const std::vector<Tensor>& ids,
+                           const std::vector<float>& save_ratios,
+                           const std::vector<std::string>& updaters,
+                           const std::vector<std::vector<int64_t>>& groups,
+                           const std::vector<std::vector<Data*>>& data,
+                           const Client::Callback& cb) {
+  auto fail = [&data, &cb](const Status& st) {
+    for (auto& item : data) {
+      for (auto one : item) {
+        delete one;
+      }
+    }
+    cb(st);
+  };
+  if (updaters.size() != groups.size() || updaters.size() != data.size()) {
+    fail(Status::ArgumentError("MixedHashPush: updaters, groups and data size not match"));
+    return;
+  }
+  for (size_t g = 0; g < groups.size(); g++) {
+    if (data[g].empty() || dynamic_cast<WrapperData<std::vector<Tensor>>*>(data[g][0]) == nullptr) {
+      fail(Status::ArgumentError("MixedHashPush: the first data of an updater should be its gradients"));
+      return;
+    }
+    if (dynamic_cast<WrapperData<std::vector<Tensor>>*>(data[g][0])->Internal().size() != groups[g].size()) {
+      fail(Status::ArgumentError("MixedHashPush: gradients and group size not match"));
+      return;
+    }
+    for (auto index : groups[g]) {
+      if (index < 0 || (size_t)index >= var_names.size() || (size_t)index >= ids.size()) {
+        fail(Status::ArgumentError("MixedHashPush: group index out of range"));
+        return;
+      }
+    }
+  }
+  if (sync_mode_) {
+    // AggregateSlice waits per request, every updater keeps its own
+    struct Join {
+      std::mutex mu;
+      size_t remaining;
+      Status st;
+    };
+    std::shared_ptr<Join> join(new Join);
+    join->remaining = updaters.size();
+    for (size_t g = 0; g < updaters.size(); g++) {
+      std::vector<std::string> group_names;
+      std::vector<Tensor> group_ids;
+      std::vector<float> group_ratios;
+      for (auto index : groups[g]) {
+        group_names.push_back(var_names[index]);
+        group_ids.push_back(ids[index]);
+        group_ratios.push_back(save_ratios[index]);
+      }
+      MergedHashPush(group_names, group_ids, group_ratios, updaters[g], data[g], [join, cb](const Status& st) {
+        bool done;
+        Status ret;
+        {
+          std::unique_lock<std::mutex> lock(join->mu);
+          if (!st.IsOk() && join->st.IsOk()) {
+            join->st = st;
+          }
+          done = --join->remaining == 0;
+          ret = join->st;
+        }
+        if (done) {
+          cb(ret);
+        }
+      });
+    }
+    return;
+  }
+
+  std::vector<Tensor> grads(var_names.size());
+  for (size_t g = 0; g < groups.size(); g++) {
+    std::vector<Tensor>& group_grads = dynamic_cast<WrapperData<std::vector<Tensor>>*>(data[g][0])->Internal();
+    for (size_t k = 0; k < groups[g].size(); k++) {
+      grads[groups[g][k]] = group_grads[k];
+    }
+    delete data[g][0];
+  }
+  for (size_t i = 0; i < var_names.size() && i < ids.size(); i++) {
+    EraseHashCache(var_names[i], ids[i]);
+  }
+  std::vector<int> codecs;
+  std::vector<int64_t> cols;
+  for (size_t j = 0; j < var_names.size(); j++) {
+    codecs.emplace_back();
+    cols.emplace_back();
+    CHECK_ASYNC(EncodeGradient(var_names[j], ids[j], &grads[j], &codecs.back(), &cols.back()));
+  }
+
+  std::vector<Data*> inputs = Args(ids, var_names, save_ratios, true, false, grads);
+  std::vector<MergedPartitioner*> splitter = {
+    new partitioner::MergedHashId,
+    new partitioner::MergedBroadcast,
+    new partitioner::MergedBroadcast,
+    new partitioner::MergedBroadcast,
+    new partitioner::MergedBroadcast,
+    new partitioner::MergedHashData
+  };
+  UdfData slices("BuildHashSlice", UdfData(0), UdfData(1), UdfData(2), UdfData(3), UdfData(4));
+  UdfData grad_input(5);
+  if (std::any_of(codecs.begin(), codecs.end(), [](int codec) { return codec != GradientCodec::kNone; })) {
+    inputs.push_back(Args(codecs)[0]);
+    inputs.push_back(Args(cols)[0]);
+    splitter.push_back(new partitioner::MergedBroadcast);
+    splitter.push_back(new partitioner::MergedBroadcast);
+    grad_input = UdfData("DecodeGradient", UdfData(5), UdfData(6), UdfData(7));
+  }
+  // every updater sees its own variables, the rest of its data are
+  // per variable hyperparameters broadcast to all servers
+  std::vector<UdfData> updates;
+  for (size_t g = 0; g < updaters.size(); g++) {
+    size_t group_index = inputs.size();
+    inputs.push_back(Args(groups[g])[0]);
+    splitter.push_back(new partitioner::MergedBroadcast);
+    std::vector<UdfData> udf_inputs = {
+      UdfData("SelectSlices", slices, UdfData(group_index)),
+      UdfData("SelectTensors", grad_input, UdfData(group_index))
+    };
+    for (size_t i = 1; i < data[g].size(); i++) {
+      udf_inputs.push_back(UdfData(inputs.size()));
+      inputs.push_back(data[g][i]);
+      splitter.push_back(new partitioner::MergedBroadcast);
+    }
+    updates.push_back(UdfData(updaters[g], udf_inputs));
+  }
+
+  std::vector<MergedPartitioner*> combiner = {};
+  std::vector<std::vector<std::unique_ptr<Data>>>* outputs =
+    new std::vector<std::vector<std::unique_ptr<Data>>>;
+  Callback realcb = [cb, outputs](const Status& st) {
+    std::unique_ptr<std::vector<std::vector<std::unique_ptr<Data>>>> deleter(outputs);
+    cb(st);
+  };
+
+  Process(UdfChain(updates), var_names, inputs, splitter,
+          combiner, outputs, realcb);
+}
+
 void Client::MergedHashStatis(const std::vector<std::string>& var_names,
                               const std::vector<Tensor>& ids,
                               const std::vector<float>& save_ratios,
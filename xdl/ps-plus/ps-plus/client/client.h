@@ -16,12 +16,21 @@ limitations under the License.
 #ifndef PS_PLUS_CLIENT_CLIENT_H_
 #define PS_PLUS_CLIENT_CLIENT_H_
 
+#include <atomic>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include "ps-plus/common/logging.h"
 #include "ps-plus/client/raw_client.h"
 #include "ps-plus/client/base_client.h"
+#include "ps-plus/client/hash_cache.h"
+#include "ps-plus/client/hot_id_router.h"
+#include "ps-plus/client/shared_id_merger.h"
+#include "ps-plus/client/gradient_accumulator.h"
+#include "ps-plus/client/gradient_residual.h"
+#include "ps-plus/common/gradient_codec.h"
 #include "ps-plus/common/tensor.h"
 
 
@@ -62,13 +71,27 @@ class Client: public BaseClient {
   }
 
   void Save(const std::string& name, const Callback& cb) override {
-    return raw_->Save(name, cb);
+    FlushGradients([this, name, cb](const Status& st) {
+      if (!st.IsOk()) {
+        cb(st);
+        return;
+      }
+      raw_->Save(name, cb);
+    });
   }
 
   void Restore(const std::string& name, const Callback& cb) override {
     return raw_->Restore(name, cb);
   }
 
+  void ResizeServers(int server_num, const Callback& cb) override {
+    return raw_->ResizeServers(server_num, cb);
+  }
+
+  void GetClusterStats(ClusterStats* result, const Callback& cb) override {
+    return raw_->GetClusterStats(result, cb);
+  }
+
   void TriggerStreamingModelDense(const std::string& stream_ver, const Callback& cb) override {
     return raw_->TriggerStreamingModelDense(stream_ver, cb);
   }
@@ -116,10 +139,12 @@ class Client: public BaseClient {
   }
 
   void AsynchronizeEnter(int id, int staleness, int worker_count, const Callback& cb) override {
+    EnterStep(staleness);
     raw_->AsynchronizeEnter(id, staleness, worker_count, cb);
   }
 
   void SynchronizeEnter(int id, int worker_count, const Callback& cb) override {
+    EnterStep(0);
     sync_mode_ = true;
     worker_count_ = worker_count;
     raw_->SynchronizeEnter(id, worker_count, &token_, cb);
@@ -130,7 +155,13 @@ class Client: public BaseClient {
   }
 
   void WorkerReportFinish(int id, const Callback& cb) override {
-    raw_->WorkerReportFinish(id, cb);        
+    FlushGradients([this, id, cb](const Status& st) {
+      if (!st.IsOk()) {
+        cb(st);
+        return;
+      }
+      raw_->WorkerReportFinish(id, cb);
+    });
   }
 
   void GetWorkerFinishCount(int64_t* count, const Callback& cb) {
@@ -207,12 +238,23 @@ class Client: public BaseClient {
                 const std::string& updater,
                 const std::vector<Data*>& data, 
                 const Callback& cb) override;
+  // Pushes the gradients HashPush accumulated for the variables setting
+  // VariableInfo::GRADIENT_ACCUMULATE_STEPS, with the other data of their
+  // last push. Save and WorkerReportFinish flush first.
+  void FlushGradients(const Callback& cb);
   void MergedHashPush(const std::vector<std::string>& var_names,
                       const std::vector<Tensor>& ids,
                       const std::vector<float>& save_ratios,                      
                       const std::string& updater,
                       const std::vector<Data*>& data,
                       const Callback& cb) override;
+  void MixedHashPush(const std::vector<std::string>& var_names,
+                     const std::vector<Tensor>& ids,
+                     const std::vector<float>& save_ratios,
+                     const std::vector<std::string>& updaters,
+                     const std::vector<std::vector<int64_t>>& groups,
+                     const std::vector<std::vector<Data*>>& data,
+                     const Callback& cb) override;
   void MergedHashStatis(const std::vector<std::string>& var_names,
                         const std::vector<Tensor>& ids,
                         const std::vector<float>& save_ratios,
@@ -229,11 +271,115 @@ class Client: public BaseClient {
     return raw_->GetVariableInfo(name, info);
   }
 
+  void HashPullRemote(const std::string& variable_name,
+                      const Tensor& ids,
+                      const float& save_ratio,
+                      Tensor* result,
+                      const Callback& cb);
+  void CachedHashPull(HashCache* cache,
+                      const std::string& variable_name,
+                      const Tensor& ids,
+                      const float& save_ratio,
+                      Tensor* result,
+                      const Callback& cb);
+  // The rows of a chunk of the dense variable, 0 when it is sent whole.
+  // Pushes are chunked in async mode only, for the updaters keeping no per
+  // call state and data of tensors by rows and copyable hyperparameters.
+  size_t DenseChunkRows(const std::string& name, const std::string& updater, const std::vector<Data*>& data);
+  void DensePullRemote(const std::string& variable_name,
+                       Tensor* result,
+                       const Callback& cb);
+  void ChunkedDensePull(const std::string& variable_name,
+                        size_t chunk_rows,
+                        Tensor* result,
+                        const Callback& cb);
+  void ChunkedDensePush(const std::string& variable_name,
+                        size_t chunk_rows,
+                        const std::string& updater,
+                        const std::vector<Data*>& data,
+                        const Callback& cb);
+  // nullptr unless the variable sets VariableInfo::HASH_CACHE_CAPACITY
+  HashCache* GetHashCache(const std::string& name);
+  void EraseHashCache(const std::string& name, const Tensor& ids);
+  void EnterStep(int64_t staleness);
+
+  struct GradientCodecState {
+    GradientCodec codec;
+    // error feedback of topk, the other codecs lose too little to keep it
+    std::unique_ptr<GradientResidual> residual;
+  };
+  Status GetGradientCodec(const std::string& name, GradientCodecState** state);
+  // Encodes a float gradient row by row with the codec of the variable,
+  // codec is kNone when it is sent as is.
+  Status EncodeGradient(const std::string& name, const Tensor& ids, Tensor* grad, int* codec, int64_t* cols);
+
+  struct GradientAccumulateState {
+    GradientAccumulateState(size_t steps, size_t max_bytes, bool mean)
+      : buffer(steps, max_bytes, mean) {}
+    std::mutex mu;
+    GradientAccumulator buffer;
+    // the push the buffer was last added by, FlushGradients sends its data
+    // besides the gradient
+    float save_ratio = 0;
+    bool insertable = false;
+    std::string updater;
+    std::vector<std::unique_ptr<Data>> args;
+  };
+  // nullptr unless the variable sets VariableInfo::GRADIENT_ACCUMULATE_STEPS
+  // above 1
+  GradientAccumulateState* GetGradientAccumulator(const std::string& name);
+  void HashPushRemote(const std::string& variable_name,
+                      const Tensor& ids,
+                      const float& save_ratio,
+                      const bool& insertable,
+                      const std::string& updater,
+                      const std::vector<Data*>& data,
+                      const Callback& cb);
+  void MergedHashPullRemote(const std::vector<std::string>& var_names,
+                            const std::vector<Tensor>& ids,
+                            const std::vector<float>& save_ratios,
+                            std::vector<Tensor>* result,
+                            const Callback& cb);
+  void MergedHashPushRemote(const std::vector<std::string>& var_names,
+                            const std::vector<Tensor>& ids,
+                            const std::vector<float>& save_ratios,
+                            const std::string& updater,
+                            const std::vector<Data*>& data,
+                            const Callback& cb);
+  // The data of a push merged by merger, false when one of the per variable
+  // data can't be merged. The merged data are owned by the caller.
+  bool MergeSharedData(const SharedIdMerger& merger, const std::vector<Data*>& data, std::vector<Data*>* merged);
+  // nullptr unless the variable sets VariableInfo::HOT_ID_REPLICAS above 1,
+  // replicas are not kept in sync mode
+  HotIdRouter* GetHotIdRouter(const std::string& name);
+  // The id splitter of a hash pull or push, routing the replicated ids of the
+  // router if any
+  Partitioner* HashIdSplitter(HotIdRouter* router, const Tensor& ids, bool push, std::vector<size_t>* promote);
+  // Assigns the pulled rows of the promoted ids to their replicas
+  void SeedReplicas(HotIdRouter* router,
+                    const std::string& variable_name,
+                    const Tensor& ids,
+                    const Tensor& rows,
+                    const std::vector<size_t>& promote,
+                    const float& save_ratio);
+
  private:
   std::unique_ptr<RawClient> raw_;
   bool sync_mode_ = false;
   int worker_count_ = -1;
   int64_t token_ = -1;  
+  std::mutex hash_cache_mu_;
+  // null for variables without cache
+  std::unordered_map<std::string, std::unique_ptr<HashCache>> hash_caches_;
+  std::unordered_map<std::string, std::unique_ptr<GradientCodecState>> gradient_codecs_;
+  // null for variables without accumulation
+  std::unordered_map<std::string, std::unique_ptr<GradientAccumulateState>> gradient_accumulators_;
+  // null for variables without replicas
+  std::unordered_map<std::string, std::unique_ptr<HotIdRouter>> hot_id_routers_;
+  std::atomic<size_t> hot_id_salt_{0};
+  std::atomic<int64_t> step_{0};
+  // the staleness of the last step entered, -1 before any
+  int64_t step_staleness_ = -1;
 };
 
 } //namespace client
@@ -23,6 +23,7 @@ limitations under the License.
 #include "ps-plus/client/merged_partitioner.h"
 #include "ps-plus/common/tensor.h"
 #include "ps-plus/message/worker_state.h"
+#include "ps-plus/message/variable_stats.h"
 #include <vector>
 #include <functional>
 
@@ -33,6 +34,15 @@ class ClientWrapper {
  public:
   using Callback = std::function<void (const Status&)>;
 
+  // One Process call carried by BatchProcess.
+  struct ProcessItem {
+    std::string var_name;
+    size_t udf_id;
+    std::vector<Data*> input;
+    std::vector<Data*>* output;
+    Callback cb;
+  };
+
   virtual ~ClientWrapper() {}
 
   // Change Internal cluster version.
@@ -42,9 +52,23 @@ class ClientWrapper {
   virtual void UpdateVariableInfo(const std::vector<VariableInfo>& input, std::vector<VariableInfo>* output, const Callback& cb) = 0;
   virtual void UpdateVariableVisitInfo(const std::string& name, int64_t id_num, const Callback& cb) = 0;
   virtual void Process(const std::string& var_name, size_t server_id, size_t udf_id, const std::vector<Data*>& input, std::vector<Data*>* output, const Callback& cb) = 0;
+  // Send several Process calls to one server in a single request,
+  // every item's cb is run with the status of that item.
+  virtual void BatchProcess(size_t server_id, const std::vector<ProcessItem>& items) {
+    for (auto& item : items) {
+      Process(item.var_name, server_id, item.udf_id, item.input, item.output, item.cb);
+    }
+  }
+  // A Process call that only reads, it may be answered by one of the read
+  // replicas of server_id instead of the primary.
+  virtual void ReadProcess(const std::string& var_name, size_t server_id, size_t udf_id, const std::vector<Data*>& input, std::vector<Data*>* output, const Callback& cb) {
+    Process(var_name, server_id, udf_id, input, output, cb);
+  }
   virtual void RegisterUdf(size_t server_id, const UdfChain& def, const Callback& cb) = 0;
   virtual void Save(const std::string& version, const Callback& cb) = 0;
   virtual void Restore(const std::string& version, const Callback& cb) = 0;
+  virtual void ResizeServers(int server_num, const Callback& cb) = 0;
+  virtual void GetClusterStats(ClusterStats* result, const Callback& cb) = 0;
   virtual Status InitGlobalQueue(const std::string& name, const std::vector<std::string>& paths, size_t epochs, bool epoch_isolate = false) = 0;
   virtual Status GetNextFile(const std::string& name, size_t worker_id, std::string* path, size_t* begin, size_t* epoch) = 0;
   virtual Status ReportWorkerState(const std::string& name, size_t worker_id, const std::vector<WorkerState>& worker_states) = 0;
@@ -16,6 +16,9 @@ limitations under the License.
 #include "ps-plus/common/status.h"
 #include "ps-plus/client/client_wrapper_impl.h"
 #include "ps-plus/common/reliable_kv.h"
+#include "ps-plus/common/tracer.h"
+#include <algorithm>
+#include <cstdlib>
 #include <future>
 #include <iostream>
 
@@ -141,6 +144,27 @@ void ClientWrapperImpl::Process(const std::string& var_name,
                                 const std::vector<Data*>& input, 
                                 std::vector<Data*>* output, 
                                 const Callback& cb) {
+  ProcessOn(server_id + offset_[0], var_name, udf_id, input, output, cb);
+}
+
+void ClientWrapperImpl::ReadProcess(const std::string& var_name, 
+                                    size_t server_id, 
+                                    size_t udf_id, 
+                                    const std::vector<Data*>& input, 
+                                    std::vector<Data*>* output, 
+                                    const Callback& cb) {
+  size_t replicas = server_id < replicas_.size() ? replicas_[server_id] : 0;
+  size_t pick = replicas == 0 ? 0 : read_round_++ % (replicas + 1);
+  size_t connection = pick == 0 ? server_id + offset_[0] : ReplicaConnection(server_id, pick);
+  ProcessOn(connection, var_name, udf_id, input, output, cb);
+}
+
+void ClientWrapperImpl::ProcessOn(size_t connection,
+                                  const std::string& var_name, 
+                                  size_t udf_id, 
+                                  const std::vector<Data*>& input, 
+                                  std::vector<Data*>* output, 
+                                  const Callback& cb) {
   std::vector<Data*> request_datas;
   
   WrapperData<Version>* version_data = new WrapperData<Version>(scheduler_version_); 
@@ -152,12 +176,24 @@ void ClientWrapperImpl::Process(const std::string& var_name,
   WrapperData<std::string>* var_data = new WrapperData<std::string>(var_name);
   request_datas.push_back(var_data);
 
+  // a traced request carries the (trace id, span id) of its rpc span
+  int func_id = func_ids::kServerProcess;
+  WrapperData<std::vector<int64_t> >* trace_data = nullptr;
+  ps::common::TraceContext trace = ps::common::Tracer::Current();
+  if (trace.Traced()) {
+    func_id = func_ids::kServerTracedProcess;
+    trace_data = new WrapperData<std::vector<int64_t> >(
+        std::vector<int64_t>{(int64_t)trace.trace_id, (int64_t)trace.span_id});
+    request_datas.push_back(trace_data);
+  }
+
   request_datas.insert(request_datas.end(), input.begin(), input.end());
-  CallBackClosure* cb_closure = new CallBackClosure([this, output, cb, var_name, server_id, udf_id, 
-						     version_data, udf_data, var_data](const SeastarStatus& sst, const std::vector<Data*>& response) {
+  CallBackClosure* cb_closure = new CallBackClosure([output, cb,
+						     version_data, udf_data, var_data, trace_data](const SeastarStatus& sst, const std::vector<Data*>& response) {
     std::unique_ptr<WrapperData<Version>> version_deleter(version_data);
     std::unique_ptr<WrapperData<size_t>> udf_deleter(udf_data);
     std::unique_ptr<WrapperData<std::string> > var_deleter(var_data);
+    std::unique_ptr<WrapperData<std::vector<int64_t> > > trace_deleter(trace_data);
     Status st = GetNetworkStatus(sst, response);
     if (!st.IsOk()) {
       cb(st);
@@ -167,7 +203,69 @@ void ClientWrapperImpl::Process(const std::string& var_name,
     cb(Status::Ok());
   });
 
-  client_lib_->Request(server_id + offset_[0], func_ids::kServerProcess, request_datas, cb_closure, false);
+  client_lib_->Request(connection, func_id, request_datas, cb_closure, false);
+}
+
+void ClientWrapperImpl::BatchProcess(size_t server_id,
+                                     const std::vector<ProcessItem>& items) {
+  std::vector<Data*> request_datas;
+
+  WrapperData<Version>* version_data = new WrapperData<Version>(scheduler_version_); 
+  request_datas.push_back(version_data);
+
+  // (udf_id, input size) for every item
+  WrapperData<std::vector<int64_t> >* header_data = new WrapperData<std::vector<int64_t> >();
+  request_datas.push_back(header_data);
+
+  WrapperData<std::vector<std::string> >* var_data = new WrapperData<std::vector<std::string> >();
+  request_datas.push_back(var_data);
+
+  for (auto& item : items) {
+    header_data->Internal().push_back((int64_t)item.udf_id);
+    header_data->Internal().push_back(item.input.size());
+    var_data->Internal().push_back(item.var_name);
+    request_datas.insert(request_datas.end(), item.input.begin(), item.input.end());
+  }
+
+  CallBackClosure* cb_closure = new CallBackClosure([items, version_data, header_data, var_data]
+                                                    (const SeastarStatus& sst, const std::vector<Data*>& response) {
+    std::unique_ptr<WrapperData<Version>> version_deleter(version_data);
+    std::unique_ptr<WrapperData<std::vector<int64_t> > > header_deleter(header_data);
+    std::unique_ptr<WrapperData<std::vector<std::string> > > var_deleter(var_data);
+    Status st = GetNetworkStatus(sst, response);
+    WrapperData<std::vector<int64_t> >* counts = nullptr;
+    if (st.IsOk()) {
+      counts = response.size() < 2 ? nullptr : dynamic_cast<WrapperData<std::vector<int64_t> >*>(response[1]);
+      if (counts == nullptr || counts->Internal().size() != items.size()) {
+        st = Status::ArgumentError("BatchProcess: Response should carry the output size of every item");
+      }
+    }
+    if (!st.IsOk()) {
+      for (auto& item : items) {
+        item.cb(st);
+      }
+      return;
+    }
+    size_t offset = 2;
+    for (size_t i = 0; i < items.size(); i++) {
+      size_t count = counts->Internal()[i];
+      if (offset + count > response.size()) {
+        items[i].cb(Status::ArgumentError("BatchProcess: Response is truncated"));
+        continue;
+      }
+      std::vector<Data*> item_response(response.begin() + offset, response.begin() + offset + count);
+      offset += count;
+      Status item_st = GetNetworkStatus(sst, item_response);
+      if (!item_st.IsOk()) {
+        items[i].cb(item_st);
+        continue;
+      }
+      (*items[i].output) = std::vector<Data*>(item_response.begin() + 1, item_response.end());
+      items[i].cb(Status::Ok());
+    }
+  });
+
+  client_lib_->Request(server_id + offset_[0], func_ids::kServerBatchProcess, request_datas, cb_closure, false);
 }
 
 void ClientWrapperImpl::RegisterUdf(size_t server_id, const UdfChain& def, const Callback& cb) {
@@ -180,11 +278,49 @@ void ClientWrapperImpl::RegisterUdf(size_t server_id, const UdfChain& def, const
 
   request_datas.push_back(udf_data);
 
-  CallBackClosure* cb_closure = new CallBackClosure([cb](const SeastarStatus& sst, const std::vector<Data*>& response) {
-    cb(GetNetworkStatus(sst, response));
-  });
+  size_t replicas = server_id < replicas_.size() ? replicas_[server_id] : 0;
+  if (replicas == 0) {
+    CallBackClosure* cb_closure = new CallBackClosure([cb](const SeastarStatus& sst, const std::vector<Data*>& response) {
+      cb(GetNetworkStatus(sst, response));
+    });
+    client_lib_->Request(server_id + offset_[0], func_ids::kServerRegisterUdfChain, request_datas, cb_closure);
+    return;
+  }
+
+  // Reads are spread over the replicas, so they all need the chain.
+  struct Collect {
+    std::mutex mu;
+    size_t count_down;
+    Status st;
+  };
+  std::shared_ptr<Collect> collect(new Collect);
+  collect->count_down = replicas + 1;
+  for (size_t i = 0; i <= replicas; i++) {
+    std::vector<Data*> datas = {
+      new WrapperData<Version>(scheduler_version_),
+      new WrapperData<UdfChainRegister>(udf_data->Internal())
+    };
+    CallBackClosure* cb_closure = new CallBackClosure([cb, collect](const SeastarStatus& sst, const std::vector<Data*>& response) {
+      Status st = GetNetworkStatus(sst, response);
+      std::unique_lock<std::mutex> lock(collect->mu);
+      if (!st.IsOk() && collect->st.IsOk()) {
+        collect->st = st;
+      }
+      if (--collect->count_down == 0) {
+        lock.unlock();
+        cb(collect->st);
+      }
+    });
+    client_lib_->Request(i == 0 ? server_id + offset_[0] : ReplicaConnection(server_id, i),
+                         func_ids::kServerRegisterUdfChain, datas, cb_closure);
+  }
+  for (auto data : request_datas) {
+    delete data;
+  }
+}
 
-  client_lib_->Request(server_id + offset_[0], func_ids::kServerRegisterUdfChain, request_datas, cb_closure);
+size_t ClientWrapperImpl::ReplicaConnection(size_t server_id, size_t replica) {
+  return offset_.back() + (replica - 1) * replicas_.size() + server_id;
 }
 
 void ClientWrapperImpl::Save(const std::string& version, const Callback& cb) {
@@ -200,6 +336,46 @@ void ClientWrapperImpl::Save(const std::string& version, const Callback& cb) {
   client_lib_->Request(0, func_ids::kSchedulerSave, request_datas, cb_closure);
 }
 
+void ClientWrapperImpl::ResizeServers(int server_num, const Callback& cb) {
+  std::vector<Data*> request_datas = {
+    new WrapperData<Version>(scheduler_version_),
+    new WrapperData<int>(server_num)
+  };
+
+  CallBackClosure* cb_closure = new CallBackClosure([cb](const SeastarStatus& sst, const std::vector<Data*>& response) {
+    cb(GetNetworkStatus(sst, response));
+  });
+
+  client_lib_->Request(0, func_ids::kSchedulerResizeServers, request_datas, cb_closure);
+}
+
+void ClientWrapperImpl::GetClusterStats(ClusterStats* result, const Callback& cb) {
+  std::vector<Data*> request_datas = {
+    new WrapperData<Version>(scheduler_version_)
+  };
+
+  CallBackClosure* cb_closure = new CallBackClosure([result, cb](const SeastarStatus& sst, const std::vector<Data*>& response) {
+    Status st = GetNetworkStatus(sst, response);
+    if (!st.IsOk()) {
+      cb(st);
+      return;
+    }
+    if (response.size() != 2) {
+      cb(Status::Unknown("GetClusterStats Protocol Error"));
+      return;
+    }
+    WrapperData<ClusterStats>* stats = dynamic_cast<WrapperData<ClusterStats>*>(response[1]);
+    if (stats == nullptr) {
+      cb(Status::Unknown("GetClusterStats Protocol Error"));
+      return;
+    }
+    *result = stats->Internal();
+    cb(Status::Ok());
+  });
+
+  client_lib_->Request(0, func_ids::kSchedulerGetClusterStats, request_datas, cb_closure);
+}
+
 void ClientWrapperImpl::Restore(const std::string& version, const Callback& cb) {
   std::vector<Data*> request_datas = {
     new WrapperData<Version>(scheduler_version_),
@@ -260,45 +436,71 @@ Status ClientWrapperImpl::GetNextFile(
     std::string* path, 
     size_t* begin, 
     size_t* epoch) {
-  std::vector<Data*> request_datas = {
-    new WrapperData<Version>(scheduler_version_),
-    new WrapperData<std::string>(name),
-    new WrapperData<size_t>(worker_id)
-  };
+  // the files are leased file_lease_size a request, the rest are returned
+  // from the lease, which the scheduler restores as the files got
+  static const size_t lease_size = std::getenv("file_lease_size") == nullptr ?
+    8 : std::max(atoi(std::getenv("file_lease_size")), 1);
+  std::string key = name + "^" + std::to_string(worker_id);
+  std::unique_lock<std::mutex> lock(lease_mu_);
+  std::deque<WorkerState>& lease = file_leases_[key];
+  if (lease.empty()) {
+    std::vector<Data*> request_datas = {
+      new WrapperData<Version>(scheduler_version_),
+      new WrapperData<std::string>(name),
+      new WrapperData<size_t>(worker_id),
+      new WrapperData<size_t>(lease_size)
+    };
+
+    std::promise<Status> p;
+    CallBackClosure* cb_closure = 
+      new CallBackClosure([&p, &lease](
+                              const SeastarStatus& sst, 
+                              const std::vector<Data*>& response) {
+      Status st = GetNetworkStatus(sst, response);
+      if (!st.IsOk()) {
+        p.set_value(st);
+        return;
+      }
 
-  std::promise<Status> p;
-  CallBackClosure* cb_closure = 
-    new CallBackClosure([&p, path, begin, epoch, this](
-                            const SeastarStatus& sst, 
-                            const std::vector<Data*>& response) {
-    Status st = GetNetworkStatus(sst, response);
-    if (!st.IsOk()) {
-      p.set_value(st);
-      return;
-    }
+      if (response.size() % 3 != 1) {
+        p.set_value(Status::Unknown("response data not match"));
+        return;
+      }
 
-    if (response.size() != 4) {
-      p.set_value(Status::Unknown("response data not match"));
-      return;
-    }
+      for (size_t i = 1; i < response.size(); i += 3) {
+        WrapperData<std::string>* path_data = dynamic_cast<WrapperData<std::string>* >(response[i]);
+        WrapperData<size_t>* begin_data = dynamic_cast<WrapperData<size_t>* >(response[i + 1]);    
+        WrapperData<size_t>* epoch_data = dynamic_cast<WrapperData<size_t>* >(response[i + 2]);    
+        if (path_data == nullptr || begin_data == nullptr || epoch_data == nullptr) {
+          lease.clear();
+          p.set_value(Status::Unknown("reponse data type not match"));
+          return;
+        }
+
+        WorkerState ws;
+        ws.path_ = path_data->Internal();
+        ws.begin_ = begin_data->Internal();
+        ws.epoch_ = epoch_data->Internal();
+        lease.push_back(ws);
+      }
 
-    WrapperData<std::string>* path_data = dynamic_cast<WrapperData<std::string>* >(response[1]);
-    WrapperData<size_t>* begin_data = dynamic_cast<WrapperData<size_t>* >(response[2]);    
-    WrapperData<size_t>* epoch_data = dynamic_cast<WrapperData<size_t>* >(response[3]);    
-    if (path_data == nullptr || begin_data == nullptr || epoch_data == nullptr) {
-      p.set_value(Status::Unknown("reponse data type not match"));
-      return;
-    }
+      p.set_value(Status::Ok());
+    });
 
-    *path = path_data->Internal();
-    *begin = begin_data->Internal();
-    *epoch = epoch_data->Internal();
-    p.set_value(Status::Ok());
-  });
+    client_lib_->Request(0, func_ids::kSchedulerGetNextFile,
+                         request_datas, cb_closure);
+    PS_CHECK_STATUS(p.get_future().get());
+    if (lease.empty()) {
+      path->clear();
+      return Status::Ok();
+    }
+  }
 
-  client_lib_->Request(0, func_ids::kSchedulerGetNextFile,
-                       request_datas, cb_closure);
-  return p.get_future().get();
+  *path = lease.front().path_;
+  *begin = lease.front().begin_;
+  *epoch = lease.front().epoch_;
+  lease.pop_front();
+  return Status::Ok();
 }
 
 Status ClientWrapperImpl::ReportWorkerState(
@@ -328,6 +530,12 @@ Status ClientWrapperImpl::ReportWorkerState(
 Status ClientWrapperImpl::RestoreWorkerState(
     const std::string& name,
     size_t worker_id) {
+  {
+    // the scheduler leases the files again
+    std::unique_lock<std::mutex> lock(lease_mu_);
+    file_leases_.erase(name + "^" + std::to_string(worker_id));
+  }
+
   std::vector<Data*> request_datas = {
     new WrapperData<Version>(scheduler_version_),
     new WrapperData<std::string>(name),
@@ -662,8 +870,17 @@ Status ClientWrapperImpl::ConnectToServers() {
   for (auto item : info.server_size_) {
     offset_.push_back(offset_.back() + item);
   }
+  replicas_.assign(info.server_size_.empty() ? 0 : info.server_size_[0], 0);
+  for (auto&& item : info.GetServers()) {
+    if (item.GetReplica() != 0 && item.GetId() < replicas_.size()) {
+      replicas_[item.GetId()] = std::max(replicas_[item.GetId()], item.GetReplica());
+    }
+  }
   for (auto&& item : info.GetServers()) {
-    if (!client_lib_->Connect(offset_[item.GetServerType()] + item.GetId(), item.GetIp() + ":" + std::to_string(item.GetPort()))) {
+    size_t connection = item.GetReplica() == 0
+        ? offset_[item.GetServerType()] + item.GetId()
+        : ReplicaConnection(item.GetId(), item.GetReplica());
+    if (!client_lib_->Connect(connection, item.GetIp() + ":" + std::to_string(item.GetPort()))) {
       return Status::NetworkError(
           "Server[" + std::to_string(item.GetServerType()) + "][" + std::to_string(item.GetId()) + "] Connect Failed "
           + item.GetIp() + ":" + std::to_string(item.GetPort()));
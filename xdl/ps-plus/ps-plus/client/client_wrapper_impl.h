@@ -20,10 +20,18 @@ limitations under the License.
 #include "ps-plus/service/seastar/lib/seastar_client_lib.h"
 #include "ps-plus/service/seastar/lib/event_client_lib.h"
 #include "ps-plus/service/seastar/lib/callback_closure.h"
+#include "ps-plus/service/shm/lib/shm_client_lib.h"
+#ifdef USE_RDMA
+#include "ps-plus/service/rdma/lib/rdma_client_lib.h"
+#endif
 #include "ps-plus/message/version.h"
 #include "ps-plus/message/cluster_info.h"
 #include "ps-plus/message/func_ids.h"
 
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+
 namespace ps {
 namespace client {
 
@@ -34,9 +42,13 @@ class ClientWrapperImpl : public ClientWrapper {
   void UpdateVariableInfo(const std::vector<VariableInfo>& input, std::vector<VariableInfo>* output, const Callback& cb) override;
   void UpdateVariableVisitInfo(const std::string& name, int64_t id_num, const Callback& cb) override;
   void Process(const std::string& var_name, size_t server_id, size_t udf_id, const std::vector<Data*>& input, std::vector<Data*>* output, const Callback& cb) override;
+  void BatchProcess(size_t server_id, const std::vector<ProcessItem>& items) override;
+  void ReadProcess(const std::string& var_name, size_t server_id, size_t udf_id, const std::vector<Data*>& input, std::vector<Data*>* output, const Callback& cb) override;
   void RegisterUdf(size_t server_id, const UdfChain& def, const Callback& cb) override;
   void Save(const std::string& version, const Callback& cb) override;
   void Restore(const std::string& version, const Callback& cb) override;
+  void ResizeServers(int server_num, const Callback& cb) override;
+  void GetClusterStats(ClusterStats* result, const Callback& cb) override;
   Status InitGlobalQueue(const std::string& name, const std::vector<std::string>& paths, size_t epochs, bool epoch_isolate = false) override;
   Status GetNextFile(const std::string& name, size_t worker_id, std::string* path, size_t* begin, size_t* epoch) override;
   Status ReportWorkerState(const std::string& name, size_t worker_id, const std::vector<WorkerState>& worker_states) override;
@@ -57,19 +69,32 @@ class ClientWrapperImpl : public ClientWrapper {
   int ServerTypeSize() override;
 
   //using ClientLib = ps::service::seastar::SeastarClientLib;
-  using ClientLib = ps::service::seastar::EventClientLib;
+#ifdef USE_RDMA
+  using ClientLib = ps::service::shm::ShmClientLib<ps::service::rdma::RdmaClientLib>;
+#else
+  using ClientLib = ps::service::shm::ShmClientLib<ps::service::seastar::EventClientLib>;
+#endif
  private:
   Status CreateServerLib();
   Status ConnectToScheduler(const std::string& addr);
   Status WaitForReady();
   Status ConnectToServers();
+  // Connection ids of the replicas follow the ones of all servers.
+  size_t ReplicaConnection(size_t server_id, size_t replica);
+  void ProcessOn(size_t connection, const std::string& var_name, size_t udf_id, const std::vector<Data*>& input, std::vector<Data*>* output, const Callback& cb);
 
   ClientLib* client_lib_;
   Version scheduler_version_;
 
   static ClientLib* client_lib_singleton_;
   std::vector<size_t> offset_;
+  // replica count of every type 0 server
+  std::vector<size_t> replicas_;
+  std::atomic<size_t> read_round_{0};
   std::mutex mu_;
+  // the files leased by GetNextFile, keyed by the queue name and worker id
+  std::unordered_map<std::string, std::deque<WorkerState> > file_leases_;
+  std::mutex lease_mu_;
 };
 
 } //namespace client
@@ -0,0 +1,126 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/client/gradient_accumulator.h"
+#include "ps-plus/common/initializer/none_initializer.h"
+
+#include <cstring>
+
+namespace ps {
+namespace client {
+
+namespace {
+
+// the bookkeeping of an id besides its row, the index entry is counted as
+// a few pointers
+const size_t kIdBytes = sizeof(HashCache::Key) * 2 + sizeof(int64_t) + 4 * sizeof(void*);
+
+}
+
+Status GradientAccumulator::Add(const Tensor& ids, const Tensor& grad, bool* full) {
+  if (grad.Type() != DataType::kFloat || grad.Shape().IsScalar() || ids.Shape().IsScalar()) {
+    return Status::ArgumentError("GradientAccumulator: float gradient rows required");
+  }
+  size_t rows = ids.Shape()[0];
+  if (grad.Shape()[0] != rows) {
+    return Status::ArgumentError("GradientAccumulator: gradient rows mismatch with ids");
+  }
+  std::vector<size_t> row_dims(grad.Shape().Dims().begin() + 1, grad.Shape().Dims().end());
+  bool hash128 = ids.Shape().Size() == 2;
+  if (keys_.empty()) {
+    id_type_ = ids.Type();
+    hash128_ = hash128;
+    row_dims_ = row_dims;
+    cols_ = rows == 0 ? 0 : grad.Shape().NumElements() / rows;
+  } else if (id_type_ != ids.Type() || hash128_ != hash128 || row_dims_ != row_dims) {
+    return Status::ArgumentError("GradientAccumulator: ids or gradient shape changed between pushes");
+  }
+  const float* raw_grad = grad.Raw<float>();
+  CASES(ids.Type(), do {
+    T* raw_ids = ids.Raw<T>();
+    for (size_t i = 0; i < rows; i++) {
+      HashCache::Key key;
+      key.x = hash128 ? raw_ids[i * 2] : raw_ids[i];
+      key.y = hash128 ? raw_ids[i * 2 + 1] : 0;
+      auto iter = index_.find(key);
+      size_t index;
+      if (iter == index_.end()) {
+        index = keys_.size();
+        index_[key] = index;
+        keys_.push_back(key);
+        counts_.push_back(0);
+        sums_.resize(sums_.size() + cols_, 0);
+      } else {
+        index = iter->second;
+      }
+      counts_[index]++;
+      float* sum = &sums_[index * cols_];
+      const float* row = raw_grad + i * cols_;
+      for (size_t j = 0; j < cols_; j++) {
+        sum[j] += row[j];
+      }
+    }
+  } while(0));
+  pushes_++;
+  *full = pushes_ >= steps_ || Bytes() > max_bytes_;
+  return Status::Ok();
+}
+
+void GradientAccumulator::Take(Tensor* ids, Tensor* grad) {
+  size_t rows = keys_.size();
+  std::vector<size_t> id_dims = {rows};
+  if (hash128_) {
+    id_dims.push_back(2);
+  }
+  std::vector<size_t> grad_dims = {rows};
+  grad_dims.insert(grad_dims.end(), row_dims_.begin(), row_dims_.end());
+  *ids = Tensor(id_type_, TensorShape(id_dims), new initializer::NoneInitializer);
+  *grad = Tensor(DataType::kFloat, TensorShape(grad_dims), new initializer::NoneInitializer);
+  CASES(id_type_, do {
+    T* raw_ids = ids->Raw<T>();
+    for (size_t i = 0; i < rows; i++) {
+      if (hash128_) {
+        raw_ids[i * 2] = keys_[i].x;
+        raw_ids[i * 2 + 1] = keys_[i].y;
+      } else {
+        raw_ids[i] = keys_[i].x;
+      }
+    }
+  } while(0));
+  float* raw_grad = grad->Raw<float>();
+  if (rows > 0) {
+    memcpy(raw_grad, &sums_[0], rows * cols_ * sizeof(float));
+  }
+  if (mean_) {
+    for (size_t i = 0; i < rows; i++) {
+      float scale = 1.0f / counts_[i];
+      for (size_t j = 0; j < cols_; j++) {
+        raw_grad[i * cols_ + j] *= scale;
+      }
+    }
+  }
+  index_.clear();
+  keys_.clear();
+  counts_.clear();
+  sums_.clear();
+  pushes_ = 0;
+}
+
+size_t GradientAccumulator::Bytes() const {
+  return keys_.size() * (kIdBytes + cols_ * sizeof(float));
+}
+
+} //namespace client
+} //namespace ps
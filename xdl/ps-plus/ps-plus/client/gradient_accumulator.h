@@ -0,0 +1,71 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_CLIENT_GRADIENT_ACCUMULATOR_H_
+#define PS_PLUS_CLIENT_GRADIENT_ACCUMULATOR_H_
+
+#include "ps-plus/client/hash_cache.h"
+#include "ps-plus/common/status.h"
+#include "ps-plus/common/tensor.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace ps {
+namespace client {
+
+// Sums the hash gradients of a variable pushed over several steps, an id
+// pushed by each of them is sent once per flush. The buffer is full after
+// steps pushes or when it holds more than max_bytes.
+//
+// The updater sees one step per flush. That is exact for sgd with the sum,
+// while adagrad, momentum, adam and the other updaters keeping per step
+// state see a single larger batch: their state advances once per flush and
+// the learning rate applies to the sum, or to the mean of the steps an id
+// was pushed by when mean is set. Not thread safe, the caller locks it.
+class GradientAccumulator {
+ public:
+  GradientAccumulator(size_t steps, size_t max_bytes, bool mean)
+    : steps_(steps), max_bytes_(max_bytes), mean_(mean) {}
+
+  // Adds the float rows of grad, one per id. full is set when the buffer
+  // should be taken, the rows are always added.
+  Status Add(const Tensor& ids, const Tensor& grad, bool* full);
+  // The buffered ids in the order first pushed and their summed (or mean)
+  // gradients, the buffer is emptied.
+  void Take(Tensor* ids, Tensor* grad);
+
+  bool Empty() const { return keys_.empty(); }
+  size_t Bytes() const;
+
+ private:
+  size_t steps_;
+  size_t max_bytes_;
+  bool mean_;
+  size_t pushes_ = 0;
+  DataType id_type_ = DataType::kInt64;
+  bool hash128_ = false;
+  std::vector<size_t> row_dims_;
+  size_t cols_ = 0;
+  std::unordered_map<HashCache::Key, size_t, HashCache::KeyHash> index_;
+  std::vector<HashCache::Key> keys_;
+  std::vector<int64_t> counts_;
+  std::vector<float> sums_;
+};
+
+} //namespace client
+} //namespace ps
+
+#endif
@@ -0,0 +1,55 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/client/gradient_residual.h"
+#include "ps-plus/common/initializer/none_initializer.h"
+
+#include <cstring>
+
+namespace ps {
+namespace client {
+
+void GradientResidual::Apply(const std::vector<HashCache::Key>& keys, const Tensor& grad, Tensor* result) {
+  *result = Tensor(grad.Type(), grad.Shape(), new initializer::NoneInitializer);
+  size_t cols = keys.empty() ? 0 : grad.Shape().NumElements() / keys.size();
+  memcpy(result->Raw<float>(), grad.Raw<float>(), keys.size() * cols * sizeof(float));
+  for (size_t i = 0; i < keys.size(); i++) {
+    Shard& shard = GetShard(keys[i]);
+    std::lock_guard<std::mutex> lock(shard.mu);
+    auto iter = shard.rows.find(keys[i]);
+    if (iter == shard.rows.end()) {
+      continue;
+    }
+    float* row = result->Raw<float>() + i * cols;
+    for (size_t j = 0; j < cols && j < iter->second.size(); j++) {
+      row[j] += iter->second[j];
+    }
+    shard.rows.erase(iter);
+  }
+}
+
+void GradientResidual::Store(const std::vector<HashCache::Key>& keys, const Tensor& residual) {
+  size_t cols = keys.empty() ? 0 : residual.Shape().NumElements() / keys.size();
+  for (size_t i = 0; i < keys.size(); i++) {
+    const float* row = residual.Raw<float>() + i * cols;
+    Shard& shard = GetShard(keys[i]);
+    std::lock_guard<std::mutex> lock(shard.mu);
+    shard.rows[keys[i]].assign(row, row + cols);
+  }
+}
+
+} //namespace client
+} //namespace ps
+
@@ -0,0 +1,53 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_CLIENT_GRADIENT_RESIDUAL_H_
+#define PS_PLUS_CLIENT_GRADIENT_RESIDUAL_H_
+
+#include "ps-plus/client/hash_cache.h"
+#include "ps-plus/common/tensor.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace ps {
+namespace client {
+
+// Error feedback of a lossy gradient codec: what the push of an id lost is
+// added to the next gradient pushed for it.
+class GradientResidual {
+ public:
+  // result is grad plus the residual of every id, the residuals are taken.
+  void Apply(const std::vector<HashCache::Key>& keys, const Tensor& grad, Tensor* result);
+  void Store(const std::vector<HashCache::Key>& keys, const Tensor& residual);
+
+ private:
+  static const size_t kShards = 16;
+  struct Shard {
+    std::mutex mu;
+    std::unordered_map<HashCache::Key, std::vector<float>, HashCache::KeyHash> rows;
+  };
+  Shard& GetShard(const HashCache::Key& key) {
+    return shards_[(HashCache::KeyHash()(key) >> 32) % kShards];
+  }
+  Shard shards_[kShards];
+};
+
+} //namespace client
+} //namespace ps
+
+#endif
+
@@ -0,0 +1,103 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/client/hash_cache.h"
+#include "ps-plus/common/logging.h"
+
+#include <cstring>
+
+namespace ps {
+namespace client {
+
+HashCache::HashCache(const std::string& name, size_t capacity, int64_t staleness, size_t row_bytes)
+  : name_(name), shard_capacity_((capacity + kShards - 1) / kShards),
+    staleness_(staleness), row_bytes_(row_bytes), hits_(0), misses_(0) {
+}
+
+void HashCache::LimitStaleness(int64_t staleness) {
+  int64_t current = staleness_.load();
+  while (staleness < current && !staleness_.compare_exchange_weak(current, staleness)) {
+  }
+}
+
+bool HashCache::Get(const Key& key, int64_t step, char* row) {
+  bool hit = Lookup(key, step, row);
+  size_t hits = hit ? ++hits_ : hits_.load();
+  size_t misses = hit ? misses_.load() : ++misses_;
+  if ((hits + misses) % kReportInterval == 0) {
+    LOG(INFO) << "HashCache " << name_ << ": hits " << hits << " misses " << misses
+              << " hit rate " << static_cast<double>(hits) / (hits + misses);
+  }
+  return hit;
+}
+
+bool HashCache::Lookup(const Key& key, int64_t step, char* row) {
+  Shard& shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mu);
+  auto iter = shard.index.find(key);
+  if (iter == shard.index.end()) {
+    return false;
+  }
+  std::list<Entry>::iterator entry = iter->second;
+  if (step - entry->step > staleness_.load()) {
+    shard.entries.erase(entry);
+    shard.index.erase(iter);
+    return false;
+  }
+  shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+  memcpy(row, entry->row.data(), row_bytes_);
+  return true;
+}
+
+void HashCache::Put(const Key& key, int64_t step, const char* row) {
+  if (shard_capacity_ == 0) {
+    return;
+  }
+  Shard& shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mu);
+  auto iter = shard.index.find(key);
+  if (iter != shard.index.end()) {
+    shard.entries.splice(shard.entries.begin(), shard.entries, iter->second);
+  } else {
+    if (shard.entries.size() >= shard_capacity_) {
+      shard.index.erase(shard.entries.back().key);
+      shard.entries.pop_back();
+    }
+    shard.entries.push_front(Entry{key, step, std::vector<char>(row_bytes_)});
+    shard.index[key] = shard.entries.begin();
+  }
+  Entry& entry = shard.entries.front();
+  entry.step = step;
+  memcpy(entry.row.data(), row, row_bytes_);
+}
+
+void HashCache::Erase(const Key& key) {
+  Shard& shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mu);
+  auto iter = shard.index.find(key);
+  if (iter != shard.index.end()) {
+    shard.entries.erase(iter->second);
+    shard.index.erase(iter);
+  }
+}
+
+void HashCache::GetStatis(size_t* hits, size_t* misses) const {
+  *hits = hits_.load();
+  *misses = misses_.load();
+}
+
+} //namespace client
+} //namespace ps
+
@@ -0,0 +1,98 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_CLIENT_HASH_CACHE_H_
+#define PS_PLUS_CLIENT_HASH_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ps {
+namespace client {
+
+// Worker side cache of hash variable rows, keyed by id. A row is served for
+// at most staleness steps after it was pulled, least recently used rows are
+// evicted beyond capacity. Hash64 ids use the low half of the key only.
+// The hit rate is logged every kReportInterval lookups.
+class HashCache {
+ public:
+  struct Key {
+    int64_t x;
+    int64_t y;
+    bool operator==(const Key& rhs) const { return x == rhs.x && y == rhs.y; }
+  };
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      return (key.x * 0x9E3779B97F4A7C15ull) ^ key.y;
+    }
+  };
+
+  static const size_t kReportInterval = 1 << 20;
+
+  HashCache(const std::string& name, size_t capacity, int64_t staleness, size_t row_bytes);
+
+  size_t RowBytes() const { return row_bytes_; }
+  int64_t Staleness() const { return staleness_.load(); }
+  // Async training bounds the staleness of the whole worker, rows are never
+  // served older than that.
+  void LimitStaleness(int64_t staleness);
+
+  // Copies the row of key to row when it was pulled at most staleness steps
+  // before step.
+  bool Get(const Key& key, int64_t step, char* row);
+  void Put(const Key& key, int64_t step, const char* row);
+  // Rows pushed by this worker are out of date
+  void Erase(const Key& key);
+
+  void GetStatis(size_t* hits, size_t* misses) const;
+
+ private:
+  HashCache(const HashCache&) = delete;
+  static const size_t kShards = 16;
+  struct Entry {
+    Key key;
+    int64_t step;
+    std::vector<char> row;
+  };
+  struct Shard {
+    std::mutex mu;
+    // most recently used first
+    std::list<Entry> entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+  };
+  Shard& GetShard(const Key& key) {
+    return shards_[(KeyHash()(key) >> 32) % kShards];
+  }
+  bool Lookup(const Key& key, int64_t step, char* row);
+
+  std::string name_;
+  size_t shard_capacity_;
+  std::atomic<int64_t> staleness_;
+  size_t row_bytes_;
+  Shard shards_[kShards];
+  std::atomic<size_t> hits_;
+  std::atomic<size_t> misses_;
+};
+
+} //namespace client
+} //namespace ps
+
+#endif
+
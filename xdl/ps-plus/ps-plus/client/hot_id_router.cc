@@ -0,0 +1,100 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/client/hot_id_router.h"
+#include "ps-plus/common/logging.h"
+
+#include <algorithm>
+
+namespace ps {
+namespace client {
+
+const size_t HotIdRouter::kDepth;
+const size_t HotIdRouter::kWidthBits;
+const uint64_t HotIdRouter::kWindow;
+
+HotIdRouter::HotIdRouter(const std::string& name, size_t replicas, double ratio, size_t capacity)
+  : name_(name), replicas_(replicas), capacity_(capacity), counts_(kDepth << kWidthBits) {
+  threshold_ = std::max<uint32_t>(2, ratio * kWindow);
+}
+
+uint32_t HotIdRouter::Count(const HashCache::Key& key) {
+  uint64_t base = key.x * 0x9E3779B97F4A7C15ull ^ key.y * 0xC2B2AE3D27D4EB4Full;
+  uint32_t estimate = UINT32_MAX;
+  for (size_t d = 0; d < kDepth; d++) {
+    uint64_t h = (base + d * 0x632BE59BD9B4E019ull) * 0xFF51AFD7ED558CCDull;
+    uint32_t& count = counts_[(d << kWidthBits) + (h >> (64 - kWidthBits))];
+    if (count < UINT32_MAX) {
+      count++;
+    }
+    estimate = std::min(estimate, count);
+  }
+  if (++observed_ == kWindow) {
+    observed_ = 0;
+    for (auto& count : counts_) {
+      count >>= 1;
+    }
+  }
+  return estimate;
+}
+
+void HotIdRouter::ObservePull(const std::vector<HashCache::Key>& keys, std::vector<bool>* replicated, std::vector<size_t>* promote) {
+  replicated->assign(keys.size(), false);
+  std::lock_guard<std::mutex> lock(mu_);
+  for (size_t i = 0; i < keys.size(); i++) {
+    auto iter = replicated_.find(keys[i]);
+    if (iter != replicated_.end()) {
+      (*replicated)[i] = iter->second;
+      continue;
+    }
+    if (Count(keys[i]) >= threshold_ && replicated_.size() < capacity_) {
+      replicated_[keys[i]] = false;
+      promote->push_back(i);
+    }
+  }
+  if (!promote->empty()) {
+    LOG(INFO) << "HotIdRouter " << name_ << ": promote " << promote->size() << " ids, " << replicated_.size() << " replicated";
+  }
+}
+
+void HotIdRouter::RoutePush(const std::vector<HashCache::Key>& keys, std::vector<bool>* replicated) {
+  replicated->assign(keys.size(), false);
+  std::lock_guard<std::mutex> lock(mu_);
+  if (replicated_.empty()) {
+    return;
+  }
+  for (size_t i = 0; i < keys.size(); i++) {
+    (*replicated)[i] = replicated_.find(keys[i]) != replicated_.end();
+  }
+}
+
+void HotIdRouter::Seeded(const std::vector<HashCache::Key>& keys, bool ok) {
+  std::lock_guard<std::mutex> lock(mu_);
+  for (auto& key : keys) {
+    if (ok) {
+      replicated_[key] = true;
+    } else {
+      replicated_.erase(key);
+    }
+  }
+}
+
+size_t HotIdRouter::Size() {
+  std::lock_guard<std::mutex> lock(mu_);
+  return replicated_.size();
+}
+
+} //namespace client
+} //namespace ps
@@ -0,0 +1,79 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_CLIENT_HOT_ID_ROUTER_H_
+#define PS_PLUS_CLIENT_HOT_ID_ROUTER_H_
+
+#include "ps-plus/client/hash_cache.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ps {
+namespace client {
+
+// Finds the heavy hitter ids of a hash variable by a count-min sketch of the
+// pulled ids, and tracks the ones replicated to the replicas servers after
+// their owner. The counts are halved every kWindow ids, an id is hot once
+// its count reaches ratio of the window. At most capacity ids are replicated
+// and they stay so.
+//
+// A hot id is seeding from its promotion until its replicas are assigned
+// the owner row, pushes write it to all the replicas meanwhile and pulls
+// spread over them after. The replicas learn from the workers replicating
+// the id, which agree for the global heavy hitters it is meant for.
+class HotIdRouter {
+ public:
+  static const size_t kDepth = 4;
+  static const size_t kWidthBits = 16;
+  static const uint64_t kWindow = 1 << 20;
+
+  HotIdRouter(const std::string& name, size_t replicas, double ratio, size_t capacity);
+
+  size_t Replicas() const { return replicas_; }
+
+  // Counts the pulled keys. replicated[i] is set for the seeded keys, the
+  // keys turning hot are appended to promote and they are seeding.
+  void ObservePull(const std::vector<HashCache::Key>& keys, std::vector<bool>* replicated, std::vector<size_t>* promote);
+  // replicated[i] is set for the seeding or seeded keys
+  void RoutePush(const std::vector<HashCache::Key>& keys, std::vector<bool>* replicated);
+  // Ends seeding the keys, they are dropped unless ok
+  void Seeded(const std::vector<HashCache::Key>& keys, bool ok);
+
+  size_t Size();
+
+ private:
+  HotIdRouter(const HotIdRouter&) = delete;
+  // Increments the counts of key and returns its estimate
+  uint32_t Count(const HashCache::Key& key);
+
+  std::string name_;
+  size_t replicas_;
+  uint32_t threshold_;
+  size_t capacity_;
+  std::mutex mu_;
+  std::vector<uint32_t> counts_;
+  uint64_t observed_ = 0;
+  // true once seeded
+  std::unordered_map<HashCache::Key, bool, HashCache::KeyHash> replicated_;
+};
+
+} //namespace client
+} //namespace ps
+
+#endif
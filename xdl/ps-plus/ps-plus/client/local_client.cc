@@ -409,6 +409,41 @@ void LocalClient::MergedHashPush(const std::vector<std::string>& var_names,
   Process(udf, "^hash_variable", inputs, outputs, realcb);
 }
 
+void LocalClient::MixedHashPush(const std::vector<std::string>& var_names,
+                                const std::vector<Tensor>& ids,
+                                const std::vector<float>& save_ratios,
+                                const std::vector<std::string>& updaters,
+                                const std::vector<std::vector<int64_t>>& groups,
+                                const std::vector<std::vector<Data*>>& data,
+                                const Callback& cb) {
+  if (updaters.size() != groups.size() || updaters.size() != data.size()) {
+    cb(Status::ArgumentError("MixedHashPush: updaters, groups and data size not match"));
+    return;
+  }
+  std::vector<Data*> inputs = Args(ids, var_names, save_ratios, true, false);
+  UdfData slices("BuildHashSlice", UdfData(0), UdfData(1), UdfData(2), UdfData(3), UdfData(4));
+  std::vector<UdfData> updates;
+  for (size_t g = 0; g < updaters.size(); g++) {
+    // the variables are split already, so the gradients need no select
+    size_t group_index = inputs.size();
+    inputs.push_back(Args(groups[g])[0]);
+    std::vector<UdfData> udf_inputs = {UdfData("SelectSlices", slices, UdfData(group_index))};
+    for (auto item : data[g]) {
+      udf_inputs.push_back(UdfData(inputs.size()));
+      inputs.push_back(item);
+    }
+    updates.push_back(UdfData(updaters[g], udf_inputs));
+  }
+  std::vector<std::unique_ptr<Data>>* outputs =
+    new std::vector<std::unique_ptr<Data>>;
+  Callback realcb = [cb, outputs](const Status& st) {
+    std::unique_ptr<std::vector<std::unique_ptr<Data>>> deleter(outputs);
+    cb(st);
+  };
+
+  Process(UdfChain(updates), "^hash_variable", inputs, outputs, realcb);
+}
+
 void LocalClient::MergedHashStatis(const std::vector<std::string>& var_names,
                                    const std::vector<Tensor>& ids,
                                    const std::vector<float>& save_ratios,
@@ -78,6 +78,19 @@ class LocalClient: public BaseClient {
     cb(st);
   }
 
+  void ResizeServers(int server_num, const Callback& cb) override {
+    cb(Status::NotImplemented("LocalClient has no servers to resize"));
+  }
+
+  void GetClusterStats(ClusterStats* result, const Callback& cb) override {
+    result->servers.resize(1);
+    Status st = local_server_->GetStats(&result->servers[0]);
+    if (st.IsOk()) {
+      result->Aggregate();
+    }
+    cb(st);
+  }
+
   Status InitGlobalQueue(
       const std::string& name,
       const std::vector<std::string>& paths,
@@ -193,6 +206,14 @@ class LocalClient: public BaseClient {
                       const std::vector<Data*>& data,
                       const Callback& cb) override;
 
+  void MixedHashPush(const std::vector<std::string>& var_names,
+                     const std::vector<Tensor>& ids,
+                     const std::vector<float>& save_ratios,
+                     const std::vector<std::string>& updaters,
+                     const std::vector<std::vector<int64_t>>& groups,
+                     const std::vector<std::vector<Data*>>& data,
+                     const Callback& cb) override;
+
   void MergedHashStatis(const std::vector<std::string>& var_names,
                         const std::vector<Tensor>& ids,
                         const std::vector<float>& save_ratio,
@@ -94,6 +94,11 @@ Status MergedHashId::Init(MergedPartitionerContext* ctx, Data* src) {
           if (ctx->GetContext(i)->GetVariableInfo()->parts.size() != part_size) {
             return Status::ArgumentError("Merged Hash Variable Should Have the Same Parts Size");
           }
+          for (size_t j = 0; j < part_size; j++) {
+            if (ctx->GetContext(i)->GetVariableInfo()->parts[j].server != ctx->GetContext(0)->GetVariableInfo()->parts[j].server) {
+              return Status::ArgumentError("Merged Hash Variable Should Be Placed On the Same Servers");
+            }
+          }
           if (ctx->GetContext(i)->GetVariableInfo()->type != VariableInfo::kHash128 && 
               ctx->GetContext(i)->GetVariableInfo()->type != VariableInfo::kHash64) {
             return Status::ArgumentError("HashId Partitioner Only Allow by kHash");
@@ -16,7 +16,9 @@ limitations under the License.
 #include "ps-plus/client/partitioner/sparse.h"
 #include "ps-plus/common/initializer/none_initializer.h"
 #include "ps-plus/common/hasher.h"
+#include <algorithm>
 #include <cstring>
+#include <functional>
 #include <iostream>
 
 namespace ps {
@@ -30,7 +32,10 @@ struct SparseSlices {
   size_t id_size;
 };
 
-Status SplitOneHashId(PartitionerContext* ctx, const Tensor& id, size_t index) {
+// The parts to send the id of row i to, on top of its owner part
+typedef std::function<void(size_t i, size_t owner, std::vector<std::vector<size_t>>* ids)> HashRoute;
+
+Status SplitOneHashId(PartitionerContext* ctx, const Tensor& id, size_t index, const HashRoute& route = nullptr) {
   VariableInfo* info = ctx->GetVariableInfo();
   if (info->type == VariableInfo::kHash128) {
     if (id.Shape().Size() != 2 || id.Shape()[1] != 2) {
@@ -68,7 +73,11 @@ Status SplitOneHashId(PartitionerContext* ctx, const Tensor& id, size_t index) {
         x = Hasher::Hash64(raw_ids[i]);
       }
       int split_id = std::lower_bound(splits.begin(), splits.end(), x) - splits.begin();
-      slices.ids[split_id].push_back(i);
+      if (route) {
+        route(i, split_id, &slices.ids);
+      } else {
+        slices.ids[split_id].push_back(i);
+      }
     }
   } while(0));
 
@@ -277,6 +286,34 @@ Status HashId::Init(PartitionerContext* ctx, Data* src) {
   }
 }
 
+Status ReplicatedHashId::Init(PartitionerContext* ctx, Data* src) {
+  VariableInfo* info = ctx->GetVariableInfo();
+  if (info->type != VariableInfo::kHash128 && info->type != VariableInfo::kHash64) {
+    return Status::ArgumentError("ReplicatedHashId Partitioner Only Allow by kHash");
+  }
+  WrapperData<Tensor>* id = dynamic_cast<WrapperData<Tensor>*>(src);
+  if (id == nullptr) {
+    return Status::ArgumentError("ReplicatedHashId Partitioner Only Allow the Tensor Data");
+  }
+  if (id->Internal().Shape().IsScalar() || replicated_.size() != id->Internal().Shape()[0]) {
+    return Status::ArgumentError("ReplicatedHashId Partitioner: replicated size mismatch with ids, variable[" + info->name + "]");
+  }
+  size_t parts = info->parts.size();
+  size_t replicas = std::max<size_t>(1, std::min(replicas_, parts));
+  HashRoute route = [this, parts, replicas](size_t i, size_t owner, std::vector<std::vector<size_t>>* ids) {
+    if (!replicated_[i] || replicas == 1) {
+      (*ids)[owner].push_back(i);
+    } else if (route_ == kPullAny) {
+      (*ids)[(owner + (salt_ + i) % replicas) % parts].push_back(i);
+    } else {
+      for (size_t r = route_ == kSeedReplicas ? 1 : 0; r < replicas; r++) {
+        (*ids)[(owner + r) % parts].push_back(i);
+      }
+    }
+  };
+  return SplitOneHashId(ctx, id->Internal(), id_, route);
+}
+
 Status SparseData::CombineInit(PartitionerContext* ctx, std::unique_ptr<Data>* output) {
   WrapperData<SparseSlices>* id_wrapper = dynamic_cast<WrapperData<SparseSlices>*>(ctx->GetData(id_));
   if (id_wrapper == nullptr) {
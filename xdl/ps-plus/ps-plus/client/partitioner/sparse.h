@@ -50,6 +50,27 @@ class HashId : public HashData {
   virtual Status Init(PartitionerContext* ctx, Data* src) override;
 };
 
+// HashId with the replicated ids on the replicas parts following the owner
+// part. A pull reads a replicated id from one of them chosen by salt, a push
+// writes it to all of them, and a seed writes it to the replicas only.
+// replicated is indexed by the id row, the other ids go to the owner.
+class ReplicatedHashId : public HashData {
+ public:
+  enum Route {
+    kPullAny = 0,
+    kPushAll = 1,
+    kSeedReplicas = 2
+  };
+  ReplicatedHashId(const std::vector<bool>& replicated, size_t replicas, Route route, size_t salt = 0)
+    : HashData(0), replicated_(replicated), replicas_(replicas), route_(route), salt_(salt) {}
+  virtual Status Init(PartitionerContext* ctx, Data* src) override;
+ private:
+  std::vector<bool> replicated_;
+  size_t replicas_;
+  Route route_;
+  size_t salt_;
+};
+
 }
 }
 }
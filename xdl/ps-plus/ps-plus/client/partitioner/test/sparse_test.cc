@@ -17,6 +17,8 @@ limitations under the License.
 #include "ps-plus/client/partitioner/sparse.h"
 #include "ps-plus/common/initializer/none_initializer.h"
 
+#include <algorithm>
+
 using ps::client::PartitionerContext;
 using ps::client::partitioner::SparseId;
 using ps::client::partitioner::SparseData;
@@ -128,3 +130,80 @@ TEST(SparsePartitionerTest, SplitAndCombine) {
     EXPECT_EQ(i, dynamic_cast<WrapperData<Tensor>*>(data2.get())->Internal().Raw<int64_t>()[i]);
   }
 }
+
+TEST(SparsePartitionerTest, ReplicatedHashId) {
+  using ps::client::partitioner::ReplicatedHashId;
+  using ps::client::partitioner::HashId;
+  VariableInfo info;
+  info.parts.push_back(VariableInfo::Part{.server = 0, .size = 16384});
+  info.parts.push_back(VariableInfo::Part{.server = 1, .size = 16384});
+  info.parts.push_back(VariableInfo::Part{.server = 2, .size = 16384});
+  info.parts.push_back(VariableInfo::Part{.server = 3, .size = 16384});
+  info.shape.push_back(10);
+  info.shape.push_back(2);
+  info.type = VariableInfo::kHash64;
+  info.datatype = DataType::kInt64;
+  info.name = "w";
+
+  std::unique_ptr<WrapperData<Tensor>> ids(new WrapperData<Tensor>(DataType::kInt64, TensorShape({8}), new NoneInitializer));
+  for (int i = 0; i < 8; i++) {
+    ids->Internal().Raw<int64_t>()[i] = i * 7919;
+  }
+  std::vector<bool> replicated = {true, false, true, false, false, false, false, true};
+
+  // the owner parts of the ids
+  std::vector<size_t> owner(8);
+  {
+    PartitionerContext ctx(info);
+    HashId partitioner;
+    std::vector<Data*> result;
+    EXPECT_TRUE(partitioner.Init(&ctx, ids.get()).IsOk());
+    EXPECT_TRUE(partitioner.Split(&ctx, ids.get(), &result).IsOk());
+    for (size_t s = 0; s < result.size(); s++) {
+      Tensor& part = dynamic_cast<WrapperData<Tensor>*>(result[s])->Internal();
+      for (size_t j = 0; j < part.Shape()[0]; j++) {
+        owner[part.Raw<int64_t>()[j] / 7919] = s;
+      }
+    }
+  }
+
+  auto route = [&](ReplicatedHashId::Route r, std::vector<std::vector<size_t>>* parts) {
+    PartitionerContext ctx(info);
+    ReplicatedHashId partitioner(replicated, 3, r, 1);
+    std::vector<Data*> result;
+    EXPECT_TRUE(partitioner.Init(&ctx, ids.get()).IsOk());
+    EXPECT_TRUE(partitioner.Split(&ctx, ids.get(), &result).IsOk());
+    EXPECT_EQ(4u, result.size());
+    parts->assign(8, std::vector<size_t>());
+    for (size_t s = 0; s < result.size(); s++) {
+      Tensor& part = dynamic_cast<WrapperData<Tensor>*>(result[s])->Internal();
+      for (size_t j = 0; j < part.Shape()[0]; j++) {
+        (*parts)[part.Raw<int64_t>()[j] / 7919].push_back(s);
+      }
+    }
+  };
+
+  std::vector<std::vector<size_t>> parts;
+  route(ReplicatedHashId::kPullAny, &parts);
+  for (size_t i = 0; i < 8; i++) {
+    ASSERT_EQ(1u, parts[i].size());
+    size_t expected = replicated[i] ? (owner[i] + (1 + i) % 3) % 4 : owner[i];
+    EXPECT_EQ(expected, parts[i][0]);
+  }
+  route(ReplicatedHashId::kPushAll, &parts);
+  for (size_t i = 0; i < 8; i++) {
+    EXPECT_EQ(replicated[i] ? 3u : 1u, parts[i].size());
+    EXPECT_NE(parts[i].end(), std::find(parts[i].begin(), parts[i].end(), owner[i]));
+  }
+  route(ReplicatedHashId::kSeedReplicas, &parts);
+  for (size_t i = 0; i < 8; i++) {
+    if (replicated[i]) {
+      EXPECT_EQ(2u, parts[i].size());
+      EXPECT_EQ(parts[i].end(), std::find(parts[i].begin(), parts[i].end(), owner[i]));
+    }
+  }
+
+  PartitionerContext ctx(info);
+  ReplicatedHashId partitioner(std::vector<bool>(3, true), 3, ReplicatedHashId::kPullAny);
+  EXPECT_FALSE(partitioner.Init(&ctx, ids.get()).IsOk());
+}
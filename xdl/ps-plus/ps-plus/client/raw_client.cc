@@ -19,7 +19,10 @@ limitations under the License.
 #include "ps-plus/client/model_server_splitter.h"
 
 #include "ps-plus/common/logging.h"
+#include "ps-plus/common/tracer.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <sstream>
 #include <sys/time.h>
@@ -46,7 +49,14 @@ Status RawClient::Init() {
     std::lock_guard<std::mutex> lock(variable_info_mutex_);
     init_variable_info_ = false;
   }
+  coalescer_.reset();
   client_wrapper_.reset(args_.client_wrapper_creator());
+  if (args_.coalesce_window_us > 0) {
+    coalescer_.reset(new RequestCoalescer(client_wrapper_.get(), args_.coalesce_window_us, args_.coalesce_max_batch));
+  }
+  if (timers_ == nullptr && (args_.process_timeout_ms > 0 || args_.hedge_quantile > 0)) {
+    timers_.reset(new TimerQueue);
+  }
   return client_wrapper_->ConnectToCluster(args_.scheduler_addr);
 }
 
@@ -57,11 +67,13 @@ void RawClient::Process(
   const std::vector<MergedPartitioner*>& splitter,
   const std::vector<MergedPartitioner*>& combiner,
   std::vector<std::vector<std::unique_ptr<Data>>>* results,
-  const Callback& cb_internal) {
+  const Callback& cb_internal,
+  bool idempotent) {
 
   MergedPartitionerContext* ctx = new MergedPartitionerContext;
-  Callback cb = [this, ctx, splitter, combiner, datas, cb_internal](Status s){
-    cb_internal(s);
+  // Requests still in flight after a timeout or a hedge read the inputs,
+  // they are freed with the last copy of cb.
+  std::shared_ptr<void> inputs(nullptr, [ctx, splitter, combiner, datas](void*){
     delete ctx;
     for (auto item : splitter) {
       delete item;
@@ -72,6 +84,9 @@ void RawClient::Process(
     for (auto item : datas) {
       delete item;
     }
+  });
+  Callback cb = [inputs, cb_internal](Status s){
+    cb_internal(s);
   };
   for (size_t i = 0; i < var_names.size(); ++i) {
     PartitionerContext* one_ctx = new PartitionerContext;
@@ -120,7 +135,7 @@ void RawClient::Process(
   for (size_t i = 0; i < servers; ++i) {
     size_t server_id = server_to_send[i].server;
     std::vector<Data*>* server_results = new std::vector<Data*>();
-    Process("^hash_variable", server_id, udf, request[i], server_results, 
+    Process("^hash_variable", server_id, udf, request[i], server_results, idempotent,
       pctx->CollectResults(combiner, ctx, server_results, results, i, cb));
   }
 }
@@ -132,11 +147,11 @@ void RawClient::Process(
   const std::vector<Partitioner*>& splitter,
   const std::vector<Partitioner*>& combiner,
   std::vector<std::unique_ptr<Data>>* results,
-  const Callback& cb_internal) {
+  const Callback& cb_internal,
+  bool idempotent) {
 
   PartitionerContext* ctx = new PartitionerContext;
-  Callback cb = [this, ctx, splitter, combiner, datas, cb_internal](Status s){
-    cb_internal(s);
+  std::shared_ptr<void> inputs(nullptr, [ctx, splitter, combiner, datas](void*){
     delete ctx;
     for (auto item : splitter) {
       delete item;
@@ -147,6 +162,9 @@ void RawClient::Process(
     for (auto item : datas) {
       delete item;
     }
+  });
+  Callback cb = [inputs, cb_internal](Status s){
+    cb_internal(s);
   };
 
   VariableInfo info;
@@ -190,7 +208,7 @@ void RawClient::Process(
   for (size_t i = 0; i < servers; ++i) {
     size_t server_id = server_to_send[i].server;
     std::vector<Data*>* server_results = new std::vector<Data*>();
-    Process(var_name, server_id, udf, request[i], server_results, 
+    Process(var_name, server_id, udf, request[i], server_results, idempotent,
       pctx->CollectResults(combiner, ctx, server_results, results, i, cb));
   }
 }
@@ -203,6 +221,14 @@ void RawClient::Restore(const std::string& name, const Callback& cb) {
   client_wrapper_->Restore(name, cb);
 }
 
+void RawClient::ResizeServers(int server_num, const Callback& cb) {
+  client_wrapper_->ResizeServers(server_num, cb);
+}
+
+void RawClient::GetClusterStats(ClusterStats* result, const Callback& cb) {
+  client_wrapper_->GetClusterStats(result, cb);
+}
+
 struct ModelServerContext {
   std::mutex mu;
   ModelServerSplitter splitter;
@@ -323,12 +349,132 @@ void RawClient::WorkerBarrierV2(int barrier_id, int task_id, int task_num, int t
   client_wrapper_->WorkerBarrierV2(barrier_id, task_id, task_num, token, cb);    
 }
 
-void RawClient::Process(const std::string& var_name, size_t server_id, const UdfChain& udf, const std::vector<Data*>& input, std::vector<Data*>* output, const Callback& cb) {
-  client_wrapper_->Process(var_name, server_id, udf.hash(), input, output, [var_name, server_id, udf, input, output, cb, this](Status st) {
+// One Process call to a server, maybe sent twice. Every attempt answers
+// into its own output, the first answer or the deadline runs cb.
+struct RawClient::Call {
+  std::string var_name;
+  size_t server_id;
+  UdfChain udf;
+  std::vector<Data*> input;
+  std::vector<Data*>* output;
+  bool idempotent;
+  Callback cb;
+  std::mutex mu;
+  bool done;
+  std::vector<std::unique_ptr<std::vector<Data*> > > outputs;
+  // the attempts sent from the timer thread keep the trace of the call
+  ps::common::TraceContext trace;
+};
+
+void RawClient::Process(const std::string& var_name, size_t server_id, const UdfChain& udf, const std::vector<Data*>& input, std::vector<Data*>* output, bool idempotent, const Callback& user_cb) {
+  // A traced request is a ps_rpc span, its id goes to the server with the
+  // request and parents the server spans.
+  ps::common::TraceContext parent = ps::common::Tracer::Current();
+  Callback cb = user_cb;
+  ps::common::TraceContext rpc;
+  if (parent.Traced() && ps::common::Tracer::Instance()->Enabled()) {
+    rpc = ps::common::TraceContext(parent.trace_id, ps::common::Tracer::NewId());
+    int64_t rpc_start = ps::common::Tracer::NowMicros();
+    cb = [parent, rpc, rpc_start, var_name, user_cb](Status st) {
+      ps::common::Tracer::Instance()->Record(parent, rpc.span_id, "ps_rpc", var_name,
+                                             rpc_start, ps::common::Tracer::NowMicros());
+      user_cb(st);
+    };
+  }
+  ps::common::TraceScope trace_scope(rpc);
+  bool hedge = idempotent && args_.hedge_quantile > 0;
+  if (args_.process_timeout_ms <= 0 && !hedge) {
+    auto start = std::chrono::steady_clock::now();
+    Send(var_name, server_id, udf, input, output, idempotent, [this, server_id, start, cb](Status st) {
+      latency_.Record(server_id, std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start).count());
+      cb(st);
+    });
+    return;
+  }
+  std::shared_ptr<Call> call(new Call{var_name, server_id, udf, input, output, idempotent, cb});
+  call->done = false;
+  call->trace = rpc;
+  std::weak_ptr<Call> weak_call = call;
+  if (args_.process_timeout_ms > 0) {
+    timers_->Schedule(args_.process_timeout_ms * 1000, [weak_call]{
+      std::shared_ptr<Call> call = weak_call.lock();
+      if (call == nullptr) {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(call->mu);
+        if (call->done) {
+          return;
+        }
+        call->done = true;
+      }
+      call->cb(Status::Timeout("Process " + call->var_name + " timeout on server " + std::to_string(call->server_id)));
+    });
+  }
+  if (hedge) {
+    int64_t delay = std::max(latency_.Quantile(server_id, args_.hedge_quantile), args_.hedge_min_us);
+    timers_->Schedule(delay, [this, weak_call]{
+      std::shared_ptr<Call> call = weak_call.lock();
+      if (call == nullptr) {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(call->mu);
+        if (call->done) {
+          return;
+        }
+      }
+      SendAttempt(call);
+    });
+  }
+  SendAttempt(call);
+}
+
+void RawClient::SendAttempt(const std::shared_ptr<Call>& call) {
+  std::vector<Data*>* output;
+  {
+    std::lock_guard<std::mutex> lock(call->mu);
+    call->outputs.emplace_back(new std::vector<Data*>);
+    output = call->outputs.back().get();
+  }
+  ps::common::TraceScope trace_scope(call->trace);
+  auto start = std::chrono::steady_clock::now();
+  // The answer data lives until the callback returns, so it is handed over
+  // inside it.
+  Send(call->var_name, call->server_id, call->udf, call->input, output, call->idempotent, [this, call, output, start](Status st) {
+    latency_.Record(call->server_id, std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    {
+      std::lock_guard<std::mutex> lock(call->mu);
+      if (call->done) {
+        return;
+      }
+      call->done = true;
+    }
+    *call->output = *output;
+    call->cb(st);
+  });
+}
+
+void RawClient::Send(const std::string& var_name, size_t server_id, const UdfChain& udf, const std::vector<Data*>& input, std::vector<Data*>* output, bool idempotent, const Callback& cb) {
+  // Only reads may be answered by a read replica, a coalesced batch always
+  // goes to the primary.
+  ps::common::TraceContext trace = ps::common::Tracer::Current();
+  auto process = [idempotent, trace, this](const std::string& var_name, size_t server_id, size_t udf_id, const std::vector<Data*>& input, std::vector<Data*>* output, const Callback& cb) {
+    // also on the retry after the udf registration
+    ps::common::TraceScope trace_scope(trace);
+    if (idempotent) {
+      client_wrapper_->ReadProcess(var_name, server_id, udf_id, input, output, cb);
+    } else {
+      client_wrapper_->Process(var_name, server_id, udf_id, input, output, cb);
+    }
+  };
+  Callback done = [var_name, server_id, udf, input, output, cb, process, this](Status st) {
     if (st.Code() == Status::kUdfNotRegistered) {
-      client_wrapper_->RegisterUdf(server_id, udf, [var_name, server_id, udf, input, output, cb, this](Status st) {
+      client_wrapper_->RegisterUdf(server_id, udf, [var_name, server_id, udf, input, output, cb, process](Status st) {
         if (st.IsOk()) {
-          client_wrapper_->Process(var_name, server_id, udf.hash(), input, output, cb);
+          process(var_name, server_id, udf.hash(), input, output, cb);
         } else {
           cb(st);
         }
@@ -336,7 +482,12 @@ void RawClient::Process(const std::string& var_name, size_t server_id, const Udf
     } else {
       cb(st);
     }
-  });
+  };
+  if (coalescer_ != nullptr) {
+    coalescer_->Process(var_name, server_id, udf.hash(), input, output, done);
+  } else {
+    process(var_name, server_id, udf.hash(), input, output, done);
+  }
 }
 
 Status RawClient::RegisterVariable(const std::string& name, const VariableInfo& info) {
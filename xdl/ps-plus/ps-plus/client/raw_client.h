@@ -17,15 +17,19 @@ limitations under the License.
 #define PS_PLUS_CLIENT_RAW_CLIENT_H_
 
 #include "ps-plus/client/client_wrapper.h"
+#include "ps-plus/client/request_coalescer.h"
+#include "ps-plus/client/server_latency.h"
 #include "ps-plus/client/udf.h"
 #include "ps-plus/client/udf.h"
 #include "ps-plus/common/status.h"
 #include "ps-plus/common/data.h"
+#include "ps-plus/common/timer_queue.h"
 
 #include <functional>
 #include <string>
 #include <mutex>
 #include <future>
+#include <memory>
 #include <unordered_set>
 
 namespace ps {
@@ -35,6 +39,25 @@ struct ClientArgs {
   std::string scheduler_addr;
   std::function<ClientWrapper*()> client_wrapper_creator;
   std::unordered_map<std::string, VariableInfo> variable_info;
+  // Process calls to one server within this window are sent as one
+  // request, 0 sends every call on its own.
+  int64_t coalesce_window_us = 0;
+  size_t coalesce_max_batch = 64;
+  // Process calls not answered in time fail with Status::kTimeout, 0 waits
+  // for the answer.
+  int64_t process_timeout_ms = 0;
+  // Idempotent calls not answered within this latency quantile of their
+  // server are sent once more, the first answer wins. 0 never resends.
+  double hedge_quantile = 0;
+  int64_t hedge_min_us = 1000;
+  // Dense variables larger than this are pulled and pushed in chunks of
+  // rows of about this size, dense_chunk_window of them in flight, so the
+  // first rows are sent while the rest are serialized. 0 sends them whole.
+  size_t dense_chunk_bytes = 0;
+  size_t dense_chunk_window = 4;
+  // Merged pulls and pushes send the ids of the entries sharing a variable
+  // once, the pushed gradients of an id are summed.
+  bool merge_shared_ids = true;
 };
 
 class RawClient {
@@ -42,10 +65,13 @@ class RawClient {
   using Callback = std::function<void (const Status&)>;
 
   RawClient(const ClientArgs& args);
+  const ClientArgs& GetArgs() const { return args_; }
 
   Status Init();
 
   // Note: element in datas/splitter/combiner will be free after cb run
+  // and after every request sent for them is answered.
+  // Only idempotent calls are hedged.
   void Process(
     const UdfChain& udf, 
     const std::string& var_name,
@@ -53,7 +79,8 @@ class RawClient {
     const std::vector<Partitioner*>& splitter,
     const std::vector<Partitioner*>& combiner,
     std::vector<std::unique_ptr<Data> >* results,
-    const Callback& cb);
+    const Callback& cb,
+    bool idempotent = false);
 
   void Process(
     const UdfChain& udf, 
@@ -62,7 +89,8 @@ class RawClient {
     const std::vector<MergedPartitioner*>& splitter,
     const std::vector<MergedPartitioner*>& combiner,
     std::vector<std::vector<std::unique_ptr<Data> > >* results,
-    const Callback& cb);
+    const Callback& cb,
+    bool idempotent = false);
 
   void ModelServerForward(int type, const Tensor& ids, Tensor* rst, const Callback& cb);
   void ModelServerBackward(int type, const Tensor& ids, const Tensor& grads, const Callback& cb);
@@ -71,6 +99,8 @@ class RawClient {
 
   void Save(const std::string& name, const Callback& cb);
   void Restore(const std::string& name, const Callback& cb);
+  void ResizeServers(int server_num, const Callback& cb);
+  void GetClusterStats(ClusterStats* result, const Callback& cb);
   void TriggerStreamingModelDense(const std::string& stream_ver, const Callback& cb);
   void TriggerStreamingModelSparse(const std::string& stream_ver, const Callback& cb);
   void TriggerStreamingModelHash(const std::string& stream_ver, const Callback& cb);
@@ -120,13 +150,19 @@ class RawClient {
   Status GetVariableInfo(const std::string& name, VariableInfo* info);
 
  private:
-  void Process(const std::string& var_name, size_t server_id, const UdfChain& udf, const std::vector<Data*>& input, std::vector<Data*>* output, const Callback& cb);
+  struct Call;
+  void Process(const std::string& var_name, size_t server_id, const UdfChain& udf, const std::vector<Data*>& input, std::vector<Data*>* output, bool idempotent, const Callback& cb);
+  void Send(const std::string& var_name, size_t server_id, const UdfChain& udf, const std::vector<Data*>& input, std::vector<Data*>* output, bool idempotent, const Callback& cb);
+  void SendAttempt(const std::shared_ptr<Call>& call);
 
   ClientArgs args_;
   std::unique_ptr<ClientWrapper> client_wrapper_;
+  std::unique_ptr<RequestCoalescer> coalescer_;
+  ServerLatency latency_;
   std::mutex variable_info_mutex_;
   std::unordered_map<std::string, VariableInfo> variable_infos_;
   bool init_variable_info_;
+  std::unique_ptr<TimerQueue> timers_;
 };
 
 } //namespace client
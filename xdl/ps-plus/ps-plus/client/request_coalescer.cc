@@ -0,0 +1,103 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/client/request_coalescer.h"
+
+namespace ps {
+namespace client {
+
+RequestCoalescer::RequestCoalescer(ClientWrapper* client_wrapper, int64_t window_us, size_t max_batch)
+  : client_wrapper_(client_wrapper), window_(window_us), max_batch_(max_batch), stop_(false) {
+  flush_thread_ = std::thread([this]{ FlushLoop(); });
+}
+
+RequestCoalescer::~RequestCoalescer() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  flush_thread_.join();
+}
+
+void RequestCoalescer::Process(const std::string& var_name, size_t server_id, size_t udf_id,
+                               const std::vector<Data*>& input, std::vector<Data*>* output,
+                               const Callback& cb) {
+  std::vector<ClientWrapper::ProcessItem> full;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    Batch& batch = batches_[server_id];
+    if (batch.items.empty()) {
+      batch.deadline = Clock::now() + window_;
+      cv_.notify_all();
+    }
+    batch.items.push_back(ClientWrapper::ProcessItem{var_name, udf_id, input, output, cb});
+    if (batch.items.size() >= max_batch_) {
+      full.swap(batch.items);
+    }
+  }
+  if (!full.empty()) {
+    Send(server_id, &full);
+  }
+}
+
+void RequestCoalescer::FlushLoop() {
+  std::unique_lock<std::mutex> lock(mu_);
+  while (true) {
+    Clock::time_point now = Clock::now();
+    Clock::time_point next = Clock::time_point::max();
+    std::vector<std::pair<size_t, std::vector<ClientWrapper::ProcessItem> > > expired;
+    for (auto& item : batches_) {
+      if (item.second.items.empty()) {
+        continue;
+      }
+      if (stop_ || item.second.deadline <= now) {
+        expired.emplace_back(item.first, std::vector<ClientWrapper::ProcessItem>());
+        expired.back().second.swap(item.second.items);
+      } else if (item.second.deadline < next) {
+        next = item.second.deadline;
+      }
+    }
+    if (!expired.empty()) {
+      lock.unlock();
+      for (auto& item : expired) {
+        Send(item.first, &item.second);
+      }
+      lock.lock();
+      continue;
+    }
+    if (stop_) {
+      return;
+    }
+    if (next == Clock::time_point::max()) {
+      cv_.wait(lock);
+    } else {
+      cv_.wait_until(lock, next);
+    }
+  }
+}
+
+void RequestCoalescer::Send(size_t server_id, std::vector<ClientWrapper::ProcessItem>* items) {
+  if (items->size() == 1) {
+    ClientWrapper::ProcessItem& item = items->front();
+    client_wrapper_->Process(item.var_name, server_id, item.udf_id, item.input, item.output, item.cb);
+  } else {
+    client_wrapper_->BatchProcess(server_id, *items);
+  }
+}
+
+} //namespace client
+} //namespace ps
+
@@ -0,0 +1,70 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_CLIENT_REQUEST_COALESCER_H_
+#define PS_PLUS_CLIENT_REQUEST_COALESCER_H_
+
+#include "ps-plus/client/client_wrapper.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ps {
+namespace client {
+
+// Batches Process calls to the same server. The first call to a server
+// opens a batch which is sent by BatchProcess window_us later, or as soon
+// as it holds max_batch calls.
+class RequestCoalescer {
+ public:
+  using Callback = ClientWrapper::Callback;
+
+  RequestCoalescer(ClientWrapper* client_wrapper, int64_t window_us, size_t max_batch);
+  // Sends the batches still open
+  ~RequestCoalescer();
+
+  void Process(const std::string& var_name, size_t server_id, size_t udf_id,
+               const std::vector<Data*>& input, std::vector<Data*>* output,
+               const Callback& cb);
+
+ private:
+  using Clock = std::chrono::steady_clock;
+  struct Batch {
+    Clock::time_point deadline;
+    std::vector<ClientWrapper::ProcessItem> items;
+  };
+
+  void FlushLoop();
+  void Send(size_t server_id, std::vector<ClientWrapper::ProcessItem>* items);
+
+  ClientWrapper* client_wrapper_;
+  std::chrono::microseconds window_;
+  size_t max_batch_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::unordered_map<size_t, Batch> batches_;
+  bool stop_;
+  std::thread flush_thread_;
+};
+
+} //namespace client
+} //namespace ps
+
+#endif
+
@@ -0,0 +1,73 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/client/server_latency.h"
+#include "ps-plus/common/logging.h"
+
+namespace ps {
+namespace client {
+
+ServerLatency::Histogram* ServerLatency::Get(size_t server_id) {
+  std::lock_guard<std::mutex> lock(mu_);
+  std::unique_ptr<Histogram>& histogram = histograms_[server_id];
+  if (histogram == nullptr) {
+    histogram.reset(new Histogram);
+    for (size_t i = 0; i < kBuckets; i++) {
+      histogram->buckets[i] = 0;
+    }
+    histogram->count = 0;
+  }
+  return histogram.get();
+}
+
+void ServerLatency::Record(size_t server_id, int64_t us) {
+  size_t bucket = 0;
+  while (bucket + 1 < kBuckets && (int64_t(1) << bucket) < us) {
+    bucket++;
+  }
+  Histogram* histogram = Get(server_id);
+  histogram->buckets[bucket]++;
+  if (++histogram->count % kReportInterval == 0) {
+    LOG(INFO) << "Server " << server_id << " latency us p50 " << Quantile(*histogram, 0.5)
+              << " p99 " << Quantile(*histogram, 0.99) << " p999 " << Quantile(*histogram, 0.999);
+  }
+}
+
+int64_t ServerLatency::Quantile(size_t server_id, double q) {
+  Histogram* histogram = Get(server_id);
+  if (histogram->count < kMinSamples) {
+    return -1;
+  }
+  return Quantile(*histogram, q);
+}
+
+int64_t ServerLatency::Quantile(const Histogram& histogram, double q) {
+  uint64_t total = 0;
+  for (size_t i = 0; i < kBuckets; i++) {
+    total += histogram.buckets[i];
+  }
+  uint64_t rank = q * total;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBuckets; i++) {
+    seen += histogram.buckets[i];
+    if (seen > rank) {
+      return int64_t(1) << i;
+    }
+  }
+  return int64_t(1) << (kBuckets - 1);
+}
+
+} //namespace client
+} //namespace ps
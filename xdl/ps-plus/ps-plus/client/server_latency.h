@@ -0,0 +1,58 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_CLIENT_SERVER_LATENCY_H_
+#define PS_PLUS_CLIENT_SERVER_LATENCY_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace ps {
+namespace client {
+
+// Latency histogram of Process calls per server, in power of 2 buckets of
+// microseconds. The p50/p99/p999 of a server are logged every
+// kReportInterval calls to it.
+class ServerLatency {
+ public:
+  static const size_t kBuckets = 40;
+  static const size_t kReportInterval = 1 << 16;
+  // Quantiles need this many samples of a server
+  static const size_t kMinSamples = 100;
+
+  void Record(size_t server_id, int64_t us);
+  // Upper bound of the bucket holding quantile q of server_id, or -1 with
+  // too few samples.
+  int64_t Quantile(size_t server_id, double q);
+
+ private:
+  struct Histogram {
+    std::atomic<uint64_t> buckets[kBuckets];
+    std::atomic<uint64_t> count;
+  };
+  Histogram* Get(size_t server_id);
+  static int64_t Quantile(const Histogram& histogram, double q);
+
+  std::mutex mu_;
+  std::unordered_map<size_t, std::unique_ptr<Histogram>> histograms_;
+};
+
+} //namespace client
+} //namespace ps
+
+#endif
@@ -0,0 +1,163 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/client/shared_id_merger.h"
+#include "ps-plus/common/initializer/none_initializer.h"
+
+#include <cstring>
+#include <unordered_map>
+
+namespace ps {
+namespace client {
+
+bool SharedIdMerger::Init(const std::vector<std::string>& var_names, const std::vector<Tensor>& ids) {
+  if (var_names.size() != ids.size()) {
+    return false;
+  }
+  var_names_.clear();
+  entry_.clear();
+  std::unordered_map<std::string, size_t> merged_entry;
+  for (size_t i = 0; i < var_names.size(); i++) {
+    auto iter = merged_entry.find(var_names[i]);
+    if (iter == merged_entry.end()) {
+      merged_entry[var_names[i]] = var_names_.size();
+      entry_.push_back(var_names_.size());
+      var_names_.push_back(var_names[i]);
+    } else {
+      entry_.push_back(iter->second);
+    }
+  }
+  if (var_names_.size() == var_names.size()) {
+    return false;
+  }
+  std::vector<std::vector<size_t>> entries(var_names_.size());
+  for (size_t i = 0; i < entry_.size(); i++) {
+    const Tensor& id = ids[i];
+    if (id.Shape().IsScalar() || id.Shape().Size() > 2) {
+      return false;
+    }
+    if (!entries[entry_[i]].empty()) {
+      const Tensor& first = ids[entries[entry_[i]][0]];
+      if (first.Type() != id.Type() || first.Shape().Size() != id.Shape().Size()) {
+        return false;
+      }
+    }
+    entries[entry_[i]].push_back(i);
+  }
+
+  ids_.clear();
+  index_.assign(entry_.size(), std::vector<size_t>());
+  rows_ = merged_rows_ = 0;
+  for (auto& item : entries) {
+    const Tensor& first = ids[item[0]];
+    bool hash128 = first.Shape().Size() == 2;
+    std::vector<HashCache::Key> keys;
+    std::unordered_map<HashCache::Key, size_t, HashCache::KeyHash> unique;
+    CASES(first.Type(), do {
+      for (auto i : item) {
+        T* raw_ids = ids[i].Raw<T>();
+        size_t rows = ids[i].Shape()[0];
+        index_[i].resize(rows);
+        for (size_t r = 0; r < rows; r++) {
+          HashCache::Key key;
+          key.x = hash128 ? raw_ids[r * 2] : raw_ids[r];
+          key.y = hash128 ? raw_ids[r * 2 + 1] : 0;
+          auto iter = unique.find(key);
+          if (iter == unique.end()) {
+            iter = unique.insert(std::make_pair(key, keys.size())).first;
+            keys.push_back(key);
+          }
+          index_[i][r] = iter->second;
+        }
+        rows_ += rows;
+      }
+      std::vector<size_t> dims = {keys.size()};
+      if (hash128) {
+        dims.push_back(2);
+      }
+      Tensor merged(first.Type(), TensorShape(dims), new initializer::NoneInitializer);
+      T* raw_merged = merged.Raw<T>();
+      for (size_t k = 0; k < keys.size(); k++) {
+        if (hash128) {
+          raw_merged[k * 2] = keys[k].x;
+          raw_merged[k * 2 + 1] = keys[k].y;
+        } else {
+          raw_merged[k] = keys[k].x;
+        }
+      }
+      ids_.push_back(merged);
+    } while(0));
+    merged_rows_ += keys.size();
+  }
+  return true;
+}
+
+Status SharedIdMerger::Scatter(const std::vector<Tensor>& merged, std::vector<Tensor>* result) const {
+  if (merged.size() != var_names_.size()) {
+    return Status::ArgumentError("SharedIdMerger: pulled size mismatch with the variables");
+  }
+  for (size_t i = 0; i < entry_.size(); i++) {
+    const Tensor& rows = merged[entry_[i]];
+    if (rows.Shape().IsScalar() || rows.Shape()[0] != ids_[entry_[i]].Shape()[0]) {
+      return Status::ArgumentError("SharedIdMerger: pulled rows mismatch with the ids of " + var_names_[entry_[i]]);
+    }
+    std::vector<size_t> dims(rows.Shape().Dims());
+    dims[0] = index_[i].size();
+    Tensor output(rows.Type(), TensorShape(dims), new initializer::NoneInitializer);
+    size_t row_bytes = rows.Shape()[0] == 0 ? 0 : SizeOfType(rows.Type()) * rows.Shape().NumElements() / rows.Shape()[0];
+    for (size_t r = 0; r < index_[i].size(); r++) {
+      memcpy(output.Raw<char>() + r * row_bytes, rows.Raw<char>() + index_[i][r] * row_bytes, row_bytes);
+    }
+    result->push_back(output);
+  }
+  return Status::Ok();
+}
+
+Status SharedIdMerger::Sum(const std::vector<Tensor>& grads, std::vector<Tensor>* merged) const {
+  if (grads.size() != entry_.size()) {
+    return Status::ArgumentError("SharedIdMerger: gradient size mismatch with the ids");
+  }
+  merged->assign(var_names_.size(), Tensor());
+  std::vector<size_t> cols(var_names_.size());
+  for (size_t i = 0; i < entry_.size(); i++) {
+    const Tensor& grad = grads[i];
+    if (grad.Type() != DataType::kFloat || grad.Shape().IsScalar() || grad.Shape()[0] != index_[i].size()) {
+      return Status::ArgumentError("SharedIdMerger: float gradient rows required for " + var_names_[entry_[i]]);
+    }
+    size_t j = entry_[i];
+    std::vector<size_t> dims(grad.Shape().Dims());
+    dims[0] = ids_[j].Shape()[0];
+    if (!(*merged)[j].Initialized()) {
+      (*merged)[j] = Tensor(DataType::kFloat, TensorShape(dims), new initializer::NoneInitializer);
+      memset((*merged)[j].Raw<char>(), 0, (*merged)[j].Shape().NumElements() * sizeof(float));
+      cols[j] = dims[0] == 0 ? 0 : (*merged)[j].Shape().NumElements() / dims[0];
+    } else if ((*merged)[j].Shape().Dims() != dims) {
+      return Status::ArgumentError("SharedIdMerger: gradient shapes differ for " + var_names_[j]);
+    }
+    float* sum = (*merged)[j].Raw<float>();
+    const float* raw_grad = grad.Raw<float>();
+    for (size_t r = 0; r < index_[i].size(); r++) {
+      float* dst = sum + index_[i][r] * cols[j];
+      const float* src = raw_grad + r * cols[j];
+      for (size_t c = 0; c < cols[j]; c++) {
+        dst[c] += src[c];
+      }
+    }
+  }
+  return Status::Ok();
+}
+
+} //namespace client
+} //namespace ps
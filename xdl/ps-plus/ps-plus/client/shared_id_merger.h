@@ -0,0 +1,82 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_CLIENT_SHARED_ID_MERGER_H_
+#define PS_PLUS_CLIENT_SHARED_ID_MERGER_H_
+
+#include "ps-plus/client/hash_cache.h"
+#include "ps-plus/common/status.h"
+#include "ps-plus/common/tensor.h"
+
+#include <string>
+#include <vector>
+
+namespace ps {
+namespace client {
+
+// Merges the entries of a merged hash pull or push naming the same
+// variable, the features sharing an embedding table. Their ids are uniqued
+// across the entries and sent once, the pulled rows are scattered back to
+// every entry and the pushed gradient rows of an id are summed.
+class SharedIdMerger {
+ public:
+  // false when no variable repeats or the ids of one differ in type or rank
+  bool Init(const std::vector<std::string>& var_names, const std::vector<Tensor>& ids);
+
+  const std::vector<std::string>& VarNames() const { return var_names_; }
+  const std::vector<Tensor>& Ids() const { return ids_; }
+  size_t Rows() const { return rows_; }
+  size_t MergedRows() const { return merged_rows_; }
+
+  // The per variable values of the merged entries, false when the entries
+  // of a variable disagree
+  template <typename T>
+  bool MergeValues(const std::vector<T>& values, std::vector<T>* merged) const {
+    if (values.size() != entry_.size()) {
+      return false;
+    }
+    std::vector<bool> set(var_names_.size(), false);
+    merged->resize(var_names_.size());
+    for (size_t i = 0; i < entry_.size(); i++) {
+      size_t j = entry_[i];
+      if (!set[j]) {
+        (*merged)[j] = values[i];
+        set[j] = true;
+      } else if ((*merged)[j] != values[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // The rows pulled for the merged entries back in the entries
+  Status Scatter(const std::vector<Tensor>& merged, std::vector<Tensor>* result) const;
+  // The float gradient rows of the entries summed by merged id
+  Status Sum(const std::vector<Tensor>& grads, std::vector<Tensor>* merged) const;
+
+ private:
+  std::vector<std::string> var_names_;
+  std::vector<Tensor> ids_;
+  // the merged entry of each entry, and the merged row of each of its rows
+  std::vector<size_t> entry_;
+  std::vector<std::vector<size_t>> index_;
+  size_t rows_ = 0;
+  size_t merged_rows_ = 0;
+};
+
+} //namespace client
+} //namespace ps
+
+#endif
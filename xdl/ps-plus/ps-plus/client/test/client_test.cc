@@ -22,6 +22,7 @@ limitations under the License.
 #include "ps-plus/common/initializer/constant_initializer.h"
 #include "ps-plus/common/initializer/none_initializer.h"
 #include "ps-plus/message/worker_state.h"
+#include <set>
 #include <thread>
 
 using ps::Data;
@@ -39,6 +40,7 @@ using ps::client::UdfData;
 using ps::client::UdfChain;
 using ps::VariableInfo;
 using ps::WorkerState;
+using ps::ClusterStats;
 using ps::initializer::ConstantInitializer;
 using ps::initializer::NoneInitializer;
 
@@ -161,6 +163,14 @@ class MockClientWrapper : public ClientWrapper {
     ReturnAsync(Status::Ok(), cb);
     return;
   };
+  void ResizeServers(int server_num, const Callback& cb) {
+    ReturnAsync(Status::Ok(), cb);
+    return;
+  };
+  void GetClusterStats(ClusterStats* result, const Callback& cb) {
+    ReturnAsync(Status::Ok(), cb);
+    return;
+  };
   void TriggerStreamingModelDense(const std::string& stream_ver, const Callback& cb) {
     ReturnAsync(Status::Ok(), cb);
     return;
@@ -240,6 +250,69 @@ class MockClientWrapper : public ClientWrapper {
   std::vector<unsigned long long> mok_udf_;
 };
 
+// Answers the first Process call to every server after slow_ms
+class SlowMockClientWrapper : public MockClientWrapper {
+ public:
+  SlowMockClientWrapper(int slow_ms) : slow_ms_(slow_ms), calls_(0) {}
+  void Process(const std::string& var_name,
+               size_t server_id, 
+               size_t udf_id, 
+               const std::vector<Data*>& input, 
+               std::vector<Data*>* output, 
+               const Callback& cb) override {
+    int delay;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      delay = seen_.insert(server_id).second ? slow_ms_ : 0;
+      calls_++;
+    }
+    MockClientWrapper::Process(var_name, server_id, udf_id, input, output, [delay, cb](const Status& st) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+      cb(st);
+    });
+  }
+  int slow_ms_;
+  std::set<size_t> seen_;
+  std::atomic<int> calls_;
+};
+
+// Counts the Process calls that may go to a read replica
+class ReadMockClientWrapper : public MockClientWrapper {
+ public:
+  ReadMockClientWrapper() : reads_(0) {}
+  void ReadProcess(const std::string& var_name,
+                   size_t server_id, 
+                   size_t udf_id, 
+                   const std::vector<Data*>& input, 
+                   std::vector<Data*>* output, 
+                   const Callback& cb) override {
+    reads_++;
+    Process(var_name, server_id, udf_id, input, output, cb);
+  }
+  std::atomic<int> reads_;
+};
+
+// Answers every Process call, counting the calls and the id rows sent
+class ChunkMockClientWrapper : public MockClientWrapper {
+ public:
+  ChunkMockClientWrapper() : calls_(0), rows_(0) {}
+  void Process(const std::string& var_name,
+               size_t server_id, 
+               size_t udf_id, 
+               const std::vector<Data*>& input, 
+               std::vector<Data*>* output, 
+               const Callback& cb) override {
+    calls_++;
+    WrapperData<Tensor>* ids = input.empty() ? nullptr : dynamic_cast<WrapperData<Tensor>*>(input[0]);
+    if (ids != nullptr && !ids->Internal().Shape().IsScalar()) {
+      rows_ += ids->Internal().Shape()[0];
+    }
+    ReturnAsync(Status::Ok(), cb);
+  }
+  std::atomic<int> calls_;
+  std::atomic<int> rows_;
+};
+
 class MockPartitioner : public Partitioner {
  public:
   Status Split(PartitionerContext* ctx, Data* src, std::vector<Data*>* dst) {
@@ -543,6 +616,166 @@ TEST(ClientTest, ProcessNormalPullTest) {
   delete client;
 }
 
+TEST(ClientTest, ChunkedDensePushTest) {
+  ChunkMockClientWrapper* wrapper = new ChunkMockClientWrapper;
+  ClientArgs args;
+  args.scheduler_addr = "";
+  args.client_wrapper_creator = [wrapper](){ return wrapper; };
+  args.dense_chunk_bytes = 4096;
+  Client* client = new Client(new RawClient(args));
+  client->Init();
+  VariableInfo info = {VariableInfo::kIndex, "dense", {{0, 40}, {1, 24}}, {64, 64}, ps::DataType::kFloat};
+  client->RegisterVariable("dense", info);
+
+  auto push = [client](const std::string& updater) {
+    std::vector<Tensor> grad_vec = {Tensor(ps::DataType::kFloat, ps::TensorShape({64, 64}), new ConstantInitializer(1))};
+    std::vector<double> lr_vec = {0.1};
+    std::promise<Status> st_promise;
+    client->DensePush("dense", updater, client->Args(grad_vec, lr_vec), [&st_promise](Status st){
+      st_promise.set_value(st);
+    });
+    return st_promise.get_future().get();
+  };
+  // 256 bytes rows, 16 of them a chunk, every chunk is a call per server
+  EXPECT_EQ(Status::Ok(), push("MomentumUpdater"));
+  EXPECT_EQ(8, wrapper->calls_);
+  EXPECT_EQ(64, wrapper->rows_);
+
+  // adam advances its powers once per call
+  wrapper->calls_ = 0;
+  EXPECT_EQ(Status::Ok(), push("AdamUpdater"));
+  EXPECT_EQ(2, wrapper->calls_);
+  delete client;
+}
+
+TEST(ClientTest, ProcessTimeoutTest) {
+  std::vector<VariableInfo> remote_info;
+  std::vector<unsigned long long> remote_udf;
+  ClientArgs args;
+  std::vector<Partitioner*> splitter;
+  std::vector<Partitioner*> splitter_error;
+  std::vector<Partitioner*> combiner;
+  std::vector<Partitioner*> combiner_error;
+  std::vector<Data*> datas;
+  std::vector<std::unique_ptr<Data>> results;
+
+  MockArgument(remote_info, remote_udf, args, splitter, splitter_error, combiner, combiner_error, datas, results);
+  SlowMockClientWrapper* wrapper = new SlowMockClientWrapper(300);
+  wrapper->MockRemoteVariableInfo(remote_info);
+  wrapper->MockRemoteUdf(remote_udf);
+  args.client_wrapper_creator = [wrapper](){ return wrapper; };
+  args.process_timeout_ms = 20;
+  Client* client = new Client(new RawClient(args));
+  client->Init();
+
+  UdfData udf_data2 = UdfData(2);
+  UdfChain udf2 = UdfChain(udf_data2);
+  VariableInfo info1 = {VariableInfo::kIndex, "var1", {{1, 1}, {2, 2}}};
+  client->RegisterVariable("var1", info1);
+
+  std::promise<Status> st_promise;
+  client->Process(udf2, "var1", {}, {}, combiner, &results, [&st_promise](Status st){
+    st_promise.set_value(st);
+  });
+  Status st = st_promise.get_future().get();
+  EXPECT_EQ(Status::kTimeout, st.Code());
+
+  // the late answers still arrive
+  std::this_thread::sleep_for(std::chrono::milliseconds(400));
+  DeleteItems(splitter, splitter_error, combiner_error);
+  delete client;
+}
+
+TEST(ClientTest, ProcessHedgeTest) {
+  std::vector<VariableInfo> remote_info;
+  std::vector<unsigned long long> remote_udf;
+  ClientArgs args;
+  std::vector<Partitioner*> splitter;
+  std::vector<Partitioner*> splitter_error;
+  std::vector<Partitioner*> combiner;
+  std::vector<Partitioner*> combiner_error;
+  std::vector<Data*> datas;
+  std::vector<std::unique_ptr<Data>> results;
+
+  MockArgument(remote_info, remote_udf, args, splitter, splitter_error, combiner, combiner_error, datas, results);
+  SlowMockClientWrapper* wrapper = new SlowMockClientWrapper(300);
+  wrapper->MockRemoteVariableInfo(remote_info);
+  wrapper->MockRemoteUdf(remote_udf);
+  args.client_wrapper_creator = [wrapper](){ return wrapper; };
+  args.hedge_quantile = 0.99;
+  args.hedge_min_us = 20000;
+  RawClient* raw = new RawClient(args);
+  raw->Init();
+
+  UdfData udf_data2 = UdfData(2);
+  UdfChain udf2 = UdfChain(udf_data2);
+  VariableInfo info1 = {VariableInfo::kIndex, "var1", {{1, 1}, {2, 2}}};
+  raw->RegisterVariable("var1", info1);
+
+  auto start = std::chrono::steady_clock::now();
+  std::promise<Status> st_promise;
+  raw->Process(udf2, "var1", {}, {}, combiner, &results, [&st_promise](Status st){
+    st_promise.set_value(st);
+  }, true);
+  Status st = st_promise.get_future().get();
+  EXPECT_EQ(Status::Ok(), st);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(250));
+  EXPECT_EQ(4, wrapper->calls_);
+  MockData result_data = dynamic_cast<WrapperData<MockData>*>(results[0].get())->Internal();
+  EXPECT_EQ(2, result_data.GetValue());
+  EXPECT_EQ(3, result_data.GetDim());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(400));
+  DeleteItems(splitter, splitter_error, combiner_error);
+  delete raw;
+}
+
+TEST(ClientTest, ProcessReadTest) {
+  std::vector<VariableInfo> remote_info;
+  std::vector<unsigned long long> remote_udf;
+  ClientArgs args;
+  std::vector<Partitioner*> splitter;
+  std::vector<Partitioner*> splitter_error;
+  std::vector<Partitioner*> combiner;
+  std::vector<Partitioner*> combiner_error;
+  std::vector<Data*> datas;
+  std::vector<std::unique_ptr<Data>> results;
+
+  MockArgument(remote_info, remote_udf, args, splitter, splitter_error, combiner, combiner_error, datas, results);
+  ReadMockClientWrapper* wrapper = new ReadMockClientWrapper;
+  wrapper->MockRemoteVariableInfo(remote_info);
+  wrapper->MockRemoteUdf(remote_udf);
+  args.client_wrapper_creator = [wrapper](){ return wrapper; };
+  RawClient* raw = new RawClient(args);
+  raw->Init();
+
+  UdfData udf_data1 = UdfData(1);
+  UdfChain udf1 = UdfChain(udf_data1);
+  UdfData udf_data2 = UdfData(2);
+  UdfChain udf2 = UdfChain(udf_data2);
+  VariableInfo info1 = {VariableInfo::kIndex, "var1", {{1, 1}, {2, 2}}};
+  raw->RegisterVariable("var1", info1);
+
+  std::promise<Status> push_promise;
+  raw->Process(udf1, "var1", datas, splitter, {}, &results, [&push_promise](Status st){
+    push_promise.set_value(st);
+  });
+  EXPECT_EQ(Status::Ok(), push_promise.get_future().get());
+  EXPECT_EQ(0, wrapper->reads_);
+
+  results.clear();
+  std::promise<Status> pull_promise;
+  raw->Process(udf2, "var1", {}, {}, combiner, &results, [&pull_promise](Status st){
+    pull_promise.set_value(st);
+  }, true);
+  EXPECT_EQ(Status::Ok(), pull_promise.get_future().get());
+  EXPECT_EQ(2, wrapper->reads_);
+
+  std::vector<Partitioner*> none;
+  DeleteItems(splitter_error, combiner_error, none);
+  delete raw;
+}
+
 TEST(ClientTest, OtherTest) {
   std::vector<VariableInfo> remote_info;
   std::vector<unsigned long long> remote_udf;
@@ -721,6 +954,52 @@ TEST(ClientTest, OtherRemoteTest) {
   EXPECT_EQ(Status::kArgumentError, st.Code());
 }
 
+TEST(ClientTest, MixedHashPushArgumentTest) {
+  std::vector<VariableInfo> remote_info;
+  std::vector<unsigned long long> remote_udf;
+  ClientArgs args;
+  std::vector<Partitioner*> splitter;
+  std::vector<Partitioner*> splitter_error;
+  std::vector<Partitioner*> combiner;
+  std::vector<Partitioner*> combiner_error;
+  std::vector<Data*> datas;
+  std::vector<std::unique_ptr<Data>> results;
+
+  MockArgument(remote_info, remote_udf, args, splitter, splitter_error, combiner, combiner_error, datas, results);
+  Client* client = new Client(new RawClient(args));
+  client->Init();
+
+  std::vector<std::string> names = {"var4", "var5"};
+  std::vector<Tensor> ids(2);
+  std::vector<float> ratios = {0.0, 0.0};
+  std::promise<Status> st_promise0;
+  client->MixedHashPush(names, ids, ratios, {"AdagradUpdater"}, {{0}, {1}}, {{}},
+                        [&st_promise0](Status st){
+    st_promise0.set_value(st);
+  });
+  Status st = st_promise0.get_future().get();
+  EXPECT_EQ(Status::kArgumentError, st.Code());
+
+  // the first data of an updater are its gradients
+  std::promise<Status> st_promise1;
+  std::vector<double> lr = {0.1};
+  client->MixedHashPush(names, ids, ratios, {"AdagradUpdater"}, {{0, 1}}, {client->Args(lr)},
+                        [&st_promise1](Status st){
+    st_promise1.set_value(st);
+  });
+  st = st_promise1.get_future().get();
+  EXPECT_EQ(Status::kArgumentError, st.Code());
+
+  std::promise<Status> st_promise2;
+  std::vector<Tensor> grads(1);
+  client->MixedHashPush(names, ids, ratios, {"AdagradUpdater"}, {{0, 1}}, {client->Args(grads, lr)},
+                        [&st_promise2](Status st){
+    st_promise2.set_value(st);
+  });
+  st = st_promise2.get_future().get();
+  EXPECT_EQ(Status::kArgumentError, st.Code());
+}
+
 TEST(LocalClientTest, LocalTest) {
   auto client = new LocalClient("./");
   client->Init();
@@ -0,0 +1,103 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "ps-plus/client/gradient_accumulator.h"
+#include "ps-plus/common/initializer/none_initializer.h"
+
+using ps::DataType;
+using ps::Tensor;
+using ps::TensorShape;
+using ps::client::GradientAccumulator;
+using ps::initializer::NoneInitializer;
+
+namespace {
+
+void Push(GradientAccumulator* buffer, const std::vector<int64_t>& ids, float value, bool* full) {
+  Tensor id_tensor(DataType::kInt64, TensorShape({ids.size()}), new NoneInitializer);
+  Tensor grad(DataType::kFloat, TensorShape({ids.size(), 2}), new NoneInitializer);
+  for (size_t i = 0; i < ids.size(); i++) {
+    id_tensor.Raw<int64_t>()[i] = ids[i];
+    grad.Raw<float>()[i * 2] = value;
+    grad.Raw<float>()[i * 2 + 1] = -value;
+  }
+  ASSERT_TRUE(buffer->Add(id_tensor, grad, full).IsOk());
+}
+
+}
+
+TEST(GradientAccumulatorTest, Sum) {
+  GradientAccumulator buffer(3, 1 << 20, false);
+  bool full;
+  Push(&buffer, {1, 2}, 1, &full);
+  EXPECT_FALSE(full);
+  Push(&buffer, {2, 3}, 2, &full);
+  EXPECT_FALSE(full);
+  Push(&buffer, {2}, 4, &full);
+  EXPECT_TRUE(full);
+
+  Tensor ids, grad;
+  buffer.Take(&ids, &grad);
+  EXPECT_TRUE(buffer.Empty());
+  ASSERT_EQ(TensorShape({3}), ids.Shape());
+  ASSERT_EQ(TensorShape({3, 2}), grad.Shape());
+  EXPECT_EQ(1, ids.Raw<int64_t>()[0]);
+  EXPECT_EQ(2, ids.Raw<int64_t>()[1]);
+  EXPECT_EQ(3, ids.Raw<int64_t>()[2]);
+  EXPECT_FLOAT_EQ(1, grad.Raw<float>()[0]);
+  EXPECT_FLOAT_EQ(7, grad.Raw<float>()[2]);
+  EXPECT_FLOAT_EQ(-7, grad.Raw<float>()[3]);
+  EXPECT_FLOAT_EQ(2, grad.Raw<float>()[4]);
+
+  Push(&buffer, {5}, 1, &full);
+  EXPECT_FALSE(full);
+}
+
+TEST(GradientAccumulatorTest, Mean) {
+  GradientAccumulator buffer(10, 1 << 20, true);
+  bool full;
+  Push(&buffer, {7}, 1, &full);
+  Push(&buffer, {7, 8}, 3, &full);
+  Tensor ids, grad;
+  buffer.Take(&ids, &grad);
+  ASSERT_EQ(TensorShape({2, 2}), grad.Shape());
+  EXPECT_FLOAT_EQ(2, grad.Raw<float>()[0]);
+  EXPECT_FLOAT_EQ(3, grad.Raw<float>()[2]);
+}
+
+TEST(GradientAccumulatorTest, Budget) {
+  GradientAccumulator buffer(100, 1024, false);
+  bool full = false;
+  int64_t id = 0;
+  int pushes = 0;
+  while (!full) {
+    Push(&buffer, {id++, id++}, 1, &full);
+    pushes++;
+  }
+  EXPECT_LT(1, pushes);
+  EXPECT_GT(100, pushes);
+  EXPECT_LT(1024u, buffer.Bytes());
+}
+
+TEST(GradientAccumulatorTest, Mismatch) {
+  GradientAccumulator buffer(2, 1 << 20, false);
+  bool full;
+  Push(&buffer, {1}, 1, &full);
+  Tensor ids(DataType::kInt64, TensorShape({1}), new NoneInitializer);
+  Tensor grad(DataType::kFloat, TensorShape({1, 3}), new NoneInitializer);
+  EXPECT_FALSE(buffer.Add(ids, grad, &full).IsOk());
+  Tensor rows(DataType::kFloat, TensorShape({2, 2}), new NoneInitializer);
+  EXPECT_FALSE(buffer.Add(ids, rows, &full).IsOk());
+}
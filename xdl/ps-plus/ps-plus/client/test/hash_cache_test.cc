@@ -0,0 +1,65 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "ps-plus/client/hash_cache.h"
+
+using ps::client::HashCache;
+
+TEST(HashCacheTest, Staleness) {
+  HashCache cache("x", 64, 2, sizeof(float));
+  float row = 1;
+  float out = 0;
+  EXPECT_FALSE(cache.Get(HashCache::Key{1, 0}, 0, (char*)&out));
+  cache.Put(HashCache::Key{1, 0}, 0, (char*)&row);
+  EXPECT_TRUE(cache.Get(HashCache::Key{1, 0}, 2, (char*)&out));
+  EXPECT_EQ(1, out);
+  EXPECT_FALSE(cache.Get(HashCache::Key{1, 1}, 2, (char*)&out));
+  EXPECT_FALSE(cache.Get(HashCache::Key{1, 0}, 3, (char*)&out));
+
+  cache.Put(HashCache::Key{2, 0}, 3, (char*)&row);
+  cache.LimitStaleness(0);
+  cache.LimitStaleness(5);
+  EXPECT_EQ(0, cache.Staleness());
+  EXPECT_TRUE(cache.Get(HashCache::Key{2, 0}, 3, (char*)&out));
+  EXPECT_FALSE(cache.Get(HashCache::Key{2, 0}, 4, (char*)&out));
+
+  cache.Put(HashCache::Key{3, 0}, 4, (char*)&row);
+  cache.Erase(HashCache::Key{3, 0});
+  EXPECT_FALSE(cache.Get(HashCache::Key{3, 0}, 4, (char*)&out));
+
+  size_t hits, misses;
+  cache.GetStatis(&hits, &misses);
+  EXPECT_EQ(2u, hits);
+  EXPECT_EQ(5u, misses);
+}
+
+TEST(HashCacheTest, Evict) {
+  HashCache cache("x", 16, 10, sizeof(int64_t));
+  for (int64_t i = 0; i < 1000; i++) {
+    cache.Put(HashCache::Key{i, 0}, 0, (char*)&i);
+  }
+  size_t cached = 0;
+  int64_t out;
+  for (int64_t i = 0; i < 1000; i++) {
+    if (cache.Get(HashCache::Key{i, 0}, 0, (char*)&out)) {
+      EXPECT_EQ(i, out);
+      cached++;
+    }
+  }
+  EXPECT_GE(16u, cached);
+  EXPECT_LT(0u, cached);
+}
+
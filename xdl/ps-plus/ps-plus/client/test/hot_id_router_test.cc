@@ -0,0 +1,71 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "ps-plus/client/hot_id_router.h"
+
+using ps::client::HotIdRouter;
+using ps::client::HashCache;
+
+TEST(HotIdRouterTest, PromoteAndSeed) {
+  // hot at 1% of the window
+  HotIdRouter router("w", 3, 0.01, 2);
+  EXPECT_EQ(3u, router.Replicas());
+  std::vector<HashCache::Key> keys = {{1, 0}, {2, 0}, {3, 0}};
+  std::vector<bool> replicated;
+  std::vector<size_t> promote;
+  size_t threshold = HotIdRouter::kWindow / 100;
+  for (size_t i = 0; i + 1 < threshold; i++) {
+    router.ObservePull(keys, &replicated, &promote);
+  }
+  EXPECT_TRUE(promote.empty());
+  EXPECT_EQ(std::vector<bool>(3, false), replicated);
+
+  router.ObservePull(keys, &replicated, &promote);
+  // the capacity holds the first two
+  EXPECT_EQ(std::vector<size_t>({0, 1}), promote);
+  EXPECT_EQ(2u, router.Size());
+  // seeding, pulled from the owner and pushed to all
+  promote.clear();
+  router.ObservePull(keys, &replicated, &promote);
+  EXPECT_TRUE(promote.empty());
+  EXPECT_EQ(std::vector<bool>(3, false), replicated);
+  router.RoutePush(keys, &replicated);
+  EXPECT_EQ(std::vector<bool>({true, true, false}), replicated);
+
+  router.Seeded({{1, 0}}, true);
+  router.Seeded({{2, 0}}, false);
+  router.ObservePull(keys, &replicated, &promote);
+  EXPECT_EQ(std::vector<bool>({true, false, false}), replicated);
+  // the failed one is promoted again
+  EXPECT_EQ(std::vector<size_t>({1}), promote);
+  router.RoutePush(keys, &replicated);
+  EXPECT_EQ(std::vector<bool>({true, true, false}), replicated);
+}
+
+TEST(HotIdRouterTest, ColdIds) {
+  HotIdRouter router("w", 2, 0.01, 1024);
+  std::vector<bool> replicated;
+  std::vector<size_t> promote;
+  std::vector<HashCache::Key> keys(1000);
+  for (int64_t step = 0; step < 100; step++) {
+    for (size_t i = 0; i < keys.size(); i++) {
+      keys[i] = {step * 1000 + (int64_t)i, 7};
+    }
+    router.ObservePull(keys, &replicated, &promote);
+  }
+  EXPECT_TRUE(promote.empty());
+  EXPECT_EQ(0u, router.Size());
+}
@@ -0,0 +1,155 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "ps-plus/client/request_coalescer.h"
+
+#include <algorithm>
+#include <future>
+#include <thread>
+
+using ps::Data;
+using ps::WrapperData;
+using ps::Status;
+using ps::Tensor;
+using ps::VariableInfo;
+using ps::WorkerState;
+using ps::ClusterStats;
+using ps::client::ClientWrapper;
+using ps::client::RequestCoalescer;
+using ps::client::UdfChain;
+
+namespace {
+
+// Answers every call with its udf id, records the shape of each request.
+class CountingClientWrapper : public ClientWrapper {
+ public:
+  void Process(const std::string& var_name, size_t server_id, size_t udf_id,
+               const std::vector<Data*>& input, std::vector<Data*>* output,
+               const Callback& cb) override {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      requests_.push_back(1);
+    }
+    Answer(udf_id, output, cb);
+  }
+  void BatchProcess(size_t server_id, const std::vector<ProcessItem>& items) override {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      requests_.push_back(items.size());
+    }
+    for (auto& item : items) {
+      Answer(item.udf_id, item.output, item.cb);
+    }
+  }
+  void Answer(size_t udf_id, std::vector<Data*>* output, const Callback& cb) {
+    output->push_back(new WrapperData<size_t>(udf_id));
+    if (udf_id == 0) {
+      cb(Status::ArgumentError("udf 0"));
+    } else {
+      cb(Status::Ok());
+    }
+  }
+  std::vector<size_t> Requests() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return requests_;
+  }
+
+  Status ConnectToCluster(const std::string& addr) override { return Status::Ok(); }
+  void UpdateVariableInfo(const std::vector<VariableInfo>& input, std::vector<VariableInfo>* output, const Callback& cb) override {}
+  void UpdateVariableVisitInfo(const std::string& name, int64_t id_num, const Callback& cb) override {}
+  void RegisterUdf(size_t server_id, const UdfChain& def, const Callback& cb) override {}
+  void Save(const std::string& version, const Callback& cb) override {}
+  void Restore(const std::string& version, const Callback& cb) override {}
+  void ResizeServers(int server_num, const Callback& cb) override {}
+  void GetClusterStats(ClusterStats* result, const Callback& cb) override {}
+  Status InitGlobalQueue(const std::string& name, const std::vector<std::string>& paths, size_t epochs, bool epoch_isolate = false) override { return Status::Ok(); }
+  Status GetNextFile(const std::string& name, size_t worker_id, std::string* path, size_t* begin, size_t* epoch) override { return Status::Ok(); }
+  Status ReportWorkerState(const std::string& name, size_t worker_id, const std::vector<WorkerState>& worker_states) override { return Status::Ok(); }
+  Status RestoreWorkerState(const std::string& name, size_t worker_id) override { return Status::Ok(); }
+  void ModelServerForward(int server_type, int server_id, const Tensor& ids, std::unique_ptr<Tensor>* rst, const Callback& cb) override {}
+  void ModelServerBackward(int server_type, int server_id, const Tensor& ids, const Tensor& grads, const Callback& cb) override {}
+  void TriggerStreamingModelDense(const std::string& stream_ver, const Callback& cb) override {}
+  void TriggerStreamingModelSparse(const std::string& stream_ver, const Callback& cb) override {}
+  void TriggerStreamingModelHash(const std::string& stream_ver, const Callback& cb) override {}
+  void AsynchronizeEnter(int id, int staleness, int worker_count, const Callback& cb) override {}
+  void SynchronizeEnter(int id, int worker_count, int64_t* token, const Callback& cb) override {}
+  void SynchronizeLeave(int id, int64_t token, const Callback& cb) override {}
+  void WorkerReportFinish(int id, const Callback& cb) override {}
+  void GetWorkerFinishCount(int64_t* count, const Callback& cb) override {}
+  void WorkerBarrier(int id, int worker_count, const Callback& cb) override {}
+  void WorkerBarrierV2(int barrier_id, int task_id, int task_num, int token, const Callback& cb) override {}
+  int ServerSize(int id) override { return 0; }
+  int ServerTypeSize() override { return 0; }
+
+ private:
+  std::mutex mu_;
+  std::vector<size_t> requests_;
+};
+
+struct Call {
+  std::vector<Data*> output;
+  std::promise<Status> done;
+  ~Call() {
+    for (auto item : output) {
+      delete item;
+    }
+  }
+};
+
+}
+
+TEST(RequestCoalescerTest, WindowBatchesOneServer) {
+  CountingClientWrapper wrapper;
+  std::vector<Call> calls(4);
+  {
+    RequestCoalescer coalescer(&wrapper, 100000, 64);
+    for (size_t i = 0; i < calls.size(); i++) {
+      Call* call = &calls[i];
+      coalescer.Process("var", i < 3 ? 1 : 2, i, {}, &call->output, [call](const Status& st) {
+        call->done.set_value(st);
+      });
+    }
+    for (size_t i = 0; i < calls.size(); i++) {
+      Status st = calls[i].done.get_future().get();
+      EXPECT_EQ(i == 0 ? Status::kArgumentError : Status::kOk, st.Code());
+      ASSERT_EQ(1u, calls[i].output.size());
+      EXPECT_EQ(i, dynamic_cast<WrapperData<size_t>*>(calls[i].output[0])->Internal());
+    }
+  }
+  std::vector<size_t> requests = wrapper.Requests();
+  std::sort(requests.begin(), requests.end());
+  EXPECT_EQ(std::vector<size_t>({1, 3}), requests);
+}
+
+TEST(RequestCoalescerTest, FullBatchIsSentAtOnce) {
+  CountingClientWrapper wrapper;
+  std::vector<Call> calls(5);
+  // The window never expires before the destructor, only full batches go out early
+  RequestCoalescer* coalescer = new RequestCoalescer(&wrapper, 60000000, 2);
+  for (size_t i = 0; i < calls.size(); i++) {
+    Call* call = &calls[i];
+    coalescer->Process("var", 0, i + 1, {}, &call->output, [call](const Status& st) {
+      call->done.set_value(st);
+    });
+  }
+  for (size_t i = 0; i < 4; i++) {
+    EXPECT_TRUE(calls[i].done.get_future().get().IsOk());
+  }
+  EXPECT_EQ(std::vector<size_t>({2, 2}), wrapper.Requests());
+  delete coalescer;
+  EXPECT_TRUE(calls[4].done.get_future().get().IsOk());
+  EXPECT_EQ(std::vector<size_t>({2, 2, 1}), wrapper.Requests());
+}
@@ -0,0 +1,35 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "ps-plus/client/server_latency.h"
+
+using ps::client::ServerLatency;
+
+TEST(ServerLatencyTest, Quantile) {
+  ServerLatency latency;
+  EXPECT_EQ(-1, latency.Quantile(0, 0.5));
+  for (int i = 0; i < 990; i++) {
+    latency.Record(0, 100);
+  }
+  for (int i = 0; i < 10; i++) {
+    latency.Record(0, 5000);
+  }
+  latency.Record(1, 5000);
+  EXPECT_EQ(128, latency.Quantile(0, 0.5));
+  EXPECT_EQ(128, latency.Quantile(0, 0.98));
+  EXPECT_EQ(8192, latency.Quantile(0, 0.995));
+  EXPECT_EQ(-1, latency.Quantile(1, 0.5));
+}
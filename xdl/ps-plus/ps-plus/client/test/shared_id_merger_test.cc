@@ -0,0 +1,115 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "ps-plus/client/shared_id_merger.h"
+#include "ps-plus/common/initializer/none_initializer.h"
+
+#include <cstring>
+
+using ps::client::SharedIdMerger;
+using ps::Tensor;
+using ps::TensorShape;
+using ps::DataType;
+using ps::initializer::NoneInitializer;
+
+namespace {
+
+Tensor Ids(const std::vector<int64_t>& values) {
+  Tensor ids(DataType::kInt64, TensorShape({values.size()}), new NoneInitializer);
+  for (size_t i = 0; i < values.size(); i++) {
+    ids.Raw<int64_t>()[i] = values[i];
+  }
+  return ids;
+}
+
+Tensor Rows(const std::vector<float>& values, size_t cols) {
+  Tensor rows(DataType::kFloat, TensorShape({values.size() / cols, cols}), new NoneInitializer);
+  for (size_t i = 0; i < values.size(); i++) {
+    rows.Raw<float>()[i] = values[i];
+  }
+  return rows;
+}
+
+}
+
+TEST(SharedIdMergerTest, NoSharedVariable) {
+  SharedIdMerger merger;
+  EXPECT_FALSE(merger.Init({"a", "b"}, {Ids({1, 2}), Ids({1, 2})}));
+}
+
+TEST(SharedIdMergerTest, PullAndPush) {
+  SharedIdMerger merger;
+  ASSERT_TRUE(merger.Init({"a", "b", "a"}, {Ids({1, 2, 3}), Ids({5}), Ids({3, 4, 1})}));
+  EXPECT_EQ(std::vector<std::string>({"a", "b"}), merger.VarNames());
+  ASSERT_EQ(2u, merger.Ids().size());
+  EXPECT_EQ(TensorShape({4}), merger.Ids()[0].Shape());
+  EXPECT_EQ(TensorShape({1}), merger.Ids()[1].Shape());
+  for (size_t i = 0; i < 4; i++) {
+    EXPECT_EQ((int64_t)i + 1, merger.Ids()[0].Raw<int64_t>()[i]);
+  }
+  EXPECT_EQ(7u, merger.Rows());
+  EXPECT_EQ(5u, merger.MergedRows());
+
+  std::vector<float> ratios;
+  EXPECT_TRUE(merger.MergeValues(std::vector<float>({0.5, 0, 0.5}), &ratios));
+  EXPECT_EQ(std::vector<float>({0.5, 0}), ratios);
+  std::vector<double> lr;
+  EXPECT_FALSE(merger.MergeValues(std::vector<double>({0.1, 0.1, 0.2}), &lr));
+
+  // the row of id x is {x, -x}
+  std::vector<Tensor> pulled = {Rows({1, -1, 2, -2, 3, -3, 4, -4}, 2), Rows({5, -5}, 2)};
+  std::vector<Tensor> result;
+  ASSERT_TRUE(merger.Scatter(pulled, &result).IsOk());
+  ASSERT_EQ(3u, result.size());
+  EXPECT_EQ(TensorShape({3, 2}), result[0].Shape());
+  EXPECT_EQ(TensorShape({1, 2}), result[1].Shape());
+  std::vector<float> expected = {3, -3, 4, -4, 1, -1};
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_EQ(expected[i], result[2].Raw<float>()[i]);
+  }
+  EXPECT_EQ(5, result[1].Raw<float>()[0]);
+
+  std::vector<Tensor> grads = {Rows({1, 1, 2, 2, 3, 3}, 2), Rows({5, 5}, 2), Rows({10, 10, 20, 20, 30, 30}, 2)};
+  std::vector<Tensor> summed;
+  ASSERT_TRUE(merger.Sum(grads, &summed).IsOk());
+  ASSERT_EQ(2u, summed.size());
+  EXPECT_EQ(TensorShape({4, 2}), summed[0].Shape());
+  std::vector<float> sums = {31, 31, 2, 2, 13, 13, 20, 20};
+  for (size_t i = 0; i < sums.size(); i++) {
+    EXPECT_EQ(sums[i], summed[0].Raw<float>()[i]);
+  }
+  EXPECT_EQ(5, summed[1].Raw<float>()[1]);
+
+  grads[2] = Rows({1, 1}, 2);
+  EXPECT_FALSE(merger.Sum(grads, &summed).IsOk());
+}
+
+TEST(SharedIdMergerTest, Hash128) {
+  Tensor a(DataType::kInt64, TensorShape({2, 2}), new NoneInitializer);
+  Tensor b(DataType::kInt64, TensorShape({2, 2}), new NoneInitializer);
+  int64_t a_values[] = {1, 2, 1, 3};
+  int64_t b_values[] = {1, 3, 2, 1};
+  memcpy(a.Raw<int64_t>(), a_values, sizeof(a_values));
+  memcpy(b.Raw<int64_t>(), b_values, sizeof(b_values));
+  SharedIdMerger merger;
+  ASSERT_TRUE(merger.Init({"a", "a"}, {a, b}));
+  EXPECT_EQ(TensorShape({3, 2}), merger.Ids()[0].Shape());
+  int64_t expected[] = {1, 2, 1, 3, 2, 1};
+  for (size_t i = 0; i < 6; i++) {
+    EXPECT_EQ(expected[i], merger.Ids()[0].Raw<int64_t>()[i]);
+  }
+  EXPECT_FALSE(merger.Init({"a", "a"}, {a, Ids({1})}));
+}
@@ -49,6 +49,24 @@ CountingBloomFilter<CType>::CountingBloomFilter(double fpp,
             << " element_size=" << element_size_ << ", bucket_size=" << bucket_size_ << " hash_function_number=" << hash_function_number_;
 }
 
+namespace {
+
+// Saturating increment, lock free so that concurrent inserts from the
+// hashmap workers neither race nor serialize. Returns the new value.
+template <typename CType>
+inline CType AtomicSaturatingIncrease(CType* counter) {
+  CType old = __atomic_load_n(counter, __ATOMIC_RELAXED);
+  while (old != std::numeric_limits<CType>::max()) {
+    if (__atomic_compare_exchange_n(counter, &old, old + 1, true,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      return old + 1;
+    }
+  }
+  return old;
+}
+
+}  // namespace
+
 template <typename CType>
 void CountingBloomFilter<CType>::Insert(const void* key, int len) {
   if (key == nullptr) return;
@@ -56,9 +74,7 @@ void CountingBloomFilter<CType>::Insert(const void* key, int len) {
   for (auto&& fn : hash_functions_) {
     fn(key, len, mur_res);
     uint64_t index = mur_res[1] % bucket_size_;
-    if (buf_[index] != std::numeric_limits<CType>::max()) {
-      buf_[index] += 1;
-    }
+    AtomicSaturatingIncrease(&buf_[index]);
   }
 }
 
@@ -71,7 +87,7 @@ bool CountingBloomFilter<CType>::Exists(const void* key, int len,
   for (auto&& fn : hash_functions_) {
     fn(key, len, mur_res);
     uint64_t index = mur_res[1] % bucket_size_;
-    if (buf_[index] < max_count) return false;
+    if (__atomic_load_n(&buf_[index], __ATOMIC_RELAXED) < max_count) return false;
   }
   return true;
 }
@@ -79,8 +95,71 @@ bool CountingBloomFilter<CType>::Exists(const void* key, int len,
 template <typename CType>
 bool CountingBloomFilter<CType>::InsertedLookup(const void* key, int len,
                                                 uint32_t max_count) {
-  Insert(key, len);
-  return Exists(key, len, max_count);
+  if (key == nullptr) return max_count == 0;
+  // hash once for both the insert and the lookup
+  uint64_t mur_res[2];
+  bool exists = true;
+  for (auto&& fn : hash_functions_) {
+    fn(key, len, mur_res);
+    uint64_t index = mur_res[1] % bucket_size_;
+    if (AtomicSaturatingIncrease(&buf_[index]) < max_count) {
+      exists = false;
+    }
+  }
+  return exists;
+}
+
+template <typename CType>
+ShardedCountingBloomFilter<CType>::ShardedCountingBloomFilter(
+    size_t shard_count, double fpp, uint64_t element_size) {
+  if (shard_count == 0) {
+    shard_count = 1;
+  }
+  uint64_t shard_element_size = (element_size + shard_count - 1) / shard_count;
+  for (size_t i = 0; i < shard_count; i++) {
+    shards_.emplace_back(new CountingBloomFilter<CType>(fpp, shard_element_size));
+  }
+}
+
+template <typename CType>
+size_t ShardedCountingBloomFilter<CType>::Shard(const void* key, int len) const {
+  static MurmurHash hasher(0x9747b28c);
+  uint64_t mur_res[2];
+  hasher(key, len, mur_res);
+  return mur_res[0] % shards_.size();
+}
+
+template <typename CType>
+void ShardedCountingBloomFilter<CType>::Insert(const void* key, int len) {
+  if (key == nullptr) return;
+  shards_[Shard(key, len)]->Insert(key, len);
+}
+
+template <typename CType>
+bool ShardedCountingBloomFilter<CType>::Exists(const void* key, int len,
+                                               uint32_t max_count) const {
+  if (max_count == 0) return true;
+  if (key == nullptr) return false;
+  return shards_[Shard(key, len)]->Exists(key, len, max_count);
+}
+
+template <typename CType>
+bool ShardedCountingBloomFilter<CType>::InsertedLookup(const void* key, int len,
+                                                       uint32_t max_count) {
+  if (key == nullptr) return max_count == 0;
+  return shards_[Shard(key, len)]->InsertedLookup(key, len, max_count);
+}
+
+template class ShardedCountingBloomFilter<uint8_t>;
+template class ShardedCountingBloomFilter<uint16_t>;
+
+BloomFilterBase* NewShardedBloomFilter(int32_t threthold, size_t shard_count,
+                                       double fpp, uint64_t element_size) {
+  if (threthold < 240) {
+    return new ShardedCountingBloomFilter<uint8_t>(shard_count, fpp, element_size);
+  } else {
+    return new ShardedCountingBloomFilter<uint16_t>(shard_count, fpp, element_size);
+  }
 }
 
 BloomFilterBase* GlobalBloomFilter::Instance() {
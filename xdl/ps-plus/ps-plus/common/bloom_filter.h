@@ -25,6 +25,7 @@ namespace ps {
 
 class BloomFilterBase {
  public: 
+  virtual ~BloomFilterBase() {}
   virtual void Insert(const void* key, int len) = 0;
   virtual bool Exists(const void* key, int len, uint32_t max_count=1u) const = 0;
   virtual bool InsertedLookup(const void* key, int len, uint32_t max_count=1u) = 0;
@@ -64,6 +65,33 @@ class CountingBloomFilter : public BloomFilterBase {
   std::vector<CType> buf_;
 };
 
+// Splits the counters into shards selected by a hash of the key, each shard
+// is an independent CountingBloomFilter with its own hash seeds. Used for
+// the per-variable admission filters so that hot variables do not share
+// counters (and cache lines) with each other or with the global filter.
+template <typename CType>
+class ShardedCountingBloomFilter : public BloomFilterBase {
+ public:
+  ShardedCountingBloomFilter(size_t shard_count, double fpp=0.01, uint64_t element_size=1000000000);
+  virtual void Insert(const void* key, int len);
+  virtual bool Exists(const void* key, int len, uint32_t max_count=1u) const;
+  virtual bool InsertedLookup(const void* key, int len, uint32_t max_count=1u);
+  size_t shard_count() const {
+    return shards_.size();
+  }
+ private:
+  ShardedCountingBloomFilter(const ShardedCountingBloomFilter&) = delete;
+  ShardedCountingBloomFilter& operator=(const ShardedCountingBloomFilter&) = delete;
+  size_t Shard(const void* key, int len) const;
+
+  std::vector<std::unique_ptr<CountingBloomFilter<CType> > > shards_;
+};
+
+// Creates a per-variable sharded filter with counters wide enough for
+// threthold, see GlobalBloomFilter::Instance for the process wide one.
+BloomFilterBase* NewShardedBloomFilter(int32_t threthold, size_t shard_count,
+                                       double fpp, uint64_t element_size);
+
 class GlobalBloomFilter {
  public: 
   static void SetThrethold(int32_t threthold);
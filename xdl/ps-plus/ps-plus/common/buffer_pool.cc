@@ -0,0 +1,338 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/common/buffer_pool.h"
+#include "ps-plus/common/tensor_allocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+namespace ps {
+
+constexpr size_t BufferPool::kMinSize;
+constexpr size_t BufferPool::kMaxSize;
+constexpr int BufferPool::kClassCount;
+
+namespace {
+
+// The header before a buffer, which keeps the buffer 16 bytes aligned as
+// new char[] does
+struct Header {
+  int32_t cls;
+  uint32_t magic;
+  uint64_t capacity;
+};
+
+static_assert(sizeof(Header) == 16, "BufferPool header must be 16 bytes");
+
+const uint32_t kMagic = 0x50534250;
+// the class of the buffers mapped by the TensorAllocator
+const int32_t kMapped = -2;
+// The bytes a thread caches of each class, at least a buffer
+const size_t kThreadCacheBytes = 1 << 20;
+// The bytes moved between a thread cache and a shared list at once
+const size_t kBatchBytes = 256 << 10;
+
+// set once the cache of the thread is destroyed, the buffers freed by the
+// later thread_local destructors go to the heap
+thread_local bool cache_exited = false;
+
+inline Header* GetHeader(const char* buffer) {
+  return reinterpret_cast<Header*>(const_cast<char*>(buffer) - sizeof(Header));
+}
+
+inline char* NewRaw(int cls, size_t capacity) {
+  char* raw = new char[sizeof(Header) + capacity];
+  Header* header = reinterpret_cast<Header*>(raw);
+  header->cls = cls;
+  header->magic = kMagic;
+  header->capacity = capacity;
+  return raw;
+}
+
+inline size_t CacheCount(int cls) {
+  return std::max<size_t>(1, kThreadCacheBytes / BufferPool::ClassSize(cls));
+}
+
+inline size_t BatchCount(int cls) {
+  return std::max<size_t>(1, kBatchBytes / BufferPool::ClassSize(cls));
+}
+
+}  // namespace
+
+struct BufferPool::ThreadCache {
+  ThreadCache(BufferPool* pool_) : pool(pool_) {
+    pool->Register(this);
+  }
+  ~ThreadCache() {
+    pool->Unregister(this);
+    cache_exited = true;
+  }
+
+  BufferPool* pool;
+  // the raw buffers, with the header
+  std::vector<char*> buffers[kClassCount];
+  // written by the owner only, read by GetStats
+  std::atomic<int64_t> in_use_bytes{0};
+  std::atomic<int64_t> cached_bytes{0};
+  std::atomic<int64_t> hits{0};
+  std::atomic<int64_t> misses{0};
+};
+
+BufferPool::BufferPool(size_t max_cached_bytes)
+  : max_cached_bytes_(max_cached_bytes), central_bytes_(0),
+    exited_in_use_bytes_(0), exited_hits_(0), exited_misses_(0),
+    large_in_use_bytes_(0) {
+}
+
+BufferPool* BufferPool::Instance() {
+  // never destroyed, the thread caches may exit after the static objects
+  static BufferPool* pool = [] {
+    const char* mb = std::getenv("PS_BUFFER_POOL_MB");
+    return new BufferPool((mb == nullptr ? 256 : atol(mb)) << 20);
+  }();
+  return pool;
+}
+
+int BufferPool::Class(size_t size) {
+  if (size <= kMinSize) {
+    return 0;
+  }
+  if (size > kMaxSize) {
+    return -1;
+  }
+  uint64_t s = size - 1;
+  int e = 63 - __builtin_clzll(s);
+  int m = (s >> (e - 2)) & 3;
+  return 1 + (e - 6) * 4 + m;
+}
+
+size_t BufferPool::ClassSize(int cls) {
+  if (cls == 0) {
+    return kMinSize;
+  }
+  int e = (cls - 1) / 4 + 6;
+  int m = (cls - 1) % 4;
+  return (size_t)(5 + m) << (e - 2);
+}
+
+char* BufferPool::Allocate(size_t size) {
+  int cls = Class(size);
+  if (cls < 0) {
+    BufferPool* pool = Instance();
+    TensorAllocator* allocator = TensorAllocator::Instance();
+    if (allocator->Enabled() && size >= allocator->GetOptions().map_min_bytes) {
+      // the large tensors go on the huge pages
+      size_t mapped = 0;
+      char* raw = allocator->Map(sizeof(Header) + size, 0, &mapped);
+      if (raw == nullptr) {
+        throw std::bad_alloc();
+      }
+      Header* header = reinterpret_cast<Header*>(raw);
+      header->cls = kMapped;
+      header->magic = kMagic;
+      header->capacity = mapped - sizeof(Header);
+      pool->large_in_use_bytes_.fetch_add(header->capacity, std::memory_order_relaxed);
+      return raw + sizeof(Header);
+    }
+    pool->large_in_use_bytes_.fetch_add(size, std::memory_order_relaxed);
+    return NewRaw(-1, size) + sizeof(Header);
+  }
+  return Instance()->AllocateClass(cls) + sizeof(Header);
+}
+
+void BufferPool::Free(char* buffer) {
+  if (buffer == nullptr) {
+    return;
+  }
+  Header* header = GetHeader(buffer);
+  if (header->magic != kMagic) {
+    abort();
+  }
+  if (header->cls < 0) {
+    Instance()->large_in_use_bytes_.fetch_sub(header->capacity, std::memory_order_relaxed);
+    if (header->cls == kMapped) {
+      TensorAllocator::Unmap(reinterpret_cast<char*>(header), sizeof(Header) + header->capacity);
+    } else {
+      delete [] reinterpret_cast<char*>(header);
+    }
+    return;
+  }
+  Instance()->FreeClass(header->cls, reinterpret_cast<char*>(header));
+}
+
+size_t BufferPool::Capacity(const char* buffer) {
+  return GetHeader(buffer)->capacity;
+}
+
+BufferPool::ThreadCache* BufferPool::GetThreadCache() {
+  static thread_local ThreadCache cache(this);
+  return &cache;
+}
+
+char* BufferPool::AllocateClass(int cls) {
+  size_t size = ClassSize(cls);
+  if (cache_exited) {
+    exited_in_use_bytes_.fetch_add(size, std::memory_order_relaxed);
+    return NewRaw(cls, size);
+  }
+  ThreadCache* cache = GetThreadCache();
+  std::vector<char*>& buffers = cache->buffers[cls];
+  cache->in_use_bytes.store(cache->in_use_bytes.load(std::memory_order_relaxed) + size,
+                            std::memory_order_relaxed);
+  if (buffers.empty()) {
+    Central& central = central_[cls];
+    std::lock_guard<std::mutex> lock(central.mu);
+    size_t count = std::min(BatchCount(cls), central.buffers.size());
+    buffers.insert(buffers.end(), central.buffers.end() - count, central.buffers.end());
+    central.buffers.resize(central.buffers.size() - count);
+    central_bytes_.fetch_sub(count * size, std::memory_order_relaxed);
+    cache->cached_bytes.store(cache->cached_bytes.load(std::memory_order_relaxed) + count * size,
+                              std::memory_order_relaxed);
+  }
+  if (buffers.empty()) {
+    cache->misses.store(cache->misses.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+    return NewRaw(cls, size);
+  }
+  char* raw = buffers.back();
+  buffers.pop_back();
+  cache->cached_bytes.store(cache->cached_bytes.load(std::memory_order_relaxed) - size,
+                            std::memory_order_relaxed);
+  cache->hits.store(cache->hits.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+  return raw;
+}
+
+void BufferPool::FreeClass(int cls, char* raw) {
+  size_t size = ClassSize(cls);
+  if (cache_exited) {
+    exited_in_use_bytes_.fetch_sub(size, std::memory_order_relaxed);
+    delete [] raw;
+    return;
+  }
+  ThreadCache* cache = GetThreadCache();
+  std::vector<char*>& buffers = cache->buffers[cls];
+  cache->in_use_bytes.store(cache->in_use_bytes.load(std::memory_order_relaxed) - size,
+                            std::memory_order_relaxed);
+  buffers.push_back(raw);
+  int64_t cached = cache->cached_bytes.load(std::memory_order_relaxed) + size;
+  size_t limit = CacheCount(cls);
+  if (buffers.size() > limit) {
+    // move the older half to the shared list, the ones over its bytes to the heap
+    size_t count = std::max<size_t>(1, limit / 2);
+    Central& central = central_[cls];
+    std::lock_guard<std::mutex> lock(central.mu);
+    for (size_t i = 0; i < count; ++i) {
+      if (central_bytes_.load(std::memory_order_relaxed) + (int64_t)size <= max_cached_bytes_) {
+        central.buffers.push_back(buffers[i]);
+        central_bytes_.fetch_add(size, std::memory_order_relaxed);
+      } else {
+        delete [] buffers[i];
+      }
+    }
+    buffers.erase(buffers.begin(), buffers.begin() + count);
+    cached -= count * size;
+  }
+  cache->cached_bytes.store(cached, std::memory_order_relaxed);
+}
+
+void BufferPool::Register(ThreadCache* cache) {
+  std::lock_guard<std::mutex> lock(caches_mu_);
+  caches_.push_back(cache);
+}
+
+void BufferPool::Unregister(ThreadCache* cache) {
+  for (int cls = 0; cls < kClassCount; ++cls) {
+    size_t size = ClassSize(cls);
+    Central& central = central_[cls];
+    std::lock_guard<std::mutex> lock(central.mu);
+    for (char* raw: cache->buffers[cls]) {
+      if (central_bytes_.load(std::memory_order_relaxed) + (int64_t)size <= max_cached_bytes_) {
+        central.buffers.push_back(raw);
+        central_bytes_.fetch_add(size, std::memory_order_relaxed);
+      } else {
+        delete [] raw;
+      }
+    }
+    cache->buffers[cls].clear();
+  }
+  std::lock_guard<std::mutex> lock(caches_mu_);
+  exited_in_use_bytes_.fetch_add(cache->in_use_bytes.load(std::memory_order_relaxed),
+                                 std::memory_order_relaxed);
+  exited_hits_.fetch_add(cache->hits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  exited_misses_.fetch_add(cache->misses.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  caches_.erase(std::find(caches_.begin(), caches_.end(), cache));
+}
+
+BufferPool::Stats BufferPool::GetStats() {
+  Stats stats;
+  stats.in_use_bytes = exited_in_use_bytes_.load(std::memory_order_relaxed) +
+                       large_in_use_bytes_.load(std::memory_order_relaxed);
+  stats.cached_bytes = central_bytes_.load(std::memory_order_relaxed);
+  stats.hits = exited_hits_.load(std::memory_order_relaxed);
+  stats.misses = exited_misses_.load(std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(caches_mu_);
+  for (ThreadCache* cache: caches_) {
+    stats.in_use_bytes += cache->in_use_bytes.load(std::memory_order_relaxed);
+    stats.cached_bytes += cache->cached_bytes.load(std::memory_order_relaxed);
+    stats.hits += cache->hits.load(std::memory_order_relaxed);
+    stats.misses += cache->misses.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+std::string BufferPool::DumpStats() {
+  Stats stats = GetStats();
+  std::ostringstream os;
+  os << "BufferPool: in_use_bytes[" << stats.in_use_bytes << "] cached_bytes["
+     << stats.cached_bytes << "] hits[" << stats.hits << "] misses["
+     << stats.misses << "]\n";
+  for (int cls = 0; cls < kClassCount; ++cls) {
+    Central& central = central_[cls];
+    std::lock_guard<std::mutex> lock(central.mu);
+    if (!central.buffers.empty()) {
+      os << "BufferPool." << ClassSize(cls) << ": shared[" << central.buffers.size() << "]\n";
+    }
+  }
+  return os.str();
+}
+
+void BufferPool::Trim() {
+  if (cache_exited) {
+    return;
+  }
+  ThreadCache* cache = GetThreadCache();
+  int64_t cached = cache->cached_bytes.load(std::memory_order_relaxed);
+  for (int cls = 0; cls < kClassCount; ++cls) {
+    for (char* raw: cache->buffers[cls]) {
+      delete [] raw;
+    }
+    cached -= cache->buffers[cls].size() * ClassSize(cls);
+    cache->buffers[cls].clear();
+    Central& central = central_[cls];
+    std::lock_guard<std::mutex> lock(central.mu);
+    for (char* raw: central.buffers) {
+      delete [] raw;
+    }
+    central_bytes_.fetch_sub(central.buffers.size() * ClassSize(cls), std::memory_order_relaxed);
+    central.buffers.clear();
+  }
+  cache->cached_bytes.store(cached, std::memory_order_relaxed);
+}
+
+}  // namespace ps
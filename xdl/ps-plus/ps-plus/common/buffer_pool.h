@@ -0,0 +1,106 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_COMMON_BUFFER_POOL_H_
+#define PS_PLUS_COMMON_BUFFER_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ps {
+
+// Size classed pool of the payload buffers, the tensors and the serializer
+// buffers of the requests. The classes are four a power of two from 64
+// bytes to 4MB, so a buffer wastes at most a quarter of its size, and the
+// larger ones go to the heap, or the huge pages of the TensorAllocator.
+// Each thread caches the buffers it frees, the others are shared by a
+// locked list of each class, so the steady pull and push allocate from the
+// thread caches without a lock or a heap call.
+// A buffer may be freed by any thread.
+class BufferPool {
+ public:
+  static constexpr size_t kMinSize = 64;
+  static constexpr size_t kMaxSize = 4 << 20;
+  static constexpr int kClassCount = 65;
+
+  struct Stats {
+    // the class bytes of the buffers allocated and not freed
+    int64_t in_use_bytes;
+    // the bytes cached by the threads and the shared lists
+    int64_t cached_bytes;
+    // the allocations served from a cache and from the heap
+    int64_t hits;
+    int64_t misses;
+  };
+
+  struct Deleter {
+    void operator()(char* buffer) const { BufferPool::Free(buffer); }
+  };
+
+  // The shared lists cache PS_BUFFER_POOL_MB, 256 by default
+  static BufferPool* Instance();
+
+  static char* Allocate(size_t size);
+  // Free a buffer of Allocate, nullptr is ignored
+  static void Free(char* buffer);
+  // The usable size of a buffer of Allocate
+  static size_t Capacity(const char* buffer);
+
+  // The size of class, -1 for the sizes pooled by none
+  static int Class(size_t size);
+  static size_t ClassSize(int cls);
+
+  Stats GetStats();
+  // The stats and the cached buffers of the classes in use, one a line
+  std::string DumpStats();
+  // Free the buffers cached by the shared lists and the calling thread
+  void Trim();
+
+  struct ThreadCache;
+
+ private:
+  BufferPool(size_t max_cached_bytes);
+
+  struct Central {
+    std::mutex mu;
+    std::vector<char*> buffers;
+  };
+
+  char* AllocateClass(int cls);
+  void FreeClass(int cls, char* buffer);
+  ThreadCache* GetThreadCache();
+  void Register(ThreadCache* cache);
+  void Unregister(ThreadCache* cache);
+
+  const int64_t max_cached_bytes_;
+  Central central_[kClassCount];
+  std::atomic<int64_t> central_bytes_;
+  std::mutex caches_mu_;
+  std::vector<ThreadCache*> caches_;
+  // the stats of the exited threads
+  std::atomic<int64_t> exited_in_use_bytes_;
+  std::atomic<int64_t> exited_hits_;
+  std::atomic<int64_t> exited_misses_;
+  std::atomic<int64_t> large_in_use_bytes_;
+};
+
+}  // namespace ps
+
+#endif  // PS_PLUS_COMMON_BUFFER_POOL_H_
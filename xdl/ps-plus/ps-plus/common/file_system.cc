@@ -32,6 +32,39 @@ Status FileSystem::ReadStream::Read(void* buf, size_t size) {
     buffer_ptr_ += read;
     remain -= read;
     raw_buf += read;
+    offset_ += read;
+  }
+  return Status::Ok();
+}
+
+Status FileSystem::ReadStream::Skip(size_t size) {
+  if (buffer_ptr_ < buffer_size_) {
+    size_t buffered = std::min(size, (size_t)(buffer_size_ - buffer_ptr_));
+    buffer_ptr_ += buffered;
+    offset_ += buffered;
+    size -= buffered;
+  }
+  if (size == 0) {
+    return Status::Ok();
+  }
+  // the buffer is used up here, so the stream position is right after it
+  if (!(buffer_size_ >= 0 && buffer_size_ < (int)BUFFER_SIZE)) {
+    int64_t skipped = SkipSimple(size);
+    if (skipped == (int64_t)size) {
+      buffer_size_ = -1;
+      buffer_ptr_ = -1;
+      offset_ += size;
+      return Status::Ok();
+    }
+    if (skipped > 0) {
+      return Status::DataLoss("File Skip Error");
+    }
+  }
+  char buf[4096];
+  while (size > 0) {
+    size_t read = std::min(size, sizeof(buf));
+    PS_CHECK_STATUS(Read(buf, read));
+    size -= read;
   }
   return Status::Ok();
 }
@@ -172,6 +205,15 @@ Status FileSystem::RenameAny(const std::string& src_name, const std::string& dst
   return fs->Rename(src_name, dst_name);
 }
 
+Status FileSystem::OpenRandomAccessAny(const std::string& name, std::unique_ptr<RandomAccessFile>* result) {
+  FileSystem* fs;
+  PS_CHECK_STATUS(GetFileSystem(name, &fs));
+  RandomAccessFile* file;
+  PS_CHECK_STATUS(fs->OpenRandomAccess(name, &file));
+  result->reset(file);
+  return Status::Ok();
+}
+
 Status FileSystem::ReadStream::ReadStr(std::string* data) {
   size_t size;
   PS_CHECK_STATUS(ReadRaw(&size));
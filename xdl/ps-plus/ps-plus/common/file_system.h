@@ -31,13 +31,19 @@ class FileSystem {
  public:
   class ReadStream {
    public:
-    ReadStream() : close_(false), buffer_ptr_(-1), buffer_size_(-1) {}
+    ReadStream() : close_(false), buffer_ptr_(-1), buffer_size_(-1), offset_(0) {}
     virtual ~ReadStream() {Close();}
     Status Read(void* buf, size_t size);
     Status ReadBuffer();
     virtual int64_t ReadSimple(void* buf, size_t size) = 0;
+    // Skips size bytes past the buffer, returns the bytes skipped or -1
+    // when the stream can't seek, then Skip reads them.
+    virtual int64_t SkipSimple(size_t size) { return -1; }
     void Close();
     Status Eof(bool* eof);
+    Status Skip(size_t size);
+    // The bytes read or skipped since the stream was opened
+    size_t Tell() const { return offset_; }
 
     template <typename T>
     Status ReadRaw(T* data);
@@ -54,6 +60,16 @@ class FileSystem {
     char buffer_[BUFFER_SIZE];
     int buffer_ptr_;
     int buffer_size_;
+    size_t offset_;
+  };
+
+  // Positional reads of a file, for the readers that need a few ranges of a
+  // large file, such as the lazy restore of a checkpoint.
+  class RandomAccessFile {
+   public:
+    virtual ~RandomAccessFile() {}
+    // Reads exactly size bytes at offset
+    virtual Status Read(uint64_t offset, void* buf, size_t size) = 0;
   };
 
   class WriteStream {
@@ -88,6 +104,10 @@ class FileSystem {
   virtual Status ListDirectory(const std::string& name, std::vector<std::string>* results) = 0;
   virtual Status Remove(const std::string& name) = 0;
   virtual Status Rename(const std::string& src_name, const std::string& dst_name) = 0;
+  // NotImplemented by the file systems that only stream
+  virtual Status OpenRandomAccess(const std::string& name, RandomAccessFile** result) {
+    return Status::NotImplemented("RandomAccessFile is not supported for " + name);
+  }
 
   Status OpenReadStream(const std::string& name, std::unique_ptr<ReadStream>* result) {
     ReadStream* out;
@@ -112,6 +132,7 @@ class FileSystem {
   static Status ListDirectoryAny(const std::string& dir, std::vector<std::string>* files);
   static Status RemoveAny(const std::string& name);
   static Status RenameAny(const std::string& src_name, const std::string& dst_name);
+  static Status OpenRandomAccessAny(const std::string& name, std::unique_ptr<RandomAccessFile>* result);
 };
 
 template <typename T>
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <cstring>
 #include <cstdio>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <dirent.h>  
@@ -31,6 +32,9 @@ class FileFileSystem : public FileSystem {
     virtual int64_t ReadSimple(void* buf, size_t size) override {
       return fread(buf, 1, size, file_);
     }
+    virtual int64_t SkipSimple(size_t size) override {
+      return fseeko(file_, size, SEEK_CUR) == 0 ? size : -1;
+    }
    protected:
     virtual void CloseInternal() override {
       fclose(file_);
@@ -67,6 +71,37 @@ class FileFileSystem : public FileSystem {
     return Status::Ok();
   }
 
+  class FileRandomAccessFile : public RandomAccessFile {
+   public:
+    FileRandomAccessFile(int fd) : fd_(fd) {}
+    virtual ~FileRandomAccessFile() {close(fd_);}
+    virtual Status Read(uint64_t offset, void* buf, size_t size) override {
+      char* raw_buf = (char*)buf;
+      while (size > 0) {
+        ssize_t read = pread(fd_, raw_buf, size, offset);
+        if (read <= 0) {
+          return Status::DataLoss("File pread Error");
+        }
+        raw_buf += read;
+        offset += read;
+        size -= read;
+      }
+      return Status::Ok();
+    }
+   private:
+    int fd_;
+  };
+
+  virtual Status OpenRandomAccess(const std::string& name, RandomAccessFile** result) override {
+    std::string real_name = name.substr(0, 7) == "file://" ? name.substr(7) : name;
+    int fd = open(real_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return Status::Unknown("File open Error " + name);
+    }
+    *result = new FileRandomAccessFile(fd);
+    return Status::Ok();
+  }
+
   virtual Status OpenWriteStream(const std::string& name, WriteStream** result, bool append = false) override {
     std::string real_name = name.substr(0, 7) == "file://" ? name.substr(7) : name;
     auto pos = real_name.find_last_of('/');
@@ -36,6 +36,13 @@ class MemoryFileSystem : public FileSystem {
       offset_ += size;
       return size;
     }
+    virtual int64_t SkipSimple(size_t size) override {
+      if (offset_ + size > str_->size()) {
+        return -1;
+      }
+      offset_ += size;
+      return size;
+    }
    protected:
     virtual void CloseInternal() override {
     }
@@ -68,6 +75,29 @@ class MemoryFileSystem : public FileSystem {
     return Status::Ok();
   }
 
+  class MemoryRandomAccessFile : public RandomAccessFile {
+   public:
+    MemoryRandomAccessFile(std::string* str) : str_(str) {}
+    virtual Status Read(uint64_t offset, void* buf, size_t size) override {
+      if (offset + size > str_->size()) {
+        return Status::DataLoss("File exhausted");
+      }
+      memcpy(buf, str_->data() + offset, size);
+      return Status::Ok();
+    }
+   private:
+    std::string* str_;
+  };
+
+  virtual Status OpenRandomAccess(const std::string& name, RandomAccessFile** result) override {
+    std::unique_lock<std::mutex> lock(mu_);
+    if (strs_.find(name) == strs_.end()) {
+      return Status::NotFound("File Not Found");
+    }
+    *result = new MemoryRandomAccessFile(strs_[name].get());
+    return Status::Ok();
+  }
+
   virtual Status OpenWriteStream(const std::string& name, WriteStream** result, bool append = false) override {
     std::unique_lock<std::mutex> lock(mu_);
     if (strs_[name] == nullptr) {
@@ -16,8 +16,11 @@ limitations under the License.
 #include "global_file_queue.h"
 
 #include "ps-plus/common/logging.h"
+#include "ps-plus/common/reliable_kv.h"
 #include "ps-plus/common/status.h"
 
+#include <string.h>
+#include <algorithm>
 #include <string>
 #include <iostream>
 
@@ -28,13 +31,19 @@ using namespace ps;
 namespace ps {
 
 const int GlobalFileQueue::MAX_WORKER_COUNT = 10000;
+const size_t GlobalFileQueue::kShardCount = 64;
 
 GlobalFileQueue::GlobalFileQueue() 
-  : epochs_(1)
+  : shards_(new Shard[kShardCount])
+  , epochs_(1)
   , cur_epoch_(0)
   , cur_file_index_(0)
   , epoch_isolate_(false)
   , initialized_(false) {
+  used_files_.resize(MAX_WORKER_COUNT);
+  restored_files_.resize(MAX_WORKER_COUNT);
+  last_report_.resize(MAX_WORKER_COUNT);
+  lease_scales_.resize(MAX_WORKER_COUNT, 1.0);
 }
 
 GlobalFileQueue::~GlobalFileQueue() {
@@ -49,9 +58,6 @@ Status GlobalFileQueue::Init(
     epochs_ = epochs;
     epoch_isolate_ = epoch_isolate;
     files_ = paths;
-    used_files_.resize(MAX_WORKER_COUNT);
-    restored_files_.resize(MAX_WORKER_COUNT);
-    last_report_.resize(MAX_WORKER_COUNT);
     for (size_t i = 0; i < files_.size(); ++i) {
       file_index_[files_[i]] = i;
     }
@@ -62,41 +68,84 @@ Status GlobalFileQueue::Init(
   return Status::Ok();
 }
 
+size_t GlobalFileQueue::FileIndex(const std::string& path) const {
+  auto it = file_index_.find(path);
+  return it == file_index_.end() ? 0 : it->second;
+}
+
 Status GlobalFileQueue::GetNextFile(
     int worker_id , 
     WorkerState* file) {
-  std::unique_lock<std::mutex> lock(mu_);
+  std::vector<WorkerState> files;
+  PS_CHECK_STATUS(GetNextFiles(worker_id, 1, &files));
+  if (files.empty()) {
+    file->path_ = "";
+  } else {
+    *file = files[0];
+  }
+
+  return Status::Ok();
+}
+
+Status GlobalFileQueue::GetNextFiles(
+    int worker_id,
+    size_t count,
+    std::vector<WorkerState>* files) {
+  files->clear();
   if (!initialized_) {
     return Status::FileQueueNeedWait("not initialized");
   } 
 
+  if (worker_id < 0 || worker_id >= MAX_WORKER_COUNT) {
+    return Status::ArgumentError("worker_id exceed MAX_WORKER_COUNT:10000");
+  }
+
+  Shard& shard = shards_[worker_id % kShardCount];
+  std::unique_lock<std::mutex> shard_lock(shard.mu);
+  shard.dirty = true;
+  if (lease_scales_[worker_id] < 1.0) {
+    count = std::max<size_t>(1, count * lease_scales_[worker_id]);
+  }
   std::deque<WorkerState>& restored_files = restored_files_[worker_id];
-  if (!restored_files.empty()) {
-    *file = restored_files.front();
+  std::vector<FileInfo>& used_files = used_files_[worker_id];
+  while (!restored_files.empty() && files->size() < count) {
+    files->push_back(restored_files.front());
     restored_files.pop_front();
-    used_files_[worker_id].push_back(
-        FileInfo{.index_ = file_index_[file->path_],
-            .epoch_ = file->epoch_});
-  } else {
+    used_files.push_back(
+        FileInfo{.index_ = FileIndex(files->back().path_),
+            .epoch_ = files->back().epoch_});
+  }
+
+  if (files->size() == count) {
+    return Status::Ok();
+  }
+
+  std::unique_lock<std::mutex> lock(mu_);
+  while (files->size() < count) {
     if (cur_file_index_ >= files_.size()) {
-      if (cur_epoch_ + 1 == epochs_) {
-        file->path_ = "";
-        return Status::Ok();
+      if (cur_epoch_ + 1 >= (size_t)epochs_ || files_.empty()) {
+        break;
       }
 
       if (epoch_isolate_ && !IsAllWorkerFinishCurEpoch()) {
-        return Status::FileQueueNeedWait("not all worker finish current epoch");
+        if (files->empty()) {
+          return Status::FileQueueNeedWait("not all worker finish current epoch");
+        }
+
+        break;
       } 
       
       ++cur_epoch_;
       cur_file_index_ = 0;
     } 
 
-    file->path_ = files_[cur_file_index_];
-    file->begin_ = 0;
-    file->end_ = 0;
-    file->epoch_ = cur_epoch_;
-    used_files_[worker_id].push_back(
+    WorkerState file;
+    file.path_ = files_[cur_file_index_];
+    file.begin_ = 0;
+    file.end_ = 0;
+    file.epoch_ = cur_epoch_;
+    files->push_back(file);
+    used_files.push_back(
         FileInfo{.index_ = cur_file_index_,
             .epoch_ = cur_epoch_});
     ++cur_file_index_;
@@ -109,27 +158,46 @@ bool GlobalFileQueue::IsAllWorkerFinishCurEpoch() {
   return true;
 }
 
+Status GlobalFileQueue::SetLeaseScale(int worker_id, double scale) {
+  if (worker_id < 0 || worker_id >= MAX_WORKER_COUNT) {
+    return Status::ArgumentError("worker_id exceed MAX_WORKER_COUNT:10000");
+  }
+
+  Shard& shard = shards_[worker_id % kShardCount];
+  std::unique_lock<std::mutex> lock(shard.mu);
+  lease_scales_[worker_id] = std::min(std::max(scale, 0.0), 1.0);
+  return Status::Ok();
+}
+
 Status GlobalFileQueue::ReportWorkerState(
     int worker_id, 
     const std::vector<ps::WorkerState>& worker_states) {
-  if (worker_id >= MAX_WORKER_COUNT) {
+  if (worker_id < 0 || worker_id >= MAX_WORKER_COUNT) {
     return Status::ArgumentError("worker_id exceed MAX_WORKER_COUNT:10000");
   }
 
-  std::unique_lock<std::mutex> lock(mu_);
+  Shard& shard = shards_[worker_id % kShardCount];
+  std::unique_lock<std::mutex> lock(shard.mu);
+  shard.dirty = true;
   last_report_[worker_id] = worker_states;
   return Status::Ok();
 }
 
 Status GlobalFileQueue::RestoreWorkerState(
     int worker_id) {
+  if (worker_id < 0 || worker_id >= MAX_WORKER_COUNT) {
+    return Status::ArgumentError("worker_id exceed MAX_WORKER_COUNT:10000");
+  }
+
+  Shard& shard = shards_[worker_id % kShardCount];
+  std::unique_lock<std::mutex> lock(shard.mu);
+  shard.dirty = true;
   std::set<std::pair<size_t, size_t> > last_report;
   for (auto& worker_state: last_report_[worker_id]) {
-    last_report.insert({file_index_[worker_state.path_], 
+    last_report.insert({FileIndex(worker_state.path_), 
         worker_state.epoch_});
   }
 
-  std::unique_lock<std::mutex> lock(mu_);
   std::deque<WorkerState>& restored_files = 
     restored_files_[worker_id];
   restored_files.clear();  
@@ -158,6 +226,11 @@ Status GlobalFileQueue::RestoreWorkerState(
 }
 
 Status GlobalFileQueue::Serialize(std::string* buf) {
+  std::vector<std::unique_lock<std::mutex> > shard_locks;
+  for (size_t i = 0; i < kShardCount; ++i) {
+    shard_locks.emplace_back(shards_[i].mu);
+  }
+
   unique_lock<std::mutex> lock(mu_);
   buf->append((char*)&cur_epoch_, sizeof(size_t));
   buf->append((char*)&cur_file_index_, sizeof(size_t));  
@@ -187,6 +260,12 @@ void GlobalFileQueue::SerializeFileInfos(
 }
 
 Status GlobalFileQueue::Deserialize(const std::string& buf) {
+  std::vector<std::unique_lock<std::mutex> > shard_locks;
+  for (size_t i = 0; i < kShardCount; ++i) {
+    shard_locks.emplace_back(shards_[i].mu);
+    shards_[i].dirty = true;
+  }
+
   unique_lock<std::mutex> lock(mu_);
   char* ptr = const_cast<char*>(buf.data());
   cur_epoch_ = *(reinterpret_cast<size_t*>(ptr));  
@@ -198,6 +277,9 @@ Status GlobalFileQueue::Deserialize(const std::string& buf) {
       ptr, &last_report_);
   ptr += DeserializeWorkerStates<std::deque<WorkerState> >(
       ptr, &restored_files_);
+  used_files_.resize(MAX_WORKER_COUNT);
+  restored_files_.resize(MAX_WORKER_COUNT);
+  last_report_.resize(MAX_WORKER_COUNT);
   if (ptr - buf.data() == buf.size()) {
     return Status::Ok();
   }
@@ -229,4 +311,197 @@ size_t GlobalFileQueue::DeserializeFileInfos(
   return ptr - base;
 }
 
+void GlobalFileQueue::SerializeShard(size_t shard, std::string* buf) {
+  // the workers with state only, most of the MAX_WORKER_COUNT are idle
+  std::vector<size_t> workers;
+  for (size_t i = shard; i < (size_t)MAX_WORKER_COUNT; i += kShardCount) {
+    if (!used_files_[i].empty() || !last_report_[i].empty() ||
+        !restored_files_[i].empty()) {
+      workers.push_back(i);
+    }
+  }
+
+  size_t len = workers.size();
+  buf->append((char*)&len, sizeof(size_t));
+  for (size_t i: workers) {
+    buf->append((char*)&i, sizeof(size_t));
+    size_t used_len = used_files_[i].size();
+    buf->append((char*)&used_len, sizeof(size_t));
+    for (auto& it: used_files_[i]) {
+      buf->append((char*)&it.index_, sizeof(size_t));
+      buf->append((char*)&it.epoch_, sizeof(size_t));
+    }
+
+    SerializeStates(last_report_[i], buf);
+    SerializeStates(restored_files_[i], buf);
+  }
+}
+
+Status GlobalFileQueue::DeserializeShard(size_t shard, const std::string& buf) {
+  for (size_t i = shard; i < (size_t)MAX_WORKER_COUNT; i += kShardCount) {
+    used_files_[i].clear();
+    last_report_[i].clear();
+    restored_files_[i].clear();
+  }
+
+  char* ptr = const_cast<char*>(buf.data());
+  size_t len = *(reinterpret_cast<size_t*>(ptr));
+  ptr += sizeof(size_t);
+  for (size_t j = 0; j < len; ++j) {
+    size_t i = *(reinterpret_cast<size_t*>(ptr));
+    ptr += sizeof(size_t);
+    if (i >= (size_t)MAX_WORKER_COUNT || i % kShardCount != shard) {
+      return Status::DataLoss("global_file_queue shard deserialize error");
+    }
+
+    size_t used_len = *(reinterpret_cast<size_t*>(ptr));
+    ptr += sizeof(size_t);
+    for (size_t k = 0; k < used_len; ++k) {
+      FileInfo file_info;
+      file_info.index_ = *(reinterpret_cast<size_t*>(ptr));
+      ptr += sizeof(size_t);
+      file_info.epoch_ = *(reinterpret_cast<size_t*>(ptr));
+      ptr += sizeof(size_t);
+      used_files_[i].push_back(file_info);
+    }
+
+    ptr += DeserializeStates(ptr, &last_report_[i]);
+    ptr += DeserializeStates(ptr, &restored_files_[i]);
+  }
+
+  if (static_cast<size_t>(ptr - buf.data()) == buf.size()) {
+    return Status::Ok();
+  }
+
+  return Status::DataLoss("global_file_queue shard deserialize error");
+}
+
+Status GlobalFileQueue::Checkpoint(
+    const std::string& kv_addr,
+    const std::string& tag) {
+  std::unique_lock<std::mutex> checkpoint_lock(checkpoint_mu_);
+  // encode the changed shards under all the locks for a consistent state,
+  // the kv writes go on without them
+  std::vector<std::pair<size_t, std::string> > dirty_shards;
+  std::vector<int> slots(kShardCount);
+  std::string head;
+  {
+    std::vector<std::unique_lock<std::mutex> > shard_locks;
+    for (size_t i = 0; i < kShardCount; ++i) {
+      shard_locks.emplace_back(shards_[i].mu);
+    }
+
+    unique_lock<std::mutex> lock(mu_);
+    head.append((char*)&cur_epoch_, sizeof(size_t));
+    head.append((char*)&cur_file_index_, sizeof(size_t));
+    for (size_t i = 0; i < kShardCount; ++i) {
+      Shard& shard = shards_[i];
+      slots[i] = shard.slot;
+      if (shard.dirty) {
+        dirty_shards.emplace_back(i, std::string());
+        SerializeShard(i, &dirty_shards.back().second);
+        slots[i] = shard.slot == 0 ? 1 : 0;
+        shard.dirty = false;
+      }
+    }
+  }
+
+  size_t tag_len = tag.size();
+  head.append((char*)&tag_len, sizeof(size_t));
+  head.append(tag);
+  head.append((char*)slots.data(), sizeof(int) * kShardCount);
+
+  Status st = Status::Ok();
+  for (auto& it: dirty_shards) {
+    st = ReliableKV::WriteAny(
+        kv_addr + "/shard_" + std::to_string(it.first) + "_" +
+        std::to_string(slots[it.first]), it.second);
+    if (!st.IsOk()) {
+      break;
+    }
+  }
+
+  if (st.IsOk()) {
+    st = ReliableKV::WriteAny(kv_addr + "/head", head);
+  }
+
+  for (auto& it: dirty_shards) {
+    Shard& shard = shards_[it.first];
+    std::unique_lock<std::mutex> lock(shard.mu);
+    if (st.IsOk()) {
+      shard.slot = slots[it.first];
+    } else {
+      shard.dirty = true;
+    }
+  }
+
+  if (st.IsOk()) {
+    LOG(INFO) << "global_file_queue checkpoint " << tag << " to " << kv_addr
+              << ", " << dirty_shards.size() << " shards changed";
+  }
+
+  return st;
+}
+
+Status GlobalFileQueue::Recover(
+    const std::string& kv_addr,
+    const std::string& tag) {
+  std::unique_lock<std::mutex> checkpoint_lock(checkpoint_mu_);
+  std::string head;
+  PS_CHECK_STATUS(ReliableKV::ReadAny(kv_addr + "/head", &head));
+  if (head.size() < sizeof(size_t) * 3) {
+    return Status::DataLoss("global_file_queue checkpoint head error");
+  }
+
+  char* ptr = const_cast<char*>(head.data());
+  size_t cur_epoch = *(reinterpret_cast<size_t*>(ptr));
+  ptr += sizeof(size_t);
+  size_t cur_file_index = *(reinterpret_cast<size_t*>(ptr));
+  ptr += sizeof(size_t);
+  size_t tag_len = *(reinterpret_cast<size_t*>(ptr));
+  ptr += sizeof(size_t);
+  if (head.size() != sizeof(size_t) * 3 + tag_len + sizeof(int) * kShardCount) {
+    return Status::DataLoss("global_file_queue checkpoint head error");
+  }
+
+  std::string head_tag(ptr, tag_len);
+  ptr += tag_len;
+  if (head_tag != tag) {
+    return Status::NotFound("global_file_queue checkpoint " + tag +
+                            " not found, the last is " + head_tag);
+  }
+
+  std::vector<int> slots(kShardCount);
+  memcpy(slots.data(), ptr, sizeof(int) * kShardCount);
+  std::vector<std::string> shard_bufs(kShardCount);
+  for (size_t i = 0; i < kShardCount; ++i) {
+    if (slots[i] >= 0) {
+      PS_CHECK_STATUS(ReliableKV::ReadAny(
+          kv_addr + "/shard_" + std::to_string(i) + "_" +
+          std::to_string(slots[i]), &shard_bufs[i]));
+    }
+  }
+
+  std::vector<std::unique_lock<std::mutex> > shard_locks;
+  for (size_t i = 0; i < kShardCount; ++i) {
+    shard_locks.emplace_back(shards_[i].mu);
+  }
+
+  unique_lock<std::mutex> lock(mu_);
+  cur_epoch_ = cur_epoch;
+  cur_file_index_ = cur_file_index;
+  for (size_t i = 0; i < kShardCount; ++i) {
+    if (slots[i] >= 0) {
+      PS_CHECK_STATUS(DeserializeShard(i, shard_bufs[i]));
+    } else {
+      PS_CHECK_STATUS(DeserializeShard(i, std::string(sizeof(size_t), '\0')));
+    }
+
+    shards_[i].slot = slots[i];
+    shards_[i].dirty = false;
+  }
+
+  return Status::Ok();
+}
+
 } // namespace ps
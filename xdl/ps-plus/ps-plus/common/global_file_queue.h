@@ -25,6 +25,8 @@ limitations under the License.
 #include <thread>
 #include <atomic>
 #include <deque>
+#include <string>
+#include <vector>
 #include <unordered_map>
 
 #include "ps-plus/common/status.h"
@@ -32,6 +34,10 @@ limitations under the License.
 
 namespace ps {
 
+// The file queue shared by the workers of a job. The states of the workers
+// are sharded by worker_id so that the requests of the workers in different
+// shards only meet on the short cursor lock, and a worker may lease several
+// files by a request.
 class GlobalFileQueue {
 public:    
   GlobalFileQueue();
@@ -40,14 +46,28 @@ public:
               int epochs = 1, 
               bool epoch_isolate = false);
   Status GetNextFile(int worker_id, WorkerState* file);
+  // Lease up to count files to worker_id, files is empty at the end of the
+  // queue. The leased files are restored as the ones got one by one.
+  Status GetNextFiles(int worker_id, size_t count,
+                      std::vector<WorkerState>* files);
+  // The leases of worker_id are scaled down to at least one file, a slow
+  // worker leases less so that the others take the rest of the queue.
+  Status SetLeaseScale(int worker_id, double scale);
   Status ReportWorkerState(
       int worker_id, 
       const std::vector<WorkerState>& worker_states);
   Status RestoreWorkerState(int worker_id);
   Status Serialize(std::string* buf);
   Status Deserialize(const std::string& buf);
+  // Write the state to the ReliableKV at kv_addr, only the shards changed
+  // since the last checkpoint are written. A shard is written to the slot
+  // the head doesn't refer, so the state of the last head stays whole if
+  // the checkpoint fails midway. tag is stored in the head.
+  Status Checkpoint(const std::string& kv_addr, const std::string& tag);
+  // Read the state written by Checkpoint, NotFound if the tag of the head
+  // is not tag.
+  Status Recover(const std::string& kv_addr, const std::string& tag);
   bool IsInitialized() const {
-    std::unique_lock<std::mutex> lock(mu_);
     return initialized_;
   }
 
@@ -58,6 +78,18 @@ public:
     size_t epoch_;
   };
 
+  // The states of the workers of worker_id % kShardCount
+  struct Shard {
+    std::mutex mu;
+    // changed since the last checkpoint
+    bool dirty = true;
+    // the kv slot of the last checkpoint, -1 if not written
+    int slot = -1;
+  };
+
+  size_t FileIndex(const std::string& path) const;
+  void SerializeShard(size_t shard, std::string* buf);
+  Status DeserializeShard(size_t shard, const std::string& buf);
   void SerializeFileInfos(
     const std::vector<std::vector<FileInfo> >& file_infos,
     std::string* buf);
@@ -65,6 +97,8 @@ public:
   void SerializeWorkerStates(
       const std::vector<T>& worker_states,
       std::string* buf);
+  template <typename T>
+  static void SerializeStates(const T& states, std::string* buf);
   size_t DeserializeFileInfos(
       char* buf,
       std::vector<std::vector<FileInfo> >* file_infos);
@@ -72,22 +106,44 @@ public:
   size_t DeserializeWorkerStates(
       char* buf,
       std::vector<T>* file_infos);  
+  template <typename T>
+  static size_t DeserializeStates(char* buf, T* states);
 
  private:
   static const int MAX_WORKER_COUNT;
+  static const size_t kShardCount;
+  // guards the cursor, files_ and file_index_ are set once by Init
   mutable std::mutex mu_;
+  std::mutex checkpoint_mu_;
+  std::unique_ptr<Shard[]> shards_;
   std::vector<std::string> files_;
   std::unordered_map<std::string, size_t> file_index_;
   int epochs_;
   size_t cur_epoch_;
   size_t cur_file_index_;
   bool epoch_isolate_;
-  bool initialized_;
+  std::atomic<bool> initialized_;
   std::vector<std::vector<FileInfo> > used_files_;
   std::vector<std::vector<WorkerState> > last_report_;
   std::vector<std::deque<WorkerState> > restored_files_;
+  // guarded by the shard of the worker, not checkpointed
+  std::vector<double> lease_scales_;
 };
 
+template <typename T>
+void GlobalFileQueue::SerializeStates(const T& states, std::string* buf) {
+  size_t len = states.size();
+  buf->append((char*)&len, sizeof(size_t));    
+  for (auto& it: states) {
+    buf->append((char*)&it.begin_, sizeof(size_t));        
+    buf->append((char*)&it.end_, sizeof(size_t));        
+    buf->append((char*)&it.epoch_, sizeof(size_t));        
+    size_t path_len = it.path_.size();
+    buf->append((char*)&path_len, sizeof(size_t));            
+    buf->append(it.path_.data(), it.path_.size());                
+  }
+}
+
 template <typename T>
 void GlobalFileQueue::SerializeWorkerStates(
     const std::vector<T>& worker_states,
@@ -95,18 +151,32 @@ void GlobalFileQueue::SerializeWorkerStates(
   size_t len = worker_states.size();
   buf->append((char*)&len, sizeof(size_t));    
   for (size_t i = 0; i < len; ++i) {
-    auto& it = worker_states[i];
-    size_t sub_len = it.size();
-    buf->append((char*)&sub_len, sizeof(size_t));    
-    for (auto& sub_it: it) {
-      buf->append((char*)&sub_it.begin_, sizeof(size_t));        
-      buf->append((char*)&sub_it.end_, sizeof(size_t));        
-      buf->append((char*)&sub_it.epoch_, sizeof(size_t));        
-      size_t path_len = sub_it.path_.size();
-      buf->append((char*)&path_len, sizeof(size_t));            
-      buf->append(sub_it.path_.data(), sub_it.path_.size());                
-    }
+    SerializeStates(worker_states[i], buf);
+  }
+}
+
+template <typename T>
+size_t GlobalFileQueue::DeserializeStates(char* base, T* states) {
+  states->clear();
+  char* ptr = base;
+  size_t len = *(reinterpret_cast<size_t*>(ptr));
+  ptr += sizeof(size_t);
+  for (size_t j = 0; j < len; ++j) {
+    WorkerState worker_state;
+    worker_state.begin_ = *(reinterpret_cast<size_t*>(ptr));
+    ptr += sizeof(size_t);
+    worker_state.end_ = *(reinterpret_cast<size_t*>(ptr));
+    ptr += sizeof(size_t);
+    worker_state.epoch_ = *(reinterpret_cast<size_t*>(ptr));
+    ptr += sizeof(size_t);
+    size_t path_len = *(reinterpret_cast<size_t*>(ptr));
+    ptr += sizeof(size_t);
+    worker_state.path_.assign(ptr, path_len);
+    ptr += path_len;
+    states->push_back(worker_state);
   }
+
+  return ptr - base;
 }
 
 template <typename T>  
@@ -117,30 +187,14 @@ size_t GlobalFileQueue::DeserializeWorkerStates(
   char* ptr = base;
   size_t len = *(reinterpret_cast<size_t*>(ptr));
   ptr += sizeof(size_t);
+  worker_states->resize(len);
   for (size_t i = 0; i < len; ++i) {
-    worker_states->emplace_back();
-    size_t sub_len = *(reinterpret_cast<size_t*>(ptr));
-    ptr += sizeof(size_t);
-    for (size_t j = 0; j < sub_len; ++j) {
-      WorkerState worker_state;
-      worker_state.begin_ = *(reinterpret_cast<size_t*>(ptr));
-      ptr += sizeof(size_t);
-      worker_state.end_ = *(reinterpret_cast<size_t*>(ptr));
-      ptr += sizeof(size_t);
-      worker_state.epoch_ = *(reinterpret_cast<size_t*>(ptr));
-      ptr += sizeof(size_t);
-      size_t path_len = *(reinterpret_cast<size_t*>(ptr));
-      ptr += sizeof(size_t);
-      worker_state.path_.assign(ptr, path_len);
-      ptr += path_len;
-      (*worker_states)[i].push_back(worker_state);
-    }
+    ptr += DeserializeStates(ptr, &(*worker_states)[i]);
   }
 
   return ptr - base;
 }
 
-
 } // namespace ps
 
 #endif // PS_SCHEDULER_GLOBAL_FILE_QUEUE_H_
@@ -0,0 +1,166 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/common/gradient_codec.h"
+#include "ps-plus/common/reduced_precision.h"
+#include "ps-plus/common/string_utils.h"
+#include "ps-plus/common/initializer/none_initializer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace ps {
+
+namespace {
+
+struct TopKEntry {
+  int32_t col;
+  float value;
+};
+
+StoragePrecision ToPrecision(GradientCodec::Type type) {
+  return type == GradientCodec::kFp16 ? StoragePrecision::kFp16 : StoragePrecision::kInt8;
+}
+
+}
+
+Status GradientCodec::Parse(const std::string& spec, GradientCodec* codec) {
+  codec->ratio_ = 1;
+  if (spec == "" || spec == "none") {
+    codec->type_ = kNone;
+  } else if (spec == "fp16") {
+    codec->type_ = kFp16;
+  } else if (spec == "int8") {
+    codec->type_ = kInt8;
+  } else if (spec.compare(0, 5, "topk:") == 0) {
+    double ratio;
+    if (!StringUtils::strToDouble(spec.c_str() + 5, ratio) || !(ratio > 0 && ratio <= 1)) {
+      return Status::ArgumentError("Gradient codec topk ratio should be in (0, 1], got " + spec);
+    }
+    codec->type_ = kTopK;
+    codec->ratio_ = ratio;
+  } else {
+    return Status::ArgumentError("Unknown gradient codec " + spec);
+  }
+  return Status::Ok();
+}
+
+size_t GradientCodec::TopK(size_t cols) const {
+  return std::min(cols, std::max<size_t>(1, std::ceil(ratio_ * cols)));
+}
+
+Status GradientCodec::Encode(const Tensor& grad, Tensor* encoded, Tensor* residual) const {
+  if (grad.Type() != DataType::kFloat) {
+    return Status::ArgumentError("Gradient codec only encodes float gradients");
+  }
+  if (grad.Shape().IsScalar()) {
+    return Status::ArgumentError("Gradient codec doesn't encode scalars");
+  }
+  size_t rows = grad.Shape()[0];
+  size_t cols = rows == 0 ? 0 : grad.Shape().NumElements() / rows;
+  size_t row_bytes;
+  switch (type_) {
+  case kFp16:
+  case kInt8:
+    row_bytes = EncodedRowBytes(ToPrecision(type_), cols);
+    break;
+  case kTopK:
+    row_bytes = TopK(cols) * sizeof(TopKEntry);
+    break;
+  default:
+    *encoded = grad;
+    return Status::Ok();
+  }
+  *encoded = Tensor(DataType::kInt8, TensorShape({rows, row_bytes}), new initializer::NoneInitializer);
+  if (residual != nullptr) {
+    *residual = Tensor(DataType::kFloat, grad.Shape(), new initializer::NoneInitializer);
+  }
+  std::vector<float> decoded(cols);
+  std::vector<int32_t> order(cols);
+  for (size_t i = 0; i < rows; i++) {
+    const float* src = grad.Raw<float>(i);
+    char* dst = encoded->Raw<char>() + i * row_bytes;
+    if (type_ == kTopK) {
+      size_t k = TopK(cols);
+      std::iota(order.begin(), order.end(), 0);
+      std::nth_element(order.begin(), order.begin() + k - 1, order.end(), [src](int32_t a, int32_t b) {
+            return std::fabs(src[a]) > std::fabs(src[b]);
+          });
+      std::fill(decoded.begin(), decoded.end(), 0);
+      TopKEntry* entries = reinterpret_cast<TopKEntry*>(dst);
+      for (size_t j = 0; j < k; j++) {
+        entries[j].col = order[j];
+        entries[j].value = src[order[j]];
+        decoded[order[j]] = src[order[j]];
+      }
+    } else {
+      EncodeRow(ToPrecision(type_), src, cols, dst, nullptr);
+      DecodeRow(ToPrecision(type_), dst, cols, decoded.data());
+    }
+    if (residual != nullptr) {
+      float* lost = residual->Raw<float>(i);
+      for (size_t j = 0; j < cols; j++) {
+        lost[j] = src[j] - decoded[j];
+      }
+    }
+  }
+  return Status::Ok();
+}
+
+Status GradientCodec::Decode(Type type, size_t cols, const Tensor& encoded, Tensor* grad) {
+  if (type == kNone) {
+    *grad = encoded;
+    return Status::Ok();
+  }
+  if (encoded.Type() != DataType::kInt8 || encoded.Shape().Size() != 2) {
+    return Status::ArgumentError("Encoded gradient should be a 2-D int8 tensor");
+  }
+  size_t rows = encoded.Shape()[0];
+  size_t row_bytes = encoded.Shape()[1];
+  if (type == kTopK) {
+    if (row_bytes % sizeof(TopKEntry) != 0 || row_bytes / sizeof(TopKEntry) > cols) {
+      return Status::ArgumentError("Encoded topk gradient has a bad row size");
+    }
+  } else if (type == kFp16 || type == kInt8) {
+    if (row_bytes != EncodedRowBytes(ToPrecision(type), cols)) {
+      return Status::ArgumentError("Encoded gradient has a bad row size");
+    }
+  } else {
+    return Status::ArgumentError("Unknown gradient codec " + std::to_string(type));
+  }
+  *grad = Tensor(DataType::kFloat, TensorShape({rows, cols}), new initializer::NoneInitializer);
+  for (size_t i = 0; i < rows; i++) {
+    const char* src = encoded.Raw<char>() + i * row_bytes;
+    float* dst = grad->Raw<float>(i);
+    if (type == kTopK) {
+      memset(dst, 0, cols * sizeof(float));
+      const TopKEntry* entries = reinterpret_cast<const TopKEntry*>(src);
+      for (size_t j = 0; j < row_bytes / sizeof(TopKEntry); j++) {
+        if (entries[j].col < 0 || (size_t)entries[j].col >= cols) {
+          return Status::ArgumentError("Encoded topk gradient has a bad column");
+        }
+        dst[entries[j].col] = entries[j].value;
+      }
+    } else {
+      DecodeRow(ToPrecision(type), src, cols, dst);
+    }
+  }
+  return Status::Ok();
+}
+
+}
+
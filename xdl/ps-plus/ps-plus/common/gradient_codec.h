@@ -0,0 +1,61 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_COMMON_GRADIENT_CODEC_H_
+#define PS_PLUS_COMMON_GRADIENT_CODEC_H_
+
+#include "ps-plus/common/status.h"
+#include "ps-plus/common/tensor.h"
+
+#include <string>
+
+namespace ps {
+
+// Wire format of pushed float gradients. Every row is encoded on its own,
+// so encoded rows are split between servers like the gradient rows.
+// kFp16 keeps one half per element, kInt8 a float scale followed by one int8
+// per element, kTopK the k largest elements of the row as (int32 column,
+// float value) pairs.
+class GradientCodec {
+ public:
+  enum Type : int32_t {
+    kNone = 0,
+    kFp16 = 1,
+    kInt8 = 2,
+    kTopK = 3
+  };
+
+  GradientCodec() : type_(kNone), ratio_(1) {}
+
+  // "", "none", "fp16", "int8" or "topk:<ratio of the row kept>"
+  static Status Parse(const std::string& spec, GradientCodec* codec);
+
+  Type GetType() const { return type_; }
+
+  // residual gets what the encoding lost when it is not nullptr.
+  Status Encode(const Tensor& grad, Tensor* encoded, Tensor* residual) const;
+  static Status Decode(Type type, size_t cols, const Tensor& encoded, Tensor* grad);
+
+ private:
+  size_t TopK(size_t cols) const;
+
+  Type type_;
+  double ratio_;
+};
+
+}
+
+#endif
+
@@ -20,7 +20,7 @@ limitations under the License.
 
 namespace ps {
 
-HashMap::HashMap() : offset_(0), urd(0.0, 1.0), max_count_(0) {
+HashMap::HashMap() : offset_(0), max_count_(0) {
 }
 
 HashMap::~HashMap() {
@@ -34,6 +34,10 @@ void HashMap::SetBloomFilterThrethold(int32_t max_count) {
   max_count_ = max_count;
 }
 
+void HashMap::SetBloomFilter(BloomFilterBase* filter) {
+  bloom_filter_.reset(filter);
+}
+
 std::ostream& operator<<(std::ostream& os, const Hash128Key& key) {
   os << key.hash1 << "," << key.hash2;
   return os;
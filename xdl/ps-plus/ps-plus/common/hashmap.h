@@ -17,10 +17,12 @@ limitations under the License.
 #define PS_COMMON_HASHMAP_H
 
 #include <vector>
+#include <algorithm>
 #include <atomic>
 #include <deque>
 #include <mutex>
 #include <random>
+#include <memory>
 #include <iostream>
 #include <assert.h>
 #include <unordered_set>
@@ -55,6 +57,37 @@ struct HashMapStruct {
   tbb::concurrent_vector<HashMapItem<T> > items;
   std::atomic<int64_t> count;
 };
+
+// The key of every id, kept by a hashmap once TrackKeys was called so that
+// rows can be erased by id without walking the table. Stale entries of
+// erased ids are left, the hashmap checks the key still maps to the id.
+template<typename T>
+class IdKeys {
+ public:
+  IdKeys() : tracking_(false) {}
+  bool Tracking() const { return tracking_.load(std::memory_order_relaxed); }
+  void Start() { tracking_.store(true, std::memory_order_release); }
+  // ids are owned by one inserter, so the distinct ids may be set in parallel
+  void Set(size_t id, const T& key) {
+    if (id >= keys_.size()) {
+      keys_.grow_to_at_least(id + 1);
+    }
+    keys_[id] = key;
+  }
+  bool Get(size_t id, T* key) const {
+    if (id >= keys_.size()) {
+      return false;
+    }
+    *key = keys_[id];
+    return true;
+  }
+  size_t Bytes() const {
+    return keys_.size() * sizeof(T);
+  }
+ private:
+  std::atomic<bool> tracking_;
+  tbb::concurrent_vector<T> keys_;
+};
 }
 
 namespace tbb {
@@ -95,18 +128,59 @@ class HashMap {
   virtual int64_t Get(const int64_t* keys, size_t size, bool not_insert, float add_probability, std::vector<size_t>* ids, tbb::concurrent_vector<size_t>* reused_ids, size_t* filtered_keys, size_t block_size = 500) = 0;
   virtual void Erase(const int64_t* keys, size_t size) = 0;
   virtual size_t EraseById(const std::string& variable_name, const std::vector<size_t>& ids, tbb::concurrent_vector<size_t>* unfiltered_ids) = 0;
+  // Keeps the key of every id from now on, so that EraseIds only costs the
+  // erased ids. Walks the table once, needs the inserts blocked.
+  virtual void TrackKeys() = 0;
+  virtual bool TrackingKeys() = 0;
+  // Erases the rows of ids, the ids without a key are skipped and the erased
+  // ones appended to erased if not null. Walks the table unless the keys are
+  // tracked. Needs the readers blocked.
+  virtual size_t EraseIds(const std::vector<size_t>& ids, std::vector<size_t>* erased) = 0;
   void SetBloomFilterThrethold(int32_t max_count);  
+  // Use a filter owned by this hashmap instead of GlobalBloomFilter.
+  void SetBloomFilter(BloomFilterBase* filter);
   static const size_t NOT_ADD_ID;
   static const float FLOAT_EPSILON;
-  std::default_random_engine dre;
-  std::uniform_real_distribution<float> urd;
   size_t GetSize() {return offset_;}
+  // the ids given to keys, less the freed ones
+  size_t KeyCount() {
+    size_t freed = free_list_.unsafe_size();
+    size_t offset = offset_;
+    return offset > freed ? offset - freed : 0;
+  }
+  // Estimated memory of the table and the tracked keys, not of the rows.
+  virtual size_t MemoryBytes() = 0;
   virtual size_t GetBucketCount(const std::string& variable_name) = 0;
  protected:
   bool FloatEqual(float v1, float v2);
+  // Uniform float in [0, 1) from a per-thread generator.
+  static inline float ThreadLocalUniform() {
+    static thread_local uint64_t state = 0;
+    if (state == 0) {
+      std::random_device rd;
+      state = ((uint64_t)rd() << 32 | rd()) | 1;
+    }
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return ((state * 0x2545F4914F6CDD1DULL) >> 40) * (1.0f / (1 << 24));
+  }
+  // Feature admission for a new key: keep it with add_probability and, if a
+  // bloom filter threthold is set, only once it has been seen max_count_ times.
+  inline bool Admit(const void* key, int len, float add_probability) {
+    if (!FloatEqual(add_probability, 1.0) && ThreadLocalUniform() > add_probability) {
+      return false;
+    }
+    if (max_count_ == 0) {
+      return true;
+    }
+    BloomFilterBase* filter = bloom_filter_ != nullptr ? bloom_filter_.get() : GlobalBloomFilter::Instance();
+    return filter->InsertedLookup(key, len, max_count_);
+  }
   std::atomic<size_t> offset_;
   tbb::concurrent_queue<size_t> free_list_;
   int32_t max_count_;
+  std::unique_ptr<BloomFilterBase> bloom_filter_;
 };
 
 template <typename KeyType> class HashMapImpl : public HashMap {
@@ -127,8 +201,7 @@ template <typename KeyType> class HashMapImpl : public HashMap {
               (*ids)[i] = iter->second;
               //only not_insert is false(pull request), we use add_probability or bloom filter;
             } else if (!not_insert) {
-              if ((FloatEqual(add_probability, 1.0) || urd(dre) <= add_probability)
-                && (max_count_ == 0 || GlobalBloomFilter::Instance()->InsertedLookup(&key, sizeof(key), max_count_))
+              if (Admit(&key, sizeof(key), add_probability)
                 && (black_list_ == nullptr || black_list_->find(key) == black_list_->end())
                 && (white_list_ == nullptr || white_list_->find(key) != white_list_->end())) {
                 auto insert = table_.insert(std::make_pair(key, 0));
@@ -142,6 +215,9 @@ template <typename KeyType> class HashMapImpl : public HashMap {
                     (*ids)[i] = offset_++;
                     insert.first->second = (*ids)[i];
                   }
+                  if (id_keys_.Tracking()) {
+                    id_keys_.Set((*ids)[i], key);
+                  }
                 } else {
                   (*ids)[i] = insert.first->second;
                 }
@@ -172,6 +248,12 @@ template <typename KeyType> class HashMapImpl : public HashMap {
     }
   }
 
+  // a node of the split ordered list per key, a pointer per bucket
+  virtual size_t MemoryBytes() {
+    return table_.size() * (sizeof(typename HashTable::value_type) + 2 * sizeof(void*))
+        + table_.unsafe_bucket_count() * sizeof(void*) + id_keys_.Bytes();
+  }
+
   virtual size_t GetBucketCount(const std::string& variable_name) {
     /*
     LOG_INFO("%s, load_factor %f, max_load_factor %f", variable_name.c_str(), table_.load_factor(), table_.max_load_factor());
@@ -232,6 +314,59 @@ template <typename KeyType> class HashMapImpl : public HashMap {
     return size;
   }
 
+  virtual void TrackKeys() {
+    if (id_keys_.Tracking()) {
+      return;
+    }
+    tbb::parallel_for_each(begin(table_), end(table_), [&](const std::pair<KeyType, size_t>& pr) {
+      id_keys_.Set(pr.second, pr.first);
+    });
+    id_keys_.Start();
+  }
+
+  virtual bool TrackingKeys() {
+    return id_keys_.Tracking();
+  }
+
+  virtual size_t EraseIds(const std::vector<size_t>& ids, std::vector<size_t>* erased) {
+    std::vector<KeyType> keys;
+    std::vector<size_t> key_ids;
+    if (id_keys_.Tracking()) {
+      for (size_t id : ids) {
+        KeyType key;
+        if (!id_keys_.Get(id, &key)) {
+          continue;
+        }
+        auto iter = table_.find(key);
+        if (iter != table_.end() && iter->second == id) {
+          keys.push_back(key);
+          key_ids.push_back(id);
+        }
+      }
+    } else {
+      std::vector<size_t> sorted(ids);
+      std::sort(sorted.begin(), sorted.end());
+      tbb::concurrent_vector<HashMapItem<KeyType> > items;
+      tbb::parallel_for_each(begin(table_), end(table_), [&](const std::pair<KeyType, size_t>& pr) {
+        if (std::binary_search(sorted.begin(), sorted.end(), pr.second)) {
+          items.push_back(HashMapItem<KeyType>{.key=pr.first, .id=pr.second});
+        }
+      });
+      for (auto&& item : items) {
+        keys.push_back(item.key);
+        key_ids.push_back(item.id);
+      }
+    }
+    for (size_t i = 0; i < keys.size(); i++) {
+      table_.unsafe_erase(keys[i]);
+      free_list_.push(key_ids[i]);
+    }
+    if (erased != nullptr) {
+      erased->insert(erased->end(), key_ids.begin(), key_ids.end());
+    }
+    return keys.size();
+  }
+
  //只应调用偏特化版本
  inline void GetKey(const int64_t* keys, int index, KeyType* result) {
    throw std::invalid_argument("GetKey for HashMap base should not be called");    
@@ -279,6 +414,7 @@ template <typename KeyType> class HashMapImpl : public HashMap {
 
  private:
   HashTable table_;
+  IdKeys<KeyType> id_keys_;
   std::unique_ptr<NonCocurrentHashTable> black_list_, white_list_;
   QRWLock lock_;
 };
@@ -37,6 +37,14 @@ void Initializer::MultiThreadInit(void* data, DataType type, size_t size) {
   }
 }
 
+void Initializer::InitAt(void* data, DataType type, size_t size, size_t offset) {
+  Init(data, type, size);
+}
+
+void Initializer::MultiThreadInitAt(void* data, DataType type, size_t size, size_t offset) {
+  MultiThreadInit(data, type, size);
+}
+
 }
 
 
@@ -26,6 +26,12 @@ public:
   virtual bool Accept(DataType type);
   virtual void Init(void* data, DataType type, size_t size) = 0;
   virtual void MultiThreadInit(void* data, DataType type, size_t size);
+  // Init the elements [offset, offset + size) of a tensor at data. The
+  // random initializers draw them from a stream keyed by the offset, so a
+  // row gets the same values whichever thread or chunk inits it, the
+  // others ignore offset.
+  virtual void InitAt(void* data, DataType type, size_t size, size_t offset);
+  virtual void MultiThreadInitAt(void* data, DataType type, size_t size, size_t offset);
   virtual Initializer* Clone() = 0;
 };
 
@@ -0,0 +1,46 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/common/initializer/encoded_constant_initializer.h"
+
+#include <cstring>
+#include <vector>
+
+namespace ps {
+namespace initializer {
+
+void EncodedConstantInitializer::Init(void* data, DataType type, size_t size) {
+  size_t row_bytes = EncodedRowBytes(precision_, slice_size_);
+  std::vector<float> values(slice_size_, c_);
+  std::vector<char> row(row_bytes);
+  EncodeRow(precision_, values.data(), slice_size_, row.data(), nullptr);
+  char* ptr = reinterpret_cast<char*>(data);
+  size_t bytes = size * SizeOfType(type);
+  for (size_t i = 0; i + row_bytes <= bytes; i += row_bytes) {
+    memcpy(ptr + i, row.data(), row_bytes);
+  }
+}
+
+void EncodedConstantInitializer::MultiThreadInit(void* data, DataType type, size_t size) {
+  Init(data, type, size);
+}
+
+Initializer* EncodedConstantInitializer::Clone() {
+  return new EncodedConstantInitializer(precision_, c_, slice_size_);
+}
+
+}
+}
+
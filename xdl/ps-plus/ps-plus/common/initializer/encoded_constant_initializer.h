@@ -0,0 +1,46 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_COMMON_INITIALIZER_ENCODED_CONSTANT_INITIALIZER_H_
+#define PS_PLUS_COMMON_INITIALIZER_ENCODED_CONSTANT_INITIALIZER_H_
+
+#include "ps-plus/common/initializer.h"
+#include "ps-plus/common/reduced_precision.h"
+
+namespace ps {
+namespace initializer {
+
+// Fill rows of slice_size elements encoded in reduced precision with constant c.
+// Init must see whole rows, so MultiThreadInit does not split the buffer.
+class EncodedConstantInitializer : public Initializer {
+ public:
+  EncodedConstantInitializer(StoragePrecision precision, double c, size_t slice_size)
+    : precision_(precision), c_(c), slice_size_(slice_size) {}
+  virtual void Init(void* data, DataType type, size_t size);
+  virtual void MultiThreadInit(void* data, DataType type, size_t size);
+  virtual Initializer* Clone();
+  StoragePrecision precision() const { return precision_; }
+  size_t slice_size() const { return slice_size_; }
+ private:
+  StoragePrecision precision_;
+  double c_;
+  size_t slice_size_;
+};
+
+}
+}
+
+#endif
+
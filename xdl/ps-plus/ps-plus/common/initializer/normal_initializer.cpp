@@ -21,7 +21,6 @@ limitations under the License.
 #include <memory>
 
 #include "ps-plus/common/types.h"
-#include "random/random.h"
 #include "random/random_ops.h"
 
 namespace ps {
@@ -42,20 +41,16 @@ bool NormalInitializer::Accept(DataType type) {
   return false;
 }
 
-void NormalInitializer::Init(void* data, 
-                                      DataType type, 
-                                      size_t size) {
-  int seed1 = 0;
-  int seed2 = 0;
-  int* seed = seed_ == -1? nullptr: &seed_;
-  Random::GetSeed(seed, &seed1, &seed2);
-  std::unique_ptr<PhiloxRandomOp> op(new PhiloxRandomOp(seed1, seed2));
+void NormalInitializer::InitAt(void* data, 
+                               DataType type, 
+                               size_t size,
+                               size_t offset) {
   if (type == DataType::kFloat) {
-    op->Fill<NormalDistribution<PhiloxRandom,float> >(
-        size, data);
+    FillPhiloxRandomAt(Generator(), reinterpret_cast<float*>(data), offset,
+                       size, NormalDistribution<PhiloxRandom, float>());
   } else {
-    op->Fill<NormalDistribution<PhiloxRandom,double> >(
-        size, data);
+    FillPhiloxRandomAt(Generator(), reinterpret_cast<double*>(data), offset,
+                       size, NormalDistribution<PhiloxRandom, double>());
   }
 
   CASES(type, do {
@@ -67,9 +62,11 @@ void NormalInitializer::Init(void* data,
 }
 
 Initializer* NormalInitializer::Clone() {
-  return new NormalInitializer(seed_, 
-                                        mean_, 
-                                        stddev_);
+  NormalInitializer* ret = new NormalInitializer(seed_, 
+                                                 mean_, 
+                                                 stddev_);
+  ret->CopyKey(*this);
+  return ret;
 }
 
 } //namespace initializer
@@ -59,7 +59,7 @@ void OrthogonalInitializer::Init(void* data,
     abort();
   }
 
-  normal_initializer_->Init(data, type, size);
+  normal_initializer_->MultiThreadInit(data, type, size);
   int64_t row = size / dim_;
   int64_t col = dim_;
   if (type == DataType::kFloat) {
@@ -97,6 +97,12 @@ void OrthogonalInitializer::Init(void* data,
   }
 }
 
+void OrthogonalInitializer::MultiThreadInit(void* data, 
+                                            DataType type, 
+                                            size_t size) {
+  Init(data, type, size);
+}
+
 Initializer* OrthogonalInitializer::Clone() {
   return new OrthogonalInitializer(
       dim_, seed_, gain_);
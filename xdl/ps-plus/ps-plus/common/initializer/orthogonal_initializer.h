@@ -29,6 +29,8 @@ class OrthogonalInitializer: public Initializer {
   OrthogonalInitializer(int64_t dim, int seed = 0, float gain = 1.0);
   bool Accept(DataType type) override;
   void Init(void* data, DataType type, size_t size) override;
+  // The svd needs the whole matrix, so the buffer is not split
+  void MultiThreadInit(void* data, DataType type, size_t size) override;
   Initializer* Clone() override;
 
  private:
@@ -378,6 +378,39 @@ inline void BoxMullerFloat(uint32 x0, uint32 x1, float* f0, float* f1) {
   *f1 *= u2;
 }
 
+// BoxMullerFloat of the pairs (x[i], x[i + 1]) of x into f[i], f[i + 1],
+// n is even. The steps run as separate loops over the pairs of a block, so
+// each of them vectorizes, and the results are the same as BoxMullerFloat.
+inline void BoxMullerFloatBlock(const uint32* x, float* f, int64 n) {
+  static const int kBlockPairs = 128;
+  const float epsilon = 1.0e-7f;
+  float u[kBlockPairs];
+  float v[kBlockPairs];
+  for (int64 begin = 0; begin < n; begin += 2 * kBlockPairs) {
+    const int pairs = std::min<int64>(kBlockPairs, (n - begin) / 2);
+    const uint32* xb = x + begin;
+    float* fb = f + begin;
+    for (int i = 0; i < pairs; ++i) {
+      const float u1 = Uint32ToFloat(xb[2 * i]);
+      u[i] = u1 < epsilon ? epsilon : u1;
+      v[i] = 2.0f * M_PI * Uint32ToFloat(xb[2 * i + 1]);
+    }
+    for (int i = 0; i < pairs; ++i) {
+      u[i] = sqrt(-2.0f * log(u[i]));
+    }
+    for (int i = 0; i < pairs; ++i) {
+#if defined(__linux__)
+      sincosf(v[i], &fb[2 * i], &fb[2 * i + 1]);
+#else
+      fb[2 * i] = sinf(v[i]);
+      fb[2 * i + 1] = cosf(v[i]);
+#endif
+      fb[2 * i] *= u[i];
+      fb[2 * i + 1] *= u[i];
+    }
+  }
+}
+
 // Helper function to convert four 32-bit uniform integers to two doubles
 // under the unit normal distribution.
 inline void BoxMullerDouble(uint32 x0, uint32 x1, uint32 x2, uint32 x3, double* d0,
@@ -123,6 +123,113 @@ void FillPhiloxRandom<Distribution>::operator()(PhiloxRandom gen,
                                                   0, limit_group, dist);
 };
 
+// Fills whole groups [start_group, limit_group) of the stream of base_gen
+// into data, sampled one group after another.
+template <class Distribution, bool VariableSamplesPerOutput>
+struct FillPhiloxGroups;
+
+template <class Distribution>
+struct FillPhiloxGroups<Distribution, false> {
+  typedef typename Distribution::ResultElementType T;
+  static void Run(PhiloxRandom base_gen, T* data, int64 start_group,
+                  int64 limit_group, Distribution dist) {
+    const int kGroupSize = Distribution::kResultElementCount;
+    PhiloxRandom gen = base_gen;
+    gen.Skip(start_group);
+    for (int64 index = start_group; index < limit_group; ++index) {
+      auto samples = dist(&gen);
+      std::copy(&samples[0], &samples[0] + kGroupSize, data);
+      data += kGroupSize;
+    }
+  }
+};
+
+template <class Distribution>
+struct FillPhiloxGroups<Distribution, true> {
+  typedef typename Distribution::ResultElementType T;
+  static void Run(PhiloxRandom base_gen, T* data, int64 start_group,
+                  int64 limit_group, Distribution dist) {
+    const int kGroupSize = Distribution::kResultElementCount;
+    static const int64 kGeneratorSkipPerOutputGroup =
+      kGroupSize * FillPhiloxRandomTask<Distribution, true>::kReservedSamplesPerOutput /
+      PhiloxRandom::kResultElementCount;
+    for (int64 index = start_group; index < limit_group; ++index) {
+      PhiloxRandom gen = base_gen;
+      gen.Skip(index * kGeneratorSkipPerOutputGroup);
+      SingleSampleAdapter<PhiloxRandom> single_samples(&gen);
+      auto samples = dist(&single_samples);
+      std::copy(&samples[0], &samples[0] + kGroupSize, data);
+      data += kGroupSize;
+    }
+  }
+};
+
+// The unit normal floats, the raw samples of a block are drawn first and
+// transformed by BoxMullerFloatBlock, which the compiler can vectorize.
+template <>
+struct FillPhiloxGroups<NormalDistribution<PhiloxRandom, float>, false> {
+  static void Run(PhiloxRandom base_gen, float* data, int64 start_group,
+                  int64 limit_group, NormalDistribution<PhiloxRandom, float> dist) {
+    static const int64 kBlockGroups = 256;
+    const int kGroupSize = PhiloxRandom::kResultElementCount;
+    uint32 raw[kBlockGroups * kGroupSize];
+    PhiloxRandom gen = base_gen;
+    gen.Skip(start_group);
+    for (int64 index = start_group; index < limit_group; index += kBlockGroups) {
+      int64 groups = std::min(kBlockGroups, limit_group - index);
+      for (int64 i = 0; i < groups; ++i) {
+        auto sample = gen();
+        std::copy(&sample[0], &sample[0] + kGroupSize, raw + i * kGroupSize);
+      }
+      BoxMullerFloatBlock(raw, data, groups * kGroupSize);
+      data += groups * kGroupSize;
+    }
+  }
+};
+
+// Fills the elements [offset, offset + size) of the stream of base_gen into
+// data. An element only depends on the key of base_gen and its offset, so
+// the ranges of a stream can be filled in any order by any thread and the
+// result is the same as one Fill of the whole stream.
+template <class Distribution>
+void FillPhiloxRandomAt(PhiloxRandom base_gen,
+                        typename Distribution::ResultElementType* data,
+                        int64 offset, int64 size, Distribution dist) {
+  typedef typename Distribution::ResultElementType T;
+  typedef FillPhiloxGroups<Distribution,
+                           Distribution::kVariableSamplesPerOutput> Groups;
+  const int kGroupSize = Distribution::kResultElementCount;
+  if (size <= 0) {
+    return;
+  }
+  int64 group = offset / kGroupSize;
+  int64 limit = offset + size;
+  // the partial group at the begin
+  int64 head = offset - group * kGroupSize;
+  if (head != 0) {
+    T samples[kGroupSize];
+    Groups::Run(base_gen, samples, group, group + 1, dist);
+    int64 count = std::min<int64>(kGroupSize - head, size);
+    std::copy(samples + head, samples + head + count, data);
+    data += count;
+    offset += count;
+    group++;
+  }
+  int64 limit_group_full = limit / kGroupSize;
+  if (group < limit_group_full) {
+    Groups::Run(base_gen, data, group, limit_group_full, dist);
+    data += (limit_group_full - group) * kGroupSize;
+    offset = limit_group_full * kGroupSize;
+    group = limit_group_full;
+  }
+  // the partial group at the end
+  if (offset < limit) {
+    T samples[kGroupSize];
+    Groups::Run(base_gen, samples, group, group + 1, dist);
+    std::copy(samples, samples + (limit - offset), data);
+  }
+}
+
 class PhiloxRandomOp {
  public:
   explicit PhiloxRandomOp(uint64_t seed1, uint64_t seed2) {    
@@ -0,0 +1,62 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "random_initializer.h"
+
+#include "tbb/parallel_for.h"
+#include "random/random.h"
+
+namespace ps {
+namespace initializer {
+
+RandomInitializer::RandomInitializer() {
+  int seed1 = 0;
+  int seed2 = 0;
+  Random::GetSeed(nullptr, &seed1, &seed2);
+  seed1_ = (uint32_t)seed1;
+  seed2_ = (uint32_t)seed2;
+}
+
+void RandomInitializer::Init(void* data, DataType type, size_t size) {
+  InitAt(data, type, size, 0);
+}
+
+void RandomInitializer::MultiThreadInit(void* data, DataType type, size_t size) {
+  MultiThreadInitAt(data, type, size, 0);
+}
+
+void RandomInitializer::MultiThreadInitAt(void* data, DataType type, size_t size, size_t offset) {
+  static const size_t block_size = 1 << 15; // 32K
+  if (size < block_size * 2) {
+    InitAt(data, type, size, offset);
+    return;
+  }
+  // the blocks are keyed by their offsets, so the split does not matter
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, size, block_size), [&](const tbb::blocked_range<size_t>& r) {
+        InitAt((char*)data + r.begin() * SizeOfType(type), type, r.end() - r.begin(), offset + r.begin());
+      });
+}
+
+PhiloxRandom RandomInitializer::Generator() const {
+  return PhiloxRandom(seed1_, seed2_);
+}
+
+void RandomInitializer::CopyKey(const RandomInitializer& rhs) {
+  seed1_ = rhs.seed1_;
+  seed2_ = rhs.seed2_;
+}
+
+} //namespace initializer
+} //ps
@@ -0,0 +1,52 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_COMMON_INITIALIZER_RANDOM_INITIALIZER_H
+#define PS_COMMON_INITIALIZER_RANDOM_INITIALIZER_H
+
+#include "ps-plus/common/initializer.h"
+#include "ps-plus/common/initializer/random/philox_random.h"
+
+namespace ps {
+namespace initializer {
+
+// The base of the initializers drawing from a Philox stream. The key of the
+// stream is drawn once by the initializer and kept by Clone, and element i
+// of a tensor is the element i of the stream, so a tensor gets the same
+// values however the init is split over the threads or the chunks.
+class RandomInitializer: public Initializer {
+ public:
+  RandomInitializer();
+
+  void Init(void* data, DataType type, size_t size) override;
+  void MultiThreadInit(void* data, DataType type, size_t size) override;
+  void InitAt(void* data, DataType type, size_t size, size_t offset) override = 0;
+  void MultiThreadInitAt(void* data, DataType type, size_t size, size_t offset) override;
+
+ protected:
+  // The generator at the begin of the stream
+  PhiloxRandom Generator() const;
+  // Share the stream of rhs, for Clone
+  void CopyKey(const RandomInitializer& rhs);
+
+ private:
+  uint64_t seed1_;
+  uint64_t seed2_;
+};
+
+} //namespace initializer
+} //ps
+
+#endif  // PS_COMMON_INITIALIZER_RANDOM_INITIALIZER_H
@@ -0,0 +1,124 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "ps-plus/common/tensor_shape.h"
+#include "ps-plus/common/initializer/normal_initializer.h"
+#include "ps-plus/common/initializer/truncated_normal_initializer.h"
+#include "ps-plus/common/initializer/variance_scaling_initializer.h"
+#include "ps-plus/common/initializer/random/random_distributions.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+using ps::DataType;
+using ps::Initializer;
+using ps::TensorShape;
+using ps::initializer::NormalInitializer;
+using ps::initializer::TruncatedNormalInitializer;
+using ps::initializer::VarianceScalingInitializer;
+
+namespace {
+
+// Init of the whole buffer, InitAt of uneven pieces and the parallel
+// MultiThreadInit give the same values
+template <typename T>
+void CheckSplit(Initializer* init, DataType type) {
+  const size_t size = 200003;
+  std::vector<T> whole(size), pieces(size), parallel(size);
+  init->Init(&whole[0], type, size);
+  size_t pieces_size[] = {1, 3, 7, 4, 1021, 65537};
+  size_t offset = 0;
+  for (size_t i = 0; offset < size; i++) {
+    size_t n = std::min(pieces_size[i % 6], size - offset);
+    init->InitAt(&pieces[offset], type, n, offset);
+    offset += n;
+  }
+  init->MultiThreadInit(&parallel[0], type, size);
+  for (size_t i = 0; i < size; i++) {
+    ASSERT_EQ(whole[i], pieces[i]) << i;
+    ASSERT_EQ(whole[i], parallel[i]) << i;
+  }
+
+  std::unique_ptr<Initializer> clone(init->Clone());
+  std::vector<T> cloned(size);
+  clone->MultiThreadInitAt(&cloned[0], type, size, 0);
+  EXPECT_EQ(whole, cloned);
+}
+
+template <typename T>
+void CheckMoments(const std::vector<T>& x, double mean, double stddev) {
+  double sum = 0, sum2 = 0;
+  for (T v : x) {
+    sum += v;
+    sum2 += v * v;
+  }
+  double m = sum / x.size();
+  EXPECT_NEAR(mean, m, 0.01);
+  EXPECT_NEAR(stddev, std::sqrt(sum2 / x.size() - m * m), 0.01);
+}
+
+}
+
+TEST(RandomInitializer, NormalSplit) {
+  std::unique_ptr<Initializer> init(new NormalInitializer(-1, 0.5, 2.0));
+  CheckSplit<float>(init.get(), DataType::kFloat);
+  CheckSplit<double>(init.get(), DataType::kDouble);
+
+  std::vector<float> x(1 << 20);
+  init->MultiThreadInit(&x[0], DataType::kFloat, x.size());
+  CheckMoments(x, 0.5, 2.0);
+}
+
+TEST(RandomInitializer, TruncatedNormalSplit) {
+  std::unique_ptr<Initializer> init(new TruncatedNormalInitializer(-1, 0, 1));
+  CheckSplit<float>(init.get(), DataType::kFloat);
+  CheckSplit<double>(init.get(), DataType::kDouble);
+}
+
+TEST(RandomInitializer, VarianceScalingSplit) {
+  std::unique_ptr<Initializer> init(new VarianceScalingInitializer(TensorShape({100, 4}), -1, 1.0, "fan_in", "uniform"));
+  CheckSplit<float>(init.get(), DataType::kFloat);
+  // the scale is the same for each chunk
+  std::vector<float> x(1 << 18);
+  init->MultiThreadInit(&x[0], DataType::kFloat, x.size());
+  CheckMoments(x, 0.0, 0.1);
+}
+
+TEST(RandomInitializer, IndependentKeys) {
+  std::unique_ptr<Initializer> a(new NormalInitializer(-1, 0, 1));
+  std::unique_ptr<Initializer> b(new NormalInitializer(-1, 0, 1));
+  float x[16], y[16];
+  a->Init(x, DataType::kFloat, 16);
+  b->Init(y, DataType::kFloat, 16);
+  EXPECT_FALSE(std::equal(x, x + 16, y));
+}
+
+TEST(RandomInitializer, BoxMullerFloatBlock) {
+  std::vector<ps::uint32> raw(1000);
+  for (size_t i = 0; i < raw.size(); i++) {
+    raw[i] = i * 2654435761u;
+  }
+  raw[0] = 0;
+  std::vector<float> block(raw.size());
+  ps::BoxMullerFloatBlock(&raw[0], &block[0], raw.size());
+  for (size_t i = 0; i < raw.size(); i += 2) {
+    float f0, f1;
+    ps::BoxMullerFloat(raw[i], raw[i + 1], &f0, &f1);
+    EXPECT_EQ(f0, block[i]);
+    EXPECT_EQ(f1, block[i + 1]);
+  }
+}
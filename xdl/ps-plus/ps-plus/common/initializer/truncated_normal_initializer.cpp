@@ -21,7 +21,6 @@ limitations under the License.
 #include <memory>
 
 #include "ps-plus/common/types.h"
-#include "random/random.h"
 #include "random/random_ops.h"
 
 namespace ps {
@@ -42,20 +41,16 @@ bool TruncatedNormalInitializer::Accept(DataType type) {
   return false;
 }
 
-void TruncatedNormalInitializer::Init(void* data, 
-                                      DataType type, 
-                                      size_t size) {
-  int seed1 = 0;
-  int seed2 = 0;
-  int* seed = seed_ == -1? nullptr: &seed_;
-  Random::GetSeed(seed, &seed1, &seed2);
-  std::unique_ptr<PhiloxRandomOp> op(new PhiloxRandomOp(seed1, seed2));
+void TruncatedNormalInitializer::InitAt(void* data, 
+                                        DataType type, 
+                                        size_t size,
+                                        size_t offset) {
   if (type == DataType::kFloat) {
-    op->Fill<TruncatedNormalDistribution<SingleSampleAdapter<PhiloxRandom>,float> >(
-        size, data);
+    FillPhiloxRandomAt(Generator(), reinterpret_cast<float*>(data), offset, size,
+                       TruncatedNormalDistribution<SingleSampleAdapter<PhiloxRandom>, float>());
   } else {
-    op->Fill<TruncatedNormalDistribution<SingleSampleAdapter<PhiloxRandom>,double> >(
-        size, data);
+    FillPhiloxRandomAt(Generator(), reinterpret_cast<double*>(data), offset, size,
+                       TruncatedNormalDistribution<SingleSampleAdapter<PhiloxRandom>, double>());
   }
 
   CASES(type, do {
@@ -67,9 +62,11 @@ void TruncatedNormalInitializer::Init(void* data,
 }
 
 Initializer* TruncatedNormalInitializer::Clone() {
-  return new TruncatedNormalInitializer(seed_, 
-                                        mean_, 
-                                        stddev_);
+  TruncatedNormalInitializer* ret = new TruncatedNormalInitializer(seed_, 
+                                                                   mean_, 
+                                                                   stddev_);
+  ret->CopyKey(*this);
+  return ret;
 }
 
 } //namespace initializer
@@ -16,20 +16,20 @@ limitations under the License.
 #ifndef PS_COMMON_INITIALIZER_TRUNCATED_NORMAL_INITIALIZER_H
 #define PS_COMMON_INITIALIZER_TRUNCATED_NORMAL_INITIALIZER_H
 
-#include "ps-plus/common/initializer.h"
+#include "ps-plus/common/initializer/random_initializer.h"
 #include "ps-plus/common/tensor_shape.h"
 
 namespace ps {
 namespace initializer {
 
-class TruncatedNormalInitializer: public Initializer {
+class TruncatedNormalInitializer: public RandomInitializer {
  public:
   TruncatedNormalInitializer(int seed, 
                              float mean,
                              float stdev);
 
   bool Accept(DataType type) override;
-  void Init(void* data, DataType type, size_t size) override;
+  void InitAt(void* data, DataType type, size_t size, size_t offset) override;
   Initializer* Clone() override;
 
  private:
@@ -21,7 +21,6 @@ limitations under the License.
 #include <memory>
 
 #include "ps-plus/common/types.h"
-#include "random/random.h"
 #include "random/random_ops.h"
 
 namespace ps {
@@ -50,20 +49,16 @@ bool UniformUnitScalingInitializer::Accept(DataType type) {
   return false;
 }
 
-void UniformUnitScalingInitializer::Init(void* data, 
-                                         DataType type, 
-                                         size_t size) {
-  int seed1 = 0;
-  int seed2 = 0;
-  int* seed = seed_ == -1? nullptr: &seed_;
-  Random::GetSeed(seed, &seed1, &seed2);
-  std::unique_ptr<PhiloxRandomOp> op(new PhiloxRandomOp(seed1, seed2));
+void UniformUnitScalingInitializer::InitAt(void* data, 
+                                           DataType type, 
+                                           size_t size,
+                                           size_t offset) {
   if (type == DataType::kFloat) {
-    op->Fill<UniformDistribution<PhiloxRandom, float> >(
-        size, data);
+    FillPhiloxRandomAt(Generator(), reinterpret_cast<float*>(data), offset,
+                       size, UniformDistribution<PhiloxRandom, float>());
   } else {
-    op->Fill<UniformDistribution<PhiloxRandom, double> >(
-        size, data);
+    FillPhiloxRandomAt(Generator(), reinterpret_cast<double*>(data), offset,
+                       size, UniformDistribution<PhiloxRandom, double>());
   }
 
   size_t input_size = 1;
@@ -82,9 +77,11 @@ void UniformUnitScalingInitializer::Init(void* data,
 }
 
 Initializer* UniformUnitScalingInitializer::Clone() {
-  return new UniformUnitScalingInitializer(shape_, 
-                                           seed_, 
-                                           factor_);
+  UniformUnitScalingInitializer* ret = new UniformUnitScalingInitializer(shape_, 
+                                                                         seed_, 
+                                                                         factor_);
+  ret->CopyKey(*this);
+  return ret;
 }
 
 } //namespace initializer
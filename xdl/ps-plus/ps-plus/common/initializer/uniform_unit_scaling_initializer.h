@@ -16,13 +16,13 @@ limitations under the License.
 #ifndef PS_COMMON_INITIALIZER_UNIFORM_UNIT_SCALING_INITIALIZER_H
 #define PS_COMMON_INITIALIZER_UNIFORM_UNIT_SCALING_INITIALIZER_H
 
-#include "ps-plus/common/initializer.h"
+#include "ps-plus/common/initializer/random_initializer.h"
 #include "ps-plus/common/tensor_shape.h"
 
 namespace ps {
 namespace initializer {
 
-class UniformUnitScalingInitializer: public Initializer {
+class UniformUnitScalingInitializer: public RandomInitializer {
  public:
   UniformUnitScalingInitializer(const TensorShape& shape,
                                 int seed, 
@@ -33,7 +33,7 @@ class UniformUnitScalingInitializer: public Initializer {
                                 float factor);
 
   bool Accept(DataType type) override;
-  void Init(void* data, DataType type, size_t size) override;
+  void InitAt(void* data, DataType type, size_t size, size_t offset) override;
   Initializer* Clone() override;
 
  private:
@@ -20,7 +20,6 @@ limitations under the License.
 #include <iostream>
 #include <memory>
 
-#include "random/random.h"
 #include "random/random_ops.h"
 
 namespace ps {
@@ -61,35 +60,33 @@ bool VarianceScalingInitializer::Accept(DataType type) {
   return false;
 }
 
-void VarianceScalingInitializer::Init(void* data, 
-                                      DataType type, 
-                                      size_t size) {
+void VarianceScalingInitializer::InitAt(void* data, 
+                                        DataType type, 
+                                        size_t size,
+                                        size_t offset) {
+  // the scale of the fans is not kept, InitAt runs once per chunk
+  double scale = scale_;
   double fan_in, fan_out;
   ComputeFans(full_shape_, &fan_in, &fan_out);
   if (mode_ == "fan_in") {
-    scale_ /= fan_in < 1 ? 1 : fan_in;
+    scale /= fan_in < 1 ? 1 : fan_in;
   } else if (mode_ == "fan_out") {
-    scale_ /= fan_out < 1 ? 1 : fan_out;
+    scale /= fan_out < 1 ? 1 : fan_out;
   } else {
     const double fan = (fan_in + fan_out) / 2;
-    scale_ /= fan < 1 ? 1 : fan;
+    scale /= fan < 1 ? 1 : fan;
   }
 
-  int seed1 = 0;
-  int seed2 = 0;
-  int* seed = seed_ == -1? nullptr: &seed_;
-  Random::GetSeed(seed, &seed1, &seed2);
-  std::unique_ptr<PhiloxRandomOp> op(new PhiloxRandomOp(seed1, seed2));
   if (distribution_ == "normal") {
     if (type == DataType::kFloat){
-      op->Fill<TruncatedNormalDistribution<SingleSampleAdapter<PhiloxRandom>, float>>(
-          size, data);
+      FillPhiloxRandomAt(Generator(), reinterpret_cast<float*>(data), offset, size,
+                         TruncatedNormalDistribution<SingleSampleAdapter<PhiloxRandom>, float>());
     } else {
-      op->Fill<TruncatedNormalDistribution<SingleSampleAdapter<PhiloxRandom>, double>>(
-          size, data);
+      FillPhiloxRandomAt(Generator(), reinterpret_cast<double*>(data), offset, size,
+                         TruncatedNormalDistribution<SingleSampleAdapter<PhiloxRandom>, double>());
     }
 
-    const double stddev = sqrt(scale_);
+    const double stddev = sqrt(scale);
     CASES(type, do {
       T* beg = reinterpret_cast<T*>(data);
       T* end = beg + size;
@@ -99,12 +96,14 @@ void VarianceScalingInitializer::Init(void* data,
     } while (0));
   } else {
     if (type == DataType::kFloat) {
-      op->Fill<UniformDistribution<PhiloxRandom, float>>(size, data);
+      FillPhiloxRandomAt(Generator(), reinterpret_cast<float*>(data), offset,
+                         size, UniformDistribution<PhiloxRandom, float>());
     } else {
-      op->Fill<UniformDistribution<PhiloxRandom, double>>(size, data);
+      FillPhiloxRandomAt(Generator(), reinterpret_cast<double*>(data), offset,
+                         size, UniformDistribution<PhiloxRandom, double>());
     }
 
-    const double limit = sqrt(3 * scale_);
+    const double limit = sqrt(3 * scale);
     CASES(type, do {
       T* beg = reinterpret_cast<T*>(data);
       T* end = beg + size;
@@ -148,11 +147,13 @@ void VarianceScalingInitializer::ComputeFans(const TensorShape& shape,
 }
 
 Initializer* VarianceScalingInitializer::Clone() {
-  return new VarianceScalingInitializer(full_shape_,
-                                        seed_,
-                                        scale_,
-                                        mode_,
-                                        distribution_);
+  VarianceScalingInitializer* ret = new VarianceScalingInitializer(full_shape_,
+                                                                   seed_,
+                                                                   scale_,
+                                                                   mode_,
+                                                                   distribution_);
+  ret->CopyKey(*this);
+  return ret;
 }
 
 } // namespace initializer
@@ -16,13 +16,13 @@ limitations under the License.
 #ifndef PS_COMMON_INITIALIZER_VARIANCE_SCALING_INITIALIZER_H
 #define PS_COMMON_INITIALIZER_VARIANCE_SCALING_INITIALIZER_H
 
-#include "ps-plus/common/initializer.h"
+#include "ps-plus/common/initializer/random_initializer.h"
 #include "ps-plus/common/tensor_shape.h"
 
 namespace ps {
 namespace initializer {
 
-class VarianceScalingInitializer: public Initializer {
+class VarianceScalingInitializer: public RandomInitializer {
  public:
   VarianceScalingInitializer(const TensorShape& full_shape,
                              int seed, 
@@ -37,7 +37,7 @@ class VarianceScalingInitializer: public Initializer {
                              const std::string& distribution);
 
   bool Accept(DataType type) override;
-  void Init(void* data, DataType type, size_t size) override;
+  void InitAt(void* data, DataType type, size_t size, size_t offset) override;
   Initializer* Clone() override;
 
  private:
@@ -17,6 +17,9 @@ limitations under the License.
 #define PS_COMMON_MEMGUARD_H_
 
 #include <cstring>
+#include <vector>
+
+#include "ps-plus/common/buffer_pool.h"
 
 namespace ps {
 namespace serializer {
@@ -55,14 +58,14 @@ class MemGuard {
 
   template <typename T>
   T* AllocateElement(const T& data) {
-    char* buf = new char[sizeof(T)];
+    char* buf = BufferPool::Allocate(sizeof(T));
     std::memcpy(buf, reinterpret_cast<const void*>(&data), sizeof(T));
     Collect(buf);
     return reinterpret_cast<T*>(buf);
   }
 
   char* AllocateBuffer(size_t len) {
-    char* buf = new char[len];
+    char* buf = BufferPool::Allocate(len);
     Collect(buf);
     return buf;
   }
@@ -92,7 +95,7 @@ class MemGuard {
 
     ~State() {
       for (char* buf: bufs_) {
-        delete[] buf;
+        BufferPool::Free(buf);
       }
     }
     
@@ -16,7 +16,13 @@ limitations under the License.
 #ifndef PS_PLUS_COMMON_METRICS_COLLECTOR_H_
 #define PS_PLUS_COMMON_METRICS_COLLECTOR_H_
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <csignal>
+#include <map>
+#include <memory>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -42,6 +48,77 @@ struct Metrics {
   size_t except_;
 };
 
+// Lock free histogram in power of two buckets, cheap enough to record
+// every request with. Percentiles are the upper bound of their bucket.
+class Histogram {
+ public:
+  static constexpr size_t kBuckets = 65;
+
+  Histogram() {
+    Reset();
+  }
+
+  void Record(uint64_t value) {
+    buckets_[Bucket(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+  uint64_t Sum() const { return sum_.load(std::memory_order_relaxed); }
+  uint64_t Max() const { return max_.load(std::memory_order_relaxed); }
+
+  uint64_t Percentile(double p) const {
+    uint64_t count = 0;
+    for (size_t i = 0; i < kBuckets; i++) {
+      count += buckets_[i].load(std::memory_order_relaxed);
+    }
+    uint64_t rank = (uint64_t)(count * p);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; i++) {
+      seen += buckets_[i].load(std::memory_order_relaxed);
+      if (seen > rank) {
+        return i == 0 ? 0 : std::min<uint64_t>(Max(), i == 64 ? ~0ull : (1ull << i) - 1);
+      }
+    }
+    return Max();
+  }
+
+  void Merge(const Histogram& other) {
+    for (size_t i = 0; i < kBuckets; i++) {
+      buckets_[i].fetch_add(other.buckets_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    count_.fetch_add(other.Count(), std::memory_order_relaxed);
+    sum_.fetch_add(other.Sum(), std::memory_order_relaxed);
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (other.Max() > max && !max_.compare_exchange_weak(max, other.Max(), std::memory_order_relaxed)) {
+    }
+  }
+
+  void Reset() {
+    for (size_t i = 0; i < kBuckets; i++) {
+      buckets_[i].store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  // bucket i > 0 holds [2^(i-1), 2^i)
+  static size_t Bucket(uint64_t value) {
+    return value == 0 ? 0 : 64 - __builtin_clzll(value);
+  }
+
+  std::atomic<uint64_t> buckets_[kBuckets];
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_;
+  std::atomic<uint64_t> max_;
+};
+
 class MetricsCollector {
 private:
   MetricsCollector() {}
@@ -133,6 +210,50 @@ public:
     }
   }
 
+  // The histogram lives as long as the process, callers on hot paths
+  // should look it up once and keep the pointer.
+  Histogram* GetHistogram(const std::string& name) {
+    std::lock_guard<std::mutex> l(mu_);
+    std::unique_ptr<Histogram>& histogram = histograms_[name];
+    if (histogram == nullptr) {
+      histogram.reset(new Histogram);
+    }
+    return histogram.get();
+  }
+
+  // One line per histogram: count, avg, p50, p99, p999 and max.
+  std::string DumpHistograms() {
+    std::ostringstream os;
+    std::lock_guard<std::mutex> l(mu_);
+    for (auto& item: histograms_) {
+      Histogram* h = item.second.get();
+      uint64_t count = h->Count();
+      if (count == 0) {
+        continue;
+      }
+      os << item.first << ": count[" << count << "] avg[" << h->Sum() / count
+         << "] p50[" << h->Percentile(0.5) << "] p99[" << h->Percentile(0.99)
+         << "] p999[" << h->Percentile(0.999) << "] max[" << h->Max() << "]\n";
+    }
+    return os.str();
+  }
+
+  // The histograms are dumped to stdout shortly after the process gets sig.
+  void DumpOnSignal(int sig = SIGUSR2) {
+    std::call_once(dump_once_, [this, sig] {
+      std::signal(sig, [](int) { DumpRequested() = 1; });
+      std::thread([this] {
+        while (true) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(200));
+          if (DumpRequested()) {
+            DumpRequested() = 0;
+            std::cout << DumpHistograms() << std::flush;
+          }
+        }
+      }).detach();
+    });
+  }
+
   static size_t GetCurrentTimeMS() {
     auto time_now = std::chrono::system_clock::now();  
     auto duration_in_ms = std::chrono::duration_cast<std::chrono::microseconds>(time_now.time_since_epoch());  
@@ -140,7 +261,14 @@ public:
   }
 
 private:
+  static volatile std::sig_atomic_t& DumpRequested() {
+    static volatile std::sig_atomic_t requested = 0;
+    return requested;
+  }
+
   std::unordered_map<std::string, Metrics> metrics_;
+  std::map<std::string, std::unique_ptr<Histogram>> histograms_;
+  std::once_flag dump_once_;
   std::mutex mu_;
   std::thread th_;
 };
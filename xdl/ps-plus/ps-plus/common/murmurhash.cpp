@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "murmurhash.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace ps {
 
 namespace {
@@ -33,31 +36,28 @@ inline uint64_t fmix64(uint64_t k) {
   return k;
 }
 
-}  // namespace
+const uint64_t c1 = 0x87c37b91114253d5ULL;
+const uint64_t c2 = 0x4cf5ad432745937fULL;
 
-// smhasher implementation:
-// https://github.com/aappleby/smhasher/blob/master/src/MurmurHash3.cpp
-void MurmurHash::operator()(const void* key, const int len, void* out) {
-  const uint8_t* data = (const uint8_t*)(key);
-  const int nblocks = len / 16;
+inline void MixBlock(const uint8_t* block, uint64_t* h1, uint64_t* h2) {
+  uint64_t k1, k2;
+  memcpy(&k1, block, sizeof(k1));
+  memcpy(&k2, block + 8, sizeof(k2));
 
-  uint64_t h1 = seed_, h2 = seed_;
+  k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; *h1 ^= k1;
 
-  const uint64_t c1 = 0x87c37b91114253d5ULL;
-  const uint64_t c2 = 0x4cf5ad432745937fULL;
+  *h1 = rotl64(*h1, 27); *h1 += *h2; *h1 = *h1*5+0x52dce729;
 
-  const uint64_t* blocks = (const uint64_t*)(data);
-  for (int i = 0; i < nblocks; ++i) {
-    uint64_t k1 = blocks[i*2];
-    uint64_t k2 = blocks[i*2+1];
+  k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; *h2 ^= k2;
 
-    k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
-
-    h1 = rotl64(h1, 27); h1 += h2; h1 = h1*5+0x52dce729;
-
-    k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+  *h2 = rotl64(*h2, 31); *h2 += *h1; *h2 = *h2*5+0x38495ab5;
+}
 
-    h2 = rotl64(h2, 31); h2 += h1; h2 = h2*5+0x38495ab5;
+// Mixes the blocks of data from the block begin, then the tail and len
+void Finish(const uint8_t* data, int len, int begin, uint64_t h1, uint64_t h2, void* out) {
+  const int nblocks = len / 16;
+  for (int i = begin; i < nblocks; ++i) {
+    MixBlock(data + i * 16, &h1, &h2);
   }
 
   const uint8_t* tail = (const uint8_t*)(data + nblocks*16);
@@ -97,4 +97,38 @@ void MurmurHash::operator()(const void* key, const int len, void* out) {
   ((uint64_t*)out)[1] = h2;
 }
 
+}  // namespace
+
+// smhasher implementation:
+// https://github.com/aappleby/smhasher/blob/master/src/MurmurHash3.cpp
+void MurmurHash::operator()(const void* key, const int len, void* out) {
+  Finish((const uint8_t*)(key), len, 0, seed_, seed_, out);
+}
+
+void MurmurHash::operator()(const void* const* keys, const int* lens, int n, void* out) {
+  const int kLanes = 4;
+  uint64_t* res = (uint64_t*)out;
+  int i = 0;
+  for (; i + kLanes <= n; i += kLanes) {
+    uint64_t h1[kLanes], h2[kLanes];
+    int nblocks = lens[i] / 16;
+    for (int l = 0; l < kLanes; ++l) {
+      h1[l] = h2[l] = seed_;
+      nblocks = std::min(nblocks, lens[i + l] / 16);
+    }
+    for (int b = 0; b < nblocks; ++b) {
+      for (int l = 0; l < kLanes; ++l) {
+        MixBlock((const uint8_t*)(keys[i + l]) + b * 16, &h1[l], &h2[l]);
+      }
+    }
+    for (int l = 0; l < kLanes; ++l) {
+      Finish((const uint8_t*)(keys[i + l]), lens[i + l], nblocks, h1[l], h2[l],
+             res + (i + l) * 2);
+    }
+  }
+  for (; i < n; ++i) {
+    (*this)(keys[i], lens[i], res + i * 2);
+  }
+}
+
 }  // namespace ps
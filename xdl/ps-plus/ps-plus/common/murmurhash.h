@@ -24,6 +24,10 @@ class MurmurHash {
  public:
   MurmurHash(uint32_t seed) : seed_(seed) {}
   void operator()(const void* key, int len, void* out);
+  // Hashes the n keys, out holds the 2 uint64 of each key as the key by key
+  // hash does. The blocks a group of keys have in common are mixed in lock
+  // step, which overlaps the multiplies of the short keys.
+  void operator()(const void* const* keys, const int* lens, int n, void* out);
  private:
   uint32_t seed_;
 };
@@ -94,6 +94,42 @@ std::string NetUtils::GetLocalIP(const std::string& interface) {
   return ip;
 }
 
+bool NetUtils::IsLocalHost(const std::string& host) {
+  struct hostent* hent = gethostbyname(host.c_str());
+  if (hent == NULL || hent->h_addrtype != AF_INET) {
+    return false;
+  }
+  std::vector<in_addr_t> addrs;
+  for (uint32_t i = 0; hent->h_addr_list[i]; i++) {
+    in_addr_t addr = reinterpret_cast<struct in_addr*>(hent->h_addr_list[i])->s_addr;
+    if ((ntohl(addr) >> 24) == 127) {
+      return true;
+    }
+    addrs.push_back(addr);
+  }
+
+  struct ifaddrs * ifAddrStruct = NULL;
+  struct ifaddrs * ifa = NULL;
+  bool local = false;
+  getifaddrs(&ifAddrStruct);
+  for (ifa = ifAddrStruct; ifa != NULL && !local; ifa = ifa->ifa_next) {
+    if (ifa->ifa_addr == NULL || ifa->ifa_addr->sa_family != AF_INET) continue;
+    in_addr_t addr = reinterpret_cast<struct sockaddr_in*>(ifa->ifa_addr)->sin_addr.s_addr;
+    for (in_addr_t item : addrs) {
+      if (item == addr) {
+        local = true;
+        break;
+      }
+    }
+  }
+
+  if (ifAddrStruct != NULL) { 
+    freeifaddrs(ifAddrStruct);
+  }
+
+  return local;
+}
+
 int NetUtils::GetAvailablePort() {
   struct sockaddr_in addr;
   addr.sin_port = htons(0);  // have system pick up a random port available for me
@@ -28,6 +28,8 @@ class NetUtils {
   static bool GetIP(std::vector<std::string>& ips);
   static bool GetDefaultIP(std::string& ip);
   static std::string GetLocalIP(const std::string& interface);
+  // Whether host resolves to a loopback address or one of the local interfaces.
+  static bool IsLocalHost(const std::string& host);
   static int GetAvailablePort();
   static int GetAvailableCpuNum();
   static std::string GetEnv(const std::string& name) {
@@ -0,0 +1,46 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/common/open_hashmap.h"
+
+namespace ps {
+
+template <typename KeyType> const size_t OpenHashMapImpl<KeyType>::kCacheLineSize;
+template <typename KeyType> const size_t OpenHashMapImpl<KeyType>::kSlotsPerBucket;
+template <typename KeyType> const uint64_t OpenHashMapImpl<KeyType>::kEmpty;
+template <typename KeyType> const uint64_t OpenHashMapImpl<KeyType>::kBusy;
+template <typename KeyType> const uint64_t OpenHashMapImpl<KeyType>::kDeleted;
+template <typename KeyType> const size_t OpenHashMapImpl<KeyType>::kPrefetchGroup;
+
+Status CreateHashMap(const std::string& backend, bool hash64, size_t hint, HashMap** result) {
+  if (backend.empty() || backend == "tbb") {
+    if (hash64) {
+      *result = new HashMapImpl<int64_t>(hint);
+    } else {
+      *result = new HashMapImpl<Hash128Key>(hint);
+    }
+  } else if (backend == "open") {
+    if (hash64) {
+      *result = new OpenHashMapImpl<int64_t>(hint);
+    } else {
+      *result = new OpenHashMapImpl<Hash128Key>(hint);
+    }
+  } else {
+    return Status::ArgumentError("Unknown hashmap backend " + backend);
+  }
+  return Status::Ok();
+}
+
+} //ps
@@ -0,0 +1,595 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_COMMON_OPEN_HASHMAP_H
+#define PS_COMMON_OPEN_HASHMAP_H
+
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "ps-plus/common/hashmap.h"
+#include "ps-plus/common/status.h"
+
+namespace ps {
+
+// Open addressing hash map with cache-line-sized buckets.
+// Each bucket keeps its keys together so a probe compares a whole bucket
+// with one SIMD instruction, and stores the id of every slot in an atomic
+// state word (kEmpty/kBusy/kDeleted or the id itself).
+// Inserts only claim kEmpty slots by CAS, so concurrent Get calls never
+// create duplicate keys. Erase leaves tombstones which are dropped by the
+// next rehash. The table grows under write lock before a Get starts, so
+// the lookup path itself never blocks on a resize.
+// Get works on groups of kPrefetchGroup keys: all home buckets of a group
+// are prefetched before the first probe, and the misses of the group are
+// inserted only after every lookup of it resolved, so the memory latency of
+// a group overlaps instead of stalling once per key.
+// The black and white lists of HashMapImpl gate the inserts the same way.
+template <typename KeyType> class OpenHashMapImpl : public HashMap {
+ public:
+  static const size_t kCacheLineSize = 64;
+  static const size_t kSlotsPerBucket = sizeof(KeyType) == 8 ? 4 : 2;
+  static const uint64_t kEmpty = (uint64_t)-1;
+  static const uint64_t kBusy = (uint64_t)-3;
+  static const uint64_t kDeleted = (uint64_t)-4;
+  // keys hashed and prefetched together in Get
+  static const size_t kPrefetchGroup = 16;
+
+  struct alignas(kCacheLineSize) Bucket {
+    KeyType keys[kSlotsPerBucket];
+    std::atomic<uint64_t> states[kSlotsPerBucket];
+  };
+  static_assert(sizeof(Bucket) == kCacheLineSize, "Bucket should fit one cache line");
+  typedef std::unordered_set<KeyType, tbb::tbb_hash<KeyType>, std::equal_to<KeyType> > NonCocurrentHashTable;
+
+  OpenHashMapImpl(size_t hint)
+    : HashMap(), buckets_(nullptr), bucket_count_(0), used_(0), reserved_(0) {
+    size_t bucket_count = 16;
+    while (bucket_count * kSlotsPerBucket < hint) {
+      bucket_count <<= 1;
+    }
+    buckets_ = AllocBuckets(bucket_count);
+    bucket_count_ = bucket_count;
+  }
+
+  virtual ~OpenHashMapImpl() {
+    free(buckets_);
+  }
+
+  virtual int64_t Get(const int64_t* keys, size_t size, bool not_insert, float add_probability, std::vector<size_t>* ids, tbb::concurrent_vector<size_t>* reused_ids, size_t* filtered_keys, size_t block_size = 500) {
+    ids->resize(size);
+    size_t reserve = not_insert ? 0 : size;
+    Reserve(reserve);
+    std::atomic<size_t> total_filtered_count(0);
+    MultiThreadDo(size, [&](const Range& r) {
+          size_t filtered_count = 0;
+          KeyType group_keys[kPrefetchGroup];
+          size_t hashes[kPrefetchGroup];
+          size_t misses[kPrefetchGroup];
+          for (size_t beg = r.begin; beg < r.end; beg += kPrefetchGroup) {
+            size_t n = std::min(kPrefetchGroup, r.end - beg);
+            // hash the whole group and prefetch home buckets before probing
+            for (size_t i = 0; i < n; i++) {
+              GetKey(keys, beg + i, &group_keys[i]);
+              hashes[i] = Hash(group_keys[i]);
+              __builtin_prefetch(&buckets_[hashes[i] & (bucket_count_ - 1)]);
+            }
+            size_t miss_count = 0;
+            for (size_t i = 0; i < n; i++) {
+              uint64_t id;
+              if (Find(group_keys[i], hashes[i], &id)) {
+                (*ids)[beg + i] = id;
+              } else {
+                misses[miss_count++] = i;
+              }
+            }
+            //only not_insert is false(pull request), we use add_probability or bloom filter;
+            if (not_insert) {
+              continue;
+            }
+            for (size_t j = 0; j < miss_count; j++) {
+              size_t i = misses[j];
+              // sorted input (e.g. from MergedHashPull) repeats keys back to back
+              if (j > 0 && group_keys[misses[j - 1]] == group_keys[i]) {
+                (*ids)[beg + i] = (*ids)[beg + misses[j - 1]];
+                if ((*ids)[beg + i] == NOT_ADD_ID) {
+                  filtered_count++;
+                }
+                continue;
+              }
+              if (Admit(&group_keys[i], sizeof(KeyType), add_probability)
+                && (black_list_ == nullptr || black_list_->find(group_keys[i]) == black_list_->end())
+                && (white_list_ == nullptr || white_list_->find(group_keys[i]) != white_list_->end())) {
+                (*ids)[beg + i] = Insert(group_keys[i], hashes[i], reused_ids);
+              } else {
+                filtered_count++;
+                (*ids)[beg + i] = NOT_ADD_ID;
+              }
+            }
+          }
+          total_filtered_count += filtered_count;
+          return Status::Ok();
+        }, block_size);
+    reserved_ -= reserve;
+    lock_.ReadUnlock();
+    *filtered_keys = total_filtered_count.load();
+    return offset_.load();
+  }
+
+  virtual void Erase(const int64_t* keys, size_t size) {
+    QRWLocker lock(lock_, QRWLocker::kWrite);
+    for (size_t i = 0; i < size; i++) {
+      KeyType key;
+      GetKey(keys, i, &key);
+      Bucket* bucket;
+      size_t slot;
+      if (Locate(key, Hash(key), &bucket, &slot)) {
+        free_list_.push(bucket->states[slot].load(std::memory_order_relaxed));
+        bucket->states[slot].store(kDeleted, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  virtual size_t EraseById(const std::string& variable_name, const std::vector<size_t>& ids, tbb::concurrent_vector<size_t>* unfiltered_ids) {
+    QRWLocker lock(lock_, QRWLocker::kWrite);
+    std::atomic<size_t> size(0);
+    std::atomic<size_t> left(0);
+    MultiThreadDo(bucket_count_, [&](const Range& r) {
+          for (size_t b = r.begin; b < r.end; b++) {
+            Bucket& bucket = buckets_[b];
+            for (size_t s = 0; s < kSlotsPerBucket; s++) {
+              uint64_t state = bucket.states[s].load(std::memory_order_relaxed);
+              if (state == kEmpty) {
+                break;
+              }
+              if (state == kDeleted) {
+                continue;
+              }
+              auto iter = std::lower_bound(ids.begin(), ids.end(), state);
+              if (iter != ids.end() && *iter == state) {
+                bucket.states[s].store(kDeleted, std::memory_order_relaxed);
+                free_list_.push(state);
+                size++;
+              } else {
+                unfiltered_ids->push_back(state);
+                left++;
+              }
+            }
+          }
+          return Status::Ok();
+        }, 1 << 14);
+    LOG(INFO) << "Filter for " << variable_name << ", clear=" << size << ", left=" << left;
+    return size;
+  }
+
+  virtual void TrackKeys() {
+    QRWLocker lock(lock_, QRWLocker::kWrite);
+    if (id_keys_.Tracking()) {
+      return;
+    }
+    MultiThreadDo(bucket_count_, [&](const Range& r) {
+          for (size_t b = r.begin; b < r.end; b++) {
+            Bucket& bucket = buckets_[b];
+            for (size_t s = 0; s < kSlotsPerBucket; s++) {
+              uint64_t state = bucket.states[s].load(std::memory_order_relaxed);
+              if (state == kEmpty) {
+                break;
+              }
+              if (state != kDeleted) {
+                id_keys_.Set(state, bucket.keys[s]);
+              }
+            }
+          }
+          return Status::Ok();
+        }, 1 << 14);
+    id_keys_.Start();
+  }
+
+  virtual bool TrackingKeys() {
+    return id_keys_.Tracking();
+  }
+
+  virtual size_t EraseIds(const std::vector<size_t>& ids, std::vector<size_t>* erased) {
+    if (!id_keys_.Tracking()) {
+      std::vector<size_t> sorted(ids);
+      std::sort(sorted.begin(), sorted.end());
+      QRWLocker lock(lock_, QRWLocker::kWrite);
+      tbb::concurrent_vector<size_t> erased_ids;
+      MultiThreadDo(bucket_count_, [&](const Range& r) {
+            for (size_t b = r.begin; b < r.end; b++) {
+              Bucket& bucket = buckets_[b];
+              for (size_t s = 0; s < kSlotsPerBucket; s++) {
+                uint64_t state = bucket.states[s].load(std::memory_order_relaxed);
+                if (state == kEmpty) {
+                  break;
+                }
+                if (state != kDeleted && std::binary_search(sorted.begin(), sorted.end(), state)) {
+                  bucket.states[s].store(kDeleted, std::memory_order_relaxed);
+                  free_list_.push(state);
+                  erased_ids.push_back(state);
+                }
+              }
+            }
+            return Status::Ok();
+          }, 1 << 14);
+      if (erased != nullptr) {
+        erased->insert(erased->end(), erased_ids.begin(), erased_ids.end());
+      }
+      return erased_ids.size();
+    }
+    QRWLocker lock(lock_, QRWLocker::kWrite);
+    size_t size = 0;
+    for (size_t id : ids) {
+      KeyType key;
+      Bucket* bucket;
+      size_t slot;
+      if (!id_keys_.Get(id, &key) || !Locate(key, Hash(key), &bucket, &slot)
+          || bucket->states[slot].load(std::memory_order_relaxed) != id) {
+        continue;
+      }
+      bucket->states[slot].store(kDeleted, std::memory_order_relaxed);
+      free_list_.push(id);
+      if (erased != nullptr) {
+        erased->push_back(id);
+      }
+      size++;
+    }
+    return size;
+  }
+
+  virtual size_t GetBucketCount(const std::string& variable_name) {
+    return bucket_count_;
+  }
+
+  virtual size_t MemoryBytes() {
+    QRWLocker lock(lock_, QRWLocker::kRead);
+    return bucket_count_ * sizeof(Bucket) + id_keys_.Bytes();
+  }
+
+  void GetItems(HashMapStruct<KeyType>* result) {
+    QRWLocker lock(lock_, QRWLocker::kRead);
+    MultiThreadDo(bucket_count_, [&](const Range& r) {
+          for (size_t b = r.begin; b < r.end; b++) {
+            Bucket& bucket = buckets_[b];
+            for (size_t s = 0; s < kSlotsPerBucket; s++) {
+              uint64_t state = bucket.states[s].load(std::memory_order_acquire);
+              if (state == kEmpty) {
+                break;
+              }
+              if (state != kDeleted) {
+                result->items.push_back(HashMapItem<KeyType>{.key=bucket.keys[s], .id=state});
+              }
+            }
+          }
+          return Status::Ok();
+        }, 1 << 14);
+    result->count = result->items.size();
+  }
+
+  //只应调用偏特化版本
+  inline void GetKey(const int64_t* keys, int index, KeyType* result) {
+    throw std::invalid_argument("GetKey for HashMap base should not be called");
+  }
+
+  NonCocurrentHashTable* NewBlackList() {
+    black_list_.reset(new NonCocurrentHashTable);
+    return black_list_.get();
+  }
+
+  NonCocurrentHashTable* NewWhiteList() {
+    white_list_.reset(new NonCocurrentHashTable);
+    return white_list_.get();
+  }
+
+  NonCocurrentHashTable* GetBlackList() {
+    return black_list_.get();
+  }
+
+  NonCocurrentHashTable* GetWhiteList() {
+    return white_list_.get();
+  }
+
+  // The ids of the filtered keys are reused as by Erase.
+  size_t FilterByBlackList() {
+    QRWLocker lock(lock_, QRWLocker::kWrite);
+    size_t size = 0;
+    for (auto&& key : *black_list_) {
+      Bucket* bucket;
+      size_t slot;
+      if (Locate(key, Hash(key), &bucket, &slot)) {
+        free_list_.push(bucket->states[slot].load(std::memory_order_relaxed));
+        bucket->states[slot].store(kDeleted, std::memory_order_relaxed);
+        size++;
+      }
+    }
+    return size;
+  }
+
+  size_t FilterByWhiteList() {
+    QRWLocker lock(lock_, QRWLocker::kWrite);
+    std::atomic<size_t> size(0);
+    MultiThreadDo(bucket_count_, [&](const Range& r) {
+          for (size_t b = r.begin; b < r.end; b++) {
+            Bucket& bucket = buckets_[b];
+            for (size_t s = 0; s < kSlotsPerBucket; s++) {
+              uint64_t state = bucket.states[s].load(std::memory_order_relaxed);
+              if (state == kEmpty) {
+                break;
+              }
+              if (state != kDeleted && white_list_->find(bucket.keys[s]) == white_list_->end()) {
+                bucket.states[s].store(kDeleted, std::memory_order_relaxed);
+                free_list_.push(state);
+                size++;
+              }
+            }
+          }
+          return Status::Ok();
+        }, 1 << 14);
+    return size;
+  }
+
+ private:
+  static Bucket* AllocBuckets(size_t count) {
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, kCacheLineSize, count * sizeof(Bucket)) != 0) {
+      throw std::bad_alloc();
+    }
+    Bucket* buckets = reinterpret_cast<Bucket*>(ptr);
+    for (size_t b = 0; b < count; b++) {
+      for (size_t s = 0; s < kSlotsPerBucket; s++) {
+        buckets[b].states[s].store(kEmpty, std::memory_order_relaxed);
+      }
+    }
+    return buckets;
+  }
+
+  static inline size_t Mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  inline size_t Hash(const KeyType& key) const;
+
+  // Bitmask of the slots in bucket whose key equals key.
+  inline uint32_t MatchMask(const Bucket& bucket, const KeyType& key) const;
+
+  // Capacity the table may be filled to before it has to grow.
+  size_t Limit(size_t bucket_count) const {
+    return bucket_count * kSlotsPerBucket / 4 * 3;
+  }
+
+  // Leaves the read lock held with room for size more keys reserved.
+  void Reserve(size_t size) {
+    while (true) {
+      lock_.ReadLock();
+      size_t reserved = reserved_.fetch_add(size) + size;
+      if (used_.load() + reserved <= Limit(bucket_count_)) {
+        return;
+      }
+      reserved_ -= size;
+      lock_.ReadUnlock();
+      QRWLocker lock(lock_, QRWLocker::kWrite);
+      if (used_.load() + size > Limit(bucket_count_)) {
+        Rehash(size);
+      }
+    }
+  }
+
+  // Drops tombstones and grows the table until extra more keys fit.
+  // Runs under write lock.
+  void Rehash(size_t extra) {
+    size_t live = 0;
+    for (size_t b = 0; b < bucket_count_; b++) {
+      for (size_t s = 0; s < kSlotsPerBucket; s++) {
+        uint64_t state = buckets_[b].states[s].load(std::memory_order_relaxed);
+        if (state != kEmpty && state != kDeleted) {
+          live++;
+        }
+      }
+    }
+    size_t bucket_count = bucket_count_;
+    while (Limit(bucket_count) < live + extra) {
+      bucket_count <<= 1;
+    }
+    Bucket* buckets = AllocBuckets(bucket_count);
+    size_t mask = bucket_count - 1;
+    for (size_t b = 0; b < bucket_count_; b++) {
+      for (size_t s = 0; s < kSlotsPerBucket; s++) {
+        uint64_t state = buckets_[b].states[s].load(std::memory_order_relaxed);
+        if (state == kEmpty || state == kDeleted) {
+          continue;
+        }
+        const KeyType& key = buckets_[b].keys[s];
+        for (size_t nb = Hash(key) & mask;; nb = (nb + 1) & mask) {
+          size_t ns = 0;
+          while (ns < kSlotsPerBucket && buckets[nb].states[ns].load(std::memory_order_relaxed) != kEmpty) {
+            ns++;
+          }
+          if (ns < kSlotsPerBucket) {
+            buckets[nb].keys[ns] = key;
+            buckets[nb].states[ns].store(state, std::memory_order_relaxed);
+            break;
+          }
+        }
+      }
+    }
+    free(buckets_);
+    buckets_ = buckets;
+    bucket_count_ = bucket_count;
+    used_ = live;
+  }
+
+  // Loads every state of the bucket, waiting for in-flight inserts.
+  inline void LoadStates(const Bucket& bucket, uint64_t* states) const {
+    for (size_t s = 0; s < kSlotsPerBucket; s++) {
+      uint64_t state;
+      while ((state = bucket.states[s].load(std::memory_order_acquire)) == kBusy) {
+        asm volatile("pause" ::: "memory");
+      }
+      states[s] = state;
+    }
+  }
+
+  bool Locate(const KeyType& key, size_t hash, Bucket** result, size_t* slot) const {
+    size_t mask = bucket_count_ - 1;
+    for (size_t b = hash & mask;; b = (b + 1) & mask) {
+      Bucket& bucket = buckets_[b];
+      uint64_t states[kSlotsPerBucket];
+      LoadStates(bucket, states);
+      uint32_t match = MatchMask(bucket, key);
+      for (size_t s = 0; s < kSlotsPerBucket; s++) {
+        if (states[s] == kEmpty) {
+          return false;
+        }
+        if (states[s] != kDeleted && (match & (1u << s))) {
+          *result = &bucket;
+          *slot = s;
+          return true;
+        }
+      }
+    }
+  }
+
+  inline bool Find(const KeyType& key, size_t hash, uint64_t* id) const {
+    Bucket* bucket;
+    size_t slot;
+    if (!Locate(key, hash, &bucket, &slot)) {
+      return false;
+    }
+    *id = bucket->states[slot].load(std::memory_order_relaxed);
+    return true;
+  }
+
+  size_t Insert(const KeyType& key, size_t hash, tbb::concurrent_vector<size_t>* reused_ids) {
+    size_t mask = bucket_count_ - 1;
+    for (size_t b = hash & mask;; b = (b + 1) & mask) {
+      Bucket& bucket = buckets_[b];
+      for (size_t s = 0; s < kSlotsPerBucket;) {
+        uint64_t state;
+        while ((state = bucket.states[s].load(std::memory_order_acquire)) == kBusy) {
+          asm volatile("pause" ::: "memory");
+        }
+        if (state == kEmpty) {
+          if (!bucket.states[s].compare_exchange_strong(state, kBusy)) {
+            continue;
+          }
+          bucket.keys[s] = key;
+          used_++;
+          size_t id;
+          if (free_list_.try_pop(id)) {
+            reused_ids->push_back(id);
+          } else {
+            id = offset_++;
+          }
+          if (id_keys_.Tracking()) {
+            id_keys_.Set(id, key);
+          }
+          bucket.states[s].store(id, std::memory_order_release);
+          return id;
+        }
+        if (state != kDeleted && bucket.keys[s] == key) {
+          return state;
+        }
+        s++;
+      }
+    }
+  }
+
+  Bucket* buckets_;
+  size_t bucket_count_;
+  std::atomic<size_t> used_;
+  std::atomic<size_t> reserved_;
+  IdKeys<KeyType> id_keys_;
+  std::unique_ptr<NonCocurrentHashTable> black_list_, white_list_;
+  QRWLock lock_;
+};
+
+template<>
+inline void OpenHashMapImpl<int64_t>::GetKey(const int64_t* keys, int index, int64_t* result) {
+  *result = keys[index];
+}
+
+template<>
+inline void OpenHashMapImpl<Hash128Key>::GetKey(const int64_t* keys, int index, Hash128Key* result) {
+  result->hash1 = keys[2*index];
+  result->hash2 = keys[2*index+1];
+}
+
+template<>
+inline size_t OpenHashMapImpl<int64_t>::Hash(const int64_t& key) const {
+  return Mix(key);
+}
+
+template<>
+inline size_t OpenHashMapImpl<Hash128Key>::Hash(const Hash128Key& key) const {
+  return Mix(tbb::tbb_hash_compare<Hash128Key>::GetHashKey(key.hash1, key.hash2));
+}
+
+template<>
+inline uint32_t OpenHashMapImpl<int64_t>::MatchMask(const Bucket& bucket, const int64_t& key) const {
+#if defined(__AVX2__)
+  __m256i keys = _mm256_load_si256(reinterpret_cast<const __m256i*>(bucket.keys));
+  __m256i cmp = _mm256_cmpeq_epi64(keys, _mm256_set1_epi64x(key));
+  return _mm256_movemask_pd(_mm256_castsi256_pd(cmp));
+#else
+  uint32_t mask = 0;
+  for (size_t s = 0; s < kSlotsPerBucket; s++) {
+    mask |= (uint32_t)(bucket.keys[s] == key) << s;
+  }
+  return mask;
+#endif
+}
+
+template<>
+inline uint32_t OpenHashMapImpl<Hash128Key>::MatchMask(const Bucket& bucket, const Hash128Key& key) const {
+#if defined(__SSE2__)
+  __m128i target = _mm_set_epi64x(key.hash2, key.hash1);
+  uint32_t mask = 0;
+  for (size_t s = 0; s < kSlotsPerBucket; s++) {
+    __m128i cmp = _mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(&bucket.keys[s])), target);
+    mask |= (uint32_t)(_mm_movemask_epi8(cmp) == 0xFFFF) << s;
+  }
+  return mask;
+#else
+  uint32_t mask = 0;
+  for (size_t s = 0; s < kSlotsPerBucket; s++) {
+    mask |= (uint32_t)(bucket.keys[s] == key) << s;
+  }
+  return mask;
+#endif
+}
+
+// Creates the hashmap backend selected by the "hashmap" variable arg,
+// "tbb" (default, HashMapImpl) or "open" (OpenHashMapImpl).
+Status CreateHashMap(const std::string& backend, bool hash64, size_t hint, HashMap** result);
+
+} //ps
+
+#endif //PS_COMMON_OPEN_HASHMAP_H
@@ -19,6 +19,7 @@ limitations under the License.
 #include <atomic>
 #include <pthread.h>
 #include <iostream>
+#include <thread>
 
 namespace ps {
 
@@ -49,7 +50,15 @@ class QRWLock {
   void WriteLock() {
     simple_lock_ += 0x10000;
     pthread_rwlock_wrlock(&lock_);
-    while ((simple_lock_.load(std::memory_order_relaxed) & 0xFFFF) != 0);
+    // simple readers only hold the lock for one request, give up the cpu to them
+    // instead of burning it when they take long
+    for (size_t spin = 0; (simple_lock_.load(std::memory_order_acquire) & 0xFFFF) != 0; spin++) {
+      if (spin < kSpinCount) {
+        __builtin_ia32_pause();
+      } else {
+        std::this_thread::yield();
+      }
+    }
   }
 
   void SimpleReadUnlock() {
@@ -66,6 +75,7 @@ class QRWLock {
   }
  private:
   QRWLock(const QRWLock&) = delete;
+  static const size_t kSpinCount = 1024;
   pthread_rwlock_t lock_;
   std::atomic<uint32_t> simple_lock_;
 };
@@ -0,0 +1,230 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/common/reduced_precision.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace ps {
+
+namespace {
+
+const uint32_t kNearest = 0x80000000u;
+
+inline uint32_t NextRandom(uint64_t* seed) {
+  if (seed == nullptr) {
+    return kNearest;
+  }
+  uint64_t x = *seed == 0 ? 0x9E3779B97F4A7C15ull : *seed;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  *seed = x;
+  return x >> 32;
+}
+
+inline uint32_t FloatBits(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+inline float BitsFloat(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+}
+
+Status ParseStoragePrecision(const std::string& name, StoragePrecision* result) {
+  if (name == "" || name == "float" || name == "fp32") {
+    *result = StoragePrecision::kFloat;
+  } else if (name == "fp16" || name == "half") {
+    *result = StoragePrecision::kFp16;
+  } else if (name == "bf16") {
+    *result = StoragePrecision::kBf16;
+  } else if (name == "int8") {
+    *result = StoragePrecision::kInt8;
+  } else {
+    return Status::ArgumentError("Unknown storage precision " + name);
+  }
+  return Status::Ok();
+}
+
+DataType EncodedDataType(StoragePrecision precision) {
+  switch (precision) {
+  case StoragePrecision::kFp16:
+  case StoragePrecision::kBf16:
+    return DataType::kInt16;
+  case StoragePrecision::kInt8:
+    return DataType::kInt8;
+  default:
+    return DataType::kFloat;
+  }
+}
+
+size_t EncodedRowBytes(StoragePrecision precision, size_t size) {
+  switch (precision) {
+  case StoragePrecision::kFp16:
+  case StoragePrecision::kBf16:
+    return size * sizeof(uint16_t);
+  case StoragePrecision::kInt8:
+    return sizeof(float) + size;
+  default:
+    return size * sizeof(float);
+  }
+}
+
+uint16_t FloatToHalf(float value, uint32_t rnd) {
+  uint32_t bits = FloatBits(value);
+  uint16_t sign = (bits >> 16) & 0x8000;
+  uint32_t abs = bits & 0x7FFFFFFF;
+  if (abs >= 0x7F800000) {
+    return sign | 0x7C00 | (abs > 0x7F800000 ? 0x200 : 0);
+  }
+  int32_t exp = (int32_t)(abs >> 23) - 127 + 15;
+  if (exp >= 31) {
+    return sign | 0x7C00;
+  }
+  if (exp <= 0) {
+    // subnormal half, mantissa has to be shifted by 14 - exp bits
+    int32_t shift = 14 - exp;
+    if (shift > 24) {
+      return sign;
+    }
+    uint32_t mantissa = (abs & 0x7FFFFF) | 0x800000;
+    return sign | ((mantissa + (rnd >> (32 - shift))) >> shift);
+  }
+  uint32_t v = ((uint32_t)exp << 23) | (abs & 0x7FFFFF);
+  v = (v + (rnd >> 19)) >> 13;
+  if (v >= 0x7C00) {
+    v = 0x7C00;
+  }
+  return sign | v;
+}
+
+float HalfToFloat(uint16_t value) {
+  uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+  uint32_t exp = (value >> 10) & 0x1F;
+  uint32_t mantissa = value & 0x3FF;
+  if (exp == 0x1F) {
+    return BitsFloat(sign | 0x7F800000 | (mantissa << 13));
+  }
+  if (exp == 0) {
+    if (mantissa == 0) {
+      return BitsFloat(sign);
+    }
+    exp = 127 - 14;
+    while ((mantissa & 0x400) == 0) {
+      mantissa <<= 1;
+      exp--;
+    }
+    mantissa &= 0x3FF;
+    return BitsFloat(sign | (exp << 23) | (mantissa << 13));
+  }
+  return BitsFloat(sign | ((exp + 127 - 15) << 23) | (mantissa << 13));
+}
+
+uint16_t FloatToBFloat16(float value, uint32_t rnd) {
+  uint32_t bits = FloatBits(value);
+  if ((bits & 0x7FFFFFFF) > 0x7F800000) {
+    return (bits >> 16) | 0x40;
+  }
+  if ((bits & 0x7FFFFFFF) == 0x7F800000) {
+    return bits >> 16;
+  }
+  // finite values carry at most into infinity
+  return (bits + (rnd >> 16)) >> 16;
+}
+
+float BFloat16ToFloat(uint16_t value) {
+  return BitsFloat((uint32_t)value << 16);
+}
+
+void DecodeRow(StoragePrecision precision, const void* src, size_t size, float* dst) {
+  switch (precision) {
+  case StoragePrecision::kFp16: {
+    const uint16_t* s = reinterpret_cast<const uint16_t*>(src);
+    for (size_t i = 0; i < size; i++) {
+      dst[i] = HalfToFloat(s[i]);
+    }
+    break;
+  }
+  case StoragePrecision::kBf16: {
+    const uint16_t* s = reinterpret_cast<const uint16_t*>(src);
+    for (size_t i = 0; i < size; i++) {
+      dst[i] = BFloat16ToFloat(s[i]);
+    }
+    break;
+  }
+  case StoragePrecision::kInt8: {
+    float scale;
+    memcpy(&scale, src, sizeof(scale));
+    const int8_t* s = reinterpret_cast<const int8_t*>(src) + sizeof(scale);
+    for (size_t i = 0; i < size; i++) {
+      dst[i] = s[i] * scale;
+    }
+    break;
+  }
+  default:
+    memcpy(dst, src, size * sizeof(float));
+  }
+}
+
+void EncodeRow(StoragePrecision precision, const float* src, size_t size, void* dst, uint64_t* seed) {
+  switch (precision) {
+  case StoragePrecision::kFp16: {
+    uint16_t* d = reinterpret_cast<uint16_t*>(dst);
+    for (size_t i = 0; i < size; i++) {
+      d[i] = FloatToHalf(src[i], NextRandom(seed));
+    }
+    break;
+  }
+  case StoragePrecision::kBf16: {
+    uint16_t* d = reinterpret_cast<uint16_t*>(dst);
+    for (size_t i = 0; i < size; i++) {
+      d[i] = FloatToBFloat16(src[i], NextRandom(seed));
+    }
+    break;
+  }
+  case StoragePrecision::kInt8: {
+    float absmax = 0;
+    for (size_t i = 0; i < size; i++) {
+      absmax = std::max(absmax, std::fabs(src[i]));
+    }
+    float scale = absmax / 127;
+    memcpy(dst, &scale, sizeof(scale));
+    int8_t* d = reinterpret_cast<int8_t*>(dst) + sizeof(scale);
+    if (scale == 0 || !std::isfinite(scale)) {
+      memset(d, 0, size);
+      break;
+    }
+    float inv = 1 / scale;
+    for (size_t i = 0; i < size; i++) {
+      float q = std::floor(src[i] * inv + NextRandom(seed) * (1.0f / 4294967296.0f));
+      d[i] = (int8_t)std::max(-127.0f, std::min(127.0f, q));
+    }
+    break;
+  }
+  default:
+    memcpy(dst, src, size * sizeof(float));
+  }
+}
+
+}
+
@@ -0,0 +1,57 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_COMMON_REDUCED_PRECISION_H_
+#define PS_PLUS_COMMON_REDUCED_PRECISION_H_
+
+#include "ps-plus/common/status.h"
+#include "ps-plus/common/types.h"
+
+#include <cstdint>
+#include <string>
+
+namespace ps {
+
+// Storage format of a row of floats.
+// kFp16 / kBf16 keep one 16-bit value per element,
+// kInt8 keeps a float scale followed by one int8 per element (row-wise absmax scaling).
+enum class StoragePrecision : int32_t {
+  kFloat = 0,
+  kFp16 = 1,
+  kBf16 = 2,
+  kInt8 = 3
+};
+
+Status ParseStoragePrecision(const std::string& name, StoragePrecision* result);
+
+// DataType used to hold encoded rows, the row occupies EncodedRowBytes / SizeOfType bytes.
+DataType EncodedDataType(StoragePrecision precision);
+size_t EncodedRowBytes(StoragePrecision precision, size_t size);
+
+void DecodeRow(StoragePrecision precision, const void* src, size_t size, float* dst);
+
+// When seed is nullptr values are rounded to nearest, otherwise rounding is stochastic
+// and seed is advanced as an xorshift state.
+void EncodeRow(StoragePrecision precision, const float* src, size_t size, void* dst, uint64_t* seed);
+
+uint16_t FloatToHalf(float value, uint32_t rnd);
+float HalfToFloat(uint16_t value);
+uint16_t FloatToBFloat16(float value, uint32_t rnd);
+float BFloat16ToFloat(uint16_t value);
+
+}
+
+#endif
+
@@ -28,6 +28,7 @@ limitations under the License.
 #include "ps-plus/server/slice.h"
 #include "ps-plus/common/initializer/none_initializer.h"
 #include "ps-plus/common/initializer/constant_initializer.h"
+#include "ps-plus/common/initializer/encoded_constant_initializer.h"
 #include "ps-plus/common/initializer/normal_initializer.h"
 #include "ps-plus/common/initializer/truncated_normal_initializer.h"
 #include "ps-plus/common/initializer/variance_scaling_initializer.h"
@@ -433,32 +434,36 @@ ps::Status SerializeHelper::Serialize<std::vector<ps::Tensor> >(
   if (tvec->size() == 1) {
     return SerializeHelper::SerializeVec<ps::Tensor>(tvec, bufs, mem_guard);
   }
+  // Only the headers are written here, the payloads are sent from the
+  // tensor buffers, no initializers follow them.
   size_t buffer_size = sizeof(size_t);
   for (size_t i = 0; i < tvec->size(); i++) {
     const ps::Tensor* t = &tvec->at(i);
+    if (t->tensor_type_ != Tensor::TType::kContinuous) {
+      return Status::ArgumentError("SegmentTensor can't be serialized");
+    }
     buffer_size += sizeof(ps::DataType) + (1 + t->state_->shape.Size()) * sizeof(size_t);
-    buffer_size += t->Shape().NumElements() * SizeOfType(t->Type());
   }
   char* buffer = mem_guard.AllocateBuffer(buffer_size);
   *(size_t*)buffer = tvec->size();
+  bufs->push_back(Fragment{.base=buffer, .size=sizeof(size_t)});
   size_t offset = sizeof(size_t);
   for (size_t i = 0; i < tvec->size(); i++) {
     const ps::Tensor* t = &tvec->at(i);
-    if (t->tensor_type_ != Tensor::TType::kContinuous) {
-      return Status::ArgumentError("SegmentTensor can't be serialized");
-    }
+    char* header = buffer + offset;
     *(ps::DataType*)(buffer+offset) = t->state_->type;
     offset += sizeof(ps::DataType);
     *(size_t*)(buffer + offset) = t->state_->shape.Size();
     offset += sizeof(size_t);
     memcpy(buffer + offset, &(t->state_->shape.dims_[0]), t->state_->shape.Size() * sizeof(size_t));
     offset += t->state_->shape.Size() * sizeof(size_t);
+    bufs->push_back(Fragment{.base=header, .size=(size_t)(buffer + offset - header)});
     ps::Tensor::ContinuousState* state = dynamic_cast<ps::Tensor::ContinuousState*>(t->state_);
     size_t size = t->Shape().NumElements() * SizeOfType(t->Type());    
-    memcpy(buffer + offset, state->buffer, size);
-    offset += size;
+    if (size > 0) {
+      bufs->push_back(Fragment{.base=state->buffer, .size=size});
+    }
   }
-  bufs->push_back(Fragment{.base=buffer, .size=buffer_size});
   return Status::Ok();
 }
 
@@ -553,6 +558,7 @@ ps::Status SerializeHelper::Deserialize<std::vector<ps::Tensor> >(const char* bu
 using Initializer = ps::Initializer;
 using NoneInitializer = ps::initializer::NoneInitializer;
 using ConstantInitializer = ps::initializer::ConstantInitializer;
+using EncodedConstantInitializer = ps::initializer::EncodedConstantInitializer;
 using TruncatedNormalInitializer = ps::initializer::TruncatedNormalInitializer;
 using NormalInitializer = ps::initializer::NormalInitializer;
 using VarianceScalingInitializer = ps::initializer::VarianceScalingInitializer;
@@ -615,6 +621,58 @@ class ConstantInitializerDeserializer:
   }
 };
 
+class EncodedConstantInitializerSerializer: 
+    public Serializer<Initializer, EncodedConstantInitializer> {
+ public:
+  virtual ps::Status Serialize(EncodedConstantInitializer* data, 
+                               std::vector<Fragment>* bufs,
+                               MemGuard& mem_guard) {
+    SerializeHelper::Serialize<int>(
+        mem_guard.AllocateElement<int>((int)data->precision_), 
+        bufs, mem_guard);
+    SerializeHelper::Serialize<double>(&data->c_, 
+                                       bufs, 
+                                       mem_guard);
+    SerializeHelper::Serialize<int64_t>(
+        mem_guard.AllocateElement<int64_t>(data->slice_size_), 
+        bufs, mem_guard);
+    return ps::Status::Ok();
+  }
+};
+
+class EncodedConstantInitializerDeserializer: 
+    public Deserializer<Initializer, EncodedConstantInitializer> {
+ public:
+  virtual ps::Status Deserialize(Fragment* buf, 
+                                 size_t offset, 
+                                 EncodedConstantInitializer** result, 
+                                 size_t* len,
+                                 MemGuard& mem_guard) {
+    size_t field_len;
+    int precision;
+    char* base = buf->base + offset;
+    SerializeHelper::Deserialize<int>(base, 
+                                      &precision, 
+                                      &field_len, 
+                                      mem_guard);
+    *len = field_len;
+    double value;
+    SerializeHelper::Deserialize<double>(base + *len, 
+                                         &value, 
+                                         &field_len, 
+                                         mem_guard);
+    *len += field_len;
+    int64_t slice_size;
+    SerializeHelper::Deserialize<int64_t>(base + *len, 
+                                          &slice_size, 
+                                          &field_len, 
+                                          mem_guard);
+    *len += field_len;
+    *result = new EncodedConstantInitializer((ps::StoragePrecision)precision, value, slice_size);
+    return ps::Status::Ok();
+  }
+};
+
 class TruncatedNormalInitializerSerializer: 
     public Serializer<Initializer, TruncatedNormalInitializer> {
  public:
@@ -1182,6 +1240,9 @@ DESERIALIZER_REGISTER(ps::serializer::NoneInitializerDeserializer);
 SERIALIZER_REGISTER(ps::serializer::ConstantInitializerSerializer);
 DESERIALIZER_REGISTER(ps::serializer::ConstantInitializerDeserializer);
 
+SERIALIZER_REGISTER(ps::serializer::EncodedConstantInitializerSerializer);
+DESERIALIZER_REGISTER(ps::serializer::EncodedConstantInitializerDeserializer);
+
 SERIALIZER_REGISTER(ps::serializer::TruncatedNormalInitializerSerializer);
 DESERIALIZER_REGISTER(ps::serializer::TruncatedNormalInitializerDeserializer);
 
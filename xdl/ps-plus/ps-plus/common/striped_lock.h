@@ -0,0 +1,112 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_COMMON_STRIPED_LOCK_H_
+#define PS_COMMON_STRIPED_LOCK_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+namespace ps {
+
+// Spin locks striped by row id. Serializes concurrent updates of the same row
+// without a lock per row; two rows may share a stripe. The stripes are one
+// cache line each, allocated apart from the owner so that it keeps its
+// natural alignment, and no more of them than the rows are created.
+class StripedLock {
+ public:
+  static const size_t kMaxStripes = 256;
+
+  explicit StripedLock(size_t rows = kMaxStripes) {
+    size_t stripes = 1;
+    while (stripes < rows && stripes < kMaxStripes) {
+      stripes <<= 1;
+    }
+    mask_ = stripes - 1;
+    void* buffer = nullptr;
+    if (posix_memalign(&buffer, kCacheLine, stripes * sizeof(Stripe)) != 0) {
+      throw std::bad_alloc();
+    }
+    stripes_ = static_cast<Stripe*>(buffer);
+    for (size_t i = 0; i < stripes; i++) {
+      new (&stripes_[i]) Stripe;
+      stripes_[i].locked.store(false, std::memory_order_relaxed);
+    }
+  }
+
+  ~StripedLock() {
+    for (size_t i = 0; i <= mask_; i++) {
+      stripes_[i].~Stripe();
+    }
+    free(stripes_);
+  }
+
+  size_t Stripes() const { return mask_ + 1; }
+
+  void Lock(size_t id) {
+    std::atomic<bool>& locked = stripes_[Index(id)].locked;
+    for (size_t spin = 0; ; spin++) {
+      if (!locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire)) {
+        return;
+      }
+      if (spin < kSpinCount) {
+        __builtin_ia32_pause();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void Unlock(size_t id) {
+    stripes_[Index(id)].locked.store(false, std::memory_order_release);
+  }
+
+ private:
+  StripedLock(const StripedLock&) = delete;
+  StripedLock& operator=(const StripedLock&) = delete;
+  static const size_t kSpinCount = 256;
+  static const size_t kCacheLine = 64;
+  size_t Index(size_t id) const {
+    return ((id * 0x9E3779B97F4A7C15ull) >> 32) & mask_;
+  }
+  struct Stripe {
+    std::atomic<bool> locked;
+    char padding[kCacheLine - sizeof(std::atomic<bool>)];
+  };
+  Stripe* stripes_;
+  size_t mask_;
+};
+
+class StripedLocker {
+ public:
+  StripedLocker(StripedLock& lock, size_t id) : lock_(&lock), id_(id) {
+    lock_->Lock(id_);
+  }
+  ~StripedLocker() {
+    lock_->Unlock(id_);
+  }
+ private:
+  StripedLocker(const StripedLocker&) = delete;
+  StripedLock* lock_;
+  size_t id_;
+};
+
+}
+
+#endif
+
@@ -16,6 +16,10 @@ limitations under the License.
 #include "ps-plus/common/tensor.h"
 #include "ps-plus/common/logging.h"
 #include <cstring>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace ps {
 
@@ -24,7 +28,7 @@ Tensor::Tensor(TType tensor_type) : state_(nullptr), tensor_type_(tensor_type) {
 Tensor::Tensor(DataType type, const TensorShape& shape, Initializer* initializer, TType tensor_type, bool init) {
   tensor_type_ = tensor_type;
   if (tensor_type == TType::kContinuous) {
-    state_ = new ContinuousState(new char[SizeOfType(type) * shape.NumElements()], type, shape, initializer, true, init);
+    state_ = new ContinuousState(BufferPool::Allocate(SizeOfType(type) * shape.NumElements()), type, shape, initializer, true, init, true);
   } else {
     state_ = new SegmentState(type, shape, initializer, init, DEFAULT_SEGMENT_SIZE);
   }
@@ -36,6 +40,9 @@ Tensor::Tensor(DataType type, const TensorShape& shape, char* buffer, Initialize
 Tensor::Tensor(DataType type, const TensorShape& shape, Initializer* initializer, bool init, size_t segment_size)
   : state_(new SegmentState(type, shape, initializer, init, segment_size)), tensor_type_(TType::kSegment) {}
 
+Tensor::Tensor(DataType type, const TensorShape& shape, Initializer* initializer, bool init, size_t segment_size, size_t reserve_bytes)
+  : state_(new SegmentState(type, shape, initializer, init, segment_size, reserve_bytes)), tensor_type_(TType::kSegment) {}
+
 Tensor::Tensor(const Tensor& rhs) : state_(rhs.state_), tensor_type_(rhs.tensor_type_) {
   Ref();
 }
@@ -67,12 +74,12 @@ Status Tensor::InitChunkFrom(const size_t& start_index) {
     return Status::NotImplemented("ContinuousTensor can't support InitChunkFrom function");
   }
   SegmentState* state = dynamic_cast<SegmentState*>(state_);
-  size_t trunk_start = start_index % state->segment_size;
+  size_t segment_size = state->segments->segment_size;
+  size_t trunk_start = start_index % segment_size;
   if (trunk_start == 0) {
     return Status::Ok();
   }
-  void* ptr = state->Raw(start_index);
-  state->initializer->MultiThreadInit(ptr, state->type, (state->segment_size - trunk_start) * state->slice_size);
+  state->InitRows(start_index, start_index - trunk_start + segment_size);
   //LOG_INFO("Call InitChunkFrom in tensor, start %ld, trunk_start %ld, size %ld", start_index, trunk_start, (state->segment_size - trunk_start) * state->slice_size);
   return Status::Ok();
 }
@@ -81,13 +88,13 @@ void Tensor::ReShape(const TensorShape& shape) {
   if (tensor_type_ == TType::kContinuous) {
     size_t old_size = state_->shape.NumElements() * SizeOfType(state_->type);
     size_t new_size = shape.NumElements() * SizeOfType(state_->type);
-    ContinuousState* new_state = new ContinuousState(new char[new_size], state_->type, shape, state_->initializer->Clone(), true, false);
+    ContinuousState* new_state = new ContinuousState(BufferPool::Allocate(new_size), state_->type, shape, state_->initializer->Clone(), true, false, true);
     ContinuousState* old_state = dynamic_cast<ContinuousState*>(state_);
     if (new_size <= old_size) {
       QuickMemcpy(new_state->buffer, old_state->buffer, new_size);
     } else {
       QuickMemcpy(new_state->buffer, old_state->buffer, old_size);
-      new_state->initializer->MultiThreadInit(new_state->buffer + old_size, new_state->type, new_state->shape.NumElements() - state_->shape.NumElements());
+      new_state->initializer->MultiThreadInitAt(new_state->buffer + old_size, new_state->type, new_state->shape.NumElements() - state_->shape.NumElements(), state_->shape.NumElements());
     }
     UnRef();
     state_ = new_state;
@@ -97,24 +104,130 @@ void Tensor::ReShape(const TensorShape& shape) {
       std::cerr << "state_ for segment tensor is nullptr\n";
       abort();
     }
-    size_t index = shape[0]/state->segment_size;
-    if (state->buffers.size() > index && state->buffers[index] != nullptr) {
+    Segments* segments = state->segments.get();
+    size_t index = shape[0]/segments->segment_size;
+    if (index < state->published.load(std::memory_order_acquire)) {
       return;
     }
-    while (state->buffers.size() <= index) {
-      char* ptr = new char[state->chunk_size];
-      state->initializer->MultiThreadInit(ptr, state->type, state->slice_size * state->segment_size);
-      state->buffers.push_back(ptr);
-    }
-    while (state->buffers[index] == nullptr) {
+    // segments are fully initialized before they are published, the
+    // grow only appends chunks, so the rows never move or get copied and
+    // readers of existing rows never wait for it. The chunks may be grown
+    // by another tensor of the rows already.
+    std::lock_guard<std::mutex> lock(segments->grow_mu);
+    segments->Grow(index);
+    state->shape.Set(0, segments->buffers.size() * segments->segment_size);
+    state->published.store(segments->buffers.size(), std::memory_order_release);
+  }
+}
+
+void Tensor::Segments::Grow(size_t segment) {
+  while (buffers.size() <= segment) {
+    char* ptr = arena->Allocate();
+    size_t begin = buffers.size() * segment_size;
+    // the fields are inited on the chunk before it is reachable by Row
+    for (SegmentState* field : fields) {
+      field->InitRows(begin, begin + segment_size, ptr);
     }
-    state->shape.Set(0, state->buffers.size() * state->segment_size);
+    buffers.push_back(ptr);
+  }
+  published.store(buffers.size(), std::memory_order_release);
+}
+
+void Tensor::SegmentState::InitRows(size_t begin, size_t end) {
+  InitRows(begin, end, segments->buffers[begin / segments->segment_size]);
+}
+
+void Tensor::SegmentState::InitRows(size_t begin, size_t end, char* chunk) {
+  if (initializer == nullptr || begin >= end) {
+    return;
+  }
+  size_t stride = segments->row_stride;
+  char* first = chunk + (begin % segments->segment_size) * stride + offset;
+  if (!Interleaved()) {
+    initializer->MultiThreadInitAt(first, type, (end - begin) * slice_size, begin * slice_size);
+    return;
+  }
+  // the rows are keyed by their ids, so they can be inited in any order
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, end - begin, 256), [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i < r.end(); i++) {
+          initializer->InitAt(first + i * stride, type, slice_size, (begin + i) * slice_size);
+        }
+      });
+}
+
+Status Tensor::AddRowField(DataType type, const TensorShape& shape, Initializer* initializer, bool init, Tensor* field) const {
+  SegmentState* state = dynamic_cast<SegmentState*>(state_);
+  if (state == nullptr) {
+    delete initializer;
+    return Status::NotImplemented("ContinuousTensor can't support AddRowField function");
+  }
+  if (shape.IsScalar()) {
+    delete initializer;
+    return Status::ArgumentError("AddRowField: field should not be scalar");
   }
+  Segments* segments = state->segments.get();
+  size_t row_bytes = shape.NumElements() / shape[0] * SizeOfType(type);
+  size_t align = std::min(SizeOfType(type), sizeof(double));
+  std::lock_guard<std::mutex> lock(segments->grow_mu);
+  size_t offset = (segments->used + align - 1) / align * align;
+  if (offset + row_bytes > segments->row_stride) {
+    delete initializer;
+    return Status::NotFound("AddRowField: " + std::to_string(segments->row_stride - segments->used) + " bytes left in the rows");
+  }
+  segments->used = offset + row_bytes;
+  Tensor ret(TType::kSegment);
+  ret.state_ = new SegmentState(type, shape, initializer, init, state->segments, offset);
+  *field = std::move(ret);
+  return Status::Ok();
+}
+
+size_t Tensor::RowStride() const {
+  SegmentState* state = dynamic_cast<SegmentState*>(state_);
+  if (state == nullptr) {
+    return state_->shape.IsScalar() ? 0 : state_->shape.NumElements() / state_->shape[0] * SizeOfType(state_->type);
+  }
+  return state->segments->row_stride;
+}
+
+size_t Tensor::AllocatedBytes() const {
+  const std::vector<size_t>& dims = state_->shape.Dims();
+  if (dims.empty()) {
+    return SizeOfType(state_->type);
+  }
+  size_t row_bytes = SizeOfType(state_->type);
+  for (size_t i = 1; i < dims.size(); i++) {
+    row_bytes *= dims[i];
+  }
+  SegmentState* state = dynamic_cast<SegmentState*>(state_);
+  if (state == nullptr) {
+    return dims[0] * row_bytes;
+  }
+  Segments* segments = state->segments.get();
+  std::lock_guard<std::mutex> lock(segments->grow_mu);
+  if (segments->fields.front() == state) {
+    row_bytes += segments->row_stride - segments->used;
+  }
+  return segments->buffers.size() * segments->segment_size * row_bytes;
+}
+
+bool Tensor::Interleaved() const {
+  SegmentState* state = dynamic_cast<SegmentState*>(state_);
+  return state != nullptr && state->Interleaved();
 }
 
 void Tensor::ClearId(size_t id) {
   SegmentState* state = dynamic_cast<SegmentState*>(state_);
-  state_->initializer->MultiThreadInit(state->Raw(id), state->type, state->slice_size);
+  state_->initializer->MultiThreadInitAt(state->Raw(id), state->type, state->slice_size, id * state->slice_size);
+}
+
+void Tensor::ClearIds(const std::vector<size_t>& ids) {
+  SegmentState* state = dynamic_cast<SegmentState*>(state_);
+  // the rows are keyed by their ids, so they can be inited in any order
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, ids.size(), 64), [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i < r.end(); i++) {
+          state->initializer->InitAt(state->Raw(ids[i]), state->type, state->slice_size, ids[i] * state->slice_size);
+        }
+      });
 }
 
 size_t Tensor::SegmentSize() const {
@@ -123,7 +236,87 @@ size_t Tensor::SegmentSize() const {
     std::cerr << "Only Segment tensor can call SegmentSize\n";
     abort();
   }
-  return state->segment_size;
+  return state->segments->segment_size;
+}
+
+size_t Tensor::SegmentCount() const {
+  SegmentState* state = dynamic_cast<SegmentState*>(state_);
+  if (state == nullptr) {
+    return 0;
+  }
+  return state->segments->buffers.size();
+}
+
+bool Tensor::SegmentSpilled(size_t segment) const {
+  SegmentState* state = dynamic_cast<SegmentState*>(state_);
+  return state != nullptr && state->segments->spilled.find(segment) != state->segments->spilled.end();
+}
+
+Status Tensor::SpillSegment(size_t segment, int fd) {
+  SegmentState* state = dynamic_cast<SegmentState*>(state_);
+  if (state == nullptr) {
+    return Status::NotImplemented("ContinuousTensor can't support SpillSegment function");
+  }
+  // the chunks are shared by the interleaved tensors, spilled once for all
+  Segments* segments = state->segments.get();
+  if (segment >= segments->buffers.size()) {
+    return Status::ArgumentError("SpillSegment: segment out of range");
+  }
+  if (segments->spilled.find(segment) != segments->spilled.end()) {
+    return Status::Ok();
+  }
+  off_t offset = segment * segments->chunk_size;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    return Status::Unknown("SpillSegment: fstat error " + std::string(strerror(errno)));
+  }
+  if (st.st_size < (off_t)(offset + segments->chunk_size)) {
+    if (ftruncate(fd, offset + segments->chunk_size) != 0) {
+      return Status::Unknown("SpillSegment: ftruncate error " + std::string(strerror(errno)));
+    }
+  }
+  char* buffer = segments->buffers[segment];
+  size_t written = 0;
+  while (written < segments->chunk_size) {
+    ssize_t ret = pwrite(fd, buffer + written, segments->chunk_size - written, offset + written);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return Status::Unknown("SpillSegment: write error " + std::string(strerror(errno)));
+    }
+    written += ret;
+  }
+  void* ptr = mmap(nullptr, segments->chunk_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+  if (ptr == MAP_FAILED) {
+    return Status::Unknown("SpillSegment: mmap error " + std::string(strerror(errno)));
+  }
+  segments->buffers[segment] = reinterpret_cast<char*>(ptr);
+  segments->spilled.insert(segment);
+  segments->arena->Free(buffer);
+  return Status::Ok();
+}
+
+Status Tensor::LoadSegment(size_t segment) {
+  SegmentState* state = dynamic_cast<SegmentState*>(state_);
+  if (state == nullptr) {
+    return Status::NotImplemented("ContinuousTensor can't support LoadSegment function");
+  }
+  Segments* segments = state->segments.get();
+  if (segments->spilled.find(segment) == segments->spilled.end()) {
+    return Status::Ok();
+  }
+  char* mapped = segments->buffers[segment];
+  char* buffer = segments->arena->Allocate();
+  memcpy(buffer, mapped, segments->chunk_size);
+  segments->buffers[segment] = buffer;
+  segments->spilled.erase(segment);
+  UnmapBuffer(mapped, segments->chunk_size);
+  return Status::Ok();
+}
+
+void Tensor::UnmapBuffer(char* buffer, size_t size) {
+  munmap(buffer, size);
 }
 
 void Tensor::SetOwnBuffer(bool own) {
@@ -132,6 +325,15 @@ void Tensor::SetOwnBuffer(bool own) {
     std::cerr << "Only Continuous tensor can call SetOwnBuffer\n";
     abort();
   }
+  if (!own && state->own_buffer && state->pooled) {
+    // the new owner frees the buffer by delete[]
+    size_t size = state->shape.NumElements() * SizeOfType(state->type);
+    char* buffer = new char[size];
+    memcpy(buffer, state->buffer, size);
+    BufferPool::Free(state->buffer);
+    state->buffer = buffer;
+    state->pooled = false;
+  }
   state->own_buffer = own;
 }
 
@@ -150,11 +352,20 @@ Tensor Tensor::Clone() const {
     memcpy(ret_state->buffer, this_state->buffer, state_->shape.NumElements() * SizeOfType(state_->type));
     return ret;
   } else {
-    Tensor ret(state_->type, state_->shape, init, TType::kSegment, false);
     SegmentState* this_state = dynamic_cast<SegmentState*>(state_);
+    Tensor ret(state_->type, state_->shape, init, false, this_state->segments->segment_size);
     SegmentState* ret_state = dynamic_cast<SegmentState*>(ret.state_);
-    for (size_t i = 0; i < this_state->buffers.size(); i++) {
-      memcpy(ret_state->buffers[i], this_state->buffers[i], this_state->chunk_size);
+    size_t count = ret_state->segments->buffers.size();
+    if (!this_state->Interleaved()) {
+      for (size_t i = 0; i < count; i++) {
+        memcpy(ret_state->segments->buffers[i], this_state->segments->buffers[i], this_state->segments->chunk_size);
+      }
+      return ret;
+    }
+    // the clone owns its rows, the fields of the rows are not cloned
+    size_t rows = count * this_state->segments->segment_size;
+    for (size_t i = 0; i < rows; i++) {
+      memcpy(ret_state->Raw(i), this_state->Raw(i), this_state->row_bytes);
     }
     return ret;
   }
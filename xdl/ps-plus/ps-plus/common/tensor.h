@@ -18,10 +18,15 @@ limitations under the License.
 
 #include <memory>
 #include <atomic>
+#include <algorithm>
 #include <iostream>
+#include <mutex>
+#include <set>
 #include "tbb/parallel_for.h"
 #include "tbb/concurrent_vector.h"
 
+#include "ps-plus/common/buffer_pool.h"
+#include "ps-plus/common/tensor_allocator.h"
 #include "ps-plus/common/types.h"
 #include "ps-plus/common/tensor_shape.h"
 #include "ps-plus/common/initializer.h"
@@ -41,6 +46,9 @@ class Tensor {
   Tensor(DataType type, const TensorShape& shape, char* buffer, Initializer* initializer);
   // used for only kSegment tensor  
   Tensor(DataType type, const TensorShape& shape, Initializer* initializer, bool init, size_t segment_size);
+  // used for only kSegment tensor, reserve_bytes after each row are left
+  // for the rows of the tensors added by AddRowField
+  Tensor(DataType type, const TensorShape& shape, Initializer* initializer, bool init, size_t segment_size, size_t reserve_bytes);
   
   Tensor(const Tensor& rhs);
   Tensor(Tensor&& rhs);
@@ -73,9 +81,32 @@ class Tensor {
   void ReShape(const TensorShape& shape);
   // Note: We don't check id
   void ClearId(size_t id);
+  // ClearId of the ids in bulk, in parallel
+  void ClearIds(const std::vector<size_t>& ids);
   Tensor Clone() const;
 
   size_t SegmentSize() const;
+  // Segment tensor only. field gets a tensor of the same ids whose rows
+  // live in the reserved bytes of the rows of this tensor, so a row and its
+  // fields are read in the same cache lines. It grows with this tensor.
+  // NotFound if the bytes left in the rows are too few.
+  Status AddRowField(DataType type, const TensorShape& shape, Initializer* initializer, bool init, Tensor* field) const;
+  // The bytes from a row to the next, more than the row if the rows are
+  // interleaved with other tensors
+  size_t RowStride() const;
+  bool Interleaved() const;
+  // The bytes of the rows allocated for this tensor, the segments not
+  // filled yet and the spilled ones included. The row bytes still reserved
+  // for fields count to the tensor which reserved them.
+  size_t AllocatedBytes() const;
+  // Segment tensor only, used by tiered storage. A spilled segment is
+  // written to fd at segment * chunk size and its buffer replaced by a
+  // shared mapping of that range, so Raw() keeps working and the kernel
+  // faults the rows back on access. Caller should block all readers.
+  size_t SegmentCount() const;
+  bool SegmentSpilled(size_t segment) const;
+  Status SpillSegment(size_t segment, int fd);
+  Status LoadSegment(size_t segment);
   void SetOwnBuffer(bool own);
   const static int64_t DEFAULT_SEGMENT_SIZE;
  private:
@@ -95,8 +126,8 @@ class Tensor {
   };
 
   struct ContinuousState: public State {
-    ContinuousState(char* buffer_, DataType type_, const TensorShape& shape_, Initializer* initializer_, bool own_buffer_, bool init_)
-      : State(type_, shape_, initializer_), buffer(buffer_), own_buffer(own_buffer_) {
+    ContinuousState(char* buffer_, DataType type_, const TensorShape& shape_, Initializer* initializer_, bool own_buffer_, bool init_, bool pooled_ = false)
+      : State(type_, shape_, initializer_), own_buffer(own_buffer_), pooled(pooled_), buffer(buffer_) {
       if (init_) {
         initializer->MultiThreadInit(buffer, type, shape.NumElements());
       }
@@ -112,52 +143,150 @@ class Tensor {
     }
     virtual ~ContinuousState() {
       if (own_buffer) {
-        delete [] buffer;
+        if (pooled) {
+          BufferPool::Free(buffer);
+        } else {
+          delete [] buffer;
+        }
         buffer = nullptr;
       }
     }
     bool own_buffer;
+    // buffer is of BufferPool, the others are of new[]
+    bool pooled;
     char* buffer;
   };
 
+  struct SegmentState;
+
+  // The chunks of segment tensors, shared by the tensors interleaved in the
+  // rows of one of them. Each row takes row_stride bytes of a chunk and
+  // every tensor reads its row at its own offset in them.
+  struct Segments {
+    Segments(size_t segment_size_, size_t row_stride_)
+      : segment_size(segment_size_), segment_shift(-1), row_stride(row_stride_),
+        chunk_size(segment_size_ * row_stride_), used(0), published(0) {
+      if (segment_size_ != 0 && (segment_size_ & (segment_size_ - 1)) == 0) {
+        segment_shift = 0;
+        while ((size_t(1) << segment_shift) < segment_size_) {
+          segment_shift++;
+        }
+      }
+      arena.reset(new ChunkArena(chunk_size));
+    }
+    ~Segments() {
+      for (size_t i = 0; i < buffers.size(); i++) {
+        if (spilled.find(i) != spilled.end()) {
+          UnmapBuffer(buffers[i], chunk_size);
+        } else {
+          arena->Free(buffers[i]);
+        }
+      }
+    }
+    char* Row(size_t id) {
+      if (segment_shift >= 0) {
+        return buffers[id >> segment_shift] + (id & (segment_size - 1)) * row_stride;
+      }
+      return buffers[id / segment_size] + (id % segment_size) * row_stride;
+    }
+    // Appends the chunks up to segment, every field inits its rows of a
+    // chunk before the chunk is published. Caller holds grow_mu.
+    void Grow(size_t segment);
+    size_t segment_size;
+    // log2(segment_size) if it is a power of two, the ids are addressed
+    // by shift and mask then, -1 falls back to the division
+    int segment_shift;
+    size_t row_stride;
+    size_t chunk_size;
+    // bytes of a row taken by the fields, guarded by grow_mu
+    size_t used;
+    // the chunks, on huge pages if the TensorAllocator is enabled
+    std::unique_ptr<ChunkArena> arena;
+    // buffers never move, so readers keep working while a writer appends
+    tbb::concurrent_vector<char*> buffers;
+    // serializes growers and the fields added
+    std::mutex grow_mu;
+    // the chunks fully initialized, checked by ReShape without grow_mu
+    std::atomic<size_t> published;
+    // index of buffers mapped from a spill file
+    std::set<size_t> spilled;
+    // the tensors of the rows, guarded by grow_mu
+    std::vector<SegmentState*> fields;
+  };
+
   struct SegmentState: public State {
-    SegmentState(DataType type_, const TensorShape& shape_, Initializer* initializer_, bool init_, size_t segment_size_)
-      : State(type_, shape_, initializer_), segment_size(segment_size_) {
+    // reserve_bytes of each row are left for the fields added by AddRowField
+    SegmentState(DataType type_, const TensorShape& shape_, Initializer* initializer_, bool init_, size_t segment_size_, size_t reserve_bytes_ = 0)
+      : State(type_, shape_, initializer_), offset(0), published(0) {
       if (shape_.IsScalar()) {
         throw std::invalid_argument("SegmentState don't allow scalar variable");
       }
       slice_size = shape_.NumElements() / shape_[0];
-      chunk_size = segment_size_ * SizeOfType(type_) * slice_size;
-      buffers.grow_to_at_least(shape_[0]/segment_size + (shape_[0] % segment_size == 0 ? 0 : 1), nullptr);
+      row_bytes = slice_size * SizeOfType(type_);
+      segments.reset(new Segments(segment_size_, row_bytes + reserve_bytes_));
+      segments->used = row_bytes;
+      segments->fields.push_back(this);
+      tbb::concurrent_vector<char*>& buffers = segments->buffers;
+      buffers.grow_to_at_least(shape_[0]/segment_size_ + (shape_[0] % segment_size_ == 0 ? 0 : 1), nullptr);
       for (size_t i = 0; i < buffers.size(); i++) {
-        buffers[i] = new char[chunk_size];
+        buffers[i] = segments->arena->Allocate();
       }
       if (init_) {
         tbb::parallel_for(tbb::blocked_range<size_t>(0, buffers.size() - 1), [&](tbb::blocked_range<size_t>& r) {
               for (size_t i = r.begin(); i < r.end(); i++) {
-                initializer_->MultiThreadInit(buffers[i], type_, segment_size * slice_size);
+                InitRows(i * segment_size_, (i + 1) * segment_size_);
               }
             });
       }
       // 因为我们有预留的空间，所以最后一个buffer必须初始化
       if (initializer_ != nullptr) {
-        initializer_->MultiThreadInit(buffers[buffers.size()-1], type_, segment_size * slice_size);
+        InitRows((buffers.size() - 1) * segment_size_, buffers.size() * segment_size_);
       }
-      shape.Set(0, buffers.size() * segment_size);
+      shape.Set(0, buffers.size() * segment_size_);
+      segments->published.store(buffers.size(), std::memory_order_release);
+      published.store(buffers.size(), std::memory_order_release);
     }
-    virtual ~SegmentState() {
-      for (size_t i = 0; i < buffers.size(); i++) {
-        delete [] buffers[i];
+    // A field at offset of the rows of segments_, caller holds grow_mu
+    SegmentState(DataType type_, const TensorShape& shape_, Initializer* initializer_, bool init_, const std::shared_ptr<Segments>& segments_, size_t offset_)
+      : State(type_, shape_, initializer_), segments(segments_), offset(offset_), published(0) {
+      slice_size = shape_.NumElements() / shape_[0];
+      row_bytes = slice_size * SizeOfType(type_);
+      segments->fields.push_back(this);
+      size_t count = segments->buffers.size();
+      if (init_) {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, count), [&](tbb::blocked_range<size_t>& r) {
+              for (size_t i = r.begin(); i < r.end(); i++) {
+                InitRows(i * segments->segment_size, (i + 1) * segments->segment_size);
+              }
+            });
       }
+      shape.Set(0, count * segments->segment_size);
+      published.store(count, std::memory_order_release);
+    }
+    virtual ~SegmentState() {
+      std::lock_guard<std::mutex> lock(segments->grow_mu);
+      auto& fields = segments->fields;
+      fields.erase(std::remove(fields.begin(), fields.end(), this), fields.end());
     }
     virtual void* Raw(size_t id) {
-      return buffers[id/segment_size] + (id%segment_size) * slice_size * SizeOfType(type);
+      return segments->Row(id) + offset;
     }
-    size_t segment_size;
-    size_t chunk_size;
+    bool Interleaved() const {
+      return segments->row_stride != row_bytes;
+    }
+    // Inits the rows [begin, end) of a chunk with the ids as the offsets,
+    // chunk is the buffer of the rows if it is not appended yet
+    void InitRows(size_t begin, size_t end);
+    void InitRows(size_t begin, size_t end, char* chunk);
     size_t slice_size;
-    tbb::concurrent_vector<char*> buffers;
+    size_t row_bytes;
+    std::shared_ptr<Segments> segments;
+    // of the row in the row_stride bytes
+    size_t offset;
+    // the chunks in shape, checked by ReShape without grow_mu
+    std::atomic<size_t> published;
   };
+  static void UnmapBuffer(char* buffer, size_t size);
   State* state_;
   TType tensor_type_;
 };
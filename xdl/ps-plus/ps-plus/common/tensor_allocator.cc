@@ -0,0 +1,300 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/common/tensor_allocator.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+
+#include "ps-plus/common/logging.h"
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+#ifndef MADV_HUGEPAGE
+#define MADV_HUGEPAGE 14
+#endif
+
+namespace ps {
+
+namespace {
+
+const size_t kSmallPage = 4096;
+const size_t k2MB = 2 << 20;
+const size_t k1GB = 1 << 30;
+const size_t kMaxRegion = 64 << 20;
+// the mbind modes of linux/mempolicy.h
+const int kMpolBind = 2;
+const int kMpolInterleave = 3;
+
+inline size_t RoundUp(size_t size, size_t page) {
+  return (size + page - 1) / page * page;
+}
+
+}  // namespace
+
+Status TensorAllocator::ParseOptions(const std::string& huge_page,
+                                     const std::string& numa,
+                                     Options* options) {
+  if (huge_page == "" || huge_page == "none") {
+    options->huge_page = kNoHugePage;
+  } else if (huge_page == "thp") {
+    options->huge_page = kTransparent;
+  } else if (huge_page == "2m") {
+    options->huge_page = kHugePage2MB;
+  } else if (huge_page == "1g") {
+    options->huge_page = kHugePage1GB;
+  } else {
+    return Status::ArgumentError("unknown huge page " + huge_page);
+  }
+
+  if (numa == "" || numa == "none") {
+    options->numa = kNoNuma;
+  } else if (numa == "interleave") {
+    options->numa = kInterleave;
+  } else if (numa == "slice") {
+    options->numa = kSlice;
+  } else {
+    char* end = nullptr;
+    long node = strtol(numa.c_str(), &end, 10);
+    if (*end != '\0' || node < 0) {
+      return Status::ArgumentError("unknown numa " + numa);
+    }
+    options->numa = kNode;
+    options->node = node;
+  }
+  return Status::Ok();
+}
+
+TensorAllocator* TensorAllocator::Instance() {
+  static TensorAllocator* allocator = [] {
+    const char* huge_page = getenv("PS_TENSOR_HUGEPAGE");
+    const char* numa = getenv("PS_TENSOR_NUMA");
+    const char* map_min_mb = getenv("PS_TENSOR_MAP_MIN_MB");
+    Options options;
+    Status st = ParseOptions(huge_page == nullptr ? "" : huge_page,
+                             numa == nullptr ? "" : numa, &options);
+    if (!st.IsOk()) {
+      LOG(WARNING) << "TensorAllocator: " << st.Msg() << ", huge pages and numa disabled";
+      options = Options();
+    }
+    if (map_min_mb != nullptr) {
+      options.map_min_bytes = (size_t)atol(map_min_mb) << 20;
+    }
+    return new TensorAllocator(options);
+  }();
+  return allocator;
+}
+
+TensorAllocator::TensorAllocator(const Options& options)
+  : options_(options), nodes_(NumaNodes()), huge_page_failed_(false) {
+  if (options_.numa == kNode && options_.node >= nodes_) {
+    LOG(WARNING) << "TensorAllocator: numa node " << options_.node << " of "
+                 << nodes_ << " nodes, numa disabled";
+    options_.numa = kNoNuma;
+  }
+}
+
+int TensorAllocator::NumaNodes() {
+  // the online nodes, as 0-3 or 0,2
+  std::ifstream in("/sys/devices/system/node/online");
+  std::string line;
+  if (!std::getline(in, line)) {
+    return 1;
+  }
+  int nodes = 1;
+  std::stringstream ss(line);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    size_t dash = range.find('-');
+    int last = atoi(range.substr(dash == std::string::npos ? 0 : dash + 1).c_str());
+    nodes = std::max(nodes, last + 1);
+  }
+  return nodes;
+}
+
+size_t TensorAllocator::PageSize() const {
+  switch (options_.huge_page) {
+  case kHugePage1GB:
+    return k1GB;
+  case kHugePage2MB:
+  case kTransparent:
+    return k2MB;
+  default:
+    return kSmallPage;
+  }
+}
+
+char* TensorAllocator::MapPages(size_t len, size_t page) {
+  if (page > kSmallPage) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+    flags |= (page == k1GB ? 30 : 21) << MAP_HUGE_SHIFT;
+    void* ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : reinterpret_cast<char*>(ptr);
+  }
+  // map a 2MB more and trim it to 2MB aligned, so the kernel may back the
+  // whole of it by the transparent huge pages
+  size_t align = options_.huge_page == kNoHugePage ? kSmallPage : k2MB;
+  size_t raw_len = len + align - kSmallPage;
+  void* ptr = mmap(nullptr, raw_len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED) {
+    return nullptr;
+  }
+  char* raw = reinterpret_cast<char*>(ptr);
+  char* aligned = reinterpret_cast<char*>(RoundUp((size_t)raw, align));
+  if (aligned != raw) {
+    munmap(raw, aligned - raw);
+  }
+  if (aligned + len != raw + raw_len) {
+    munmap(aligned + len, raw + raw_len - (aligned + len));
+  }
+  if (options_.huge_page != kNoHugePage) {
+    madvise(aligned, len, MADV_HUGEPAGE);
+  }
+  return aligned;
+}
+
+void TensorAllocator::Bind(char* buffer, size_t len, size_t slice) {
+  if (options_.numa == kNoNuma || nodes_ <= 1) {
+    return;
+  }
+  std::vector<unsigned long> mask((nodes_ + 63) / 64, 0);
+  int mode = kMpolBind;
+  if (options_.numa == kInterleave) {
+    mode = kMpolInterleave;
+    for (int i = 0; i < nodes_; ++i) {
+      mask[i / 64] |= 1ul << (i % 64);
+    }
+  } else {
+    int node = options_.numa == kNode ? options_.node : slice % nodes_;
+    mask[node / 64] |= 1ul << (node % 64);
+  }
+  // the pages are not touched yet, so they all follow the policy
+  if (syscall(SYS_mbind, buffer, len, mode, mask.data(), mask.size() * 64 + 1, 0) != 0) {
+    LOG(WARNING) << "TensorAllocator: mbind error " << errno;
+  }
+}
+
+char* TensorAllocator::Map(size_t size, size_t slice, size_t* mapped) {
+  // the 1g pages for the buffers of 1GB at least, the 2MB ones for the less
+  size_t page = 0;
+  if (options_.huge_page == kHugePage2MB || options_.huge_page == kHugePage1GB) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!huge_page_failed_) {
+      page = size >= k1GB ? PageSize() : k2MB;
+    }
+  }
+  char* buffer = nullptr;
+  size_t len = 0;
+  if (page != 0) {
+    len = RoundUp(size, page);
+    buffer = MapPages(len, page);
+    if (buffer == nullptr) {
+      std::lock_guard<std::mutex> lock(mu_);
+      if (!huge_page_failed_) {
+        LOG(WARNING) << "TensorAllocator: no huge pages of " << page
+                     << " bytes reserved, thp is used instead";
+        huge_page_failed_ = true;
+      }
+    }
+  }
+  if (buffer == nullptr) {
+    len = RoundUp(size, options_.huge_page == kNoHugePage ? kSmallPage : k2MB);
+    buffer = MapPages(len, kSmallPage);
+  }
+  if (buffer == nullptr) {
+    return nullptr;
+  }
+  Bind(buffer, len, slice);
+  *mapped = len;
+  return buffer;
+}
+
+void TensorAllocator::Unmap(char* buffer, size_t mapped) {
+  munmap(buffer, mapped);
+}
+
+ChunkArena::ChunkArena(size_t chunk_size, TensorAllocator* allocator)
+  : chunk_size_(chunk_size), allocator_(allocator), cursor_(0), mapped_bytes_(0) {
+}
+
+ChunkArena::~ChunkArena() {
+  for (auto& region: regions_) {
+    TensorAllocator::Unmap(region.first, region.second);
+  }
+}
+
+char* ChunkArena::Allocate() {
+  if (!allocator_->Enabled()) {
+    return new char[chunk_size_];
+  }
+  std::lock_guard<std::mutex> lock(mu_);
+  if (!free_.empty()) {
+    char* chunk = free_.back();
+    free_.pop_back();
+    return chunk;
+  }
+  if (regions_.empty() || cursor_ + chunk_size_ > regions_.back().second) {
+    size_t max_region = allocator_->GetOptions().huge_page == TensorAllocator::kHugePage1GB ?
+      k1GB : kMaxRegion;
+    size_t region_size = std::min(max_region, k2MB << std::min<size_t>(regions_.size(), 20));
+    region_size = std::max(region_size, chunk_size_);
+    size_t mapped = 0;
+    char* region = allocator_->Map(region_size, regions_.size(), &mapped);
+    if (region == nullptr) {
+      throw std::bad_alloc();
+    }
+    // the tail of the last region too short for a chunk is left unused
+    regions_.emplace_back(region, mapped);
+    mapped_bytes_ += mapped;
+    cursor_ = 0;
+  }
+  char* chunk = regions_.back().first + cursor_;
+  cursor_ += chunk_size_;
+  return chunk;
+}
+
+void ChunkArena::Free(char* chunk) {
+  if (!allocator_->Enabled()) {
+    delete [] chunk;
+    return;
+  }
+  // give the pages inside the chunk back, a spilled segment frees its chunk
+  // to save the memory
+  char* begin = reinterpret_cast<char*>(RoundUp((size_t)chunk, kSmallPage));
+  char* end = reinterpret_cast<char*>((size_t)(chunk + chunk_size_) / kSmallPage * kSmallPage);
+  if (begin < end) {
+    madvise(begin, end - begin, MADV_DONTNEED);
+  }
+  std::lock_guard<std::mutex> lock(mu_);
+  free_.push_back(chunk);
+}
+
+size_t ChunkArena::MappedBytes() {
+  std::lock_guard<std::mutex> lock(mu_);
+  return mapped_bytes_;
+}
+
+}  // namespace ps
@@ -0,0 +1,128 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_COMMON_TENSOR_ALLOCATOR_H_
+#define PS_PLUS_COMMON_TENSOR_ALLOCATOR_H_
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ps-plus/common/status.h"
+
+namespace ps {
+
+// The memory of the large tensors, the variables of hundreds of GB read in
+// random rows. The buffers are mapped anonymously on huge pages and placed
+// on the numa nodes as configured:
+//   PS_TENSOR_HUGEPAGE  none (default), thp for the transparent huge pages,
+//                       2m or 1g for the explicit ones, which fall back to
+//                       thp when the system has none reserved. The 1g pages
+//                       back the mappings of 1GB at least, the 2m the less
+//   PS_TENSOR_NUMA      none (default), interleave over the nodes, slice to
+//                       bind the regions of a tensor to the nodes in turn,
+//                       or a node id to bind all to
+//   PS_TENSOR_MAP_MIN_MB the continuous buffers mapped, 2 by default
+// With both none the buffers are of new[] as before.
+class TensorAllocator {
+ public:
+  enum HugePage {
+    kNoHugePage,
+    kTransparent,
+    kHugePage2MB,
+    kHugePage1GB,
+  };
+
+  enum Numa {
+    kNoNuma,
+    kInterleave,
+    // the regions of a tensor bound to the nodes in turn
+    kSlice,
+    kNode,
+  };
+
+  struct Options {
+    HugePage huge_page = kNoHugePage;
+    Numa numa = kNoNuma;
+    int node = 0;
+    size_t map_min_bytes = 2 << 20;
+  };
+
+  static Status ParseOptions(const std::string& huge_page,
+                             const std::string& numa,
+                             Options* options);
+  // Configured by the env once
+  static TensorAllocator* Instance();
+
+  explicit TensorAllocator(const Options& options);
+
+  const Options& GetOptions() const { return options_; }
+  bool Enabled() const {
+    return options_.huge_page != kNoHugePage || options_.numa != kNoNuma;
+  }
+  // The largest page size of the mappings
+  size_t PageSize() const;
+  // Map at least size bytes on the node of slice, nullptr if it fails.
+  // mapped is the length to Unmap.
+  char* Map(size_t size, size_t slice, size_t* mapped);
+  static void Unmap(char* buffer, size_t mapped);
+
+  static int NumaNodes();
+
+ private:
+  // Map len on the pages of page, the small pages are aligned to the
+  // transparent huge pages if they are on
+  char* MapPages(size_t len, size_t page);
+  void Bind(char* buffer, size_t len, size_t slice);
+
+  Options options_;
+  int nodes_;
+  // the explicit huge pages failed to map once, thp is used since
+  bool huge_page_failed_;
+  std::mutex mu_;
+};
+
+// The chunks of a segment tensor, carved from the regions mapped by the
+// TensorAllocator so that the chunks of the small rows are on huge pages
+// too. The regions double from 2MB up to 64MB, or 1GB for the 1g pages, and
+// a freed chunk is reused by the next. The chunks are of new[]
+// if the TensorAllocator is not enabled.
+class ChunkArena {
+ public:
+  explicit ChunkArena(size_t chunk_size,
+                      TensorAllocator* allocator = TensorAllocator::Instance());
+  ~ChunkArena();
+
+  char* Allocate();
+  void Free(char* chunk);
+  // The bytes mapped by the regions
+  size_t MappedBytes();
+
+ private:
+  size_t chunk_size_;
+  TensorAllocator* allocator_;
+  std::mutex mu_;
+  std::vector<std::pair<char*, size_t> > regions_;
+  std::vector<char*> free_;
+  // the next chunk of the last region
+  size_t cursor_;
+  size_t mapped_bytes_;
+};
+
+}  // namespace ps
+
+#endif  // PS_PLUS_COMMON_TENSOR_ALLOCATOR_H_
@@ -16,6 +16,7 @@ limitations under the License.
 #include "gtest/gtest.h"
 #include "ps-plus/common/bloom_filter.h"
 #include <vector>
+#include <thread>
 
 TEST(BloomFilter, CountingBloomFilter) {
   double fpp = 0.001;
@@ -60,3 +61,37 @@ TEST(BloomFilter, InsertedLookup) {
   ASSERT_FALSE(cbf.InsertedLookup(&key, sizeof(key), 256));
 }
 
+
+TEST(BloomFilter, ShardedInsertedLookup) {
+  ps::ShardedCountingBloomFilter<uint8_t> cbf(8, 0.001, 8000);
+  ASSERT_EQ(8u, cbf.shard_count());
+  std::vector<uint64_t> keys = { 1ul, 2ul, 3ul };
+  for (int i = 0; i < 3; ++i) {
+    bool res = cbf.InsertedLookup(&keys[0], sizeof(uint64_t), 3);
+    if (i < 2) ASSERT_FALSE(res);
+    else ASSERT_TRUE(res);
+  }
+  ASSERT_TRUE(cbf.Exists(&keys[0], sizeof(uint64_t), 3));
+  ASSERT_FALSE(cbf.Exists(&keys[0], sizeof(uint64_t), 4));
+  cbf.Insert(&keys[1], sizeof(uint64_t));
+  ASSERT_TRUE(cbf.Exists(&keys[1], sizeof(uint64_t), 1));
+  ASSERT_FALSE(cbf.Exists(&keys[2], sizeof(uint64_t), 1));
+}
+
+TEST(BloomFilter, ConcurrentInsert) {
+  std::unique_ptr<ps::BloomFilterBase> cbf(ps::NewShardedBloomFilter(300, 4, 0.001, 1000));
+  uint64_t key = 7;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 100; ++i) {
+        cbf->Insert(&key, sizeof(key));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_TRUE(cbf->Exists(&key, sizeof(key), 400));
+  ASSERT_FALSE(cbf->Exists(&key, sizeof(key), 401));
+}
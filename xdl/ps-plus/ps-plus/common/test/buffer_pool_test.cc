@@ -0,0 +1,124 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "ps-plus/common/buffer_pool.h"
+#include "ps-plus/common/memguard.h"
+#include "ps-plus/common/tensor.h"
+#include "ps-plus/common/initializer/constant_initializer.h"
+
+#include <thread>
+#include <cstring>
+
+using ps::BufferPool;
+using ps::DataType;
+using ps::Tensor;
+using ps::TensorShape;
+using ps::initializer::ConstantInitializer;
+
+TEST(BufferPoolTest, Class) {
+  EXPECT_EQ(0, BufferPool::Class(1));
+  EXPECT_EQ(0, BufferPool::Class(64));
+  EXPECT_EQ(-1, BufferPool::Class(BufferPool::kMaxSize + 1));
+  EXPECT_EQ(BufferPool::kClassCount - 1, BufferPool::Class(BufferPool::kMaxSize));
+  EXPECT_EQ(80, BufferPool::ClassSize(BufferPool::Class(65)));
+  EXPECT_EQ(96, BufferPool::ClassSize(BufferPool::Class(81)));
+  EXPECT_EQ(160, BufferPool::ClassSize(BufferPool::Class(129)));
+  for (size_t size = 1; size <= BufferPool::kMaxSize; size = size * 3 / 2 + 1) {
+    size_t class_size = BufferPool::ClassSize(BufferPool::Class(size));
+    EXPECT_GE(class_size, size);
+    EXPECT_LE(class_size, std::max<size_t>(64, size + size / 4));
+  }
+}
+
+TEST(BufferPoolTest, Reuse) {
+  char* a = BufferPool::Allocate(1000);
+  EXPECT_EQ(1024, BufferPool::Capacity(a));
+  memset(a, 1, 1000);
+  BufferPool::Free(a);
+  BufferPool::Stats stats = BufferPool::Instance()->GetStats();
+  char* b = BufferPool::Allocate(1020);
+  EXPECT_EQ(a, b);
+  BufferPool::Stats after = BufferPool::Instance()->GetStats();
+  EXPECT_EQ(stats.hits + 1, after.hits);
+  EXPECT_EQ(stats.in_use_bytes + 1024, after.in_use_bytes);
+  EXPECT_EQ(stats.cached_bytes - 1024, after.cached_bytes);
+  BufferPool::Free(b);
+  BufferPool::Free(nullptr);
+
+  char* large = BufferPool::Allocate(BufferPool::kMaxSize + 10);
+  EXPECT_EQ(BufferPool::kMaxSize + 10, BufferPool::Capacity(large));
+  after = BufferPool::Instance()->GetStats();
+  EXPECT_EQ(stats.in_use_bytes + (int64_t)BufferPool::kMaxSize + 10, after.in_use_bytes);
+  BufferPool::Free(large);
+}
+
+TEST(BufferPoolTest, MultiThread) {
+  BufferPool::Stats stats = BufferPool::Instance()->GetStats();
+  std::vector<char*> buffers(4000);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([t, &buffers] {
+      for (int round = 0; round < 10; ++round) {
+        for (int i = t * 1000; i < (t + 1) * 1000; ++i) {
+          buffers[i] = BufferPool::Allocate(i % 5000 + 1);
+          memset(buffers[i], i, i % 5000 + 1);
+        }
+        for (int i = t * 1000; i < (t + 1) * 1000; ++i) {
+          BufferPool::Free(buffers[i]);
+        }
+      }
+      // the last round is freed by the main thread
+      for (int i = t * 1000; i < (t + 1) * 1000; ++i) {
+        buffers[i] = BufferPool::Allocate(i % 5000 + 1);
+      }
+    });
+  }
+  for (auto& thread: threads) {
+    thread.join();
+  }
+  for (char* buffer: buffers) {
+    BufferPool::Free(buffer);
+  }
+  BufferPool::Stats after = BufferPool::Instance()->GetStats();
+  EXPECT_EQ(stats.in_use_bytes, after.in_use_bytes);
+  EXPECT_GT(after.hits - stats.hits, after.misses - stats.misses);
+  EXPECT_NE(std::string::npos, BufferPool::Instance()->DumpStats().find("in_use_bytes"));
+  BufferPool::Instance()->Trim();
+}
+
+TEST(BufferPoolTest, TensorAndMemGuard) {
+  BufferPool::Stats stats = BufferPool::Instance()->GetStats();
+  {
+    Tensor x(DataType::kFloat, TensorShape({10, 8}), new ConstantInitializer(1));
+    EXPECT_EQ(320, BufferPool::Capacity(x.Raw<char>()));
+    x.ReShape(TensorShape({20, 8}));
+    EXPECT_EQ(640, BufferPool::Capacity(x.Raw<char>()));
+    EXPECT_EQ(1, x.Raw<float>()[159]);
+    ps::serializer::MemGuard guard;
+    size_t* len = guard.AllocateElement<size_t>(10);
+    EXPECT_EQ(10, *len);
+    guard.AllocateBuffer(100);
+  }
+  EXPECT_EQ(stats.in_use_bytes, BufferPool::Instance()->GetStats().in_use_bytes);
+
+  // the buffer given away is of new[]
+  Tensor y(DataType::kFloat, TensorShape({10, 8}), new ConstantInitializer(2));
+  y.SetOwnBuffer(false);
+  float* raw = y.Raw<float>();
+  EXPECT_EQ(2, raw[79]);
+  EXPECT_EQ(stats.in_use_bytes, BufferPool::Instance()->GetStats().in_use_bytes);
+  delete [] reinterpret_cast<char*>(raw);
+}
@@ -15,6 +15,43 @@ limitations under the License.
 
 #include "gtest/gtest.h"
 #include "ps-plus/common/global_file_queue.h"
+#include "ps-plus/common/plugin.h"
+#include "ps-plus/common/reliable_kv.h"
+
+#include <map>
+#include <mutex>
+
+namespace {
+
+class MemoryKV : public ps::ReliableKV {
+ public:
+  ps::Status Read(const std::string& addr, std::string* val, int retry) override {
+    std::unique_lock<std::mutex> lock(mu_);
+    auto it = kv_.find(addr);
+    if (it == kv_.end()) {
+      return ps::Status::NotFound("MemoryKV: " + addr);
+    }
+    *val = it->second;
+    return ps::Status::Ok();
+  }
+  ps::Status Write(const std::string& addr, const std::string& val, int retry) override {
+    std::unique_lock<std::mutex> lock(mu_);
+    if (fail_) {
+      return ps::Status::Unknown("MemoryKV: write fail");
+    }
+    kv_[addr] = val;
+    ++writes_;
+    return ps::Status::Ok();
+  }
+  std::mutex mu_;
+  std::map<std::string, std::string> kv_;
+  size_t writes_ = 0;
+  bool fail_ = false;
+};
+
+}
+
+PLUGIN_REGISTER(ps::ReliableKV, gfq_memory, MemoryKV);
 
 TEST(GlobalFileQueueTest, TestNotInit) {
   ps::GlobalFileQueue queue;
@@ -278,3 +315,123 @@ TEST(GlobalFileQueueTest, TestSerialize) {
     ASSERT_EQ(1, file.epoch_);
   }
 }
+
+TEST(GlobalFileQueueTest, TestGetNextFiles) {
+  ps::GlobalFileQueue queue;
+  std::vector<std::string> paths = {"1.txt", "2.txt", "3.txt"};
+  ASSERT_TRUE(queue.Init(paths, 2, false).IsOk());
+  std::vector<ps::WorkerState> files;
+  ASSERT_TRUE(queue.GetNextFiles(0, 2, &files).IsOk());
+  ASSERT_EQ(2, files.size());
+  ASSERT_EQ("1.txt", files[0].path_);
+  ASSERT_EQ("2.txt", files[1].path_);
+  ASSERT_TRUE(queue.GetNextFiles(1, 2, &files).IsOk());
+  ASSERT_EQ(2, files.size());
+  ASSERT_EQ("3.txt", files[0].path_);
+  ASSERT_EQ(0, files[0].epoch_);
+  ASSERT_EQ("1.txt", files[1].path_);
+  ASSERT_EQ(1, files[1].epoch_);
+
+  // worker 1 fails having read none of its lease
+  std::vector<ps::WorkerState> worker_states;
+  ASSERT_TRUE(queue.ReportWorkerState(1, worker_states).IsOk());
+  ASSERT_TRUE(queue.RestoreWorkerState(1).IsOk());
+  ASSERT_TRUE(queue.GetNextFiles(1, 5, &files).IsOk());
+  ASSERT_EQ(4, files.size());
+  ASSERT_EQ("1.txt", files[0].path_);
+  ASSERT_EQ(1, files[0].epoch_);
+  ASSERT_EQ("3.txt", files[1].path_);
+  ASSERT_EQ(0, files[1].epoch_);
+  ASSERT_EQ("2.txt", files[2].path_);
+  ASSERT_EQ("3.txt", files[3].path_);
+  ASSERT_EQ(1, files[3].epoch_);
+  ASSERT_TRUE(queue.GetNextFiles(0, 2, &files).IsOk());
+  ASSERT_TRUE(files.empty());
+  ps::WorkerState file;
+  ASSERT_TRUE(queue.GetNextFile(1, &file).IsOk());
+  ASSERT_EQ("", file.path_);
+}
+
+TEST(GlobalFileQueueTest, TestCheckpoint) {
+  MemoryKV* kv = dynamic_cast<MemoryKV*>(ps::GetPlugin<ps::ReliableKV>("gfq_memory"));
+  ASSERT_NE(nullptr, kv);
+  std::vector<std::string> paths = {"1.txt", "2.txt", "3.txt", "4.txt"};
+  ps::GlobalFileQueue queue;
+  ASSERT_TRUE(queue.Init(paths, 2, false).IsOk());
+  ps::WorkerState file;
+  queue.GetNextFile(0, &file);
+  queue.GetNextFile(1, &file);
+  std::vector<ps::WorkerState> worker_states;
+  worker_states.push_back(ps::WorkerState(1, 11, 0, "1.txt"));
+  ASSERT_TRUE(queue.ReportWorkerState(0, worker_states).IsOk());
+  ASSERT_TRUE(queue.Checkpoint("gfq_memory://queue", "ckpt1").IsOk());
+
+  // only the shard of worker 1 and the head are written again
+  size_t writes = kv->writes_;
+  worker_states.clear();
+  worker_states.push_back(ps::WorkerState(2, 12, 0, "2.txt"));
+  ASSERT_TRUE(queue.ReportWorkerState(1, worker_states).IsOk());
+  ASSERT_TRUE(queue.Checkpoint("gfq_memory://queue", "ckpt2").IsOk());
+  ASSERT_EQ(writes + 2, kv->writes_);
+
+  // a failed checkpoint keeps the last one whole
+  queue.GetNextFile(1, &file);
+  kv->fail_ = true;
+  ASSERT_FALSE(queue.Checkpoint("gfq_memory://queue", "ckpt3").IsOk());
+  kv->fail_ = false;
+
+  ps::GlobalFileQueue restored;
+  ASSERT_EQ(ps::Status::kNotFound,
+            restored.Recover("gfq_memory://queue", "ckpt1").Code());
+  ASSERT_TRUE(restored.Recover("gfq_memory://queue", "ckpt2").IsOk());
+  ASSERT_TRUE(restored.Init(paths, 2, false).IsOk());
+  ASSERT_TRUE(restored.RestoreWorkerState(0).IsOk());
+  ASSERT_TRUE(restored.RestoreWorkerState(1).IsOk());
+  restored.GetNextFile(0, &file);
+  ASSERT_EQ("1.txt", file.path_);
+  ASSERT_EQ(1, file.begin_);
+  restored.GetNextFile(1, &file);
+  ASSERT_EQ("2.txt", file.path_);
+  ASSERT_EQ(2, file.begin_);
+  restored.GetNextFile(1, &file);
+  ASSERT_EQ("3.txt", file.path_);
+  ASSERT_EQ(0, file.epoch_);
+
+  // the shards failed to write are written by the next checkpoint
+  ASSERT_TRUE(queue.Checkpoint("gfq_memory://queue", "ckpt4").IsOk());
+  ps::GlobalFileQueue restored4;
+  ASSERT_TRUE(restored4.Recover("gfq_memory://queue", "ckpt4").IsOk());
+  ASSERT_TRUE(restored4.Init(paths, 2, false).IsOk());
+  ASSERT_TRUE(restored4.RestoreWorkerState(1).IsOk());
+  restored4.GetNextFile(1, &file);
+  ASSERT_EQ("2.txt", file.path_);
+  ASSERT_EQ(2, file.begin_);
+  restored4.GetNextFile(1, &file);
+  ASSERT_EQ("3.txt", file.path_);
+  restored4.GetNextFile(1, &file);
+  ASSERT_EQ("4.txt", file.path_);
+}
+
+TEST(GlobalFileQueueTest, TestLeaseScale) {
+  ps::GlobalFileQueue queue;
+  std::vector<std::string> paths;
+  for (int i = 0; i < 10; ++i) {
+    paths.push_back(std::to_string(i) + ".txt");
+  }
+  queue.Init(paths, 1, false);
+  ASSERT_TRUE(queue.SetLeaseScale(1, 0.25).IsOk());
+  std::vector<ps::WorkerState> files;
+  ASSERT_TRUE(queue.GetNextFiles(0, 4, &files).IsOk());
+  ASSERT_EQ(4, files.size());
+  ASSERT_TRUE(queue.GetNextFiles(1, 4, &files).IsOk());
+  ASSERT_EQ(1, files.size());
+  ASSERT_EQ("4.txt", files[0].path_);
+  // a slow worker still leases a file
+  ASSERT_TRUE(queue.SetLeaseScale(1, 0.01).IsOk());
+  ASSERT_TRUE(queue.GetNextFiles(1, 2, &files).IsOk());
+  ASSERT_EQ(1, files.size());
+  ASSERT_TRUE(queue.SetLeaseScale(1, 1).IsOk());
+  ASSERT_TRUE(queue.GetNextFiles(1, 4, &files).IsOk());
+  ASSERT_EQ(4, files.size());
+  ASSERT_FALSE(queue.SetLeaseScale(-1, 1).IsOk());
+}
@@ -0,0 +1,85 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "ps-plus/common/gradient_codec.h"
+#include "ps-plus/common/initializer/none_initializer.h"
+
+using ps::GradientCodec;
+using ps::Tensor;
+using ps::TensorShape;
+using ps::DataType;
+using ps::initializer::NoneInitializer;
+
+namespace {
+
+Tensor MakeGrad() {
+  Tensor grad(DataType::kFloat, TensorShape({3, 4}), new NoneInitializer);
+  float values[] = {0.5, -2, 0.25, 1, 0, 0, 0, 0, 3, -0.125, 0.75, -6};
+  memcpy(grad.Raw<float>(), values, sizeof(values));
+  return grad;
+}
+
+}
+
+TEST(GradientCodecTest, Parse) {
+  GradientCodec codec;
+  EXPECT_TRUE(GradientCodec::Parse("", &codec).IsOk());
+  EXPECT_EQ(GradientCodec::kNone, codec.GetType());
+  EXPECT_TRUE(GradientCodec::Parse("int8", &codec).IsOk());
+  EXPECT_EQ(GradientCodec::kInt8, codec.GetType());
+  EXPECT_TRUE(GradientCodec::Parse("topk:0.5", &codec).IsOk());
+  EXPECT_EQ(GradientCodec::kTopK, codec.GetType());
+  EXPECT_FALSE(GradientCodec::Parse("topk:2", &codec).IsOk());
+  EXPECT_FALSE(GradientCodec::Parse("fp8", &codec).IsOk());
+}
+
+TEST(GradientCodecTest, RoundTrip) {
+  Tensor grad = MakeGrad();
+  for (std::string spec : {"fp16", "int8"}) {
+    GradientCodec codec;
+    EXPECT_TRUE(GradientCodec::Parse(spec, &codec).IsOk());
+    Tensor encoded, decoded, residual;
+    EXPECT_TRUE(codec.Encode(grad, &encoded, &residual).IsOk());
+    EXPECT_EQ(DataType::kInt8, encoded.Type());
+    EXPECT_EQ(3u, encoded.Shape()[0]);
+    EXPECT_TRUE(GradientCodec::Decode(codec.GetType(), 4, encoded, &decoded).IsOk());
+    EXPECT_EQ(TensorShape({3, 4}), decoded.Shape());
+    for (size_t i = 0; i < 12; i++) {
+      EXPECT_NEAR(grad.Raw<float>()[i], decoded.Raw<float>()[i], 0.03);
+      EXPECT_FLOAT_EQ(grad.Raw<float>()[i] - decoded.Raw<float>()[i], residual.Raw<float>()[i]);
+    }
+  }
+}
+
+TEST(GradientCodecTest, TopK) {
+  Tensor grad = MakeGrad();
+  GradientCodec codec;
+  EXPECT_TRUE(GradientCodec::Parse("topk:0.5", &codec).IsOk());
+  Tensor encoded, decoded, residual;
+  EXPECT_TRUE(codec.Encode(grad, &encoded, &residual).IsOk());
+  // two (column, value) pairs per row
+  EXPECT_EQ(TensorShape({3, 16}), encoded.Shape());
+  EXPECT_TRUE(GradientCodec::Decode(GradientCodec::kTopK, 4, encoded, &decoded).IsOk());
+  float expected[] = {0, -2, 0, 1, 0, 0, 0, 0, 3, 0, 0, -6};
+  for (size_t i = 0; i < 12; i++) {
+    EXPECT_EQ(expected[i], decoded.Raw<float>()[i]);
+    EXPECT_EQ(grad.Raw<float>()[i] - expected[i], residual.Raw<float>()[i]);
+  }
+  EXPECT_FALSE(GradientCodec::Decode(GradientCodec::kTopK, 1, encoded, &decoded).IsOk());
+}
+
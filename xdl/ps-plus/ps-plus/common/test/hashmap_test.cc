@@ -160,3 +160,38 @@ TEST(HashMap128Test, MultiThread) {
   std::cout << "insert " << key_count/2 << " keys, takes " << (end-start).count()/1000000 << "ms" <<std::endl;
   delete [] keys;
 }
+
+TEST(HashMap64Test, EraseIds) {
+  for (bool track : {false, true}) {
+    std::unique_ptr<HashMap> hashmap(new ps::HashMapImpl<int64_t>(1));
+    int64_t keys[] = {10, 20, 30, 40};
+    vector<size_t> ids;
+    tbb::concurrent_vector<size_t> reused_ids;
+    size_t filtered;
+    hashmap->Get(keys, 4ul, false, 1.0, &ids, &reused_ids, &filtered);
+    if (track) {
+      hashmap->TrackKeys();
+    }
+    EXPECT_EQ(track, hashmap->TrackingKeys());
+    vector<size_t> erased;
+    // an unknown id is skipped
+    EXPECT_EQ(2u, hashmap->EraseIds({ids[2], ids[0], 100}, &erased));
+    std::sort(erased.begin(), erased.end());
+    EXPECT_EQ((vector<size_t>{std::min(ids[0], ids[2]), std::max(ids[0], ids[2])}), erased);
+    // erased twice
+    EXPECT_EQ(0u, hashmap->EraseIds({ids[0]}, nullptr));
+
+    // the freed ids are given to the new keys, which are tracked as well
+    int64_t new_keys[] = {50, 60};
+    vector<size_t> new_ids;
+    hashmap->Get(new_keys, 2ul, false, 1.0, &new_ids, &reused_ids, &filtered);
+    EXPECT_EQ(2u, reused_ids.size());
+    EXPECT_EQ(1u, hashmap->EraseIds({new_ids[1]}, nullptr));
+    vector<size_t> lookup;
+    int64_t all_keys[] = {10, 20, 30, 40, 50, 60};
+    hashmap->Get(all_keys, 6ul, true, 1.0, &lookup, &reused_ids, &filtered);
+    EXPECT_EQ(ids[1], lookup[1]);
+    EXPECT_EQ(ids[3], lookup[3]);
+    EXPECT_EQ(new_ids[0], lookup[4]);
+  }
+}
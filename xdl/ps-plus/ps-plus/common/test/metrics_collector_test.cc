@@ -0,0 +1,84 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ps-plus/common/metrics_collector.h"
+
+using ps::common::Histogram;
+using ps::common::MetricsCollector;
+
+TEST(HistogramTest, Percentile) {
+  Histogram h;
+  EXPECT_EQ(0u, h.Percentile(0.5));
+  for (uint64_t i = 1; i <= 1000; i++) {
+    h.Record(i);
+  }
+  EXPECT_EQ(1000u, h.Count());
+  EXPECT_EQ(500500u, h.Sum());
+  EXPECT_EQ(1000u, h.Max());
+  // 500 falls in [256, 512), 990 and 999 in [512, 1024) capped by the max
+  EXPECT_EQ(511u, h.Percentile(0.5));
+  EXPECT_EQ(1000u, h.Percentile(0.99));
+  EXPECT_EQ(1000u, h.Percentile(0.999));
+  h.Record(0);
+  EXPECT_EQ(0u, h.Percentile(0));
+  h.Reset();
+  EXPECT_EQ(0u, h.Count());
+  EXPECT_EQ(0u, h.Max());
+}
+
+TEST(HistogramTest, Merge) {
+  Histogram a, b;
+  a.Record(1);
+  b.Record(100);
+  b.Record(200);
+  a.Merge(b);
+  EXPECT_EQ(3u, a.Count());
+  EXPECT_EQ(301u, a.Sum());
+  EXPECT_EQ(200u, a.Max());
+  EXPECT_EQ(127u, a.Percentile(0.5));
+}
+
+TEST(HistogramTest, Concurrent) {
+  Histogram h;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&h, t] {
+      for (uint64_t i = 0; i < 10000; i++) {
+        h.Record(t * 10000 + i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(40000u, h.Count());
+  EXPECT_EQ(39999u, h.Max());
+}
+
+TEST(MetricsCollectorTest, DumpHistograms) {
+  MetricsCollector* metrics = MetricsCollector::Instance();
+  Histogram* h = metrics->GetHistogram("test.dump");
+  EXPECT_EQ(h, metrics->GetHistogram("test.dump"));
+  metrics->GetHistogram("test.empty");
+  h->Record(3);
+  h->Record(5);
+  std::string dump = metrics->DumpHistograms();
+  EXPECT_NE(std::string::npos, dump.find("test.dump: count[2] avg[4] p50[5] p99[5] p999[5] max[5]"));
+  EXPECT_EQ(std::string::npos, dump.find("test.empty"));
+}
@@ -17,6 +17,8 @@ limitations under the License.
 #include "ps-plus/common/murmurhash.h"
 #include <iomanip>
 #include <sstream>
+#include <string>
+#include <vector>
 
 using ps::MurmurHash;
 
@@ -55,3 +57,27 @@ TEST(MurmurHashTest, MurmurHash) {
     ASSERT_EQ(uint128_2_string(res), val1);
   }
 }
+
+TEST(MurmurHashTest, Batch) {
+  MurmurHash hash_fn(7621U);
+  std::vector<std::string> keys;
+  for (int i = 0; i < 43; ++i) {
+    keys.push_back(std::string(i, 'a' + i % 26) + std::to_string(i * 7919));
+  }
+  keys.push_back("this is a test line");
+  std::vector<const void*> ptrs;
+  std::vector<int> lens;
+  for (auto& key : keys) {
+    ptrs.push_back(key.data());
+    lens.push_back(key.size());
+  }
+  std::vector<uint64_t> batch(keys.size() * 2);
+  hash_fn(ptrs.data(), lens.data(), keys.size(), batch.data());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    uint64_t res[2];
+    hash_fn(keys[i].data(), keys[i].size(), res);
+    ASSERT_EQ(res[0], batch[i * 2]);
+    ASSERT_EQ(res[1], batch[i * 2 + 1]);
+  }
+  ASSERT_EQ(uint128_2_string(&batch[keys.size() * 2 - 2]), "b3c8e4d2b3806183bc117d2cd9cf9a3e");
+}
@@ -22,6 +22,11 @@ TEST(NetUtilsTest, NetUtils) {
   ip = NetUtils::GetLocalIP("bond0");
   ASSERT_TRUE(ip.length() > 0);
 
+  ASSERT_TRUE(NetUtils::IsLocalHost("127.0.0.1"));
+  ASSERT_TRUE(NetUtils::IsLocalHost("localhost"));
+  ASSERT_TRUE(NetUtils::IsLocalHost(ip));
+  ASSERT_FALSE(NetUtils::IsLocalHost("192.0.2.1"));
+
   int port = NetUtils::GetAvailablePort();
   ASSERT_TRUE(port > 0);
 
@@ -0,0 +1,222 @@
+#include <iostream>
+#include "gtest/gtest.h"
+#include "ps-plus/common/open_hashmap.h"
+#include "ps-plus/common/thread_pool.h"
+
+using ps::Hash128Key;
+using ps::HashMap;
+using ps::HashMapStruct;
+using ps::OpenHashMapImpl;
+using ps::Range;
+using ps::Status;
+using std::vector;
+
+TEST(OpenHashMap64Test, Get) {
+  std::unique_ptr<HashMap> hashmap(new OpenHashMapImpl<int64_t>(1));
+  int64_t keys[] = {1, 2, 3, 4};
+  vector<size_t> ids;
+  tbb::concurrent_vector<size_t> reused_ids;
+  size_t filtered;
+  int64_t max = hashmap->Get((const int64_t*)keys, 4ul, false, 1.0, &ids, &reused_ids, &filtered);
+  EXPECT_EQ(4, max);
+  EXPECT_EQ(4u, ids.size());
+  size_t total = 0;
+  for (size_t i = 0; i < 4; i++) {
+    total += ids[i];
+  }
+  EXPECT_EQ(6ul, total);
+  EXPECT_EQ(0ul, reused_ids.size());
+
+  int64_t keys1[] = {4, 3, 2, 1, 13, 14};
+  vector<size_t> ids1;
+  max = hashmap->Get((const int64_t*)keys1, 6ul, false, 1.0, &ids1, &reused_ids, &filtered);
+  EXPECT_EQ(6, max);
+  EXPECT_EQ(6u, ids1.size());
+  for (size_t i = 0; i < 4; i++) {
+    EXPECT_EQ(ids[3 - i], ids1[i]);
+  }
+  EXPECT_EQ(9u, ids1[4] + ids1[5]);
+  EXPECT_EQ(0u, reused_ids.size());
+
+  int64_t keys2[] = {1, 100};
+  max = hashmap->Get((const int64_t*)keys2, 2ul, true, 1.0, &ids1, &reused_ids, &filtered);
+  EXPECT_EQ(6, max);
+  EXPECT_EQ(ids[0], ids1[0]);
+}
+
+TEST(OpenHashMap64Test, SortedDuplicate) {
+  std::unique_ptr<HashMap> hashmap(new OpenHashMapImpl<int64_t>(1));
+  int64_t keys[] = {5, 5, 5, 7, 7, 9};
+  vector<size_t> ids;
+  tbb::concurrent_vector<size_t> reused_ids;
+  size_t filtered;
+  int64_t max = hashmap->Get((const int64_t*)keys, 6ul, false, 1.0, &ids, &reused_ids, &filtered);
+  EXPECT_EQ(3, max);
+  EXPECT_EQ(ids[0], ids[1]);
+  EXPECT_EQ(ids[0], ids[2]);
+  EXPECT_EQ(ids[3], ids[4]);
+  EXPECT_NE(ids[0], ids[3]);
+  EXPECT_NE(ids[3], ids[5]);
+}
+
+TEST(OpenHashMap128Test, Get) {
+  std::unique_ptr<HashMap> hashmap(new OpenHashMapImpl<Hash128Key>(1));
+  int64_t keys[] = {1, 2, 3, 4};
+  vector<size_t> ids;
+  tbb::concurrent_vector<size_t> reused_ids;
+  size_t filtered;
+  int64_t max = hashmap->Get((const int64_t*)keys, 2ul, false, 1.0, &ids, &reused_ids, &filtered);
+  EXPECT_EQ(2, max);
+  EXPECT_EQ(2u, ids.size());
+  EXPECT_EQ(1u, ids[0] + ids[1]);
+
+  int64_t keys1[] = {4, 3, 3, 4, 13, 14};
+  vector<size_t> ids1;
+  max = hashmap->Get((const int64_t*)keys1, 3ul, false, 1.0, &ids1, &reused_ids, &filtered);
+  EXPECT_EQ(4, max);
+  EXPECT_EQ(3u, ids1.size());
+  EXPECT_EQ(ids[1], ids1[1]);
+  EXPECT_EQ(0u, reused_ids.size());
+}
+
+TEST(OpenHashMap128Test, Erase) {
+  std::unique_ptr<HashMap> hashmap(new OpenHashMapImpl<Hash128Key>(1));
+  int64_t keys[] = {1, 2, 3, 4};
+  vector<size_t> ids;
+  tbb::concurrent_vector<size_t> reused_ids;
+  size_t filtered;
+  int64_t max = hashmap->Get(keys, 2ul, false, 1.0, &ids, &reused_ids, &filtered);
+  ASSERT_EQ(2, max);
+  int64_t del_keys[] = {3, 4};
+  hashmap->Erase(del_keys, 1);
+  int64_t keys2[] = {1, 2, 5, 6};
+  vector<size_t> ids2;
+  max = hashmap->Get(keys2, 2ul, false, 1.0, &ids2, &reused_ids, &filtered);
+  ASSERT_EQ(2, max);
+  EXPECT_EQ(ids[0], ids2[0]);
+  EXPECT_EQ(ids[1], ids2[1]);
+  ASSERT_EQ(1u, reused_ids.size());
+  EXPECT_EQ(ids[1], reused_ids[0]);
+}
+
+TEST(OpenHashMap64Test, EraseById) {
+  std::unique_ptr<OpenHashMapImpl<int64_t> > hashmap(new OpenHashMapImpl<int64_t>(1));
+  int64_t keys[] = {10, 20, 30, 40};
+  vector<size_t> ids;
+  tbb::concurrent_vector<size_t> reused_ids;
+  size_t filtered;
+  hashmap->Get(keys, 4ul, false, 1.0, &ids, &reused_ids, &filtered);
+  tbb::concurrent_vector<size_t> unfiltered;
+  std::vector<size_t> del_ids = {ids[1], ids[2]};
+  std::sort(del_ids.begin(), del_ids.end());
+  EXPECT_EQ(2u, hashmap->EraseById("var", del_ids, &unfiltered));
+  EXPECT_EQ(2u, unfiltered.size());
+  HashMapStruct<int64_t> items;
+  hashmap->GetItems(&items);
+  EXPECT_EQ(2, items.count);
+}
+
+TEST(OpenHashMap64Test, EraseIds) {
+  for (bool track : {false, true}) {
+    std::unique_ptr<OpenHashMapImpl<int64_t> > hashmap(new OpenHashMapImpl<int64_t>(1));
+    int64_t keys[] = {10, 20, 30, 40};
+    vector<size_t> ids;
+    tbb::concurrent_vector<size_t> reused_ids;
+    size_t filtered;
+    hashmap->Get(keys, 4ul, false, 1.0, &ids, &reused_ids, &filtered);
+    if (track) {
+      hashmap->TrackKeys();
+    }
+    vector<size_t> erased;
+    EXPECT_EQ(2u, hashmap->EraseIds({ids[3], ids[1], 100}, &erased));
+    EXPECT_EQ(2u, erased.size());
+    EXPECT_EQ(0u, hashmap->EraseIds({ids[1]}, nullptr));
+    HashMapStruct<int64_t> items;
+    hashmap->GetItems(&items);
+    EXPECT_EQ(2, items.count);
+
+    int64_t new_keys[] = {50};
+    vector<size_t> new_ids;
+    hashmap->Get(new_keys, 1ul, false, 1.0, &new_ids, &reused_ids, &filtered);
+    ASSERT_EQ(1u, reused_ids.size());
+    EXPECT_EQ(1u, hashmap->EraseIds({new_ids[0]}, nullptr));
+    HashMapStruct<int64_t> left;
+    hashmap->GetItems(&left);
+    EXPECT_EQ(2, left.count);
+  }
+}
+
+TEST(OpenHashMap64Test, BlackWhiteList) {
+  std::unique_ptr<OpenHashMapImpl<int64_t> > hashmap(new OpenHashMapImpl<int64_t>(1));
+  int64_t keys[] = {10, 20, 30, 40};
+  vector<size_t> ids;
+  tbb::concurrent_vector<size_t> reused_ids;
+  size_t filtered;
+  hashmap->Get(keys, 4ul, false, 1.0, &ids, &reused_ids, &filtered);
+  hashmap->NewBlackList()->insert(20);
+  EXPECT_EQ(1u, hashmap->FilterByBlackList());
+  hashmap->NewWhiteList()->insert({10, 40, 50});
+  EXPECT_EQ(1u, hashmap->FilterByWhiteList());
+  HashMapStruct<int64_t> items;
+  hashmap->GetItems(&items);
+  EXPECT_EQ(2, items.count);
+
+  // the lists keep gating the inserts, the ids of the filtered keys are reused
+  int64_t new_keys[] = {20, 30, 50};
+  vector<size_t> new_ids;
+  hashmap->Get(new_keys, 3ul, false, 1.0, &new_ids, &reused_ids, &filtered);
+  EXPECT_EQ(2u, filtered);
+  EXPECT_EQ(HashMap::NOT_ADD_ID, new_ids[0]);
+  EXPECT_EQ(HashMap::NOT_ADD_ID, new_ids[1]);
+  ASSERT_EQ(1u, reused_ids.size());
+  EXPECT_EQ(reused_ids[0], new_ids[2]);
+}
+
+TEST(OpenHashMap64Test, Grow) {
+  size_t key_count = 100000;
+  std::unique_ptr<HashMap> hashmap(new OpenHashMapImpl<int64_t>(1));
+  std::vector<int64_t> keys(key_count);
+  for (size_t i = 0; i < key_count; i++) {
+    keys[i] = i * 7919;
+  }
+  vector<size_t> ids;
+  tbb::concurrent_vector<size_t> reused_ids;
+  size_t filtered;
+  for (size_t i = 0; i < key_count; i += 1000) {
+    vector<size_t> part;
+    hashmap->Get(&keys[i], 1000, false, 1.0, &part, &reused_ids, &filtered);
+    ids.insert(ids.end(), part.begin(), part.end());
+  }
+  vector<size_t> found;
+  int64_t max = hashmap->Get(&keys[0], key_count, true, 1.0, &found, &reused_ids, &filtered);
+  EXPECT_EQ((int64_t)key_count, max);
+  EXPECT_EQ(ids, found);
+}
+
+TEST(OpenHashMap128Test, MultiThread) {
+  int thread_count = 10;
+  size_t key_count = 20000l;
+  std::unique_ptr<HashMap> hashmap(new OpenHashMapImpl<Hash128Key>(1));
+  int64_t* keys = new int64_t[key_count];
+  for (size_t i = 0; i < key_count; i++) {
+    keys[i] = i;
+  }
+  std::atomic<size_t> total(0);
+  ps::MultiThreadDoTBB(thread_count, [&](const Range& r) {
+        for (size_t i = r.begin; i < r.end; i++) {
+          vector<size_t> ids;
+          tbb::concurrent_vector<size_t> reused_ids;
+          size_t filtered;
+          hashmap->Get(keys + i* key_count/thread_count, key_count/2/thread_count, false, 1.0, &ids, &reused_ids, &filtered);
+          EXPECT_EQ(key_count/2/thread_count, ids.size());
+          size_t sub_total = 0;
+          for (size_t j = 0; j < ids.size(); j++) {
+            sub_total += ids[j];
+          }
+          total.fetch_add(sub_total);
+        }
+        return Status::Ok();
+      });
+  EXPECT_EQ(49995000, total);
+  delete [] keys;
+}
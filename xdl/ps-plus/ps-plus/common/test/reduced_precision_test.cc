@@ -0,0 +1,69 @@
+#include <cmath>
+#include <vector>
+#include "gtest/gtest.h"
+#include "ps-plus/common/reduced_precision.h"
+
+using ps::StoragePrecision;
+
+TEST(ReducedPrecisionTest, Half) {
+  EXPECT_EQ(0x3C00, ps::FloatToHalf(1.0f, 0x80000000u));
+  EXPECT_EQ(0xC000, ps::FloatToHalf(-2.0f, 0x80000000u));
+  EXPECT_EQ(0x7C00, ps::FloatToHalf(1e6f, 0x80000000u));
+  EXPECT_EQ(0x0001, ps::FloatToHalf(std::ldexp(1.0f, -24), 0x80000000u));
+  for (float v : {0.0f, 1.0f, -3.5f, 0.0999755859375f, 65504.0f, std::ldexp(1.0f, -20)}) {
+    EXPECT_EQ(v, ps::HalfToFloat(ps::FloatToHalf(v, 0x80000000u)));
+  }
+  EXPECT_TRUE(std::isnan(ps::HalfToFloat(ps::FloatToHalf(NAN, 0))));
+}
+
+TEST(ReducedPrecisionTest, BFloat16) {
+  EXPECT_EQ(0x3F80, ps::FloatToBFloat16(1.0f, 0x80000000u));
+  for (float v : {0.0f, 1.0f, -3.5f, 25.0f, 1e30f}) {
+    float r = ps::BFloat16ToFloat(ps::FloatToBFloat16(v, 0x80000000u));
+    EXPECT_NEAR(v, r, std::fabs(v) / 128);
+  }
+  EXPECT_TRUE(std::isnan(ps::BFloat16ToFloat(ps::FloatToBFloat16(NAN, 0))));
+}
+
+TEST(ReducedPrecisionTest, StochasticRoundingIsUnbiased) {
+  // 1 + 2^-10 lies between two bf16 neighbours 1 and 1 + 2^-7
+  float value = 1.0f + std::ldexp(1.0f, -10);
+  std::vector<float> src(100000, value);
+  std::vector<uint16_t> dst(src.size());
+  std::vector<float> back(src.size());
+  uint64_t seed = 1;
+  ps::EncodeRow(StoragePrecision::kBf16, src.data(), src.size(), dst.data(), &seed);
+  ps::DecodeRow(StoragePrecision::kBf16, dst.data(), src.size(), back.data());
+  double sum = 0;
+  for (float v : back) {
+    sum += v;
+  }
+  EXPECT_NEAR(value, sum / src.size(), 1e-4);
+}
+
+TEST(ReducedPrecisionTest, Int8Row) {
+  std::vector<float> src = {-1.0f, 0.5f, 0.25f, 0.0f, 2.0f};
+  EXPECT_EQ(sizeof(float) + src.size(), ps::EncodedRowBytes(StoragePrecision::kInt8, src.size()));
+  std::vector<char> dst(ps::EncodedRowBytes(StoragePrecision::kInt8, src.size()));
+  ps::EncodeRow(StoragePrecision::kInt8, src.data(), src.size(), dst.data(), nullptr);
+  std::vector<float> back(src.size());
+  ps::DecodeRow(StoragePrecision::kInt8, dst.data(), src.size(), back.data());
+  for (size_t i = 0; i < src.size(); i++) {
+    EXPECT_NEAR(src[i], back[i], 2.0f / 127);
+  }
+  EXPECT_FLOAT_EQ(2.0f, back[4]);
+
+  std::vector<float> zeros(4, 0);
+  ps::EncodeRow(StoragePrecision::kInt8, zeros.data(), zeros.size(), dst.data(), nullptr);
+  ps::DecodeRow(StoragePrecision::kInt8, dst.data(), zeros.size(), back.data());
+  EXPECT_EQ(0, back[0]);
+}
+
+TEST(ReducedPrecisionTest, Parse) {
+  StoragePrecision p;
+  EXPECT_TRUE(ps::ParseStoragePrecision("bf16", &p).IsOk());
+  EXPECT_EQ(StoragePrecision::kBf16, p);
+  EXPECT_TRUE(ps::ParseStoragePrecision("int8", &p).IsOk());
+  EXPECT_EQ(StoragePrecision::kInt8, p);
+  EXPECT_FALSE(ps::ParseStoragePrecision("fp8", &p).IsOk());
+}
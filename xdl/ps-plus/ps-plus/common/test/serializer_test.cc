@@ -17,6 +17,7 @@
 #include "ps-plus/message/variable_info.h"
 #include "ps-plus/message/cluster_info.h"
 #include "ps-plus/message/udf_chain_register.h"
+#include "ps-plus/message/variable_stats.h"
 
 #undef private
 
@@ -541,6 +542,49 @@ TEST(SerializerTest, Serializer) {
     delete result;
     delete[] deserialize_buf.base;
   }
+  {
+    //vector<Tensor> payloads are sent from the tensor buffers
+    MemGuard mem_guard;
+    ps::Tensor t(DataType::kInt32, ps::TensorShape({2,2}), new ps::initializer::ConstantInitializer(3));
+    ps::Tensor t2(DataType::kFloat, ps::TensorShape({3}), new ps::initializer::ConstantInitializer(1.5));
+    WrapperData<std::vector<ps::Tensor> >* data = new WrapperData<std::vector<ps::Tensor> >(std::vector<ps::Tensor>{t, t2});
+    size_t id;
+    std::vector<Fragment> bufs;
+    Status st = SerializeAny<Data>(data, &id, &bufs, mem_guard);
+    EXPECT_TRUE(st.IsOk());
+    bool t_ref = false, t2_ref = false;
+    for (auto& frag : bufs) {
+      t_ref |= frag.base == t.Raw<char>();
+      t2_ref |= frag.base == t2.Raw<char>();
+    }
+    EXPECT_TRUE(t_ref);
+    EXPECT_TRUE(t2_ref);
+
+    ps::Data* result = nullptr;
+    size_t len;
+    Fragment deserialize_buf;
+    FragmentConcat(bufs, &deserialize_buf);
+    st = DeserializeAny<Data>(id, &deserialize_buf, 0, &result, &len, mem_guard);
+    EXPECT_TRUE(st.IsOk());
+    EXPECT_EQ(deserialize_buf.size, len);
+    WrapperData<std::vector<ps::Tensor> >* r = dynamic_cast<WrapperData<std::vector<ps::Tensor> >*>(result);
+    EXPECT_EQ(2, r->Internal().size());
+    ps::Tensor& rt = r->Internal()[0];
+    EXPECT_EQ(DataType::kInt32, rt.Type());
+    EXPECT_EQ(ps::TensorShape({2,2}), rt.Shape());
+    for (size_t i = 0; i < 4; ++i) {
+      EXPECT_EQ(3, *(rt.Raw<int32_t>() + i));
+    }
+    ps::Tensor& rt2 = r->Internal()[1];
+    EXPECT_EQ(DataType::kFloat, rt2.Type());
+    EXPECT_EQ(ps::TensorShape({3}), rt2.Shape());
+    for (size_t i = 0; i < 3; ++i) {
+      EXPECT_EQ(1.5, *(rt2.Raw<float>() + i));
+    }
+    delete data;
+    delete result;
+    delete[] deserialize_buf.base;
+  }
 }
 
 TEST(MessageSerializerTest, ServerInfoTest) {
@@ -876,3 +920,61 @@ TEST(MessageSerializerTest, VecBoolTest) {
     delete result;
   }
 }
+
+TEST(MessageSerializerTest, ClusterStatsTest) {
+  {
+    MemGuard mem_guard;
+    WrapperData<ps::ClusterStats>* data = new WrapperData<ps::ClusterStats>();
+    ps::VariableStats var;
+    var.name = "emb";
+    var.rows = 3;
+    var.data_bytes = 96;
+    var.slot_names = {"acc", "m"};
+    var.slot_bytes = {96, 48};
+    var.hashmap_bytes = 200;
+    var.pull_rows = 10;
+    var.pull_bytes = 320;
+    var.push_rows = 5;
+    var.push_bytes = 160;
+    var.micros = 1000;
+    ps::ServerStats server;
+    server.server_id = 2;
+    server.variables.push_back(var);
+    data->Internal().servers.push_back(server);
+    data->Internal().variables.push_back(var);
+
+    size_t id;
+    std::vector<Fragment> bufs;
+    EXPECT_TRUE(SerializeAny<Data>(data, &id, &bufs, mem_guard).IsOk());
+
+    ps::Data* result = nullptr;
+    size_t len;
+    Fragment deserialize_buf;
+    FragmentConcat(bufs, &deserialize_buf);
+    EXPECT_TRUE(DeserializeAny<Data>(id, &deserialize_buf, 0, &result, &len, mem_guard).IsOk());
+    WrapperData<ps::ClusterStats>* r = dynamic_cast<WrapperData<ps::ClusterStats>*>(result);
+    ASSERT_TRUE(r != nullptr);
+    ASSERT_EQ(1u, r->Internal().servers.size());
+    EXPECT_EQ(2u, r->Internal().servers[0].server_id);
+    ASSERT_EQ(1u, r->Internal().servers[0].variables.size());
+    ASSERT_EQ(1u, r->Internal().variables.size());
+    const ps::VariableStats& ret = r->Internal().variables[0];
+    EXPECT_EQ("emb", ret.name);
+    EXPECT_EQ(3u, ret.rows);
+    EXPECT_EQ(96u, ret.data_bytes);
+    ASSERT_EQ(2u, ret.slot_names.size());
+    EXPECT_EQ("m", ret.slot_names[1]);
+    EXPECT_EQ(48u, ret.slot_bytes[1]);
+    EXPECT_EQ(200u, ret.hashmap_bytes);
+    EXPECT_EQ(10u, ret.pull_rows);
+    EXPECT_EQ(320u, ret.pull_bytes);
+    EXPECT_EQ(5u, ret.push_rows);
+    EXPECT_EQ(160u, ret.push_bytes);
+    EXPECT_EQ(1000u, ret.micros);
+    EXPECT_EQ(440u, ret.TotalBytes());
+    EXPECT_DOUBLE_EQ(10000.0, ret.Rate(ret.pull_rows));
+    delete data;
+    delete result;
+    delete[] deserialize_buf.base;
+  }
+}
@@ -0,0 +1,52 @@
+#include "gtest/gtest.h"
+#include "ps-plus/common/striped_lock.h"
+
+#include <thread>
+#include <vector>
+
+using ps::StripedLock;
+using ps::StripedLocker;
+
+TEST(StripedLock, StripedLock) {
+  const size_t kRows = 64;
+  std::vector<int64_t> rows(kRows * 4, 0);
+  StripedLock lock;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&rows, &lock, t](){
+      for (int i = 0; i < 10000; i++) {
+        size_t id = (i * 7 + t) % kRows;
+        StripedLocker locker(lock, id);
+        for (size_t j = 0; j < 4; j++) {
+          rows[id * 4 + j]++;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  int64_t sum = 0;
+  for (size_t i = 0; i < kRows; i++) {
+    for (size_t j = 1; j < 4; j++) {
+      EXPECT_EQ(rows[i * 4], rows[i * 4 + j]);
+    }
+    sum += rows[i * 4];
+  }
+  EXPECT_EQ(8 * 10000, sum);
+}
+
+TEST(StripedLock, Stripes) {
+  const size_t max_stripes = StripedLock::kMaxStripes;
+  EXPECT_EQ(1u, StripedLock(0).Stripes());
+  EXPECT_EQ(1u, StripedLock(1).Stripes());
+  EXPECT_EQ(8u, StripedLock(5).Stripes());
+  EXPECT_EQ(max_stripes, StripedLock(1 << 20).Stripes());
+  EXPECT_EQ(max_stripes, StripedLock().Stripes());
+
+  // every id maps to one of the stripes
+  StripedLock lock(4);
+  for (size_t id = 0; id < 1000; id++) {
+    StripedLocker locker(lock, id);
+  }
+}
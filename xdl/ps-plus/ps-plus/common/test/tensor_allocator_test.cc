@@ -0,0 +1,84 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "ps-plus/common/tensor_allocator.h"
+
+#include <cstring>
+#include <set>
+
+using ps::ChunkArena;
+using ps::TensorAllocator;
+
+TEST(TensorAllocatorTest, ParseOptions) {
+  TensorAllocator::Options options;
+  ASSERT_TRUE(TensorAllocator::ParseOptions("", "", &options).IsOk());
+  EXPECT_EQ(TensorAllocator::kNoHugePage, options.huge_page);
+  EXPECT_EQ(TensorAllocator::kNoNuma, options.numa);
+  ASSERT_TRUE(TensorAllocator::ParseOptions("1g", "interleave", &options).IsOk());
+  EXPECT_EQ(TensorAllocator::kHugePage1GB, options.huge_page);
+  EXPECT_EQ(TensorAllocator::kInterleave, options.numa);
+  ASSERT_TRUE(TensorAllocator::ParseOptions("2m", "slice", &options).IsOk());
+  EXPECT_EQ(TensorAllocator::kHugePage2MB, options.huge_page);
+  EXPECT_EQ(TensorAllocator::kSlice, options.numa);
+  ASSERT_TRUE(TensorAllocator::ParseOptions("thp", "1", &options).IsOk());
+  EXPECT_EQ(TensorAllocator::kTransparent, options.huge_page);
+  EXPECT_EQ(TensorAllocator::kNode, options.numa);
+  EXPECT_EQ(1, options.node);
+  EXPECT_FALSE(TensorAllocator::ParseOptions("4k", "", &options).IsOk());
+  EXPECT_FALSE(TensorAllocator::ParseOptions("", "x", &options).IsOk());
+  EXPECT_GE(TensorAllocator::NumaNodes(), 1);
+}
+
+TEST(TensorAllocatorTest, Map) {
+  // the explicit huge pages fall back to thp if none are reserved
+  for (const char* huge_page: {"thp", "2m"}) {
+    TensorAllocator::Options options;
+    ASSERT_TRUE(TensorAllocator::ParseOptions(huge_page, "interleave", &options).IsOk());
+    TensorAllocator allocator(options);
+    size_t mapped = 0;
+    char* buffer = allocator.Map(3 << 20, 0, &mapped);
+    ASSERT_NE(nullptr, buffer);
+    EXPECT_EQ(0, (size_t)buffer % (2 << 20));
+    EXPECT_EQ(4 << 20, mapped);
+    memset(buffer, 1, mapped);
+    TensorAllocator::Unmap(buffer, mapped);
+  }
+}
+
+TEST(TensorAllocatorTest, ChunkArena) {
+  TensorAllocator::Options options;
+  ASSERT_TRUE(TensorAllocator::ParseOptions("thp", "slice", &options).IsOk());
+  TensorAllocator allocator(options);
+  ChunkArena arena(100 << 10, &allocator);
+  std::set<char*> chunks;
+  for (int i = 0; i < 100; ++i) {
+    char* chunk = arena.Allocate();
+    memset(chunk, i, 100 << 10);
+    ASSERT_TRUE(chunks.insert(chunk).second);
+  }
+  // the regions double from 2MB
+  EXPECT_EQ((2 + 4 + 8) << 20, arena.MappedBytes());
+  char* chunk = *chunks.begin();
+  arena.Free(chunk);
+  EXPECT_EQ(chunk, arena.Allocate());
+
+  TensorAllocator disabled(TensorAllocator::Options{});
+  ChunkArena heap(100, &disabled);
+  chunk = heap.Allocate();
+  memset(chunk, 1, 100);
+  heap.Free(chunk);
+  EXPECT_EQ(0, heap.MappedBytes());
+}
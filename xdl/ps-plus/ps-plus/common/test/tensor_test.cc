@@ -2,6 +2,10 @@
 #include "ps-plus/common/tensor.h"
 #include "ps-plus/common/initializer/constant_initializer.h"
 
+#include <cstdio>
+#include <thread>
+#include <atomic>
+
 using ps::TensorShape;
 using ps::DataType;
 using ps::Tensor;
@@ -70,6 +74,138 @@ TEST(TensorTest, Initializer) {
   EXPECT_EQ(0x1F1E1D1C1B1A1918, x.Raw<int64_t>()[3]);
 }
 
+TEST(TensorTest, SegmentGrowth) {
+  for (size_t segment_size : {4, 3}) {
+    Tensor x(DataType::kInt64, TensorShape({5, 2}), new ConstantInitializer(7), true, segment_size);
+    ASSERT_EQ(0u, x.Shape()[0] % segment_size);
+    for (size_t i = 0; i < 5; i++) {
+      x.Raw<int64_t>(i)[0] = i;
+      x.Raw<int64_t>(i)[1] = i + 100;
+    }
+    int64_t* row = x.Raw<int64_t>(4);
+
+    std::atomic<bool> done(false);
+    std::atomic<size_t> mismatch(0);
+    std::thread reader([&]{
+      while (!done) {
+        for (size_t i = 0; i < 5; i++) {
+          if (x.Raw<int64_t>(i)[1] != (int64_t)i + 100) {
+            mismatch++;
+          }
+        }
+      }
+    });
+    for (size_t rows = 6; rows <= 1000; rows++) {
+      x.ReShape(TensorShape({rows, 2}));
+    }
+    done = true;
+    reader.join();
+    EXPECT_EQ(0u, mismatch);
+
+    // the rows never move on growth
+    EXPECT_EQ(row, x.Raw<int64_t>(4));
+    EXPECT_LE(1000u, x.Shape()[0]);
+    EXPECT_EQ(0u, x.Shape()[0] % segment_size);
+    for (size_t i = 0; i < 5; i++) {
+      EXPECT_EQ((int64_t)i, x.Raw<int64_t>(i)[0]);
+    }
+    for (size_t i = 5; i < 1000; i++) {
+      EXPECT_EQ(7, x.Raw<int64_t>(i)[0]);
+      if (i % segment_size != 0) {
+        EXPECT_EQ(x.Raw<int64_t>(i - 1) + 2, x.Raw<int64_t>(i));
+      }
+    }
+  }
+}
+
+TEST(TensorTest, InterleavedRows) {
+  // 2 floats, then 2 doubles the reserved bytes fit
+  Tensor x(DataType::kFloat, TensorShape({5, 2}), new ConstantInitializer(1), true, 4, 16);
+  EXPECT_TRUE(x.Interleaved());
+  EXPECT_EQ(24u, x.RowStride());
+  Tensor m;
+  EXPECT_TRUE(x.AddRowField(DataType::kDouble, TensorShape({5, 1}), new ConstantInitializer(2), true, &m).IsOk());
+  EXPECT_TRUE(m.Interleaved());
+  Tensor v;
+  EXPECT_TRUE(x.AddRowField(DataType::kInt8, TensorShape({5, 1}), new ConstantInitializer(3), true, &v).IsOk());
+  Tensor full;
+  EXPECT_FALSE(x.AddRowField(DataType::kDouble, TensorShape({5, 1}), new ConstantInitializer(4), true, &full).IsOk());
+  EXPECT_EQ(8u, x.Shape()[0]);
+  EXPECT_EQ(8u, m.Shape()[0]);
+  for (size_t i = 0; i < 8; i++) {
+    // the double is aligned after the floats, the int8 after the double
+    EXPECT_EQ(x.Raw<char>(i) + 8, m.Raw<char>(i));
+    EXPECT_EQ(x.Raw<char>(i) + 16, v.Raw<char>(i));
+    EXPECT_EQ(1, x.Raw<float>(i)[1]);
+    EXPECT_EQ(2, m.Raw<double>(i)[0]);
+    EXPECT_EQ(3, v.Raw<int8_t>(i)[0]);
+    x.Raw<float>(i)[0] = i;
+    m.Raw<double>(i)[0] = i + 10;
+  }
+
+  // a grow of any of them inits the new rows of all
+  m.ReShape(TensorShape({20, 1}));
+  x.ReShape(TensorShape({20, 2}));
+  EXPECT_EQ(24u, x.Shape()[0]);
+  EXPECT_EQ(24u, m.Shape()[0]);
+  EXPECT_EQ(8u, v.Shape()[0]);
+  for (size_t i = 0; i < 20; i++) {
+    EXPECT_EQ(i < 8 ? (float)i : 1, x.Raw<float>(i)[0]);
+    EXPECT_EQ(i < 8 ? i + 10.0 : 2, m.Raw<double>(i)[0]);
+    EXPECT_EQ(3, v.Raw<int8_t>(i)[0]);
+  }
+  m.ClearId(3);
+  EXPECT_EQ(2, m.Raw<double>(3)[0]);
+  EXPECT_EQ(3, x.Raw<float>(3)[0]);
+
+  // a clone owns its rows
+  Tensor y = x.Clone();
+  EXPECT_FALSE(y.Interleaved());
+  EXPECT_EQ(8u, y.RowStride());
+  for (size_t i = 0; i < 20; i++) {
+    EXPECT_EQ(x.Raw<float>(i)[0], y.Raw<float>(i)[0]);
+    EXPECT_EQ(x.Raw<float>(i)[1], y.Raw<float>(i)[1]);
+  }
+
+  // the rows are shared, so a spill of any of them spills all
+  FILE* file = tmpfile();
+  ASSERT_NE(nullptr, file);
+  EXPECT_TRUE(x.SpillSegment(0, fileno(file)).IsOk());
+  EXPECT_TRUE(m.SegmentSpilled(0));
+  EXPECT_EQ(11, m.Raw<double>(1)[0]);
+  EXPECT_TRUE(m.LoadSegment(0).IsOk());
+  EXPECT_FALSE(x.SegmentSpilled(0));
+  EXPECT_EQ(1, x.Raw<float>(1)[0]);
+  fclose(file);
+
+  Tensor z(DataType::kFloat, TensorShape({5, 2}), new ConstantInitializer(1), Tensor::TType::kSegment, true);
+  EXPECT_FALSE(z.Interleaved());
+  EXPECT_FALSE(z.AddRowField(DataType::kInt8, TensorShape({5, 1}), new ConstantInitializer(3), true, &full).IsOk());
+}
+
+TEST(TensorTest, SpillSegment) {
+  Tensor x(DataType::kInt64, TensorShape({4, 2}), new ConstantInitializer(1), Tensor::TType::kSegment, true);
+  for (size_t i = 0; i < 8; i++) {
+    x.Raw<int64_t>()[i] = i;
+  }
+  ASSERT_EQ(1u, x.SegmentCount());
+  FILE* file = tmpfile();
+  ASSERT_NE(nullptr, file);
+  EXPECT_FALSE(x.SegmentSpilled(0));
+  EXPECT_TRUE(x.SpillSegment(0, fileno(file)).IsOk());
+  EXPECT_TRUE(x.SegmentSpilled(0));
+  for (size_t i = 0; i < 8; i++) {
+    EXPECT_EQ((int64_t)i, x.Raw<int64_t>()[i]);
+  }
+  x.Raw<int64_t>()[3] = 100;
+  EXPECT_TRUE(x.LoadSegment(0).IsOk());
+  EXPECT_FALSE(x.SegmentSpilled(0));
+  EXPECT_EQ(100, x.Raw<int64_t>()[3]);
+  EXPECT_EQ(7, x.Raw<int64_t>()[7]);
+  EXPECT_FALSE(x.SpillSegment(1, fileno(file)).IsOk());
+  fclose(file);
+}
+
 TEST(TensorTest, CopyAndMoveForOwnBuffer) {
   TensorShape shape({1, 8});
   Tensor x(DataType::kInt8, shape, new ConstantInitializer(1));
@@ -19,3 +19,58 @@ TEST(ThreadPoolTest, ThreadPool) {
   free(dest);
   free(src);
 }
+
+TEST(ThreadPoolTest, Order) {
+  // a pool of one thread runs the tasks in the order scheduled
+  std::vector<int> order;
+  {
+    ThreadPool pool(1);
+    for (int i = 0; i < 1000; i++) {
+      pool.Schedule([&order, i]{ order.push_back(i); });
+    }
+  }
+  ASSERT_EQ(order.size(), 1000u);
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_EQ(order[i], i);
+  }
+}
+
+TEST(ThreadPoolTest, Steal) {
+  ps::common::Histogram queue_wait;
+  std::atomic<int> count(0);
+  {
+    ThreadPool pool(4, false, &queue_wait);
+    // the tasks a worker schedules go to its own deque, the others steal them
+    pool.Schedule([&]{
+      for (int i = 0; i < 1000; i++) {
+        pool.Schedule([&]{ ++count; });
+      }
+    });
+    std::vector<std::function<void()>> tasks;
+    for (int i = 0; i < 1000; i++) {
+      tasks.emplace_back([&]{ ++count; });
+    }
+    pool.ScheduleBatch(&tasks);
+    ASSERT_TRUE(tasks.empty());
+  }
+  ASSERT_EQ(count, 2000);
+  ASSERT_EQ(queue_wait.Count(), 2001u);
+}
+
+TEST(ThreadPoolTest, MultiThreadDo) {
+  std::vector<int> values(100000, 0);
+  ps::Status st = ps::MultiThreadDo(values.size(), [&](const ps::Range& range) {
+    for (size_t i = range.begin; i < range.end; i++) {
+      values[i]++;
+    }
+    return ps::Status::Ok();
+  }, 100);
+  ASSERT_TRUE(st.IsOk());
+  for (size_t i = 0; i < values.size(); i++) {
+    ASSERT_EQ(values[i], 1);
+  }
+  st = ps::MultiThreadDo(values.size(), [&](const ps::Range& range) {
+    return range.begin == 0 ? ps::Status::ArgumentError("first") : ps::Status::Ok();
+  }, 100);
+  ASSERT_FALSE(st.IsOk());
+}
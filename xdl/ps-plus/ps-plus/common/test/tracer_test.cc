@@ -0,0 +1,69 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ps-plus/common/tracer.h"
+
+using ps::common::ScopedSpan;
+using ps::common::TraceContext;
+using ps::common::TraceScope;
+using ps::common::TraceSpan;
+using ps::common::Tracer;
+
+TEST(TracerTest, Spans) {
+  std::vector<TraceSpan> spans;
+  Tracer* tracer = Tracer::Instance();
+  tracer->SetExporter([&spans](const std::vector<TraceSpan>& batch) {
+    spans.insert(spans.end(), batch.begin(), batch.end());
+  });
+  tracer->SetProcessName("worker_0");
+  EXPECT_TRUE(tracer->Enabled());
+
+  {
+    // out of a trace
+    ScopedSpan span("op", "none");
+    EXPECT_FALSE(span.context().Traced());
+  }
+  TraceContext root(Tracer::NewId(), Tracer::NewId());
+  {
+    TraceScope scope(root);
+    ScopedSpan rpc("ps_rpc", "emb");
+    EXPECT_EQ(root.trace_id, Tracer::Current().trace_id);
+    EXPECT_EQ(rpc.context().span_id, Tracer::Current().span_id);
+    ScopedSpan udf("udf", "BuildHashSlice");
+  }
+  EXPECT_FALSE(Tracer::Current().Traced());
+  tracer->Flush();
+
+  ASSERT_EQ(2u, spans.size());
+  EXPECT_EQ("BuildHashSlice", spans[0].name);
+  EXPECT_EQ("emb", spans[1].name);
+  EXPECT_EQ(root.span_id, spans[1].parent_id);
+  EXPECT_EQ(spans[1].span_id, spans[0].parent_id);
+  EXPECT_EQ(root.trace_id, spans[0].trace_id);
+  EXPECT_EQ("worker_0", spans[0].process);
+  EXPECT_LE(spans[0].start_micros, spans[0].end_micros);
+
+  tracer->SetExporter(nullptr);
+}
+
+TEST(TracerTest, ChildId) {
+  uint64_t id = Tracer::NewId();
+  EXPECT_NE(0u, id);
+  EXPECT_EQ(Tracer::ChildId(id, 3), Tracer::ChildId(id, 3));
+  EXPECT_NE(Tracer::ChildId(id, 3), Tracer::ChildId(id, 4));
+}
@@ -14,42 +14,141 @@ limitations under the License.
 ==============================================================================*/
 
 #include "ps-plus/common/thread_pool.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#include <chrono>
+
 namespace ps {
- 
-ThreadPool::ThreadPool(size_t threads)
-  : stop_(false) {
+
+namespace {
+
+// the pool and the worker id of the running worker thread
+thread_local const void* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threads, bool pin, common::Histogram* queue_wait)
+  : next_queue_(0), pending_(0), idle_(0), queue_wait_(queue_wait), stop_(false) {
+  if (threads == 0) {
+    threads = 1;
+  }
   for (size_t i = 0; i < threads; i++) {
-    workers_.emplace_back([this]{ Loop(); });
+    queues_.emplace_back(new Queue);
   }
+  size_t cpus = std::thread::hardware_concurrency();
+  for (size_t i = 0; i < threads; i++) {
+    workers_.emplace_back([this, i]{ Loop(i); });
+    if (pin && cpus > 0) {
+      cpu_set_t cpuset;
+      CPU_ZERO(&cpuset);
+      CPU_SET(i % cpus, &cpuset);
+      pthread_setaffinity_np(workers_.back().native_handle(), sizeof(cpuset), &cpuset);
+    }
+  }
+}
+
+uint64_t ThreadPool::NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
-void ThreadPool::Loop() {
+size_t ThreadPool::CurrentWorker() const {
+  return current_pool == this ? current_worker : workers_.size();
+}
+
+bool ThreadPool::Pop(size_t id, Task* task) {
+  // the own deque first, then those of the others from the next one
+  for (size_t i = 0; i < queues_.size(); i++) {
+    Queue* queue = queues_[(id + i) % queues_.size()].get();
+    std::unique_lock<std::mutex> lock(queue->mu);
+    if (!queue->tasks.empty()) {
+      *task = std::move(queue->tasks.front());
+      queue->tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::Push(size_t id, Task&& task) {
+  Queue* queue = queues_[id].get();
+  std::unique_lock<std::mutex> lock(queue->mu);
+  queue->tasks.emplace_back(std::move(task));
+}
+
+void ThreadPool::Wake(bool all) {
+  // a worker going idle counts itself before it checks pending_, so
+  // either it sees the task or the scheduler sees it idle
+  if (idle_.load() == 0) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(idle_mutex_);
+  if (all) {
+    condition_.notify_all();
+  } else {
+    condition_.notify_one();
+  }
+}
+
+void ThreadPool::Loop(size_t id) {
+  current_pool = this;
+  current_worker = id;
   while (true) {
-    std::function<void()> task;
-    {
-      std::unique_lock<std::mutex> lock(this->queue_mutex_);
-      this->condition_.wait(lock,
-          [this]{ return this->stop_ || !this->tasks_.empty(); });
-      if (this->stop_ && this->tasks_.empty())
-          return;
-      task = std::move(this->tasks_.front());
-      this->tasks_.pop();
+    Task task;
+    if (Pop(id, &task)) {
+      --pending_;
+      if (queue_wait_ != nullptr) {
+        queue_wait_->Record(NowMicros() - task.enqueue_us);
+      }
+      task.func();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    ++idle_;
+    condition_.wait(lock, [this]{ return stop_ || pending_.load() > 0; });
+    --idle_;
+    if (stop_ && pending_.load() <= 0) {
+      return;
     }
-    task();
   }
 }
 
 void ThreadPool::Schedule(const std::function<void()>& func) {
-  {
-    std::unique_lock<std::mutex> lock(queue_mutex_);
-    tasks_.emplace(func);
+  size_t id = CurrentWorker();
+  if (id == workers_.size()) {
+    id = next_queue_++ % queues_.size();
+  }
+  Push(id, Task{func, queue_wait_ == nullptr ? 0 : NowMicros()});
+  ++pending_;
+  Wake(false);
+}
+
+void ThreadPool::ScheduleBatch(std::vector<std::function<void()>>* funcs) {
+  if (funcs->empty()) {
+    return;
+  }
+  uint64_t now = queue_wait_ == nullptr ? 0 : NowMicros();
+  size_t chunks = std::min(queues_.size(), funcs->size());
+  size_t first = next_queue_++;
+  for (size_t c = 0; c < chunks; c++) {
+    Queue* queue = queues_[(first + c) % queues_.size()].get();
+    std::unique_lock<std::mutex> lock(queue->mu);
+    for (size_t i = c; i < funcs->size(); i += chunks) {
+      queue->tasks.emplace_back(Task{std::move((*funcs)[i]), now});
+    }
   }
-  condition_.notify_one();
+  pending_ += funcs->size();
+  funcs->clear();
+  Wake(true);
 }
 
 ThreadPool::~ThreadPool() {
   {
-    std::unique_lock<std::mutex> lock(queue_mutex_);
+    std::unique_lock<std::mutex> lock(idle_mutex_);
     stop_ = true;
   }
   condition_.notify_all();
@@ -59,9 +158,12 @@ ThreadPool::~ThreadPool() {
 }
 
 ThreadPool* ThreadPool::Global() {
-  static ThreadPool tp(std::thread::hardware_concurrency());
+  static bool pin = getenv("PS_THREAD_POOL_PIN") != nullptr &&
+                    atoi(getenv("PS_THREAD_POOL_PIN")) != 0;
+  static ThreadPool tp(std::thread::hardware_concurrency(), pin,
+                       common::MetricsCollector::Instance()->GetHistogram(
+                           "ThreadPool.Global.QueueWait"));
   return &tp;
 };
 
 }
-
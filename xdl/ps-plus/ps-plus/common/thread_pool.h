@@ -17,34 +17,72 @@ limitations under the License.
 #define PS_PLUS_COMMON_THREAD_POOL_H
 
 #include <vector>
-#include <queue>
+#include <deque>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
 #include <future>
+#include <atomic>
+#include <memory>
 #include <cstring>
 #include "ps-plus/common/status.h"
+#include "ps-plus/common/metrics_collector.h"
 #include "tbb/parallel_for.h"
 
 namespace ps {
 
+// Work stealing pool, each worker owns a deque and takes the tasks of the
+// others once it runs out, so the schedulers do not contend on one queue.
+// The tasks scheduled by a worker go to its own deque, others are spread
+// round robin, and a pool of one thread runs them in order. The workers
+// may be pinned to the cpus in order, which keeps them on their numa node
+// with the usual cpu numbering, and the queue wait of the tasks may be
+// recorded in micros.
 class ThreadPool {
 public:
-  ThreadPool(size_t threads);
+  ThreadPool(size_t threads, bool pin = false,
+             common::Histogram* queue_wait = nullptr);
   ~ThreadPool();
   void Schedule(const std::function<void()>& func);
+  // Schedule the tasks in as many chunks as the workers, waking them once
+  void ScheduleBatch(std::vector<std::function<void()>>* funcs);
 
+  size_t Size() const { return workers_.size(); }
+
+  // Pinned with PS_THREAD_POOL_PIN=1, the queue wait is the histogram
+  // ThreadPool.Global.QueueWait of the MetricsCollector
   static ThreadPool* Global();
 private:
-  void Loop();
-
+  struct Task {
+    std::function<void()> func;
+    uint64_t enqueue_us;
+  };
+
+  struct Queue {
+    std::mutex mu;
+    std::deque<Task> tasks;
+  };
+
+  void Loop(size_t id);
+  bool Pop(size_t id, Task* task);
+  void Push(size_t id, Task&& task);
+  // The worker id of the calling thread in this pool, Size() if none
+  size_t CurrentWorker() const;
+  void Wake(bool all);
+  static uint64_t NowMicros();
+
+  std::vector<std::unique_ptr<Queue>> queues_;
   std::vector<std::thread> workers_;
-  std::queue<std::function<void()>> tasks_;
-  
-  std::mutex queue_mutex_;
+  std::atomic<size_t> next_queue_;
+  // the tasks scheduled and not popped yet
+  std::atomic<int64_t> pending_;
+  std::atomic<int64_t> idle_;
+  common::Histogram* queue_wait_;
+
+  std::mutex idle_mutex_;
   std::condition_variable condition_;
-  bool stop_;
+  std::atomic<bool> stop_;
 };
 
 inline void QuickMemcpy(void* dest, const void* src, size_t count) {
@@ -100,17 +138,22 @@ inline Status MultiThreadDo(size_t size, const std::function<Status(const Range&
       ++block_size;
     }
     Status st = Status::Ok();
+    std::mutex st_mu;
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(round);
     for (size_t i = 0; i < round; i++) {
-      ThreadPool::Global()->Schedule([&, i]{
+      tasks.emplace_back([&, i]{
             Range range{.begin=i*block_size, .end=std::min(size, (i+1)*block_size)};
             Status ret = func(range);
             if (!ret.IsOk()) {
+              std::unique_lock<std::mutex> lock(st_mu);
               st = ret;
             }
             if (--counter == 0) {
               ok.set_value(true);
             }});
     }
+    ThreadPool::Global()->ScheduleBatch(&tasks);
     ok.get_future().wait();
     return st;
   }
@@ -0,0 +1,60 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/common/timer_queue.h"
+
+namespace ps {
+
+TimerQueue::TimerQueue() : seq_(0), stop_(false) {
+  thread_ = std::thread([this]{ Loop(); });
+}
+
+TimerQueue::~TimerQueue() {
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+}
+
+void TimerQueue::Schedule(int64_t delay_us, const std::function<void()>& func) {
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    timers_.push(Timer{Clock::now() + std::chrono::microseconds(delay_us), seq_++, func});
+  }
+  cv_.notify_one();
+}
+
+void TimerQueue::Loop() {
+  std::unique_lock<std::mutex> lock(mu_);
+  while (!stop_) {
+    if (timers_.empty()) {
+      cv_.wait(lock);
+      continue;
+    }
+    if (timers_.top().when > Clock::now()) {
+      cv_.wait_until(lock, timers_.top().when);
+      continue;
+    }
+    std::function<void()> func = std::move(const_cast<Timer&>(timers_.top()).func);
+    timers_.pop();
+    lock.unlock();
+    func();
+    lock.lock();
+  }
+}
+
+}
@@ -0,0 +1,59 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_COMMON_TIMER_QUEUE_H
+#define PS_PLUS_COMMON_TIMER_QUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace ps {
+
+// Runs functions after a delay on one thread. Functions still pending when
+// the queue is destroyed are dropped.
+class TimerQueue {
+ public:
+  TimerQueue();
+  ~TimerQueue();
+  void Schedule(int64_t delay_us, const std::function<void()>& func);
+
+ private:
+  using Clock = std::chrono::steady_clock;
+  struct Timer {
+    Clock::time_point when;
+    size_t seq;
+    std::function<void()> func;
+    bool operator<(const Timer& rhs) const {
+      return when != rhs.when ? when > rhs.when : seq > rhs.seq;
+    }
+  };
+  void Loop();
+
+  std::priority_queue<Timer> timers_;
+  size_t seq_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool stop_;
+  std::thread thread_;
+};
+
+}
+
+#endif
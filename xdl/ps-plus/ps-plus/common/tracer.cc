@@ -0,0 +1,226 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/common/tracer.h"
+
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <random>
+
+#include "ps-plus/common/logging.h"
+
+namespace ps {
+namespace common {
+
+namespace {
+
+thread_local TraceContext current_context;
+
+std::string Escape(const std::string& str) {
+  std::string ret;
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      ret += '\\';
+      ret += c;
+    } else if (static_cast<unsigned char>(c) >= 0x20) {
+      ret += c;
+    }
+  }
+  return ret;
+}
+
+std::string Hex(uint64_t id) {
+  char buf[20];
+  snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)id);
+  return buf;
+}
+
+}  // namespace
+
+constexpr size_t Tracer::kFlushSpans;
+constexpr int64_t Tracer::kFlushMicros;
+
+Tracer* Tracer::Instance() {
+  static Tracer tracer;
+  return &tracer;
+}
+
+Tracer::Tracer()
+  : enabled_(false), process_(std::to_string(getpid())),
+    last_flush_(NowMicros()), file_(nullptr) {
+  const char* env = getenv("PS_TRACE_FILE");
+  if (env != nullptr && env[0] != '\0') {
+    SetExportFile(env);
+  }
+}
+
+Tracer::~Tracer() {
+  Flush();
+  if (file_ != nullptr) {
+    fclose(file_);
+  }
+}
+
+void Tracer::SetExportFile(const std::string& path) {
+  std::string real_path = path;
+  size_t pos = real_path.find("%p");
+  if (pos != std::string::npos) {
+    real_path.replace(pos, 2, std::to_string(getpid()));
+  }
+  Flush();
+  std::lock_guard<std::mutex> lock(export_mu_);
+  if (file_ != nullptr) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+  if (!real_path.empty()) {
+    file_ = fopen(real_path.c_str(), "a");
+    if (file_ == nullptr) {
+      LOG(WARNING) << "Tracer: can't open " << real_path << ", errno " << errno;
+    }
+  }
+  enabled_ = file_ != nullptr || exporter_ != nullptr;
+}
+
+void Tracer::SetExporter(Exporter exporter) {
+  Flush();
+  std::lock_guard<std::mutex> lock(export_mu_);
+  exporter_ = exporter;
+  enabled_ = file_ != nullptr || exporter_ != nullptr;
+}
+
+void Tracer::SetProcessName(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mu_);
+  process_ = name;
+}
+
+TraceContext Tracer::Current() {
+  return current_context;
+}
+
+void Tracer::SetCurrent(const TraceContext& ctx) {
+  current_context = ctx;
+}
+
+uint64_t Tracer::NewId() {
+  thread_local std::mt19937_64 rng(std::random_device{}());
+  uint64_t id;
+  do {
+    id = rng();
+  } while (id == 0);
+  return id;
+}
+
+uint64_t Tracer::ChildId(uint64_t id, uint64_t n) {
+  // splitmix64 finalizer
+  uint64_t x = id + (n + 1) * 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x == 0 ? 1 : x;
+}
+
+int64_t Tracer::NowMicros() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return static_cast<int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+void Tracer::Record(const TraceContext& parent, uint64_t span_id,
+                    const std::string& category, const std::string& name,
+                    int64_t start_micros, int64_t end_micros) {
+  if (!enabled_ || !parent.Traced()) {
+    return;
+  }
+  std::vector<TraceSpan> flush;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    spans_.push_back(TraceSpan{parent.trace_id, span_id, parent.span_id,
+                               process_, category, name, start_micros,
+                               std::max(end_micros, start_micros)});
+    if (spans_.size() >= kFlushSpans || end_micros - last_flush_ >= kFlushMicros) {
+      flush.swap(spans_);
+      last_flush_ = end_micros;
+    }
+  }
+  if (!flush.empty()) {
+    Export(flush);
+  }
+}
+
+void Tracer::Flush() {
+  std::vector<TraceSpan> flush;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    flush.swap(spans_);
+    last_flush_ = NowMicros();
+  }
+  if (!flush.empty()) {
+    Export(flush);
+  }
+}
+
+void Tracer::Export(const std::vector<TraceSpan>& spans) {
+  std::lock_guard<std::mutex> lock(export_mu_);
+  if (exporter_ != nullptr) {
+    exporter_(spans);
+  }
+  if (file_ == nullptr) {
+    return;
+  }
+  std::string lines;
+  for (auto&& span : spans) {
+    lines += "{\"trace_id\":\"" + Hex(span.trace_id) +
+             "\",\"span_id\":\"" + Hex(span.span_id) +
+             "\",\"parent_id\":\"" + Hex(span.parent_id) +
+             "\",\"process\":\"" + Escape(span.process) +
+             "\",\"cat\":\"" + Escape(span.category) +
+             "\",\"name\":\"" + Escape(span.name) +
+             "\",\"ts\":" + std::to_string(span.start_micros) +
+             ",\"dur\":" + std::to_string(span.end_micros - span.start_micros) +
+             "}\n";
+  }
+  fwrite(lines.data(), 1, lines.size(), file_);
+  fflush(file_);
+}
+
+ScopedSpan::ScopedSpan(const TraceContext& parent, const char* category,
+                       const std::string& name)
+  : parent_(parent), category_(category), start_micros_(0) {
+  if (!parent_.Traced() || !Tracer::Instance()->Enabled()) {
+    return;
+  }
+  name_ = name;
+  ctx_ = TraceContext(parent_.trace_id, Tracer::NewId());
+  saved_ = Tracer::Current();
+  Tracer::SetCurrent(ctx_);
+  start_micros_ = Tracer::NowMicros();
+}
+
+ScopedSpan::~ScopedSpan() {
+  if (!ctx_.Traced()) {
+    return;
+  }
+  Tracer::SetCurrent(saved_);
+  Tracer::Instance()->Record(parent_, ctx_.span_id, category_, name_,
+                             start_micros_, Tracer::NowMicros());
+}
+
+}  // namespace common
+}  // namespace ps
@@ -0,0 +1,140 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_COMMON_TRACER_H_
+#define PS_PLUS_COMMON_TRACER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ps {
+namespace common {
+
+// The trace and the span a piece of work runs under, the zero trace id is
+// not traced.
+struct TraceContext {
+  uint64_t trace_id = 0;
+  uint64_t span_id = 0;
+
+  TraceContext() {}
+  TraceContext(uint64_t trace, uint64_t span) : trace_id(trace), span_id(span) {}
+  bool Traced() const { return trace_id != 0; }
+};
+
+struct TraceSpan {
+  uint64_t trace_id;
+  uint64_t span_id;
+  uint64_t parent_id;
+  std::string process;
+  std::string category;
+  std::string name;
+  int64_t start_micros;
+  int64_t end_micros;
+};
+
+// Collects the spans of the sampled traces of the process. The worker and
+// the servers each export their own spans, joined later by the trace id.
+// The spans are buffered and written as json lines to the export file, or
+// handed to the exporter, when the buffer fills up or every second.
+// PS_TRACE_FILE=<path> sets the export file with the process, a %p in the
+// path is replaced by the pid.
+class Tracer {
+ public:
+  using Exporter = std::function<void(const std::vector<TraceSpan>&)>;
+
+  static Tracer* Instance();
+  ~Tracer();
+
+  // Whether the spans go anywhere, the traces are only started then.
+  bool Enabled() const { return enabled_; }
+  void SetExportFile(const std::string& path);
+  void SetExporter(Exporter exporter);
+  void SetProcessName(const std::string& name);
+
+  // The context of the calling thread.
+  static TraceContext Current();
+  static void SetCurrent(const TraceContext& ctx);
+  // A new non-zero random id.
+  static uint64_t NewId();
+  // A deterministic child id, like the span of the n-th node of a step.
+  static uint64_t ChildId(uint64_t id, uint64_t n);
+  static int64_t NowMicros();
+
+  void Record(const TraceContext& parent, uint64_t span_id,
+              const std::string& category, const std::string& name,
+              int64_t start_micros, int64_t end_micros);
+  void Flush();
+
+  static constexpr size_t kFlushSpans = 4096;
+  static constexpr int64_t kFlushMicros = 1000000;
+
+ private:
+  Tracer();
+  void Export(const std::vector<TraceSpan>& spans);
+
+  std::atomic<bool> enabled_;
+  std::mutex mu_;
+  std::string process_;
+  std::vector<TraceSpan> spans_;
+  int64_t last_flush_;
+  // the export is out of mu_, the exporter may be slow
+  std::mutex export_mu_;
+  FILE* file_;
+  Exporter exporter_;
+};
+
+// Makes ctx the context of the thread in the scope.
+class TraceScope {
+ public:
+  explicit TraceScope(const TraceContext& ctx) : saved_(Tracer::Current()) {
+    Tracer::SetCurrent(ctx);
+  }
+  ~TraceScope() { Tracer::SetCurrent(saved_); }
+
+ private:
+  TraceContext saved_;
+};
+
+// Records the scope as a child span of parent, the thread context by
+// default, and makes it the context in the scope. Nothing is recorded out
+// of a trace.
+class ScopedSpan {
+ public:
+  ScopedSpan(const char* category, const std::string& name)
+    : ScopedSpan(Tracer::Current(), category, name) {}
+  ScopedSpan(const TraceContext& parent, const char* category,
+             const std::string& name);
+  ~ScopedSpan();
+
+  const TraceContext& context() const { return ctx_; }
+
+ private:
+  TraceContext parent_;
+  TraceContext saved_;
+  TraceContext ctx_;
+  const char* category_;
+  std::string name_;
+  int64_t start_micros_;
+};
+
+}  // namespace common
+}  // namespace ps
+
+#endif  // PS_PLUS_COMMON_TRACER_H_
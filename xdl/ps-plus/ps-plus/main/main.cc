@@ -18,8 +18,10 @@ limitations under the License.
 #include "ps-plus/server/server_service.h"
 #include "ps-plus/scheduler/scheduler_impl.h"
 #include "ps-plus/scheduler/placementer.h"
+#include "ps-plus/scheduler/offline_resharder.h"
 
 #include <dlfcn.h>
+#include <cstdlib>
 #include <thread>
 
 int ServerRun(int argc, char** argv) {
@@ -30,6 +32,8 @@ int ServerRun(int argc, char** argv) {
   optParser.addOption("-smsparse", "--streaming_model_sparse", "streaming_model_sparse", "");
   optParser.addOption("-smhash", "--streaming_model_hash", "streaming_model_hash", "");
   optParser.addOption("-bc", "--bind_cores", "bind_cores", ps::OptionParser::OPT_STRING, true);
+  optParser.addOption("-rp", "--replica", "replica", 0);
+  optParser.addOption("-rsm", "--replica_sync_ms", "replica_sync_ms", 100);
   if (!optParser.parseArgs(argc, argv)) {
     LOG(ERROR) << "Parse Server Args Error";
     return -1;
@@ -41,6 +45,8 @@ int ServerRun(int argc, char** argv) {
   std::string streaming_model_sparse;
   std::string streaming_model_hash;
   std::string bind_cores;
+  int replica;
+  int replica_sync_ms;
   
   optParser.getOptionValue("scheduler_kv_path", scheduler_kv_path);
   optParser.getOptionValue("server_id", server_id);
@@ -48,10 +54,13 @@ int ServerRun(int argc, char** argv) {
   optParser.getOptionValue("streaming_model_sparse", streaming_model_sparse);
   optParser.getOptionValue("streaming_model_hash", streaming_model_hash);
   optParser.getOptionValue("bind_cores", bind_cores);
+  optParser.getOptionValue("replica", replica);
+  optParser.getOptionValue("replica_sync_ms", replica_sync_ms);
 
   ps::server::ServerService service(scheduler_kv_path, server_id,
                                     streaming_model_dense, streaming_model_sparse, streaming_model_hash,
-                                    bind_cores == "True" ? true : false);
+                                    bind_cores == "True" ? true : false,
+                                    replica, replica_sync_ms);
   ps::Status st = service.Init();
   if (!st.IsOk()) {
     LOG(ERROR) << "ERROR ON Server Init: " << st.ToString();
@@ -75,6 +84,7 @@ int SchedulerRun(int argc, char** argv) {
   optParser.addOption("-smsparse", "--streaming_model_sparse", "streaming_model_sparse", "");
   optParser.addOption("-smhash", "--streaming_model_hash", "streaming_model_hash", "");
   optParser.addOption("-bc", "--bind_cores", "bind_cores", ps::OptionParser::OPT_STRING, true);
+  optParser.addOption("-srp", "--server_replicas", "server_replicas", 0);
 
   if (!optParser.parseArgs(argc, argv)) {
     LOG(ERROR) << "argument error";
@@ -91,6 +101,7 @@ int SchedulerRun(int argc, char** argv) {
   std::string streaming_model_sparse;
   std::string streaming_model_hash;
   std::string bind_cores;
+  int server_replicas;
 
   optParser.getOptionValue("scheduler_kv_path", scheduler_kv_path);
   optParser.getOptionValue("checkpoint_path", checkpoint_path);
@@ -102,6 +113,7 @@ int SchedulerRun(int argc, char** argv) {
   optParser.getOptionValue("streaming_model_sparse", streaming_model_sparse);
   optParser.getOptionValue("streaming_model_hash", streaming_model_hash);
   optParser.getOptionValue("bind_cores", bind_cores);
+  optParser.getOptionValue("server_replicas", server_replicas);
 
   ps::scheduler::Placementer::Arg placement_arg {
     .net = (size_t)server_network_limit * (1 << 20),
@@ -111,7 +123,8 @@ int SchedulerRun(int argc, char** argv) {
 
   ps::scheduler::SchedulerImpl service(
       server_num, scheduler_kv_path, checkpoint_path, placement_arg,
-      streaming_model_dense, streaming_model_sparse, streaming_model_hash, bind_cores == "True" ? true : false);
+      streaming_model_dense, streaming_model_sparse, streaming_model_hash, bind_cores == "True" ? true : false,
+      server_replicas);
   ps::Status st = service.Start();
   if (!st.IsOk()) {
     LOG(ERROR) << "ERROR ON Server Init: " << st.ToString();
@@ -123,6 +136,62 @@ int SchedulerRun(int argc, char** argv) {
   return 0;
 }
 
+// Reshards a checkpoint to another server count out of the cluster, the
+// placement args are the ones of the scheduler restoring it.
+int ReshardRun(int argc, char** argv) {
+  ps::OptionParser optParser;
+  optParser.addOption("-fp", "--from_path", "from_path", ps::OptionParser::OPT_STRING, true);
+  optParser.addOption("-fc", "--from_checkpoint", "from_checkpoint", "");
+  optParser.addOption("-tp", "--to_path", "to_path", ps::OptionParser::OPT_STRING, true);
+  optParser.addOption("-tc", "--to_checkpoint", "to_checkpoint", ps::OptionParser::OPT_STRING, true);
+  optParser.addOption("-sn", "--server_num", "server_num", ps::OptionParser::OPT_INT32, true);
+  optParser.addOption("-np", "--processes", "processes", 1);
+  optParser.addOption("-snet", "--server_network_limit", "server_network_limit", ps::OptionParser::OPT_INT32, true); //MB/s
+  optParser.addOption("-smem", "--server_memory_limit", "server_memory_limit", ps::OptionParser::OPT_INT32, true); //MB
+  optParser.addOption("-sqps", "--server_query_limit", "server_query_limit", ps::OptionParser::OPT_INT32, true);
+  if (!optParser.parseArgs(argc, argv)) {
+    LOG(ERROR) << "argument error";
+    return -1;
+  }
+
+  ps::scheduler::OfflineResharder::Arg arg;
+  int server_num;
+  int processes;
+  int server_network_limit;
+  int server_memory_limit;
+  int server_query_limit;
+  optParser.getOptionValue("from_path", arg.from_path);
+  optParser.getOptionValue("from_checkpoint", arg.from_checkpoint);
+  optParser.getOptionValue("to_path", arg.to_path);
+  optParser.getOptionValue("to_checkpoint", arg.to_checkpoint);
+  optParser.getOptionValue("server_num", server_num);
+  optParser.getOptionValue("processes", processes);
+  optParser.getOptionValue("server_network_limit", server_network_limit);
+  optParser.getOptionValue("server_memory_limit", server_memory_limit);
+  optParser.getOptionValue("server_query_limit", server_query_limit);
+
+  arg.server_num = server_num;
+  arg.processes = processes;
+  arg.placement_arg = ps::scheduler::Placementer::Arg {
+    .net = (size_t)server_network_limit * (1 << 20),
+    .mem = (size_t)server_memory_limit * (1 << 20),
+    .query = (size_t)server_query_limit
+  };
+  // vp_method selects the placementer like for the scheduler
+  const char* vp_var = std::getenv("vp_method");
+  std::string vp_string = vp_var == nullptr ? "" : vp_var;
+  if (vp_string == "balance") { arg.placementer = ps::GetPlugin<ps::scheduler::Placementer>("Balance"); }
+  else if (vp_string == "locality") { arg.placementer = ps::GetPlugin<ps::scheduler::Placementer>("Locality"); }
+  else { arg.placementer = ps::GetPlugin<ps::scheduler::Placementer>("BalanceV2"); }
+
+  ps::Status st = ps::scheduler::OfflineResharder::Run(arg);
+  if (!st.IsOk()) {
+    LOG(ERROR) << "ERROR ON Reshard: " << st.ToString();
+    return -1;
+  }
+  return 0;
+}
+
 int LoadPlugin(const std::string& name) {
   void* handle = dlopen(name.c_str(), RTLD_NOW | RTLD_GLOBAL);
   if (handle == nullptr) {
@@ -168,8 +237,10 @@ int main(int argc, char** argv) {
     return SchedulerRun(argc, argv);
   } else if (role == "server") {
     return ServerRun(argc, argv);
+  } else if (role == "reshard") {
+    return ReshardRun(argc, argv);
   } else {
-    LOG(ERROR) << "Role must be scheduler or server";
+    LOG(ERROR) << "Role must be scheduler, server or reshard";
     return -1;
   }
 }
@@ -40,6 +40,8 @@ static const int kSchedulerGetNextFile              = 0x00010012;
 static const int kSchedulerReportWorkerState        = 0x00010013;
 static const int kSchedulerRestoreWorkerState       = 0x00010014;
 static const int kSchedulerWorkerBarrierV2          = 0x00010015;
+static const int kSchedulerResizeServers            = 0x00010016;
+static const int kSchedulerGetClusterStats          = 0x00010017;
 
 static const int kServerRegisterUdfChain            = 0x00020001;
 static const int kServerProcess                     = 0x00020002;
@@ -50,6 +52,13 @@ static const int kServerStreamingDenseVarName       = 0x00020006;
 static const int kServerGatherStreamingDenseVar     = 0x00020007;
 static const int kServerTriggerStreamingSparse      = 0x00020008;
 static const int kServerTriggerStreamingHash        = 0x00020009;
+static const int kServerBatchProcess                = 0x0002000a;
+static const int kServerSetReplicas                 = 0x0002000b;
+static const int kServerApplyReplica                = 0x0002000c;
+static const int kServerGetLoad                     = 0x0002000d;
+static const int kServerBumpVersion                 = 0x0002000e;
+static const int kServerTracedProcess               = 0x0002000f;
+static const int kServerGetStats                    = 0x00020010;
 
 static const int kModelServerFlush                  = 0x00030001;
 static const int kModelServerForward                = 0x00030002;
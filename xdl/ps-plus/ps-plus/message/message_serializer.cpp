@@ -39,6 +39,18 @@ DESERIALIZER_REGISTER(ps::serializer::WrapperDataDerializer<ps::DenseVarNames>);
 SERIALIZER_REGISTER(ps::serializer::WrapperDataSerializer<ps::DenseVarValues>);
 DESERIALIZER_REGISTER(ps::serializer::WrapperDataDerializer<ps::DenseVarValues>);
 
+SERIALIZER_REGISTER(ps::serializer::WrapperDataSerializer<ps::ReplicaDelta>);
+DESERIALIZER_REGISTER(ps::serializer::WrapperDataDerializer<ps::ReplicaDelta>);
+
+SERIALIZER_REGISTER(ps::serializer::WrapperDataSerializer<ps::ServerLoad>);
+DESERIALIZER_REGISTER(ps::serializer::WrapperDataDerializer<ps::ServerLoad>);
+
+SERIALIZER_REGISTER(ps::serializer::WrapperDataSerializer<ps::ServerStats>);
+DESERIALIZER_REGISTER(ps::serializer::WrapperDataDerializer<ps::ServerStats>);
+
+SERIALIZER_REGISTER(ps::serializer::WrapperDataSerializer<ps::ClusterStats>);
+DESERIALIZER_REGISTER(ps::serializer::WrapperDataDerializer<ps::ClusterStats>);
+
 SERIALIZER_REGISTER(ps::serializer::WrapperDataSerializer<ps::WorkerState>);
 DESERIALIZER_REGISTER(ps::serializer::WrapperDataDerializer<ps::WorkerState>);
 
@@ -24,6 +24,8 @@ limitations under the License.
 #include "udf_chain_register.h"
 #include "streaming_model_infos.h"
 #include "worker_state.h"
+#include "server_load.h"
+#include "variable_stats.h"
 
 namespace ps {
 namespace serializer {
@@ -38,6 +40,7 @@ ps::Status SerializeHelper::Serialize<ps::ServerInfo>(
   Serialize<ps::Version>(&(si->version_), bufs, mem_guard);
   Serialize<std::string>(&(si->ip_), bufs, mem_guard);
   Serialize<uint16_t>(&(si->port_), bufs, mem_guard);
+  Serialize<size_t>(&(si->replica_), bufs, mem_guard);
   return ps::Status::Ok();
 }
 
@@ -58,6 +61,8 @@ ps::Status SerializeHelper::Deserialize<ps::ServerInfo>(
   *len += field_len;
   Deserialize<uint16_t>(buf + *len, &(si->port_), &field_len, mem_guard);
   *len += field_len;
+  Deserialize<size_t>(buf + *len, &(si->replica_), &field_len, mem_guard);
+  *len += field_len;
   return ps::Status::Ok();
 }
 
@@ -403,6 +408,193 @@ ps::Status SerializeHelper::Deserialize<ps::DenseVarValues>(
   return ps::Status::Ok();
 }
 
+template <>  
+ps::Status SerializeHelper::Serialize<ps::ReplicaDelta>(
+    const ps::ReplicaDelta* value, 
+    std::vector<Fragment>* bufs,
+    MemGuard& mem_guard) {
+  Serialize<size_t>(mem_guard.AllocateElement<size_t>(value->updates.size()), bufs, mem_guard);
+  for (size_t i = 0; i < value->updates.size(); i++) {
+    Serialize<std::string>(&(value->updates[i].name), bufs, mem_guard);
+    Serialize<std::vector<int64_t> >(&(value->updates[i].keys), bufs, mem_guard);
+    Serialize<std::vector<int64_t> >(&(value->updates[i].del_keys), bufs, mem_guard);
+    Serialize<ps::Tensor>(&(value->updates[i].data), bufs, mem_guard);
+  }
+  return ps::Status::Ok();
+}
+
+template <>
+ps::Status SerializeHelper::Deserialize<ps::ReplicaDelta>(
+    const char* buf, 
+    ps::ReplicaDelta* value, 
+    size_t* len,
+    MemGuard& mem_guard) {
+  size_t size;
+  size_t field_len;
+  Deserialize<size_t>(buf, &(size), &field_len, mem_guard);
+  *len = field_len;
+  value->updates.resize(size);
+  for (size_t i = 0; i < size; i++) {
+    Deserialize<std::string>(buf + *len, &(value->updates[i].name), &field_len, mem_guard);
+    *len += field_len;
+    Deserialize<std::vector<int64_t> >(buf + *len, &(value->updates[i].keys), &field_len, mem_guard);
+    *len += field_len;
+    Deserialize<std::vector<int64_t> >(buf + *len, &(value->updates[i].del_keys), &field_len, mem_guard);
+    *len += field_len;
+    Deserialize<ps::Tensor>(buf + *len, &(value->updates[i].data), &field_len, mem_guard);
+    *len += field_len;
+  }
+  return ps::Status::Ok();
+}
+
+template <>  
+ps::Status SerializeHelper::Serialize<ps::ServerLoad>(
+    const ps::ServerLoad* value, 
+    std::vector<Fragment>* bufs,
+    MemGuard& mem_guard) {
+  Serialize<size_t>(&(value->window_micros), bufs, mem_guard);
+  Serialize<size_t>(&(value->cpu_micros), bufs, mem_guard);
+  Serialize<size_t>(mem_guard.AllocateElement<size_t>(value->variables.size()), bufs, mem_guard);
+  for (size_t i = 0; i < value->variables.size(); i++) {
+    Serialize<std::string>(&(value->variables[i].name), bufs, mem_guard);
+    Serialize<size_t>(&(value->variables[i].requests), bufs, mem_guard);
+    Serialize<size_t>(&(value->variables[i].bytes), bufs, mem_guard);
+    Serialize<size_t>(&(value->variables[i].micros), bufs, mem_guard);
+  }
+  return ps::Status::Ok();
+}
+
+template <>
+ps::Status SerializeHelper::Deserialize<ps::ServerLoad>(
+    const char* buf, 
+    ps::ServerLoad* value, 
+    size_t* len,
+    MemGuard& mem_guard) {
+  size_t size;
+  size_t field_len;
+  Deserialize<size_t>(buf, &(value->window_micros), &field_len, mem_guard);
+  *len = field_len;
+  Deserialize<size_t>(buf + *len, &(value->cpu_micros), &field_len, mem_guard);
+  *len += field_len;
+  Deserialize<size_t>(buf + *len, &(size), &field_len, mem_guard);
+  *len += field_len;
+  value->variables.resize(size);
+  for (size_t i = 0; i < size; i++) {
+    Deserialize<std::string>(buf + *len, &(value->variables[i].name), &field_len, mem_guard);
+    *len += field_len;
+    Deserialize<size_t>(buf + *len, &(value->variables[i].requests), &field_len, mem_guard);
+    *len += field_len;
+    Deserialize<size_t>(buf + *len, &(value->variables[i].bytes), &field_len, mem_guard);
+    *len += field_len;
+    Deserialize<size_t>(buf + *len, &(value->variables[i].micros), &field_len, mem_guard);
+    *len += field_len;
+  }
+  return ps::Status::Ok();
+}
+
+template <>  
+ps::Status SerializeHelper::Serialize<ps::VariableStats>(
+    const ps::VariableStats* value, 
+    std::vector<Fragment>* bufs,
+    MemGuard& mem_guard) {
+  Serialize<std::string>(&(value->name), bufs, mem_guard);
+  Serialize<size_t>(&(value->rows), bufs, mem_guard);
+  Serialize<size_t>(&(value->data_bytes), bufs, mem_guard);
+  Serialize<std::vector<std::string> >(&(value->slot_names), bufs, mem_guard);
+  SerializeVec<size_t>(&(value->slot_bytes), bufs, mem_guard);
+  Serialize<size_t>(&(value->hashmap_bytes), bufs, mem_guard);
+  Serialize<size_t>(&(value->pull_rows), bufs, mem_guard);
+  Serialize<size_t>(&(value->pull_bytes), bufs, mem_guard);
+  Serialize<size_t>(&(value->push_rows), bufs, mem_guard);
+  Serialize<size_t>(&(value->push_bytes), bufs, mem_guard);
+  Serialize<size_t>(&(value->micros), bufs, mem_guard);
+  return ps::Status::Ok();
+}
+
+template <>
+ps::Status SerializeHelper::Deserialize<ps::VariableStats>(
+    const char* buf, 
+    ps::VariableStats* value, 
+    size_t* len,
+    MemGuard& mem_guard) {
+  size_t field_len;
+  Deserialize<std::string>(buf, &(value->name), &field_len, mem_guard);
+  *len = field_len;
+  Deserialize<size_t>(buf + *len, &(value->rows), &field_len, mem_guard);
+  *len += field_len;
+  Deserialize<size_t>(buf + *len, &(value->data_bytes), &field_len, mem_guard);
+  *len += field_len;
+  Deserialize<std::vector<std::string> >(buf + *len, &(value->slot_names), &field_len, mem_guard);
+  *len += field_len;
+  value->slot_bytes.clear();
+  DeserializeVec<size_t>(buf + *len, &(value->slot_bytes), &field_len, mem_guard);
+  *len += field_len;
+  Deserialize<size_t>(buf + *len, &(value->hashmap_bytes), &field_len, mem_guard);
+  *len += field_len;
+  Deserialize<size_t>(buf + *len, &(value->pull_rows), &field_len, mem_guard);
+  *len += field_len;
+  Deserialize<size_t>(buf + *len, &(value->pull_bytes), &field_len, mem_guard);
+  *len += field_len;
+  Deserialize<size_t>(buf + *len, &(value->push_rows), &field_len, mem_guard);
+  *len += field_len;
+  Deserialize<size_t>(buf + *len, &(value->push_bytes), &field_len, mem_guard);
+  *len += field_len;
+  Deserialize<size_t>(buf + *len, &(value->micros), &field_len, mem_guard);
+  *len += field_len;
+  return ps::Status::Ok();
+}
+
+template <>  
+ps::Status SerializeHelper::Serialize<ps::ServerStats>(
+    const ps::ServerStats* value, 
+    std::vector<Fragment>* bufs,
+    MemGuard& mem_guard) {
+  Serialize<size_t>(&(value->server_id), bufs, mem_guard);
+  SerializeVec<ps::VariableStats>(&(value->variables), bufs, mem_guard);
+  return ps::Status::Ok();
+}
+
+template <>
+ps::Status SerializeHelper::Deserialize<ps::ServerStats>(
+    const char* buf, 
+    ps::ServerStats* value, 
+    size_t* len,
+    MemGuard& mem_guard) {
+  size_t field_len;
+  Deserialize<size_t>(buf, &(value->server_id), &field_len, mem_guard);
+  *len = field_len;
+  value->variables.clear();
+  DeserializeVec<ps::VariableStats>(buf + *len, &(value->variables), &field_len, mem_guard);
+  *len += field_len;
+  return ps::Status::Ok();
+}
+
+template <>  
+ps::Status SerializeHelper::Serialize<ps::ClusterStats>(
+    const ps::ClusterStats* value, 
+    std::vector<Fragment>* bufs,
+    MemGuard& mem_guard) {
+  SerializeVec<ps::ServerStats>(&(value->servers), bufs, mem_guard);
+  SerializeVec<ps::VariableStats>(&(value->variables), bufs, mem_guard);
+  return ps::Status::Ok();
+}
+
+template <>
+ps::Status SerializeHelper::Deserialize<ps::ClusterStats>(
+    const char* buf, 
+    ps::ClusterStats* value, 
+    size_t* len,
+    MemGuard& mem_guard) {
+  size_t field_len;
+  value->servers.clear();
+  DeserializeVec<ps::ServerStats>(buf, &(value->servers), &field_len, mem_guard);
+  *len = field_len;
+  value->variables.clear();
+  DeserializeVec<ps::VariableStats>(buf + *len, &(value->variables), &field_len, mem_guard);
+  *len += field_len;
+  return ps::Status::Ok();
+}
+
 template <>  
 ps::Status SerializeHelper::Serialize<ps::WorkerState>(
     const ps::WorkerState* ws, 
@@ -33,12 +33,14 @@ class ServerInfo {
              ServerId id, 
              Version version, 
              const std::string& ip, 
-             uint16_t port)
+             uint16_t port,
+             size_t replica = 0)
     : server_type_(server_type)
     , id_(id)
     , version_(version)
     , ip_(ip)
-    , port_(port) {}
+    , port_(port)
+    , replica_(replica) {}
   ServerInfo() = default;
   
   ServerType GetServerType() const noexcept { return server_type_; }
@@ -46,6 +48,8 @@ class ServerInfo {
   Version GetVersion() const noexcept { return version_; }
   const std::string& GetIp() const noexcept { return ip_; }
   uint32_t GetPort() const noexcept { return port_; }
+  // 0 for the primary, 1..n for the read replicas serving the same id
+  size_t GetReplica() const noexcept { return replica_; }
 
   std::string Address() const noexcept {
     return ip_ + ":" + std::to_string(port_);
@@ -53,7 +57,11 @@ class ServerInfo {
 
   std::string ToString() const {
     std::ostringstream os;
-    os << server_type_ << "-" << id_ << " (" << ip_ << ":" << port_ << "@" << version_ << ")";
+    os << server_type_ << "-" << id_;
+    if (replica_ != 0) {
+      os << "#" << replica_;
+    }
+    os << " (" << ip_ << ":" << port_ << "@" << version_ << ")";
     return os.str();
   }
 
@@ -61,7 +69,8 @@ class ServerInfo {
     return (id_ == other.id_
             && version_ == other.version_
             && ip_ == other.ip_
-            && port_ == other.port_);
+            && port_ == other.port_
+            && replica_ == other.replica_);
   }
 
   bool operator!=(const ServerInfo& other) const { return !(*this == other); }
@@ -71,6 +80,7 @@ class ServerInfo {
   Version version_;
   std::string ip_;
   uint16_t port_;
+  size_t replica_ = 0;
 };
 
 } // namespace ps
@@ -0,0 +1,40 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef PS_MESSAGE_SERVER_LOAD_H_
+#define PS_MESSAGE_SERVER_LOAD_H_
+
+#include <vector>
+#include <string>
+
+namespace ps {
+
+// Work a server did since the previous report, the scheduler rebalances
+// variable parts with it.
+struct VariableLoad {
+  std::string name;
+  size_t requests;
+  size_t bytes;
+  size_t micros;
+};
+
+struct ServerLoad {
+  size_t window_micros;
+  size_t cpu_micros;
+  std::vector<VariableLoad> variables;
+};
+
+}
+
+#endif // PS_MESSAGE_SERVER_LOAD_H_
@@ -35,6 +35,20 @@ struct DenseVarValues {
   std::vector<DenseVarValue> values;
 };
 
+// Rows a primary server forwards to its read replicas. A dense variable
+// ships its whole value with empty keys, an index variable the changed
+// global ids and a hash variable the changed keys as flat (x, y) pairs,
+// with one row of data per id or pair.
+struct ReplicaDelta {
+  struct Update {
+    std::string name;
+    std::vector<int64_t> keys;
+    std::vector<int64_t> del_keys;
+    Tensor data;
+  };
+  std::vector<Update> updates;
+};
+
 } // namespace ps
 
 #endif // PS_COMMON_STREAMING_MODEL_INFO_
@@ -19,5 +19,17 @@ namespace ps {
 
 const std::string VariableInfo::ORIGIN_FILE_PATH = "origin_file_path";
 const std::string VariableInfo::ORIGIN_NAME = "oname";
+const std::string VariableInfo::INCREMENTAL_CHECKPOINT = "incremental_checkpoint";
+const std::string VariableInfo::CHECKPOINT_COMPRESSION = "checkpoint_compression";
+const std::string VariableInfo::HASH_CACHE_CAPACITY = "hash_cache_capacity";
+const std::string VariableInfo::HASH_CACHE_STALENESS = "hash_cache_staleness";
+const std::string VariableInfo::GRADIENT_CODEC = "gradient_codec";
+const std::string VariableInfo::GRADIENT_ACCUMULATE_STEPS = "gradient_accumulate_steps";
+const std::string VariableInfo::GRADIENT_ACCUMULATE_BYTES = "gradient_accumulate_bytes";
+const std::string VariableInfo::GRADIENT_ACCUMULATE_MEAN = "gradient_accumulate_mean";
+const std::string VariableInfo::HOT_ID_REPLICAS = "hot_id_replicas";
+const std::string VariableInfo::HOT_ID_RATIO = "hot_id_ratio";
+const std::string VariableInfo::HOT_ID_CAPACITY = "hot_id_capacity";
+const std::string VariableInfo::PLACEMENT_GROUP = "placement_group";
 
 }
@@ -47,6 +47,18 @@ struct VariableInfo {
 
   static const std::string ORIGIN_FILE_PATH;
   static const std::string ORIGIN_NAME;
+  static const std::string INCREMENTAL_CHECKPOINT;
+  static const std::string CHECKPOINT_COMPRESSION;
+  static const std::string HASH_CACHE_CAPACITY;
+  static const std::string HASH_CACHE_STALENESS;
+  static const std::string GRADIENT_CODEC;
+  static const std::string GRADIENT_ACCUMULATE_STEPS;
+  static const std::string GRADIENT_ACCUMULATE_BYTES;
+  static const std::string GRADIENT_ACCUMULATE_MEAN;
+  static const std::string HOT_ID_REPLICAS;
+  static const std::string HOT_ID_RATIO;
+  static const std::string HOT_ID_CAPACITY;
+  static const std::string PLACEMENT_GROUP;
 };
 
 struct VariableInfoCollection {
@@ -0,0 +1,70 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "variable_stats.h"
+
+#include <algorithm>
+#include <map>
+
+namespace ps {
+
+size_t VariableStats::TotalBytes() const {
+  size_t total = data_bytes + hashmap_bytes;
+  for (size_t bytes : slot_bytes) {
+    total += bytes;
+  }
+  return total;
+}
+
+double VariableStats::Rate(size_t count) const {
+  return micros == 0 ? 0 : count * 1000000.0 / micros;
+}
+
+void ClusterStats::Aggregate() {
+  std::map<std::string, VariableStats> sums;
+  for (auto& server : servers) {
+    for (auto& item : server.variables) {
+      auto iter = sums.find(item.name);
+      if (iter == sums.end()) {
+        sums[item.name] = item;
+        continue;
+      }
+      VariableStats& sum = iter->second;
+      sum.rows += item.rows;
+      sum.data_bytes += item.data_bytes;
+      sum.hashmap_bytes += item.hashmap_bytes;
+      for (size_t i = 0; i < item.slot_names.size(); i++) {
+        auto slot = std::find(sum.slot_names.begin(), sum.slot_names.end(), item.slot_names[i]);
+        if (slot == sum.slot_names.end()) {
+          sum.slot_names.push_back(item.slot_names[i]);
+          sum.slot_bytes.push_back(item.slot_bytes[i]);
+        } else {
+          sum.slot_bytes[slot - sum.slot_names.begin()] += item.slot_bytes[i];
+        }
+      }
+      sum.pull_rows += item.pull_rows;
+      sum.pull_bytes += item.pull_bytes;
+      sum.push_rows += item.push_rows;
+      sum.push_bytes += item.push_bytes;
+      sum.micros = std::max(sum.micros, item.micros);
+    }
+  }
+  variables.clear();
+  for (auto& item : sums) {
+    variables.push_back(item.second);
+  }
+}
+
+}
@@ -0,0 +1,62 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_MESSAGE_VARIABLE_STATS_H_
+#define PS_MESSAGE_VARIABLE_STATS_H_
+
+#include <vector>
+#include <string>
+
+namespace ps {
+
+// The memory and the traffic of a variable on a server. The traffic is
+// counted since the variable was created or restored on the server, micros
+// ago, the rates of a window are the difference of two reports.
+struct VariableStats {
+  std::string name;
+  size_t rows;
+  size_t data_bytes;
+  std::vector<std::string> slot_names;
+  std::vector<size_t> slot_bytes;
+  // the keys and the tables of hash variables
+  size_t hashmap_bytes;
+  size_t pull_rows;
+  size_t pull_bytes;
+  size_t push_rows;
+  size_t push_bytes;
+  size_t micros;
+
+  size_t TotalBytes() const;
+  // per second over micros
+  double Rate(size_t count) const;
+};
+
+struct ServerStats {
+  size_t server_id;
+  std::vector<VariableStats> variables;
+};
+
+// The stats of the servers and their sum by variable, micros is the
+// longest of the servers.
+struct ClusterStats {
+  std::vector<ServerStats> servers;
+  std::vector<VariableStats> variables;
+
+  void Aggregate();
+};
+
+}
+
+#endif // PS_MESSAGE_VARIABLE_STATS_H_
@@ -32,6 +32,7 @@ class BackwardCache {
  public:
   using Callback = std::function<void(Status)>;
   using BackwardRun = std::function<void(Tensor, Tensor, Callback)>;
+  virtual ~BackwardCache() {}
   virtual Status Init(BackwardRun factory, const std::unordered_map<std::string, std::string>& map) = 0;
   virtual void Calc(Tensor ids, Tensor grads, Callback cb) = 0;
   virtual Status Flush() = 0;
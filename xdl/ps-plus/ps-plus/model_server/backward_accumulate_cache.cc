@@ -0,0 +1,277 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/model_server/backward.h"
+#include "ps-plus/common/initializer/none_initializer.h"
+#include "ps-plus/common/qrw_lock.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace ps {
+namespace modelserver {
+
+// Sums the gradients of the same id over many requests and runs backward
+// on the sums once flush_count requests or flush_rows distinct ids are in,
+// the oldest request waited flush_ms, or Flush is called. Requests are
+// answered with the status of the run that applied their gradients.
+//   flush_count: requests per run, default 16
+//   flush_rows: distinct ids per run, default 0 for no limit
+//   flush_ms: max wait of a request, default 100, 0 for no timer
+class BackwardAccumulateCache : public BackwardCache {
+ public:
+  BackwardAccumulateCache() : table_(new Table), oldest_(0), stop_(false) {}
+  ~BackwardAccumulateCache() {
+    {
+      std::unique_lock<std::mutex> lock(timer_mu_);
+      stop_ = true;
+    }
+    timer_cv_.notify_all();
+    if (timer_.joinable()) {
+      timer_.join();
+    }
+    for (auto&& cb : table_->cb) {
+      cb(Status::NetworkError("BackwardAccumulateCache: Server is reset"));
+    }
+  }
+  Status Init(BackwardRun backward, const std::unordered_map<std::string, std::string>& map) override {
+    flush_count_ = GetArg(map, "flush_count", 16);
+    flush_rows_ = GetArg(map, "flush_rows", 0);
+    flush_us_ = GetArg(map, "flush_ms", 100) * 1000;
+    PS_CHECK_BOOL(flush_count_ > 0 && flush_rows_ >= 0 && flush_us_ >= 0,
+                  Status::ArgumentError("BackwardAccumulateCache: flush_count should be positive"));
+    backward_ = backward;
+    if (flush_us_ > 0) {
+      timer_ = std::thread(&BackwardAccumulateCache::TimerLoop, this);
+    }
+    return Status::Ok();
+  }
+  void Calc(Tensor ids, Tensor grads, Callback cb) override {
+    std::vector<size_t> id_dims = ids.Shape().Dims();
+    std::vector<size_t> grad_dims = grads.Shape().Dims();
+    if (id_dims.size() != 1) {
+      cb(Status::ArgumentError("BackwardAccumulateCache: ids should be rank-1"));
+      return;
+    }
+    if (ids.Type() != DataType::kInt64) {
+      cb(Status::ArgumentError("BackwardAccumulateCache: ids should be int64"));
+      return;
+    }
+    if (grad_dims.size() == 0) {
+      cb(Status::ArgumentError("BackwardAccumulateCache: grads should not be rank-0"));
+      return;
+    }
+    if (grad_dims[0] != id_dims[0]) {
+      cb(Status::ArgumentError("BackwardAccumulateCache: grads.dim[0] should be equal to ids"));
+      return;
+    }
+    Table* full = nullptr;
+    {
+      QRWLocker lock(table_lock_, QRWLocker::kSimpleRead);
+      Table* table = table_.get();
+      size_t calls;
+      {
+        std::unique_lock<std::mutex> meta_lock(table->mu);
+        if (table->inited) {
+          bool match = grad_dims.size() == table->grad_dims.size() && grads.Type() == table->grad_type;
+          for (size_t i = 1; match && i < grad_dims.size(); i++) {
+            match = grad_dims[i] == table->grad_dims[i];
+          }
+          if (!match) {
+            cb(Status::ArgumentError("BackwardAccumulateCache: grad shape or type mismatch to other worker"));
+            return;
+          }
+        } else {
+          table->grad_dims = grad_dims;
+          table->grad_type = grads.Type();
+          table->inited = true;
+        }
+        table->cb.push_back(cb);
+        calls = table->cb.size();
+        if (calls == 1) {
+          oldest_ = NowUs();
+          timer_cv_.notify_all();
+        }
+      }
+      // every shard is locked once per request
+      std::vector<int64_t> offsets[kShardNum];
+      int64_t* id_ptr = ids.Raw<int64_t>();
+      for (size_t i = 0; i < id_dims[0]; i++) {
+        offsets[Shard::Index(id_ptr[i])].push_back(i);
+      }
+      size_t block = grad_dims[0] == 0 ? 0 : grads.Shape().NumElements() / grad_dims[0];
+      size_t rows = 0;
+      for (size_t s = 0; s < kShardNum; s++) {
+        if (offsets[s].empty()) {
+          continue;
+        }
+        Shard& shard = table->shards[s];
+        std::unique_lock<std::mutex> shard_lock(shard.mu);
+        CASES(grads.Type(), {
+          for (auto i : offsets[s]) {
+            int64_t uniq_id;
+            auto iter = shard.uniq_map.find(id_ptr[i]);
+            if (iter == shard.uniq_map.end()) {
+              uniq_id = shard.id_buffer.size();
+              shard.uniq_map[id_ptr[i]] = uniq_id;
+              shard.id_buffer.push_back(id_ptr[i]);
+              shard.grad_buffer.resize(shard.grad_buffer.size() + sizeof(T) * block, 0);
+              rows = ++table->rows;
+            } else {
+              uniq_id = iter->second;
+            }
+            T* buffer = (T*)(void*)&shard.grad_buffer[0] + uniq_id * block;
+            T* src_buffer = grads.Raw<T>() + i * block;
+            for (size_t k = 0; k < block; k++) {
+              *buffer++ += *src_buffer++;
+            }
+          }
+        });
+      }
+      if (calls >= (size_t)flush_count_ || (flush_rows_ > 0 && rows >= (size_t)flush_rows_)) {
+        full = table;
+      }
+    }
+    if (full != nullptr) {
+      Table* process = Swap(full);
+      if (process != nullptr) {
+        Process(process);
+      }
+    }
+  }
+  Status Flush() override {
+    Table* process = Swap(nullptr);
+    if (process != nullptr) {
+      Process(process);
+    }
+    return Status::Ok();
+  }
+ private:
+  static constexpr size_t kShardNum = 16;
+
+  struct Shard {
+    // the top 4 bits of a fibonacci hash
+    static size_t Index(int64_t id) {
+      return (uint64_t)id * 0x9E3779B97F4A7C15ull >> 60;
+    }
+    std::mutex mu;
+    std::unordered_map<int64_t, int64_t> uniq_map;
+    std::vector<int64_t> id_buffer;
+    std::vector<char> grad_buffer;
+  };
+
+  struct Table {
+    Table() : inited(false), rows(0) {}
+    Shard shards[kShardNum];
+    std::mutex mu;
+    bool inited;
+    DataType grad_type;
+    std::vector<size_t> grad_dims;
+    std::vector<Callback> cb;
+    std::atomic<size_t> rows;
+    std::vector<int64_t> id_buffer;
+    std::vector<char> grad_buffer;
+  };
+
+  static int64_t GetArg(const std::unordered_map<std::string, std::string>& map,
+                        const std::string& key, int64_t def) {
+    auto iter = map.find(key);
+    return iter == map.end() ? def : atoll(iter->second.c_str());
+  }
+
+  static int64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  // Takes the table out if it is still expected, or any non empty table
+  // when expected is null.
+  Table* Swap(Table* expected) {
+    QRWLocker lock(table_lock_, QRWLocker::kWrite);
+    if (expected == nullptr ? table_->cb.empty() : table_.get() != expected) {
+      return nullptr;
+    }
+    oldest_ = 0;
+    Table* table = table_.release();
+    table_.reset(new Table);
+    return table;
+  }
+
+  void Process(Table* table) {
+    if (table->rows == 0) {
+      for (auto&& item : table->cb) {
+        item(Status::Ok());
+      }
+      delete table;
+      return;
+    }
+    for (auto& shard : table->shards) {
+      table->id_buffer.insert(table->id_buffer.end(), shard.id_buffer.begin(), shard.id_buffer.end());
+      table->grad_buffer.insert(table->grad_buffer.end(), shard.grad_buffer.begin(), shard.grad_buffer.end());
+      std::vector<int64_t>().swap(shard.id_buffer);
+      std::vector<char>().swap(shard.grad_buffer);
+    }
+    Tensor ids(DataType::kInt64, TensorShape({table->id_buffer.size()}), (char*)(void*)table->id_buffer.data(), new initializer::NoneInitializer);
+    table->grad_dims[0] = table->id_buffer.size();
+    Tensor grads(table->grad_type, TensorShape(table->grad_dims), table->grad_buffer.data(), new initializer::NoneInitializer);
+    backward_(ids, grads, [table](Status st){
+      for (auto&& item : table->cb) {
+        item(st);
+      }
+      delete table;
+    });
+  }
+
+  void TimerLoop() {
+    std::unique_lock<std::mutex> lock(timer_mu_);
+    while (!stop_) {
+      int64_t oldest = oldest_;
+      int64_t wait = oldest == 0 ? flush_us_ : oldest + flush_us_ - NowUs();
+      if (wait > 0) {
+        timer_cv_.wait_for(lock, std::chrono::microseconds(wait));
+        continue;
+      }
+      lock.unlock();
+      Table* process = Swap(nullptr);
+      if (process != nullptr) {
+        Process(process);
+      }
+      lock.lock();
+    }
+  }
+
+  BackwardRun backward_;
+  int64_t flush_count_;
+  int64_t flush_rows_;
+  int64_t flush_us_;
+
+  QRWLock table_lock_;
+  std::unique_ptr<Table> table_;
+  std::atomic<int64_t> oldest_;
+
+  std::mutex timer_mu_;
+  std::condition_variable timer_cv_;
+  std::thread timer_;
+  bool stop_;
+};
+
+BACKWARD_REGISTER(BackwardAccumulateCache, accumulate_cache);
+
+}
+}
@@ -32,6 +32,7 @@ class ForwardCache {
  public:
   using Callback = std::function<void(Status, Tensor)>;
   using ForwardRun = std::function<void(Tensor, Callback)>;
+  virtual ~ForwardCache() {}
   virtual Status Init(ForwardRun factory, const std::unordered_map<std::string, std::string>& map) = 0;
   virtual void Calc(Tensor ids, Callback cb) = 0;
   virtual Status Flush() = 0;
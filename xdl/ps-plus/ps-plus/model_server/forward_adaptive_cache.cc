@@ -0,0 +1,482 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/model_server/forward.h"
+#include "ps-plus/common/initializer/none_initializer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace ps {
+namespace modelserver {
+
+// Keeps the computed rows in a LRU cache with a ttl, dedupes the missed ids
+// against the window being collected and the batches already running, and
+// closes a window once the requests expected to arrive within the latency
+// budget are in or the budget is spent.
+//   window_size: max requests per batch, default 64
+//   slo_ms: latency budget of a request, default 10, 0 never waits
+//   cache_size: max cached rows, default 1048576, 0 disables the cache
+//   ttl_ms: lifetime of a cached row, default 0 for no expiry
+//   batch_size: max ids per batch, a request is split across batches past
+//     it, default 0 for no limit
+//   pad_batch: 1 pads every batch to batch_size ids with its last id, for
+//     the predictors compiled for a fixed batch, default 0
+//   max_inflight: max batches running at once, the window keeps collecting
+//     while all of them run, default 0 for no limit
+class ForwardAdaptiveCache : public ForwardCache {
+ public:
+  ForwardAdaptiveCache()
+    : stop_(false), window_(new Batch), generation_(0), target_(1), deadline_(0), inflight_(0),
+      last_arrival_(0), interarrival_us_(-1), forward_us_(0), block_(0) {}
+  ~ForwardAdaptiveCache() {
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    if (timer_.joinable()) {
+      timer_.join();
+    }
+  }
+  Status Init(ForwardRun forward, const std::unordered_map<std::string, std::string>& map) override {
+    window_size_ = GetArg(map, "window_size", 64);
+    slo_us_ = GetArg(map, "slo_ms", 10) * 1000;
+    cache_size_ = GetArg(map, "cache_size", 1 << 20);
+    ttl_us_ = GetArg(map, "ttl_ms", 0) * 1000;
+    batch_size_ = GetArg(map, "batch_size", 0);
+    pad_batch_ = GetArg(map, "pad_batch", 0) != 0;
+    max_inflight_ = GetArg(map, "max_inflight", 0);
+    PS_CHECK_BOOL(window_size_ > 0 && slo_us_ >= 0 && cache_size_ >= 0 && ttl_us_ >= 0 &&
+                  batch_size_ >= 0 && max_inflight_ >= 0,
+                  Status::ArgumentError("ForwardAdaptiveCache: arguments should not be negative"));
+    PS_CHECK_BOOL(!pad_batch_ || batch_size_ > 0,
+                  Status::ArgumentError("ForwardAdaptiveCache: pad_batch needs batch_size"));
+    forward_ = forward;
+    timer_ = std::thread(&ForwardAdaptiveCache::TimerLoop, this);
+    return Status::Ok();
+  }
+  void Calc(Tensor ids, Callback cb) override {
+    if (ids.Shape().Size() != 1) {
+      cb(Status::ArgumentError("ForwardAdaptiveCache: ids should be rank-1"), ps::Tensor());
+      return;
+    }
+    if (ids.Type() != DataType::kInt64) {
+      cb(Status::ArgumentError("ForwardAdaptiveCache: ids should be int64"), ps::Tensor());
+      return;
+    }
+    std::shared_ptr<Request> req(new Request);
+    req->cb = cb;
+    req->size = ids.Shape().NumElements();
+    req->missed = 0;
+    std::vector<Batch*> process;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      int64_t now = NowUs();
+      Arrive(now);
+      bool joined = false;
+      for (size_t i = 0; i < req->size; i++) {
+        int64_t id = ids.Raw<int64_t>()[i];
+        if (ReadCache(id, now, req.get(), i)) {
+          continue;
+        }
+        auto iter = pending_.find(id);
+        if (iter == pending_.end()) {
+          int64_t uniq_id = window_->ids.size();
+          window_->ids.push_back(id);
+          iter = pending_.emplace(id, std::make_pair(window_.get(), uniq_id)).first;
+        }
+        iter->second.first->waiters.push_back(Waiter{req, (int64_t)i, iter->second.second});
+        joined |= iter->second.first == window_.get();
+        req->missed++;
+        if (batch_size_ > 0 && window_->ids.size() >= (size_t)batch_size_) {
+          // the rest of the request goes to the next window
+          if (window_->requests++ == 0) {
+            OpenWindow(now);
+          }
+          Launch(CloseWindow(now), &process);
+          joined = false;
+        }
+      }
+      if (joined && window_->requests++ == 0) {
+        OpenWindow(now);
+      }
+      if (joined && window_->requests >= target_ && !Busy()) {
+        Launch(CloseWindow(now), &process);
+      }
+      if (req->missed == 0 && !req->rst.Initialized() && !dims_.empty()) {
+        dims_[0] = 0;
+        req->rst = Tensor(type_, TensorShape(dims_), new initializer::NoneInitializer);
+      }
+    }
+    if (req->missed == 0) {
+      cb(Status::Ok(), req->rst);
+    }
+    for (auto batch : process) {
+      Process(batch);
+    }
+  }
+  Status Flush() override {
+    std::unique_ptr<Batch> window;
+    std::vector<std::unique_ptr<Batch>> ready;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      generation_++;
+      lru_.clear();
+      cache_.clear();
+      free_slots_.clear();
+      slots_.clear();
+      chunks_.clear();
+      dims_.clear();
+      window.reset(window_.release());
+      window_.reset(new Batch);
+      for (auto id : window->ids) {
+        pending_.erase(id);
+      }
+      for (auto batch : ready_) {
+        ready.emplace_back(batch);
+        for (auto id : batch->ids) {
+          pending_.erase(id);
+        }
+      }
+      ready_.clear();
+    }
+    Finish(window.get(), Status::NetworkError("ForwardAdaptiveCache: Server is reset"), Tensor());
+    for (auto& batch : ready) {
+      Finish(batch.get(), Status::NetworkError("ForwardAdaptiveCache: Server is reset"), Tensor());
+    }
+    return Status::Ok();
+  }
+ private:
+  struct Request {
+    std::mutex mu;
+    Callback cb;
+    size_t size;
+    size_t missed;
+    Status st;
+    Tensor rst;
+  };
+
+  struct Waiter {
+    std::shared_ptr<Request> req;
+    int64_t req_offset;
+    int64_t uniq_id;
+  };
+
+  struct Batch {
+    Batch() : requests(0) {}
+    std::vector<int64_t> ids;
+    std::vector<Waiter> waiters;
+    size_t requests;
+    int64_t generation;
+    int64_t start;
+  };
+
+  struct CacheNode {
+    size_t slot;
+    int64_t timestamp;
+    std::list<int64_t>::iterator lru;
+  };
+
+  static int64_t GetArg(const std::unordered_map<std::string, std::string>& map,
+                        const std::string& key, int64_t def) {
+    auto iter = map.find(key);
+    return iter == map.end() ? def : atoll(iter->second.c_str());
+  }
+
+  static int64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  static void Ewma(int64_t* avg, int64_t sample) {
+    *avg = *avg < 0 ? sample : (*avg * 4 + sample) / 5;
+  }
+
+  void Arrive(int64_t now) {
+    if (last_arrival_ > 0) {
+      Ewma(&interarrival_us_, now - last_arrival_);
+    }
+    last_arrival_ = now;
+  }
+
+  // The part of the budget the forward run doesn't use is spent waiting,
+  // as long as more than one request is expected to arrive meanwhile.
+  void OpenWindow(int64_t now) {
+    int64_t wait = std::max<int64_t>(slo_us_ - forward_us_, 0);
+    int64_t expected = 1;
+    if (interarrival_us_ >= 0) {
+      expected = interarrival_us_ == 0 ? window_size_ : wait / interarrival_us_;
+    }
+    target_ = std::max<int64_t>(std::min<int64_t>(expected, window_size_), 1);
+    deadline_ = now + wait;
+    cv_.notify_all();
+  }
+
+  Batch* CloseWindow(int64_t now) {
+    Batch* batch = window_.release();
+    window_.reset(new Batch);
+    batch->generation = generation_;
+    batch->start = now;
+    return batch;
+  }
+
+  bool Busy() {
+    return max_inflight_ > 0 && inflight_ >= max_inflight_;
+  }
+
+  // Adds batch to process if a run is free, it waits in ready_ otherwise
+  void Launch(Batch* batch, std::vector<Batch*>* process) {
+    if (Busy()) {
+      ready_.push_back(batch);
+      return;
+    }
+    inflight_++;
+    process->push_back(batch);
+  }
+
+  char* Slot(size_t slot) {
+    return chunks_[slot / kChunkSize].get() + (slot % kChunkSize) * block_;
+  }
+
+  bool ReadCache(int64_t id, int64_t now, Request* req, size_t offset) {
+    auto iter = cache_.find(id);
+    if (iter == cache_.end()) {
+      return false;
+    }
+    if (ttl_us_ > 0 && iter->second.timestamp + ttl_us_ < now) {
+      free_slots_.push_back(iter->second.slot);
+      lru_.erase(iter->second.lru);
+      cache_.erase(iter);
+      return false;
+    }
+    lru_.splice(lru_.begin(), lru_, iter->second.lru);
+    if (!req->rst.Initialized()) {
+      dims_[0] = req->size;
+      req->rst = Tensor(type_, TensorShape(dims_), new initializer::NoneInitializer);
+    }
+    memcpy(req->rst.Raw<char>() + offset * block_, Slot(iter->second.slot), block_);
+    return true;
+  }
+
+  Status AddCache(const std::vector<int64_t>& ids, Tensor rst, int64_t now) {
+    std::vector<size_t> dims = rst.Shape().Dims();
+    size_t block = dims[0] == 0 ? 0 : rst.Shape().NumElements() / dims[0] * SizeOfType(rst.Type());
+    if (!dims_.empty()) {
+      if (dims.size() != dims_.size() || rst.Type() != type_) {
+        return Status::ArgumentError("Result dim mismatch to cache");
+      }
+      for (size_t i = 1; i < dims.size(); i++) {
+        if (dims[i] != dims_[i]) {
+          return Status::ArgumentError("Result dim mismatch to cache " + std::to_string(i));
+        }
+      }
+    } else {
+      dims_ = dims;
+      type_ = rst.Type();
+      block_ = block;
+    }
+    if (cache_size_ == 0) {
+      return Status::Ok();
+    }
+    for (size_t i = 0; i < ids.size(); i++) {
+      size_t slot;
+      auto iter = cache_.find(ids[i]);
+      if (iter != cache_.end()) {
+        slot = iter->second.slot;
+        lru_.erase(iter->second.lru);
+      } else if (!free_slots_.empty()) {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+      } else if (slots_.size() < (size_t)cache_size_) {
+        slot = slots_.size();
+        slots_.push_back(slot);
+        if (slot % kChunkSize == 0) {
+          chunks_.emplace_back(new char[block_ * kChunkSize]);
+        }
+      } else {
+        auto victim = cache_.find(lru_.back());
+        slot = victim->second.slot;
+        cache_.erase(victim);
+        lru_.pop_back();
+      }
+      lru_.push_front(ids[i]);
+      cache_[ids[i]] = CacheNode{.slot = slot, .timestamp = now, .lru = lru_.begin()};
+      memcpy(Slot(slot), rst.Raw<char>() + i * block_, block_);
+    }
+    return Status::Ok();
+  }
+
+  void Process(Batch* batch) {
+    size_t size = batch->ids.size();
+    Tensor t(DataType::kInt64, TensorShape({size}), (char*)(void*)&batch->ids[0], new initializer::NoneInitializer);
+    if (pad_batch_ && size < (size_t)batch_size_) {
+      // the padded rows are never read
+      size = batch_size_;
+      t = Tensor(DataType::kInt64, TensorShape({size}), new initializer::NoneInitializer);
+      memcpy(t.Raw<int64_t>(), &batch->ids[0], batch->ids.size() * sizeof(int64_t));
+      std::fill(t.Raw<int64_t>() + batch->ids.size(), t.Raw<int64_t>() + size, batch->ids.back());
+    }
+    forward_(t, [batch, size, this](Status st, Tensor rst){
+      std::unique_ptr<Batch> deleter(batch);
+      std::vector<size_t> dims;
+      if (st.IsOk()) {
+        dims = rst.Shape().Dims();
+      }
+      if (st.IsOk() && dims.empty()) {
+        st = Status::ArgumentError("Result should not be scalar");
+      }
+      if (st.IsOk() && dims[0] != size) {
+        st = Status::ArgumentError("Result dim0 should be id size");
+      }
+      Batch* next = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(mu_);
+        int64_t now = NowUs();
+        inflight_--;
+        if (!ready_.empty()) {
+          next = ready_.front();
+          ready_.pop_front();
+          next->start = now;
+          inflight_++;
+        } else if (max_inflight_ > 0 && window_->requests > 0 &&
+                   (window_->requests >= target_ || now >= deadline_)) {
+          // the window kept collecting while the runs were busy
+          next = CloseWindow(now);
+          inflight_++;
+        }
+        cv_.notify_all();
+        Ewma(&forward_us_, now - batch->start);
+        if (st.IsOk() && batch->generation == generation_) {
+          st = AddCache(batch->ids, rst, now);
+        }
+        for (auto id : batch->ids) {
+          auto iter = pending_.find(id);
+          if (iter != pending_.end() && iter->second.first == batch) {
+            pending_.erase(iter);
+          }
+        }
+      }
+      Finish(batch, st, rst);
+      if (next != nullptr) {
+        Process(next);
+      }
+    });
+  }
+
+  void Finish(Batch* batch, Status st, Tensor rst) {
+    size_t block = 0;
+    std::vector<size_t> dims;
+    if (st.IsOk()) {
+      dims = rst.Shape().Dims();
+      block = dims[0] == 0 ? 0 : rst.Shape().NumElements() / dims[0] * SizeOfType(rst.Type());
+    }
+    for (auto& waiter : batch->waiters) {
+      Request* req = waiter.req.get();
+      bool done;
+      {
+        std::unique_lock<std::mutex> lock(req->mu);
+        if (!st.IsOk()) {
+          req->st = st;
+        } else if (req->st.IsOk()) {
+          if (!req->rst.Initialized()) {
+            dims[0] = req->size;
+            req->rst = Tensor(rst.Type(), TensorShape(dims), new initializer::NoneInitializer);
+          }
+          memcpy(req->rst.Raw<char>() + waiter.req_offset * block, rst.Raw<char>() + waiter.uniq_id * block, block);
+        }
+        done = --req->missed == 0;
+      }
+      if (done) {
+        req->cb(req->st, req->st.IsOk() ? req->rst : Tensor());
+      }
+    }
+  }
+
+  void TimerLoop() {
+    std::unique_lock<std::mutex> lock(mu_);
+    while (!stop_) {
+      if (window_->requests == 0) {
+        cv_.wait(lock);
+        continue;
+      }
+      int64_t now = NowUs();
+      if (now < deadline_) {
+        cv_.wait_for(lock, std::chrono::microseconds(deadline_ - now));
+        continue;
+      }
+      // the window is closed by the next free run
+      if (Busy()) {
+        cv_.wait(lock);
+        continue;
+      }
+      inflight_++;
+      Batch* batch = CloseWindow(now);
+      lock.unlock();
+      Process(batch);
+      lock.lock();
+    }
+  }
+
+  static constexpr size_t kChunkSize = 1024;
+  ForwardRun forward_;
+  int64_t window_size_;
+  int64_t slo_us_;
+  int64_t cache_size_;
+  int64_t ttl_us_;
+  int64_t batch_size_;
+  bool pad_batch_;
+  int64_t max_inflight_;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::thread timer_;
+  bool stop_;
+
+  std::unique_ptr<Batch> window_;
+  std::unordered_map<int64_t, std::pair<Batch*, int64_t>> pending_;
+  int64_t generation_;
+  // the requests a window closes at, at least 1
+  size_t target_;
+  int64_t deadline_;
+  int64_t inflight_;
+  // the batches closed while max_inflight of them run
+  std::deque<Batch*> ready_;
+
+  int64_t last_arrival_;
+  int64_t interarrival_us_;
+  int64_t forward_us_;
+
+  std::list<int64_t> lru_;
+  std::unordered_map<int64_t, CacheNode> cache_;
+  std::vector<size_t> slots_;
+  std::vector<size_t> free_slots_;
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  std::vector<size_t> dims_;
+  DataType type_;
+  size_t block_;
+};
+
+FORWARD_REGISTER(ForwardAdaptiveCache, adaptive_cache);
+
+}
+}
@@ -13,6 +13,12 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+
 #include "gtest/gtest.h"
 #include "ps-plus/common/tensor.h"
 #include "ps-plus/model_server/backward.h"
@@ -134,3 +140,147 @@ TEST(BackwardUniqueCacheTest, BackwardUniqueCache) {
   }
 
 }
+
+namespace {
+
+// sums the gradients each run gets per id, grads are {n, 2} floats
+struct BackwardRecorder {
+  std::mutex mu;
+  int runs = 0;
+  std::map<int64_t, float> sum;
+  std::vector<BackwardCache::Callback> cbs;
+  bool async = false;
+
+  BackwardCache::BackwardRun Run() {
+    return [this](Tensor ids, Tensor grads, BackwardCache::Callback cb) {
+      {
+        std::unique_lock<std::mutex> lock(mu);
+        runs++;
+        for (size_t i = 0; i < ids.Shape().NumElements(); i++) {
+          EXPECT_EQ(grads.Raw<float>()[i * 2], grads.Raw<float>()[i * 2 + 1]);
+          sum[ids.Raw<int64_t>()[i]] += grads.Raw<float>()[i * 2];
+        }
+        if (async) {
+          cbs.push_back(cb);
+          return;
+        }
+      }
+      cb(Status::Ok());
+    };
+  }
+};
+
+void Push(BackwardCache* cache, const std::vector<int64_t>& ids, float grad, BackwardCache::Callback cb) {
+  Tensor t(DataType::kInt64, TensorShape({ids.size()}), new ConstantInitializer(0));
+  for (size_t i = 0; i < ids.size(); i++) {
+    t.Raw<int64_t>()[i] = ids[i];
+  }
+  Tensor grads(DataType::kFloat, TensorShape({ids.size(), 2}), new ConstantInitializer(grad));
+  cache->Calc(t, grads, cb);
+}
+
+}
+
+TEST(BackwardAccumulateCacheTest, FlushCount) {
+  BackwardRecorder recorder;
+  std::unique_ptr<BackwardCache> cache;
+  ASSERT_TRUE(BackwardCache::Get(recorder.Run(), "name=accumulate_cache&flush_count=3&flush_ms=0", &cache).IsOk());
+  int done = 0;
+  auto cb = [&](Status st) { EXPECT_TRUE(st.IsOk()); done++; };
+  Push(cache.get(), {1, 2, 1}, 1, cb);
+  Push(cache.get(), {2, 3}, 2, cb);
+  EXPECT_EQ(0, recorder.runs);
+  EXPECT_EQ(0, done);
+  Push(cache.get(), {1}, 4, cb);
+  EXPECT_EQ(1, recorder.runs);
+  EXPECT_EQ(3, done);
+  EXPECT_EQ((std::map<int64_t, float>{{1, 6}, {2, 3}, {3, 2}}), recorder.sum);
+
+  Push(cache.get(), {5}, 1, cb);
+  EXPECT_EQ(1, recorder.runs);
+  ASSERT_TRUE(cache->Flush().IsOk());
+  EXPECT_EQ(2, recorder.runs);
+  EXPECT_EQ(4, done);
+  EXPECT_EQ(1, recorder.sum[5]);
+  ASSERT_TRUE(cache->Flush().IsOk());
+  EXPECT_EQ(2, recorder.runs);
+}
+
+TEST(BackwardAccumulateCacheTest, FlushRowsAndTime) {
+  BackwardRecorder recorder;
+  std::unique_ptr<BackwardCache> cache;
+  ASSERT_TRUE(BackwardCache::Get(recorder.Run(), "name=accumulate_cache&flush_count=100&flush_rows=3&flush_ms=0", &cache).IsOk());
+  auto ignore = [](Status st) { EXPECT_TRUE(st.IsOk()); };
+  Push(cache.get(), {1, 2}, 1, ignore);
+  Push(cache.get(), {1, 2}, 1, ignore);
+  EXPECT_EQ(0, recorder.runs);
+  Push(cache.get(), {3}, 1, ignore);
+  EXPECT_EQ(1, recorder.runs);
+
+  ASSERT_TRUE(BackwardCache::Get(recorder.Run(), "name=accumulate_cache&flush_count=100&flush_ms=20", &cache).IsOk());
+  std::mutex mu;
+  bool done = false;
+  Push(cache.get(), {1}, 1, [&](Status st) {
+    std::unique_lock<std::mutex> lock(mu);
+    done = true;
+  });
+  for (int i = 0; i < 100; i++) {
+    {
+      std::unique_lock<std::mutex> lock(mu);
+      if (done) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::unique_lock<std::mutex> lock(mu);
+  EXPECT_TRUE(done);
+}
+
+TEST(BackwardAccumulateCacheTest, Concurrent) {
+  BackwardRecorder recorder;
+  std::unique_ptr<BackwardCache> cache;
+  ASSERT_TRUE(BackwardCache::Get(recorder.Run(), "name=accumulate_cache&flush_count=7&flush_ms=1", &cache).IsOk());
+  std::atomic<int> done(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 250; i++) {
+        Push(cache.get(), {i % 10, 100 + t}, 1, [&](Status st) { done++; });
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_TRUE(cache->Flush().IsOk());
+  EXPECT_EQ(1000, done);
+  std::unique_lock<std::mutex> lock(recorder.mu);
+  EXPECT_LT(recorder.runs, 1000);
+  for (int64_t id = 0; id < 10; id++) {
+    EXPECT_EQ(100, recorder.sum[id]);
+  }
+  for (int64_t t = 0; t < 4; t++) {
+    EXPECT_EQ(250, recorder.sum[100 + t]);
+  }
+}
+
+TEST(BackwardAccumulateCacheTest, Error) {
+  BackwardRecorder recorder;
+  recorder.async = true;
+  std::unique_ptr<BackwardCache> cache;
+  ASSERT_TRUE(BackwardCache::Get(recorder.Run(), "name=accumulate_cache&flush_count=2&flush_ms=0", &cache).IsOk());
+  std::vector<Status> results;
+  auto cb = [&](Status st) { results.push_back(st); };
+  Push(cache.get(), {1}, 1, cb);
+  Tensor ids(DataType::kInt64, TensorShape({1}), new ConstantInitializer(0));
+  cache->Calc(ids, Tensor(DataType::kFloat, TensorShape({1, 3}), new ConstantInitializer(0)), cb);
+  ASSERT_EQ(1u, results.size());
+  EXPECT_FALSE(results[0].IsOk());
+  Push(cache.get(), {1}, 1, cb);
+  ASSERT_EQ(1u, recorder.cbs.size());
+  recorder.cbs[0](Status::NetworkError("down"));
+  ASSERT_EQ(3u, results.size());
+  EXPECT_EQ(Status::NetworkError("down"), results[1]);
+  EXPECT_EQ(Status::NetworkError("down"), results[2]);
+}
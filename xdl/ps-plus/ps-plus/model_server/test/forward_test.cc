@@ -13,6 +13,10 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <chrono>
+#include <mutex>
+#include <thread>
+
 #include "gtest/gtest.h"
 #include "ps-plus/common/tensor.h"
 #include "ps-plus/model_server/forward.h"
@@ -153,3 +157,220 @@ TEST(ForwardUniqueCacheTest, ForwardUniqueCache) {
   }
 
 }
+
+namespace {
+
+// rows are {id, id * 2} and every batch run is recorded
+struct ForwardRecorder {
+  std::mutex mu;
+  std::vector<std::vector<int64_t>> runs;
+  std::vector<ForwardCache::Callback> cbs;
+  bool async = false;
+
+  ForwardCache::ForwardRun Run() {
+    return [this](Tensor ids, ForwardCache::Callback cb) {
+      std::vector<int64_t> run(ids.Raw<int64_t>(), ids.Raw<int64_t>() + ids.Shape().NumElements());
+      {
+        std::unique_lock<std::mutex> lock(mu);
+        runs.push_back(run);
+        if (async) {
+          cbs.push_back(cb);
+          return;
+        }
+      }
+      cb(Status::Ok(), Rows(run));
+    };
+  }
+  static Tensor Rows(const std::vector<int64_t>& ids) {
+    Tensor rst(DataType::kInt64, TensorShape({ids.size(), 2}), new ConstantInitializer(0));
+    for (size_t i = 0; i < ids.size(); i++) {
+      rst.Raw<int64_t>()[i * 2] = ids[i];
+      rst.Raw<int64_t>()[i * 2 + 1] = ids[i] * 2;
+    }
+    return rst;
+  }
+  void Complete(size_t i) {
+    cbs[i](Status::Ok(), Rows(runs[i]));
+  }
+};
+
+Tensor Ids(const std::vector<int64_t>& ids) {
+  Tensor t(DataType::kInt64, TensorShape({ids.size()}), new ConstantInitializer(0));
+  for (size_t i = 0; i < ids.size(); i++) {
+    t.Raw<int64_t>()[i] = ids[i];
+  }
+  return t;
+}
+
+void ExpectRows(const std::vector<int64_t>& ids, Status st, Tensor rst) {
+  ASSERT_TRUE(st.IsOk()) << st.ToString();
+  ASSERT_EQ(TensorShape({ids.size(), 2}), rst.Shape());
+  for (size_t i = 0; i < ids.size(); i++) {
+    EXPECT_EQ(ids[i], rst.Raw<int64_t>()[i * 2]);
+    EXPECT_EQ(ids[i] * 2, rst.Raw<int64_t>()[i * 2 + 1]);
+  }
+}
+
+}
+
+TEST(ForwardAdaptiveCacheTest, CacheHit) {
+  ForwardRecorder recorder;
+  std::unique_ptr<ForwardCache> cache;
+  ASSERT_TRUE(ForwardCache::Get(recorder.Run(), "name=adaptive_cache&slo_ms=0", &cache).IsOk());
+  int done = 0;
+  cache->Calc(Ids({1, 2, 3, 2}), [&](Status st, Tensor rst) {
+    ExpectRows({1, 2, 3, 2}, st, rst); done++;
+  });
+  cache->Calc(Ids({3, 4, 1}), [&](Status st, Tensor rst) {
+    ExpectRows({3, 4, 1}, st, rst); done++;
+  });
+  cache->Calc(Ids({4, 2}), [&](Status st, Tensor rst) {
+    ExpectRows({4, 2}, st, rst); done++;
+  });
+  EXPECT_EQ(3, done);
+  ASSERT_EQ(2u, recorder.runs.size());
+  EXPECT_EQ(std::vector<int64_t>({1, 2, 3}), recorder.runs[0]);
+  EXPECT_EQ(std::vector<int64_t>({4}), recorder.runs[1]);
+
+  ASSERT_TRUE(cache->Flush().IsOk());
+  cache->Calc(Ids({1}), [&](Status st, Tensor rst) {
+    ExpectRows({1}, st, rst); done++;
+  });
+  EXPECT_EQ(4, done);
+  EXPECT_EQ(3u, recorder.runs.size());
+}
+
+TEST(ForwardAdaptiveCacheTest, LruAndTtl) {
+  ForwardRecorder recorder;
+  std::unique_ptr<ForwardCache> cache;
+  ASSERT_TRUE(ForwardCache::Get(recorder.Run(), "name=adaptive_cache&slo_ms=0&cache_size=2", &cache).IsOk());
+  auto ignore = [](Status st, Tensor rst) { EXPECT_TRUE(st.IsOk()); };
+  cache->Calc(Ids({1, 2}), ignore);
+  cache->Calc(Ids({1}), ignore);
+  cache->Calc(Ids({3}), ignore);
+  // 2 was the least recently used one
+  cache->Calc(Ids({1, 3}), ignore);
+  EXPECT_EQ(2u, recorder.runs.size());
+  cache->Calc(Ids({2}), ignore);
+  EXPECT_EQ(3u, recorder.runs.size());
+
+  ASSERT_TRUE(ForwardCache::Get(recorder.Run(), "name=adaptive_cache&slo_ms=0&ttl_ms=20", &cache).IsOk());
+  recorder.runs.clear();
+  cache->Calc(Ids({1}), ignore);
+  cache->Calc(Ids({1}), ignore);
+  EXPECT_EQ(1u, recorder.runs.size());
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  cache->Calc(Ids({1}), ignore);
+  EXPECT_EQ(2u, recorder.runs.size());
+}
+
+TEST(ForwardAdaptiveCacheTest, DedupeInFlight) {
+  ForwardRecorder recorder;
+  recorder.async = true;
+  std::unique_ptr<ForwardCache> cache;
+  ASSERT_TRUE(ForwardCache::Get(recorder.Run(), "name=adaptive_cache&slo_ms=0", &cache).IsOk());
+  int done = 0;
+  cache->Calc(Ids({1, 2}), [&](Status st, Tensor rst) {
+    ExpectRows({1, 2}, st, rst); done++;
+  });
+  cache->Calc(Ids({2, 3}), [&](Status st, Tensor rst) {
+    ExpectRows({2, 3}, st, rst); done++;
+  });
+  cache->Calc(Ids({2, 1}), [&](Status st, Tensor rst) {
+    ExpectRows({2, 1}, st, rst); done++;
+  });
+  ASSERT_EQ(2u, recorder.runs.size());
+  EXPECT_EQ(std::vector<int64_t>({3}), recorder.runs[1]);
+  recorder.Complete(1);
+  EXPECT_EQ(0, done);
+  recorder.Complete(0);
+  EXPECT_EQ(3, done);
+}
+
+TEST(ForwardAdaptiveCacheTest, AdaptiveWindow) {
+  ForwardRecorder recorder;
+  std::unique_ptr<ForwardCache> cache;
+  ASSERT_TRUE(ForwardCache::Get(recorder.Run(), "name=adaptive_cache&slo_ms=50&window_size=16&cache_size=0", &cache).IsOk());
+  std::mutex mu;
+  int done = 0;
+  for (int64_t i = 0; i < 100; i++) {
+    cache->Calc(Ids({i}), [&, i](Status st, Tensor rst) {
+      ExpectRows({i}, st, rst);
+      std::unique_lock<std::mutex> lock(mu);
+      done++;
+    });
+  }
+  for (int i = 0; i < 100; i++) {
+    {
+      std::unique_lock<std::mutex> lock(mu);
+      if (done == 100) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::unique_lock<std::mutex> lock(mu);
+  EXPECT_EQ(100, done);
+  // the first requests go alone until the arrival rate is known
+  EXPECT_LT(recorder.runs.size(), 20u);
+  for (auto& run : recorder.runs) {
+    EXPECT_LE(run.size(), 16u);
+  }
+}
+
+TEST(ForwardAdaptiveCacheTest, Error) {
+  ForwardRecorder recorder;
+  recorder.async = true;
+  std::unique_ptr<ForwardCache> cache;
+  ASSERT_TRUE(ForwardCache::Get(recorder.Run(), "name=adaptive_cache&slo_ms=0", &cache).IsOk());
+  Status result;
+  cache->Calc(Ids({1}), [&](Status st, Tensor rst) { result = st; });
+  recorder.cbs[0](Status::NetworkError("down"), Tensor());
+  EXPECT_EQ(Status::NetworkError("down"), result);
+  cache->Calc(Tensor(DataType::kInt32, TensorShape({1}), new ConstantInitializer(0)),
+              [&](Status st, Tensor rst) { result = st; });
+  EXPECT_FALSE(result.IsOk());
+  EXPECT_EQ(1u, recorder.runs.size());
+}
+
+TEST(ForwardAdaptiveCacheTest, BatchSize) {
+  ForwardRecorder recorder;
+  std::unique_ptr<ForwardCache> cache;
+  ASSERT_TRUE(ForwardCache::Get(recorder.Run(), "name=adaptive_cache&slo_ms=0&cache_size=0&batch_size=3&pad_batch=1", &cache).IsOk());
+  int done = 0;
+  cache->Calc(Ids({1, 2, 3, 4, 2}), [&](Status st, Tensor rst) {
+    ExpectRows({1, 2, 3, 4, 2}, st, rst); done++;
+  });
+  EXPECT_EQ(1, done);
+  ASSERT_EQ(2u, recorder.runs.size());
+  EXPECT_EQ(std::vector<int64_t>({1, 2, 3}), recorder.runs[0]);
+  // padded with the last id
+  EXPECT_EQ(std::vector<int64_t>({4, 4, 4}), recorder.runs[1]);
+
+  EXPECT_FALSE(ForwardCache::Get(recorder.Run(), "name=adaptive_cache&pad_batch=1", &cache).IsOk());
+}
+
+TEST(ForwardAdaptiveCacheTest, MaxInflight) {
+  ForwardRecorder recorder;
+  recorder.async = true;
+  std::unique_ptr<ForwardCache> cache;
+  ASSERT_TRUE(ForwardCache::Get(recorder.Run(), "name=adaptive_cache&slo_ms=0&cache_size=0&max_inflight=1", &cache).IsOk());
+  int done = 0;
+  auto count = [&](Status st, Tensor rst) { EXPECT_TRUE(st.IsOk()); done++; };
+  cache->Calc(Ids({1}), count);
+  cache->Calc(Ids({2}), count);
+  cache->Calc(Ids({3, 4}), count);
+  // the window collects while the first batch runs
+  {
+    std::unique_lock<std::mutex> lock(recorder.mu);
+    ASSERT_EQ(1u, recorder.runs.size());
+  }
+  recorder.Complete(0);
+  EXPECT_EQ(1, done);
+  std::unique_lock<std::mutex> lock(recorder.mu);
+  ASSERT_EQ(2u, recorder.runs.size());
+  EXPECT_EQ(std::vector<int64_t>({2, 3, 4}), recorder.runs[1]);
+  lock.unlock();
+  recorder.Complete(1);
+  EXPECT_EQ(3, done);
+}
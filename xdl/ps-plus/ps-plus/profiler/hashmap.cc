@@ -15,45 +15,66 @@ limitations under the License.
 
 #include "ps-plus/profiler/profiler.h"
 #include "ps-plus/common/hashmap.h"
+#include "ps-plus/common/open_hashmap.h"
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <random>
 
 using ps::HashMap;
 
+namespace {
+
+const size_t kKeySpace = 1 << 24;
+const size_t kKeysPerRequest = 20000;
+
 std::unique_ptr<HashMap> hashmap;
-const int hint = 1 << 10;
-std::vector<std::unique_ptr<std::mt19937>> rands;
+std::vector<std::unique_ptr<std::mt19937_64>> rands;
 std::random_device rd;
 
-#if 0
-PROFILE(hashmap, 32, 100000).Init([](size_t threads){
+void InitHashMap(const std::string& backend, size_t threads) {
   rands.clear();
   for (size_t i = 0; i < threads; i++) {
-    rands.emplace_back(new std::mt19937(rd()));
+    rands.emplace_back(new std::mt19937_64(rd()));
   }
-  std::srand(std::time(0));
-  hashmap.reset(new HashMap(hint));
-}).TestCase([](size_t thread_id, bool run){
-  int hint = (1<<10);
-  std::vector<int64_t> ids;
-  std::vector<int64_t> reused_ids;
-  const int keys_size = 500;
-  int64_t keys[keys_size * 2];
-  int ret = 0;
-
-  for (int i = 0; i < keys_size; i++) {
-    int rv = (*rands[thread_id])() % hint;
-    rv = (rv + hint) % hint;
-    keys[i*2] = rv;
-    keys[i*2+1] = rv+1;
+  HashMap* result = nullptr;
+  ps::Status st = ps::CreateHashMap(backend, true, kKeySpace, &result);
+  if (!st.IsOk()) {
+    std::cout << "ERROR " << st.ToString() << std::endl;
   }
+  hashmap.reset(result);
+  // warm up with the whole key space so that the test case only does lookups
+  std::vector<int64_t> keys(kKeySpace);
+  for (size_t i = 0; i < kKeySpace; i++) {
+    keys[i] = i;
+  }
+  std::vector<size_t> ids;
+  tbb::concurrent_vector<size_t> reused_ids;
+  size_t filtered;
+  hashmap->Get(&keys[0], keys.size(), false, 1.0, &ids, &reused_ids, &filtered);
+}
 
+// sorted keys, as MergedHashPull sends them after the worker side unique
+void PullSorted(size_t thread_id, bool run) {
+  std::vector<int64_t> keys(kKeysPerRequest);
+  for (size_t i = 0; i < kKeysPerRequest; i++) {
+    keys[i] = (*rands[thread_id])() % kKeySpace;
+  }
+  std::sort(keys.begin(), keys.end());
   if (run) {
-    ret = hashmap->Get(keys, keys_size, 2, &ids, &reused_ids); 
-    if (ret != 0) {
-      std::cout << "ERROR" << std::endl;
-    }
+    std::vector<size_t> ids;
+    tbb::concurrent_vector<size_t> reused_ids;
+    size_t filtered;
+    hashmap->Get(&keys[0], keys.size(), false, 1.0, &ids, &reused_ids, &filtered);
   }
-});
-#endif
+}
+
+}
+
+PROFILE(hashmap_tbb, 32, 100).Init([](size_t threads){
+  InitHashMap("tbb", threads);
+}).TestCase(PullSorted);
+
+PROFILE(hashmap_open, 32, 100).Init([](size_t threads){
+  InitHashMap("open", threads);
+}).TestCase(PullSorted);
@@ -16,9 +16,11 @@ limitations under the License.
 #include "synchronizer.h"
 
 #include "ps-plus/common/status.h"
+#include "ps-plus/scheduler/group_barrier.h"
 
 #include <string>
 #include <iostream>
+#include <vector>
 
 using namespace std;
 using namespace std::chrono;
@@ -37,7 +39,8 @@ function<void (const Status&)> MkCb(int id) {
 
 }
 
-Asynchronizer::Asynchronizer(int staleness, int worker_count) : staleness_(staleness), worker_count_(worker_count) {
+Asynchronizer::Asynchronizer(int staleness, int worker_count, ThreadPool* grant_pool, size_t grant_batch)
+  : staleness_(staleness), worker_count_(worker_count), grant_pool_(grant_pool), grant_batch_(grant_batch) {
   contexts_.reset(new Context[worker_count_]);
   Context* ctxs = contexts_.get();
   for (int i = 0; i < worker_count_; i++) {
@@ -56,10 +59,14 @@ void Asynchronizer::UnlockNewSteps(int least_step) {
   int step = least_step + staleness_ + 1;
   auto it = step_index_.find(step);
   if (it == step_index_.end()) { return; }
+  // With many workers most of them wait on the same step, the grants go
+  // out in batches on the pool instead of one reply after another here.
+  std::vector<function<void (const Status&)>> grants;
   for (Context* p: it->second) {
-    p->cb_(Status::Ok());
+    grants.push_back(std::move(p->cb_));
     p->cb_ = MkCb(p->id_);
   }
+  GroupBarrier::FanOut(grant_batch_, grant_pool_, &grants);
 }
 
 void Asynchronizer::Enter(int id, function<void (const Status&)> cb) {
@@ -0,0 +1,161 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/scheduler/group_barrier.h"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+
+namespace ps {
+namespace scheduler {
+
+GroupBarrier::GroupBarrier(size_t group_size, ThreadPool* pool)
+  : group_size_(group_size == 0 ? 1 : group_size), pool_(pool),
+    worker_count_(0), complete_groups_(0) {
+}
+
+void GroupBarrier::Enter(int id, int worker_count, const Callback& cb) {
+  if (id < 0 || id >= worker_count) {
+    cb(Status::ArgumentError("Barrier worker out of bound: min=0, max="
+                             + std::to_string(worker_count) + ", actual="
+                             + std::to_string(id)));
+    return;
+  }
+  if (finished_.find(id) != finished_.end()) {
+    cb(Status::Ok());
+    return;
+  }
+  if (worker_count != worker_count_) {
+    Reshape(worker_count);
+  }
+  Group& group = groups_[id / group_size_];
+  for (auto& item : group.waiting) {
+    // a retried enter replaces the callback of the lost one
+    if (item.first == id) {
+      item.second = cb;
+      return;
+    }
+  }
+  group.waiting.emplace_back(id, cb);
+  if (group.waiting.size() == group.expected) {
+    complete_groups_++;
+  }
+  TryRelease();
+}
+
+void GroupBarrier::Remove(int id) {
+  if (!finished_.insert(id).second) {
+    return;
+  }
+  if (id < 0 || id >= worker_count_) {
+    return;
+  }
+  Group& group = groups_[id / group_size_];
+  bool complete = group.waiting.size() >= group.expected;
+  for (auto iter = group.waiting.begin(); iter != group.waiting.end(); ++iter) {
+    if (iter->first == id) {
+      iter->second(Status::Ok());
+      group.waiting.erase(iter);
+      break;
+    }
+  }
+  group.expected--;
+  if (!complete && group.waiting.size() >= group.expected) {
+    complete_groups_++;
+  }
+  TryRelease();
+}
+
+size_t GroupBarrier::Waiting() const {
+  size_t waiting = 0;
+  for (auto& group : groups_) {
+    waiting += group.waiting.size();
+  }
+  return waiting;
+}
+
+void GroupBarrier::Reshape(int worker_count) {
+  std::vector<std::pair<int, Callback>> waiting;
+  for (auto& group : groups_) {
+    for (auto& item : group.waiting) {
+      waiting.push_back(std::move(item));
+    }
+  }
+  worker_count_ = worker_count;
+  groups_.assign((worker_count + group_size_ - 1) / group_size_, Group{0, {}});
+  for (int id = 0; id < worker_count; id++) {
+    if (finished_.find(id) == finished_.end()) {
+      groups_[id / group_size_].expected++;
+    }
+  }
+  for (auto& item : waiting) {
+    if (item.first < worker_count) {
+      groups_[item.first / group_size_].waiting.push_back(std::move(item));
+    } else {
+      item.second(Status::ArgumentError("Barrier worker " + std::to_string(item.first)
+                                        + " out of " + std::to_string(worker_count)));
+    }
+  }
+  complete_groups_ = 0;
+  for (auto& group : groups_) {
+    if (group.waiting.size() >= group.expected) {
+      complete_groups_++;
+    }
+  }
+}
+
+void GroupBarrier::TryRelease() {
+  if (complete_groups_ != groups_.size()) {
+    return;
+  }
+  std::vector<Callback> cbs;
+  complete_groups_ = 0;
+  for (auto& group : groups_) {
+    for (auto& item : group.waiting) {
+      cbs.push_back(std::move(item.second));
+    }
+    group.waiting.clear();
+    if (group.expected == 0) {
+      complete_groups_++;
+    }
+  }
+  FanOut(group_size_, pool_, &cbs);
+}
+
+void GroupBarrier::FanOut(size_t group_size, ThreadPool* pool, std::vector<Callback>* cbs) {
+  group_size = group_size == 0 ? 1 : group_size;
+  if (pool == nullptr || cbs->size() <= group_size) {
+    for (auto& cb : *cbs) {
+      cb(Status::Ok());
+    }
+    cbs->clear();
+    return;
+  }
+  for (size_t beg = 0; beg < cbs->size(); beg += group_size) {
+    size_t end = std::min(beg + group_size, cbs->size());
+    std::shared_ptr<std::vector<Callback>> chunk(new std::vector<Callback>(
+        std::make_move_iterator(cbs->begin() + beg), std::make_move_iterator(cbs->begin() + end)));
+    pool->Schedule([chunk] {
+      for (auto& cb : *chunk) {
+        cb(Status::Ok());
+      }
+    });
+  }
+  cbs->clear();
+}
+
+}
+}
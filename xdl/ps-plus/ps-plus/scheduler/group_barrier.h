@@ -0,0 +1,70 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_SCHEDULER_GROUP_BARRIER_H_
+#define PS_SCHEDULER_GROUP_BARRIER_H_
+
+#include <functional>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "ps-plus/common/status.h"
+#include "ps-plus/common/thread_pool.h"
+
+namespace ps {
+namespace scheduler {
+
+// Worker barrier aggregated through groups of group_size consecutive ids.
+// An arrival only touches its own group, the root just counts the groups
+// that are complete, and the release hands every group to the pool, so the
+// callbacks of a large barrier reply in parallel instead of one by one on
+// the synchronizer thread. Not thread safe, like the other sync mechanisms
+// it runs on the synchronizer queue.
+class GroupBarrier {
+ public:
+  using Callback = std::function<void (const Status&)>;
+
+  GroupBarrier(size_t group_size, ThreadPool* pool);
+  // Waits until all worker_count workers but the finished ones entered.
+  void Enter(int id, int worker_count, const Callback& cb);
+  // A finished worker is no longer waited for.
+  void Remove(int id);
+  size_t Waiting() const;
+
+  // Runs cbs on the pool, group_size of them per task.
+  static void FanOut(size_t group_size, ThreadPool* pool, std::vector<Callback>* cbs);
+
+ private:
+  struct Group {
+    size_t expected;
+    std::vector<std::pair<int, Callback>> waiting;
+  };
+  void Reshape(int worker_count);
+  void Join(Group* group);
+  void TryRelease();
+
+  size_t group_size_;
+  ThreadPool* pool_;
+  int worker_count_;
+  std::vector<Group> groups_;
+  size_t complete_groups_;
+  std::set<int> finished_;
+};
+
+}
+}
+
+#endif // PS_SCHEDULER_GROUP_BARRIER_H_
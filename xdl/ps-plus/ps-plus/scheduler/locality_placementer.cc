@@ -0,0 +1,139 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/scheduler/placementer.h"
+#include "ps-plus/common/hasher.h"
+#include "ps-plus/common/logging.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <vector>
+
+namespace ps {
+namespace scheduler {
+
+namespace {
+
+// Bytes a variable moves per step, estimated the way BalanceV2 does.
+double VariableNet(const VariableInfo& info) {
+  size_t slice_size = 1;
+  for (size_t i = 1; i < info.shape.size(); i++) {
+    slice_size *= info.shape[i];
+  }
+  auto iter = info.args.find("io_ratio");
+  double io_ratio = iter == info.args.end() ? 1 : atof(iter->second.c_str());
+  iter = info.args.find("batch_read");
+  double rows;
+  if (info.shape.empty()) {
+    rows = 1;
+  } else {
+    rows = iter == info.args.end() ? info.shape[0] : atof(iter->second.c_str());
+  }
+  return SizeOfType(info.datatype) * slice_size * rows * io_ratio;
+}
+
+bool IsHash(const VariableInfo& info) {
+  return info.type == VariableInfo::kHash128 || info.type == VariableInfo::kHash64;
+}
+
+}
+
+// Hash variables sharing a placement_group arg are pulled together by merged
+// ops, so every member gets the same hash range split over one subset of the
+// servers instead of all of them. The subset is as small as the group's
+// traffic allows, about one server per average server load of traffic, and
+// it goes to the servers least loaded by earlier groups. A group that already
+// has a placed member keeps its parts. The rest of the variables are placed by
+// BalanceV2.
+class LocalityPlacementer : public Placementer {
+ public:
+  virtual Status Placement(const std::vector<VariableInfo>& inputs, std::vector<VariableInfo>* outputs, const Arg& arg, size_t server) override {
+    if (server == 0) {
+      return Status::ArgumentError("Locality Placementer needs at least 1 server");
+    }
+    std::vector<VariableInfo> staged = inputs;
+    std::map<std::string, std::vector<size_t>> groups;
+    std::map<std::string, std::vector<VariableInfo::Part>> group_parts;
+    std::vector<double> load(server, 0);
+    double total_net = 0;
+    for (size_t i = 0; i < staged.size(); i++) {
+      const VariableInfo& info = staged[i];
+      double net = VariableNet(info);
+      total_net += net;
+      size_t total_size = 0;
+      for (auto& part : info.parts) {
+        total_size += part.size;
+      }
+      for (auto& part : info.parts) {
+        if (part.server < server) {
+          load[part.server] += net * part.size / total_size;
+        }
+      }
+      auto iter = info.args.find(VariableInfo::PLACEMENT_GROUP);
+      if (!IsHash(info) || iter == info.args.end() || iter->second.empty()) {
+        continue;
+      }
+      if (info.parts.empty()) {
+        groups[iter->second].push_back(i);
+      } else if (group_parts.find(iter->second) == group_parts.end()) {
+        group_parts[iter->second] = info.parts;
+      }
+    }
+    double avg_net = total_net / server;
+    for (auto& group : groups) {
+      auto placed = group_parts.find(group.first);
+      std::vector<VariableInfo::Part> parts;
+      if (placed != group_parts.end()) {
+        parts = placed->second;
+      } else {
+        double net = 0;
+        for (size_t i : group.second) {
+          net += VariableNet(staged[i]);
+        }
+        size_t k = avg_net > 0 ? (size_t)std::ceil(net / avg_net) : 1;
+        k = std::max<size_t>(1, std::min(k, server));
+        std::vector<size_t> order(server);
+        for (size_t s = 0; s < server; s++) {
+          order[s] = s;
+        }
+        std::stable_sort(order.begin(), order.end(), [&load](size_t a, size_t b) {
+          return load[a] < load[b];
+        });
+        order.resize(k);
+        std::sort(order.begin(), order.end());
+        size_t a = Hasher::kTargetRange;
+        for (size_t s : order) {
+          size_t size = std::min((size_t)(Hasher::kTargetRange / k) + 1, a);
+          parts.push_back(VariableInfo::Part{.server = s, .size = size});
+          load[s] += net / k;
+          a -= size;
+          if (a == 0) { break; }
+        }
+        LOG(INFO) << "Placement group " << group.first << ": " << group.second.size()
+                  << " variables on " << parts.size() << " servers";
+      }
+      for (size_t i : group.second) {
+        staged[i].parts = parts;
+      }
+    }
+    return GetPlugin<Placementer>("BalanceV2")->Placement(staged, outputs, arg, server);
+  }
+};
+
+PLUGIN_REGISTER(Placementer, Locality, LocalityPlacementer);
+
+}
+}
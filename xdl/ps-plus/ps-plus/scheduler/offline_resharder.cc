@@ -0,0 +1,232 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/scheduler/offline_resharder.h"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <memory>
+#include <unordered_map>
+
+#include "ps-plus/common/file_system.h"
+#include "ps-plus/common/logging.h"
+#include "ps-plus/common/serializer.h"
+#include "ps-plus/server/checkpoint_utils.h"
+#include "ps-plus/server/variable.h"
+
+namespace ps {
+namespace scheduler {
+
+namespace {
+
+// the infos saved by a restored cluster still point at its source
+void ClearOrigin(std::vector<VariableInfo>* infos) {
+  for (auto& info : *infos) {
+    info.args.erase(VariableInfo::ORIGIN_FILE_PATH);
+    info.args.erase(VariableInfo::ORIGIN_NAME);
+  }
+}
+
+}
+
+Status OfflineResharder::Run(const Arg& arg) {
+  if (arg.server_num == 0 || arg.processes == 0) {
+    return Status::ArgumentError("OfflineResharder: server num and processes should be positive");
+  }
+  if (arg.placementer == nullptr) {
+    return Status::ArgumentError("OfflineResharder: placementer not found");
+  }
+  std::vector<std::string> checkpoints;
+  PS_CHECK_STATUS(ReadCheckpoints(arg.from_path, &checkpoints));
+  std::string from_checkpoint = arg.from_checkpoint;
+  if (from_checkpoint.empty()) {
+    if (checkpoints.empty()) {
+      return Status::NotFound("OfflineResharder: no checkpoint in " + arg.from_path);
+    }
+    from_checkpoint = checkpoints.back();
+  } else if (std::find(checkpoints.begin(), checkpoints.end(), from_checkpoint) == checkpoints.end()) {
+    return Status::NotFound("Checkpoint Not Found : " + from_checkpoint);
+  }
+  std::string from = arg.from_path + "/" + from_checkpoint;
+  std::string to = arg.to_path + "/" + arg.to_checkpoint;
+
+  size_t old_server_num;
+  std::vector<VariableInfo> from_infos, to_infos;
+  PS_CHECK_STATUS(ReadMeta(from, &old_server_num, &from_infos));
+  PS_CHECK_STATUS(Plan(from_infos, arg.placementer, arg.placement_arg, arg.server_num, &to_infos));
+  LOG(INFO) << "Resharding " << from << " from " << old_server_num << " servers to "
+            << arg.server_num << " servers in " << to;
+
+  // forked before the checkpoint pools start their threads
+  size_t processes = std::min(arg.processes, arg.server_num);
+  if (processes == 1) {
+    PS_CHECK_STATUS(ReshardServers(from, from_infos, to, to_infos, arg.server_num, 0, 1));
+  } else {
+    std::vector<pid_t> children;
+    Status st = Status::Ok();
+    for (size_t i = 0; i < processes; i++) {
+      pid_t pid = fork();
+      if (pid < 0) {
+        st = Status::Unknown("OfflineResharder: fork error " + std::to_string(errno));
+        break;
+      }
+      if (pid == 0) {
+        Status ret = ReshardServers(from, from_infos, to, to_infos, arg.server_num, i, processes);
+        if (!ret.IsOk()) {
+          LOG(ERROR) << "Reshard process " << i << " failed: " << ret.ToString();
+        }
+        _exit(ret.IsOk() ? 0 : 1);
+      }
+      children.push_back(pid);
+    }
+    for (size_t i = 0; i < children.size(); i++) {
+      int status = 0;
+      if (waitpid(children[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        if (st.IsOk()) {
+          st = Status::Unknown("OfflineResharder: reshard process " + std::to_string(i) + " failed");
+        }
+      }
+    }
+    PS_CHECK_STATUS(st);
+  }
+
+  PS_CHECK_STATUS(WriteMeta(to, arg.server_num, to_infos));
+  std::unique_ptr<FileSystem::ReadStream> queue;
+  if (FileSystem::OpenReadStreamAny(from + "/global_queue_meta", &queue).IsOk()) {
+    std::string queue_buf;
+    PS_CHECK_STATUS(queue->ReadStr(&queue_buf));
+    std::unique_ptr<FileSystem::WriteStream> s;
+    PS_CHECK_STATUS(FileSystem::OpenWriteStreamAny(to + "/global_queue_meta", &s));
+    PS_CHECK_STATUS(s->WriteStr(queue_buf));
+  } else if (FileSystem::OpenReadStreamAny(from + "/global_queue_kv", &queue).IsOk()) {
+    // the queue shards in the kv are keyed by the checkpoint dir
+    LOG(WARNING) << "The global queues of " << from << " are in the kv, not resharded";
+  }
+
+  std::vector<std::string> to_checkpoints;
+  ReadCheckpoints(arg.to_path, &to_checkpoints);
+  to_checkpoints.push_back(arg.to_checkpoint);
+  PS_CHECK_STATUS(WriteCheckpoints(arg.to_path, to_checkpoints));
+  LOG(INFO) << "Resharded " << from << " in " << to;
+  return Status::Ok();
+}
+
+Status OfflineResharder::Plan(const std::vector<VariableInfo>& inputs, Placementer* placementer,
+                              const Placementer::Arg& placement_arg, size_t server_num,
+                              std::vector<VariableInfo>* outputs) {
+  std::vector<VariableInfo> infos = inputs;
+  ClearOrigin(&infos);
+  for (auto& info : infos) {
+    info.parts.clear();
+  }
+  return placementer->Placement(infos, outputs, placement_arg, server_num);
+}
+
+Status OfflineResharder::ReshardServers(const std::string& from, const std::vector<VariableInfo>& from_infos,
+                                        const std::string& to, const std::vector<VariableInfo>& to_infos,
+                                        size_t server_num, size_t process, size_t processes) {
+  VariableInfoCollection source{from_infos};
+  ClearOrigin(&source.infos);
+  for (auto& info : source.infos) {
+    info.args[VariableInfo::ORIGIN_FILE_PATH] = from;
+    info.args[VariableInfo::ORIGIN_NAME] = info.name;
+  }
+  VariableInfoCollection dest{to_infos};
+  ClearOrigin(&dest.infos);
+  server::CheckpointUtils loader(source);
+  server::CheckpointUtils saver(dest);
+  for (size_t id = process; id < server_num; id += processes) {
+    // one server at a time, like the servers of the new cluster
+    std::unordered_map<std::string, std::unique_ptr<server::Variable>> vars;
+    PS_CHECK_STATUS(loader.LoadVariables(dest, id, &vars));
+    PS_CHECK_STATUS(saver.SaveVariables(id, to, vars));
+    LOG(INFO) << "Resharded server " << id << ", " << vars.size() << " variables";
+  }
+  return Status::Ok();
+}
+
+Status OfflineResharder::ReadCheckpoints(const std::string& path, std::vector<std::string>* checkpoints) {
+  std::unique_ptr<FileSystem::ReadStream> s;
+  PS_CHECK_STATUS(FileSystem::OpenReadStreamAny(path + "/checkpoints", &s));
+  size_t size;
+  PS_CHECK_STATUS(s->ReadRaw(&size));
+  checkpoints->resize(size);
+  for (size_t i = 0; i < size; i++) {
+    PS_CHECK_STATUS(s->ReadStr(&(*checkpoints)[i]));
+  }
+  return Status::Ok();
+}
+
+Status OfflineResharder::WriteCheckpoints(const std::string& path, const std::vector<std::string>& checkpoints) {
+  {
+    std::unique_ptr<FileSystem::WriteStream> s;
+    PS_CHECK_STATUS(FileSystem::OpenWriteStreamAny(path + "/checkpoints.tmp", &s));
+    PS_CHECK_STATUS(s->WriteRaw(checkpoints.size()));
+    for (auto& checkpoint : checkpoints) {
+      PS_CHECK_STATUS(s->WriteStr(checkpoint));
+    }
+  }
+  FileSystem::RemoveAny(path + "/checkpoints");
+  return FileSystem::RenameAny(path + "/checkpoints.tmp", path + "/checkpoints");
+}
+
+Status OfflineResharder::ReadMeta(const std::string& checkpoint, size_t* server_num, std::vector<VariableInfo>* infos) {
+  std::unique_ptr<FileSystem::ReadStream> s;
+  PS_CHECK_STATUS(FileSystem::OpenReadStreamAny(checkpoint + "/__meta__", &s));
+  size_t infos_type;
+  std::string infos_buf;
+  PS_CHECK_STATUS(s->ReadRaw(server_num));
+  PS_CHECK_STATUS(s->ReadRaw(&infos_type));
+  PS_CHECK_STATUS(s->ReadStr(&infos_buf));
+  Data* info_wrapper;
+  size_t len;
+  serializer::MemGuard mem;
+  serializer::Fragment frag(&infos_buf[0], infos_buf.size());
+  PS_CHECK_STATUS(serializer::DeserializeAny<Data>(infos_type, &frag, 0, &info_wrapper, &len, mem));
+  std::unique_ptr<Data> info_wrapper_deleter(info_wrapper);
+  WrapperData<VariableInfoCollection>* info_wrapper_converted = dynamic_cast<WrapperData<VariableInfoCollection>*>(info_wrapper);
+  if (info_wrapper_converted == nullptr) {
+    return Status::Unknown("Variable Info Load Error");
+  }
+  *infos = info_wrapper_converted->Internal().infos;
+  return Status::Ok();
+}
+
+Status OfflineResharder::WriteMeta(const std::string& checkpoint, size_t server_num, const std::vector<VariableInfo>& infos) {
+  std::unique_ptr<WrapperData<VariableInfoCollection>> info_wrapper(new WrapperData<VariableInfoCollection>);
+  info_wrapper->Internal().infos = infos;
+  ClearOrigin(&info_wrapper->Internal().infos);
+  size_t infos_type;
+  std::string infos_buf;
+  std::vector<serializer::Fragment> frags;
+  serializer::MemGuard mem;
+  PS_CHECK_STATUS(serializer::SerializeAny<Data>(info_wrapper.get(), &infos_type, &frags, mem));
+  for (auto frag : frags) {
+    infos_buf.append(frag.base, frag.size);
+  }
+  std::unique_ptr<FileSystem::WriteStream> s;
+  PS_CHECK_STATUS(FileSystem::OpenWriteStreamAny(checkpoint + "/__meta__", &s));
+  PS_CHECK_STATUS(s->WriteRaw(server_num));
+  PS_CHECK_STATUS(s->WriteRaw(infos_type));
+  PS_CHECK_STATUS(s->WriteStr(infos_buf));
+  return Status::Ok();
+}
+
+}
+}
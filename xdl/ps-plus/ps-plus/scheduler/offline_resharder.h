@@ -0,0 +1,75 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_SCHEDULER_OFFLINE_RESHARDER_H_
+#define PS_SCHEDULER_OFFLINE_RESHARDER_H_
+
+#include <string>
+#include <vector>
+
+#include "ps-plus/common/status.h"
+#include "ps-plus/message/variable_info.h"
+#include "ps-plus/scheduler/placementer.h"
+
+namespace ps {
+namespace scheduler {
+
+// Reshards a checkpoint to another server count out of the cluster. The
+// variables are placed on the new servers like the scheduler places them
+// on restore, so a cluster of the new size restoring the result reads one
+// file per part instead of resharding in the live servers. The new servers
+// are split over forked processes, each loads the rows of its servers like
+// Server::Restore and saves them like Server::Save. The children inherit
+// the thread pools of the caller without their threads, so Run is for a
+// process which hasn't loaded or saved a checkpoint yet, like the
+// reshard role of the ps binary.
+class OfflineResharder {
+ public:
+  struct Arg {
+    // checkpoint dirs holding a checkpoints list, an empty from_checkpoint
+    // is the last one
+    std::string from_path;
+    std::string from_checkpoint;
+    std::string to_path;
+    std::string to_checkpoint;
+    size_t server_num;
+    size_t processes;
+    Placementer* placementer;
+    Placementer::Arg placement_arg;
+  };
+
+  static Status Run(const Arg& arg);
+
+  // The placement of the checkpoint variables on server_num servers.
+  static Status Plan(const std::vector<VariableInfo>& inputs, Placementer* placementer,
+                     const Placementer::Arg& placement_arg, size_t server_num,
+                     std::vector<VariableInfo>* outputs);
+  // Writes the parts of the servers id % processes == process, from and to
+  // are the checkpoint dirs.
+  static Status ReshardServers(const std::string& from, const std::vector<VariableInfo>& from_infos,
+                               const std::string& to, const std::vector<VariableInfo>& to_infos,
+                               size_t server_num, size_t process, size_t processes);
+
+  static Status ReadCheckpoints(const std::string& path, std::vector<std::string>* checkpoints);
+  static Status WriteCheckpoints(const std::string& path, const std::vector<std::string>& checkpoints);
+  // the __meta__ of a checkpoint dir
+  static Status ReadMeta(const std::string& checkpoint, size_t* server_num, std::vector<VariableInfo>* infos);
+  static Status WriteMeta(const std::string& checkpoint, size_t server_num, const std::vector<VariableInfo>& infos);
+};
+
+}
+}
+
+#endif // PS_SCHEDULER_OFFLINE_RESHARDER_H_
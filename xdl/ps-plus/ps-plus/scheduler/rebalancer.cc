@@ -0,0 +1,117 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "ps-plus/scheduler/rebalancer.h"
+
+#include <map>
+#include <cmath>
+
+namespace ps {
+namespace scheduler {
+
+double Rebalancer::Score(const VariableLoad& load) {
+  return load.micros + load.bytes / 1024.0;
+}
+
+Status Rebalancer::Plan(const std::vector<VariableInfo>& inputs,
+                        const std::vector<ServerLoad>& loads,
+                        const Arg& arg,
+                        std::vector<VariableInfo>* outputs,
+                        std::vector<Move>* moves) {
+  *outputs = inputs;
+  moves->clear();
+  size_t server_size = loads.size();
+  if (server_size < 2) {
+    return Status::Ok();
+  }
+
+  // load of each variable part, keyed by (variable, server)
+  std::map<std::pair<std::string, size_t>, double> part_score;
+  std::vector<double> server_score(server_size, 0);
+  double total = 0;
+  for (size_t i = 0; i < server_size; i++) {
+    for (auto& load : loads[i].variables) {
+      double score = Score(load);
+      part_score[std::make_pair(load.name, i)] += score;
+      server_score[i] += score;
+      total += score;
+    }
+  }
+  if (total <= 0) {
+    return Status::Ok();
+  }
+  double upper = total / server_size * (1 + arg.band);
+
+  while (moves->size() < arg.max_moves) {
+    size_t hot = 0, cold = 0;
+    for (size_t i = 1; i < server_size; i++) {
+      if (server_score[i] > server_score[hot]) { hot = i; }
+      if (server_score[i] < server_score[cold]) { cold = i; }
+    }
+    if (server_score[hot] <= upper) {
+      break;
+    }
+
+    // Of the parts on the hot server, move the one leaving the pair of
+    // servers closest to each other. A server holds at most one part of a
+    // variable, and variables that are not saved can't be moved.
+    double gap = server_score[hot] - server_score[cold];
+    int best_info = -1;
+    size_t best_part = 0;
+    double best_score = 0;
+    double best_gap = gap;
+    for (size_t i = 0; i < outputs->size(); i++) {
+      VariableInfo& info = (*outputs)[i];
+      auto save = info.args.find("save");
+      if (save != info.args.end() && save->second == "false") {
+        continue;
+      }
+      int part = -1;
+      bool on_cold = false;
+      for (size_t j = 0; j < info.parts.size(); j++) {
+        if (info.parts[j].server == hot) { part = j; }
+        if (info.parts[j].server == cold) { on_cold = true; }
+      }
+      if (part == -1 || on_cold) {
+        continue;
+      }
+      auto iter = part_score.find(std::make_pair(info.name, hot));
+      if (iter == part_score.end() || iter->second <= 0) {
+        continue;
+      }
+      double new_gap = std::abs(gap - 2 * iter->second);
+      if (new_gap < best_gap) {
+        best_gap = new_gap;
+        best_info = i;
+        best_part = part;
+        best_score = iter->second;
+      }
+    }
+    if (best_info == -1) {
+      break;
+    }
+
+    VariableInfo& info = (*outputs)[best_info];
+    info.parts[best_part].server = cold;
+    part_score.erase(std::make_pair(info.name, hot));
+    part_score[std::make_pair(info.name, cold)] = best_score;
+    server_score[hot] -= best_score;
+    server_score[cold] += best_score;
+    moves->push_back(Move{info.name, best_part, hot, cold});
+  }
+  return Status::Ok();
+}
+
+}
+}
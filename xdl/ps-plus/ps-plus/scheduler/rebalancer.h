@@ -0,0 +1,60 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef PS_SCHEDULER_REBALANCER_H_
+#define PS_SCHEDULER_REBALANCER_H_
+
+#include <string>
+#include <vector>
+
+#include "ps-plus/common/status.h"
+#include "ps-plus/message/variable_info.h"
+#include "ps-plus/message/server_load.h"
+
+namespace ps {
+namespace scheduler {
+
+// Plans moves of whole variable parts from the busiest servers to the
+// idlest ones, using the load every server reported for the last window.
+class Rebalancer {
+ public:
+  struct Arg {
+    // servers are balanced once they are within (1 + band) * mean
+    double band;
+    size_t max_moves;
+  };
+  struct Move {
+    std::string name;
+    size_t part;
+    size_t from;
+    size_t to;
+  };
+
+  // loads[i] is the report of server i, outputs are the infos after all
+  // moves. An empty moves means the cluster is already within the band.
+  static Status Plan(const std::vector<VariableInfo>& inputs,
+                     const std::vector<ServerLoad>& loads,
+                     const Arg& arg,
+                     std::vector<VariableInfo>* outputs,
+                     std::vector<Move>* moves);
+
+  // Busy time of the part, with 1KB of request payload costing about as
+  // much as 1us of udf time.
+  static double Score(const VariableLoad& load);
+};
+
+}
+}
+
+#endif // PS_SCHEDULER_REBALANCER_H_
@@ -0,0 +1,156 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/scheduler/resharder.h"
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+namespace ps {
+namespace scheduler {
+
+namespace {
+
+using Ranges = std::set<std::tuple<std::string, size_t, size_t>>;
+
+void CollectRanges(const std::vector<VariableInfo>& infos, std::map<size_t, Ranges>* ranges) {
+  for (auto& info : infos) {
+    size_t beg = 0;
+    for (auto& part : info.parts) {
+      (*ranges)[part.server].insert(std::make_tuple(info.name, beg, beg + part.size));
+      beg += part.size;
+    }
+  }
+}
+
+}
+
+Status Resharder::Plan(const std::vector<VariableInfo>& inputs,
+                       size_t old_server_num,
+                       size_t new_server_num,
+                       std::vector<VariableInfo>* outputs,
+                       std::set<size_t>* affected) {
+  if (old_server_num == 0 || new_server_num == 0) {
+    return Status::ArgumentError("Resharder: server num should be positive");
+  }
+  for (auto& info : inputs) {
+    for (auto& part : info.parts) {
+      if (part.server >= old_server_num) {
+        return Status::ArgumentError("Resharder: variable " + info.name + " is placed on server "
+                                     + std::to_string(part.server) + " out of the cluster");
+      }
+    }
+  }
+
+  *outputs = inputs;
+  for (size_t id = old_server_num; id < new_server_num; id++) {
+    AddServer(id, outputs);
+  }
+  for (size_t id = old_server_num; id > new_server_num; id--) {
+    DrainServer(id - 1, new_server_num, outputs);
+  }
+
+  std::map<size_t, Ranges> old_ranges, new_ranges;
+  CollectRanges(inputs, &old_ranges);
+  CollectRanges(*outputs, &new_ranges);
+  affected->clear();
+  for (size_t id = 0; id < std::max(old_server_num, new_server_num); id++) {
+    if (old_ranges[id] != new_ranges[id]) {
+      affected->insert(id);
+    }
+  }
+  return Status::Ok();
+}
+
+void Resharder::AddServer(size_t id, std::vector<VariableInfo>* infos) {
+  for (auto& info : *infos) {
+    // a single part is a variable that can't or needn't be split
+    if (info.parts.size() < 2) {
+      continue;
+    }
+    size_t k = 0;
+    for (size_t i = 1; i + 1 < info.parts.size(); i++) {
+      if (info.parts[i].size + info.parts[i + 1].size > info.parts[k].size + info.parts[k + 1].size) {
+        k = i;
+      }
+    }
+    // Take a third of the pair, the tail of the left part and the head of
+    // the right one, so the new part sits between them.
+    VariableInfo::Part& left = info.parts[k];
+    VariableInfo::Part& right = info.parts[k + 1];
+    size_t total = left.size + right.size;
+    size_t take = total / 3;
+    size_t take_left = std::min(take * left.size / total, left.size - 1);
+    size_t take_right = std::min(take - take_left, right.size - 1);
+    if (take_left + take_right == 0) {
+      continue;
+    }
+    left.size -= take_left;
+    right.size -= take_right;
+    info.parts.insert(info.parts.begin() + k + 1,
+                      VariableInfo::Part{.server = id, .size = take_left + take_right});
+  }
+}
+
+void Resharder::DrainServer(size_t id, size_t remaining, std::vector<VariableInfo>* infos) {
+  std::vector<size_t> part_count(remaining, 0);
+  for (auto& info : *infos) {
+    for (auto& part : info.parts) {
+      if (part.server < remaining) {
+        part_count[part.server]++;
+      }
+    }
+  }
+  for (auto& info : *infos) {
+    size_t k = 0;
+    while (k < info.parts.size() && info.parts[k].server != id) {
+      k++;
+    }
+    if (k == info.parts.size()) {
+      continue;
+    }
+    if (info.parts.size() == 1) {
+      // the whole variable goes to the server holding the fewest parts
+      size_t target = 0;
+      for (size_t i = 1; i < remaining; i++) {
+        if (part_count[i] < part_count[target]) {
+          target = i;
+        }
+      }
+      info.parts[0].server = target;
+      part_count[target]++;
+      continue;
+    }
+    // The neighbours grow into the drained range, each in proportion to
+    // its own size, which keeps the parts contiguous.
+    size_t size = info.parts[k].size;
+    if (k == 0) {
+      info.parts[1].size += size;
+    } else if (k + 1 == info.parts.size()) {
+      info.parts[k - 1].size += size;
+    } else {
+      VariableInfo::Part& left = info.parts[k - 1];
+      VariableInfo::Part& right = info.parts[k + 1];
+      size_t give_left = size * left.size / (left.size + right.size);
+      left.size += give_left;
+      right.size += size - give_left;
+    }
+    info.parts.erase(info.parts.begin() + k);
+  }
+}
+
+}
+}
@@ -0,0 +1,52 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_SCHEDULER_RESHARDER_H_
+#define PS_SCHEDULER_RESHARDER_H_
+
+#include <set>
+#include <vector>
+
+#include "ps-plus/common/status.h"
+#include "ps-plus/message/variable_info.h"
+
+namespace ps {
+namespace scheduler {
+
+// Plans the placement of a cluster growing or shrinking to server_num
+// servers while keeping every other row where it is. A new server takes a
+// slice from the two adjacent parts holding the most rows, a drained
+// server hands its part to its neighbours, so only about 1/N of the rows
+// of each variable change server.
+class Resharder {
+ public:
+  // Servers are added after and drained from the end of the id range.
+  // affected are the servers whose rows change, all others keep serving
+  // their parts untouched.
+  static Status Plan(const std::vector<VariableInfo>& inputs,
+                     size_t old_server_num,
+                     size_t new_server_num,
+                     std::vector<VariableInfo>* outputs,
+                     std::set<size_t>* affected);
+ private:
+  static void AddServer(size_t id, std::vector<VariableInfo>* infos);
+  // parts of single part variables move to a server below remaining
+  static void DrainServer(size_t id, size_t remaining, std::vector<VariableInfo>* infos);
+};
+
+}
+}
+
+#endif // PS_SCHEDULER_RESHARDER_H_
@@ -22,6 +22,7 @@ limitations under the License.
 #include <cstdlib>
 
 #include "ps-plus/common/logging.h"
+#include "ps-plus/common/metrics_collector.h"
 #include "ps-plus/common/string_utils.h"
 #include "ps-plus/common/file_system.h"
 #include "ps-plus/common/serializer.h"
@@ -34,6 +35,9 @@ using namespace ps::scheduler;
 using namespace std;
 using namespace std::chrono;
 
+static const size_t kStandbyWaitSeconds = 120;
+static const int64_t kStragglerCheckSeconds = 10;
+
 SchedulerImpl::SchedulerImpl(
     const string& server_count,
     const string& scheduler_addr,
@@ -42,7 +46,8 @@ SchedulerImpl::SchedulerImpl(
     const string& streaming_dense_model_addr,
     const string& streaming_sparse_model_addr,
     const string& streaming_hash_model_addr,
-    bool bind_cores)
+    bool bind_cores,
+    size_t server_replicas)
     : main_thread_(nullptr), meta_thread_(nullptr), stopped_(false), ready_(false),
       version_(kUnusedVersion),
       server_count_(server_count),
@@ -51,16 +56,45 @@ SchedulerImpl::SchedulerImpl(
       streaming_dense_model_addr_(streaming_dense_model_addr),
       streaming_sparse_model_addr_(streaming_sparse_model_addr),
       streaming_hash_model_addr_(streaming_hash_model_addr) {
-  service_.reset(new SchedulerService(this, server_count, scheduler_addr, bind_cores));
+  service_.reset(new SchedulerService(this, server_count, scheduler_addr, bind_cores, server_replicas));
   char* vp_var = std::getenv("vp_method");
   char* meta_var = std::getenv("meta_dir");
   if (vp_var != NULL ) { vp_string_ = vp_var; }
   if (meta_var != NULL) { meta_string_ = meta_var; }
   else { meta_string_ = ""; }
   if (vp_string_ == "balance") { placementer_ = GetPlugin<Placementer>("Balance"); }
+  else if (vp_string_ == "locality") { placementer_ = GetPlugin<Placementer>("Locality"); }
   else { placementer_ = GetPlugin<Placementer>("BalanceV2"); }
+  // rebalance_interval is in seconds, 0 keeps the placement fixed
+  char* rebalance_interval = std::getenv("rebalance_interval");
+  char* rebalance_band = std::getenv("rebalance_band");
+  char* rebalance_max_moves = std::getenv("rebalance_max_moves");
+  rebalance_interval_ = rebalance_interval == NULL ? 0 : atoi(rebalance_interval);
+  rebalance_arg_.band = rebalance_band == NULL ? 0.2 : atof(rebalance_band);
+  rebalance_arg_.max_moves = rebalance_max_moves == NULL ? 2 : atoi(rebalance_max_moves);
+  // workers wait for barriers in groups of barrier_group_size
+  char* barrier_group_size = std::getenv("barrier_group_size");
+  barrier_group_size_ = barrier_group_size == NULL ? 32 : atoi(barrier_group_size);
+  // sync mode moves on without the slowest sync_backup_workers workers
+  char* sync_backup_workers = std::getenv("sync_backup_workers");
+  sync_backup_workers_ = sync_backup_workers == NULL ? 0 : atoi(sync_backup_workers);
+  // the global queues checkpoint incrementally to the ReliableKV if set
+  char* global_queue_kv = std::getenv("global_queue_kv");
+  if (global_queue_kv != NULL) { global_queue_kv_addr_ = global_queue_kv; }
+  // workers stepping under straggler_ratio of the median lease fewer files,
+  // 0 disables the detection
+  char* straggler_ratio = std::getenv("straggler_ratio");
+  char* straggler_min_steps = std::getenv("straggler_min_steps");
+  char* straggler_chronic_checks = std::getenv("straggler_chronic_checks");
+  StragglerDetector::Arg straggler_arg;
+  straggler_arg.slow_ratio = straggler_ratio == NULL ? 0 : atof(straggler_ratio);
+  straggler_arg.min_steps = straggler_min_steps == NULL ? 20 : atoi(straggler_min_steps);
+  straggler_arg.chronic_checks = straggler_chronic_checks == NULL ? 30 : atoi(straggler_chronic_checks);
+  if (straggler_arg.slow_ratio > 0) { straggler_.reset(new StragglerDetector(straggler_arg)); }
   lazy_queue_.reset(new ThreadPool(1));
   synchronizer_queue_.reset(new ThreadPool(1));
+  barrier_queue_.reset(new ThreadPool(4));
+  worker_barrier_.reset(new GroupBarrier(barrier_group_size_, barrier_queue_.get()));
 }
 
 SchedulerImpl::~SchedulerImpl() {
@@ -69,6 +103,10 @@ SchedulerImpl::~SchedulerImpl() {
     main_thread_->join();
     if (vp_string_ == "anneal" && !meta_string_.empty()) { meta_thread_->join(); }
   }
+  if (rebalance_thread_) {
+    stopped_ = true;
+    rebalance_thread_->join();
+  }
 }
 
 Status SchedulerImpl::Start() {
@@ -79,6 +117,9 @@ Status SchedulerImpl::Start() {
   if (vp_string_ == "anneal" && !meta_string_.empty()) { 
     meta_thread_.reset(new thread(&SchedulerImpl::WriteMetaInfo, this)); 
   }
+  if (rebalance_interval_ > 0) {
+    rebalance_thread_.reset(new thread(&SchedulerImpl::RebalanceLoop, this));
+  }
   service_->Start();
   LOG(INFO) << "Started scheduler main thread";
   return Status::Ok();
@@ -95,6 +136,39 @@ Status SchedulerImpl::RegisterServer(const ServerInfo& server) {
     LOG(INFO) << "Skip Disconnected Server " << server.ToString();
     return Status::ArgumentError("you are died.");
   }
+  if (server.GetReplica() != 0) {
+    if (server.GetServerType() != 0 || server.GetReplica() > service_->GetServerReplicas()
+        || server.GetId() >= (ServerId)service_->GetServerSize(0)) {
+      return Status::ArgumentError("Unexpected replica " + server.ToString());
+    }
+    const std::pair<ServerId, size_t> id(server.GetId(), server.GetReplica());
+    const auto& it = replicas_.find(id);
+    if (it == replicas_.end()) {
+      replicas_[id] = server;
+      service_->SetReplica(id.first, id.second, server.Address());
+      LOG(INFO) << "Added new replica " << server.ToString();
+    } else if (it->second != server) {
+      // A restarted replica is restored together with the whole cluster.
+      ready_ = false;
+      r_ready_ = false;
+      ServerInfo old_server = it->second;
+      replicas_[id] = server;
+      service_->SetReplica(id.first, id.second, server.Address());
+      LOG(INFO) << "Replica" << old_server.ToString() << " failed And Restore at " << server.ToString();
+      disconnected_server_.insert(old_server);
+      op_cv_.notify_all();
+    }
+    return Status::Ok();
+  }
+  if (server.GetServerType() == 0 && server.GetId() >= (ServerId)service_->GetServerSize(0)) {
+    const auto& it = standby_.find(server.GetId());
+    if (it == standby_.end() || it->second != server) {
+      standby_[server.GetId()] = server;
+      service_->SetServer(0, server.GetId(), server.Address());
+      LOG(INFO) << "Added standby server " << server.ToString();
+    }
+    return Status::Ok();
+  }
   const std::pair<ServerType, ServerId> id(server.GetServerType(), server.GetId());
   const auto& it = servers_.find(id);
   if (it == servers_.end()) {
@@ -121,6 +195,7 @@ Status SchedulerImpl::GetClusterInfo(const Version version, ClusterInfo* result)
   if (!ready_) { return Status::NotReady("Cluster is not ready"); }
   if (version != version_) { return VersionMismatch(version_, version); }
   for (const auto& it: servers_) { result->AddServer(it.second); }
+  for (const auto& it: replicas_) { result->AddServer(it.second); }
   for (int i = 0; i < service_->GetServerTypeSize(); i++) {
     result->server_size_.push_back(service_->GetServerSize(i));
   }
@@ -137,6 +212,74 @@ void SchedulerImpl::Restore(Version version, const string& checkpoint,
   AssignOp(kRestore, version, checkpoint, cb);
 }
 
+void SchedulerImpl::ResizeServers(Version version, int server_num,
+                                  OpCallback cb) {
+  {
+    unique_lock<mutex> lock(m_);
+    if (server_num <= 0) {
+      lock.unlock();
+      cb(Status::ArgumentError("Resize servers to " + to_string(server_num)));
+      return;
+    }
+    if (!replicas_.empty() || service_->GetServerTypeSize() != 1) {
+      lock.unlock();
+      cb(Status::ArgumentError("Resize servers needs a cluster of type 0 servers without replicas"));
+      return;
+    }
+  }
+  AssignOp(kResize, version, to_string(server_num), cb);
+}
+
+void SchedulerImpl::GetClusterStats(
+    Version version,
+    function<void (const Status&, const ClusterStats&)> cb) {
+  size_t server_size;
+  {
+    unique_lock<mutex> lock(m_);
+    if (!ready_) {
+      lock.unlock();
+      cb(Status::NotReady("Cluster is not ready"), ClusterStats());
+      return;
+    }
+    if (version != version_) {
+      Status st = VersionMismatch(version_, version);
+      lock.unlock();
+      cb(st, ClusterStats());
+      return;
+    }
+    server_size = service_->GetServerSize(0);
+  }
+  struct Collect {
+    mutex mu;
+    Status st;
+    size_t count_down;
+    ClusterStats stats;
+  };
+  std::shared_ptr<Collect> collect = std::make_shared<Collect>();
+  collect->count_down = server_size;
+  collect->stats.servers.resize(server_size);
+  if (server_size == 0) {
+    cb(Status::Ok(), collect->stats);
+    return;
+  }
+  for (size_t i = 0; i < server_size; i++) {
+    service_->ServerGetStats(i, version, [i, collect, cb](Status st, const ServerStats& stats) {
+      unique_lock<mutex> lock(collect->mu);
+      if (!st.IsOk() && collect->st.IsOk()) {
+        collect->st = st;
+      }
+      collect->stats.servers[i] = stats;
+      if (--collect->count_down == 0) {
+        lock.unlock();
+        if (collect->st.IsOk()) {
+          collect->stats.Aggregate();
+        }
+        cb(collect->st, collect->stats);
+      }
+    });
+  }
+}
+
 void SchedulerImpl::TriggerStreamingDense(Version version, const std::string& stream_version, OpCallback cb) {
   lazy_queue_->Schedule([=](){cb(InternalTriggerStreamingDense(version, stream_version));});
 }
@@ -151,20 +294,48 @@ Status SchedulerImpl::InitGlobalQueue(
   auto it = global_file_queues_.find(name);
   if (it == global_file_queues_.end()) {
     global_file_queues_[name].reset(new GlobalFileQueue());
+    for (auto& item : lease_scales_) {
+      global_file_queues_[name]->SetLeaseScale(item.first, item.second);
+    }
   }
 
   return global_file_queues_[name]->Init(
       paths, epochs, epoch_isolate);
 }
 
+std::shared_ptr<GlobalFileQueue> SchedulerImpl::GetGlobalQueue(
+    const std::string& name) {
+  std::unique_lock<std::mutex> lock(mu_);
+  auto it = global_file_queues_.find(name);
+  return it == global_file_queues_.end() ? nullptr : it->second;
+}
+
 Status SchedulerImpl::GetNextFile(
     Version version, 
     const std::string& name,
     size_t worker_id, 
     WorkerState* ws) {
-  std::unique_lock<std::mutex> lock(mu_);
-  return global_file_queues_[name]->GetNextFile(
-      worker_id, ws);
+  // the queues lock by themselves, mu_ only guards the lookup
+  std::shared_ptr<GlobalFileQueue> queue = GetGlobalQueue(name);
+  if (queue == nullptr) {
+    return Status::FileQueueNeedWait("global queue " + name + " not initialized");
+  }
+
+  return queue->GetNextFile(worker_id, ws);
+}
+
+Status SchedulerImpl::GetNextFiles(
+    Version version, 
+    const std::string& name,
+    size_t worker_id, 
+    size_t count,
+    std::vector<WorkerState>* ws) {
+  std::shared_ptr<GlobalFileQueue> queue = GetGlobalQueue(name);
+  if (queue == nullptr) {
+    return Status::FileQueueNeedWait("global queue " + name + " not initialized");
+  }
+
+  return queue->GetNextFiles(worker_id, count, ws);
 }
 
 Status SchedulerImpl::ReportWorkerState(
@@ -172,18 +343,24 @@ Status SchedulerImpl::ReportWorkerState(
     const std::string& name,
     size_t worker_id,
     const std::vector<ps::WorkerState>& worker_states) {
-  std::unique_lock<std::mutex> lock(mu_);
-  return global_file_queues_[name]->ReportWorkerState(
-      worker_id, worker_states);
+  std::shared_ptr<GlobalFileQueue> queue = GetGlobalQueue(name);
+  if (queue == nullptr) {
+    return Status::NotFound("global queue " + name + " not found");
+  }
+
+  return queue->ReportWorkerState(worker_id, worker_states);
 }
 
 Status SchedulerImpl::RestoreWorkerState(
     Version version, 
     const std::string& name,
     size_t worker_id) {
-  std::unique_lock<std::mutex> lock(mu_);
-  return global_file_queues_[name]->RestoreWorkerState(
-      worker_id);
+  std::shared_ptr<GlobalFileQueue> queue = GetGlobalQueue(name);
+  if (queue == nullptr) {
+    return Status::NotFound("global queue " + name + " not found");
+  }
+
+  return queue->RestoreWorkerState(worker_id);
 }
 
 void SchedulerImpl::TriggerStreamingSparse(Version version, const std::string& stream_version, OpCallback cb) {
@@ -263,7 +440,7 @@ Status SchedulerImpl::InternalUpdateVariableInfo(const vector<VariableInfo>& inf
   for (const auto& i: variable_info_) { m[i.name] = i; }
 
   // fill in new args
-  std::vector<std::string> arg_names{"save_ratio", "batch_read", "mem_ratio", "no_split", "save", VariableInfo::ORIGIN_NAME, VariableInfo::ORIGIN_FILE_PATH};
+  std::vector<std::string> arg_names{"save_ratio", "batch_read", "mem_ratio", "no_split", "save", VariableInfo::PLACEMENT_GROUP, VariableInfo::ORIGIN_NAME, VariableInfo::ORIGIN_FILE_PATH};
   for (const auto& i: info) {
     for (auto& arg_name: arg_names) {
       auto it = i.args.find(arg_name);
@@ -368,6 +545,22 @@ void SchedulerImpl::MainLoop() {
       if (sync_) { sync_->Reset(); }
       break;
     }
+    case kRebalance: {
+      LOG(INFO) << "Rebalancing through checkpoint " << op_checkpoint_;
+      Status st = InternalRebalance(op_checkpoint_);
+      LOG(INFO) << "Rebalancing through checkpoint " << op_checkpoint_ << ", Get Status " << st.ToString();
+      op_cb_(st);
+      if (sync_) { sync_->Reset(); }
+      break;
+    }
+    case kResize: {
+      LOG(INFO) << "Resizing servers to " << op_checkpoint_;
+      Status st = InternalResize(atoi(op_checkpoint_.c_str()));
+      LOG(INFO) << "Resizing servers to " << op_checkpoint_ << ", Get Status " << st.ToString();
+      op_cb_(st);
+      if (sync_) { sync_->Reset(); }
+      break;
+    }
     default: {
       LOG(FATAL) << "Invalid op code " << op_code_;
       abort();
@@ -400,6 +593,8 @@ string SchedulerImpl::OpName(OpCode code) {
   switch (code) {
   case kSave:    return "save";
   case kRestore: return "restore";
+  case kRebalance: return "rebalance";
+  case kResize: return "resize";
   default: {
     LOG(FATAL) << "Invalid op code " << code;
     abort();
@@ -448,7 +643,8 @@ void SchedulerImpl::WaitForServers() {
   while (true) {
     {
       unique_lock<mutex> lock(m_);
-      const size_t n = service_->GetServerTotalSize() - servers_.size();
+      const size_t n = service_->GetServerTotalSize() + service_->GetServerReplicas() * service_->GetServerSize(0)
+                       - servers_.size() - replicas_.size();
       if (n == 0) { return; }
       LOG(INFO) << "Waiting for " << n << " more server";
     }
@@ -491,7 +687,7 @@ Status SchedulerImpl::InternalRestore(const string& checkpoint) {
     PS_CHECK_STATUS(GenerateVariableInfo(real_checkpoint, &source_infos));
     PS_CHECK_STATUS(RestoreGlobalQueue(checkpoint_path_ + "/" + real_checkpoint));
 
-    count_down = service_->GetServerTotalSize();
+    count_down = service_->GetServerTotalSize() + replicas_.size();
     LOG(INFO) << "VariableInfos " << PrintVariableInfo(variable_info_);
     for (const auto& it: servers_) {
       const ServerInfo& server = it.second;
@@ -526,8 +722,29 @@ Status SchedulerImpl::InternalRestore(const string& checkpoint) {
             });
       }
     }
+    for (const auto& it: replicas_) {
+      const ServerId id = it.first.first;
+      const size_t replica = it.first.second;
+      service_->ReplicaRestore(
+          id, replica, version_,
+          source_infos, variable_info_, [id, replica, &result, &mu, &collect, &count_down](Status st) {
+            std::unique_lock<std::mutex> lock(mu);
+            if (!st.IsOk() && collect.IsOk()) {
+              collect = st;
+            }
+            if (--count_down == 0) {
+              lock.unlock();
+              result.set_value(collect);
+            }
+            LOG(INFO) << "replica " << id << "#" << replica << " finish restore, status " << (st.IsOk() ? "OK" : st.Msg()) << ", waiting " << count_down << " more";
+          });
+    }
   }
   result.get_future().wait();
+  if (collect.IsOk()) {
+    // Primaries and replicas hold the same rows now, forwarding starts here.
+    collect = SetReplicas();
+  }
   if (collect.IsOk()) {
     // enable
     unique_lock<mutex> lock(m_);
@@ -536,6 +753,37 @@ Status SchedulerImpl::InternalRestore(const string& checkpoint) {
   return collect;
 }
 
+Status SchedulerImpl::SetReplicas() {
+  map<ServerId, vector<string>> replica_addrs;
+  {
+    unique_lock<mutex> lock(m_);
+    for (const auto& it: replicas_) {
+      replica_addrs[it.first.first].push_back(it.second.Address());
+    }
+  }
+  if (replica_addrs.empty()) {
+    return Status::Ok();
+  }
+  std::promise<Status> result;
+  std::mutex mu;
+  Status collect;
+  size_t count_down = replica_addrs.size();
+  for (const auto& it: replica_addrs) {
+    service_->ServerSetReplicas(it.first, version_, it.second, [&result, &mu, &collect, &count_down](Status st) {
+      std::unique_lock<std::mutex> lock(mu);
+      if (!st.IsOk() && collect.IsOk()) {
+        collect = st;
+      }
+      if (--count_down == 0) {
+        lock.unlock();
+        result.set_value(collect);
+      }
+    });
+  }
+  result.get_future().wait();
+  return collect;
+}
+
 Status SchedulerImpl::GenerateVariableInfo(string real_checkpoint, vector<VariableInfo>* source) {
   std::string checkpoint = "";
   if (real_checkpoint != "") {
@@ -693,7 +941,15 @@ Status SchedulerImpl::InternalSave(const string& checkpoint) {
   FileSystem::RemoveAny(checkpoint_path_ + "/checkpoints");
   PS_CHECK_STATUS(FileSystem::RenameAny(checkpoint_path_ + "/checkpoints.tmp", checkpoint_path_ + "/checkpoints"));
 
-  {
+  if (!global_queue_kv_addr_.empty()) {
+    // the queues write the shards changed since the last checkpoint to
+    // the kv, the checkpoint only lists the queue names
+    std::unique_ptr<FileSystem::WriteStream> s;
+    PS_CHECK_STATUS(FileSystem::OpenWriteStreamAny(checkpoint_path_ + "/" + checkpoint + "/global_queue_kv", &s));
+    std::string queue_buf;
+    PS_CHECK_STATUS(CheckpointGlobalQueue(checkpoint_path_ + "/" + checkpoint, &queue_buf));
+    PS_CHECK_STATUS(s->WriteStr(queue_buf));
+  } else {
     std::unique_ptr<FileSystem::WriteStream> s;
     PS_CHECK_STATUS(FileSystem::OpenWriteStreamAny(checkpoint_path_ + "/" + checkpoint + "/global_queue_meta", &s));
     std::string queue_buf;
@@ -704,6 +960,232 @@ Status SchedulerImpl::InternalSave(const string& checkpoint) {
   return Status::Ok();;
 }
 
+void SchedulerImpl::RebalanceLoop() {
+  size_t waited = 0;
+  while (!stopped_) {
+    this_thread::sleep_for(seconds(1));
+    if (++waited < rebalance_interval_) {
+      continue;
+    }
+    waited = 0;
+    vector<VariableInfo> infos;
+    {
+      unique_lock<mutex> lock(m_);
+      if (!ready_ || op_code_ != kNone) { continue; }
+      infos = variable_info_;
+    }
+    vector<ServerLoad> loads;
+    Status st = CollectServerLoads(&loads);
+    if (!st.IsOk()) {
+      LOG(WARNING) << "Collect server loads failed: " << st.ToString();
+      continue;
+    }
+    vector<VariableInfo> outputs;
+    vector<Rebalancer::Move> moves;
+    st = Rebalancer::Plan(infos, loads, rebalance_arg_, &outputs, &moves);
+    if (!st.IsOk()) {
+      LOG(WARNING) << "Plan rebalance failed: " << st.ToString();
+      continue;
+    }
+    if (moves.empty()) { continue; }
+
+    unique_lock<mutex> lock(m_);
+    if (!ready_ || op_code_ != kNone) { continue; }
+    // variables registered meanwhile would be dropped by the planned infos
+    bool changed = infos.size() != variable_info_.size();
+    for (size_t i = 0; !changed && i < infos.size(); i++) {
+      changed = infos[i].name != variable_info_[i].name ||
+                infos[i].parts.size() != variable_info_[i].parts.size();
+    }
+    if (changed) { continue; }
+    for (const auto& move: moves) {
+      LOG(INFO) << "Rebalance variable " << move.name << " part " << move.part
+                << " from server " << move.from << " to server " << move.to;
+    }
+    rebalance_info_ = outputs;
+    op_code_ = kRebalance;
+    op_checkpoint_ = "rebalance_" + to_string(
+        duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count());
+    op_cb_ = [](const Status&){};
+    op_cv_.notify_all();
+  }
+}
+
+Status SchedulerImpl::CollectServerLoads(vector<ServerLoad>* loads) {
+  std::promise<Status> result;
+  std::mutex mu;
+  Status collect;
+  size_t count_down;
+  Version version;
+  {
+    unique_lock<mutex> lock(m_);
+    version = version_;
+    count_down = service_->GetServerSize(0);
+  }
+  loads->resize(count_down);
+  if (count_down == 0) {
+    return Status::Ok();
+  }
+  for (size_t i = 0; i < loads->size(); i++) {
+    service_->ServerGetLoad(i, version, [i, loads, &result, &mu, &collect, &count_down](Status st, const ServerLoad& load) {
+      std::unique_lock<std::mutex> lock(mu);
+      if (!st.IsOk() && collect.IsOk()) {
+        collect = st;
+      }
+      (*loads)[i] = load;
+      if (--count_down == 0) {
+        lock.unlock();
+        result.set_value(collect);
+      }
+    });
+  }
+  result.get_future().wait();
+  return collect;
+}
+
+Status SchedulerImpl::InternalRebalance(const string& checkpoint) {
+  // The checkpoint keeps the current placement, the restore loads its
+  // rows into the planned one and bumps the version, so clients fail over
+  // and pick up the new routing.
+  PS_CHECK_STATUS(InternalSave(checkpoint));
+  {
+    unique_lock<mutex> lock(m_);
+    variable_info_ = rebalance_info_;
+  }
+  return InternalRestore(checkpoint);
+}
+
+Status SchedulerImpl::RunOnServers(const vector<size_t>& ids,
+                                   function<void (size_t, function<void (Status)>)> fn) {
+  if (ids.empty()) {
+    return Status::Ok();
+  }
+  std::promise<Status> result;
+  std::mutex mu;
+  Status collect;
+  size_t count_down = ids.size();
+  for (size_t id : ids) {
+    fn(id, [id, &result, &mu, &collect, &count_down](Status st) {
+      std::unique_lock<std::mutex> lock(mu);
+      if (!st.IsOk() && collect.IsOk()) {
+        collect = st;
+      }
+      if (--count_down == 0) {
+        lock.unlock();
+        result.set_value(collect);
+      }
+      LOG(INFO) << "server " << id << " finish resize step, status " << (st.IsOk() ? "OK" : st.Msg()) << ", waiting " << count_down << " more";
+    });
+  }
+  result.get_future().wait();
+  return collect;
+}
+
+Status SchedulerImpl::InternalResize(size_t server_num) {
+  size_t old_num;
+  {
+    unique_lock<mutex> lock(m_);
+    old_num = service_->GetServerSize(0);
+  }
+  if (server_num == old_num) {
+    return Status::Ok();
+  }
+  // servers register every few seconds, give the new ones some time
+  for (size_t waited = 0; ; waited++) {
+    size_t missing = 0;
+    {
+      unique_lock<mutex> lock(m_);
+      for (size_t id = old_num; id < server_num; id++) {
+        if (standby_.find(id) == standby_.end()) { missing++; }
+      }
+    }
+    if (missing == 0) { break; }
+    if (waited >= kStandbyWaitSeconds) {
+      return Status::Timeout("Resize servers: " + to_string(missing) + " standby servers not registered");
+    }
+    LOG(INFO) << "Waiting for " << missing << " more standby server";
+    this_thread::sleep_for(seconds(1));
+  }
+
+  vector<VariableInfo> old_infos, new_infos;
+  set<size_t> affected;
+  Version old_version, fence_version, new_version;
+  {
+    unique_lock<mutex> lock(m_);
+    if (!ready_) {
+      return Status::NotReady("Resize servers: cluster not ready");
+    }
+    old_infos = variable_info_;
+    PS_CHECK_STATUS(Resharder::Plan(old_infos, old_num, server_num, &new_infos, &affected));
+    // Clients see the cluster not ready and the servers a version they
+    // don't know until the rows are settled.
+    ready_ = false;
+    r_ready_ = true;
+    old_version = version_;
+    fence_version = NewRandomVersion();
+    new_version = NewRandomVersion();
+    version_ = fence_version;
+  }
+  // Every resize overwrites the parts it reads back, the directory is not
+  // a checkpoint to restore from.
+  string dir = checkpoint_path_ + "/__reshard__";
+  vector<size_t> old_servers, saves, restores, bumps;
+  for (size_t id = 0; id < old_num; id++) {
+    old_servers.push_back(id);
+    if (affected.count(id) != 0) { saves.push_back(id); }
+  }
+  for (size_t id = 0; id < server_num; id++) {
+    if (affected.count(id) != 0) { restores.push_back(id); }
+    else { bumps.push_back(id); }
+  }
+  LOG(INFO) << "Resize servers from " << old_num << " to " << server_num << ", "
+            << saves.size() << " servers save and " << restores.size() << " restore";
+
+  // Any failure leaves the cluster not ready, and the main loop restores
+  // the latest checkpoint.
+  PS_CHECK_STATUS(RunOnServers(old_servers, [&](size_t id, function<void (Status)> cb) {
+    service_->ServerBumpVersion(id, old_version, fence_version, cb);
+  }));
+  PS_CHECK_STATUS(RunOnServers(saves, [&](size_t id, function<void (Status)> cb) {
+    service_->ServerSave(0, id, fence_version, dir, old_infos, cb);
+  }));
+  vector<VariableInfo> from = old_infos, to = new_infos;
+  for (auto& info : from) {
+    info.args[VariableInfo::ORIGIN_FILE_PATH] = dir;
+    info.args[VariableInfo::ORIGIN_NAME] = info.name;
+  }
+  for (auto& info : to) {
+    info.args[VariableInfo::ORIGIN_FILE_PATH] = dir;
+  }
+  PS_CHECK_STATUS(RunOnServers(restores, [&](size_t id, function<void (Status)> cb) {
+    service_->ServerRestore(0, id, new_version, from, to, cb);
+  }));
+  PS_CHECK_STATUS(RunOnServers(bumps, [&](size_t id, function<void (Status)> cb) {
+    service_->ServerBumpVersion(id, fence_version, new_version, cb);
+  }));
+
+  {
+    unique_lock<mutex> lock(m_);
+    for (size_t id = server_num; id < old_num; id++) {
+      auto it = servers_.find(std::make_pair((ServerType)0, (ServerId)id));
+      if (it != servers_.end()) {
+        standby_[id] = it->second;
+        servers_.erase(it);
+      }
+    }
+    for (size_t id = old_num; id < server_num; id++) {
+      servers_[std::make_pair((ServerType)0, (ServerId)id)] = standby_[id];
+      standby_.erase(id);
+    }
+    service_->SetServerSize(server_num);
+    variable_info_ = new_infos;
+    version_ = new_version;
+    ready_ = r_ready_;
+  }
+
+  return Status::Ok();
+}
+
 Status SchedulerImpl::InternalTriggerStreamingDense(Version version, const std::string& stream_version) {
   vector<ps::VariableInfo> variable_info;
   {
@@ -956,7 +1438,7 @@ void SchedulerImpl::InternalAsynchronizeEnter(Version version, int id, int stale
     return;
   }
   if (!sync_) {
-    auto sync = new Asynchronizer(staleness, worker_count);
+    auto sync = new Asynchronizer(staleness, worker_count, barrier_queue_.get(), barrier_group_size_);
     sync_.reset(sync);
   }
   auto sync = dynamic_cast<Asynchronizer*>(sync_.get());
@@ -964,6 +1446,7 @@ void SchedulerImpl::InternalAsynchronizeEnter(Version version, int id, int stale
     LOG(ERROR) << "Call Async method in sync mode.";
     cb(Status::ArgumentError("Call Async method in sync mode."));
   }
+  WorkerStep(id);
   sync->Enter(id, cb);
 }
 
@@ -981,22 +1464,12 @@ void SchedulerImpl::InternalWorkerReportFinish(Version version, int id, function
   }
 
   finished_workers_.insert(id);
-
-  {
-    auto iter = worker_barriers_.find(id);
-    if (iter != worker_barriers_.end()) {
-      worker_barriers_.erase(iter);
-    }
-
-    if (worker_barriers_.size() == worker_count_ - finished_workers_.size()) {
-      for (auto iter : worker_barriers_) {
-        (iter.second)(Status::Ok());
-      }
-
-      worker_barriers_.clear();
-    }
+  if (straggler_) {
+    straggler_->Finish(id);
   }
 
+  worker_barrier_->Remove(id);
+
   {
     auto iter = barrier_infos_.find(id);
     if (iter != barrier_infos_.end()) {
@@ -1004,30 +1477,63 @@ void SchedulerImpl::InternalWorkerReportFinish(Version version, int id, function
     }
 
     if (barrier_infos_.size() == worker_count_ - finished_workers_.size()) {
-      for (auto iter : barrier_infos_) {
-        (iter.second.cb)(Status::Ok());
-      }
-
-      barrier_infos_.clear();
+      ReleaseBarrierV2();
     }
   }
 
   cb(Status::Ok());
 }
 
+void SchedulerImpl::WorkerStep(int id) {
+  if (!straggler_) {
+    return;
+  }
+  int64_t now = duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+  straggler_->Step(id, now);
+  if (straggler_checked_ == 0) {
+    straggler_checked_ = now;
+  } else if (now - straggler_checked_ >= kStragglerCheckSeconds * 1000000) {
+    straggler_checked_ = now;
+    CheckStragglers();
+  }
+}
+
+void SchedulerImpl::CheckStragglers() {
+  StragglerDetector::Result result = straggler_->Check();
+  common::MetricsCollector* metrics = common::MetricsCollector::Instance();
+  for (auto& item : result.scales) {
+    double rate = straggler_->Rate(item.first);
+    // steps per second in thousandths, dumped with the other histograms
+    metrics->GetHistogram("worker_step_rate_" + std::to_string(item.first))->Record(rate * 1000);
+  }
+  for (int id : result.slow) {
+    LOG(INFO) << "Worker " << id << " is slow, " << straggler_->Rate(id)
+              << " steps/s, lease scale " << result.scales[id];
+  }
+  for (int id : result.chronic) {
+    LOG(WARNING) << "Worker " << id << " has been slow for a long time, it should be replaced";
+  }
+
+  std::unique_lock<std::mutex> lock(mu_);
+  for (auto& item : result.scales) {
+    double& scale = lease_scales_[item.first];
+    if (scale == item.second) {
+      continue;
+    }
+    scale = item.second;
+    for (auto& queue : global_file_queues_) {
+      queue.second->SetLeaseScale(item.first, scale);
+    }
+  }
+}
+
 void SchedulerImpl::InternalWorkerBarrier(Version version, int id, int worker_count, function<void (const Status&)> cb) {
   worker_count_ = worker_count;
   if (version != version_) {
     cb(VersionMismatch(version_, version));
     return;
   }
-  worker_barriers_[id] = cb;
-  if (worker_barriers_.size() == worker_count - finished_workers_.size()) {
-    for (auto iter : worker_barriers_) {
-      (iter.second)(Status::Ok());
-    }
-    worker_barriers_.clear();
-  }
+  worker_barrier_->Enter(id, worker_count, cb);
 }
 
 void SchedulerImpl::InternalWorkerBarrierV2(
@@ -1086,12 +1592,17 @@ void SchedulerImpl::BarrierAddAndNotifyAll(
     int task_id, const BarrierV2Info& bi) {
   barrier_infos_[task_id] = bi;
   if (barrier_infos_.size() == worker_count_ - finished_workers_.size()) {
-    for (auto& it: barrier_infos_) {
-      (it.second.cb)(Status::Ok());
-    }
+    ReleaseBarrierV2();
+  }
+}
 
-    barrier_infos_.clear();
+void SchedulerImpl::ReleaseBarrierV2() {
+  vector<function<void (const Status&)>> cbs;
+  for (auto& it: barrier_infos_) {
+    cbs.push_back(it.second.cb);
   }
+  barrier_infos_.clear();
+  GroupBarrier::FanOut(barrier_group_size_, barrier_queue_.get(), &cbs);
 }
 
 void SchedulerImpl::InternalGetWorkerFinishCount(Version version, function<void (int64_t, const Status&)> cb) {
@@ -1110,7 +1621,7 @@ void SchedulerImpl::InternalSynchronizeEnter(Version version, int id, int worker
     return;
   }
   if (!sync_) {
-    auto sync = new Synchronizer(worker_count);
+    auto sync = new Synchronizer(worker_count, sync_backup_workers_);
     sync_.reset(sync);
   }
   auto sync = dynamic_cast<Synchronizer*>(sync_.get());
@@ -1118,6 +1629,7 @@ void SchedulerImpl::InternalSynchronizeEnter(Version version, int id, int worker
     LOG(ERROR) << "Call sync method in async mode.";
     cb(-1, Status::ArgumentError("Call sync method in async mode."));
   }
+  WorkerStep(id);
   sync->Enter(id, cb);    
 }
 
@@ -1141,6 +1653,14 @@ Status SchedulerImpl::RestoreGlobalQueue(const std::string& ckpt_dir) {
     std::string queue_state;
     PS_CHECK_STATUS(s->ReadStr(&queue_state));    
     PS_CHECK_STATUS(DeserializeGlobalQueue(queue_state));
+    return Status::Ok();
+  }
+
+  st = FileSystem::OpenReadStreamAny(ckpt_dir + "/global_queue_kv", &s);
+  if (st.IsOk()) {
+    std::string queue_names;
+    PS_CHECK_STATUS(s->ReadStr(&queue_names));
+    PS_CHECK_STATUS(RecoverGlobalQueue(ckpt_dir, queue_names));
   }
 
   return Status::Ok();
@@ -1165,7 +1685,7 @@ Status SchedulerImpl::SerializeGlobalQueue(std::string* buf) {
 }
 
 Status SchedulerImpl::DeserializeGlobalQueue(const std::string& buf) {
-  std::unordered_map<std::string, std::unique_ptr<GlobalFileQueue> > queues;
+  std::unordered_map<std::string, std::shared_ptr<GlobalFileQueue> > queues;
   char* ptr = const_cast<char*>(buf.data());
   size_t len = *(reinterpret_cast<size_t*>(ptr));
   ptr += sizeof(size_t);
@@ -1189,6 +1709,49 @@ Status SchedulerImpl::DeserializeGlobalQueue(const std::string& buf) {
   return Status::Ok();
 }
 
+Status SchedulerImpl::CheckpointGlobalQueue(const std::string& checkpoint, std::string* buf) {
+  std::vector<std::pair<std::string, std::shared_ptr<GlobalFileQueue> > > queues;
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    queues.assign(global_file_queues_.begin(), global_file_queues_.end());
+  }
+
+  size_t size = queues.size();
+  buf->append((char*)&size, sizeof(size_t));
+  for (auto& it: queues) {
+    PS_CHECK_STATUS(it.second->Checkpoint(global_queue_kv_addr_ + "/" + it.first, checkpoint));
+    size_t name_size = it.first.size();
+    buf->append((char*)&name_size, sizeof(size_t));    
+    buf->append((char*)it.first.data(), it.first.size());        
+  }
+
+  return Status::Ok();
+}
+
+Status SchedulerImpl::RecoverGlobalQueue(const std::string& checkpoint, const std::string& buf) {
+  if (global_queue_kv_addr_.empty()) {
+    return Status::ArgumentError("global queue of " + checkpoint + " is in the kv, global_queue_kv not set");
+  }
+
+  std::unordered_map<std::string, std::shared_ptr<GlobalFileQueue> > queues;
+  char* ptr = const_cast<char*>(buf.data());
+  size_t len = *(reinterpret_cast<size_t*>(ptr));
+  ptr += sizeof(size_t);
+  for (size_t i = 0; i < len; ++i) {
+    size_t name_len = *(reinterpret_cast<size_t*>(ptr));    
+    ptr += sizeof(size_t);
+    std::string name;
+    name.assign(ptr, name_len);
+    ptr += name_len;
+    queues[name].reset(new GlobalFileQueue());
+    PS_CHECK_STATUS(queues[name]->Recover(global_queue_kv_addr_ + "/" + name, checkpoint));
+  }
+
+  std::unique_lock<std::mutex> lock(mu_);
+  global_file_queues_ = std::move(queues);
+  return Status::Ok();
+}
+
 Status SchedulerImpl::ReadCheckpoints(const std::string& ckpt_dir, bool ignoreError, std::vector<std::string>* checkpoints) {
   std::unique_ptr<FileSystem::ReadStream> s;
   Status st = FileSystem::OpenReadStreamAny(ckpt_dir + "/checkpoints", &s);
@@ -31,9 +31,14 @@ limitations under the License.
 #include "ps-plus/common/thread_pool.h"
 #include "ps-plus/message/streaming_model_manager.h"
 #include "ps-plus/message/worker_state.h"
+#include "ps-plus/message/variable_stats.h"
 
+#include "group_barrier.h"
 #include "placementer.h"
+#include "rebalancer.h"
+#include "resharder.h"
 #include "scheduler_service.h"
+#include "straggler_detector.h"
 #include "synchronizer.h"
 #include "ps-plus/common/global_file_queue.h"
 
@@ -41,7 +46,7 @@ namespace ps {
 namespace scheduler {
 
 enum OpCode {
-  kNone, kSave, kRestore
+  kNone, kSave, kRestore, kRebalance, kResize
 };
 
 using OpCallback = std::function<void (const ps::Status&)>;
@@ -56,7 +61,8 @@ class SchedulerImpl {
       const std::string& streaming_dense_model_addr,
       const std::string& streaming_sparse_model_addr,
       const std::string& streaming_hash_model_addr,
-      bool bind_cores = false);
+      bool bind_cores = false,
+      size_t server_replicas = 0);
   ~SchedulerImpl();
 
   Status Start();
@@ -66,6 +72,13 @@ class SchedulerImpl {
   Status GetClusterInfo(const Version version, ClusterInfo* result);
   void Save(Version version, const std::string& checkpoint, OpCallback cb);
   void Restore(Version version, const std::string& checkpoint, OpCallback cb);
+  // Grows or shrinks the type 0 servers to server_num in place, servers to
+  // add register with ids from the current size and wait as standby.
+  void ResizeServers(Version version, int server_num, OpCallback cb);
+  // Gathers the stats of the type 0 servers, cb runs on the reply of the
+  // last one without blocking the caller.
+  void GetClusterStats(Version version,
+                       std::function<void (const Status&, const ClusterStats&)> cb);
   void TriggerStreamingDense(Version version, const std::string& stream_version, OpCallback cb);
   void TriggerStreamingSparse(Version version, const std::string& stream_version, OpCallback cb);
   void TriggerStreamingHash(Version version, const std::string& stream_version, OpCallback cb);
@@ -80,6 +93,12 @@ class SchedulerImpl {
       const std::string& name,
       size_t worker_id, 
       WorkerState* ws);
+  Status GetNextFiles(
+      Version version, 
+      const std::string& name,
+      size_t worker_id, 
+      size_t count,
+      std::vector<WorkerState>* ws);
   Status ReportWorkerState(
       Version version, 
       const std::string& name,
@@ -119,22 +138,28 @@ class SchedulerImpl {
   };
 
   void BarrierAddAndNotifyAll(int task_id, const BarrierV2Info& bi);
+  void ReleaseBarrierV2();
 
  private:
   std::unique_ptr<std::thread> main_thread_;
   std::unique_ptr<std::thread> meta_thread_;
+  std::unique_ptr<std::thread> rebalance_thread_;
   bool stopped_;
   bool variable_info_updated_ = false;
     
   std::mutex m_;
   bool ready_;
   bool r_ready_;
-  std::map<int32_t, std::function<void (const Status&)>> worker_barriers_;
+  std::unique_ptr<GroupBarrier> worker_barrier_;
   int worker_count_ = 0;
   Version version_;
   std::set<int32_t> finished_workers_;
   std::string server_count_;
   std::map<std::pair<ServerType, ServerId>, ServerInfo> servers_;
+  // read replicas by (id, replica) of the type 0 server they follow
+  std::map<std::pair<ServerId, size_t>, ServerInfo> replicas_;
+  // type 0 servers beyond the cluster size, registered for a resize
+  std::map<ServerId, ServerInfo> standby_;
 
   ps::Status VersionMismatch(Version exp, Version act);
 
@@ -155,7 +180,18 @@ class SchedulerImpl {
   std::vector<ps::VariableInfo> variable_info_;
   Status InternalUpdateVariableInfo(const std::vector<VariableInfo>& info, std::vector<VariableInfo>* result);
   Status InternalRestore(const std::string& checkpoint);
+  Status SetReplicas();
   Status InternalSave(const std::string& checkpoint);
+  // Moves variable parts off overloaded servers by saving the cluster and
+  // restoring it with the planned placement.
+  void RebalanceLoop();
+  Status CollectServerLoads(std::vector<ServerLoad>* loads);
+  Status InternalRebalance(const std::string& checkpoint);
+  // Only the servers whose rows change save and restore, through a
+  // temporary checkpoint, the others just move to the new version.
+  Status InternalResize(size_t server_num);
+  Status RunOnServers(const std::vector<size_t>& ids,
+                      std::function<void (size_t, std::function<void (Status)>)> fn);
   Status InternalTriggerStreamingDense(Version version, const std::string& stream_version);
   Status InternalTriggerStreamingSparse(Version version, const std::string& stream_version);
   Status InternalTriggerStreamingHash(Version version, const std::string& stream_version);
@@ -170,25 +206,45 @@ class SchedulerImpl {
   void InternalGetWorkerFinishCount(Version version, std::function<void (int64_t, const Status&)> cb);
   void InternalWorkerBarrier(Version version, int id, int worker_count, std::function<void (const Status&)> cb);
   void InternalWorkerBarrierV2(Version version, int barrier_id, int task_id, int task_num, int token, std::function<void (const Status&)> cb);
+  // Tracks the step of worker id, the lease scales of the slow workers are
+  // updated on the global queues every kStragglerCheckSeconds.
+  void WorkerStep(int id);
+  void CheckStragglers();
   std::string static PrintVariableInfo(const std::vector<VariableInfo>& infos);
   Status GenerateVariableInfo(std::string real_checkpoint, std::vector<VariableInfo>* source);
   Status SerializeGlobalQueue(std::string* buf);
   Status DeserializeGlobalQueue(const std::string& buf);  
+  Status CheckpointGlobalQueue(const std::string& checkpoint, std::string* buf);
+  Status RecoverGlobalQueue(const std::string& checkpoint, const std::string& buf);
+  std::shared_ptr<GlobalFileQueue> GetGlobalQueue(const std::string& name);
   
   Placementer* placementer_;
   const std::string checkpoint_path_;
   const Placementer::Arg placement_arg_;
   std::string vp_string_;
   std::string meta_string_;
+  size_t rebalance_interval_;
+  Rebalancer::Arg rebalance_arg_;
+  std::vector<ps::VariableInfo> rebalance_info_;
 
   std::unique_ptr<SchedulerService> service_;
   std::unique_ptr<ThreadPool> lazy_queue_;
   std::unique_ptr<ThreadPool> synchronizer_queue_;
+  // replies to released barriers
+  std::unique_ptr<ThreadPool> barrier_queue_;
+  size_t barrier_group_size_;
+  int sync_backup_workers_;
 
   std::unique_ptr<SyncMechanism> sync_;
+  // null if straggler_ratio is 0, runs on the synchronizer queue
+  std::unique_ptr<StragglerDetector> straggler_;
+  int64_t straggler_checked_ = 0;
 
   std::mutex mu_;
-  std::unordered_map<std::string, std::unique_ptr<GlobalFileQueue> > global_file_queues_;
+  std::unordered_map<std::string, std::shared_ptr<GlobalFileQueue> > global_file_queues_;
+  std::string global_queue_kv_addr_;
+  // the lease scales of the slow workers, set on the queues created later
+  std::map<int, double> lease_scales_;
 
   std::string streaming_dense_model_addr_;
   std::string streaming_sparse_model_addr_;
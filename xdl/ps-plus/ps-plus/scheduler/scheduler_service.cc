@@ -94,6 +94,18 @@ Status SchedulerService::Start() {
              ps::service::seastar::DoneClosure* done) {
       Restore(inputs, outputs, done);
   });
+  seastar_lib_->RegisterServerFunc(func_ids::kSchedulerResizeServers,
+      [this](const std::vector<ps::Data*>& inputs,
+             std::vector<ps::Data*>* outputs,
+             ps::service::seastar::DoneClosure* done) {
+      ResizeServers(inputs, outputs, done);
+  });
+  seastar_lib_->RegisterServerFunc(func_ids::kSchedulerGetClusterStats,
+      [this](const std::vector<ps::Data*>& inputs,
+             std::vector<ps::Data*>* outputs,
+             ps::service::seastar::DoneClosure* done) {
+      GetClusterStats(inputs, outputs, done);
+  });
   seastar_lib_->RegisterServerFunc(func_ids::kSchedulerRegisterServer,
       [this](const std::vector<ps::Data*>& inputs,
              std::vector<ps::Data*>* outputs,
@@ -220,6 +232,10 @@ void SchedulerService::SetServer(int server_type, int server_id, const std::stri
   seastar_lib_->Connect(server_offset_[server_type] + server_id, server_addr, true, true);      
 }
 
+void SchedulerService::SetReplica(int server_id, size_t replica, const std::string& server_addr) {
+  seastar_lib_->Connect(ReplicaConnection(server_id, replica), server_addr, true, true);
+}
+
 //TODO: Add VariableInfos
 void SchedulerService::ServerSave(
     int server_type,
@@ -257,6 +273,108 @@ void SchedulerService::ServerRestore(
   }));
 }
 
+void SchedulerService::ReplicaRestore(
+    int server_id,
+    size_t replica,
+    Version version,
+    const std::vector<VariableInfo>& from,
+    const std::vector<VariableInfo>& to,
+    std::function<void(Status)> cb) {
+  std::vector<Data*> datas = {
+    new WrapperData<Version>(version),
+    new WrapperData<VariableInfoCollection>(VariableInfoCollection{.infos = from}),
+    new WrapperData<VariableInfoCollection>(VariableInfoCollection{.infos = to})
+  };
+  seastar_lib_->Request(ReplicaConnection(server_id, replica), func_ids::kServerRestore, datas,
+    new CallBackClosure([cb](const SeastarStatus& sst, const std::vector<ps::Data*>& datas) {
+      cb(GetNetworkStatus(sst, datas));
+  }));
+}
+
+void SchedulerService::ServerSetReplicas(
+    int server_id,
+    Version version,
+    const std::vector<std::string>& replica_addrs,
+    std::function<void(Status)> cb) {
+  std::vector<Data*> datas = {
+    new WrapperData<Version>(version),
+    new WrapperData<std::vector<std::string> >(replica_addrs)
+  };
+  seastar_lib_->Request(server_offset_[0] + server_id, func_ids::kServerSetReplicas, datas,
+    new CallBackClosure([cb](const SeastarStatus& sst, const std::vector<ps::Data*>& datas) {
+      cb(GetNetworkStatus(sst, datas));
+  }));
+}
+
+void SchedulerService::ServerBumpVersion(
+    int server_id,
+    Version version,
+    Version new_version,
+    std::function<void(Status)> cb) {
+  std::vector<Data*> datas = {
+    new WrapperData<Version>(version),
+    new WrapperData<Version>(new_version)
+  };
+  seastar_lib_->Request(server_offset_[0] + server_id, func_ids::kServerBumpVersion, datas,
+    new CallBackClosure([cb](const SeastarStatus& sst, const std::vector<ps::Data*>& datas) {
+      cb(GetNetworkStatus(sst, datas));
+  }));
+}
+
+void SchedulerService::ServerGetLoad(
+    int server_id,
+    Version version,
+    std::function<void(Status, const ServerLoad&)> cb) {
+  std::vector<Data*> datas = {
+    new WrapperData<Version>(version)
+  };
+  seastar_lib_->Request(server_offset_[0] + server_id, func_ids::kServerGetLoad, datas,
+    new CallBackClosure([cb](const SeastarStatus& sst, const std::vector<ps::Data*>& datas) {
+      Status st = GetNetworkStatus(sst, datas);
+      if (!st.IsOk()) {
+        cb(st, ServerLoad());
+        return;
+      }
+      if (datas.size() != 2) {
+        cb(Status::Unknown("ServerGetLoad Protocol Error, Size Error"), ServerLoad());
+        return;
+      }
+      WrapperData<ServerLoad>* result = dynamic_cast<WrapperData<ServerLoad>*>(datas[1]);
+      if (result == nullptr) {
+        cb(Status::Unknown("ServerGetLoad Protocol Error, Type Error"), ServerLoad());
+        return;
+      }
+      cb(Status::Ok(), result->Internal());
+  }));
+}
+
+void SchedulerService::ServerGetStats(
+    int server_id,
+    Version version,
+    std::function<void(Status, const ServerStats&)> cb) {
+  std::vector<Data*> datas = {
+    new WrapperData<Version>(version)
+  };
+  seastar_lib_->Request(server_offset_[0] + server_id, func_ids::kServerGetStats, datas,
+    new CallBackClosure([cb](const SeastarStatus& sst, const std::vector<ps::Data*>& datas) {
+      Status st = GetNetworkStatus(sst, datas);
+      if (!st.IsOk()) {
+        cb(st, ServerStats());
+        return;
+      }
+      if (datas.size() != 2) {
+        cb(Status::Unknown("ServerGetStats Protocol Error, Size Error"), ServerStats());
+        return;
+      }
+      WrapperData<ServerStats>* result = dynamic_cast<WrapperData<ServerStats>*>(datas[1]);
+      if (result == nullptr) {
+        cb(Status::Unknown("ServerGetStats Protocol Error, Type Error"), ServerStats());
+        return;
+      }
+      cb(Status::Ok(), result->Internal());
+  }));
+}
+
 void SchedulerService::ServerStreamingDenseVarName(
     int server_type,
     int server_id,
@@ -400,6 +518,46 @@ void SchedulerService::Save(const std::vector<Data*>& inputs, std::vector<Data*>
   });
 }
 
+void SchedulerService::ResizeServers(const std::vector<Data*>& inputs, std::vector<Data*>* outputs, ps::service::seastar::DoneClosure* done) {
+  if (inputs.size() != 2) {
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("SchedulerService ResizeServers: Need 2 inputs")));
+    done->Run();
+    return;
+  }
+  WrapperData<Version>* ver = dynamic_cast<WrapperData<Version>*>(inputs[0]);
+  WrapperData<int>* server_num = dynamic_cast<WrapperData<int>*>(inputs[1]);
+  if (ver == nullptr || server_num == nullptr) {
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("SchedulerService ResizeServers: Input Type Error")));
+    done->Run();
+    return;
+  }
+  impl_->ResizeServers(ver->Internal(), server_num->Internal(), [outputs, done](const Status& st) {
+    outputs->push_back(new WrapperData<Status>(st));
+    done->Run();
+  });
+}
+
+void SchedulerService::GetClusterStats(const std::vector<Data*>& inputs, std::vector<Data*>* outputs, ps::service::seastar::DoneClosure* done) {
+  if (inputs.size() != 1) {
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("SchedulerService GetClusterStats: Need 1 inputs")));
+    done->Run();
+    return;
+  }
+  WrapperData<Version>* ver = dynamic_cast<WrapperData<Version>*>(inputs[0]);
+  if (ver == nullptr) {
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("SchedulerService GetClusterStats: Input Type Error")));
+    done->Run();
+    return;
+  }
+  impl_->GetClusterStats(ver->Internal(), [outputs, done](const Status& st, const ClusterStats& stats) {
+    outputs->push_back(new WrapperData<Status>(st));
+    if (st.IsOk()) {
+      outputs->push_back(new WrapperData<ClusterStats>(stats));
+    }
+    done->Run();
+  });
+}
+
 void SchedulerService::Restore(const std::vector<Data*>& inputs, std::vector<Data*>* outputs, ps::service::seastar::DoneClosure* done) {
   if (inputs.size() != 2) {
     outputs->push_back(new WrapperData<Status>(Status::ArgumentError("SchedulerService Restore: Need 2 inputs")));
@@ -456,8 +614,8 @@ void SchedulerService::InitGlobalQueue(const std::vector<Data*>& inputs, std::ve
 }
 
 void SchedulerService::GetNextFile(const std::vector<Data*>& inputs, std::vector<Data*>* outputs, ps::service::seastar::DoneClosure* done) {
-  if (inputs.size() != 3) {
-    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("SchedulerService GetNextFile: Need 3 inputs")));
+  if (inputs.size() != 3 && inputs.size() != 4) {
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("SchedulerService GetNextFile: Need 3 or 4 inputs")));
     done->Run();
     return;
   }
@@ -471,6 +629,28 @@ void SchedulerService::GetNextFile(const std::vector<Data*>& inputs, std::vector
     return;
   }
 
+  // the 4th input leases count files, replied as (path, begin, epoch) each
+  // and none at the end of the queue
+  if (inputs.size() == 4) {
+    WrapperData<size_t>* count = dynamic_cast<WrapperData<size_t>*>(inputs[3]);
+    if (count == nullptr) {
+      outputs->push_back(new WrapperData<Status>(Status::ArgumentError("SchedulerService GetNextFile: Input Type Error")));
+      done->Run();
+      return;
+    }
+
+    std::vector<WorkerState> files;
+    Status st = impl_->GetNextFiles(ver->Internal(), name->Internal(), worker_id->Internal(), count->Internal(), &files);
+    outputs->push_back(new WrapperData<Status>(st));
+    for (auto& ws: files) {
+      outputs->push_back(new WrapperData<std::string>(ws.path_));
+      outputs->push_back(new WrapperData<size_t>(ws.begin_));
+      outputs->push_back(new WrapperData<size_t>(ws.epoch_));
+    }
+    done->Run();
+    return;
+  }
+
   WorkerState ws;
   Status st = impl_->GetNextFile(ver->Internal(), name->Internal() ,worker_id->Internal(), &ws);
   outputs->push_back(new WrapperData<Status>(st));
@@ -856,6 +1036,10 @@ void SchedulerService::UpdateVariableVisitInfo(const std::vector<Data*>& inputs,
 int SchedulerService::GetServerSize(int server_type) {
   return server_offset_[server_type + 1] - server_offset_[server_type];
 }
+void SchedulerService::SetServerSize(int server_num) {
+  server_offset_ = {0, server_num};
+}
+
 int SchedulerService::GetServerTotalSize() {
   return server_offset_.back();
 }
@@ -864,6 +1048,14 @@ int SchedulerService::GetServerTypeSize() {
   return server_offset_.size() - 1;
 }
 
+size_t SchedulerService::GetServerReplicas() {
+  return server_replicas_;
+}
+
+int SchedulerService::ReplicaConnection(int server_id, size_t replica) {
+  return server_offset_.back() + (replica - 1) * GetServerSize(0) + server_id;
+}
+
 }
 }
 
@@ -26,6 +26,8 @@ limitations under the License.
 #include "ps-plus/message/variable_info.h"
 #include "ps-plus/message/streaming_model_manager.h"
 #include "ps-plus/message/streaming_model_infos.h"
+#include "ps-plus/message/server_load.h"
+#include "ps-plus/message/variable_stats.h"
 
 namespace ps {
 namespace scheduler {
@@ -36,12 +38,14 @@ class SchedulerService {
   SchedulerService(SchedulerImpl* impl, 
                    const std::string& server_count, 
                    const std::string& scheduler_kv_addr,
-                   bool bind_cores)
+                   bool bind_cores,
+                   size_t server_replicas = 0)
     : impl_(impl)
     , core_num_(NetUtils::GetAvailableCpuNum())
     , scheduler_kv_addr_(scheduler_kv_addr) 
     , port_(NetUtils::GetAvailablePort())
-    , bind_cores_(bind_cores) {
+    , bind_cores_(bind_cores)
+    , server_replicas_(server_replicas) {
     server_count_ = server_count;
     server_offset_.push_back(0);
     int s = 0;
@@ -60,6 +64,7 @@ class SchedulerService {
   ~SchedulerService();
   Status Start();
   void SetServer(int server_type, int server_id, const std::string& server_addr);
+  void SetReplica(int server_id, size_t replica, const std::string& server_addr);
   void ServerSave(
       int server_type,
       int server_id,
@@ -74,6 +79,31 @@ class SchedulerService {
       const std::vector<VariableInfo>& from,
       const std::vector<VariableInfo>& to,
       std::function<void(Status)> cb);
+  void ReplicaRestore(
+      int server_id,
+      size_t replica,
+      Version version,
+      const std::vector<VariableInfo>& from,
+      const std::vector<VariableInfo>& to,
+      std::function<void(Status)> cb);
+  void ServerSetReplicas(
+      int server_id,
+      Version version,
+      const std::vector<std::string>& replica_addrs,
+      std::function<void(Status)> cb);
+  void ServerGetLoad(
+      int server_id,
+      Version version,
+      std::function<void(Status, const ServerLoad&)> cb);
+  void ServerGetStats(
+      int server_id,
+      Version version,
+      std::function<void(Status, const ServerStats&)> cb);
+  void ServerBumpVersion(
+      int server_id,
+      Version version,
+      Version new_version,
+      std::function<void(Status)> cb);
   void ServerStreamingDenseVarName(
       int server_type,
       int server_id,
@@ -103,14 +133,21 @@ class SchedulerService {
       Version version,
       std::function<void(Status)> cb);
   int GetServerSize(int server_type);
+  // Only for clusters of type 0 servers, the connections keep their ids.
+  void SetServerSize(int server_num);
   int GetServerTotalSize();
   int GetServerTypeSize();
+  // read replicas of every type 0 server
+  size_t GetServerReplicas();
  private:
+  int ReplicaConnection(int server_id, size_t replica);
   void GetVersion(const std::vector<Data*>& inputs, std::vector<Data*>* outputs, ps::service::seastar::DoneClosure* done);
   void RegisterServer(const std::vector<Data*>& inputs, std::vector<Data*>* outputs, ps::service::seastar::DoneClosure* done);
   void GetClusterInfo(const std::vector<Data*>& inputs, std::vector<Data*>* outputs, ps::service::seastar::DoneClosure* done);
   void Save(const std::vector<Data*>& inputs, std::vector<Data*>* outputs, ps::service::seastar::DoneClosure* done);
   void Restore(const std::vector<Data*>& inputs, std::vector<Data*>* outputs, ps::service::seastar::DoneClosure* done);
+  void ResizeServers(const std::vector<Data*>& inputs, std::vector<Data*>* outputs, ps::service::seastar::DoneClosure* done);
+  void GetClusterStats(const std::vector<Data*>& inputs, std::vector<Data*>* outputs, ps::service::seastar::DoneClosure* done);
   void InitGlobalQueue(const std::vector<Data*>& inputs, std::vector<Data*>* outputs, ps::service::seastar::DoneClosure* done);
   void GetNextFile(const std::vector<Data*>& inputs, std::vector<Data*>* outputs, ps::service::seastar::DoneClosure* done);
   void ReportWorkerState(const std::vector<Data*>& inputs, std::vector<Data*>* outputs, ps::service::seastar::DoneClosure* done);
@@ -133,6 +170,7 @@ class SchedulerService {
   SchedulerImpl* impl_;
   std::string server_count_;
   bool bind_cores_;
+  size_t server_replicas_;
   int core_num_;
   std::unique_ptr<ps::service::seastar::SeastarServerClientLib> seastar_lib_;
 
@@ -0,0 +1,96 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/scheduler/straggler_detector.h"
+
+#include <algorithm>
+
+namespace ps {
+namespace scheduler {
+
+namespace {
+
+// the weight of the last interval in the moving average
+const double kIntervalDecay = 0.1;
+
+}
+
+StragglerDetector::StragglerDetector(const Arg& arg) : arg_(arg) {}
+
+void StragglerDetector::Step(int id, int64_t now_micros) {
+  if (finished_.find(id) != finished_.end()) {
+    return;
+  }
+  Worker& worker = workers_[id];
+  if (worker.steps > 0 && now_micros > worker.last) {
+    double interval = now_micros - worker.last;
+    worker.interval = worker.steps == 1
+        ? interval
+        : (1 - kIntervalDecay) * worker.interval + kIntervalDecay * interval;
+  }
+  worker.last = now_micros;
+  worker.steps++;
+}
+
+void StragglerDetector::Finish(int id) {
+  finished_.insert(id);
+  workers_.erase(id);
+}
+
+double StragglerDetector::Rate(int id) const {
+  auto iter = workers_.find(id);
+  if (iter == workers_.end() || iter->second.steps < std::max<size_t>(arg_.min_steps, 2) ||
+      iter->second.interval <= 0) {
+    return 0;
+  }
+  return 1000000 / iter->second.interval;
+}
+
+StragglerDetector::Result StragglerDetector::Check() {
+  Result result;
+  std::vector<double> rates;
+  for (auto& item : workers_) {
+    double rate = Rate(item.first);
+    if (rate > 0) {
+      rates.push_back(rate);
+    }
+  }
+  if (rates.size() < 2) {
+    return result;
+  }
+  std::nth_element(rates.begin(), rates.begin() + rates.size() / 2, rates.end());
+  double median = rates[rates.size() / 2];
+  for (auto& item : workers_) {
+    double rate = Rate(item.first);
+    if (rate <= 0) {
+      continue;
+    }
+    Worker& worker = item.second;
+    if (rate < arg_.slow_ratio * median) {
+      result.scales[item.first] = rate / median;
+      result.slow.push_back(item.first);
+      if (++worker.slow_checks == arg_.chronic_checks) {
+        result.chronic.push_back(item.first);
+      }
+    } else {
+      result.scales[item.first] = 1;
+      worker.slow_checks = 0;
+    }
+  }
+  return result;
+}
+
+}
+}
@@ -0,0 +1,74 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_SCHEDULER_STRAGGLER_DETECTOR_H_
+#define PS_SCHEDULER_STRAGGLER_DETECTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace ps {
+namespace scheduler {
+
+// Tracks the step rate of every worker from the times it enters the sync
+// mechanism. A worker is slow when its rate falls under slow_ratio of the
+// median rate of the running workers, its lease scale is then its rate
+// over the median so that the faster workers take the files it doesn't.
+// Not thread safe, it runs on the synchronizer queue.
+class StragglerDetector {
+ public:
+  struct Arg {
+    double slow_ratio;
+    // a worker is judged after min_steps steps
+    size_t min_steps;
+    // slow for chronic_checks checks in a row, a worker should be replaced
+    size_t chronic_checks;
+  };
+  struct Result {
+    // the scale of the leases of every judged worker, 1 if not slow
+    std::map<int, double> scales;
+    std::vector<int> slow;
+    std::vector<int> chronic;
+  };
+
+  explicit StragglerDetector(const Arg& arg);
+  void Step(int id, int64_t now_micros);
+  // A finished worker is no longer judged.
+  void Finish(int id);
+  // Steps per second, 0 if not judged yet.
+  double Rate(int id) const;
+  Result Check();
+
+ private:
+  struct Worker {
+    int64_t last = 0;
+    size_t steps = 0;
+    // moving average of the step interval in micros
+    double interval = 0;
+    size_t slow_checks = 0;
+  };
+
+  Arg arg_;
+  std::map<int, Worker> workers_;
+  std::set<int> finished_;
+};
+
+}
+}
+
+#endif // PS_SCHEDULER_STRAGGLER_DETECTOR_H_
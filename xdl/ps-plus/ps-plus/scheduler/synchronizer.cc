@@ -38,7 +38,9 @@ function<void (int, const Status&)> MkCb(int id) {
 
 }
 
-Synchronizer::Synchronizer(int worker_count) : worker_count_(worker_count), left_token_(worker_count), current_token_(0) {
+Synchronizer::Synchronizer(int worker_count, int backup_workers)
+  : worker_count_(worker_count), left_token_(worker_count), current_token_(0),
+    backup_workers_(backup_workers), closed_tokens_(0), dropped_(0) {
   contexts_.reset(new Context[worker_count_ + 100]);
   Context* ctxs = contexts_.get();
   for (int i = 0; i < worker_count_ + 100; i++) {
@@ -51,6 +53,7 @@ Synchronizer::Synchronizer(int worker_count) : worker_count_(worker_count), left
 void Synchronizer::UnlockNewToken() {
   left_token_ = worker_count_;
   current_token_++;
+  left_list_.clear();
   while(left_token_ > 0 && !waiting_list_.empty()) {
       auto iter = waiting_list_.begin();
       (*iter)->cb_(current_token_, Status::Ok());
@@ -65,7 +68,10 @@ void Synchronizer::Enter(int id, function<void (int64_t, const Status&)> cb) {
     cb(current_token_, Status::Ok());
     return;
   }
-  if (left_token_ > 0) {
+  // a straggler starting over gave up on its token
+  late_list_.erase(id);
+  // the quorum counts workers, one can't leave the same token twice
+  if (left_token_ > 0 && left_list_.find(id) == left_list_.end()) {
     left_token_--;
     working_list_.insert(id);
     cb(current_token_, Status::Ok());
@@ -77,28 +83,83 @@ void Synchronizer::Enter(int id, function<void (int64_t, const Status&)> cb) {
 }
 
 Status Synchronizer::WorkerReportFinish(int id) {
-  if (working_list_.find(id) == working_list_.end()) {
-    return Status::Ok();
+  late_list_.erase(id);
+  if (backup_workers_ > 0) {
+    finished_list_.insert(id);
   }
-  working_list_.erase(id);
-  if (left_token_ == 0 && working_list_.empty()) {
-    UnlockNewToken();
+  if (working_list_.find(id) != working_list_.end()) {
+    working_list_.erase(id);
+    if (left_token_ == 0 && working_list_.empty()) {
+      UnlockNewToken();
+      return Status::Ok();
+    }
   }
+  // fewer workers are left to make the quorum
+  CloseToken();
   return Status::Ok();
 }
 
+void Synchronizer::CloseToken() {
+  if (backup_workers_ <= 0) {
+    return;
+  }
+  int quorum = worker_count_ - backup_workers_;
+  int active = worker_count_ - (int)finished_list_.size();
+  if (quorum > active) {
+    quorum = active;
+  }
+  if (quorum <= 0 || (int)left_list_.size() < quorum) {
+    return;
+  }
+  // Tokens nobody took yet are dropped steps as much as the ones still
+  // being worked on, but finished workers take none.
+  int untaken = left_token_ - (int)finished_list_.size();
+  int dropped = working_list_.size() + (untaken > 0 ? untaken : 0);
+  for (int id : working_list_) {
+    late_list_.insert(id);
+  }
+  working_list_.clear();
+  closed_tokens_++;
+  dropped_ += dropped;
+  if (dropped > 0) {
+    LOG(INFO) << "Token " << current_token_ << " closed with " << left_list_.size()
+              << " workers, dropped " << dropped << ", dropped rate " << DroppedRate();
+  }
+  UnlockNewToken();
+}
+
+double Synchronizer::DroppedRate() const {
+  if (closed_tokens_ == 0 || worker_count_ == 0) {
+    return 0;
+  }
+  return (double)dropped_ / (closed_tokens_ * worker_count_);
+}
+
 void Synchronizer::Leave(int id, int64_t token, function<void (const Status&)> cb) {
+  if (late_list_.erase(id) != 0) {
+    cb(Status::Ok());
+    return;
+  }
   if (token != current_token_) {
     LOG(WARNING) << "Receive token " << token << " from " << id << " while current_token_ is " << current_token_;
     cb(Status::Ok());
+    return;
   }
   if (working_list_.find(id) == working_list_.end()) {
     LOG(FATAL) << "Worker " << id << " not granted token, but it call leave with token " << token << ", current token is " << current_token_;
     abort();
   }
   working_list_.erase(id);
+  if (backup_workers_ > 0) {
+    left_list_.insert(id);
+  }
   if (left_token_ == 0 && working_list_.empty()) {
+    if (backup_workers_ > 0) {
+      closed_tokens_++;
+    }
     UnlockNewToken();
+  } else {
+    CloseToken();
   }
   cb(Status::Ok());
 }
@@ -109,6 +170,8 @@ void Synchronizer::Reset() {
   }
   waiting_list_.clear();
   working_list_.clear();
+  left_list_.clear();
+  late_list_.clear();
   current_token_++;
   left_token_ = worker_count_;
 }
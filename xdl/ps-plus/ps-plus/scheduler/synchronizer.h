@@ -25,6 +25,7 @@ limitations under the License.
 #include <thread>
 
 #include "ps-plus/common/status.h"
+#include "ps-plus/common/thread_pool.h"
 
 namespace ps {
 namespace scheduler {
@@ -49,9 +50,13 @@ class Asynchronizer : public SyncMechanism {
   std::map<int, std::set<Context*>> step_index_;
   std::mutex m_;
   std::set<int> removed_workers_;
+  ThreadPool* grant_pool_;
+  size_t grant_batch_;
   void UnlockNewSteps(int old_first);
 public:
-  Asynchronizer(int staleness, int worker_count);
+  // Grants of a step are replied grant_batch at a time on grant_pool,
+  // inline without a pool.
+  Asynchronizer(int staleness, int worker_count, ThreadPool* grant_pool = nullptr, size_t grant_batch = 32);
   ~Asynchronizer();
   void Enter(int id, std::function<void (const Status&)> cb);
   Status WorkerReportFinish(int id);
@@ -70,14 +75,26 @@ class Synchronizer : public SyncMechanism {
   std::unique_ptr<Context[]> contexts_;
   std::set<Context*> waiting_list_;
   std::set<int> working_list_;
+  // With backup workers a token closes once worker_count - backup_workers
+  // workers left it, the ones still working on it are stragglers whose
+  // pushes land in the next token.
+  int backup_workers_;
+  std::set<int> left_list_;
+  std::set<int> late_list_;
+  std::set<int> finished_list_;
+  int64_t closed_tokens_;
+  int64_t dropped_;
   void UnlockNewToken();
+  void CloseToken();
 public:    
-  Synchronizer(int worker_count);
+  Synchronizer(int worker_count, int backup_workers = 0);
   ~Synchronizer() {}
   void Enter(int id, std::function<void (int64_t, const Status&)> cb);
   void Leave(int id, int64_t token, std::function<void (const Status&)> cb);
   Status WorkerReportFinish(int id);
   void Reset();
+  // Share of the worker steps that missed the token they started in.
+  double DroppedRate() const;
 };
 
 } // namespace scheduler
@@ -0,0 +1,149 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+
+#include "gtest/gtest.h"
+#include "ps-plus/scheduler/group_barrier.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace ps;
+using namespace ps::scheduler;
+
+TEST(GroupBarrier, EnterAndRelease) {
+  GroupBarrier barrier(2, nullptr);
+  string execute_log;
+  for (int i = 0; i < 4; i++) {
+    barrier.Enter(i, 5, [&execute_log, i](const Status& st) {
+      execute_log += to_string(i);
+    });
+  }
+  EXPECT_EQ(execute_log, "");
+  EXPECT_EQ(4u, barrier.Waiting());
+  barrier.Enter(4, 5, [&execute_log](const Status& st) {
+    execute_log += "4";
+  });
+  EXPECT_EQ(execute_log, "01234");
+  EXPECT_EQ(0u, barrier.Waiting());
+
+  // the next round starts empty
+  barrier.Enter(1, 5, [&execute_log](const Status& st) {
+    execute_log += "1";
+  });
+  EXPECT_EQ(execute_log, "01234");
+  EXPECT_EQ(1u, barrier.Waiting());
+}
+
+TEST(GroupBarrier, Remove) {
+  GroupBarrier barrier(2, nullptr);
+  string execute_log;
+  barrier.Enter(0, 3, [&execute_log](const Status& st) {
+    execute_log += "0";
+  });
+  barrier.Enter(2, 3, [&execute_log](const Status& st) {
+    execute_log += "2";
+  });
+  EXPECT_EQ(execute_log, "");
+  barrier.Remove(1);
+  EXPECT_EQ(execute_log, "02");
+
+  // a finished worker is never waited for again
+  barrier.Enter(0, 3, [&execute_log](const Status& st) {
+    execute_log += "0";
+  });
+  EXPECT_EQ(execute_log, "02");
+  barrier.Enter(2, 3, [&execute_log](const Status& st) {
+    execute_log += "2";
+  });
+  EXPECT_EQ(execute_log, "0202");
+  barrier.Enter(1, 3, [&execute_log](const Status& st) {
+    execute_log += "1";
+  });
+  EXPECT_EQ(execute_log, "02021");
+}
+
+TEST(GroupBarrier, Retry) {
+  GroupBarrier barrier(4, nullptr);
+  string execute_log;
+  barrier.Enter(0, 2, [&execute_log](const Status& st) {
+    execute_log += "a";
+  });
+  barrier.Enter(0, 2, [&execute_log](const Status& st) {
+    execute_log += "b";
+  });
+  barrier.Enter(1, 2, [&execute_log](const Status& st) {
+    execute_log += "c";
+  });
+  EXPECT_EQ(execute_log, "bc");
+  Status result;
+  barrier.Enter(2, 2, [&result](const Status& st) {
+    result = st;
+  });
+  EXPECT_FALSE(result.IsOk());
+}
+
+TEST(GroupBarrier, FanOut) {
+  ThreadPool pool(3);
+  GroupBarrier barrier(8, &pool);
+  const int worker_count = 100;
+  std::atomic<int> released(0);
+  std::promise<bool> done;
+  for (int i = 0; i < worker_count; i++) {
+    barrier.Enter(i, worker_count, [&](const Status& st) {
+      EXPECT_TRUE(st.IsOk());
+      if (++released == worker_count) {
+        done.set_value(true);
+      }
+    });
+  }
+  EXPECT_EQ(std::future_status::ready, done.get_future().wait_for(seconds(10)));
+}
+
+// Time from the last worker entering until every worker got its reply,
+// each reply standing in for the serialize and send of 2us.
+TEST(GroupBarrier, DISABLED_LatencyBenchMark) {
+  ThreadPool pool(4);
+  for (int worker_count : {128, 1024, 4096}) {
+    for (size_t group_size : {(size_t)worker_count, (size_t)32}) {
+      GroupBarrier barrier(group_size, &pool);
+      const int rounds = 20;
+      double total = 0;
+      for (int round = 0; round < rounds; round++) {
+        std::atomic<int> released(0);
+        std::promise<bool> done;
+        auto reply = [&](const Status& st) {
+          auto start = steady_clock::now();
+          while (steady_clock::now() - start < microseconds(2)) {}
+          if (++released == worker_count) {
+            done.set_value(true);
+          }
+        };
+        for (int i = 0; i < worker_count - 1; i++) {
+          barrier.Enter(i, worker_count, reply);
+        }
+        auto start = steady_clock::now();
+        barrier.Enter(worker_count - 1, worker_count, reply);
+        done.get_future().wait();
+        total += duration_cast<microseconds>(steady_clock::now() - start).count();
+      }
+      cout << "workers " << worker_count << " group " << group_size
+           << " release " << total / rounds << "us" << endl;
+    }
+  }
+}
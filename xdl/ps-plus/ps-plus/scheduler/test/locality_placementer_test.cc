@@ -0,0 +1,103 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <stdio.h>
+
+#include "gtest/gtest.h"
+#include "ps-plus/scheduler/placementer.h"
+#include "ps-plus/common/hasher.h"
+
+#include <map>
+#include <set>
+
+using ps::scheduler::Placementer;
+using ps::VariableInfo;
+using ps::Status;
+using ps::DataType;
+using ps::Hasher;
+
+namespace {
+
+VariableInfo HashInfo(const std::string& name, const std::string& group) {
+  VariableInfo info;
+  info.type = VariableInfo::Type::kHash128;
+  info.name = name;
+  info.shape = {1000, 8};
+  info.datatype = DataType::kFloat;
+  info.args["batch_read"] = "100";
+  if (!group.empty()) {
+    info.args[VariableInfo::PLACEMENT_GROUP] = group;
+  }
+  return info;
+}
+
+size_t TotalSize(const VariableInfo& info) {
+  size_t size = 0;
+  for (auto& part : info.parts) {
+    size += part.size;
+  }
+  return size;
+}
+
+void ExpectSameParts(const VariableInfo& a, const VariableInfo& b) {
+  ASSERT_EQ(a.parts.size(), b.parts.size());
+  for (size_t i = 0; i < a.parts.size(); i++) {
+    EXPECT_EQ(a.parts[i].server, b.parts[i].server);
+    EXPECT_EQ(a.parts[i].size, b.parts[i].size);
+  }
+}
+
+}
+
+TEST(LocalityPlacementerTest, GroupsShareServerSubset) {
+  auto sp = ps::GetPlugin<Placementer>("Locality");
+  ASSERT_NE(nullptr, sp);
+  std::vector<VariableInfo> input = {
+    HashInfo("a1", "a"), HashInfo("a2", "a"), HashInfo("b1", "b"),
+    HashInfo("b2", "b"), HashInfo("c1", "c"), HashInfo("c2", "c"),
+    HashInfo("d1", "d"), HashInfo("d2", "d"), HashInfo("free", "")};
+  std::vector<VariableInfo> output;
+  Placementer::Arg arg{.net = 0, .mem = 1 << 30, .query = 0};
+  EXPECT_TRUE(sp->Placement(input, &output, arg, 4).IsOk());
+  ASSERT_EQ(9u, output.size());
+  std::map<std::string, VariableInfo> result;
+  for (auto& info : output) {
+    EXPECT_EQ((size_t)Hasher::kTargetRange, TotalSize(info));
+    result[info.name] = info;
+  }
+  ExpectSameParts(result["a1"], result["a2"]);
+  ExpectSameParts(result["d1"], result["d2"]);
+  // 9 equal variables over 4 servers, a pair fits on one server
+  EXPECT_EQ(1u, result["a1"].parts.size());
+  std::set<size_t> used;
+  for (auto group : {"a1", "b1", "c1", "d1"}) {
+    used.insert(result[group].parts[0].server);
+  }
+  EXPECT_EQ(4u, used.size());
+  EXPECT_EQ(4u, result["free"].parts.size());
+}
+
+TEST(LocalityPlacementerTest, PlacedGroupKeepsParts) {
+  auto sp = ps::GetPlugin<Placementer>("Locality");
+  VariableInfo placed = HashInfo("a1", "a");
+  placed.parts = {{1, 30000}, {2, 35536}};
+  std::vector<VariableInfo> input = {placed, HashInfo("a2", "a")};
+  std::vector<VariableInfo> output;
+  Placementer::Arg arg{.net = 0, .mem = 1 << 30, .query = 0};
+  EXPECT_TRUE(sp->Placement(input, &output, arg, 4).IsOk());
+  ASSERT_EQ(2u, output.size());
+  ExpectSameParts(placed, output[0]);
+  ExpectSameParts(placed, output[1]);
+}
@@ -0,0 +1,146 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "ps-plus/scheduler/offline_resharder.h"
+#include "ps-plus/server/checkpoint_utils.h"
+#include "ps-plus/common/initializer/constant_initializer.h"
+
+using ps::DataType;
+using ps::Status;
+using ps::Tensor;
+using ps::TensorShape;
+using ps::VariableInfo;
+using ps::VariableInfoCollection;
+using ps::WrapperData;
+using ps::initializer::ConstantInitializer;
+using ps::scheduler::OfflineResharder;
+using ps::scheduler::Placementer;
+using ps::server::CheckpointUtils;
+using ps::server::Variable;
+
+namespace {
+
+// splits every variable evenly
+class EvenPlacementer : public Placementer {
+ public:
+  Status Placement(const std::vector<VariableInfo>& inputs, std::vector<VariableInfo>* outputs,
+                   const Arg& arg, size_t server) override {
+    *outputs = inputs;
+    for (auto& info : *outputs) {
+      for (size_t i = 0; i < server; i++) {
+        info.parts.push_back(VariableInfo::Part{.server = i, .size = (size_t)info.shape[0] / server});
+      }
+    }
+    return Status::Ok();
+  }
+};
+
+VariableInfo MakeInfo(size_t servers) {
+  VariableInfo info;
+  info.type = VariableInfo::kIndex;
+  info.name = "x";
+  info.shape = {8, 4};
+  info.datatype = DataType::kInt8;
+  for (size_t i = 0; i < servers; i++) {
+    info.parts.push_back(VariableInfo::Part{.server = i, .size = 8 / servers});
+  }
+  return info;
+}
+
+// two servers, the rows of server i are i + 1
+void SaveSource(const std::string& path) {
+  VariableInfoCollection infos{{MakeInfo(2)}};
+  CheckpointUtils ckpt(infos);
+  for (size_t id = 0; id < 2; id++) {
+    std::unordered_map<std::string, std::unique_ptr<Variable>> vars;
+    vars["x"].reset(new Variable(new Tensor(DataType::kInt8, TensorShape({4, 4}), new ConstantInitializer(id + 1)),
+                                 new WrapperData<size_t>(id * 4), "x"));
+    ASSERT_TRUE(ckpt.SaveVariables(id, path + "/ckpt_2", vars).IsOk());
+  }
+  ASSERT_TRUE(OfflineResharder::WriteMeta(path + "/ckpt_2", 2, infos.infos).IsOk());
+  ASSERT_TRUE(OfflineResharder::WriteCheckpoints(path, {"ckpt_2"}).IsOk());
+}
+
+void CheckResharded(const std::string& path) {
+  std::vector<std::string> checkpoints;
+  ASSERT_TRUE(OfflineResharder::ReadCheckpoints(path, &checkpoints).IsOk());
+  EXPECT_EQ(std::vector<std::string>({"ckpt_4"}), checkpoints);
+  size_t server_num;
+  VariableInfoCollection infos;
+  ASSERT_TRUE(OfflineResharder::ReadMeta(path + "/ckpt_4", &server_num, &infos.infos).IsOk());
+  EXPECT_EQ(4u, server_num);
+  ASSERT_EQ(1u, infos.infos.size());
+  ASSERT_EQ(4u, infos.infos[0].parts.size());
+
+  VariableInfoCollection from = infos;
+  from.infos[0].args[VariableInfo::ORIGIN_FILE_PATH] = path + "/ckpt_4";
+  CheckpointUtils ckpt(from);
+  for (size_t id = 0; id < 4; id++) {
+    std::unordered_map<std::string, std::unique_ptr<Variable>> vars;
+    ASSERT_TRUE(ckpt.LoadVariables(infos, id, &vars).IsOk());
+    Tensor* data = vars["x"]->GetData();
+    EXPECT_EQ(TensorShape({2, 4}), data->Shape());
+    EXPECT_EQ(id * 2, dynamic_cast<WrapperData<size_t>*>(vars["x"]->GetSlicer())->Internal());
+    for (size_t i = 0; i < 8; i++) {
+      EXPECT_EQ(id / 2 + 1, data->Raw<int8_t>()[i]);
+    }
+  }
+}
+
+OfflineResharder::Arg MakeArg(const std::string& from, const std::string& to, size_t processes,
+                              Placementer* placementer) {
+  OfflineResharder::Arg arg;
+  arg.from_path = from;
+  arg.to_path = to;
+  arg.to_checkpoint = "ckpt_4";
+  arg.server_num = 4;
+  arg.processes = processes;
+  arg.placementer = placementer;
+  arg.placement_arg = Placementer::Arg{0, 0, 0};
+  return arg;
+}
+
+}
+
+TEST(OfflineResharderTest, Reshard) {
+  SaveSource("memory://reshard_from");
+  EvenPlacementer placementer;
+  EXPECT_TRUE(OfflineResharder::Run(MakeArg("memory://reshard_from", "memory://reshard_to", 1, &placementer)).IsOk());
+  CheckResharded("memory://reshard_to");
+
+  OfflineResharder::Arg arg = MakeArg("memory://reshard_from", "memory://reshard_to", 1, &placementer);
+  arg.from_checkpoint = "ckpt_3";
+  EXPECT_EQ(Status::kNotFound, OfflineResharder::Run(arg).Code());
+}
+
+TEST(OfflineResharderTest, Processes) {
+  // the share of each forked process, run here one after the other
+  SaveSource("memory://reshard_processes");
+  size_t server_num;
+  std::vector<VariableInfo> from_infos, to_infos;
+  ASSERT_TRUE(OfflineResharder::ReadMeta("memory://reshard_processes/ckpt_2", &server_num, &from_infos).IsOk());
+  EXPECT_EQ(2u, server_num);
+  EvenPlacementer placementer;
+  ASSERT_TRUE(OfflineResharder::Plan(from_infos, &placementer, Placementer::Arg{0, 0, 0}, 4, &to_infos).IsOk());
+  for (size_t process = 0; process < 3; process++) {
+    EXPECT_TRUE(OfflineResharder::ReshardServers("memory://reshard_processes/ckpt_2", from_infos,
+                                                 "memory://reshard_processes_to/ckpt_4", to_infos,
+                                                 4, process, 3).IsOk());
+  }
+  ASSERT_TRUE(OfflineResharder::WriteMeta("memory://reshard_processes_to/ckpt_4", 4, to_infos).IsOk());
+  ASSERT_TRUE(OfflineResharder::WriteCheckpoints("memory://reshard_processes_to", {"ckpt_4"}).IsOk());
+  CheckResharded("memory://reshard_processes_to");
+}
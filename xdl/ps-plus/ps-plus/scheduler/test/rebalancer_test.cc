@@ -0,0 +1,113 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <set>
+
+#include "gtest/gtest.h"
+#include "ps-plus/scheduler/rebalancer.h"
+
+using ps::scheduler::Rebalancer;
+using ps::VariableInfo;
+using ps::VariableLoad;
+using ps::ServerLoad;
+using ps::DataType;
+
+namespace {
+
+VariableInfo MakeInfo(const std::string& name, const std::vector<size_t>& servers) {
+  VariableInfo info;
+  info.type = VariableInfo::Type::kHash128;
+  info.name = name;
+  info.shape = {100, 8};
+  info.datatype = DataType::kFloat;
+  for (auto server : servers) {
+    info.parts.push_back(VariableInfo::Part{.server = server, .size = 100});
+  }
+  return info;
+}
+
+ServerLoad MakeLoad(const std::vector<std::pair<std::string, size_t>>& micros) {
+  ServerLoad load;
+  load.window_micros = 1000000;
+  load.cpu_micros = 0;
+  for (auto& item : micros) {
+    load.variables.push_back(VariableLoad{item.first, 1, 0, item.second});
+  }
+  return load;
+}
+
+}
+
+TEST(RebalancerTest, Balanced) {
+  std::vector<VariableInfo> infos = {MakeInfo("a", {0, 1}), MakeInfo("b", {0, 1})};
+  std::vector<ServerLoad> loads = {
+    MakeLoad({{"a", 100}, {"b", 100}}),
+    MakeLoad({{"a", 110}, {"b", 90}})};
+  std::vector<VariableInfo> outputs;
+  std::vector<Rebalancer::Move> moves;
+  EXPECT_TRUE(Rebalancer::Plan(infos, loads, Rebalancer::Arg{0.2, 4}, &outputs, &moves).IsOk());
+  EXPECT_TRUE(moves.empty());
+  EXPECT_EQ(0u, outputs[0].parts[0].server);
+}
+
+TEST(RebalancerTest, MoveHotPart) {
+  std::vector<VariableInfo> infos = {MakeInfo("a", {0}), MakeInfo("b", {0}), MakeInfo("c", {1}), MakeInfo("d", {0, 1})};
+  std::vector<ServerLoad> loads = {
+    MakeLoad({{"a", 300}, {"b", 100}, {"d", 50}}),
+    MakeLoad({{"c", 50}, {"d", 50}})};
+  std::vector<VariableInfo> outputs;
+  std::vector<Rebalancer::Move> moves;
+  EXPECT_TRUE(Rebalancer::Plan(infos, loads, Rebalancer::Arg{0.2, 4}, &outputs, &moves).IsOk());
+  ASSERT_EQ(1u, moves.size());
+  // moving b leaves 350/200, a 150/400; d already has a part on server 1
+  EXPECT_EQ("b", moves[0].name);
+  EXPECT_EQ(0u, moves[0].from);
+  EXPECT_EQ(1u, moves[0].to);
+  EXPECT_EQ(1u, outputs[1].parts[0].server);
+  EXPECT_EQ(0u, outputs[0].parts[0].server);
+  EXPECT_EQ(0u, outputs[3].parts[0].server);
+}
+
+TEST(RebalancerTest, SkipUnsavedVariables) {
+  std::vector<VariableInfo> infos = {MakeInfo("a", {0}), MakeInfo("b", {1})};
+  infos[0].args["save"] = "false";
+  std::vector<ServerLoad> loads = {
+    MakeLoad({{"a", 1000}}),
+    MakeLoad({{"b", 10}})};
+  std::vector<VariableInfo> outputs;
+  std::vector<Rebalancer::Move> moves;
+  EXPECT_TRUE(Rebalancer::Plan(infos, loads, Rebalancer::Arg{0.2, 4}, &outputs, &moves).IsOk());
+  EXPECT_TRUE(moves.empty());
+}
+
+TEST(RebalancerTest, MaxMoves) {
+  std::vector<VariableInfo> infos = {MakeInfo("a", {0}), MakeInfo("b", {0}), MakeInfo("c", {0}), MakeInfo("d", {0})};
+  std::vector<ServerLoad> loads = {
+    MakeLoad({{"a", 100}, {"b", 100}, {"c", 100}, {"d", 100}}),
+    MakeLoad({}),
+    MakeLoad({}),
+    MakeLoad({})};
+  std::vector<VariableInfo> outputs;
+  std::vector<Rebalancer::Move> moves;
+  EXPECT_TRUE(Rebalancer::Plan(infos, loads, Rebalancer::Arg{0.2, 2}, &outputs, &moves).IsOk());
+  EXPECT_EQ(2u, moves.size());
+  EXPECT_TRUE(Rebalancer::Plan(infos, loads, Rebalancer::Arg{0.2, 10}, &outputs, &moves).IsOk());
+  EXPECT_EQ(3u, moves.size());
+  std::set<size_t> servers;
+  for (auto& info : outputs) {
+    servers.insert(info.parts[0].server);
+  }
+  EXPECT_EQ(4u, servers.size());
+}
@@ -0,0 +1,117 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "ps-plus/scheduler/resharder.h"
+
+using ps::scheduler::Resharder;
+using ps::VariableInfo;
+using ps::DataType;
+
+namespace {
+
+VariableInfo MakeInfo(const std::string& name, const std::vector<std::pair<size_t, size_t>>& parts) {
+  VariableInfo info;
+  info.type = VariableInfo::Type::kHash128;
+  info.name = name;
+  info.shape = {100, 8};
+  info.datatype = DataType::kFloat;
+  for (auto& part : parts) {
+    info.parts.push_back(VariableInfo::Part{.server = part.first, .size = part.second});
+  }
+  return info;
+}
+
+size_t TotalSize(const VariableInfo& info) {
+  size_t total = 0;
+  for (auto& part : info.parts) {
+    total += part.size;
+  }
+  return total;
+}
+
+}
+
+TEST(ResharderTest, ScaleOut) {
+  std::vector<VariableInfo> infos = {
+    MakeInfo("a", {{0, 30000}, {1, 20000}, {2, 15536}}),
+    MakeInfo("b", {{2, 100}})};
+  std::vector<VariableInfo> outputs;
+  std::set<size_t> affected;
+  EXPECT_TRUE(Resharder::Plan(infos, 3, 4, &outputs, &affected).IsOk());
+  ASSERT_EQ(2u, outputs.size());
+  ASSERT_EQ(4u, outputs[0].parts.size());
+  EXPECT_EQ(0u, outputs[0].parts[0].server);
+  EXPECT_EQ(3u, outputs[0].parts[1].server);
+  EXPECT_EQ(1u, outputs[0].parts[2].server);
+  EXPECT_EQ(2u, outputs[0].parts[3].server);
+  EXPECT_EQ(20001u, outputs[0].parts[0].size);
+  EXPECT_EQ(16666u, outputs[0].parts[1].size);
+  EXPECT_EQ(13333u, outputs[0].parts[2].size);
+  EXPECT_EQ(15536u, outputs[0].parts[3].size);
+  EXPECT_EQ(65536u, TotalSize(outputs[0]));
+  ASSERT_EQ(1u, outputs[1].parts.size());
+  EXPECT_EQ(2u, outputs[1].parts[0].server);
+  EXPECT_EQ(std::set<size_t>({0, 1, 3}), affected);
+}
+
+TEST(ResharderTest, ScaleIn) {
+  std::vector<VariableInfo> infos = {
+    MakeInfo("a", {{0, 20000}, {2, 30000}, {1, 15536}}),
+    MakeInfo("b", {{2, 100}}),
+    MakeInfo("c", {{0, 100}})};
+  std::vector<VariableInfo> outputs;
+  std::set<size_t> affected;
+  EXPECT_TRUE(Resharder::Plan(infos, 3, 2, &outputs, &affected).IsOk());
+  ASSERT_EQ(3u, outputs.size());
+  ASSERT_EQ(2u, outputs[0].parts.size());
+  EXPECT_EQ(0u, outputs[0].parts[0].server);
+  EXPECT_EQ(1u, outputs[0].parts[1].server);
+  EXPECT_EQ(20000u + 30000u * 20000 / 35536, outputs[0].parts[0].size);
+  EXPECT_EQ(65536u, TotalSize(outputs[0]));
+  ASSERT_EQ(1u, outputs[1].parts.size());
+  EXPECT_EQ(1u, outputs[1].parts[0].server);
+  EXPECT_EQ(std::set<size_t>({0, 1, 2}), affected);
+}
+
+TEST(ResharderTest, RoundTrip) {
+  std::vector<VariableInfo> infos = {MakeInfo("a", {{0, 32768}, {1, 32768}})};
+  std::vector<VariableInfo> grown, shrunk;
+  std::set<size_t> affected;
+  EXPECT_TRUE(Resharder::Plan(infos, 2, 5, &grown, &affected).IsOk());
+  ASSERT_EQ(5u, grown[0].parts.size());
+  EXPECT_EQ(65536u, TotalSize(grown[0]));
+  std::set<size_t> servers;
+  for (auto& part : grown[0].parts) {
+    EXPECT_LT(0u, part.size);
+    servers.insert(part.server);
+  }
+  EXPECT_EQ(5u, servers.size());
+  EXPECT_TRUE(Resharder::Plan(grown, 5, 2, &shrunk, &affected).IsOk());
+  ASSERT_EQ(2u, shrunk[0].parts.size());
+  EXPECT_EQ(0u, shrunk[0].parts[0].server);
+  EXPECT_EQ(1u, shrunk[0].parts[1].server);
+  EXPECT_EQ(65536u, TotalSize(shrunk[0]));
+}
+
+TEST(ResharderTest, Unchanged) {
+  std::vector<VariableInfo> infos = {MakeInfo("a", {{0, 100}, {1, 100}})};
+  std::vector<VariableInfo> outputs;
+  std::set<size_t> affected;
+  EXPECT_TRUE(Resharder::Plan(infos, 2, 2, &outputs, &affected).IsOk());
+  EXPECT_TRUE(affected.empty());
+  EXPECT_FALSE(Resharder::Plan(infos, 1, 2, &outputs, &affected).IsOk());
+  EXPECT_FALSE(Resharder::Plan(infos, 2, 0, &outputs, &affected).IsOk());
+}
@@ -0,0 +1,67 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "ps-plus/scheduler/straggler_detector.h"
+
+using ps::scheduler::StragglerDetector;
+
+namespace {
+
+// worker i steps every intervals[i] micros from step begin to end
+void StepAll(StragglerDetector* detector, const std::vector<int64_t>& intervals,
+             size_t begin, size_t end) {
+  for (size_t step = begin; step < end; step++) {
+    for (size_t i = 0; i < intervals.size(); i++) {
+      detector->Step(i, step * intervals[i]);
+    }
+  }
+}
+
+}
+
+TEST(StragglerDetectorTest, Slow) {
+  StragglerDetector detector(StragglerDetector::Arg{0.5, 10, 2});
+  StepAll(&detector, {1000, 1000, 1000, 4000}, 0, 5);
+  // not judged before min_steps
+  EXPECT_EQ(0, detector.Rate(0));
+  EXPECT_TRUE(detector.Check().scales.empty());
+
+  StepAll(&detector, {1000, 1000, 1000, 4000}, 5, 25);
+  EXPECT_DOUBLE_EQ(1000, detector.Rate(0));
+  EXPECT_DOUBLE_EQ(250, detector.Rate(3));
+  StragglerDetector::Result result = detector.Check();
+  ASSERT_EQ(4u, result.scales.size());
+  EXPECT_DOUBLE_EQ(1, result.scales[0]);
+  EXPECT_DOUBLE_EQ(0.25, result.scales[3]);
+  EXPECT_EQ(std::vector<int>({3}), result.slow);
+  EXPECT_TRUE(result.chronic.empty());
+
+  // reported once as chronic on the chronic_checks check
+  EXPECT_EQ(std::vector<int>({3}), detector.Check().chronic);
+  EXPECT_TRUE(detector.Check().chronic.empty());
+}
+
+TEST(StragglerDetectorTest, Finish) {
+  StragglerDetector detector(StragglerDetector::Arg{0.5, 2, 2});
+  StepAll(&detector, {1000, 1000, 4000}, 0, 10);
+  EXPECT_EQ(std::vector<int>({2}), detector.Check().slow);
+  detector.Finish(2);
+  detector.Step(2, 100000);
+  EXPECT_EQ(0, detector.Rate(2));
+  StragglerDetector::Result result = detector.Check();
+  EXPECT_EQ(2u, result.scales.size());
+  EXPECT_TRUE(result.slow.empty());
+}
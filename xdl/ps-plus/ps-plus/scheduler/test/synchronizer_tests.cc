@@ -125,3 +125,71 @@ TEST(Synchronizer, WorkerReportFinish) {
   EXPECT_EQ(execute_log, "0L0E");
   EXPECT_EQ(result, 1L);    
 }
+
+TEST(Synchronizer, BackupWorkers) {
+  unique_ptr<Synchronizer> sync(new Synchronizer(3, 1));
+  int64_t result = -1;
+  for (int i = 0; i < 3; i++) {
+    sync->Enter(i, [&result](int64_t token, const Status& st) {
+      result = token;
+    });
+    EXPECT_EQ(result, 0);
+  }
+  string execute_log;
+  sync->Leave(0, 0, [&execute_log](const Status& st) {
+    execute_log += "0L";
+  });
+  // a worker can't make the quorum alone
+  sync->Enter(0, [&result, &execute_log](int64_t token, const Status& st) {
+    result = token;
+    execute_log += "0E";
+  });
+  EXPECT_EQ(execute_log, "0L");
+  sync->Leave(1, 0, [&execute_log](const Status& st) {
+    execute_log += "1L";
+  });
+  EXPECT_EQ(execute_log, "0L0E1L");
+  EXPECT_EQ(result, 1);
+  EXPECT_DOUBLE_EQ(1.0 / 3, sync->DroppedRate());
+
+  // the straggler leaves its closed token and joins the current one
+  sync->Leave(2, 0, [&execute_log](const Status& st) {
+    execute_log += "2L";
+  });
+  sync->Enter(2, [&result, &execute_log](int64_t token, const Status& st) {
+    result = token;
+    execute_log += "2E";
+  });
+  EXPECT_EQ(execute_log, "0L0E1L2L2E");
+  EXPECT_EQ(result, 1);
+  sync->Enter(1, [&result, &execute_log](int64_t token, const Status& st) {
+    result = token;
+    execute_log += "1E";
+  });
+  EXPECT_EQ(result, 1);
+  // the quorum closes the token before the third worker leaves
+  sync->Leave(0, 1, [](const Status& st) {});
+  sync->Leave(1, 1, [](const Status& st) {});
+  EXPECT_DOUBLE_EQ(1.0 / 3, sync->DroppedRate());
+  execute_log = "";
+  sync->Leave(2, 1, [&execute_log](const Status& st) {
+    execute_log += "2L";
+  });
+  EXPECT_EQ(execute_log, "2L");
+}
+
+TEST(Synchronizer, BackupWorkersFinish) {
+  unique_ptr<Synchronizer> sync(new Synchronizer(3, 1));
+  int64_t result = -1;
+  sync->Enter(0, [&result](int64_t token, const Status& st) {
+    result = token;
+  });
+  sync->WorkerReportFinish(1);
+  sync->WorkerReportFinish(2);
+  sync->Leave(0, 0, [](const Status& st) {});
+  sync->Enter(0, [&result](int64_t token, const Status& st) {
+    result = token;
+  });
+  EXPECT_EQ(result, 1);
+  EXPECT_DOUBLE_EQ(0, sync->DroppedRate());
+}
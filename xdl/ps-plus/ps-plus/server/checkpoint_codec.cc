@@ -0,0 +1,187 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/server/checkpoint_codec.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <future>
+#include <memory>
+#include <thread>
+#include <lz4.h>
+
+namespace ps {
+namespace server {
+
+namespace {
+
+struct Chunk {
+  const char* data;
+  size_t raw_size;
+  std::string stored;
+};
+
+Status Compress(CheckpointCodec::Compression compression, Chunk* chunk) {
+  switch (compression) {
+  case CheckpointCodec::kLz4: {
+    chunk->stored.resize(LZ4_compressBound(chunk->raw_size));
+    int size = LZ4_compress_default(chunk->data, &chunk->stored[0], chunk->raw_size, chunk->stored.size());
+    if (size <= 0) {
+      return Status::Unknown("LZ4 compress failed");
+    }
+    chunk->stored.resize(size);
+    return Status::Ok();
+  }
+  default:
+    return Status::NotImplemented("Not Implemented checkpoint compression");
+  }
+}
+
+Status Decompress(CheckpointCodec::Compression compression, const std::string& stored, char* data, size_t size) {
+  switch (compression) {
+  case CheckpointCodec::kLz4: {
+    int ret = LZ4_decompress_safe(stored.data(), data, stored.size(), size);
+    if (ret < 0 || (size_t)ret != size) {
+      return Status::DataLoss("LZ4 decompress failed");
+    }
+    return Status::Ok();
+  }
+  default:
+    return Status::NotImplemented("Not Implemented checkpoint compression");
+  }
+}
+
+Status WriteChunk(FileSystem::WriteStream* s, const Chunk& chunk) {
+  if (chunk.stored.size() >= chunk.raw_size) {
+    PS_CHECK_STATUS(s->WriteRaw(chunk.raw_size));
+    PS_CHECK_STATUS(s->WriteRaw(chunk.raw_size));
+    return s->Write(chunk.data, chunk.raw_size);
+  }
+  PS_CHECK_STATUS(s->WriteRaw(chunk.raw_size));
+  PS_CHECK_STATUS(s->WriteRaw(chunk.stored.size()));
+  return s->Write(chunk.stored.data(), chunk.stored.size());
+}
+
+}
+
+const size_t CheckpointCodec::kChunkSize;
+
+Status CheckpointCodec::ParseCompression(const std::string& name, Compression* compression) {
+  if (name == "" || name == "none") {
+    *compression = kNone;
+  } else if (name == "lz4") {
+    *compression = kLz4;
+  } else {
+    return Status::ArgumentError("Unknown checkpoint compression " + name);
+  }
+  return Status::Ok();
+}
+
+size_t CheckpointCodec::Parallel() {
+  static size_t parallel = [] {
+    const char* threads = getenv("PS_CHECKPOINT_THREADS");
+    long ret = threads == nullptr ? 0 : atol(threads);
+    if (ret <= 0) {
+      ret = std::thread::hardware_concurrency();
+    }
+    return ret <= 0 ? (size_t)1 : (size_t)ret;
+  }();
+  return parallel;
+}
+
+ThreadPool* CheckpointCodec::WriterPool() {
+  static ThreadPool pool(Parallel());
+  return &pool;
+}
+
+Status CheckpointCodec::Write(FileSystem::WriteStream* s, Compression compression, const std::vector<std::pair<const char*, size_t>>& spans) {
+  if (compression == kNone) {
+    for (auto&& span : spans) {
+      PS_CHECK_STATUS(s->Write(span.first, span.second));
+    }
+    return Status::Ok();
+  }
+  std::vector<std::unique_ptr<Chunk>> chunks;
+  for (auto&& span : spans) {
+    for (size_t offset = 0; offset < span.second; offset += kChunkSize) {
+      chunks.emplace_back(new Chunk{span.first + offset, std::min(kChunkSize, span.second - offset), ""});
+    }
+  }
+  std::deque<std::future<Status>> pending;
+  size_t next = 0;
+  Status st = Status::Ok();
+  for (size_t i = 0; i < chunks.size(); i++) {
+    while (next < chunks.size() && next < i + Parallel()) {
+      Chunk* chunk = chunks[next++].get();
+      pending.push_back(std::async(std::launch::async, [compression, chunk] { return Compress(compression, chunk); }));
+    }
+    Status ret = pending.front().get();
+    pending.pop_front();
+    if (st.IsOk() && !ret.IsOk()) {
+      st = ret;
+    }
+    if (st.IsOk()) {
+      st = WriteChunk(s, *chunks[i]);
+    }
+    chunks[i].reset();
+  }
+  return st;
+}
+
+Status CheckpointCodec::Read(FileSystem::ReadStream* s, Compression compression, char* data, size_t size) {
+  if (compression == kNone) {
+    return s->Read(data, size);
+  }
+  std::deque<std::future<Status>> pending;
+  Status st = Status::Ok();
+  size_t offset = 0;
+  while (offset < size && st.IsOk()) {
+    size_t raw_size, stored_size;
+    PS_CHECK_STATUS(s->ReadRaw(&raw_size));
+    PS_CHECK_STATUS(s->ReadRaw(&stored_size));
+    if (raw_size > size - offset || stored_size > raw_size) {
+      st = Status::DataLoss("Checkpoint chunk overflow");
+      break;
+    }
+    if (stored_size == raw_size) {
+      st = s->Read(data + offset, raw_size);
+    } else {
+      std::shared_ptr<std::string> stored(new std::string(stored_size, '\0'));
+      st = s->Read(&(*stored)[0], stored_size);
+      if (st.IsOk()) {
+        char* dst = data + offset;
+        pending.push_back(std::async(std::launch::async, [compression, stored, dst, raw_size] { return Decompress(compression, *stored, dst, raw_size); }));
+      }
+    }
+    offset += raw_size;
+    while (pending.size() >= Parallel() || (!pending.empty() && offset >= size)) {
+      Status ret = pending.front().get();
+      pending.pop_front();
+      if (st.IsOk() && !ret.IsOk()) {
+        st = ret;
+      }
+    }
+  }
+  while (!pending.empty()) {
+    pending.front().get();
+    pending.pop_front();
+  }
+  return st;
+}
+
+}
+}
+
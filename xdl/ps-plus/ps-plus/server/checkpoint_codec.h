@@ -0,0 +1,59 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_SERVER_CHECKPOINT_CODEC_H_
+#define PS_PLUS_SERVER_CHECKPOINT_CODEC_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "ps-plus/common/status.h"
+#include "ps-plus/common/file_system.h"
+#include "ps-plus/common/thread_pool.h"
+
+namespace ps {
+namespace server {
+
+// Tensor payloads of compressed checkpoint files are a sequence of chunks,
+// each one [raw size, stored size, bytes]. A chunk that does not shrink is
+// stored raw. Chunks are compressed on worker threads while the earlier ones
+// are written, and decompressed the same way while later ones are read.
+// Uncompressed payloads stay plain bytes, as in older checkpoints.
+class CheckpointCodec {
+ public:
+  enum Compression : int32_t {
+    kNone = 0,
+    kLz4 = 1,
+  };
+  static const size_t kChunkSize = 4 << 20;
+
+  static Status ParseCompression(const std::string& name, Compression* compression);
+
+  // Chunks in flight per stream and threads of WriterPool, taken from
+  // PS_CHECKPOINT_THREADS, hardware concurrency by default.
+  static size_t Parallel();
+  // Runs the per-part writers of SaveVariables, apart from the global pool
+  // that their compression and copies may wait on.
+  static ThreadPool* WriterPool();
+
+  static Status Write(FileSystem::WriteStream* s, Compression compression, const std::vector<std::pair<const char*, size_t>>& spans);
+  static Status Read(FileSystem::ReadStream* s, Compression compression, char* data, size_t size);
+};
+
+}
+}
+
+#endif
+
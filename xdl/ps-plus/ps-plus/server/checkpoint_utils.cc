@@ -15,14 +15,39 @@ limitations under the License.
 
 #include <chrono>
 #include "ps-plus/server/checkpoint_utils.h"
+#include "ps-plus/common/open_hashmap.h"
 #include "ps-plus/common/serializer.h"
 #include "ps-plus/common/logging.h"
+#include "ps-plus/common/string_utils.h"
+#include <algorithm>
+#include <future>
 #include <map>
 #define CK_CHECK_STATUS(STATUS, STATUS_RET, COUNTER, OK) do { Status st = STATUS_RET; if (!st.IsOk()) {STATUS = st; if (--COUNTER == 0) {OK.set_value(true);} return;}} while(0);
 
 namespace ps {
 namespace server {
 
+namespace {
+
+// The checkpoints of a run are the directories under one root, the files of
+// a delta chain are named relative to it so the root can be moved as one.
+void SplitCheckpointPath(const std::string& checkpoint_path, std::string* root, std::string* checkpoint) {
+  size_t pos = checkpoint_path.find_last_of('/');
+  if (pos == std::string::npos) {
+    root->clear();
+    *checkpoint = checkpoint_path;
+  } else {
+    *root = checkpoint_path.substr(0, pos);
+    *checkpoint = checkpoint_path.substr(pos + 1);
+  }
+}
+
+std::string ChainFileName(const std::string& root, const std::string& file) {
+  return root.empty() ? file : root + '/' + file;
+}
+
+}  // namespace
+
 CheckpointUtils::CheckpointUtils(const VariableInfoCollection& infos) : infos_(infos) {
 }
 
@@ -106,6 +131,17 @@ Status CheckpointUtils::SaveVariables(
     const std::string& checkpoint_path,
     const std::unordered_map<std::string, std::unique_ptr<Variable>>& vars,
     size_t timeout) {
+  SaveSnapshot snapshot;
+  PS_CHECK_STATUS(Snapshot(id, checkpoint_path, vars, &snapshot, timeout));
+  return WriteSnapshot(&snapshot, timeout);
+}
+
+Status CheckpointUtils::Snapshot(
+    size_t id,
+    const std::string& checkpoint_path,
+    const std::unordered_map<std::string, std::unique_ptr<Variable>>& vars,
+    SaveSnapshot* snapshot,
+    size_t timeout) {
   std::map<std::string, VariableInfo> dest_infos;
   for (auto&& item : infos_.infos) {
     dest_infos[item.name] = item;
@@ -113,12 +149,15 @@ Status CheckpointUtils::SaveVariables(
   if (vars.size() == 0) {
     return Status::Ok();
   }
+  std::vector<std::unique_ptr<SaveTask>> tasks(vars.size());
   std::atomic<size_t> counter(vars.size());
   Status status = Status::Ok();
   std::promise<bool> ok;
+  size_t task_id = 0;
   for (auto&& item : vars) {
     std::string name = item.first;
-    ThreadPool::Global()->Schedule([&, name] {
+    std::unique_ptr<SaveTask>* task = &tasks[task_id++];
+    CheckpointCodec::WriterPool()->Schedule([&, name, task] {
           auto iter = dest_infos.find(name);
           if (iter == dest_infos.end()) {
             CK_CHECK_STATUS(status, Status::ArgumentError("Can't find variable[" + name + "] in variable_infos."), counter, ok);
@@ -141,9 +180,31 @@ Status CheckpointUtils::SaveVariables(
             CK_CHECK_STATUS(status, Status::ArgumentError("Not found variable[" + name + "] part[" + std::to_string(id) + "] in variable_infos when save variable."),
                             counter, ok);
           }
-          VariableStruct vs;
-          CK_CHECK_STATUS(status, VariableToStruct(vars.at(name), &vs), counter, ok);
-          CK_CHECK_STATUS(status, SaveVariable(checkpoint_path, iter->first, part, &vs), counter, ok);
+          CheckpointCodec::Compression compression;
+          auto codec = info.args.find(VariableInfo::CHECKPOINT_COMPRESSION);
+          CK_CHECK_STATUS(status, CheckpointCodec::ParseCompression(codec == info.args.end() ? "" : codec->second, &compression), counter, ok);
+          task->reset(new SaveTask);
+          (*task)->checkpoint_path = checkpoint_path;
+          (*task)->name = iter->first;
+          (*task)->part = part;
+          LazyRows* lazy_rows = vars.at(name)->GetLazyRows();
+          if (lazy_rows != nullptr) {
+            CK_CHECK_STATUS(status, lazy_rows->EnsureAll(), counter, ok);
+          }
+          auto incremental = info.args.find(VariableInfo::INCREMENTAL_CHECKPOINT);
+          if (incremental != info.args.end()) {
+            uint64_t max_deltas;
+            if (!StringUtils::strToUInt64(incremental->second.c_str(), max_deltas)) {
+              CK_CHECK_STATUS(status, Status::ArgumentError("Variable[" + name + "] " + VariableInfo::INCREMENTAL_CHECKPOINT + " not int " + incremental->second),
+                              counter, ok);
+            }
+            CK_CHECK_STATUS(status, SnapshotIncrementalVariable(vars.at(name), max_deltas, task->get()), counter, ok);
+          } else {
+            CK_CHECK_STATUS(status, VariableToStruct(vars.at(name), &(*task)->vs), counter, ok);
+          }
+          (*task)->vs.compression = compression;
+          (*task)->variable = vars.at(name).get();
+          (*task)->variable->PinForSave();
           if (--counter == 0) {
             ok.set_value(true);
           }
@@ -154,6 +215,45 @@ Status CheckpointUtils::SaveVariables(
     LOG(FATAL) << "Save checkpoint timeout, killing myself...";
     throw std::runtime_error("Save checkpoint timeout");
   }
+  for (auto& task : tasks) {
+    if (task != nullptr && task->variable != nullptr) {
+      if (status.IsOk()) {
+        snapshot->tasks.push_back(std::move(task));
+      } else {
+        task->variable->UnpinForSave();
+      }
+    }
+  }
+  return status;
+}
+
+Status CheckpointUtils::WriteSnapshot(SaveSnapshot* snapshot, size_t timeout) {
+  if (snapshot->tasks.size() == 0) {
+    return Status::Ok();
+  }
+  std::atomic<size_t> counter(snapshot->tasks.size());
+  Status status = Status::Ok();
+  std::promise<bool> ok;
+  for (auto& item : snapshot->tasks) {
+    SaveTask* task = item.get();
+    CheckpointCodec::WriterPool()->Schedule([&, task] {
+          Status saved = SaveVariable(task->checkpoint_path, task->name, task->part, &task->vs);
+          if (saved.IsOk() && task->dirty_rows != nullptr) {
+            task->dirty_rows->SetChain(task->chain, task->chain_rows);
+          }
+          task->variable->UnpinForSave();
+          CK_CHECK_STATUS(status, saved, counter, ok);
+          if (--counter == 0) {
+            ok.set_value(true);
+          }
+        });
+  }
+  std::future_status fstatus = ok.get_future().wait_for(std::chrono::minutes(timeout));
+  if (fstatus != std::future_status::ready) {
+    LOG(FATAL) << "Save checkpoint timeout, killing myself...";
+    throw std::runtime_error("Save checkpoint timeout");
+  }
+  snapshot->tasks.clear();
   return status;
 }
 
@@ -185,23 +285,51 @@ Status CheckpointUtils::MergeLoadVariable(const std::string& name, const Variabl
   std::chrono::time_point<std::chrono::system_clock> time_start, time_end;
   time_start = std::chrono::system_clock::now();
   
-  for (size_t i = 0; i < info.parts.size(); i++) {
-    size_t part_end = part_beg + info.parts[i].size;
-    if (part_beg < end && beg < part_end) {
-      LOG(INFO) << name << ", part_beg [" << part_beg << "] part_end [" << part_end << "]";
-      variables.emplace_back(new LoadVariableStruct);
-      LoadVariableStruct& lvs = *variables.back();
-      lvs.beg = part_beg;
-      lvs.end = part_end;
-      lvs.clip_beg = std::max(part_beg, beg);
-      lvs.clip_end = std::min(part_end, end);
-      PS_CHECK_STATUS(LoadVariable(info, i, &lvs.variable));
-      if (!lvs.variable.initialized) {
-        variables.pop_back();
+  // every overlapping part is a separate file, read them as parallel streams
+  auto load_parts = [&](bool lazy) {
+    variables.clear();
+    part_beg = 0;
+    std::vector<std::future<Status>> loads;
+    for (size_t i = 0; i < info.parts.size(); i++) {
+      size_t part_end = part_beg + info.parts[i].size;
+      if (part_beg < end && beg < part_end) {
+        LOG(INFO) << name << ", part_beg [" << part_beg << "] part_end [" << part_end << "]";
+        variables.emplace_back(new LoadVariableStruct);
+        LoadVariableStruct* lvs = variables.back().get();
+        lvs->beg = part_beg;
+        lvs->end = part_end;
+        lvs->clip_beg = std::max(part_beg, beg);
+        lvs->clip_end = std::min(part_end, end);
+        lvs->variable.initialized = false;
+        loads.push_back(std::async(std::launch::async, [this, &info, i, lvs, lazy] {
+              return lazy ? LoadVariableIndex(info, i, lvs) : LoadVariable(info, i, &lvs->variable);
+            }));
+      }
+      part_beg = part_end;
+    }
+    Status load_status = Status::Ok();
+    for (auto& load : loads) {
+      Status st = load.get();
+      if (load_status.IsOk() && !st.IsOk()) {
+        load_status = st;
       }
     }
-    part_beg = part_end;
+    return load_status;
+  };
+  Status load_status = Status::Ok();
+  if (info.type != VariableInfo::Type::kIndex && LazyRestore()) {
+    load_status = load_parts(true);
+    if (load_status.Code() == Status::ErrorCode::kNotImplemented) {
+      LOG(INFO) << name << ", can't restore lazily, " << load_status.Msg();
+      load_status = load_parts(false);
+    }
+  } else {
+    load_status = load_parts(false);
   }
+  PS_CHECK_STATUS(load_status);
+  variables.erase(std::remove_if(variables.begin(), variables.end(),
+                                 [](const std::unique_ptr<LoadVariableStruct>& lvs) { return !lvs->variable.initialized; }),
+                  variables.end());
   if (variables.size() == 0) {
     return Status::NotFound("Not found variable when load " + info.name);
   }
@@ -260,7 +388,7 @@ Status CheckpointUtils::MergeLoadVariable(const std::string& name, const Variabl
       return Status::Ok();
   } else {
     time_start = std::chrono::system_clock::now();
-    LoadHashVariable(variables, name, info, beg, end, *result_variable);
+    PS_CHECK_STATUS(LoadHashVariable(variables, name, info, beg, end, *result_variable));
     time_end = std::chrono::system_clock::now();
     LOG(INFO) << info.name << ", load hash variable total, takes " << std::chrono::duration_cast<std::chrono::seconds>(time_end-time_start).count();
     return Status::Ok();
@@ -282,12 +410,20 @@ Status CheckpointUtils::LoadHashVariable(const std::vector<std::unique_ptr<LoadV
   TensorShape data_shape = t.Shape();
   data_shape.Set(0, max_size);
   HashMap* hashmap;
-  if (info.type == VariableInfo::Type::kHash128) {
-    hashmap = new HashMapImpl<Hash128Key>(100);
-  } else {
-    hashmap = new HashMapImpl<int64_t>(100);
+  auto backend = info.args.find("hashmap");
+  PS_CHECK_STATUS(CreateHashMap(backend == info.args.end() ? "" : backend->second,
+                                info.type != VariableInfo::Type::kHash128, 100, &hashmap));
+  // the restored rows keep the layout of the variable, interleaved with
+  // the variable-like slots if row_interleave_bytes is set
+  uint64_t row_interleave_bytes = 0;
+  auto interleave = info.args.find("row_interleave_bytes");
+  if (interleave != info.args.end() && !StringUtils::strToUInt64(interleave->second.c_str(), row_interleave_bytes)) {
+    return Status::ArgumentError("Variable[" + name + "] row_interleave_bytes not int " + interleave->second);
   }
-  Variable* var = new Variable(new Tensor(t.Type(), data_shape, t.GetInitializer()->Clone(), Tensor::TType::kSegment, false), new WrapperData<std::unique_ptr<HashMap> >(hashmap), name);
+  Tensor* data = row_interleave_bytes == 0
+      ? new Tensor(t.Type(), data_shape, t.GetInitializer()->Clone(), Tensor::TType::kSegment, false)
+      : new Tensor(t.Type(), data_shape, t.GetInitializer()->Clone(), false, Tensor::DEFAULT_SEGMENT_SIZE, row_interleave_bytes);
+  Variable* var = new Variable(data, new WrapperData<std::unique_ptr<HashMap> >(hashmap), name);
   std::unordered_map<std::string, Variable::Slot> slots;
   for (const auto& iter : variables[0]->variable.slots) {
     if (iter.second.joiner == Variable::SlotJoiner::kAnyOne) {
@@ -295,6 +431,12 @@ Status CheckpointUtils::LoadHashVariable(const std::vector<std::unique_ptr<LoadV
     } else {
       Tensor& tt = *iter.second.tensor;
       TensorShape tt_shape = tt.Shape();
+      tt_shape.Set(0, data->Shape()[0]);
+      Tensor field;
+      if (data->Interleaved() && data->AddRowField(tt.Type(), tt_shape, tt.GetInitializer()->Clone(), false, &field).IsOk()) {
+        slots[iter.first] = Variable::Slot{.tensor = std::unique_ptr<Tensor>(new Tensor(std::move(field))), .joiner = iter.second.joiner};
+        continue;
+      }
       tt_shape.Set(0, max_size);
       slots[iter.first] = Variable::Slot{.tensor = std::unique_ptr<Tensor>(new Tensor(tt.Type(), tt_shape, tt.GetInitializer()->Clone(), Tensor::TType::kSegment, false)), .joiner = iter.second.joiner};
     }
@@ -302,32 +444,75 @@ Status CheckpointUtils::LoadHashVariable(const std::vector<std::unique_ptr<LoadV
   time_end = std::chrono::system_clock::now();
   LOG(INFO) << name << ", initialize takes " << std::chrono::duration_cast<std::chrono::seconds>(time_end-time_start).count();
 
-  for (size_t i = 0; i < variables.size(); i++) {
-    const std::unique_ptr<LoadVariableStruct>& lvs = variables[i];
-    std::vector<int64_t>& key = keys[i];
-    std::vector<int64_t>& value = values[i];
-    std::vector<size_t> ids;
-    time_start = std::chrono::system_clock::now();
-    size_t no_use;
-    hashmap->Get((int64_t*)&key[0], value.size(), false, 1.0, &ids, nullptr, &no_use, 10000000000L);
-    size_t slice_size = SizeOfType(var->GetData()->Type()) * var->GetData()->Shape().NumElements() / var->GetData()->Shape()[0];
-    for (size_t j = 0; j < ids.size(); j++) {
-      char* target = var->GetData()->Raw<char>(ids[j]);
-      char* source = lvs->variable.data.Raw<char>(value[j]);
-      memcpy(target, source, slice_size);
-      for (auto& slot : slots) {
-        if (slot.second.joiner == Variable::SlotJoiner::kVariableLike) {
-          size_t ssize = SizeOfType(slot.second.tensor->Type()) * slot.second.tensor->Shape().NumElements() / slot.second.tensor->Shape()[0];
-          char* target = slot.second.tensor->Raw<char>(ids[j]);
-          char* source = lvs->variable.slots[slot.first].tensor->Raw<char>(value[j]);
-          memcpy(target, source, ssize);
+  std::unique_ptr<LazyRows> lazy_rows;
+  if (variables[0]->lazy) {
+    std::vector<Tensor*> tensors = {var->GetData()};
+    std::vector<std::string> slot_names;
+    for (auto& slot : slots) {
+      if (slot.second.joiner == Variable::SlotJoiner::kVariableLike) {
+        tensors.push_back(slot.second.tensor.get());
+        slot_names.push_back(slot.first);
+      }
+    }
+    lazy_rows.reset(new LazyRows(name, tensors, max_size, var->GetData()->SegmentSize()));
+    for (auto& lvs : variables) {
+      std::vector<uint64_t> offsets = {lvs->data_offset};
+      for (auto& slot_name : slot_names) {
+        auto iter = lvs->slot_offsets.find(slot_name);
+        if (iter == lvs->slot_offsets.end()) {
+          delete var;
+          return Status::ArgumentError("Variable[" + name + "] slot[" + slot_name + "] not found in all parts");
         }
+        offsets.push_back(iter->second);
       }
+      lazy_rows->AddPart(std::move(lvs->file), offsets);
     }
-    time_end = std::chrono::system_clock::now();
-    LOG(INFO) << name << ", memcpy takes " << std::chrono::duration_cast<std::chrono::seconds>(time_end-time_start).count();
+  }
+
+  // parts hold disjoint keys, so their rows are copied concurrently
+  std::vector<std::future<void>> copies;
+  for (size_t i = 0; i < variables.size(); i++) {
+    copies.push_back(std::async(std::launch::async, [&, i] {
+          const std::unique_ptr<LoadVariableStruct>& lvs = variables[i];
+          std::vector<int64_t>& key = keys[i];
+          std::vector<int64_t>& value = values[i];
+          std::vector<size_t> ids;
+          auto copy_start = std::chrono::system_clock::now();
+          size_t no_use;
+          hashmap->Get((int64_t*)&key[0], value.size(), false, 1.0, &ids, nullptr, &no_use, 10000000000L);
+          if (lazy_rows != nullptr) {
+            for (size_t j = 0; j < ids.size(); j++) {
+              lazy_rows->SetSource(ids[j], i, value[j]);
+            }
+            return;
+          }
+          size_t slice_size = SizeOfType(var->GetData()->Type()) * var->GetData()->Shape().NumElements() / var->GetData()->Shape()[0];
+          for (size_t j = 0; j < ids.size(); j++) {
+            char* target = var->GetData()->Raw<char>(ids[j]);
+            char* source = lvs->variable.data.Raw<char>(value[j]);
+            memcpy(target, source, slice_size);
+            for (auto& slot : slots) {
+              if (slot.second.joiner == Variable::SlotJoiner::kVariableLike) {
+                size_t ssize = SizeOfType(slot.second.tensor->Type()) * slot.second.tensor->Shape().NumElements() / slot.second.tensor->Shape()[0];
+                char* target = slot.second.tensor->Raw<char>(ids[j]);
+                char* source = lvs->variable.slots[slot.first].tensor->Raw<char>(value[j]);
+                memcpy(target, source, ssize);
+              }
+            }
+          }
+          auto copy_end = std::chrono::system_clock::now();
+          LOG(INFO) << name << ", memcpy takes " << std::chrono::duration_cast<std::chrono::seconds>(copy_end-copy_start).count();
+        }));
+  }
+  for (auto& copy : copies) {
+    copy.get();
   }
   var->SetSlots(std::move(slots));
+  if (lazy_rows != nullptr) {
+    LOG(INFO) << name << ", index restored, " << max_size << " rows are restored lazily";
+    lazy_rows->Start();
+    var->SetLazyRows(lazy_rows.release());
+  }
   result_variable.reset(var);
   return Status::Ok();
 }
@@ -383,7 +568,72 @@ Status CheckpointUtils::LoadVariable(const VariableInfo& info, size_t part, Vari
     var->initialized = false;
     return st;
   }
-  return LoadVariable(info.name + " part[" + std::to_string(part) + "]", s.get(), var);
+  std::string name = info.name + " part[" + std::to_string(part) + "]";
+  PS_CHECK_STATUS(LoadVariable(name, s.get(), var));
+  if (var->delta) {
+    std::string root, checkpoint;
+    SplitCheckpointPath(info.args.at(VariableInfo::ORIGIN_FILE_PATH), &root, &checkpoint);
+    PS_CHECK_STATUS(LoadDeltaChain(name, root, var));
+  }
+  return Status::Ok();
+}
+
+bool CheckpointUtils::LazyRestore() {
+  char* env = getenv("PS_LAZY_RESTORE");
+  return env != nullptr && (std::string(env) == "1" || std::string(env) == "true");
+}
+
+Status CheckpointUtils::LoadVariableIndex(const VariableInfo& info, size_t part, LoadVariableStruct* lvs) {
+  VariableStruct* var = &lvs->variable;
+  std::string file_name = VariableInfoToFileName(info, part);
+  std::unique_ptr<FileSystem::ReadStream> s;
+  Status st = FileSystem::OpenReadStreamAny(file_name, &s);
+  if (!st.IsOk()) {
+    LOG(ERROR) << "Open " << file_name << " failed.";
+    var->initialized = false;
+    return st;
+  }
+  PS_CHECK_STATUS(s->ReadRaw(&(var->type)));
+  if (var->type == VariableStruct::kCompressed || var->type == VariableStruct::kDelta) {
+    return Status::NotImplemented(file_name + " is compressed or incremental");
+  }
+  switch (var->type) {
+  case VariableStruct::kHashSlicer128:
+    PS_CHECK_STATUS(s->ReadRaw(&(var->hash_slicer128.count)));
+    PS_CHECK_STATUS(s->ReadTBBVec(&(var->hash_slicer128.items)));
+    break;
+  case VariableStruct::kHashSlicer64:
+    PS_CHECK_STATUS(s->ReadRaw(&(var->hash_slicer64.count)));
+    PS_CHECK_STATUS(s->ReadTBBVec(&(var->hash_slicer64.items)));
+    break;
+  default:
+    return Status::NotImplemented(file_name + " is not a hash variable");
+  }
+  PS_CHECK_STATUS(FileSystem::OpenRandomAccessAny(file_name, &lvs->file));
+  size_t bytes;
+  PS_CHECK_STATUS(LoadTensorHeader(s.get(), &var->data, &bytes));
+  lvs->data_offset = s->Tell();
+  PS_CHECK_STATUS(s->Skip(bytes));
+  size_t slot_size;
+  PS_CHECK_STATUS(s->ReadRaw(&slot_size));
+  for (size_t i = 0; i < slot_size; i++) {
+    std::string slot_name;
+    PS_CHECK_STATUS(s->ReadStr(&slot_name));
+    Variable::Slot& slot = var->slots[slot_name];
+    slot.tensor.reset(new Tensor);
+    PS_CHECK_STATUS(s->ReadRaw(&slot.joiner));
+    if (slot.joiner == Variable::SlotJoiner::kAnyOne) {
+      std::string name = info.name + " part[" + std::to_string(part) + "] slot[" + slot_name + "]";
+      PS_CHECK_STATUS(LoadTensor(name, s.get(), var->type, var->compression, slot.tensor.get()));
+    } else {
+      PS_CHECK_STATUS(LoadTensorHeader(s.get(), slot.tensor.get(), &bytes));
+      lvs->slot_offsets[slot_name] = s->Tell();
+      PS_CHECK_STATUS(s->Skip(bytes));
+    }
+  }
+  lvs->lazy = true;
+  var->initialized = true;
+  return Status::Ok();
 }
 
 Status CheckpointUtils::SaveVariable(const std::string& checkpoint, const std::string& var_name, size_t part, VariableStruct* var) {
@@ -392,6 +642,158 @@ Status CheckpointUtils::SaveVariable(const std::string& checkpoint, const std::s
   return SaveVariable(s.get(), var);
 }
 
+Status CheckpointUtils::SnapshotIncrementalVariable(const std::unique_ptr<Variable>& var, size_t max_deltas, SaveTask* task) {
+  DirtyRows& dirty_rows = var->GetDirtyRows();
+  bool tracked = dirty_rows.Enabled();
+  dirty_rows.Enable();
+  std::vector<size_t> ids;
+  bool all;
+  dirty_rows.Collect(&ids, &all);
+  std::vector<std::string> chain;
+  size_t base_rows;
+  dirty_rows.GetChain(&chain, &base_rows);
+  // the collected rows are gone, a failed save must be followed by a full one
+  dirty_rows.SetChain({}, 0);
+  task->dirty_rows = &dirty_rows;
+
+  VariableStruct& vs = task->vs;
+  PS_CHECK_STATUS(VariableToStruct(var, &vs));
+  std::string root, checkpoint;
+  SplitCheckpointPath(task->checkpoint_path, &root, &checkpoint);
+  std::string file_name = checkpoint + '/' + VariableNameToFileName(task->name, task->part);
+  TensorShape shape = vs.data.Shape();
+  if (!tracked || all || chain.empty() || chain.size() > max_deltas || shape.IsScalar() || shape[0] == 0) {
+    task->chain = {file_name};
+    task->chain_rows = shape.IsScalar() ? 0 : shape[0];
+    return Status::Ok();
+  }
+
+  size_t rows = shape[0];
+  std::vector<size_t> delta_ids;
+  for (size_t id : ids) {
+    if (id < base_rows && id < rows) {
+      delta_ids.push_back(id);
+    }
+  }
+  // rows created since the last save may hold initial values only
+  for (size_t id = base_rows; id < rows; id++) {
+    delta_ids.push_back(id);
+  }
+  // rows of a delta are few, they are copied right away
+  PS_CHECK_STATUS(GatherRows(delta_ids, &vs.data));
+  for (auto& slot : vs.slots) {
+    if (slot.second.joiner == Variable::SlotJoiner::kVariableLike) {
+      PS_CHECK_STATUS(GatherRows(delta_ids, slot.second.tensor.get()));
+    }
+  }
+  LOG(INFO) << task->name << ", incremental checkpoint saves " << delta_ids.size() << " of " << rows << " rows, " << chain.size() << " files before it";
+  vs.delta = true;
+  vs.chain = chain;
+  vs.delta_rows = rows;
+  vs.delta_ids = std::move(delta_ids);
+  task->chain = chain;
+  task->chain.push_back(file_name);
+  task->chain_rows = rows;
+  return Status::Ok();
+}
+
+Status CheckpointUtils::LoadDeltaChain(const std::string& name, const std::string& root, VariableStruct* var) {
+  const std::vector<std::string>& chain = var->chain;
+  if (chain.empty()) {
+    return Status::DataLoss(name + " delta without base");
+  }
+  // files of the chain are independent, only the replay is ordered
+  std::vector<std::unique_ptr<VariableStruct>> prevs(chain.size());
+  std::vector<std::future<Status>> loads;
+  for (size_t i = 0; i < chain.size(); i++) {
+    prevs[i].reset(new VariableStruct);
+    loads.push_back(std::async(std::launch::async, [&, i] {
+          std::string file_name = ChainFileName(root, chain[i]);
+          std::unique_ptr<FileSystem::ReadStream> s;
+          Status st = FileSystem::OpenReadStreamAny(file_name, &s);
+          if (!st.IsOk()) {
+            return Status::DataLoss(name + " misses " + file_name + " of its delta chain, " + st.ToString());
+          }
+          return LoadVariable(name + " [" + file_name + "]", s.get(), prevs[i].get());
+        }));
+  }
+  Status st = Status::Ok();
+  for (auto& load : loads) {
+    Status ret = load.get();
+    if (!ret.IsOk()) {
+      st = ret;
+    }
+  }
+  PS_CHECK_STATUS(st);
+  if (prevs[0]->delta) {
+    return Status::DataLoss(name + " base " + chain[0] + " is a delta");
+  }
+  for (size_t i = 1; i < prevs.size(); i++) {
+    if (!prevs[i]->delta) {
+      return Status::DataLoss(name + " " + chain[i] + " in the chain is not a delta");
+    }
+    PS_CHECK_STATUS(ApplyDelta(*prevs[i - 1], prevs[i].get()));
+  }
+  return ApplyDelta(*prevs.back(), var);
+}
+
+Status CheckpointUtils::ApplyDelta(const VariableStruct& prev, VariableStruct* var) {
+  if (prev.type != var->type) {
+    return Status::DataLoss("Delta slicer type mismatch with its base");
+  }
+  PS_CHECK_STATUS(ExpandRows(var->delta_ids, var->delta_rows, &prev.data, &var->data));
+  for (auto& slot : var->slots) {
+    if (slot.second.joiner == Variable::SlotJoiner::kVariableLike) {
+      auto iter = prev.slots.find(slot.first);
+      const Tensor* prev_slot = iter == prev.slots.end() ? nullptr : iter->second.tensor.get();
+      PS_CHECK_STATUS(ExpandRows(var->delta_ids, var->delta_rows, prev_slot, slot.second.tensor.get()));
+    }
+  }
+  var->delta = false;
+  return Status::Ok();
+}
+
+Status CheckpointUtils::GatherRows(const std::vector<size_t>& ids, Tensor* data) {
+  TensorShape shape = data->Shape();
+  size_t slice_size = SizeOfType(data->Type()) * shape.NumElements() / shape[0];
+  shape.Set(0, ids.size());
+  Tensor result(data->Type(), shape, data->GetInitializer()->Clone(), Tensor::TType::kContinuous, false);
+  for (size_t i = 0; i < ids.size(); i++) {
+    memcpy(result.Raw<char>() + i * slice_size, data->Raw<char>(ids[i]), slice_size);
+  }
+  *data = result;
+  return Status::Ok();
+}
+
+Status CheckpointUtils::ExpandRows(const std::vector<size_t>& ids, size_t rows, const Tensor* prev, Tensor* data) {
+  TensorShape shape = data->Shape();
+  if (shape.IsScalar() || shape[0] != ids.size()) {
+    return Status::DataLoss("Delta rows mismatch with its ids");
+  }
+  size_t slice_size = SizeOfType(data->Type());
+  for (size_t i = 1; i < shape.Size(); i++) {
+    slice_size *= shape[i];
+  }
+  shape.Set(0, rows);
+  // rows missing from prev are only possible for slots created after it
+  Tensor result(data->Type(), shape, data->GetInitializer()->Clone(), Tensor::TType::kContinuous, prev == nullptr);
+  if (prev != nullptr) {
+    TensorShape prev_shape = prev->Shape();
+    if (prev->Type() != data->Type() || prev_shape.IsScalar() || prev_shape.NumElements() / prev_shape[0] * SizeOfType(prev->Type()) != slice_size) {
+      return Status::DataLoss("Delta shape mismatch with its base");
+    }
+    QuickMemcpy(result.Raw<char>(), prev->Raw<char>(), std::min(rows, prev_shape[0]) * slice_size);
+  }
+  for (size_t i = 0; i < ids.size(); i++) {
+    if (ids[i] >= rows) {
+      return Status::DataLoss("Delta row overflow");
+    }
+    memcpy(result.Raw<char>() + ids[i] * slice_size, data->Raw<char>() + i * slice_size, slice_size);
+  }
+  *data = result;
+  return Status::Ok();
+}
+
 Status CheckpointUtils::VariableToStruct(const std::unique_ptr<Variable>& var, VariableStruct* vs) {
   Data* slicer = var->GetSlicer();
   if (dynamic_cast<WrapperData<size_t>*>(slicer) != nullptr) {
@@ -405,6 +807,12 @@ Status CheckpointUtils::VariableToStruct(const std::unique_ptr<Variable>& var, V
     } else if (dynamic_cast<HashMapImpl<Hash128Key>*>(hashmap) != nullptr) {
       vs->type = VariableStruct::kHashSlicer128;
       dynamic_cast<HashMapImpl<Hash128Key>*>(hashmap)->GetItems(&vs->hash_slicer128);
+    } else if (dynamic_cast<OpenHashMapImpl<int64_t>*>(hashmap) != nullptr) {
+      vs->type = VariableStruct::kHashSlicer64;
+      dynamic_cast<OpenHashMapImpl<int64_t>*>(hashmap)->GetItems(&vs->hash_slicer64);
+    } else if (dynamic_cast<OpenHashMapImpl<Hash128Key>*>(hashmap) != nullptr) {
+      vs->type = VariableStruct::kHashSlicer128;
+      dynamic_cast<OpenHashMapImpl<Hash128Key>*>(hashmap)->GetItems(&vs->hash_slicer128);
     }
   } else {
     return Status::NotImplemented("Not Implemented variable slicer type");
@@ -417,6 +825,22 @@ Status CheckpointUtils::VariableToStruct(const std::unique_ptr<Variable>& var, V
 
 Status CheckpointUtils::LoadVariable(const std::string& name, FileSystem::ReadStream* s, VariableStruct* var) {
   PS_CHECK_STATUS(s->ReadRaw(&(var->type)));
+  if (var->type == VariableStruct::kCompressed) {
+    PS_CHECK_STATUS(s->ReadRaw(&(var->compression)));
+    PS_CHECK_STATUS(s->ReadRaw(&(var->type)));
+  }
+  var->delta = var->type == VariableStruct::kDelta;
+  if (var->delta) {
+    size_t chain_size;
+    PS_CHECK_STATUS(s->ReadRaw(&chain_size));
+    var->chain.resize(chain_size);
+    for (size_t i = 0; i < chain_size; i++) {
+      PS_CHECK_STATUS(s->ReadStr(&var->chain[i]));
+    }
+    PS_CHECK_STATUS(s->ReadRaw(&(var->delta_rows)));
+    PS_CHECK_STATUS(s->ReadVec(&(var->delta_ids)));
+    PS_CHECK_STATUS(s->ReadRaw(&(var->type)));
+  }
   switch (var->type) {
   case VariableStruct::kIndexSlicer:
     PS_CHECK_STATUS(s->ReadRaw(&(var->index_slicer)));
@@ -432,7 +856,7 @@ Status CheckpointUtils::LoadVariable(const std::string& name, FileSystem::ReadSt
   default:
     return Status::NotImplemented("Not Implemented variable slicer type");
   }
-  PS_CHECK_STATUS(LoadTensor(name, s, var->type, &var->data));
+  PS_CHECK_STATUS(LoadTensor(name, s, var->type, var->compression, &var->data));
   size_t slot_size;
   PS_CHECK_STATUS(s->ReadRaw(&slot_size));
   for (size_t i = 0; i < slot_size; i++) {
@@ -441,13 +865,26 @@ Status CheckpointUtils::LoadVariable(const std::string& name, FileSystem::ReadSt
     Variable::Slot& slot = var->slots[slot_name];
     slot.tensor.reset(new Tensor);
     PS_CHECK_STATUS(s->ReadRaw(&slot.joiner));
-    PS_CHECK_STATUS(LoadTensor(name + " slot[" + slot_name + "]", s, var->type, slot.tensor.get()));
+    PS_CHECK_STATUS(LoadTensor(name + " slot[" + slot_name + "]", s, var->type, var->compression, slot.tensor.get()));
   }
   var->initialized = true;
   return Status::Ok();
 }
 
 Status CheckpointUtils::SaveVariable(FileSystem::WriteStream* s, VariableStruct* var) {
+  if (var->compression != CheckpointCodec::kNone) {
+    PS_CHECK_STATUS(s->WriteRaw(VariableStruct::kCompressed));
+    PS_CHECK_STATUS(s->WriteRaw(var->compression));
+  }
+  if (var->delta) {
+    PS_CHECK_STATUS(s->WriteRaw(VariableStruct::kDelta));
+    PS_CHECK_STATUS(s->WriteRaw(var->chain.size()));
+    for (auto&& file : var->chain) {
+      PS_CHECK_STATUS(s->WriteStr(file));
+    }
+    PS_CHECK_STATUS(s->WriteRaw(var->delta_rows));
+    PS_CHECK_STATUS(s->WriteVec(var->delta_ids));
+  }
   PS_CHECK_STATUS(s->WriteRaw(var->type));
   switch (var->type) {
   case VariableStruct::kIndexSlicer:
@@ -464,18 +901,18 @@ Status CheckpointUtils::SaveVariable(FileSystem::WriteStream* s, VariableStruct*
   default:
     return Status::NotImplemented("Not Implemented variable slicer type");
   }
-  PS_CHECK_STATUS(SaveTensor(s, var->data));
+  PS_CHECK_STATUS(SaveTensor(s, var->compression, var->data));
   size_t slot_size = var->slots.size();
   PS_CHECK_STATUS(s->WriteRaw(slot_size));
   for (auto&& slot : var->slots) {
     PS_CHECK_STATUS(s->WriteStr(slot.first));
     PS_CHECK_STATUS(s->WriteRaw(slot.second.joiner));
-    PS_CHECK_STATUS(SaveTensor(s, *slot.second.tensor));
+    PS_CHECK_STATUS(SaveTensor(s, var->compression, *slot.second.tensor));
   }
   return Status::Ok();
 }
 
-Status CheckpointUtils::LoadTensor(const std::string& name, FileSystem::ReadStream* s, VariableStruct::SlicerType slicer_type, Tensor* data) {
+Status CheckpointUtils::LoadTensor(const std::string& name, FileSystem::ReadStream* s, VariableStruct::SlicerType slicer_type, CheckpointCodec::Compression compression, Tensor* data) {
   DataType type;
   std::vector<size_t> shape;
   Initializer* initializer;
@@ -491,12 +928,37 @@ Status CheckpointUtils::LoadTensor(const std::string& name, FileSystem::ReadStre
   serializer::Fragment frag(&initializer_buf[0], initializer_buf.size());
   PS_CHECK_STATUS(serializer::DeserializeAny<Initializer>(initializer_type, &frag, 0, &initializer, &len, mem));
   Tensor result(type, TensorShape(shape), initializer, Tensor::TType::kContinuous, false);
-  PS_CHECK_STATUS(s->Read(result.Raw<char>(), result.Shape().NumElements() * SizeOfType(type)));
+  PS_CHECK_STATUS(CheckpointCodec::Read(s, compression, result.Raw<char>(), result.Shape().NumElements() * SizeOfType(type)));
   *data = result;
   return Status::Ok();
 }
 
-Status CheckpointUtils::SaveTensor(FileSystem::WriteStream* s, const Tensor& data) {
+Status CheckpointUtils::LoadTensorHeader(FileSystem::ReadStream* s, Tensor* data, size_t* bytes) {
+  DataType type;
+  std::vector<size_t> shape;
+  Initializer* initializer;
+  size_t initializer_type;
+  std::string initializer_buf;
+
+  PS_CHECK_STATUS(s->ReadRaw(&type));
+  PS_CHECK_STATUS(s->ReadVec(&shape));
+  PS_CHECK_STATUS(s->ReadRaw(&initializer_type));
+  PS_CHECK_STATUS(s->ReadStr(&initializer_buf));
+  size_t len;
+  serializer::MemGuard mem;
+  serializer::Fragment frag(&initializer_buf[0], initializer_buf.size());
+  PS_CHECK_STATUS(serializer::DeserializeAny<Initializer>(initializer_type, &frag, 0, &initializer, &len, mem));
+  TensorShape tensor_shape(shape);
+  *bytes = tensor_shape.NumElements() * SizeOfType(type);
+  if (shape.size() == 0) {
+    return Status::ArgumentError("Hash variable tensor should not be a scalar");
+  }
+  tensor_shape.Set(0, 1);
+  *data = Tensor(type, tensor_shape, initializer, Tensor::TType::kContinuous, false);
+  return Status::Ok();
+}
+
+Status CheckpointUtils::SaveTensor(FileSystem::WriteStream* s, CheckpointCodec::Compression compression, const Tensor& data) {
   DataType type = data.Type();
   TensorShape tensor_shape = data.Shape();
   const std::vector<size_t>& shape = tensor_shape.Dims();
@@ -515,17 +977,35 @@ Status CheckpointUtils::SaveTensor(FileSystem::WriteStream* s, const Tensor& dat
   PS_CHECK_STATUS(s->WriteVec(shape));
   PS_CHECK_STATUS(s->WriteRaw(initializer_type));
   PS_CHECK_STATUS(s->WriteStr(initializer_buf));
+  std::vector<std::pair<const char*, size_t>> spans;
   if (data.TensorType() == Tensor::TType::kContinuous) { 
-    PS_CHECK_STATUS(s->Write(data.Raw<char>(), tensor_shape.NumElements() * SizeOfType(type)));
+    spans.emplace_back(data.Raw<char>(), tensor_shape.NumElements() * SizeOfType(type));
+  } else if (data.TensorType() == Tensor::TType::kSegment && data.Interleaved()) {
+    // the rows are gathered by a few segments at a time, a segment is
+    // written as it would be without the interleaving
+    size_t row_size = tensor_shape.NumElements() / tensor_shape[0] * SizeOfType(type);
+    size_t segments = tensor_shape[0] / data.SegmentSize();
+    size_t batch = std::max<size_t>(1, CheckpointCodec::kChunkSize / (data.SegmentSize() * row_size)) * CheckpointCodec::Parallel();
+    std::string gather;
+    for (size_t i = 0; i < segments; i += batch) {
+      size_t rows = std::min(batch, segments - i) * data.SegmentSize();
+      gather.resize(rows * row_size);
+      for (size_t j = 0; j < rows; j++) {
+        memcpy(&gather[j * row_size], data.Raw<char>(i * data.SegmentSize() + j), row_size);
+      }
+      spans.assign(1, std::make_pair(gather.data(), gather.size()));
+      PS_CHECK_STATUS(CheckpointCodec::Write(s, compression, spans));
+    }
+    return Status::Ok();
   } else if (data.TensorType() == Tensor::TType::kSegment) {
     size_t slice_size = tensor_shape.NumElements()/tensor_shape[0];
     for (size_t i = 0; i < tensor_shape[0] / data.SegmentSize(); i++) {
-      PS_CHECK_STATUS(s->Write(data.Raw<char>(i * data.SegmentSize()), data.SegmentSize() * slice_size * SizeOfType(type)));
+      spans.emplace_back(data.Raw<char>(i * data.SegmentSize()), data.SegmentSize() * slice_size * SizeOfType(type));
     }
   } else {
     return Status::ArgumentError("Tensor type not support .");
   }
-  return Status::Ok();
+  return CheckpointCodec::Write(s, compression, spans);
 }
 
 std::unordered_map<std::string, Variable::Slot> CheckpointUtils::CloneSlots(const std::unordered_map<std::string, Variable::Slot>& slots) {
@@ -23,6 +23,7 @@ limitations under the License.
 #include "ps-plus/common/hashmap.h"
 #include "ps-plus/message/variable_info.h"
 #include "ps-plus/server/variable.h"
+#include "ps-plus/server/checkpoint_codec.h"
 #include "ps-plus/common/hasher.h"
 
 namespace ps {
@@ -41,12 +42,37 @@ class CheckpointUtils {
       const std::unordered_map<std::string, std::unique_ptr<Variable>>& vars,
       size_t timeout=30);
 
+ private:
+  struct SaveTask;
+
+ public:
+  // What SaveVariables writes. Hash keys and the rows of deltas are copied,
+  // other rows are shared with the variables, which stay pinned for save
+  // until the snapshot is written.
+  struct SaveSnapshot {
+    std::vector<std::unique_ptr<SaveTask>> tasks;
+  };
+  // Cheap enough to run under the server lock, WriteSnapshot runs without it.
+  Status Snapshot(
+      size_t id,
+      const std::string& checkpoint_path,
+      const std::unordered_map<std::string, std::unique_ptr<Variable>>& vars,
+      SaveSnapshot* snapshot,
+      size_t timeout=30);
+  Status WriteSnapshot(SaveSnapshot* snapshot, size_t timeout=30);
+
  private:
   struct VariableStruct {
     enum SlicerType : int32_t {
       kIndexSlicer = 0,
       kHashSlicer128 = 1,
       kHashSlicer64 = 2,
+      // leading tag of incremental checkpoint files, followed by the delta
+      // header and a regular variable
+      kDelta = 3,
+      // leading tag of compressed checkpoint files, followed by the
+      // compression, then a delta or a regular variable
+      kCompressed = 4,
     };
     bool initialized;
     SlicerType type;
@@ -55,21 +81,61 @@ class CheckpointUtils {
     size_t index_slicer;
     Tensor data;
     std::unordered_map<std::string, Variable::Slot> slots;
+    // data and variable-like slots of a delta only hold the rows in
+    // delta_ids, the other rows come from the files in chain
+    bool delta = false;
+    std::vector<std::string> chain;
+    size_t delta_rows = 0;
+    std::vector<size_t> delta_ids;
+    CheckpointCodec::Compression compression = CheckpointCodec::kNone;
+  };
+  struct SaveTask {
+    std::string checkpoint_path;
+    std::string name;
+    size_t part;
+    VariableStruct vs;
+    Variable* variable = nullptr;
+    // chain of incremental checkpoints once the task is written
+    DirtyRows* dirty_rows = nullptr;
+    std::vector<std::string> chain;
+    size_t chain_rows = 0;
   };
   struct LoadVariableStruct {
     VariableStruct variable;
     size_t beg, end;
     size_t clip_beg, clip_end;
+    // lazy restore only, the tensors of variable hold no rows but one, the
+    // rows are at the offsets of file
+    bool lazy = false;
+    std::unique_ptr<FileSystem::RandomAccessFile> file;
+    uint64_t data_offset = 0;
+    std::unordered_map<std::string, uint64_t> slot_offsets;
   };
+  // PS_LAZY_RESTORE=1 restores the hash variables lazily, see LazyRows
+  static bool LazyRestore();
+  // LoadVariable of the hash index only, the row tensors are skipped and
+  // their offsets kept. NotImplemented for the files that can't be read
+  // lazily: compressed, incremental or not randomly accessible.
+  static Status LoadVariableIndex(const VariableInfo& info, size_t part, LoadVariableStruct* lvs);
+  // LoadTensor without the rows, data gets one row of the shape
+  static Status LoadTensorHeader(FileSystem::ReadStream* s, Tensor* data, size_t* bytes);
   Status LoadVariable(const VariableInfo& info, size_t part, VariableStruct* var);
   Status VariableToStruct(const std::unique_ptr<Variable>& var, VariableStruct* vs);
   static Status SaveVariable(const std::string& checkpoint_path, const std::string& var_name, size_t part, VariableStruct* var);
+  // Takes only the rows marked dirty since the last save, or a new full base
+  // when there is none yet or max_deltas deltas were saved after it.
+  Status SnapshotIncrementalVariable(const std::unique_ptr<Variable>& var, size_t max_deltas, SaveTask* task);
+  // The chain files are named relative to root, the parent of the checkpoints
+  static Status LoadDeltaChain(const std::string& name, const std::string& root, VariableStruct* var);
+  static Status ApplyDelta(const VariableStruct& prev, VariableStruct* var);
+  static Status GatherRows(const std::vector<size_t>& ids, Tensor* data);
+  static Status ExpandRows(const std::vector<size_t>& ids, size_t rows, const Tensor* prev, Tensor* data);
   static std::string VariableInfoToFileName(const VariableInfo& info, size_t id);
   static std::string VariableNameToFileName(const std::string& name, size_t id);
   static Status LoadVariable(const std::string& name, FileSystem::ReadStream* s, VariableStruct* var);
   static Status SaveVariable(FileSystem::WriteStream* s, VariableStruct* var);
-  static Status LoadTensor(const std::string& name, FileSystem::ReadStream* s, VariableStruct::SlicerType slicer_type, Tensor* data);
-  static Status SaveTensor(FileSystem::WriteStream* s, const Tensor& data);
+  static Status LoadTensor(const std::string& name, FileSystem::ReadStream* s, VariableStruct::SlicerType slicer_type, CheckpointCodec::Compression compression, Tensor* data);
+  static Status SaveTensor(FileSystem::WriteStream* s, CheckpointCodec::Compression compression, const Tensor& data);
   static std::unordered_map<std::string, Variable::Slot> CloneSlots(const std::unordered_map<std::string, Variable::Slot>& slots);
   Status MergeLoadVariable(const std::string& name, const VariableInfo& info, size_t beg, size_t end, std::unique_ptr<Variable>* result_variable);
   Status LoadHashVariable(const std::vector<std::unique_ptr<LoadVariableStruct>>& variables, const std::string& name, const VariableInfo& info, size_t beg, size_t end, std::unique_ptr<Variable>& result_variable);
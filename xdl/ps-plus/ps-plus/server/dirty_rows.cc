@@ -0,0 +1,77 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/server/dirty_rows.h"
+
+#include <algorithm>
+
+namespace ps {
+namespace server {
+
+DirtyRows::DirtyRows() : enabled_(false), all_(false), rows_(0) {
+}
+
+void DirtyRows::Mark(const std::vector<size_t>& ids) {
+  if (!Enabled()) {
+    return;
+  }
+  std::vector<size_t> sharded[kShards];
+  for (size_t id : ids) {
+    sharded[id % kShards].push_back(id);
+  }
+  for (size_t i = 0; i < kShards; i++) {
+    if (sharded[i].empty()) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(shards_[i].mu);
+    shards_[i].ids.insert(sharded[i].begin(), sharded[i].end());
+  }
+}
+
+void DirtyRows::MarkAll() {
+  if (Enabled()) {
+    all_ = true;
+  }
+}
+
+void DirtyRows::Collect(std::vector<size_t>* ids, bool* all) {
+  ids->clear();
+  *all = all_.exchange(false);
+  for (size_t i = 0; i < kShards; i++) {
+    std::unordered_set<size_t> shard_ids;
+    {
+      std::lock_guard<std::mutex> lock(shards_[i].mu);
+      shard_ids.swap(shards_[i].ids);
+    }
+    ids->insert(ids->end(), shard_ids.begin(), shard_ids.end());
+  }
+  std::sort(ids->begin(), ids->end());
+}
+
+void DirtyRows::GetChain(std::vector<std::string>* chain, size_t* rows) {
+  std::lock_guard<std::mutex> lock(chain_mu_);
+  *chain = chain_;
+  *rows = rows_;
+}
+
+void DirtyRows::SetChain(const std::vector<std::string>& chain, size_t rows) {
+  std::lock_guard<std::mutex> lock(chain_mu_);
+  chain_ = chain;
+  rows_ = rows;
+}
+
+}
+}
+
@@ -0,0 +1,70 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_SERVER_DIRTY_ROWS_H_
+#define PS_PLUS_SERVER_DIRTY_ROWS_H_
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace ps {
+namespace server {
+
+// Rows of a variable written since its last checkpoint, used by incremental
+// checkpoints. Nothing is recorded until the first incremental save enables
+// the tracker. Also keeps the chain of checkpoint files the next delta
+// builds on: the full base first, then every delta saved after it.
+class DirtyRows {
+ public:
+  DirtyRows();
+
+  bool Enabled() const { return enabled_.load(std::memory_order_relaxed); }
+  void Enable() { enabled_ = true; }
+
+  void Mark(const std::vector<size_t>& ids);
+  // Dense updates touch every row
+  void MarkAll();
+  // Swaps out the marked rows in ascending order, all is true when MarkAll
+  // was called since the last Collect.
+  void Collect(std::vector<size_t>* ids, bool* all);
+
+  // Files and row count of the last save, an empty chain forces a full save.
+  void GetChain(std::vector<std::string>* chain, size_t* rows);
+  void SetChain(const std::vector<std::string>& chain, size_t rows);
+
+ private:
+  DirtyRows(const DirtyRows&) = delete;
+  static const size_t kShards = 32;
+  struct Shard {
+    std::mutex mu;
+    std::unordered_set<size_t> ids;
+  };
+  Shard shards_[kShards];
+  std::atomic<bool> enabled_;
+  std::atomic<bool> all_;
+
+  std::mutex chain_mu_;
+  std::vector<std::string> chain_;
+  size_t rows_;
+};
+
+}
+}
+
+#endif
+
@@ -0,0 +1,128 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/server/hash_evictor.h"
+#include "ps-plus/common/hashmap.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace ps {
+namespace server {
+
+HashEvictor::HashEvictor(size_t idle_steps, size_t keep_count, size_t scan_interval,
+                         size_t scan_rows, size_t max_evict_per_pass)
+  : idle_steps_(idle_steps), keep_count_(keep_count),
+    scan_interval_(scan_interval == 0 ? 1 : scan_interval),
+    scan_rows_(scan_rows == 0 ? 1 : scan_rows),
+    max_evict_per_pass_(max_evict_per_pass), step_(0), cursor_(0), evicted_(0) {
+}
+
+void HashEvictor::Touch(const std::vector<size_t>& ids) {
+  uint32_t step = step_.load(std::memory_order_relaxed) + 1;
+  if (step == 0) {
+    // 0 is kept for the rows not seen yet
+    step = 1;
+  }
+  for (size_t id : ids) {
+    if (id == HashMap::NOT_ADD_ID) {
+      continue;
+    }
+    if (id >= last_access_.size()) {
+      access_count_.grow_to_at_least(id + 1, 0);
+      last_access_.grow_to_at_least(id + 1, 0);
+    }
+    __atomic_store_n(&last_access_[id], step, __ATOMIC_RELAXED);
+    uint32_t count = __atomic_load_n(&access_count_[id], __ATOMIC_RELAXED);
+    if (count != std::numeric_limits<uint32_t>::max()) {
+      __atomic_store_n(&access_count_[id], count + 1, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+bool HashEvictor::Step() {
+  return ++step_ % scan_interval_ == 0;
+}
+
+bool HashEvictor::IsIdle(size_t id, uint32_t step) const {
+  if (id >= last_access_.size()) {
+    return false;
+  }
+  uint32_t last = __atomic_load_n(&last_access_[id], __ATOMIC_RELAXED);
+  // unsigned distance stays right when the step wraps
+  return last != 0 && (uint32_t)(step - last) > idle_steps_;
+}
+
+bool HashEvictor::Scan(size_t size, std::vector<size_t>* ids) {
+  std::unique_lock<std::mutex> lock(scan_mu_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    return false;
+  }
+  if (size == 0) {
+    return true;
+  }
+  if (cursor_ >= size) {
+    cursor_ = 0;
+  }
+  uint32_t step = step_.load();
+  size_t end = std::min(size, cursor_ + scan_rows_);
+  access_count_.grow_to_at_least(end, 0);
+  last_access_.grow_to_at_least(end, 0);
+  size_t id = cursor_;
+  for (; id < end && ids->size() < max_evict_per_pass_; id++) {
+    uint32_t last = __atomic_load_n(&last_access_[id], __ATOMIC_RELAXED);
+    if (last == 0) {
+      // restored or free rows, they get a whole idle window from now
+      __atomic_store_n(&last_access_[id], step == 0 ? 1 : step, __ATOMIC_RELAXED);
+      continue;
+    }
+    uint32_t count = __atomic_load_n(&access_count_[id], __ATOMIC_RELAXED);
+    __atomic_store_n(&access_count_[id], count / 2, __ATOMIC_RELAXED);
+    if (IsIdle(id, step) && (keep_count_ == 0 || count < keep_count_)) {
+      ids->push_back(id);
+    }
+  }
+  cursor_ = id;
+  return true;
+}
+
+size_t HashEvictor::Evict(HashMap* hashmap, const std::vector<size_t>& ids, std::vector<size_t>* erased) {
+  uint32_t step = step_.load();
+  std::vector<size_t> idle;
+  for (size_t id : ids) {
+    // a pull may have touched the row after it was picked
+    if (IsIdle(id, step)) {
+      idle.push_back(id);
+    }
+  }
+  if (idle.empty()) {
+    return 0;
+  }
+  if (!hashmap->TrackingKeys()) {
+    hashmap->TrackKeys();
+  }
+  size_t begin = erased->size();
+  size_t size = hashmap->EraseIds(idle, erased);
+  for (size_t i = begin; i < erased->size(); i++) {
+    size_t id = (*erased)[i];
+    __atomic_store_n(&last_access_[id], 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&access_count_[id], 0, __ATOMIC_RELAXED);
+  }
+  evicted_ += size;
+  return size;
+}
+
+}
+}
@@ -0,0 +1,83 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_SERVER_HASH_EVICTOR_H_
+#define PS_PLUS_SERVER_HASH_EVICTOR_H_
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "tbb/concurrent_vector.h"
+
+#include "ps-plus/common/status.h"
+
+namespace ps {
+
+class HashMap;
+
+namespace server {
+
+// Incremental eviction of the idle keys of a hash variable.
+// Touch keeps the step of the last access and an access count of every row
+// on the pull path, both are relaxed stores so a lost update only delays an
+// eviction. Every scan_interval pulls, Scan visits the next scan_rows rows
+// from a cursor wrapping over the ids and picks the rows idle for idle_steps
+// pulls, unless they were accessed keep_count times since the last visit,
+// the count is halved by every visit. Evict erases at most max_evict_per_pass
+// of the picked rows, so the readers are blocked for a few of them only
+// instead of a pass over the whole table.
+class HashEvictor {
+ public:
+  HashEvictor(size_t idle_steps, size_t keep_count, size_t scan_interval,
+              size_t scan_rows, size_t max_evict_per_pass);
+
+  // Records ids as accessed in the current step.
+  void Touch(const std::vector<size_t>& ids);
+
+  // Advances the step, returns true when Scan should run.
+  bool Step();
+
+  // Picks the rows of the next slice of [0, size) to evict. Runs with the
+  // readers, returns false if another scan is running.
+  bool Scan(size_t size, std::vector<size_t>* ids);
+
+  // Erases the rows of ids still idle from hashmap, the erased ones are
+  // appended to erased. Needs every reader of the variable to be blocked.
+  size_t Evict(HashMap* hashmap, const std::vector<size_t>& ids, std::vector<size_t>* erased);
+
+  size_t Evicted() const { return evicted_; }
+
+ private:
+  bool IsIdle(size_t id, uint32_t step) const;
+
+  size_t idle_steps_;
+  size_t keep_count_;
+  size_t scan_interval_;
+  size_t scan_rows_;
+  size_t max_evict_per_pass_;
+  std::atomic<uint32_t> step_;
+  std::mutex scan_mu_;
+  size_t cursor_;
+  std::atomic<size_t> evicted_;
+  // step of the last access of each row, 0 for not seen yet
+  tbb::concurrent_vector<uint32_t> last_access_;
+  // accesses of each row since the last visit of Scan, halved by the visit
+  tbb::concurrent_vector<uint32_t> access_count_;
+};
+
+}
+}
+
+#endif
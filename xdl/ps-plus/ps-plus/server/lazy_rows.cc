@@ -0,0 +1,161 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/server/lazy_rows.h"
+#include "ps-plus/common/logging.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace ps {
+namespace server {
+
+const size_t LazyRows::kStripes;
+const uint64_t LazyRows::kNoSource;
+const int LazyRows::kRowBits;
+
+LazyRows::LazyRows(const std::string& name, const std::vector<Tensor*>& tensors, size_t rows, size_t segment_size)
+  : name_(name), tensors_(tensors), rows_(rows), segment_size_(segment_size),
+    segments_((rows + segment_size - 1) / segment_size), sources_(rows, kNoSource),
+    loaded_(new std::atomic<bool>[segments_]), remaining_(segments_), stop_(false) {
+  for (Tensor* tensor : tensors_) {
+    TensorShape shape = tensor->Shape();
+    row_bytes_.push_back(shape.NumElements() / shape[0] * SizeOfType(tensor->Type()));
+  }
+  for (size_t i = 0; i < segments_; i++) {
+    loaded_[i].store(false, std::memory_order_relaxed);
+  }
+}
+
+LazyRows::~LazyRows() {
+  stop_ = true;
+  if (loader_.joinable()) {
+    loader_.join();
+  }
+}
+
+size_t LazyRows::AddPart(std::unique_ptr<FileSystem::RandomAccessFile>&& file, const std::vector<uint64_t>& offsets) {
+  parts_.emplace_back();
+  parts_.back().file = std::move(file);
+  parts_.back().offsets = offsets;
+  return parts_.size() - 1;
+}
+
+void LazyRows::SetSource(size_t id, size_t part, size_t row) {
+  sources_[id] = ((uint64_t)part << kRowBits) | row;
+}
+
+void LazyRows::Start() {
+  if (segments_ == 0) {
+    Release();
+    return;
+  }
+  loader_ = std::thread([this] {
+        auto start = std::chrono::system_clock::now();
+        for (size_t i = 0; i < segments_ && !stop_; i++) {
+          Status st = LoadSegment(i);
+          if (!st.IsOk()) {
+            LOG(WARNING) << "Variable[" << name_ << "] lazy restore stopped, " << st.ToString();
+            return;
+          }
+        }
+        if (!stop_) {
+          LOG(INFO) << "Variable[" << name_ << "] lazy restore finished, takes " << std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now() - start).count();
+        }
+      });
+}
+
+Status LazyRows::Ensure(const std::vector<size_t>& ids) {
+  if (Done()) {
+    return Status::Ok();
+  }
+  for (size_t id : ids) {
+    if (id >= rows_) {
+      continue;
+    }
+    size_t segment = id / segment_size_;
+    if (!loaded_[segment].load(std::memory_order_acquire)) {
+      PS_CHECK_STATUS(LoadSegment(segment));
+    }
+  }
+  return Status::Ok();
+}
+
+Status LazyRows::EnsureAll() {
+  for (size_t i = 0; i < segments_ && !Done(); i++) {
+    if (!loaded_[i].load(std::memory_order_acquire)) {
+      PS_CHECK_STATUS(LoadSegment(i));
+    }
+  }
+  return Status::Ok();
+}
+
+Status LazyRows::LoadSegment(size_t segment) {
+  std::lock_guard<std::mutex> lock(mu_[segment % kStripes]);
+  if (loaded_[segment].load(std::memory_order_acquire)) {
+    return Status::Ok();
+  }
+  {
+    std::lock_guard<std::mutex> status_lock(status_mu_);
+    PS_CHECK_STATUS(status_);
+  }
+  size_t begin = segment * segment_size_;
+  size_t end = std::min(rows_, begin + segment_size_);
+  std::vector<char> buf;
+  for (size_t id = begin; id < end;) {
+    uint64_t source = sources_[id];
+    if (source == kNoSource) {
+      id++;
+      continue;
+    }
+    // the keys kept their order in the checkpoint, so the rows of a
+    // segment are mostly runs of one part, each read at once
+    size_t run = 1;
+    while (id + run < end && sources_[id + run] == source + run) {
+      run++;
+    }
+    Part& part = parts_[source >> kRowBits];
+    uint64_t row = source & ((1ull << kRowBits) - 1);
+    for (size_t i = 0; i < tensors_.size(); i++) {
+      size_t bytes = row_bytes_[i];
+      buf.resize(run * bytes);
+      Status st = part.file->Read(part.offsets[i] + row * bytes, &buf[0], run * bytes);
+      if (!st.IsOk()) {
+        std::lock_guard<std::mutex> status_lock(status_mu_);
+        status_ = Status::DataLoss("Variable[" + name_ + "] lazy restore read failed, " + st.ToString());
+        return status_;
+      }
+      for (size_t k = 0; k < run; k++) {
+        memcpy(tensors_[i]->Raw<char>(id + k), &buf[k * bytes], bytes);
+      }
+    }
+    id += run;
+  }
+  loaded_[segment].store(true, std::memory_order_release);
+  if (--remaining_ == 0) {
+    Release();
+  }
+  return Status::Ok();
+}
+
+void LazyRows::Release() {
+  // every segment is read, nobody looks at the sources or the files again
+  std::vector<uint64_t>().swap(sources_);
+  parts_.clear();
+}
+
+}
+}
+
@@ -0,0 +1,94 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_SERVER_LAZY_ROWS_H_
+#define PS_PLUS_SERVER_LAZY_ROWS_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ps-plus/common/file_system.h"
+#include "ps-plus/common/status.h"
+#include "ps-plus/common/tensor.h"
+
+namespace ps {
+namespace server {
+
+// The rows of a hash variable restored lazily. The restore only reads the
+// hash index of the checkpoint parts, the rows of a segment are read from
+// the part files by the first request touching it, and a background thread
+// reads the other segments in order. Every row of a segment is read at once,
+// so a segment is either all restored or untouched.
+class LazyRows {
+ public:
+  // tensors are the data and the variable-like slots, rows the restored
+  // rows, read by segment_size rows.
+  LazyRows(const std::string& name, const std::vector<Tensor*>& tensors, size_t rows, size_t segment_size);
+  ~LazyRows();
+
+  // A part file, offsets are where the rows of each tensor begin. Returns
+  // the index of the part for SetSource.
+  size_t AddPart(std::unique_ptr<FileSystem::RandomAccessFile>&& file, const std::vector<uint64_t>& offsets);
+  // Row id is restored from row of part, before Start
+  void SetSource(size_t id, size_t part, size_t row);
+  // Starts the background loader
+  void Start();
+
+  // Reads the segments of ids that are not read yet, ids out of the
+  // restored rows are skipped.
+  Status Ensure(const std::vector<size_t>& ids);
+  // Reads every segment left
+  Status EnsureAll();
+  bool Done() const { return remaining_.load() == 0; }
+
+ private:
+  static const size_t kStripes = 64;
+  static const uint64_t kNoSource = ~0ull;
+  static const int kRowBits = 40;
+
+  Status LoadSegment(size_t segment);
+  void Release();
+
+  std::string name_;
+  std::vector<Tensor*> tensors_;
+  std::vector<size_t> row_bytes_;
+  size_t rows_;
+  size_t segment_size_;
+  size_t segments_;
+  struct Part {
+    std::unique_ptr<FileSystem::RandomAccessFile> file;
+    std::vector<uint64_t> offsets;
+  };
+  std::vector<Part> parts_;
+  // part << kRowBits | row of each restored row, freed when all are read
+  std::vector<uint64_t> sources_;
+  std::unique_ptr<std::atomic<bool>[]> loaded_;
+  std::atomic<size_t> remaining_;
+  std::mutex mu_[kStripes];
+  std::mutex status_mu_;
+  Status status_;
+  std::atomic<bool> stop_;
+  std::thread loader_;
+};
+
+}
+}
+
+#endif
+
@@ -192,6 +192,23 @@ Status LocalServer::GetVariableInfo(const std::string& var_name,
                          var_name);
 }
 
+Status LocalServer::GetStats(ServerStats* result) {
+  result->server_id = 0;
+  for (auto& item : storage_manager_->Internal()) {
+    if (item.second == nullptr) {
+      continue;
+    }
+    VariableStats stats;
+    stats.name = item.first;
+    {
+      QRWLocker lock(item.second->VariableLock(), QRWLocker::kSimpleRead);
+      item.second->GetStats(&stats);
+    }
+    result->variables.push_back(std::move(stats));
+  }
+  return Status::Ok();
+}
+
 Status LocalServer::RegisterVariable(const std::string& name, 
                                      const VariableInfo& info) {
   VariableInfo vi = info;
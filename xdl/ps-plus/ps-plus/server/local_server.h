@@ -43,6 +43,7 @@ class LocalServer {
   Status Save(const std::string& ckpt_version);
   Status GetVariableInfo(const std::string& var_name, VariableInfo* info);
   Status RegisterVariable(const std::string& name, const VariableInfo& info);
+  Status GetStats(ServerStats* result);
 
  private:
   Status RunUdfChain(size_t udf, 
@@ -0,0 +1,112 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/server/reduced_slot.h"
+#include "ps-plus/common/initializer/constant_initializer.h"
+#include "ps-plus/common/initializer/encoded_constant_initializer.h"
+
+namespace ps {
+namespace server {
+
+namespace {
+
+std::string PrecisionName(StoragePrecision precision) {
+  switch (precision) {
+  case StoragePrecision::kFp16:
+    return "fp16";
+  case StoragePrecision::kBf16:
+    return "bf16";
+  case StoragePrecision::kInt8:
+    return "int8";
+  default:
+    return "fp32";
+  }
+}
+
+// The precision and the elements of a row of slot, false if its rows are
+// not encoded
+bool EncodedFormat(Tensor* slot, StoragePrecision* precision, size_t* slice_size) {
+  initializer::EncodedConstantInitializer* initializer =
+      dynamic_cast<initializer::EncodedConstantInitializer*>(slot->GetInitializer());
+  if (initializer == nullptr) {
+    return false;
+  }
+  *precision = initializer->precision();
+  *slice_size = initializer->slice_size();
+  return true;
+}
+
+size_t RowElements(Tensor* slot) {
+  const TensorShape& shape = slot->Shape();
+  if (shape.Size() == 0 || shape[0] == 0) {
+    return shape.NumElements();
+  }
+  return shape.NumElements() / shape[0];
+}
+
+}
+
+ReducedSlot::ReducedSlot()
+  : tensor_(nullptr), encoded_(false), precision_(StoragePrecision::kFloat), slice_size_(0) {
+}
+
+Status ReducedSlot::Init(Variable* variable, const std::string& name, DataType type, double initial_value) {
+  precision_ = variable->GetSlotPrecision();
+  encoded_ = false;
+  const TensorShape& shape = variable->GetData()->Shape();
+  size_t data_slice_size = shape.Size() == 0 || shape[0] == 0 ? shape.NumElements() : shape.NumElements() / shape[0];
+  std::string slot_name = "Variable[" + variable->GetName() + "] slot[" + name + "]";
+  StoragePrecision stored_precision;
+  size_t stored_slice_size;
+  if (precision_ == StoragePrecision::kFloat || shape.Size() == 0 || shape[0] == 0 ||
+      (type != DataType::kFloat && type != DataType::kDouble)) {
+    tensor_ = variable->GetVariableLikeSlot(name, type, [=]{ return new initializer::ConstantInitializer(initial_value); });
+    if (EncodedFormat(tensor_, &stored_precision, &stored_slice_size)) {
+      return Status::ArgumentError(slot_name + " is stored in " + PrecisionName(stored_precision) +
+                                   ", not in " + PrecisionName(precision_));
+    }
+    if (tensor_->Type() != type || RowElements(tensor_) != data_slice_size) {
+      return Status::ArgumentError(slot_name + " does not match the rows of the variable");
+    }
+    return Status::Ok();
+  }
+  slice_size_ = data_slice_size;
+  DataType encoded_type = EncodedDataType(precision_);
+  size_t row_size = EncodedRowBytes(precision_, slice_size_) / SizeOfType(encoded_type);
+  StoragePrecision precision = precision_;
+  size_t slice_size = slice_size_;
+  tensor_ = variable->GetVariableLikeSlot(name, encoded_type, TensorShape({row_size}), [=]{
+    return new initializer::EncodedConstantInitializer(precision, initial_value, slice_size);
+  });
+  if (!EncodedFormat(tensor_, &stored_precision, &stored_slice_size)) {
+    // restored from a full precision checkpoint
+    if (tensor_->Type() != type || RowElements(tensor_) != slice_size_) {
+      return Status::ArgumentError(slot_name + " does not match the rows of the variable");
+    }
+    return Status::Ok();
+  }
+  if (stored_precision != precision_) {
+    return Status::ArgumentError(slot_name + " is stored in " + PrecisionName(stored_precision) +
+                                 ", not in " + PrecisionName(precision_));
+  }
+  if (tensor_->Type() != encoded_type || stored_slice_size != slice_size_ || RowElements(tensor_) != row_size) {
+    return Status::ArgumentError(slot_name + " does not match the rows of the variable");
+  }
+  encoded_ = true;
+  return Status::Ok();
+}
+}
+}
+
@@ -0,0 +1,89 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_SERVER_REDUCED_SLOT_H_
+#define PS_PLUS_SERVER_REDUCED_SLOT_H_
+
+#include "ps-plus/common/reduced_precision.h"
+#include "ps-plus/server/variable.h"
+
+#include <type_traits>
+#include <vector>
+
+namespace ps {
+namespace server {
+
+// A kVariableLike optimizer slot stored in the variable's slot precision.
+// Only float/double slots of non-scalar variables are encoded, the others
+// (and slots restored from a full precision checkpoint) are used as is.
+// Init fails if the slot was restored in another reduced precision, or with
+// rows of another size, since its rows can not be read in this one.
+class ReducedSlot {
+ public:
+  ReducedSlot();
+  Status Init(Variable* variable, const std::string& name, DataType type, double initial_value);
+  Tensor* GetTensor() const { return tensor_; }
+  bool Encoded() const { return encoded_; }
+  StoragePrecision Precision() const { return precision_; }
+  size_t SliceSize() const { return slice_size_; }
+ private:
+  Tensor* tensor_;
+  bool encoded_;
+  StoragePrecision precision_;
+  size_t slice_size_;
+};
+
+// Row accessor used inside one updater thread.
+// Load returns a pointer to slice_size values of T, Store writes them back
+// with stochastic rounding when the slot is encoded.
+template <typename T>
+class ReducedSlotRow {
+ public:
+  explicit ReducedSlotRow(const ReducedSlot& slot)
+    : slot_(slot), id_(0), seed_(reinterpret_cast<uintptr_t>(this) * 0x9E3779B97F4A7C15ull | 1) {
+    if (slot_.Encoded()) {
+      floats_.resize(slot_.SliceSize());
+      values_.resize(slot_.SliceSize());
+    }
+  }
+  T* Load(size_t id) {
+    if (!slot_.Encoded()) {
+      return slot_.GetTensor()->Raw<T>(id);
+    }
+    id_ = id;
+    DecodeRow(slot_.Precision(), slot_.GetTensor()->Raw<char>(id), floats_.size(), floats_.data());
+    values_.assign(floats_.begin(), floats_.end());
+    return values_.data();
+  }
+  void Store() {
+    if (!slot_.Encoded()) {
+      return;
+    }
+    floats_.assign(values_.begin(), values_.end());
+    EncodeRow(slot_.Precision(), floats_.data(), floats_.size(), slot_.GetTensor()->Raw<char>(id_), &seed_);
+  }
+ private:
+  const ReducedSlot& slot_;
+  size_t id_;
+  uint64_t seed_;
+  std::vector<float> floats_;
+  std::vector<T> values_;
+};
+
+}
+}
+
+#endif
+
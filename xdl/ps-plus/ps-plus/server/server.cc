@@ -16,15 +16,60 @@ limitations under the License.
 #include "ps-plus/server/server.h"
 #include "ps-plus/server/checkpoint_utils.h"
 #include "ps-plus/common/logging.h"
+#include "ps-plus/common/tracer.h"
+#include "ps-plus/common/initializer/none_initializer.h"
+
+#include <cstring>
+#include <chrono>
+#include <sys/resource.h>
 
 namespace ps {
 namespace server {
 
+namespace {
+
+int64_t NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t CpuMicros() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000L +
+         usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+// The lock wait of a traced request as a span ending now
+void TraceWait(const common::TraceContext& trace, const char* name, int64_t micros) {
+  if (trace.Traced()) {
+    int64_t end = common::Tracer::NowMicros();
+    common::Tracer::Instance()->Record(trace, common::Tracer::NewId(), "lock", name,
+                                       end - micros, end);
+  }
+}
+
+size_t TensorBytes(const std::vector<Data*>& inputs) {
+  size_t bytes = 0;
+  for (auto input : inputs) {
+    WrapperData<Tensor>* tensor = dynamic_cast<WrapperData<Tensor>*>(input);
+    if (tensor != nullptr && tensor->Internal().Initialized()) {
+      bytes += tensor->Internal().Shape().NumElements() * SizeOfType(tensor->Internal().Type());
+    }
+  }
+  return bytes;
+}
+
+}
+
 Server::Server(size_t id, const StreamingModelArgs& streaming_model_args)
   : udf_chain_manager_(new UdfChainManager), 
     storage_manager_(new StorageManager),
     ver_(kUnusedVersion), id_(id),
-    streaming_model_args_(streaming_model_args) {}
+    streaming_model_args_(streaming_model_args),
+    load_time_(-1), load_cpu_(0) {}
 
 Status Server::Init() {
   PS_CHECK_STATUS(streaming_model_args_.Init());
@@ -37,7 +82,16 @@ Status Server::RegisterUdfChain(Version ver, const UdfChainRegister& def) {
 }
 
 Status Server::RunUdfChain(Version ver, size_t udf, const std::string& variable_name, const std::vector<Data*>& inputs, UdfContext* ctx) {
+  static common::Histogram* server_lock_wait =
+      common::MetricsCollector::Instance()->GetHistogram("lock.server_wait_micros");
+  static common::Histogram* variable_lock_wait =
+      common::MetricsCollector::Instance()->GetHistogram("lock.variable_wait_micros");
+  common::TraceContext trace = common::Tracer::Current();
+  int64_t lock_begin = NowMicros();
   QRWLocker lock(server_lock_, QRWLocker::kSimpleRead);
+  int64_t waited = NowMicros() - lock_begin;
+  server_lock_wait->Record(waited);
+  TraceWait(trace, "server_lock_wait", waited);
   if (ver != ver_) {
     return Status::VersionMismatch("RunUdfChain Version Mismatch");
   }
@@ -63,27 +117,108 @@ Status Server::RunUdfChain(Version ver, size_t udf, const std::string& variable_
   PS_CHECK_STATUS(ctx->SetVariable(variable));
   std::unique_ptr<QRWLocker> locker;
   if (variable != nullptr) {
+    lock_begin = NowMicros();
     locker.reset(new QRWLocker(variable->VariableLock(), QRWLocker::kSimpleRead));
+    waited = NowMicros() - lock_begin;
+    variable_lock_wait->Record(waited);
+    TraceWait(trace, "variable_lock_wait", waited);
     ctx->SetLocker(locker.get());
   }
   ctx->SetServerLocker(&lock);
+  if (variable == nullptr) {
+    return udf_chain->Process(ctx);
+  }
+  int64_t begin = NowMicros();
   Status ret = udf_chain->Process(ctx);
+  size_t micros = NowMicros() - begin;
+  size_t bytes_in = TensorBytes(inputs);
+  variable->AddLoad(bytes_in, micros);
+  variable->Profile(bytes_in, ret.IsOk() ? TensorBytes(ctx->Outputs()) : 0, micros);
   return ret;
 }
 
-Status Server::Save(Version ver, const std::string& checkpoint, const VariableInfoCollection& info) {
+Status Server::BumpVersion(Version ver, Version new_ver) {
+  QRWLocker lock(server_lock_, QRWLocker::kWrite);
+  if (ver != ver_) {
+    return Status::VersionMismatch("BumpVersion Version Mismatch");
+  }
+  ver_ = new_ver;
+  return Status::Ok();
+}
+
+Status Server::GetLoad(Version ver, ServerLoad* result) {
   QRWLocker lock(server_lock_, QRWLocker::kSimpleRead);
   if (ver != ver_) {
-    return Status::VersionMismatch("RunUdfChain Version Mismatch");
+    return Status::VersionMismatch("GetLoad Version Mismatch");
+  }
+  std::lock_guard<std::mutex> load_lock(load_mu_);
+  int64_t now = NowMicros();
+  int64_t cpu = CpuMicros();
+  result->window_micros = load_time_ < 0 ? 0 : now - load_time_;
+  result->cpu_micros = load_time_ < 0 ? 0 : cpu - load_cpu_;
+  load_time_ = now;
+  load_cpu_ = cpu;
+  for (auto& item : storage_manager_->Internal()) {
+    if (item.second == nullptr) {
+      continue;
+    }
+    VariableLoad load;
+    load.name = item.first;
+    item.second->TakeLoad(&load.requests, &load.bytes, &load.micros);
+    result->variables.push_back(load);
+  }
+  return Status::Ok();
+}
+
+Status Server::GetStats(Version ver, ServerStats* result) {
+  QRWLocker lock(server_lock_, QRWLocker::kSimpleRead);
+  if (ver != ver_) {
+    return Status::VersionMismatch("GetStats Version Mismatch");
+  }
+  result->server_id = id_;
+  for (auto& item : storage_manager_->Internal()) {
+    if (item.second == nullptr) {
+      continue;
+    }
+    VariableStats stats;
+    stats.name = item.first;
+    {
+      QRWLocker var_lock(item.second->VariableLock(), QRWLocker::kSimpleRead);
+      item.second->GetStats(&stats);
+    }
+    result->variables.push_back(std::move(stats));
   }
+  return Status::Ok();
+}
+
+Status Server::Save(Version ver, const std::string& checkpoint, const VariableInfoCollection& info) {
+  std::lock_guard<std::mutex> save_lock(save_mu_);
   CheckpointUtils ckpt(info);
-  return ckpt.SaveVariables(id_, checkpoint, storage_manager_->Internal());
+  CheckpointUtils::SaveSnapshot snapshot;
+  {
+    QRWLocker lock(server_lock_, QRWLocker::kSimpleRead);
+    if (ver != ver_) {
+      return Status::VersionMismatch("RunUdfChain Version Mismatch");
+    }
+    PS_CHECK_STATUS(ckpt.Snapshot(id_, checkpoint, storage_manager_->Internal(), &snapshot));
+  }
+  // udfs that need the server lock exclusively would stall every push
+  // behind them until the rows are written
+  return ckpt.WriteSnapshot(&snapshot);
 }
 
 Status Server::Restore(Version ver, const VariableInfoCollection& from, const VariableInfoCollection& to) {
+  std::lock_guard<std::mutex> save_lock(save_mu_);
   QRWLocker lock(server_lock_, QRWLocker::kWrite);
   ver_ = ver;
   storage_manager_->Internal().clear();
+  // rows logged before the restore don't belong to the new version
+  std::unordered_map<std::string, StreamingModelUtils::DenseLog> dense_logs;
+  std::unordered_map<std::string, StreamingModelUtils::SparseLog> sparse_logs;
+  std::unordered_map<std::string, StreamingModelUtils::HashLog> hash_logs;
+  StreamingModelUtils::GetDense(&dense_logs, StreamingModelUtils::kReplica);
+  StreamingModelUtils::GetSparse(&sparse_logs, StreamingModelUtils::kReplica);
+  StreamingModelUtils::GetHash(&hash_logs, StreamingModelUtils::kReplica);
   CheckpointUtils ckpt(from);
   return ckpt.LoadVariables(to, id_, &storage_manager_->Internal());
 }
@@ -135,6 +270,204 @@ Status Server::GatherStreamingDenseVar(Version ver, const DenseVarNames& name, D
   return Status::Ok();
 }
 
+Status Server::CollectReplicaDelta(Version* ver, ReplicaDelta* result) {
+  QRWLocker lock(server_lock_, QRWLocker::kSimpleRead);
+  *ver = ver_;
+  std::unordered_map<std::string, StreamingModelUtils::DenseLog> dense_logs;
+  std::unordered_map<std::string, StreamingModelUtils::SparseLog> sparse_logs;
+  std::unordered_map<std::string, StreamingModelUtils::HashLog> hash_logs;
+  StreamingModelUtils::GetDense(&dense_logs, StreamingModelUtils::kReplica);
+  StreamingModelUtils::GetSparse(&sparse_logs, StreamingModelUtils::kReplica);
+  StreamingModelUtils::GetHash(&hash_logs, StreamingModelUtils::kReplica);
+  for (auto&& item : dense_logs) {
+    Variable* var;
+    Status st = storage_manager_->Get(item.first, &var);
+    if (st.Code() == Status::kNotFound) {
+      continue;
+    }
+    PS_CHECK_STATUS(st);
+    QRWLocker var_lock(var->VariableLock(), QRWLocker::kSimpleRead);
+    ReplicaDelta::Update update;
+    update.name = item.first;
+    update.data = var->GetData()->Clone();
+    result->updates.emplace_back(std::move(update));
+  }
+  for (auto&& item : sparse_logs) {
+    if (dense_logs.find(item.first) != dense_logs.end()) {
+      continue;
+    }
+    Variable* var;
+    Status st = storage_manager_->Get(item.first, &var);
+    if (st.Code() == Status::kNotFound) {
+      continue;
+    }
+    PS_CHECK_STATUS(st);
+    QRWLocker var_lock(var->VariableLock(), QRWLocker::kSimpleRead);
+    WrapperData<size_t>* offset_slicer = dynamic_cast<WrapperData<size_t>*>(var->GetSlicer());
+    if (offset_slicer == nullptr) {
+      return Status::Unknown("Variable " + item.first + " is not a index variable");
+    }
+    size_t offset = offset_slicer->Internal();
+    Tensor* data = var->GetData();
+    TensorShape shape = data->Shape();
+    size_t row_size = shape.NumElements() / shape[0] * SizeOfType(data->Type());
+    ReplicaDelta::Update update;
+    update.name = item.first;
+    for (auto id : item.second.write_ids) {
+      if (id >= offset && id - offset < shape[0]) {
+        update.keys.push_back(id);
+      }
+    }
+    shape.Set(0, update.keys.size());
+    update.data = Tensor(data->Type(), shape, new initializer::NoneInitializer, Tensor::TType::kContinuous, false);
+    char* dst = update.data.Raw<char>();
+    for (auto id : update.keys) {
+      memcpy(dst, data->Raw<char>(id - offset), row_size);
+      dst += row_size;
+    }
+    result->updates.emplace_back(std::move(update));
+  }
+  for (auto&& item : hash_logs) {
+    Variable* var;
+    Status st = storage_manager_->Get(item.first, &var);
+    if (st.Code() == Status::kNotFound) {
+      continue;
+    }
+    PS_CHECK_STATUS(st);
+    QRWLocker var_lock(var->VariableLock(), QRWLocker::kSimpleRead);
+    WrapperData<std::unique_ptr<HashMap> >* slicer = dynamic_cast<WrapperData<std::unique_ptr<HashMap> >*>(var->GetSlicer());
+    if (slicer == nullptr || slicer->Internal() == nullptr) {
+      return Status::Unknown("Variable " + item.first + " is not a hash variable");
+    }
+    auto&& log = item.second;
+    std::vector<int64_t> keys;
+    for (auto&& key : log.write_ids) {
+      keys.push_back(key.first);
+      keys.push_back(key.second);
+    }
+    // keys erased since they were written stay NOT_ADD_ID
+    std::vector<size_t> ids(log.write_ids.size(), HashMap::NOT_ADD_ID);
+    tbb::concurrent_vector<size_t> reused_ids;
+    size_t filtered;
+    if (!keys.empty()) {
+      slicer->Internal()->Get(&keys[0], ids.size(), true, 1.0, &ids, &reused_ids, &filtered);
+    }
+    ReplicaDelta::Update update;
+    update.name = item.first;
+    Tensor* data = var->GetData();
+    TensorShape shape = data->Shape();
+    size_t row_size = shape.NumElements() / shape[0] * SizeOfType(data->Type());
+    size_t rows = 0;
+    for (size_t i = 0; i < ids.size(); i++) {
+      if (ids[i] != HashMap::NOT_ADD_ID) {
+        update.keys.push_back(keys[2 * i]);
+        update.keys.push_back(keys[2 * i + 1]);
+        rows++;
+      }
+    }
+    for (auto&& key : log.del_ids) {
+      update.del_keys.push_back(key.first);
+      update.del_keys.push_back(key.second);
+    }
+    if (rows == 0 && update.del_keys.empty()) {
+      continue;
+    }
+    shape.Set(0, rows);
+    update.data = Tensor(data->Type(), shape, new initializer::NoneInitializer, Tensor::TType::kContinuous, false);
+    char* dst = update.data.Raw<char>();
+    for (size_t i = 0; i < ids.size(); i++) {
+      if (ids[i] != HashMap::NOT_ADD_ID) {
+        memcpy(dst, data->Raw<char>(ids[i]), row_size);
+        dst += row_size;
+      }
+    }
+    result->updates.emplace_back(std::move(update));
+  }
+  return Status::Ok();
+}
+
+Status Server::ApplyReplicaDelta(Version ver, const ReplicaDelta& delta) {
+  QRWLocker lock(server_lock_, QRWLocker::kSimpleRead);
+  if (ver != ver_) {
+    return Status::VersionMismatch("ApplyReplicaDelta Version Mismatch");
+  }
+  for (auto&& update : delta.updates) {
+    Variable* var;
+    PS_CHECK_STATUS(storage_manager_->Get(update.name, &var));
+    Tensor* data = var->GetData();
+    if (update.data.Type() != data->Type()) {
+      return Status::ArgumentError("ApplyReplicaDelta: type mismatch for " + update.name);
+    }
+    WrapperData<size_t>* offset_slicer = dynamic_cast<WrapperData<size_t>*>(var->GetSlicer());
+    if (offset_slicer != nullptr && update.keys.empty()) {
+      QRWLocker var_lock(var->VariableLock(), QRWLocker::kWrite);
+      if (update.data.Shape() != data->Shape()) {
+        return Status::ArgumentError("ApplyReplicaDelta: shape mismatch for " + update.name);
+      }
+      memcpy(data->Raw<char>(), update.data.Raw<char>(), data->Shape().NumElements() * SizeOfType(data->Type()));
+      continue;
+    }
+    if (offset_slicer != nullptr) {
+      QRWLocker var_lock(var->VariableLock(), QRWLocker::kSimpleRead);
+      size_t offset = offset_slicer->Internal();
+      TensorShape shape = data->Shape();
+      if (update.data.Shape().Size() != shape.Size() || update.data.Shape()[0] != update.keys.size()
+          || update.data.Shape().NumElements() / update.keys.size() != shape.NumElements() / shape[0]) {
+        return Status::ArgumentError("ApplyReplicaDelta: row shape mismatch for " + update.name);
+      }
+      size_t row_size = shape.NumElements() / shape[0] * SizeOfType(data->Type());
+      const char* src = update.data.Raw<char>();
+      for (auto id : update.keys) {
+        if (id < (int64_t)offset || id - offset >= shape[0]) {
+          return Status::ArgumentError("ApplyReplicaDelta: id overflow for " + update.name);
+        }
+        memcpy(data->Raw<char>(id - offset), src, row_size);
+        src += row_size;
+      }
+      continue;
+    }
+    WrapperData<std::unique_ptr<HashMap> >* slicer = dynamic_cast<WrapperData<std::unique_ptr<HashMap> >*>(var->GetSlicer());
+    if (slicer == nullptr || slicer->Internal() == nullptr) {
+      return Status::ArgumentError("ApplyReplicaDelta: " + update.name + " is neither dense nor hash");
+    }
+    std::unique_ptr<HashMap>& hashmap = slicer->Internal();
+    QRWLocker var_lock(var->VariableLock(), QRWLocker::kSimpleRead);
+    if (!update.del_keys.empty()) {
+      hashmap->Erase(&update.del_keys[0], update.del_keys.size() / 2);
+    }
+    size_t rows = update.keys.size() / 2;
+    if (rows == 0) {
+      continue;
+    }
+    TensorShape shape = data->Shape();
+    if (update.data.Shape().Size() != shape.Size() || update.data.Shape()[0] != rows
+        || update.data.Shape().NumElements() / rows != shape.NumElements() / shape[0]) {
+      return Status::ArgumentError("ApplyReplicaDelta: row shape mismatch for " + update.name);
+    }
+    std::vector<size_t> ids;
+    tbb::concurrent_vector<size_t> reused_ids;
+    size_t filtered;
+    int64_t max_id = hashmap->Get(&update.keys[0], rows, false, 1.0, &ids, &reused_ids, &filtered);
+    if (max_id > 0) {
+      PS_CHECK_STATUS(var->ReShapeId(max_id));
+    }
+    if (var->GetLazyRows() != nullptr) {
+      PS_CHECK_STATUS(var->GetLazyRows()->Ensure(ids));
+    }
+    if (reused_ids.size() != 0) {
+      var->ClearIds(std::vector<size_t>(reused_ids.begin(), reused_ids.end()));
+    }
+    size_t row_size = shape.NumElements() / shape[0] * SizeOfType(data->Type());
+    const char* src = update.data.Raw<char>();
+    for (size_t i = 0; i < rows; i++, src += row_size) {
+      if (ids[i] != HashMap::NOT_ADD_ID) {
+        memcpy(data->Raw<char>(ids[i]), src, row_size);
+      }
+    }
+  }
+  return Status::Ok();
+}
+
 Status Server::TriggerStreamingSparse(Version ver, const int& server_id, const std::string& stream_version) {
   {
     QRWLocker lock(server_lock_, QRWLocker::kSimpleRead);
@@ -142,11 +475,11 @@ Status Server::TriggerStreamingSparse(Version ver, const int& server_id, const s
       return Status::VersionMismatch("RunUdfChain Version Mismatch");
     }
   }
-  if (streaming_model_args_.streaming_hash_model_addr.empty()) {
-    return Status::Unknown("Streaming Hash Model is Disabled");
+  if (streaming_model_args_.streaming_sparse_model_addr.empty()) {
+    return Status::Unknown("Streaming Sparse Model is Disabled");
   }
-  if (streaming_model_args_.streaming_hash_model_writer == nullptr) {
-    return Status::Unknown("Streaming Hash Model Writer connect error");
+  if (streaming_model_args_.streaming_sparse_model_writer == nullptr) {
+    return Status::Unknown("Streaming Sparse Model Writer connect error");
   }
   std::unordered_map<std::string, StreamingModelUtils::SparseLog> logs;
   StreamingModelUtils::GetSparse(&logs);
@@ -201,24 +534,21 @@ Status Server::TriggerStreamingHash(Version ver, const int& server_id, const std
     if (hashmap == nullptr) {
       return Status::Unknown("Variable " + var_name + " is not a hash variable");
     }
-    std::vector<size_t> ids;
-    int64_t* keys = new int64_t[log.write_ids.size()*2];
-    int i = 0;
-    for (auto it = log.write_ids.begin(); it != log.write_ids.end(); ++it){
-        keys[2*i] = it->first;
-        keys[2*i+1] = it->second;
-        i++;
+    std::vector<int64_t> keys;
+    keys.reserve(log.write_ids.size() * 2);
+    for (auto it = log.write_ids.begin(); it != log.write_ids.end(); ++it) {
+      keys.push_back(it->first);
+      keys.push_back(it->second);
     }
+    // a lookup only, the keys erased since they were written are skipped
+    std::vector<size_t> ids(log.write_ids.size(), HashMap::NOT_ADD_ID);
     tbb::concurrent_vector<size_t> reids;
     size_t filter;
-    size_t r = hashmap->Get(keys, log.write_ids.size(), false, 1.0, &ids, &reids, &filter);
-    if (r != 0) {
-      return Status::Unknown("Streaming Hash Model Get Hashmap error");
-    }
+    hashmap->Get(keys.data(), log.write_ids.size(), true, 1.0, &ids, &reids, &filter);
     ret.name = var_name;
     ret.data = *var->GetData();
     for (size_t i = 0; i < ids.size(); i++) {
-      if (ids[i] < 0) {
+      if (ids[i] == HashMap::NOT_ADD_ID) {
         continue;
       }
       std::pair<int64_t, int64_t> temp(keys[2*i], keys[2*i+1]);
@@ -227,7 +557,6 @@ Status Server::TriggerStreamingHash(Version ver, const int& server_id, const std
     }
     ret.del_ids = std::vector<std::pair<int64_t, int64_t>>(log.del_ids.begin(), log.del_ids.end());
     results.emplace_back(std::move(ret));
-    delete keys;
   }
   return streaming_model_args_.streaming_hash_model_writer->WriteHashModel(results, stream_version, server_id);
 }
@@ -26,6 +26,10 @@ limitations under the License.
 #include "ps-plus/server/streaming_model_args.h"
 #include "ps-plus/message/streaming_model_infos.h"
 #include "ps-plus/message/streaming_model_manager.h"
+#include "ps-plus/message/server_load.h"
+#include "ps-plus/message/variable_stats.h"
+
+#include <mutex>
 
 namespace ps {
 namespace server {
@@ -42,14 +46,30 @@ class Server {
   Status GatherStreamingDenseVar(Version ver, const DenseVarNames& name, DenseVarValues* result);
   Status TriggerStreamingSparse(Version ver, const int& server_id, const std::string& stream_version);
   Status TriggerStreamingHash(Version ver, const int& server_id, const std::string& stream_version);
+  // Drains the replica channel into the current rows of the written
+  // variables, ver is the version the rows belong to.
+  Status CollectReplicaDelta(Version* ver, ReplicaDelta* result);
+  Status ApplyReplicaDelta(Version ver, const ReplicaDelta& delta);
+  // Load of every variable since the previous call.
+  Status GetLoad(Version ver, ServerLoad* result);
+  // Memory and traffic of every variable, the counters are not reset.
+  Status GetStats(Version ver, ServerStats* result);
+  // Moves the rows to new_ver untouched, waiting out the udfs in flight.
+  Status BumpVersion(Version ver, Version new_ver);
  private:
   // Writelocked when restore.
   QRWLock server_lock_;
+  // Held by a save for its whole duration, the server lock only while its
+  // snapshot is taken. Keeps a restore from freeing variables under it.
+  std::mutex save_mu_;
   std::unique_ptr<UdfChainManager> udf_chain_manager_;
   std::unique_ptr<StorageManager> storage_manager_;
   Version ver_;
   size_t id_;
   StreamingModelArgs streaming_model_args_;
+  std::mutex load_mu_;
+  int64_t load_time_;
+  int64_t load_cpu_;
 };
 
 }
@@ -16,10 +16,15 @@ limitations under the License.
 #include "ps-plus/server/server_service.h"
 
 #include "ps-plus/common/logging.h"
+#include "ps-plus/common/metrics_collector.h"
 #include "ps-plus/common/net_utils.h"
 #include "ps-plus/common/reliable_kv.h"
+#include "ps-plus/common/tracer.h"
 #include "ps-plus/message/server_info.h"
 #include "ps-plus/service/seastar/lib/callback_closure.h"
+#include "ps-plus/service/seastar/lib/core_router.h"
+#include "ps-plus/service/seastar/lib/server_func_manager.h"
+#include <map>
 #include <thread>
 #include <tuple>
 #include <future>
@@ -27,6 +32,7 @@ limitations under the License.
 
 using ps::service::seastar::SeastarStatus;
 using ps::service::seastar::SeastarServerClientLib;
+using ps::service::seastar::CoreRouter;
 
 namespace ps {
 namespace server {
@@ -50,7 +56,9 @@ ServerService::ServerService(
     std::string streaming_dense_model_addr,
     std::string streaming_sparse_model_addr,
     std::string streaming_hash_model_addr,
-    bool bind_cores) {
+    bool bind_cores,
+    size_t replica,
+    int replica_sync_ms) {
   port_ = NetUtils::GetAvailablePort();
   NetUtils::GetDefaultIP(ip_);
   server_id_ = server_id;
@@ -62,6 +70,10 @@ ServerService::ServerService(
   streaming_sparse_model_addr_ = streaming_sparse_model_addr;
   streaming_hash_model_addr_ = streaming_hash_model_addr;
   bind_cores_ = bind_cores;
+  replica_ = replica;
+  replica_sync_ms_ = replica_sync_ms;
+  replica_size_ = 0;
+  core_sharded_ = false;
 }
 
 Status ServerService::Init() {
@@ -72,6 +84,12 @@ Status ServerService::Init() {
   server_.reset(new Server(server_id_, streaming_model_args));
   PS_CHECK_STATUS(server_->Init());
   lazy_queue_.reset(new ThreadPool(3));
+  // kill -USR2 dumps the request, udf and lock histograms
+  common::MetricsCollector::Instance()->DumpOnSignal();
+  // PS_CORE_SHARDED=1 runs the work on a variable on the seastar core
+  // owning it, shm and rdma requests are still served where they arrive
+  core_sharded_ = NetUtils::GetEnv("PS_CORE_SHARDED") == "1";
+  common::Tracer::Instance()->SetProcessName("server_" + std::to_string(server_id_));
 
   seastar_lib_.reset(new SeastarServerClientLib(port_, core_num_, core_num_, CLIENT_THREAD_NUM, bind_cores_));
   seastar_lib_->RegisterServerFunc(func_ids::kServerRegisterUdfChain, 
@@ -85,9 +103,35 @@ Status ServerService::Init() {
       [this](const std::vector<ps::Data*>& inputs, 
              std::vector<ps::Data*>* outputs, 
              ps::service::seastar::DoneClosure* done) {
+    if (core_sharded_ && CoreRouter::OnReactor()) {
+      ShardedProcess(inputs, outputs, done);
+      return;
+    }
     Process(inputs, outputs);
     done->Run();
   });
+  seastar_lib_->RegisterServerFunc(func_ids::kServerTracedProcess, 
+      [this](const std::vector<ps::Data*>& inputs, 
+             std::vector<ps::Data*>* outputs, 
+             ps::service::seastar::DoneClosure* done) {
+    if (core_sharded_ && CoreRouter::OnReactor()) {
+      ShardedProcess(inputs, outputs, done, true);
+      return;
+    }
+    TracedProcess(inputs, outputs);
+    done->Run();
+  });
+  seastar_lib_->RegisterServerFunc(func_ids::kServerBatchProcess, 
+      [this](const std::vector<ps::Data*>& inputs, 
+             std::vector<ps::Data*>* outputs, 
+             ps::service::seastar::DoneClosure* done) {
+    if (core_sharded_ && CoreRouter::OnReactor()) {
+      ShardedBatchProcess(inputs, outputs, done);
+      return;
+    }
+    BatchProcess(inputs, outputs);
+    done->Run();
+  });
   seastar_lib_->RegisterServerFunc(func_ids::kServerSave, 
       [this](const std::vector<ps::Data*>& inputs, 
              std::vector<ps::Data*>* outputs, 
@@ -142,7 +186,75 @@ Status ServerService::Init() {
       done->Run();
     });
   });
+  seastar_lib_->RegisterServerFunc(func_ids::kServerSetReplicas, 
+      [this](const std::vector<ps::Data*>& inputs, 
+             std::vector<ps::Data*>* outputs, 
+             ps::service::seastar::DoneClosure* done) {
+    lazy_queue_->Schedule([=]{
+      SetReplicas(inputs, outputs);
+      done->Run();
+    });
+  });
+  seastar_lib_->RegisterServerFunc(func_ids::kServerApplyReplica, 
+      [this](const std::vector<ps::Data*>& inputs, 
+             std::vector<ps::Data*>* outputs, 
+             ps::service::seastar::DoneClosure* done) {
+    lazy_queue_->Schedule([=]{
+      ApplyReplica(inputs, outputs);
+      done->Run();
+    });
+  });
+  seastar_lib_->RegisterServerFunc(func_ids::kServerGetLoad, 
+      [this](const std::vector<ps::Data*>& inputs, 
+             std::vector<ps::Data*>* outputs, 
+             ps::service::seastar::DoneClosure* done) {
+    GetLoad(inputs, outputs);
+    done->Run();
+  });
+  // Waits on the variable locks, so it leaves the reactor like a restore.
+  seastar_lib_->RegisterServerFunc(func_ids::kServerGetStats, 
+      [this](const std::vector<ps::Data*>& inputs, 
+             std::vector<ps::Data*>* outputs, 
+             ps::service::seastar::DoneClosure* done) {
+    lazy_queue_->Schedule([=]{
+      GetStats(inputs, outputs);
+      done->Run();
+    });
+  });
+  seastar_lib_->RegisterServerFunc(func_ids::kServerBumpVersion, 
+      [this](const std::vector<ps::Data*>& inputs, 
+             std::vector<ps::Data*>* outputs, 
+             ps::service::seastar::DoneClosure* done) {
+    lazy_queue_->Schedule([=]{
+      BumpVersion(inputs, outputs);
+      done->Run();
+    });
+  });
+  // Checkpoints and cluster management queue apart from pulls and pushes,
+  // with a small in flight budget of their own.
+  for (size_t id : {func_ids::kServerRegisterUdfChain, func_ids::kServerSave, func_ids::kServerRestore,
+                    func_ids::kServerStreamingDenseVarName, func_ids::kServerGatherStreamingDenseVar,
+                    func_ids::kServerTriggerStreamingSparse, func_ids::kServerTriggerStreamingHash,
+                    func_ids::kServerSetReplicas, func_ids::kServerGetLoad, func_ids::kServerBumpVersion,
+                    func_ids::kServerGetStats}) {
+    ps::service::seastar::ServerFuncManager::GetInstance()->SetControlFunc(id);
+  }
   seastar_lib_->Start();
+  // Workers on this host reach the funcs above through shared memory.
+  if (NetUtils::GetEnv("PS_SHM_TRANSPORT") != "0") {
+    shm_lib_.reset(new ps::service::shm::ShmServerLib(port_, core_num_));
+    if (!shm_lib_->Start()) {
+      shm_lib_.reset();
+    }
+  }
+#ifdef USE_RDMA
+  // Serves the funcs registered above, clients fall back to tcp without it.
+  rdma_lib_.reset(new ps::service::rdma::RdmaServerLib(
+      port_ + ps::service::rdma::kRdmaPortOffset, core_num_));
+  if (!rdma_lib_->Start()) {
+    rdma_lib_.reset();
+  }
+#endif
 
   // TODO: move cpus
   std::vector<std::tuple<int64_t, std::string>> server_addrs = { std::make_tuple(0, "") };
@@ -156,6 +268,17 @@ ServerService::~ServerService() {
   if (register_server_loop_ != nullptr) {
     register_server_loop_->join();
   }
+  if (forward_replica_loop_ != nullptr) {
+    forward_replica_loop_->join();
+  }
+#ifdef USE_RDMA
+  if (rdma_lib_ != nullptr) {
+    rdma_lib_->Stop();
+  }
+#endif
+  if (shm_lib_ != nullptr) {
+    shm_lib_->Stop();
+  }
   if (seastar_lib_ != nullptr) {
     seastar_lib_->Stop();
   }
@@ -203,6 +326,175 @@ void ServerService::Process(const std::vector<Data*>& inputs, std::vector<Data*>
   return;
 }
 
+void ServerService::TracedProcess(const std::vector<Data*>& inputs, std::vector<Data*>* outputs) {
+  if (inputs.size() < 4) {
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("TracedProcessFunc: Need at least 4 inputs")));
+    return;
+  }
+  WrapperData<std::string>* variable_name = dynamic_cast<WrapperData<std::string>*>(inputs[2]);
+  WrapperData<std::vector<int64_t> >* trace = dynamic_cast<WrapperData<std::vector<int64_t> >*>(inputs[3]);
+  if (variable_name == nullptr || trace == nullptr || trace->Internal().size() != 2) {
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("TracedProcessFunc: Input Type Error")));
+    return;
+  }
+  std::vector<Data*> in(inputs.begin(), inputs.begin() + 3);
+  in.insert(in.end(), inputs.begin() + 4, inputs.end());
+  common::TraceContext parent((uint64_t)trace->Internal()[0], (uint64_t)trace->Internal()[1]);
+  common::ScopedSpan span(parent, "ps_server", variable_name->Internal());
+  Process(in, outputs);
+}
+
+Status ServerService::CheckBatch(const std::vector<Data*>& inputs) {
+  if (inputs.size() < 3) {
+    return Status::ArgumentError("BatchProcessFunc: Need at least 3 inputs");
+  }
+  WrapperData<Version>* ver = dynamic_cast<WrapperData<Version>*>(inputs[0]);
+  WrapperData<std::vector<int64_t> >* header = dynamic_cast<WrapperData<std::vector<int64_t> >*>(inputs[1]);
+  WrapperData<std::vector<std::string> >* variable_names = dynamic_cast<WrapperData<std::vector<std::string> >*>(inputs[2]);
+  if (ver == nullptr || header == nullptr || variable_names == nullptr) {
+    return Status::ArgumentError("BatchProcessFunc: Input Type Error");
+  }
+  const std::vector<int64_t>& items = header->Internal();
+  const std::vector<std::string>& names = variable_names->Internal();
+  if (items.size() != names.size() * 2) {
+    return Status::ArgumentError("BatchProcessFunc: Header Size Error");
+  }
+  size_t total = 3;
+  for (size_t i = 0; i < names.size(); i++) {
+    total += items[i * 2 + 1];
+  }
+  if (total != inputs.size()) {
+    return Status::ArgumentError("BatchProcessFunc: Input Size Error");
+  }
+  return Status::Ok();
+}
+
+void ServerService::RunBatchItem(const Version& ver, size_t udf, const std::string& name,
+                                 const std::vector<Data*>& in, std::vector<Data*>* outputs) {
+  UdfContext ctx;
+  Status st = server_->RunUdfChain(ver, udf, name, in, &ctx);
+  outputs->push_back(new WrapperData<Status>(st));
+  if (!st.IsOk()) {
+    return;
+  }
+  ctx.RemoveOutputDependency();
+  outputs->insert(outputs->end(), ctx.Outputs().begin(), ctx.Outputs().end());
+}
+
+void ServerService::BatchProcess(const std::vector<Data*>& inputs, std::vector<Data*>* outputs) {
+  Status st = CheckBatch(inputs);
+  if (!st.IsOk()) {
+    outputs->push_back(new WrapperData<Status>(st));
+    return;
+  }
+  const Version& ver = dynamic_cast<WrapperData<Version>*>(inputs[0])->Internal();
+  const std::vector<int64_t>& items = dynamic_cast<WrapperData<std::vector<int64_t> >*>(inputs[1])->Internal();
+  const std::vector<std::string>& names = dynamic_cast<WrapperData<std::vector<std::string> >*>(inputs[2])->Internal();
+  // Every item answers like Process: its status followed by its outputs.
+  WrapperData<std::vector<int64_t> >* counts = new WrapperData<std::vector<int64_t> >();
+  outputs->push_back(new WrapperData<Status>(Status::Ok()));
+  outputs->push_back(counts);
+  size_t offset = 3;
+  for (size_t i = 0; i < names.size(); i++) {
+    std::vector<Data*> in(inputs.begin() + offset, inputs.begin() + offset + items[i * 2 + 1]);
+    offset += items[i * 2 + 1];
+    size_t before = outputs->size();
+    RunBatchItem(ver, (size_t)items[i * 2], names[i], in, outputs);
+    counts->Internal().push_back(outputs->size() - before);
+  }
+  return;
+}
+
+size_t ServerService::OwnerCore(const std::string& variable_name) {
+  // initializer chains run on the core owning the variable they create
+  size_t beg = !variable_name.empty() && variable_name[0] == '^' ? 1 : 0;
+  std::string name = variable_name.substr(beg);
+  return CoreRouter::OwnerCore(std::hash<std::string>()(name));
+}
+
+void ServerService::ShardedProcess(const std::vector<Data*>& inputs, std::vector<Data*>* outputs,
+                                   ps::service::seastar::DoneClosure* done, bool traced) {
+  WrapperData<std::string>* variable_name =
+      inputs.size() < 3 ? nullptr : dynamic_cast<WrapperData<std::string>*>(inputs[2]);
+  auto process = [this, traced](const std::vector<Data*>& inputs, std::vector<Data*>* outputs) {
+    if (traced) {
+      TracedProcess(inputs, outputs);
+    } else {
+      Process(inputs, outputs);
+    }
+  };
+  if (variable_name == nullptr) {
+    process(inputs, outputs);
+    done->Run();
+    return;
+  }
+  std::vector<Data*> args(inputs);
+  CoreRouter::RunOn(OwnerCore(variable_name->Internal()),
+                    [process, args, outputs] { process(args, outputs); },
+                    [done] { done->Run(); });
+}
+
+void ServerService::ShardedBatchProcess(const std::vector<Data*>& inputs, std::vector<Data*>* outputs,
+                                        ps::service::seastar::DoneClosure* done) {
+  Status st = CheckBatch(inputs);
+  if (!st.IsOk()) {
+    outputs->push_back(new WrapperData<Status>(st));
+    done->Run();
+    return;
+  }
+  const Version& ver = dynamic_cast<WrapperData<Version>*>(inputs[0])->Internal();
+  const std::vector<int64_t>& items = dynamic_cast<WrapperData<std::vector<int64_t> >*>(inputs[1])->Internal();
+  const std::vector<std::string>& names = dynamic_cast<WrapperData<std::vector<std::string> >*>(inputs[2])->Internal();
+  // The items of a core run there in one go, the replies are assembled in
+  // the request order once the last core is back on the calling one.
+  struct Batch {
+    std::vector<std::vector<Data*>> ins;
+    std::vector<std::vector<Data*>> outs;
+    size_t pending;
+  };
+  std::shared_ptr<Batch> batch(new Batch);
+  batch->ins.resize(names.size());
+  batch->outs.resize(names.size());
+  std::map<size_t, std::vector<size_t>> groups;
+  size_t offset = 3;
+  for (size_t i = 0; i < names.size(); i++) {
+    batch->ins[i].assign(inputs.begin() + offset, inputs.begin() + offset + items[i * 2 + 1]);
+    offset += items[i * 2 + 1];
+    groups[OwnerCore(names[i])].push_back(i);
+  }
+  if (groups.empty()) {
+    BatchProcess(inputs, outputs);
+    done->Run();
+    return;
+  }
+  batch->pending = groups.size();
+  std::vector<int64_t> udfs;
+  for (size_t i = 0; i < names.size(); i++) {
+    udfs.push_back(items[i * 2]);
+  }
+  Version version = ver;
+  for (auto& group : groups) {
+    std::vector<size_t> ids = group.second;
+    CoreRouter::RunOn(group.first, [this, batch, ids, version, udfs, names] {
+      for (size_t i : ids) {
+        RunBatchItem(version, (size_t)udfs[i], names[i], batch->ins[i], &batch->outs[i]);
+      }
+    }, [batch, outputs, done] {
+      if (--batch->pending != 0) {
+        return;
+      }
+      WrapperData<std::vector<int64_t> >* counts = new WrapperData<std::vector<int64_t> >();
+      outputs->push_back(new WrapperData<Status>(Status::Ok()));
+      outputs->push_back(counts);
+      for (auto& out : batch->outs) {
+        outputs->insert(outputs->end(), out.begin(), out.end());
+        counts->Internal().push_back(out.size());
+      }
+      done->Run();
+    });
+  }
+}
+
 void ServerService::Save(const std::vector<Data*>& inputs, std::vector<Data*>* outputs) {
   if (inputs.size() != 3) {
     outputs->push_back(new WrapperData<Status>(Status::ArgumentError("SaveFunc: Need 3 inputs")));
@@ -310,6 +602,147 @@ void ServerService::TriggerStreamingHash(const std::vector<Data*>& inputs, std::
   return;
 }
 
+void ServerService::SetReplicas(const std::vector<Data*>& inputs, std::vector<Data*>* outputs) {
+  if (inputs.size() != 2) {
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("SetReplicasFunc: Need 2 inputs")));
+    return;
+  }
+  WrapperData<Version>* ver = dynamic_cast<WrapperData<Version>*>(inputs[0]);
+  WrapperData<std::vector<std::string> >* addrs = dynamic_cast<WrapperData<std::vector<std::string> >*>(inputs[1]);
+  if ((ver == nullptr) || (addrs == nullptr)){
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("SetReplicasFunc: Input Type Error")));
+    return;
+  }
+  if (replica_ != 0) {
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("SetReplicasFunc: replica " + std::to_string(replica_) + " can't have replicas")));
+    return;
+  }
+  std::unique_lock<std::mutex> lock(replica_mu_);
+  const std::vector<std::string>& replica_addrs = addrs->Internal();
+  for (size_t i = 0; i < replica_addrs.size(); i++) {
+    if (!seastar_lib_->Connect(i + 1, replica_addrs[i])) {
+      outputs->push_back(new WrapperData<Status>(Status::NetworkError("SetReplicasFunc: Connect Failed " + replica_addrs[i])));
+      return;
+    }
+  }
+  replica_size_ = replica_addrs.size();
+  if (replica_size_ > 0 && forward_replica_loop_ == nullptr) {
+    StreamingModelUtils::EnableReplica();
+    forward_replica_loop_.reset(new std::thread([this]{ForwardReplicas();}));
+  }
+  LOG(INFO) << "Server " << server_id_ << " forwards to " << replica_size_ << " replicas";
+  outputs->push_back(new WrapperData<Status>(Status::Ok()));
+}
+
+void ServerService::ApplyReplica(const std::vector<Data*>& inputs, std::vector<Data*>* outputs) {
+  if (inputs.size() != 2) {
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("ApplyReplicaFunc: Need 2 inputs")));
+    return;
+  }
+  WrapperData<Version>* ver = dynamic_cast<WrapperData<Version>*>(inputs[0]);
+  WrapperData<ReplicaDelta>* delta = dynamic_cast<WrapperData<ReplicaDelta>*>(inputs[1]);
+  if ((ver == nullptr) || (delta == nullptr)){
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("ApplyReplicaFunc: Input Type Error")));
+    return;
+  }
+  Status st = server_->ApplyReplicaDelta(ver->Internal(), delta->Internal());
+  outputs->push_back(new WrapperData<Status>(st));
+  return;
+}
+
+void ServerService::GetLoad(const std::vector<Data*>& inputs, std::vector<Data*>* outputs) {
+  if (inputs.size() != 1) {
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("GetLoadFunc: Need 1 inputs")));
+    return;
+  }
+  WrapperData<Version>* ver = dynamic_cast<WrapperData<Version>*>(inputs[0]);
+  if (ver == nullptr) {
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("GetLoadFunc: Input Type Error")));
+    return;
+  }
+  ServerLoad load;
+  Status st = server_->GetLoad(ver->Internal(), &load);
+  outputs->push_back(new WrapperData<Status>(st));
+  if (st.IsOk()) {
+    outputs->push_back(new WrapperData<ServerLoad>(std::move(load)));
+  }
+  return;
+}
+
+void ServerService::GetStats(const std::vector<Data*>& inputs, std::vector<Data*>* outputs) {
+  if (inputs.size() != 1) {
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("GetStatsFunc: Need 1 inputs")));
+    return;
+  }
+  WrapperData<Version>* ver = dynamic_cast<WrapperData<Version>*>(inputs[0]);
+  if (ver == nullptr) {
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("GetStatsFunc: Input Type Error")));
+    return;
+  }
+  ServerStats stats;
+  Status st = server_->GetStats(ver->Internal(), &stats);
+  outputs->push_back(new WrapperData<Status>(st));
+  if (st.IsOk()) {
+    outputs->push_back(new WrapperData<ServerStats>(std::move(stats)));
+  }
+  return;
+}
+
+void ServerService::BumpVersion(const std::vector<Data*>& inputs, std::vector<Data*>* outputs) {
+  if (inputs.size() != 2) {
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("BumpVersionFunc: Need 2 inputs")));
+    return;
+  }
+  WrapperData<Version>* ver = dynamic_cast<WrapperData<Version>*>(inputs[0]);
+  WrapperData<Version>* new_ver = dynamic_cast<WrapperData<Version>*>(inputs[1]);
+  if (ver == nullptr || new_ver == nullptr) {
+    outputs->push_back(new WrapperData<Status>(Status::ArgumentError("BumpVersionFunc: Input Type Error")));
+    return;
+  }
+  outputs->push_back(new WrapperData<Status>(server_->BumpVersion(ver->Internal(), new_ver->Internal())));
+}
+
+void ServerService::ForwardReplicas() {
+  while (!stop_) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(replica_sync_ms_));
+    std::unique_lock<std::mutex> lock(replica_mu_);
+    Version ver;
+    ReplicaDelta delta;
+    Status st = server_->CollectReplicaDelta(&ver, &delta);
+    if (!st.IsOk()) {
+      LOG(WARNING) << "Collect replica delta failed: " << st.ToString();
+      continue;
+    }
+    if (delta.updates.empty()) {
+      continue;
+    }
+    size_t replica_size = replica_size_;
+    std::vector<std::promise<Status> > results(replica_size);
+    for (size_t i = 0; i < replica_size; i++) {
+      std::vector<Data*> request_datas = {
+        new WrapperData<Version>(ver),
+        new WrapperData<ReplicaDelta>(delta)
+      };
+      std::promise<Status>* result = &results[i];
+      seastar_lib_->Request(i + 1, func_ids::kServerApplyReplica, request_datas,
+          new ps::service::seastar::CallBackClosure([result](const SeastarStatus& sst, const std::vector<ps::Data*>& datas) {
+            if (!sst.Success()) {
+              result->set_value(Status::NetworkError("Replica Error"));
+            } else {
+              result->set_value(GetNetworkStatus(datas));
+            }
+      }));
+    }
+    for (size_t i = 0; i < replica_size; i++) {
+      // a failed replica stays stale until the scheduler restores the cluster
+      Status result = results[i].get_future().get();
+      if (!result.IsOk()) {
+        LOG(WARNING) << "Forward to replica " << i + 1 << " of server " << server_id_ << " failed: " << result.ToString();
+      }
+    }
+  }
+}
+
 void ServerService::RegisterServer() {
   std::string old_scheduler_addr;
   while (!stop_) {
@@ -335,7 +768,7 @@ void ServerService::RegisterServer() {
 
     std::promise<Status> result;
     std::vector<Data*> request_datas = {
-      new WrapperData<ps::ServerInfo>(0, server_id_, server_version_, ip_, port_)
+      new WrapperData<ps::ServerInfo>(0, server_id_, server_version_, ip_, port_, replica_)
     };
     seastar_lib_->Request(0, func_ids::kSchedulerRegisterServer, request_datas,
         new ps::service::seastar::CallBackClosure([&result](const SeastarStatus& sst, const std::vector<ps::Data*>& datas) {
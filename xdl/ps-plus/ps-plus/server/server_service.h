@@ -22,8 +22,13 @@ limitations under the License.
 #include "ps-plus/common/thread_pool.h"
 #include "ps-plus/service/seastar/lib/seastar_server_client_lib.h"
 #include "ps-plus/service/seastar/lib/done_closure.h"
+#include "ps-plus/service/shm/lib/shm_server_lib.h"
+#ifdef USE_RDMA
+#include "ps-plus/service/rdma/lib/rdma_server_lib.h"
+#endif
 
 #include <atomic>
+#include <mutex>
 
 namespace ps {
 namespace server {
@@ -35,12 +40,28 @@ class ServerService {
 		std::string streaming_dense_model_addr,
 		std::string streaming_sparse_model_addr,
     std::string streaming_hash_model_addr,
-    bool bind_cores);
+    bool bind_cores,
+    size_t replica = 0,
+    int replica_sync_ms = 100);
   Status Init();
   ~ServerService();
  private:
   void RegisterUdfChain(const std::vector<Data*>& inputs, std::vector<Data*>* outputs);
   void Process(const std::vector<Data*>& inputs, std::vector<Data*>* outputs);
+  // Process with the (trace id, span id) of the client rpc span after the
+  // variable name, run as a ps_server span.
+  void TracedProcess(const std::vector<Data*>& inputs, std::vector<Data*>* outputs);
+  void BatchProcess(const std::vector<Data*>& inputs, std::vector<Data*>* outputs);
+  Status CheckBatch(const std::vector<Data*>& inputs);
+  void RunBatchItem(const Version& ver, size_t udf, const std::string& name,
+                    const std::vector<Data*>& in, std::vector<Data*>* outputs);
+  // Core sharded mode, called on a reactor: the work runs on the owner
+  // cores of the variables and done is run back on the calling core.
+  size_t OwnerCore(const std::string& variable_name);
+  void ShardedProcess(const std::vector<Data*>& inputs, std::vector<Data*>* outputs,
+                      ps::service::seastar::DoneClosure* done, bool traced = false);
+  void ShardedBatchProcess(const std::vector<Data*>& inputs, std::vector<Data*>* outputs,
+                           ps::service::seastar::DoneClosure* done);
   void Save(const std::vector<Data*>& inputs, std::vector<Data*>* outputs);
   void Restore(const std::vector<Data*>& inputs, std::vector<Data*>* outputs);
   void Announce(const std::vector<Data*>& inputs, std::vector<Data*>* outputs);
@@ -48,21 +69,40 @@ class ServerService {
   void GatherStreamingDenseVar(const std::vector<Data*>& inputs, std::vector<Data*>* outputs);
   void TriggerStreamingSparse(const std::vector<Data*>& inputs, std::vector<Data*>* outputs);
   void TriggerStreamingHash(const std::vector<Data*>& inputs, std::vector<Data*>* outputs);
+  void SetReplicas(const std::vector<Data*>& inputs, std::vector<Data*>* outputs);
+  void ApplyReplica(const std::vector<Data*>& inputs, std::vector<Data*>* outputs);
+  void GetLoad(const std::vector<Data*>& inputs, std::vector<Data*>* outputs);
+  void GetStats(const std::vector<Data*>& inputs, std::vector<Data*>* outputs);
+  void BumpVersion(const std::vector<Data*>& inputs, std::vector<Data*>* outputs);
   void RegisterServer();
+  // Pushes the rows written since the last round to every replica, one
+  // round in flight at a time so replicas apply them in order.
+  void ForwardReplicas();
 
   static const int CLIENT_THREAD_NUM = 100;
 
   std::unique_ptr<std::thread> register_server_loop_;
+  std::unique_ptr<std::thread> forward_replica_loop_;
   int port_;
   std::string ip_;
   bool stop_;
   int server_id_;
   int core_num_;
   int bind_cores_;
+  size_t replica_;
+  int replica_sync_ms_;
+  bool core_sharded_;
+  // Connected as ids 1..replica_size_, 0 is the scheduler.
+  std::atomic<size_t> replica_size_;
+  std::mutex replica_mu_;
   
   Version server_version_;
   std::unique_ptr<Server> server_;
   std::unique_ptr<ps::service::seastar::SeastarServerClientLib> seastar_lib_;
+  std::unique_ptr<ps::service::shm::ShmServerLib> shm_lib_;
+#ifdef USE_RDMA
+  std::unique_ptr<ps::service::rdma::RdmaServerLib> rdma_lib_;
+#endif
   std::string scheduler_kv_addr_;
   std::atomic<Version> scheduler_version_;
   std::unique_ptr<ThreadPool> lazy_queue_;
@@ -0,0 +1,307 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/server/streaming_model_export.h"
+#include "ps-plus/common/file_system.h"
+#include "ps-plus/common/logging.h"
+#include "ps-plus/common/plugin.h"
+#include "ps-plus/common/string_utils.h"
+#include "ps-plus/common/thread_pool.h"
+
+#include <cstring>
+
+namespace ps {
+namespace server {
+
+namespace {
+
+// rows encoded by a thread before they are written
+const size_t kWriteBatchRows = 4096;
+
+std::string FileName(const std::string& name) {
+  std::string result = name;
+  for (auto& c : result) {
+    if (c == '/') {
+      c = '_';
+    }
+  }
+  return result;
+}
+
+size_t NowMillis() {
+  return common::MetricsCollector::GetCurrentTimeMS() / 1000;
+}
+
+Status WriteKeys(FileSystem::WriteStream* stream, StreamingFileWriter::KeyKind key_kind,
+                 const std::vector<std::pair<int64_t, int64_t>>& keys) {
+  if (key_kind == StreamingFileWriter::kNoKey) {
+    return Status::Ok();
+  }
+  std::vector<int64_t> buf;
+  buf.reserve(keys.size() * 2);
+  for (auto& key : keys) {
+    buf.push_back(key.first);
+    if (key_kind == StreamingFileWriter::kHash128Key) {
+      buf.push_back(key.second);
+    }
+  }
+  return stream->Write(buf.data(), buf.size() * sizeof(int64_t));
+}
+
+}
+
+const uint32_t StreamingFileWriter::kFormat;
+
+StreamingFileWriter::Stream::Stream(const std::string& kind, KeyKind key_kind)
+  : kind(kind), key_kind(key_kind), triggers(0), oldest_millis(0), server_id(0) {
+  common::MetricsCollector* metrics = common::MetricsCollector::Instance();
+  lag_millis = metrics->GetHistogram("streaming." + kind + ".lag_millis");
+  write_micros = metrics->GetHistogram("streaming." + kind + ".write_micros");
+  rows = metrics->GetHistogram("streaming." + kind + ".rows");
+}
+
+StreamingFileWriter::StreamingFileWriter(const std::string& dir, size_t compact_triggers, StoragePrecision precision)
+  : dir_(dir), compact_triggers_(compact_triggers == 0 ? 1 : compact_triggers), precision_(precision),
+    dense_("dense", kNoKey), sparse_("sparse", kInt64Key), hash_("hash", kHash128Key) {
+}
+
+StreamingFileWriter::~StreamingFileWriter() {
+  Status st = Flush();
+  if (!st.IsOk()) {
+    LOG(ERROR) << "StreamingFileWriter: flush " << dir_ << " error " << st.ToString();
+  }
+}
+
+Status StreamingFileWriter::GetPending(Stream* stream, const std::string& name, const Tensor& data, Pending** result) {
+  const TensorShape& shape = data.Shape();
+  size_t row_elements = shape.NumElements();
+  if (stream->key_kind != kNoKey) {
+    if (shape.IsScalar() || shape[0] == 0) {
+      return Status::ArgumentError("StreamingFileWriter: " + name + " has no rows");
+    }
+    row_elements /= shape[0];
+  }
+  Pending& pending = stream->vars[name];
+  if (pending.keys.empty() && pending.deletes.empty()) {
+    pending.type = data.Type();
+    pending.row_elements = row_elements;
+    pending.row_bytes = row_elements * SizeOfType(data.Type());
+  } else if (pending.type != data.Type() || pending.row_elements != row_elements) {
+    return Status::ArgumentError("StreamingFileWriter: " + name + " changed its row shape");
+  }
+  *result = &pending;
+  return Status::Ok();
+}
+
+void StreamingFileWriter::WriteRow(Pending* pending, const Key& key, const char* row) {
+  auto iter = pending->slots.find(key);
+  size_t slot;
+  if (iter != pending->slots.end()) {
+    slot = iter->second;
+  } else {
+    slot = pending->keys.size();
+    pending->keys.push_back(key);
+    pending->live.push_back(true);
+    pending->rows.resize(pending->rows.size() + pending->row_bytes);
+    pending->slots[key] = slot;
+    pending->live_count++;
+  }
+  memcpy(&pending->rows[slot * pending->row_bytes], row, pending->row_bytes);
+  pending->deletes.erase(key);
+}
+
+void StreamingFileWriter::DeleteRow(Pending* pending, const Key& key) {
+  auto iter = pending->slots.find(key);
+  if (iter != pending->slots.end()) {
+    pending->live[iter->second] = false;
+    pending->slots.erase(iter);
+    pending->live_count--;
+  }
+  pending->deletes.insert(key);
+}
+
+Status StreamingFileWriter::WriteDenseModel(const std::vector<DenseModel>& val, const std::string& stream_version) {
+  std::unique_lock<std::mutex> lock(mu_);
+  for (auto& model : val) {
+    Pending* pending;
+    PS_CHECK_STATUS(GetPending(&dense_, model.name, model.data, &pending));
+    WriteRow(pending, Key(0, 0), model.data.Raw<char>());
+  }
+  return Trigger(&dense_, stream_version, 0);
+}
+
+Status StreamingFileWriter::WriteSparseModel(const std::vector<SparseModel>& val, const std::string& stream_version, const int& server_id) {
+  std::unique_lock<std::mutex> lock(mu_);
+  for (auto& model : val) {
+    if (model.ids.size() != model.offsets.size()) {
+      return Status::ArgumentError("StreamingFileWriter: ids and offsets of " + model.name + " differ");
+    }
+    Pending* pending;
+    PS_CHECK_STATUS(GetPending(&sparse_, model.name, model.data, &pending));
+    for (size_t i = 0; i < model.ids.size(); i++) {
+      WriteRow(pending, Key(model.ids[i], 0), model.data.Raw<char>(model.offsets[i]));
+    }
+  }
+  return Trigger(&sparse_, stream_version, server_id);
+}
+
+Status StreamingFileWriter::WriteHashModel(const std::vector<HashModel>& val, const std::string& stream_version, const int& server_id) {
+  std::unique_lock<std::mutex> lock(mu_);
+  for (auto& model : val) {
+    if (model.ids.size() != model.offsets.size()) {
+      return Status::ArgumentError("StreamingFileWriter: ids and offsets of " + model.name + " differ");
+    }
+    Pending* pending;
+    PS_CHECK_STATUS(GetPending(&hash_, model.name, model.data, &pending));
+    for (size_t i = 0; i < model.ids.size(); i++) {
+      WriteRow(pending, model.ids[i], model.data.Raw<char>(model.offsets[i]));
+    }
+    for (auto& key : model.del_ids) {
+      DeleteRow(pending, key);
+    }
+  }
+  return Trigger(&hash_, stream_version, server_id);
+}
+
+Status StreamingFileWriter::Trigger(Stream* stream, const std::string& stream_version, int server_id) {
+  if (stream->oldest_millis == 0) {
+    stream->oldest_millis = NowMillis();
+  }
+  stream->version = stream_version;
+  stream->server_id = server_id;
+  if (++stream->triggers < compact_triggers_) {
+    return Status::Ok();
+  }
+  return FlushStream(stream);
+}
+
+Status StreamingFileWriter::Flush() {
+  std::unique_lock<std::mutex> lock(mu_);
+  PS_CHECK_STATUS(FlushStream(&dense_));
+  PS_CHECK_STATUS(FlushStream(&sparse_));
+  return FlushStream(&hash_);
+}
+
+Status StreamingFileWriter::FlushStream(Stream* stream) {
+  if (stream->triggers == 0) {
+    return Status::Ok();
+  }
+  size_t start = common::MetricsCollector::GetCurrentTimeMS();
+  std::string dir = dir_ + "/" + stream->version + "/" + stream->kind;
+  PS_CHECK_STATUS(FileSystem::MkdirAny(dir));
+  std::vector<std::pair<std::string, Pending*>> vars;
+  size_t rows = 0;
+  for (auto& item : stream->vars) {
+    vars.emplace_back(item.first, &item.second);
+    rows += item.second.live_count;
+  }
+  std::string suffix = "." + std::to_string(stream->server_id);
+  PS_CHECK_STATUS(MultiThreadDo(vars.size(), [&](const Range& r) {
+        for (size_t i = r.begin; i < r.end; i++) {
+          PS_CHECK_STATUS(WriteFile(dir + "/" + FileName(vars[i].first) + suffix, stream->key_kind, *vars[i].second));
+        }
+        return Status::Ok();
+      }, 1));
+  {
+    std::unique_ptr<FileSystem::WriteStream> done;
+    PS_CHECK_STATUS(FileSystem::OpenWriteStreamAny(dir + "/_DONE" + suffix, &done));
+    PS_CHECK_STATUS(done->WriteRaw<uint64_t>(vars.size()));
+  }
+  stream->lag_millis->Record(NowMillis() - stream->oldest_millis);
+  stream->write_micros->Record(common::MetricsCollector::GetCurrentTimeMS() - start);
+  stream->rows->Record(rows);
+  LOG(INFO) << "StreamingFileWriter: " << dir << " server " << stream->server_id << ", vars " << vars.size() << ", rows " << rows
+            << ", triggers " << stream->triggers << ", lag " << NowMillis() - stream->oldest_millis << "ms";
+  stream->vars.clear();
+  stream->triggers = 0;
+  stream->oldest_millis = 0;
+  return Status::Ok();
+}
+
+Status StreamingFileWriter::WriteFile(const std::string& file, KeyKind key_kind, const Pending& pending) {
+  bool encode = pending.type == DataType::kFloat && precision_ != StoragePrecision::kFloat;
+  size_t row_bytes = encode ? EncodedRowBytes(precision_, pending.row_elements) : pending.row_bytes;
+  std::vector<Key> keys;
+  std::vector<size_t> slots;
+  keys.reserve(pending.live_count);
+  slots.reserve(pending.live_count);
+  for (size_t i = 0; i < pending.keys.size(); i++) {
+    if (pending.live[i]) {
+      keys.push_back(pending.keys[i]);
+      slots.push_back(i);
+    }
+  }
+  std::vector<Key> deletes(pending.deletes.begin(), pending.deletes.end());
+  std::unique_ptr<FileSystem::WriteStream> stream;
+  PS_CHECK_STATUS(FileSystem::OpenWriteStreamAny(file, &stream));
+  PS_CHECK_STATUS(stream->Write("PSSM", 4));
+  PS_CHECK_STATUS(stream->WriteRaw<uint32_t>(kFormat));
+  PS_CHECK_STATUS(stream->WriteRaw<uint32_t>(key_kind));
+  PS_CHECK_STATUS(stream->WriteRaw<int32_t>((int32_t)(encode ? precision_ : StoragePrecision::kFloat)));
+  PS_CHECK_STATUS(stream->WriteRaw<int32_t>((int32_t)pending.type));
+  PS_CHECK_STATUS(stream->WriteRaw<uint64_t>(pending.row_elements));
+  PS_CHECK_STATUS(stream->WriteRaw<uint64_t>(row_bytes));
+  PS_CHECK_STATUS(stream->WriteRaw<uint64_t>(keys.size()));
+  PS_CHECK_STATUS(stream->WriteRaw<uint64_t>(deletes.size()));
+  PS_CHECK_STATUS(WriteKeys(stream.get(), key_kind, keys));
+  std::vector<char> buf;
+  for (size_t beg = 0; beg < slots.size(); beg += kWriteBatchRows) {
+    size_t end = std::min(slots.size(), beg + kWriteBatchRows);
+    buf.resize((end - beg) * row_bytes);
+    for (size_t i = beg; i < end; i++) {
+      const char* row = &pending.rows[slots[i] * pending.row_bytes];
+      if (encode) {
+        EncodeRow(precision_, (const float*)row, pending.row_elements, &buf[(i - beg) * row_bytes], nullptr);
+      } else {
+        memcpy(&buf[(i - beg) * row_bytes], row, row_bytes);
+      }
+    }
+    PS_CHECK_STATUS(stream->Write(buf.data(), buf.size()));
+  }
+  return WriteKeys(stream.get(), key_kind, deletes);
+}
+
+Status StreamingFileManager::OpenWriter(const std::string& path, std::unique_ptr<StreamingModelWriter>* writer) {
+  std::string dir = path.substr(path.find("://") + 3);
+  std::unordered_map<std::string, std::string> kvs;
+  size_t pos = dir.rfind('?');
+  if (pos != std::string::npos) {
+    kvs = StringUtils::ParseMap(dir.substr(pos + 1));
+    dir = dir.substr(0, pos);
+  }
+  if (dir.empty()) {
+    return Status::ArgumentError("StreamingFileManager: no directory in " + path);
+  }
+  uint64_t compact_triggers = 1;
+  StoragePrecision precision = StoragePrecision::kFloat;
+  for (auto& item : kvs) {
+    if (item.first == "compact_triggers") {
+      if (!StringUtils::strToUInt64(item.second.c_str(), compact_triggers)) {
+        return Status::ArgumentError("StreamingFileManager: compact_triggers not int " + item.second);
+      }
+    } else if (item.first == "precision") {
+      PS_CHECK_STATUS(ParseStoragePrecision(item.second, &precision));
+    } else {
+      return Status::ArgumentError("StreamingFileManager: unknown option " + item.first);
+    }
+  }
+  writer->reset(new StreamingFileWriter(dir, compact_triggers, precision));
+  return Status::Ok();
+}
+
+PLUGIN_REGISTER(StreamingModelManager, stream_file, StreamingFileManager);
+
+}
+}
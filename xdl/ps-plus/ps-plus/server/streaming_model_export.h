@@ -0,0 +1,127 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_SERVER_STREAMING_MODEL_EXPORT_H_
+#define PS_PLUS_SERVER_STREAMING_MODEL_EXPORT_H_
+
+#include "ps-plus/message/streaming_model_manager.h"
+#include "ps-plus/common/reduced_precision.h"
+#include "ps-plus/common/metrics_collector.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ps {
+namespace server {
+
+// Streaming model output to files, opened by the stream_file protocol:
+//   stream_file://<dir>[?compact_triggers=N&precision=fp16|bf16|int8]
+// The rows of a trigger are copied into the pending rows of their variable,
+// a later write of an id overwrites its row and a delete drops it. Every
+// compact_triggers triggers the pending rows are written, one file per
+// variable and server, the files in parallel:
+//   <dir>/<stream_version>/<sparse|hash|dense>/<variable>.<server_id>
+// followed by a _DONE.<server_id> marker in the same directory.
+//
+// A file is "PSSM", uint32 format, uint32 key kind (0 none, 1 int64,
+// 2 hash128), int32 precision, int32 dtype, uint64 row elements, uint64 row
+// bytes as written, uint64 rows, uint64 deletes, then the keys of the rows,
+// the rows and the deleted keys. Float rows are encoded by precision as in
+// reduced_precision.h, rows of other types are written raw.
+//
+// Histograms streaming.<kind>.lag_millis (time the oldest pending row
+// waited for its file), streaming.<kind>.write_micros and
+// streaming.<kind>.rows record every flush.
+class StreamingFileWriter : public StreamingModelWriter {
+ public:
+  static const uint32_t kFormat = 1;
+  enum KeyKind {
+    kNoKey = 0,
+    kInt64Key = 1,
+    kHash128Key = 2
+  };
+
+  StreamingFileWriter(const std::string& dir, size_t compact_triggers, StoragePrecision precision);
+  virtual ~StreamingFileWriter();
+
+  virtual Status WriteDenseModel(const std::vector<DenseModel>& val, const std::string& stream_version) override;
+  virtual Status WriteSparseModel(const std::vector<SparseModel>& val, const std::string& stream_version, const int& server_id) override;
+  virtual Status WriteHashModel(const std::vector<HashModel>& val, const std::string& stream_version, const int& server_id) override;
+
+  // Writes the pending rows now.
+  Status Flush();
+
+ private:
+  typedef std::pair<int64_t, int64_t> Key;
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      return key.first * 0x9E3779B97F4A7C15ull ^ key.second;
+    }
+  };
+  // The rows are kept in one arena, slot i holds the row of keys[i]
+  struct Pending {
+    DataType type;
+    size_t row_elements;
+    size_t row_bytes;
+    std::vector<char> rows;
+    std::vector<Key> keys;
+    std::vector<bool> live;
+    std::unordered_map<Key, size_t, KeyHash> slots;
+    std::unordered_set<Key, KeyHash> deletes;
+    size_t live_count = 0;
+  };
+  struct Stream {
+    Stream(const std::string& kind, KeyKind key_kind);
+    std::string kind;
+    KeyKind key_kind;
+    std::unordered_map<std::string, Pending> vars;
+    size_t triggers;
+    // first trigger of the pending rows, 0 if there are none
+    size_t oldest_millis;
+    std::string version;
+    int server_id;
+    common::Histogram* lag_millis;
+    common::Histogram* write_micros;
+    common::Histogram* rows;
+  };
+
+  static Status GetPending(Stream* stream, const std::string& name, const Tensor& data, Pending** result);
+  static void WriteRow(Pending* pending, const Key& key, const char* row);
+  static void DeleteRow(Pending* pending, const Key& key);
+  Status Trigger(Stream* stream, const std::string& stream_version, int server_id);
+  Status FlushStream(Stream* stream);
+  Status WriteFile(const std::string& file, KeyKind key_kind, const Pending& pending);
+
+  std::string dir_;
+  size_t compact_triggers_;
+  StoragePrecision precision_;
+  std::mutex mu_;
+  Stream dense_;
+  Stream sparse_;
+  Stream hash_;
+};
+
+class StreamingFileManager : public StreamingModelManager {
+ public:
+  virtual Status OpenWriter(const std::string& path, std::unique_ptr<StreamingModelWriter>* writer) override;
+};
+
+}
+}
+
+#endif
@@ -18,16 +18,16 @@ limitations under the License.
 namespace ps {
 namespace server {
 
-Status StreamingModelUtils::WriteDense(const std::string& var) {
+Status StreamingModelUtils::WriteDense(const std::string& var, Channel channel) {
   std::unique_lock<std::mutex> lock(logger_.logger->mu);
-  DenseLog& log = logger_.logger->dense[var];
+  DenseLog& log = logger_.logger->logs[channel].dense[var];
   log.clear = false;
   return Status::Ok();
 }
 
-Status StreamingModelUtils::WriteSparse(const std::string& var, const Tensor& data) {
+Status StreamingModelUtils::WriteSparse(const std::string& var, const Tensor& data, Channel channel) {
   std::unique_lock<std::mutex> lock(logger_.logger->mu);
-  SparseLog& log = logger_.logger->sparse[var];
+  SparseLog& log = logger_.logger->logs[channel].sparse[var];
   if (data.Shape().Size() != 1) {
     return Status::ArgumentError("StreamingModelUtils WriteSparse Error: Shape Error");
   }
@@ -40,9 +40,9 @@ Status StreamingModelUtils::WriteSparse(const std::string& var, const Tensor& da
   return Status::Ok();
 }
 
-Status StreamingModelUtils::WriteHash(const std::string& var, const Tensor& data) {
+Status StreamingModelUtils::WriteHash(const std::string& var, const Tensor& data, Channel channel) {
   std::unique_lock<std::mutex> lock(logger_.logger->mu);
-  HashLog& log = logger_.logger->hash[var];
+  HashLog& log = logger_.logger->logs[channel].hash[var];
   if (data.Shape().Size() != 2 || data.Shape()[1] != 2) {
     return Status::ArgumentError("StreamingModelUtils WriteHash Error: Shape Error");
   }
@@ -55,24 +55,24 @@ Status StreamingModelUtils::WriteHash(const std::string& var, const Tensor& data
   return Status::Ok();
 }
 
-Status StreamingModelUtils::DelHash(const std::string& var, const std::vector<int64_t>& data) {
+Status StreamingModelUtils::DelHash(const std::string& var, const std::vector<int64_t>& data, Channel channel) {
   std::unique_lock<std::mutex> lock(logger_.logger->mu);
-  HashLog& log = logger_.logger->hash[var];
+  HashLog& log = logger_.logger->logs[channel].hash[var];
   for (size_t i = 0; i < data.size() / 2; i++) {
     log.del_ids.insert(std::pair<int64_t, int64_t>(data[i * 2], data[i * 2 + 1]));
   }
   return Status::Ok();
 }
 
-Status StreamingModelUtils::GetDense(std::unordered_map<std::string, DenseLog>* result) {
+Status StreamingModelUtils::GetDense(std::unordered_map<std::string, DenseLog>* result, Channel channel) {
   std::unique_lock<std::mutex> lock(mu_);
   result->clear();
   for (auto&& logger : loggers_) {
     {
       std::unique_lock<std::mutex> lock(logger->mu);
-      std::swap(logger->dense, logger->dense_back);
+      std::swap(logger->logs[channel].dense, logger->back[channel].dense);
     }
-    auto& log = logger->dense_back;
+    auto& log = logger->back[channel].dense;
     for (auto& item : log) {
       (*result)[item.first].Combine(item.second);
       item.second.Clear();
@@ -90,15 +90,15 @@ Status StreamingModelUtils::GetDense(std::unordered_map<std::string, DenseLog>*
   return Status::Ok();
 }
 
-Status StreamingModelUtils::GetSparse(std::unordered_map<std::string, SparseLog>* result) {
+Status StreamingModelUtils::GetSparse(std::unordered_map<std::string, SparseLog>* result, Channel channel) {
   std::unique_lock<std::mutex> lock(mu_);
   result->clear();
   for (auto&& logger : loggers_) {
     {
       std::unique_lock<std::mutex> lock(logger->mu);
-      std::swap(logger->sparse, logger->sparse_back);
+      std::swap(logger->logs[channel].sparse, logger->back[channel].sparse);
     }
-    auto& log = logger->sparse_back;
+    auto& log = logger->back[channel].sparse;
     for (auto& item : log) {
       (*result)[item.first].Combine(item.second);
       item.second.Clear();
@@ -116,15 +116,15 @@ Status StreamingModelUtils::GetSparse(std::unordered_map<std::string, SparseLog>
   return Status::Ok();
 }
 
-Status StreamingModelUtils::GetHash(std::unordered_map<std::string, HashLog>* result) {
+Status StreamingModelUtils::GetHash(std::unordered_map<std::string, HashLog>* result, Channel channel) {
   std::unique_lock<std::mutex> lock(mu_);
   result->clear();
   for (auto&& logger : loggers_) {
     {
       std::unique_lock<std::mutex> lock(logger->mu);
-      std::swap(logger->hash, logger->hash_back);
+      std::swap(logger->logs[channel].hash, logger->back[channel].hash);
     }
-    auto& log = logger->hash_back;
+    auto& log = logger->back[channel].hash;
     for (auto& item : log) {
       (*result)[item.first].Combine(item.second);
       item.second.Clear();
@@ -161,6 +161,7 @@ StreamingModelUtils::LoggerRegister::~LoggerRegister() {
 std::mutex StreamingModelUtils::mu_;
 std::unordered_set<StreamingModelUtils::Logger*> StreamingModelUtils::loggers_;
 thread_local StreamingModelUtils::LoggerRegister StreamingModelUtils::logger_;
+std::atomic<bool> StreamingModelUtils::replica_enabled_(false);
 
 }
 }
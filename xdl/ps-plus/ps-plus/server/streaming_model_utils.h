@@ -22,6 +22,7 @@ limitations under the License.
 #include <unordered_set>
 #include <unordered_map>
 #include <mutex>
+#include <atomic>
 
 namespace ps {
 namespace server {
@@ -79,23 +80,35 @@ class StreamingModelUtils {
     }
   };
 
-  static Status WriteDense(const std::string& var);
-  static Status WriteSparse(const std::string& var, const Tensor& data);
-  static Status WriteHash(const std::string& var, const Tensor& data);
-  static Status DelHash(const std::string& var, const std::vector<int64_t>& data);
-  static Status GetDense(std::unordered_map<std::string, DenseLog>* var);
-  static Status GetSparse(std::unordered_map<std::string, SparseLog>* var);
-  static Status GetHash(std::unordered_map<std::string, HashLog>* var);
+  // Every channel keeps its own logs, so the streaming model output and the
+  // replica forwarding each see all writes since they last drained.
+  enum Channel {
+    kStreaming = 0,
+    kReplica = 1,
+    kChannelCount = 2
+  };
+
+  static Status WriteDense(const std::string& var, Channel channel = kStreaming);
+  static Status WriteSparse(const std::string& var, const Tensor& data, Channel channel = kStreaming);
+  static Status WriteHash(const std::string& var, const Tensor& data, Channel channel = kStreaming);
+  static Status DelHash(const std::string& var, const std::vector<int64_t>& data, Channel channel = kStreaming);
+  static Status GetDense(std::unordered_map<std::string, DenseLog>* var, Channel channel = kStreaming);
+  static Status GetSparse(std::unordered_map<std::string, SparseLog>* var, Channel channel = kStreaming);
+  static Status GetHash(std::unordered_map<std::string, HashLog>* var, Channel channel = kStreaming);
+
+  // The replica channel only records once a server has replicas to feed.
+  static void EnableReplica() { replica_enabled_ = true; }
+  static bool ReplicaEnabled() { return replica_enabled_; }
  private:
-  struct Logger {
-    std::mutex mu;
+  struct Logs {
     std::unordered_map<std::string, DenseLog> dense;
     std::unordered_map<std::string, SparseLog> sparse;
     std::unordered_map<std::string, HashLog> hash;
-
-    std::unordered_map<std::string, DenseLog> dense_back;
-    std::unordered_map<std::string, SparseLog> sparse_back;
-    std::unordered_map<std::string, HashLog> hash_back;
+  };
+  struct Logger {
+    std::mutex mu;
+    Logs logs[kChannelCount];
+    Logs back[kChannelCount];
   };
   struct LoggerRegister {
     LoggerRegister();
@@ -105,6 +118,7 @@ class StreamingModelUtils {
   static std::mutex mu_;
   static std::unordered_set<Logger*> loggers_;
   static thread_local LoggerRegister logger_;
+  static std::atomic<bool> replica_enabled_;
 };
 
 }
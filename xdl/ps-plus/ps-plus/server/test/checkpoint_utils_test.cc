@@ -17,6 +17,7 @@ limitations under the License.
 
 #define private public
 #include "ps-plus/server/checkpoint_utils.h"
+#include "ps-plus/server/reduced_slot.h"
 #include "ps-plus/scheduler/scheduler_impl.h"
 #include "ps-plus/common/initializer/constant_initializer.h"
 #include <ps-plus/common/logging.h>
@@ -31,6 +32,8 @@ using ps::HashMapImpl;
 using ps::Hash128Key;
 using ps::server::Variable;
 using ps::server::CheckpointUtils;
+using ps::server::ReducedSlot;
+using ps::StoragePrecision;
 using ps::initializer::ConstantInitializer;
 using ps::WrapperData;
 using ps::VariableInfoCollection;
@@ -132,5 +135,391 @@ TEST(CheckpointUtilsTest, CheckpointUtilsTest) {
   EXPECT_EQ(0u, y_reused_ids.size());
 }
 
+TEST(CheckpointUtilsTest, IncrementalCheckpoint) {
+  std::unordered_map<std::string, std::unique_ptr<Variable>> a;
+  std::unordered_map<std::string, std::unique_ptr<Variable>> b;
+  WrapperData<std::unique_ptr<HashMap> >* y_slicer = new WrapperData<std::unique_ptr<HashMap> >(new HashMapImpl<int64_t>(10));
+  a["x"].reset(new Variable(new Tensor(DataType::kFloat, TensorShape({4, 2}), new ConstantInitializer(0)), new WrapperData<size_t>(0), "x"));
+  a["y"].reset(new Variable(new Tensor(DataType::kFloat, TensorShape({4, 2}), new ConstantInitializer(1)), y_slicer, "y"));
+  Tensor* x_slot = a["x"]->GetVariableLikeSlot("slot", DataType::kFloat, []{return new ConstantInitializer(5);});
+  VariableInfoCollection from = {.infos = {
+  VariableInfo {
+    .type = VariableInfo::kIndex,
+    .name = "x",
+    .parts = {VariableInfo::Part{.server = 0, .size = 4}},
+    .shape = {4, 2},
+    .datatype = DataType::kFloat,
+    .args = {{VariableInfo::INCREMENTAL_CHECKPOINT, "2"}}},
+  VariableInfo {
+    .type = VariableInfo::kHash64,
+    .name = "y",
+    .parts = {VariableInfo::Part{.server = 0, .size = 65536}},
+    .shape = {4, 2},
+    .datatype = DataType::kFloat,
+    .args = {{VariableInfo::INCREMENTAL_CHECKPOINT, "2"}}}
+  }};
+  CheckpointUtils ckpt(from);
+  int64_t keys[] = {100, 200, 300};
+  std::vector<size_t> ids;
+  size_t filtered;
+  y_slicer->Internal()->Get(keys, 2, false, 1.0, &ids, nullptr, &filtered);
+  a["y"]->GetData()->Raw<float>(ids[0])[0] = 10;
+  EXPECT_TRUE(ckpt.SaveVariables(0, "memory://inc0", a).IsOk());
+
+  a["x"]->GetDirtyRows().Mark({1});
+  a["x"]->GetData()->Raw<float>()[2] = 11;
+  x_slot->Raw<float>()[3] = 12;
+  a["x"]->GetData()->Raw<float>()[6] = 13;
+  a["y"]->GetDirtyRows().Mark({ids[1]});
+  a["y"]->GetData()->Raw<float>(ids[1])[1] = 14;
+  EXPECT_TRUE(ckpt.SaveVariables(0, "memory://inc1", a).IsOk());
+
+  a["x"]->GetDirtyRows().Mark({2});
+  a["x"]->GetData()->Raw<float>()[4] = 15;
+  y_slicer->Internal()->Get(keys + 2, 1, false, 1.0, &ids, nullptr, &filtered);
+  a["y"]->GetDirtyRows().Mark(ids);
+  a["y"]->GetData()->Raw<float>(ids[0])[0] = 16;
+  EXPECT_TRUE(ckpt.SaveVariables(0, "memory://inc2", a).IsOk());
+
+  std::vector<std::string> chain;
+  size_t rows;
+  a["x"]->GetDirtyRows().GetChain(&chain, &rows);
+  EXPECT_EQ(3u, chain.size());
+  EXPECT_EQ("inc0/x^0", chain[0]);
+  EXPECT_EQ(4u, rows);
+
+  VariableInfoCollection to = from;
+  for (auto& info : to.infos) {
+    info.args[VariableInfo::ORIGIN_FILE_PATH] = "memory://inc2";
+  }
+  EXPECT_TRUE(ckpt.LoadVariables(to, 0, &b).IsOk());
+  Tensor* x = b["x"]->GetData();
+  Tensor* slot = b["x"]->GetVariableLikeSlot("slot", DataType::kFloat, []{return new ConstantInitializer(0);});
+  // row 3 was changed without being marked, the base value is kept
+  float x_expected[] = {0, 0, 11, 0, 15, 0, 0, 0};
+  float slot_expected[] = {5, 5, 5, 12, 5, 5, 5, 5};
+  for (size_t i = 0; i < 8; i++) {
+    EXPECT_EQ(x_expected[i], x->Raw<float>()[i]);
+    EXPECT_EQ(slot_expected[i], slot->Raw<float>()[i]);
+  }
+  std::unique_ptr<HashMap>& y_hashmap = dynamic_cast<WrapperData<std::unique_ptr<HashMap> >*>(b["y"]->GetSlicer())->Internal();
+  EXPECT_EQ(3u, y_hashmap->GetSize());
+  y_hashmap->Get(keys, 3, true, 1.0, &ids, nullptr, &filtered);
+  EXPECT_EQ(10, b["y"]->GetData()->Raw<float>(ids[0])[0]);
+  EXPECT_EQ(14, b["y"]->GetData()->Raw<float>(ids[1])[1]);
+  EXPECT_EQ(16, b["y"]->GetData()->Raw<float>(ids[2])[0]);
+
+  // the chain is full, the next save writes a new base
+  EXPECT_TRUE(ckpt.SaveVariables(0, "memory://inc3", a).IsOk());
+  a["x"]->GetDirtyRows().GetChain(&chain, &rows);
+  EXPECT_EQ(1u, chain.size());
+}
+
+TEST(CheckpointUtilsTest, IncrementalCheckpointMoved) {
+  std::unordered_map<std::string, std::unique_ptr<Variable>> a;
+  std::unordered_map<std::string, std::unique_ptr<Variable>> b;
+  a["x"].reset(new Variable(new Tensor(DataType::kFloat, TensorShape({4, 2}), new ConstantInitializer(0)), new WrapperData<size_t>(0), "x"));
+  VariableInfoCollection from = {.infos = {
+  VariableInfo {
+    .type = VariableInfo::kIndex,
+    .name = "x",
+    .parts = {VariableInfo::Part{.server = 0, .size = 4}},
+    .shape = {4, 2},
+    .datatype = DataType::kFloat,
+    .args = {{VariableInfo::INCREMENTAL_CHECKPOINT, "2"}}}
+  }};
+  CheckpointUtils ckpt(from);
+  a["x"]->GetData()->Raw<float>()[0] = 1;
+  EXPECT_TRUE(ckpt.SaveVariables(0, "memory://run_a/ck0", a).IsOk());
+  a["x"]->GetDirtyRows().Mark({1});
+  a["x"]->GetData()->Raw<float>()[2] = 2;
+  EXPECT_TRUE(ckpt.SaveVariables(0, "memory://run_a/ck1", a).IsOk());
+
+  // the chain follows the checkpoints to another root
+  for (auto dir : {"ck0", "ck1"}) {
+    EXPECT_TRUE(ps::FileSystem::RenameAny(std::string("memory://run_a/") + dir + "/x^0",
+                                          std::string("memory://run_b/") + dir + "/x^0").IsOk());
+  }
+  VariableInfoCollection to = from;
+  to.infos[0].args[VariableInfo::ORIGIN_FILE_PATH] = "memory://run_b/ck1";
+  EXPECT_TRUE(ckpt.LoadVariables(to, 0, &b).IsOk());
+  EXPECT_EQ(1, b["x"]->GetData()->Raw<float>()[0]);
+  EXPECT_EQ(2, b["x"]->GetData()->Raw<float>()[2]);
+
+  // a missing base fails the load
+  b.clear();
+  EXPECT_TRUE(ps::FileSystem::RemoveAny("memory://run_b/ck0/x^0").IsOk());
+  ps::Status st = ckpt.LoadVariables(to, 0, &b);
+  EXPECT_FALSE(st.IsOk());
+  EXPECT_NE(std::string::npos, st.ToString().find("misses memory://run_b/ck0/x^0"));
+}
+
+TEST(CheckpointUtilsTest, CompressedCheckpoint) {
+  std::unordered_map<std::string, std::unique_ptr<Variable>> a;
+  std::unordered_map<std::string, std::unique_ptr<Variable>> b;
+  WrapperData<std::unique_ptr<HashMap> >* y_slicer = new WrapperData<std::unique_ptr<HashMap> >(new HashMapImpl<int64_t>(10));
+  // spans two chunks, the second one only partially
+  a["x"].reset(new Variable(new Tensor(DataType::kFloat, TensorShape({1536, 1024}), new ConstantInitializer(0)), new WrapperData<size_t>(0), "x"));
+  a["y"].reset(new Variable(new Tensor(DataType::kFloat, TensorShape({8, 4}), new ConstantInitializer(2)), y_slicer, "y"));
+  float* x = a["x"]->GetData()->Raw<float>();
+  for (size_t i = 0; i < 1536 * 1024; i++) {
+    x[i] = i % 7;
+  }
+  int64_t keys[] = {100, 200};
+  std::vector<size_t> ids;
+  size_t filtered;
+  y_slicer->Internal()->Get(keys, 2, false, 1.0, &ids, nullptr, &filtered);
+  a["y"]->GetData()->Raw<float>(ids[1])[3] = 42;
+  VariableInfoCollection from = {.infos = {
+  VariableInfo {
+    .type = VariableInfo::kIndex,
+    .name = "x",
+    .parts = {VariableInfo::Part{.server = 0, .size = 1536}},
+    .shape = {1536, 1024},
+    .datatype = DataType::kFloat,
+    .args = {{VariableInfo::CHECKPOINT_COMPRESSION, "lz4"}}},
+  VariableInfo {
+    .type = VariableInfo::kHash64,
+    .name = "y",
+    .parts = {VariableInfo::Part{.server = 0, .size = 32768}, {.server = 1, .size = 32768}},
+    .shape = {8, 4},
+    .datatype = DataType::kFloat,
+    .args = {{VariableInfo::CHECKPOINT_COMPRESSION, "lz4"}}}
+  }};
+  CheckpointUtils ckpt(from);
+  // both parts of y come from the same variable, written as two files
+  EXPECT_TRUE(ckpt.SaveVariables(0, "memory://lz4", a).IsOk());
+  from.infos[1].parts[1].server = 0;
+  from.infos[1].parts[0].server = 1;
+  EXPECT_TRUE(CheckpointUtils(from).SaveVariables(0, "memory://lz4", a).IsOk());
+
+  VariableInfoCollection to = from;
+  for (auto& info : to.infos) {
+    info.args[VariableInfo::ORIGIN_FILE_PATH] = "memory://lz4";
+    info.parts = {VariableInfo::Part{.server = 0, .size = info.name == "x" ? 1536u : 65536u}};
+  }
+  EXPECT_TRUE(ckpt.LoadVariables(to, 0, &b).IsOk());
+  EXPECT_EQ(TensorShape({1536, 1024}), b["x"]->GetData()->Shape());
+  x = b["x"]->GetData()->Raw<float>();
+  size_t mismatch = 0;
+  for (size_t i = 0; i < 1536 * 1024; i++) {
+    mismatch += x[i] != i % 7;
+  }
+  EXPECT_EQ(0u, mismatch);
+  std::unique_ptr<HashMap>& y_hashmap = dynamic_cast<WrapperData<std::unique_ptr<HashMap> >*>(b["y"]->GetSlicer())->Internal();
+  y_hashmap->Get(keys, 2, true, 1.0, &ids, nullptr, &filtered);
+  EXPECT_EQ(2, b["y"]->GetData()->Raw<float>(ids[0])[3]);
+  EXPECT_EQ(42, b["y"]->GetData()->Raw<float>(ids[1])[3]);
+
+  CheckpointUtils::VariableStruct vs;
+  std::unique_ptr<ps::FileSystem::ReadStream> stream;
+  EXPECT_TRUE(ps::FileSystem::OpenReadStreamAny("memory://lz4/x^0", &stream).IsOk());
+  EXPECT_TRUE(CheckpointUtils::LoadVariable("x", stream.get(), &vs).IsOk());
+  EXPECT_EQ(ps::server::CheckpointCodec::kLz4, vs.compression);
+}
+
+TEST(CheckpointUtilsTest, SnapshotCheckpoint) {
+  std::unordered_map<std::string, std::unique_ptr<Variable>> a;
+  std::unordered_map<std::string, std::unique_ptr<Variable>> b;
+  WrapperData<std::unique_ptr<HashMap> >* y_slicer = new WrapperData<std::unique_ptr<HashMap> >(new HashMapImpl<int64_t>(10));
+  a["y"].reset(new Variable(new Tensor(DataType::kFloat, TensorShape({4, 2}), new ConstantInitializer(1)), y_slicer, "y"));
+  VariableInfoCollection from = {.infos = {
+  VariableInfo {
+    .type = VariableInfo::kHash64,
+    .name = "y",
+    .parts = {VariableInfo::Part{.server = 0, .size = 65536}},
+    .shape = {4, 2},
+    .datatype = DataType::kFloat,
+    .args = {}}
+  }};
+  CheckpointUtils ckpt(from);
+  int64_t keys[] = {100, 200, 300};
+  std::vector<size_t> ids;
+  size_t filtered;
+  y_slicer->Internal()->Get(keys, 2, false, 1.0, &ids, nullptr, &filtered);
+
+  CheckpointUtils::SaveSnapshot snapshot;
+  EXPECT_TRUE(ckpt.Snapshot(0, "memory://snapshot", a, &snapshot).IsOk());
+  EXPECT_TRUE(a["y"]->SavePinned());
+  // keys inserted after the snapshot are not written
+  y_slicer->Internal()->Get(keys, 3, false, 1.0, &ids, nullptr, &filtered);
+  EXPECT_TRUE(ckpt.WriteSnapshot(&snapshot).IsOk());
+  EXPECT_FALSE(a["y"]->SavePinned());
+
+  VariableInfoCollection to = from;
+  to.infos[0].args[VariableInfo::ORIGIN_FILE_PATH] = "memory://snapshot";
+  EXPECT_TRUE(ckpt.LoadVariables(to, 0, &b).IsOk());
+  std::unique_ptr<HashMap>& y_hashmap = dynamic_cast<WrapperData<std::unique_ptr<HashMap> >*>(b["y"]->GetSlicer())->Internal();
+  EXPECT_EQ(2u, y_hashmap->GetSize());
+}
+
+TEST(CheckpointUtilsTest, LazyRestore) {
+  std::unordered_map<std::string, std::unique_ptr<Variable>> a;
+  std::unordered_map<std::string, std::unique_ptr<Variable>> b;
+  WrapperData<std::unique_ptr<HashMap> >* y_slicer = new WrapperData<std::unique_ptr<HashMap> >(new HashMapImpl<int64_t>(10));
+  a["y"].reset(new Variable(new Tensor(DataType::kFloat, TensorShape({4, 4}), new ConstantInitializer(0), true, 16), y_slicer, "y"));
+  const size_t kKeys = 100;
+  std::vector<int64_t> keys;
+  for (size_t i = 0; i < kKeys; i++) {
+    keys.push_back(i * 7 + 1);
+  }
+  std::vector<size_t> ids;
+  size_t filtered;
+  int64_t max_id = y_slicer->Internal()->Get(&keys[0], kKeys, false, 1.0, &ids, nullptr, &filtered);
+  EXPECT_TRUE(a["y"]->ReShapeId(max_id).IsOk());
+  Tensor* slot = a["y"]->GetVariableLikeSlot("slot", DataType::kInt16, []{return new ConstantInitializer(0);});
+  for (size_t i = 0; i < kKeys; i++) {
+    a["y"]->GetData()->Raw<float>(ids[i])[2] = keys[i];
+    slot->Raw<int16_t>(ids[i])[0] = keys[i] + 1;
+  }
+  VariableInfoCollection from = {.infos = {
+  VariableInfo {
+    .type = VariableInfo::kHash64,
+    .name = "y",
+    .parts = {VariableInfo::Part{.server = 0, .size = 32768}, {.server = 1, .size = 32768}},
+    .shape = {4, 4},
+    .datatype = DataType::kFloat,
+    .args = {}}
+  }};
+  EXPECT_TRUE(CheckpointUtils(from).SaveVariables(0, "memory://lazy", a).IsOk());
+  from.infos[0].parts[1].server = 0;
+  from.infos[0].parts[0].server = 1;
+  EXPECT_TRUE(CheckpointUtils(from).SaveVariables(0, "memory://lazy", a).IsOk());
+
+  VariableInfoCollection to = from;
+  to.infos[0].args[VariableInfo::ORIGIN_FILE_PATH] = "memory://lazy";
+  to.infos[0].parts = {VariableInfo::Part{.server = 0, .size = 65536}};
+  setenv("PS_LAZY_RESTORE", "1", 1);
+  EXPECT_TRUE(CheckpointUtils(to).LoadVariables(to, 0, &b).IsOk());
+  unsetenv("PS_LAZY_RESTORE");
+  ps::server::LazyRows* lazy_rows = b["y"]->GetLazyRows();
+  ASSERT_TRUE(lazy_rows != nullptr);
+  std::unique_ptr<HashMap>& y_hashmap = dynamic_cast<WrapperData<std::unique_ptr<HashMap> >*>(b["y"]->GetSlicer())->Internal();
+  EXPECT_EQ(kKeys, y_hashmap->GetSize());
+  y_hashmap->Get(&keys[0], kKeys, true, 1.0, &ids, nullptr, &filtered);
+  Tensor* y_slot = b["y"]->GetVariableLikeSlot("slot", DataType::kInt16, []{return new ConstantInitializer(0);});
+  std::vector<size_t> some(ids.begin(), ids.begin() + 10);
+  EXPECT_TRUE(lazy_rows->Ensure(some).IsOk());
+  for (size_t i = 0; i < some.size(); i++) {
+    EXPECT_EQ(keys[i], b["y"]->GetData()->Raw<float>(ids[i])[2]);
+    EXPECT_EQ(keys[i] + 1, y_slot->Raw<int16_t>(ids[i])[0]);
+  }
+  EXPECT_TRUE(lazy_rows->EnsureAll().IsOk());
+  EXPECT_TRUE(lazy_rows->Done());
+  size_t mismatch = 0;
+  for (size_t i = 0; i < kKeys; i++) {
+    mismatch += b["y"]->GetData()->Raw<float>(ids[i])[2] != keys[i];
+    mismatch += y_slot->Raw<int16_t>(ids[i])[0] != keys[i] + 1;
+  }
+  EXPECT_EQ(0u, mismatch);
+}
+
+TEST(CheckpointUtilsTest, InterleavedRows) {
+  std::unordered_map<std::string, std::unique_ptr<Variable>> a;
+  std::unordered_map<std::string, std::unique_ptr<Variable>> b;
+  WrapperData<std::unique_ptr<HashMap> >* y_slicer = new WrapperData<std::unique_ptr<HashMap> >(new HashMapImpl<int64_t>(10));
+  a["y"].reset(new Variable(new Tensor(DataType::kFloat, TensorShape({4, 4}), new ConstantInitializer(0), true, 16, 32), y_slicer, "y"));
+  Tensor* slot = a["y"]->GetVariableLikeSlot("slot", DataType::kDouble, []{return new ConstantInitializer(5);});
+  EXPECT_TRUE(slot->Interleaved());
+  const size_t kKeys = 40;
+  std::vector<int64_t> keys;
+  for (size_t i = 0; i < kKeys; i++) {
+    keys.push_back(i * 3 + 1);
+  }
+  std::vector<size_t> ids;
+  size_t filtered;
+  int64_t max_id = y_slicer->Internal()->Get(&keys[0], kKeys, false, 1.0, &ids, nullptr, &filtered);
+  EXPECT_TRUE(a["y"]->ReShapeId(max_id).IsOk());
+  for (size_t i = 0; i < kKeys; i++) {
+    a["y"]->GetData()->Raw<float>(ids[i])[1] = keys[i];
+    slot->Raw<double>(ids[i])[3] = keys[i] + 1;
+  }
+  VariableInfoCollection from = {.infos = {
+  VariableInfo {
+    .type = VariableInfo::kHash64,
+    .name = "y",
+    .parts = {VariableInfo::Part{.server = 0, .size = 65536}},
+    .shape = {4, 4},
+    .datatype = DataType::kFloat,
+    .args = {{"row_interleave_bytes", "32"}, {VariableInfo::CHECKPOINT_COMPRESSION, "lz4"}}}
+  }};
+  EXPECT_TRUE(CheckpointUtils(from).SaveVariables(0, "memory://interleaved", a).IsOk());
+
+  VariableInfoCollection to = from;
+  to.infos[0].args[VariableInfo::ORIGIN_FILE_PATH] = "memory://interleaved";
+  EXPECT_TRUE(CheckpointUtils(to).LoadVariables(to, 0, &b).IsOk());
+  std::unique_ptr<HashMap>& y_hashmap = dynamic_cast<WrapperData<std::unique_ptr<HashMap> >*>(b["y"]->GetSlicer())->Internal();
+  y_hashmap->Get(&keys[0], kKeys, true, 1.0, &ids, nullptr, &filtered);
+  Tensor* y_slot = b["y"]->GetVariableLikeSlot("slot", DataType::kDouble, []{return new ConstantInitializer(0);});
+  EXPECT_TRUE(b["y"]->GetData()->Interleaved());
+  EXPECT_TRUE(y_slot->Interleaved());
+  size_t mismatch = 0;
+  for (size_t i = 0; i < kKeys; i++) {
+    mismatch += b["y"]->GetData()->Raw<float>(ids[i])[1] != keys[i];
+    mismatch += y_slot->Raw<double>(ids[i])[3] != keys[i] + 1;
+    mismatch += y_slot->Raw<double>(ids[i])[0] != 5;
+  }
+  EXPECT_EQ(0u, mismatch);
+}
+
+TEST(CheckpointUtilsTest, ReducedSlotRestore) {
+  std::unordered_map<std::string, std::unique_ptr<Variable>> a;
+  std::unordered_map<std::string, std::unique_ptr<Variable>> b;
+  a["x"].reset(new Variable(new Tensor(DataType::kFloat, TensorShape({4, 8}), new ConstantInitializer(0)), new WrapperData<size_t>(10), "x"));
+  Variable* x = a["x"].get();
+  ReducedSlot slot;
+  x->SetSlotPrecision(StoragePrecision::kInt8);
+  EXPECT_TRUE(slot.Init(x, "int8", DataType::kFloat, 3).IsOk());
+  EXPECT_TRUE(slot.Encoded());
+  x->SetSlotPrecision(StoragePrecision::kBf16);
+  EXPECT_TRUE(slot.Init(x, "bf16", DataType::kFloat, 3).IsOk());
+  EXPECT_TRUE(slot.Encoded());
+  x->SetSlotPrecision(StoragePrecision::kFloat);
+  EXPECT_TRUE(slot.Init(x, "fp32", DataType::kFloat, 3).IsOk());
+  EXPECT_FALSE(slot.Encoded());
+  VariableInfoCollection from = {.infos = {
+  VariableInfo {
+    .type = VariableInfo::kIndex,
+    .name = "x",
+    .parts = {VariableInfo::Part{.server = 0, .size = 4}},
+    .shape = {4, 8},
+    .datatype = DataType::kFloat,
+    .args = {}}
+  }};
+  EXPECT_TRUE(CheckpointUtils(from).SaveVariables(0, "memory://reduced_slot", a).IsOk());
+
+  VariableInfoCollection to = from;
+  to.infos[0].args[VariableInfo::ORIGIN_FILE_PATH] = "memory://reduced_slot";
+  EXPECT_TRUE(CheckpointUtils(to).LoadVariables(to, 0, &b).IsOk());
+  Variable* y = b["x"].get();
+
+  // the rows of an int8 slot are shorter than the ones of fp16 and fp32
+  y->SetSlotPrecision(StoragePrecision::kFp16);
+  ps::Status st = slot.Init(y, "int8", DataType::kFloat, 0);
+  EXPECT_FALSE(st.IsOk());
+  EXPECT_EQ("Variable[x] slot[int8] is stored in int8, not in fp16", st.Msg());
+  y->SetSlotPrecision(StoragePrecision::kFloat);
+  EXPECT_FALSE(slot.Init(y, "int8", DataType::kFloat, 0).IsOk());
+  y->SetSlotPrecision(StoragePrecision::kInt8);
+  EXPECT_TRUE(slot.Init(y, "int8", DataType::kFloat, 0).IsOk());
+  EXPECT_TRUE(slot.Encoded());
+  float row[8];
+  ps::DecodeRow(StoragePrecision::kInt8, slot.GetTensor()->Raw<char>(3), 8, row);
+  EXPECT_FLOAT_EQ(3, row[7]);
+
+  // fp16 and bf16 rows are both int16
+  y->SetSlotPrecision(StoragePrecision::kFp16);
+  EXPECT_FALSE(slot.Init(y, "bf16", DataType::kFloat, 0).IsOk());
+  y->SetSlotPrecision(StoragePrecision::kBf16);
+  EXPECT_TRUE(slot.Init(y, "bf16", DataType::kFloat, 0).IsOk());
+
+  // a full precision slot is used as is, but only with its own type
+  y->SetSlotPrecision(StoragePrecision::kFp16);
+  EXPECT_TRUE(slot.Init(y, "fp32", DataType::kFloat, 0).IsOk());
+  EXPECT_FALSE(slot.Encoded());
+  EXPECT_EQ(3, slot.GetTensor()->Raw<float>(2)[5]);
+  EXPECT_FALSE(slot.Init(y, "fp32", DataType::kDouble, 0).IsOk());
+}
+
 TEST(CheckpointUtilsTest, CheckpointUtilsDebug) {
 }
@@ -0,0 +1,85 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "ps-plus/server/hash_evictor.h"
+#include "ps-plus/common/hashmap.h"
+
+using ps::HashMap;
+using ps::HashMapImpl;
+using ps::server::HashEvictor;
+
+namespace {
+
+std::vector<size_t> Pull(HashMap* hashmap, HashEvictor* evictor, std::vector<int64_t> keys) {
+  std::vector<size_t> ids;
+  tbb::concurrent_vector<size_t> reused_ids;
+  size_t filtered;
+  hashmap->Get(keys.data(), keys.size(), false, 1.0, &ids, &reused_ids, &filtered);
+  evictor->Touch(ids);
+  evictor->Step();
+  return ids;
+}
+
+}
+
+TEST(HashEvictorTest, EvictIdle) {
+  std::unique_ptr<HashMap> hashmap(new HashMapImpl<int64_t>(10));
+  HashEvictor evictor(2, 0, 1, 2, 10);
+  std::vector<size_t> ids = Pull(hashmap.get(), &evictor, {1, 2, 3});
+  for (int i = 0; i < 3; i++) {
+    Pull(hashmap.get(), &evictor, {1});
+  }
+  // the scan visits two rows at a time
+  std::vector<size_t> picked;
+  EXPECT_TRUE(evictor.Scan(hashmap->GetSize(), &picked));
+  EXPECT_TRUE(evictor.Scan(hashmap->GetSize(), &picked));
+  std::sort(picked.begin(), picked.end());
+  std::vector<size_t> expect = {ids[1], ids[2]};
+  std::sort(expect.begin(), expect.end());
+  EXPECT_EQ(expect, picked);
+
+  // key 2 is pulled again before the rows are erased
+  Pull(hashmap.get(), &evictor, {2});
+  std::vector<size_t> erased;
+  EXPECT_EQ(1u, evictor.Evict(hashmap.get(), picked, &erased));
+  EXPECT_EQ(std::vector<size_t>({ids[2]}), erased);
+  EXPECT_EQ(1u, evictor.Evicted());
+  EXPECT_TRUE(hashmap->TrackingKeys());
+
+  // the freed row goes to the next new key
+  std::vector<size_t> new_ids = Pull(hashmap.get(), &evictor, {4});
+  EXPECT_EQ(ids[2], new_ids[0]);
+}
+
+TEST(HashEvictorTest, KeepCount) {
+  std::unique_ptr<HashMap> hashmap(new HashMapImpl<int64_t>(10));
+  HashEvictor evictor(1, 4, 1, 10, 10);
+  std::vector<size_t> ids;
+  for (int i = 0; i < 4; i++) {
+    ids = Pull(hashmap.get(), &evictor, {1, 2});
+  }
+  for (int i = 0; i < 2; i++) {
+    Pull(hashmap.get(), &evictor, {3});
+  }
+  Pull(hashmap.get(), &evictor, {2, 3});
+  // key 1 is idle, but was pulled 4 times since the last visit
+  std::vector<size_t> picked;
+  EXPECT_TRUE(evictor.Scan(3, &picked));
+  EXPECT_TRUE(picked.empty());
+  // the visit halved the count
+  EXPECT_TRUE(evictor.Scan(3, &picked));
+  EXPECT_EQ(std::vector<size_t>({ids[0]}), picked);
+}
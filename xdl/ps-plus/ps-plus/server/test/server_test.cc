@@ -19,6 +19,7 @@ limitations under the License.
 #include "ps-plus/server/local_server.h"
 #include "ps-plus/message/variable_info.h"
 #include "ps-plus/common/initializer/constant_initializer.h"
+#include "ps-plus/common/hashmap.h"
 
 using ps::server::UdfContext;
 using ps::server::Udf;
@@ -40,6 +41,15 @@ using ps::kUnusedVersion;
 using ps::VariableInfoCollection;
 using ps::DenseVarNames;
 using ps::DenseVarValues;
+using ps::ReplicaDelta;
+using ps::ServerLoad;
+using ps::ServerStats;
+using ps::ClusterStats;
+using ps::Version;
+using ps::HashMap;
+using ps::HashMapImpl;
+using ps::Hash128Key;
+using ps::server::StreamingModelUtils;
 
 namespace {
 
@@ -146,6 +156,223 @@ TEST(ServerTest, ServerTest) {
   EXPECT_EQ(40, dynamic_cast<WrapperData<int>*>(ctx2.Outputs()[0])->Internal());
 }
 
+TEST(ServerTest, GetLoad) {
+  StreamingModelArgs args;
+  Server server(0, args);
+  VariableInfoCollection from, to;
+  EXPECT_TRUE(server.Restore(7, from, to).IsOk());
+  EXPECT_TRUE(server.RegisterUdfChain(7, BuildUdfChainRegister()).IsOk());
+  UdfContext ctx1;
+  EXPECT_TRUE(server.RunUdfChain(7, 100, "^var", Inputs(), &ctx1).IsOk());
+  ctx1.GetStorageManager()->Set("var", []{ return new Variable(new Tensor(DataType::kInt8, TensorShape({4, 8}), new ConstantInitializer(1)), nullptr, "");});
+
+  // the first report only starts the window
+  ServerLoad load;
+  EXPECT_TRUE(server.GetLoad(7, &load).IsOk());
+  EXPECT_EQ(0u, load.window_micros);
+  ASSERT_EQ(1u, load.variables.size());
+  EXPECT_EQ(0u, load.variables[0].requests);
+
+  UdfContext ctx2, ctx3;
+  EXPECT_TRUE(server.RunUdfChain(7, 100, "var", Inputs(), &ctx2).IsOk());
+  EXPECT_TRUE(server.RunUdfChain(7, 100, "var", Inputs(), &ctx3).IsOk());
+  ServerLoad load2;
+  EXPECT_TRUE(server.GetLoad(7, &load2).IsOk());
+  ASSERT_EQ(1u, load2.variables.size());
+  EXPECT_EQ("var", load2.variables[0].name);
+  EXPECT_EQ(2u, load2.variables[0].requests);
+
+  ServerLoad load3;
+  EXPECT_TRUE(server.GetLoad(7, &load3).IsOk());
+  EXPECT_EQ(0u, load3.variables[0].requests);
+  EXPECT_FALSE(server.GetLoad(8, &load3).IsOk());
+}
+
+TEST(ServerTest, BumpVersion) {
+  StreamingModelArgs args;
+  Server server(0, args);
+  VariableInfoCollection from, to;
+  EXPECT_TRUE(server.Restore(7, from, to).IsOk());
+  EXPECT_TRUE(server.RegisterUdfChain(7, BuildUdfChainRegister()).IsOk());
+  UdfContext ctx1;
+  EXPECT_TRUE(server.RunUdfChain(7, 100, "^var", Inputs(), &ctx1).IsOk());
+  ctx1.GetStorageManager()->Set("var", []{ return new Variable(new Tensor(DataType::kInt8, TensorShape({4, 8}), new ConstantInitializer(1)), nullptr, "");});
+
+  EXPECT_FALSE(server.BumpVersion(8, 9).IsOk());
+  EXPECT_TRUE(server.BumpVersion(7, 9).IsOk());
+  UdfContext ctx2, ctx3;
+  EXPECT_FALSE(server.RunUdfChain(7, 100, "var", Inputs(), &ctx2).IsOk());
+  // the rows stay, only the version moves
+  EXPECT_TRUE(server.RunUdfChain(9, 100, "var", Inputs(), &ctx3).IsOk());
+}
+
+TEST(ServerTest, GetStats) {
+  StreamingModelArgs args;
+  Server server(3, args);
+  VariableInfoCollection from, to;
+  EXPECT_TRUE(server.Restore(7, from, to).IsOk());
+  EXPECT_TRUE(server.RegisterUdfChain(7, BuildUdfChainRegister()).IsOk());
+  UdfContext ctx;
+  EXPECT_TRUE(server.RunUdfChain(7, 100, "^var", Inputs(), &ctx).IsOk());
+  ctx.GetStorageManager()->Set("dense", []{
+    return new Variable(new Tensor(DataType::kFloat, TensorShape({4, 2}), new ConstantInitializer(0)), new WrapperData<size_t>(0), "dense");
+  });
+  ctx.GetStorageManager()->Set("hash", []{
+    return new Variable(new Tensor(DataType::kFloat, TensorShape({4, 2}), new ConstantInitializer(0), true, 2),
+                        new WrapperData<std::unique_ptr<HashMap> >(new HashMapImpl<Hash128Key>(10)), "hash");
+  });
+  Variable *dense, *hash;
+  EXPECT_TRUE(ctx.GetStorageManager()->Get("dense", &dense).IsOk());
+  EXPECT_TRUE(ctx.GetStorageManager()->Get("hash", &hash).IsOk());
+  dense->GetSlot("acc", [&]{ return dense->VariableLikeSlot(DataType::kDouble, TensorShape({4, 2}), new ConstantInitializer(0)); });
+  dense->AddTraffic(false, 4);
+  dense->AddTraffic(true, 2);
+  std::unique_ptr<HashMap>& hashmap = dynamic_cast<WrapperData<std::unique_ptr<HashMap> >*>(hash->GetSlicer())->Internal();
+  int64_t keys[] = {1, 2, 3, 4, 5, 6};
+  std::vector<size_t> ids;
+  tbb::concurrent_vector<size_t> reused;
+  size_t filtered;
+  hashmap->Get(keys, 3, false, 1.0, &ids, &reused, &filtered);
+  hash->AddTraffic(false, 3);
+
+  ServerStats stats;
+  EXPECT_FALSE(server.GetStats(8, &stats).IsOk());
+  EXPECT_TRUE(server.GetStats(7, &stats).IsOk());
+  EXPECT_EQ(3u, stats.server_id);
+  ASSERT_EQ(2u, stats.variables.size());
+  for (auto& item : stats.variables) {
+    if (item.name == "dense") {
+      EXPECT_EQ(4u, item.rows);
+      EXPECT_EQ(32u, item.data_bytes);
+      EXPECT_EQ(0u, item.hashmap_bytes);
+      ASSERT_EQ(1u, item.slot_names.size());
+      EXPECT_EQ("acc", item.slot_names[0]);
+      EXPECT_EQ(64u, item.slot_bytes[0]);
+      EXPECT_EQ(96u, item.TotalBytes());
+      EXPECT_EQ(4u, item.pull_rows);
+      EXPECT_EQ(32u, item.pull_bytes);
+      EXPECT_EQ(2u, item.push_rows);
+      EXPECT_EQ(16u, item.push_bytes);
+    } else {
+      EXPECT_EQ("hash", item.name);
+      EXPECT_EQ(3u, item.rows);
+      EXPECT_LE(24u, item.data_bytes);
+      EXPECT_LT(0u, item.hashmap_bytes);
+      EXPECT_EQ(3u, item.pull_rows);
+      EXPECT_EQ(24u, item.pull_bytes);
+      EXPECT_EQ(0u, item.push_rows);
+    }
+  }
+
+  // the counters are not reset by a report
+  ServerStats stats2;
+  EXPECT_TRUE(server.GetStats(7, &stats2).IsOk());
+  for (auto& item : stats2.variables) {
+    if (item.name == "dense") {
+      EXPECT_EQ(4u, item.pull_rows);
+    }
+  }
+
+  ClusterStats cluster;
+  cluster.servers.push_back(stats);
+  cluster.servers.push_back(stats2);
+  cluster.servers[1].server_id = 4;
+  cluster.Aggregate();
+  ASSERT_EQ(2u, cluster.variables.size());
+  EXPECT_EQ("dense", cluster.variables[0].name);
+  EXPECT_EQ(8u, cluster.variables[0].rows);
+  EXPECT_EQ(8u, cluster.variables[0].pull_rows);
+  ASSERT_EQ(1u, cluster.variables[0].slot_bytes.size());
+  EXPECT_EQ(128u, cluster.variables[0].slot_bytes[0]);
+  EXPECT_EQ("hash", cluster.variables[1].name);
+  EXPECT_EQ(6u, cluster.variables[1].rows);
+}
+
+TEST(ServerTest, ReplicaDelta) {
+  StreamingModelArgs args;
+  Server primary(0, args);
+  Server replica(0, args);
+  VariableInfoCollection from, to;
+  EXPECT_TRUE(primary.Restore(5, from, to).IsOk());
+  EXPECT_TRUE(replica.Restore(5, from, to).IsOk());
+
+  // the storage managers are reached through a udf context
+  UdfContext pctx, rctx;
+  EXPECT_TRUE(primary.RegisterUdfChain(5, BuildUdfChainRegister()).IsOk());
+  EXPECT_TRUE(replica.RegisterUdfChain(5, BuildUdfChainRegister()).IsOk());
+  EXPECT_TRUE(primary.RunUdfChain(5, 100, "^var", Inputs(), &pctx).IsOk());
+  EXPECT_TRUE(replica.RunUdfChain(5, 100, "^var", Inputs(), &rctx).IsOk());
+  for (int i = 0; i < 2; i++) {
+    UdfContext* ctx = i == 0 ? &pctx : &rctx;
+    ctx->GetStorageManager()->Set("dense", [i]{
+      return new Variable(new Tensor(DataType::kFloat, TensorShape({4, 2}), new ConstantInitializer(i == 0 ? 3 : 0)), new WrapperData<size_t>(0), "dense");
+    });
+    ctx->GetStorageManager()->Set("index", [i]{
+      return new Variable(new Tensor(DataType::kFloat, TensorShape({4, 2}), new ConstantInitializer(i == 0 ? 4 : 0)), new WrapperData<size_t>(10), "index");
+    });
+    ctx->GetStorageManager()->Set("hash", []{
+      return new Variable(new Tensor(DataType::kFloat, TensorShape({4, 2}), new ConstantInitializer(0), true, 2),
+                          new WrapperData<std::unique_ptr<HashMap> >(new HashMapImpl<Hash128Key>(10)), "hash");
+    });
+  }
+  Variable* hash;
+  EXPECT_TRUE(pctx.GetStorageManager()->Get("hash", &hash).IsOk());
+  std::unique_ptr<HashMap>& hashmap = dynamic_cast<WrapperData<std::unique_ptr<HashMap> >*>(hash->GetSlicer())->Internal();
+  int64_t keys[] = {1, 2, 3, 4, 5, 6};
+  std::vector<size_t> ids;
+  tbb::concurrent_vector<size_t> reused;
+  size_t filtered;
+  hashmap->Get(keys, 3, false, 1.0, &ids, &reused, &filtered);
+  for (size_t i = 0; i < 3; i++) {
+    hash->GetData()->Raw<float>(ids[i])[0] = 10 + i;
+    hash->GetData()->Raw<float>(ids[i])[1] = 20 + i;
+  }
+
+  StreamingModelUtils::EnableReplica();
+  Tensor written(DataType::kInt64, TensorShape({2, 2}), new ConstantInitializer(0));
+  written.Raw<int64_t>()[0] = 1;
+  written.Raw<int64_t>()[1] = 2;
+  written.Raw<int64_t>()[2] = 5;
+  written.Raw<int64_t>()[3] = 6;
+  EXPECT_TRUE(StreamingModelUtils::WriteHash("hash", written, StreamingModelUtils::kReplica).IsOk());
+  EXPECT_TRUE(StreamingModelUtils::WriteDense("dense", StreamingModelUtils::kReplica).IsOk());
+  Tensor index_ids(DataType::kInt64, TensorShape({1}), new ConstantInitializer(12));
+  EXPECT_TRUE(StreamingModelUtils::WriteSparse("index", index_ids, StreamingModelUtils::kReplica).IsOk());
+
+  Version ver;
+  ReplicaDelta delta;
+  EXPECT_TRUE(primary.CollectReplicaDelta(&ver, &delta).IsOk());
+  EXPECT_EQ(5, ver);
+  ASSERT_EQ(3u, delta.updates.size());
+  EXPECT_FALSE(replica.ApplyReplicaDelta(6, delta).IsOk());
+  EXPECT_TRUE(replica.ApplyReplicaDelta(ver, delta).IsOk());
+
+  Variable* dense;
+  EXPECT_TRUE(rctx.GetStorageManager()->Get("dense", &dense).IsOk());
+  for (size_t i = 0; i < 8; i++) {
+    EXPECT_EQ(3, dense->GetData()->Raw<float>()[i]);
+  }
+  Variable* index;
+  EXPECT_TRUE(rctx.GetStorageManager()->Get("index", &index).IsOk());
+  for (size_t i = 0; i < 8; i++) {
+    EXPECT_EQ(i / 2 == 2 ? 4 : 0, index->GetData()->Raw<float>()[i]);
+  }
+  Variable* replica_hash;
+  EXPECT_TRUE(rctx.GetStorageManager()->Get("hash", &replica_hash).IsOk());
+  std::unique_ptr<HashMap>& replica_hashmap = dynamic_cast<WrapperData<std::unique_ptr<HashMap> >*>(replica_hash->GetSlicer())->Internal();
+  std::vector<size_t> replica_ids(3, HashMap::NOT_ADD_ID);
+  replica_hashmap->Get(keys, 3, true, 1.0, &replica_ids, &reused, &filtered);
+  EXPECT_EQ(HashMap::NOT_ADD_ID, replica_ids[1]);
+  EXPECT_EQ(10, replica_hash->GetData()->Raw<float>(replica_ids[0])[0]);
+  EXPECT_EQ(20, replica_hash->GetData()->Raw<float>(replica_ids[0])[1]);
+  EXPECT_EQ(12, replica_hash->GetData()->Raw<float>(replica_ids[2])[0]);
+  EXPECT_EQ(22, replica_hash->GetData()->Raw<float>(replica_ids[2])[1]);
+
+  ReplicaDelta empty;
+  EXPECT_TRUE(primary.CollectReplicaDelta(&ver, &empty).IsOk());
+  EXPECT_EQ(0u, empty.updates.size());
+}
+
 TEST(LocalServerTest, LocalServer) {
   std::unique_ptr<LocalServer> svr(new LocalServer("./"));
   EXPECT_NE(svr, nullptr);
@@ -0,0 +1,142 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "ps-plus/server/streaming_model_export.h"
+#include "ps-plus/common/file_system.h"
+#include "ps-plus/common/initializer/constant_initializer.h"
+
+#include <cstring>
+
+using ps::DataType;
+using ps::FileSystem;
+using ps::Status;
+using ps::StoragePrecision;
+using ps::StreamingModelManager;
+using ps::StreamingModelWriter;
+using ps::Tensor;
+using ps::TensorShape;
+using ps::initializer::ConstantInitializer;
+using ps::server::StreamingFileWriter;
+
+namespace {
+
+struct Header {
+  uint32_t format;
+  uint32_t key_kind;
+  int32_t precision;
+  int32_t type;
+  uint64_t row_elements;
+  uint64_t row_bytes;
+  uint64_t rows;
+  uint64_t deletes;
+};
+
+std::string ReadFile(const std::string& name, Header* header) {
+  std::unique_ptr<FileSystem::ReadStream> stream;
+  EXPECT_TRUE(FileSystem::OpenReadStreamAny(name, &stream).IsOk()) << name;
+  std::string content;
+  char buf[4096];
+  int64_t size;
+  while ((size = stream->ReadSimple(buf, sizeof(buf))) > 0) {
+    content.append(buf, size);
+  }
+  if (content.size() < 4 + sizeof(Header)) {
+    ADD_FAILURE() << name << " is too short";
+    return "";
+  }
+  EXPECT_EQ("PSSM", content.substr(0, 4));
+  memcpy(header, content.data() + 4, sizeof(Header));
+  return content.substr(4 + sizeof(Header));
+}
+
+Tensor Rows(size_t rows) {
+  Tensor data(DataType::kFloat, TensorShape({rows, 2}), new ConstantInitializer(0));
+  for (size_t i = 0; i < rows * 2; i++) {
+    data.Raw<float>()[i] = i;
+  }
+  return data;
+}
+
+}
+
+TEST(StreamingModelExportTest, CompactHash) {
+  std::unique_ptr<StreamingModelWriter> writer;
+  ASSERT_TRUE(StreamingModelManager::OpenWriterAny("stream_file://memory://compact?compact_triggers=2", &writer).IsOk());
+  Tensor data = Rows(4);
+  StreamingModelWriter::HashModel first;
+  first.name = "emb/hash";
+  first.data = data;
+  first.ids = {{1, 1}, {2, 2}, {3, 3}};
+  first.offsets = {0, 1, 2};
+  ASSERT_TRUE(writer->WriteHashModel({first}, "v1", 3).IsOk());
+  StreamingModelWriter::HashModel second;
+  second.name = "emb/hash";
+  second.data = data;
+  second.ids = {{1, 1}};
+  second.offsets = {3};
+  second.del_ids = {{2, 2}, {9, 9}};
+  ASSERT_TRUE(writer->WriteHashModel({second}, "v2", 3).IsOk());
+
+  Header header;
+  std::string body = ReadFile("memory://compact/v2/hash/emb_hash.3", &header);
+  EXPECT_EQ(StreamingFileWriter::kFormat, header.format);
+  EXPECT_EQ(StreamingFileWriter::kHash128Key, header.key_kind);
+  EXPECT_EQ(2u, header.row_elements);
+  EXPECT_EQ(8u, header.row_bytes);
+  ASSERT_EQ(2u, header.rows);
+  ASSERT_EQ(2u, header.deletes);
+  ASSERT_EQ(2 * 16 + 2 * 8 + 2 * 16, body.size());
+  const int64_t* keys = (const int64_t*)body.data();
+  const float* rows = (const float*)(body.data() + 2 * 16);
+  // the second write of key 1 wins, key 2 is deleted
+  for (size_t i = 0; i < 2; i++) {
+    if (keys[2 * i] == 1) {
+      EXPECT_EQ(6, rows[2 * i]);
+      EXPECT_EQ(7, rows[2 * i + 1]);
+    } else {
+      EXPECT_EQ(3, keys[2 * i]);
+      EXPECT_EQ(4, rows[2 * i]);
+    }
+  }
+  std::unique_ptr<FileSystem::ReadStream> done;
+  EXPECT_TRUE(FileSystem::OpenReadStreamAny("memory://compact/v2/hash/_DONE.3", &done).IsOk());
+}
+
+TEST(StreamingModelExportTest, SparsePrecision) {
+  StreamingFileWriter writer("memory://precision", 1, StoragePrecision::kInt8);
+  StreamingModelWriter::SparseModel model;
+  model.name = "emb";
+  model.data = Rows(2);
+  model.ids = {100, 101};
+  model.offsets = {0, 1};
+  ASSERT_TRUE(writer.WriteSparseModel({model}, "v1", 0).IsOk());
+  Header header;
+  std::string body = ReadFile("memory://precision/v1/sparse/emb.0", &header);
+  EXPECT_EQ((int32_t)StoragePrecision::kInt8, header.precision);
+  EXPECT_EQ(ps::EncodedRowBytes(StoragePrecision::kInt8, 2), header.row_bytes);
+  ASSERT_EQ(2u, header.rows);
+  ASSERT_EQ(2 * 8 + 2 * header.row_bytes, body.size());
+  std::vector<float> row(2);
+  ps::DecodeRow(StoragePrecision::kInt8, body.data() + 2 * 8 + header.row_bytes, 2, row.data());
+  EXPECT_NEAR(2, row[0], 0.05);
+  EXPECT_NEAR(3, row[1], 0.05);
+}
+
+TEST(StreamingModelExportTest, BadOption) {
+  std::unique_ptr<StreamingModelWriter> writer;
+  EXPECT_FALSE(StreamingModelManager::OpenWriterAny("stream_file://memory://x?precision=int4", &writer).IsOk());
+  EXPECT_FALSE(StreamingModelManager::OpenWriterAny("stream_file://memory://x?unknown=1", &writer).IsOk());
+}
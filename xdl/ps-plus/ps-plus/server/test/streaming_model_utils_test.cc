@@ -95,3 +95,30 @@ TEST(StreamingModelUtilsTest, StreamingModelUtilsTest) {
   }
 }
 
+
+TEST(StreamingModelUtilsTest, ReplicaChannel) {
+  Tensor x(DataType::kInt64, TensorShape({2, 2}), new ConstantInitializer(7));
+  EXPECT_TRUE(StreamingModelUtils::WriteHash("hash", x, StreamingModelUtils::kReplica).IsOk());
+  EXPECT_TRUE(StreamingModelUtils::WriteDense("dense", StreamingModelUtils::kReplica).IsOk());
+  EXPECT_TRUE(StreamingModelUtils::WriteDense("both").IsOk());
+  EXPECT_TRUE(StreamingModelUtils::WriteDense("both", StreamingModelUtils::kReplica).IsOk());
+
+  std::unordered_map<std::string, StreamingModelUtils::DenseLog> dense;
+  std::unordered_map<std::string, StreamingModelUtils::HashLog> hash;
+  EXPECT_TRUE(StreamingModelUtils::GetDense(&dense).IsOk());
+  EXPECT_TRUE(StreamingModelUtils::GetHash(&hash).IsOk());
+  EXPECT_EQ(1u, dense.size());
+  EXPECT_EQ(1u, dense.count("both"));
+  EXPECT_EQ(0u, hash.size());
+
+  EXPECT_TRUE(StreamingModelUtils::GetDense(&dense, StreamingModelUtils::kReplica).IsOk());
+  EXPECT_TRUE(StreamingModelUtils::GetHash(&hash, StreamingModelUtils::kReplica).IsOk());
+  EXPECT_EQ(2u, dense.size());
+  EXPECT_EQ(1u, dense.count("dense"));
+  EXPECT_EQ(1u, dense.count("both"));
+  EXPECT_EQ(1u, hash.size());
+  EXPECT_EQ(1u, hash["hash"].write_ids.size());
+
+  EXPECT_TRUE(StreamingModelUtils::GetDense(&dense, StreamingModelUtils::kReplica).IsOk());
+  EXPECT_EQ(0u, dense.size());
+}
@@ -16,6 +16,7 @@ limitations under the License.
 #include "gtest/gtest.h"
 #include "ps-plus/common/data.h"
 #include "ps-plus/server/udf_manager.h"
+#include "ps-plus/server/udf/fused_udf.h"
 
 using ps::server::UdfContext;
 using ps::server::Udf;
@@ -24,6 +25,7 @@ using ps::server::UdfChainManager;
 using ps::UdfChainRegister;
 using ps::Status;
 using ps::Data;
+using ps::WrapperData;
 
 namespace {
 
@@ -87,9 +89,56 @@ void AddInputs(UdfContext* ctx) {
   ctx->SetData(3, new MockUdfData(4), true);
 }
 
+class UdfManagerTest_Add : public ps::server::udf::SimpleUdf<int, int, int*> {
+ public:
+  virtual Status SimpleRun(UdfContext* ctx, const int& x, const int& y, int* z) const {
+    *z = x + y;
+    return Status::Ok();
+  }
+};
+
+class UdfManagerTest_Mul : public ps::server::udf::SimpleUdf<int, int, int*> {
+ public:
+  virtual Status SimpleRun(UdfContext* ctx, const int& x, const int& y, int* z) const {
+    *z = x * y;
+    return Status::Ok();
+  }
+};
+
+// Mul(Add(x, y), z), Add(x, y) is an output too if add_output
+UdfChainRegister BuildFusedUdfChainRegister(bool add_output) {
+  UdfChainRegister def;
+  def.hash = 0;
+  UdfChainRegister::UdfDef s0, s1, s2;
+  s0.udf_name = "";
+  s1.udf_name = "UdfManagerTest_Add";
+  s1.inputs.emplace_back(0, 0);
+  s1.inputs.emplace_back(0, 1);
+  s2.udf_name = "UdfManagerTest_Mul";
+  s2.inputs.emplace_back(1, 0);
+  s2.inputs.emplace_back(0, 2);
+  def.udfs.push_back(s0);
+  def.udfs.push_back(s1);
+  def.udfs.push_back(s2);
+  def.outputs.emplace_back(2, 0);
+  if (add_output) {
+    def.outputs.emplace_back(1, 0);
+  }
+  return def;
+}
+
+void AddFusedInputs(UdfContext* ctx) {
+  ctx->SetData(0, new WrapperData<int>(1), true);
+  ctx->SetData(1, new WrapperData<int>(2), true);
+  ctx->SetData(2, new WrapperData<int>(4), true);
+}
+
 }
 
 UDF_REGISTER(MockUdf, UdfManagerTest_MockUdf, 2, 1);
+SIMPLE_UDF_REGISTER(UdfManagerTest_Add, UdfManagerTest_Add);
+SIMPLE_UDF_REGISTER(UdfManagerTest_Mul, UdfManagerTest_Mul);
+FUSED_UDF_REGISTER(UdfManagerTest_Add, UdfManagerTest_Mul);
 
 TEST(UdfManagerTest, Build) {
   UdfChain chain;
@@ -121,3 +170,30 @@ TEST(UdfManagerTest, Register) {
   EXPECT_EQ(10, dynamic_cast<MockUdfData*>(ctx->Outputs()[0])->id);
   delete ctx;
 }
+
+TEST(UdfManagerTest, Fused) {
+  UdfChain chain;
+  UdfContext* ctx = new UdfContext;
+  AddFusedInputs(ctx);
+
+  EXPECT_TRUE(chain.BuildFromDef(BuildFusedUdfChainRegister(false)).IsOk());
+  EXPECT_TRUE(chain.Process(ctx).IsOk());
+  EXPECT_EQ(1u, ctx->Outputs().size());
+  EXPECT_EQ(12, dynamic_cast<WrapperData<int>*>(ctx->Outputs()[0])->Internal());
+  // the output of the add is not stored
+  Data* sum;
+  EXPECT_TRUE(ctx->GetData(3, &sum).IsOk());
+  EXPECT_EQ(nullptr, sum);
+  delete ctx;
+
+  // the add read by the outputs runs on its own
+  UdfChain unfused_chain;
+  ctx = new UdfContext;
+  AddFusedInputs(ctx);
+  EXPECT_TRUE(unfused_chain.BuildFromDef(BuildFusedUdfChainRegister(true)).IsOk());
+  EXPECT_TRUE(unfused_chain.Process(ctx).IsOk());
+  EXPECT_EQ(2u, ctx->Outputs().size());
+  EXPECT_EQ(12, dynamic_cast<WrapperData<int>*>(ctx->Outputs()[0])->Internal());
+  EXPECT_EQ(3, dynamic_cast<WrapperData<int>*>(ctx->Outputs()[1])->Internal());
+  delete ctx;
+}
@@ -0,0 +1,155 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/server/tiered_storage.h"
+#include "ps-plus/server/variable.h"
+#include "ps-plus/common/hashmap.h"
+#include "ps-plus/common/logging.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace ps {
+namespace server {
+
+TieredStorage::TieredStorage(const std::string& spill_dir, const std::string& variable_name,
+                             size_t cold_steps, size_t check_interval, size_t max_spill_per_pass)
+  : spill_dir_(spill_dir), variable_name_(variable_name), cold_steps_(cold_steps),
+    check_interval_(check_interval == 0 ? 1 : check_interval),
+    max_spill_per_pass_(max_spill_per_pass), step_(0), spilled_(0) {
+}
+
+TieredStorage::~TieredStorage() {
+  for (auto& item : files_) {
+    close(item.second);
+  }
+}
+
+void TieredStorage::Touch(const std::vector<size_t>& ids, size_t segment_size) {
+  size_t step = step_.load(std::memory_order_relaxed) + 1;
+  size_t last = (size_t)-1;
+  for (size_t id : ids) {
+    if (id == HashMap::NOT_ADD_ID) {
+      continue;
+    }
+    size_t segment = id / segment_size;
+    // ids of one request are mostly sorted, skip runs in the same segment
+    if (segment == last) {
+      continue;
+    }
+    last = segment;
+    if (segment >= last_access_.size()) {
+      last_access_.grow_to_at_least(segment + 1, 0);
+    }
+    __atomic_store_n(&last_access_[segment], step, __ATOMIC_RELAXED);
+  }
+}
+
+bool TieredStorage::Step() {
+  return ++step_ % check_interval_ == 0;
+}
+
+bool TieredStorage::IsCold(size_t segment, size_t step) const {
+  if (segment >= last_access_.size()) {
+    // never touched, it is either free space or will be hot soon
+    return false;
+  }
+  size_t last = __atomic_load_n(&last_access_[segment], __ATOMIC_RELAXED);
+  return last != 0 && step > last + cold_steps_;
+}
+
+Status TieredStorage::GetFile(const std::string& tensor_name, int* fd) {
+  auto iter = files_.find(tensor_name);
+  if (iter != files_.end()) {
+    *fd = iter->second;
+    return Status::Ok();
+  }
+  std::string file_name = variable_name_ + "." + tensor_name + ".spill";
+  for (auto& c : file_name) {
+    if (c == '/') {
+      c = '_';
+    }
+  }
+  std::string path = spill_dir_ + "/" + file_name;
+  int ret = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (ret < 0) {
+    return Status::Unknown("TieredStorage: open " + path + " error " + std::string(strerror(errno)));
+  }
+  files_[tensor_name] = ret;
+  *fd = ret;
+  return Status::Ok();
+}
+
+Status TieredStorage::Balance(Variable* variable) {
+  std::vector<std::pair<std::string, Tensor*> > tensors;
+  tensors.emplace_back("data", variable->GetData());
+  for (auto& slot : variable->GetSlots()) {
+    if (slot.second.joiner == Variable::kVariableLike) {
+      tensors.emplace_back(slot.first, slot.second.tensor.get());
+    }
+  }
+  for (auto& tensor : tensors) {
+    if (tensor.second->TensorType() != Tensor::TType::kSegment) {
+      return Status::ArgumentError("TieredStorage: only segment tensor can be tiered for " + variable_name_);
+    }
+  }
+  size_t step = step_.load();
+  size_t segment_count = tensors[0].second->SegmentCount();
+  size_t spill = 0, load = 0, spilled = 0;
+  for (size_t segment = 0; segment < segment_count; segment++) {
+    bool cold = IsCold(segment, step);
+    if (cold && !tensors[0].second->SegmentSpilled(segment) && spill >= max_spill_per_pass_) {
+      continue;
+    }
+    bool changed = false;
+    // check every tensor, slots may be created after the data was spilled
+    for (auto& tensor : tensors) {
+      if (segment >= tensor.second->SegmentCount()) {
+        continue;
+      }
+      bool tensor_spilled = tensor.second->SegmentSpilled(segment);
+      if (cold && !tensor_spilled) {
+        int fd;
+        PS_CHECK_STATUS(GetFile(tensor.first, &fd));
+        PS_CHECK_STATUS(tensor.second->SpillSegment(segment, fd));
+        changed = true;
+      } else if (!cold && tensor_spilled) {
+        PS_CHECK_STATUS(tensor.second->LoadSegment(segment));
+        changed = true;
+      }
+    }
+    if (changed) {
+      if (cold) {
+        spill++;
+      } else {
+        load++;
+      }
+    }
+    if (cold) {
+      spilled++;
+    }
+  }
+  spilled_ = spilled;
+  if (spill != 0 || load != 0) {
+    LOG(INFO) << "TieredStorage for " << variable_name_ << ", spill " << spill << " segments, load " << load << " segments, spilled " << spilled_ << "/" << segment_count;
+  }
+  return Status::Ok();
+}
+
+}
+}
+
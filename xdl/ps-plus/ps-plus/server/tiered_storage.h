@@ -0,0 +1,77 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_SERVER_TIERED_STORAGE_H_
+#define PS_PLUS_SERVER_TIERED_STORAGE_H_
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "tbb/concurrent_vector.h"
+
+#include "ps-plus/common/status.h"
+
+namespace ps {
+namespace server {
+
+class Variable;
+
+// Hot/cold tiering for hash variables.
+// Access is tracked per tensor segment (Tensor::DEFAULT_SEGMENT_SIZE rows).
+// Every check_interval pulls, Balance spills segments that were not touched
+// for cold_steps pulls to files under spill_dir, together with the same
+// segment of every variable-like slot, and moves spilled segments that got
+// hot again back to memory. Spilled rows stay addressable through a shared
+// mapping of the file, so nothing else has to know about the tiers.
+class TieredStorage {
+ public:
+  TieredStorage(const std::string& spill_dir, const std::string& variable_name,
+                size_t cold_steps, size_t check_interval, size_t max_spill_per_pass);
+  ~TieredStorage();
+
+  // Records the segments of ids as accessed in the current step.
+  void Touch(const std::vector<size_t>& ids, size_t segment_size);
+
+  // Advances the step, returns true when Balance should run.
+  bool Step();
+
+  // Needs every reader of variable to be blocked.
+  Status Balance(Variable* variable);
+
+  size_t SpilledSegments() const { return spilled_; }
+
+ private:
+  Status GetFile(const std::string& tensor_name, int* fd);
+  bool IsCold(size_t segment, size_t step) const;
+
+  std::string spill_dir_;
+  std::string variable_name_;
+  size_t cold_steps_;
+  size_t check_interval_;
+  size_t max_spill_per_pass_;
+  std::atomic<size_t> step_;
+  size_t spilled_;
+  // step + 1 of the last access of each segment, 0 for never accessed
+  tbb::concurrent_vector<size_t> last_access_;
+  std::unordered_map<std::string, int> files_;
+};
+
+}
+}
+
+#endif
+
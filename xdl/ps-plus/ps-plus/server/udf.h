@@ -22,6 +22,7 @@ limitations under the License.
 #include "ps-plus/server/udf_context.h"
 
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace ps {
@@ -123,6 +124,11 @@ class UdfRegistryImpl : public UdfRegistry {
   }
 };
 
+// The name of the udf fusing the udf consumer into the udf producer feeding it
+inline std::string FusedUdfName(const std::string& producer, const std::string& consumer) {
+  return producer + "+" + consumer;
+}
+
 #define UDF_REGISTER(TYPE, NAME, INPUT, OUTPUT) \
   PLUGIN_REGISTER(ps::server::UdfRegistry, NAME, ps::server::UdfRegistryImpl<TYPE>, INPUT, OUTPUT)
 
@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "ps-plus/server/udf/simple_udf.h"
 #include "ps-plus/server/slice.h"
+#include "ps-plus/server/reduced_slot.h"
+#include "ps-plus/server/udf/optimizer_kernels.h"
 #include "ps-plus/common/initializer/constant_initializer.h"
 #include "ps-plus/common/hashmap.h"
 
@@ -43,26 +45,32 @@ class AdagradUpdater : public SimpleUdf<vector<Slices>, vector<Tensor>, vector<d
       double learning_rate = learning_rates[si];
       double initial_accumulator_value = initial_accumulator_values[si];
       Tensor* data_tensor = slices.variable->GetData();
-      Tensor* acc_tensor = slices.variable->GetVariableLikeSlot("adagrad_accumulation", data_tensor->Type(), [=]{ return new initializer::ConstantInitializer(initial_accumulator_value); });
+      ReducedSlot acc_slot;
+      PS_CHECK_STATUS(acc_slot.Init(slices.variable, "adagrad_accumulation", data_tensor->Type(), initial_accumulator_value));
       const Tensor& grad_tensor = grad_tensors[si];
       if (grad_tensor.Type() != data_tensor->Type()) {
         return Status::ArgumentError("grad should has same datatype with variable");
       }
 
       CASES(data_tensor->Type(), MultiThreadDo(slices.slice_id.size(), [&](const Range& r) {
+                ReducedSlotRow<T> acc_row(acc_slot);
                 for (size_t i = r.begin; i < r.end; i++) {
                   int64_t slice = slices.slice_id[i];
                   if ((int64_t)slice == ps::HashMap::NOT_ADD_ID) {
                     continue;
                   }
+                  StripedLocker row_locker(slices.variable->RowLock(), slice);
                   T* grad = grad_tensor.Raw<T>(i);
-                  T* acc = acc_tensor->Raw<T>(slice);
+                  T* acc = acc_row.Load(slice);
                   T* data = data_tensor->Raw<T>(slice);
-                  for (size_t j = 0; j < slices.slice_size; j++) {
-                    *acc += *grad * *grad;
-                    *data -= *grad * learning_rate / sqrt(*acc);
-                    data++;grad++;acc++;
+                  if (!AdagradRow(data, acc, grad, slices.slice_size, learning_rate)) {
+                    for (size_t j = 0; j < slices.slice_size; j++) {
+                      *acc += *grad * *grad;
+                      *data -= *grad * learning_rate / sqrt(*acc);
+                      data++;grad++;acc++;
+                    }
                   }
+                  acc_row.Store();
                 }
                 return Status::Ok();
               }));
@@ -14,7 +14,11 @@ limitations under the License.
 ==============================================================================*/
 
 #include "ps-plus/server/udf/simple_udf.h"
+#include "ps-plus/server/udf/build_hash_slice.h"
+#include "ps-plus/server/udf/fused_udf.h"
 #include "ps-plus/server/slice.h"
+#include "ps-plus/server/reduced_slot.h"
+#include "ps-plus/server/udf/optimizer_kernels.h"
 #include "ps-plus/common/initializer/constant_initializer.h"
 #include "ps-plus/common/hashmap.h"
 
@@ -53,8 +57,10 @@ class AdamUpdater : public SimpleUdf<vector<Slices>, vector<Tensor>, vector<doub
       Tensor* data_tensor = slices.variable->GetData();
       Tensor* beta1_tensor = slices.variable->GetAnyOneSlot("beta1", DataType::kDouble, ps::TensorShape({}), [&]{ return new initializer::ConstantInitializer(beta1); });
       Tensor* beta2_tensor = slices.variable->GetAnyOneSlot("beta2", DataType::kDouble, ps::TensorShape({}), [&]{ return new initializer::ConstantInitializer(beta2); });
-      Tensor* m_tensor = slices.variable->GetVariableLikeSlot("m", DataType::kDouble, []{ return new initializer::ConstantInitializer(0); });
-      Tensor* v_tensor = slices.variable->GetVariableLikeSlot("v", DataType::kDouble, []{ return new initializer::ConstantInitializer(0); });    
+      ReducedSlot m_slot;
+      PS_CHECK_STATUS(m_slot.Init(slices.variable, "m", DataType::kDouble, 0));
+      ReducedSlot v_slot;
+      PS_CHECK_STATUS(v_slot.Init(slices.variable, "v", DataType::kDouble, 0));
     
       if (grad_tensor.Type() != data_tensor->Type()) {
         return Status::ArgumentError("grad should has same datatype with variable");
@@ -70,22 +76,29 @@ class AdamUpdater : public SimpleUdf<vector<Slices>, vector<Tensor>, vector<doub
               alpha = learning_rate;
             }
             MultiThreadDo(slices.slice_id.size(), [&](const Range& r) {
+                  ReducedSlotRow<double> m_row(m_slot);
+                  ReducedSlotRow<double> v_row(v_slot);
                   for (size_t i = r.begin; i < r.end; i++) {
                     T* grad = grad_tensor.Raw<T>(i);
                     size_t slice = slices.slice_id[i];
                     if ((int64_t)slice == ps::HashMap::NOT_ADD_ID) {
                       continue;
                     }
+                    StripedLocker row_locker(slices.variable->RowLock(), slice);
                     T* data = data_tensor->Raw<T>(slice);
-                    double* m = m_tensor->Raw<double>(slice);
-                    double* v = v_tensor->Raw<double>(slice);
-                    for (size_t j = 0; j < slices.slice_size; j++) {
-                      double grad_d = (double)(*grad);
-                      *m += (grad_d - *m) * (1 - beta1);
-                      *v += (grad_d * grad_d - *v) * (1 - beta2);
-                      *data -= (alpha * *m) / (sqrt(*v) + epsilon);
-                      data++;grad++;m++;v++;
+                    double* m = m_row.Load(slice);
+                    double* v = v_row.Load(slice);
+                    if (!AdamRow(data, m, v, grad, slices.slice_size, alpha, beta1, beta2, epsilon)) {
+                      for (size_t j = 0; j < slices.slice_size; j++) {
+                        double grad_d = (double)(*grad);
+                        *m += (grad_d - *m) * (1 - beta1);
+                        *v += (grad_d * grad_d - *v) * (1 - beta2);
+                        *data -= (alpha * *m) / (sqrt(*v) + epsilon);
+                        data++;grad++;m++;v++;
+                      }
                     }
+                    m_row.Store();
+                    v_row.Store();
                   }
                   return Status::Ok();
                 });
@@ -98,6 +111,7 @@ class AdamUpdater : public SimpleUdf<vector<Slices>, vector<Tensor>, vector<doub
 };
 
 SIMPLE_UDF_REGISTER(AdamUpdater, AdamUpdater);
+FUSED_UDF_REGISTER(BuildHashSlice, AdamUpdater);
 
 }
 }
@@ -35,11 +35,19 @@ class BuildDenseSlice : public SimpleUdf<bool, std::vector<Slices>*> {
     slices.slice_size = variable->GetData()->Shape().NumElements();
     slices.slice_id.push_back(0);
     result->push_back(slices);
+    const TensorShape& shape = variable->GetData()->Shape();
+    variable->AddTraffic(writable, shape.IsScalar() ? 1 : shape[0]);
+    if (writable) {
+      variable->GetDirtyRows().MarkAll();
+    }
 
     //TODO write dense
     if (writable && ctx->GetStreamingModelArgs() != NULL && !ctx->GetStreamingModelArgs()->streaming_dense_model_addr.empty()) {
       PS_CHECK_STATUS(StreamingModelUtils::WriteDense(ctx->GetVariableName()));
     }
+    if (writable && StreamingModelUtils::ReplicaEnabled()) {
+      PS_CHECK_STATUS(StreamingModelUtils::WriteDense(ctx->GetVariableName(), StreamingModelUtils::kReplica));
+    }
 
     return Status::Ok();
   }
@@ -13,8 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
-#include "ps-plus/server/udf/simple_udf.h"
-#include "ps-plus/server/slice.h"
+#include "ps-plus/server/udf/build_hash_slice.h"
 #include "ps-plus/common/hashmap.h"
 #include "ps-plus/server/streaming_model_utils.h"
 #include "ps-plus/common/string_utils.h"
@@ -25,58 +24,96 @@ namespace ps {
 namespace server {
 namespace udf {
 
-class BuildHashSlice : public SimpleUdf<std::vector<Tensor>, std::vector<std::string>, std::vector<float>, bool, bool, std::vector<Slices>*> {
- public:
-  virtual Status SimpleRun(UdfContext* ctx, const std::vector<Tensor>& ids, const std::vector<std::string>& tensor_names, const std::vector<float>& save_ratios, const bool& writable, const bool& insert, std::vector<Slices>* result) const {
-    static size_t step = 0;
-    size_t current_step = step++;
-    if (ids.size() != tensor_names.size()) {
-      return Status::ArgumentError("BuildHashSlice: ids and tensor_names can't match");
+Status BuildHashSlice::SimpleRun(UdfContext* ctx, const std::vector<Tensor>& ids, const std::vector<std::string>& tensor_names, const std::vector<float>& save_ratios, const bool& writable, const bool& insert, std::vector<Slices>* result) const {
+  static size_t step = 0;
+  size_t current_step = step++;
+  if (ids.size() != tensor_names.size()) {
+    return Status::ArgumentError("BuildHashSlice: ids and tensor_names can't match");
+  }
+  StorageManager* manager = ctx->GetStorageManager();
+  result->resize(ids.size());
+  size_t total_id = 0;
+  for (size_t si = 0; si < ids.size(); si++) {
+    const Tensor& id = ids[si];
+    Variable* variable;
+    PS_CHECK_STATUS(manager->Get(tensor_names[si], &variable));
+    if (id.Type() != DataType::kInt64) {
+      return Status::ArgumentError("BuildHashSlice: dtype should be int64 for " + tensor_names[si]);
     }
-    StorageManager* manager = ctx->GetStorageManager();
-    result->resize(ids.size());
-    size_t total_id = 0;
-    for (size_t si = 0; si < ids.size(); si++) {
-      const Tensor& id = ids[si];
-      Variable* variable;
-      PS_CHECK_STATUS(manager->Get(tensor_names[si], &variable));
-      if (id.Type() != DataType::kInt64) {
-        return Status::ArgumentError("BuildHashSlice: dtype should be int64 for " + tensor_names[si]);
-      }
-      std::unique_ptr<HashMap>& hashmap = (dynamic_cast<WrapperData<std::unique_ptr<HashMap> >*>(variable->GetSlicer()))->Internal();
-      if (hashmap == nullptr) {
-        return Status::ArgumentError("BuildHashSlice: Variable Should be a Hash Variable for " + tensor_names[si]);
-      }
-      QRWLocker locker(variable->VariableLock(), QRWLocker::kSimpleRead);
-      Slices& element = (*result)[si];
-      tbb::concurrent_vector<size_t> reused_ids;
-      size_t total_filtered_count = 0;
-      int64_t max_id = hashmap->Get(id.Raw<int64_t>(), id.Shape()[0], !insert, save_ratios[si], &element.slice_id, &reused_ids, &total_filtered_count);
-      if (!insert && (current_step % 200 == 0) && total_filtered_count != 0) {
-        LOG(INFO) << "Step " << current_step/2 << ", variable[" << tensor_names[si] << "], filtered keys [" << total_filtered_count << "], hashmap size [" << hashmap->GetSize() << "]";
-      }
-      if (max_id > 0) {
-        PS_CHECK_STATUS(variable->ReShapeId(max_id));
+    std::unique_ptr<HashMap>& hashmap = (dynamic_cast<WrapperData<std::unique_ptr<HashMap> >*>(variable->GetSlicer()))->Internal();
+    if (hashmap == nullptr) {
+      return Status::ArgumentError("BuildHashSlice: Variable Should be a Hash Variable for " + tensor_names[si]);
+    }
+    QRWLocker locker(variable->VariableLock(), QRWLocker::kSimpleRead);
+    Slices& element = (*result)[si];
+    tbb::concurrent_vector<size_t> reused_ids;
+    size_t total_filtered_count = 0;
+    int64_t max_id = hashmap->Get(id.Raw<int64_t>(), id.Shape()[0], !insert, save_ratios[si], &element.slice_id, &reused_ids, &total_filtered_count);
+    if (!insert && (current_step % 200 == 0) && total_filtered_count != 0) {
+      LOG(INFO) << "Step " << current_step/2 << ", variable[" << tensor_names[si] << "], filtered keys [" << total_filtered_count << "], hashmap size [" << hashmap->GetSize() << "]";
+    }
+    if (max_id > 0) {
+      PS_CHECK_STATUS(variable->ReShapeId(max_id));
+    }
+    // before ClearIds, the reused rows must not be overwritten by the restore
+    LazyRows* lazy_rows = variable->GetLazyRows();
+    if (lazy_rows != nullptr) {
+      PS_CHECK_STATUS(lazy_rows->Ensure(element.slice_id));
+    }
+    TieredStorage* tiered_storage = variable->GetTieredStorage();
+    if (tiered_storage != nullptr) {
+      tiered_storage->Touch(element.slice_id, variable->GetData()->SegmentSize());
+    }
+    HashEvictor* hash_evictor = variable->GetHashEvictor();
+    if (hash_evictor != nullptr) {
+      hash_evictor->Touch(element.slice_id);
+    }
+    if (reused_ids.size() != 0) {
+      std::vector<size_t> raw_reused_ids;
+      for (auto iter : reused_ids) {
+        raw_reused_ids.push_back(iter);
       }
-      if (reused_ids.size() != 0) {
-        std::vector<size_t> raw_reused_ids;
-        for (auto iter : reused_ids) {
-          raw_reused_ids.push_back(iter);
+      variable->ClearIds(raw_reused_ids);
+    }
+    ps::TensorShape shape = variable->GetData()->Shape();
+    element.slice_size = shape.NumElements() / shape[0];
+    element.writable = writable;
+    element.variable = variable;
+    element.dim_part = 1;
+    variable->AddTraffic(writable, element.slice_id.size());
+    if (writable) {
+      variable->GetDirtyRows().Mark(element.slice_id);
+    }
+    if (writable && ctx->GetStreamingModelArgs() != NULL && !ctx->GetStreamingModelArgs()->streaming_hash_model_addr.empty()) { 
+        PS_CHECK_STATUS(StreamingModelUtils::WriteHash(tensor_names[si], id));
+    }
+    if (writable && StreamingModelUtils::ReplicaEnabled()) {
+      PS_CHECK_STATUS(StreamingModelUtils::WriteHash(tensor_names[si], id, StreamingModelUtils::kReplica));
+    }
+    if (tiered_storage != nullptr && tiered_storage->Step() && ctx->GetServerLocker() != nullptr) {
+      // Block Everything, spilled buffers are swapped under the readers
+      ctx->GetServerLocker()->ChangeType(QRWLocker::kWrite);
+      // a checkpoint writing the rows keeps them in place
+      Status st = variable->SavePinned() ? Status::Ok() : tiered_storage->Balance(variable);
+      ctx->GetServerLocker()->ChangeType(QRWLocker::kSimpleRead);
+      PS_CHECK_STATUS(st);
+    }
+    if (hash_evictor != nullptr && hash_evictor->Step() && ctx->GetServerLocker() != nullptr) {
+      // the rows are picked with the readers, only the erase blocks them
+      std::vector<size_t> evict_ids;
+      if (hash_evictor->Scan(hashmap->GetSize(), &evict_ids) && !evict_ids.empty()) {
+        ctx->GetServerLocker()->ChangeType(QRWLocker::kWrite);
+        // erased rows could be given to new keys while a checkpoint writes them
+        if (!variable->SavePinned()) {
+          std::vector<size_t> erased;
+          hash_evictor->Evict(hashmap.get(), evict_ids, &erased);
         }
-        variable->ClearIds(raw_reused_ids);
-      }
-      ps::TensorShape shape = variable->GetData()->Shape();
-      element.slice_size = shape.NumElements() / shape[0];
-      element.writable = writable;
-      element.variable = variable;
-      element.dim_part = 1;
-      if (writable && ctx->GetStreamingModelArgs() != NULL && !ctx->GetStreamingModelArgs()->streaming_hash_model_addr.empty()) { 
-          PS_CHECK_STATUS(StreamingModelUtils::WriteHash(tensor_names[si], id));
+        ctx->GetServerLocker()->ChangeType(QRWLocker::kSimpleRead);
       }
     }
-    return Status::Ok();
   }
-};
+  return Status::Ok();
+}
 
 SIMPLE_UDF_REGISTER(BuildHashSlice, BuildHashSlice);
 
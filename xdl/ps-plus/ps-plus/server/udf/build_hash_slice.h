@@ -0,0 +1,36 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_SERVER_UDF_BUILD_HASH_SLICE_H_
+#define PS_SERVER_UDF_BUILD_HASH_SLICE_H_
+
+#include "ps-plus/server/udf/simple_udf.h"
+#include "ps-plus/server/slice.h"
+
+namespace ps {
+namespace server {
+namespace udf {
+
+class BuildHashSlice : public SimpleUdf<std::vector<Tensor>, std::vector<std::string>, std::vector<float>, bool, bool, std::vector<Slices>*> {
+ public:
+  virtual Status SimpleRun(UdfContext* ctx, const std::vector<Tensor>& ids, const std::vector<std::string>& tensor_names, const std::vector<float>& save_ratios, const bool& writable, const bool& insert, std::vector<Slices>* result) const;
+};
+
+}
+}
+}
+
+#endif
+
@@ -57,11 +57,18 @@ class BuildSparseSlice : public SimpleUdf<Tensor, bool, std::vector<Slices>*> {
                               slices.slice_id.push_back(id - min_id);
                             }
                           } while (0));
+    if (writable) {
+      variable->GetDirtyRows().Mark(slices.slice_id);
+    }
+    variable->AddTraffic(writable, slices.slice_id.size());
     result->push_back(slices);
     //TODO Write Sparse
     if (writable && ctx->GetStreamingModelArgs() != NULL  && !ctx->GetStreamingModelArgs()->streaming_sparse_model_addr.empty()) {
       PS_CHECK_STATUS(StreamingModelUtils::WriteSparse(ctx->GetVariableName(), ids));
     }
+    if (writable && StreamingModelUtils::ReplicaEnabled()) {
+      PS_CHECK_STATUS(StreamingModelUtils::WriteSparse(ctx->GetVariableName(), ids, StreamingModelUtils::kReplica));
+    }
     return Status::Ok();
   }
 };
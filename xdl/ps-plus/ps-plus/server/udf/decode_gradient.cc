@@ -0,0 +1,51 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/server/udf/simple_udf.h"
+#include "ps-plus/common/gradient_codec.h"
+
+namespace ps {
+namespace server {
+namespace udf {
+
+using std::vector;
+
+// Restores float gradients encoded by the client's gradient codec, codecs and
+// row sizes are given per tensor.
+class DecodeGradient : public SimpleUdf<vector<Tensor>, vector<int>, vector<int64_t>, vector<Tensor>*> {
+ public:
+  virtual Status SimpleRun(
+      UdfContext* ctx,
+      const vector<Tensor>& encoded,
+      const vector<int>& codecs,
+      const vector<int64_t>& cols,
+      vector<Tensor>* grads) const {
+    if (encoded.size() != codecs.size() || encoded.size() != cols.size()) {
+      return Status::ArgumentError("DecodeGradient: gradients and codecs size not match");
+    }
+    grads->resize(encoded.size());
+    for (size_t i = 0; i < encoded.size(); i++) {
+      PS_CHECK_STATUS(GradientCodec::Decode((GradientCodec::Type)codecs[i], cols[i], encoded[i], &(*grads)[i]));
+    }
+    return Status::Ok();
+  }
+};
+
+SIMPLE_UDF_REGISTER(DecodeGradient, DecodeGradient);
+
+}
+}
+}
+
@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "ps-plus/server/udf/simple_udf.h"
 #include "ps-plus/server/slice.h"
+#include "ps-plus/server/reduced_slot.h"
+#include "ps-plus/server/udf/optimizer_kernels.h"
 #include "ps-plus/common/initializer/constant_initializer.h"
 #include "ps-plus/common/hashmap.h"
 
@@ -51,48 +53,57 @@ class FtrlUpdater : public SimpleUdf<vector<Slices>, vector<Tensor>, vector<doub
       const Tensor& grad_tensor = grad_tensors[si];
 
       Tensor* data_tensor = slices.variable->GetData();
-      Tensor* acc_tensor = slices.variable->GetVariableLikeSlot("accum", data_tensor->Type(), [&]{ return new initializer::ConstantInitializer(initial_accumulator_value); });
-      Tensor* linear_tensor = slices.variable->GetVariableLikeSlot("linear", data_tensor->Type(), [&]{ return new initializer::ConstantInitializer(0); });
+      ReducedSlot acc_slot;
+      PS_CHECK_STATUS(acc_slot.Init(slices.variable, "accum", data_tensor->Type(), initial_accumulator_value));
+      ReducedSlot linear_slot;
+      PS_CHECK_STATUS(linear_slot.Init(slices.variable, "linear", data_tensor->Type(), 0));
       if (grad_tensor.Type() != data_tensor->Type()) {
         return Status::ArgumentError("grad should has same datatype with variable");
       }
 
       CASES(data_tensor->Type(), MultiThreadDo(slices.slice_id.size(), [&](const Range& r) {
+                ReducedSlotRow<T> acc_row(acc_slot);
+                ReducedSlotRow<T> linear_row(linear_slot);
                 for (size_t i = r.begin; i < r.end; i++) {
                   T* grad = grad_tensor.Raw<T>(i);
                   int64_t slice = slices.slice_id[i];
                   if ((int64_t)slice == ps::HashMap::NOT_ADD_ID) {
                     continue;
                   }
+                  StripedLocker row_locker(slices.variable->RowLock(), slice);
                   T* data = data_tensor->Raw<T>(slice);
-                  T* acc = acc_tensor->Raw<T>(slice);
-                  T* linear = linear_tensor->Raw<T>(slice);
-                  for (size_t j = 0; j < slices.slice_size; j++) {
-                    T new_accum = *acc + *grad * *grad;
-                    if (fabs(learning_rate_power + 0.5) < 1e-6) {
-                      *linear += *grad - (sqrt(new_accum) - sqrt(*acc)) / learning_rate * *data;
-                      auto x = l1_reg * sgn(*linear) - *linear;
-                      auto y = sqrt(new_accum) / learning_rate + l2_reg * 2;
-                      auto pre_shrink = x / y;
-                      if (fabs(*linear) > l1_reg) {
-                        *data = pre_shrink;
+                  T* acc = acc_row.Load(slice);
+                  T* linear = linear_row.Load(slice);
+                  if (!FtrlRow(data, acc, linear, grad, slices.slice_size, learning_rate, learning_rate_power, l1_reg, l2_reg)) {
+                    for (size_t j = 0; j < slices.slice_size; j++) {
+                      T new_accum = *acc + *grad * *grad;
+                      if (fabs(learning_rate_power + 0.5) < 1e-6) {
+                        *linear += *grad - (sqrt(new_accum) - sqrt(*acc)) / learning_rate * *data;
+                        auto x = l1_reg * sgn(*linear) - *linear;
+                        auto y = sqrt(new_accum) / learning_rate + l2_reg * 2;
+                        auto pre_shrink = x / y;
+                        if (fabs(*linear) > l1_reg) {
+                          *data = pre_shrink;
+                        } else {
+                          *data = 0;
+                        }
                       } else {
-                        *data = 0;
-                      }
-                    } else {
-                      *linear += *grad - (pow(new_accum, -learning_rate_power) - pow(*acc, -learning_rate_power)) / learning_rate * *data;
-                      auto x = l1_reg * sgn(*linear) - *linear;
-                      auto y = pow(new_accum, -learning_rate_power) / learning_rate + l2_reg * 2;
-                      auto pre_shrink = x / y;
-                      if (fabs(*linear) > l1_reg) {
-                        *data = pre_shrink;
-                      } else {
-                        *data = 0;
+                        *linear += *grad - (pow(new_accum, -learning_rate_power) - pow(*acc, -learning_rate_power)) / learning_rate * *data;
+                        auto x = l1_reg * sgn(*linear) - *linear;
+                        auto y = pow(new_accum, -learning_rate_power) / learning_rate + l2_reg * 2;
+                        auto pre_shrink = x / y;
+                        if (fabs(*linear) > l1_reg) {
+                          *data = pre_shrink;
+                        } else {
+                          *data = 0;
+                        }
                       }
+                      *acc += *grad * *grad;
+                      data++; grad++; acc++; linear++;
                     }
-                    *acc += *grad * *grad;
-                    data++; grad++; acc++; linear++;
                   }
+                  acc_row.Store();
+                  linear_row.Store();
                 }
                 return Status::Ok();
               }));
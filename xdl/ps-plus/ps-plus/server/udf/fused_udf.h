@@ -0,0 +1,124 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_SERVER_UDF_FUSED_UDF_H_
+#define PS_SERVER_UDF_FUSED_UDF_H_
+
+#include "ps-plus/server/udf/simple_udf.h"
+
+#include <type_traits>
+
+namespace ps {
+namespace server {
+namespace udf {
+
+namespace fused_udf_helper {
+
+template <typename... T>
+struct TypeList {};
+
+template <typename... T>
+TypeList<T...> SimpleArguments(const SimpleUdf<T...>*);
+
+template <typename T, typename... Rest>
+struct Last {
+  using Type = typename Last<Rest...>::Type;
+};
+
+template <typename T>
+struct Last<T> {
+  using Type = T;
+};
+
+template <typename Tudf>
+using Arguments = decltype(SimpleArguments(static_cast<const Tudf*>(nullptr)));
+
+}
+
+// FusedUdf<Producer, Consumer> runs the SimpleUdf Consumer on the only output
+// of the SimpleUdf Producer in one udf, such as BuildHashSlice -> SliceToTensor.
+// The inputs are the ones of Producer followed by the ones of Consumer but the
+// first, the outputs are the one of Producer, which is left unset, followed by
+// the ones of Consumer. The output of Producer is kept on the stack and passed
+// to Consumer as is, instead of being allocated and stored in the UdfContext.
+// UdfChain fuses the two when nothing else reads the output of Producer,
+// see FUSED_UDF_REGISTER.
+template <typename Producer, typename Consumer,
+          typename ProducerArgs = fused_udf_helper::Arguments<Producer>,
+          typename ConsumerArgs = fused_udf_helper::Arguments<Consumer>>
+class FusedUdf;
+
+template <typename Producer, typename Consumer, typename... P, typename C0, typename... C>
+class FusedUdf<Producer, Consumer, fused_udf_helper::TypeList<P...>, fused_udf_helper::TypeList<C0, C...>> : public Udf {
+ public:
+  static_assert(Producer::kOutputSize == 1, "FusedUdf: Producer should have one output");
+  static_assert(std::is_same<typename fused_udf_helper::Last<P...>::Type, C0*>::value,
+                "FusedUdf: the first input of Consumer should be the output of Producer");
+
+  static constexpr size_t kInputSize = Producer::kInputSize + Consumer::kInputSize - 1;
+  static constexpr size_t kOutputSize = 1 + Consumer::kOutputSize;
+
+  virtual Status Run(UdfContext* ctx) const {
+    if (InputSize() != kInputSize || OutputSize() != kOutputSize) {
+      return Status::ArgumentError("Fused Udf InputSize or OutputSize Error!");
+    }
+    std::vector<Data*> inputs;
+    PS_CHECK_STATUS(GetInputs(ctx, &inputs));
+
+    WrapperData<C0> intermediate;
+    std::vector<Data*> producer_args(inputs.begin(), inputs.begin() + Producer::kInputSize);
+    producer_args.push_back(&intermediate);
+    PS_CHECK_STATUS((simple_udf_helper::SimpleRunHelper<Producer, P...>(&producer_, ctx, producer_args)));
+
+    std::vector<Data*> consumer_args({&intermediate, simple_udf_helper::Argument<C>::Build()...});
+    for (size_t i = 1; i < Consumer::kInputSize; i++) {
+      consumer_args[i] = inputs[Producer::kInputSize + i - 1];
+    }
+    Status ret = simple_udf_helper::SimpleRunHelper<Consumer, C0, C...>(&consumer_, ctx, consumer_args);
+    if (ret.IsOk()) {
+      for (size_t i = 0; i < Consumer::kOutputSize; i++) {
+        Udf::SetOutput(ctx, 1 + i, consumer_args[Consumer::kInputSize + i]);
+      }
+    } else {
+      for (size_t i = 0; i < Consumer::kOutputSize; i++) {
+        delete consumer_args[Consumer::kInputSize + i];
+      }
+    }
+    return ret;
+  }
+
+ private:
+  Producer producer_;
+  Consumer consumer_;
+};
+
+}
+}
+}
+
+#define FUSED_UDF_REGISTER_INTERNAL(REGISTER_ID, PRODUCER, CONSUMER) \
+  static ps::PluginRegister<ps::server::UdfRegistry, std::string> PLUGIN_REGISTER_CONCAT(FUSED_UDF_REGISTER_, REGISTER_ID)( \
+      ps::server::FusedUdfName(#PRODUCER, #CONSUMER), \
+      new ps::server::UdfRegistryImpl<ps::server::udf::FusedUdf<PRODUCER, CONSUMER>>( \
+          ps::server::udf::FusedUdf<PRODUCER, CONSUMER>::kInputSize, \
+          ps::server::udf::FusedUdf<PRODUCER, CONSUMER>::kOutputSize))
+
+// Registers the fusion of the SimpleUdfs PRODUCER and CONSUMER, which are
+// registered with their class names
+#define FUSED_UDF_REGISTER(PRODUCER, CONSUMER) \
+  FUSED_UDF_REGISTER_INTERNAL(__COUNTER__, PRODUCER, CONSUMER)
+
+#endif
+
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "ps-plus/server/udf/simple_udf.h"
 #include "ps-plus/common/hashmap.h"
+#include "ps-plus/common/open_hashmap.h"
 #include "ps-plus/common/hasher.h"
 #include "ps-plus/common/file_system.h"
 
@@ -23,12 +24,44 @@ namespace server {
 namespace udf {
 
 namespace {
+typedef HashMapImpl<int64_t>::NonCocurrentHashTable IdList;
+
 struct ListHandle {
-  HashMapImpl<int64_t>::NonCocurrentHashTable* list;
+  IdList* list;
   int beg, end;
   int threshold;
   bool is_black;
 };
+
+// HashMapImpl and OpenHashMapImpl keep the same lists for the 64 bit ids
+template <typename Map>
+IdList* List(Map* hashmap, bool is_black, bool renew) {
+  if (is_black) {
+    return renew ? hashmap->NewBlackList() : hashmap->GetBlackList();
+  }
+  return renew ? hashmap->NewWhiteList() : hashmap->GetWhiteList();
+}
+
+template <typename Map>
+size_t Filter(Map* hashmap, bool is_black) {
+  return is_black ? hashmap->FilterByBlackList() : hashmap->FilterByWhiteList();
+}
+
+IdList* List(HashMap* hashmap, bool is_black, bool renew) {
+  auto open = dynamic_cast<OpenHashMapImpl<int64_t>*>(hashmap);
+  if (open != nullptr) {
+    return List(open, is_black, renew);
+  }
+  return List(dynamic_cast<HashMapImpl<int64_t>*>(hashmap), is_black, renew);
+}
+
+size_t Filter(HashMap* hashmap, bool is_black) {
+  auto open = dynamic_cast<OpenHashMapImpl<int64_t>*>(hashmap);
+  if (open != nullptr) {
+    return Filter(open, is_black);
+  }
+  return Filter(dynamic_cast<HashMapImpl<int64_t>*>(hashmap), is_black);
+}
 }
 
 class HashBlackWhiteList : public SimpleUdf<std::vector<std::string>, std::vector<std::string>, std::vector<std::string>, std::vector<int>, std::vector<int>, std::vector<int>, std::vector<int>> {
@@ -39,10 +72,10 @@ class HashBlackWhiteList : public SimpleUdf<std::vector<std::string>, std::vecto
       const std::vector<std::string>& dirs, const std::vector<int>& threshold,
       const std::vector<int>& is_black, const std::vector<int>& beg, const std::vector<int>& end) const {
     ctx->GetServerLocker()->ChangeType(QRWLocker::kWrite);
-    std::unordered_map<std::string, HashMapImpl<int64_t>*> hashmaps;
+    std::unordered_map<std::string, HashMap*> hashmaps;
     std::unordered_map<std::string, ListHandle> lists;
     StorageManager* manager = ctx->GetStorageManager();
-    std::unordered_map<std::string, HashMapImpl<int64_t>*> white_hashmap, black_hashmap;
+    std::unordered_map<std::string, HashMap*> white_hashmap, black_hashmap;
     for (size_t i = 0; i < token_names.size(); i++) {
       std::string token = token_names[i];
       std::string var = var_names[i];
@@ -52,24 +85,25 @@ class HashBlackWhiteList : public SimpleUdf<std::vector<std::string>, std::vecto
       if (slicer == nullptr) {
         return Status::ArgumentError("HashBlackWhiteList: Variable Should be a Hash Variable for " + var);
       }
-      auto hashmap = dynamic_cast<HashMapImpl<int64_t>*>(slicer->Internal().get());
-      if (hashmap == nullptr) {
+      HashMap* hashmap = slicer->Internal().get();
+      if (dynamic_cast<HashMapImpl<int64_t>*>(hashmap) == nullptr
+          && dynamic_cast<OpenHashMapImpl<int64_t>*>(hashmap) == nullptr) {
         return Status::ArgumentError("HashBlackWhiteList: Variable Should be a Hash 64 Variable for " + var);
       }
       hashmaps[token] = hashmap;
       if (is_black[i]) {
         if (black_hashmap[var] == nullptr) {
           black_hashmap[var] = hashmap;
-          lists[token].list = hashmap->NewBlackList();
+          lists[token].list = List(hashmap, true, true);
         } else {
-          lists[token].list = hashmap->GetBlackList();
+          lists[token].list = List(hashmap, true, false);
         }
       } else {
         if (white_hashmap[var] == nullptr) {
           white_hashmap[var] = hashmap;
-          lists[token].list = hashmap->NewWhiteList();
+          lists[token].list = List(hashmap, false, true);
         } else {
-          lists[token].list = hashmap->GetWhiteList();
+          lists[token].list = List(hashmap, false, false);
         }
       }
       lists[token].beg = beg[i];
@@ -123,12 +157,12 @@ class HashBlackWhiteList : public SimpleUdf<std::vector<std::string>, std::vecto
       f->Close();
     }
     for (auto&& item : white_hashmap) {
-      size_t s = item.second->FilterByWhiteList();
-      LOG(INFO) << "filter " << item.first << " as " << s << " listsize " << item.second->GetWhiteList()->size();
+      size_t s = Filter(item.second, false);
+      LOG(INFO) << "filter " << item.first << " as " << s << " listsize " << List(item.second, false, false)->size();
     }
     for (auto&& item : black_hashmap) {
-      size_t s = item.second->FilterByBlackList();
-      LOG(INFO) << "filter " << item.first << " as " << s << " listsize " << item.second->GetBlackList()->size();
+      size_t s = Filter(item.second, true);
+      LOG(INFO) << "filter " << item.first << " as " << s << " listsize " << List(item.second, true, false)->size();
     }
     ctx->GetServerLocker()->ChangeType(QRWLocker::kSimpleRead);
     return Status::Ok();
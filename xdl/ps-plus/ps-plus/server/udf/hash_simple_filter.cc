@@ -80,12 +80,18 @@ class HashSimpleFilter
       }
       arguments.push_back(argument);
     }
-    // Block Everything
-    ctx->GetServerLocker()->ChangeType(QRWLocker::kWrite);
+    if (var->SavePinned()) {
+      // erased rows could be given to new keys while a checkpoint writes them
+      LOG(INFO) << "HashSimpleFilter: skip " << ctx->GetVariableName() << " while a checkpoint is written";
+      *del_size = 0;
+      return Status::Ok();
+    }
+    // The rows are decided with the readers, only the erase of each segment
+    // blocks everything, which costs the erased ids once the keys are tracked
     size_t size = hashmap->GetSize();
     size_t segment_size = var->GetData()->SegmentSize();
     size_t segment_count = (size + segment_size - 1) / segment_size;
-    std::vector<size_t> ids;
+    *del_size = 0;
     for (size_t i = 0; i < segment_count; i++) {
       std::vector<PythonRunner::NumpyArray> real_args;
       for (auto& arg : arguments) {
@@ -105,15 +111,28 @@ class HashSimpleFilter
       if (result.type != DataType::kInt8) {
         return Status::ArgumentError("HashSimpleFilter: return array type should be Bool");
       }
+      std::vector<size_t> ids;
       for (size_t j = 0; j < result.shape[0]; j++) {
         if (((uint8_t*)result.data)[j]) {
           ids.push_back(j + segment_size * i);
         }
       }
+      if (ids.empty()) {
+        continue;
+      }
+      ctx->GetServerLocker()->ChangeType(QRWLocker::kWrite);
+      if (var->SavePinned()) {
+        ctx->GetServerLocker()->ChangeType(QRWLocker::kSimpleRead);
+        LOG(INFO) << "HashSimpleFilter: stop " << ctx->GetVariableName() << " while a checkpoint is written";
+        break;
+      }
+      if (!hashmap->TrackingKeys()) {
+        hashmap->TrackKeys();
+      }
+      *del_size += hashmap->EraseIds(ids, nullptr);
+      ctx->GetServerLocker()->ChangeType(QRWLocker::kSimpleRead);
     }
-    tbb::concurrent_vector<size_t> unfiltered_ids;
-    *del_size = hashmap->EraseById(ctx->GetVariableName(), ids, &unfiltered_ids);
-    ctx->GetServerLocker()->ChangeType(QRWLocker::kSimpleRead);
+    LOG(INFO) << "Filter for " << ctx->GetVariableName() << ", clear=" << *del_size;
     return Status::Ok();
   }
 };
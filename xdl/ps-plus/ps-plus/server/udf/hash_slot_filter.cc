@@ -66,6 +66,9 @@ class HashSlotFilter
     if (hashmap == nullptr) {
       return Status::ArgumentError("HashSlotFilter: Variable Should be a Hash Variable for " + ctx->GetVariableName());
     }
+    if (var->GetLazyRows() != nullptr) {
+      PS_CHECK_STATUS(var->GetLazyRows()->EnsureAll());
+    }
     Tensor* slot = var->GetVariableLikeSlot(slot_name, DataType::kFloat, TensorShape({slot_size}), []{ return new initializer::ConstantInitializer(0); });
     std::vector<Argument> arguments;
     for (auto&& arg : func_args) {
@@ -86,8 +89,14 @@ class HashSlotFilter
       }
       arguments.push_back(argument);
     }
-    // Block Everything
-    ctx->GetServerLocker()->ChangeType(QRWLocker::kWrite);
+    if (var->SavePinned()) {
+      // erased rows could be given to new keys while a checkpoint writes them
+      LOG(INFO) << "HashSlotFilter: skip " << ctx->GetVariableName() << " while a checkpoint is written";
+      *del_size = 0;
+      return Status::Ok();
+    }
+    // The rows are decided with the readers, only the erase and the slot
+    // update of each segment block everything
     size_t size = hashmap->GetSize();
     size_t segment_size = var->GetData()->SegmentSize();
     size_t segment_count = (size + segment_size - 1) / segment_size;
@@ -126,13 +135,28 @@ class HashSlotFilter
           ids.push_back(j + segment_size * i);
         }
       }
-      tbb::concurrent_vector<size_t> unfiltered_ids;
-      *del_size += hashmap->EraseById(ctx->GetVariableName(), ids, &unfiltered_ids);
-      for (auto id : unfiltered_ids) {
-        memcpy(slot->Raw<float>(id), ((float*)new_slot.data) + slot_size * (id - segment_size * i), sizeof(float) * slot_size);
+      ctx->GetServerLocker()->ChangeType(QRWLocker::kWrite);
+      if (var->SavePinned()) {
+        ctx->GetServerLocker()->ChangeType(QRWLocker::kSimpleRead);
+        LOG(INFO) << "HashSlotFilter: stop " << ctx->GetVariableName() << " while a checkpoint is written";
+        break;
+      }
+      if (!hashmap->TrackingKeys()) {
+        hashmap->TrackKeys();
+      }
+      *del_size += hashmap->EraseIds(ids, nullptr);
+      // the rows left free are cleared when they are given to new keys
+      size_t k = 0;
+      for (size_t j = 0; j < new_slot.shape[0]; j++) {
+        size_t id = j + segment_size * i;
+        if (k < ids.size() && ids[k] == id) {
+          k++;
+          continue;
+        }
+        memcpy(slot->Raw<float>(id), ((float*)new_slot.data) + slot_size * j, sizeof(float) * slot_size);
       }
+      ctx->GetServerLocker()->ChangeType(QRWLocker::kSimpleRead);
     }
-    ctx->GetServerLocker()->ChangeType(QRWLocker::kSimpleRead);
     return Status::Ok();
   }
 };
@@ -70,6 +70,9 @@ class HashUnaryFilter : public SimpleUdf<std::string, double, int64_t> {
     if (variable->GetData()->Shape().IsScalar()) {
       return Status::ArgumentError("HashUnaryFilter: Variable should not be Scalar");
     }
+    if (variable->GetLazyRows() != nullptr) {
+      PS_CHECK_STATUS(variable->GetLazyRows()->EnsureAll());
+    }
     WrapperData<HashMap>* hashmap = dynamic_cast<WrapperData<HashMap>*>(variable->GetSlicer());
     if (hashmap == nullptr) {
       return Status::ArgumentError("HashUnaryFilter: Variable Should be a Hash Variable");
@@ -93,9 +96,9 @@ class HashUnaryFilter : public SimpleUdf<std::string, double, int64_t> {
         return Status::ArgumentError("HashUnaryFilter: Slot Shape Error! Must be 1 dim");
       }
       CASES(tensor->Type(), {
-        T* data = tensor->Raw<T>();
         for (auto& item : map.items) {
-          if (TESTFN(data[item.id])) {
+          // hash variables are segmented, the rows are addressed by id
+          if (TESTFN(*tensor->Raw<T>(item.id))) {
             keys.push_back(item.x);
             keys.push_back(item.y);
           }
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "ps-plus/server/udf/simple_udf.h"
 #include "ps-plus/common/hashmap.h"
+#include "ps-plus/common/open_hashmap.h"
 #include "ps-plus/common/string_utils.h"
 
 namespace ps {
@@ -35,6 +36,26 @@ class HashVariableInitializer : public SimpleUdf<DataType, TensorShape, std::str
     std::unordered_map<std::string, std::string> kvs = StringUtils::ParseMap(extra_info);
     bool hash64 = false;
     int32_t bloom_filter_threthold = 0;
+    // "global" shares GlobalBloomFilter, "variable" gives the variable its own sharded filter
+    std::string bloom_filter_scope = "global";
+    uint32_t bloom_filter_shards = 64;
+    uint64_t bloom_filter_size = 10000000;
+    double bloom_filter_fpp = 0.01;
+    std::string backend;
+    // tiered storage is enabled by tier_spill_dir
+    std::string tier_spill_dir;
+    uint64_t tier_cold_steps = 100000;
+    uint64_t tier_check_interval = 1000;
+    uint64_t tier_max_spill = 64;
+    // eviction of the idle keys is enabled by evict_idle_steps
+    uint64_t evict_idle_steps = 0;
+    uint64_t evict_keep_count = 0;
+    uint64_t evict_scan_interval = 100;
+    uint64_t evict_scan_rows = 1 << 16;
+    uint64_t evict_max_per_pass = 1 << 14;
+    StoragePrecision slot_precision = StoragePrecision::kFloat;
+    // bytes reserved after each row for the rows of the variable-like slots
+    uint64_t row_interleave_bytes = 0;
     for (const auto iter : kvs) {
       if (iter.first == "hash64" && iter.second == "true") {
         hash64 = true;
@@ -45,25 +66,97 @@ class HashVariableInitializer : public SimpleUdf<DataType, TensorShape, std::str
         if (bloom_filter_threthold >= 65500) {
           return Status::ArgumentError("HashVariableInitializer: bloom_filter_threthold too large, only support < 65500, "  + iter.first + "=" + iter.second);
         }
-        GlobalBloomFilter::SetThrethold(bloom_filter_threthold);
+      } else if (iter.first == "bloom_filter_scope") {
+        if (iter.second != "global" && iter.second != "variable") {
+          return Status::ArgumentError("HashVariableInitializer: bloom_filter_scope should be global or variable, "  + iter.first + "=" + iter.second);
+        }
+        bloom_filter_scope = iter.second;
+      } else if (iter.first == "bloom_filter_shards") {
+        if (!StringUtils::strToUInt32(iter.second.c_str(), bloom_filter_shards) || bloom_filter_shards == 0) {
+          return Status::ArgumentError("HashVariableInitializer: bloom_filter_shards not positive int "  + iter.first + "=" + iter.second);
+        }
+      } else if (iter.first == "bloom_filter_size") {
+        if (!StringUtils::strToUInt64(iter.second.c_str(), bloom_filter_size)) {
+          return Status::ArgumentError("HashVariableInitializer: bloom_filter_size not int "  + iter.first + "=" + iter.second);
+        }
+      } else if (iter.first == "bloom_filter_fpp") {
+        if (!StringUtils::strToDouble(iter.second.c_str(), bloom_filter_fpp) || bloom_filter_fpp <= 0 || bloom_filter_fpp >= 1) {
+          return Status::ArgumentError("HashVariableInitializer: bloom_filter_fpp should be in (0, 1) "  + iter.first + "=" + iter.second);
+        }
+      } else if (iter.first == "hashmap") {
+        backend = iter.second;
+      } else if (iter.first == "slot_precision") {
+        PS_CHECK_STATUS(ParseStoragePrecision(iter.second, &slot_precision));
+      } else if (iter.first == "tier_spill_dir") {
+        tier_spill_dir = iter.second;
+      } else if (iter.first == "tier_cold_steps") {
+        if (!StringUtils::strToUInt64(iter.second.c_str(), tier_cold_steps)) {
+          return Status::ArgumentError("HashVariableInitializer: tier_cold_steps not int "  + iter.first + "=" + iter.second);
+        }
+      } else if (iter.first == "tier_check_interval") {
+        if (!StringUtils::strToUInt64(iter.second.c_str(), tier_check_interval)) {
+          return Status::ArgumentError("HashVariableInitializer: tier_check_interval not int "  + iter.first + "=" + iter.second);
+        }
+      } else if (iter.first == "tier_max_spill") {
+        if (!StringUtils::strToUInt64(iter.second.c_str(), tier_max_spill)) {
+          return Status::ArgumentError("HashVariableInitializer: tier_max_spill not int "  + iter.first + "=" + iter.second);
+        }
+      } else if (iter.first == "evict_idle_steps") {
+        if (!StringUtils::strToUInt64(iter.second.c_str(), evict_idle_steps)) {
+          return Status::ArgumentError("HashVariableInitializer: evict_idle_steps not int "  + iter.first + "=" + iter.second);
+        }
+      } else if (iter.first == "evict_keep_count") {
+        if (!StringUtils::strToUInt64(iter.second.c_str(), evict_keep_count)) {
+          return Status::ArgumentError("HashVariableInitializer: evict_keep_count not int "  + iter.first + "=" + iter.second);
+        }
+      } else if (iter.first == "evict_scan_interval") {
+        if (!StringUtils::strToUInt64(iter.second.c_str(), evict_scan_interval)) {
+          return Status::ArgumentError("HashVariableInitializer: evict_scan_interval not int "  + iter.first + "=" + iter.second);
+        }
+      } else if (iter.first == "evict_scan_rows") {
+        if (!StringUtils::strToUInt64(iter.second.c_str(), evict_scan_rows)) {
+          return Status::ArgumentError("HashVariableInitializer: evict_scan_rows not int "  + iter.first + "=" + iter.second);
+        }
+      } else if (iter.first == "row_interleave_bytes") {
+        if (!StringUtils::strToUInt64(iter.second.c_str(), row_interleave_bytes)) {
+          return Status::ArgumentError("HashVariableInitializer: row_interleave_bytes not int "  + iter.first + "=" + iter.second);
+        }
+      } else if (iter.first == "evict_max_per_pass") {
+        if (!StringUtils::strToUInt64(iter.second.c_str(), evict_max_per_pass)) {
+          return Status::ArgumentError("HashVariableInitializer: evict_max_per_pass not int "  + iter.first + "=" + iter.second);
+        }
       }
     }
+    bool variable_bloom_filter = bloom_filter_threthold != 0 && bloom_filter_scope == "variable";
     if (bloom_filter_threthold != 0) {
-      LOG(INFO) << ctx->GetVariableName() << ", bloom_filter_threthold " << bloom_filter_threthold;
+      if (!variable_bloom_filter) {
+        GlobalBloomFilter::SetThrethold(bloom_filter_threthold);
+      }
+      LOG(INFO) << ctx->GetVariableName() << ", bloom_filter_threthold " << bloom_filter_threthold << ", bloom_filter_scope " << bloom_filter_scope;
     }
     std::string var_name = ctx->GetVariableName();
     Variable* var;
     ps::Status status = GetStorageManager(ctx)->Get(var_name, &var);
     if (!status.IsOk()) {
+      HashMap* hashmap = nullptr;
+      PS_CHECK_STATUS(CreateHashMap(backend, hash64, shape[0], &hashmap));
+      std::unique_ptr<HashMap> hashmap_holder(hashmap);
       return ctx->GetStorageManager()->Set(var_name, [&]{
-            HashMap* hashmap = nullptr;
-            if (hash64) {
-              hashmap = new HashMapImpl<int64_t>(shape[0]);
-            } else {
-              hashmap = new HashMapImpl<Hash128Key>(shape[0]);
-            }
             hashmap->SetBloomFilterThrethold(bloom_filter_threthold);
-            Variable* var = new Variable(new Tensor(dt, shape, initializer->Clone(), Tensor::TType::kSegment, true), new WrapperData<std::unique_ptr<HashMap> >(hashmap), var_name);
+            if (variable_bloom_filter) {
+              hashmap->SetBloomFilter(NewShardedBloomFilter(bloom_filter_threthold, bloom_filter_shards, bloom_filter_fpp, bloom_filter_size));
+            }
+            Tensor* data = row_interleave_bytes == 0
+                ? new Tensor(dt, shape, initializer->Clone(), Tensor::TType::kSegment, true)
+                : new Tensor(dt, shape, initializer->Clone(), true, Tensor::DEFAULT_SEGMENT_SIZE, row_interleave_bytes);
+            Variable* var = new Variable(data, new WrapperData<std::unique_ptr<HashMap> >(hashmap_holder.release()), var_name);
+            var->SetSlotPrecision(slot_precision);
+            if (!tier_spill_dir.empty()) {
+              var->SetTieredStorage(new TieredStorage(tier_spill_dir, var_name, tier_cold_steps, tier_check_interval, tier_max_spill));
+            }
+            if (evict_idle_steps != 0) {
+              var->SetHashEvictor(new HashEvictor(evict_idle_steps, evict_keep_count, evict_scan_interval, evict_scan_rows, evict_max_per_pass));
+            }
             var->SetRealInited(true);
             return var;
           });
@@ -75,6 +168,16 @@ class HashVariableInitializer : public SimpleUdf<DataType, TensorShape, std::str
       var->GetData()->SetInititalizer(initializer->Clone());
       var->GetData()->InitChunkFrom(hashmap->GetSize());
       hashmap->SetBloomFilterThrethold(bloom_filter_threthold);
+      if (variable_bloom_filter) {
+        hashmap->SetBloomFilter(NewShardedBloomFilter(bloom_filter_threthold, bloom_filter_shards, bloom_filter_fpp, bloom_filter_size));
+      }
+      var->SetSlotPrecision(slot_precision);
+      if (!tier_spill_dir.empty() && var->GetTieredStorage() == nullptr) {
+        var->SetTieredStorage(new TieredStorage(tier_spill_dir, var_name, tier_cold_steps, tier_check_interval, tier_max_spill));
+      }
+      if (evict_idle_steps != 0 && var->GetHashEvictor() == nullptr) {
+        var->SetHashEvictor(new HashEvictor(evict_idle_steps, evict_keep_count, evict_scan_interval, evict_scan_rows, evict_max_per_pass));
+      }
       var->SetRealInited(true);
       return Status::Ok();
     }
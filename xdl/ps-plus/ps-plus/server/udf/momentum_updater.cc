@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "ps-plus/server/udf/simple_udf.h"
 #include "ps-plus/server/slice.h"
+#include "ps-plus/server/reduced_slot.h"
+#include "ps-plus/server/udf/optimizer_kernels.h"
 #include "ps-plus/common/initializer/constant_initializer.h"
 #include "ps-plus/common/hashmap.h"
 
@@ -48,33 +50,39 @@ class MomentumUpdater : public SimpleUdf<vector<Slices>, vector<Tensor>, vector<
             bool use_nesterov = use_nesterovs[si];
             const Tensor& grad_tensor = grad_tensors[si];
             Tensor* data_tensor = slices.variable->GetData();
-            Tensor* acc_tensor = slices.variable->GetVariableLikeSlot("accumulation", data_tensor->Type(), []{ return new initializer::ConstantInitializer(0); });
+            ReducedSlot acc_slot;
+            PS_CHECK_STATUS(acc_slot.Init(slices.variable, "accumulation", data_tensor->Type(), 0));
             if (grad_tensor.Type() != data_tensor->Type()) {
               return Status::ArgumentError("grad should has same datatype with variable");
             }
 
             CASES(data_tensor->Type(), MultiThreadDo(slices.slice_id.size(), [&](const Range& r) {
+                      ReducedSlotRow<T> acc_row(acc_slot);
                       for (size_t i = r.begin; i < r.end; i++) {
                         int64_t slice = slices.slice_id[i];
                         if ((int64_t)slice == ps::HashMap::NOT_ADD_ID) {
                           continue;
                         }                  
+                        StripedLocker row_locker(slices.variable->RowLock(), slice);
                         T* data = data_tensor->Raw<T>(slice);
-                        T* acc = acc_tensor->Raw<T>(slice);
+                        T* acc = acc_row.Load(slice);
                         T* grad = grad_tensor.Raw<T>(i);
-                        if (use_nesterov) {
-                          for (size_t j = 0; j < slices.slice_size; j++) {
-                            *acc = *acc * momentum + *grad;
-                            *data -= *grad * learning_rate + *acc * momentum * learning_rate;
-                            data++; acc++; grad++;
-                          }
-                        } else {
-                          for (size_t j = 0; j < slices.slice_size; j++) {
-                            *acc = *acc * momentum + *grad;
-                            *data -= *acc * learning_rate;
-                            data++; acc++; grad++;
+                        if (!MomentumRow(data, acc, grad, slices.slice_size, learning_rate, momentum, use_nesterov)) {
+                          if (use_nesterov) {
+                            for (size_t j = 0; j < slices.slice_size; j++) {
+                              *acc = *acc * momentum + *grad;
+                              *data -= *grad * learning_rate + *acc * momentum * learning_rate;
+                              data++; acc++; grad++;
+                            }
+                          } else {
+                            for (size_t j = 0; j < slices.slice_size; j++) {
+                              *acc = *acc * momentum + *grad;
+                              *data -= *acc * learning_rate;
+                              data++; acc++; grad++;
+                            }
                           }
                         }
+                        acc_row.Store();
                       }
                       return Status::Ok();
                     }));
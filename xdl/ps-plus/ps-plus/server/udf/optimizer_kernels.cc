@@ -0,0 +1,50 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/server/udf/optimizer_kernels.h"
+
+#include <cstdlib>
+
+namespace ps {
+namespace server {
+namespace udf {
+
+namespace {
+
+const OptimizerKernels* DetectOptimizerKernels() {
+  if (getenv("PS_DISABLE_SIMD_KERNELS") != nullptr) {
+    return nullptr;
+  }
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return &kAvx512OptimizerKernels;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return &kAvx2OptimizerKernels;
+  }
+  return nullptr;
+}
+
+}
+
+const OptimizerKernels* GetOptimizerKernels() {
+  static const OptimizerKernels* kernels = DetectOptimizerKernels();
+  return kernels;
+}
+
+}
+}
+}
+
@@ -0,0 +1,126 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_PLUS_SERVER_UDF_OPTIMIZER_KERNELS_H_
+#define PS_PLUS_SERVER_UDF_OPTIMIZER_KERNELS_H_
+
+#include <cmath>
+#include <cstddef>
+
+namespace ps {
+namespace server {
+namespace udf {
+
+// Fused row update kernels of the sparse updaters for float variables.
+// Every kernel updates `size` elements of one row in a single pass.
+struct OptimizerKernels {
+  const char* name;
+  void (*adagrad)(float* data, float* acc, const float* grad, size_t size, float lr);
+  void (*momentum)(float* data, float* acc, const float* grad, size_t size, float lr, float momentum, bool use_nesterov);
+  // rho is 1 - decay, computed by the caller in double
+  void (*rmsprop)(float* data, float* acc, float* mom, const float* grad, size_t size, float lr, float rho, float alpha, float epsilon);
+  void (*adam)(float* data, double* m, double* v, const float* grad, size_t size, double alpha, double beta1, double beta2, double epsilon);
+  // only the learning_rate_power == -0.5 case
+  void (*ftrl)(float* data, float* acc, float* linear, const float* grad, size_t size, float lr, float l1, float l2);
+};
+
+extern const OptimizerKernels kAvx2OptimizerKernels;
+extern const OptimizerKernels kAvx512OptimizerKernels;
+
+// Kernels for the running cpu, nullptr when neither AVX-512 nor AVX2 is
+// available or PS_DISABLE_SIMD_KERNELS is set; callers then use their scalar loop.
+const OptimizerKernels* GetOptimizerKernels();
+
+template <typename T>
+inline bool AdagradRow(T* data, T* acc, const T* grad, size_t size, double lr) {
+  return false;
+}
+
+template <>
+inline bool AdagradRow<float>(float* data, float* acc, const float* grad, size_t size, double lr) {
+  const OptimizerKernels* kernels = GetOptimizerKernels();
+  if (kernels == nullptr) {
+    return false;
+  }
+  kernels->adagrad(data, acc, grad, size, lr);
+  return true;
+}
+
+template <typename T>
+inline bool MomentumRow(T* data, T* acc, const T* grad, size_t size, double lr, double momentum, bool use_nesterov) {
+  return false;
+}
+
+template <>
+inline bool MomentumRow<float>(float* data, float* acc, const float* grad, size_t size, double lr, double momentum, bool use_nesterov) {
+  const OptimizerKernels* kernels = GetOptimizerKernels();
+  if (kernels == nullptr) {
+    return false;
+  }
+  kernels->momentum(data, acc, grad, size, lr, momentum, use_nesterov);
+  return true;
+}
+
+template <typename T>
+inline bool RmspropRow(T* data, T* acc, T* mom, const T* grad, size_t size, double lr, double decay, double alpha, double epsilon) {
+  return false;
+}
+
+template <>
+inline bool RmspropRow<float>(float* data, float* acc, float* mom, const float* grad, size_t size, double lr, double decay, double alpha, double epsilon) {
+  const OptimizerKernels* kernels = GetOptimizerKernels();
+  if (kernels == nullptr) {
+    return false;
+  }
+  kernels->rmsprop(data, acc, mom, grad, size, lr, 1 - decay, alpha, epsilon);
+  return true;
+}
+
+template <typename T>
+inline bool AdamRow(T* data, double* m, double* v, const T* grad, size_t size, double alpha, double beta1, double beta2, double epsilon) {
+  return false;
+}
+
+template <>
+inline bool AdamRow<float>(float* data, double* m, double* v, const float* grad, size_t size, double alpha, double beta1, double beta2, double epsilon) {
+  const OptimizerKernels* kernels = GetOptimizerKernels();
+  if (kernels == nullptr) {
+    return false;
+  }
+  kernels->adam(data, m, v, grad, size, alpha, beta1, beta2, epsilon);
+  return true;
+}
+
+template <typename T>
+inline bool FtrlRow(T* data, T* acc, T* linear, const T* grad, size_t size, double lr, double lr_power, double l1, double l2) {
+  return false;
+}
+
+template <>
+inline bool FtrlRow<float>(float* data, float* acc, float* linear, const float* grad, size_t size, double lr, double lr_power, double l1, double l2) {
+  const OptimizerKernels* kernels = GetOptimizerKernels();
+  if (kernels == nullptr || std::fabs(lr_power + 0.5) >= 1e-6) {
+    return false;
+  }
+  kernels->ftrl(data, acc, linear, grad, size, lr, l1, l2);
+  return true;
+}
+
+}
+}
+}
+
+#endif
+
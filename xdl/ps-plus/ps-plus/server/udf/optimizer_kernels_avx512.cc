@@ -0,0 +1,86 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// The kernels are AVX-512 functions by their target attribute, only called
+// after a runtime cpu check. The file takes the common flags, so the inline
+// functions of the headers, e.g. std::sqrt, stay baseline code.
+
+#include <immintrin.h>
+
+#define PS_OPTIMIZER_KERNEL_TARGET __attribute__((target("avx512f")))
+
+#include "ps-plus/server/udf/optimizer_kernels_impl.h"
+
+namespace ps {
+namespace server {
+namespace udf {
+
+namespace {
+
+struct Avx512 {
+  typedef __m512 F;
+  typedef __m512d D;
+  static const size_t kFloatWidth = 16;
+  static const size_t kDoubleWidth = 8;
+
+  PS_OPTIMIZER_KERNEL_TARGET static inline F Set1(float v) { return _mm512_set1_ps(v); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline F Load(const float* p) { return _mm512_loadu_ps(p); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline void Store(float* p, F v) { _mm512_storeu_ps(p, v); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline F Add(F a, F b) { return _mm512_add_ps(a, b); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline F Sub(F a, F b) { return _mm512_sub_ps(a, b); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline F Mul(F a, F b) { return _mm512_mul_ps(a, b); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline F Div(F a, F b) { return _mm512_div_ps(a, b); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline F Sqrt(F a) { return _mm512_sqrt_ps(a); }
+  // a * b + c
+  PS_OPTIMIZER_KERNEL_TARGET static inline F Fmadd(F a, F b, F c) { return _mm512_fmadd_ps(a, b, c); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline F Abs(F a) { return _mm512_abs_ps(a); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline F Sign(F a) {
+    F zero = _mm512_setzero_ps();
+    F one = _mm512_set1_ps(1.0f);
+    F pos = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(a, zero, _CMP_GT_OQ), one);
+    F neg = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(a, zero, _CMP_LT_OQ), one);
+    return _mm512_sub_ps(pos, neg);
+  }
+  // a > b ? x : y
+  PS_OPTIMIZER_KERNEL_TARGET static inline F SelectGt(F a, F b, F x, F y) { return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, b, _CMP_GT_OQ), y, x); }
+
+  PS_OPTIMIZER_KERNEL_TARGET static inline D Set1D(double v) { return _mm512_set1_pd(v); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline D LoadD(const double* p) { return _mm512_loadu_pd(p); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline void StoreD(double* p, D v) { _mm512_storeu_pd(p, v); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline D CvtLoadD(const float* p) { return _mm512_cvtps_pd(_mm256_loadu_ps(p)); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline void CvtStoreD(float* p, D v) { _mm256_storeu_ps(p, _mm512_cvtpd_ps(v)); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline D AddD(D a, D b) { return _mm512_add_pd(a, b); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline D SubD(D a, D b) { return _mm512_sub_pd(a, b); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline D MulD(D a, D b) { return _mm512_mul_pd(a, b); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline D DivD(D a, D b) { return _mm512_div_pd(a, b); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline D SqrtD(D a) { return _mm512_sqrt_pd(a); }
+  PS_OPTIMIZER_KERNEL_TARGET static inline D FmaddD(D a, D b, D c) { return _mm512_fmadd_pd(a, b, c); }
+};
+
+}
+
+extern const OptimizerKernels kAvx512OptimizerKernels = {
+  "avx512",
+  &AdagradKernel<Avx512>,
+  &MomentumKernel<Avx512>,
+  &RmspropKernel<Avx512>,
+  &AdamKernel<Avx512>,
+  &FtrlKernel<Avx512>
+};
+
+}
+}
+}
+
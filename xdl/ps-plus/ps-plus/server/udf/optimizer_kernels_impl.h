@@ -0,0 +1,167 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Kernel bodies shared by optimizer_kernels_avx2.cc and optimizer_kernels_avx512.cc.
+// V provides the vector type F (floats) and D (doubles) of one instruction set;
+// the including file defines PS_OPTIMIZER_KERNEL_TARGET as the matching
+// target attribute.
+
+#ifndef PS_PLUS_SERVER_UDF_OPTIMIZER_KERNELS_IMPL_H_
+#define PS_PLUS_SERVER_UDF_OPTIMIZER_KERNELS_IMPL_H_
+
+#include "ps-plus/server/udf/optimizer_kernels.h"
+
+#include <cmath>
+
+#ifndef PS_OPTIMIZER_KERNEL_TARGET
+#error "PS_OPTIMIZER_KERNEL_TARGET should be defined by the including file"
+#endif
+
+namespace ps {
+namespace server {
+namespace udf {
+namespace {
+
+template <class V>
+PS_OPTIMIZER_KERNEL_TARGET void AdagradKernel(float* data, float* acc, const float* grad, size_t size, float lr) {
+  typedef typename V::F F;
+  F vlr = V::Set1(lr);
+  size_t j = 0;
+  for (; j + V::kFloatWidth <= size; j += V::kFloatWidth) {
+    F g = V::Load(grad + j);
+    F a = V::Fmadd(g, g, V::Load(acc + j));
+    V::Store(acc + j, a);
+    V::Store(data + j, V::Sub(V::Load(data + j), V::Div(V::Mul(g, vlr), V::Sqrt(a))));
+  }
+  for (; j < size; j++) {
+    acc[j] += grad[j] * grad[j];
+    data[j] -= grad[j] * lr / std::sqrt(acc[j]);
+  }
+}
+
+template <class V>
+PS_OPTIMIZER_KERNEL_TARGET void MomentumKernel(float* data, float* acc, const float* grad, size_t size, float lr, float momentum, bool use_nesterov) {
+  typedef typename V::F F;
+  F vlr = V::Set1(lr);
+  F vm = V::Set1(momentum);
+  size_t j = 0;
+  for (; j + V::kFloatWidth <= size; j += V::kFloatWidth) {
+    F g = V::Load(grad + j);
+    F a = V::Fmadd(V::Load(acc + j), vm, g);
+    V::Store(acc + j, a);
+    F delta = use_nesterov ? V::Mul(V::Fmadd(a, vm, g), vlr) : V::Mul(a, vlr);
+    V::Store(data + j, V::Sub(V::Load(data + j), delta));
+  }
+  for (; j < size; j++) {
+    acc[j] = acc[j] * momentum + grad[j];
+    if (use_nesterov) {
+      data[j] -= grad[j] * lr + acc[j] * momentum * lr;
+    } else {
+      data[j] -= acc[j] * lr;
+    }
+  }
+}
+
+template <class V>
+PS_OPTIMIZER_KERNEL_TARGET void RmspropKernel(float* data, float* acc, float* mom, const float* grad, size_t size, float lr, float rho, float alpha, float epsilon) {
+  typedef typename V::F F;
+  F vlr = V::Set1(lr);
+  F vrho = V::Set1(rho);
+  F valpha = V::Set1(alpha);
+  F veps = V::Set1(epsilon);
+  size_t j = 0;
+  for (; j + V::kFloatWidth <= size; j += V::kFloatWidth) {
+    F g = V::Load(grad + j);
+    F a = V::Load(acc + j);
+    a = V::Fmadd(V::Sub(V::Mul(g, g), a), vrho, a);
+    V::Store(acc + j, a);
+    F m = V::Fmadd(V::Load(mom + j), valpha, V::Div(V::Mul(g, vlr), V::Sqrt(V::Add(a, veps))));
+    V::Store(mom + j, m);
+    V::Store(data + j, V::Sub(V::Load(data + j), m));
+  }
+  for (; j < size; j++) {
+    acc[j] += (grad[j] * grad[j] - acc[j]) * rho;
+    mom[j] = mom[j] * alpha + (grad[j] * lr) / std::sqrt(acc[j] + epsilon);
+    data[j] -= mom[j];
+  }
+}
+
+template <class V>
+PS_OPTIMIZER_KERNEL_TARGET void AdamKernel(float* data, double* m, double* v, const float* grad, size_t size, double alpha, double beta1, double beta2, double epsilon) {
+  typedef typename V::D D;
+  D valpha = V::Set1D(alpha);
+  D vb1 = V::Set1D(1 - beta1);
+  D vb2 = V::Set1D(1 - beta2);
+  D veps = V::Set1D(epsilon);
+  size_t j = 0;
+  for (; j + V::kDoubleWidth <= size; j += V::kDoubleWidth) {
+    D g = V::CvtLoadD(grad + j);
+    D vm = V::LoadD(m + j);
+    D vv = V::LoadD(v + j);
+    vm = V::FmaddD(V::SubD(g, vm), vb1, vm);
+    vv = V::FmaddD(V::SubD(V::MulD(g, g), vv), vb2, vv);
+    V::StoreD(m + j, vm);
+    V::StoreD(v + j, vv);
+    D delta = V::DivD(V::MulD(valpha, vm), V::AddD(V::SqrtD(vv), veps));
+    V::CvtStoreD(data + j, V::SubD(V::CvtLoadD(data + j), delta));
+  }
+  for (; j < size; j++) {
+    double g = grad[j];
+    m[j] += (g - m[j]) * (1 - beta1);
+    v[j] += (g * g - v[j]) * (1 - beta2);
+    data[j] -= (alpha * m[j]) / (std::sqrt(v[j]) + epsilon);
+  }
+}
+
+template <class V>
+PS_OPTIMIZER_KERNEL_TARGET void FtrlKernel(float* data, float* acc, float* linear, const float* grad, size_t size, float lr, float l1, float l2) {
+  typedef typename V::F F;
+  F vinv_lr = V::Set1(1 / lr);
+  F vl1 = V::Set1(l1);
+  F vl2 = V::Set1(l2 * 2);
+  F zero = V::Set1(0);
+  size_t j = 0;
+  for (; j + V::kFloatWidth <= size; j += V::kFloatWidth) {
+    F g = V::Load(grad + j);
+    F a = V::Load(acc + j);
+    F w = V::Load(data + j);
+    F new_a = V::Fmadd(g, g, a);
+    F sqrt_new_a = V::Sqrt(new_a);
+    F l = V::Load(linear + j);
+    l = V::Add(l, V::Sub(g, V::Mul(V::Mul(V::Sub(sqrt_new_a, V::Sqrt(a)), vinv_lr), w)));
+    F x = V::Sub(V::Mul(vl1, V::Sign(l)), l);
+    F y = V::Fmadd(sqrt_new_a, vinv_lr, vl2);
+    V::Store(linear + j, l);
+    V::Store(data + j, V::SelectGt(V::Abs(l), vl1, V::Div(x, y), zero));
+    V::Store(acc + j, new_a);
+  }
+  for (; j < size; j++) {
+    float new_acc = acc[j] + grad[j] * grad[j];
+    linear[j] += grad[j] - (std::sqrt(new_acc) - std::sqrt(acc[j])) / lr * data[j];
+    float sign = (0 < linear[j]) - (linear[j] < 0);
+    float x = l1 * sign - linear[j];
+    float y = std::sqrt(new_acc) / lr + l2 * 2;
+    data[j] = std::fabs(linear[j]) > l1 ? x / y : 0;
+    acc[j] = new_acc;
+  }
+}
+
+}
+}
+}
+}
+
+#endif
+
@@ -269,8 +269,21 @@ Status PythonRunner::ParseSubTensor(
     return Status::ArgumentError("input Type Error");
   }
   int ndim = shapex.size();
-  arr->object = PyArray_SimpleNewFromData(
-      ndim, &shapex[0], type, data);
+  if (!t.Interleaved()) {
+    arr->object = PyArray_SimpleNewFromData(
+        ndim, &shapex[0], type, data);
+    return Status::Ok();
+  }
+  // the rows are apart, seen as a strided array of the rows
+  std::vector<npy_intp> strides(ndim);
+  strides[ndim - 1] = SizeOfType(arr->type);
+  for (int i = ndim - 2; i > 0; i--) {
+    strides[i] = strides[i + 1] * shapex[i + 1];
+  }
+  strides[0] = t.RowStride();
+  arr->object = PyArray_New(
+      &PyArray_Type, ndim, &shapex[0], type, &strides[0], data,
+      0, NPY_ARRAY_ALIGNED | NPY_ARRAY_WRITEABLE, nullptr);
   return Status::Ok();
 }
 
@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "ps-plus/server/udf/simple_udf.h"
 #include "ps-plus/server/slice.h"
+#include "ps-plus/server/reduced_slot.h"
+#include "ps-plus/server/udf/optimizer_kernels.h"
 #include "ps-plus/common/initializer/constant_initializer.h"
 #include "ps-plus/common/hashmap.h"
 
@@ -43,8 +45,10 @@ class RmspropUpdater : public SimpleUdf<vector<Slices>, vector<Tensor>, vector<d
         return Status::ArgumentError("slice is not writable");
       }
       Tensor* data_tensor = slices.variable->GetData();
-      Tensor* acc_tensor = slices.variable->GetVariableLikeSlot("accumulator", data_tensor->Type(), []{ return new initializer::ConstantInitializer(0); });
-      Tensor* mom_tensor = slices.variable->GetVariableLikeSlot("momentum", data_tensor->Type(), []{ return new initializer::ConstantInitializer(0); });
+      ReducedSlot acc_slot;
+      PS_CHECK_STATUS(acc_slot.Init(slices.variable, "accumulator", data_tensor->Type(), 0));
+      ReducedSlot mom_slot;
+      PS_CHECK_STATUS(mom_slot.Init(slices.variable, "momentum", data_tensor->Type(), 0));
       double learning_rate = learning_rates[si];
       double decay = decays[si];
       double alpha = alphas[si];
@@ -56,21 +60,28 @@ class RmspropUpdater : public SimpleUdf<vector<Slices>, vector<Tensor>, vector<d
       }
 
       CASES(data_tensor->Type(), MultiThreadDo(slices.slice_id.size(), [&](const Range& r) {
+                ReducedSlotRow<T> acc_row(acc_slot);
+                ReducedSlotRow<T> mom_row(mom_slot);
                 for (size_t i = r.begin; i < r.end; i++) {
                   int64_t slice = slices.slice_id[i];
                   if ((int64_t)slice == ps::HashMap::NOT_ADD_ID) {
                     continue;
                   }
+                  StripedLocker row_locker(slices.variable->RowLock(), slice);
                   T* data = data_tensor->Raw<T>(slice);
-                  T* acc = acc_tensor->Raw<T>(slice);
-                  T* mom = mom_tensor->Raw<T>(slice);
+                  T* acc = acc_row.Load(slice);
+                  T* mom = mom_row.Load(slice);
                   T* grad = grad_tensor.Raw<T>(i);
-                  for (size_t j = 0; j < slices.slice_size; j++) {
-                    *acc += (*grad * *grad - *acc) * (1 - decay);
-                    *mom = *mom * alpha + (*grad * learning_rate) / sqrt(*acc + epsilon);
-                    *data -= *mom;
-                    data++; grad++; acc++; mom++;
+                  if (!RmspropRow(data, acc, mom, grad, slices.slice_size, learning_rate, decay, alpha, epsilon)) {
+                    for (size_t j = 0; j < slices.slice_size; j++) {
+                      *acc += (*grad * *grad - *acc) * (1 - decay);
+                      *mom = *mom * alpha + (*grad * learning_rate) / sqrt(*acc + epsilon);
+                      *data -= *mom;
+                      data++; grad++; acc++; mom++;
+                    }
                   }
+                  acc_row.Store();
+                  mom_row.Store();
                 }
                 return Status::Ok();
               }));
@@ -0,0 +1,68 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ps-plus/server/udf/simple_udf.h"
+#include "ps-plus/server/slice.h"
+
+namespace ps {
+namespace server {
+namespace udf {
+
+using std::vector;
+
+// A mixed push carries the variables of several updaters in one request,
+// these pick the slices and gradients of one updater's variables out of it.
+class SelectSlices : public SimpleUdf<vector<Slices>, vector<int64_t>, vector<Slices>*> {
+ public:
+  virtual Status SimpleRun(
+      UdfContext* ctx,
+      const vector<Slices>& slices,
+      const vector<int64_t>& indices,
+      vector<Slices>* result) const {
+    result->clear();
+    for (auto index : indices) {
+      if (index < 0 || (size_t)index >= slices.size()) {
+        return Status::ArgumentError("SelectSlices: index out of range");
+      }
+      result->push_back(slices[index]);
+    }
+    return Status::Ok();
+  }
+};
+
+class SelectTensors : public SimpleUdf<vector<Tensor>, vector<int64_t>, vector<Tensor>*> {
+ public:
+  virtual Status SimpleRun(
+      UdfContext* ctx,
+      const vector<Tensor>& tensors,
+      const vector<int64_t>& indices,
+      vector<Tensor>* result) const {
+    result->clear();
+    for (auto index : indices) {
+      if (index < 0 || (size_t)index >= tensors.size()) {
+        return Status::ArgumentError("SelectTensors: index out of range");
+      }
+      result->push_back(tensors[index]);
+    }
+    return Status::Ok();
+  }
+};
+
+SIMPLE_UDF_REGISTER(SelectSlices, SelectSlices);
+SIMPLE_UDF_REGISTER(SelectTensors, SelectTensors);
+
+}
+}
+}
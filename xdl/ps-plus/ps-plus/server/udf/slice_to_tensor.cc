@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 
 #include "ps-plus/server/udf/simple_udf.h"
+#include "ps-plus/server/udf/build_hash_slice.h"
+#include "ps-plus/server/udf/fused_udf.h"
 #include "ps-plus/server/slice.h"
 #include "ps-plus/common/hashmap.h"
 
@@ -31,8 +33,10 @@ class SliceToTensor : public SimpleUdf<vector<Slices>, vector<Tensor>*> {
     std::promise<bool> ok;
     Status status = Status::Ok();    
     std::atomic<size_t> counter(sslices.size());
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(sslices.size());
     for (size_t si = 0; si < sslices.size(); si++) {
-      ThreadPool::Global()->Schedule([&, si]{
+      tasks.emplace_back([&, si]{
             const Slices& slices = sslices[si];
             const Tensor& t = *(slices.variable->GetData());
             if (slices.dim_part < 0) {
@@ -62,12 +66,14 @@ class SliceToTensor : public SimpleUdf<vector<Slices>, vector<Tensor>*> {
             CHECK_COUNTER(counter, ok);            
           });
     }
+    ThreadPool::Global()->ScheduleBatch(&tasks);
     ok.get_future().wait();
     return status;
   }
 };
 
 SIMPLE_UDF_REGISTER(SliceToTensor, SliceToTensor);
+FUSED_UDF_REGISTER(BuildHashSlice, SliceToTensor);
 
 }
 }
@@ -20,6 +20,7 @@ limitations under the License.
 #include "ps-plus/server/slice.h"
 #include "ps-plus/common/initializer/constant_initializer.h"
 #include "ps-plus/common/hashmap.h"
+#include "ps-plus/common/reduced_precision.h"
 
 using ps::server::Udf;
 using ps::server::UdfContext;
@@ -189,3 +190,43 @@ TEST(AdagradUpdater, AdagradUpdaterForHash) {
   delete ctx;
   delete udf;
 }
+
+TEST(AdagradUpdater, AdagradUpdaterReducedSlot) {
+  UdfRegistry* udf_registry = UdfRegistry::Get("AdagradUpdater");
+  Udf* udf = udf_registry->Build(std::vector<size_t>({0, 1, 2, 3}), std::vector<size_t>({}));
+  UdfContext* ctx = new UdfContext;
+  Variable* var = new Variable(new Tensor(DataType::kFloat, TensorShape({4, 8}), new ConstantInitializer(5), Tensor::TType::kSegment, true), nullptr, "");
+  var->SetSlotPrecision(ps::StoragePrecision::kBf16);
+  ctx->SetVariable(var);
+  std::vector<Slices> sv;
+  sv.push_back(Slices{.slice_size = 8, .slice_id = std::vector<size_t>({0, 2}), .dim_part = -1, .variable = var, .writable = true});
+  ctx->SetData(0, new WrapperData<std::vector<Slices> >(sv), true);
+  std::vector<Tensor> tv;
+  tv.push_back(Tensor(DataType::kFloat, TensorShape({2, 8}), new ConstantInitializer(2)));
+  ctx->SetData(1, new WrapperData<std::vector<Tensor> >(tv), true);
+  ctx->SetData(2, new WrapperData<std::vector<double> >(std::vector<double>{3}), true);
+  ctx->SetData(3, new WrapperData<std::vector<double> >(std::vector<double>{5}), true);
+  EXPECT_TRUE(udf->Run(ctx).IsOk());
+
+  std::vector<Tensor> tv2;
+  tv2.push_back(Tensor(DataType::kFloat, TensorShape({2, 8}), new ConstantInitializer(4)));
+  ctx->SetData(1, new WrapperData<std::vector<Tensor> >(tv2), true);
+  EXPECT_TRUE(udf->Run(ctx).IsOk());
+  for (size_t i = 0; i < 8; i++) {
+    EXPECT_FLOAT_EQ(0.6, *(var->GetData()->Raw<float>(0) + i));
+    EXPECT_FLOAT_EQ(0.6, *(var->GetData()->Raw<float>(2) + i));
+    EXPECT_EQ(5, *(var->GetData()->Raw<float>(1) + i));
+  }
+
+  Tensor* acc = nullptr;
+  EXPECT_TRUE(var->GetExistSlot("adagrad_accumulation", &acc).IsOk());
+  EXPECT_EQ(DataType::kInt16, acc->Type());
+  float row[8];
+  ps::DecodeRow(ps::StoragePrecision::kBf16, acc->Raw<char>(2), 8, row);
+  EXPECT_EQ(25, row[0]);
+  ps::DecodeRow(ps::StoragePrecision::kBf16, acc->Raw<char>(1), 8, row);
+  EXPECT_EQ(5, row[7]);
+  delete var;
+  delete ctx;
+  delete udf;
+}
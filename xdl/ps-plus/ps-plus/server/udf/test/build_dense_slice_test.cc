@@ -47,6 +47,11 @@ TEST(BuildDenseSlice, BuildDenseSlice) {
   EXPECT_EQ(1u, slices[0].slice_id.size());
   EXPECT_EQ(0u, slices[0].slice_id[0]);
   EXPECT_EQ(-1, slices[0].dim_part);
+  ps::VariableStats stats;
+  var->GetStats(&stats);
+  EXPECT_EQ(4u, stats.pull_rows);
+  EXPECT_EQ(32u, stats.pull_bytes);
+  EXPECT_EQ(0u, stats.push_rows);
   ctx->SetVariable(nullptr);
   EXPECT_FALSE(udf->Run(ctx).IsOk());
   delete var;
@@ -0,0 +1,134 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cmath>
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "ps-plus/server/udf/optimizer_kernels.h"
+
+using ps::server::udf::OptimizerKernels;
+
+namespace {
+
+std::vector<const OptimizerKernels*> AvailableKernels() {
+  std::vector<const OptimizerKernels*> result;
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    result.push_back(&ps::server::udf::kAvx2OptimizerKernels);
+  }
+  if (__builtin_cpu_supports("avx512f")) {
+    result.push_back(&ps::server::udf::kAvx512OptimizerKernels);
+  }
+  return result;
+}
+
+std::vector<float> Random(size_t size, float lo, float hi, int seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> dist(lo, hi);
+  std::vector<float> result(size);
+  for (auto& x : result) {
+    x = dist(gen);
+  }
+  return result;
+}
+
+const size_t kSize = 37;
+
+}
+
+TEST(OptimizerKernelsTest, Adagrad) {
+  for (auto kernels : AvailableKernels()) {
+    std::vector<float> data = Random(kSize, -1, 1, 1), acc = Random(kSize, 0.1, 1, 2), grad = Random(kSize, -1, 1, 3);
+    std::vector<float> data0 = data, acc0 = acc;
+    kernels->adagrad(&data[0], &acc[0], &grad[0], kSize, 0.1);
+    for (size_t j = 0; j < kSize; j++) {
+      acc0[j] += grad[j] * grad[j];
+      data0[j] -= grad[j] * 0.1 / sqrt(acc0[j]);
+      EXPECT_NEAR(acc0[j], acc[j], 1e-5) << kernels->name;
+      EXPECT_NEAR(data0[j], data[j], 1e-5) << kernels->name;
+    }
+  }
+}
+
+TEST(OptimizerKernelsTest, Momentum) {
+  for (auto kernels : AvailableKernels()) {
+    for (bool nesterov : {false, true}) {
+      std::vector<float> data = Random(kSize, -1, 1, 1), acc = Random(kSize, -1, 1, 2), grad = Random(kSize, -1, 1, 3);
+      std::vector<float> data0 = data, acc0 = acc;
+      kernels->momentum(&data[0], &acc[0], &grad[0], kSize, 0.1, 0.9, nesterov);
+      for (size_t j = 0; j < kSize; j++) {
+        acc0[j] = acc0[j] * 0.9 + grad[j];
+        data0[j] -= nesterov ? grad[j] * 0.1 + acc0[j] * 0.9 * 0.1 : acc0[j] * 0.1;
+        EXPECT_NEAR(acc0[j], acc[j], 1e-5) << kernels->name;
+        EXPECT_NEAR(data0[j], data[j], 1e-5) << kernels->name;
+      }
+    }
+  }
+}
+
+TEST(OptimizerKernelsTest, Rmsprop) {
+  for (auto kernels : AvailableKernels()) {
+    std::vector<float> data = Random(kSize, -1, 1, 1), acc = Random(kSize, 0, 1, 2), mom = Random(kSize, -1, 1, 4), grad = Random(kSize, -1, 1, 3);
+    std::vector<float> data0 = data, acc0 = acc, mom0 = mom;
+    kernels->rmsprop(&data[0], &acc[0], &mom[0], &grad[0], kSize, 0.1, 1 - 0.9, 0.5, 1e-6);
+    for (size_t j = 0; j < kSize; j++) {
+      acc0[j] += (grad[j] * grad[j] - acc0[j]) * (1 - 0.9);
+      mom0[j] = mom0[j] * 0.5 + (grad[j] * 0.1) / sqrt(acc0[j] + 1e-6);
+      data0[j] -= mom0[j];
+      EXPECT_NEAR(acc0[j], acc[j], 1e-5) << kernels->name;
+      EXPECT_NEAR(mom0[j], mom[j], 1e-4) << kernels->name;
+      EXPECT_NEAR(data0[j], data[j], 1e-4) << kernels->name;
+    }
+  }
+}
+
+TEST(OptimizerKernelsTest, Adam) {
+  for (auto kernels : AvailableKernels()) {
+    std::vector<float> data = Random(kSize, -1, 1, 1), grad = Random(kSize, -1, 1, 3);
+    std::vector<double> m(kSize, 0.1), v(kSize, 0.2);
+    std::vector<float> data0 = data;
+    std::vector<double> m0 = m, v0 = v;
+    kernels->adam(&data[0], &m[0], &v[0], &grad[0], kSize, 0.01, 0.9, 0.999, 1e-8);
+    for (size_t j = 0; j < kSize; j++) {
+      double g = grad[j];
+      m0[j] += (g - m0[j]) * (1 - 0.9);
+      v0[j] += (g * g - v0[j]) * (1 - 0.999);
+      data0[j] -= (0.01 * m0[j]) / (sqrt(v0[j]) + 1e-8);
+      EXPECT_NEAR(m0[j], m[j], 1e-12) << kernels->name;
+      EXPECT_NEAR(v0[j], v[j], 1e-12) << kernels->name;
+      EXPECT_FLOAT_EQ(data0[j], data[j]) << kernels->name;
+    }
+  }
+}
+
+TEST(OptimizerKernelsTest, Ftrl) {
+  for (auto kernels : AvailableKernels()) {
+    std::vector<float> data = Random(kSize, -1, 1, 1), acc = Random(kSize, 0.1, 1, 2), linear = Random(kSize, -2, 2, 4), grad = Random(kSize, -1, 1, 3);
+    std::vector<float> data0 = data, acc0 = acc, linear0 = linear;
+    kernels->ftrl(&data[0], &acc[0], &linear[0], &grad[0], kSize, 0.1, 0.5, 0.1);
+    for (size_t j = 0; j < kSize; j++) {
+      float new_acc = acc0[j] + grad[j] * grad[j];
+      linear0[j] += grad[j] - (sqrt(new_acc) - sqrt(acc0[j])) / 0.1 * data0[j];
+      float sign = (0 < linear0[j]) - (linear0[j] < 0);
+      data0[j] = fabs(linear0[j]) > 0.5 ? (0.5 * sign - linear0[j]) / (sqrt(new_acc) / 0.1 + 0.2) : 0;
+      acc0[j] = new_acc;
+      EXPECT_NEAR(acc0[j], acc[j], 1e-5) << kernels->name;
+      EXPECT_NEAR(linear0[j], linear[j], 1e-4) << kernels->name;
+      EXPECT_NEAR(data0[j], data[j], 1e-4) << kernels->name;
+    }
+  }
+}
+
@@ -0,0 +1,82 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "ps-plus/common/data.h"
+#include "ps-plus/server/udf.h"
+#include "ps-plus/server/slice.h"
+#include "ps-plus/common/initializer/constant_initializer.h"
+
+using ps::server::Udf;
+using ps::server::UdfContext;
+using ps::server::UdfRegistry;
+using ps::server::Variable;
+using ps::server::Slices;
+using ps::server::TensorSlices;
+using ps::initializer::ConstantInitializer;
+using ps::Initializer;
+using ps::DataType;
+using ps::TensorShape;
+using ps::Tensor;
+using ps::Data;
+using ps::WrapperData;
+using std::vector;
+
+TEST(SelectSlices, SelectSlices) {
+  UdfRegistry* udf_registry = UdfRegistry::Get("SelectSlices");
+  Udf* udf = udf_registry->Build(std::vector<size_t>({0, 1}), std::vector<size_t>({2}));
+  UdfContext* ctx = new UdfContext;
+  Variable* var = new Variable(new Tensor(DataType::kInt8, TensorShape({4, 8}), new ConstantInitializer(1)), nullptr, "");
+  vector<Slices> slices;
+  slices.push_back(Slices{.slice_size = 8, .slice_id = std::vector<size_t>({0}), .dim_part = -1, .variable = var, .writable = true});
+  slices.push_back(Slices{.slice_size = 8, .slice_id = std::vector<size_t>({1, 2}), .dim_part = -1, .variable = var, .writable = true});
+  slices.push_back(Slices{.slice_size = 8, .slice_id = std::vector<size_t>({3}), .dim_part = -1, .variable = var, .writable = false});
+  EXPECT_TRUE(ctx->SetData(0, new WrapperData<vector<Slices> >(slices), true).IsOk());
+  EXPECT_TRUE(ctx->SetData(1, new WrapperData<vector<int64_t> >(vector<int64_t>({2, 1})), true).IsOk());
+  EXPECT_TRUE(udf->Run(ctx).IsOk());
+  Data* output;
+  EXPECT_TRUE(ctx->GetData(2, &output).IsOk());
+  vector<Slices>& result = dynamic_cast<WrapperData<vector<Slices> >*>(output)->Internal();
+  ASSERT_EQ(2u, result.size());
+  EXPECT_EQ(3u, result[0].slice_id[0]);
+  EXPECT_FALSE(result[0].writable);
+  EXPECT_EQ(2u, result[1].slice_id.size());
+
+  EXPECT_TRUE(ctx->SetData(1, new WrapperData<vector<int64_t> >(vector<int64_t>({3})), true).IsOk());
+  EXPECT_FALSE(udf->Run(ctx).IsOk());
+  delete var;
+  delete ctx;
+  delete udf;
+}
+
+TEST(SelectTensors, SelectTensors) {
+  UdfRegistry* udf_registry = UdfRegistry::Get("SelectTensors");
+  Udf* udf = udf_registry->Build(std::vector<size_t>({0, 1}), std::vector<size_t>({2}));
+  UdfContext* ctx = new UdfContext;
+  vector<Tensor> tensors;
+  tensors.emplace_back(DataType::kFloat, TensorShape({1}), new ConstantInitializer(1));
+  tensors.emplace_back(DataType::kFloat, TensorShape({2}), new ConstantInitializer(2));
+  EXPECT_TRUE(ctx->SetData(0, new WrapperData<vector<Tensor> >(tensors), true).IsOk());
+  EXPECT_TRUE(ctx->SetData(1, new WrapperData<vector<int64_t> >(vector<int64_t>({1})), true).IsOk());
+  EXPECT_TRUE(udf->Run(ctx).IsOk());
+  Data* output;
+  EXPECT_TRUE(ctx->GetData(2, &output).IsOk());
+  vector<Tensor>& result = dynamic_cast<WrapperData<vector<Tensor> >*>(output)->Internal();
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ(2u, result[0].Shape().NumElements());
+  EXPECT_EQ(2, result[0].Raw<float>()[0]);
+  delete ctx;
+  delete udf;
+}
@@ -15,9 +15,21 @@ limitations under the License.
 
 #include "ps-plus/server/udf_manager.h"
 
+#include <algorithm>
+#include <chrono>
+
 namespace ps {
 namespace server {
 
+namespace {
+
+int64_t NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
 UdfChain::~UdfChain() {
   for (auto udf : udfs_) {
     delete udf;
@@ -38,8 +50,12 @@ Status UdfChain::BuildFromDef(const UdfChainRegister& def) {
 
   // Calculate Every Node Input
   std::vector<std::vector<size_t>> output_nodes;
+  std::vector<std::vector<size_t>> input_nodes;
+  std::vector<UdfRegistry*> udf_regs;
   size_t output_counter = 0;
   output_nodes.emplace_back();
+  input_nodes.emplace_back();
+  udf_regs.push_back(nullptr);
   for (size_t i = 0; i < input_size; i++) {
     output_nodes[0].push_back(output_counter++);
   }
@@ -70,8 +86,8 @@ Status UdfChain::BuildFromDef(const UdfChainRegister& def) {
       indexed_output.push_back(output_counter++);
     }
     output_nodes.push_back(indexed_output);
-    Udf* udf = udf_reg->Build(indexed_input, indexed_output);
-    udfs_.push_back(udf);
+    input_nodes.push_back(indexed_input);
+    udf_regs.push_back(udf_reg);
   }
 
   // Calculate Outputs
@@ -89,9 +105,51 @@ Status UdfChain::BuildFromDef(const UdfChainRegister& def) {
     }
   }
 
+  // Build Udfs, a udf only feeding the next one is fused with it when registered
+  for (std::size_t i = 1; i < def.udfs.size(); i++) {
+    std::string udf_name = def.udfs[i].udf_name;
+    UdfRegistry* udf_reg = udf_regs[i];
+    std::vector<size_t> indexed_input = input_nodes[i];
+    std::vector<size_t> indexed_output = output_nodes[i];
+    UdfRegistry* fused_reg = nullptr;
+    if (i + 1 < def.udfs.size() && Fusible(input_nodes, output_nodes, i)) {
+      fused_reg = UdfRegistry::Get(FusedUdfName(udf_name, def.udfs[i + 1].udf_name));
+    }
+    if (fused_reg != nullptr) {
+      udf_name = FusedUdfName(udf_name, def.udfs[i + 1].udf_name);
+      udf_reg = fused_reg;
+      indexed_input.insert(indexed_input.end(), input_nodes[i + 1].begin() + 1, input_nodes[i + 1].end());
+      indexed_output.insert(indexed_output.end(), output_nodes[i + 1].begin(), output_nodes[i + 1].end());
+      i++;
+    }
+    Udf* udf = udf_reg->Build(indexed_input, indexed_output);
+    udfs_.push_back(udf);
+    udf_micros_.push_back(common::MetricsCollector::Instance()->GetHistogram(
+        "udf." + udf_name + ".micros"));
+    udf_names_.push_back(udf_name);
+  }
+
   return Status::Ok();
 }
 
+bool UdfChain::Fusible(const std::vector<std::vector<size_t>>& input_nodes,
+                       const std::vector<std::vector<size_t>>& output_nodes,
+                       size_t producer) {
+  if (output_nodes[producer].size() != 1 || input_nodes[producer + 1].empty() ||
+      input_nodes[producer + 1][0] != output_nodes[producer][0]) {
+    return false;
+  }
+  // the output of producer is not stored, nothing else may read it
+  size_t id = output_nodes[producer][0];
+  for (size_t i = producer + 1; i < input_nodes.size(); i++) {
+    size_t begin = i == producer + 1 ? 1 : 0;
+    if (std::find(input_nodes[i].begin() + begin, input_nodes[i].end(), id) != input_nodes[i].end()) {
+      return false;
+    }
+  }
+  return std::find(output_ids_.begin(), output_ids_.end(), id) == output_ids_.end();
+}
+
 Status UdfChain::Process(UdfContext* ctx) {
   if (ctx->DataSize() < input_size_) {
     return Status::DataLoss("UdfChain Process Input Loss");
@@ -99,8 +157,21 @@ Status UdfChain::Process(UdfContext* ctx) {
   for (size_t i = input_size_; i < ctx->DataSize(); i++) {
     PS_CHECK_STATUS(ctx->SetData(i, nullptr, false));
   }
-  for (Udf* udf : udfs_) {
-    PS_CHECK_STATUS(udf->Run(ctx));
+  // a traced request also records the histogram timings as udf spans
+  common::TraceContext trace = common::Tracer::Current();
+  bool traced = trace.Traced() && common::Tracer::Instance()->Enabled();
+  int64_t trace_begin = traced ? common::Tracer::NowMicros() : 0;
+  int64_t begin = NowMicros();
+  for (size_t i = 0; i < udfs_.size(); i++) {
+    PS_CHECK_STATUS(udfs_[i]->Run(ctx));
+    int64_t end = NowMicros();
+    udf_micros_[i]->Record(end - begin);
+    if (traced) {
+      common::Tracer::Instance()->Record(trace, common::Tracer::NewId(), "udf", udf_names_[i],
+                                         trace_begin, trace_begin + end - begin);
+      trace_begin += end - begin;
+    }
+    begin = end;
   }
   PS_CHECK_STATUS(ctx->ProcessOutputs(output_ids_));
   return Status::Ok();
@@ -19,6 +19,8 @@ limitations under the License.
 #include "ps-plus/message/udf_chain_register.h"
 #include "ps-plus/server/udf.h"
 #include "ps-plus/common/qrw_lock.h"
+#include "ps-plus/common/metrics_collector.h"
+#include "ps-plus/common/tracer.h"
 
 namespace ps {
 namespace server {
@@ -29,7 +31,16 @@ class UdfChain {
   Status BuildFromDef(const UdfChainRegister& def);
   Status Process(UdfContext* ctx);
  private:
+  // Whether the udf producer can be fused with the next one, which is the
+  // only reader of its only output
+  bool Fusible(const std::vector<std::vector<size_t>>& input_nodes,
+               const std::vector<std::vector<size_t>>& output_nodes,
+               size_t producer);
+
   std::vector<Udf*> udfs_;
+  std::vector<common::Histogram*> udf_micros_;
+  // the names of the udf spans of a traced request
+  std::vector<std::string> udf_names_;
   std::vector<size_t> output_ids_;
   size_t input_size_;
 };
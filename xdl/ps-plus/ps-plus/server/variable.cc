@@ -14,10 +14,47 @@ limitations under the License.
 ==============================================================================*/
 
 #include "ps-plus/server/variable.h"
+#include "ps-plus/common/logging.h"
+#include "ps-plus/common/hashmap.h"
+
+#include <chrono>
 
 namespace ps {
 namespace server {
 
+int64_t Variable::NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Variable::GetStats(VariableStats* stats) {
+  stats->name = name_;
+  WrapperData<std::unique_ptr<HashMap> >* hashmap =
+      dynamic_cast<WrapperData<std::unique_ptr<HashMap> >*>(slicer_.get());
+  if (hashmap != nullptr) {
+    stats->rows = hashmap->Internal()->KeyCount();
+    stats->hashmap_bytes = hashmap->Internal()->MemoryBytes();
+  } else {
+    stats->rows = data_->Shape().IsScalar() ? 1 : data_->Shape()[0];
+    stats->hashmap_bytes = 0;
+  }
+  stats->data_bytes = data_->AllocatedBytes();
+  stats->slot_names.clear();
+  stats->slot_bytes.clear();
+  {
+    QRWLocker lock(slots_lock_, QRWLocker::kSimpleRead);
+    for (auto& item : slots_) {
+      stats->slot_names.push_back(item.first);
+      stats->slot_bytes.push_back(item.second.tensor->AllocatedBytes());
+    }
+  }
+  stats->pull_rows = pull_traffic_[0].load(std::memory_order_relaxed);
+  stats->pull_bytes = pull_traffic_[1].load(std::memory_order_relaxed);
+  stats->push_rows = push_traffic_[0].load(std::memory_order_relaxed);
+  stats->push_bytes = push_traffic_[1].load(std::memory_order_relaxed);
+  stats->micros = NowMicros() - created_micros_;
+}
+
 Tensor* Variable::GetSlot(const std::string& name, const std::function<Slot()>& slot_creator) {
   {
     QRWLocker lock(slots_lock_, QRWLocker::kSimpleRead);
@@ -38,6 +75,16 @@ Tensor* Variable::GetSlot(const std::string& name, const std::function<Slot()>&
 }
 
 Variable::Slot Variable::VariableLikeSlot(DataType type, const TensorShape& shape, Initializer* initializer) {
+  // the rows of the slot go to the bytes reserved in the data rows if they fit
+  if (data_->Interleaved()) {
+    Tensor field;
+    Status st = data_->AddRowField(type, shape, initializer->Clone(), true, &field);
+    if (st.IsOk()) {
+      delete initializer;
+      return Slot{.tensor = std::unique_ptr<Tensor>(new Tensor(std::move(field))), .joiner = kVariableLike};
+    }
+    LOG(WARNING) << name_ << ", slot is not interleaved in the rows, " << st.Msg();
+  }
   return Slot{.tensor = std::unique_ptr<Tensor>(new Tensor(type, shape, initializer, data_->TensorType(), true)), .joiner = kVariableLike};
 }
 
@@ -81,6 +128,8 @@ Status Variable::ReShapeId(size_t id) {
   if (shape.Size() == 0) {
     return Status::ArgumentError("Scalar Not Support ReShapeId");
   }
+  // slots may be created by updaters of other requests at the same time
+  QRWLocker lock(slots_lock_, QRWLocker::kSimpleRead);
   for (auto& slot : slots_) {
     if (slot.second.joiner == kVariableLike) {
       Tensor* tensor = slot.second.tensor.get();
@@ -98,14 +147,12 @@ Status Variable::ReShapeId(size_t id) {
 }
 
 void Variable::ClearIds(const std::vector<size_t>& ids) {
-  for (size_t id : ids) {
-    data_->ClearId(id);
-  }
+  dirty_rows_.Mark(ids);
+  data_->ClearIds(ids);
+  QRWLocker lock(slots_lock_, QRWLocker::kSimpleRead);
   for (auto& slot : slots_) {
     if (slot.second.joiner == kVariableLike) {
-      for (size_t id : ids) {
-        slot.second.tensor->ClearId(id);
-      }
+      slot.second.tensor->ClearIds(ids);
     }
   }
 }
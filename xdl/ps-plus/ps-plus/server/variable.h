@@ -20,6 +20,15 @@ limitations under the License.
 #include "ps-plus/common/tensor.h"
 #include "ps-plus/common/status.h"
 #include "ps-plus/common/qrw_lock.h"
+#include "ps-plus/common/reduced_precision.h"
+#include "ps-plus/common/striped_lock.h"
+#include "ps-plus/common/metrics_collector.h"
+#include "ps-plus/message/variable_stats.h"
+#include "ps-plus/server/tiered_storage.h"
+#include "ps-plus/server/hash_evictor.h"
+#include "ps-plus/server/dirty_rows.h"
+#include "ps-plus/server/lazy_rows.h"
+#include <atomic>
 #include <memory>
 #include <unordered_map>
 
@@ -37,12 +46,62 @@ class Variable {
     SlotJoiner joiner;
   };
 
-  Variable(Tensor* data, Data* slicer, std::string name): data_(data), slicer_(slicer), name_(name), real_inited_(false) {
+  Variable(Tensor* data, Data* slicer, std::string name): row_lock_(RowsOf(data)), data_(data), slicer_(slicer), name_(name), real_inited_(false), slot_precision_(StoragePrecision::kFloat), save_pins_(0), load_requests_(0), load_bytes_(0), load_micros_(0) {
+    common::MetricsCollector* metrics = common::MetricsCollector::Instance();
+    profile_micros_ = metrics->GetHistogram("variable." + name + ".micros");
+    profile_bytes_in_ = metrics->GetHistogram("variable." + name + ".bytes_in");
+    profile_bytes_out_ = metrics->GetHistogram("variable." + name + ".bytes_out");
+    created_micros_ = NowMicros();
   }
 
   // you should lock this when you process the data.
   QRWLock& VariableLock() { return variable_lock_; }
 
+  // updaters hold the stripe of a row while they modify the row and its slots
+  StripedLock& RowLock() { return row_lock_; }
+
+  // rows written since the last incremental checkpoint
+  DirtyRows& GetDirtyRows() { return dirty_rows_; }
+
+  // Held while a checkpoint writes the rows without the server lock, rows
+  // must not be freed, spilled or handed to other keys meanwhile.
+  void PinForSave() { ++save_pins_; }
+  void UnpinForSave() { --save_pins_; }
+  bool SavePinned() { return save_pins_.load() != 0; }
+
+  // Work done on the variable since the last TakeLoad, reported to the
+  // scheduler for rebalancing.
+  void AddLoad(size_t bytes, size_t micros) {
+    load_requests_.fetch_add(1, std::memory_order_relaxed);
+    load_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    load_micros_.fetch_add(micros, std::memory_order_relaxed);
+  }
+  void TakeLoad(size_t* requests, size_t* bytes, size_t* micros) {
+    *requests = load_requests_.exchange(0);
+    *bytes = load_bytes_.exchange(0);
+    *micros = load_micros_.exchange(0);
+  }
+
+  // Rows pulled from and pushed to the variable since it was created,
+  // counted by the udfs building the slices, the bytes are the data of the
+  // rows. Reported with its memory by GetStats.
+  void AddTraffic(bool push, size_t rows) {
+    const TensorShape& shape = data_->Shape();
+    size_t row_bytes = SizeOfType(data_->Type()) * (shape.IsScalar() || shape[0] == 0 ? 1 : shape.NumElements() / shape[0]);
+    std::atomic<size_t>* counts = push ? push_traffic_ : pull_traffic_;
+    counts[0].fetch_add(rows, std::memory_order_relaxed);
+    counts[1].fetch_add(rows * row_bytes, std::memory_order_relaxed);
+  }
+  // The variable lock should be read locked.
+  void GetStats(VariableStats* stats);
+
+  // Always on histograms of the requests run on the variable.
+  void Profile(size_t bytes_in, size_t bytes_out, size_t micros) {
+    profile_micros_->Record(micros);
+    profile_bytes_in_->Record(bytes_in);
+    profile_bytes_out_->Record(bytes_out);
+  }
+
   // you should use following method when VariableLock is read_locked.
   Data* GetSlicer() { return slicer_.get(); }
   Tensor* GetData() {
@@ -59,25 +118,66 @@ class Variable {
   Status ReShapeId(size_t id);
   void ClearIds(const std::vector<size_t>& id);
   std::string GetName() { return name_;}
+  static int64_t NowMicros();
   // Used for Save and Restore
   const std::unordered_map<std::string, Slot>& GetSlots() { return slots_; }
   void SetSlots(std::unordered_map<std::string, Slot>&& slots) { slots_ = std::move(slots); }
   bool RealInited() {return real_inited_;}
   void SetRealInited(bool init) {real_inited_ = init;}
+  // nullptr when the variable is kept in memory only
+  TieredStorage* GetTieredStorage() { return tiered_storage_.get(); }
+  void SetTieredStorage(TieredStorage* tiered_storage) { tiered_storage_.reset(tiered_storage); }
+  // nullptr when the idle keys are not evicted
+  HashEvictor* GetHashEvictor() { return hash_evictor_.get(); }
+  void SetHashEvictor(HashEvictor* hash_evictor) { hash_evictor_.reset(hash_evictor); }
+  // nullptr unless the rows are still being restored lazily, the rows must
+  // be Ensured before they are used
+  LazyRows* GetLazyRows() { return lazy_rows_.get(); }
+  void SetLazyRows(LazyRows* lazy_rows) { lazy_rows_.reset(lazy_rows); }
+  // Storage of optimizer slots created through ReducedSlot
+  StoragePrecision GetSlotPrecision() { return slot_precision_; }
+  void SetSlotPrecision(StoragePrecision precision) { slot_precision_ = precision; }
 
  private:
+  // rows the row lock is sized to, segment tensors grow with the ids
+  static size_t RowsOf(Tensor* data) {
+    const TensorShape& shape = data->Shape();
+    if (data->TensorType() == Tensor::TType::kSegment) {
+      return StripedLock::kMaxStripes;
+    }
+    return shape.IsScalar() ? 1 : shape[0];
+  }
+
   // There is 3 state in Variable Processor:
   // <variable_lock_.read, slots_lock_.read>
   // <variable_lock_.read, slots_lock_.write>
   // <variable_lock_.write, None>
   QRWLock variable_lock_; // Guard variable
   QRWLock slots_lock_; // Guard the slots unordered_map
+  StripedLock row_lock_; // Guard concurrent updates of one row
+  DirtyRows dirty_rows_;
 
   std::unique_ptr<Tensor> data_;
   std::unique_ptr<Data> slicer_;
   std::unordered_map<std::string, Slot> slots_;
   std::string name_;
   bool real_inited_;  
+  std::unique_ptr<TieredStorage> tiered_storage_;
+  std::unique_ptr<HashEvictor> hash_evictor_;
+  StoragePrecision slot_precision_;
+  std::atomic<size_t> save_pins_;
+  std::atomic<size_t> load_requests_;
+  std::atomic<size_t> load_bytes_;
+  std::atomic<size_t> load_micros_;
+  // rows and bytes
+  std::atomic<size_t> pull_traffic_[2] = {{0}, {0}};
+  std::atomic<size_t> push_traffic_[2] = {{0}, {0}};
+  int64_t created_micros_;
+  common::Histogram* profile_micros_;
+  common::Histogram* profile_bytes_in_;
+  common::Histogram* profile_bytes_out_;
+  // last, so the loader stops before the tensors it writes are freed
+  std::unique_ptr<LazyRows> lazy_rows_;
 };
 
 }
@@ -0,0 +1,448 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "rdma_channel.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <iostream>
+#include <random>
+
+using ps::serializer::Fragment;
+
+namespace ps {
+namespace service {
+namespace rdma {
+
+RdmaChannel::RdmaChannel(RdmaContext* context,
+                         const MessageHandler& message_handler,
+                         const DisconnectHandler& disconnect_handler)
+  : context_(context), message_handler_(message_handler),
+    disconnect_handler_(disconnect_handler), qp_(nullptr),
+    closed_(false), outstanding_(0) {
+  memset(&local_, 0, sizeof(local_));
+}
+
+RdmaChannel::~RdmaChannel() {
+  if (qp_ != nullptr) {
+    context_->RemoveChannel(qp_->qp_num);
+    ibv_destroy_qp(qp_);
+  }
+  RdmaBufferPool* pool = context_->Pool();
+  for (Work* work : recvs_) {
+    pool->Release(work->buffer);
+    delete work;
+  }
+  for (Work* work : inflight_) {
+    pool->Release(work->buffer);
+    delete work;
+  }
+  for (Work* work : backlog_) {
+    pool->Release(work->buffer);
+    delete work;
+  }
+  for (auto&& item : staged_) {
+    pool->Release(item.second);
+  }
+}
+
+bool RdmaChannel::Init() {
+  ibv_qp_init_attr init_attr;
+  memset(&init_attr, 0, sizeof(init_attr));
+  init_attr.send_cq = context_->Cq();
+  init_attr.recv_cq = context_->Cq();
+  init_attr.qp_type = IBV_QPT_RC;
+  init_attr.cap.max_send_wr = kSendDepth;
+  init_attr.cap.max_recv_wr = kRecvDepth;
+  init_attr.cap.max_send_sge = 1;
+  init_attr.cap.max_recv_sge = 1;
+  qp_ = ibv_create_qp(context_->Pd(), &init_attr);
+  if (qp_ == nullptr) {
+    std::cerr << "ibv_create_qp failed, errno " << errno << std::endl;
+    return false;
+  }
+
+  ibv_qp_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.qp_state = IBV_QPS_INIT;
+  attr.pkey_index = 0;
+  attr.port_num = context_->PortNum();
+  attr.qp_access_flags = IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_WRITE;
+  if (ibv_modify_qp(qp_, &attr, IBV_QP_STATE | IBV_QP_PKEY_INDEX | IBV_QP_PORT | IBV_QP_ACCESS_FLAGS) != 0) {
+    std::cerr << "modify qp to INIT failed, errno " << errno << std::endl;
+    return false;
+  }
+
+  ibv_port_attr port_attr;
+  if (ibv_query_port(context_->Device(), context_->PortNum(), &port_attr) != 0) {
+    std::cerr << "ibv_query_port failed" << std::endl;
+    return false;
+  }
+  ibv_gid gid;
+  if (ibv_query_gid(context_->Device(), context_->PortNum(), context_->GidIndex(), &gid) != 0) {
+    std::cerr << "ibv_query_gid failed" << std::endl;
+    return false;
+  }
+  std::random_device rd;
+  local_.qp_num = qp_->qp_num;
+  local_.psn = rd() & 0xffffff;
+  local_.lid = port_attr.lid;
+  memcpy(local_.gid, gid.raw, sizeof(local_.gid));
+
+  context_->AddChannel(qp_->qp_num, this);
+  for (int i = 0; i < kRecvDepth; i++) {
+    RdmaBuffer* buffer = context_->Pool()->Allocate(kSlotSize);
+    if (buffer == nullptr) {
+      return false;
+    }
+    Work* work = new Work{.type = Work::kRecv, .buffer = buffer, .remote_addr = 0, .remote_rkey = 0, .size = 0};
+    recvs_.push_back(work);
+    if (!PostRecv(work)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool RdmaChannel::Connect(const Endpoint& remote) {
+  ibv_port_attr port_attr;
+  if (ibv_query_port(context_->Device(), context_->PortNum(), &port_attr) != 0) {
+    std::cerr << "ibv_query_port failed" << std::endl;
+    return false;
+  }
+
+  ibv_qp_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.qp_state = IBV_QPS_RTR;
+  attr.path_mtu = port_attr.active_mtu;
+  attr.dest_qp_num = remote.qp_num;
+  attr.rq_psn = remote.psn;
+  attr.max_dest_rd_atomic = kMaxReadAtomic;
+  attr.min_rnr_timer = 12;
+  attr.ah_attr.dlid = remote.lid;
+  attr.ah_attr.sl = 0;
+  attr.ah_attr.src_path_bits = 0;
+  attr.ah_attr.port_num = context_->PortNum();
+  static const uint8_t kZeroGid[16] = {0};
+  if (memcmp(remote.gid, kZeroGid, sizeof(kZeroGid)) != 0) {
+    attr.ah_attr.is_global = 1;
+    memcpy(attr.ah_attr.grh.dgid.raw, remote.gid, sizeof(remote.gid));
+    attr.ah_attr.grh.sgid_index = context_->GidIndex();
+    attr.ah_attr.grh.hop_limit = 64;
+  }
+  if (ibv_modify_qp(qp_, &attr, IBV_QP_STATE | IBV_QP_AV | IBV_QP_PATH_MTU | IBV_QP_DEST_QPN |
+                    IBV_QP_RQ_PSN | IBV_QP_MAX_DEST_RD_ATOMIC | IBV_QP_MIN_RNR_TIMER) != 0) {
+    std::cerr << "modify qp to RTR failed, errno " << errno << std::endl;
+    return false;
+  }
+
+  memset(&attr, 0, sizeof(attr));
+  attr.qp_state = IBV_QPS_RTS;
+  attr.timeout = 14;
+  attr.retry_cnt = 7;
+  // Retry forever on receiver not ready, this is the flow control when
+  // the peer runs out of posted receive slots.
+  attr.rnr_retry = 7;
+  attr.sq_psn = local_.psn;
+  attr.max_rd_atomic = kMaxReadAtomic;
+  if (ibv_modify_qp(qp_, &attr, IBV_QP_STATE | IBV_QP_TIMEOUT | IBV_QP_RETRY_CNT |
+                    IBV_QP_RNR_RETRY | IBV_QP_SQ_PSN | IBV_QP_MAX_QP_RD_ATOMIC) != 0) {
+    std::cerr << "modify qp to RTS failed, errno " << errno << std::endl;
+    return false;
+  }
+  return true;
+}
+
+namespace {
+
+bool WriteFull(int fd, const void* buf, size_t size) {
+  const char* ptr = (const char*)buf;
+  while (size > 0) {
+    ssize_t ret = write(fd, ptr, size);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      return false;
+    }
+    ptr += ret;
+    size -= ret;
+  }
+  return true;
+}
+
+bool ReadFull(int fd, void* buf, size_t size) {
+  char* ptr = (char*)buf;
+  while (size > 0) {
+    ssize_t ret = read(fd, ptr, size);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      return false;
+    }
+    ptr += ret;
+    size -= ret;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool RdmaChannel::Handshake(int fd, bool passive) {
+  Endpoint remote;
+  char ready = 1;
+  if (passive) {
+    return ReadFull(fd, &remote, sizeof(remote))
+        && WriteFull(fd, &local_, sizeof(local_))
+        && Connect(remote)
+        && WriteFull(fd, &ready, sizeof(ready));
+  } else {
+    return WriteFull(fd, &local_, sizeof(local_))
+        && ReadFull(fd, &remote, sizeof(remote))
+        && Connect(remote)
+        && ReadFull(fd, &ready, sizeof(ready));
+  }
+}
+
+bool RdmaChannel::Send(const std::vector<Fragment>& frags) {
+  size_t size = 0;
+  for (auto&& frag : frags) {
+    size += frag.size;
+  }
+  if (size <= kInlineSize) {
+    RdmaBuffer* buffer = context_->Pool()->Allocate(kSlotSize);
+    if (buffer == nullptr) {
+      return false;
+    }
+    Control* control = (Control*)(void*)buffer->base;
+    control->type = kInline;
+    control->rkey = 0;
+    control->addr = 0;
+    control->size = size;
+    char* ptr = buffer->base + sizeof(Control);
+    for (auto&& frag : frags) {
+      memcpy(ptr, frag.base, frag.size);
+      ptr += frag.size;
+    }
+    Post(new Work{.type = Work::kSend, .buffer = buffer, .remote_addr = 0, .remote_rkey = 0,
+                  .size = sizeof(Control) + size});
+    return !closed_;
+  }
+
+  RdmaBuffer* staged = context_->Pool()->Allocate(size);
+  if (staged == nullptr) {
+    return false;
+  }
+  char* ptr = staged->base;
+  for (auto&& frag : frags) {
+    memcpy(ptr, frag.base, frag.size);
+    ptr += frag.size;
+  }
+  uint64_t addr = reinterpret_cast<uint64_t>(staged->base);
+  {
+    std::unique_lock<std::mutex> lock(staged_mu_);
+    staged_[addr] = staged;
+  }
+  Control control{.type = kRendezvous, .rkey = staged->mr->rkey, .addr = addr, .size = size};
+  return SendControl(control);
+}
+
+bool RdmaChannel::SendControl(const Control& control) {
+  RdmaBuffer* buffer = context_->Pool()->Allocate(sizeof(Control));
+  if (buffer == nullptr) {
+    return false;
+  }
+  memcpy(buffer->base, &control, sizeof(Control));
+  Post(new Work{.type = Work::kSend, .buffer = buffer, .remote_addr = 0, .remote_rkey = 0,
+                .size = sizeof(Control)});
+  return !closed_;
+}
+
+bool RdmaChannel::PostRecv(Work* work) {
+  ibv_sge sge;
+  sge.addr = reinterpret_cast<uint64_t>(work->buffer->base);
+  sge.length = kSlotSize;
+  sge.lkey = work->buffer->mr->lkey;
+  ibv_recv_wr wr;
+  memset(&wr, 0, sizeof(wr));
+  wr.wr_id = reinterpret_cast<uint64_t>(work);
+  wr.sg_list = &sge;
+  wr.num_sge = 1;
+  ibv_recv_wr* bad_wr;
+  if (ibv_post_recv(qp_, &wr, &bad_wr) != 0) {
+    std::cerr << "ibv_post_recv failed, errno " << errno << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void RdmaChannel::Post(Work* work) {
+  std::unique_lock<std::mutex> lock(send_mu_);
+  if (closed_) {
+    context_->Pool()->Release(work->buffer);
+    delete work;
+    return;
+  }
+  if (outstanding_ < kSendDepth) {
+    PostLocked(work);
+  } else {
+    backlog_.push_back(work);
+  }
+}
+
+void RdmaChannel::PostLocked(Work* work) {
+  ibv_sge sge;
+  sge.addr = reinterpret_cast<uint64_t>(work->buffer->base);
+  sge.length = work->size;
+  sge.lkey = work->buffer->mr->lkey;
+  ibv_send_wr wr;
+  memset(&wr, 0, sizeof(wr));
+  wr.wr_id = reinterpret_cast<uint64_t>(work);
+  wr.sg_list = &sge;
+  wr.num_sge = 1;
+  wr.send_flags = IBV_SEND_SIGNALED;
+  if (work->type == Work::kRead) {
+    wr.opcode = IBV_WR_RDMA_READ;
+    wr.wr.rdma.remote_addr = work->remote_addr;
+    wr.wr.rdma.rkey = work->remote_rkey;
+  } else {
+    wr.opcode = IBV_WR_SEND;
+  }
+  ibv_send_wr* bad_wr;
+  if (ibv_post_send(qp_, &wr, &bad_wr) != 0) {
+    std::cerr << "ibv_post_send failed, errno " << errno << std::endl;
+    context_->Pool()->Release(work->buffer);
+    delete work;
+    return;
+  }
+  inflight_.insert(work);
+  outstanding_++;
+}
+
+void RdmaChannel::HandleCompletion(const ibv_wc& wc) {
+  Work* work = reinterpret_cast<Work*>(wc.wr_id);
+  if (work->type != Work::kRecv) {
+    std::unique_lock<std::mutex> lock(send_mu_);
+    inflight_.erase(work);
+    outstanding_--;
+    while (!closed_ && !backlog_.empty() && outstanding_ < kSendDepth) {
+      Work* next = backlog_.front();
+      backlog_.pop_front();
+      PostLocked(next);
+    }
+  }
+  if (wc.status != IBV_WC_SUCCESS) {
+    if (!closed_) {
+      std::cerr << "rdma completion error: " << ibv_wc_status_str(wc.status) << std::endl;
+    }
+    if (work->type != Work::kRecv) {
+      context_->Pool()->Release(work->buffer);
+      delete work;
+    }
+    Disconnect();
+    return;
+  }
+
+  switch (work->type) {
+  case Work::kSend: {
+    context_->Pool()->Release(work->buffer);
+    delete work;
+    break;
+  }
+  case Work::kRead: {
+    Control ack{.type = kReadDone, .rkey = 0, .addr = work->remote_addr, .size = 0};
+    SendControl(ack);
+    RdmaBuffer* message = work->buffer;
+    size_t size = work->size;
+    delete work;
+    message_handler_(this, message, size);
+    break;
+  }
+  case Work::kRecv: {
+    Control control = *(Control*)(void*)work->buffer->base;
+    if (control.type == kInline) {
+      RdmaBuffer* message = context_->Pool()->Allocate(control.size);
+      if (message == nullptr) {
+        Disconnect();
+        return;
+      }
+      memcpy(message->base, work->buffer->base + sizeof(Control), control.size);
+      if (!PostRecv(work)) {
+        context_->Pool()->Release(message);
+        Disconnect();
+        return;
+      }
+      message_handler_(this, message, control.size);
+    } else if (control.type == kRendezvous) {
+      if (!PostRecv(work)) {
+        Disconnect();
+        return;
+      }
+      RdmaBuffer* buffer = context_->Pool()->Allocate(control.size);
+      if (buffer == nullptr) {
+        Disconnect();
+        return;
+      }
+      Post(new Work{.type = Work::kRead, .buffer = buffer, .remote_addr = control.addr,
+                    .remote_rkey = control.rkey, .size = control.size});
+    } else if (control.type == kReadDone) {
+      RdmaBuffer* staged = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(staged_mu_);
+        auto iter = staged_.find(control.addr);
+        if (iter != staged_.end()) {
+          staged = iter->second;
+          staged_.erase(iter);
+        }
+      }
+      context_->Pool()->Release(staged);
+      if (!PostRecv(work)) {
+        Disconnect();
+        return;
+      }
+    } else {
+      std::cerr << "unknown rdma control type " << control.type << std::endl;
+      Disconnect();
+    }
+    break;
+  }
+  }
+}
+
+void RdmaChannel::Disconnect() {
+  if (closed_.exchange(true)) {
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(send_mu_);
+    for (Work* work : backlog_) {
+      context_->Pool()->Release(work->buffer);
+      delete work;
+    }
+    backlog_.clear();
+  }
+  // Move the queue pair to error so the outstanding requests are flushed.
+  ibv_qp_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.qp_state = IBV_QPS_ERR;
+  ibv_modify_qp(qp_, &attr, IBV_QP_STATE);
+  disconnect_handler_(this);
+}
+
+} // namespace rdma
+} // namespace service
+} // namespace ps
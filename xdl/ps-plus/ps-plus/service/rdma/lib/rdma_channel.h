@@ -0,0 +1,136 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_SERVICE_RDMA_LIB_RDMA_CHANNEL_H_
+#define PS_SERVICE_RDMA_LIB_RDMA_CHANNEL_H_
+
+#include <infiniband/verbs.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "ps-plus/common/serializer.h"
+#include "rdma_context.h"
+
+namespace ps {
+namespace service {
+namespace rdma {
+
+// A reliable connected queue pair carrying framed messages.
+//
+// Messages up to kInlineSize are sent two-sided into receive slots posted
+// by the peer. Larger messages are staged once in registered memory and
+// announced to the peer, which pulls them with a one-sided RDMA READ and
+// acks, so the tensor payload never passes through the sender's cpu again.
+class RdmaChannel {
+ public:
+  // Address of a queue pair, exchanged over tcp when connecting.
+  struct Endpoint {
+    uint32_t qp_num;
+    uint32_t psn;
+    uint16_t lid;
+    uint8_t gid[16];
+  };
+
+  // Called on the poller thread with a whole message. The handler takes
+  // the buffer and releases it to the context pool when done with it.
+  using MessageHandler = std::function<void(RdmaChannel* channel, RdmaBuffer* message, size_t size)>;
+  using DisconnectHandler = std::function<void(RdmaChannel* channel)>;
+
+  RdmaChannel(RdmaContext* context,
+              const MessageHandler& message_handler,
+              const DisconnectHandler& disconnect_handler);
+  ~RdmaChannel();
+
+  bool Init();
+  bool Connect(const Endpoint& remote);
+  // Exchanges endpoints over the connected tcp socket fd and connects,
+  // returns once both queue pairs are ready to receive.
+  bool Handshake(int fd, bool passive);
+  const Endpoint& Local() const { return local_; }
+  RdmaContext* Context() { return context_; }
+  bool Closed() { return closed_; }
+
+  // Copies the fragments into registered memory and sends them as one message.
+  bool Send(const std::vector<ps::serializer::Fragment>& frags);
+
+  void HandleCompletion(const ibv_wc& wc);
+
+  static constexpr size_t kSlotSize = 16 * 1024;
+  static constexpr int kRecvDepth = 128;
+  static constexpr int kSendDepth = 512;
+  static constexpr int kMaxReadAtomic = 16;
+
+ private:
+  enum ControlType : uint32_t {
+    kInline = 0,
+    kRendezvous = 1,
+    kReadDone = 2
+  };
+
+  struct Control {
+    uint32_t type;
+    uint32_t rkey;
+    uint64_t addr;
+    uint64_t size;
+  };
+
+  struct Work {
+    enum Type { kRecv, kSend, kRead };
+    Type type;
+    RdmaBuffer* buffer;
+    uint64_t remote_addr;
+    uint32_t remote_rkey;
+    uint64_t size;
+  };
+
+  static constexpr size_t kInlineSize = kSlotSize - sizeof(Control);
+
+  bool PostRecv(Work* work);
+  bool SendControl(const Control& control);
+  void Post(Work* work);
+  void PostLocked(Work* work);
+  void Disconnect();
+
+  RdmaContext* context_;
+  MessageHandler message_handler_;
+  DisconnectHandler disconnect_handler_;
+  ibv_qp* qp_;
+  Endpoint local_;
+  std::atomic<bool> closed_;
+
+  std::vector<Work*> recvs_;
+
+  // Send queue entries are bounded by kSendDepth, the rest wait in backlog_.
+  std::mutex send_mu_;
+  int outstanding_;
+  std::set<Work*> inflight_;
+  std::deque<Work*> backlog_;
+
+  // Staged messages waiting for the peer's kReadDone, by address.
+  std::mutex staged_mu_;
+  std::unordered_map<uint64_t, RdmaBuffer*> staged_;
+};
+
+} // namespace rdma
+} // namespace service
+} // namespace ps
+
+#endif // PS_SERVICE_RDMA_LIB_RDMA_CHANNEL_H_
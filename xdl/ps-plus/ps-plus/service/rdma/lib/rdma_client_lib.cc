@@ -0,0 +1,260 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "rdma_client_lib.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <iostream>
+
+#include "ps-plus/common/data.h"
+#include "ps-plus/service/seastar/lib/callback_closure.h"
+#include "ps-plus/service/seastar/lib/common.h"
+
+using ps::serializer::Fragment;
+using ps::service::seastar::CallBackClosure;
+using ps::service::seastar::SeastarStatus;
+
+namespace ps {
+namespace service {
+namespace rdma {
+
+RdmaClientConnection::RdmaClientConnection(RdmaContext* context) {
+  channel_.reset(new RdmaChannel(
+      context,
+      [this](RdmaChannel* channel, RdmaBuffer* message, size_t size) {
+        Process(message, size);
+      },
+      [this](RdmaChannel* channel) {
+        Close();
+      }));
+}
+
+RdmaClientConnection::~RdmaClientConnection() {
+  Close();
+  channel_.reset();
+}
+
+bool RdmaClientConnection::Connect(const std::string& host_str, int port) {
+  hostent* host = gethostbyname(host_str.c_str());
+  if (host == nullptr) {
+    return false;
+  }
+  sockaddr_in addr;
+  bzero((char *) &addr, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr = *((struct in_addr *)host->h_addr);
+  int sd = ::socket(PF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sd < 0) {
+    return false;
+  }
+  bool ok = connect(sd, (const struct sockaddr*)&addr, sizeof(addr)) == 0
+      && channel_->Init()
+      && channel_->Handshake(sd, false);
+  close(sd);
+  return ok;
+}
+
+bool RdmaClientConnection::Closed() {
+  return channel_->Closed();
+}
+
+void RdmaClientConnection::Close() {
+  std::set<Closure*> closures;
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    closures.swap(closures_);
+  }
+  for (auto closure : closures) {
+    CallBackClosure* cb = dynamic_cast<CallBackClosure*>(closure);
+    cb->SetStatus(SeastarStatus::NetworkError());
+    cb->Run();
+  }
+}
+
+void RdmaClientConnection::Request(
+    int32_t func_id, const std::vector<Data*>& datas,
+    Closure* closure, bool delete_request_data) {
+  ps::coding::MessageHeader header;
+  memset(&header, 0, sizeof(header));
+  ps::serializer::MemGuard mem;
+  std::vector<Fragment> frags;
+  header.mSequence = reinterpret_cast<uint64_t>(closure);
+  header.mProcessorClassId = ps::service::seastar::SEASTAR_REQUEST_PROCESSOR_ID;
+  header.mMetaBufferSize = sizeof(uint64_t) + sizeof(int32_t) + sizeof(size_t) * datas.size();
+  char* meta = mem.AllocateBuffer(header.mMetaBufferSize);
+  *(uint64_t*)(void*)meta = func_id;
+  SeastarStatus status;
+  frags.push_back(Fragment((char*)(void*)&header, sizeof(header)));
+  frags.push_back(Fragment(meta, header.mMetaBufferSize));
+  for (size_t i = 0; i < datas.size(); i++) {
+    ps::Status st = ps::serializer::SerializeAny<ps::Data>(datas[i], ((uint64_t*)(void*)(meta + 12)) + i, &frags, mem);
+    if (!st.IsOk()) {
+      std::cerr << st.ToString() << std::endl;
+      status = SeastarStatus::ClientSerializeFailed();
+      break;
+    }
+  }
+  *(uint32_t*)(void*)(meta + 8) = status.Code();
+  size_t data_size = 0;
+  for (size_t i = 2; i < frags.size(); i++) {
+    data_size += frags[i].size;
+  }
+  header.mDataBufferSize = data_size;
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    closures_.insert(closure);
+  }
+  bool sent = !channel_->Closed() && channel_->Send(frags);
+  if (delete_request_data) {
+    for (auto data : datas) {
+      delete data;
+    }
+  }
+  if (!sent) {
+    size_t erased;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      erased = closures_.erase(closure);
+    }
+    if (erased != 0) {
+      CallBackClosure* cb = dynamic_cast<CallBackClosure*>(closure);
+      cb->SetStatus(SeastarStatus::NetworkError());
+      cb->Run();
+    }
+  }
+}
+
+void RdmaClientConnection::Process(RdmaBuffer* message, size_t size) {
+  ps::coding::MessageHeader* header = (ps::coding::MessageHeader*)(void*)message->base;
+  int meta_size = header->mMetaBufferSize;
+  int data_size = header->mDataBufferSize;
+  char* meta_buf = message->base + sizeof(ps::coding::MessageHeader);
+  char* data_buf = meta_buf + meta_size;
+  SeastarStatus status((SeastarStatus::ErrorCode)(*(int32_t*)(void*)meta_buf));
+  ps::serializer::MemGuard mem_guard;
+  size_t serializer_size = (meta_size - sizeof(int32_t)) / sizeof(size_t);
+  size_t* serializer_ids = (size_t*)(void*)(meta_buf + sizeof(int32_t));
+  std::vector<Data*> datas;
+  size_t offset = 0;
+  ps::serializer::Fragment buf;
+  buf.base = data_buf;
+  buf.size = data_size;
+  for (size_t i = 0 ; i < serializer_size; i++) {
+    ps::Data* data = nullptr;
+    size_t len;
+    Status st = ps::serializer::DeserializeAny<ps::Data>(serializer_ids[i], &buf, offset, &data, &len, mem_guard);
+    if (!st.IsOk()) {
+      status = SeastarStatus::ClientDeserializeFailed();
+      break;
+    }
+
+    offset += len;
+    datas.push_back(data);
+  }
+
+  Closure* closure = reinterpret_cast<Closure*>(header->mSequence);
+  size_t erased;
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    erased = closures_.erase(closure);
+  }
+  if (erased != 0) {
+    CallBackClosure* cb = dynamic_cast<CallBackClosure*>(closure);
+    cb->SetResponseData(datas);
+    cb->SetMemGuard(mem_guard);
+    cb->SetStatus(status);
+    cb->Run();
+  }
+  for (auto data : datas) {
+    delete data;
+  }
+  channel_->Context()->Pool()->Release(message);
+}
+
+RdmaClientLib::RdmaClientLib(const std::vector<ServerAddr>& server_addrs,
+                             int user_thread_num,
+                             int core_num,
+                             size_t timeout)
+  : fallback_(server_addrs, user_thread_num, core_num, timeout) {
+}
+
+bool RdmaClientLib::Start() {
+  fallback_.Start();
+  context_.reset(new RdmaContext);
+  if (!context_->Init()) {
+    std::cerr << "rdma device not available, requests use tcp" << std::endl;
+    context_.reset();
+  }
+  return true;
+}
+
+void RdmaClientLib::Stop() {
+  if (context_ != nullptr) {
+    context_->Stop();
+  }
+  conns_.clear();
+  context_.reset();
+  fallback_.Stop();
+}
+
+void RdmaClientLib::Request(
+    int32_t server_id,
+    int32_t func_id,
+    const std::vector<ps::Data*>& request_datas,
+    Closure* closure,
+    bool delete_request_data) {
+  if ((size_t)server_id < conns_.size() && conns_[server_id] != nullptr
+      && !conns_[server_id]->Closed()) {
+    conns_[server_id]->Request(func_id, request_datas, closure, delete_request_data);
+  } else {
+    fallback_.Request(server_id, func_id, request_datas, closure, delete_request_data);
+  }
+}
+
+bool RdmaClientLib::Connect(
+    const int32_t server_id,
+    const std::string& server_addr) {
+  if (!fallback_.Connect(server_id, server_addr)) {
+    return false;
+  }
+  conns_.resize(std::max(conns_.size(), (size_t)server_id + 1));
+  conns_[server_id].reset();
+  if (context_ == nullptr) {
+    return true;
+  }
+  size_t pos = server_addr.find(':');
+  std::string host = server_addr.substr(0, pos);
+  int port = atoi(server_addr.substr(pos + 1).c_str()) + kRdmaPortOffset;
+  std::unique_ptr<RdmaClientConnection> conn(new RdmaClientConnection(context_.get()));
+  if (conn->Connect(host, port)) {
+    conns_[server_id] = std::move(conn);
+  }
+  return true;
+}
+
+int RdmaClientLib::CheckServer() {
+  // A broken rdma connection falls back to tcp, so the tcp connections
+  // alone decide whether a server is lost.
+  return fallback_.CheckServer();
+}
+
+} // namespace rdma
+} // namespace service
+} // namespace ps
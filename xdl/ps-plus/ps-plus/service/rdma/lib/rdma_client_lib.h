@@ -0,0 +1,91 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_SERVICE_RDMA_LIB_RDMA_CLIENT_LIB_H_
+#define PS_SERVICE_RDMA_LIB_RDMA_CLIENT_LIB_H_
+
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "ps-plus/service/seastar/lib/event_client_lib.h"
+#include "rdma_channel.h"
+#include "rdma_context.h"
+
+namespace ps {
+class Data;
+}
+
+namespace ps {
+namespace service {
+namespace rdma {
+
+using ps::service::seastar::Closure;
+
+class RdmaClientConnection {
+ public:
+  explicit RdmaClientConnection(RdmaContext* context);
+  ~RdmaClientConnection();
+  bool Connect(const std::string& host, int port);
+  bool Closed();
+  void Close();
+  void Request(int32_t func_id, const std::vector<Data*>& datas,
+               Closure* closure, bool delete_request_data);
+ private:
+  void Process(RdmaBuffer* message, size_t size);
+
+  std::unique_ptr<RdmaChannel> channel_;
+  std::mutex mu_;
+  std::set<Closure*> closures_;
+};
+
+// Same interface as EventClientLib. Every server keeps its tcp connection,
+// which serves the scheduler, servers started without rdma and liveness
+// checks; requests go over rdma when the handshake on port + kRdmaPortOffset
+// succeeded.
+class RdmaClientLib {
+ public:
+  using ServerAddr = std::tuple<int64_t, std::string>;
+  RdmaClientLib(const std::vector<ServerAddr>& server_addrs,
+                int user_thread_num,
+                int core_num,
+                size_t timeout = 0);
+
+  bool Start();
+  void Stop();
+  void Request(int32_t server_id,
+               int32_t func_id,
+               const std::vector<ps::Data*>& request_datas,
+               Closure* closure,
+               bool delete_request_data = true);
+
+  bool Connect(const int32_t server_id,
+               const std::string& server_addr);
+
+  int CheckServer();
+ private:
+  ps::service::seastar::EventClientLib fallback_;
+  std::unique_ptr<RdmaContext> context_;
+  std::vector<std::unique_ptr<RdmaClientConnection>> conns_;
+};
+
+} // namespace rdma
+} // namespace service
+} // namespace ps
+
+#endif // PS_SERVICE_RDMA_LIB_RDMA_CLIENT_LIB_H_
@@ -0,0 +1,236 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "rdma_context.h"
+#include "rdma_channel.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+
+#include "ps-plus/common/net_utils.h"
+
+namespace ps {
+namespace service {
+namespace rdma {
+
+RdmaBufferPool::~RdmaBufferPool() {
+  for (auto&& bucket : buckets_) {
+    for (RdmaBuffer* buffer : bucket) {
+      ibv_dereg_mr(buffer->mr);
+      delete [] buffer->base;
+      delete buffer;
+    }
+  }
+}
+
+RdmaBuffer* RdmaBufferPool::Allocate(size_t size) {
+  int bucket = kMinBucket;
+  while (bucket < kBucketCount - 1 && ((size_t)1 << bucket) < size) {
+    bucket++;
+  }
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    if (!buckets_[bucket].empty()) {
+      RdmaBuffer* buffer = buckets_[bucket].back();
+      buckets_[bucket].pop_back();
+      return buffer;
+    }
+  }
+  size_t capacity = (size_t)1 << bucket;
+  char* base = new char[capacity];
+  ibv_mr* mr = ibv_reg_mr(pd_, base, capacity,
+      IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_WRITE);
+  if (mr == nullptr) {
+    std::cerr << "ibv_reg_mr failed, size " << capacity << ", errno " << errno << std::endl;
+    delete [] base;
+    return nullptr;
+  }
+  return new RdmaBuffer{.base = base, .capacity = capacity, .mr = mr};
+}
+
+void RdmaBufferPool::Release(RdmaBuffer* buffer) {
+  if (buffer == nullptr) {
+    return;
+  }
+  int bucket = kMinBucket;
+  while (((size_t)1 << bucket) < buffer->capacity) {
+    bucket++;
+  }
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    if (buckets_[bucket].size() < kMaxCachedPerBucket) {
+      buckets_[bucket].push_back(buffer);
+      return;
+    }
+  }
+  ibv_dereg_mr(buffer->mr);
+  delete [] buffer->base;
+  delete buffer;
+}
+
+RdmaContext::RdmaContext()
+  : device_(nullptr), pd_(nullptr), comp_channel_(nullptr), cq_(nullptr),
+    port_num_(1), gid_index_(0), stop_(false) {
+}
+
+RdmaContext::~RdmaContext() {
+  Stop();
+  pool_.reset();
+  if (cq_ != nullptr) {
+    ibv_destroy_cq(cq_);
+  }
+  if (comp_channel_ != nullptr) {
+    ibv_destroy_comp_channel(comp_channel_);
+  }
+  if (pd_ != nullptr) {
+    ibv_dealloc_pd(pd_);
+  }
+  if (device_ != nullptr) {
+    ibv_close_device(device_);
+  }
+}
+
+bool RdmaContext::Init() {
+  std::string device_name = ps::NetUtils::GetEnv("PS_RDMA_DEVICE");
+  std::string port = ps::NetUtils::GetEnv("PS_RDMA_PORT");
+  std::string gid_index = ps::NetUtils::GetEnv("PS_RDMA_GID_INDEX");
+  if (!port.empty()) {
+    port_num_ = atoi(port.c_str());
+  }
+  if (!gid_index.empty()) {
+    gid_index_ = atoi(gid_index.c_str());
+  }
+
+  int num = 0;
+  ibv_device** devices = ibv_get_device_list(&num);
+  if (devices == nullptr || num == 0) {
+    if (devices != nullptr) {
+      ibv_free_device_list(devices);
+    }
+    return false;
+  }
+  ibv_device* device = nullptr;
+  for (int i = 0; i < num; i++) {
+    if (device_name.empty() || device_name == ibv_get_device_name(devices[i])) {
+      device = devices[i];
+      break;
+    }
+  }
+  if (device != nullptr) {
+    device_ = ibv_open_device(device);
+  }
+  ibv_free_device_list(devices);
+  if (device_ == nullptr) {
+    std::cerr << "rdma device [" << device_name << "] open failed" << std::endl;
+    return false;
+  }
+
+  pd_ = ibv_alloc_pd(device_);
+  if (pd_ == nullptr) {
+    std::cerr << "ibv_alloc_pd failed" << std::endl;
+    return false;
+  }
+  comp_channel_ = ibv_create_comp_channel(device_);
+  if (comp_channel_ == nullptr) {
+    std::cerr << "ibv_create_comp_channel failed" << std::endl;
+    return false;
+  }
+  int flags = fcntl(comp_channel_->fd, F_GETFL);
+  if (fcntl(comp_channel_->fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+    std::cerr << "set comp channel nonblock failed" << std::endl;
+    return false;
+  }
+  cq_ = ibv_create_cq(device_, kCqDepth, nullptr, comp_channel_, 0);
+  if (cq_ == nullptr) {
+    std::cerr << "ibv_create_cq failed" << std::endl;
+    return false;
+  }
+  pool_.reset(new RdmaBufferPool(pd_));
+  poller_.reset(new std::thread([this]{ Poll(); }));
+  return true;
+}
+
+void RdmaContext::Stop() {
+  stop_ = true;
+  if (poller_ != nullptr) {
+    poller_->join();
+    poller_.reset();
+  }
+}
+
+void RdmaContext::AddChannel(uint32_t qp_num, RdmaChannel* channel) {
+  std::unique_lock<std::mutex> lock(mu_);
+  channels_[qp_num] = channel;
+}
+
+void RdmaContext::RemoveChannel(uint32_t qp_num) {
+  std::unique_lock<std::mutex> lock(mu_);
+  channels_.erase(qp_num);
+}
+
+void RdmaContext::Poll() {
+  static constexpr int kPollBatch = 32;
+  ibv_wc wcs[kPollBatch];
+  auto drain = [&] {
+    while (true) {
+      int n = ibv_poll_cq(cq_, kPollBatch, wcs);
+      if (n < 0) {
+        std::cerr << "ibv_poll_cq failed" << std::endl;
+        abort();
+      }
+      for (int i = 0; i < n; i++) {
+        RdmaChannel* channel = nullptr;
+        {
+          std::unique_lock<std::mutex> lock(mu_);
+          auto iter = channels_.find(wcs[i].qp_num);
+          if (iter != channels_.end()) {
+            channel = iter->second;
+          }
+        }
+        if (channel != nullptr) {
+          channel->HandleCompletion(wcs[i]);
+        }
+      }
+      if (n < kPollBatch) {
+        break;
+      }
+    }
+  };
+  while (!stop_) {
+    drain();
+    if (ibv_req_notify_cq(cq_, 0) != 0) {
+      std::cerr << "ibv_req_notify_cq failed" << std::endl;
+      abort();
+    }
+    // Completions arrived between the drain and the notify request would
+    // not raise an event, so drain once more before sleeping.
+    drain();
+    pollfd fd{.fd = comp_channel_->fd, .events = POLLIN, .revents = 0};
+    if (poll(&fd, 1, 100) > 0) {
+      ibv_cq* cq;
+      void* ctx;
+      if (ibv_get_cq_event(comp_channel_, &cq, &ctx) == 0) {
+        ibv_ack_cq_events(cq, 1);
+      }
+    }
+  }
+}
+
+} // namespace rdma
+} // namespace service
+} // namespace ps
@@ -0,0 +1,110 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_SERVICE_RDMA_LIB_RDMA_CONTEXT_H_
+#define PS_SERVICE_RDMA_LIB_RDMA_CONTEXT_H_
+
+#include <infiniband/verbs.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ps {
+namespace service {
+namespace rdma {
+
+class RdmaChannel;
+
+// The rdma handshake listens on the tcp service port plus this offset.
+const int kRdmaPortOffset = 1;
+
+// A buffer registered with the protection domain, readable by the peer.
+struct RdmaBuffer {
+  char* base;
+  size_t capacity;
+  ibv_mr* mr;
+};
+
+// Registered buffers bucketed by power-of-two capacity, so the staging
+// memory for tensors is registered once and reused across requests.
+class RdmaBufferPool {
+ public:
+  explicit RdmaBufferPool(ibv_pd* pd) : pd_(pd) {}
+  ~RdmaBufferPool();
+  RdmaBuffer* Allocate(size_t size);
+  void Release(RdmaBuffer* buffer);
+
+ private:
+  static constexpr int kBucketCount = 48;
+  static constexpr int kMinBucket = 12;
+  static constexpr size_t kMaxCachedPerBucket = 16;
+
+  ibv_pd* pd_;
+  std::mutex mu_;
+  std::vector<RdmaBuffer*> buckets_[kBucketCount];
+};
+
+// Device, protection domain and completion queue shared by all channels
+// of one lib. Completions are dispatched to channels by a poller thread.
+//
+// Env:
+//   PS_RDMA_DEVICE     device name, the first device by default
+//   PS_RDMA_PORT       device port, 1 by default
+//   PS_RDMA_GID_INDEX  gid index, 0 by default (RoCE v2 is often 3)
+class RdmaContext {
+ public:
+  RdmaContext();
+  ~RdmaContext();
+
+  bool Init();
+  void Stop();
+
+  ibv_context* Device() { return device_; }
+  ibv_pd* Pd() { return pd_; }
+  ibv_cq* Cq() { return cq_; }
+  uint8_t PortNum() { return port_num_; }
+  int GidIndex() { return gid_index_; }
+  RdmaBufferPool* Pool() { return pool_.get(); }
+
+  void AddChannel(uint32_t qp_num, RdmaChannel* channel);
+  void RemoveChannel(uint32_t qp_num);
+
+  static constexpr int kCqDepth = 8192;
+
+ private:
+  void Poll();
+
+  ibv_context* device_;
+  ibv_pd* pd_;
+  ibv_comp_channel* comp_channel_;
+  ibv_cq* cq_;
+  uint8_t port_num_;
+  int gid_index_;
+  std::unique_ptr<RdmaBufferPool> pool_;
+  std::atomic<bool> stop_;
+  std::unique_ptr<std::thread> poller_;
+  std::mutex mu_;
+  std::unordered_map<uint32_t, RdmaChannel*> channels_;
+};
+
+} // namespace rdma
+} // namespace service
+} // namespace ps
+
+#endif // PS_SERVICE_RDMA_LIB_RDMA_CONTEXT_H_
@@ -0,0 +1,265 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "rdma_server_lib.h"
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <iostream>
+
+#include <core/ps_coding/message_header.hh>
+
+#include "ps-plus/common/data.h"
+#include "ps-plus/service/seastar/lib/common.h"
+#include "ps-plus/service/seastar/lib/done_closure.h"
+#include "ps-plus/service/seastar/lib/seastar_status.h"
+
+using ps::serializer::Fragment;
+using ps::service::seastar::DoneClosure;
+using ps::service::seastar::SeastarStatus;
+using ps::service::seastar::ServerFuncManager;
+
+namespace ps {
+namespace service {
+namespace rdma {
+
+namespace {
+
+// Holds the request message, whose buffer backs the request datas, until
+// the response is sent back on the channel.
+class RdmaDoneClosure : public DoneClosure {
+ public:
+  RdmaDoneClosure(RdmaChannel* channel, RdmaBuffer* message, uint64_t sequence,
+                  std::vector<ps::Data*>* request_datas,
+                  const ps::serializer::MemGuard& mem_guard,
+                  const SeastarStatus& status)
+    : channel_(channel), message_(message), sequence_(sequence),
+      mem_guard_(mem_guard), status_(status) {
+    request_datas_.swap(*request_datas);
+  }
+
+  ~RdmaDoneClosure() override {
+    for (ps::Data* data : request_datas_) {
+      delete data;
+    }
+    for (ps::Data* data : response_datas_) {
+      delete data;
+    }
+    channel_->Context()->Pool()->Release(message_);
+  }
+
+  void Run() override {
+    std::vector<Fragment> fragments;
+    std::vector<size_t> ids;
+    for (ps::Data* data : response_datas_) {
+      size_t id;
+      if (!ps::serializer::SerializeAny<ps::Data>(data, &id, &fragments,
+                                                  mem_guard_).IsOk()) {
+        status_ = SeastarStatus::ServerSerializeFailed();
+        break;
+      }
+      ids.push_back(id);
+    }
+
+    ps::coding::MessageHeader header;
+    memset(&header, 0, sizeof(header));
+    header.mProcessorClassId = ps::service::seastar::SEASTAR_RESPONSE_PROCESSOR_ID;
+    header.mSequence = sequence_;
+    header.mMetaBufferSize = sizeof(int32_t) + sizeof(size_t) * ids.size();
+    char* meta = mem_guard_.AllocateBuffer(header.mMetaBufferSize);
+    *(int32_t*)(void*)meta = status_.Code();
+    memcpy(meta + sizeof(int32_t), ids.data(), sizeof(size_t) * ids.size());
+    size_t data_size = 0;
+    for (auto&& frag : fragments) {
+      data_size += frag.size;
+    }
+    header.mDataBufferSize = data_size;
+    fragments.insert(fragments.begin(), Fragment(meta, header.mMetaBufferSize));
+    fragments.insert(fragments.begin(), Fragment((char*)(void*)&header, sizeof(header)));
+    if (!channel_->Closed()) {
+      channel_->Send(fragments);
+    }
+    delete this;
+  }
+
+  const std::vector<ps::Data*>& RequestData() const {
+    return request_datas_;
+  }
+
+  std::vector<ps::Data*>* MutableResponseData() {
+    return &response_datas_;
+  }
+
+ private:
+  RdmaChannel* channel_;
+  RdmaBuffer* message_;
+  uint64_t sequence_;
+  std::vector<ps::Data*> request_datas_;
+  std::vector<ps::Data*> response_datas_;
+  ps::serializer::MemGuard mem_guard_;
+  SeastarStatus status_;
+};
+
+}  // namespace
+
+RdmaServerLib::RdmaServerLib(int port, int thread_num)
+  : port_(port), thread_num_(thread_num), listen_fd_(-1), stop_(false) {
+}
+
+RdmaServerLib::~RdmaServerLib() {
+  Stop();
+}
+
+bool RdmaServerLib::Start() {
+  context_.reset(new RdmaContext);
+  if (!context_->Init()) {
+    std::cerr << "rdma device not available, serve tcp only" << std::endl;
+    context_.reset();
+    return false;
+  }
+  listen_fd_ = ::socket(PF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd_ < 0) {
+    return false;
+  }
+  int reuse = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in addr;
+  bzero((char *) &addr, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port_);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(listen_fd_, (const struct sockaddr*)&addr, sizeof(addr)) != 0
+      || listen(listen_fd_, 128) != 0) {
+    std::cerr << "rdma listen on port " << port_ << " failed, errno " << errno << std::endl;
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+  pool_.reset(new ThreadPool(thread_num_));
+  accept_thread_.reset(new std::thread([this]{ Accept(); }));
+  return true;
+}
+
+void RdmaServerLib::Stop() {
+  stop_ = true;
+  if (accept_thread_ != nullptr) {
+    accept_thread_->join();
+    accept_thread_.reset();
+  }
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+    listen_fd_ = -1;
+  }
+  if (context_ != nullptr) {
+    context_->Stop();
+  }
+  pool_.reset();
+  channels_.clear();
+  context_.reset();
+}
+
+bool RdmaServerLib::RegisterServerFunc(size_t id,
+                                       const ServerFunc& server_func) {
+  return ServerFuncManager::GetInstance()->RegisterServerFunc(
+      id, server_func) == 0;
+}
+
+void RdmaServerLib::Accept() {
+  while (!stop_) {
+    pollfd fd{.fd = listen_fd_, .events = POLLIN, .revents = 0};
+    if (poll(&fd, 1, 100) <= 0) {
+      continue;
+    }
+    int sd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (sd < 0) {
+      continue;
+    }
+    // A client stuck in the handshake must not block the others for long.
+    timeval timeout{.tv_sec = 5, .tv_usec = 0};
+    setsockopt(sd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    std::unique_ptr<RdmaChannel> channel(new RdmaChannel(
+        context_.get(),
+        [this](RdmaChannel* channel, RdmaBuffer* message, size_t size) {
+          Process(channel, message, size);
+        },
+        [](RdmaChannel* channel) {}));
+    bool ok = channel->Init() && channel->Handshake(sd, true);
+    close(sd);
+    if (!ok) {
+      std::cerr << "rdma handshake failed" << std::endl;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mu_);
+    channels_.push_back(std::move(channel));
+  }
+}
+
+void RdmaServerLib::Process(RdmaChannel* channel, RdmaBuffer* message, size_t size) {
+  ps::coding::MessageHeader* header = (ps::coding::MessageHeader*)(void*)message->base;
+  char* meta = message->base + sizeof(ps::coding::MessageHeader);
+  size_t meta_size = header->mMetaBufferSize;
+  uint64_t server_func_id = *(uint64_t*)(void*)meta;
+  SeastarStatus st((SeastarStatus::ErrorCode)*(int32_t*)(void*)(meta + sizeof(uint64_t)));
+  size_t* ids = (size_t*)(void*)(meta + sizeof(uint64_t) + sizeof(int32_t));
+  size_t id_size = (meta_size - sizeof(uint64_t) - sizeof(int32_t)) / sizeof(size_t);
+  ServerFunc server_func;
+  std::vector<ps::Data*> request_datas;
+  ps::serializer::MemGuard mem_guard;
+  do {
+    if (!st.Success()) break;
+    if (0 != ServerFuncManager::GetInstance()->GetServerFunc(
+            server_func_id, &server_func)) {
+      st = SeastarStatus::ServerFuncNotFound();
+      break;
+    }
+
+    ps::serializer::Fragment buf;
+    buf.base = meta + meta_size;
+    buf.size = header->mDataBufferSize;
+    request_datas.reserve(id_size);
+    size_t offset = 0;
+    for (size_t i = 0; i < id_size; i++) {
+      ps::Data* data = nullptr;
+      size_t len;
+      ps::Status deserialize_st = ps::serializer::DeserializeAny<Data>(ids[i], &buf, offset, &data, &len, mem_guard);
+      if (!deserialize_st.IsOk()) {
+        std::cerr << deserialize_st.ToString() << std::endl;
+        st = SeastarStatus::ServerDeserializeFailed();
+        break;
+      }
+
+      offset += len;
+      request_datas.push_back(data);
+    }
+  } while(0);
+
+  RdmaDoneClosure* done = new RdmaDoneClosure(
+      channel, message, header->mSequence, &request_datas, mem_guard, st);
+  if (!st.Success()) {
+    done->Run();
+    return;
+  }
+  pool_->Schedule([server_func, done] {
+    server_func(done->RequestData(), done->MutableResponseData(), done);
+  });
+}
+
+} // namespace rdma
+} // namespace service
+} // namespace ps
@@ -0,0 +1,65 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_SERVICE_SEASTAR_LIB_CORE_ROUTER_H_
+#define PS_SERVICE_SEASTAR_LIB_CORE_ROUTER_H_
+
+#include <functional>
+
+#include <core/reactor.hh>
+
+namespace ps {
+namespace service {
+namespace seastar {
+
+// Owner cores of the core sharded server mode: the work on a key always
+// runs on the same server core, so what it touches is never shared with
+// the other reactors and its locks are never contended.
+class CoreRouter {
+ public:
+  // false off the reactor threads, e.g. for the shm and rdma transports
+  static bool OnReactor() {
+    return ::seastar::engine_is_ready();
+  }
+
+  static unsigned OwnerCore(size_t key) {
+    if (::seastar::smp::seperate_server_client) {
+      return ::seastar::smp::client_count + key % ::seastar::smp::server_count;
+    }
+    return key % ::seastar::smp::count;
+  }
+
+  // Runs work on core, then reply back on the calling core. Replies never
+  // go out from a foreign reactor, DoneClosure would block it on the queue
+  // hub of the calling core.
+  static void RunOn(unsigned core, const std::function<void()>& work, const std::function<void()>& reply) {
+    unsigned origin = ::seastar::engine().cpu_id();
+    if (core == origin) {
+      work();
+      reply();
+      return;
+    }
+    (void)::seastar::smp::submit_to(core, [work, reply, origin] {
+      work();
+      return ::seastar::smp::submit_to(origin, [reply] { reply(); });
+    });
+  }
+};
+
+} // namespace seastar
+} // namespace service
+} // namespace ps
+
+#endif //PS_SERVICE_SEASTAR_LIB_CORE_ROUTER_H_
@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef PS_SERVICE_SEASTAR_LIB_DONE_CLOSURE_H_
 #define PS_SERVICE_SEASTAR_LIB_DONE_CLOSURE_H_
 
+#include <atomic>
 #include <functional>
 #include <thread>
 #include <mutex>
@@ -24,6 +25,8 @@ limitations under the License.
 #include <core/reactor.hh>
 #include <core/ps_common.hh>
 
+#include "ps-plus/common/metrics_collector.h"
+
 #include "common.h"
 #include "seastar_response_item.h"
 
@@ -48,12 +51,34 @@ class DoneClosure : public Closure {
     , serializer_(serializer)
     , thread_id_(std::this_thread::get_id())
     , cpu_id_(::seastar::engine().cpu_id())
-    , should_enqueue_(should_enqueue) {
+    , should_enqueue_(should_enqueue)
+    , profile_micros_(nullptr)
+    , inflight_(nullptr)
+    , class_inflight_(nullptr) {
   } 
 
   ~DoneClosure() override {}
 
+  // Records the time until the reply and leaves the in flight count.
+  void Profile(common::Histogram* micros, std::atomic<int64_t>* inflight) {
+    profile_micros_ = micros;
+    inflight_ = inflight;
+    begin_ = common::MetricsCollector::GetCurrentTimeMS();
+  }
+
+  // Gives back the in flight budget of the request class at Run.
+  void Release(std::atomic<int64_t>* class_inflight) {
+    class_inflight_ = class_inflight;
+  }
+
   virtual void Run() {
+    if (profile_micros_ != nullptr) {
+      profile_micros_->Record(common::MetricsCollector::GetCurrentTimeMS() - begin_);
+      inflight_->fetch_sub(1, std::memory_order_relaxed);
+    }
+    if (class_inflight_ != nullptr) {
+      class_inflight_->fetch_sub(1, std::memory_order_relaxed);
+    }
     if (std::this_thread::get_id() != thread_id_) {
       std::unique_lock<std::mutex> lock(global_mu_);
       std::pair<ps::network::QueueHub<ps::network::Item>*, 
@@ -77,6 +102,19 @@ class DoneClosure : public Closure {
     delete this;
   }    
 
+ protected:
+  // For transports which reply without a seastar session, see service/rdma.
+  DoneClosure()
+    : sc_(nullptr)
+    , serializer_(nullptr)
+    , thread_id_(std::this_thread::get_id())
+    , cpu_id_(0)
+    , should_enqueue_(false)
+    , profile_micros_(nullptr)
+    , inflight_(nullptr)
+    , class_inflight_(nullptr) {
+  }
+
  private:
   static std::mutex global_mu_;
   ps::network::SessionContext* sc_;
@@ -84,6 +122,10 @@ class DoneClosure : public Closure {
   std::thread::id thread_id_;
   size_t cpu_id_;
   bool should_enqueue_;
+  common::Histogram* profile_micros_;
+  std::atomic<int64_t>* inflight_;
+  std::atomic<int64_t>* class_inflight_;
+  size_t begin_;
 };
 
 } // namespace seastar
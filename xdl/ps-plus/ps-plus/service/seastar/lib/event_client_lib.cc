@@ -130,7 +130,7 @@ void EventReader::StartReadBuffer() {
   state_ = kReadBuffer;
   int size = cur_message_->header.mMetaBufferSize
       + cur_message_->header.mDataBufferSize;
-  cur_message_->buffer.reset(new char[size]);
+  cur_message_->buffer.reset(BufferPool::Allocate(size));
   cur_ptr_ = cur_message_->buffer.get();
   size_ = size;
 }
@@ -23,6 +23,7 @@ limitations under the License.
 #include <future>
 #include <service/client_network_context.hh>
 #include <event.h>
+#include "ps-plus/common/buffer_pool.h"
 #include "ps-plus/common/rd_lock.h"
 #include "ps-plus/service/seastar/lib/callback_closure.h"
 
@@ -38,7 +39,7 @@ class EventReader {
  public:
   struct EventMessage {
     ps::coding::MessageHeader header;
-    std::unique_ptr<char[]> buffer;
+    std::unique_ptr<char, BufferPool::Deleter> buffer;
     SeastarStatus status;
     std::vector<Data*> datas;
   };
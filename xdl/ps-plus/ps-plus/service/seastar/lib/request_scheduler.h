@@ -0,0 +1,132 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_SERVICE_SEASTAR_LIB_REQUEST_SCHEDULER_H_
+#define PS_SERVICE_SEASTAR_LIB_REQUEST_SCHEDULER_H_
+
+#include <core/reactor.hh>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <string>
+
+namespace ps {
+namespace service {
+namespace seastar {
+
+enum RequestClass {
+  kPullRequest = 0,
+  kPushRequest = 1,
+  kControlRequest = 2,
+  kRequestClassNum = 3
+};
+
+// Per reactor queues of the requests of each class. The classes with room
+// in their in flight budget are served by weighted round robin, so pulls
+// keep flowing behind a burst of pushes or a checkpoint. Weights and
+// budgets are PS_SEASTAR_{PULL,PUSH,CONTROL}_{WEIGHT,INFLIGHT}.
+class RequestScheduler {
+ public:
+  // run gets the in flight count the request leaves when it replies
+  using Request = std::function<void(std::atomic<int64_t>* inflight)>;
+
+  static RequestScheduler* Local() {
+    // never destroyed, the timer must not outlive the reactor
+    thread_local RequestScheduler* scheduler = new RequestScheduler;
+    return scheduler;
+  }
+
+  void Schedule(RequestClass klass, Request&& request) {
+    queues_[klass].push_back(std::move(request));
+    Dispatch();
+  }
+
+  size_t Queued(RequestClass klass) const {
+    return queues_[klass].size();
+  }
+
+ private:
+  RequestScheduler() : cursor_(0) {
+    static const char* names[kRequestClassNum] = {"PULL", "PUSH", "CONTROL"};
+    static const int64_t weights[kRequestClassNum] = {8, 2, 1};
+    static const int64_t budgets[kRequestClassNum] = {1024, 64, 1};
+    for (int k = 0; k < kRequestClassNum; k++) {
+      weight_[k] = GetEnv(std::string("PS_SEASTAR_") + names[k] + "_WEIGHT", weights[k]);
+      budget_[k] = GetEnv(std::string("PS_SEASTAR_") + names[k] + "_INFLIGHT", budgets[k]);
+      credit_[k] = weight_[k];
+      inflight_[k] = 0;
+    }
+    timer_.set_callback([this] { Dispatch(); });
+  }
+
+  static int64_t GetEnv(const std::string& name, int64_t def) {
+    const char* value = getenv(name.c_str());
+    int64_t result = value == nullptr ? def : atoll(value);
+    return result > 0 ? result : def;
+  }
+
+  void Dispatch() {
+    int k;
+    while ((k = Pick()) >= 0) {
+      Request request = std::move(queues_[k].front());
+      queues_[k].pop_front();
+      credit_[k]--;
+      inflight_[k].fetch_add(1, std::memory_order_relaxed);
+      request(&inflight_[k]);
+    }
+    // budgets are given back by replies, possibly from other threads
+    bool queued = false;
+    for (auto& queue : queues_) {
+      queued = queued || !queue.empty();
+    }
+    if (queued && !timer_.armed()) {
+      timer_.arm(std::chrono::microseconds(200));
+    }
+  }
+
+  int Pick() {
+    for (int round = 0; round < 2; round++) {
+      for (int i = 0; i < kRequestClassNum; i++) {
+        int k = (cursor_ + i) % kRequestClassNum;
+        if (!queues_[k].empty() && credit_[k] > 0 &&
+            inflight_[k].load(std::memory_order_relaxed) < budget_[k]) {
+          cursor_ = k;
+          return k;
+        }
+      }
+      for (int k = 0; k < kRequestClassNum; k++) {
+        credit_[k] = weight_[k];
+      }
+    }
+    return -1;
+  }
+
+  std::deque<Request> queues_[kRequestClassNum];
+  std::atomic<int64_t> inflight_[kRequestClassNum];
+  int64_t weight_[kRequestClassNum];
+  int64_t budget_[kRequestClassNum];
+  int64_t credit_[kRequestClassNum];
+  int cursor_;
+  ::seastar::timer<> timer_;
+};
+
+} // namespace seastar
+} // namespace service
+} // namespace ps
+
+#endif //PS_SERVICE_SEASTAR_LIB_REQUEST_SCHEDULER_H_
@@ -19,10 +19,16 @@ limitations under the License.
 #include <core/ps_coding/message_processor.hh>
 #include <core/ps_coding/fragment.hh>
 
+#include <atomic>
+#include <cstdio>
+#include <unordered_map>
+
 #include "ps-plus/common/serializer.h"
+#include "ps-plus/common/metrics_collector.h"
 
 #include "common.h"
 #include "done_closure.h"
+#include "request_scheduler.h"
 #include "seastar_status.h"
 #include "server_func_manager.h"
 #include "seastar_response_serializer.h"
@@ -42,6 +48,11 @@ class SeastarRequestProcessor : public ps::coding::MessageProcessor {
   ~SeastarRequestProcessor() override {}
 
   ::seastar::future<> Process(ps::network::SessionContext* sc) override {
+    static std::atomic<int64_t> inflight(0);
+    static common::Histogram* inflight_depth =
+        common::MetricsCollector::Instance()->GetHistogram("seastar.inflight");
+    static common::Histogram* bytes_in =
+        common::MetricsCollector::Instance()->GetHistogram("seastar.bytes_in");
     size_t server_func_id;
     std::vector<size_t> serialize_ids;
     ServerFunc server_func;
@@ -81,15 +92,48 @@ class SeastarRequestProcessor : public ps::coding::MessageProcessor {
       new SeastarResponseSerializer(this, request_datas, mem_guard, st);
     serializer->SetUserThreadId(GetMessageHeader().mUserThreadId);
     serializer->SetSequence(GetMessageHeader().mSequence);
-    server_func(serializer->RequestData(), 
-                serializer->MutableResponseData(),
-                // server will write packet via queue, 
-	        // not directly via write function,
-	        // so should pass 'true' param	
-                new DoneClosure(sc, serializer, true));
+    // server will write packet via queue, 
+    // not directly via write function,
+    // so should pass 'true' param	
+    DoneClosure* done = new DoneClosure(sc, serializer, true);
+    inflight_depth->Record(inflight.fetch_add(1, std::memory_order_relaxed) + 1);
+    bytes_in->Record(GetMetaBuffer().size() + GetDataBuffer().size());
+    done->Profile(FuncMicros(server_func_id), &inflight);
+    if (!st.Success()) {
+      server_func(serializer->RequestData(), serializer->MutableResponseData(), done);
+      return ::seastar::make_ready_future<>();
+    }
+    RequestScheduler::Local()->Schedule(
+        Classify(server_func_id, GetDataBuffer().size()),
+        [server_func, serializer, done] (std::atomic<int64_t>* class_inflight) {
+      done->Release(class_inflight);
+      server_func(serializer->RequestData(), serializer->MutableResponseData(), done);
+    });
     return ::seastar::make_ready_future<>();
   }
 
+  // pushes carry their gradients, pulls only the ids
+  static RequestClass Classify(size_t func_id, size_t bytes) {
+    static const size_t push_bytes = getenv("PS_SEASTAR_PUSH_BYTES") == nullptr
+        ? 16 << 10 : atoll(getenv("PS_SEASTAR_PUSH_BYTES"));
+    if (ServerFuncManager::GetInstance()->IsControlFunc(func_id)) {
+      return kControlRequest;
+    }
+    return bytes > push_bytes ? kPushRequest : kPullRequest;
+  }
+
+  // histograms are looked up once per func on every seastar thread
+  static common::Histogram* FuncMicros(size_t func_id) {
+    thread_local std::unordered_map<size_t, common::Histogram*> histograms;
+    common::Histogram*& histogram = histograms[func_id];
+    if (histogram == nullptr) {
+      char name[64];
+      snprintf(name, sizeof(name), "seastar.func.0x%08zx.micros", func_id);
+      histogram = common::MetricsCollector::Instance()->GetHistogram(name);
+    }
+    return histogram;
+  }
+
   void ParseMeta(uint64_t* func_id, SeastarStatus* st, std::vector<size_t>* ids) {
     char* cbegin = const_cast<char*>(GetMetaBuffer().begin());
     *func_id = *(reinterpret_cast<uint64_t*>(cbegin));
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <functional>
 #include <mutex>
+#include <unordered_set>
 
 namespace ps {
 class Data;
@@ -55,6 +56,16 @@ class ServerFuncManager {
     return 0;
   }
 
+  // Control funcs get their own queue in the request scheduler, the
+  // others are data requests, classed as pull or push by their size.
+  void SetControlFunc(size_t id) {
+    control_funcs_.insert(id);
+  }
+
+  bool IsControlFunc(size_t id) {
+    return control_funcs_.find(id) != control_funcs_.end();
+  }
+
   int GetServerFunc(size_t id, ServerFunc* server_func) {
     auto it = server_funcs_.find(id);
     if (it == server_funcs_.end()) {
@@ -71,6 +82,7 @@ class ServerFuncManager {
 
  private:
   std::unordered_map<size_t, ServerFunc> server_funcs_;
+  std::unordered_set<size_t> control_funcs_;
 };
 
 } // namespace seastar
@@ -0,0 +1,359 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shm_channel.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <iostream>
+#include <thread>
+
+using ps::serializer::Fragment;
+
+namespace ps {
+namespace service {
+namespace shm {
+
+namespace {
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  asm volatile("pause" ::: "memory");
+#endif
+}
+
+sockaddr_un UnixAddr(const std::string& name, socklen_t* len) {
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  // abstract namespace, nothing is left on the file system
+  strncpy(addr.sun_path + 1, name.c_str(), sizeof(addr.sun_path) - 2);
+  *len = offsetof(sockaddr_un, sun_path) + 1 + std::min(name.size(), sizeof(addr.sun_path) - 2);
+  return addr;
+}
+
+}  // namespace
+
+ShmRing::ShmRing(ShmRingHeader* header, char* data, size_t capacity,
+                 int data_fd, int space_fd, int peer_fd)
+  : header_(header), data_(data), capacity_(capacity),
+    data_fd_(data_fd), space_fd_(space_fd), peer_fd_(peer_fd) {
+}
+
+int ShmRing::SpinCount() {
+  static int spin_count = std::thread::hardware_concurrency() > 1 ? kSpinCount : 0;
+  return spin_count;
+}
+
+template <typename Pred>
+bool ShmRing::Wait(Pred pred, std::atomic<uint32_t>* waiting, int fd) {
+  for (int i = 0, n = SpinCount(); i < n; i++) {
+    if (pred()) {
+      return true;
+    }
+    if (Closed()) {
+      return false;
+    }
+    CpuRelax();
+  }
+  while (true) {
+    waiting->store(1);
+    // Pairs with the position store in Signal, one of both sides sees the other.
+    if (pred()) {
+      waiting->store(0);
+      return true;
+    }
+    if (Closed()) {
+      waiting->store(0);
+      return false;
+    }
+    pollfd fds[2] = {{.fd = fd, .events = POLLIN, .revents = 0},
+                     {.fd = peer_fd_, .events = POLLIN | POLLRDHUP, .revents = 0}};
+    if (poll(fds, 2, 100) > 0) {
+      if (fds[0].revents & POLLIN) {
+        uint64_t x;
+        if (read(fd, &x, sizeof(x)) < 0 && errno != EAGAIN) {
+          Close();
+        }
+      }
+      // Nothing is sent over the socket, any event means the peer is gone.
+      if (fds[1].revents != 0) {
+        Close();
+      }
+    }
+    waiting->store(0);
+  }
+}
+
+void ShmRing::Signal(std::atomic<uint32_t>* waiting, int fd) {
+  if (waiting->load() != 0) {
+    uint64_t x = 1;
+    if (write(fd, &x, sizeof(x)) < 0 && errno != EAGAIN) {
+      std::cerr << "shm ring signal error, errno " << errno << std::endl;
+    }
+  }
+}
+
+bool ShmRing::Put(const char* buf, size_t size) {
+  while (size > 0) {
+    uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    if (!Wait([&]{ return tail - header_->head.load() < capacity_; },
+              &header_->producer_waiting, space_fd_)) {
+      return false;
+    }
+    size_t space = capacity_ - (tail - header_->head.load());
+    size_t offset = tail & (capacity_ - 1);
+    size_t n = std::min(std::min(size, space), capacity_ - offset);
+    memcpy(data_ + offset, buf, n);
+    header_->tail.store(tail + n);
+    Signal(&header_->consumer_waiting, data_fd_);
+    buf += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool ShmRing::Get(char* buf, size_t size) {
+  while (size > 0) {
+    uint64_t head = header_->head.load(std::memory_order_relaxed);
+    if (!Wait([&]{ return header_->tail.load() != head; },
+              &header_->consumer_waiting, data_fd_)) {
+      return false;
+    }
+    size_t available = header_->tail.load() - head;
+    size_t offset = head & (capacity_ - 1);
+    size_t n = std::min(std::min(size, available), capacity_ - offset);
+    memcpy(buf, data_ + offset, n);
+    header_->head.store(head + n);
+    Signal(&header_->producer_waiting, space_fd_);
+    buf += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool ShmRing::Write(const std::vector<Fragment>& frags) {
+  uint64_t size = 0;
+  for (auto&& frag : frags) {
+    size += frag.size;
+  }
+  std::unique_lock<std::mutex> lock(write_mu_);
+  if (!Put((const char*)&size, sizeof(size))) {
+    return false;
+  }
+  for (auto&& frag : frags) {
+    if (!Put(frag.base, frag.size)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ShmRing::Read(std::unique_ptr<char[]>* message, size_t* size) {
+  uint64_t len;
+  if (!Get((char*)&len, sizeof(len))) {
+    return false;
+  }
+  message->reset(new char[len]);
+  *size = len;
+  return Get(message->get(), len);
+}
+
+void ShmRing::Close() {
+  header_->closed.store(1);
+  uint64_t x = 1;
+  write(data_fd_, &x, sizeof(x));
+  write(space_fd_, &x, sizeof(x));
+}
+
+bool ShmRing::Closed() {
+  return header_->closed.load() != 0;
+}
+
+ShmChannel::ShmChannel(int sock, int* fds, char* region, size_t region_size, bool server)
+  : sock_(sock), region_(region), region_size_(region_size) {
+  memcpy(fds_, fds, sizeof(fds_));
+  size_t capacity = region_size / 2 - kHeaderSize;
+  char* base0 = region;
+  char* base1 = region + region_size / 2;
+  ShmRing* ring0 = new ShmRing((ShmRingHeader*)(void*)base0, base0 + kHeaderSize, capacity, fds_[1], fds_[2], sock_);
+  ShmRing* ring1 = new ShmRing((ShmRingHeader*)(void*)base1, base1 + kHeaderSize, capacity, fds_[3], fds_[4], sock_);
+  // ring0 carries requests, ring1 responses
+  if (server) {
+    recv_.reset(ring0);
+    send_.reset(ring1);
+  } else {
+    send_.reset(ring0);
+    recv_.reset(ring1);
+  }
+}
+
+ShmChannel::~ShmChannel() {
+  Close();
+  send_.reset();
+  recv_.reset();
+  munmap(region_, region_size_);
+  for (int fd : fds_) {
+    close(fd);
+  }
+  close(sock_);
+}
+
+std::string ShmChannel::Name(int port) {
+  return "ps-plus-shm-" + std::to_string(port);
+}
+
+int ShmChannel::Listen(const std::string& name) {
+  int sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sock < 0) {
+    return -1;
+  }
+  socklen_t len;
+  sockaddr_un addr = UnixAddr(name, &len);
+  if (bind(sock, (const sockaddr*)&addr, len) != 0 || listen(sock, 128) != 0) {
+    close(sock);
+    return -1;
+  }
+  return sock;
+}
+
+ShmChannel* ShmChannel::Accept(int sock, size_t capacity) {
+  static std::atomic<int> counter(0);
+  std::string name = "/ps-plus-shm-" + std::to_string(getpid()) + "-" + std::to_string(counter++);
+  int memfd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+  if (memfd < 0) {
+    std::cerr << "shm_open " << name << " failed, errno " << errno << std::endl;
+    return nullptr;
+  }
+  shm_unlink(name.c_str());
+  size_t region_size = 2 * (kHeaderSize + capacity);
+  if (ftruncate(memfd, region_size) != 0) {
+    close(memfd);
+    return nullptr;
+  }
+  char* region = (char*)mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+  if (region == MAP_FAILED) {
+    close(memfd);
+    return nullptr;
+  }
+  memset(region, 0, kHeaderSize);
+  memset(region + region_size / 2, 0, kHeaderSize);
+
+  int fds[kFdCount];
+  fds[0] = memfd;
+  for (int i = 1; i < kFdCount; i++) {
+    fds[i] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  }
+
+  char dummy = 0;
+  iovec iov{.iov_base = &dummy, .iov_len = 1};
+  char control[CMSG_SPACE(sizeof(fds))];
+  memset(control, 0, sizeof(control));
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+  ShmChannel* channel = new ShmChannel(sock, fds, region, region_size, true);
+  if (sendmsg(sock, &msg, MSG_NOSIGNAL) != 1) {
+    std::cerr << "shm channel send fds failed, errno " << errno << std::endl;
+    delete channel;
+    return nullptr;
+  }
+  return channel;
+}
+
+ShmChannel* ShmChannel::Connect(const std::string& name) {
+  int sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sock < 0) {
+    return nullptr;
+  }
+  socklen_t len;
+  sockaddr_un addr = UnixAddr(name, &len);
+  if (connect(sock, (const sockaddr*)&addr, len) != 0) {
+    close(sock);
+    return nullptr;
+  }
+
+  int fds[kFdCount];
+  char dummy;
+  iovec iov{.iov_base = &dummy, .iov_len = 1};
+  char control[CMSG_SPACE(sizeof(fds))];
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != 1) {
+    close(sock);
+    return nullptr;
+  }
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg == nullptr || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+    close(sock);
+    return nullptr;
+  }
+  memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+  struct stat st;
+  char* region = (char*)MAP_FAILED;
+  if (fstat(fds[0], &st) == 0) {
+    region = (char*)mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+  }
+  if (region == MAP_FAILED) {
+    for (int fd : fds) {
+      close(fd);
+    }
+    close(sock);
+    return nullptr;
+  }
+  return new ShmChannel(sock, fds, region, st.st_size, false);
+}
+
+bool ShmChannel::Send(const std::vector<Fragment>& frags) {
+  return send_->Write(frags);
+}
+
+bool ShmChannel::Receive(std::unique_ptr<char[]>* message, size_t* size) {
+  return recv_->Read(message, size);
+}
+
+void ShmChannel::Close() {
+  send_->Close();
+  recv_->Close();
+}
+
+bool ShmChannel::Closed() {
+  return send_->Closed() || recv_->Closed();
+}
+
+} // namespace shm
+} // namespace service
+} // namespace ps
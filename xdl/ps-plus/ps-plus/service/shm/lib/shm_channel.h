@@ -0,0 +1,112 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_SERVICE_SHM_LIB_SHM_CHANNEL_H_
+#define PS_SERVICE_SHM_LIB_SHM_CHANNEL_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ps-plus/common/serializer.h"
+
+namespace ps {
+namespace service {
+namespace shm {
+
+// Control block of a ring, shared by both processes. Positions only grow,
+// the offset in the ring is position & (capacity - 1).
+struct ShmRingHeader {
+  alignas(64) std::atomic<uint64_t> head;
+  alignas(64) std::atomic<uint64_t> tail;
+  alignas(64) std::atomic<uint32_t> consumer_waiting;
+  std::atomic<uint32_t> producer_waiting;
+  std::atomic<uint32_t> closed;
+};
+
+// Single consumer byte ring carrying [uint64 size][message] records.
+// Writers are serialized by a process local mutex. Both ends spin for a
+// while before sleeping on an eventfd, so a busy ring is served without
+// any syscall.
+class ShmRing {
+ public:
+  ShmRing(ShmRingHeader* header, char* data, size_t capacity,
+          int data_fd, int space_fd, int peer_fd);
+  bool Write(const std::vector<ps::serializer::Fragment>& frags);
+  bool Read(std::unique_ptr<char[]>* message, size_t* size);
+  void Close();
+  bool Closed();
+
+ private:
+  bool Put(const char* buf, size_t size);
+  bool Get(char* buf, size_t size);
+  template <typename Pred>
+  bool Wait(Pred pred, std::atomic<uint32_t>* waiting, int fd);
+  void Signal(std::atomic<uint32_t>* waiting, int fd);
+
+  // Spinning only pays off when the peer runs on another cpu.
+  static constexpr int kSpinCount = 4000;
+  static int SpinCount();
+
+  ShmRingHeader* header_;
+  char* data_;
+  size_t capacity_;
+  int data_fd_;
+  int space_fd_;
+  int peer_fd_;
+  std::mutex write_mu_;
+};
+
+// A pair of rings in one shared region, one per direction. The server
+// creates the region and eventfds and passes them over a unix socket,
+// which stays open to detect the death of either process.
+class ShmChannel {
+ public:
+  ~ShmChannel();
+  // Listening socket for Accept, -1 if name is taken.
+  static int Listen(const std::string& name);
+  static ShmChannel* Accept(int sock, size_t capacity);
+  static ShmChannel* Connect(const std::string& name);
+  // Abstract unix socket name of the server listening on a tcp port.
+  static std::string Name(int port);
+
+  bool Send(const std::vector<ps::serializer::Fragment>& frags);
+  bool Receive(std::unique_ptr<char[]>* message, size_t* size);
+  void Close();
+  bool Closed();
+
+  static constexpr size_t kDefaultCapacity = 16 << 20;
+
+ private:
+  static constexpr size_t kHeaderSize = 4096;
+  static constexpr int kFdCount = 5;
+
+  ShmChannel(int sock, int* fds, char* region, size_t region_size, bool server);
+
+  int sock_;
+  int fds_[kFdCount];
+  char* region_;
+  size_t region_size_;
+  std::unique_ptr<ShmRing> send_;
+  std::unique_ptr<ShmRing> recv_;
+};
+
+} // namespace shm
+} // namespace service
+} // namespace ps
+
+#endif // PS_SERVICE_SHM_LIB_SHM_CHANNEL_H_
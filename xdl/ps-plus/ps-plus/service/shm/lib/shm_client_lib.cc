@@ -0,0 +1,170 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shm_client_lib.h"
+
+#include <iostream>
+
+#include <core/ps_coding/message_header.hh>
+
+#include "ps-plus/common/data.h"
+#include "ps-plus/service/seastar/lib/common.h"
+
+using ps::serializer::Fragment;
+using ps::service::seastar::CallBackClosure;
+using ps::service::seastar::SeastarStatus;
+
+namespace ps {
+namespace service {
+namespace shm {
+
+ShmClientConnection::ShmClientConnection(ShmChannel* channel)
+  : channel_(channel) {
+  reader_.reset(new std::thread([this]{ Loop(); }));
+}
+
+ShmClientConnection::~ShmClientConnection() {
+  channel_->Close();
+  reader_->join();
+  FailAll();
+}
+
+bool ShmClientConnection::Closed() {
+  return channel_->Closed();
+}
+
+void ShmClientConnection::Loop() {
+  std::unique_ptr<char[]> message;
+  size_t size;
+  while (channel_->Receive(&message, &size)) {
+    Process(std::move(message), size);
+  }
+  FailAll();
+}
+
+void ShmClientConnection::FailAll() {
+  std::set<Closure*> closures;
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    closures.swap(closures_);
+  }
+  for (auto closure : closures) {
+    CallBackClosure* cb = dynamic_cast<CallBackClosure*>(closure);
+    cb->SetStatus(SeastarStatus::NetworkError());
+    cb->Run();
+  }
+}
+
+void ShmClientConnection::Request(
+    int32_t func_id, const std::vector<Data*>& datas,
+    Closure* closure, bool delete_request_data) {
+  ps::coding::MessageHeader header{};
+  ps::serializer::MemGuard mem;
+  std::vector<Fragment> frags;
+  header.mSequence = reinterpret_cast<uint64_t>(closure);
+  header.mProcessorClassId = ps::service::seastar::SEASTAR_REQUEST_PROCESSOR_ID;
+  header.mMetaBufferSize = sizeof(uint64_t) + sizeof(int32_t) + sizeof(size_t) * datas.size();
+  char* meta = mem.AllocateBuffer(header.mMetaBufferSize);
+  *(uint64_t*)(void*)meta = func_id;
+  SeastarStatus status;
+  frags.push_back(Fragment((char*)(void*)&header, sizeof(header)));
+  frags.push_back(Fragment(meta, header.mMetaBufferSize));
+  for (size_t i = 0; i < datas.size(); i++) {
+    ps::Status st = ps::serializer::SerializeAny<ps::Data>(datas[i], ((uint64_t*)(void*)(meta + 12)) + i, &frags, mem);
+    if (!st.IsOk()) {
+      std::cerr << st.ToString() << std::endl;
+      status = SeastarStatus::ClientSerializeFailed();
+      break;
+    }
+  }
+  *(uint32_t*)(void*)(meta + 8) = status.Code();
+  size_t data_size = 0;
+  for (size_t i = 2; i < frags.size(); i++) {
+    data_size += frags[i].size;
+  }
+  header.mDataBufferSize = data_size;
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    closures_.insert(closure);
+  }
+  bool sent = channel_->Send(frags);
+  if (delete_request_data) {
+    for (auto data : datas) {
+      delete data;
+    }
+  }
+  if (!sent) {
+    size_t erased;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      erased = closures_.erase(closure);
+    }
+    if (erased != 0) {
+      CallBackClosure* cb = dynamic_cast<CallBackClosure*>(closure);
+      cb->SetStatus(SeastarStatus::NetworkError());
+      cb->Run();
+    }
+  }
+}
+
+void ShmClientConnection::Process(std::unique_ptr<char[]> message, size_t size) {
+  ps::coding::MessageHeader* header = (ps::coding::MessageHeader*)(void*)message.get();
+  int meta_size = header->mMetaBufferSize;
+  int data_size = header->mDataBufferSize;
+  char* meta_buf = message.get() + sizeof(ps::coding::MessageHeader);
+  char* data_buf = meta_buf + meta_size;
+  SeastarStatus status((SeastarStatus::ErrorCode)(*(int32_t*)(void*)meta_buf));
+  ps::serializer::MemGuard mem_guard;
+  size_t serializer_size = (meta_size - sizeof(int32_t)) / sizeof(size_t);
+  size_t* serializer_ids = (size_t*)(void*)(meta_buf + sizeof(int32_t));
+  std::vector<Data*> datas;
+  size_t offset = 0;
+  ps::serializer::Fragment buf;
+  buf.base = data_buf;
+  buf.size = data_size;
+  for (size_t i = 0 ; i < serializer_size; i++) {
+    ps::Data* data = nullptr;
+    size_t len;
+    Status st = ps::serializer::DeserializeAny<ps::Data>(serializer_ids[i], &buf, offset, &data, &len, mem_guard);
+    if (!st.IsOk()) {
+      status = SeastarStatus::ClientDeserializeFailed();
+      break;
+    }
+
+    offset += len;
+    datas.push_back(data);
+  }
+
+  Closure* closure = reinterpret_cast<Closure*>(header->mSequence);
+  size_t erased;
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    erased = closures_.erase(closure);
+  }
+  if (erased != 0) {
+    CallBackClosure* cb = dynamic_cast<CallBackClosure*>(closure);
+    cb->SetResponseData(datas);
+    cb->SetMemGuard(mem_guard);
+    cb->SetStatus(status);
+    cb->Run();
+  }
+  for (auto data : datas) {
+    delete data;
+  }
+}
+
+} // namespace shm
+} // namespace service
+} // namespace ps
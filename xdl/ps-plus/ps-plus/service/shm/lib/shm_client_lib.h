@@ -0,0 +1,132 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_SERVICE_SHM_LIB_SHM_CLIENT_LIB_H_
+#define PS_SERVICE_SHM_LIB_SHM_CLIENT_LIB_H_
+
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "ps-plus/common/net_utils.h"
+#include "ps-plus/service/seastar/lib/callback_closure.h"
+#include "shm_channel.h"
+
+namespace ps {
+class Data;
+}
+
+namespace ps {
+namespace service {
+namespace shm {
+
+using ps::service::seastar::Closure;
+
+class ShmClientConnection {
+ public:
+  explicit ShmClientConnection(ShmChannel* channel);
+  ~ShmClientConnection();
+  bool Closed();
+  void Request(int32_t func_id, const std::vector<Data*>& datas,
+               Closure* closure, bool delete_request_data);
+ private:
+  void Loop();
+  void Process(std::unique_ptr<char[]> message, size_t size);
+  void FailAll();
+
+  std::unique_ptr<ShmChannel> channel_;
+  std::unique_ptr<std::thread> reader_;
+  std::mutex mu_;
+  std::set<Closure*> closures_;
+};
+
+// Wraps a network client lib of the same interface. Servers on this host
+// are reached over a shared memory channel, the others and the scheduler
+// through Fallback, which also keeps deciding liveness. Set env
+// PS_SHM_TRANSPORT=0 to disable.
+template <typename Fallback>
+class ShmClientLib {
+ public:
+  using ServerAddr = std::tuple<int64_t, std::string>;
+  ShmClientLib(const std::vector<ServerAddr>& server_addrs,
+               int user_thread_num,
+               int core_num,
+               size_t timeout = 0)
+    : fallback_(server_addrs, user_thread_num, core_num, timeout),
+      enabled_(false) {
+  }
+
+  bool Start() {
+    enabled_ = ps::NetUtils::GetEnv("PS_SHM_TRANSPORT") != "0";
+    return fallback_.Start();
+  }
+
+  void Stop() {
+    conns_.clear();
+    fallback_.Stop();
+  }
+
+  void Request(int32_t server_id,
+               int32_t func_id,
+               const std::vector<ps::Data*>& request_datas,
+               Closure* closure,
+               bool delete_request_data = true) {
+    if ((size_t)server_id < conns_.size() && conns_[server_id] != nullptr
+        && !conns_[server_id]->Closed()) {
+      conns_[server_id]->Request(func_id, request_datas, closure, delete_request_data);
+    } else {
+      fallback_.Request(server_id, func_id, request_datas, closure, delete_request_data);
+    }
+  }
+
+  bool Connect(const int32_t server_id,
+               const std::string& server_addr) {
+    if (!fallback_.Connect(server_id, server_addr)) {
+      return false;
+    }
+    conns_.resize(std::max(conns_.size(), (size_t)server_id + 1));
+    conns_[server_id].reset();
+    size_t pos = server_addr.find(':');
+    if (!enabled_ || pos == std::string::npos
+        || !ps::NetUtils::IsLocalHost(server_addr.substr(0, pos))) {
+      return true;
+    }
+    int port = atoi(server_addr.substr(pos + 1).c_str());
+    ShmChannel* channel = ShmChannel::Connect(ShmChannel::Name(port));
+    if (channel != nullptr) {
+      conns_[server_id].reset(new ShmClientConnection(channel));
+    }
+    return true;
+  }
+
+  int CheckServer() {
+    return fallback_.CheckServer();
+  }
+
+ private:
+  Fallback fallback_;
+  bool enabled_;
+  std::vector<std::unique_ptr<ShmClientConnection>> conns_;
+};
+
+} // namespace shm
+} // namespace service
+} // namespace ps
+
+#endif // PS_SERVICE_SHM_LIB_SHM_CLIENT_LIB_H_
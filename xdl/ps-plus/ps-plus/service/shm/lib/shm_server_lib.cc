@@ -0,0 +1,243 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "shm_server_lib.h"
+
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <iostream>
+
+#include <core/ps_coding/message_header.hh>
+
+#include "ps-plus/common/data.h"
+#include "ps-plus/service/seastar/lib/common.h"
+#include "ps-plus/service/seastar/lib/done_closure.h"
+#include "ps-plus/service/seastar/lib/seastar_status.h"
+
+using ps::serializer::Fragment;
+using ps::service::seastar::DoneClosure;
+using ps::service::seastar::SeastarStatus;
+using ps::service::seastar::ServerFuncManager;
+
+namespace ps {
+namespace service {
+namespace shm {
+
+namespace {
+
+// Holds the request message, whose buffer backs the request datas, until
+// the response is written to the channel.
+class ShmDoneClosure : public DoneClosure {
+ public:
+  ShmDoneClosure(ShmChannel* channel, std::unique_ptr<char[]> message, uint64_t sequence,
+                 std::vector<ps::Data*>* request_datas,
+                 const ps::serializer::MemGuard& mem_guard,
+                 const SeastarStatus& status)
+    : channel_(channel), message_(std::move(message)), sequence_(sequence),
+      mem_guard_(mem_guard), status_(status) {
+    request_datas_.swap(*request_datas);
+  }
+
+  ~ShmDoneClosure() override {
+    for (ps::Data* data : request_datas_) {
+      delete data;
+    }
+    for (ps::Data* data : response_datas_) {
+      delete data;
+    }
+  }
+
+  void Run() override {
+    std::vector<Fragment> fragments;
+    std::vector<size_t> ids;
+    for (ps::Data* data : response_datas_) {
+      size_t id;
+      if (!ps::serializer::SerializeAny<ps::Data>(data, &id, &fragments,
+                                                  mem_guard_).IsOk()) {
+        status_ = SeastarStatus::ServerSerializeFailed();
+        break;
+      }
+      ids.push_back(id);
+    }
+
+    ps::coding::MessageHeader header;
+    memset(&header, 0, sizeof(header));
+    header.mProcessorClassId = ps::service::seastar::SEASTAR_RESPONSE_PROCESSOR_ID;
+    header.mSequence = sequence_;
+    header.mMetaBufferSize = sizeof(int32_t) + sizeof(size_t) * ids.size();
+    char* meta = mem_guard_.AllocateBuffer(header.mMetaBufferSize);
+    *(int32_t*)(void*)meta = status_.Code();
+    memcpy(meta + sizeof(int32_t), ids.data(), sizeof(size_t) * ids.size());
+    size_t data_size = 0;
+    for (auto&& frag : fragments) {
+      data_size += frag.size;
+    }
+    header.mDataBufferSize = data_size;
+    fragments.insert(fragments.begin(), Fragment(meta, header.mMetaBufferSize));
+    fragments.insert(fragments.begin(), Fragment((char*)(void*)&header, sizeof(header)));
+    channel_->Send(fragments);
+    delete this;
+  }
+
+  const std::vector<ps::Data*>& RequestData() const {
+    return request_datas_;
+  }
+
+  std::vector<ps::Data*>* MutableResponseData() {
+    return &response_datas_;
+  }
+
+ private:
+  ShmChannel* channel_;
+  std::unique_ptr<char[]> message_;
+  uint64_t sequence_;
+  std::vector<ps::Data*> request_datas_;
+  std::vector<ps::Data*> response_datas_;
+  ps::serializer::MemGuard mem_guard_;
+  SeastarStatus status_;
+};
+
+}  // namespace
+
+ShmServerLib::ShmServerLib(int port, int thread_num)
+  : port_(port), thread_num_(thread_num), listen_fd_(-1), stop_(false) {
+}
+
+ShmServerLib::~ShmServerLib() {
+  Stop();
+}
+
+bool ShmServerLib::Start() {
+  listen_fd_ = ShmChannel::Listen(ShmChannel::Name(port_));
+  if (listen_fd_ < 0) {
+    std::cerr << "shm listen " << ShmChannel::Name(port_) << " failed, errno " << errno << std::endl;
+    return false;
+  }
+  pool_.reset(new ThreadPool(thread_num_));
+  accept_thread_.reset(new std::thread([this]{ Accept(); }));
+  return true;
+}
+
+void ShmServerLib::Stop() {
+  stop_ = true;
+  if (accept_thread_ != nullptr) {
+    accept_thread_->join();
+    accept_thread_.reset();
+  }
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+    listen_fd_ = -1;
+  }
+  for (auto&& conn : conns_) {
+    conn->channel->Close();
+    conn->reader->join();
+  }
+  pool_.reset();
+  conns_.clear();
+}
+
+bool ShmServerLib::RegisterServerFunc(size_t id,
+                                      const ServerFunc& server_func) {
+  return ServerFuncManager::GetInstance()->RegisterServerFunc(
+      id, server_func) == 0;
+}
+
+void ShmServerLib::Accept() {
+  while (!stop_) {
+    pollfd fd{.fd = listen_fd_, .events = POLLIN, .revents = 0};
+    if (poll(&fd, 1, 100) <= 0) {
+      continue;
+    }
+    int sd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (sd < 0) {
+      continue;
+    }
+    ShmChannel* channel = ShmChannel::Accept(sd, ShmChannel::kDefaultCapacity);
+    if (channel == nullptr) {
+      close(sd);
+      continue;
+    }
+    Connection* conn = new Connection;
+    conn->channel.reset(channel);
+    conn->reader.reset(new std::thread([this, channel]{ Loop(channel); }));
+    std::unique_lock<std::mutex> lock(mu_);
+    conns_.emplace_back(conn);
+  }
+}
+
+void ShmServerLib::Loop(ShmChannel* channel) {
+  std::unique_ptr<char[]> message;
+  size_t size;
+  while (channel->Receive(&message, &size)) {
+    Process(channel, std::move(message), size);
+  }
+}
+
+void ShmServerLib::Process(ShmChannel* channel, std::unique_ptr<char[]> message, size_t size) {
+  ps::coding::MessageHeader* header = (ps::coding::MessageHeader*)(void*)message.get();
+  char* meta = message.get() + sizeof(ps::coding::MessageHeader);
+  size_t meta_size = header->mMetaBufferSize;
+  uint64_t sequence = header->mSequence;
+  uint64_t server_func_id = *(uint64_t*)(void*)meta;
+  SeastarStatus st((SeastarStatus::ErrorCode)*(int32_t*)(void*)(meta + sizeof(uint64_t)));
+  size_t* ids = (size_t*)(void*)(meta + sizeof(uint64_t) + sizeof(int32_t));
+  size_t id_size = (meta_size - sizeof(uint64_t) - sizeof(int32_t)) / sizeof(size_t);
+  ServerFunc server_func;
+  std::vector<ps::Data*> request_datas;
+  ps::serializer::MemGuard mem_guard;
+  do {
+    if (!st.Success()) break;
+    if (0 != ServerFuncManager::GetInstance()->GetServerFunc(
+            server_func_id, &server_func)) {
+      st = SeastarStatus::ServerFuncNotFound();
+      break;
+    }
+
+    ps::serializer::Fragment buf;
+    buf.base = meta + meta_size;
+    buf.size = header->mDataBufferSize;
+    request_datas.reserve(id_size);
+    size_t offset = 0;
+    for (size_t i = 0; i < id_size; i++) {
+      ps::Data* data = nullptr;
+      size_t len;
+      ps::Status deserialize_st = ps::serializer::DeserializeAny<Data>(ids[i], &buf, offset, &data, &len, mem_guard);
+      if (!deserialize_st.IsOk()) {
+        std::cerr << deserialize_st.ToString() << std::endl;
+        st = SeastarStatus::ServerDeserializeFailed();
+        break;
+      }
+
+      offset += len;
+      request_datas.push_back(data);
+    }
+  } while(0);
+
+  ShmDoneClosure* done = new ShmDoneClosure(
+      channel, std::move(message), sequence, &request_datas, mem_guard, st);
+  if (!st.Success()) {
+    done->Run();
+    return;
+  }
+  pool_->Schedule([server_func, done] {
+    server_func(done->RequestData(), done->MutableResponseData(), done);
+  });
+}
+
+} // namespace shm
+} // namespace service
+} // namespace ps
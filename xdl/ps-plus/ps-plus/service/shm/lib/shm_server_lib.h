@@ -0,0 +1,71 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef PS_SERVICE_SHM_LIB_SHM_SERVER_LIB_H_
+#define PS_SERVICE_SHM_LIB_SHM_SERVER_LIB_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ps-plus/common/thread_pool.h"
+#include "ps-plus/service/seastar/lib/server_func_manager.h"
+#include "shm_channel.h"
+
+namespace ps {
+namespace service {
+namespace shm {
+
+using ps::service::seastar::ServerFunc;
+
+// Serves the funcs of ServerFuncManager to clients on the same host, next
+// to the seastar server listening on port. Every channel has a reader
+// thread, funcs run on a thread pool of thread_num.
+class ShmServerLib {
+ public:
+  ShmServerLib(int port, int thread_num);
+  ~ShmServerLib();
+  bool Start();
+  void Stop();
+  bool RegisterServerFunc(size_t id, const ServerFunc& server_func);
+
+ private:
+  struct Connection {
+    std::unique_ptr<ShmChannel> channel;
+    std::unique_ptr<std::thread> reader;
+  };
+
+  void Accept();
+  void Loop(ShmChannel* channel);
+  void Process(ShmChannel* channel, std::unique_ptr<char[]> message, size_t size);
+
+  int port_;
+  int thread_num_;
+  int listen_fd_;
+  std::atomic<bool> stop_;
+  std::unique_ptr<ThreadPool> pool_;
+  std::unique_ptr<std::thread> accept_thread_;
+  std::mutex mu_;
+  std::vector<std::unique_ptr<Connection>> conns_;
+};
+
+} // namespace shm
+} // namespace service
+} // namespace ps
+
+#endif // PS_SERVICE_SHM_LIB_SHM_SERVER_LIB_H_
@@ -0,0 +1,207 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "xdl/core/framework/caching_allocator.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#include <functional>
+#include <new>
+#include <set>
+#include <thread>
+#include <vector>
+
+using xdl::Allocator;
+using xdl::CachingAllocator;
+
+namespace {
+class MockAllocator : public Allocator {
+ public:
+  MockAllocator() : counter_(0) {}
+  void* Allocate(size_t size) override {
+    counter_++;
+    return malloc(size);
+  }
+  void Deallocate(void* b) override {
+    counter_--;
+    free(b);
+  }
+  int Counter() {
+    return counter_;
+  }
+ private:
+  std::atomic<int> counter_;
+};
+
+// Run fn on a thread pinned to cpu, so the thread caches share a numa node
+void RunOnCpu(int cpu, std::function<void()> fn) {
+  std::thread thread([cpu, fn] {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    fn();
+  });
+  thread.join();
+}
+
+int CurrentCpu() {
+  int cpu = sched_getcpu();
+  return cpu < 0 ? 0 : cpu;
+}
+}
+
+TEST(TestCachingAllocator, SizeClass) {
+  MockAllocator* mock_allocator = new MockAllocator;
+  CachingAllocator* allocator = new CachingAllocator(mock_allocator);
+  void* a = allocator->Allocate(1);
+  ASSERT_EQ(128, allocator->GetStats().in_use);
+  void* b = allocator->Allocate(64);
+  ASSERT_EQ(256, allocator->GetStats().in_use);
+  void* c = allocator->Allocate(65);
+  ASSERT_EQ(512, allocator->GetStats().in_use);
+  void* d = allocator->Allocate((1 << 20) - CachingAllocator::kHeaderSize);
+  ASSERT_EQ(512 + (1 << 20), allocator->GetStats().in_use);
+  ASSERT_EQ(3 * CachingAllocator::kSlabSize, allocator->GetStats().reserved);
+  allocator->Deallocate(a);
+  allocator->Deallocate(b);
+  allocator->Deallocate(c);
+  allocator->Deallocate(d);
+  ASSERT_EQ(0, allocator->GetStats().in_use);
+
+  // the freed block of a class is the next one of it
+  void* e = allocator->Allocate(100);
+  ASSERT_EQ(c, e);
+  allocator->Deallocate(e);
+  CachingAllocator::Stats stats = allocator->GetStats();
+  ASSERT_EQ(2, stats.cache_hits);
+  ASSERT_EQ(3, stats.cache_misses);
+  allocator->UnRef();
+  mock_allocator->UnRef();
+}
+
+TEST(TestCachingAllocator, LargeAllocation) {
+  MockAllocator* mock_allocator = new MockAllocator;
+  CachingAllocator* allocator = new CachingAllocator(mock_allocator);
+  int counter = mock_allocator->Counter();
+  size_t size = 1 << 20;
+  char* buf = static_cast<char*>(allocator->Allocate(size));
+  ASSERT_EQ(counter + 1, mock_allocator->Counter());
+  buf[0] = 1;
+  buf[size - 1] = 1;
+  CachingAllocator::Stats stats = allocator->GetStats();
+  ASSERT_EQ(size + CachingAllocator::kHeaderSize, stats.in_use);
+  ASSERT_EQ(size + CachingAllocator::kHeaderSize, stats.reserved);
+  ASSERT_EQ(0, stats.cache_hits + stats.cache_misses);
+  allocator->Deallocate(buf);
+  ASSERT_EQ(counter, mock_allocator->Counter());
+  ASSERT_EQ(0, allocator->GetStats().in_use);
+  ASSERT_EQ(0, allocator->GetStats().reserved);
+  allocator->UnRef();
+  mock_allocator->UnRef();
+}
+
+TEST(TestCachingAllocator, CrossThreadFree) {
+  MockAllocator* mock_allocator = new MockAllocator;
+  CachingAllocator* allocator = new CachingAllocator(mock_allocator);
+  int cpu = CurrentCpu();
+  std::vector<void*> bufs;
+  RunOnCpu(cpu, [&] {
+    for (int i = 0; i < 100; i++) {
+      bufs.push_back(allocator->Allocate(100));
+    }
+  });
+  ASSERT_EQ(100 * 256, allocator->GetStats().in_use);
+  std::vector<void*> again;
+  RunOnCpu(cpu, [&] {
+    for (void* buf : bufs) {
+      allocator->Deallocate(buf);
+    }
+    // the blocks freed here are reused by this thread
+    again.push_back(allocator->Allocate(100));
+  });
+  ASSERT_EQ(bufs.back(), again.back());
+  ASSERT_EQ(256, allocator->GetStats().in_use);
+  allocator->Deallocate(again.back());
+  ASSERT_EQ(0, allocator->GetStats().in_use);
+  ASSERT_EQ(CachingAllocator::kSlabSize, allocator->GetStats().reserved);
+  allocator->UnRef();
+  mock_allocator->UnRef();
+}
+
+TEST(TestCachingAllocator, Flush) {
+  MockAllocator* mock_allocator = new MockAllocator;
+  CachingAllocator* allocator = new CachingAllocator(mock_allocator);
+  int cpu = CurrentCpu();
+  size_t size = 1000;
+
+  // a full magazine flushes half of itself to the arena for the others
+  std::set<void*> freed;
+  std::vector<void*> taken;
+  RunOnCpu(cpu, [&] {
+    std::vector<void*> bufs;
+    for (size_t i = 0; i <= CachingAllocator::kMagazineSize; i++) {
+      bufs.push_back(allocator->Allocate(size));
+    }
+    for (void* buf : bufs) {
+      allocator->Deallocate(buf);
+      freed.insert(buf);
+    }
+    RunOnCpu(cpu, [&] {
+      taken.push_back(allocator->Allocate(size));
+    });
+  });
+  ASSERT_EQ(1u, freed.count(taken.back()));
+  allocator->Deallocate(taken.back());
+
+  // an exiting thread flushes all of its magazines
+  freed.clear();
+  taken.clear();
+  RunOnCpu(cpu, [&] {
+    freed.insert(allocator->Allocate(size));
+    allocator->Deallocate(*freed.begin());
+  });
+  RunOnCpu(cpu, [&] {
+    taken.push_back(allocator->Allocate(size));
+    allocator->Deallocate(taken.back());
+  });
+  ASSERT_EQ(1u, freed.count(taken.back()));
+  ASSERT_EQ(0, allocator->GetStats().in_use);
+  ASSERT_EQ(CachingAllocator::kSlabSize, allocator->GetStats().reserved);
+  allocator->UnRef();
+  mock_allocator->UnRef();
+}
+
+TEST(TestCachingAllocator, ReusedAddress) {
+  MockAllocator* mock_allocator = new MockAllocator;
+  alignas(CachingAllocator) char storage[sizeof(CachingAllocator)];
+  CachingAllocator* allocator = new (storage) CachingAllocator(mock_allocator);
+  allocator->Deallocate(allocator->Allocate(1));
+  allocator->~CachingAllocator();
+
+  // a new allocator at the same address has no thread cache yet
+  allocator = new (storage) CachingAllocator(mock_allocator);
+  void* buf = allocator->Allocate(1);
+  CachingAllocator::Stats stats = allocator->GetStats();
+  ASSERT_EQ(128, stats.in_use);
+  ASSERT_EQ(0, stats.cache_hits);
+  ASSERT_EQ(1, stats.cache_misses);
+  allocator->Deallocate(buf);
+  allocator->~CachingAllocator();
+  mock_allocator->UnRef();
+}
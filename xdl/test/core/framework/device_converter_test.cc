@@ -0,0 +1,116 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <string.h>
+
+#include "gtest/gtest.h"
+#include "xdl/core/framework/device_converter.h"
+
+using xdl::Allocator;
+using xdl::DataType;
+using xdl::Device;
+using xdl::DeviceConverter;
+using xdl::Status;
+using xdl::Tensor;
+using xdl::TensorShape;
+using xdl::ThreadPool;
+
+namespace {
+
+class MockAllocator : public Allocator {
+ public:
+  void* Allocate(size_t size) override {
+    return new char[size];
+  }
+  void Deallocate(void* buf) override {
+    delete [] reinterpret_cast<char*>(buf);
+  }
+};
+
+class MockDevice : public Device {
+ public:
+  MockDevice() : Device(new MockAllocator) {}
+  std::string DeviceType() override {
+    return "MockDevice";
+  }
+};
+
+// Copies by value, fails the tensors of kFailSize elements
+class MockConverter : public DeviceConverter {
+ public:
+  void Convert(Device* src_device, Device* dst_device,
+               Tensor src, Tensor* dst,
+               ThreadPool* tp, std::function<void(Status)> cb) override {
+    converted++;
+    if (src.Shape().NumElements() == kFailSize) {
+      cb(Status::Internal("convert failed"));
+      return;
+    }
+    *dst = Tensor(dst_device, src.Shape(), src.Type());
+    memcpy(dst->Raw<char>(), src.Raw<char>(), src.GetBuffer()->size());
+    cb(Status::Ok());
+  }
+  static constexpr size_t kFailSize = 3;
+  int converted = 0;
+};
+
+Tensor MakeTensor(Device* device, size_t size, float value) {
+  Tensor tensor(device, TensorShape({size}), DataType::kFloat);
+  for (size_t i = 0; i < size; i++) {
+    tensor.Raw<float>()[i] = value;
+  }
+  return tensor;
+}
+
+}  // namespace
+
+TEST(DeviceConverterTest, ConvertBatch) {
+  std::unique_ptr<MockDevice> src_device(new MockDevice);
+  std::unique_ptr<MockDevice> dst_device(new MockDevice);
+  MockConverter converter;
+  std::vector<Tensor> src = {
+    MakeTensor(src_device.get(), 2, 1), MakeTensor(src_device.get(), 4, 2)};
+  std::vector<Tensor> dst;
+  int done = 0;
+  converter.ConvertBatch(src_device.get(), dst_device.get(), src, &dst,
+                         nullptr, [&done](Status st) {
+    EXPECT_TRUE(st.IsOk());
+    done++;
+  });
+  EXPECT_EQ(1, done);
+  EXPECT_EQ(2, converter.converted);
+  ASSERT_EQ(2u, dst.size());
+  EXPECT_EQ(4u, dst[1].Shape().NumElements());
+  EXPECT_EQ(2, dst[1].Raw<float>()[3]);
+  EXPECT_NE(src[1].Raw<float>(), dst[1].Raw<float>());
+
+  // a failed tensor fails the batch once all are done
+  src.push_back(MakeTensor(src_device.get(), MockConverter::kFailSize, 3));
+  converter.ConvertBatch(src_device.get(), dst_device.get(), src, &dst,
+                         nullptr, [&done](Status st) {
+    EXPECT_FALSE(st.IsOk());
+    done++;
+  });
+  EXPECT_EQ(2, done);
+  EXPECT_EQ(5, converter.converted);
+
+  converter.ConvertBatch(src_device.get(), dst_device.get(), {}, &dst,
+                         nullptr, [&done](Status st) {
+    EXPECT_TRUE(st.IsOk());
+    done++;
+  });
+  EXPECT_EQ(3, done);
+  EXPECT_TRUE(dst.empty());
+}
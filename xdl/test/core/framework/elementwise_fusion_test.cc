@@ -0,0 +1,138 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "xdl/core/framework/graph_def.h"
+#include "xdl/core/framework/grappler.h"
+#include "xdl/core/ops/fused_elementwise_op.h"
+
+using xdl::AttrValue;
+using xdl::NodeDef;
+using xdl::DataType;
+using xdl::OutputSpec;
+using xdl::Status;
+using xdl::GraphDef;
+using xdl::GrapplerRegistry;
+
+namespace {
+
+NodeDef Node(const std::string& name, const std::string& op,
+             const std::vector<std::string>& input,
+             DataType type = DataType::kFloat) {
+  NodeDef ret;
+  ret.name = name;
+  ret.op = op;
+  ret.device.device_name = "GPU";
+  ret.input = input;
+  ret.attr["dtype"].attr_type = AttrValue::kDataType;
+  ret.attr["dtype"].type = type;
+  return ret;
+}
+
+const NodeDef* Find(const GraphDef& def, const std::string& name) {
+  for (auto&& node : def.node) {
+    if (node.name == name) {
+      return &node;
+    }
+  }
+  return nullptr;
+}
+
+}
+
+TEST(ElementwiseFusionTest, FuseTree) {
+  GraphDef def;
+  def.node.push_back(Node("x", "MockOp", {}));
+  def.node.push_back(Node("y", "MockOp", {}));
+  def.node.push_back(Node("c", "MockOp", {}));
+  def.node.push_back(Node("add", "Add", {"x:0", "y:0"}));
+  def.node.push_back(Node("log", "Log", {"add:0", "^c"}));
+  def.node.push_back(Node("mul", "Mul", {"log:0", "x:0"}));
+  def.node.push_back(Node("out", "MockOp", {"mul:0"}));
+  OutputSpec output;
+  output.output.push_back("out:0");
+  ASSERT_EQ(Status::Ok(), GrapplerRegistry::Get()->Process(&def, &output));
+
+  EXPECT_TRUE(Find(def, "add") == nullptr);
+  EXPECT_TRUE(Find(def, "log") == nullptr);
+  const NodeDef* mul = Find(def, "mul");
+  ASSERT_TRUE(mul != nullptr);
+  EXPECT_EQ("FusedElementwise", mul->op);
+  EXPECT_EQ(std::vector<std::string>({"x:0", "y:0", "^c"}), mul->input);
+  EXPECT_EQ(2, mul->attr.at("size").i);
+  EXPECT_EQ("$0 $1 Add Log $0 Mul", mul->attr.at("program").s);
+  EXPECT_EQ("GPU", mul->device.device_name);
+}
+
+TEST(ElementwiseFusionTest, KeepShared) {
+  GraphDef def;
+  def.node.push_back(Node("x", "MockOp", {}));
+  def.node.push_back(Node("i", "MockOp", {}, DataType::kInt64));
+  // add is read twice and sqrt is an output, so neither is fused
+  def.node.push_back(Node("add", "Add", {"x:0", "x:0"}));
+  def.node.push_back(Node("neg", "Negative", {"add:0"}));
+  def.node.push_back(Node("sqrt", "Sqrt", {"add:0"}));
+  def.node.push_back(Node("log", "Log", {"sqrt:0"}));
+  // the int ops are not fused
+  def.node.push_back(Node("isub", "Sub", {"i:0", "i:0"}, DataType::kInt64));
+  def.node.push_back(Node("ineg", "Negative", {"isub:0"}, DataType::kInt64));
+  def.node.push_back(Node("out", "MockOp", {"neg:0", "log:0", "ineg:0"}));
+  OutputSpec output;
+  output.output.push_back("out:0");
+  output.output.push_back("sqrt:0");
+  ASSERT_EQ(Status::Ok(), GrapplerRegistry::Get()->Process(&def, &output));
+
+  EXPECT_EQ("Add", Find(def, "add")->op);
+  EXPECT_EQ("Negative", Find(def, "neg")->op);
+  EXPECT_EQ("Sqrt", Find(def, "sqrt")->op);
+  EXPECT_EQ("Log", Find(def, "log")->op);
+  EXPECT_EQ("Sub", Find(def, "isub")->op);
+  EXPECT_EQ("Negative", Find(def, "ineg")->op);
+}
+
+TEST(ElementwiseFusionTest, Eval) {
+  xdl::FusedElementwiseProgram prog;
+  ASSERT_EQ(Status::Ok(),
+            xdl::ParseFusedElementwiseProgram("$0 $1 Sub $2 Div Negative", 3, &prog));
+  EXPECT_EQ(6, prog.size);
+  EXPECT_EQ(2, prog.depth);
+  EXPECT_NE(Status::Ok(),
+            xdl::ParseFusedElementwiseProgram("$0 Add", 1, &prog));
+  EXPECT_NE(Status::Ok(),
+            xdl::ParseFusedElementwiseProgram("$0 $3 Add", 2, &prog));
+  ASSERT_EQ(Status::Ok(),
+            xdl::ParseFusedElementwiseProgram("$0 $1 Sub $2 Div Negative", 3, &prog));
+
+  // x is 2x3, y 2x1 and z a scalar
+  float x[] = {1, 2, 3, 4, 5, 6};
+  float y[] = {1, 2};
+  float z[] = {2};
+  xdl::FusedElementwiseArgs<float> args;
+  args.in[0] = x;
+  args.in[1] = y;
+  args.in[2] = z;
+  args.mode[0] = xdl::kFusedDense;
+  args.mode[1] = xdl::kFusedStrided;
+  args.mode[2] = xdl::kFusedScalar;
+  args.stride[1][0] = 1;
+  args.stride[1][1] = 0;
+  args.dims[0] = 2;
+  args.dims[1] = 3;
+  args.ndims = 2;
+  args.strided = true;
+  for (int i = 0; i < 6; i++) {
+    EXPECT_EQ(-(x[i] - y[i / 3]) / z[0], xdl::FusedElementwiseEval(prog, args, i));
+  }
+}
@@ -0,0 +1,132 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "xdl/core/framework/graph_def.h"
+#include "xdl/core/grappler/hash_pull_fusion_worker.h"
+#include "xdl/core/utils/string_utils.h"
+
+using xdl::AttrValue;
+using xdl::NodeDef;
+using xdl::DataType;
+using xdl::OutputSpec;
+using xdl::Status;
+using xdl::GraphDef;
+using xdl::HashPullFusionWorker;
+using xdl::StringUtils;
+
+namespace {
+
+NodeDef Node(const std::string& name, const std::string& op,
+             const std::vector<std::string>& input) {
+  NodeDef ret;
+  ret.name = name;
+  ret.op = op;
+  ret.device.device_name = "CPU";
+  ret.input = input;
+  return ret;
+}
+
+NodeDef Batch(const std::string& name, const std::string& ds) {
+  NodeDef ret = Node(name, "GetBatch", {});
+  ret.attr["ds"].attr_type = AttrValue::kString;
+  ret.attr["ds"].s = ds;
+  ret.attr["indicator_count"].attr_type = AttrValue::kInt;
+  ret.attr["indicator_count"].i = 1;
+  ret.attr["sparse_count"].attr_type = AttrValue::kInt;
+  ret.attr["sparse_count"].i = 3;
+  return ret;
+}
+
+NodeDef Pull(const std::string& name, const std::string& var_name,
+             const std::string& ids) {
+  NodeDef ret = Node(name, "PsSparsePullOp", {ids, "sr:0"});
+  ret.attr["var_name"].attr_type = AttrValue::kString;
+  ret.attr["var_name"].s = var_name;
+  ret.attr["var_type"].attr_type = AttrValue::kString;
+  ret.attr["var_type"].s = "hash64";
+  ret.attr["dtype"].attr_type = AttrValue::kDataType;
+  ret.attr["dtype"].type = DataType::kInt64;
+  ret.attr["otype"].attr_type = AttrValue::kDataType;
+  ret.attr["otype"].type = DataType::kFloat;
+  return ret;
+}
+
+// the outputs of batch are 1 indicator, 3 indices and then the 3 ids
+GraphDef CreateDef(const std::string& ids1, const std::string& ids2) {
+  GraphDef ret;
+  ret.node.push_back(Batch("batch", "train"));
+  ret.node.push_back(Batch("test_batch", "test"));
+  ret.node.push_back(Node("sr", "MockOp", {}));
+  ret.node.push_back(Node("unique", "Unique", {"batch:4"}));
+  ret.node.push_back(Pull("p1", "v1", ids1));
+  ret.node.push_back(Pull("p2", "v2", ids2));
+  ret.node.push_back(Node("out", "NoOp", {"^p1", "^p2"}));
+  return ret;
+}
+
+const NodeDef* Fuse(GraphDef* def) {
+  OutputSpec output;
+  output.output.push_back("out:0");
+  HashPullFusionWorker worker;
+  EXPECT_EQ(Status::Ok(), worker.Process(def, &output));
+  for (auto&& node : def->node) {
+    if (node.op == "PsMergedSparsePullOp") {
+      return &node;
+    }
+  }
+  return nullptr;
+}
+
+}
+
+TEST(HashPullFusionTest, PullAheadFromGetBatch) {
+  GraphDef def = CreateDef("batch:6", "batch:4");
+  const NodeDef* node = Fuse(&def);
+  ASSERT_TRUE(node != nullptr);
+  EXPECT_EQ("train", node->attr.at("pull_ahead_ds").s);
+
+  // the features follow the order of var_names
+  std::vector<std::string> var_names =
+      StringUtils::split(node->attr.at("var_names").s, ",");
+  std::vector<std::string> features =
+      StringUtils::split(node->attr.at("pull_ahead_ids").s, ",");
+  ASSERT_EQ(2u, var_names.size());
+  ASSERT_EQ(2u, features.size());
+  for (size_t i = 0; i < var_names.size(); i++) {
+    EXPECT_EQ(var_names[i] == "v1" ? "2" : "0", features[i]);
+  }
+}
+
+TEST(HashPullFusionTest, NoPullAhead) {
+  // ids not straight out of GetBatch
+  GraphDef def = CreateDef("batch:6", "unique:0");
+  const NodeDef* node = Fuse(&def);
+  ASSERT_TRUE(node != nullptr);
+  EXPECT_EQ("", node->attr.at("pull_ahead_ds").s);
+  EXPECT_EQ("", node->attr.at("pull_ahead_ids").s);
+
+  // ids of two data sources
+  def = CreateDef("batch:6", "test_batch:4");
+  node = Fuse(&def);
+  ASSERT_TRUE(node != nullptr);
+  EXPECT_EQ("", node->attr.at("pull_ahead_ds").s);
+
+  // not an ids output of GetBatch
+  def = CreateDef("batch:6", "batch:1");
+  node = Fuse(&def);
+  ASSERT_TRUE(node != nullptr);
+  EXPECT_EQ("", node->attr.at("pull_ahead_ds").s);
+}
@@ -0,0 +1,122 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdlib>
+
+#include "gtest/gtest.h"
+#include "xdl/core/framework/graph_def.h"
+#include "xdl/core/grappler/hash_push_fusion_worker.h"
+
+using xdl::AttrValue;
+using xdl::NodeDef;
+using xdl::DataType;
+using xdl::OutputSpec;
+using xdl::Status;
+using xdl::GraphDef;
+using xdl::HashPushFusionWorker;
+
+namespace {
+
+NodeDef Node(const std::string& name, const std::string& op,
+             const std::vector<std::string>& input) {
+  NodeDef ret;
+  ret.name = name;
+  ret.op = op;
+  ret.device.device_name = "CPU";
+  ret.input = input;
+  return ret;
+}
+
+NodeDef Apply(const std::string& name, const std::string& op,
+              const std::string& var_name,
+              const std::vector<std::string>& input) {
+  NodeDef ret = Node(name, op, input);
+  ret.attr["var_name"].attr_type = AttrValue::kString;
+  ret.attr["var_name"].s = var_name;
+  ret.attr["var_type"].attr_type = AttrValue::kString;
+  ret.attr["var_type"].s = "hash64";
+  ret.attr["dtype"].attr_type = AttrValue::kDataType;
+  ret.attr["dtype"].type = DataType::kInt64;
+  return ret;
+}
+
+GraphDef CreateDef() {
+  GraphDef ret;
+  for (auto name : {"lr1", "acc1", "g1", "i1", "lr2", "mom2", "nest2", "g2", "i2",
+                    "lr3", "acc3", "g3", "i3"}) {
+    ret.node.push_back(Node(name, "MockOp", {}));
+  }
+  ret.node.push_back(Apply("m2", "PsSparseApplyMomentumOp", "v2",
+                           {"lr2:0", "mom2:0", "nest2:0", "g2:0", "i2:0"}));
+  ret.node.push_back(Apply("a1", "PsSparseApplyAdagradOp", "v1",
+                           {"lr1:0", "acc1:0", "g1:0", "i1:0"}));
+  ret.node.push_back(Apply("a3", "PsSparseApplyAdagradOp", "v3",
+                           {"lr3:0", "acc3:0", "g3:0", "i3:0", "^lr1"}));
+  ret.node.push_back(Node("out", "NoOp", {"^a1", "^m2", "^a3"}));
+  return ret;
+}
+
+const NodeDef* Find(const GraphDef& def, const std::string& op) {
+  for (auto&& node : def.node) {
+    if (node.op == op) {
+      return &node;
+    }
+  }
+  return nullptr;
+}
+
+}
+
+TEST(HashPushFusionTest, SameOptimizer) {
+  unsetenv("XDL_MIXED_PUSH_FUSION");
+  GraphDef def = CreateDef();
+  OutputSpec output;
+  output.output.push_back("out:0");
+  HashPushFusionWorker worker;
+  ASSERT_EQ(Status::Ok(), worker.Process(&def, &output));
+  EXPECT_TRUE(Find(def, "PsSparseApplyAdagradMergedOp") != nullptr);
+  EXPECT_TRUE(Find(def, "PsSparseApplyMomentumOp") != nullptr);
+  EXPECT_TRUE(Find(def, "PsSparseApplyMixedMergedOp") == nullptr);
+}
+
+TEST(HashPushFusionTest, MixedOptimizer) {
+  setenv("XDL_MIXED_PUSH_FUSION", "1", 1);
+  GraphDef def = CreateDef();
+  OutputSpec output;
+  output.output.push_back("out:0");
+  HashPushFusionWorker worker;
+  ASSERT_EQ(Status::Ok(), worker.Process(&def, &output));
+  unsetenv("XDL_MIXED_PUSH_FUSION");
+
+  EXPECT_TRUE(Find(def, "PsSparseApplyAdagradOp") == nullptr);
+  EXPECT_TRUE(Find(def, "PsSparseApplyMomentumOp") == nullptr);
+  const NodeDef* node = Find(def, "PsSparseApplyMixedMergedOp");
+  ASSERT_TRUE(node != nullptr);
+  EXPECT_EQ("v1,v3,v2", node->attr.at("var_names").s);
+  EXPECT_EQ("AdagradUpdater,MomentumUpdater", node->attr.at("updaters").s);
+  EXPECT_EQ("2,1", node->attr.at("group_sizes").s);
+  EXPECT_EQ("2,3", node->attr.at("group_args").s);
+  std::vector<std::string> inputs = {
+    "lr1:0", "lr3:0", "acc1:0", "acc3:0", "lr2:0", "mom2:0", "nest2:0",
+    "g1:0", "g3:0", "g2:0", "i1:0", "i3:0", "i2:0", "^lr1"};
+  EXPECT_EQ(inputs, node->input);
+  EXPECT_EQ(7u, node->attr.at("input_type_0").type_list.size());
+  EXPECT_EQ(DataType::kBool, node->attr.at("input_type_0").type_list[6]);
+  const NodeDef* out = Find(def, "NoOp");
+  ASSERT_TRUE(out != nullptr);
+  for (auto& input : out->input) {
+    EXPECT_EQ("^" + node->name, input);
+  }
+}
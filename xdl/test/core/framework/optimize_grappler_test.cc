@@ -0,0 +1,142 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstring>
+
+#include "gtest/gtest.h"
+#include "xdl/core/framework/graph_def.h"
+#include "xdl/core/framework/grappler.h"
+
+using xdl::AttrValue;
+using xdl::NodeDef;
+using xdl::DataType;
+using xdl::OutputSpec;
+using xdl::TensorShape;
+using xdl::Status;
+using xdl::GraphDef;
+using xdl::GrapplerRegistry;
+
+namespace {
+
+NodeDef Constant(const std::string& name, const std::vector<int64_t>& value) {
+  NodeDef ret;
+  ret.name = name;
+  ret.op = "_Constant";
+  ret.device.device_name = "CPU";
+  ret.attr["dtype"].attr_type = AttrValue::kDataType;
+  ret.attr["dtype"].type = DataType::kInt64;
+  ret.attr["shape"].attr_type = AttrValue::kTensorShape;
+  ret.attr["shape"].shape = TensorShape({value.size()});
+  ret.attr["value"].attr_type = AttrValue::kString;
+  ret.attr["value"].s = std::string(reinterpret_cast<const char*>(value.data()),
+                                    value.size() * sizeof(int64_t));
+  return ret;
+}
+
+NodeDef Node(const std::string& name, const std::string& op,
+             const std::vector<std::string>& input) {
+  NodeDef ret;
+  ret.name = name;
+  ret.op = op;
+  ret.device.device_name = "CPU";
+  ret.input = input;
+  ret.attr["dtype"].attr_type = AttrValue::kDataType;
+  ret.attr["dtype"].type = DataType::kInt64;
+  return ret;
+}
+
+const NodeDef* Find(const GraphDef& def, const std::string& name) {
+  for (auto&& node : def.node) {
+    if (node.name == name) {
+      return &node;
+    }
+  }
+  return nullptr;
+}
+
+}
+
+TEST(OptimizeGrapplerTest, FoldConstant) {
+  GraphDef def;
+  def.node.push_back(Constant("a", {1, 2, 3, 4, 5, 6}));
+  def.node.push_back(Constant("s", {2, -1}));
+  def.node.push_back(Node("r", "Reshape", {"a:0", "s:0"}));
+  def.node.push_back(Node("shape", "ShapeOp", {"r:0"}));
+  def.node.push_back(Node("out", "MockOp", {"shape:0", "r:0"}));
+  OutputSpec output;
+  output.output.push_back("out:0");
+  ASSERT_EQ(Status::Ok(), GrapplerRegistry::Get()->Process(&def, &output));
+
+  const NodeDef* r = Find(def, "r");
+  ASSERT_TRUE(r != nullptr);
+  EXPECT_EQ("_Constant", r->op);
+  EXPECT_EQ(TensorShape({2, 3}), r->attr.at("shape").shape);
+  const NodeDef* shape = Find(def, "shape");
+  ASSERT_TRUE(shape != nullptr);
+  EXPECT_EQ("_Constant", shape->op);
+  int64_t dims[2];
+  ASSERT_EQ(sizeof(dims), shape->attr.at("value").s.size());
+  memcpy(dims, shape->attr.at("value").s.data(), sizeof(dims));
+  EXPECT_EQ(2, dims[0]);
+  EXPECT_EQ(3, dims[1]);
+  EXPECT_TRUE(Find(def, "a") == nullptr);
+  EXPECT_TRUE(Find(def, "s") == nullptr);
+}
+
+TEST(OptimizeGrapplerTest, EliminateCommon) {
+  GraphDef def;
+  def.node.push_back(Node("x", "MockOp", {}));
+  def.node.push_back(Node("i1", "IdentityOp", {"x:0"}));
+  def.node.push_back(Node("i2", "IdentityOp", {"x:0"}));
+  def.node.push_back(Node("m1", "MockOp", {"i1:0"}));
+  def.node.push_back(Node("m2", "MockOp", {"i2:0"}));
+  def.node.push_back(Node("out", "MockOp", {"m1:0", "m2:0", "^i2"}));
+  OutputSpec output;
+  output.output.push_back("out:0");
+  output.output.push_back("i2:0");
+  ASSERT_EQ(Status::Ok(), GrapplerRegistry::Get()->Process(&def, &output));
+
+  // one of the identities is kept, the other one's consumers read it
+  std::string kept = Find(def, "i1") != nullptr ? "i1" : "i2";
+  std::string dropped = kept == "i1" ? "i2" : "i1";
+  EXPECT_TRUE(Find(def, dropped) == nullptr);
+  EXPECT_EQ(kept + ":0", Find(def, "m1")->input[0]);
+  EXPECT_EQ(kept + ":0", Find(def, "m2")->input[0]);
+  EXPECT_EQ("^" + kept, Find(def, "out")->input[2]);
+  EXPECT_EQ(kept + ":0", output.output[1]);
+  // MockOp may have side effects, so both of them stay
+  EXPECT_TRUE(Find(def, "m1") != nullptr);
+  EXPECT_TRUE(Find(def, "m2") != nullptr);
+}
+
+TEST(OptimizeGrapplerTest, CollapseChain) {
+  GraphDef def;
+  def.node.push_back(Node("x", "MockOp", {}));
+  def.node.push_back(Node("c", "MockOp", {}));
+  def.node.push_back(Node("i1", "IdentityOp", {"x:0"}));
+  def.node.push_back(Node("i2", "IdentityOp", {"i1:0", "^c"}));
+  def.node.push_back(Node("i3", "IdentityOp", {"i2:0"}));
+  OutputSpec output;
+  output.output.push_back("i3:0");
+  ASSERT_EQ(Status::Ok(), GrapplerRegistry::Get()->Process(&def, &output));
+
+  const NodeDef* i3 = Find(def, "i3");
+  ASSERT_TRUE(i3 != nullptr);
+  ASSERT_EQ(2u, i3->input.size());
+  EXPECT_EQ("x:0", i3->input[0]);
+  EXPECT_EQ("^c", i3->input[1]);
+  EXPECT_TRUE(Find(def, "i1") == nullptr);
+  EXPECT_TRUE(Find(def, "i2") == nullptr);
+}
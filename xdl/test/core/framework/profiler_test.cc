@@ -0,0 +1,140 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "xdl/core/framework/graph.h"
+#include "xdl/core/framework/profiler.h"
+
+using xdl::Graph;
+using xdl::Node;
+using xdl::Profiler;
+
+namespace {
+
+void AddNode(Graph* graph, const std::string& name, const std::string& op,
+             const std::vector<int>& inputs) {
+  graph->nodes.emplace_back();
+  Node& node = graph->nodes.back();
+  node.name = name;
+  node.op_name = op;
+  for (int id : inputs) {
+    node.inputs.push_back(Node::Input{id, 0});
+  }
+}
+
+void SetStat(xdl::proto::PerfStats* stats, const Graph& graph, int id,
+             int64_t start, int64_t end) {
+  xdl::proto::NodeExecStat* stat = stats->mutable_node_stats(id);
+  stat->set_node_name(graph.nodes[id].name);
+  stat->set_op(graph.nodes[id].op_name);
+  stat->set_start_micros(start);
+  stat->set_end_micros(end);
+  stat->set_thread_id(id % 2);
+}
+
+}
+
+TEST(ProfilerTest, Sample) {
+  Profiler* profiler = Profiler::Get();
+  profiler->Start(0.25);
+  int sampled = 0;
+  for (int i = 0; i < 100; i++) {
+    sampled += profiler->Sample() ? 1 : 0;
+  }
+  EXPECT_EQ(25, sampled);
+  profiler->Stop();
+  EXPECT_FALSE(profiler->Sample());
+}
+
+TEST(ProfilerTest, Step) {
+  Graph graph;
+  AddNode(&graph, "_Source", "", {});
+  AddNode(&graph, "_Sink", "", {4});
+  AddNode(&graph, "a", "MockOp", {0});
+  AddNode(&graph, "pull", "PsPullOp", {2});
+  AddNode(&graph, "d", "MockOp", {2, 3, 5});
+  AddNode(&graph, "c", "MockOp", {2});
+  xdl::proto::PerfStats stats;
+  for (size_t i = 0; i < graph.nodes.size(); i++) {
+    stats.add_node_stats();
+  }
+  SetStat(&stats, graph, 2, 100, 110);
+  SetStat(&stats, graph, 3, 110, 150);
+  SetStat(&stats, graph, 5, 110, 130);
+  SetStat(&stats, graph, 4, 150, 160);
+
+  EXPECT_EQ(std::vector<int>({2, 3, 4}), Profiler::CriticalPath(graph, stats));
+
+  Profiler* profiler = Profiler::Get();
+  profiler->Clear();
+  profiler->Start(1);
+  profiler->AddStep(graph, stats);
+  profiler->AddSpan("data_io", "GetBatch", 90, 100);
+  profiler->Stop();
+
+  auto ops = profiler->OpStats();
+  EXPECT_EQ(3, ops["MockOp"].count);
+  EXPECT_EQ(40, ops["MockOp"].total_micros);
+  EXPECT_EQ(20, ops["MockOp"].max_micros);
+  EXPECT_EQ(20, ops["MockOp"].critical_micros);
+  EXPECT_EQ(40, ops["PsPullOp"].critical_micros);
+  EXPECT_EQ(10, ops["data_io:GetBatch"].total_micros);
+
+  std::string trace = profiler->ChromeTrace();
+  EXPECT_NE(std::string::npos, trace.find("\"traceEvents\""));
+  EXPECT_NE(std::string::npos, trace.find("\"name\":\"pull\",\"cat\":\"ps_rpc\""));
+  EXPECT_NE(std::string::npos, trace.find("\"cat\":\"data_io\""));
+  EXPECT_NE(std::string::npos, trace.find("a -> pull -> d"));
+  EXPECT_NE(std::string::npos, profiler->Summary().find("PsPullOp"));
+
+  profiler->Clear();
+  EXPECT_TRUE(profiler->OpStats().empty());
+}
+
+TEST(ProfilerTest, Trace) {
+  Graph graph;
+  AddNode(&graph, "_Source", "", {});
+  AddNode(&graph, "_Sink", "", {3});
+  AddNode(&graph, "a", "MockOp", {0});
+  AddNode(&graph, "pull", "PsPullOp", {2});
+  xdl::proto::PerfStats stats;
+  for (size_t i = 0; i < graph.nodes.size(); i++) {
+    stats.add_node_stats();
+  }
+  SetStat(&stats, graph, 2, 100, 110);
+  SetStat(&stats, graph, 3, 110, 150);
+
+  std::vector<ps::common::TraceSpan> spans;
+  ps::common::Tracer* tracer = ps::common::Tracer::Instance();
+  tracer->SetExporter([&spans](const std::vector<ps::common::TraceSpan>& batch) {
+    spans.insert(spans.end(), batch.begin(), batch.end());
+  });
+  ps::common::TraceContext step(ps::common::Tracer::NewId(),
+                                ps::common::Tracer::NewId());
+  Profiler::ExportTrace(stats, step);
+  tracer->Flush();
+  tracer->SetExporter(nullptr);
+
+  ASSERT_EQ(3u, spans.size());
+  EXPECT_EQ("pull", spans[1].name);
+  EXPECT_EQ("ps_rpc", spans[1].category);
+  EXPECT_EQ(Profiler::NodeSpanId(step, 3), spans[1].span_id);
+  EXPECT_EQ(step.span_id, spans[1].parent_id);
+  EXPECT_EQ("step", spans[2].name);
+  EXPECT_EQ(step.span_id, spans[2].span_id);
+  EXPECT_EQ(0u, spans[2].parent_id);
+  EXPECT_EQ(100, spans[2].start_micros);
+  EXPECT_EQ(150, spans[2].end_micros);
+}
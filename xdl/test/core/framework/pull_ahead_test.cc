@@ -0,0 +1,122 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+#include "xdl/core/ops/ps_ops/pull_ahead.h"
+#include "ps-plus/common/initializer/none_initializer.h"
+
+using xdl::PullAhead;
+using xdl::PrefetchedPull;
+using xdl::PrefetchSlot;
+
+namespace {
+
+ps::Tensor Ids(const std::vector<int64_t>& ids) {
+  ps::Tensor ret(ps::DataType::kInt64, ps::TensorShape({ids.size()}),
+                 new ps::initializer::NoneInitializer());
+  for (size_t i = 0; i < ids.size(); i++) {
+    ret.Raw<int64_t>()[i] = ids[i];
+  }
+  return ret;
+}
+
+std::shared_ptr<PrefetchedPull> Pull(int64_t step,
+                                     const std::vector<int64_t>& ids) {
+  std::shared_ptr<PrefetchedPull> ret = std::make_shared<PrefetchedPull>();
+  ret->step = step;
+  ret->ids.push_back(Ids(ids));
+  return ret;
+}
+
+}
+
+TEST(PullAheadTest, PublishToSubscribers) {
+  int calls = 0;
+  int other_calls = 0;
+  int id = PullAhead::Get()->Subscribe(
+      "ds", [&](const std::vector<xdl::Tensor>& next_ids) {
+        EXPECT_EQ(2u, next_ids.size());
+        calls++;
+      });
+  int other_id = PullAhead::Get()->Subscribe(
+      "other", [&](const std::vector<xdl::Tensor>& next_ids) {
+        other_calls++;
+      });
+  EXPECT_TRUE(PullAhead::Get()->HasListener("ds"));
+  EXPECT_FALSE(PullAhead::Get()->HasListener("none"));
+  PullAhead::Get()->Publish("ds", std::vector<xdl::Tensor>(2));
+  EXPECT_EQ(1, calls);
+  EXPECT_EQ(0, other_calls);
+
+  PullAhead::Get()->Unsubscribe(id);
+  EXPECT_FALSE(PullAhead::Get()->HasListener("ds"));
+  PullAhead::Get()->Publish("ds", std::vector<xdl::Tensor>(2));
+  EXPECT_EQ(1, calls);
+  PullAhead::Get()->Unsubscribe(other_id);
+}
+
+TEST(PullAheadTest, Match) {
+  std::shared_ptr<PrefetchedPull> pull = Pull(1, {1, 2, 3});
+  std::vector<ps::Tensor> same = {Ids({1, 2, 3})};
+  EXPECT_FALSE(pull->Match(same));
+  pull->Done(ps::Status::Ok());
+  EXPECT_TRUE(pull->Match(same));
+
+  std::vector<ps::Tensor> other = {Ids({1, 2, 4})};
+  EXPECT_FALSE(pull->Match(other));
+  std::vector<ps::Tensor> shorter = {Ids({1, 2})};
+  EXPECT_FALSE(pull->Match(shorter));
+  std::vector<ps::Tensor> more = {Ids({1, 2, 3}), Ids({1})};
+  EXPECT_FALSE(pull->Match(more));
+
+  std::shared_ptr<PrefetchedPull> failed = Pull(1, {1, 2, 3});
+  failed->Done(ps::Status::NotFound("variable"));
+  EXPECT_FALSE(failed->Match(same));
+}
+
+TEST(PullAheadTest, WaitDone) {
+  std::shared_ptr<PrefetchedPull> pull = Pull(1, {1});
+  int waited = 0;
+  pull->Wait([&] { waited++; });
+  EXPECT_EQ(0, waited);
+  pull->Done(ps::Status::Ok());
+  EXPECT_EQ(1, waited);
+  pull->Wait([&] { waited++; });
+  EXPECT_EQ(2, waited);
+}
+
+TEST(PullAheadTest, TakeByStep) {
+  PrefetchSlot slot;
+  EXPECT_EQ(nullptr, slot.Take(0));
+
+  // issued during step 0 for step 1, the pull of step 0 falls back
+  std::shared_ptr<PrefetchedPull> pull = Pull(1, {1});
+  slot.Park(pull);
+  EXPECT_EQ(nullptr, slot.Take(0));
+  EXPECT_EQ(pull, slot.Take(1));
+  EXPECT_EQ(nullptr, slot.Take(1));
+
+  // a pull its step skipped is dropped
+  slot.Park(Pull(2, {1}));
+  EXPECT_EQ(nullptr, slot.Take(3));
+  EXPECT_EQ(nullptr, slot.Take(2));
+
+  // the later pull replaces the parked one
+  slot.Park(Pull(4, {1}));
+  pull = Pull(5, {1});
+  slot.Park(pull);
+  EXPECT_EQ(nullptr, slot.Take(4));
+  EXPECT_EQ(pull, slot.Take(5));
+}
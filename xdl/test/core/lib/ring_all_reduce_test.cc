@@ -0,0 +1,77 @@
+/* Copyright 2018 Alibaba Group. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
+
+#include "xdl/core/lib/ring_all_reduce.h"
+#include "gtest/gtest.h"
+
+namespace xdl {
+
+TEST(RingAllReduceTest, AllReduce) {
+  const int ranks = 3;
+  int base = 20000 + getpid() % 20000;
+  std::vector<std::string> addresses;
+  for (int i = 0; i < ranks; ++i) {
+    addresses.push_back("127.0.0.1:" + std::to_string(base + i));
+  }
+
+  // the sizes of segments of zero, uneven ones and a large one
+  std::vector<size_t> sizes = {1, 2, 7, 1000, 1 << 20};
+  std::vector<std::vector<std::vector<float>>> data(ranks);
+  std::vector<std::thread> threads;
+  std::vector<bool> ok(ranks, false);
+  for (int r = 0; r < ranks; ++r) {
+    threads.emplace_back([&, r] {
+      RingAllReduce ring;
+      if (!ring.Init(r, addresses, 10000).IsOk()) return;
+      for (size_t size : sizes) {
+        std::vector<float> values(size);
+        for (size_t i = 0; i < size; ++i) {
+          values[i] = r * 10 + i % 10;
+        }
+        if (!ring.AllReduce(values.data(), size).IsOk()) return;
+        data[r].push_back(values);
+      }
+      ok[r] = true;
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (int r = 0; r < ranks; ++r) {
+    ASSERT_TRUE(ok[r]);
+    for (size_t k = 0; k < sizes.size(); ++k) {
+      for (size_t i = 0; i < sizes[k]; ++i) {
+        ASSERT_EQ(30 + 3 * (i % 10), data[r][k][i]);
+      }
+    }
+  }
+}
+
+TEST(RingAllReduceTest, Single) {
+  RingAllReduce ring;
+  ASSERT_TRUE(ring.Init(0, {"127.0.0.1:1"}).IsOk());
+  float value = 1;
+  ASSERT_TRUE(ring.AllReduce(&value, 1).IsOk());
+  ASSERT_EQ(1, value);
+  ASSERT_FALSE(ring.Init(1, {"127.0.0.1:1"}).IsOk());
+}
+
+}  // namespace xdl
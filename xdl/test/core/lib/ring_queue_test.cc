@@ -0,0 +1,96 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+/*
+ * Copyright 1999-2017 Alibaba Group.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <thread>
+#include <vector>
+
+#include "xdl/core/lib/ring_queue.h"
+#include "gtest/gtest.h"
+
+namespace xdl {
+
+TEST(TestRingQueue, All) {
+  RingQueue<int> rq(3);
+  EXPECT_TRUE(rq.Empty());
+  EXPECT_EQ(4u, rq.Stats().capacity);
+
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(rq.TryEnqueue(i, 0));
+  }
+  EXPECT_FALSE(rq.TryEnqueue(4, 1));
+  rq.ForceEnqueue(4);
+  EXPECT_EQ(5u, rq.Size());
+
+  int item;
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_TRUE(rq.TryDequeue(&item, 0));
+    EXPECT_EQ(i, item);
+  }
+  EXPECT_FALSE(rq.TryDequeue(&item, 1));
+  EXPECT_TRUE(rq.Empty());
+
+  auto stats = rq.Stats();
+  EXPECT_EQ(5u, stats.enqueued);
+  EXPECT_EQ(5u, stats.dequeued);
+  EXPECT_GE(stats.full_micros, 1000u);
+  EXPECT_GE(stats.empty_micros, 1000u);
+}
+
+TEST(TestRingQueue, Concurrent) {
+  const int kThreads = 4;
+  const int kItems = 100000;
+  RingQueue<int> rq(64);
+  std::vector<std::thread> threads;
+  std::vector<long> sums(kThreads, 0);
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&rq, t]() {
+      for (int i = 0; i < kItems; ++i) {
+        rq.Enqueue(t * kItems + i);
+      }
+    });
+    threads.emplace_back([&rq, &sums, t]() {
+      for (int i = 0; i < kItems; ++i) {
+        sums[t] += rq.Dequeue();
+      }
+    });
+  }
+  for (auto &th : threads) {
+    th.join();
+  }
+  long sum = 0;
+  for (auto s : sums) {
+    sum += s;
+  }
+  long n = (long)kThreads * kItems;
+  EXPECT_EQ(n * (n - 1) / 2, sum);
+  EXPECT_TRUE(rq.Empty());
+}
+
+}  // namespace xdl
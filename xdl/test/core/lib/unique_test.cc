@@ -0,0 +1,116 @@
+/* Copyright 2018 Alibaba Group. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "xdl/core/lib/unique.h"
+#include "gtest/gtest.h"
+
+namespace xdl {
+
+namespace {
+
+// Runs the functor on id_num ids of id_dim columns drawn from distinct
+// values, the samples holding 1, 2, 3, ... ids, and checks the outputs
+// against a std::map reference.
+void CheckUnique(size_t id_num, size_t id_dim, int64_t distinct, bool ordered) {
+  CpuDevice device;
+  TensorShape shape = id_dim == 1 ? TensorShape({id_num}) : TensorShape({id_num, id_dim});
+  Tensor in(&device, shape, DataType::kInt64);
+  int64_t* pin = in.Raw<int64_t>();
+  for (size_t i = 0; i < id_num; ++i) {
+    int64_t value = (i * 7919) % distinct;
+    for (size_t k = 0; k < id_dim; ++k) {
+      pin[i * id_dim + k] = value * (k + 1);
+    }
+  }
+  std::vector<int32_t> ends;
+  std::vector<int32_t> sample_of(id_num);
+  for (size_t end = 0, size = 1; end < id_num; ++size) {
+    size_t begin = end;
+    end = std::min(id_num, end + size);
+    for (size_t i = begin; i < end; ++i) {
+      sample_of[i] = ends.size();
+    }
+    ends.push_back(end);
+  }
+  Tensor segment(&device, TensorShape({ends.size()}), DataType::kInt32);
+  std::copy(ends.begin(), ends.end(), segment.Raw<int32_t>());
+
+  Tensor out, out_index, sample_index, sample_segment;
+  functor::UniqueFunctor<CpuDevice, int64_t, int32_t>()(
+      &device, in, segment, &out, &out_index, &sample_index, &sample_segment);
+
+  // reference: the positions of every id in input order
+  std::map<std::vector<int64_t>, std::vector<size_t>> positions;
+  std::vector<std::vector<int64_t>> first_order;
+  for (size_t i = 0; i < id_num; ++i) {
+    std::vector<int64_t> id(pin + i * id_dim, pin + (i + 1) * id_dim);
+    if (positions[id].empty()) first_order.push_back(id);
+    positions[id].push_back(i);
+  }
+  size_t uniq_num = positions.size();
+  ASSERT_EQ(uniq_num, out.Shape()[0]);
+  ASSERT_EQ(id_dim == 1 ? 1u : 2u, out.Shape().Size());
+  ASSERT_EQ(id_num, out_index.Shape()[0]);
+  ASSERT_EQ(id_num, sample_index.Shape()[0]);
+  ASSERT_EQ(uniq_num, sample_segment.Shape()[0]);
+
+  int64_t* pout = out.Raw<int64_t>();
+  int32_t* pindex = out_index.Raw<int32_t>();
+  int32_t* psample_index = sample_index.Raw<int32_t>();
+  int32_t* psample_segment = sample_segment.Raw<int32_t>();
+  std::map<std::vector<int64_t>, int32_t> uniques;
+  for (size_t j = 0; j < uniq_num; ++j) {
+    std::vector<int64_t> id(pout + j * id_dim, pout + (j + 1) * id_dim);
+    ASSERT_TRUE(uniques.emplace(id, j).second);
+    if (ordered) {
+      ASSERT_EQ(first_order[j], id);
+    }
+  }
+  for (const auto& item : positions) {
+    ASSERT_EQ(1u, uniques.count(item.first));
+    int32_t j = uniques[item.first];
+    int32_t begin = j == 0 ? 0 : psample_segment[j - 1];
+    ASSERT_EQ(item.second.size(), psample_segment[j] - begin);
+    for (size_t k = 0; k < item.second.size(); ++k) {
+      ASSERT_EQ(j, pindex[item.second[k]]);
+      ASSERT_EQ(sample_of[item.second[k]], psample_index[begin + k]);
+    }
+  }
+  ASSERT_EQ(static_cast<int32_t>(id_num), psample_segment[uniq_num - 1]);
+}
+
+}  // namespace
+
+TEST(UniqueTest, Unique1D) {
+  CheckUnique(1000, 1, 97, true);
+}
+
+TEST(UniqueTest, Unique2D) {
+  CheckUnique(1000, 2, 97, true);
+}
+
+TEST(UniqueTest, ParallelUnique1D) {
+  CheckUnique(200000, 1, 50000, false);
+}
+
+TEST(UniqueTest, ParallelUnique2D) {
+  CheckUnique(200000, 2, 50000, false);
+}
+
+}  // namespace xdl
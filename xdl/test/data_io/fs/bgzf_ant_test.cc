@@ -0,0 +1,90 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/data_io/fs/bgzf_ant.h"
+#include "xdl/data_io/fs/file_system_local.h"
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <memory>
+#include <string>
+
+namespace xdl {
+namespace io {
+
+namespace {
+
+const char *kPath = "bgzf_ant_test.gz";
+
+std::string Write(size_t size) {
+  std::string content(size, 0);
+  for (size_t i = 0; i < size; ++i) {
+    // compressible with some noise
+    content[i] = "abcdefgh"[(i * i + i / 97) % 8];
+  }
+  FileSystemLocal::Get()->Write(kPath, BgzfAnt::Compress(content.data(), size));
+  return content;
+}
+
+std::string ReadAll(IOAnt *ant, size_t step) {
+  std::string read;
+  std::string buf(step, 0);
+  ssize_t n;
+  while ((n = ant->Read(&buf[0], step)) > 0) {
+    read.append(buf.data(), n);
+  }
+  EXPECT_EQ(0, n);
+  return read;
+}
+
+}  // namespace
+
+TEST(BgzfAntTest, Read) {
+  for (size_t size : {0ul, 1000ul, 1ul << 20}) {
+    std::string content = Write(size);
+    std::unique_ptr<IOAnt> ant(new BgzfAnt(FileSystemLocal::Get()->GetAnt(kPath), 4));
+    EXPECT_EQ(content, ReadAll(ant.get(), 10000));
+  }
+  remove(kPath);
+}
+
+TEST(BgzfAntTest, Seek) {
+  std::string content = Write(300000);
+  std::unique_ptr<IOAnt> ant(FileSystemLocal::Get()->GetZAnt(kPath, kBgzf));
+  ant->Seek(100000);
+  EXPECT_EQ(content.substr(100000), ReadAll(ant.get(), 4096));
+  ant->Seek(0);
+  EXPECT_EQ(content, ReadAll(ant.get(), 70000));
+  remove(kPath);
+}
+
+TEST(BgzfAntTest, Broken) {
+  std::string content(200000, 'x');
+  std::string compressed = BgzfAnt::Compress(content.data(), content.size());
+  // flips a byte of the deflated data of the first member
+  compressed[30] ^= 0x55;
+  FileSystemLocal::Get()->Write(kPath, compressed);
+  std::unique_ptr<IOAnt> ant(new BgzfAnt(FileSystemLocal::Get()->GetAnt(kPath)));
+  char buf[1024];
+  EXPECT_EQ(-1, ant->Read(buf, sizeof(buf)));
+
+  FileSystemLocal::Get()->Write(kPath, "not gzip at all");
+  ant.reset(new BgzfAnt(FileSystemLocal::Get()->GetAnt(kPath)));
+  EXPECT_EQ(-1, ant->Read(buf, sizeof(buf)));
+  remove(kPath);
+}
+
+}  // namespace io
+}  // namespace xdl
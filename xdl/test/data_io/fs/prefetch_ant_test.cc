@@ -0,0 +1,91 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/data_io/fs/prefetch_ant.h"
+#include "xdl/data_io/fs/file_system_local.h"
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <memory>
+#include <string>
+
+namespace xdl {
+namespace io {
+
+namespace {
+
+const char *kPath = "prefetch_ant_test.dat";
+const size_t kBlock = 4096;
+
+std::string Write(size_t size) {
+  std::string content(size, 0);
+  for (size_t i = 0; i < size; ++i) {
+    content[i] = static_cast<char>(i * 7 + i / 251);
+  }
+  FileSystemLocal::Get()->Write(kPath, content);
+  return content;
+}
+
+PrefetchAnt *Open() {
+  return new PrefetchAnt(FileSystemLocal::Get()->GetAnt(kPath), kBlock, 3);
+}
+
+}  // namespace
+
+TEST(PrefetchAntTest, Read) {
+  for (size_t size : {0ul, 100ul, kBlock, kBlock * 10 + 13}) {
+    std::string content = Write(size);
+    std::unique_ptr<PrefetchAnt> ant(Open());
+    std::string read;
+    char buf[1000];
+    ssize_t n;
+    while ((n = ant->Read(buf, sizeof(buf))) > 0) {
+      read.append(buf, n);
+    }
+    EXPECT_EQ(0, n);
+    EXPECT_EQ(content, read);
+    EXPECT_EQ(0, ant->Read(buf, sizeof(buf)));
+  }
+  remove(kPath);
+}
+
+TEST(PrefetchAntTest, Seek) {
+  std::string content = Write(kBlock * 10 + 13);
+  std::unique_ptr<PrefetchAnt> ant(Open());
+  std::string buf(kBlock * 3, 0);
+
+  // ahead in the blocks in flight
+  ant->Prefetch();
+  ant->Seek(kBlock + 5);
+  ASSERT_EQ(kBlock * 2, ant->Read(&buf[0], kBlock * 2));
+  EXPECT_EQ(content.substr(kBlock + 5, kBlock * 2), buf.substr(0, kBlock * 2));
+
+  // back and past them
+  ant->Seek(10);
+  ASSERT_EQ(100, ant->Read(&buf[0], 100));
+  EXPECT_EQ(content.substr(10, 100), buf.substr(0, 100));
+  ant->Seek(kBlock * 8);
+  ASSERT_EQ(kBlock * 2 + 13, ant->Read(&buf[0], kBlock * 3));
+  EXPECT_EQ(content.substr(kBlock * 8), buf.substr(0, kBlock * 2 + 13));
+
+  // from the end of the file
+  ant->Seek(0);
+  ASSERT_EQ(kBlock, ant->Read(&buf[0], kBlock));
+  EXPECT_EQ(content.substr(0, kBlock), buf.substr(0, kBlock));
+  remove(kPath);
+}
+
+}  // namespace io
+}  // namespace xdl
@@ -17,7 +17,9 @@ limitations under the License.
 #include "gtest/gtest.h"
 #include "xdl/core/ops/ps_ops/client.h"
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string>
 
 namespace xdl {
 namespace io {
@@ -66,7 +68,7 @@ TEST(GlobalSchedulerTest, TestRestore) {
   EXPECT_STREQ(rparam->path_, path);
   EXPECT_NE(nullptr, rparam->ant_);
 
-  rparam->begin_ = 1;
+  rparam->parsed_ = 1;
 
   rparam = sched.Acquire();
   ASSERT_NE(nullptr, rparam);
@@ -76,7 +78,7 @@ TEST(GlobalSchedulerTest, TestRestore) {
   EXPECT_STREQ(rparam->path_, path2);
   EXPECT_NE(nullptr, rparam->ant_);
 
-  rparam->begin_ = 2;
+  rparam->parsed_ = 2;
 
   DSState ds_state;
   sched.Store(&ds_state);
@@ -108,6 +110,43 @@ TEST(GlobalSchedulerTest, TestRestore) {
     EXPECT_NE(nullptr, rparam->ant_);
   }
 }
+TEST(GlobalSchedulerTest, TestSplit) {
+  ResetClient();
+  ConnectToClient("localhost", "./v1");
+  const char *split_path = "split.txt";
+  FILE *fp = fopen(split_path, "w");
+  ASSERT_NE(nullptr, fp);
+  std::string line(99, 'x');
+  for (int i = 0; i < 100; ++i) {
+    fprintf(fp, "%s\n", line.c_str());
+  }
+  fclose(fp);
+
+  GlobalScheduler sched("g2", kLocal);
+  sched.AddPath(split_path);
+  ASSERT_TRUE(sched.SetSplit(4000));
+  ASSERT_TRUE(sched.Schedule());
+
+  // ranges of 4000 bytes up to the last 5% of the 10000, then of 500
+  const size_t ends[] = {4000, 8000, 9500, 10000};
+  size_t end = 0;
+  for (int i = 0; ; ++i) {
+    ReadParam *rparam = sched.Acquire();
+    if (rparam == nullptr) {
+      break;
+    }
+    EXPECT_STREQ(split_path, rparam->path_);
+    EXPECT_EQ(10000, rparam->end_);
+    EXPECT_EQ(i > 0, rparam->skip_);
+    EXPECT_EQ(end == 0 ? 0 : end - 1, rparam->begin_);
+    end = rparam->limit_ == 0 ? 10000 : rparam->limit_;
+    ASSERT_LT(i, 4);
+    EXPECT_EQ(ends[i], end);
+    sched.Release(rparam);
+  }
+  EXPECT_EQ(10000, end);
+  remove(split_path);
+}
 
 }
 }
@@ -118,6 +118,27 @@ TEST_F(MergerTest, TestRun) {
   EXPECT_EQ(nullptr, c->ts_[Block::kSSegment]);    
 }
 
+TEST_F(MergerTest, TestStart) {
+  EXPECT_EQ(nullptr, merger_->Wait());
+  merger_->Start(&batch_);
+  EXPECT_EQ(&batch_, merger_->Wait());
+  EXPECT_EQ(nullptr, merger_->Wait());
+
+  auto a = batch_.Get("a");
+  auto ukey = a->ts_[Block::kUKey]->Raw<int64_t>();
+  auto index = a->ts_[Block::kIndex]->Raw<int32_t>();
+  for (size_t i = 0; i < kFeatureCount; ++i) {
+    EXPECT_EQ(i64_[i], ukey[index[i]]);
+  }
+  auto b = batch_.Get("b");
+  ukey = b->ts_[Block::kUKey]->Raw<int64_t>();
+  index = b->ts_[Block::kIndex]->Raw<int32_t>();
+  for (size_t i = 0; i < kFeatureCount; ++i) {
+    EXPECT_EQ(i128_[i].first, ukey[index[i] * 2]);
+    EXPECT_EQ(i128_[i].second, ukey[index[i] * 2 + 1]);
+  }
+}
+
 }  // io
 }  // xdl
 
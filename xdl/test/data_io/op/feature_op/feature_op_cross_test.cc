@@ -0,0 +1,83 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include "xdl/data_io/op/feature_op/feature_op.h"
+#include "xdl/data_io/op/feature_op/multi_feature_op/multi_feature_func/cartesian_product.h"
+#include "xdl/proto/sample.pb.h"
+
+using xdl::io::CartesianProduct;
+using xdl::io::Feature;
+using xdl::io::FeatureLine;
+using xdl::io::FeatureNameVec;
+using xdl::io::FeatureOP;
+using xdl::io::FeatureTable;
+using xdl::io::FeatureValue;
+using xdl::io::SampleGroup;
+
+namespace {
+
+void AddFeature(FeatureLine *feature_line, const char *name,
+                const std::vector<int64_t> &keys, const std::vector<float> &values) {
+  Feature *feature = feature_line->add_features();
+  feature->set_name(name);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    FeatureValue *feature_value = feature->add_values();
+    feature_value->set_key(keys[i]);
+    feature_value->set_value(values[i]);
+  }
+}
+
+}  // namespace
+
+TEST(FeatureOpTest, CrossLines) {
+  // table 0 has three samples of one ad in table 1, the last one without nick_cate
+  SampleGroup sample_group;
+  FeatureTable *sample_table = sample_group.add_feature_tables();
+  FeatureTable *ad_table = sample_group.add_feature_tables();
+  AddFeature(ad_table->add_feature_lines(), "ad_cate", {3}, {2});
+  for (int i = 0; i < 3; ++i) {
+    FeatureLine *feature_line = sample_table->add_feature_lines();
+    feature_line->set_refer(0);
+    if (i < 2)  AddFeature(feature_line, "nick_cate", {1, 2 + i}, {0.5, 1});
+  }
+
+  std::vector<FeatureNameVec> feature_name_vecs(2);
+  feature_name_vecs[0].push_back("nick_cate");
+  feature_name_vecs[1].push_back("ad_cate");
+  std::vector<std::string> dsl_arr = {
+    "Name=ad_nick_cate; Expr=cartesian(ad_cate,nick_cate); Type=Numeric;"
+  };
+  FeatureOP feature_op;
+  feature_op.Init(dsl_arr, feature_name_vecs);
+  feature_op.Run(&sample_group);
+
+  for (int i = 0; i < 2; ++i) {
+    const FeatureLine &feature_line = sample_group.feature_tables(0).feature_lines(i);
+    ASSERT_EQ(feature_line.features_size(), 2);
+    const Feature &feature = feature_line.features(1);
+    EXPECT_EQ(feature.name(), "ad_nick_cate");
+    ASSERT_EQ(feature.values_size(), 2);
+    EXPECT_EQ(feature.values(0).key(), CartesianProduct::CombineKey(3, 1));
+    EXPECT_FLOAT_EQ(feature.values(0).value(), 1);
+    EXPECT_EQ(feature.values(1).key(), CartesianProduct::CombineKey(3, 2 + i));
+    EXPECT_FLOAT_EQ(feature.values(1).value(), 2);
+  }
+  EXPECT_EQ(sample_group.feature_tables(0).feature_lines(2).features_size(), 0);
+}
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <cstdlib>
 #include <ctime>
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <string>
@@ -178,6 +179,79 @@ TEST_F(PackSKeyTest, Run) {
   TestRun();
 }
 
+TEST(PackSKeyHashTest, Run) {
+  CpuDevice dev;
+  Schema schema;
+  schema.batch_size_ = 8;
+  schema.skey_hash_ = true;
+  schema.skey_dict_ = "skey_hash_test.dict";
+  remove(schema.skey_dict_.c_str());
+  PackSKey pack(&dev, &schema);
+  Batch *batch = BatchPool::Get()->Acquire();
+  ASSERT_TRUE(pack.Init(batch));
+
+  SampleGroup sg;
+  std::vector<std::string> skeys = {"a", "sample_0001", "a long sample key of a sample"};
+  for (auto &s : skeys) {
+    sg.add_sample_ids(s);
+  }
+  PParam pparam;
+  pparam.begin_ = 0;
+  pparam.end_ = skeys.size();
+  pparam.sample_ids_ = &sg.sample_ids();
+  pparam.isgroup_ = 0;
+  pack.Stat(pparam);
+  ASSERT_TRUE(pack.Setup());
+  pack.Run(pparam);
+
+  auto sbuf = batch->GetMutable(kSKeyName)->ts_[Block::kSBuf];
+  ASSERT_EQ(8, sbuf->Shape()[0]);
+  ASSERT_EQ(sizeof(int64_t), sbuf->Shape()[1]);
+  auto ids = sbuf->Raw<int64_t>();
+  for (size_t i = 0; i < 8; ++i) {
+    EXPECT_EQ(i < skeys.size() ? PackSKey::Hash(skeys[i].data(), skeys[i].size()) : 0, ids[i]);
+  }
+  EXPECT_NE(PackSKey::Hash("ab", 2), PackSKey::Hash("ba", 2));
+
+  std::ifstream dict(schema.skey_dict_);
+  std::string line;
+  for (auto &s : skeys) {
+    ASSERT_TRUE((bool)std::getline(dict, line));
+    EXPECT_EQ(std::to_string(PackSKey::Hash(s.data(), s.size())) + "\t" + s, line);
+  }
+  EXPECT_FALSE((bool)std::getline(dict, line));
+  dict.close();
+
+  // a key packed again, as in the next epoch, is not written again
+  ASSERT_TRUE(pack.Init(batch));
+  pack.Stat(pparam);
+  ASSERT_TRUE(pack.Setup());
+  pack.Run(pparam);
+  dict.open(schema.skey_dict_);
+  size_t lines = 0;
+  while (std::getline(dict, line)) {
+    ++lines;
+  }
+  EXPECT_EQ(skeys.size(), lines);
+  dict.close();
+
+  // reset on a new run
+  PackSKey::ResetDict(schema.skey_dict_);
+  dict.open(schema.skey_dict_);
+  EXPECT_FALSE((bool)std::getline(dict, line));
+  dict.close();
+  ASSERT_TRUE(pack.Init(batch));
+  pack.Stat(pparam);
+  ASSERT_TRUE(pack.Setup());
+  pack.Run(pparam);
+  dict.open(schema.skey_dict_);
+  ASSERT_TRUE((bool)std::getline(dict, line));
+  EXPECT_EQ(std::to_string(PackSKey::Hash(skeys[0].data(), skeys[0].size())) + "\t" + skeys[0], line);
+
+  remove(schema.skey_dict_.c_str());
+  BatchPool::Get()->Release(batch);
+}
+
 }  // io
 }  // xdl
 
@@ -0,0 +1,177 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/data_io/packer/packer.h"
+
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "xdl/data_io/constant.h"
+#include "xdl/data_io/pool.h"
+#include "xdl/core/framework/cpu_device.h"
+
+namespace xdl {
+namespace io {
+
+/// packs batches large enough for the sgroups to run in parallel
+class PackerParallelTest: public ::testing::Test {
+ public:
+  static void SetUpTestCase();
+  static void TearDownTestCase();
+
+  /// size samples from sample, the values of each tell its index
+  static SGroup *InitSGroup(size_t sample, size_t size);
+  static void CheckBatch(const Batch *batch, size_t sample);
+
+  static const size_t kBatchSize;
+
+  static Schema schema_;
+  static Packer *packer_;
+};
+
+const size_t PackerParallelTest::kBatchSize = 8192;
+
+Schema PackerParallelTest::schema_;
+Packer *PackerParallelTest::packer_ = nullptr;
+
+void PackerParallelTest::SetUpTestCase() {
+  setenv("XDL_IO_PACK_THREADS", "4", 1);
+  schema_.batch_size_ = kBatchSize;
+  schema_.label_count_ = 1;
+
+  FeatureOption *s = new FeatureOption();
+  s->set_name("0s");
+  s->set_type(kSparse);
+  s->set_serialized(true);
+  s->set_table(0);
+  schema_.Add(s);
+
+  FeatureOption *d = new FeatureOption();
+  d->set_name("0d");
+  d->set_type(kDense);
+  d->set_nvec(1);
+  d->set_table(0);
+  schema_.Add(d);
+
+  FeatureOption *t = new FeatureOption();
+  t->set_name("1s");
+  t->set_type(kSparse);
+  t->set_serialized(true);
+  t->set_table(1);
+  schema_.Add(t);
+
+  packer_ = new Packer(&schema_, new CpuDevice());
+  EXPECT_TRUE(packer_->Init());
+}
+
+void PackerParallelTest::TearDownTestCase() {
+  delete packer_;
+}
+
+SGroup *PackerParallelTest::InitSGroup(size_t sample, size_t size) {
+  auto sgroup = SGroupPool::Get()->Acquire();
+  auto sg = sgroup->New();
+  auto ft = sg->add_feature_tables();
+  for (size_t i = 0; i < size; ++i) {
+    size_t n = sample + i;
+    sg->add_sample_ids("sk"+std::to_string(n));
+    sg->add_labels()->add_values(n);
+    auto fl = ft->add_feature_lines();
+    fl->set_refer(i/2);
+    /// n%3 values, none is missing
+    if (n % 3 != 0) {
+      auto f = fl->add_features();
+      f->set_name("0s");
+      f->set_type(kSparse);
+      for (size_t v = 0; v < n % 3; ++v) {
+        f->add_values()->set_key(n);
+      }
+    }
+    auto f = fl->add_features();
+    f->set_name("0d");
+    f->set_type(kDense);
+    f->add_values()->add_vector(n);
+  }
+  ft = sg->add_feature_tables();
+  for (size_t i = 0; i < (size+1)/2; ++i) {
+    auto f = ft->add_feature_lines()->add_features();
+    f->set_name("1s");
+    f->set_type(kSparse);
+    /// the first sample referring the line
+    f->add_values()->set_key(sample + 2*i);
+  }
+  sgroup->Reset();
+  return sgroup;
+}
+
+void PackerParallelTest::CheckBatch(const Batch *batch, size_t sample) {
+  size_t n = batch->size_;
+  auto label = batch->Get(kLabelName)->ts_[Block::kValue];
+  ASSERT_EQ(kBatchSize, label->Shape()[0]);
+  auto labels = label->Raw<float>();
+  for (size_t r = 0; r < kBatchSize; ++r) {
+    ASSERT_EQ(r < n ? sample + r : 0, labels[r]) << "r=" << r;
+  }
+
+  auto blk = batch->Get("0s");
+  auto keys = blk->ts_[Block::kKey]->Raw<int64_t>();
+  auto segments = blk->ts_[Block::kSegment]->Raw<int32_t>();
+  size_t off = 0;
+  for (size_t r = 0; r < kBatchSize; ++r) {
+    for (size_t v = 0; r < n && v < (sample + r) % 3; ++v, ++off) {
+      ASSERT_EQ(sample + r, keys[off]) << "r=" << r;
+    }
+    ASSERT_EQ(off, segments[r]) << "r=" << r;
+  }
+
+  auto dense = batch->Get("0d")->ts_[Block::kValue]->Raw<float>();
+  for (size_t r = 0; r < kBatchSize; ++r) {
+    ASSERT_EQ(r < n ? sample + r : 0, dense[r]) << "r=" << r;
+  }
+
+  auto indicators = batch->Get(kIndicatorPrefix+std::to_string(0))->ts_[Block::kIndex]->Raw<int32_t>();
+  keys = batch->Get("1s")->ts_[Block::kKey]->Raw<int64_t>();
+  for (size_t r = 0; r < n; ++r) {
+    int64_t key = keys[indicators[r]];
+    ASSERT_TRUE(key == sample + r || key + 1 == sample + r) << "r=" << r << " key=" << key;
+  }
+}
+
+TEST_F(PackerParallelTest, Run) {
+  std::vector<Batch *> batches;
+  size_t sample = 0;
+  while (sample < kBatchSize * 2 + 100) {
+    size_t size = sample % 7 + 1;
+    auto out = packer_->Run(InitSGroup(sample, size));
+    batches.insert(batches.end(), out.begin(), out.end());
+    sample += size;
+  }
+  auto out = packer_->Run((SGroup *)END);
+  batches.insert(batches.end(), out.begin(), out.end());
+  ASSERT_EQ(3, batches.size());
+
+  sample = 0;
+  for (auto batch : batches) {
+    CheckBatch(batch, sample);
+    sample += batch->size_;
+    BatchPool::Get()->Release(batch);
+  }
+}
+
+}  // io
+}  // xdl
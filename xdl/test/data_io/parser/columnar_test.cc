@@ -0,0 +1,270 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/data_io/parser/columnar.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "xdl/data_io/fs/file_system_local.h"
+#include "xdl/core/framework/cpu_device.h"
+
+namespace xdl {
+namespace io {
+
+namespace {
+
+const char *kPath = "columnar_test.dat";
+const size_t kRows = 3;
+
+Tensor *Make(Device *dev, const TensorShape &shape, DataType type, const void *data) {
+  Tensor *t = new Tensor(dev, shape, type);
+  memcpy(t->Raw<char>(), data, shape.NumElements() * SizeOfType(type));
+  return t;
+}
+
+void Init(Schema *schema) {
+  auto s = new FeatureOption();
+  s->set_name("s");
+  s->set_type(kSparse);
+  s->set_table(0);
+  s->set_nvec(1);
+  schema->Add(s);
+  auto d = new FeatureOption();
+  d->set_name("d");
+  d->set_type(kDense);
+  d->set_table(0);
+  d->set_nvec(2);
+  schema->Add(d);
+  schema->label_count_ = 2;
+}
+
+/// two chunks of kRows rows, as packed without padding, or of size rows
+/// with the rest as padding
+void Write(Schema *schema, Device *dev, size_t size = 0) {
+  float label[kRows * 2] = {0, 1, 1, 2, 2, 3};
+  int32_t segment[kRows] = {1, 3, 3};
+  int64_t key[3 * 2] = {1, 0, 2, 0, 3, 0};
+  float value[3] = {0.1, 0.2, 0.3};
+  float dense[kRows * 2] = {1, 1, 2, 2, 3, 3};
+
+  Batch batch;
+  batch.size_ = size;
+  Block blk;
+  memset(blk.ts_, 0, sizeof(blk.ts_));
+  blk.ts_[Block::kValue] = Make(dev, TensorShape({kRows, 2}), types::kFloat, label);
+  batch.Add(kLabelName, blk);
+  blk.ts_[Block::kValue] = Make(dev, TensorShape({3, 1}), types::kFloat, value);
+  blk.ts_[Block::kKey] = Make(dev, TensorShape({3, 2}), types::kInt64, key);
+  blk.ts_[Block::kSegment] = Make(dev, TensorShape({kRows}), types::kInt32, segment);
+  batch.Add("s", blk);
+  memset(blk.ts_, 0, sizeof(blk.ts_));
+  blk.ts_[Block::kValue] = Make(dev, TensorShape({kRows, 2}), types::kFloat, dense);
+  batch.Add("d", blk);
+
+  IOAnt *ant = FileSystemLocal::Get()->GetAnt(kPath, 'w');
+  ColumnarWriter writer(ant, schema);
+  EXPECT_TRUE(writer.Write(&batch));
+  EXPECT_TRUE(writer.Write(&batch));
+  EXPECT_TRUE(writer.Close());
+  delete ant;
+
+  for (auto &it : batch.blocks()) {
+    for (int i = 0; i < Block::kTypes; ++i) {
+      delete it.second.ts_[i];
+    }
+  }
+}
+
+void Check(bool mmap, bool padding) {
+  Device *dev = new CpuDevice();
+  Schema schema;
+  Init(&schema);
+  Write(&schema, dev);
+  schema.batch_size_ = 2;
+  schema.padding_ = padding;
+
+  ReadParam rparam;
+  rparam.path_ = kPath;
+  rparam.end_ = FileSystemLocal::Get()->Size(kPath);
+  rparam.ant_ = FileSystemLocal::Get()->GetAnt(kPath, 'r');
+
+  ColumnarReader reader(&schema, dev, mmap);
+  ASSERT_TRUE(reader.Open(&rparam));
+  for (int c = 0; c < 2; ++c) {
+    // rows [0, 2) sliced, then row 2 with its segments rebased
+    Batch *batch = reader.Next();
+    ASSERT_NE(nullptr, batch);
+    auto label = batch->GetTensor(kLabelName, Block::kValue);
+    ASSERT_EQ(TensorShape({2, 2}), label->Shape());
+    EXPECT_EQ(2, label->Raw<float>()[3]);
+    auto segment = batch->GetTensor("s", Block::kSegment);
+    ASSERT_EQ(TensorShape({2}), segment->Shape());
+    EXPECT_EQ(3, segment->Raw<int32_t>()[1]);
+    auto key = batch->GetTensor("s", Block::kKey);
+    ASSERT_EQ(TensorShape({3, 2}), key->Shape());
+    EXPECT_EQ(3, key->Raw<int64_t>()[4]);
+    auto dense = batch->GetTensor("d", Block::kValue);
+    ASSERT_EQ(TensorShape({2, 2}), dense->Shape());
+    EXPECT_EQ(2, dense->Raw<float>()[2]);
+
+    batch = reader.Next();
+    ASSERT_NE(nullptr, batch);
+    size_t rows = padding ? 2 : 1;
+    label = batch->GetTensor(kLabelName, Block::kValue);
+    ASSERT_EQ(TensorShape({rows, 2}), label->Shape());
+    EXPECT_EQ(3, label->Raw<float>()[1]);
+    segment = batch->GetTensor("s", Block::kSegment);
+    ASSERT_EQ(TensorShape({rows}), segment->Shape());
+    for (size_t r = 0; r < rows; ++r) {
+      EXPECT_EQ(0, segment->Raw<int32_t>()[r]);
+    }
+    key = batch->GetTensor("s", Block::kKey);
+    EXPECT_EQ(0, key->Shape()[0]);
+    dense = batch->GetTensor("d", Block::kValue);
+    ASSERT_EQ(TensorShape({rows, 2}), dense->Shape());
+    EXPECT_EQ(3, dense->Raw<float>()[0]);
+    if (padding) {
+      EXPECT_EQ(0, dense->Raw<float>()[2]);
+    }
+  }
+  EXPECT_EQ(nullptr, reader.Next());
+  EXPECT_EQ(rparam.end_, rparam.begin_);
+  reader.Close();
+
+  // the first chunk starts right after the magic, resumes from the second one
+  rparam.begin_ = ColumnarMeta::kAlign + 1;
+  ASSERT_TRUE(reader.Open(&rparam));
+  EXPECT_NE(nullptr, reader.Next());
+  EXPECT_NE(nullptr, reader.Next());
+  EXPECT_EQ(nullptr, reader.Next());
+  reader.Close();
+  remove(kPath);
+}
+
+}  // namespace
+
+TEST(ColumnarTest, Meta) {
+  ColumnarMeta meta;
+  meta.label_count = 2;
+  meta.features.push_back({"s", kSparse, 1, ColumnarMeta::kHasValue});
+  meta.features.push_back({"d", kDense, 2, ColumnarMeta::kHasValue});
+  meta.chunks.push_back({64, 3, 0, {5}});
+  std::string footer = meta.Encode();
+
+  ColumnarMeta decoded;
+  ASSERT_TRUE(decoded.Decode(footer.data(), footer.size()));
+  EXPECT_EQ(2u, decoded.label_count);
+  ASSERT_EQ(2u, decoded.features.size());
+  EXPECT_EQ("d", decoded.features[1].name);
+  ASSERT_EQ(1u, decoded.chunks.size());
+  EXPECT_EQ(5u, decoded.chunks[0].nnz[0]);
+  EXPECT_FALSE(decoded.Decode(footer.data(), footer.size() - 1));
+
+  for (auto &column : meta.Columns(meta.chunks[0])) {
+    EXPECT_EQ(0u, column.offset % ColumnarMeta::kAlign);
+  }
+}
+
+TEST(ColumnarTest, Read) {
+  Check(false, false);
+}
+
+TEST(ColumnarTest, ReadMmap) {
+  Check(true, false);
+}
+
+TEST(ColumnarTest, ReadPadding) {
+  Check(true, true);
+}
+
+TEST(ColumnarTest, ReadProjected) {
+  Device *dev = new CpuDevice();
+  Schema schema;
+  Init(&schema);
+  Write(&schema, dev);
+
+  Schema dense;
+  auto d = new FeatureOption();
+  d->set_name("d");
+  d->set_type(kDense);
+  d->set_table(0);
+  d->set_nvec(2);
+  dense.Add(d);
+  dense.label_count_ = 2;
+  dense.batch_size_ = 0;
+
+  ReadParam rparam;
+  rparam.path_ = kPath;
+  rparam.end_ = FileSystemLocal::Get()->Size(kPath);
+  rparam.ant_ = FileSystemLocal::Get()->GetAnt(kPath, 'r');
+
+  ColumnarReader reader(&dense, dev, false);
+  ASSERT_TRUE(reader.Open(&rparam));
+  for (int c = 0; c < 2; ++c) {
+    Batch *batch = reader.Next();
+    ASSERT_NE(nullptr, batch);
+    EXPECT_EQ(nullptr, batch->Get("s"));
+    auto label = batch->GetTensor(kLabelName, Block::kValue);
+    ASSERT_EQ(TensorShape({kRows, 2}), label->Shape());
+    EXPECT_EQ(3, label->Raw<float>()[5]);
+    auto value = batch->GetTensor("d", Block::kValue);
+    ASSERT_EQ(TensorShape({kRows, 2}), value->Shape());
+    EXPECT_EQ(3, value->Raw<float>()[5]);
+  }
+  EXPECT_EQ(nullptr, reader.Next());
+  reader.Close();
+  remove(kPath);
+}
+
+TEST(ColumnarTest, WritePadded) {
+  Device *dev = new CpuDevice();
+  Schema schema;
+  Init(&schema);
+  Write(&schema, dev, 1);
+  schema.batch_size_ = 2;
+  schema.padding_ = false;
+
+  ReadParam rparam;
+  rparam.path_ = kPath;
+  rparam.end_ = FileSystemLocal::Get()->Size(kPath);
+  rparam.ant_ = FileSystemLocal::Get()->GetAnt(kPath, 'r');
+
+  ColumnarReader reader(&schema, dev, true);
+  reader.set_shuffle(true);
+  ASSERT_TRUE(reader.Open(&rparam));
+  for (int c = 0; c < 2; ++c) {
+    Batch *batch = reader.Next();
+    ASSERT_NE(nullptr, batch);
+    EXPECT_EQ(1u, batch->size_);
+    auto label = batch->GetTensor(kLabelName, Block::kValue);
+    ASSERT_EQ(TensorShape({1, 2}), label->Shape());
+    EXPECT_EQ(1, label->Raw<float>()[1]);
+    auto key = batch->GetTensor("s", Block::kKey);
+    ASSERT_EQ(TensorShape({1, 2}), key->Shape());
+    EXPECT_EQ(1, key->Raw<int64_t>()[0]);
+    auto dense = batch->GetTensor("d", Block::kValue);
+    ASSERT_EQ(TensorShape({1, 2}), dense->Shape());
+  }
+  EXPECT_EQ(nullptr, reader.Next());
+  reader.Close();
+  remove(kPath);
+}
+
+}  // namespace io
+}  // namespace xdl
@@ -181,6 +181,38 @@ TEST(ParseTxtTest, TestRun) {
 
 }
 
+TEST(ParseTxtTest, TestProjection) {
+  std::string str = "skey|gkey|upv14@101:0.1,102:0.2;ufav3@201:0.1|a@0.01,0.02;s@0.04|1.0,0.0|150000000";
+
+  Schema schema;
+  FeatureOption *opt = new FeatureOption();
+  opt->set_name("ufav3");
+  opt->set_type(kSparse);
+  opt->set_table(0);
+  schema.Add(opt);
+  opt = new FeatureOption();
+  opt->set_name("s");
+  opt->set_type(kDense);
+  opt->set_table(0);
+  opt->set_nvec(1);
+  schema.Add(opt);
+  schema.projection_ = true;
+
+  ParseTxt p(&schema);
+  p.InitMeta("");
+  EXPECT_EQ(nullptr, p.Run(str.c_str(), str.size()));
+  auto sgroup = p.Run(str.c_str(), 0);
+  ASSERT_NE(nullptr, sgroup);
+  auto &fl = sgroup->Get()->feature_tables(0).feature_lines(0);
+  ASSERT_EQ(2, fl.features_size());
+  EXPECT_EQ("ufav3", fl.features(0).name());
+  EXPECT_EQ(1, fl.features(0).values_size());
+  EXPECT_EQ(201, fl.features(0).values(0).key());
+  EXPECT_EQ("s", fl.features(1).name());
+  EXPECT_EQ(1, fl.features(1).values(0).vector_size());
+  EXPECT_EQ(2, sgroup->Get()->labels(0).values_size());
+}
+
 }  // namespace io
 }  // namespace xdl
 
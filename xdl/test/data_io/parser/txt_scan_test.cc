@@ -0,0 +1,91 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/data_io/parser/txt_scan.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace xdl {
+namespace io {
+
+TEST(TxtScanTest, FindChars) {
+  std::mt19937 rng(7);
+  const char alphabet[] = "0123456789,:;@|.";
+  for (int t = 0; t < 200; ++t) {
+    std::string str(rng() % 300, ' ');
+    for (auto &c : str) {
+      c = alphabet[rng() % (sizeof(alphabet) - 1)];
+    }
+    size_t max = rng() % 64 + 1;
+    std::vector<uint32_t> scalar(max), avx2(max), any(max);
+    size_t n = FindCharsScalar(str.data(), str.size(), ',', scalar.data(), max);
+    EXPECT_EQ(n, FindChars(str.data(), str.size(), ',', any.data(), max));
+    if (__builtin_cpu_supports("avx2")) {
+      EXPECT_EQ(n, FindCharsAvx2(str.data(), str.size(), ',', avx2.data(), max));
+    } else {
+      avx2 = scalar;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      EXPECT_EQ(',', str[scalar[i]]);
+      EXPECT_EQ(scalar[i], avx2[i]);
+      EXPECT_EQ(scalar[i], any[i]);
+    }
+  }
+}
+
+TEST(TxtScanTest, ParseInt64) {
+  std::vector<std::string> strs = {
+    "0", "-0", "+12", "123456789012345678", "1234567890123456789",
+    "99999999999999999999", "-42:1.5", "12,3", "-", "+", "", " 7", "0x10", "12a"};
+  for (auto &str : strs) {
+    char *end, *expected_end;
+    int64_t expected = strtol(str.c_str(), &expected_end, 10);
+    EXPECT_EQ(expected, ParseInt64(str.c_str(), &end)) << str;
+    EXPECT_EQ(expected_end, end) << str;
+  }
+}
+
+TEST(TxtScanTest, ParseFloat) {
+  std::vector<std::string> strs = {
+    "0", "-0", "1", "0.1", "0.2", "0.3", "1.000000", "0.010000", "16777216",
+    "16777217", "0.0000000001", "0.00000000001", "3.14159265", "-2.5;", ".5",
+    "1.", ".", "-", "1e3", "1.5E-2", "0x1p3", "inf", "nan", " 2", "1.5.5",
+    "123456789012345678901", "0.999999999"};
+  std::mt19937 rng(11);
+  for (int t = 0; t < 10000; ++t) {
+    std::string str = std::to_string(rng() % 100000);
+    if (rng() % 2) {
+      str += "." + std::to_string(rng() % 100000);
+    }
+    strs.push_back(rng() % 2 ? "-" + str : str);
+  }
+  for (auto &str : strs) {
+    char *end, *expected_end;
+    float expected = strtof(str.c_str(), &expected_end);
+    float v = ParseFloat(str.c_str(), &end);
+    EXPECT_EQ(0, memcmp(&expected, &v, sizeof(v))) << str << " " << expected << " " << v;
+    EXPECT_EQ(expected_end, end) << str;
+  }
+}
+
+}  // namespace io
+}  // namespace xdl
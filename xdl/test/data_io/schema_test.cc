@@ -57,5 +57,20 @@ TEST(DataIOTest, TestRead2ParseTxt) {
   EXPECT_EQ(items.size(), 3);
 }
 
+TEST(DataIOTest, TestPaddedRows) {
+  Schema schema_;
+  schema_.batch_size_ = 100;
+  EXPECT_EQ(100, schema_.PaddedRows(37));
+  EXPECT_EQ(100, schema_.PaddedRows(100));
+
+  schema_.pad_multiple_ = 16;
+  EXPECT_EQ(48, schema_.PaddedRows(37));
+  EXPECT_EQ(32, schema_.PaddedRows(32));
+  EXPECT_EQ(100, schema_.PaddedRows(97));
+
+  schema_.padding_ = false;
+  EXPECT_EQ(37, schema_.PaddedRows(37));
+}
+
 }
 }
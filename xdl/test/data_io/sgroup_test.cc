@@ -71,5 +71,33 @@ TEST(SGroupTest, TestSGroup) {
   EXPECT_NE(sample, nullptr);
 }
 
+TEST(SGroupTest, TestArena) {
+  SGroup head;
+  auto sg = head.New();
+  int c = 4;
+  for (int i = 0; i < c; ++i) {
+    sg->add_labels();
+  }
+  head.Reset();
+  head.Reset(0, 2);
+
+  /// the sample group and its arena move to the tail
+  SGroup tail;
+  tail.CloneTail(&head);
+  EXPECT_FALSE(head.own_);
+  EXPECT_TRUE(tail.own_);
+  head.Clear();
+  EXPECT_EQ(c, tail.Get()->labels_size());
+
+  auto sg1 = head.New();
+  EXPECT_EQ(0, sg1->labels_size());
+  sg1->add_labels();
+  EXPECT_EQ(c, tail.Get()->labels_size());
+
+  tail.Clear();
+  EXPECT_FALSE(tail.own_);
+  EXPECT_EQ(1, head.Get()->labels_size());
+}
+
 }
 }
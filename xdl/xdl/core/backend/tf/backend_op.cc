@@ -84,15 +84,17 @@ class TFBackendOp : public xdl::OpKernelAsync {
                            gradient_op_names_.begin(), 
                            gradient_op_names_.end());
     
-	results_.clear();
+    // the outputs refer the buffers of the results, which live as long
+    // as the outputs do, so the results are per step
+    std::vector<tensorflow::Tensor> results;
     XDL_CHECK_STATUS_ASYNC(
-        tf_runner_.Run(tf_inputs, output_op_names, &results_), 
+        tf_runner_.Run(tf_inputs, output_op_names, &results), 
         done);
     
     TensorList outputs;
     for (size_t i = 0; i < target_op_size; ++i) {
       Tensor t;
-      XDL_CHECK_STATUS_ASYNC(TF2XDL::ConvertTensor(results_[i], &t), done);
+      XDL_CHECK_STATUS_ASYNC(TF2XDL::ConvertTensor(results[i], &t), done);
       outputs.emplace_back(t);
     }
 
@@ -102,7 +104,7 @@ class TFBackendOp : public xdl::OpKernelAsync {
     #pragma omp parallel for
     for (size_t i = 0; i < gradient_op_size; ++i) {
       Tensor t;
-      TF2XDL::ConvertTensor(results_[i + target_op_size], &t);
+      TF2XDL::ConvertTensor(results[i + target_op_size], &t);
       gradients[i] = std::move(t);
     }
 
@@ -117,7 +119,6 @@ class TFBackendOp : public xdl::OpKernelAsync {
   std::vector<std::string> target_op_names_;
   std::vector<std::string> gradient_op_names_;
   std::vector<std::string> local_init_op_names_;
-  std::vector<tensorflow::Tensor> results_;
 };
 
 XDL_DEFINE_OP(TFBackendOp)
@@ -22,39 +22,50 @@ limitations under the License.
 
 namespace xdl {
 
-class FakeAllocator:public tensorflow::Allocator {
-  public:
-    FakeAllocator() {}
-    void* AllocateRaw(size_t alignment, size_t num_bytes) override { 
-		return buffer_;
-	}
-			   
-	std::string Name() override {
-		return "FakeAllocator";
-	}
-	void DeallocateRaw(void*) override {}
-	void SetBuffer(void* buffer) {
-		buffer_ = buffer;
-		return;
-	}
-  private:
-	void* buffer_ = nullptr;
+namespace {
+
+// Lends the buffer of an xdl tensor to a tensorflow tensor, the allocator
+// holds the buffer until tensorflow releases it and then deletes itself,
+// so the feeds are not copied and outlive the xdl tensor if tensorflow
+// keeps them
+class XDLBufferAllocator : public tensorflow::Allocator {
+ public:
+  explicit XDLBufferAllocator(Buffer* buffer) : buffer_(buffer) {}
+
+  std::string Name() override {
+    return "XDLBufferAllocator";
+  }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    return buffer_->begin();
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    delete this;
+  }
+
+ private:
+  RefCountedPtr<Buffer> buffer_;
 };
 
-class FakeXDLAllocator:public Allocator {
-  public:
-    void* Allocate(size_t num_bytes) override {
-		return buffer_;
-	}
-	void Deallocate(void*) override {}
-	void SetBuffer(void* buffer) {
-		buffer_ = buffer;
-		return;
-	}
-  private:
-    void* buffer_ = nullptr;
+// Lends the buffer of a tensorflow tensor to an xdl tensor, the buffer
+// refers the tensorflow one until the xdl tensor is released
+class TFTensorAllocator : public Allocator {
+ public:
+  explicit TFTensorAllocator(const tensorflow::Tensor& tensor)
+    : tensor_(tensor) {}
+
+  void* Allocate(size_t num_bytes) override {
+    return const_cast<char*>(tensor_.tensor_data().data());
+  }
+
+  void Deallocate(void* buf) override {}
+
+ private:
+  tensorflow::Tensor tensor_;
 };
 
+}  // namespace
 
 Status XDL2TF::ConvertType(const xdl::DataType s, tensorflow::DataType* d) {
   switch(s) {
@@ -96,10 +107,13 @@ Status XDL2TF::ConvertTensor(const xdl::Tensor& s, tensorflow::Tensor* d) {
   tensorflow::TensorShape shape;
   XDL_CHECK_STATUS(ConvertType(s.Type(), &type));
   XDL_CHECK_STATUS(ConvertShape(s.Shape(), &shape));
-  //avoid memcopy 
-  static __thread FakeAllocator fakeAlloc;
-  fakeAlloc.SetBuffer(s.Raw<void>());
-  *d = tensorflow::Tensor(&fakeAlloc, type, shape);
+  if (shape.num_elements() == 0) {
+    *d = tensorflow::Tensor(type, shape);
+    return Status::Ok();
+  }
+
+  // deleted by tensorflow with the buffer
+  *d = tensorflow::Tensor(new XDLBufferAllocator(s.GetBuffer()), type, shape);
   return Status::Ok();
 }
 
@@ -143,10 +157,15 @@ Status TF2XDL::ConvertTensor(const tensorflow::Tensor& s, xdl::Tensor* d) {
   XDL_CHECK_STATUS(ConvertType(s.dtype(), &type));
   TensorShape shape;
   XDL_CHECK_STATUS(ConvertShape(s.shape(), &shape));
-  //avoid memcopy
-  static __thread FakeXDLAllocator xAllocator;
-  xAllocator.SetBuffer((void*)s.tensor_data().data());
-  *d = Tensor(&xAllocator, shape, type);
+  if (shape.NumElements() == 0) {
+    *d = Tensor(DeviceSingleton::CpuInstance(), shape, type);
+    return Status::Ok();
+  }
+
+  // the tensor buffer holds the only reference of the allocator
+  Allocator* allocator = new TFTensorAllocator(s);
+  *d = Tensor(allocator, shape, type);
+  allocator->UnRef();
   return Status::Ok();
 }
 
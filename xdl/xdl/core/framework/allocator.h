@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef XDL_CORE_FRAMEWORK_ALLOCATOR_H_
 #define XDL_CORE_FRAMEWORK_ALLOCATOR_H_
 
+#include <functional>
 #include <unordered_map>
 #include <mutex>
 
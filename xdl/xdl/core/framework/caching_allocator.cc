@@ -0,0 +1,259 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/core/framework/caching_allocator.h"
+
+#include <numa.h>
+#include <sched.h>
+
+#include <map>
+#include <sstream>
+
+namespace xdl {
+
+namespace {
+
+// never destroyed, thread exits may outlive static destruction
+std::mutex* LiveMutex() {
+  static std::mutex* mu = new std::mutex;
+  return mu;
+}
+
+std::map<int64_t, CachingAllocator*>* LiveAllocators() {
+  static auto* live = new std::map<int64_t, CachingAllocator*>;
+  return live;
+}
+
+std::atomic<int64_t> next_generation(0);
+
+}  // namespace
+
+constexpr size_t CachingAllocator::kHeaderSize;
+constexpr int CachingAllocator::kClassNum;
+constexpr size_t CachingAllocator::kMagazineSize;
+constexpr size_t CachingAllocator::kSlabSize;
+
+// Gives the magazines of an exiting thread back to their arenas, the
+// caches of the destroyed allocators are gone with them.
+struct CachingAllocator::CacheHolder {
+  std::vector<std::pair<int64_t, ThreadCache*>> caches;
+  ~CacheHolder() {
+    std::unique_lock<std::mutex> lock(*LiveMutex());
+    for (auto& item : caches) {
+      auto iter = LiveAllocators()->find(item.first);
+      if (iter != LiveAllocators()->end()) {
+        CachingAllocator* allocator = iter->second;
+        for (int i = 0; i < kClassNum; i++) {
+          allocator->Flush(item.second, i, 0);
+        }
+      }
+    }
+  }
+  // drop the caches of the destroyed allocators
+  void Prune() {
+    std::unique_lock<std::mutex> lock(*LiveMutex());
+    size_t size = 0;
+    for (auto& item : caches) {
+      if (LiveAllocators()->count(item.first) != 0) {
+        caches[size++] = item;
+      }
+    }
+    caches.resize(size);
+  }
+};
+
+CachingAllocator::CachingAllocator(Allocator* internal)
+  : generation_(next_generation++), internal_(internal), reserved_(0),
+    large_in_use_(0), numa_(numa_available() >= 0) {
+  int nodes = numa_ ? numa_max_node() + 1 : 1;
+  for (int i = 0; i < nodes; i++) {
+    arenas_.emplace_back(new Arena);
+  }
+  std::unique_lock<std::mutex> lock(*LiveMutex());
+  (*LiveAllocators())[generation_] = this;
+}
+
+CachingAllocator::~CachingAllocator() {
+  {
+    std::unique_lock<std::mutex> lock(*LiveMutex());
+    LiveAllocators()->erase(generation_);
+  }
+  for (auto& slab : slabs_) {
+    if (numa_) {
+      numa_free(slab.first, kSlabSize);
+    } else {
+      internal_->Deallocate(slab.first);
+    }
+  }
+}
+
+void* CachingAllocator::Allocate(size_t size) {
+  int size_class = 0;
+  while (size_class < kClassNum && ClassSize(size_class) < size + kHeaderSize) {
+    size_class++;
+  }
+  Header* header;
+  if (size_class == kClassNum) {
+    header = static_cast<Header*>(internal_->Allocate(size + kHeaderSize));
+    header->size_class = -1;
+    header->node = -1;
+    header->size = size + kHeaderSize;
+    large_in_use_ += header->size;
+    reserved_ += header->size;
+    return reinterpret_cast<char*>(header) + kHeaderSize;
+  }
+  ThreadCache* cache = LocalCache();
+  std::vector<void*>& blocks = cache->blocks[size_class];
+  if (blocks.empty()) {
+    cache->misses.fetch_add(1, std::memory_order_relaxed);
+    Refill(cache, size_class);
+  } else {
+    cache->hits.fetch_add(1, std::memory_order_relaxed);
+  }
+  header = static_cast<Header*>(blocks.back());
+  blocks.pop_back();
+  cache->in_use.fetch_add(ClassSize(size_class), std::memory_order_relaxed);
+  return reinterpret_cast<char*>(header) + kHeaderSize;
+}
+
+void CachingAllocator::Deallocate(void* buf) {
+  Header* header = reinterpret_cast<Header*>(static_cast<char*>(buf) - kHeaderSize);
+  if (header->size_class < 0) {
+    large_in_use_ -= header->size;
+    reserved_ -= header->size;
+    internal_->Deallocate(header);
+    return;
+  }
+  ThreadCache* cache = LocalCache();
+  std::vector<void*>& blocks = cache->blocks[header->size_class];
+  cache->in_use.fetch_sub(ClassSize(header->size_class), std::memory_order_relaxed);
+  blocks.push_back(header);
+  if (blocks.size() > kMagazineSize) {
+    Flush(cache, header->size_class, kMagazineSize / 2);
+  }
+}
+
+CachingAllocator::ThreadCache* CachingAllocator::LocalCache() {
+  thread_local CacheHolder holder;
+  thread_local int64_t last_owner = -1;
+  thread_local ThreadCache* last_cache = nullptr;
+  if (last_owner == generation_) {
+    return last_cache;
+  }
+  for (auto& item : holder.caches) {
+    if (item.first == generation_) {
+      last_owner = generation_;
+      last_cache = item.second;
+      return last_cache;
+    }
+  }
+  holder.Prune();
+  ThreadCache* cache = new ThreadCache;
+  int cpu = sched_getcpu();
+  cache->node = numa_ && cpu >= 0 ? numa_node_of_cpu(cpu) : 0;
+  if (cache->node < 0 || cache->node >= static_cast<int>(arenas_.size())) {
+    cache->node = 0;
+  }
+  cache->in_use = 0;
+  cache->hits = 0;
+  cache->misses = 0;
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    caches_.emplace_back(cache);
+  }
+  holder.caches.emplace_back(generation_, cache);
+  last_owner = generation_;
+  last_cache = cache;
+  return cache;
+}
+
+void CachingAllocator::Refill(ThreadCache* cache, int size_class) {
+  Arena* arena = arenas_[cache->node].get();
+  std::vector<void*>& blocks = cache->blocks[size_class];
+  {
+    std::unique_lock<std::mutex> lock(arena->mu);
+    std::vector<void*>& free = arena->blocks[size_class];
+    while (!free.empty() && blocks.size() < kMagazineSize / 2) {
+      blocks.push_back(free.back());
+      free.pop_back();
+    }
+  }
+  if (!blocks.empty()) {
+    return;
+  }
+  // a new slab on the local node, the blocks left over go to the arena
+  char* slab = static_cast<char*>(numa_ ? numa_alloc_onnode(kSlabSize, cache->node)
+                                        : internal_->Allocate(kSlabSize));
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    slabs_.emplace_back(slab, cache->node);
+  }
+  reserved_ += kSlabSize;
+  size_t class_size = ClassSize(size_class);
+  std::vector<void*> rest;
+  for (size_t offset = 0; offset + class_size <= kSlabSize; offset += class_size) {
+    Header* header = reinterpret_cast<Header*>(slab + offset);
+    header->size_class = size_class;
+    header->node = cache->node;
+    header->size = class_size;
+    if (blocks.size() < kMagazineSize / 2) {
+      blocks.push_back(header);
+    } else {
+      rest.push_back(header);
+    }
+  }
+  std::unique_lock<std::mutex> lock(arena->mu);
+  arena->blocks[size_class].insert(arena->blocks[size_class].end(), rest.begin(), rest.end());
+}
+
+void CachingAllocator::Flush(ThreadCache* cache, int size_class, size_t keep) {
+  std::vector<void*>& blocks = cache->blocks[size_class];
+  while (blocks.size() > keep) {
+    Header* header = static_cast<Header*>(blocks.back());
+    blocks.pop_back();
+    Arena* arena = arenas_[header->node].get();
+    std::unique_lock<std::mutex> lock(arena->mu);
+    arena->blocks[size_class].push_back(header);
+  }
+}
+
+CachingAllocator::Stats CachingAllocator::GetStats() {
+  Stats stats{large_in_use_.load(), reserved_.load(), 0, 0};
+  std::unique_lock<std::mutex> lock(mu_);
+  for (auto& cache : caches_) {
+    stats.in_use += cache->in_use.load(std::memory_order_relaxed);
+    stats.cache_hits += cache->hits.load(std::memory_order_relaxed);
+    stats.cache_misses += cache->misses.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+std::string CachingAllocator::Report() {
+  std::ostringstream report;
+  std::unique_lock<std::mutex> lock(*LiveMutex());
+  for (auto& item : *LiveAllocators()) {
+    Stats stats = item.second->GetStats();
+    int64_t requests = stats.cache_hits + stats.cache_misses;
+    report << "in_use[" << stats.in_use << "] reserved[" << stats.reserved
+           << "] fragmentation["
+           << (stats.reserved == 0 ? 0.0 : 1.0 - static_cast<double>(stats.in_use) / stats.reserved)
+           << "] cache_hit_rate["
+           << (requests == 0 ? 0.0 : static_cast<double>(stats.cache_hits) / requests)
+           << "]\n";
+  }
+  return report.str();
+}
+
+}  // namespace xdl
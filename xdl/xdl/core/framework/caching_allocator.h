@@ -0,0 +1,100 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XDL_CORE_FRAMEWORK_CACHING_ALLOCATOR_H_
+#define XDL_CORE_FRAMEWORK_CACHING_ALLOCATOR_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "xdl/core/framework/allocator.h"
+
+namespace xdl {
+
+// Thread caching front end over per numa node arenas. Blocks of power of
+// two size classes up to 1MB are popped from a per thread magazine, which
+// refills from and flushes half of itself back to the arena of the node
+// the block lives on, so the common path takes no lock. Every block starts
+// with a header naming its class and node, deallocation never searches.
+// Larger sizes go straight to the internal allocator.
+class CachingAllocator : public Allocator {
+ public:
+  static constexpr size_t kHeaderSize = 64;
+  static constexpr int kClassNum = 15;
+  static constexpr size_t kMagazineSize = 32;
+  static constexpr size_t kSlabSize = 4 << 20;
+
+  struct Stats {
+    int64_t in_use;
+    int64_t reserved;
+    int64_t cache_hits;
+    int64_t cache_misses;
+  };
+
+  explicit CachingAllocator(Allocator* internal);
+  ~CachingAllocator();
+  void* Allocate(size_t size) override;
+  void Deallocate(void* buf) override;
+  // in_use counts the bytes of the blocks handed out, headers included
+  Stats GetStats();
+  // One line per live caching allocator.
+  static std::string Report();
+
+ private:
+  struct Header {
+    int32_t size_class;
+    int32_t node;
+    int64_t size;
+  };
+  struct Arena {
+    std::mutex mu;
+    std::vector<void*> blocks[kClassNum];
+  };
+  struct ThreadCache {
+    int node;
+    std::vector<void*> blocks[kClassNum];
+    std::atomic<int64_t> in_use;
+    std::atomic<int64_t> hits;
+    std::atomic<int64_t> misses;
+  };
+  struct CacheHolder;
+
+  static size_t ClassSize(int size_class) {
+    return kHeaderSize << size_class;
+  }
+  // the cache of the calling thread, created on the first use
+  ThreadCache* LocalCache();
+  void Refill(ThreadCache* cache, int size_class);
+  void Flush(ThreadCache* cache, int size_class, size_t keep);
+
+  // unique across the process, the thread caches are keyed on it as an
+  // allocator may reuse the address of a destroyed one
+  const int64_t generation_;
+  RefCountedPtr<Allocator> internal_;
+  std::vector<std::unique_ptr<Arena>> arenas_;
+  std::mutex mu_;
+  std::vector<std::unique_ptr<ThreadCache>> caches_;
+  std::vector<std::pair<void*, int>> slabs_;
+  std::atomic<int64_t> reserved_;
+  std::atomic<int64_t> large_in_use_;
+  bool numa_;
+};
+
+}  // namespace xdl
+
+#endif  // XDL_CORE_FRAMEWORK_CACHING_ALLOCATOR_H_
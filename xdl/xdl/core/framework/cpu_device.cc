@@ -15,9 +15,13 @@ limitations under the License.
 
 #include "xdl/core/framework/cpu_device.h"
 
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <malloc.h>
 
+#include "xdl/core/framework/caching_allocator.h"
+
 namespace xdl {
 
 void* CpuAllocator::Allocate(size_t size) {
@@ -31,9 +35,16 @@ void CpuAllocator::Deallocate(void* buf) {
   return;
 }
 
+// XDL_CPU_ALLOCATOR=caching puts a CachingAllocator in front of memalign
 CpuDevice::CpuDevice()
     : Device(AllocatorManager::Instance()->Get(
-             "CPU", [] ()->Allocator* { return new CpuAllocator; })) {}
+             "CPU", [] ()->Allocator* {
+               const char* allocator = getenv("XDL_CPU_ALLOCATOR");
+               if (allocator != nullptr && strcmp(allocator, "caching") == 0) {
+                 return new CachingAllocator(new CpuAllocator);
+               }
+               return new CpuAllocator;
+             })) {}
 
 std::string CpuDevice::DeviceType() {
   return "CPU";
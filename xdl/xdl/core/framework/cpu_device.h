@@ -35,6 +35,9 @@ class CpuDevice : public Device {
   std::string DeviceType() override;
   static Status CreateDevice(const DeviceDef& def, Device** device);
   CpuDevice();
+
+ protected:
+  explicit CpuDevice(Allocator* allocator) : Device(allocator) {}
 };
 
 }  // namespace xdl
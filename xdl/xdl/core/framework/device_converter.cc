@@ -15,8 +15,42 @@ limitations under the License.
 
 #include "xdl/core/framework/device_converter.h"
 
+#include <atomic>
+#include <mutex>
+
 namespace xdl {
 
+void DeviceConverter::ConvertBatch(Device* src_device, Device* dst_device,
+                                   const std::vector<Tensor>& src,
+                                   std::vector<Tensor>* dst,
+                                   ThreadPool* tp,
+                                   std::function<void(Status)> cb) {
+  struct Pending {
+    std::atomic<size_t> count;
+    std::mutex mu;
+    Status status;
+  };
+  dst->resize(src.size());
+  if (src.empty()) {
+    cb(Status::Ok());
+    return;
+  }
+  std::shared_ptr<Pending> pending = std::make_shared<Pending>();
+  pending->count = src.size();
+  for (size_t i = 0; i < src.size(); i++) {
+    Convert(src_device, dst_device, src[i], &(*dst)[i], tp,
+            [pending, cb](Status st) {
+              if (!st.IsOk()) {
+                std::unique_lock<std::mutex> lock(pending->mu);
+                pending->status = st;
+              }
+              if (--pending->count == 0) {
+                cb(pending->status);
+              }
+            });
+  }
+}
+
 std::string DeviceConverterRegistry::UniqId(
     const std::string& src, const std::string& dst) {
   return src + "->" + dst;
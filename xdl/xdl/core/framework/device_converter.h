@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef XDL_CORE_FRAMEWORK_DEVICE_CONVERTER_H_
 #define XDL_CORE_FRAMEWORK_DEVICE_CONVERTER_H_
 
+#include <vector>
+
 #include "xdl/core/lib/singleton.h"
 #include "xdl/core/framework/device.h"
 #include "xdl/core/framework/tensor.h"
@@ -28,6 +30,12 @@ class DeviceConverter {
   virtual void Convert(Device* src_device, Device* dst_device,
                        Tensor src, Tensor* dst,
                        ThreadPool* tp, std::function<void(Status)> cb) = 0;
+  // Converts the outputs of a node sent to dst_device together, cb runs
+  // once when all of dst are set. The default converts them one by one.
+  virtual void ConvertBatch(Device* src_device, Device* dst_device,
+                            const std::vector<Tensor>& src,
+                            std::vector<Tensor>* dst,
+                            ThreadPool* tp, std::function<void(Status)> cb);
 };
 
 class DeviceConverterRegistry : public Singleton<DeviceConverterRegistry> {
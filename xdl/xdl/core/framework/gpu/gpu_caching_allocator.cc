@@ -0,0 +1,221 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/core/framework/gpu/gpu_caching_allocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include "xdl/core/utils/logging.h"
+
+namespace xdl {
+
+thread_local CudaStream* GpuCachingAllocator::StreamScope::current_ = nullptr;
+
+GpuCachingAllocator* GpuCachingAllocator::instance_ = nullptr;
+
+GpuCachingAllocator::GpuCachingAllocator(Allocator* internal)
+  : internal_(internal), in_use_(0), peak_(0), reserved_(0),
+    cuda_mallocs_(0), requests_(0) {
+  instance_ = this;
+}
+
+void* GpuCachingAllocator::Allocate(size_t size) {
+  size = size == 0 ? kRoundSize : (size + kRoundSize - 1) / kRoundSize * kRoundSize;
+  CudaStream* stream = StreamScope::current_;
+  std::unique_lock<std::mutex> lock(mu_);
+  requests_++;
+  Block* block = FindFree(stream, size);
+  if (block == nullptr) {
+    block = NewSegment(stream, size);
+  }
+  Split(block, size);
+  block->allocated = true;
+  allocated_[block->ptr] = block;
+  in_use_ += block->size;
+  peak_ = std::max(peak_, in_use_);
+  return block->ptr;
+}
+
+void GpuCachingAllocator::Deallocate(void* buf) {
+  std::unique_lock<std::mutex> lock(mu_);
+  auto iter = allocated_.find(buf);
+  if (iter == allocated_.end()) {
+    XDL_LOG(ERROR) << "GpuCachingAllocator: deallocate unknown buffer "
+                   << reinterpret_cast<uintptr_t>(buf);
+    return;
+  }
+  Block* block = iter->second;
+  allocated_.erase(iter);
+  in_use_ -= block->size;
+  Free(block);
+}
+
+GpuCachingAllocator::Block* GpuCachingAllocator::FindFree(CudaStream* stream, size_t size) {
+  Block key{nullptr, size, nullptr, false, nullptr, nullptr, nullptr};
+  FreeList& list = free_[stream];
+  auto iter = list.lower_bound(&key);
+  if (iter != list.end()) {
+    Block* block = *iter;
+    list.erase(iter);
+    ReleaseEvent(block);
+    return block;
+  }
+  for (auto& item : free_) {
+    if (item.first == stream) {
+      continue;
+    }
+    iter = item.second.lower_bound(&key);
+    if (iter == item.second.end()) {
+      continue;
+    }
+    Block* block = *iter;
+    if (block->event != nullptr && cudaEventQuery(block->event) != cudaSuccess) {
+      continue;
+    }
+    item.second.erase(iter);
+    ReleaseEvent(block);
+    block->stream = stream;
+    return block;
+  }
+  return nullptr;
+}
+
+GpuCachingAllocator::Block* GpuCachingAllocator::NewSegment(CudaStream* stream, size_t size) {
+  size_t segment = size <= kSmallSize ? kSmallSegmentSize
+      : (size + kSmallSegmentSize - 1) / kSmallSegmentSize * kSmallSegmentSize;
+  void* ptr;
+  if (cudaMalloc(&ptr, segment) != cudaSuccess) {
+    // every cached segment goes back once the streams are done with them
+    cudaGetLastError();
+    CudaStream::RunOrAbort(cudaDeviceSynchronize(), "Cuda Device Synchronize Error");
+    ReleaseCached();
+    ptr = internal_->Allocate(segment);
+  }
+  cuda_mallocs_++;
+  reserved_ += segment;
+  return new Block{ptr, segment, stream, false, nullptr, nullptr, nullptr};
+}
+
+void GpuCachingAllocator::Split(Block* block, size_t size) {
+  if (block->size - size < kRoundSize) {
+    return;
+  }
+  Block* rest = new Block{static_cast<char*>(block->ptr) + size, block->size - size,
+                          block->stream, false, block, block->next, nullptr};
+  if (block->next != nullptr) {
+    block->next->prev = rest;
+  }
+  block->next = rest;
+  block->size = size;
+  // the rest is ordered on the stream from now on
+  RecordEvent(rest);
+  free_[rest->stream].insert(rest);
+}
+
+void GpuCachingAllocator::Free(Block* block) {
+  block->allocated = false;
+  RecordEvent(block);
+  // the event of the block freed last covers the ones of its neighbours
+  Block* prev = block->prev;
+  if (prev != nullptr && !prev->allocated && prev->stream == block->stream) {
+    free_[prev->stream].erase(prev);
+    ReleaseEvent(prev);
+    prev->event = block->event;
+    prev->size += block->size;
+    prev->next = block->next;
+    if (block->next != nullptr) {
+      block->next->prev = prev;
+    }
+    delete block;
+    block = prev;
+  }
+  Block* next = block->next;
+  if (next != nullptr && !next->allocated && next->stream == block->stream) {
+    free_[next->stream].erase(next);
+    ReleaseEvent(next);
+    block->size += next->size;
+    block->next = next->next;
+    if (next->next != nullptr) {
+      next->next->prev = block;
+    }
+    delete next;
+  }
+  free_[block->stream].insert(block);
+}
+
+void GpuCachingAllocator::ReleaseCached() {
+  for (auto& item : free_) {
+    for (auto iter = item.second.begin(); iter != item.second.end();) {
+      Block* block = *iter;
+      if (block->prev != nullptr || block->next != nullptr) {
+        ++iter;
+        continue;
+      }
+      iter = item.second.erase(iter);
+      ReleaseEvent(block);
+      internal_->Deallocate(block->ptr);
+      reserved_ -= block->size;
+      delete block;
+    }
+  }
+}
+
+void GpuCachingAllocator::RecordEvent(Block* block) {
+  if (block->event == nullptr) {
+    if (events_.empty()) {
+      CudaStream::RunOrAbort(cudaEventCreateWithFlags(&block->event, cudaEventDisableTiming),
+                             "Cuda Event Create Error");
+    } else {
+      block->event = events_.back();
+      events_.pop_back();
+    }
+  }
+  cudaStream_t stream = block->stream == nullptr ? 0 : block->stream->GetInternal();
+  CudaStream::RunOrAbort(cudaEventRecord(block->event, stream), "Cuda Event Record Error");
+}
+
+void GpuCachingAllocator::ReleaseEvent(Block* block) {
+  if (block->event != nullptr) {
+    events_.push_back(block->event);
+    block->event = nullptr;
+  }
+}
+
+std::string GpuCachingAllocator::Report(bool reset_peak) {
+  std::unique_lock<std::mutex> lock(mu_);
+  std::ostringstream report;
+  report << "gpu memory in_use[" << in_use_ << "] peak[" << peak_
+         << "] reserved[" << reserved_ << "] requests[" << requests_
+         << "] cuda_malloc[" << cuda_mallocs_ << "]";
+  if (reset_peak) {
+    peak_ = in_use_;
+    requests_ = 0;
+    cuda_mallocs_ = 0;
+  }
+  return report.str();
+}
+
+void GpuCachingAllocator::StepDone() {
+  static bool enabled = getenv("XDL_GPU_MEMORY_REPORT") != nullptr
+      && strcmp(getenv("XDL_GPU_MEMORY_REPORT"), "1") == 0;
+  if (enabled && instance_ != nullptr) {
+    XDL_LOG(INFO) << instance_->Report(true);
+  }
+}
+
+}  // namespace xdl
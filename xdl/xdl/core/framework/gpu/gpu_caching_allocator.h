@@ -0,0 +1,110 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XDL_CORE_FRAMEWORK_GPU_GPU_CACHING_ALLOCATOR_H_
+#define XDL_CORE_FRAMEWORK_GPU_GPU_CACHING_ALLOCATOR_H_
+
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cuda_runtime.h"
+#include "xdl/core/framework/allocator.h"
+#include "xdl/core/framework/gpu/gpu_stream.h"
+
+namespace xdl {
+
+// Caching allocator ordered by cuda streams. Blocks are carved from cached
+// segments, 2MB ones for requests up to 1MB, split on allocation and merged
+// with their free neighbours on deallocation. A freed block goes back to
+// the free list of the stream it was allocated on, which may reuse it at
+// once since its work is ordered on the stream; other streams take it only
+// once the event recorded at the free completed. cudaMalloc is left to
+// segments the cache can't serve, and cached segments are given back when
+// it fails.
+class GpuCachingAllocator : public Allocator {
+ public:
+  static constexpr size_t kRoundSize = 512;
+  static constexpr size_t kSmallSize = 1 << 20;
+  static constexpr size_t kSmallSegmentSize = 2 << 20;
+
+  // Allocations in scope belong to stream, see GpuOpKernel::Launch.
+  class StreamScope {
+   public:
+    explicit StreamScope(CudaStream* stream) : last_(current_) {
+      current_ = stream;
+    }
+    ~StreamScope() {
+      current_ = last_;
+    }
+   private:
+    friend class GpuCachingAllocator;
+    static thread_local CudaStream* current_;
+    CudaStream* last_;
+  };
+
+  explicit GpuCachingAllocator(Allocator* internal);
+  void* Allocate(size_t size) override;
+  void Deallocate(void* buf) override;
+  // bytes in use, their peak since the last reset, reserved and cudaMallocs
+  std::string Report(bool reset_peak);
+  // Logs the report of the gpu allocator once per step with
+  // XDL_GPU_MEMORY_REPORT=1.
+  static void StepDone();
+
+ private:
+  struct Block {
+    void* ptr;
+    size_t size;
+    CudaStream* stream;
+    bool allocated;
+    Block* prev;
+    Block* next;
+    cudaEvent_t event;
+  };
+  struct BlockCompare {
+    bool operator()(const Block* lhs, const Block* rhs) const {
+      return lhs->size != rhs->size ? lhs->size < rhs->size : lhs->ptr < rhs->ptr;
+    }
+  };
+  using FreeList = std::set<Block*, BlockCompare>;
+
+  Block* FindFree(CudaStream* stream, size_t size);
+  Block* NewSegment(CudaStream* stream, size_t size);
+  void Split(Block* block, size_t size);
+  void Free(Block* block);
+  void ReleaseCached();
+  void RecordEvent(Block* block);
+  void ReleaseEvent(Block* block);
+
+  static GpuCachingAllocator* instance_;
+
+  std::mutex mu_;
+  RefCountedPtr<Allocator> internal_;
+  std::unordered_map<CudaStream*, FreeList> free_;
+  std::unordered_map<void*, Block*> allocated_;
+  std::vector<cudaEvent_t> events_;
+  size_t in_use_;
+  size_t peak_;
+  size_t reserved_;
+  size_t cuda_mallocs_;
+  size_t requests_;
+};
+
+}  // namespace xdl
+
+#endif  // XDL_CORE_FRAMEWORK_GPU_GPU_CACHING_ALLOCATOR_H_
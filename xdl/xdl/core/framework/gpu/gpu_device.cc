@@ -14,9 +14,12 @@ limitations under the License.
 ==============================================================================*/
 
 #include "xdl/core/framework/gpu/gpu_device.h"
+#include "xdl/core/framework/gpu/gpu_caching_allocator.h"
 #include "xdl/core/framework/slab_buddy_allocator.h"
 #include "xdl/core/utils/logging.h"
 
+#include <cstdlib>
+#include <cstring>
 #include <string>
 
 namespace xdl {
@@ -41,6 +44,28 @@ void GpuAllocator::Deallocate(void* buf) {
   CudaStream::RunOrAbort(cudaFree(buf), "Cuda Memory Deallocate Error");
 }
 
+void* CudaHostAllocator::Allocate(size_t size) {
+  void* buf;
+  CudaStream::RunOrAbort(cudaHostAlloc(&buf, size, cudaHostAllocPortable),
+                         "Cuda Host Memory Allocate Error");
+  return buf;
+}
+
+void CudaHostAllocator::Deallocate(void* buf) {
+  CudaStream::RunOrAbort(cudaFreeHost(buf), "Cuda Host Memory Deallocate Error");
+}
+
+// cudaHostAlloc pins the pages at once, the slabs keep them for reuse
+PinnedCpuDevice::PinnedCpuDevice()
+    : CpuDevice(AllocatorManager::Instance()->Get(
+          "CPU_PINNED", []{
+            Allocator* host_allocator = new CudaHostAllocator;
+            Allocator* slab_buddy_allocator = new SlabBuddyAllocator(
+                host_allocator, 256ul << 20/*256M*/, 4ul << 10/*4K*/, 32);
+            host_allocator->UnRef();
+            return slab_buddy_allocator;
+          })) {}
+
 std::string GpuDevice::DeviceType() {
   return "GPU";
 }
@@ -59,6 +84,13 @@ GpuDevice::GpuDevice(int id)
     : Device(AllocatorManager::Instance()->Get(
               "GPU", []{
                 Allocator* simple_allocator = new GpuAllocator;
+                // XDL_GPU_ALLOCATOR=caching orders the reuse by streams
+                const char* allocator = getenv("XDL_GPU_ALLOCATOR");
+                if (allocator != nullptr && strcmp(allocator, "caching") == 0) {
+                  Allocator* caching_allocator = new GpuCachingAllocator(simple_allocator);
+                  simple_allocator->UnRef();
+                  return caching_allocator;
+                }
                 Allocator* slab_buddy_allocator = new SlabBuddyAllocator(
                     simple_allocator, 1ul << 30/*1G*/, 16ul << 10/*16K*/, 32
                   );
@@ -89,7 +121,11 @@ void GpuOpKernel::Launch(OpKernelContext* ctx) {
   }
 #else
   CudaStream* stream = CudaStreams::GetInstance()->GetCudaStream();
-  Status st = LaunchKernel(ctx, stream);
+  Status st;
+  {
+    GpuCachingAllocator::StreamScope scope(stream);
+    st = LaunchKernel(ctx, stream);
+  }
   if (!st.IsOk()) {
     ctx->LaunchDone(st);
     ctx->RunDone(Status::Ok());
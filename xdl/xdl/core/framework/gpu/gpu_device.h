@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <string>
 
+#include "xdl/core/framework/cpu_device.h"
 #include "xdl/core/framework/device.h"
 #include "xdl/core/framework/device_registry.h"
 #include "xdl/core/framework/gpu/gpu_stream.h"
@@ -31,6 +32,19 @@ class GpuAllocator : public Allocator {
   void Deallocate(void* buf) override;
 };
 
+class CudaHostAllocator : public Allocator {
+ public:
+  void* Allocate(size_t size) override;
+  void Deallocate(void* buf) override;
+};
+
+// A cpu device on page locked memory, copied to and from the gpu by dma
+// without staging, so cudaMemcpyAsync from it overlaps with the kernels.
+class PinnedCpuDevice : public CpuDevice {
+ public:
+  PinnedCpuDevice();
+};
+
 class GpuDevice : public Device {
  public:
   std::string DeviceType() override;
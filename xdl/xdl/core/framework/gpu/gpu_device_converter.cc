@@ -13,7 +13,10 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <string.h>
 #include <time.h>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <unistd.h>
 
@@ -31,21 +34,33 @@ static double GetTime() {
   return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
 }
 
+// Copies the buffers on a dedicated stream, a round of the queued copies is
+// issued without waiting and completes by the event recorded after it, so
+// the copies overlap with the kernels and with the next round.
 class GpuTransferManager {
  public:
   struct TransferMsg {
     Buffer* src_buffer;
     Buffer* dst_buffer;
     std::function<void(Status)> cb;
+    // packed into src_buffer at the offsets before it is copied
+    std::vector<std::pair<Buffer*, size_t>> gather;
     TransferMsg(Buffer* src_buffer = nullptr,Buffer* dst_buffer = nullptr,
                 std::function<void(Status)> cb = nullptr)
     : src_buffer(src_buffer), dst_buffer(dst_buffer), cb(cb) {}
   };
 
+  struct TransferRound {
+    cudaEvent_t event;
+    double btime;
+    size_t size = 0;
+    std::vector<TransferMsg> msgs;
+  };
+
   GpuTransferManager(CudaStream* stream, enum cudaMemcpyKind kind)
   : stream_(stream), kind_(kind), alive_(true) {
     queue_ = new BlockingQueue<TransferMsg>(kQueueCapacity);
-    cb_queue_ = new BlockingQueue<TransferMsg>(kQueueCapacity);
+    cb_queue_ = new BlockingQueue<TransferRound>(kQueueCapacity);
     thread_ = std::thread(&GpuTransferManager::TransferMain, this);
     cb_thread_ = std::thread(&GpuTransferManager::CallbackMain, this);
   }
@@ -57,70 +72,121 @@ class GpuTransferManager {
     cb_thread_.join();
     delete queue_;
     delete cb_queue_;
+    for (cudaEvent_t event : events_) {
+      cudaEventDestroy(event);
+    }
   }
 
-  void Enqueue(Buffer* src_buffer, Buffer* dst_buffer,
-               std::function<void(Status)> cb) {
-    while (!queue_->TryEnqueue(TransferMsg(src_buffer, dst_buffer, cb), 1) && alive_) {
+  void Enqueue(const TransferMsg& msg) {
+    while (!queue_->TryEnqueue(msg, 1) && alive_) {
       printf("Warning: transfer queue %d is full!\n", kind_);
     }
   }
 
+  void Enqueue(Buffer* src_buffer, Buffer* dst_buffer,
+               std::function<void(Status)> cb) {
+    Enqueue(TransferMsg(src_buffer, dst_buffer, cb));
+  }
+
   void TransferMain() {
     TransferMsg transfer_msg;
-    std::vector<TransferMsg> cb_msgs;
-    cb_msgs.reserve(kQueueCapacity);
     while (alive_) {
-      double btime = GetTime();
-      while (queue_->TryDequeue(&transfer_msg, 0)) {
+      if (!queue_->TryDequeue(&transfer_msg, 1)) {
+        continue;
+      }
+      TransferRound round;
+      round.btime = GetTime();
+      do {
+        Gather(transfer_msg);
         CudaStream::RunOrAbort(
             cudaMemcpyAsync(transfer_msg.dst_buffer->begin(), transfer_msg.src_buffer->begin(),
                             transfer_msg.src_buffer->size(), kind_,
                             stream_->GetInternal()),
             "cudaMemcpyAsync error");
-        total_size_ += transfer_msg.src_buffer->size();
-        ++round_;
-        cb_msgs.push_back(transfer_msg);
-      }
-      size_t cb_msgs_size = cb_msgs.size();
-      if (cb_msgs_size > 0) {
-        CudaStream::RunOrAbort(
-            cudaStreamSynchronize(stream_->GetInternal()),
-            "cudaStreamSynchronize error");
-        total_time_ += GetTime() - btime;
-        if (round_ % 10000000 < cb_msgs_size) {
-          printf("Transfer %d (1:CPU=>GPU,2:GPU=>CPU) speed = %g MB/s, %g round/s\n",
-                 kind_, total_size_ / 1024 / 1024 / total_time_, round_ / total_time_);
-        }
-        for (size_t i = 0; i < cb_msgs_size; ++i) {
-          while (!cb_queue_->TryEnqueue(cb_msgs[i], 1) && alive_) {
-            printf("Warning: callback queue %d is full!\n", kind_);
-          }
-        }
-        cb_msgs.clear();
-      } else {
-        usleep(1000);
+        round.size += transfer_msg.src_buffer->size();
+        round.msgs.push_back(transfer_msg);
+      } while (round.msgs.size() < kQueueCapacity &&
+               queue_->TryDequeue(&transfer_msg, 0));
+      round.event = NewEvent();
+      CudaStream::RunOrAbort(
+          cudaEventRecord(round.event, stream_->GetInternal()),
+          "cudaEventRecord error");
+      while (!cb_queue_->TryEnqueue(round, 1) && alive_) {
+        printf("Warning: callback queue %d is full!\n", kind_);
       }
     }
   }
 
   void CallbackMain() {
-    TransferMsg transfer_msg;
+    TransferRound round;
     while (alive_) {
-      if (cb_queue_->TryDequeue(&transfer_msg, 1)) {
-        transfer_msg.cb(Status());
+      if (!cb_queue_->TryDequeue(&round, 1)) {
+        continue;
+      }
+      CudaStream::RunOrAbort(
+          cudaEventSynchronize(round.event),
+          "cudaEventSynchronize error");
+      FreeEvent(round.event);
+      total_time_ += GetTime() - round.btime;
+      total_size_ += round.size;
+      round_ += round.msgs.size();
+      if (round_ % 10000000 < round.msgs.size()) {
+        printf("Transfer %d (1:CPU=>GPU,2:GPU=>CPU) speed = %g MB/s, %g round/s\n",
+               kind_, total_size_ / 1024 / 1024 / total_time_, round_ / total_time_);
+      }
+      for (auto& msg : round.msgs) {
+        msg.cb(Status());
       }
     }
   }
 
  private:
+  // the host buffers are packed here, the device ones on the stream
+  void Gather(const TransferMsg& msg) {
+    char* begin = static_cast<char*>(msg.src_buffer->begin());
+    for (auto& item : msg.gather) {
+      if (kind_ == cudaMemcpyHostToDevice) {
+        memcpy(begin + item.second, item.first->begin(), item.first->size());
+      } else {
+        CudaStream::RunOrAbort(
+            cudaMemcpyAsync(begin + item.second, item.first->begin(),
+                            item.first->size(), cudaMemcpyDeviceToDevice,
+                            stream_->GetInternal()),
+            "cudaMemcpyAsync error");
+      }
+    }
+  }
+
+  cudaEvent_t NewEvent() {
+    {
+      std::unique_lock<std::mutex> lock(events_mu_);
+      if (!events_.empty()) {
+        cudaEvent_t event = events_.back();
+        events_.pop_back();
+        return event;
+      }
+    }
+    cudaEvent_t event;
+    CudaStream::RunOrAbort(
+        cudaEventCreateWithFlags(&event, cudaEventDisableTiming | cudaEventBlockingSync),
+        "cudaEventCreate error");
+    return event;
+  }
+
+  void FreeEvent(cudaEvent_t event) {
+    std::unique_lock<std::mutex> lock(events_mu_);
+    events_.push_back(event);
+  }
+
   CudaStream* stream_;
   enum cudaMemcpyKind kind_;
   bool alive_;
   BlockingQueue<TransferMsg>* queue_;
-  BlockingQueue<TransferMsg>* cb_queue_;
+  BlockingQueue<TransferRound>* cb_queue_;
   std::thread thread_;
   std::thread cb_thread_;
+  std::mutex events_mu_;
+  std::vector<cudaEvent_t> events_;
   static constexpr int kQueueCapacity = 65536;
 
   double total_time_ = 0.;
@@ -128,106 +194,148 @@ class GpuTransferManager {
   size_t round_ = 0;
 };
 
-class GpuCpuConverter : public DeviceConverter {
+// Converts between the Src and Dst devices by the GpuTransferManager on
+// the stream kStream.
+template <typename Src, typename Dst, int kStream, enum cudaMemcpyKind kKind>
+class GpuTransferConverter : public DeviceConverter {
  public:
-  GpuCpuConverter() : stream_(nullptr), transfer_manager_(nullptr) {}
+  GpuTransferConverter(const std::string& src_type, const std::string& dst_type)
+    : src_type_(src_type), dst_type_(dst_type), transfer_manager_(nullptr) {}
+
   void Convert(Device* src_device, Device* dst_device,
                Tensor src, Tensor* dst,
                ThreadPool* tp, std::function<void(Status)> cb) override {
-    GpuDevice* src_gpu = dynamic_cast<GpuDevice*>(src_device);
-    CpuDevice* dst_cpu = dynamic_cast<CpuDevice*>(dst_device);
-    XDL_CHECK_COND_ASYNC(src_gpu != nullptr,
-        Status::Internal("Src Device Should Be GPU"), cb);
-    XDL_CHECK_COND_ASYNC(dst_cpu != nullptr,
-        Status::Internal("Dst Device Should Be CPU"), cb);
-    if (stream_ == nullptr) {
-      std::unique_lock<std::mutex> lock(mu_);
-      if (stream_ == nullptr) {
-        stream_ = CudaStreamManager::Instance()->GetCudaStream(kStream);
-      }
-    }
-    if (transfer_manager_ == nullptr) {
-      std::unique_lock<std::mutex> lock(mu_);
-      if (transfer_manager_ == nullptr) {
-        transfer_manager_ = new GpuTransferManager(stream_, cudaMemcpyDeviceToHost);
-      }
-    }
-    *dst = Tensor(dst_cpu, src.Shape(), src.Type());
-    //stream_->Lock();
+    XDL_CHECK_STATUS_ASYNC(CheckDevices(src_device, dst_device), cb);
+    *dst = Tensor(dst_device, src.Shape(), src.Type());
     Buffer* src_buffer = src.GetBuffer();
     if (src_buffer->size() > 0) {
       Buffer* dst_buffer = dst->GetBuffer();
-#if 0
-      CudaStream::RunOrAbort(
-          cudaMemcpyAsync(dst_buffer->begin(), src_buffer->begin(),
-                          src_buffer->size(), cudaMemcpyDeviceToHost,
-                          stream_->GetInternal()),
-          "cuda Memcpy device to host Error");
-      stream_->AddCallback(tp, cb);
-#else
-      transfer_manager_->Enqueue(src_buffer, dst_buffer, cb);
-#endif
+      TransferManager()->Enqueue(src_buffer, dst_buffer, cb);
     } else {
       cb(Status());
     }
-    //stream_->Unlock();
   }
+
+  // The tensors smaller than kCoalesceSize are packed into a staging
+  // buffer on the src device and copied once into a buffer on the dst
+  // device, which the dst tensors slice.
+  void ConvertBatch(Device* src_device, Device* dst_device,
+                    const std::vector<Tensor>& src,
+                    std::vector<Tensor>* dst,
+                    ThreadPool* tp, std::function<void(Status)> cb) override {
+    XDL_CHECK_STATUS_ASYNC(CheckDevices(src_device, dst_device), cb);
+    std::vector<size_t> offsets(src.size());
+    size_t staging_size = 0, coalesced = 0;
+    for (size_t i = 0; i < src.size(); i++) {
+      size_t size = src[i].GetBuffer()->size();
+      if (size > 0 && size < kCoalesceSize) {
+        offsets[i] = staging_size;
+        staging_size += (size + kAlignment - 1) / kAlignment * kAlignment;
+        coalesced++;
+      }
+    }
+    if (coalesced < 2) {
+      DeviceConverter::ConvertBatch(src_device, dst_device, src, dst, tp, cb);
+      return;
+    }
+
+    std::shared_ptr<ConvertTask> task = std::make_shared<ConvertTask>();
+    task->src = src;
+    task->count = 1;
+    task->cb = cb;
+    dst->resize(src.size());
+    for (size_t i = 0; i < src.size(); i++) {
+      size_t size = src[i].GetBuffer()->size();
+      if (size == 0 || size >= kCoalesceSize) {
+        task->count++;
+      }
+    }
+
+    Buffer* staging = new Buffer(src_device->GetAllocator(), staging_size);
+    Buffer* target = new Buffer(dst_device->GetAllocator(), staging_size);
+    task->staging = staging;
+    task->target = target;
+    staging->UnRef();
+    target->UnRef();
+    GpuTransferManager::TransferMsg msg(staging, target, [task](Status st) {
+      task->Done(st);
+    });
+    char* begin = static_cast<char*>(target->begin());
+    for (size_t i = 0; i < src.size(); i++) {
+      Buffer* src_buffer = src[i].GetBuffer();
+      size_t size = src_buffer->size();
+      if (size == 0 || size >= kCoalesceSize) {
+        Convert(src_device, dst_device, src[i], &(*dst)[i], tp,
+                [task](Status st) { task->Done(st); });
+        continue;
+      }
+      msg.gather.emplace_back(src_buffer, offsets[i]);
+      Buffer* buffer = new Buffer(begin + offsets[i], size, target);
+      (*dst)[i] = Tensor(src[i].Shape(), src[i].Type(), buffer);
+      buffer->UnRef();
+    }
+    TransferManager()->Enqueue(msg);
+  }
+
  private:
-  static constexpr int kStream = -2;
-  std::mutex mu_;
-  CudaStream* stream_;
-  GpuTransferManager* transfer_manager_;
-};
+  static constexpr size_t kCoalesceSize = 64 << 10;
+  static constexpr size_t kAlignment = 256;
 
-class CpuGpuConverter : public DeviceConverter {
- public:
-  CpuGpuConverter() : stream_(nullptr), transfer_manager_(nullptr) {}
-  void Convert(Device* src_device, Device* dst_device,
-               Tensor src, Tensor* dst,
-               ThreadPool* tp, std::function<void(Status)> cb) override {
-    CpuDevice* src_cpu = dynamic_cast<CpuDevice*>(src_device);
-    GpuDevice* dst_gpu = dynamic_cast<GpuDevice*>(dst_device);
-    XDL_CHECK_COND_ASYNC(src_cpu != nullptr,
-        Status::Internal("Src Device Should Be CPU"), cb);
-    XDL_CHECK_COND_ASYNC(dst_gpu != nullptr,
-        Status::Internal("Dst Device Should Be GPU"), cb);
-    if (stream_ == nullptr) {
-      std::unique_lock<std::mutex> lock(mu_);
-      if (stream_ == nullptr) {
-        stream_ = CudaStreamManager::Instance()->GetCudaStream(kStream);
+  // keeps the gathered tensors and the buffers until the copy is done
+  struct ConvertTask {
+    std::vector<Tensor> src;
+    RefCountedPtr<Buffer> staging;
+    RefCountedPtr<Buffer> target;
+    std::atomic<size_t> count;
+    std::mutex mu;
+    Status status;
+    std::function<void(Status)> cb;
+    void Done(Status st) {
+      if (!st.IsOk()) {
+        std::unique_lock<std::mutex> lock(mu);
+        status = st;
+      }
+      if (--count == 0) {
+        cb(status);
       }
     }
+  };
+
+  Status CheckDevices(Device* src_device, Device* dst_device) {
+    XDL_CHECK_COND(dynamic_cast<Src*>(src_device) != nullptr,
+                   Status::Internal("Src Device Should Be " + src_type_));
+    XDL_CHECK_COND(dynamic_cast<Dst*>(dst_device) != nullptr,
+                   Status::Internal("Dst Device Should Be " + dst_type_));
+    return Status::Ok();
+  }
+
+  GpuTransferManager* TransferManager() {
     if (transfer_manager_ == nullptr) {
       std::unique_lock<std::mutex> lock(mu_);
       if (transfer_manager_ == nullptr) {
-        transfer_manager_ = new GpuTransferManager(stream_, cudaMemcpyHostToDevice);
+        transfer_manager_ = new GpuTransferManager(
+            CudaStreamManager::Instance()->GetCudaStream(kStream), kKind);
       }
     }
-    *dst = Tensor(dst_gpu, src.Shape(), src.Type());
-    //stream_->Lock();
-    Buffer* src_buffer = src.GetBuffer();
-    if (src_buffer->size() > 0) {
-      Buffer* dst_buffer = dst->GetBuffer();
-#if 0
-      CudaStream::RunOrAbort(
-          cudaMemcpyAsync(dst_buffer->begin(), src_buffer->begin(),
-                          src_buffer->size(), cudaMemcpyHostToDevice,
-                          stream_->GetInternal()),
-          "cuda Memcpy host to device Error");
-      stream_->AddCallback(tp, cb);
-#else
-      transfer_manager_->Enqueue(src_buffer, dst_buffer, cb);
-#endif
-    } else {
-      cb(Status());
-    }
-    //stream_->Unlock();
+    return transfer_manager_;
   }
- private:
-  static constexpr int kStream = -3;
+
+  std::string src_type_;
+  std::string dst_type_;
   std::mutex mu_;
-  CudaStream* stream_;
-  GpuTransferManager* transfer_manager_;
+  std::atomic<GpuTransferManager*> transfer_manager_;
+};
+
+class GpuCpuConverter
+  : public GpuTransferConverter<GpuDevice, CpuDevice, -2, cudaMemcpyDeviceToHost> {
+ public:
+  GpuCpuConverter() : GpuTransferConverter("GPU", "CPU") {}
+};
+
+class CpuGpuConverter
+  : public GpuTransferConverter<CpuDevice, GpuDevice, -3, cudaMemcpyHostToDevice> {
+ public:
+  CpuGpuConverter() : GpuTransferConverter("CPU", "GPU") {}
 };
 
 class GpuGpuConverter : public DeviceConverter {
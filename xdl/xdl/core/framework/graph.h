@@ -22,6 +22,8 @@ limitations under the License.
 #include "xdl/core/framework/op_kernel.h"
 #include "xdl/core/framework/device_converter.h"
 #include "xdl/core/framework/graph_def.h"
+#include "xdl/core/framework/memory_plan.h"
+#include "xdl/core/framework/step_pipeline.h"
 
 namespace xdl {
 
@@ -44,14 +46,24 @@ struct Node {
   std::vector<Output> outputs;
   std::unique_ptr<OpKernelBase> op;
   OpKernelContextArg arg;
+  // Length of the longest path to the sink, ps ops weigh kPsOpCost, ready
+  // nodes with longer paths launch first.
+  int64_t priority = 0;
+  // Trivially cheap kernel run on the launching thread.
+  bool inline_run = false;
 };
 
 struct Graph {
   // Source Node Id
   static constexpr int kSource = 0;
   static constexpr int kSink = 1;
+  static constexpr int64_t kPsOpCost = 100;
   std::vector<Node> nodes;
   std::map<std::pair<Device*, Device*>, DeviceConverter*> device_converter;
+  // orders the runs with RunOption::pipeline
+  std::unique_ptr<StepPipeline> pipeline;
+  // null unless MemoryPlan::Enabled()
+  std::unique_ptr<MemoryPlan> memory_plan;
 };
 
 }  // namespace xdl
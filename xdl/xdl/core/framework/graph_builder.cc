@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "xdl/core/framework/graph_builder.h"
 
+#include <algorithm>
+#include <set>
 #include <vector>
 #include <string>
 
@@ -31,6 +33,11 @@ Status GraphBuilder::Build() {
   XDL_CHECK_STATUS(AddDeviceConverter());
   XDL_CHECK_STATUS(CheckDAG());
   XDL_CHECK_STATUS(CheckOutputOverflow());
+  XDL_CHECK_STATUS(BuildSchedule());
+  graph_->pipeline.reset(new StepPipeline(graph_->nodes.size()));
+  if (MemoryPlan::Enabled()) {
+    graph_->memory_plan.reset(new MemoryPlan);
+  }
   return Status::Ok();
 }
 
@@ -258,5 +265,37 @@ Status GraphBuilder::CheckOutputOverflow() {
   return Status::Ok();
 }
 
-}  // namespace xdl
+Status GraphBuilder::BuildSchedule() {
+  static const std::set<std::string> inline_ops = {
+    "ShapeOp", "Reshape", "ExpandDims", "IdentityOp", "NoOp", "_Constant"};
+  std::vector<int> ref;
+  std::vector<int> order;
+  for (size_t i = 0; i < graph_->nodes.size(); i++) {
+    ref.push_back(graph_->nodes[i].inputs.size());
+    if (ref.back() == 0) {
+      order.push_back(i);
+    }
+  }
+  for (size_t i = 0; i < order.size(); i++) {
+    for (auto& output : graph_->nodes[order[i]].outputs) {
+      if (--ref[output.node_id] == 0) {
+        order.push_back(output.node_id);
+      }
+    }
+  }
+  for (auto iter = order.rbegin(); iter != order.rend(); ++iter) {
+    Node& node = graph_->nodes[*iter];
+    int64_t longest = 0;
+    for (auto& output : node.outputs) {
+      longest = std::max(longest, graph_->nodes[output.node_id].priority);
+    }
+    int64_t cost = node.op_name.compare(0, 2, "Ps") == 0 ? Graph::kPsOpCost : 1;
+    node.priority = longest + cost;
+    node.inline_run = node.arg.device != nullptr
+        && node.arg.device->DeviceType() == "CPU"
+        && inline_ops.find(node.op_name) != inline_ops.end();
+  }
+  return Status::Ok();
+}
 
+}  // namespace xdl
@@ -41,6 +41,7 @@ class GraphBuilder {
   Status CreateDeviceConverter(Device* src, Device* dst);
   Status CheckDAG();
   Status CheckOutputOverflow();
+  Status BuildSchedule();
   GraphDef def_;
   OutputSpec output_;
   Graph* graph_;
@@ -0,0 +1,75 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/core/framework/memory_plan.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace xdl {
+
+bool MemoryPlan::Enabled() {
+  static bool enabled = getenv("XDL_MEMORY_PLAN") != nullptr
+      && strcmp(getenv("XDL_MEMORY_PLAN"), "1") == 0;
+  return enabled;
+}
+
+Tensor MemoryPlan::Allocate(Device* device, const TensorShape& shape, DataType type) {
+  size_t size = shape.NumElements() * SizeOfType(type);
+  if (!planned_) {
+    std::unique_lock<std::mutex> lock(record_mu_);
+    record_[size]++;
+    return Tensor(device, shape, type);
+  }
+  auto iter = pools_.find(size);
+  if (iter == pools_.end()) {
+    return Tensor(device, shape, type);
+  }
+  Pool* pool = iter->second.get();
+  std::unique_lock<std::mutex> lock(pool->mu);
+  for (size_t i = 0; i < pool->buffers.size(); i++) {
+    size_t k = (pool->cursor + i) % pool->buffers.size();
+    Buffer* buffer = pool->buffers[k].get();
+    if (buffer->RefCount() == 1) {
+      pool->cursor = k + 1;
+      return Tensor(shape, type, buffer);
+    }
+  }
+  if (pool->buffers.size() < pool->capacity) {
+    Tensor tensor(device, shape, type);
+    pool->buffers.emplace_back(tensor.GetBuffer());
+    return tensor;
+  }
+  return Tensor(device, shape, type);
+}
+
+void MemoryPlan::StepDone(bool ok) {
+  if (planned_ || !ok) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(record_mu_);
+  if (planned_) {
+    return;
+  }
+  for (auto& item : record_) {
+    std::unique_ptr<Pool> pool(new Pool);
+    pool->capacity = item.second;
+    pool->cursor = 0;
+    pools_[item.first] = std::move(pool);
+  }
+  planned_ = true;
+}
+
+}  // namespace xdl
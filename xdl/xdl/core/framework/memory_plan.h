@@ -0,0 +1,61 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XDL_CORE_FRAMEWORK_MEMORY_PLAN_H_
+#define XDL_CORE_FRAMEWORK_MEMORY_PLAN_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "xdl/core/framework/tensor.h"
+
+namespace xdl {
+
+// Reusable step arena of a cached graph, for its cpu kernels. The first
+// successful step counts the allocations of every byte size, after that each size gets a pool
+// of at most that many buffers. A buffer is handed out again once the pool
+// holds its only reference, so tensors whose lifetimes don't overlap share
+// it wherever they are freed, also when they escape into ops. Sizes the
+// plan never saw, e.g. after a shape change, and exhausted pools fall back
+// to the allocator. Enabled with XDL_MEMORY_PLAN=1.
+class MemoryPlan {
+ public:
+  MemoryPlan() : planned_(false) {}
+  Tensor Allocate(Device* device, const TensorShape& shape, DataType type);
+  void StepDone(bool ok);
+
+  static bool Enabled();
+
+ private:
+  struct Pool {
+    std::mutex mu;
+    size_t capacity;
+    size_t cursor;
+    std::vector<RefCountedPtr<Buffer>> buffers;
+  };
+
+  std::atomic<bool> planned_;
+  std::mutex record_mu_;
+  std::unordered_map<size_t, size_t> record_;
+  // read only once planned_
+  std::unordered_map<size_t, std::unique_ptr<Pool>> pools_;
+};
+
+}  // namespace xdl
+
+#endif  // XDL_CORE_FRAMEWORK_MEMORY_PLAN_H_
@@ -28,7 +28,11 @@ Status OpKernelBase::Init(OpKernelConstruction* ctx) {
 }
 
 void OpKernel::Launch(OpKernelContext* ctx) {
-  Status status = Compute(ctx);
+  Status status;
+  {
+    ps::common::TraceScope trace_scope(ctx->GetTraceContext());
+    status = Compute(ctx);
+  }
   ctx->LaunchDone(status);
   ctx->RunDone(Status::Ok());
 }
@@ -38,6 +42,7 @@ void OpKernelAsync::Launch(OpKernelContext* ctx) {
     ctx->LaunchDone(st);
     ctx->RunDone(Status::Ok());
   };
+  ps::common::TraceScope trace_scope(ctx->GetTraceContext());
   Compute(ctx, done);
 }
 
@@ -164,7 +169,12 @@ Status OpKernelContext::GetInputList(const std::string& name,
 Status OpKernelContext::Allocate(const TensorShape& shape,
                                  DataType type,
                                  Tensor* tensor) {
-  *tensor = Tensor(arg_->device, shape, type);
+  MemoryPlan* plan = executor_ == nullptr ? nullptr : executor_->GetMemoryPlan();
+  if (plan != nullptr && arg_->device->DeviceType() == "CPU") {
+    *tensor = plan->Allocate(arg_->device, shape, type);
+  } else {
+    *tensor = Tensor(arg_->device, shape, type);
+  }
   allocated_.push_back(*tensor);
   return Status::Ok();
 }
@@ -26,6 +26,7 @@ limitations under the License.
 #include "xdl/core/framework/tensor.h"
 #include "xdl/core/framework/graph_def.h"
 #include "xdl/core/framework/run_option.h"
+#include "ps-plus/common/tracer.h"
 
 namespace xdl {
 
@@ -118,12 +119,20 @@ class OpKernelContext : public RefCounted {
   const std::vector<Tensor>& GetOutputs() const {
     return output_;
   }
+  // The node span of a traced step, the ps requests of Compute join it.
+  void SetTraceContext(const ps::common::TraceContext& trace) {
+    trace_ = trace;
+  }
+  const ps::common::TraceContext& GetTraceContext() const {
+    return trace_;
+  }
 
  private:
   OpKernelContextArg* arg_;
   SimpleExecutor* executor_;
   OpKernelBase::Callback launch_done_;
   OpKernelBase::Callback run_done_;
+  ps::common::TraceContext trace_;
 
   std::vector<Tensor> allocated_;
   std::vector<Tensor> input_;
@@ -0,0 +1,289 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/core/framework/profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+
+#include "xdl/core/framework/graph.h"
+#include "xdl/core/utils/time_utils.h"
+
+namespace xdl {
+
+namespace {
+
+int64_t ThreadId() {
+  return std::hash<std::thread::id>()(std::this_thread::get_id());
+}
+
+// ps ops are asynchronous, their node spans are the rpc round trips
+std::string Category(const std::string& op) {
+  return op.compare(0, 2, "Ps") == 0 ? "ps_rpc" : "op";
+}
+
+std::string Escape(const std::string& str) {
+  std::string ret;
+  for (char c : str) {
+    switch (c) {
+     case '"': ret += "\\\""; break;
+     case '\\': ret += "\\\\"; break;
+     case '\n': ret += "\\n"; break;
+     case '\t': ret += "\\t"; break;
+     default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char buf[8];
+        snprintf(buf, sizeof(buf), "\\u%04x", c);
+        ret += buf;
+      } else {
+        ret += c;
+      }
+    }
+  }
+  return ret;
+}
+
+}  // namespace
+
+constexpr size_t Profiler::kDefaultMaxSpans;
+
+Profiler::Profiler()
+  : enabled_(false), sample_period_(1), step_counter_(0),
+    max_spans_(kDefaultMaxSpans), steps_(0) {
+  const char* env = getenv("XDL_PROFILE_SAMPLE_RATE");
+  if (env != nullptr && atof(env) > 0) {
+    Start(atof(env));
+  }
+}
+
+void Profiler::Start(double sample_rate, size_t max_spans) {
+  if (sample_rate <= 0) {
+    Stop();
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    max_spans_ = std::max<size_t>(max_spans, 1);
+    while (spans_.size() > max_spans_) {
+      spans_.pop_front();
+    }
+  }
+  sample_period_ = std::max<int64_t>(std::llround(1 / sample_rate), 1);
+  step_counter_ = 0;
+  enabled_ = true;
+}
+
+void Profiler::Stop() {
+  enabled_ = false;
+}
+
+bool Profiler::Sample() {
+  if (!enabled_) {
+    return false;
+  }
+  return step_counter_++ % sample_period_ == 0;
+}
+
+void Profiler::AddSpan(const std::string& category, const std::string& name,
+                       int64_t start_micros, int64_t end_micros) {
+  int64_t micros = std::max<int64_t>(end_micros - start_micros, 0);
+  std::unique_lock<std::mutex> lock(mu_);
+  OpStat& op = op_stats_[category + ":" + name];
+  op.count++;
+  op.total_micros += micros;
+  op.max_micros = std::max(op.max_micros, micros);
+  Push(Span{name, category, start_micros, end_micros, ThreadId(), ""});
+}
+
+void Profiler::AddStep(const Graph& graph, const proto::PerfStats& stats) {
+  std::vector<int> path = CriticalPath(graph, stats);
+  std::vector<bool> critical(stats.node_stats_size(), false);
+  std::string detail;
+  for (int id : path) {
+    critical[id] = true;
+    detail += (detail.empty() ? "" : " -> ") + stats.node_stats(id).node_name();
+  }
+  int64_t step_start = -1, step_end = -1;
+  std::unique_lock<std::mutex> lock(mu_);
+  steps_++;
+  for (int i = 0; i < stats.node_stats_size(); i++) {
+    const proto::NodeExecStat& stat = stats.node_stats(i);
+    if (stat.end_micros() == 0) {
+      continue;
+    }
+    int64_t micros = stat.end_micros() - stat.start_micros();
+    OpStat& op = op_stats_[stat.op()];
+    op.count++;
+    op.total_micros += micros;
+    op.max_micros = std::max(op.max_micros, micros);
+    if (critical[i]) {
+      op.critical_micros += micros;
+    }
+    if (step_start < 0 || stat.start_micros() < step_start) {
+      step_start = stat.start_micros();
+    }
+    step_end = std::max<int64_t>(step_end, stat.end_micros());
+    Push(Span{stat.node_name(), Category(stat.op()), stat.start_micros(),
+              stat.end_micros(), stat.thread_id(), stat.op()});
+  }
+  if (step_start >= 0) {
+    Push(Span{"step", "step", step_start, step_end, 0, detail});
+  }
+}
+
+void Profiler::Push(Span&& span) {
+  if (span.end_micros < span.start_micros) {
+    span.end_micros = span.start_micros;
+  }
+  spans_.push_back(std::move(span));
+  while (spans_.size() > max_spans_) {
+    spans_.pop_front();
+  }
+}
+
+std::vector<int> Profiler::CriticalPath(const Graph& graph,
+                                        const proto::PerfStats& stats) {
+  auto end_of = [&stats](int id) -> int64_t {
+    return id < stats.node_stats_size() ? stats.node_stats(id).end_micros() : 0;
+  };
+  int last = -1;
+  for (int i = 0; i < stats.node_stats_size() && i < (int)graph.nodes.size(); i++) {
+    if (end_of(i) != 0 && (last < 0 || end_of(i) > end_of(last))) {
+      last = i;
+    }
+  }
+  std::vector<int> path;
+  while (last >= 0) {
+    path.push_back(last);
+    int pred = -1;
+    for (auto&& input : graph.nodes[last].inputs) {
+      if (end_of(input.node_id) != 0 &&
+          (pred < 0 || end_of(input.node_id) > end_of(pred))) {
+        pred = input.node_id;
+      }
+    }
+    last = pred;
+  }
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+uint64_t Profiler::NodeSpanId(const ps::common::TraceContext& step, int node_id) {
+  return ps::common::Tracer::ChildId(step.span_id, node_id);
+}
+
+void Profiler::ExportTrace(const proto::PerfStats& stats,
+                           const ps::common::TraceContext& step) {
+  ps::common::Tracer* tracer = ps::common::Tracer::Instance();
+  int64_t step_start = -1, step_end = -1;
+  for (int i = 0; i < stats.node_stats_size(); i++) {
+    const proto::NodeExecStat& stat = stats.node_stats(i);
+    if (stat.end_micros() == 0) {
+      continue;
+    }
+    tracer->Record(step, NodeSpanId(step, i), Category(stat.op()),
+                   stat.node_name(), stat.start_micros(), stat.end_micros());
+    if (step_start < 0 || stat.start_micros() < step_start) {
+      step_start = stat.start_micros();
+    }
+    step_end = std::max<int64_t>(step_end, stat.end_micros());
+  }
+  if (step_start >= 0) {
+    // the root span of the trace
+    tracer->Record(ps::common::TraceContext(step.trace_id, 0), step.span_id,
+                   "step", "step", step_start, step_end);
+  }
+}
+
+std::string Profiler::ChromeTrace() {
+  std::unique_lock<std::mutex> lock(mu_);
+  std::unordered_map<int64_t, int> tids;
+  std::string ret = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for (auto&& span : spans_) {
+    auto iter = tids.insert({span.thread_id, (int)tids.size()}).first;
+    ret += first ? "\n" : ",\n";
+    first = false;
+    ret += "{\"name\":\"" + Escape(span.name) +
+           "\",\"cat\":\"" + Escape(span.category) +
+           "\",\"ph\":\"X\",\"pid\":0,\"tid\":" + std::to_string(iter->second) +
+           ",\"ts\":" + std::to_string(span.start_micros) +
+           ",\"dur\":" + std::to_string(span.end_micros - span.start_micros);
+    if (!span.args.empty()) {
+      ret += ",\"args\":{\"detail\":\"" + Escape(span.args) + "\"}";
+    }
+    ret += "}";
+  }
+  ret += "\n]}\n";
+  return ret;
+}
+
+std::string Profiler::Summary() {
+  std::vector<std::pair<std::string, OpStat>> ops;
+  int64_t steps;
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    ops.assign(op_stats_.begin(), op_stats_.end());
+    steps = steps_;
+  }
+  std::sort(ops.begin(), ops.end(), [](const std::pair<std::string, OpStat>& lhs,
+                                       const std::pair<std::string, OpStat>& rhs) {
+    return lhs.second.total_micros > rhs.second.total_micros;
+  });
+  std::string ret = "profiled steps: " + std::to_string(steps) + "\n";
+  char buf[512];
+  snprintf(buf, sizeof(buf), "%-40s %10s %12s %10s %10s %12s\n", "op", "count",
+           "total(ms)", "avg(us)", "max(us)", "critical(ms)");
+  ret += buf;
+  for (auto&& item : ops) {
+    const OpStat& op = item.second;
+    snprintf(buf, sizeof(buf), "%-40s %10ld %12.3f %10ld %10ld %12.3f\n",
+             item.first.c_str(), (long)op.count, op.total_micros / 1000.0,
+             (long)(op.count == 0 ? 0 : op.total_micros / op.count),
+             (long)op.max_micros, op.critical_micros / 1000.0);
+    ret += buf;
+  }
+  return ret;
+}
+
+std::map<std::string, Profiler::OpStat> Profiler::OpStats() {
+  std::unique_lock<std::mutex> lock(mu_);
+  return op_stats_;
+}
+
+void Profiler::Clear() {
+  std::unique_lock<std::mutex> lock(mu_);
+  steps_ = 0;
+  spans_.clear();
+  op_stats_.clear();
+}
+
+ProfileScope::ProfileScope(const char* category, const char* name)
+  : category_(category), name_(name),
+    start_micros_(Profiler::Get()->Enabled() ? TimeUtils::NowMicros() : -1) {}
+
+ProfileScope::~ProfileScope() {
+  if (start_micros_ >= 0) {
+    Profiler::Get()->AddSpan(category_, name_, start_micros_,
+                             TimeUtils::NowMicros());
+  }
+}
+
+}  // namespace xdl
@@ -0,0 +1,126 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XDL_CORE_FRAMEWORK_PROFILER_H_
+#define XDL_CORE_FRAMEWORK_PROFILER_H_
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "xdl/core/lib/singleton.h"
+#include "xdl/core/proto/perf_stats.pb.h"
+#include "ps-plus/common/tracer.h"
+
+namespace xdl {
+
+struct Graph;
+
+// Profiles a sampled fraction of the steps while the job runs. The sampled
+// steps turn on the executor perf stats, their nodes are aggregated per op
+// and kept, with the spans recorded by AddSpan, for a chrome trace export.
+// Also XDL_PROFILE_SAMPLE_RATE=<rate> starts it with the process.
+// While the ps tracer exports, the sampled steps are also traced to the ps
+// servers: the requests of a node are child spans of its node span.
+class Profiler : public Singleton<Profiler> {
+ public:
+  struct Span {
+    std::string name;
+    std::string category;
+    int64_t start_micros;
+    int64_t end_micros;
+    int64_t thread_id;
+    std::string args;
+  };
+
+  struct OpStat {
+    int64_t count = 0;
+    int64_t total_micros = 0;
+    int64_t max_micros = 0;
+    // time the op spent on the critical path of its step
+    int64_t critical_micros = 0;
+  };
+
+  Profiler();
+
+  // Profiles one step out of 1 / sample_rate, keeps at most max_spans
+  // spans for the trace, the older ones are dropped first.
+  void Start(double sample_rate, size_t max_spans = kDefaultMaxSpans);
+  void Stop();
+  bool Enabled() const { return enabled_; }
+  // Whether the step being launched is profiled.
+  bool Sample();
+
+  // A span which didn't run as a node, like a data io wait, aggregated as
+  // the op "category:name".
+  void AddSpan(const std::string& category, const std::string& name,
+               int64_t start_micros, int64_t end_micros);
+  // Aggregates a profiled step, stats is indexed by the graph node id.
+  void AddStep(const Graph& graph, const proto::PerfStats& stats);
+
+  // Chrome trace event format, loadable by chrome://tracing and perfetto.
+  std::string ChromeTrace();
+  // Per op statistics, the ops taking the most time first.
+  std::string Summary();
+  std::map<std::string, OpStat> OpStats();
+  void Clear();
+
+  // Node ids of the chain of nodes each waiting for the previous one that
+  // ends with the last node to finish, from the first one.
+  static std::vector<int> CriticalPath(const Graph& graph,
+                                       const proto::PerfStats& stats);
+
+  // The span of the node node_id in the traced step.
+  static uint64_t NodeSpanId(const ps::common::TraceContext& step, int node_id);
+  // Exports the step span and the node spans of a traced step to the ps
+  // tracer, stats is indexed by the graph node id.
+  static void ExportTrace(const proto::PerfStats& stats,
+                          const ps::common::TraceContext& step);
+
+  static constexpr size_t kDefaultMaxSpans = 1 << 20;
+
+ private:
+  // with mu_ held
+  void Push(Span&& span);
+
+  std::atomic<bool> enabled_;
+  std::atomic<int64_t> sample_period_;
+  std::atomic<int64_t> step_counter_;
+
+  std::mutex mu_;
+  size_t max_spans_;
+  int64_t steps_;
+  std::deque<Span> spans_;
+  std::map<std::string, OpStat> op_stats_;
+};
+
+// Records the scope as a span while the profiler is on.
+class ProfileScope {
+ public:
+  ProfileScope(const char* category, const char* name);
+  ~ProfileScope();
+
+ private:
+  const char* category_;
+  const char* name_;
+  int64_t start_micros_;
+};
+
+}  // namespace xdl
+
+#endif  // XDL_CORE_FRAMEWORK_PROFILER_H_
@@ -26,9 +26,11 @@ struct ExecutorContext {
 };
 
 struct RunOption {
-  RunOption() : perf(false) {}
-  RunOption(bool perf) : perf(perf) {}
+  RunOption() : perf(false), pipeline(false) {}
+  RunOption(bool perf) : perf(perf), pipeline(false) {}
   bool perf;
+  // Overlaps with the other pipelined runs of the graph, see StepPipeline.
+  bool pipeline;
   ExecutorContext* in_ctx;
   ExecutorContext* out_ctx;
 };
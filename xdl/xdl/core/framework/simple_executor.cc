@@ -15,12 +15,18 @@ limitations under the License.
 
 #include "xdl/core/framework/simple_executor.h"
 
+#include <algorithm>
+#include <map>
+#include <memory>
 #include <thread>
 #include <google/protobuf/text_format.h>
 
 #include "xdl/core/framework/device.h"
 #include "xdl/core/utils/time_utils.h"
 #include "xdl/core/utils/logging.h"
+#ifdef USE_GPU
+#include "xdl/core/framework/gpu/gpu_caching_allocator.h"
+#endif
 
 namespace xdl {
 
@@ -34,6 +40,16 @@ class RefClosure : public RefCounted {
   std::function<void()> done_;
 };
 
+// The outputs of a node converted to a device by one ConvertBatch
+struct PendingConvert {
+  DeviceConverter* converter;
+  std::vector<int> output_ids;
+  std::vector<Tensor> src;
+  std::vector<Tensor> dst;
+  // the (node_id, input_id) set by each of dst
+  std::vector<std::vector<std::pair<int, int>>> inputs;
+};
+
 }  // namespace
 
 void SimpleExecutor::Run(Graph* graph, 
@@ -58,9 +74,11 @@ void SimpleExecutor::Run() {
     return;
   }
   running_counter_ = 1;
+  std::vector<int> ready;
   for (auto item : graph_->nodes[Graph::kSource].outputs) {
-    Launch(item.node_id);
+    ready.push_back(item.node_id);
   }
+  LaunchReady(&ready);
   DecreaseRunningCounter();
 }
 
@@ -79,10 +97,41 @@ Status SimpleExecutor::InitImpl() {
   return Status::Ok();
 }
 
+void SimpleExecutor::LaunchReady(std::vector<int>* ready) {
+  std::sort(ready->begin(), ready->end(), [this](int lhs, int rhs) {
+    return graph_->nodes[lhs].priority < graph_->nodes[rhs].priority;
+  });
+  // A pool thread pops its own queue last in first out, so the longest
+  // path is scheduled last, and cheap kernels run here once the others
+  // can be stolen by idle threads.
+  for (int node_id : *ready) {
+    if (!graph_->nodes[node_id].inline_run) {
+      Launch(node_id);
+    }
+  }
+  for (auto iter = ready->rbegin(); iter != ready->rend(); ++iter) {
+    if (graph_->nodes[*iter].inline_run) {
+      Launch(*iter);
+    }
+  }
+}
+
 void SimpleExecutor::Launch(int node_id) {
   if (node_id == Graph::kSink) {
     return;
   }
+  if (pipeline_ == nullptr) {
+    LaunchNow(node_id);
+    return;
+  }
+  running_counter_++;
+  pipeline_->Enter(step_, node_id, [this, node_id] {
+    LaunchNow(node_id);
+    DecreaseRunningCounter();
+  });
+}
+
+void SimpleExecutor::LaunchNow(int node_id) {
   if (!failed_) {
     CheckStatus(CheckInputs(node_id, input_[node_id]));
   }
@@ -97,12 +146,24 @@ void SimpleExecutor::Launch(int node_id) {
       [this, node_id, ctx](Status st){LaunchDone(node_id, ctx, st);});
   ctx->SetRunDone(
       [this, node_id, ctx](Status st){RunDone(node_id, ctx, st);});
+  if (trace_.Traced()) {
+    ctx->SetTraceContext(ps::common::TraceContext(
+        trace_.trace_id, Profiler::NodeSpanId(trace_, node_id)));
+  }
 
   if (IsPerfOn()) {
     PerfSetNodeStart(node_id);
     PerfSetNameAndOp(node_id);
   }
 
+  // chains of inline kernels are cut to keep the stack bounded
+  thread_local int inline_depth = 0;
+  if (graph_->nodes[node_id].inline_run && inline_depth < kMaxInlineDepth) {
+    inline_depth++;
+    graph_->nodes[node_id].op->Launch(ctx);
+    inline_depth--;
+    return;
+  }
   graph_->nodes[node_id].arg.device->ScheduleToRun(
       thread_pool_, graph_->nodes[node_id].op.get(), ctx);
 }
@@ -114,9 +175,12 @@ void SimpleExecutor::LaunchDone(int node_id, OpKernelContext* ctx, Status st) {
     CheckStatus(CheckOutputs(node_id, outputs));
   }
   if (!failed_) {
+    std::vector<int> ready;
     for (auto&& item : graph_->nodes[node_id].outputs) {
       if (item.input_id == Node::kDependency) {
-        UnRef(item.node_id);
+        if (--ref_[item.node_id] == 0) {
+          ready.push_back(item.node_id);
+        }
         continue;
       }
       // Process on RunDone
@@ -130,14 +194,20 @@ void SimpleExecutor::LaunchDone(int node_id, OpKernelContext* ctx, Status st) {
         continue;
       }
       input_[item.node_id][item.input_id] = outputs[item.output_id];
-      UnRef(item.node_id);
+      if (--ref_[item.node_id] == 0) {
+        ready.push_back(item.node_id);
+      }
     }
+    LaunchReady(&ready);
   }
   DecreaseRunningCounter();
   ctx->UnRef();
 }
 
 void SimpleExecutor::RunDone(int node_id, OpKernelContext* ctx, Status st) {
+  if (pipeline_ != nullptr) {
+    pipeline_->Leave(step_, node_id);
+  }
   CheckStatus(st);
   auto& outputs = ctx->GetOutputs();
   if (!failed_) {
@@ -148,38 +218,63 @@ void SimpleExecutor::RunDone(int node_id, OpKernelContext* ctx, Status st) {
     ctx->UnRef();
   });
   if (!failed_) {
+    // the outputs sent to another device are converted by a batch per
+    // device, an output read by several nodes there is converted once
+    Device* src_device = graph_->nodes[node_id].arg.device;
+    std::map<Device*, std::shared_ptr<PendingConvert>> converts;
     for (auto&& item : graph_->nodes[node_id].outputs) {
       // Process on LaunchDone
-      Device* src_device = graph_->nodes[node_id].arg.device;
       Device* dst_device = graph_->nodes[item.node_id].arg.device;
       const std::vector<Device*>& input_devices = graph_->nodes[item.node_id].arg.input_devices;
       if (item.input_id < input_devices.size() && input_devices[item.input_id] != nullptr) {
         dst_device = input_devices[item.input_id];
       }
-      if (src_device == dst_device) {
+      if (src_device == dst_device || item.input_id == Node::kDependency) {
         continue;
       }
-      if (item.input_id != Node::kDependency) {
+      std::shared_ptr<PendingConvert>& convert = converts[dst_device];
+      if (convert == nullptr) {
         auto iter = graph_->device_converter.find(
-            std::pair<Device*, Device*>(
-            graph_->nodes[node_id].arg.device,
-            graph_->nodes[item.node_id].arg.device));
+            std::pair<Device*, Device*>(src_device, dst_device));
         if (iter == graph_->device_converter.end()) {
           Fail(Status::Internal("Internal Error, Device Converter Error"));
-        } else {
-          closure->Ref();
-          int node_id = item.node_id;
-          iter->second->Convert(
-              src_device, dst_device,
-              outputs[item.output_id], &input_[item.node_id][item.input_id],
-              ThreadPool::Global(),
-              [closure, this, node_id] (Status st) {
-                CheckStatus(st);
-                UnRef(node_id);
-                closure->UnRef();
-              });
+          converts.erase(dst_device);
+          continue;
         }
+        convert = std::make_shared<PendingConvert>();
+        convert->converter = iter->second;
+      }
+      size_t index = std::find(convert->output_ids.begin(), convert->output_ids.end(),
+                             item.output_id) - convert->output_ids.begin();
+      if (index == convert->output_ids.size()) {
+        convert->output_ids.push_back(item.output_id);
+        convert->src.push_back(outputs[item.output_id]);
+        convert->inputs.emplace_back();
       }
+      convert->inputs[index].emplace_back(item.node_id, item.input_id);
+    }
+    for (auto&& item : converts) {
+      closure->Ref();
+      std::shared_ptr<PendingConvert> convert = item.second;
+      convert->converter->ConvertBatch(
+          src_device, item.first, convert->src, &convert->dst,
+          ThreadPool::Global(),
+          [closure, this, convert] (Status st) {
+            CheckStatus(st);
+            // a node may read several of the batch, all are set before
+            // it is launched
+            for (size_t i = 0; i < convert->inputs.size(); i++) {
+              for (auto&& input : convert->inputs[i]) {
+                input_[input.first][input.second] = convert->dst[i];
+              }
+            }
+            for (auto&& inputs : convert->inputs) {
+              for (auto&& input : inputs) {
+                UnRef(input.first);
+              }
+            }
+            closure->UnRef();
+          });
     }
   }
   
@@ -254,14 +349,29 @@ void SimpleExecutor::DecreaseRunningCounter() {
 }
 
 void SimpleExecutor::Done() {
+  if (pipeline_ != nullptr) {
+    pipeline_->Finish(step_);
+  }
+  if (graph_->memory_plan != nullptr) {
+    graph_->memory_plan->StepDone(status_.IsOk());
+  }
+#ifdef USE_GPU
+  GpuCachingAllocator::StepDone();
+#endif
   for (auto&& item : done_handler_) {
     item(status_);
   }
   if (status_.IsOk()) {
+    if (profile_) {
+      Profiler::Get()->AddStep(*graph_, perf_stats_);
+    }
+    if (trace_.Traced()) {
+      Profiler::ExportTrace(perf_stats_, trace_);
+    }
     ExtraInfo info = ExtraInfo();
-    std::string perf_info;
-    google::protobuf::TextFormat::PrintToString(perf_stats_, &perf_info);
-    if (IsPerfOn()) {
+    if (run_option_.perf) {
+      std::string perf_info;
+      google::protobuf::TextFormat::PrintToString(perf_stats_, &perf_info);
       info["PERF_RESULT"] = perf_info;
     }
     done_(status_, input_[Graph::kSink], info);
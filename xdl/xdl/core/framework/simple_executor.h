@@ -23,6 +23,7 @@ limitations under the License.
 #include "xdl/core/framework/graph.h"
 #include "xdl/core/framework/device.h"
 #include "xdl/core/framework/tensor.h"
+#include "xdl/core/framework/profiler.h"
 #include "xdl/core/proto/perf_stats.pb.h"
 #include "xdl/core/lib/any.h"
 #include "xdl/core/framework/run_option.h"
@@ -47,12 +48,25 @@ class SimpleExecutor {
     return run_option_;
   }
 
+  MemoryPlan* GetMemoryPlan() {
+    return graph_->memory_plan.get();
+  }
+
  private:
+  static constexpr int kMaxInlineDepth = 16;
+
   explicit SimpleExecutor(Graph* graph, const RunOption& run_option, 
                           Callback done, ThreadPool* thread_pool)
     : graph_(graph), run_option_(run_option), 
-      done_(done), thread_pool_(thread_pool) {
-    if (run_option_.perf) {
+      done_(done), thread_pool_(thread_pool),
+      pipeline_(run_option.pipeline ? graph->pipeline.get() : nullptr),
+      step_(pipeline_ != nullptr ? pipeline_->Begin() : 0),
+      profile_(Profiler::Get()->Sample()) {
+    if (profile_ && ps::common::Tracer::Instance()->Enabled()) {
+      trace_ = ps::common::TraceContext(ps::common::Tracer::NewId(),
+                                        ps::common::Tracer::NewId());
+    }
+    if (IsPerfOn()) {
       while (perf_stats_.node_stats_size() < graph_->nodes.size() + 1) {
         perf_stats_.add_node_stats();        
       }
@@ -62,7 +76,10 @@ class SimpleExecutor {
   void Run();
   void Init();
   Status InitImpl();
+  // Launches the nodes by priority, see Node::priority.
+  void LaunchReady(std::vector<int>* ready);
   void Launch(int node_id);
+  void LaunchNow(int node_id);
   void LaunchDone(int node_id, OpKernelContext* ctx, Status st);
   void RunDone(int node_id, OpKernelContext* ctx, Status st);
   Status CheckInputs(int node_id, const std::vector<Tensor>& inputs);
@@ -74,7 +91,7 @@ class SimpleExecutor {
   void Done();
 
   inline bool IsPerfOn() {
-    return run_option_.perf;
+    return run_option_.perf || profile_;
   }
 
   void PerfSetNodeStart(int node_id);
@@ -86,6 +103,12 @@ class SimpleExecutor {
   RunOption run_option_;
   Callback done_;
   ThreadPool* thread_pool_;
+  StepPipeline* pipeline_;
+  int64_t step_;
+  // sampled by the Profiler
+  bool profile_;
+  // the step span of a profiled step while the tracer exports
+  ps::common::TraceContext trace_;
 
   std::vector<std::vector<Tensor>> input_;
   std::unique_ptr<std::atomic<int>[]> ref_;
@@ -0,0 +1,89 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/core/framework/step_pipeline.h"
+
+#include <algorithm>
+
+namespace xdl {
+
+StepPipeline::StepPipeline(size_t node_size)
+  : next_step_(0), done_(node_size, -1), node_size_(node_size) {}
+
+int64_t StepPipeline::Begin() {
+  std::unique_lock<std::mutex> lock(mu_);
+  return next_step_++;
+}
+
+void StepPipeline::Enter(int64_t step, int node_id, const std::function<void()>& launch) {
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    if (done_[node_id] < step - 1) {
+      waiting_[step * node_size_ + node_id] = launch;
+      return;
+    }
+  }
+  launch();
+}
+
+void StepPipeline::Leave(int64_t step, int node_id) {
+  std::vector<std::function<void()>> launches;
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    Release(step, node_id, &launches);
+  }
+  for (auto& launch : launches) {
+    launch();
+  }
+}
+
+void StepPipeline::Finish(int64_t step) {
+  std::vector<std::function<void()>> launches;
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    for (size_t i = 0; i < node_size_; i++) {
+      Release(step, i, &launches);
+    }
+  }
+  for (auto& launch : launches) {
+    launch();
+  }
+}
+
+void StepPipeline::Release(int64_t step, int node_id,
+                           std::vector<std::function<void()>>* launches) {
+  if (done_[node_id] >= step) {
+    return;
+  }
+  // a finished step may skip the node while the step before still runs it
+  if (done_[node_id] < step - 1) {
+    finished_.insert(step * node_size_ + node_id);
+    return;
+  }
+  while (true) {
+    done_[node_id] = step;
+    auto iter = waiting_.find((step + 1) * node_size_ + node_id);
+    if (iter != waiting_.end()) {
+      launches->push_back(std::move(iter->second));
+      waiting_.erase(iter);
+    }
+    if (finished_.erase((step + 1) * node_size_ + node_id) == 0) {
+      break;
+    }
+    step++;
+  }
+}
+
+}  // namespace xdl
@@ -0,0 +1,57 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XDL_CORE_FRAMEWORK_STEP_PIPELINE_H_
+#define XDL_CORE_FRAMEWORK_STEP_PIPELINE_H_
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace xdl {
+
+// Orders the pipelined runs of one graph. Steps are numbered as they
+// begin and a node of step N only launches once the same node of step N-1
+// is done, so the pulls of step N+1 overlap the backward of step N while
+// every kernel still sees its steps one at a time and in order. Pulls may
+// thus read parameters up to depth - 1 pushes old.
+class StepPipeline {
+ public:
+  explicit StepPipeline(size_t node_size);
+  int64_t Begin();
+  // Runs launch once the previous step is done with node_id.
+  void Enter(int64_t step, int node_id, const std::function<void()>& launch);
+  void Leave(int64_t step, int node_id);
+  // Every node of step counts as done, for the ones a failure skipped.
+  void Finish(int64_t step);
+
+ private:
+  void Release(int64_t step, int node_id, std::vector<std::function<void()>>* launches);
+
+  std::mutex mu_;
+  int64_t next_step_;
+  std::vector<int64_t> done_;
+  // (node_id, step) to the launch waiting for the step before
+  std::unordered_map<int64_t, std::function<void()>> waiting_;
+  // (node_id, step) of finished steps that are not done with the node yet
+  std::unordered_set<int64_t> finished_;
+  size_t node_size_;
+};
+
+}  // namespace xdl
+
+#endif  // XDL_CORE_FRAMEWORK_STEP_PIPELINE_H_
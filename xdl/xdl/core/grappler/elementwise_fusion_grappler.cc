@@ -0,0 +1,213 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "xdl/core/framework/grappler.h"
+#include "xdl/core/ops/fused_elementwise_op.h"
+
+namespace xdl {
+
+namespace {
+
+std::string NodeName(const std::string& input) {
+  if (!input.empty() && input[0] == '^') {
+    return input.substr(1);
+  }
+  return input.substr(0, input.find(':'));
+}
+
+bool IsControl(const std::string& input) {
+  return !input.empty() && input[0] == '^';
+}
+
+// Fuses the trees of the float elementwise ops into FusedElementwise ops, a
+// producer is fused into its consumer if the consumer is its only reader.
+// The fused op keeps the name of the root, so its readers are unchanged.
+class ElementwiseFusionExecutor {
+ public:
+  ElementwiseFusionExecutor(GraphDef* graph, OutputSpec* output)
+    : graph_(graph), output_(output) {}
+  Status Run() {
+    Index();
+    std::vector<NodeDef*> roots;
+    for (auto&& node : graph_->node) {
+      if (Fusable(node) && !IsInterior(node)) {
+        roots.push_back(&node);
+      }
+    }
+    for (auto root : roots) {
+      Fuse(root);
+    }
+    if (removed_.empty()) {
+      return Status::Ok();
+    }
+    std::vector<NodeDef> nodes;
+    for (auto&& node : graph_->node) {
+      if (removed_.find(node.name) == removed_.end()) {
+        nodes.push_back(std::move(node));
+      }
+    }
+    graph_->node = std::move(nodes);
+    return Status::Ok();
+  }
+
+ private:
+  void Index() {
+    for (auto&& node : graph_->node) {
+      node_def_[node.name] = &node;
+    }
+    for (auto&& node : graph_->node) {
+      for (auto&& input : node.input) {
+        if (IsControl(input)) {
+          pinned_.insert(NodeName(input));
+        } else {
+          readers_[NodeName(input)].push_back(&node);
+        }
+      }
+    }
+    for (auto&& name : output_->output) {
+      pinned_.insert(NodeName(name));
+    }
+  }
+
+  static bool Fusable(const NodeDef& node) {
+    FusedElementwiseCode code;
+    if (!FusedElementwiseCodeOf(node.op, &code)) {
+      return false;
+    }
+    auto dtype = node.attr.find("dtype");
+    if (dtype == node.attr.end() ||
+        (dtype->second.type != DataType::kFloat &&
+         dtype->second.type != DataType::kDouble)) {
+      return false;
+    }
+    size_t inputs = 0;
+    for (auto&& input : node.input) {
+      inputs += IsControl(input) ? 0 : 1;
+    }
+    return inputs == static_cast<size_t>(FusedElementwiseArity(code));
+  }
+
+  // Whether producer is read by consumer only, so it may be fused into it
+  bool Absorbable(const NodeDef& producer, const NodeDef& consumer) {
+    if (!Fusable(producer) || !Fusable(consumer) ||
+        pinned_.find(producer.name) != pinned_.end() ||
+        producer.device.device_name != consumer.device.device_name ||
+        producer.device.attr != consumer.device.attr ||
+        producer.attr.at("dtype").type != consumer.attr.at("dtype").type) {
+      return false;
+    }
+    const std::vector<NodeDef*>& readers = readers_[producer.name];
+    return readers.size() == 1 && readers[0] == &consumer;
+  }
+
+  bool IsInterior(const NodeDef& node) {
+    const std::vector<NodeDef*>& readers = readers_[node.name];
+    return readers.size() == 1 && Absorbable(node, *readers[0]);
+  }
+
+  // Appends the program of the tree of node in postfix order
+  void Emit(const NodeDef& node, std::string* program,
+            std::vector<std::string>* leaves,
+            std::vector<std::string>* controls,
+            std::vector<const NodeDef*>* members) {
+    for (auto&& input : node.input) {
+      if (IsControl(input)) {
+        controls->push_back(input);
+        continue;
+      }
+      auto iter = node_def_.find(NodeName(input));
+      if (iter != node_def_.end() && input == iter->first + ":0" &&
+          Absorbable(*iter->second, node)) {
+        Emit(*iter->second, program, leaves, controls, members);
+        members->push_back(iter->second);
+        continue;
+      }
+      size_t i = 0;
+      while (i < leaves->size() && (*leaves)[i] != input) i++;
+      if (i == leaves->size()) {
+        leaves->push_back(input);
+      }
+      *program += "$" + std::to_string(i) + " ";
+      tokens_++;
+    }
+    *program += node.op + " ";
+    tokens_++;
+  }
+
+  void Fuse(NodeDef* root) {
+    std::string program;
+    std::vector<std::string> leaves, controls;
+    std::vector<const NodeDef*> members;
+    tokens_ = 0;
+    Emit(*root, &program, &leaves, &controls, &members);
+    if (members.empty() || tokens_ > kFusedMaxOps ||
+        leaves.size() > kFusedMaxInputs) {
+      return;
+    }
+    program.pop_back();
+    for (auto member : members) {
+      removed_.insert(member->name);
+    }
+    std::unordered_set<std::string> seen;
+    root->input = leaves;
+    for (auto&& control : controls) {
+      if (seen.insert(control).second) {
+        root->input.push_back(control);
+      }
+    }
+    root->op = "FusedElementwise";
+    root->input_dev_descs.clear();
+    root->attr["size"].attr_type = AttrValue::kInt;
+    root->attr["size"].i = leaves.size();
+    root->attr["program"].attr_type = AttrValue::kString;
+    root->attr["program"].s = program;
+  }
+
+  GraphDef* graph_;
+  OutputSpec* output_;
+  std::unordered_map<std::string, NodeDef*> node_def_;
+  std::unordered_map<std::string, std::vector<NodeDef*>> readers_;
+  // the nodes read by a control input or an output
+  std::unordered_set<std::string> pinned_;
+  std::unordered_set<std::string> removed_;
+  int tokens_;
+};
+
+}  // namespace
+
+// Runs after the optimize grappler, so the chains are deduplicated first.
+// XDL_ELEMENTWISE_FUSION=0 turns it off.
+class ElementwiseFusionGrappler : public Grappler {
+ public:
+  Status Process(GraphDef* graph, OutputSpec* output) override {
+    const char* env = getenv("XDL_ELEMENTWISE_FUSION");
+    if (env != nullptr && std::string(env) == "0") {
+      return Status::Ok();
+    }
+    ElementwiseFusionExecutor executor(graph, output);
+    XDL_CHECK_STATUS(executor.Run());
+    return Status::Ok();
+  }
+};
+
+}  // namespace xdl
+
+XDL_REGISTER_GRAPPLER(7000, xdl::ElementwiseFusionGrappler);
@@ -170,8 +170,55 @@ Status HashPullFusionWorker::FuseImpl(
   SetAttrValue<std::string>(node, "var_name", "hash_variable");
   SetAttrValue<std::string>(node, "var_names", var_name_str);
   SetAttrValue<int>(node, "output_size", input_type_0.size());
+
+  std::string pull_ahead_ds;
+  std::string pull_ahead_ids;
+  XDL_CHECK_STATUS(
+      PullAheadSource(input_0, &pull_ahead_ds, &pull_ahead_ids));
+  SetAttrValue<std::string>(node, "pull_ahead_ds", pull_ahead_ds);
+  SetAttrValue<std::string>(node, "pull_ahead_ids", pull_ahead_ids);
   node->device.device_name = "CPU";
   return Status::Ok();
 }
 
+Status HashPullFusionWorker::PullAheadSource(
+    const std::vector<std::string>& ids_inputs,
+    std::string* ds,
+    std::string* features) {
+  // The fused pull can fetch the next step's embeddings ahead of time
+  // only when all of its ids come straight out of one GetBatch.
+  ds->clear();
+  features->clear();
+  NodeDef* source = nullptr;
+  std::string feature_str;
+  for (auto& input: ids_inputs) {
+    NodeDef* in_node;
+    XDL_CHECK_STATUS(GetNodeByName(input, &in_node));
+    if (in_node->op != "GetBatch" || (source != nullptr && source != in_node)) {
+      return Status::Ok();
+    }
+    source = in_node;
+    int indicator_count, sparse_count;
+    XDL_CHECK_STATUS(
+        GetAttrValue<int>(source, "indicator_count", &indicator_count));
+    XDL_CHECK_STATUS(
+        GetAttrValue<int>(source, "sparse_count", &sparse_count));
+    // outputs are indicators, indices and then ids
+    int feature = atoi(input.substr(input.find(':') + 1).c_str()) -
+                  indicator_count - sparse_count;
+    if (feature < 0 || feature >= sparse_count) {
+      return Status::Ok();
+    }
+    feature_str += std::to_string(feature) + ",";
+  }
+
+  if (source == nullptr) {
+    return Status::Ok();
+  }
+  XDL_CHECK_STATUS(GetAttrValue<std::string>(source, "ds", ds));
+  feature_str.pop_back();
+  *features = feature_str;
+  return Status::Ok();
+}
+
 } //namespace xdl
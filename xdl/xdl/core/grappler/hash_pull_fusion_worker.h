@@ -51,6 +51,10 @@ class HashPullFusionWorker: public FusionWorker {
       DataType otype,
       const std::set<NodeDef*>& cluster,
       NodeDef* fused_node);
+  Status PullAheadSource(
+      const std::vector<std::string>& ids_inputs,
+      std::string* ds,
+      std::string* features);
 };
 
 } //namespace XDL_CORE_GRAPPLER_PS_FUSION_WORKER
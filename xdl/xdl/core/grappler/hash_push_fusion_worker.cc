@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "xdl/core/grappler/hash_push_fusion_worker.h"
 
+#include <algorithm>
+#include <cstdlib>
+
 namespace xdl {
 
 Status HashPushFusionWorker::Process(
@@ -39,6 +42,9 @@ Status HashPushFusionWorker::PostCluster(
     const std::vector<std::set<NodeDef*> >& clusters,
     std::vector<std::set<NodeDef*> >* sub_clusters) {
   int cluster_id = 0;
+  // mixed fusion needs the SelectSlices udf on the servers
+  const char* mixed = getenv("XDL_MIXED_PUSH_FUSION");
+  bool mix_ops = mixed != nullptr && std::string(mixed) == "1";
   std::vector<std::set<NodeDef*> > tmp;
   for (auto& cluster: clusters) {
     std::map<std::pair<int, std::string>, int> type_2_cluster_id;
@@ -46,7 +52,7 @@ Status HashPushFusionWorker::PostCluster(
       DataType itype;
       XDL_CHECK_STATUS(
           GetAttrValue<DataType>(node, "dtype", &itype)); 
-      std::pair<int, std::string> type = std::make_pair(itype, node->op);
+      std::pair<int, std::string> type = std::make_pair(itype, mix_ops ? "" : node->op);
       auto it = type_2_cluster_id.find(type);
       if (it != type_2_cluster_id.end()) {
         tmp[it->second].insert(node);
@@ -77,7 +83,15 @@ Status HashPushFusionWorker::PostCluster(
 Status HashPushFusionWorker::DoFusion(
     const std::vector<std::set<NodeDef*> >& clusters) {
   for (auto& cluster: clusters) {
-    XDL_CHECK_STATUS(FuseOneCluster(cluster));
+    bool same_op = true;
+    for (auto& item: cluster) {
+      same_op = same_op && item->op == (*cluster.begin())->op;
+    }
+    if (same_op) {
+      XDL_CHECK_STATUS(FuseOneCluster(cluster));
+    } else {
+      XDL_CHECK_STATUS(FuseMixedCluster(cluster));
+    }
   }
 
   return Status::Ok();
@@ -114,23 +128,31 @@ namespace {
 struct FusionStrategy {
   std::string op;
   std::vector<DataType> input_types;
+  std::string updater;
+  // the hyperparameter inputs in the order the updater takes them
+  std::vector<size_t> args;
 };
 
 const std::unordered_map<std::string, FusionStrategy> kFusionStrategies = {
   {"PsSparseApplyAdagradOp", {.op="PsSparseApplyAdagradMergedOp",
-   .input_types={DataType::kDouble, DataType::kDouble, DataType::kFloat}}},
+   .input_types={DataType::kDouble, DataType::kDouble, DataType::kFloat},
+   .updater="AdagradUpdater", .args={0, 1}}},
   {"PsSparseApplyAdamOp", {.op="PsSparseApplyAdamMergedOp",
    .input_types={DataType::kDouble, DataType::kDouble, DataType::kDouble,
-                 DataType::kDouble, DataType::kBool, DataType::kFloat}}},
+                 DataType::kDouble, DataType::kBool, DataType::kFloat},
+   .updater="AdamUpdater", .args={3, 2, 0, 1, 4}}},
   {"PsSparseApplyFtrlOp", {.op="PsSparseApplyFtrlMergedOp",
    .input_types={DataType::kDouble, DataType::kDouble, DataType::kDouble,
-                 DataType::kDouble, DataType::kDouble, DataType::kFloat}}},
+                 DataType::kDouble, DataType::kDouble, DataType::kFloat},
+   .updater="FtrlUpdater", .args={0, 1, 2, 3, 4}}},
   {"PsSparseApplyMomentumOp", {.op="PsSparseApplyMomentumMergedOp",
    .input_types={DataType::kDouble, DataType::kDouble,
-                 DataType::kBool, DataType::kFloat}}},
+                 DataType::kBool, DataType::kFloat},
+   .updater="MomentumUpdater", .args={0, 1, 2}}},
   {"PsSparseApplyRmspropOp", {.op="PsSparseApplyRmspropMergedOp",
    .input_types={DataType::kDouble, DataType::kDouble, DataType::kDouble,
-                 DataType::kDouble, DataType::kFloat}}}
+                 DataType::kDouble, DataType::kFloat},
+   .updater="RmspropUpdater", .args={0, 1, 2, 3}}}
 };
 }
 
@@ -195,4 +217,87 @@ Status HashPushFusionWorker::FuseImpl(
   return Status::Ok();
 }
 
+Status HashPushFusionWorker::FuseMixedCluster(
+    const std::set<NodeDef*>& cluster) {
+  std::map<std::string, std::vector<NodeDef*>> groups;
+  for (auto& item: cluster) {
+    groups[item->op].push_back(item);
+  }
+  NodeDef node;
+  if (id_ == 0) {
+    node.name = "PsSparseApplyMixedMergedOp";
+  } else {
+    node.name = "PsSparseApplyMixedMergedOp_" + std::to_string(id_);
+  }
+  id_++;
+  node.op = "PsSparseApplyMixedMergedOp";
+
+  std::vector<DataType> hyper_types, grad_types, index_types;
+  std::vector<std::string> hypers, grads, indices, dependencies;
+  std::string var_names, updaters, group_sizes, group_args;
+  for (auto& group: groups) {
+    auto iter = kFusionStrategies.find(group.first);
+    if (iter == kFusionStrategies.end()) {
+      return Status::ArgumentError("Fused op_name " + group.first + " unsupported");
+    }
+    const FusionStrategy& strategy = iter->second;
+    std::vector<NodeDef*>& items = group.second;
+    std::sort(items.begin(), items.end(), [](NodeDef* x, NodeDef* y) { return x->name < y->name; });
+    std::vector<std::vector<std::string>> inputs;
+    for (auto& item: items) {
+      inputs.emplace_back();
+      for (auto& input : item->input) {
+        if (input.size() > 0 && input[0] == '^') {
+          dependencies.push_back(input);
+        } else {
+          inputs.back().push_back(input);
+        }
+      }
+      XDL_CHECK_COND(inputs.back().size() == strategy.input_types.size() + 1,
+                     Status::ArgumentError(item->name + " Input Error, not a " + group.first));
+      std::string var_name;
+      XDL_CHECK_STATUS(GetAttrValue<std::string>(item, "var_name", &var_name));
+      var_names += var_name + ",";
+      DataType itype;
+      XDL_CHECK_STATUS(GetAttrValue<DataType>(item, "dtype", &itype));
+      size_t grad = strategy.input_types.size() - 1;
+      grads.push_back(inputs.back()[grad]);
+      grad_types.push_back(strategy.input_types[grad]);
+      indices.push_back(inputs.back()[grad + 1]);
+      index_types.push_back(itype);
+      MarkRenameInput("^" + item->name, "^" + node.name);
+    }
+    for (auto arg: strategy.args) {
+      for (auto& input: inputs) {
+        hypers.push_back(input[arg]);
+        hyper_types.push_back(strategy.input_types[arg]);
+      }
+    }
+    updaters += strategy.updater + ",";
+    group_sizes += std::to_string(items.size()) + ",";
+    group_args += std::to_string(strategy.args.size()) + ",";
+  }
+  var_names.pop_back();
+  updaters.pop_back();
+  group_sizes.pop_back();
+  group_args.pop_back();
+
+  node.input.insert(node.input.end(), hypers.begin(), hypers.end());
+  node.input.insert(node.input.end(), grads.begin(), grads.end());
+  node.input.insert(node.input.end(), indices.begin(), indices.end());
+  node.input.insert(node.input.end(), dependencies.begin(), dependencies.end());
+  SetAttrValue<std::vector<DataType>>(&node, "input_type_0", hyper_types);
+  SetAttrValue<std::vector<DataType>>(&node, "input_type_1", grad_types);
+  SetAttrValue<std::vector<DataType>>(&node, "input_type_2", index_types);
+  SetAttrValue<std::string>(&node, "var_type", "hash");
+  SetAttrValue<std::string>(&node, "var_name", "hash_variable");
+  SetAttrValue<std::string>(&node, "var_names", var_names);
+  SetAttrValue<std::string>(&node, "updaters", updaters);
+  SetAttrValue<std::string>(&node, "group_sizes", group_sizes);
+  SetAttrValue<std::string>(&node, "group_args", group_args);
+  node.device.device_name = "CPU";
+  XDL_CHECK_STATUS(MarkDeleteNode(cluster, node));
+  return Status::Ok();
+}
+
 } //namespace xdl
@@ -51,6 +51,10 @@ class HashPushFusionWorker: public FusionWorker {
       const std::vector<std::set<NodeDef*> >& clusters);
   Status FuseOneCluster(
       const std::set<NodeDef*>& clusters);
+  // Fuses the sparse applies of different optimizers into one
+  // PsSparseApplyMixedMergedOp, enabled by XDL_MIXED_PUSH_FUSION=1.
+  Status FuseMixedCluster(
+      const std::set<NodeDef*>& cluster);
   Status FuseImpl(
       const std::string& var_name_str,
 	  const std::string& op_name,
@@ -0,0 +1,363 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "xdl/core/framework/grappler.h"
+
+namespace xdl {
+
+namespace {
+
+// Ops without side effects, two of them with the same inputs and attrs
+// give the same outputs.
+const std::unordered_set<std::string> kPureOps = {
+  "_Constant", "ShapeOp", "Reshape", "IdentityOp", "ExpandDims", "Concat",
+  "Split", "Stack", "Tile", "TakeOp", "KSum", "Unique", "Zeros",
+  "MfeatureToHash64"
+};
+
+std::string NodeName(const std::string& input) {
+  if (!input.empty() && input[0] == '^') {
+    return input.substr(1);
+  }
+  return input.substr(0, input.find(':'));
+}
+
+bool IsControl(const std::string& input) {
+  return !input.empty() && input[0] == '^';
+}
+
+std::string AttrKey(const AttrValue& value) {
+  std::string key = std::to_string(value.attr_type) + "|";
+  switch (value.attr_type) {
+   case AttrValue::kString: key += value.s; break;
+   case AttrValue::kInt: key += std::to_string(value.i); break;
+   case AttrValue::kFloat: key += std::to_string(value.f); break;
+   case AttrValue::kBool: key += value.b ? "1" : "0"; break;
+   case AttrValue::kDataType: key += std::to_string(value.type); break;
+   case AttrValue::kTensorShape:
+    for (auto dim : value.shape.Dims()) {
+      key += std::to_string(dim) + ",";
+    }
+    break;
+   case AttrValue::kDataTypeList:
+    for (auto type : value.type_list) {
+      key += std::to_string(type) + ",";
+    }
+    break;
+   default: break;
+  }
+  return key;
+}
+
+// Folds constant subgraphs in place, merges duplicated pure nodes and
+// collapses identity/reshape chains, then drops what no output needs.
+class OptimizeExecutor {
+ public:
+  OptimizeExecutor(GraphDef* graph, OutputSpec* output)
+    : graph_(graph), output_(output) {}
+  Status Run() {
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      Index();
+      changed |= FoldConstants();
+      changed |= CollapseChains();
+      Index();
+      changed |= EliminateCommon();
+    }
+    Index();
+    XDL_CHECK_STATUS(Prune());
+    return Status::Ok();
+  }
+
+ private:
+  void Index() {
+    node_def_.clear();
+    for (auto&& item : graph_->node) {
+      node_def_[item.name] = &item;
+    }
+  }
+
+  NodeDef* Producer(const std::string& input) {
+    auto iter = node_def_.find(NodeName(input));
+    return iter == node_def_.end() ? nullptr : iter->second;
+  }
+
+  bool IsConstant(const std::string& input) {
+    NodeDef* node = Producer(input);
+    return node != nullptr && node->op == "_Constant";
+  }
+
+  static const AttrValue* Attr(const NodeDef& node, const std::string& name) {
+    auto iter = node.attr.find(name);
+    return iter == node.attr.end() ? nullptr : &iter->second;
+  }
+
+  // Turns node into a constant, its control inputs still order it.
+  static void SetConstant(NodeDef* node, DataType type,
+                          const TensorShape& shape, const std::string& value) {
+    std::vector<std::string> controls;
+    for (auto&& input : node->input) {
+      if (IsControl(input)) {
+        controls.push_back(input);
+      }
+    }
+    node->op = "_Constant";
+    node->input = std::move(controls);
+    node->input_dev_descs.clear();
+    node->attr.clear();
+    node->attr["dtype"].attr_type = AttrValue::kDataType;
+    node->attr["dtype"].type = type;
+    node->attr["shape"].attr_type = AttrValue::kTensorShape;
+    node->attr["shape"].shape = shape;
+    node->attr["value"].attr_type = AttrValue::kString;
+    node->attr["value"].s = value;
+    node->output_type = {type};
+  }
+
+  bool FoldConstants() {
+    bool changed = false;
+    for (auto&& node : graph_->node) {
+      if (node.input.empty() || IsControl(node.input[0]) ||
+          !IsConstant(node.input[0])) {
+        continue;
+      }
+      const NodeDef& src = *Producer(node.input[0]);
+      const AttrValue* src_shape = Attr(src, "shape");
+      const AttrValue* src_type = Attr(src, "dtype");
+      const AttrValue* src_value = Attr(src, "value");
+      if (src_shape == nullptr || src_type == nullptr || src_value == nullptr) {
+        continue;
+      }
+      if (node.op == "ShapeOp") {
+        std::vector<int64_t> dims(src_shape->shape.Dims().begin(),
+                                  src_shape->shape.Dims().end());
+        std::string value(reinterpret_cast<const char*>(dims.data()),
+                          dims.size() * sizeof(int64_t));
+        SetConstant(&node, DataType::kInt64, TensorShape({dims.size()}), value);
+        changed = true;
+      } else if (node.op == "IdentityOp") {
+        std::string value = src_value->s;
+        SetConstant(&node, src_type->type, src_shape->shape, value);
+        changed = true;
+      } else if (node.op == "Reshape" && node.input.size() > 1 &&
+                 IsConstant(node.input[1])) {
+        TensorShape shape;
+        if (!ReshapeTo(*Producer(node.input[1]), src_shape->shape, &shape)) {
+          continue;
+        }
+        std::string value = src_value->s;
+        SetConstant(&node, src_type->type, shape, value);
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  // The shape a Reshape to the constant shape_node gives, like ReshapeOp.
+  bool ReshapeTo(const NodeDef& shape_node, const TensorShape& from,
+                 TensorShape* to) {
+    const AttrValue* value = Attr(shape_node, "value");
+    const AttrValue* type = Attr(shape_node, "dtype");
+    if (value == nullptr || type == nullptr || type->type != DataType::kInt64) {
+      return false;
+    }
+    std::vector<int64_t> raw(value->s.size() / sizeof(int64_t));
+    memcpy(raw.data(), value->s.data(), raw.size() * sizeof(int64_t));
+    std::vector<size_t> dims;
+    int64_t num_ele = 1, loc = -1;
+    for (size_t i = 0; i < raw.size(); i++) {
+      if (raw[i] < -1 || (raw[i] == -1 && loc != -1)) {
+        return false;
+      }
+      if (raw[i] == -1) {
+        loc = i;
+        dims.push_back(0);
+      } else {
+        num_ele *= raw[i];
+        dims.push_back(raw[i]);
+      }
+    }
+    int64_t total = from.NumElements();
+    if (loc == -1) {
+      if (num_ele != total) {
+        return false;
+      }
+    } else {
+      if (num_ele == 0 || total % num_ele != 0) {
+        return false;
+      }
+      dims[loc] = total / num_ele;
+    }
+    *to = TensorShape(dims);
+    return true;
+  }
+
+  // Identity of identity copies once, reshape of reshape reshapes once.
+  bool CollapseChains() {
+    bool changed = false;
+    for (auto&& node : graph_->node) {
+      if ((node.op != "IdentityOp" && node.op != "Reshape") ||
+          node.input.empty() || IsControl(node.input[0])) {
+        continue;
+      }
+      NodeDef* src = Producer(node.input[0]);
+      if (src == nullptr || src->op != node.op ||
+          src->device.device_name != node.device.device_name ||
+          src->input.empty() || IsControl(src->input[0])) {
+        continue;
+      }
+      node.input[0] = src->input[0];
+      for (auto&& input : src->input) {
+        if (IsControl(input)) {
+          node.input.push_back(input);
+        }
+      }
+      changed = true;
+    }
+    return changed;
+  }
+
+  std::string NodeKey(const NodeDef& node) {
+    std::string key = node.op + "@" + node.device.device_name;
+    std::map<std::string, std::string> device_attr(node.device.attr.begin(),
+                                                   node.device.attr.end());
+    for (auto&& item : device_attr) {
+      key += ";" + item.first + "=" + item.second;
+    }
+    key += "(";
+    for (auto&& input : node.input) {
+      key += input + ",";
+    }
+    key += ")";
+    for (auto&& desc : node.input_dev_descs) {
+      key += desc + ",";
+    }
+    std::map<std::string, const AttrValue*> attrs;
+    for (auto&& item : node.attr) {
+      attrs[item.first] = &item.second;
+    }
+    for (auto&& item : attrs) {
+      key += item.first + "=" + AttrKey(*item.second) + ";";
+    }
+    return key;
+  }
+
+  bool EliminateCommon() {
+    std::unordered_map<std::string, std::string> first;
+    std::unordered_map<std::string, std::string> rename;
+    for (auto&& node : graph_->node) {
+      if (kPureOps.find(node.op) == kPureOps.end()) {
+        continue;
+      }
+      auto ret = first.insert({NodeKey(node), node.name});
+      if (!ret.second) {
+        rename[node.name] = ret.first->second;
+      }
+    }
+    if (rename.empty()) {
+      return false;
+    }
+    auto rewrite = [&rename](std::string* input) {
+      auto iter = rename.find(NodeName(*input));
+      if (iter == rename.end()) {
+        return;
+      }
+      if (IsControl(*input)) {
+        *input = "^" + iter->second;
+      } else {
+        *input = iter->second + input->substr(input->find(':'));
+      }
+    };
+    for (auto&& node : graph_->node) {
+      for (auto&& input : node.input) {
+        rewrite(&input);
+      }
+    }
+    for (auto&& name : output_->output) {
+      rewrite(&name);
+    }
+    std::vector<NodeDef> nodes;
+    for (auto&& node : graph_->node) {
+      if (rename.find(node.name) == rename.end()) {
+        nodes.push_back(std::move(node));
+      }
+    }
+    graph_->node = std::move(nodes);
+    return true;
+  }
+
+  Status Prune() {
+    std::unordered_set<std::string> reachable;
+    std::vector<std::string> queue;
+    for (auto&& name : output_->output) {
+      queue.push_back(NodeName(name));
+    }
+    while (!queue.empty()) {
+      std::string name = queue.back();
+      queue.pop_back();
+      if (!reachable.insert(name).second) {
+        continue;
+      }
+      NodeDef* node = Producer(name);
+      XDL_CHECK_COND(node != nullptr,
+                     Status::ArgumentError("not found node:" + name));
+      for (auto&& input : node->input) {
+        queue.push_back(NodeName(input));
+      }
+    }
+    std::vector<NodeDef> nodes;
+    for (auto&& node : graph_->node) {
+      if (reachable.find(node.name) != reachable.end()) {
+        nodes.push_back(std::move(node));
+      }
+    }
+    graph_->node = std::move(nodes);
+    return Status::Ok();
+  }
+
+  GraphDef* graph_;
+  OutputSpec* output_;
+  std::unordered_map<std::string, NodeDef*> node_def_;
+};
+
+}  // namespace
+
+// Runs after the prune and before the ps fusion, so fused ps ops see the
+// deduplicated inputs. XDL_GRAPH_OPTIMIZE=0 turns it off.
+class OptimizeGrappler : public Grappler {
+ public:
+  Status Process(GraphDef* graph, OutputSpec* output) override {
+    const char* env = getenv("XDL_GRAPH_OPTIMIZE");
+    if (env != nullptr && std::string(env) == "0") {
+      return Status::Ok();
+    }
+    OptimizeExecutor executor(graph, output);
+    XDL_CHECK_STATUS(executor.Run());
+    return Status::Ok();
+  }
+};
+
+}  // namespace xdl
+
+XDL_REGISTER_GRAPPLER(8000, xdl::OptimizeGrappler);
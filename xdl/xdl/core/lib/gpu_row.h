@@ -0,0 +1,71 @@
+/*
+ * Copyright 1999-2017 Alibaba Group.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef XDL_CORE_LIB_GPU_ROW_H_
+#define XDL_CORE_LIB_GPU_ROW_H_
+
+#include <stdint.h>
+#include <algorithm>
+
+#include <cuda_runtime.h>
+
+namespace xdl {
+namespace common {
+
+// The row kernels map a row to the threads of a warp or a part of it, the
+// threads read the row by 16 bytes when the rows are aligned so.
+const int kRowBlockThreads = 256;
+const int kRowMaxBlocks = 65535;
+
+template <typename T>
+struct RowVec {
+  typedef T Type;
+};
+
+template <>
+struct RowVec<float> {
+  typedef float4 Type;
+};
+
+template <>
+struct RowVec<double> {
+  typedef double2 Type;
+};
+
+// Whether the rows of cols elements at ptr can be read as RowVec<T>
+template <typename T>
+inline bool RowAligned(const void* ptr, size_t cols) {
+  typedef typename RowVec<T>::Type V;
+  return cols % (sizeof(V) / sizeof(T)) == 0 &&
+         reinterpret_cast<uintptr_t>(ptr) % sizeof(V) == 0;
+}
+
+// The threads of a row of cols vectors, a power of 2 up to the warp size
+inline int RowThreads(size_t cols) {
+  int threads = 1;
+  while (threads < 32 && static_cast<size_t>(threads) < cols) threads <<= 1;
+  return threads;
+}
+
+inline size_t RowBlocks(size_t rows, int row_threads) {
+  size_t rows_per_block = kRowBlockThreads / row_threads;
+  return std::min<size_t>((rows + rows_per_block - 1) / rows_per_block,
+                          kRowMaxBlocks);
+}
+
+}  // namespace common
+}  // namespace xdl
+
+#endif  // XDL_CORE_LIB_GPU_ROW_H_
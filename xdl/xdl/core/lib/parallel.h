@@ -39,6 +39,27 @@ namespace common {
     }
   }
 
+  /* Bucket positions [0, nr_ele) by their output row, the positions of a
+     row keep their order. A split of rows then owns its outputs, so a
+     scatter-add runs in parallel without atomics. */
+  template <typename I>
+  void row_bucket_generate(const I* rows, size_t nr_ele, size_t nr_row,
+                           std::vector<size_t>* offsets,
+                           std::vector<size_t>* positions) {
+    offsets->assign(nr_row + 1, 0);
+    for (size_t i = 0; i < nr_ele; i++) {
+      (*offsets)[rows[i] + 1]++;
+    }
+    for (size_t row = 0; row < nr_row; row++) {
+      (*offsets)[row + 1] += (*offsets)[row];
+    }
+    std::vector<size_t> fill(offsets->begin(), offsets->end() - 1);
+    positions->resize(nr_ele);
+    for (size_t i = 0; i < nr_ele; i++) {
+      (*positions)[fill[rows[i]]++] = i;
+    }
+  }
+
 }
 }
 
@@ -33,6 +33,9 @@ class RefCounted {
       delete this;
     }
   }
+  int64_t RefCount() const {
+    return ref_.load();
+  }
  private:
   std::atomic<int64_t> ref_;
 };
@@ -0,0 +1,279 @@
+/* Copyright 2018 Alibaba Group. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/core/lib/ring_all_reduce.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+
+namespace xdl {
+
+namespace {
+
+bool SplitAddress(const std::string& address, std::string* host, std::string* port) {
+  size_t pos = address.rfind(':');
+  if (pos == std::string::npos) {
+    return false;
+  }
+  *host = address.substr(0, pos);
+  *port = address.substr(pos + 1);
+  return !port->empty();
+}
+
+Status SendAll(int fd, const char* data, size_t len) {
+  while (len > 0) {
+    ssize_t ret = send(fd, data, len, MSG_NOSIGNAL);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      return Status::Internal(std::string("ring send failed: ") + strerror(errno));
+    }
+    data += ret;
+    len -= ret;
+  }
+  return Status::Ok();
+}
+
+Status RecvAll(int fd, char* data, size_t len) {
+  while (len > 0) {
+    ssize_t ret = recv(fd, data, len, 0);
+    if (ret == 0) {
+      return Status::Internal("ring peer closed");
+    }
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      return Status::Internal(std::string("ring recv failed: ") + strerror(errno));
+    }
+    data += ret;
+    len -= ret;
+  }
+  return Status::Ok();
+}
+
+}  // namespace
+
+RingAllReduce::RingAllReduce()
+  : rank_(0), size_(1), listen_fd_(-1), next_fd_(-1), prev_fd_(-1) {}
+
+RingAllReduce::~RingAllReduce() {
+  Close();
+}
+
+void RingAllReduce::Close() {
+  for (int* fd : {&listen_fd_, &next_fd_, &prev_fd_}) {
+    if (*fd >= 0) {
+      close(*fd);
+      *fd = -1;
+    }
+  }
+}
+
+Status RingAllReduce::Init(int rank, const std::vector<std::string>& addresses,
+                           int timeout_ms) {
+  Close();
+  if (rank < 0 || rank >= static_cast<int>(addresses.size())) {
+    return Status::ArgumentError("ring rank should be in [0, size)");
+  }
+  rank_ = rank;
+  size_ = addresses.size();
+  if (size_ == 1) {
+    return Status::Ok();
+  }
+
+  std::string host, port;
+  if (!SplitAddress(addresses[rank_], &host, &port)) {
+    return Status::ArgumentError("ring address should be host:port, " + addresses[rank_]);
+  }
+  listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  int on = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(atoi(port.c_str()));
+  if (listen_fd_ < 0 ||
+      bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      listen(listen_fd_, 1) != 0) {
+    Status st = Status::Internal("ring listen on " + addresses[rank_] + " failed: " +
+                                 strerror(errno));
+    Close();
+    return st;
+  }
+
+  // the connect completes in the backlog of the next rank before it
+  // accepts, so every rank connects first and accepts then
+  Status st = Connect(addresses[(rank_ + 1) % size_], timeout_ms);
+  if (st.IsOk()) {
+    prev_fd_ = accept(listen_fd_, nullptr, nullptr);
+    if (prev_fd_ < 0) {
+      st = Status::Internal(std::string("ring accept failed: ") + strerror(errno));
+    }
+  }
+  int32_t prev_rank = -1;
+  if (st.IsOk()) {
+    setsockopt(prev_fd_, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    int32_t my_rank = rank_;
+    st = SendAll(next_fd_, reinterpret_cast<char*>(&my_rank), sizeof(my_rank));
+  }
+  if (st.IsOk()) {
+    st = RecvAll(prev_fd_, reinterpret_cast<char*>(&prev_rank), sizeof(prev_rank));
+  }
+  if (st.IsOk() && prev_rank != (rank_ + size_ - 1) % size_) {
+    st = Status::Internal("ring previous rank mismatch, got " + std::to_string(prev_rank));
+  }
+  if (!st.IsOk()) {
+    Close();
+  }
+  return st;
+}
+
+Status RingAllReduce::Connect(const std::string& address, int timeout_ms) {
+  std::string host, port;
+  if (!SplitAddress(address, &host, &port)) {
+    return Status::ArgumentError("ring address should be host:port, " + address);
+  }
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  while (true) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) == 0) {
+      int fd = socket(AF_INET, SOCK_STREAM, 0);
+      if (fd >= 0 && connect(fd, result->ai_addr, result->ai_addrlen) == 0) {
+        freeaddrinfo(result);
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        next_fd_ = fd;
+        return Status::Ok();
+      }
+      if (fd >= 0) {
+        close(fd);
+      }
+      freeaddrinfo(result);
+    }
+    if (std::chrono::steady_clock::now() > deadline) {
+      return Status::Internal("ring connect " + address + " timeout");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+}
+
+Status RingAllReduce::SendRecv(const char* send_buf, size_t send_len,
+                               char* recv_buf, size_t recv_len) {
+  while (send_len > 0 || recv_len > 0) {
+    struct pollfd fds[2];
+    int nfds = 0;
+    if (send_len > 0) {
+      fds[nfds].fd = next_fd_;
+      fds[nfds].events = POLLOUT;
+      ++nfds;
+    }
+    if (recv_len > 0) {
+      fds[nfds].fd = prev_fd_;
+      fds[nfds].events = POLLIN;
+      ++nfds;
+    }
+    if (poll(fds, nfds, -1) < 0) {
+      if (errno == EINTR) continue;
+      return Status::Internal(std::string("ring poll failed: ") + strerror(errno));
+    }
+    for (int i = 0; i < nfds; ++i) {
+      if (fds[i].revents == 0) {
+        continue;
+      }
+      if (fds[i].fd == next_fd_) {
+        ssize_t ret = send(next_fd_, send_buf, send_len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+          return Status::Internal(std::string("ring send failed: ") + strerror(errno));
+        }
+        if (ret > 0) {
+          send_buf += ret;
+          send_len -= ret;
+        }
+      } else {
+        ssize_t ret = recv(prev_fd_, recv_buf, recv_len, MSG_DONTWAIT);
+        if (ret == 0) {
+          return Status::Internal("ring peer closed");
+        }
+        if (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+          return Status::Internal(std::string("ring recv failed: ") + strerror(errno));
+        }
+        if (ret > 0) {
+          recv_buf += ret;
+          recv_len -= ret;
+        }
+      }
+    }
+  }
+  return Status::Ok();
+}
+
+Status RingAllReduce::AllReduce(float* data, size_t size) {
+  if (size_ == 1 || size == 0) {
+    return Status::Ok();
+  }
+  if (next_fd_ < 0 || prev_fd_ < 0) {
+    return Status::Internal("ring is not initialized");
+  }
+
+  // segment i is [begin(i), begin(i + 1))
+  auto begin = [size, this](int i) {
+    return size * i / size_;
+  };
+  buffer_.resize(size / size_ + 1);
+
+  // after step s the rank holds the sum of s + 2 ranks of the segment
+  // rank - s - 1, and of all of them of the segment rank + 1 at last
+  for (int s = 0; s < size_ - 1; ++s) {
+    int send_seg = (rank_ - s + size_) % size_;
+    int recv_seg = (rank_ - s - 1 + size_) % size_;
+    size_t recv_size = begin(recv_seg + 1) - begin(recv_seg);
+    XDL_CHECK_STATUS(SendRecv(
+        reinterpret_cast<const char*>(data + begin(send_seg)),
+        (begin(send_seg + 1) - begin(send_seg)) * sizeof(float),
+        reinterpret_cast<char*>(buffer_.data()), recv_size * sizeof(float)));
+    float* dst = data + begin(recv_seg);
+    for (size_t i = 0; i < recv_size; ++i) {
+      dst[i] += buffer_[i];
+    }
+  }
+
+  // pass the reduced segments around the ring
+  for (int s = 0; s < size_ - 1; ++s) {
+    int send_seg = (rank_ - s + 1 + size_) % size_;
+    int recv_seg = (rank_ - s + size_) % size_;
+    XDL_CHECK_STATUS(SendRecv(
+        reinterpret_cast<const char*>(data + begin(send_seg)),
+        (begin(send_seg + 1) - begin(send_seg)) * sizeof(float),
+        reinterpret_cast<char*>(data + begin(recv_seg)),
+        (begin(recv_seg + 1) - begin(recv_seg)) * sizeof(float)));
+  }
+  return Status::Ok();
+}
+
+}  // namespace xdl
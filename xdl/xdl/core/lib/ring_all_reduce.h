@@ -0,0 +1,70 @@
+/* Copyright 2018 Alibaba Group. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XDL_CORE_LIB_RING_ALL_REDUCE_H_
+#define XDL_CORE_LIB_RING_ALL_REDUCE_H_
+
+#include <string>
+#include <vector>
+
+#include "xdl/core/lib/status.h"
+
+namespace xdl {
+
+// Sums float buffers over the workers of a ring by tcp, reduce-scatter
+// then all-gather, so each worker sends and receives 2 * (n - 1) / n of
+// the buffer whatever the ring size. The workers call AllReduce in the
+// same order with buffers of the same size.
+class RingAllReduce {
+ public:
+  RingAllReduce();
+  ~RingAllReduce();
+
+  // addresses are the host:port of the ranks, the rank listens on the
+  // port of its own and connects the next one, retrying until timeout_ms
+  Status Init(int rank, const std::vector<std::string>& addresses,
+              int timeout_ms = 60000);
+  // Sum data over the ranks in place
+  Status AllReduce(float* data, size_t size);
+
+  int rank() const {
+    return rank_;
+  }
+
+  int size() const {
+    return size_;
+  }
+
+ private:
+  RingAllReduce(const RingAllReduce&) = delete;
+  RingAllReduce& operator=(const RingAllReduce&) = delete;
+
+  Status Connect(const std::string& address, int timeout_ms);
+  // Send to the next rank and receive from the previous one at once, so
+  // that the ring never waits on a full socket buffer
+  Status SendRecv(const char* send, size_t send_len, char* recv, size_t recv_len);
+  void Close();
+
+  int rank_;
+  int size_;
+  int listen_fd_;
+  int next_fd_;
+  int prev_fd_;
+  std::vector<float> buffer_;
+};
+
+}  // namespace xdl
+
+#endif  // XDL_CORE_LIB_RING_ALL_REDUCE_H_
@@ -0,0 +1,250 @@
+/*
+ * Copyright 1999-2018 Alibaba Group.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef XDL_CORE_LIB_RING_QUEUE_H_
+#define XDL_CORE_LIB_RING_QUEUE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace xdl {
+
+struct RingQueueStats {
+  size_t capacity = 0;
+  size_t size = 0;
+  uint64_t enqueued = 0;
+  uint64_t dequeued = 0;
+  /// time the producers waited on a full queue
+  uint64_t full_micros = 0;
+  /// time the consumers waited on an empty queue
+  uint64_t empty_micros = 0;
+};
+
+/*!\brief Bounded lock free multi producer multi consumer queue, a ring of
+ * sequenced cells. The waits spin, yield then sleep a little longer each
+ * time. ForceEnqueue goes past the capacity into a locked overflow, which
+ * is dequeued once the ring is empty. */
+template <typename Task>
+class RingQueue {
+ public:
+  explicit RingQueue(size_t capacity = 10) {
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+    size_ = size;
+    cells_.reset(new Cell[size]);
+    for (size_t i = 0; i < size; ++i) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+    mask_ = size - 1;
+  }
+
+  /*!\brief Enqueue, waits while full */
+  void Enqueue(const Task& task) {
+    if (Push(task)) return;
+    Backoff backoff(&full_micros_);
+    while (!Push(task)) backoff.Wait();
+  }
+
+  /*!\brief Enqueue even if full */
+  void ForceEnqueue(const Task& task) {
+    std::unique_lock<std::mutex> lck(mutex_);
+    overflow_.push_back(task);
+    overflow_size_.fetch_add(1, std::memory_order_release);
+    enqueued_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /*!\brief Enqueue with elapse timwait */
+  bool TryEnqueue(const Task& task, uint32_t timewait) {
+    if (Push(task)) return true;
+    Backoff backoff(&full_micros_, timewait);
+    while (!Push(task)) {
+      if (!backoff.Wait()) return false;
+    }
+    return true;
+  }
+
+  /*!\brief Dequeue, waits while empty */
+  Task Dequeue() {
+    Task task;
+    if (Pop(&task)) return task;
+    Backoff backoff(&empty_micros_);
+    while (!Pop(&task)) backoff.Wait();
+    return task;
+  }
+
+  /*!\brief Try Dequeue */
+  bool TryDequeue(Task* task, uint32_t timewait) {
+    if (Pop(task)) return true;
+    Backoff backoff(&empty_micros_, timewait);
+    while (!Pop(task)) {
+      if (!backoff.Wait()) return false;
+    }
+    return true;
+  }
+
+  /*!\brief Return size, approximately while in use */
+  size_t Size() const {
+    size_t tail = enqueue_pos_.load(std::memory_order_acquire);
+    size_t head = dequeue_pos_.load(std::memory_order_acquire);
+    return (tail > head ? tail - head : 0) +
+        overflow_size_.load(std::memory_order_acquire);
+  }
+
+  bool Empty() const { return Size() == 0; }
+
+  /*!\brief clear and release */
+  void ClearAndDelete(void (*deleter)(Task)) {
+    Task task;
+    while (Pop(&task)) {
+      deleter(task);
+    }
+  }
+
+  RingQueueStats Stats() const {
+    RingQueueStats stats;
+    stats.capacity = size_;
+    stats.size = Size();
+    stats.enqueued = enqueued_.load(std::memory_order_relaxed);
+    stats.dequeued = dequeued_.load(std::memory_order_relaxed);
+    stats.full_micros = full_micros_.load(std::memory_order_relaxed);
+    stats.empty_micros = empty_micros_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    Task task;
+  };
+
+  /// times an unsuccessful wait, up to timewait milliseconds
+  class Backoff {
+   public:
+    Backoff(std::atomic<uint64_t>* micros, uint32_t timewait = UINT32_MAX)
+        : micros_(micros), start_(std::chrono::steady_clock::now()),
+          timewait_(timewait) {}
+    ~Backoff() {
+      micros_->fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start_).count(), std::memory_order_relaxed);
+    }
+    /// false once timewait is over
+    bool Wait() {
+      if (++count_ < kSpins) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+        return true;
+      }
+      if (count_ < kSpins + kYields) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(sleep_));
+        sleep_ = std::min<uint32_t>(sleep_ * 2, kMaxSleepMicros);
+      }
+      if (timewait_ != UINT32_MAX && (count_ & 0x7) == 0) {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        return elapsed < std::chrono::milliseconds(timewait_);
+      }
+      return true;
+    }
+
+   private:
+    static const uint32_t kSpins = 64;
+    static const uint32_t kYields = 64;
+    static const uint32_t kMaxSleepMicros = 200;
+    std::atomic<uint64_t>* micros_;
+    std::chrono::steady_clock::time_point start_;
+    uint32_t timewait_;
+    uint32_t count_ = 0;
+    uint32_t sleep_ = 10;
+  };
+
+  bool Push(const Task& task) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell* cell = &cells_[pos & mask_];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell->task = task;
+          cell->seq.store(pos + 1, std::memory_order_release);
+          enqueued_.fetch_add(1, std::memory_order_relaxed);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool Pop(Task* task) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell* cell = &cells_[pos & mask_];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          *task = cell->task;
+          cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+          dequeued_.fetch_add(1, std::memory_order_relaxed);
+          return true;
+        }
+      } else if (diff < 0) {
+        return PopOverflow(task);
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool PopOverflow(Task* task) {
+    if (overflow_size_.load(std::memory_order_acquire) == 0) return false;
+    std::unique_lock<std::mutex> lck(mutex_);
+    if (overflow_.empty()) return false;
+    *task = overflow_.front();
+    overflow_.pop_front();
+    overflow_size_.fetch_sub(1, std::memory_order_release);
+    dequeued_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t size_;
+  size_t mask_;
+  alignas(64) std::atomic<size_t> enqueue_pos_{0};
+  alignas(64) std::atomic<size_t> dequeue_pos_{0};
+  alignas(64) std::atomic<uint64_t> enqueued_{0};
+  std::atomic<uint64_t> dequeued_{0};
+  std::atomic<uint64_t> full_micros_{0};
+  std::atomic<uint64_t> empty_micros_{0};
+
+  std::mutex mutex_;
+  std::deque<Task> overflow_;
+  std::atomic<size_t> overflow_size_{0};
+};
+
+}  // namespace xdl
+
+#endif  // XDL_CORE_LIB_RING_QUEUE_H_
@@ -16,14 +16,87 @@
 
 #include "xdl/core/lib/unique.h"
 
+#include <omp.h>
+
+#include <vector>
+
 namespace xdl {
 namespace functor {
 
-template <typename I> struct UniqueID {
-  std::vector<I> samples;
-  std::vector<I> idxs;  
+namespace {
+
+// Inputs above it are deduplicated by kShards threads, each owning the ids
+// whose hash falls in its shard.
+constexpr size_t kParallelSize = 1 << 16;
+constexpr int kShards = 16;
+
+inline uint64_t Mix(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+// Open addressing table of the first position of every id, positions are
+// compared through the input so 1-d and 2-d ids share the code.
+template <typename T, typename I>
+class IdTable {
+ public:
+  IdTable(const T* ids, size_t id_dim, size_t capacity)
+    : ids_(ids), id_dim_(id_dim) {
+    size_t size = 16;
+    while (size < capacity * 2) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    slots_.assign(size, Slot{-1, 0});
+  }
+
+  // the local id of the id at pos, next_id if it is new
+  I Insert(size_t pos, uint64_t hash, I next_id, bool* inserted) {
+    size_t k = hash & mask_;
+    while (true) {
+      Slot& slot = slots_[k];
+      if (slot.pos < 0) {
+        slot.pos = pos;
+        slot.id = next_id;
+        *inserted = true;
+        return next_id;
+      }
+      if (Equal(slot.pos, pos)) {
+        *inserted = false;
+        return slot.id;
+      }
+      k = (k + 1) & mask_;
+    }
+  }
+
+ private:
+  struct Slot {
+    int64_t pos;
+    I id;
+  };
+  bool Equal(size_t lhs, size_t rhs) const {
+    for (size_t d = 0; d < id_dim_; d++) {
+      if (ids_[lhs * id_dim_ + d] != ids_[rhs * id_dim_ + d]) {
+        return false;
+      }
+    }
+    return true;
+  }
+  const T* ids_;
+  size_t id_dim_;
+  size_t mask_;
+  std::vector<Slot> slots_;
 };
 
+}  // namespace
+
+// Unique ids come out shard by shard, each shard in first occurrence
+// order, and the samples of an id in input order. One hash table pass
+// gives the inverse index and the counts, a counting pass the segments.
 template <typename T, typename I>
 void UniqueFunctor<CpuDevice, T, I>::operator()(CpuDevice* d,
                                                 const Tensor& in,
@@ -34,8 +107,6 @@ void UniqueFunctor<CpuDevice, T, I>::operator()(CpuDevice* d,
                                                 Tensor* sample_segment) {
   size_t id_num = in.Shape()[0];
   size_t id_dim = in.Shape().Size() == 1 ? 1 : in.Shape()[1];
-  size_t total_num = in.Shape().NumElements();
-  I current_sample = 0;
   T* pin = in.Raw<T>();
   *out_index = Tensor(d, TensorShape({id_num}), DataTypeToEnum<I>::v());
   I* pindex = out_index->Raw<I>();
@@ -43,82 +114,82 @@ void UniqueFunctor<CpuDevice, T, I>::operator()(CpuDevice* d,
   *sample_index = Tensor(d, TensorShape({id_num}), DataTypeToEnum<I>::v());
   I* psample_index = sample_index->Raw<I>();
 
-  if (id_dim == 1) {
-    std::unordered_map<T, UniqueID<I> > uniq(id_num);
-    for (I i = 0; i < id_num; ++i) {
-      while (psegment[current_sample] == i) {
-        ++current_sample;
-      }
-      auto iter = uniq.insert(std::make_pair(pin[i], UniqueID<I>{.samples={current_sample}, .idxs={i}}));
-      if (!iter.second) {
-        iter.first->second.samples.push_back(current_sample);
-        iter.first->second.idxs.push_back(i);
-      }
+  std::vector<uint64_t> hashes(id_num);
+  for (size_t i = 0; i < id_num; ++i) {
+    uint64_t hash = 0;
+    for (size_t k = 0; k < id_dim; ++k) {
+      hash = Mix(hash ^ static_cast<uint64_t>(pin[i * id_dim + k]));
     }
-    TensorShape out_shape({uniq.size()});
-    *out = Tensor(d, out_shape, DataTypeToEnum<T>::v());
-    *sample_segment = Tensor(d, out_shape, DataTypeToEnum<I>::v());
-    I accum = 0;  
-    T* pout = out->Raw<T>();
-    I* psample_segment = sample_segment->Raw<I>();
-    I j = 0;
-    for (const auto& it : uniq) {
-      pout[j] = it.first;
-      for (size_t i = 0; i < it.second.samples.size(); ++i, ++accum) {
-        psample_index[accum] = it.second.samples[i];
-      }
-      for (size_t i = 0; i < it.second.idxs.size(); ++i) {
-        pindex[it.second.idxs[i]] = j;
+    hashes[i] = hash;
+  }
+
+  int shards = id_num < kParallelSize ? 1 : kShards;
+  auto shard_of = [&hashes, shards](size_t i) {
+    return static_cast<int>((hashes[i] >> 60) % shards);
+  };
+  std::vector<std::vector<size_t>> positions(shards);
+  if (shards > 1) {
+    for (size_t i = 0; i < id_num; ++i) {
+      positions[shard_of(i)].push_back(i);
+    }
+  }
+  std::vector<std::vector<size_t>> firsts(shards);
+  #pragma omp parallel for if (shards > 1)
+  for (int shard = 0; shard < shards; ++shard) {
+    size_t num = shards == 1 ? id_num : positions[shard].size();
+    IdTable<T, I> table(pin, id_dim, num);
+    std::vector<size_t>& first = firsts[shard];
+    for (size_t k = 0; k < num; ++k) {
+      size_t i = shards == 1 ? k : positions[shard][k];
+      bool inserted;
+      pindex[i] = table.Insert(i, hashes[i], first.size(), &inserted);
+      if (inserted) {
+        first.push_back(i);
       }
-      psample_segment[j] = accum;
-      j++;
     }
+  }
+  std::vector<I> offsets(shards + 1, 0);
+  for (int shard = 0; shard < shards; ++shard) {
+    offsets[shard + 1] = offsets[shard] + firsts[shard].size();
+  }
+  size_t uniq_num = offsets[shards];
+  if (shards > 1) {
+    for (size_t i = 0; i < id_num; ++i) {
+      pindex[i] += offsets[shard_of(i)];
+    }
+  }
+
+  if (id_dim == 1) {
+    *out = Tensor(d, TensorShape({uniq_num}), DataTypeToEnum<T>::v());
   } else {
-    auto hash_fn = [pin](const size_t& index) {
-      size_t x = std::hash<T>()(pin[index * 2]);
-      size_t y = std::hash<T>()(pin[index * 2 + 1]);
-      x = ((x & 0xAAAAAAAAAAAAAAAAL) >> 1) + ((x & 0x5555555555555555L) << 1);
-      y = ((y & 0xFFFFFFFF00000000L) >> 32) + ((y & 0x00000000FFFFFFFFL) << 32);
-      return x ^ y;
-    };
-    auto key_equal_fn = [pin](const size_t& lhs, const size_t& rhs) {
-      return pin[lhs * 2] == pin[rhs * 2] &&
-             pin[lhs * 2 + 1] == pin[rhs * 2 + 1];
-    };
-
-    std::unordered_map<size_t, UniqueID<I>, decltype(hash_fn), decltype(key_equal_fn)>
-        uniq(id_num, hash_fn, key_equal_fn);
-
-    for (I i = 0; i < id_num; ++i) {
-      while (psegment[current_sample] == i) {
-        ++current_sample;
-      }
-      auto iter = uniq.insert(std::make_pair(i, UniqueID<I>{.samples={current_sample}, .idxs={i}}));
-      if (!iter.second) {
-        iter.first->second.samples.push_back(current_sample);
-        iter.first->second.idxs.push_back(i);
+    *out = Tensor(d, TensorShape({uniq_num, id_dim}), DataTypeToEnum<T>::v());
+  }
+  *sample_segment = Tensor(d, TensorShape({uniq_num}), DataTypeToEnum<I>::v());
+  T* pout = out->Raw<T>();
+  I* psample_segment = sample_segment->Raw<I>();
+  for (int shard = 0; shard < shards; ++shard) {
+    for (size_t j = 0; j < firsts[shard].size(); ++j) {
+      size_t pos = firsts[shard][j];
+      for (size_t k = 0; k < id_dim; ++k) {
+        pout[(offsets[shard] + j) * id_dim + k] = pin[pos * id_dim + k];
       }
     }
-    TensorShape out_shape({uniq.size(), id_dim});
-    *out = Tensor(d, out_shape, DataTypeToEnum<T>::v());
-    TensorShape sample_segment_shape({uniq.size()});    
-    *sample_segment = Tensor(d, sample_segment_shape, DataTypeToEnum<I>::v());
-    I accum = 0;  
-    T* pout = out->Raw<T>();
-    I* psample_segment = sample_segment->Raw<I>();
-    I j = 0;
-    for (const auto& it : uniq) {
-      pout[2*j] = pin[2*it.first];
-      pout[2*j+1] = pin[2*it.first+1];
-      for (size_t i = 0; i < it.second.samples.size(); ++i, ++accum) {
-        psample_index[accum] = it.second.samples[i];
-      }
-      for (size_t i = 0; i < it.second.idxs.size(); ++i) {
-        pindex[it.second.idxs[i]] = j;
-      }
-      psample_segment[j] = accum;
-      j++;
+  }
+
+  std::vector<I> fill(uniq_num + 1, 0);
+  for (size_t i = 0; i < id_num; ++i) {
+    fill[pindex[i] + 1]++;
+  }
+  for (size_t j = 0; j < uniq_num; ++j) {
+    fill[j + 1] += fill[j];
+    psample_segment[j] = fill[j + 1];
+  }
+  I current_sample = 0;
+  for (I i = 0; i < id_num; ++i) {
+    while (psegment[current_sample] == i) {
+      ++current_sample;
     }
+    psample_index[fill[pindex[i]]++] = current_sample;
   }
 }
 
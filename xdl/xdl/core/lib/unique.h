@@ -25,6 +25,9 @@ namespace functor {
 template <typename Device, typename T, typename I>
 struct UniqueFunctor;
 
+// The unique ids of in, the index of every id into them, and the samples
+// of every unique id by segment. The sums of KSum/Take are not fused in, the
+// pull of the unique ids sits between them.
 template <typename T, typename I>
 struct UniqueFunctor<CpuDevice, T, I> {
   void operator()(CpuDevice* d, const Tensor& in, const Tensor& segment, Tensor* out, Tensor* out_index, Tensor* sample_index, Tensor* sample_segment);
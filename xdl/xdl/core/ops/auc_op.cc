@@ -50,19 +50,16 @@ class AucOp : public OpKernel {
     int64_t* fp = fp_tensor.Raw<int64_t>();
     int64_t* tn = tn_tensor.Raw<int64_t>();
     int64_t* fn = fn_tensor.Raw<int64_t>();
-    std::vector<float> tpr;
-    std::vector<float> fpr;
     int64_t num_thresholds = tp_tensor.Shape()[0];
-    tpr.reserve(num_thresholds);
-    fpr.reserve(num_thresholds);
+    float auc = 0, prev_tpr = 0, prev_fpr = 0;
     for (int64_t i = 0; i < num_thresholds; ++i) {
-      tpr[i] = (tp[i] + kEpsilon) / (tp[i] + fn[i] + kEpsilon);
-      fpr[i] = fp[i] / (fp[i] + tn[i] + kEpsilon);
-    }
-
-    float auc = 0;
-    for (size_t i = 0; i < num_thresholds - 1; ++i) {
-      auc += (fpr[i+1] - fpr[i]) * (tpr[i+1] + tpr[i]) / 2.0;
+      float tpr = (tp[i] + kEpsilon) / (tp[i] + fn[i] + kEpsilon);
+      float fpr = fp[i] / (fp[i] + tn[i] + kEpsilon);
+      if (i != 0) {
+        auc += (fpr - prev_fpr) * (tpr + prev_tpr) / 2.0;
+      }
+      prev_tpr = tpr;
+      prev_fpr = fpr;
     }
 
     return fabs(auc);
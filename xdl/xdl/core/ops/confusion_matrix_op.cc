@@ -13,6 +13,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
+
 #include "xdl/core/utils/logging.h"
 
 #include "xdl/core/framework/op_kernel.h"
@@ -84,17 +86,39 @@ class ConfusionMatrixOp : public OpKernel {
     int64_t* fp = result->at(1).Raw<int64_t>();
     int64_t* tn = result->at(2).Raw<int64_t>();
     int64_t* fn = result->at(3).Raw<int64_t>();
-    for (int64_t i = 0; i < dim0; ++i) {
-      float prediction = p_base[i];
-      T label = l_base[i];
-      for (size_t j = 0; j < thresholds_.size(); ++j) {
-        if (prediction > thresholds_[j]) {
-          if (ToBool(label)) tp[j]++; else fp[j]++;
-        } else {
-          if (ToBool(label)) fn[j]++; else tn[j]++;
-        }
+    // A sample is above the thresholds before the first one not below its
+    // prediction, so the samples are counted by that bucket only and the
+    // matrix is summed from the buckets, O(log num_thresholds) a sample
+    size_t size = thresholds_.size();
+    std::vector<int64_t> pos(size + 1, 0), neg(size + 1, 0);
+    #pragma omp parallel if (dim0 > kParallelMin)
+    {
+      std::vector<int64_t> local_pos(size + 1, 0), local_neg(size + 1, 0);
+      #pragma omp for
+      for (int64_t i = 0; i < dim0; ++i) {
+        size_t bucket = std::lower_bound(thresholds_.begin(), thresholds_.end(),
+                                         p_base[i]) - thresholds_.begin();
+        if (ToBool(l_base[i])) local_pos[bucket]++; else local_neg[bucket]++;
+      }
+      #pragma omp critical
+      for (size_t k = 0; k <= size; ++k) {
+        pos[k] += local_pos[k];
+        neg[k] += local_neg[k];
       }
     }
+    int64_t pos_above = 0, neg_above = 0, pos_total = 0, neg_total = 0;
+    for (size_t k = 0; k <= size; ++k) {
+      pos_total += pos[k];
+      neg_total += neg[k];
+    }
+    for (size_t j = size; j-- > 0;) {
+      pos_above += pos[j + 1];
+      neg_above += neg[j + 1];
+      tp[j] = pos_above;
+      fp[j] = neg_above;
+      fn[j] = pos_total - pos_above;
+      tn[j] = neg_total - neg_above;
+    }
   }
 
   void InitOutput(Tensor* output) {
@@ -106,6 +130,8 @@ class ConfusionMatrixOp : public OpKernel {
   }
 
  private:
+  // samples counted by one thread
+  static const int64_t kParallelMin = 1 << 16;
   int64_t num_thresholds_;
   std::vector<float> thresholds_;
 };
@@ -0,0 +1,158 @@
+/* Copyright 2018 Alibaba Group. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#include "xdl/core/lib/status.h"
+#include "xdl/core/lib/singleton.h"
+#include "xdl/core/framework/op_kernel.h"
+#include "xdl/core/framework/op_define.h"
+#include "xdl/core/framework/op_registry.h"
+
+namespace xdl {
+
+// The rounds of the replicas of a dense tower in a worker, a round is
+// reduced by the last replica to arrive, which sets the sums as the
+// outputs of all of them
+class DenseAllReduceRendezvous : public Singleton<DenseAllReduceRendezvous> {
+ public:
+  struct Arrival {
+    OpKernelContext* ctx;
+    OpKernelAsync::Callback done;
+    std::vector<Tensor> grads;
+  };
+
+  void Arrive(const std::string& key, int64_t replicas, int64_t replica_id,
+              bool average, const Arrival& arrival) {
+    std::vector<Arrival> arrivals;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      Group& group = groups_[key];
+      if (group.steps.empty()) {
+        group.steps.resize(replicas, 0);
+      }
+      // a replica may run ahead of the others in the step pipeline
+      int64_t step = group.steps[replica_id]++;
+      std::vector<Arrival>& round = group.rounds[step];
+      round.push_back(arrival);
+      if (static_cast<int64_t>(round.size()) < replicas) {
+        return;
+      }
+      arrivals.swap(round);
+      group.rounds.erase(step);
+    }
+
+    Status st = Reduce(average, &arrivals);
+    for (auto&& item : arrivals) {
+      if (st.IsOk()) {
+        st = item.ctx->SetOutputList("outputs", arrivals[0].grads);
+      }
+      item.done(st);
+    }
+  }
+
+ private:
+  struct Group {
+    std::vector<int64_t> steps;
+    std::unordered_map<int64_t, std::vector<Arrival> > rounds;
+  };
+
+  // Sum the grads of the arrivals into those of the first one
+  static Status Reduce(bool average, std::vector<Arrival>* arrivals) {
+    Arrival& first = (*arrivals)[0];
+    std::vector<Tensor> sums(first.grads.size());
+    for (size_t i = 0; i < first.grads.size(); ++i) {
+      TensorShape shape = first.grads[i].Shape();
+      for (auto&& item : *arrivals) {
+        XDL_CHECK_COND(item.grads.size() == first.grads.size() &&
+                       item.grads[i].Shape() == shape,
+                       Status::ArgumentError("DenseAllReduce grads mismatch"));
+      }
+      XDL_CHECK_STATUS(first.ctx->Allocate(shape, DataType::kFloat, &sums[i]));
+      float* sum = sums[i].Raw<float>();
+      size_t size = shape.NumElements();
+      memcpy(sum, first.grads[i].Raw<float>(), size * sizeof(float));
+      for (size_t j = 1; j < arrivals->size(); ++j) {
+        const float* grad = (*arrivals)[j].grads[i].Raw<float>();
+        for (size_t k = 0; k < size; ++k) {
+          sum[k] += grad[k];
+        }
+      }
+      if (average) {
+        float scale = 1.0 / arrivals->size();
+        for (size_t k = 0; k < size; ++k) {
+          sum[k] *= scale;
+        }
+      }
+    }
+    first.grads.swap(sums);
+    return Status::Ok();
+  }
+
+  std::mutex mu_;
+  std::unordered_map<std::string, Group> groups_;
+};
+
+// Allreduces the dense gradients of the replicas of a tower which one
+// worker runs on several devices, so that a single aggregated dense push
+// per worker goes to the ps, by the replica 0 only. Every replica gets
+// the same reduced tensors, which the replicas applying the dense
+// variables locally may use as well. The ops of a group share key. On
+// the gpus the reduction is by nccl, see dense_all_reduce_op.cu.
+class DenseAllReduceOp : public xdl::OpKernelAsync {
+ public:
+  Status Init(OpKernelConstruction* ctx) override {
+    XDL_CHECK_STATUS(ctx->GetAttr("key", &key_));
+    XDL_CHECK_STATUS(ctx->GetAttr("replicas", &replicas_));
+    XDL_CHECK_STATUS(ctx->GetAttr("replica_id", &replica_id_));
+    XDL_CHECK_STATUS(ctx->GetAttr("average", &average_));
+    XDL_CHECK_COND(
+        replicas_ > 0 && replica_id_ >= 0 && replica_id_ < replicas_,
+        Status::ArgumentError("DenseAllReduce replica_id should be in [0, replicas)"));
+    return Status::Ok();
+  }
+
+  void Compute(OpKernelContext* ctx, Callback done) override {
+    DenseAllReduceRendezvous::Arrival arrival;
+    XDL_CHECK_STATUS_ASYNC(ctx->GetInputList("grads", &arrival.grads), done);
+    arrival.ctx = ctx;
+    arrival.done = done;
+    DenseAllReduceRendezvous::Get()->Arrive(key_, replicas_, replica_id_,
+                                            average_, arrival);
+  }
+
+ private:
+  std::string key_;
+  int64_t replicas_;
+  int64_t replica_id_;
+  bool average_;
+};
+
+XDL_DEFINE_OP(DenseAllReduce)
+  .InputList("grads", DataType::kFloat, "size")
+  .OutputList("outputs", DataType::kFloat, "size")
+  .Attr("size", AttrValue::kInt)
+  .Attr("key", AttrValue::kString)
+  .Attr("replicas", AttrValue::kInt)
+  .Attr("replica_id", AttrValue::kInt)
+  .Attr("average", AttrValue::kBool, true);
+
+XDL_REGISTER_KERNEL(DenseAllReduce, DenseAllReduceOp)
+  .Device("CPU");
+
+} // namespace xdl
+
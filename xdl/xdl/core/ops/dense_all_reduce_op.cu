@@ -0,0 +1,309 @@
+/* Copyright 2018 Alibaba Group. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <cuda_runtime_api.h>
+#include <nccl.h>
+
+#include "xdl/core/framework/op_kernel.h"
+#include "xdl/core/framework/op_registry.h"
+#include "xdl/core/framework/gpu/gpu_device.h"
+#include "xdl/core/lib/common_defines.h"
+#include "xdl/core/lib/singleton.h"
+#include "xdl/core/lib/status.h"
+
+namespace xdl {
+
+namespace {
+
+#define NCCL_CHECK_STATUS(condition)                                    \
+  do {                                                                  \
+    ncclResult_t result = (condition);                                  \
+    if (result != ncclSuccess) {                                        \
+      return Status::Internal(std::string("DenseAllReduce nccl error ") \
+                              + ncclGetErrorString(result));            \
+    }                                                                   \
+  } while (0)
+
+__global__ void ScaleKernel(float* data, size_t size, float scale) {
+  CUDA_KERNEL_LOOP(i, size) {
+    data[i] *= scale;
+  }
+}
+
+// Sets the current device back on leaving the scope
+class DeviceScope {
+ public:
+  DeviceScope() { CUDA_CHECK(cudaGetDevice(&device_)); }
+  ~DeviceScope() { CUDA_CHECK(cudaSetDevice(device_)); }
+ private:
+  int device_;
+};
+
+// The device holding the tensors, -1 if they are all empty
+Status DeviceOf(const std::vector<Tensor>& tensors, int* device) {
+  *device = -1;
+  for (auto&& tensor : tensors) {
+    if (tensor.Shape().NumElements() == 0) continue;
+    cudaPointerAttributes attr;
+    if (cudaPointerGetAttributes(&attr, tensor.Raw<float>()) != cudaSuccess ||
+        attr.memoryType != cudaMemoryTypeDevice) {
+      cudaGetLastError();
+      return Status::ArgumentError("DenseAllReduce grads should be in gpu memory");
+    }
+    XDL_CHECK_COND(*device < 0 || *device == attr.device,
+                   Status::ArgumentError("DenseAllReduce grads of a replica "
+                                         "should be on one gpu"));
+    *device = attr.device;
+  }
+  return Status::Ok();
+}
+
+}  // namespace
+
+// The gpu counterpart of DenseAllReduceRendezvous. The replicas of a
+// group are the ranks of one nccl communicator, one gpu each, which is
+// set up on the first round from the devices holding their grads. The
+// last replica to arrive launches the allreduce of all of them as one
+// nccl group, so a single thread drives every gpu of the node.
+class NcclAllReduceRendezvous : public Singleton<NcclAllReduceRendezvous> {
+ public:
+  struct Arrival {
+    OpKernelContext* ctx;
+    OpKernelAsync::Callback done;
+    int64_t replica_id;
+    // the stream computing the grads of the replica
+    cudaStream_t compute_stream;
+    std::vector<Tensor> grads;
+    std::vector<Tensor> outputs;
+  };
+
+  void Arrive(const std::string& key, int64_t replicas, bool average,
+              const Arrival& arrival) {
+    std::vector<Arrival> arrivals;
+    Group* group;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      group = &groups_[key];
+      if (group->steps.empty()) {
+        group->steps.resize(replicas, 0);
+      }
+      if (static_cast<int64_t>(group->steps.size()) != replicas ||
+          arrival.replica_id < 0 || arrival.replica_id >= replicas) {
+        lock.unlock();
+        arrival.done(Status::ArgumentError(
+            "DenseAllReduce replicas of key " + key + " mismatch"));
+        return;
+      }
+      // a replica may run ahead of the others in the step pipeline
+      int64_t step = group->steps[arrival.replica_id]++;
+      std::vector<Arrival>& round = group->rounds[step];
+      round.push_back(arrival);
+      if (static_cast<int64_t>(round.size()) < replicas) {
+        return;
+      }
+      arrivals.swap(round);
+      group->rounds.erase(step);
+    }
+
+    std::vector<Arrival*> ranks(arrivals.size(), nullptr);
+    Status st;
+    for (auto&& item : arrivals) {
+      if (item.replica_id < 0 ||
+          item.replica_id >= static_cast<int64_t>(ranks.size())) {
+        st = Status::ArgumentError("DenseAllReduce replica_id out of range");
+      } else if (ranks[item.replica_id] != nullptr) {
+        st = Status::ArgumentError("DenseAllReduce replica_id should be distinct");
+      } else {
+        ranks[item.replica_id] = &item;
+      }
+    }
+    if (st.IsOk()) {
+      st = Reduce(average, ranks, group);
+    }
+    for (auto&& item : arrivals) {
+      if (st.IsOk()) {
+        st = item.ctx->SetOutputList("outputs", item.outputs);
+      }
+      item.done(st);
+    }
+  }
+
+ private:
+  struct Group {
+    std::vector<int64_t> steps;
+    std::unordered_map<int64_t, std::vector<Arrival> > rounds;
+    // of the ranks, guarded by common::CudaMutex()
+    std::vector<int> devices;
+    std::vector<ncclComm_t> comms;
+    std::vector<cudaStream_t> streams;
+    // recorded on the compute streams, waited by the nccl streams
+    std::vector<cudaEvent_t> events;
+  };
+
+  static Status Init(const std::vector<Arrival*>& ranks, Group* group) {
+    std::vector<int> devices(ranks.size());
+    for (size_t r = 0; r < ranks.size(); ++r) {
+      XDL_CHECK_STATUS(DeviceOf(ranks[r]->grads, &devices[r]));
+      XDL_CHECK_COND(devices[r] >= 0,
+                     Status::ArgumentError("DenseAllReduce replicas without "
+                                           "grads can not pick their gpu"));
+    }
+    std::vector<ncclComm_t> comms(ranks.size());
+    NCCL_CHECK_STATUS(ncclCommInitAll(comms.data(), comms.size(), devices.data()));
+    std::vector<cudaStream_t> streams(ranks.size());
+    std::vector<cudaEvent_t> events(ranks.size());
+    for (size_t r = 0; r < ranks.size(); ++r) {
+      CUDA_CHECK(cudaSetDevice(devices[r]));
+      CUDA_CHECK(cudaStreamCreateWithFlags(&streams[r], cudaStreamNonBlocking));
+      CUDA_CHECK(cudaEventCreateWithFlags(&events[r], cudaEventDisableTiming));
+    }
+    group->devices.swap(devices);
+    group->comms.swap(comms);
+    group->streams.swap(streams);
+    group->events.swap(events);
+    return Status::Ok();
+  }
+
+  static Status Reduce(bool average, const std::vector<Arrival*>& ranks,
+                       Group* group) {
+    const Arrival& first = *ranks[0];
+    for (auto&& item : ranks) {
+      XDL_CHECK_COND(item->grads.size() == first.grads.size(),
+                     Status::ArgumentError("DenseAllReduce grads mismatch"));
+      for (size_t i = 0; i < first.grads.size(); ++i) {
+        XDL_CHECK_COND(item->grads[i].Shape() == first.grads[i].Shape(),
+                       Status::ArgumentError("DenseAllReduce grads mismatch"));
+      }
+    }
+
+    DeviceScope device_scope;
+    ncclResult_t result = ncclSuccess;
+    {
+      std::unique_lock<std::mutex> lock(common::CudaMutex());
+      if (group->comms.empty()) {
+        XDL_CHECK_STATUS(Init(ranks, group));
+      }
+      for (size_t r = 0; r < ranks.size(); ++r) {
+        int device;
+        XDL_CHECK_STATUS(DeviceOf(ranks[r]->grads, &device));
+        XDL_CHECK_COND(device < 0 || device == group->devices[r],
+                       Status::ArgumentError("DenseAllReduce replica moved "
+                                             "to another gpu"));
+        XDL_CHECK_STATUS(DeviceOf(ranks[r]->outputs, &device));
+        XDL_CHECK_COND(device < 0 || device == group->devices[r],
+                       Status::Internal("DenseAllReduce outputs are not on "
+                                        "the gpu of the replica"));
+      }
+      // the grads are written by the compute streams asynchronously
+      for (size_t r = 0; r < ranks.size(); ++r) {
+        CUDA_CHECK(cudaSetDevice(group->devices[r]));
+        CUDA_CHECK(cudaEventRecord(group->events[r], ranks[r]->compute_stream));
+        CUDA_CHECK(cudaStreamWaitEvent(group->streams[r], group->events[r], 0));
+      }
+      // nothing returns between the start and the end of the group,
+      // ncclGroupEnd launches or drops the calls queued so far
+      NCCL_CHECK_STATUS(ncclGroupStart());
+      for (size_t r = 0; r < ranks.size() && result == ncclSuccess; ++r) {
+        CUDA_CHECK(cudaSetDevice(group->devices[r]));
+        for (size_t i = 0; i < first.grads.size() && result == ncclSuccess; ++i) {
+          size_t size = first.grads[i].Shape().NumElements();
+          result = ncclAllReduce(
+              ranks[r]->grads[i].Raw<float>(), ranks[r]->outputs[i].Raw<float>(),
+              size, ncclFloat, ncclSum, group->comms[r], group->streams[r]);
+        }
+      }
+      ncclResult_t end_result = ncclGroupEnd();
+      if (result == ncclSuccess) {
+        result = end_result;
+      }
+      if (result == ncclSuccess && average) {
+        float scale = 1.0 / ranks.size();
+        for (size_t r = 0; r < ranks.size(); ++r) {
+          CUDA_CHECK(cudaSetDevice(group->devices[r]));
+          for (size_t i = 0; i < first.grads.size(); ++i) {
+            size_t size = first.grads[i].Shape().NumElements();
+            if (size == 0) continue;
+            ScaleKernel<<<CUDA_GET_BLOCKS(size), CUDA_NUM_THREADS, 0,
+                group->streams[r]>>>(ranks[r]->outputs[i].Raw<float>(), size, scale);
+          }
+        }
+      }
+    }
+    // the launched calls finish before the buffers are released, on errors too
+    for (size_t r = 0; r < ranks.size(); ++r) {
+      CUDA_CHECK(cudaSetDevice(group->devices[r]));
+      CUDA_CHECK(cudaStreamSynchronize(group->streams[r]));
+    }
+    NCCL_CHECK_STATUS(result);
+    return Status::Ok();
+  }
+
+  std::mutex mu_;
+  std::unordered_map<std::string, Group> groups_;
+};
+
+// DenseAllReduce of the replicas which run on the gpus of the worker, by
+// nccl. Replica r is rank r of the communicator and its grads and outputs
+// stay on its gpu, so the dense push of replica 0 is the only copy of the
+// reduced grads to the host.
+class DenseAllReduceGpuOp : public xdl::OpKernelAsync {
+ public:
+  Status Init(OpKernelConstruction* ctx) override {
+    XDL_CHECK_STATUS(ctx->GetAttr("key", &key_));
+    XDL_CHECK_STATUS(ctx->GetAttr("replicas", &replicas_));
+    XDL_CHECK_STATUS(ctx->GetAttr("replica_id", &replica_id_));
+    XDL_CHECK_STATUS(ctx->GetAttr("average", &average_));
+    XDL_CHECK_COND(
+        replicas_ > 0 && replica_id_ >= 0 && replica_id_ < replicas_,
+        Status::ArgumentError("DenseAllReduce replica_id should be in [0, replicas)"));
+    return Status::Ok();
+  }
+
+  void Compute(OpKernelContext* ctx, Callback done) override {
+    NcclAllReduceRendezvous::Arrival arrival;
+    XDL_CHECK_STATUS_ASYNC(ctx->GetInputList("grads", &arrival.grads), done);
+    arrival.outputs.resize(arrival.grads.size());
+    for (size_t i = 0; i < arrival.grads.size(); ++i) {
+      XDL_CHECK_STATUS_ASYNC(ctx->Allocate(arrival.grads[i].Shape(), DataType::kFloat,
+                                           &arrival.outputs[i]), done);
+    }
+    GpuDevice* device = dynamic_cast<GpuDevice*>(ctx->GetDevice());
+    XDL_CHECK_COND_ASYNC(device != nullptr,
+                         Status::Internal("DenseAllReduce should run on gpu"),
+                         done);
+    arrival.ctx = ctx;
+    arrival.done = done;
+    arrival.replica_id = replica_id_;
+    arrival.compute_stream = device->Stream()->GetInternal();
+    NcclAllReduceRendezvous::Get()->Arrive(key_, replicas_, average_, arrival);
+  }
+
+ private:
+  std::string key_;
+  int64_t replicas_;
+  int64_t replica_id_;
+  bool average_;
+};
+
+XDL_REGISTER_KERNEL(DenseAllReduce, DenseAllReduceGpuOp)
+  .Device("GPU");
+
+#undef NCCL_CHECK_STATUS
+
+}  // namespace xdl
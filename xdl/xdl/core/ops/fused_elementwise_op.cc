@@ -0,0 +1,234 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/core/ops/fused_elementwise_op.h"
+
+#include <omp.h>
+#include <algorithm>
+#include <sstream>
+#include <unordered_map>
+
+#include "xdl/core/framework/op_define.h"
+#include "xdl/core/framework/op_registry.h"
+
+namespace xdl {
+
+namespace {
+
+const std::unordered_map<std::string, FusedElementwiseCode> kFusedCodes = {
+  {"Add", kFusedAdd}, {"Sub", kFusedSub}, {"Mul", kFusedMul},
+  {"Div", kFusedDiv}, {"Negative", kFusedNegative}, {"Log", kFusedLog},
+  {"Log1p", kFusedLog1p}, {"Sqrt", kFusedSqrt}, {"Floor", kFusedFloor},
+  {"Ceil", kFusedCeil}, {"Sin", kFusedSin}, {"Cos", kFusedCos},
+  {"Tan", kFusedTan}, {"Asin", kFusedAsin}, {"Acos", kFusedAcos},
+  {"Atan", kFusedAtan}, {"Sinh", kFusedSinh}, {"Cosh", kFusedCosh},
+  {"Tanh", kFusedTanh}, {"Asinh", kFusedAsinh}, {"Acosh", kFusedAcosh},
+  {"Atanh", kFusedAtanh}
+};
+
+// The elements a cpu thread evaluates the program on at once, the
+// intermediates of a block stay in the cache
+const int64_t kFusedBlock = 1024;
+
+template <int kCode, typename T>
+void UnaryLoop(const T* in, int64_t len, T* out) {
+  for (int64_t j = 0; j < len; j++) {
+    out[j] = FusedUnary<T>(kCode, in[j]);
+  }
+}
+
+template <int kCode, typename T>
+void BinaryLoop(const T* lhs, const T* rhs, int64_t len, T* out) {
+  for (int64_t j = 0; j < len; j++) {
+    out[j] = FusedBinary<T>(kCode, lhs[j], rhs[j]);
+  }
+}
+
+#define FUSED_UNARY_CASE(CODE)               \
+  case CODE:                                 \
+    UnaryLoop<CODE, T>(in, len, out); break;
+
+template <typename T>
+void Unary(int code, const T* in, int64_t len, T* out) {
+  switch (code) {
+    FUSED_UNARY_CASE(kFusedNegative)
+    FUSED_UNARY_CASE(kFusedLog)
+    FUSED_UNARY_CASE(kFusedLog1p)
+    FUSED_UNARY_CASE(kFusedSqrt)
+    FUSED_UNARY_CASE(kFusedFloor)
+    FUSED_UNARY_CASE(kFusedCeil)
+    FUSED_UNARY_CASE(kFusedSin)
+    FUSED_UNARY_CASE(kFusedCos)
+    FUSED_UNARY_CASE(kFusedTan)
+    FUSED_UNARY_CASE(kFusedAsin)
+    FUSED_UNARY_CASE(kFusedAcos)
+    FUSED_UNARY_CASE(kFusedAtan)
+    FUSED_UNARY_CASE(kFusedSinh)
+    FUSED_UNARY_CASE(kFusedCosh)
+    FUSED_UNARY_CASE(kFusedTanh)
+    FUSED_UNARY_CASE(kFusedAsinh)
+    FUSED_UNARY_CASE(kFusedAcosh)
+    FUSED_UNARY_CASE(kFusedAtanh)
+  }
+}
+
+#undef FUSED_UNARY_CASE
+
+template <typename T>
+void Binary(int code, const T* lhs, const T* rhs, int64_t len, T* out) {
+  switch (code) {
+    case kFusedAdd: BinaryLoop<kFusedAdd, T>(lhs, rhs, len, out); break;
+    case kFusedSub: BinaryLoop<kFusedSub, T>(lhs, rhs, len, out); break;
+    case kFusedMul: BinaryLoop<kFusedMul, T>(lhs, rhs, len, out); break;
+    case kFusedDiv: BinaryLoop<kFusedDiv, T>(lhs, rhs, len, out); break;
+  }
+}
+
+// Evaluates the program on the len elements from begin op by op, buf holds
+// prog.depth blocks. The dense inputs are read in place.
+template <typename T>
+void EvalBlock(const FusedElementwiseProgram& prog,
+               const FusedElementwiseArgs<T>& args,
+               int64_t begin, int64_t len, T* buf, T* out) {
+  const T* stack[kFusedMaxOps];
+  int top = 0;
+  for (int p = 0; p < prog.size; p++) {
+    int code = prog.code[p];
+    T* dst = p == prog.size - 1 ? out : buf + (top - 1) * kFusedBlock;
+    if (code == kFusedInput) {
+      int i = prog.arg[p];
+      if (args.mode[i] == kFusedDense) {
+        stack[top++] = args.in[i] + begin;
+        continue;
+      }
+      dst = buf + top * kFusedBlock;
+      for (int64_t j = 0; j < len; j++) {
+        dst[j] = args.in[i][FusedInputOffset(args, i, begin + j)];
+      }
+      stack[top++] = dst;
+    } else if (code <= kFusedDiv) {
+      top--;
+      Binary<T>(code, stack[top - 1], stack[top], len, dst);
+      stack[top - 1] = dst;
+    } else {
+      Unary<T>(code, stack[top - 1], len, dst);
+      stack[top - 1] = dst;
+    }
+  }
+}
+
+}  // namespace
+
+bool FusedElementwiseCodeOf(const std::string& op, FusedElementwiseCode* code) {
+  auto iter = kFusedCodes.find(op);
+  if (iter == kFusedCodes.end()) {
+    return false;
+  }
+  *code = iter->second;
+  return true;
+}
+
+int FusedElementwiseArity(FusedElementwiseCode code) {
+  if (code == kFusedInput) return 0;
+  return code <= kFusedDiv ? 2 : 1;
+}
+
+Status ParseFusedElementwiseProgram(const std::string& program, int64_t inputs,
+                                    FusedElementwiseProgram* prog) {
+  std::istringstream iss(program);
+  std::string token;
+  int top = 0;
+  prog->size = 0;
+  prog->depth = 0;
+  while (iss >> token) {
+    XDL_CHECK_COND(prog->size < kFusedMaxOps,
+                   Status::ArgumentError("fused program too long: " + program));
+    FusedElementwiseCode code = kFusedInput;
+    int arg = 0;
+    if (token[0] == '$') {
+      arg = atoi(token.c_str() + 1);
+      XDL_CHECK_COND(arg >= 0 && arg < inputs,
+                     Status::ArgumentError("fused program input error: " + token));
+    } else {
+      XDL_CHECK_COND(FusedElementwiseCodeOf(token, &code),
+                     Status::ArgumentError("fused program op error: " + token));
+    }
+    int arity = FusedElementwiseArity(code);
+    XDL_CHECK_COND(top >= arity,
+                   Status::ArgumentError("fused program stack error: " + program));
+    top += 1 - arity;
+    prog->depth = std::max(prog->depth, top);
+    prog->code[prog->size] = code;
+    prog->arg[prog->size] = arg;
+    prog->size++;
+  }
+  XDL_CHECK_COND(top == 1 && prog->size > 1,
+                 Status::ArgumentError("fused program stack error: " + program));
+  return Status::Ok();
+}
+
+template <typename T>
+class FusedElementwiseOp : public OpKernel {
+ public:
+  Status Init(OpKernelConstruction* ctx) override {
+    std::string program;
+    int64_t size;
+    XDL_CHECK_STATUS(ctx->GetAttr("program", &program));
+    XDL_CHECK_STATUS(ctx->GetAttr("size", &size));
+    return ParseFusedElementwiseProgram(program, size, &prog_);
+  }
+
+  Status Compute(OpKernelContext* ctx) override {
+    FusedElementwiseArgs<T> args;
+    Tensor out;
+    XDL_CHECK_STATUS(PrepareFusedElementwise<T>(ctx, &args, &out));
+    int64_t n = out.Shape().NumElements();
+    T* pout = out.Raw<T>();
+    int64_t blocks = (n + kFusedBlock - 1) / kFusedBlock;
+    #pragma omp parallel if (blocks > 1)
+    {
+      std::vector<T> buf(prog_.depth * kFusedBlock);
+      #pragma omp for
+      for (int64_t b = 0; b < blocks; b++) {
+        int64_t begin = b * kFusedBlock;
+        EvalBlock<T>(prog_, args, begin, std::min(kFusedBlock, n - begin),
+                     buf.data(), pout + begin);
+      }
+    }
+    return Status::Ok();
+  }
+
+ private:
+  FusedElementwiseProgram prog_;
+};
+
+XDL_DEFINE_OP(FusedElementwise)
+  .Attr("dtype", AttrValue::kDataType)
+  .Attr("size", AttrValue::kInt)
+  .Attr("program", AttrValue::kString)
+  .InputList("input", "dtype", "size")
+  .Output("out", "dtype");
+
+#define REGISTER_KERNEL(T)                                          \
+  XDL_REGISTER_KERNEL(FusedElementwise, FusedElementwiseOp<T>)      \
+  .Device("CPU")                                                    \
+  .AttrDataType<T>("dtype");
+
+REGISTER_KERNEL(float);
+REGISTER_KERNEL(double);
+
+#undef REGISTER_KERNEL
+
+}  // namespace xdl
@@ -0,0 +1,83 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/core/ops/fused_elementwise_op.h"
+
+#include "xdl/core/framework/op_registry.h"
+#include "xdl/core/framework/gpu/gpu_device.h"
+#include "xdl/core/lib/common_defines.h"
+
+#include <cuda_runtime_api.h>
+
+namespace xdl {
+
+namespace {
+
+template <typename T>
+__global__ void FusedElementwiseKernel(FusedElementwiseProgram prog,
+                                       FusedElementwiseArgs<T> args,
+                                       size_t n, T* out) {
+  CUDA_KERNEL_LOOP(idx, n) {
+    out[idx] = FusedElementwiseEval<T>(prog, args, idx);
+  }
+}
+
+}  // namespace
+
+// One kernel evaluates the fused chain, which launched a kernel and wrote
+// an intermediate tensor per op
+template <typename T>
+class FusedElementwiseGpuOp : public GpuOpKernel {
+ public:
+  Status Init(OpKernelConstruction* ctx) override {
+    std::string program;
+    int64_t size;
+    XDL_CHECK_STATUS(ctx->GetAttr("program", &program));
+    XDL_CHECK_STATUS(ctx->GetAttr("size", &size));
+    return ParseFusedElementwiseProgram(program, size, &prog_);
+  }
+
+  Status LaunchKernel(OpKernelContext* ctx, CudaStream* stream) override {
+    FusedElementwiseArgs<T> args;
+    Tensor out;
+    XDL_CHECK_STATUS(PrepareFusedElementwise<T>(ctx, &args, &out));
+    size_t n = out.Shape().NumElements();
+    if (n == 0) {
+      return Status::Ok();
+    }
+    size_t blocks = CUDA_GET_BLOCKS(n);
+    FusedElementwiseKernel<T><<<
+        blocks,
+        CUDA_GET_THREADS(n, blocks),
+        0,
+        stream->GetInternal()>>>(prog_, args, n, out.Raw<T>());
+    return Status::Ok();
+  }
+
+ private:
+  FusedElementwiseProgram prog_;
+};
+
+#define REGISTER_GPU_KERNEL(T)                                       \
+  XDL_REGISTER_KERNEL(FusedElementwise, FusedElementwiseGpuOp<T>)    \
+  .Device("GPU")                                                     \
+  .AttrDataType<T>("dtype")
+
+REGISTER_GPU_KERNEL(float);
+REGISTER_GPU_KERNEL(double);
+
+#undef REGISTER_GPU_KERNEL
+
+}  // namespace xdl
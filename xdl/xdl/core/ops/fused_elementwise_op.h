@@ -0,0 +1,240 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XDL_CORE_OPS_FUSED_ELEMENTWISE_OP_H_
+#define XDL_CORE_OPS_FUSED_ELEMENTWISE_OP_H_
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "xdl/core/framework/op_kernel.h"
+#include "xdl/core/lib/common_defines.h"
+
+// common_defines.h defines it for the gpu builds only
+#ifndef CUDA_XCALL_INL
+#define CUDA_XCALL_INL __inline__
+#endif
+
+namespace xdl {
+
+// The elementwise ops a FusedElementwise op evaluates, named as the ops of
+// core/ops/eigen_ops they replace
+enum FusedElementwiseCode {
+  kFusedInput = 0,
+  kFusedAdd,
+  kFusedSub,
+  kFusedMul,
+  kFusedDiv,
+  kFusedNegative,
+  kFusedLog,
+  kFusedLog1p,
+  kFusedSqrt,
+  kFusedFloor,
+  kFusedCeil,
+  kFusedSin,
+  kFusedCos,
+  kFusedTan,
+  kFusedAsin,
+  kFusedAcos,
+  kFusedAtan,
+  kFusedSinh,
+  kFusedCosh,
+  kFusedTanh,
+  kFusedAsinh,
+  kFusedAcosh,
+  kFusedAtanh
+};
+
+const int kFusedMaxOps = 32;
+const int kFusedMaxInputs = 8;
+const int kFusedMaxDims = 4;
+
+// The program of a fused op in postfix order, code[i] == kFusedInput pushes
+// the input arg[i], the others pop their operands and push the result. It is
+// passed by value to the gpu kernel.
+struct FusedElementwiseProgram {
+  int size;
+  int depth;  // the max size of the stack
+  int8_t code[kFusedMaxOps];
+  int8_t arg[kFusedMaxOps];
+};
+
+// Parses the program attr, e.g. "$0 $1 Add Log" is Log(Add(input0, input1))
+Status ParseFusedElementwiseProgram(const std::string& program, int64_t inputs,
+                                    FusedElementwiseProgram* prog);
+// The code of the elementwise op, false if it can not be fused
+bool FusedElementwiseCodeOf(const std::string& op, FusedElementwiseCode* code);
+// The operands code pops
+int FusedElementwiseArity(FusedElementwiseCode code);
+
+// How an input is read at an output element
+enum FusedInputMode {
+  kFusedDense = 0,  // the input has the output shape
+  kFusedScalar,     // the input has one element
+  kFusedStrided     // the input is broadcast by stride
+};
+
+template <typename T>
+struct FusedElementwiseArgs {
+  const T* in[kFusedMaxInputs];
+  int8_t mode[kFusedMaxInputs];
+  int64_t stride[kFusedMaxInputs][kFusedMaxDims];
+  int64_t dims[kFusedMaxDims];
+  int ndims;
+  bool strided;
+};
+
+// Broadcasts the inputs as the binary eigen ops do, the dims aligned at the
+// left and padded with 1, and allocates the output
+template <typename T>
+Status PrepareFusedElementwise(OpKernelContext* ctx,
+                               FusedElementwiseArgs<T>* args, Tensor* out) {
+  std::vector<Tensor> inputs;
+  XDL_CHECK_STATUS(ctx->GetInputList("input", &inputs));
+  XDL_CHECK_COND(!inputs.empty() && inputs.size() <= kFusedMaxInputs,
+                 Status::ArgumentError("fused elementwise input size error"));
+  bool same = true;
+  for (auto&& input : inputs) {
+    same = same && input.Shape().Dims() == inputs[0].Shape().Dims();
+  }
+  args->strided = false;
+  args->ndims = 0;
+  if (same) {
+    for (size_t i = 0; i < inputs.size(); i++) {
+      args->in[i] = inputs[i].Raw<T>();
+      args->mode[i] = kFusedDense;
+    }
+    return ctx->AllocateOutput(0, inputs[0].Shape(), out);
+  }
+
+  std::vector<size_t> dims;
+  for (auto&& input : inputs) {
+    const std::vector<size_t>& in_dims = input.Shape().Dims();
+    XDL_CHECK_COND(in_dims.size() <= kFusedMaxDims,
+                   Status::Internal("Dim more than 4 is not supported"));
+    if (in_dims.size() > dims.size()) {
+      dims.resize(in_dims.size(), 1);
+    }
+    for (size_t d = 0; d < in_dims.size(); d++) {
+      if (in_dims[d] == 1) continue;
+      XDL_CHECK_COND(dims[d] == 1 || dims[d] == in_dims[d],
+                     Status::ArgumentError(
+                         "Dim Error " + input.Shape().DebugString() +
+                         " vs " + inputs[0].Shape().DebugString()));
+      dims[d] = in_dims[d];
+    }
+  }
+  args->ndims = dims.size();
+  for (size_t d = 0; d < dims.size(); d++) {
+    args->dims[d] = dims[d];
+  }
+  for (size_t i = 0; i < inputs.size(); i++) {
+    std::vector<size_t> in_dims = inputs[i].Shape().Dims();
+    in_dims.resize(dims.size(), 1);
+    args->in[i] = inputs[i].Raw<T>();
+    if (in_dims == dims) {
+      args->mode[i] = kFusedDense;
+    } else if (inputs[i].Shape().NumElements() == 1) {
+      args->mode[i] = kFusedScalar;
+    } else {
+      args->mode[i] = kFusedStrided;
+      args->strided = true;
+      int64_t stride = 1;
+      for (int d = args->ndims - 1; d >= 0; d--) {
+        args->stride[i][d] = in_dims[d] == 1 ? 0 : stride;
+        stride *= in_dims[d];
+      }
+    }
+  }
+  return ctx->AllocateOutput(0, TensorShape(dims), out);
+}
+
+// The offset of the output element idx into the input i
+template <typename T>
+CUDA_XCALL_INL int64_t FusedInputOffset(const FusedElementwiseArgs<T>& args,
+                                        int i, int64_t idx) {
+  if (args.mode[i] == kFusedDense) return idx;
+  if (args.mode[i] == kFusedScalar) return 0;
+  int64_t offset = 0;
+  for (int d = args.ndims - 1; d >= 0; d--) {
+    offset += idx % args.dims[d] * args.stride[i][d];
+    idx /= args.dims[d];
+  }
+  return offset;
+}
+
+// The unary and binary ops, written as the functors of the eigen ops
+// so that the fused results are the same
+template <typename T>
+CUDA_XCALL_INL T FusedBinary(int code, T lhs, T rhs) {
+  switch (code) {
+    case kFusedAdd: return lhs + rhs;
+    case kFusedSub: return lhs - rhs;
+    case kFusedMul: return lhs * rhs;
+    default: return lhs / rhs;
+  }
+}
+
+template <typename T>
+CUDA_XCALL_INL T FusedUnary(int code, T in) {
+  switch (code) {
+    case kFusedNegative: return -in;
+    case kFusedLog: return log(in);
+    case kFusedLog1p: return log1p(in);
+    case kFusedSqrt: return sqrt(in);
+    case kFusedFloor: return floor(in);
+    case kFusedCeil: return ceil(in);
+    case kFusedSin: return sin(in);
+    case kFusedCos: return cos(in);
+    case kFusedTan: return tan(in);
+    case kFusedAsin: return asin(in);
+    case kFusedAcos: return acos(in);
+    case kFusedAtan: return atan(in);
+    case kFusedSinh: return sinh(in);
+    case kFusedCosh: return cosh(in);
+    case kFusedTanh: return tanh(in);
+    case kFusedAsinh: return asinh(in);
+    case kFusedAcosh: return acosh(in);
+    default: return atanh(in);
+  }
+}
+
+// Evaluates the program at the output element idx, the intermediates stay
+// in registers
+template <typename T>
+CUDA_XCALL_INL T FusedElementwiseEval(const FusedElementwiseProgram& prog,
+                                      const FusedElementwiseArgs<T>& args,
+                                      int64_t idx) {
+  T stack[kFusedMaxOps];
+  int top = 0;
+  for (int p = 0; p < prog.size; p++) {
+    int code = prog.code[p];
+    if (code == kFusedInput) {
+      int i = prog.arg[p];
+      stack[top++] = args.in[i][FusedInputOffset(args, i, idx)];
+    } else if (code <= kFusedDiv) {
+      top--;
+      stack[top - 1] = FusedBinary<T>(code, stack[top - 1], stack[top]);
+    } else {
+      stack[top - 1] = FusedUnary<T>(code, stack[top - 1]);
+    }
+  }
+  return stack[0];
+}
+
+}  // namespace xdl
+
+#endif  // XDL_CORE_OPS_FUSED_ELEMENTWISE_OP_H_
@@ -14,6 +14,9 @@
  * limitations under the License.
 */
 
+#include <omp.h>
+#include <string.h>
+
 #include "xdl/core/utils/logging.h"
 
 #include "xdl/core/framework/op_kernel.h"
@@ -24,6 +27,9 @@ namespace xdl {
 
 namespace {
 
+// groups of fewer samples are sorted by std::sort
+const size_t kRadixSortMin = 256;
+
 template <typename T>
 T GetNonClick(T* plabels, size_t k, int dim) {
   if (dim == 1) return 1.0 - plabels[k];
@@ -36,12 +42,89 @@ T GetClick(T* plabels, size_t k, int dim) {
   return plabels[2 * k + 1];
 }
 
+template <typename T> struct RadixKey;
+template <> struct RadixKey<float> { typedef uint32_t Type; };
+template <> struct RadixKey<double> { typedef uint64_t Type; };
+
+// The unsigned key ordered as the float, negatives have every bit flipped
+// and the others the sign bit only
+template <typename T>
+typename RadixKey<T>::Type ToRadixKey(T value) {
+  typedef typename RadixKey<T>::Type K;
+  K key;
+  memcpy(&key, &value, sizeof(key));
+  const K sign = K(1) << (sizeof(K) * 8 - 1);
+  return (key & sign) ? ~key : key | sign;
+}
+
+// The buffers of a thread, reused by its groups
+template <typename T>
+struct SortBuffer {
+  typedef typename RadixKey<T>::Type K;
+  std::vector<std::pair<K, size_t>> items;
+  std::vector<std::pair<K, size_t>> swap;
+};
+
+// Sorts pidx[l, r) by the click prediction, ascending and stable, by a LSD
+// radix sort of 8 bits a pass which skips the digits shared by the group
+template <typename T>
+void SortGroup(T* ppreds, size_t* pidx, size_t l, size_t r, int dim,
+               SortBuffer<T>* buffer) {
+  typedef typename RadixKey<T>::Type K;
+  size_t n = r - l;
+  if (n < kRadixSortMin) {
+    std::stable_sort(pidx + l, pidx + r, [ppreds, dim](size_t a, size_t b) {
+      return GetClick<T>(ppreds, a, dim) < GetClick<T>(ppreds, b, dim);
+    });
+    return;
+  }
+  auto& items = buffer->items;
+  auto& swap = buffer->swap;
+  items.resize(n);
+  swap.resize(n);
+  K diff = 0;
+  for (size_t k = 0; k < n; ++k) {
+    items[k].first = ToRadixKey<T>(GetClick<T>(ppreds, pidx[l + k], dim));
+    items[k].second = pidx[l + k];
+    diff |= items[k].first ^ items[0].first;
+  }
+  for (size_t shift = 0; shift < sizeof(K) * 8; shift += 8) {
+    if (((diff >> shift) & 0xFF) == 0) continue;
+    size_t count[257] = {0};
+    for (size_t k = 0; k < n; ++k) {
+      ++count[((items[k].first >> shift) & 0xFF) + 1];
+    }
+    for (size_t d = 0; d < 256; ++d) {
+      count[d + 1] += count[d];
+    }
+    for (size_t k = 0; k < n; ++k) {
+      swap[count[(items[k].first >> shift) & 0xFF]++] = items[k];
+    }
+    items.swap(swap);
+  }
+  for (size_t k = 0; k < n; ++k) {
+    pidx[l + k] = items[k].second;
+  }
+}
+
+bool AucResult(double fp, double tp, double auc, size_t l, size_t r, double* ret) {
+  double threshold = static_cast<double>(r - l) - 1e-3;
+  if (tp > threshold or fp > threshold) {
+    *ret = -0.5;
+    return true;
+  }
+  if (tp * fp > 0) {
+    *ret = (1.0 - auc / (2.0 * tp * fp));
+    return true;
+  }
+  return false;
+}
+
 template <typename T>
 bool ComputeGauc(T* plabels, T* ppreds, T* pfilter, size_t* pidx,
-                 size_t l, size_t r, int dim, double* ret) {
-  std::sort(pidx + l, pidx + r, [ppreds, dim](size_t a, size_t b) {
-    return GetClick<T>(ppreds, a, dim) < GetClick<T>(ppreds, b, dim);
-  });
+                 size_t l, size_t r, int dim, SortBuffer<T>* buffer,
+                 double* ret) {
+  SortGroup<T>(ppreds, pidx, l, r, dim, buffer);
   double fp1, tp1, fp2, tp2, auc;
   fp1 = tp1 = fp2 = tp2 = auc = 0;
   size_t i;
@@ -54,24 +137,49 @@ bool ComputeGauc(T* plabels, T* ppreds, T* pfilter, size_t* pidx,
     fp1 = fp2;
     tp1 = tp2;
   }
-  double threshold = static_cast<double>(r - l) - 1e-3;
-  if (tp2 > threshold or fp2 > threshold) {
-    *ret = -0.5;
-    return true;
+  return AucResult(fp2, tp2, auc, l, r, ret);
+}
+
+// The auc over num_buckets equal buckets of the prediction in [0, 1], the
+// samples of a bucket count as tied. No sort, so a group costs O(n).
+template <typename T>
+bool ComputeBucketGauc(T* plabels, T* ppreds, T* pfilter, size_t l, size_t r,
+                       int dim, int64_t num_buckets,
+                       std::vector<std::pair<double, double>>* buckets,
+                       double* ret) {
+  buckets->assign(num_buckets, std::make_pair(0.0, 0.0));
+  for (size_t i = l; i < r; ++i) {
+    if (pfilter != nullptr && pfilter[i] == 0) continue;
+    double pred = GetClick<T>(ppreds, i, dim);
+    int64_t b = static_cast<int64_t>(pred * num_buckets);
+    b = std::min(std::max(b, int64_t(0)), num_buckets - 1);
+    (*buckets)[b].first += GetNonClick<T>(plabels, i, dim);
+    (*buckets)[b].second += GetClick<T>(plabels, i, dim);
   }
-  if (tp2 * fp2 > 0) {
-    *ret = (1.0 - auc / (2.0 * tp2 * fp2));
-    return true;
+  double fp1, tp1, fp2, tp2, auc;
+  fp1 = tp1 = fp2 = tp2 = auc = 0;
+  for (const auto& bucket : *buckets) {
+    fp2 += bucket.first;
+    tp2 += bucket.second;
+    auc += (fp2 - fp1) * (tp2 + tp1);
+    fp1 = fp2;
+    tp1 = tp2;
   }
-  return false;
+  return AucResult(fp2, tp2, auc, l, r, ret);
 }
 
 }  // namespace
 
+// The groups are the runs of equal indicator, the first run and the last one
+// may be cut by the batch and are skipped. The groups are shared by the
+// threads with a dynamic schedule, as their sizes differ by a lot.
 template <typename T, typename I>
 class GaucCalcOp : public OpKernel {
  public:
   Status Init(OpKernelConstruction* ctx) override {
+    XDL_CHECK_STATUS(ctx->GetAttr("num_buckets", &num_buckets_));
+    XDL_CHECK_COND(num_buckets_ >= 0,
+                   Status::ArgumentError("num_buckets must not be negative"));
     return Status::Ok();
   }
 
@@ -100,36 +208,51 @@ class GaucCalcOp : public OpKernel {
     }
     XDL_CHECK_STATUS(ctx->AllocateOutput(0, TensorShape({}), &gauc));
     XDL_CHECK_STATUS(ctx->AllocateOutput(1, TensorShape({}), &pv_num));
-    *(gauc.Raw<double>()) = 0;
-    *(pv_num.Raw<int64_t>()) = 0;
 
     T* plabels = labels.Raw<T>(), *ppreds = predicts.Raw<T>();
     I* pind = indicator.Raw<I>();
-    std::vector<size_t> index(n);
-    for (size_t i = 0; i < n; ++i) {
-      index[i] = i;
+    // begin of each group, then the end of the last one
+    std::vector<size_t> bounds;
+    for (size_t end = 1; end < n; ++end) {
+      if (pind[end] != pind[end - 1]) bounds.push_back(end);
+    }
+    std::vector<size_t> index;
+    if (num_buckets_ == 0) {
+      index.resize(n);
+      for (size_t i = 0; i < n; ++i) {
+        index[i] = i;
+      }
     }
     size_t* pidx = index.data();
-    size_t begin = 0;
-    bool first = true;
-    for (size_t end = 0; end < n; ++end) {
-      if (pind[end] != pind[begin]) {
-        if (first) {
-          first = false;
-        } else {
-          double auc = 0;
-          if (ComputeGauc<T>(plabels, ppreds, pfilter, pidx, begin, end, ldim, &auc)) {
-              if (auc >= 0) {
-                *(gauc.Raw<double>()) += auc * (end - begin);
-                *(pv_num.Raw<int64_t>()) += (end - begin);
-              }
-          }
+    int64_t groups = bounds.empty() ? 0 : bounds.size() - 1;
+    double gauc_sum = 0;
+    int64_t pv_sum = 0;
+    #pragma omp parallel reduction(+:gauc_sum, pv_sum)
+    {
+      SortBuffer<T> buffer;
+      std::vector<std::pair<double, double>> buckets;
+      #pragma omp for schedule(dynamic, 16)
+      for (int64_t g = 0; g < groups; ++g) {
+        size_t begin = bounds[g], end = bounds[g + 1];
+        double auc = 0;
+        bool ok = num_buckets_ == 0 ?
+            ComputeGauc<T>(plabels, ppreds, pfilter, pidx, begin, end, ldim,
+                           &buffer, &auc) :
+            ComputeBucketGauc<T>(plabels, ppreds, pfilter, begin, end, ldim,
+                                 num_buckets_, &buckets, &auc);
+        if (ok && auc >= 0) {
+          gauc_sum += auc * (end - begin);
+          pv_sum += end - begin;
         }
-        begin = end;
       }
     }
+    *(gauc.Raw<double>()) = gauc_sum;
+    *(pv_num.Raw<int64_t>()) = pv_sum;
     return Status::Ok();
   }
+
+ private:
+  int64_t num_buckets_;
 };
 
 XDL_DEFINE_OP(GaucCalcOp)
@@ -140,7 +263,8 @@ XDL_DEFINE_OP(GaucCalcOp)
   .Output("gauc", DataType::kDouble)
   .Output("pv_num", DataType::kInt64)
   .Attr("dtype", AttrValue::kDataType)
-  .Attr("itype", AttrValue::kDataType);
+  .Attr("itype", AttrValue::kDataType)
+  .Attr("num_buckets", AttrValue::kInt, 0);
 
 #define REGISTER_KERNEL(T, I)                       \
   XDL_REGISTER_KERNEL(GaucCalcOp, GaucCalcOp<T, I>) \
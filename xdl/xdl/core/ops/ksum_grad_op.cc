@@ -24,6 +24,7 @@
 #include "xdl/core/framework/op_registry.h"
 #include "xdl/core/framework/cpu_device.h"
 #include "xdl/core/lib/atomic.h"
+#include "xdl/core/lib/parallel.h"
 #include "ps-plus/ps-plus/common/thread_pool.h"
 
 namespace xdl {
@@ -165,17 +166,27 @@ Status KSumGradOp<T, I>::Compute(OpKernelContext* ctx) {
       return Status::Ok();
     }
   
+    size_t out_row = embed_shape[0];
+    std::vector<size_t> offsets, positions;
+    common::row_bucket_generate(pidx, id_size, out_row, &offsets, &positions);
+    std::vector<std::tuple<size_t, size_t, size_t>> splits;
+    common::parallel_split_generate(out_row, omp_get_max_threads(), &splits);
     #pragma omp parallel for
-    for(size_t i = 0; i < id_size; ++i) {
-      size_t grp_idx = std::lower_bound(pgrp, pgrp + grp_size, i + 1) - pgrp;
-      size_t grp_width = (grp_idx == 0) ? pgrp[grp_idx] : (pgrp[grp_idx] - pgrp[grp_idx - 1]);
-      if (grp_width == 0) continue;
-      const T* src = pgrad + grp_idx * eb_dim;
-      T* dst = pout + pidx[i] * eb_dim;
-      for (size_t k = 0; k < eb_dim; ++k) {
-        T val = (pval != nullptr) ? pval[i] * src[k] : src[k];
-        if (average_) val /= grp_width;
-        common::cpu_atomic_add<T>(val, dst + k);
+    for (size_t s = 0; s < splits.size(); ++s) {
+      for (size_t r = std::get<1>(splits[s]); r < std::get<2>(splits[s]); ++r) {
+        T* dst = pout + r * eb_dim;
+        for (size_t p = offsets[r]; p < offsets[r + 1]; ++p) {
+          size_t i = positions[p];
+          size_t grp_idx = std::lower_bound(pgrp, pgrp + grp_size, i + 1) - pgrp;
+          size_t grp_width = (grp_idx == 0) ? pgrp[grp_idx] : (pgrp[grp_idx] - pgrp[grp_idx - 1]);
+          if (grp_width == 0) continue;
+          const T* src = pgrad + grp_idx * eb_dim;
+          T scale = average_ ? pval[i] / grp_width : pval[i];
+          #pragma omp simd
+          for (size_t k = 0; k < eb_dim; ++k) {
+            dst[k] += scale * src[k];
+          }
+        }
       }
     }
   } else {
@@ -17,8 +17,7 @@
 #include "xdl/core/ops/ksum_op.h"
 #include "xdl/core/framework/op_registry.h"
 #include "xdl/core/lib/common_defines.h"
-#include "xdl/core/lib/atomic.h"
-#include "xdl/core/lib/binary_search.h"
+#include "xdl/core/lib/gpu_row.h"
 #include "xdl/core/framework/gpu/gpu_device.h"
 
 #include <cuda_runtime_api.h>
@@ -26,29 +25,52 @@
 namespace xdl {
 namespace {
 
-template <typename T, typename I>
-__global__ void KSumKernel(const T* peb, const I* pidx, const T* pval,
-                           const I* pgrp, size_t grp_size, size_t eb_dim,
-                           bool average, T* pout) {
-  int idx = blockIdx.x * blockDim.x + threadIdx.x;
-  if (idx >= pgrp[grp_size - 1]) return;
-
-  const I* p = LowerBound(pgrp, pgrp + grp_size, idx + 1);
-  size_t grp_idx = p - pgrp;
-
-  size_t grp_width = (grp_idx == 0) ? p[0]
-                                    : (p[0] - p[-1]);
-  if (grp_width == 0) return;
-
-  const T* src = peb + pidx[idx] * eb_dim;
-  T* dst = pout + grp_idx * eb_dim;
-  for (size_t k = 0; k < eb_dim; ++k) {
-    T val = (pval != nullptr) ? pval[idx] * src[k] : src[k];
-    if (average) val /= grp_width;
-    common::gpu_atomic_add<T>(val, dst + k);
+// Sums the ids of a group by row_threads threads, the ids of a group are
+// contiguous, so each output row is written once without atomics
+template <typename T, typename I, typename V>
+__global__ void KSumRowKernel(const T* peb, const I* pidx, const T* pval,
+                              const I* pgrp, size_t grp_size, size_t eb_dim,
+                              bool average, int row_threads, T* pout) {
+  const int kLanes = sizeof(V) / sizeof(T);
+  const size_t cols = eb_dim / kLanes;
+  const size_t lane = threadIdx.x % row_threads;
+  const size_t rows_per_grid = gridDim.x * (blockDim.x / row_threads);
+  for (size_t g = blockIdx.x * (blockDim.x / row_threads) +
+                  threadIdx.x / row_threads;
+       g < grp_size; g += rows_per_grid) {
+    I beg = g == 0 ? 0 : pgrp[g - 1], end = pgrp[g];
+    V* dst = reinterpret_cast<V*>(pout + g * eb_dim);
+    for (size_t k = lane; k < cols; k += row_threads) {
+      V acc;
+      T* sum = reinterpret_cast<T*>(&acc);
+      for (int l = 0; l < kLanes; ++l) sum[l] = 0;
+      for (I i = beg; i < end; ++i) {
+        V v = reinterpret_cast<const V*>(peb + pidx[i] * eb_dim)[k];
+        const T* src = reinterpret_cast<const T*>(&v);
+        for (int l = 0; l < kLanes; ++l) {
+          T val = (pval != nullptr) ? pval[i] * src[l] : src[l];
+          if (average) val /= (end - beg);
+          sum[l] += val;
+        }
+      }
+      dst[k] = acc;
+    }
   }
 }
 
+template <typename T, typename I, typename V>
+void LaunchKSumRow(const T* peb, const I* pidx, const T* pval,
+                   const I* pgrp, size_t grp_size, size_t eb_dim,
+                   bool average, T* pout, cudaStream_t st) {
+  int row_threads = common::RowThreads(eb_dim / (sizeof(V) / sizeof(T)));
+  KSumRowKernel<T, I, V><<<
+      common::RowBlocks(grp_size, row_threads),
+      common::kRowBlockThreads,
+      0,
+      st>>>(peb, pidx, pval, pgrp, grp_size, eb_dim, average, row_threads,
+            pout);
+}
+
 }  // namespace
 
 template <typename T, typename I>
@@ -113,16 +135,21 @@ Status KSumGpuOp<T, I>::LaunchKernel(OpKernelContext* ctx, CudaStream* stream) {
   XDL_CHECK_STATUS(ctx->AllocateOutput(0, out_shape, &output));
   T* pout = output.Raw<T>();
   size_t bytes = sizeof(T) * out_shape.NumElements();
-  CUDA_CHECK(cudaMemsetAsync(pout, 0, bytes, stream->GetInternal()));
-  if (id_size == 0) return Status::Ok();
+  if (id_size == 0) {
+    CUDA_CHECK(cudaMemsetAsync(pout, 0, bytes, stream->GetInternal()));
+    return Status::Ok();
+  }
+  if (grp_size == 0) return Status::Ok();
 
-  size_t blocks = CUDA_GET_BLOCKS(id_size);
-  KSumKernel<T, I><<<
-      blocks,
-      CUDA_GET_THREADS(id_size, blocks),
-      0,
-      stream->GetInternal()>>>(peb, pidx, pval, pgrp, grp_size,
-                               eb_dim, average_, pout);
+  // each group row is written, the empty ones with 0
+  if (common::RowAligned<T>(peb, eb_dim) && common::RowAligned<T>(pout, eb_dim)) {
+    LaunchKSumRow<T, I, typename common::RowVec<T>::Type>(
+        peb, pidx, pval, pgrp, grp_size, eb_dim, average_, pout,
+        stream->GetInternal());
+  } else {
+    LaunchKSumRow<T, I, T>(peb, pidx, pval, pgrp, grp_size, eb_dim,
+                           average_, pout, stream->GetInternal());
+  }
   return Status::Ok();
 }
 
@@ -19,31 +19,32 @@
 #include "xdl/core/framework/op_kernel.h"
 #include "xdl/core/framework/op_registry.h"
 #include "xdl/core/lib/common_defines.h"
-#include "xdl/core/lib/atomic.h"
+#include "xdl/core/lib/gpu_row.h"
 #include "xdl/core/framework/gpu/gpu_device.h"
 #include "xdl/core/utils/logging.h"
 
 namespace xdl {
 namespace {
 
+// Counts the ids of a sample in each group, a thread per sample, so the
+// counts are written once without atomics
 template <typename I>
 __global__ void MergeGroupKernel(I** seg_list,
                                  size_t seg_size,
                                  size_t grp_size,
-                                 size_t num,
                                  I* out_seg,
                                  I* out_grp) {
-  int idx = threadIdx.x + blockIdx.x * blockDim.x;
-  if (idx >= num) return;
-  int grp_idx = idx / seg_size;
-  int seg_idx = idx % seg_size;
-  int grp_off = seg_idx * grp_size + grp_idx;
-
-  const I* pseg = seg_list[grp_idx];
-  I id_cnt = (seg_idx == 0) ? pseg[0] 
-                            : (pseg[seg_idx] - pseg[seg_idx - 1]);
-  common::gpu_atomic_add<I>(id_cnt, out_seg + seg_idx);
-  common::gpu_atomic_add<I>(id_cnt, out_grp + grp_off);
+  CUDA_KERNEL_LOOP(seg_idx, seg_size) {
+    I total = 0;
+    for (size_t grp_idx = 0; grp_idx < grp_size; ++grp_idx) {
+      const I* pseg = seg_list[grp_idx];
+      I id_cnt = (seg_idx == 0) ? pseg[0]
+                                : (pseg[seg_idx] - pseg[seg_idx - 1]);
+      out_grp[seg_idx * grp_size + grp_idx] = id_cnt;
+      total += id_cnt;
+    }
+    out_seg[seg_idx] = total;
+  }
 }
 
 template <typename I>
@@ -55,6 +56,8 @@ __global__ void ReduceKernel(I* group, size_t size) {
   }
 }
 
+// Copies the ids of a sample of a group by a warp, the ids are contiguous
+// in both the input and the output
 template <typename T, typename V, typename I>
 __global__ void MergeSparseKernel(T** id_list,
                                   V** val_list,
@@ -66,26 +69,35 @@ __global__ void MergeSparseKernel(T** id_list,
                                   size_t id_dim,
                                   T* out_id,
                                   V* out_val) {
-  int idx = threadIdx.x + blockIdx.x * blockDim.x;
-  if (idx >= num) return;
-  int grp_idx = idx / seg_size;
-  int seg_idx = idx % seg_size;
-  int grp_off = seg_idx * grp_size + grp_idx;
-
-  const T* pid = id_list[grp_idx];
-  const V* pval = val_list[grp_idx];
-  const I* pseg = seg_list[grp_idx];
-
-  I src_off = seg_idx == 0 ? 0 : pseg[seg_idx - 1];
-  I dst_off = grp_off == 0 ? 0 : pgrp[grp_off - 1];
-  I id_cnt = grp_off == 0 ? pgrp[0] :
-                            pgrp[grp_off] - pgrp[grp_off - 1];
-
-  for (I i = 0; i < id_cnt; ++i) {
-    for (size_t j = 0; j < id_dim; ++j) {
-      out_id[(dst_off + i) * id_dim + j] = pid[(src_off + i) * id_dim +j];
+  const int kWarpSize = 32;
+  const size_t lane = threadIdx.x % kWarpSize;
+  const size_t warps = gridDim.x * (blockDim.x / kWarpSize);
+  for (size_t idx = blockIdx.x * (blockDim.x / kWarpSize) +
+                    threadIdx.x / kWarpSize;
+       idx < num; idx += warps) {
+    int grp_idx = idx / seg_size;
+    int seg_idx = idx % seg_size;
+    int grp_off = seg_idx * grp_size + grp_idx;
+
+    const T* pid = id_list[grp_idx];
+    const V* pval = val_list[grp_idx];
+    const I* pseg = seg_list[grp_idx];
+
+    I src_off = seg_idx == 0 ? 0 : pseg[seg_idx - 1];
+    I dst_off = grp_off == 0 ? 0 : pgrp[grp_off - 1];
+    I id_cnt = grp_off == 0 ? pgrp[0] :
+                              pgrp[grp_off] - pgrp[grp_off - 1];
+
+    const T* src = pid + src_off * id_dim;
+    T* dst = out_id + dst_off * id_dim;
+    for (size_t j = lane; j < id_cnt * id_dim; j += kWarpSize) {
+      dst[j] = src[j];
+    }
+    if (pval) {
+      for (I i = lane; i < id_cnt; i += kWarpSize) {
+        out_val[dst_off + i] = pval[src_off + i];
+      }
     }
-    if (pval) out_val[dst_off + i] = pval[src_off + i];
   }
 }
 
@@ -173,17 +185,18 @@ Status MergeSparseGpuOp<T, V, I>::LaunchKernel(OpKernelContext* ctx,
   }
 
   size_t num = seg_size * group_size;
-  size_t blocks = CUDA_GET_BLOCKS(num);
+  if (num == 0) return Status::Ok();
+  size_t blocks = CUDA_GET_BLOCKS(seg_size);
   MergeGroupKernel<I><<<
       blocks,
-      CUDA_GET_THREADS(num, blocks),
+      CUDA_GET_THREADS(seg_size, blocks),
       0,
-      st>>>(pseg_list, seg_size, group_size, num, pseg, pgrp);
+      st>>>(pseg_list, seg_size, group_size, pseg, pgrp);
   ReduceKernel<I><<<1, 1, 0, st>>>(pseg, seg_size);
   ReduceKernel<I><<<1, 1, 0, st>>>(pgrp, num);
   MergeSparseKernel<T, V, I><<<
-      blocks,
-      CUDA_GET_THREADS(num, blocks),
+      common::RowBlocks(num, 32),
+      common::kRowBlockThreads,
       0,
       st>>>(pid_list, pval_list, pseg_list, pgrp,
             seg_size, group_size, num, id_num, pid, pvalue);
@@ -0,0 +1,77 @@
+/* Copyright 2018 Alibaba Group. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/core/lib/status.h"
+#include "xdl/core/framework/op_kernel.h"
+#include "xdl/core/framework/op_define.h"
+#include "xdl/core/framework/op_registry.h"
+
+namespace xdl {
+
+// Lays the tensors out contiguously in one 1-D tensor, which feeds the
+// dense backend as a single tensor instead of one per embedding. offsets
+// holds the element offset of each tensor and the total size last, and
+// the backend graph splits packed along them, which tensorflow does by
+// views on the first dim. UnpackTensors splits the packed gradients.
+class PackTensorsOp : public xdl::OpKernel {
+ public:
+  Status Init(OpKernelConstruction* ctx) override {
+    XDL_CHECK_STATUS(ctx->GetAttr("dtype", &dtype_));
+    return Status::Ok();
+  }
+
+  Status Compute(OpKernelContext* ctx) override {
+    std::vector<Tensor> tensors;
+    XDL_CHECK_STATUS(ctx->GetInputList("tensors", &tensors));
+    Tensor offsets;
+    XDL_CHECK_STATUS(ctx->AllocateOutput(
+        1, TensorShape({tensors.size() + 1}), &offsets));
+    int64_t* offset = offsets.Raw<int64_t>();
+    offset[0] = 0;
+    for (size_t i = 0; i < tensors.size(); ++i) {
+      offset[i + 1] = offset[i] + tensors[i].Shape().NumElements();
+    }
+
+    Tensor packed;
+    XDL_CHECK_STATUS(ctx->AllocateOutput(
+        0, TensorShape({static_cast<size_t>(offset[tensors.size()])}), &packed));
+    char* ptr = packed.Raw<char>();
+    size_t type_size = SizeOfType(dtype_);
+    for (size_t i = 0; i < tensors.size(); ++i) {
+      size_t size = (offset[i + 1] - offset[i]) * type_size;
+      if (size > 0) {
+        memcpy(ptr, tensors[i].Raw<char>(), size);
+      }
+      ptr += size;
+    }
+    return Status::Ok();
+  }
+
+ private:
+  DataType dtype_;
+};
+
+XDL_DEFINE_OP(PackTensors)
+  .InputList("tensors", "dtype", "size")
+  .Attr("dtype", AttrValue::kDataType)
+  .Attr("size", AttrValue::kInt)
+  .Output("packed", "dtype")
+  .Output("offsets", DataType::kInt64);
+
+XDL_REGISTER_KERNEL(PackTensors, PackTensorsOp)
+  .Device("CPU");
+
+} // namespace xdl
+
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "xdl/core/ops/ps_ops/client.h"
 
+#include <cstdlib>
 #include <memory>
 #include <iostream>
 
@@ -39,6 +40,30 @@ bool ConnectToClient(const std::string& addr, const std::string& ckpt_path) {
     ps::client::ClientArgs args;
     args.scheduler_addr = addr;
     args.client_wrapper_creator = [](){return new ps::client::ClientWrapperImpl();};
+    const char* coalesce_window = getenv("XDL_PS_COALESCE_WINDOW_US");
+    if (coalesce_window != nullptr) {
+      args.coalesce_window_us = atoll(coalesce_window);
+    }
+    const char* process_timeout = getenv("XDL_PS_PROCESS_TIMEOUT_MS");
+    if (process_timeout != nullptr) {
+      args.process_timeout_ms = atoll(process_timeout);
+    }
+    const char* hedge_quantile = getenv("XDL_PS_HEDGE_QUANTILE");
+    if (hedge_quantile != nullptr) {
+      args.hedge_quantile = atof(hedge_quantile);
+    }
+    const char* dense_chunk_bytes = getenv("XDL_PS_DENSE_CHUNK_BYTES");
+    if (dense_chunk_bytes != nullptr) {
+      args.dense_chunk_bytes = atoll(dense_chunk_bytes);
+    }
+    const char* dense_chunk_window = getenv("XDL_PS_DENSE_CHUNK_WINDOW");
+    if (dense_chunk_window != nullptr) {
+      args.dense_chunk_window = atoll(dense_chunk_window);
+    }
+    const char* merge_shared_ids = getenv("XDL_PS_MERGE_SHARED_IDS");
+    if (merge_shared_ids != nullptr) {
+      args.merge_shared_ids = atoi(merge_shared_ids) != 0;
+    }
     ps::client::RawClient* raw_client = new ps::client::RawClient(args);
     current_client.reset(new ps::client::Client(raw_client));
   }
@@ -13,6 +13,10 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <mutex>
+#include <memory>
+#include <cstdlib>
+
 #include "xdl/core/lib/status.h"
 #include "xdl/core/framework/op_kernel.h"
 #include "xdl/core/framework/op_define.h"
@@ -22,6 +26,7 @@ limitations under the License.
 #include "xdl/core/ops/ps_ops/convert_utils.h"
 #include "xdl/core/ops/ps_ops/client.h"
 #include "xdl/core/ops/ps_ops/var_type.h"
+#include "xdl/core/ops/ps_ops/pull_ahead.h"
 
 namespace xdl {
 
@@ -33,9 +38,37 @@ class PsMergedSparsePullOp : public xdl::OpKernelAsync {
     XDL_CHECK_STATUS(ctx->GetAttr("var_names", &var_name_str));
     var_names_ = StringUtils::split(var_name_str, ",");
     XDL_CHECK_STATUS(XdlGetVarType(ctx, &var_type_));
+
+    // Pull-ahead is opt-in by XDL_PULL_AHEAD. The embeddings pulled ahead
+    // miss the updates pushed in the step they are pulled during.
+    const char* pull_ahead = getenv("XDL_PULL_AHEAD");
+    bool enabled = pull_ahead != nullptr && atoi(pull_ahead) != 0;
+    std::string pull_ahead_ds;
+    XDL_CHECK_STATUS(ctx->GetAttr("pull_ahead_ds", &pull_ahead_ds));
+    std::string pull_ahead_ids;
+    XDL_CHECK_STATUS(ctx->GetAttr("pull_ahead_ids", &pull_ahead_ids));
+    for (auto& item: StringUtils::split(pull_ahead_ids, ",")) {
+      features_.push_back(atoi(item.c_str()));
+    }
+    step_ = 0;
+    subscribe_id_ = -1;
+    if (enabled && !pull_ahead_ds.empty() &&
+        features_.size() == var_names_.size()) {
+      subscribe_id_ = PullAhead::Get()->Subscribe(
+          pull_ahead_ds,
+          [this](const std::vector<Tensor>& next_ids) {
+            IssuePrefetch(next_ids);
+          });
+    }
     return Status::Ok();
   }
 
+  ~PsMergedSparsePullOp() {
+    if (subscribe_id_ >= 0) {
+      PullAhead::Get()->Unsubscribe(subscribe_id_);
+    }
+  }
+
   void Compute(OpKernelContext* ctx, Callback done) override {
     ps::client::BaseClient* client;
     XDL_CHECK_STATUS_ASYNC(GetClient(&client), done);
@@ -73,17 +106,82 @@ class PsMergedSparsePullOp : public xdl::OpKernelAsync {
       done(Status::Ok());
     };
 
-    if (var_type_ == VarType::kHash128 || var_type_ == VarType::kHash64) {
-      client->MergedHashPull(var_names_, converted_ids, save_ratios, ps_result, cb);
-    } else {
+    if (var_type_ != VarType::kHash128 && var_type_ != VarType::kHash64) {
       done(Status::ArgumentError("PsMergedSparsePullOp var_type must be hash"));
+      return;
+    }
+
+    int64_t step;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      step = step_++;
+      save_ratios_ = save_ratios;
+    }
+
+    std::shared_ptr<PrefetchedPull> prefetch = prefetch_.Take(step);
+    if (prefetch == nullptr) {
+      client->MergedHashPull(var_names_, converted_ids, save_ratios, ps_result, cb);
+      return;
     }
+
+    // Use the pull issued for this step only when it got exactly these ids,
+    // the reader may have been reset or reshuffled since.
+    std::vector<std::string> var_names = var_names_;
+    prefetch->Wait([=] {
+      if (prefetch->Match(converted_ids)) {
+        *ps_result = std::move(prefetch->result);
+        cb(ps::Status::Ok());
+      } else {
+        client->MergedHashPull(var_names, converted_ids, save_ratios, ps_result, cb);
+      }
+    });
   }
 
  private:
+  // Called by GetBatch of a step with the ids of the batch of the next
+  // step, before the pull of the step itself runs.
+  void IssuePrefetch(const std::vector<Tensor>& next_ids) {
+    ps::client::BaseClient* client;
+    if (!GetClient(&client).IsOk()) {
+      return;
+    }
+    std::shared_ptr<PrefetchedPull> prefetch = std::make_shared<PrefetchedPull>();
+    std::vector<float> save_ratios;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      if (save_ratios_.empty()) {
+        return;
+      }
+      save_ratios = save_ratios_;
+      prefetch->step = step_ + 1;
+    }
+    for (auto feature: features_) {
+      if (feature < 0 || feature >= (int64_t)next_ids.size()) {
+        return;
+      }
+      // The reader recycles the batch buffers, so the ids are copied.
+      prefetch->ids.emplace_back();
+      if (!XDL2PS::ConvertTensor(next_ids[feature], &prefetch->ids.back()).IsOk()) {
+        return;
+      }
+    }
+    prefetch_.Park(prefetch);
+    client->MergedHashPull(var_names_, prefetch->ids, save_ratios, &prefetch->result,
+                           [prefetch](const ps::Status& st) {
+                             prefetch->Done(st);
+                           });
+  }
+
   std::string var_name_;
   VarType var_type_;
   std::vector<std::string> var_names_;
+
+  std::vector<int64_t> features_;
+  int subscribe_id_;
+  std::mutex mu_;
+  int64_t step_;
+  std::vector<float> save_ratios_;
+  PrefetchSlot prefetch_;
 };
 
 XDL_DEFINE_OP(PsMergedSparsePullOp)
@@ -95,7 +193,9 @@ XDL_DEFINE_OP(PsMergedSparsePullOp)
   .Attr("output_size", AttrValue::kInt)
   .Attr("var_name", AttrValue::kString)
   .Attr("var_type", AttrValue::kString)
-  .Attr("var_names", AttrValue::kString);
+  .Attr("var_names", AttrValue::kString)
+  .Attr("pull_ahead_ds", AttrValue::kString, "")
+  .Attr("pull_ahead_ids", AttrValue::kString, "");
 
 XDL_REGISTER_KERNEL(PsMergedSparsePullOp, PsMergedSparsePullOp).Device("CPU");
 
@@ -0,0 +1,165 @@
+/* Copyright 2018 Alibaba Group. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/core/lib/status.h"
+#include "xdl/core/framework/op_kernel.h"
+#include "xdl/core/framework/op_define.h"
+#include "xdl/core/framework/op_registry.h"
+#include "xdl/core/ops/ps_ops/define_op.h"
+#include "xdl/core/ops/ps_ops/convert_utils.h"
+#include "xdl/core/ops/ps_ops/client.h"
+#include "xdl/core/ops/ps_ops/var_type.h"
+#include "xdl/core/utils/string_utils.h"
+
+namespace xdl {
+
+// Sparse apply of variables with different optimizers in one push. The
+// variables of updaters[g] are the next group_sizes[g] of var_names, each
+// of its group_args[g] hyperparameters comes for all of them in a row.
+class PsSparseApplyMixedMergedOp : public xdl::OpKernelAsync {
+ public:
+  Status Init(OpKernelConstruction* ctx) override {
+    XDL_CHECK_STATUS(ctx->GetAttr("var_name", &var_name_));
+    XDL_CHECK_STATUS(XdlGetVarType(ctx, &var_type_));
+    std::string str;
+    XDL_CHECK_STATUS(ctx->GetAttr("var_names", &str));
+    var_names_ = StringUtils::split(str, ",");
+    XDL_CHECK_STATUS(ctx->GetAttr("updaters", &str));
+    updaters_ = StringUtils::split(str, ",");
+    XDL_CHECK_STATUS(ParseSizes(ctx, "group_sizes", &group_sizes_));
+    XDL_CHECK_STATUS(ParseSizes(ctx, "group_args", &group_args_));
+    size_t total = 0;
+    for (auto size : group_sizes_) {
+      total += size;
+    }
+    XDL_CHECK_COND(updaters_.size() == group_sizes_.size() &&
+                   updaters_.size() == group_args_.size() &&
+                   total == var_names_.size(),
+                   Status::ArgumentError("PsSparseApplyMixedMergedOp groups not match var_names"));
+    return Status::Ok();
+  }
+
+  void Compute(OpKernelContext* ctx, Callback done) override {
+    ps::client::BaseClient* client;
+    XDL_CHECK_STATUS_ASYNC(GetClient(&client), done);
+    std::vector<Tensor> hypers;
+    XDL_CHECK_STATUS_ASYNC(ctx->GetInputList("hyper", &hypers), done);
+    std::vector<Tensor> grads;
+    XDL_CHECK_STATUS_ASYNC(ctx->GetInputList("grad", &grads), done);
+    std::vector<Tensor> indices;
+    XDL_CHECK_STATUS_ASYNC(ctx->GetInputList("indices", &indices), done);
+    if (var_type_ != VarType::kHash128 && var_type_ != VarType::kHash64) {
+      done(Status::ArgumentError("PsSparseApplyMixedMergedOp var_type must be hash"));
+      return;
+    }
+    XDL_CHECK_COND_ASYNC(grads.size() == var_names_.size() && indices.size() == var_names_.size(),
+                         Status::ArgumentError("PsSparseApplyMixedMergedOp input size not match var_names"),
+                         done);
+    std::vector<ps::Tensor> convert_indices;
+    for (auto& indice : indices) {
+      convert_indices.emplace_back();
+      XDL_CHECK_STATUS_ASYNC(
+        XDL2PS::ConvertTensorZC(indice, &convert_indices.back()),
+        done);
+    }
+
+    std::vector<std::vector<int64_t>> groups;
+    std::vector<std::vector<ps::Data*>> datas;
+    size_t var_beg = 0, hyper_beg = 0;
+    for (size_t g = 0; g < updaters_.size(); g++) {
+      size_t size = group_sizes_[g];
+      XDL_CHECK_COND_ASYNC(hyper_beg + size * group_args_[g] <= hypers.size(),
+                           Status::ArgumentError("PsSparseApplyMixedMergedOp hyper size not match"),
+                           done);
+      groups.emplace_back();
+      std::vector<ps::Tensor> convert_grad;
+      for (size_t k = 0; k < size; k++) {
+        groups.back().push_back(var_beg + k);
+        convert_grad.emplace_back();
+        XDL_CHECK_STATUS_ASYNC(
+          XDL2PS::ConvertTensorZC(grads[var_beg + k], &convert_grad.back()),
+          done);
+      }
+      datas.push_back(client->Args(convert_grad));
+      for (size_t p = 0; p < group_args_[g]; p++) {
+        const Tensor* arg = &hypers[hyper_beg + p * size];
+        if (arg->Type() == DataType::kBool) {
+          std::vector<bool> values;
+          for (size_t k = 0; k < size; k++) {
+            values.push_back(arg[k].Scalar<bool>());
+          }
+          datas.back().push_back(client->Args(values)[0]);
+        } else {
+          std::vector<double> values;
+          for (size_t k = 0; k < size; k++) {
+            values.push_back(arg[k].Scalar<double>());
+          }
+          datas.back().push_back(client->Args(values)[0]);
+        }
+      }
+      var_beg += size;
+      hyper_beg += size * group_args_[g];
+    }
+    auto cb = [grads, indices, ctx, done](const ps::Status& st) {
+      XDL_CHECK_STATUS_ASYNC(PS2XDL::ConvertStatus(st), done);
+      done(Status::Ok());
+    };
+
+    std::vector<float> save_ratios(var_names_.size(), 0.0);
+    client->MixedHashPush(var_names_,
+                          convert_indices,
+                          save_ratios,
+                          updaters_,
+                          groups,
+                          datas,
+                          cb);
+  }
+
+ private:
+  static Status ParseSizes(OpKernelConstruction* ctx, const std::string& name,
+                           std::vector<size_t>* sizes) {
+    std::string str;
+    XDL_CHECK_STATUS(ctx->GetAttr(name, &str));
+    for (auto& item : StringUtils::split(str, ",")) {
+      sizes->push_back(atoll(item.c_str()));
+    }
+    return Status::Ok();
+  }
+
+  std::string var_name_;
+  std::vector<std::string> var_names_;
+  std::vector<std::string> updaters_;
+  std::vector<size_t> group_sizes_;
+  std::vector<size_t> group_args_;
+  VarType var_type_;
+};
+
+XDL_DEFINE_OP(PsSparseApplyMixedMergedOp)
+  .InputListV2("hyper", "input_type_0")
+  .InputListV2("grad", "input_type_1")
+  .InputListV2("indices", "input_type_2")
+  .Attr("input_type_0", AttrValue::kDataTypeList)
+  .Attr("input_type_1", AttrValue::kDataTypeList)
+  .Attr("input_type_2", AttrValue::kDataTypeList)
+  .Attr("var_name", AttrValue::kString)
+  .Attr("var_names", AttrValue::kString)
+  .Attr("var_type", AttrValue::kString)
+  .Attr("updaters", AttrValue::kString)
+  .Attr("group_sizes", AttrValue::kString)
+  .Attr("group_args", AttrValue::kString);
+
+XDL_REGISTER_KERNEL(PsSparseApplyMixedMergedOp, PsSparseApplyMixedMergedOp).Device("CPU");
+
+} // namespace xdl
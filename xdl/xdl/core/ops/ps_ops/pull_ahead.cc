@@ -0,0 +1,123 @@
+/* Copyright 2018 Alibaba Group. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/core/ops/ps_ops/pull_ahead.h"
+
+#include <cstring>
+
+namespace xdl {
+
+PullAhead* PullAhead::Get() {
+  static PullAhead pull_ahead;
+  return &pull_ahead;
+}
+
+int PullAhead::Subscribe(const std::string& ds, const Listener& listener) {
+  std::unique_lock<std::mutex> lock(mu_);
+  int id = next_id_++;
+  listeners_[id] = Entry{ds, listener};
+  return id;
+}
+
+void PullAhead::Unsubscribe(int id) {
+  std::unique_lock<std::mutex> lock(mu_);
+  listeners_.erase(id);
+}
+
+bool PullAhead::HasListener(const std::string& ds) {
+  std::unique_lock<std::mutex> lock(mu_);
+  for (auto& item : listeners_) {
+    if (item.second.ds == ds) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PullAhead::Publish(const std::string& ds,
+                        const std::vector<Tensor>& next_ids) {
+  // Listeners only issue an asynchronous pull, so they run under the
+  // lock and an op can never be unsubscribed while its listener runs.
+  std::unique_lock<std::mutex> lock(mu_);
+  for (auto& item : listeners_) {
+    if (item.second.ds == ds) {
+      item.second.listener(next_ids);
+    }
+  }
+}
+
+void PrefetchedPull::Done(const ps::Status& st) {
+  std::function<void()> waiter;
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    st_ = st;
+    ready_ = true;
+    waiter.swap(waiter_);
+  }
+  if (waiter) {
+    waiter();
+  }
+}
+
+void PrefetchedPull::Wait(const std::function<void()>& fn) {
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    if (!ready_) {
+      waiter_ = fn;
+      return;
+    }
+  }
+  fn();
+}
+
+bool PrefetchedPull::Match(const std::vector<ps::Tensor>& rhs) const {
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    if (!ready_ || !st_.IsOk()) {
+      return false;
+    }
+  }
+  if (ids.size() != rhs.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < ids.size(); ++i) {
+    if (ids[i].Type() != rhs[i].Type() ||
+        ids[i].Shape().Dims() != rhs[i].Shape().Dims()) {
+      return false;
+    }
+    size_t size = ids[i].Shape().NumElements() * ps::SizeOfType(ids[i].Type());
+    if (memcmp(ids[i].Raw<void>(), rhs[i].Raw<void>(), size) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void PrefetchSlot::Park(const std::shared_ptr<PrefetchedPull>& pull) {
+  std::unique_lock<std::mutex> lock(mu_);
+  pull_ = pull;
+}
+
+std::shared_ptr<PrefetchedPull> PrefetchSlot::Take(int64_t step) {
+  std::unique_lock<std::mutex> lock(mu_);
+  if (pull_ == nullptr || pull_->step > step) {
+    return nullptr;
+  }
+  std::shared_ptr<PrefetchedPull> pull;
+  pull.swap(pull_);
+  return pull->step == step ? pull : nullptr;
+}
+
+}  // namespace xdl
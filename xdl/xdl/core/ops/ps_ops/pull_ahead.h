@@ -0,0 +1,99 @@
+/* Copyright 2018 Alibaba Group. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XDL_CORE_OPS_PS_OPS_PULL_AHEAD_H_
+#define XDL_CORE_OPS_PS_OPS_PULL_AHEAD_H_
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+#include "ps-plus/common/status.h"
+#include "ps-plus/common/tensor.h"
+#include "xdl/core/framework/tensor.h"
+
+namespace xdl {
+
+// PullAhead connects the data reader with the merged hash pull ops.
+// GetBatch publishes the sparse ids of the batch it has already
+// dequeued for the next step, and every pull op subscribed to that
+// data source may start pulling its embeddings while the current step
+// is still running.
+class PullAhead {
+ public:
+  // next_ids holds the ids of every sparse feature of the data source,
+  // in the order of GetBatch's "ids" output list.
+  using Listener = std::function<void(const std::vector<Tensor>& next_ids)>;
+
+  static PullAhead* Get();
+
+  int Subscribe(const std::string& ds, const Listener& listener);
+  void Unsubscribe(int id);
+  bool HasListener(const std::string& ds);
+  void Publish(const std::string& ds, const std::vector<Tensor>& next_ids);
+
+ private:
+  struct Entry {
+    std::string ds;
+    Listener listener;
+  };
+
+  std::mutex mu_;
+  int next_id_ = 0;
+  std::unordered_map<int, Entry> listeners_;
+};
+
+// A merged hash pull issued ahead for the ids of a later step. Whoever
+// takes it waits for it, and uses the result only if it matches the ids
+// the step really pulls.
+struct PrefetchedPull {
+  int64_t step;
+  std::vector<ps::Tensor> ids;
+  std::vector<ps::Tensor> result;
+
+  // The callback of the pull
+  void Done(const ps::Status& st);
+  // Run fn once the pull is done, right away if it already is
+  void Wait(const std::function<void()>& fn);
+  // Whether the pull is done without error for exactly ids
+  bool Match(const std::vector<ps::Tensor>& ids) const;
+
+ private:
+  mutable std::mutex mu_;
+  bool ready_ = false;
+  ps::Status st_;
+  std::function<void()> waiter_;
+};
+
+// The prefetched pull parked in a pull op until its step runs.
+class PrefetchSlot {
+ public:
+  // Replace the parked pull, the replaced one is dropped
+  void Park(const std::shared_ptr<PrefetchedPull>& pull);
+  // The parked pull of step, nullptr if there is none. A pull of an
+  // earlier step is dropped, one of a later step stays parked.
+  std::shared_ptr<PrefetchedPull> Take(int64_t step);
+
+ private:
+  std::mutex mu_;
+  std::shared_ptr<PrefetchedPull> pull_;
+};
+
+}  // namespace xdl
+
+#endif  // XDL_CORE_OPS_PS_OPS_PULL_AHEAD_H_
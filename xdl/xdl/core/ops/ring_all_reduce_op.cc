@@ -0,0 +1,117 @@
+/* Copyright 2018 Alibaba Group. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstring>
+#include <memory>
+
+#include "xdl/core/lib/status.h"
+#include "xdl/core/lib/ring_all_reduce.h"
+#include "xdl/core/lib/thread_pool.h"
+#include "xdl/core/utils/string_utils.h"
+#include "xdl/core/framework/op_kernel.h"
+#include "xdl/core/framework/op_define.h"
+#include "xdl/core/framework/op_registry.h"
+
+namespace xdl {
+
+// Allreduces the dense gradients over the workers by a tcp ring, for the
+// synchronous mode keeping the dense variables replicated on the workers
+// instead of on the ps. The grads of a step are flattened into one
+// buffer and reduced at once. The ring is hierarchical with the
+// DenseAllReduce of the replicas of a worker before it, which leaves one
+// ring member per worker. The rounds run in order on a thread of the op,
+// connected by the first one, since the ring blocks on the peers.
+class RingAllReduceOp : public xdl::OpKernelAsync {
+ public:
+  Status Init(OpKernelConstruction* ctx) override {
+    std::string addresses;
+    XDL_CHECK_STATUS(ctx->GetAttr("rank", &rank_));
+    XDL_CHECK_STATUS(ctx->GetAttr("addresses", &addresses));
+    XDL_CHECK_STATUS(ctx->GetAttr("average", &average_));
+    addresses_ = StringUtils::split(addresses, ",");
+    XDL_CHECK_COND(rank_ >= 0 && rank_ < static_cast<int64_t>(addresses_.size()),
+                   Status::ArgumentError("RingAllReduce rank should be in [0, addresses)"));
+    thread_.reset(new ThreadPool(1));
+    return Status::Ok();
+  }
+
+  void Compute(OpKernelContext* ctx, Callback done) override {
+    std::vector<Tensor> grads;
+    XDL_CHECK_STATUS_ASYNC(ctx->GetInputList("grads", &grads), done);
+    thread_->Schedule([this, ctx, grads, done] {
+      XDL_CHECK_STATUS_ASYNC(Reduce(ctx, grads), done);
+      done(Status::Ok());
+    });
+  }
+
+ private:
+  Status Reduce(OpKernelContext* ctx, const std::vector<Tensor>& grads) {
+    if (ring_ == nullptr) {
+      ring_.reset(new RingAllReduce);
+      init_ = ring_->Init(rank_, addresses_);
+    }
+    XDL_CHECK_STATUS(init_);
+
+    size_t total = 0;
+    for (auto&& grad : grads) {
+      total += grad.Shape().NumElements();
+    }
+    buffer_.resize(total);
+    float* ptr = buffer_.data();
+    for (auto&& grad : grads) {
+      size_t size = grad.Shape().NumElements();
+      memcpy(ptr, grad.Raw<float>(), size * sizeof(float));
+      ptr += size;
+    }
+    XDL_CHECK_STATUS(ring_->AllReduce(buffer_.data(), total));
+
+    float scale = average_ ? 1.0 / ring_->size() : 1.0;
+    std::vector<Tensor> outputs(grads.size());
+    ptr = buffer_.data();
+    for (size_t i = 0; i < grads.size(); ++i) {
+      XDL_CHECK_STATUS(ctx->Allocate(grads[i].Shape(), DataType::kFloat, &outputs[i]));
+      float* output = outputs[i].Raw<float>();
+      size_t size = grads[i].Shape().NumElements();
+      for (size_t k = 0; k < size; ++k) {
+        output[k] = ptr[k] * scale;
+      }
+      ptr += size;
+    }
+    return ctx->SetOutputList("outputs", outputs);
+  }
+
+  int64_t rank_;
+  std::vector<std::string> addresses_;
+  bool average_;
+  std::unique_ptr<ThreadPool> thread_;
+  // the ring and the status it connected with, touched by thread_ only
+  std::unique_ptr<RingAllReduce> ring_;
+  Status init_;
+  std::vector<float> buffer_;
+};
+
+XDL_DEFINE_OP(RingAllReduce)
+  .InputList("grads", DataType::kFloat, "size")
+  .OutputList("outputs", DataType::kFloat, "size")
+  .Attr("size", AttrValue::kInt)
+  .Attr("rank", AttrValue::kInt)
+  .Attr("addresses", AttrValue::kString)
+  .Attr("average", AttrValue::kBool, true);
+
+XDL_REGISTER_KERNEL(RingAllReduce, RingAllReduceOp)
+  .Device("CPU");
+
+} // namespace xdl
+
@@ -17,11 +17,12 @@
 #include "xdl/core/ops/take_grad_op.h"
 
 #include <omp.h>
+#include <cstring>
 
 #include "xdl/core/framework/op_kernel.h"
 #include "xdl/core/framework/op_define.h"
 #include "xdl/core/framework/op_registry.h"
-#include "xdl/core/lib/atomic.h"
+#include "xdl/core/lib/parallel.h"
 
 namespace xdl {
 
@@ -48,12 +49,23 @@ Status TakeGradOp<T, I>::Compute(OpKernelContext* ctx) {
   T* pout = output.Raw<T>();
   std::memset(pout, 0, sizeof(T) * out_shape.NumElements());
   
-  #pragma omp parallel for
-  for (size_t k = 0; k < row * col; ++k) {
-    size_t i = k / col;
-    size_t j = k % col;
-    I rrow = pind[i];
-    common::cpu_atomic_add<T>(pin[k], pout + rrow * col + j);
+  size_t out_row = dims[0];
+  std::vector<size_t> offsets, positions;
+  common::row_bucket_generate(pind, row, out_row, &offsets, &positions);
+  std::vector<std::tuple<size_t, size_t, size_t>> splits;
+  common::parallel_split_generate(out_row, omp_get_max_threads(), &splits);
+  #pragma omp parallel for if (row * col > 4096)
+  for (size_t s = 0; s < splits.size(); ++s) {
+    for (size_t r = std::get<1>(splits[s]); r < std::get<2>(splits[s]); ++r) {
+      T* dst = pout + r * col;
+      for (size_t p = offsets[r]; p < offsets[r + 1]; ++p) {
+        const T* src = pin + positions[p] * col;
+        #pragma omp simd
+        for (size_t j = 0; j < col; ++j) {
+          dst[j] += src[j];
+        }
+      }
+    }
   }
   return Status::Ok();
 }
@@ -17,21 +17,43 @@
 #include "xdl/core/ops/take_op.h"
 #include "xdl/core/framework/op_registry.h"
 #include "xdl/core/lib/common_defines.h"
+#include "xdl/core/lib/gpu_row.h"
 #include "xdl/core/framework/gpu/gpu_device.h"
 
 namespace xdl {
 namespace {
 
-template <typename T, typename I>
-__global__ void TakeOpKernel(const T* pin,
-                             const I* pind,
-                             size_t col,
-                             size_t num,
-                             T* pout) {
-  const size_t k = blockIdx.x * blockDim.x + threadIdx.x;
-  if (k >= num) return;
-  const size_t i = k / col, j = k % col;
-  pout[k] = pin[pind[i] * col + j];
+// Copies a row of col T by row_threads threads, which read it as V
+template <typename T, typename I, typename V>
+__global__ void TakeRowKernel(const T* pin,
+                              const I* pind,
+                              size_t col,
+                              size_t row,
+                              int row_threads,
+                              T* pout) {
+  const size_t cols = col / (sizeof(V) / sizeof(T));
+  const size_t lane = threadIdx.x % row_threads;
+  const size_t rows_per_grid = gridDim.x * (blockDim.x / row_threads);
+  for (size_t i = blockIdx.x * (blockDim.x / row_threads) +
+                  threadIdx.x / row_threads;
+       i < row; i += rows_per_grid) {
+    const V* src = reinterpret_cast<const V*>(pin + pind[i] * col);
+    V* dst = reinterpret_cast<V*>(pout + i * col);
+    for (size_t j = lane; j < cols; j += row_threads) {
+      dst[j] = src[j];
+    }
+  }
+}
+
+template <typename T, typename I, typename V>
+void LaunchTakeRow(const T* pin, const I* pind, size_t col, size_t row,
+                   T* pout, cudaStream_t st) {
+  int row_threads = common::RowThreads(col / (sizeof(V) / sizeof(T)));
+  TakeRowKernel<T, I, V><<<
+      common::RowBlocks(row, row_threads),
+      common::kRowBlockThreads,
+      0,
+      st>>>(pin, pind, col, row, row_threads, pout);
 }
 
 }  // namespace
@@ -70,12 +92,12 @@ Status TakeGpuOp<T, I>::LaunchKernel(OpKernelContext* ctx, CudaStream* stream) {
     CUDA_CHECK(cudaMemsetAsync(pout, 0, sizeof(T) * out_shape.NumElements(), st));
     return Status::Ok();
   }
-  size_t blocks = CUDA_GET_BLOCKS(num);
-  TakeOpKernel<T, I><<<
-      blocks,
-      CUDA_GET_THREADS(num, blocks),
-      0,
-      st>>>(pin, pind, col, num, pout);
+  if (common::RowAligned<T>(pin, col) && common::RowAligned<T>(pout, col)) {
+    LaunchTakeRow<T, I, typename common::RowVec<T>::Type>(
+        pin, pind, col, row, pout, st);
+  } else {
+    LaunchTakeRow<T, I, T>(pin, pind, col, row, pout, st);
+  }
   return Status::Ok();
 }
 
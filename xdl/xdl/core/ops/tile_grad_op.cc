@@ -17,10 +17,11 @@
 #include "xdl/core/ops/tile_grad_op.h"
 
 #include <omp.h>
+#include <algorithm>
 #include <cstring>
 #include "xdl/core/framework/op_define.h"
 #include "xdl/core/framework/op_registry.h"
-#include "xdl/core/lib/atomic.h"
+#include "xdl/core/lib/parallel.h"
 
 namespace xdl {
 
@@ -81,25 +82,32 @@ Status TileGradOp<T, I>::Compute(OpKernelContext* ctx) {
   T* pout = out_grad.Raw<T>();
   std::memset(pout, 0, sizeof(T) * embed.Shape().NumElements());
 
-  //#pragma omp parallel for
-  for (size_t i = 0; i < id_size; ++i) {
-    size_t grp_idx = std::lower_bound(pgrp, pgrp + grp_size, i + 1) - pgrp;
-    size_t src_begin = grp_idx * length_;
-    size_t dst_begin = pidx[i] * eb_dim;
-    size_t grp_width = grp_idx == 0 ? pgrp[grp_idx]
-                                    : pgrp[grp_idx] - pgrp[grp_idx - 1];
-    if (grp_width == 0) continue;
-    size_t grp_off = i - ((grp_idx == 0) ? 0 : pgrp[grp_idx - 1]);
-    grp_off = reverse_ ? (grp_width - 1 - grp_off) : grp_off;
-    for (size_t k = 0; k < eb_dim; ++k) {
-      size_t off = grp_off * eb_dim + k;
-      if (off < length_) {
-        if (pval != nullptr) {
-          common::cpu_atomic_add<T>(pval[i] * pgrad[src_begin + off],
-                                    pout + dst_begin + k);
-        } else {
-          common::cpu_atomic_add<T>(pgrad[src_begin + off],
-                                    pout + dst_begin + k);
+  size_t out_row = embed.Shape()[0];
+  std::vector<size_t> offsets, positions;
+  common::row_bucket_generate(pidx, id_size, out_row, &offsets, &positions);
+  std::vector<std::tuple<size_t, size_t, size_t>> splits;
+  common::parallel_split_generate(out_row, omp_get_max_threads(), &splits);
+  #pragma omp parallel for if (id_size * eb_dim > 4096)
+  for (size_t s = 0; s < splits.size(); ++s) {
+    for (size_t r = std::get<1>(splits[s]); r < std::get<2>(splits[s]); ++r) {
+      T* dst = pout + r * eb_dim;
+      for (size_t p = offsets[r]; p < offsets[r + 1]; ++p) {
+        size_t i = positions[p];
+        size_t grp_idx = std::lower_bound(pgrp, pgrp + grp_size, i + 1) - pgrp;
+        size_t grp_width = grp_idx == 0 ? pgrp[grp_idx]
+                                        : pgrp[grp_idx] - pgrp[grp_idx - 1];
+        if (grp_width == 0) continue;
+        size_t grp_off = i - ((grp_idx == 0) ? 0 : pgrp[grp_idx - 1]);
+        grp_off = reverse_ ? (grp_width - 1 - grp_off) : grp_off;
+        // the tile of this id covers [grp_off * eb_dim, length_)
+        size_t begin = grp_off * eb_dim;
+        if (begin >= static_cast<size_t>(length_)) continue;
+        size_t width = std::min(eb_dim, static_cast<size_t>(length_) - begin);
+        const T* src = pgrad + grp_idx * length_ + begin;
+        T scale = pval != nullptr ? pval[i] : T(1);
+        #pragma omp simd
+        for (size_t k = 0; k < width; ++k) {
+          dst[k] += scale * src[k];
         }
       }
     }
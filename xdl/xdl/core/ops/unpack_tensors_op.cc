@@ -0,0 +1,73 @@
+/* Copyright 2018 Alibaba Group. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/core/lib/status.h"
+#include "xdl/core/framework/op_kernel.h"
+#include "xdl/core/framework/op_define.h"
+#include "xdl/core/framework/op_registry.h"
+
+namespace xdl {
+
+// Splits a tensor laid out by PackTensors, the packed gradients of the
+// dense backend mostly, into the tensors of the shapes of likes. The
+// results are views of the packed buffer and nothing is copied.
+class UnpackTensorsOp : public xdl::OpKernel {
+ public:
+  Status Init(OpKernelConstruction* ctx) override {
+    XDL_CHECK_STATUS(ctx->GetAttr("dtype", &dtype_));
+    return Status::Ok();
+  }
+
+  Status Compute(OpKernelContext* ctx) override {
+    Tensor packed;
+    XDL_CHECK_STATUS(ctx->GetInput("packed", &packed));
+    std::vector<Tensor> likes;
+    XDL_CHECK_STATUS(ctx->GetInputList("likes", &likes));
+    size_t total = 0;
+    for (auto&& item : likes) {
+      total += item.Shape().NumElements();
+    }
+    XDL_CHECK_COND(packed.Shape().NumElements() == total,
+                   Status::ArgumentError("UnpackTensors packed size mismatch"));
+
+    Buffer* parent = packed.GetBuffer();
+    char* ptr = reinterpret_cast<char*>(parent->begin());
+    size_t type_size = SizeOfType(dtype_);
+    for (size_t i = 0; i < likes.size(); ++i) {
+      size_t size = likes[i].Shape().NumElements() * type_size;
+      Buffer* buf = new Buffer(ptr, size, parent);
+      XDL_CHECK_STATUS(ctx->SetOutput(i, Tensor(likes[i].Shape(), dtype_, buf)));
+      buf->UnRef();
+      ptr += size;
+    }
+    return Status::Ok();
+  }
+
+ private:
+  DataType dtype_;
+};
+
+XDL_DEFINE_OP(UnpackTensors)
+  .Input("packed", "dtype")
+  .InputList("likes", "dtype", "size")
+  .Attr("dtype", AttrValue::kDataType)
+  .Attr("size", AttrValue::kInt)
+  .OutputList("result", "dtype", "size");
+
+XDL_REGISTER_KERNEL(UnpackTensors, UnpackTensorsOp)
+  .Device("CPU");
+
+} // namespace xdl
+
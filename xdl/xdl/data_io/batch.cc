@@ -53,6 +53,7 @@ bool Batch::Reuse() {
   }
   sgroups_.clear();
   ts_count_ = 0;
+  size_ = 0;
   abandon_ = false;
   BatchPool::Get()->Release(this);
   XDL_LOG(DEBUG) << "release batch=" << this;
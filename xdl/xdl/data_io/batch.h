@@ -62,7 +62,10 @@ class Batch {
   bool Abandon() const { return abandon_; }
   std::vector<SGroup *> &sgroups();
   std::map<std::string, Block> &blocks();
+  const std::map<std::string, Block> &blocks() const { return blocks_; }
   std::atomic<size_t> ts_count_;
+  /// samples of the batch, the rows past them are padding
+  size_t size_ = 0;
  protected:
   std::map<std::string, Block> blocks_;
   std::vector<SGroup *> sgroups_;
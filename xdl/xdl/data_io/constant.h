@@ -51,12 +51,16 @@ enum ParserType {
   kTfRnn = 0x03,
   kV4 = 0x04,
   kSPB = 0x05,
+  /// batches are read as they are, see ColumnarReader
+  kColumnar = 0x06,
 };
 
 enum ZType {
   kRaw = 0x00,
   kZLib = 0x01,
   kGZip = 0x02,
+  /// blocked gzip, inflated in parallel, see BgzfAnt
+  kBgzf = 0x03,
 };
 
 const size_t MAX_END_TIME = std::numeric_limits<size_t>::max() / 8;
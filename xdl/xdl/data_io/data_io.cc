@@ -18,12 +18,24 @@ limitations under the License.
 
 #include "xdl/core/lib/timer.h"
 #include "xdl/core/framework/cpu_device.h"
+#ifdef USE_GPU
+#include "xdl/core/framework/gpu/gpu_device.h"
+#endif
+#include "xdl/data_io/fs/file_system_local.h"
+#include "xdl/data_io/packer/pack_skey.h"
 #ifdef USE_PS_PLUS
 #include "xdl/data_io/global_scheduler.h"
 #endif
 
 #include "google/protobuf/text_format.h"
 
+#include <chrono>
+#include <errno.h>
+#include <random>
+#include <sstream>
+#include <string.h>
+#include <sys/stat.h>
+
 namespace xdl {
 namespace io {
 
@@ -56,34 +68,98 @@ DataIO::~DataIO() {
 
 bool DataIO::Init() {
   if (sgroup_q_ == nullptr) {
-    sgroup_q_ = new BlockingQueue<SGroup *>(schema_->batch_size_*threads_read_);
+    sgroup_q_ = new RingQueue<SGroup *>(schema_->batch_size_*threads_read_);
   }
 
   
+  if (pack_q_ == nullptr && shuffle_samples_ > 0) {
+    pack_q_ = new RingQueue<SGroup *>(schema_->batch_size_*threads_);
+  }
+
+  if (op_threads_ > 0 && schema_->keep_sgroup_) {
+    XDL_LOG(WARNING) << "keep sgroup runs the ops in the packers, no op threads";
+  } else if (op_q_ == nullptr && op_threads_ > 0 && !ops_.empty()) {
+    op_q_ = new RingQueue<SGroup *>(schema_->batch_size_*threads_);
+  }
+
   if (batch_q_ == nullptr) {
-    batch_q_ = new BlockingQueue<Batch *>(threads_);
+    batch_q_ = new RingQueue<Batch *>(threads_);
   }
 
   if (meta_data_.empty() && !meta_path_.empty()) {
     meta_data_ = fs_->Read(meta_path_);
   }
 
+  /// while autotuning all the threads run, the ones over the active count wait
+  bool tune = tune_seconds_ > 0 && !schema_->keep_sgroup_;
+  size_t nparser = tune ? std::max(threads_read_, tune_threads_read_) : threads_read_;
+  size_t npacker = tune ? std::max(threads_, tune_threads_) : threads_;
+  active_parsers_ = threads_read_;
+  active_packers_ = threads_;
+
   parsers_.clear();
-  for (size_t i = 0; i < threads_read_; ++i) {
+  packers_.clear();
+  readers_.clear();
+  cache_writers_.clear();
+  cache_ants_.clear();
+  if (cache_sched_ != nullptr) {
+    cache_sched_->Clear();
+    cache_sched_.reset();
+  }
+  if (parser_type_ == kColumnar) {
+    XDL_CHECK(ops_.empty() && !schema_->keep_sgroup_ && ztype_ == kRaw)
+        << "columnar data io supports neither ops, keep sgroup nor compression";
+    for (size_t i = 0; i < nparser; ++i) {
+      readers_.emplace_back(new ColumnarReader(schema_.get(), NewDevice(),
+                                               fs_type_ == kLocal));
+    }
+  }
+
+  /// the ops and the kept sgroups may read the features out of the schema
+  schema_->projection_ = projection_ && ops_.empty() && !schema_->keep_sgroup_;
+  for (size_t i = 0; readers_.empty() && i < nparser; ++i) {
     Parser* parser = new Parser(parser_type_, schema_.get());
     XDL_CHECK(parser->InitMeta(meta_data_));
     parsers_.emplace_back(parser);
   }
 
-  packers_.clear();
-  for (size_t i = 0; i < threads_; ++i) {
-    auto packer = new Packer(schema_.get(), new CpuDevice());
+  for (size_t i = 0; readers_.empty() && i < npacker; ++i) {
+    auto packer = new Packer(schema_.get(), NewDevice());
     packers_.emplace_back(packer);
   }
 
+  bool cache = !cache_dir_.empty() && epochs_ != 1 && parser_type_ != kColumnar;
+  if (cache && (!ops_.empty() || schema_->keep_sgroup_)) {
+    XDL_LOG(WARNING) << "cache supports neither ops nor keep sgroup, not cached";
+    cache = false;
+  }
+  for (auto &it : schema_->feature_opts()) {
+    auto opt = it.second;
+    if (cache && (opt->table() != 0 || (opt->has_cutoff() && opt->cutoff() != 0))) {
+      XDL_LOG(WARNING) << "cache holds the features of table 0 without cutoff, feature="
+          << opt->name() << ", not cached";
+      cache = false;
+    }
+  }
+  if (cache) {
+    if (mkdir(cache_dir_.c_str(), 0755) != 0 && errno != EEXIST) {
+      XDL_LOG(FATAL) << "mkdir " << cache_dir_ << " failed, " << strerror(errno);
+    }
+    for (size_t i = 0; i < packers_.size(); ++i) {
+      std::string path = cache_dir_ + "/" + ds_name_ + "." + std::to_string(i) + ".col";
+      cache_ants_.emplace_back(FileSystemLocal::Get()->GetAnt(path.c_str(), 'w'));
+      cache_writers_.emplace_back(new ColumnarWriter(cache_ants_.back().get(), schema_.get()));
+    }
+    /// the next epochs are read from the cache
+    sched_->SetEpochs(1);
+  } else {
+    sched_->SetEpochs(epochs_);
+  }
+
   mergers_.clear();
-  for (size_t i = 0; unique_ && i < packers_.size(); ++i) {
-    auto merger = new Merger(schema_.get(), new CpuDevice());
+  size_t nmerger = readers_.empty() ? packers_.size() : readers_.size();
+  for (size_t i = 0; unique_ && i < nmerger; ++i) {
+    auto merger = new Merger(schema_.get(), NewDevice());
     mergers_.emplace_back(merger);
   }
 
@@ -103,6 +179,9 @@ bool DataIO::DoParse(size_t tid) {
   size_t count_rparam = 0;
   size_t count_sgroup = 0;
   while(running_) {
+    while (running_ && tid >= active_parsers_ && !sched_->finished()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
     ReadParam *rparam = sched_->Acquire();
     if (rparam == nullptr) {
       break;
@@ -148,14 +227,22 @@ bool DataIO::DoPack(size_t tid) {
   assert(tid < packers_.size());
   auto packer = packers_[tid].get();
   auto merger = unique_ ? mergers_[tid].get() : nullptr;
+  auto queue = op_q_ != nullptr ? op_q_ : shuffle_samples_ > 0 ? pack_q_ : sgroup_q_;
   //XDL_LOG(DEBUG) << "this=" << this << ", packer=" << packer;
   size_t count_sgroup = 0;
   size_t count_batch = 0;
   while(running_) {
+    /// the ones waiting take their END once the parsers are done
+    while (running_ && tid >= active_packers_ && !parsers_done_) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
     //XDL_TIMER_NOW(deque_sgroup);
    again:
     SGroup *sgroup = nullptr;
-    if (!sgroup_q_->TryDequeue(&sgroup, kTimeWait)) {
+    if (!queue->TryDequeue(&sgroup, kTimeWait)) {
+      if (unique_) {
+        FlushMerger(merger);
+      }
       if (!wait_exactly_) {
         //continue;
         goto again;
@@ -170,32 +257,9 @@ bool DataIO::DoPack(size_t tid) {
     //XDL_TIMER_NOW(run_ops);
     if (sgroup != END) {
       ++count_sgroup;
-      if (!RunOps(sgroup)) {
-        SGroupPool::Get()->Release(sgroup);
-        std::unique_lock<std::mutex> lck(mutex_);
-        /// all parser wait at cv, until parse_count == 0
-        if (--parse_count_ <= 0) {
-          /// it's the last sgroup, other packer wait at sgroup_q_
-          pause_ = false;
-          cv_.notify_all();
-
-          XDL_LOG(DEBUG) << "all re parsers done, notify packers exit ...";
-          NotifyPacker();
-        }
-        XDL_LOG(DEBUG) << "sgroup="<< sgroup << " -parse_count=" << parse_count_;
+      /// the op threads have run them
+      if (op_q_ == nullptr && !ApplyOps(sgroup)) {
         continue;
-      } else {
-        XDL_LOG(DEBUG) << "sgroup="<< sgroup << " parse_count=" << parse_count_;
-      }
-      if (sgroup->size_ != sgroup->Get()->labels_size()) {
-        if (sgroup->Get()->labels_size() == 0) {
-          // Ops del all
-          SGroupPool::Get()->Release(sgroup);
-          continue;
-        }
-        XDL_DLOG(DEBUG) << "rebuild sgroup " << sgroup->size_ 
-            << " -> " << sgroup->Get()->labels_size();
-        sgroup->Reset(sgroup->begin_);
       }
     }
     //XDL_TIMER_STOP(run_ops);
@@ -204,13 +268,22 @@ bool DataIO::DoPack(size_t tid) {
     std::vector<Batch *> batchs = packer->Run(sgroup);
     for(auto &batch: batchs) {
       ++count_batch;
+      if (!cache_writers_.empty()) {
+        XDL_CHECK(cache_writers_[tid]->Write(batch)) << "write cache failed";
+      }
       if (unique_) {
-        batch = merger->Run(batch);
+        /// uniqued while the next one is packed
+        Batch *done = merger->Wait();
+        merger->Start(batch);
+        batch = done;
       }
-      while (!batch_q_->TryEnqueue(batch, kTimeWaitTORetry)) {
-        if (!running_) { break; }
+      if (batch != nullptr) {
+        PushBatch(batch);
       }
     }
+    if (unique_ && sgroup == END) {
+      FlushMerger(merger);
+    }
     //XDL_TIMER_STOP(run_pack);
 
     if (sgroup == END && parsers_done_ && (parse_count_ == 0 || !wait_exactly_)) {
@@ -218,11 +291,174 @@ bool DataIO::DoPack(size_t tid) {
       break;
     }
   }
+  if (unique_) {
+    FlushMerger(merger);
+  }
 
   XDL_LOG(DEBUG) << "packer." << tid << " shutdown sgroups="
       << count_sgroup << " batchs=" << count_batch;
 }
 
+/* Keeps the sgroups in a buffer until it holds shuffle_samples_ samples,
+ * then each new one goes in place of a random one, which is packed. The
+ * buffer is flushed, in random order, before END and when no sgroup came
+ * for a while, so a paused parse doesn't leave sgroups behind.
+ */
+bool DataIO::DoShuffle() {
+  static const unsigned kTimeFlush = 1000; /// millisecond
+  XDL_LOG(DEBUG) << "shuffle startup, samples=" << shuffle_samples_;
+  std::mt19937_64 rng(shuffle_seed_);
+  std::vector<SGroup *> buffer;
+  size_t samples = 0;
+  auto put = [this](SGroup *sgroup) {
+    while (!pack_q_->TryEnqueue(sgroup, kTimeWaitTORetry)) {
+      if (!running_) { return false; }
+    }
+    return true;
+  };
+  /// moves a random sgroup of the buffer to the packers
+  auto pop = [&]() {
+    size_t i = rng() % buffer.size();
+    std::swap(buffer[i], buffer.back());
+    SGroup *sgroup = buffer.back();
+    buffer.pop_back();
+    samples -= sgroup->end_ - sgroup->begin_;
+    if (!put(sgroup)) {
+      SGroupPool::Get()->Release(sgroup);
+    }
+  };
+
+  while (running_ && !shuffle_done_) {
+    SGroup *sgroup = nullptr;
+    if (!sgroup_q_->TryDequeue(&sgroup, kTimeFlush)) {
+      while (!buffer.empty()) pop();
+      continue;
+    }
+    if (sgroup == END) {
+      while (!buffer.empty()) pop();
+      put(sgroup);
+      continue;
+    }
+    buffer.push_back(sgroup);
+    samples += sgroup->end_ - sgroup->begin_;
+    while (samples > shuffle_samples_) {
+      pop();
+    }
+  }
+
+  for (auto sgroup : buffer) {
+    SGroupPool::Get()->Release(sgroup);
+  }
+  XDL_LOG(DEBUG) << "shuffle shutdown";
+  return true;
+}
+
+/* Each op thread runs the ops of the sgroups it takes. An END is passed
+ * once the sgroups taken before it are run, so that the packers quit after
+ * all of them.
+ */
+bool DataIO::DoRunOps(size_t tid) {
+  XDL_LOG(DEBUG) << "op." << tid << " startup";
+  auto queue = shuffle_samples_ > 0 ? pack_q_ : sgroup_q_;
+  size_t count_sgroup = 0;
+  auto put = [this](SGroup *sgroup) {
+    while (!op_q_->TryEnqueue(sgroup, kTimeWaitTORetry)) {
+      if (!running_) { return false; }
+    }
+    return true;
+  };
+
+  while (running_ && !ops_done_) {
+    SGroup *sgroup = nullptr;
+    {
+      std::unique_lock<std::mutex> lck(op_mutex_);
+      if (!queue->TryDequeue(&sgroup, kTimeWaitTORetry)) {
+        continue;
+      }
+      if (sgroup != END) {
+        ++ops_running_;
+      }
+    }
+    if (sgroup == END) {
+      while (running_ && ops_running_ > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      put(sgroup);
+      continue;
+    }
+
+    ++count_sgroup;
+    if (ApplyOps(sgroup) && !put(sgroup)) {
+      SGroupPool::Get()->Release(sgroup);
+    }
+    --ops_running_;
+  }
+
+  XDL_LOG(DEBUG) << "op." << tid << " shutdown sgroups=" << count_sgroup;
+  return true;
+}
+
+void DataIO::PushBatch(Batch *batch) {
+  while (!batch_q_->TryEnqueue(batch, kTimeWaitTORetry)) {
+    if (!running_) { break; }
+  }
+}
+
+void DataIO::FlushMerger(Merger *merger) {
+  Batch *batch = merger->Wait();
+  if (batch != nullptr) {
+    PushBatch(batch);
+  }
+}
+
+bool DataIO::DoRead(size_t tid) {
+  XDL_LOG(DEBUG) << "reader." << tid << " startup";
+  assert(tid < readers_.size());
+  auto reader = readers_[tid].get();
+  auto merger = unique_ ? mergers_[tid].get() : nullptr;
+  auto sched = cache_sched_ != nullptr ? cache_sched_.get() : sched_.get();
+  size_t count_rparam = 0;
+  size_t count_batch = 0;
+  while (running_) {
+    while (running_ && cache_sched_ == nullptr && tid >= active_parsers_ &&
+           !sched->finished()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ReadParam *rparam = sched->Acquire();
+    if (rparam == nullptr) {
+      break;
+    }
+    ++count_rparam;
+
+    if (reader->Open(rparam)) {
+      while (running_) {
+        Batch *batch = reader->Next();
+        if (batch == nullptr) {
+          break;
+        }
+        ++count_batch;
+        if (unique_) {
+          Batch *done = merger->Wait();
+          merger->Start(batch);
+          batch = done;
+        }
+        if (batch != nullptr) {
+          PushBatch(batch);
+        }
+      }
+      reader->Close();
+    }
+    if (unique_) {
+      FlushMerger(merger);
+    }
+    sched->Release(rparam);
+  }
+
+  XDL_LOG(DEBUG) << "reader." << tid << " shutdown rparam="
+      << count_rparam << " batchs=" << count_batch;
+  return true;
+}
+
 bool DataIO::Startup() {
   XDL_CHECK(!running_);
   Init();
@@ -230,6 +466,20 @@ bool DataIO::Startup() {
   XDL_CHECK(batch_q_->Size() == 0) << "batch_q_ is not empty before start";
   running_ = true;
 
+  if (shuffle_samples_ > 0 && !parsers_.empty()) {
+    XDL_CHECK(pack_q_->Size() == 0) << "pack_q_ is not empty before start";
+    shuffle_done_ = false;
+    th_shuffle_ = std::thread([this](){this->DoShuffle();});
+  }
+
+  if (op_q_ != nullptr && !parsers_.empty()) {
+    XDL_CHECK(op_q_->Size() == 0) << "op_q_ is not empty before start";
+    ops_done_ = false;
+    for (size_t i = 0; i < op_threads_; ++i) {
+      th_ops_.push_back(std::thread([this, i](){this->DoRunOps(i);}));
+    }
+  }
+
   for (size_t i = 0; i < parsers_.size(); ++i) {
     th_parsers_.push_back(std::thread([this, i](){this->DoParse(i);}));
   }
@@ -238,18 +488,26 @@ bool DataIO::Startup() {
     th_packers_.push_back(std::thread([this, i](){this->DoPack(i);}));
   }
 
+  for (size_t i = 0; i < readers_.size(); ++i) {
+    th_parsers_.push_back(std::thread([this, i](){this->DoRead(i);}));
+  }
+
   XDL_LOG(DEBUG) << "xdl.data_io startup";
 
   /// wait background
   th_wait_ = std::thread([this](){this->Wait();});
 
+  if (tune_seconds_ > 0 && !schema_->keep_sgroup_) {
+    th_tune_ = std::thread([this](){this->Autotune();});
+  }
+
   return true;
 }
 
 bool DataIO::Wait() {
   /// wait to done
-  for (size_t i = 0; i < parsers_.size(); ++i) {
-    th_parsers_[i].join();
+  for (auto &th : th_parsers_) {
+    th.join();
   }
 
   parsers_done_ = true;
@@ -266,15 +524,154 @@ bool DataIO::Wait() {
   }
 
   packers_done_ = true;
+  if (th_shuffle_.joinable()) {
+    shuffle_done_ = true;
+    th_shuffle_.join();
+  }
+  ops_done_ = true;
+  for (auto &th : th_ops_) {
+    th.join();
+  }
+  th_ops_.clear();
   th_parsers_.clear();
   th_packers_.clear();
 
+  if (!cache_writers_.empty()) {
+    ReadCache();
+  }
+
   /// all packers done, notify get_batch_op
   batch_q_->ForceEnqueue(nullptr);
-  XDL_LOG(DEBUG) << "all packers done, notify graph exit ...";
+  XDL_LOG(DEBUG) << "all packers done, notify graph exit ...\n" << QueueStats();
+  return true;
+}
+
+bool DataIO::ReadCache() {
+  std::vector<std::string> paths;
+  for (size_t i = 0; i < cache_writers_.size(); ++i) {
+    XDL_CHECK(cache_writers_[i]->Close()) << "write cache failed";
+    if (!cache_writers_[i]->meta().chunks.empty()) {
+      paths.push_back(cache_dir_ + "/" + ds_name_ + "." + std::to_string(i) + ".col");
+    }
+  }
+  cache_writers_.clear();
+  cache_ants_.clear();
+  if (!running_ || paths.empty()) {
+    return false;
+  }
+
+  cache_sched_.reset(new Scheduler(FileSystemLocal::Get(), epochs_ == 0 ? 0 : epochs_ - 1));
+  for (auto &path : paths) {
+    cache_sched_->AddPath(path);
+  }
+  cache_sched_->SetShuffle(shuffle_);
+  cache_sched_->Schedule();
+
+  /// as many readers as packers, each with its merger
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < packers_.size(); ++i) {
+    auto reader = new ColumnarReader(schema_.get(), NewDevice(), true);
+    reader->set_shuffle(shuffle_);
+    readers_.emplace_back(reader);
+  }
+  for (size_t i = 0; i < readers_.size(); ++i) {
+    threads.push_back(std::thread([this, i](){this->DoRead(i);}));
+  }
+  XDL_LOG(DEBUG) << "read the next epochs from " << paths.size() << " cache files";
+  for (auto &th : threads) {
+    th.join();
+  }
   return true;
 }
 
+std::string DataIO::QueueStats() const {
+  std::stringstream ss;
+  auto print = [&ss](const char *name, const RingQueueStats &stats) {
+    ss << name << ": size=" << stats.size << "/" << stats.capacity
+       << " enqueued=" << stats.enqueued << " dequeued=" << stats.dequeued
+       << " full_ms=" << stats.full_micros / 1000
+       << " empty_ms=" << stats.empty_micros / 1000 << "\n";
+  };
+  if (sgroup_q_ != nullptr) {
+    print(pack_q_ != nullptr ? "parse -> shuffle" : op_q_ != nullptr ? "parse -> op" : "parse -> pack",
+          sgroup_q_->Stats());
+  }
+  if (pack_q_ != nullptr) {
+    print(op_q_ != nullptr ? "shuffle -> op" : "shuffle -> pack", pack_q_->Stats());
+  }
+  if (op_q_ != nullptr) {
+    print("op -> pack", op_q_->Stats());
+  }
+  if (batch_q_ != nullptr) {
+    print("pack -> get_batch", batch_q_->Stats());
+  }
+  return ss.str();
+}
+
+/* Every interval, while get batch waits for more than 5% of it, adds a
+ * thread to the stage holding it up: the parsers if the packers wait for
+ * sgroups longer than the parsers wait for room, else the packers. While it
+ * waits for less than 1%, drops a thread of a stage waiting on a full queue
+ * for more than half of the interval.
+ */
+void DataIO::Autotune() {
+  static const size_t kIntervalMs = 5000;
+  auto start = std::chrono::steady_clock::now();
+  auto elapsed = [start]() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now() - start).count();
+  };
+  bool columnar = !readers_.empty();
+  size_t max_parsers = columnar ? readers_.size() : parsers_.size();
+  size_t max_packers = packers_.size();
+  RingQueueStats sgroup = sgroup_q_->Stats(), batch = batch_q_->Stats();
+
+  while (running_ && !packers_done_ && (size_t)elapsed() < tune_seconds_) {
+    for (size_t t = 0; t < kIntervalMs / 100 && running_ && !packers_done_; ++t) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    RingQueueStats sgroup_now = sgroup_q_->Stats(), batch_now = batch_q_->Stats();
+    double interval = kIntervalMs * 1000.0;
+    size_t parsers = active_parsers_, packers = active_packers_;
+    /// fractions of the interval
+    double consumer_wait = (batch_now.empty_micros - batch.empty_micros) / interval;
+    double pack_block = (batch_now.full_micros - batch.full_micros) / interval /
+        (columnar ? parsers : packers);
+    /// with a shuffle buffer or op threads between, sgroup_q_ only tells the
+    /// parsers apart
+    double pack_starve = (sgroup_now.empty_micros - sgroup.empty_micros) / interval /
+        (pack_q_ != nullptr || op_q_ != nullptr ? 1 : packers);
+    double parse_block = (sgroup_now.full_micros - sgroup.full_micros) / interval / parsers;
+    sgroup = sgroup_now;
+    batch = batch_now;
+
+    if (consumer_wait > 0.05) {
+      bool more_parsers = columnar || pack_starve > parse_block;
+      if (more_parsers && parsers < max_parsers) {
+        ++active_parsers_;
+      } else if (!columnar && packers < max_packers) {
+        ++active_packers_;
+      } else if (parsers < max_parsers) {
+        ++active_parsers_;
+      }
+    } else if (consumer_wait < 0.01) {
+      if (columnar && pack_block > 0.5 && parsers > 1) {
+        --active_parsers_;
+      } else if (!columnar && pack_block > 0.5 && packers > 1) {
+        --active_packers_;
+      } else if (!columnar && parse_block > 0.5 && parsers > 1) {
+        --active_parsers_;
+      }
+    }
+    if (parsers != active_parsers_ || packers != active_packers_) {
+      XDL_LOG(DEBUG) << "autotune " << ds_name_ << " get_batch wait=" << consumer_wait
+          << " threads=" << active_packers_ << " threads_read=" << active_parsers_;
+    }
+  }
+  XDL_LOG(INFO) << "autotune " << ds_name_ << " chose threads=" << active_packers_
+      << " threads_read=" << active_parsers_ << " after " << elapsed() << "s";
+}
+
 bool DataIO::Restart(size_t start) {
   XDL_LOG(DEBUG) << "restart data_io " << ds_name_ << ", start_time=" << start;
   Shutdown(true);
@@ -293,22 +690,39 @@ bool DataIO::Shutdown(bool force) {
     running_ = false;
     NotifyParser();
     NotifyPacker();
+    /// the op threads might quit before passing the ENDs
+    for (size_t i = 0; op_q_ != nullptr && i < packers_.size(); ++i) {
+      op_q_->ForceEnqueue((SGroup *)END);
+    }
     batch_q_->ForceEnqueue(nullptr);
     cv_.notify_all();
   }
 
   th_wait_.join();
-  sgroup_q_->ClearAndDelete([](SGroup* sg) {
+  if (th_tune_.joinable()) {
+    th_tune_.join();
+  }
+  auto release = [](SGroup* sg) {
       if (sg != nullptr && sg != END) {
         SGroupPool::Get()->Release(sg);
       }
-  });
+  };
+  sgroup_q_->ClearAndDelete(release);
+  if (pack_q_ != nullptr) {
+    pack_q_->ClearAndDelete(release);
+  }
+  if (op_q_ != nullptr) {
+    op_q_->ClearAndDelete(release);
+  }
   batch_q_->ClearAndDelete([](Batch* batch) {
       if (batch != nullptr) {
         BatchPool::Get()->Release(batch);
       }
   });
   sched_->Clear();
+  if (cache_sched_ != nullptr) {
+    cache_sched_->Clear();
+  }
   XDL_LOG(DEBUG) << "xdl.data_io shutdown";
   return true;
 }
@@ -341,22 +755,58 @@ bool DataIO::AddPath(const std::string &path) {
 
 bool DataIO::SetEpochs(size_t epochs) {
   XDL_CHECK(!running_);
+  epochs_ = epochs;
   sched_->SetEpochs(epochs);
   return true;
 }
 
 bool DataIO::SetShuffle(bool shuffle) {
   XDL_CHECK(!running_);
+  shuffle_ = shuffle;
   sched_->SetShuffle(shuffle);
   return true;
 }
 
+bool DataIO::SetCache(const std::string &dir) {
+  XDL_CHECK(!running_);
+  cache_dir_ = dir;
+  return true;
+}
+
+bool DataIO::SetSplit(size_t split_size) {
+  XDL_CHECK(!running_);
+  if (parser_type_ != kTxt) {
+    XDL_LOG(WARNING) << "only txt files can be split";
+    return false;
+  }
+  if (!sched_->SetSplit(split_size)) {
+    XDL_LOG(WARNING) << "the scheduler doesn't split files";
+    return false;
+  }
+  return true;
+}
+
 bool DataIO::SetZType(ZType ztype) {
   XDL_CHECK(!running_);
+  ztype_ = ztype;
   sched_->SetZType(ztype);
   return true;
 }
 
+bool DataIO::SetShuffleBuffer(size_t samples, uint64_t seed) {
+  XDL_CHECK(!running_);
+  shuffle_samples_ = samples;
+  shuffle_seed_ = seed;
+  return true;
+}
+
+bool DataIO::SetOpThreads(size_t threads) {
+  XDL_CHECK(!running_);
+  XDL_CHECK(threads <= 64) << "op threads=" << threads;
+  op_threads_ = threads;
+  return true;
+}
+
 bool DataIO::SetBatchSize(size_t batch_size) {
   XDL_CHECK(!running_);
   schema_->batch_size_ = batch_size;
@@ -389,6 +839,22 @@ bool DataIO::SetKeepSKey(bool keep) {
   return true;
 }
 
+bool DataIO::SetSKeyHash(bool hash, const std::string &dict) {
+  XDL_CHECK(!running_);
+  schema_->skey_hash_ = hash;
+  schema_->skey_dict_ = hash ? dict : "";
+  if (!schema_->skey_dict_.empty()) {
+    PackSKey::ResetDict(schema_->skey_dict_);
+  }
+  return true;
+}
+
+bool DataIO::SetProjection(bool projection) {
+  XDL_CHECK(!running_);
+  projection_ = projection;
+  return true;
+}
+
 bool DataIO::SetUniqueIds(bool unique) {
   XDL_CHECK(!running_);
   unique_ = unique;
@@ -399,12 +865,38 @@ bool DataIO::GetUniqueIds() const {
   return unique_;
 }
 
+bool DataIO::SetPinMemory(bool pin) {
+  XDL_CHECK(!running_);
+#ifdef USE_GPU
+  pin_memory_ = pin;
+  return true;
+#else
+  XDL_LOG(ERROR) << "pinned memory needs USE_GPU";
+  return false;
+#endif
+}
+
+Device *DataIO::NewDevice() const {
+#ifdef USE_GPU
+  if (pin_memory_) {
+    return new PinnedCpuDevice();
+  }
+#endif
+  return new CpuDevice();
+}
+
 bool DataIO::SetPadding(bool pad) {
   XDL_CHECK(!running_);
   schema_->padding_ = pad;
   return true;
 }
 
+bool DataIO::SetPadMultiple(size_t multiple) {
+  XDL_CHECK(!running_);
+  schema_->pad_multiple_ = multiple;
+  return true;
+}
+
 bool DataIO::SetPause(size_t limit, bool wait_exactly) {
   std::unique_lock<std::mutex> lck(mutex_);
   /// wait exactly must set keep sgroup, then wait for op return false
@@ -428,6 +920,16 @@ bool DataIO::SetThreads(size_t threads,  size_t threads_read) {
   return true;
 }
 
+bool DataIO::SetAutotune(size_t max_threads, size_t max_threads_read, size_t seconds) {
+  XDL_CHECK(!running_);
+  XDL_CHECK(max_threads <= 32 && max_threads_read <= 64)
+      << "max_threads=" << max_threads << " max_threads_read=" << max_threads_read;
+  tune_threads_ = max_threads;
+  tune_threads_read_ = max_threads_read;
+  tune_seconds_ = seconds;
+  return true;
+}
+
 bool DataIO::SetStartTime(size_t ts) {
   return true;
 }
@@ -518,6 +1020,37 @@ bool DataIO::RunOps(SGroup *sgroup) {
   return true;
 }
 
+bool DataIO::ApplyOps(SGroup *sgroup) {
+  if (!RunOps(sgroup)) {
+    SGroupPool::Get()->Release(sgroup);
+    std::unique_lock<std::mutex> lck(mutex_);
+    /// all parser wait at cv, until parse_count == 0
+    if (--parse_count_ <= 0) {
+      /// it's the last sgroup, other packer wait at sgroup_q_
+      pause_ = false;
+      cv_.notify_all();
+
+      XDL_LOG(DEBUG) << "all re parsers done, notify packers exit ...";
+      NotifyPacker();
+    }
+    XDL_LOG(DEBUG) << "sgroup="<< sgroup << " -parse_count=" << parse_count_;
+    return false;
+  } else {
+    XDL_LOG(DEBUG) << "sgroup="<< sgroup << " parse_count=" << parse_count_;
+  }
+  if (sgroup->size_ != sgroup->Get()->labels_size()) {
+    if (sgroup->Get()->labels_size() == 0) {
+      // Ops del all
+      SGroupPool::Get()->Release(sgroup);
+      return false;
+    }
+    XDL_DLOG(DEBUG) << "rebuild sgroup " << sgroup->size_ 
+        << " -> " << sgroup->Get()->labels_size();
+    sgroup->Reset(sgroup->begin_);
+  }
+  return true;
+}
+
 const Batch *DataIO::GetBatch() {
   if (curr_ == nullptr) {
     return nullptr;
@@ -545,6 +1078,13 @@ const Batch *DataIO::GetBatch() {
   return curr_;
 }
 
+const Batch *DataIO::PeekNextBatch() const {
+  if (check_finish_delay_ || next_ == (Batch *)-1) {
+    return nullptr;
+  }
+  return next_;
+}
+
 bool DataIO::ReleaseBatch() {
   XDL_CHECK(curr_ != nullptr);
   if (curr_ == (Batch *)-1) {
@@ -633,6 +1173,9 @@ bool DataIO::NotifyParser() {
   for (size_t i = 0; i < parsers_.size(); ++i) {
     parsers_[i]->Shutdown();
   }
+  for (size_t i = 0; i < readers_.size(); ++i) {
+    readers_[i]->Shutdown();
+  }
   return true;
 }
 
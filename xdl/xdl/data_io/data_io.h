@@ -22,10 +22,12 @@ limitations under the License.
 #include <thread>
 
 #include "xdl/core/lib/blocking_queue.h"
+#include "xdl/core/lib/ring_queue.h"
 #include "xdl/data_io/constant.h"
 #include "xdl/data_io/batch.h"
 #include "xdl/data_io/fs/file_system.h"
 #include "xdl/data_io/parser/parser.h"
+#include "xdl/data_io/parser/columnar.h"
 #include "xdl/data_io/packer/packer.h"
 #include "xdl/data_io/merger/merger.h"
 #include "xdl/data_io/pool.h"
@@ -73,6 +75,18 @@ class DataIO {
   /*!\brief set shuffle */
   bool SetShuffle(bool shuffle);
 
+  /*!\brief shuffle the sgroups between parse and pack in a buffer of about
+   * samples samples, 0 means none. The choices are deterministic given the
+   * seed, the order the parsers feed the buffer isn't unless threads_read
+   * is 1. Sgroups are moved whole */
+  bool SetShuffleBuffer(size_t samples, uint64_t seed=0);
+
+  /*!\brief run the ops in a stage of threads of their own between parse
+   * (or the shuffle buffer) and pack, 0 means in the packers. For the
+   * expensive ops, e.g. the tdm sampling, to scale apart from the packers.
+   * Not with keep sgroup, whose ops run in the packers */
+  bool SetOpThreads(size_t threads);
+
   /*!\brief set batch size, 0 means variable size without padding */
   bool SetBatchSize(size_t batch_size=1024);
 
@@ -88,16 +102,47 @@ class DataIO {
   /*!\brief set if keep skey for debug, default false */
   bool SetKeepSKey(bool keep=true);
 
+  /*!\brief pack the sample keys as their int64 hash, 8 int8 of skbuf each,
+   * rather than the strings, default false. The hash and key of each
+   * distinct sample key are written once as a line to the local file dict
+   * if not empty, which is truncated here, for the evaluation to join */
+  bool SetSKeyHash(bool hash=true, const std::string &dict="");
+
+  /*!\brief set if the parsers skip the features not added, which holds
+   * without ops and keep sgroup only, default true */
+  bool SetProjection(bool projection=true);
+
   /*!\brief set if unique key, default true */
   bool SetUniqueIds(bool unique=true);
   bool GetUniqueIds() const;
 
+  /*!\brief allocate the batches on pinned memory, for GetBatch on a gpu to
+   * copy them asynchronously, needs USE_GPU, default false */
+  bool SetPinMemory(bool pin=true);
+
   /*!\brief set finish by next batch is null */
   bool SetFinishDelay(bool delay=true);
 
-  /*!\brief set if padding to batch size, default true */
+  /*!\brief set if padding to batch size, default true. Without padding the
+   * batches are ragged, the sparse features by their segments */
   bool SetPadding(bool pad=true);
 
+  /*!\brief pad the short batches to a multiple of multiple rows only, as
+   * the gpu kernels need, rather than to the batch size, 0 means the batch
+   * size. The padding rows are at the end, batch size_ counts the samples */
+  bool SetPadMultiple(size_t multiple=0);
+
+  /*!\brief cache the batches of the first epoch in a local dir, the next
+   * epochs are read from there, shuffled by chunk if shuffle is set. Needs
+   * neither ops nor keep sgroup, and the features in table 0 */
+  bool SetCache(const std::string &dir);
+
+  /*!\brief read files larger than split_size bytes as ranges of about
+   * that size, so that workers share the tail of the epoch, only for txt
+   * and the global scheduler. A sample group across a range end is read
+   * as two */
+  bool SetSplit(size_t split_size);
+
   /*!\brief set compress format */
   bool SetZType(ZType ztype);
 
@@ -107,6 +152,11 @@ class DataIO {
   /*!\brief set num of threads */
   bool SetThreads(size_t threads, size_t threads_read=8);
 
+  /*!\brief tune the threads of the parsers (or columnar readers) and the
+   * packers up to these bounds during the first seconds of the job, starting
+   * from SetThreads, by how long get batch and each stage wait on the queues */
+  bool SetAutotune(size_t max_threads, size_t max_threads_read, size_t seconds=300);
+
   /*!\brief set start point for online learning */
   bool SetStartTime(size_t ts);
 
@@ -139,13 +189,32 @@ class DataIO {
   FileSystem &fs();
 
   bool RunOps(SGroup *sg);
+  /// runs the ops and rebuilds sg, false if sg is dropped
+  bool ApplyOps(SGroup *sg);
+  /// moves the sgroups to op_q_ through the ops
+  bool DoRunOps(size_t tid);
   bool DoParse(size_t tid);
   bool DoPack(size_t tid);
+  /// moves the sgroups from sgroup_q_ to pack_q_ through the shuffle buffer
+  bool DoShuffle();
+  /// the columnar reader threads take the place of parsers and packers
+  bool DoRead(size_t tid);
+  /// the device the batch tensors are allocated on
+  Device *NewDevice() const;
+  void PushBatch(Batch *batch);
+  /// enqueues the batch still in the merger, if any
+  void FlushMerger(Merger *merger);
 
   bool Wait();
+  /// the epochs after the first one, from the cache
+  bool ReadCache();
+  /// adjusts active_parsers_ and active_packers_ while autotuning
+  void Autotune();
 
   const Batch *GetBatch();
   const Batch *GetBatchNext();
+  /// batch already dequeued for the next step, nullptr if none yet
+  const Batch *PeekNextBatch() const;
   bool ReleaseBatch();
   Batch *CurrBatch();
   bool finished() const;
@@ -156,6 +225,10 @@ class DataIO {
   bool NotifyParser();
   bool NotifyPacker();
 
+  /*!\brief depth and wait times of the parse -> pack -> get batch queues,
+   * a stage waiting on a full queue is ahead of the next one */
+  std::string QueueStats() const;
+
   std::string Store();
   bool Restore(const std::string &pbstr);
 
@@ -170,6 +243,8 @@ class DataIO {
   size_t threads_ = 1;
   size_t threads_read_ = 8;
   bool unique_ = false;
+  bool projection_ = true;
+  bool pin_memory_ = false;
   bool check_finish_delay_ = false;
   std::vector<Operator *> ops_;
 
@@ -178,17 +253,55 @@ class DataIO {
   std::vector<std::unique_ptr<Parser>> parsers_;
   std::vector<std::unique_ptr<Packer>> packers_;
   std::vector<std::unique_ptr<Merger>> mergers_;
+  std::vector<std::unique_ptr<ColumnarReader>> readers_;
+  ZType ztype_ = kRaw;
+  size_t epochs_ = 1;
+  bool shuffle_ = false;
+
+  std::string cache_dir_;
+  /// a writer for each packer while caching the first epoch
+  std::vector<std::unique_ptr<IOAnt>> cache_ants_;
+  std::vector<std::unique_ptr<ColumnarWriter>> cache_writers_;
+  /// schedules the cache files, for DoRead, once the first epoch is done
+  std::unique_ptr<Scheduler> cache_sched_;
 
   std::vector<std::thread> th_parsers_;
   std::vector<std::thread> th_packers_;
   std::thread th_wait_;
+  std::thread th_tune_;
+  std::thread th_shuffle_;
+  bool shuffle_done_ = false;
+  std::vector<std::thread> th_ops_;
+  bool ops_done_ = false;
+  size_t op_threads_ = 0;
+  /// serializes the dequeues of the op threads with the count of the
+  /// sgroups they run, so an END passes only after the sgroups before it
+  std::mutex op_mutex_;
+  std::atomic<size_t> ops_running_{0};
+
+  size_t shuffle_samples_ = 0;
+  uint64_t shuffle_seed_ = 0;
+
+  /// seconds to autotune, 0 for none
+  size_t tune_seconds_ = 0;
+  size_t tune_threads_ = 0;
+  size_t tune_threads_read_ = 0;
+  /// the threads over these wait, between files for the parsers
+  std::atomic<size_t> active_parsers_{0};
+  std::atomic<size_t> active_packers_{0};
 
   bool running_ = false;
   bool parsers_done_ = false;
   bool packers_done_ = false;
 
-  BlockingQueue<SGroup*> *sgroup_q_ = nullptr;
-  BlockingQueue<Batch*> *batch_q_ = nullptr;
+  /// parsers to packers
+  RingQueue<SGroup*> *sgroup_q_ = nullptr;
+  /// shuffle buffer to packers, if any
+  RingQueue<SGroup*> *pack_q_ = nullptr;
+  /// op threads to packers, if any
+  RingQueue<SGroup*> *op_q_ = nullptr;
+  /// packers to GetBatch
+  RingQueue<Batch*> *batch_q_ = nullptr;
   /// -1 : begin, nullptr: end
   Batch *curr_ = (Batch *)-1;
   Batch *next_ = (Batch *)-1;
@@ -0,0 +1,283 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/data_io/fs/bgzf_ant.h"
+
+#include <stdlib.h>
+#include <zlib.h>
+#include <algorithm>
+#include <thread>
+
+#include "xdl/core/lib/thread_pool.h"
+#include "xdl/core/utils/logging.h"
+
+namespace xdl {
+namespace io {
+
+namespace {
+
+const size_t kHeaderSize = 12;
+const size_t kTrailerSize = 8;
+/// uncompressed data of a member, keeps incompressible members under 64KB
+const size_t kMaxInputSize = 0xff00;
+
+ThreadPool *InflatePool() {
+  static ThreadPool pool([] {
+    const char *env = getenv("XDL_IO_BGZF_THREADS");
+    size_t threads = env == nullptr ? std::thread::hardware_concurrency()
+                                    : strtoul(env, nullptr, 10);
+    return std::max<size_t>(1, threads);
+  }());
+  return &pool;
+}
+
+uint16_t Get16(const char *p) {
+  const unsigned char *u = reinterpret_cast<const unsigned char *>(p);
+  return u[0] | (u[1] << 8);
+}
+
+uint32_t Get32(const char *p) {
+  return Get16(p) | (static_cast<uint32_t>(Get16(p + 2)) << 16);
+}
+
+void Put16(uint16_t v, std::string *out) {
+  out->push_back(static_cast<char>(v & 0xff));
+  out->push_back(static_cast<char>(v >> 8));
+}
+
+void Put32(uint32_t v, std::string *out) {
+  Put16(v & 0xffff, out);
+  Put16(v >> 16, out);
+}
+
+void Deflate(const char *data, size_t len, int level, std::string *out) {
+  std::string deflated(compressBound(len), 0);
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  XDL_CHECK(deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8,
+                         Z_DEFAULT_STRATEGY) == Z_OK);
+  stream.next_in = (Bytef *)data;
+  stream.avail_in = len;
+  stream.next_out = (Bytef *)&deflated[0];
+  stream.avail_out = deflated.size();
+  XDL_CHECK(deflate(&stream, Z_FINISH) == Z_STREAM_END);
+  size_t size = stream.total_out;
+  deflateEnd(&stream);
+
+  // gzip header with FLG.FEXTRA, OS unknown, and the BC extra subfield
+  const char header[] = {31, (char)139, 8, 4, 0, 0, 0, 0, 0, (char)255};
+  out->append(header, sizeof(header));
+  Put16(6, out);
+  out->push_back('B');
+  out->push_back('C');
+  Put16(2, out);
+  Put16(kHeaderSize + 6 + size + kTrailerSize - 1, out);
+  out->append(deflated.data(), size);
+  Put32(crc32(0, (const Bytef *)data, len), out);
+  Put32(len, out);
+}
+
+}  // namespace
+
+size_t BgzfAnt::DefaultDepth() {
+  static size_t depth = [] {
+    const char *env = getenv("XDL_IO_BGZF_DEPTH");
+    return std::max<size_t>(1, env == nullptr ? 64 : strtoul(env, nullptr, 10));
+  }();
+  return depth;
+}
+
+BgzfAnt::BgzfAnt(IOAnt* input_stream, size_t depth)
+    : input_stream_(input_stream), depth_(depth) {
+  XDL_CHECK(depth_ > 0);
+}
+
+BgzfAnt::~BgzfAnt() {
+  Drop();
+}
+
+ssize_t BgzfAnt::ReadFull(char* data, size_t len) {
+  size_t read = 0;
+  while (read < len) {
+    ssize_t n = input_stream_->Read(data + read, len - read);
+    if (n < 0) {
+      return n;
+    } else if (n == 0) {
+      break;
+    }
+    read += n;
+  }
+  return read;
+}
+
+int BgzfAnt::ReadBlock(std::string* input) {
+  input->resize(kHeaderSize);
+  ssize_t n = ReadFull(&(*input)[0], kHeaderSize);
+  if (n == 0) {
+    return 0;
+  }
+  const char *p = input->data();
+  if (n != (ssize_t)kHeaderSize || Get16(p) != 0x8b1f || p[2] != Z_DEFLATED ||
+      (p[3] & 0x04) == 0) {
+    XDL_LOG(ERROR) << "not a bgzf member header";
+    return -1;
+  }
+
+  size_t xlen = Get16(p + 10);
+  input->resize(kHeaderSize + xlen);
+  if (ReadFull(&(*input)[kHeaderSize], xlen) != (ssize_t)xlen) {
+    XDL_LOG(ERROR) << "truncated bgzf extra field";
+    return -1;
+  }
+  size_t bsize = 0;
+  for (size_t i = kHeaderSize; i + 4 <= kHeaderSize + xlen;) {
+    p = input->data() + i;
+    size_t slen = Get16(p + 2);
+    if (p[0] == 'B' && p[1] == 'C' && slen == 2) {
+      bsize = Get16(p + 4) + 1;
+      break;
+    }
+    i += 4 + slen;
+  }
+  if (bsize < kHeaderSize + xlen + kTrailerSize) {
+    XDL_LOG(ERROR) << "no bgzf block size in the gzip extra field";
+    return -1;
+  }
+
+  size_t offset = kHeaderSize + xlen;
+  input->resize(bsize);
+  if (ReadFull(&(*input)[offset], bsize - offset) != (ssize_t)(bsize - offset)) {
+    XDL_LOG(ERROR) << "truncated bgzf member";
+    return -1;
+  }
+  return 1;
+}
+
+void BgzfAnt::Inflate(Block* block) {
+  const std::string &in = block->input;
+  size_t xlen = Get16(in.data() + 10);
+  size_t begin = kHeaderSize + xlen;
+  size_t end = in.size() - kTrailerSize;
+  uint32_t crc = Get32(in.data() + end);
+  uint32_t isize = Get32(in.data() + end + 4);
+
+  block->output.resize(isize);
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  bool ok = inflateInit2(&stream, -MAX_WBITS) == Z_OK;
+  if (ok) {
+    stream.next_in = (Bytef *)in.data() + begin;
+    stream.avail_in = end - begin;
+    stream.next_out = (Bytef *)&block->output[0];
+    stream.avail_out = isize;
+    ok = inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.avail_out == 0 &&
+         crc32(0, (const Bytef *)block->output.data(), isize) == crc;
+    inflateEnd(&stream);
+  }
+  // the input isn't needed anymore
+  std::string().swap(block->input);
+
+  std::unique_lock<std::mutex> lck(block->mutex);
+  block->ok = ok;
+  block->done = true;
+  block->cv.notify_all();
+}
+
+bool BgzfAnt::Fill() {
+  while (!eof_ && blocks_.size() < depth_) {
+    std::shared_ptr<Block> block(new Block);
+    int ret = ReadBlock(&block->input);
+    if (ret <= 0) {
+      eof_ = true;
+      if (ret < 0) {
+        return false;
+      }
+      break;
+    }
+    blocks_.push_back(block);
+    InflatePool()->Schedule([block]() { Inflate(block.get()); });
+  }
+  return true;
+}
+
+void BgzfAnt::Wait(Block* block) {
+  std::unique_lock<std::mutex> lck(block->mutex);
+  block->cv.wait(lck, [block] { return block->done; });
+}
+
+void BgzfAnt::Drop() {
+  while (!blocks_.empty()) {
+    Wait(blocks_.front().get());
+    blocks_.pop_front();
+  }
+  pos_ = 0;
+}
+
+ssize_t BgzfAnt::Read(char* data, size_t len) {
+  size_t read = 0;
+  while (read < len && !error_) {
+    if (!Fill()) {
+      error_ = true;
+    }
+    if (blocks_.empty()) {
+      break;
+    }
+    Block *block = blocks_.front().get();
+    Wait(block);
+    if (!block->ok) {
+      XDL_LOG(ERROR) << "inflate bgzf member failed";
+      error_ = true;
+      break;
+    }
+    size_t n = std::min(len - read, block->output.size() - pos_);
+    if (data != nullptr) {
+      memcpy(data + read, block->output.data() + pos_, n);
+    }
+    read += n;
+    pos_ += n;
+    if (pos_ == block->output.size()) {
+      blocks_.pop_front();
+      pos_ = 0;
+    }
+  }
+  return error_ && read == 0 ? -1 : read;
+}
+
+ssize_t BgzfAnt::Write(const char* data, size_t len) {
+  return input_stream_->Write(data, len);
+}
+
+off_t BgzfAnt::Seek(off_t offset) {
+  Drop();
+  input_stream_->Seek(0);
+  eof_ = false;
+  error_ = false;
+  auto len = Read(nullptr, offset);
+  XDL_CHECK(len == offset);
+  return offset;
+}
+
+std::string BgzfAnt::Compress(const char* data, size_t len, int level) {
+  std::string out;
+  for (size_t pos = 0; pos < len; pos += kMaxInputSize) {
+    Deflate(data + pos, std::min(len - pos, kMaxInputSize), level, &out);
+  }
+  // the empty end of file member
+  Deflate(nullptr, 0, level, &out);
+  return out;
+}
+
+}  // namespace io
+}  // namespace xdl
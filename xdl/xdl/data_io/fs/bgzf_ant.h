@@ -0,0 +1,81 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XDL_IO_FS_BGZF_ANT_H_
+#define XDL_IO_FS_BGZF_ANT_H_
+
+#include "xdl/core/lib/common_defines.h"
+#include "xdl/data_io/fs/file_system.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace xdl {
+namespace io {
+
+/// Reads a BGZF file, gzip members of at most 64KB each with their size in
+/// the gzip extra field, as written by bgzip. The members are independent,
+/// depth of them are inflated in parallel on a shared pool while the file
+/// is read on.
+class BgzfAnt : public IOAnt {
+ public:
+  BgzfAnt(IOAnt* input_stream, size_t depth = DefaultDepth());
+  virtual ~BgzfAnt();
+  virtual ssize_t Read(char* data, size_t len);
+  virtual ssize_t Write(const char* data, size_t len);
+  virtual off_t Seek(off_t offset);
+  virtual void Prefetch() { input_stream_->Prefetch(); }
+
+  /// XDL_IO_BGZF_DEPTH members, 64 by default
+  static size_t DefaultDepth();
+  /// BGZF members of data, with the empty end of file member
+  static std::string Compress(const char* data, size_t len,
+                              int level = 6);
+  DISALLOW_COPY_AND_ASSIGN(BgzfAnt);
+
+ private:
+  struct Block {
+    std::string input;
+    std::string output;
+    bool ok = false;
+    bool done = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+  };
+
+  /// 1 on a member, 0 at the end of the file, -1 on a broken one
+  int ReadBlock(std::string* input);
+  ssize_t ReadFull(char* data, size_t len);
+  bool Fill();
+  void Wait(Block* block);
+  void Drop();
+  static void Inflate(Block* block);
+
+  std::unique_ptr<IOAnt> input_stream_;
+  size_t depth_;
+  bool eof_ = false;
+  bool error_ = false;
+  /// read position in the output of the first block
+  size_t pos_ = 0;
+  std::deque<std::shared_ptr<Block>> blocks_;
+};
+
+}  // namespace io
+}  // namespace xdl
+
+#endif  // XDL_IO_FS_BGZF_ANT_H_
@@ -21,6 +21,8 @@ limitations under the License.
 #include "xdl/data_io/fs/file_system_hdfs.h"
 #include "xdl/data_io/fs/file_system_local.h"
 #include "xdl/data_io/fs/file_system_kafka.h"
+#include "xdl/data_io/fs/bgzf_ant.h"
+#include "xdl/data_io/fs/prefetch_ant.h"
 #include "xdl/data_io/fs/zlib_ant.h"
 #include "xdl/core/utils/logging.h"
 
@@ -50,8 +52,14 @@ bool FileSystem::Write(const std::string &path, const std::string &content) {
 
 IOAnt *FileSystem::GetZAnt(const char *path, ZType ztype) {
   auto *ant = GetAnt(path);
+  if (ant->CanReadAt() && PrefetchAnt::DefaultDepth() > 0) {
+    ant = new PrefetchAnt(ant, PrefetchAnt::DefaultBlockSize(),
+                          PrefetchAnt::DefaultDepth());
+  }
   if (ztype == kZLib) {
     ant = new ZlibAnt(ant);
+  } else if (ztype == kBgzf) {
+    ant = new BgzfAnt(ant);
   }
   return ant;
 }
@@ -39,6 +39,15 @@ class IOAnt {
   /*!\brief seek to offset */
   virtual off_t Seek(off_t offset) = 0;
   virtual off_t SeekRange(off_t begin, off_t end) {}
+  /*!\brief read at offset, leaves the read position as it is */
+  virtual ssize_t ReadAt(off_t offset, char* data, size_t len) { return -1; }
+  /*!\brief whether ReadAt is supported and safe from several threads */
+  virtual bool CanReadAt() const { return false; }
+  /*!\brief start reading ahead from the read position, if supported */
+  virtual void Prefetch() {}
+  /*!\brief the offset to seek to for resuming at pos, pos being the last
+   * seek offset plus the bytes read since, for streams not seeking bytes */
+  virtual off_t Position(off_t pos) { return pos; }
 
   /*! set ref */
   void set_ref(bool ref) { ref_ = ref; }
@@ -57,7 +66,7 @@ class FileSystem {
   virtual ~FileSystem() { }
   virtual IOAnt *GetAnt(const char *path, char mode='r') = 0;
 
-  /// only support zlib with read
+  /// only support zlib with read, prefetched when the ant can ReadAt
   IOAnt *GetZAnt(const char *path, ZType ztype);
 
   virtual bool IsDir(const char *path) = 0;
@@ -82,6 +82,28 @@ class IOAntHdfs: public IOAnt {
     return offset;
   }
 
+  /*!\brief read at offset with hdfsPread */
+  virtual ssize_t ReadAt(off_t offset, char *data, size_t len) override {
+    size_t nleft = len;
+    while (nleft != 0) {
+      tSize ret = hdfs_->hdfsPread(fs_, fd_, offset, data, nleft);
+      if (ret > 0) {
+        size_t n = static_cast<size_t>(ret);
+        nleft -= n; data += n; offset += n;
+      } else if (ret == 0) {
+        break;
+      } else {
+        int errsv = errno;
+        if (errno == EINTR) continue;
+        XDL_LOG(ERROR) << "HDFSStream.hdfsPread Error:" << strerror(errsv);
+        return -1;
+      }
+    }
+    return len - nleft;
+  }
+
+  virtual bool CanReadAt() const override { return true; }
+
  protected:
   /*! hdfs io */
   hdfsFS fs_;
@@ -18,23 +18,61 @@ limitations under the License.
 #include <memory>
 #include <omp.h>
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
 
 #include "xdl/core/utils/logging.h"
 
 namespace {
 const char* kNameServiceKey = "NAME_SERVICE";
 const char* kSeparator = ":";
-int kTimeout = 10000; /* Timeout for Kafka client is 10 seconds */
+/* Timeout for Kafka client is 10 seconds, negative to wait forever */
+int kTimeout = 10000;
+/* Poll interval while gathering messages into one read */
+const int kPollMs = 100;
+/* The parser holds less than this many bytes not yet parsed */
+const off_t kParserLag = 256 << 20;
+
+int64_t GetEnv(const char *name, int64_t value) {
+  const char *env = getenv(name);
+  return env == nullptr ? value : strtoll(env, nullptr, 10);
+}
+
+int64_t NowMicros() {
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/// sets conf key from the env var name when it is set
+void SetConf(RdKafka::Conf *conf, const char *key, const char *name) {
+  const char *env = getenv(name);
+  std::string errstr;
+  if (env != nullptr && conf->set(key, env, errstr) != RdKafka::Conf::CONF_OK) {
+    XDL_LOG(ERROR) << "Failed to set Kafka " << key << "=" << env << " [" << errstr << "]";
+  }
+}
+
 }  // namespace 
 
 namespace xdl {
 namespace io {
 
-/// Kafka IO ant
+/// Kafka IO ant, a read hands out as many of the messages already fetched
+/// as fit, each message is copied once into the parser buffer. It keeps
+/// the kafka offset of the messages not yet parsed for Position.
 class IOAntKafka: public IOAnt {
  public:
-  IOAntKafka(RdKafka::Topic *topic, RdKafka::Consumer *consumer, int partition) : topic_(topic), consumer_(consumer), partition_(partition), offset_(0) { }
+  IOAntKafka(RdKafka::Topic *topic, RdKafka::Consumer *consumer, int partition)
+      : topic_(topic), consumer_(consumer), partition_(partition), offset_(0) {
+    timeout_ = GetEnv("XDL_KAFKA_TIMEOUT_MS", kTimeout);
+    stats_micros_ = GetEnv("XDL_KAFKA_STATS_SECONDS", 60) * 1000000;
+    report_micros_ = NowMicros();
+  }
   ~IOAntKafka() { 
+    msg_.reset();
     consumer_->stop(topic_, partition_);
     delete topic_;
     delete consumer_;
@@ -42,25 +80,32 @@ class IOAntKafka: public IOAnt {
 
   /*!\brief read data */
   virtual ssize_t Read(char *data, size_t len) override {
-    std::unique_ptr<RdKafka::Message> msg(consumer_->consume(topic_, partition_, kTimeout));
-    switch (msg->err()) {
-      case RdKafka::ERR__TIMED_OUT:
-        XDL_LOG(WARNING) << "Kafka consume time out";
-        return 0;
-      case RdKafka::ERR__PARTITION_EOF:
-        XDL_LOG(WARNING) << "Kafka consume reach end of partition";
-        return 0;
-      case RdKafka::ERR_NO_ERROR:
-        XDL_LOG(DEBUG) << "Kafka consume read " << msg->len();
-        break;
-
-      default:
-        XDL_LOG(ERROR) << "Kafka consume fail! [" << topic_ << "," << partition_ << "]";
-        return 0;
+    size_t n = 0;
+    int waited = 0;
+    while (n < len) {
+      if (msg_ == nullptr || used_ == msg_->len()) {
+        // block for the first message only, then take what is fetched
+        if (!Next(n == 0 ? kPollMs : 0, n)) {
+          if (n > 0)  break;
+          waited += kPollMs;
+          if (timeout_ >= 0 && waited >= timeout_) {
+            XDL_LOG(WARNING) << "Kafka consume time out";
+            return 0;
+          }
+        }
+        continue;
+      }
+      size_t size = std::min(len - n, msg_->len() - used_);
+      memcpy(data + n, static_cast<const char *>(msg_->payload()) + used_, size);
+      used_ += size;
+      n += size;
     }
-    memcpy(data, msg->payload(), msg->len());
-    len = msg->len();
-    return len;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      pos_ += n;
+    }
+    Report();
+    return n;
   }
 
   /*!\brief write data */
@@ -71,6 +116,15 @@ class IOAntKafka: public IOAnt {
   /*!\brief seek to offset */
   virtual off_t Seek(off_t offset) override {
     offset_ = offset;
+    msg_.reset();
+    used_ = 0;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      messages_.clear();
+      pos_ = offset_;
+      resume_ = offset_;
+      next_ = offset_;
+    }
     consumer_->stop(topic_, partition_);
     RdKafka::ErrorCode err = consumer_->start(topic_, partition_, offset_);
     if (err != RdKafka::ERR_NO_ERROR) {
@@ -80,14 +134,105 @@ class IOAntKafka: public IOAnt {
     return offset_;
   }
 
+  /*!\brief the first message not parsed all, stored as the offset to commit */
+  virtual off_t Position(off_t pos) override {
+    std::unique_lock<std::mutex> lock(mu_);
+    while (!messages_.empty() && messages_.front().end <= pos) {
+      resume_ = messages_.front().offset + 1;
+      messages_.pop_front();
+    }
+    // a message parsed in part is read again after a restore
+    int64_t offset = messages_.empty() ? resume_ : messages_.front().offset;
+    topic_->offset_store(partition_, offset);
+    return offset;
+  }
+
  protected:
+  struct Message {
+    /// the stream position after the message
+    off_t end;
+    int64_t offset;
+  };
+
+  /// makes the next message current, false if none came within timeout,
+  /// read bytes of the current read are handed out before it
+  bool Next(int timeout, size_t read) {
+    msg_.reset(consumer_->consume(topic_, partition_, timeout));
+    used_ = 0;
+    switch (msg_->err()) {
+      case RdKafka::ERR_NO_ERROR:
+        break;
+      case RdKafka::ERR__TIMED_OUT:
+      case RdKafka::ERR__PARTITION_EOF:
+        msg_.reset();
+        return false;
+      default:
+        XDL_LOG(ERROR) << "Kafka consume fail! [" << topic_->name() << "," << partition_
+                       << "] " << msg_->errstr();
+        msg_.reset();
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(mu_);
+    const off_t end = pos_ + read + msg_->len();
+    messages_.push_back({end, msg_->offset()});
+    next_ = msg_->offset() + 1;
+    // without stores, only keep what the parser may not have parsed yet
+    while (messages_.size() > 1 && messages_.front().end + kParserLag < end) {
+      resume_ = messages_.front().offset + 1;
+      messages_.pop_front();
+    }
+    ++count_;
+    bytes_ += msg_->len();
+    return true;
+  }
+
+  /// logs the lag and throughput every XDL_KAFKA_STATS_SECONDS
+  void Report() {
+    if (stats_micros_ <= 0)  return;
+    int64_t now = NowMicros();
+    if (now - report_micros_ < stats_micros_)  return;
+    int64_t low = 0, high = 0;
+    consumer_->get_watermark_offsets(topic_->name(), partition_, &low, &high);
+    std::unique_lock<std::mutex> lock(mu_);
+    double seconds = (now - report_micros_) / 1e6;
+    XDL_LOG(INFO) << "Kafka " << topic_->name() << kSeparator << partition_
+                  << " offset=" << next_ << " lag=" << std::max<int64_t>(0, high - next_)
+                  << " msgs/s=" << count_ / seconds
+                  << " MB/s=" << bytes_ / seconds / (1 << 20);
+    count_ = 0;
+    bytes_ = 0;
+    report_micros_ = now;
+  }
+
   RdKafka::Topic *topic_;
   RdKafka::Consumer *consumer_;
   int partition_;
   off_t offset_;
+  int timeout_;
+
+  /// the current message and how much of it was read
+  std::unique_ptr<RdKafka::Message> msg_;
+  size_t used_ = 0;
+
+  /// guards the positions below, Position is called by the store
+  std::mutex mu_;
+  /// stream position, the seek offset plus the bytes read since
+  off_t pos_ = 0;
+  /// the messages read at most kParserLag bytes ago
+  std::deque<Message> messages_;
+  /// the offset after the last message dropped from messages_
+  int64_t resume_ = 0;
+  int64_t next_ = 0;
+
+  int64_t stats_micros_;
+  int64_t report_micros_;
+  int64_t count_ = 0;
+  int64_t bytes_ = 0;
 };
 
-IOAnt *FileSystemKafka::GetAnt(const char *path, char mode) {
+/// fetches are tuned by env, XDL_KAFKA_QUEUE_KBYTES bounds the messages
+/// fetched ahead of the parser, so a full sgroup queue stops the fetches
+RdKafka::Consumer *FileSystemKafka::CreateConsumer() {
   std::string errstr;
   RdKafka::Conf *conf = RdKafka::Conf::create(RdKafka::Conf::CONF_GLOBAL);
   if (!conf) {
@@ -95,21 +240,37 @@ IOAnt *FileSystemKafka::GetAnt(const char *path, char mode) {
     return nullptr;
   }
   conf->set("metadata.broker.list", namenode_, errstr);
-  conf->set("group.id", "0", errstr);
+  const char *group = getenv("XDL_KAFKA_GROUP");
+  conf->set("group.id", group == nullptr ? "0" : group, errstr);
+  SetConf(conf, "fetch.message.max.bytes", "XDL_KAFKA_FETCH_BYTES");
+  SetConf(conf, "fetch.wait.max.ms", "XDL_KAFKA_FETCH_WAIT_MS");
+  SetConf(conf, "queued.min.messages", "XDL_KAFKA_QUEUE_MESSAGES");
+  SetConf(conf, "queued.max.messages.kbytes", "XDL_KAFKA_QUEUE_KBYTES");
 
   RdKafka::Consumer *consumer = RdKafka::Consumer::create(conf, errstr);
+  delete conf;
   if (!consumer) {
     XDL_LOG(ERROR) << "Failed to create Kafkaconsumer for " << namenode_
                << " [" << errstr << "]";
     return nullptr;
   }
-  delete conf;
+  return consumer;
+}
+
+IOAnt *FileSystemKafka::GetAnt(const char *path, char mode) {
+  std::string errstr;
+  RdKafka::Consumer *consumer = CreateConsumer();
+  if (!consumer) {
+    return nullptr;
+  }
 
   RdKafka::Conf *tconf = RdKafka::Conf::create(RdKafka::Conf::CONF_TOPIC);
   if (!tconf) { 
     XDL_LOG(ERROR) << "Failed to create tconf";
     return nullptr;
   }
+  /* Offsets stored by Position are committed to the broker */
+  tconf->set("auto.commit.enable", "true", errstr);
 
   /* Get topic string and partition from 'path' argument */
   size_t pos = std::string(path).find(kSeparator);
@@ -146,12 +307,34 @@ bool FileSystemKafka::IsReg(const char *path) {
 }
 
 bool FileSystemKafka::IsDir(const char *path) {
-  return false;
+  return !IsReg(path);
 }
 
+/// the 'topic:partition' paths of all partitions of a topic, one reader each
 std::vector<std::string> FileSystemKafka::Dir(const char *path) {
-  XDL_LOG(ERROR) << "Traverse of directory is not supported in Kafka";
   std::vector<std::string> paths;
+  std::unique_ptr<RdKafka::Consumer> consumer(CreateConsumer());
+  if (!consumer) {
+    return paths;
+  }
+  std::string errstr;
+  std::unique_ptr<RdKafka::Topic> topic(RdKafka::Topic::create(consumer.get(), path, nullptr, errstr));
+  if (!topic) {
+    XDL_LOG(ERROR) << "Failed to create topic: " << path << " [" << errstr << "]";
+    return paths;
+  }
+  RdKafka::Metadata *metadata = nullptr;
+  RdKafka::ErrorCode err = consumer->metadata(false, topic.get(), &metadata, kTimeout);
+  if (err != RdKafka::ERR_NO_ERROR) {
+    XDL_LOG(ERROR) << "Failed to get metadata of topic " << path;
+    return paths;
+  }
+  for (auto topic_metadata : *metadata->topics()) {
+    for (auto partition_metadata : *topic_metadata->partitions()) {
+      paths.push_back(std::string(path) + kSeparator + std::to_string(partition_metadata->id()));
+    }
+  }
+  delete metadata;
   return paths;
 }
 
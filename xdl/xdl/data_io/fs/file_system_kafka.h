@@ -44,6 +44,7 @@ class FileSystemKafka : public FileSystem {
   
  protected:
   FileSystemKafka(const char* namenode);
+  RdKafka::Consumer *CreateConsumer();
 
   /*! the host:port of kafka service */
   std::string namenode_;
@@ -16,6 +16,7 @@ limitations under the License.
 #include "xdl/data_io/fs/file_system_local.h"
 
 #include <dirent.h>
+#include <errno.h>
 #include <memory>
 #include <omp.h>
 #include <sys/types.h>
@@ -48,6 +49,24 @@ class IOAntLocal : public IOAnt {
     return fseek(fd_, offset, SEEK_SET);
   }
 
+  /*!\brief read at offset with pread */
+  virtual ssize_t ReadAt(off_t offset, char *data, size_t len) override {
+    size_t nleft = len;
+    while (nleft != 0) {
+      ssize_t ret = pread(fileno(fd_), data, nleft, offset);
+      if (ret > 0) {
+        nleft -= ret; data += ret; offset += ret;
+      } else if (ret == 0) {
+        break;
+      } else if (errno != EINTR) {
+        return -1;
+      }
+    }
+    return len - nleft;
+  }
+
+  virtual bool CanReadAt() const override { return true; }
+
  protected:
   /*! read only fd */
   FILE *fd_;
@@ -0,0 +1,170 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/data_io/fs/prefetch_ant.h"
+
+#include <stdlib.h>
+#include <algorithm>
+
+#include "xdl/core/lib/thread_pool.h"
+#include "xdl/core/utils/logging.h"
+
+namespace xdl {
+namespace io {
+
+namespace {
+
+size_t GetEnv(const char *name, size_t value) {
+  const char *env = getenv(name);
+  return env == nullptr ? value : strtoul(env, nullptr, 10);
+}
+
+/// the reads mostly wait on the network, hence more threads than cores
+ThreadPool *IOPool() {
+  static ThreadPool pool(std::max<size_t>(1, GetEnv("XDL_IO_PREFETCH_THREADS", 32)));
+  return &pool;
+}
+
+}  // namespace
+
+size_t PrefetchAnt::DefaultBlockSize() {
+  static size_t size = std::max<size_t>(1, GetEnv("XDL_IO_PREFETCH_BLOCK", 1 << 20));
+  return size;
+}
+
+size_t PrefetchAnt::DefaultDepth() {
+  static size_t depth = GetEnv("XDL_IO_PREFETCH_DEPTH", 4);
+  return depth;
+}
+
+PrefetchAnt::PrefetchAnt(IOAnt* input_stream, size_t block_size, size_t depth)
+    : input_stream_(input_stream), block_size_(block_size), depth_(depth) {
+  XDL_CHECK(input_stream_->CanReadAt());
+  XDL_CHECK(block_size_ > 0 && depth_ > 0);
+}
+
+PrefetchAnt::~PrefetchAnt() {
+  Drop();
+}
+
+void PrefetchAnt::Fill() {
+  while (!eof_ && blocks_.size() < depth_) {
+    std::shared_ptr<Block> block(new Block);
+    block->offset = next_;
+    if (free_.empty()) {
+      block->data.reset(new char[block_size_]);
+    } else {
+      block->data = std::move(free_.back());
+      free_.pop_back();
+    }
+    next_ += block_size_;
+    blocks_.push_back(block);
+
+    IOAnt *ant = input_stream_.get();
+    size_t size = block_size_;
+    IOPool()->Schedule([ant, block, size]() {
+      ssize_t ret = ant->ReadAt(block->offset, block->data.get(), size);
+      std::unique_lock<std::mutex> lck(block->mutex);
+      block->size = ret;
+      block->done = true;
+      block->cv.notify_all();
+    });
+  }
+}
+
+void PrefetchAnt::Wait(Block* block) {
+  std::unique_lock<std::mutex> lck(block->mutex);
+  block->cv.wait(lck, [block] { return block->done; });
+}
+
+void PrefetchAnt::Pop() {
+  Wait(blocks_.front().get());
+  free_.push_back(std::move(blocks_.front()->data));
+  blocks_.pop_front();
+}
+
+void PrefetchAnt::Drop() {
+  // the reads in flight use the blocks and input_stream_
+  while (!blocks_.empty()) {
+    Pop();
+  }
+}
+
+void PrefetchAnt::Prefetch() {
+  started_ = true;
+  Fill();
+}
+
+ssize_t PrefetchAnt::Read(char* data, size_t len) {
+  started_ = true;
+  size_t read = 0;
+  while (read < len) {
+    Fill();
+    if (blocks_.empty()) {
+      break;
+    }
+    Block *block = blocks_.front().get();
+    Wait(block);
+    if (block->size < 0) {
+      Drop();
+      return read > 0 ? read : -1;
+    }
+    size_t pos = offset_ - block->offset;
+    if (pos < (size_t)block->size) {
+      size_t n = std::min(len - read, block->size - pos);
+      memcpy(data + read, block->data.get() + pos, n);
+      read += n;
+      offset_ += n;
+    }
+    if (offset_ >= block->offset + block->size) {
+      bool last = block->size < (ssize_t)block_size_;
+      Pop();
+      if (last) {
+        // the blocks after a short one are past the end of the file
+        eof_ = true;
+        Drop();
+        free_.clear();
+      }
+    }
+  }
+  return read;
+}
+
+ssize_t PrefetchAnt::Write(const char* data, size_t len) {
+  return input_stream_->Write(data, len);
+}
+
+off_t PrefetchAnt::Seek(off_t offset) {
+  offset_ = offset;
+  while (!blocks_.empty() &&
+         (offset < blocks_.front()->offset ||
+          offset >= blocks_.front()->offset + (off_t)block_size_)) {
+    if (offset < blocks_.front()->offset) {
+      Drop();
+    } else {
+      Pop();
+    }
+  }
+  if (blocks_.empty()) {
+    // the ant may wait in the queue for a while, e.g. for the next epoch
+    free_.clear();
+    next_ = offset;
+    eof_ = false;
+  }
+  return offset;
+}
+
+}  // namespace io
+}  // namespace xdl
@@ -0,0 +1,81 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XDL_IO_FS_PREFETCH_ANT_H_
+#define XDL_IO_FS_PREFETCH_ANT_H_
+
+#include "xdl/core/lib/common_defines.h"
+#include "xdl/data_io/fs/file_system.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace xdl {
+namespace io {
+
+/// Reads ahead of a sequential reader, keeping depth reads of block_size
+/// bytes in flight with ReadAt on a shared io thread pool. Nothing is read
+/// until the first Read or Prefetch, a Seek out of the blocks in flight
+/// drops them.
+class PrefetchAnt : public IOAnt {
+ public:
+  PrefetchAnt(IOAnt* input_stream, size_t block_size, size_t depth);
+  virtual ~PrefetchAnt();
+  virtual ssize_t Read(char* data, size_t len);
+  virtual ssize_t Write(const char* data, size_t len);
+  virtual off_t Seek(off_t offset);
+  virtual void Prefetch();
+
+  /// XDL_IO_PREFETCH_BLOCK bytes, 1MB by default
+  static size_t DefaultBlockSize();
+  /// XDL_IO_PREFETCH_DEPTH blocks, 4 by default, 0 turns prefetching off
+  static size_t DefaultDepth();
+  DISALLOW_COPY_AND_ASSIGN(PrefetchAnt);
+
+ private:
+  struct Block {
+    off_t offset;
+    std::unique_ptr<char[]> data;
+    ssize_t size = 0;
+    bool done = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+  };
+
+  void Fill();
+  void Wait(Block* block);
+  void Pop();
+  void Drop();
+
+  std::unique_ptr<IOAnt> input_stream_;
+  size_t block_size_;
+  size_t depth_;
+  /// read position
+  off_t offset_ = 0;
+  /// offset of the next block to read
+  off_t next_ = 0;
+  bool started_ = false;
+  bool eof_ = false;
+  std::deque<std::shared_ptr<Block>> blocks_;
+  std::vector<std::unique_ptr<char[]>> free_;
+};
+
+}  // namespace io
+}  // namespace xdl
+
+#endif  // XDL_IO_FS_PREFETCH_ANT_H_
@@ -31,6 +31,7 @@ class ZlibAnt : public IOAnt {
   virtual ssize_t Read(char* data, size_t len);
   virtual ssize_t Write(const char* data, size_t len);
   virtual off_t Seek(off_t offset);
+  virtual void Prefetch() { input_stream_->Prefetch(); }
   DISALLOW_COPY_AND_ASSIGN(ZlibAnt);
  private:
   void InitZlibBuffer();
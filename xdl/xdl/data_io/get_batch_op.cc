@@ -16,9 +16,15 @@ limitations under the License.
 #include "xdl/core/framework/op_kernel.h"
 #include "xdl/core/framework/op_define.h"
 #include "xdl/core/framework/op_registry.h"
+#include "xdl/core/framework/profiler.h"
 #include "xdl/core/lib/timer.h"
 #include "xdl/core/lib/tbb_concurrent_queue.h"
+#include "xdl/core/ops/ps_ops/pull_ahead.h"
 #include "xdl/data_io/data_io.h"
+#ifdef USE_GPU
+#include "xdl/core/framework/cpu_device.h"
+#include "xdl/data_io/gpu/batch_prefetcher.h"
+#endif
 
 namespace xdl {
 
@@ -26,14 +32,13 @@ template <typename T>
 class GetBatchOp: public OpKernel {
  public:
   Status Init(OpKernelConstruction* ctx) override {
-    std::string ds;
-    XDL_CHECK_STATUS(ctx->GetAttr("ds", &ds));
+    XDL_CHECK_STATUS(ctx->GetAttr("ds", &ds_));
     XDL_CHECK_STATUS(ctx->GetAttr("sparse_count", &sparse_count_));
     XDL_CHECK_STATUS(ctx->GetAttr("dense_count", &dense_count_));
     XDL_CHECK_STATUS(ctx->GetAttr("indicator_count", &indicator_count_));
     XDL_CHECK_STATUS(ctx->GetAttr("tag_cnt", &tag_cnt_));
 
-    data_io_ = io::DataIOMap::Instance()->Get(ds);
+    data_io_ = io::DataIOMap::Instance()->Get(ds_);
     XDL_CHECK(data_io_ != nullptr);
 
     unique_ids_ = data_io_->GetUniqueIds();
@@ -45,7 +50,11 @@ class GetBatchOp: public OpKernel {
     //XDL_TIMER_SCOPE(get_batch_timer);
     using TensorList = std::vector<Tensor>;
 
-    auto batch = data_io_->GetBatch();
+    const io::Batch* batch;
+    {
+      ProfileScope scope("data_io", "GetBatch");
+      batch = data_io_->GetBatch();
+    }
     if (data_io_->finished()) {
       XDL_LOG(DEBUG) << "game over";
       TBBConcurrentQueue::Global()->SetFinished();
@@ -56,6 +65,7 @@ class GetBatchOp: public OpKernel {
     }
 
     XDL_CHECK(batch != nullptr);
+    XDL_CHECK_STATUS(Prepare(batch));
 
     /// skey
     auto blk = batch->Get(io::kSKeyName);
@@ -63,19 +73,16 @@ class GetBatchOp: public OpKernel {
       ctx->SetOutput("skbuf", Tensor(ctx->GetDevice(), TensorShape({0}), types::kInt8));
     } else {
       XDL_DCHECK(blk->ts_[io::Block::kSBuf] != nullptr);
-      ctx->SetOutput("skbuf", *blk->ts_[io::Block::kSBuf]);
+      ctx->SetOutput("skbuf", Out(blk->ts_[io::Block::kSBuf]));
     }
 
     /// label
     blk = batch->Get(io::kLabelName);
     XDL_CHECK(blk != nullptr && blk->ts_[io::Block::kValue] != nullptr);
-    ctx->SetOutput("label", *blk->ts_[io::Block::kValue]);
+    ctx->SetOutput("label", Out(blk->ts_[io::Block::kValue]));
 
     // tag
-    Tensor tag;
-    ctx->AllocateOutput("tag", TensorShape({}), &tag);
-    *(tag.Raw<int32_t>()) = (tag_cnt_ == 0 ? 0 : sample_id_++ % tag_cnt_);
-    ctx->SetOutput("tag", tag);
+    XDL_CHECK_STATUS(SetTag(ctx, tag_cnt_ == 0 ? 0 : sample_id_++ % tag_cnt_));
 
     /// feature
     TensorList out_indices;
@@ -98,16 +105,16 @@ class GetBatchOp: public OpKernel {
         XDL_DCHECK(blk->ts_[io::Block::kIndex] != nullptr && blk->ts_[io::Block::kIndex]->Type() == types::kInt32);
         XDL_DCHECK(blk->ts_[io::Block::kSIndex] != nullptr && blk->ts_[io::Block::kSIndex]->Type() == types::kInt32);
         XDL_DCHECK(blk->ts_[io::Block::kSSegment] != nullptr && blk->ts_[io::Block::kSSegment]->Type() == types::kInt32);
-        out_ids.push_back(*blk->ts_[io::Block::kUKey]);
-        out_indices.push_back(*blk->ts_[io::Block::kIndex]);
-        out_sample_indices.push_back(*blk->ts_[io::Block::kSIndex]);
-        out_sample_segments.push_back(*blk->ts_[io::Block::kSSegment]);
+        out_ids.push_back(Out(blk->ts_[io::Block::kUKey]));
+        out_indices.push_back(Out(blk->ts_[io::Block::kIndex]));
+        out_sample_indices.push_back(Out(blk->ts_[io::Block::kSIndex]));
+        out_sample_segments.push_back(Out(blk->ts_[io::Block::kSSegment]));
       } else {
         XDL_DCHECK(blk->ts_[io::Block::kKey] != nullptr && blk->ts_[io::Block::kKey]->Type() == types::kInt64);
         XDL_DCHECK(blk->ts_[io::Block::kIndex] == nullptr);
         XDL_DCHECK(blk->ts_[io::Block::kSIndex] == nullptr);
         XDL_DCHECK(blk->ts_[io::Block::kSSegment] == nullptr);
-        out_ids.push_back(*blk->ts_[io::Block::kKey]);
+        out_ids.push_back(Out(blk->ts_[io::Block::kKey]));
         out_indices.push_back(Tensor(ctx->GetDevice(), TensorShape({0}), types::kInt32));
         out_sample_indices.push_back(Tensor(ctx->GetDevice(), TensorShape({0}), types::kInt32));
         out_sample_segments.push_back(Tensor(ctx->GetDevice(), TensorShape({0}), types::kInt32));
@@ -115,13 +122,13 @@ class GetBatchOp: public OpKernel {
 
       if (blk->ts_[io::Block::kValue] != nullptr) {
         XDL_DCHECK(blk->ts_[io::Block::kValue]->Type() == types::kFloat);
-        out_svalues.push_back(*blk->ts_[io::Block::kValue]);
+        out_svalues.push_back(Out(blk->ts_[io::Block::kValue]));
       } else {
         out_svalues.push_back(Tensor(ctx->GetDevice(), TensorShape({0}), types::kFloat));
       }
 
       XDL_DCHECK(blk->ts_[io::Block::kSegment] != nullptr && blk->ts_[io::Block::kSegment]->Type() == types::kInt32);
-      out_segments.push_back(*blk->ts_[io::Block::kSegment]);
+      out_segments.push_back(Out(blk->ts_[io::Block::kSegment]));
     }
 
     XDL_CHECK_STATUS(ctx->SetOutputList("indices", out_indices));
@@ -137,7 +144,7 @@ class GetBatchOp: public OpKernel {
       blk = batch->Get(o);
       XDL_DCHECK(blk != nullptr);
       XDL_DCHECK(blk->ts_[io::Block::kValue] != nullptr && blk->ts_[io::Block::kValue]->Type() == types::kFloat);
-      out_dvalues.push_back(*blk->ts_[io::Block::kValue]);
+      out_dvalues.push_back(Out(blk->ts_[io::Block::kValue]));
     }
 
     XDL_CHECK_STATUS(ctx->SetOutputList("dvalues", out_dvalues));
@@ -149,24 +156,114 @@ class GetBatchOp: public OpKernel {
       blk = batch->Get(io::kIndicatorPrefix+std::to_string(i));
       XDL_DCHECK(blk != nullptr);
       XDL_DCHECK(blk->ts_[io::Block::kIndex] != nullptr);
-      out_indicators.push_back(*blk->ts_[io::Block::kIndex]);
+      out_indicators.push_back(Out(blk->ts_[io::Block::kIndex]));
     }
 
     XDL_CHECK_STATUS(ctx->SetOutputList("indicators", out_indicators));
 
+    PublishNextIds();
+
+    return Status::Ok();
+  }
+
+ protected:
+  /// called with each batch before its tensors are output
+  virtual Status Prepare(const io::Batch* batch) {
     return Status::Ok();
   }
 
+  /// the output of a tensor of the batch
+  virtual Tensor Out(const Tensor* tensor) {
+    return *tensor;
+  }
+
+  virtual Status SetTag(OpKernelContext* ctx, int32_t value) {
+    Tensor tag;
+    XDL_CHECK_STATUS(ctx->AllocateOutput("tag", TensorShape({}), &tag));
+    *(tag.Raw<int32_t>()) = value;
+    return ctx->SetOutput("tag", tag);
+  }
+
+  io::DataIO *data_io_;
+
  private:
+  /// hand the ids of the next batch to the pull ops that pull ahead
+  void PublishNextIds() {
+    if (!PullAhead::Get()->HasListener(ds_)) {
+      return;
+    }
+    auto next = data_io_->PeekNextBatch();
+    if (next == nullptr) {
+      return;
+    }
+    std::vector<Tensor> next_ids;
+    for (auto &o : data_io_->sparse_list()) {
+      auto blk = next->Get(o);
+      if (blk == nullptr) {
+        return;
+      }
+      auto ids = blk->ts_[unique_ids_ ? io::Block::kUKey : io::Block::kKey];
+      if (ids == nullptr) {
+        return;
+      }
+      next_ids.push_back(*ids);
+    }
+    PullAhead::Get()->Publish(ds_, next_ids);
+  }
+
+  std::string ds_;
   long sparse_count_;
   long dense_count_;
   long indicator_count_;
   bool unique_ids_;
   int64_t tag_cnt_;
   int64_t sample_id_;
-  io::DataIO *data_io_;
 };
 
+#ifdef USE_GPU
+/// Outputs the batches on the gpu, the next batch is copied by the
+/// prefetcher during the step, see DataIO::SetPinMemory.
+template <typename T>
+class GetBatchGpuOp: public GetBatchOp<T> {
+ public:
+  Status Init(OpKernelConstruction* ctx) override {
+    XDL_CHECK_STATUS(GetBatchOp<T>::Init(ctx));
+    GpuDevice* gpu = dynamic_cast<GpuDevice*>(ctx->GetDevice());
+    XDL_CHECK_COND(gpu != nullptr, Status::Internal("GetBatch needs a gpu"));
+    cpu_.reset(new CpuDevice());
+    prefetcher_.reset(new io::BatchPrefetcher(gpu));
+    return Status::Ok();
+  }
+
+ protected:
+  Status Prepare(const io::Batch* batch) override {
+    tensors_ = prefetcher_->Take(batch);
+    auto next = this->data_io_->PeekNextBatch();
+    if (next != nullptr) {
+      prefetcher_->Start(next);
+    }
+    return Status::Ok();
+  }
+
+  Tensor Out(const Tensor* tensor) override {
+    auto iter = tensors_.find(tensor);
+    XDL_CHECK(iter != tensors_.end()) << "tensor not prefetched";
+    return iter->second;
+  }
+
+  Status SetTag(OpKernelContext* ctx, int32_t value) override {
+    Tensor tag(cpu_.get(), TensorShape({}), types::kInt32);
+    *(tag.Raw<int32_t>()) = value;
+    return ctx->SetOutput("tag", prefetcher_->Copy(tag));
+  }
+
+ private:
+  std::unique_ptr<Device> cpu_;
+  std::unique_ptr<io::BatchPrefetcher> prefetcher_;
+  std::unordered_map<const Tensor*, Tensor> tensors_;
+};
+#endif
+
 XDL_DEFINE_OP(GetBatch)
   .Attr("ds", AttrValue::kString)
   .Attr("sparse_count", AttrValue::kInt)
@@ -198,4 +295,18 @@ REGISTER_KERNEL(double);
 
 #undef REGISTER_KERNEL
 
+#ifdef USE_GPU
+#define REGISTER_GPU_KERNEL(T)                    \
+  XDL_REGISTER_KERNEL(GetBatch, GetBatchGpuOp<T>) \
+  .Device("GPU")                                  \
+  .AttrDataType<T>("dtype");
+
+REGISTER_GPU_KERNEL(int32_t);
+REGISTER_GPU_KERNEL(int64_t);
+REGISTER_GPU_KERNEL(float);
+REGISTER_GPU_KERNEL(double);
+
+#undef REGISTER_GPU_KERNEL
+#endif
+
 }  // namespace xdl
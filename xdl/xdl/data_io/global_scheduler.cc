@@ -15,7 +15,9 @@ limitations under the License.
 
 #include "xdl/data_io/global_scheduler.h"
 
+#include <stdio.h>
 #include <string.h>
+#include <algorithm>
 #include <chrono>
 #include <thread>
 
@@ -25,6 +27,30 @@ limitations under the License.
 namespace xdl {
 namespace io {
 
+namespace {
+
+const char kRangeSeparator = '#';
+
+std::string RangeName(const std::string &path, size_t begin, size_t end) {
+  return path + kRangeSeparator + std::to_string(begin) + "-" + std::to_string(end);
+}
+
+/// false if name isn't a range
+bool ParseRange(const std::string &name, std::string *path, size_t *begin, size_t *end) {
+  size_t pos = name.rfind(kRangeSeparator);
+  if (pos == std::string::npos) {
+    return false;
+  }
+  char tail;
+  if (sscanf(name.c_str() + pos + 1, "%zu-%zu%c", begin, end, &tail) != 2) {
+    return false;
+  }
+  *path = name.substr(0, pos);
+  return true;
+}
+
+}  // namespace
+
 GlobalScheduler::GlobalScheduler(
     FileSystem *fs, 
     const std::string& name,
@@ -62,10 +88,49 @@ bool GlobalScheduler::SetEpochIsolate(bool value) {
   return true;
 }
 
+bool GlobalScheduler::SetSplit(size_t split_size) {
+  split_size_ = split_size;
+  return true;
+}
+
+std::vector<std::string> GlobalScheduler::Split() {
+  if (split_size_ == 0 || ztype_ != kRaw) {
+    return paths_;
+  }
+  std::vector<size_t> sizes;
+  size_t total = 0;
+  for (auto &path : paths_) {
+    sizes.push_back(fs_->Size(path.c_str()));
+    total += sizes.back();
+  }
+  size_t tail = total - total * kTailRatio;
+  size_t offset = 0;
+  std::vector<std::string> names;
+  for (size_t i = 0; i < paths_.size(); ++i) {
+    if (sizes[i] <= split_size_) {
+      names.push_back(paths_[i]);
+      offset += sizes[i];
+      continue;
+    }
+    for (size_t begin = 0; begin < sizes[i];) {
+      size_t step = offset + begin >= tail ? std::max<size_t>(1, split_size_ / 8) : split_size_;
+      size_t end = std::min(sizes[i], begin + step);
+      if (offset + begin < tail && offset + end > tail) {
+        end = tail - offset;
+      }
+      names.push_back(RangeName(paths_[i], begin, end));
+      begin = end;
+    }
+    offset += sizes[i];
+  }
+  XDL_LOG(DEBUG) << "split " << paths_.size() << " files into " << names.size();
+  return names;
+}
+
 bool GlobalScheduler::Schedule() {
   finished_ = false;
   XDL_CHECK(client_->InitGlobalQueue(
-            name_, paths_, epochs_, 
+            name_, Split(), epochs_, 
             epoch_isolate_).IsOk());
   return true;
 }
@@ -92,19 +157,37 @@ ReadParam *GlobalScheduler::Acquire() {
   }
 
   ReadParam *rparam = new ReadParam();
-  rparam->path_ = strdup(path.c_str());
+  std::string file = path;
+  size_t range_begin = 0, range_end = 0;
+  bool range = ParseRange(path, &file, &range_begin, &range_end);
+  rparam->path_ = strdup(file.c_str());
   rparam->epoch_ = epoch;
-  rparam->begin_ = begin;
   rparam->ant_ = fs_->GetZAnt(rparam->path_, ztype_);
-  if (ztype_ == kZLib) {
+  if (ztype_ == kZLib || ztype_ == kBgzf) {
     rparam->end_ = ULONG_MAX;
   } else {
     rparam->end_ = fs_->Size(rparam->path_);
   }
+  if (range) {
+    // the records starting in the range, the one it ends in read to its end
+    if (range_end < rparam->end_) {
+      rparam->limit_ = range_end;
+    }
+    if (begin < range_begin && range_begin > 0) {
+      begin = range_begin - 1;
+      rparam->skip_ = true;
+    } else {
+      begin = std::max(begin, range_begin);
+    }
+  }
+  rparam->parsed_ = rparam->begin_ = begin;
+  if (begin > 0) {
+    rparam->ant_->Seek(begin);
+  }
 
   XDL_CHECK(rparam->end_ > rparam->begin_);
   std::unique_lock<std::mutex> lck(mutex_);
-  using_.insert(rparam);
+  using_[rparam] = path;
   XDL_LOG(DEBUG) << "acquire " << rparam->DebugString();
   return rparam;
 }
@@ -126,10 +209,11 @@ bool GlobalScheduler::Store(DSState *ds_state) {
   std::vector<ps::WorkerState> worker_states;
   for (auto &it : using_) {
     ps::WorkerState ws;
-    ws.begin_ = it->begin_;
-    ws.end_ = it->end_;
-    ws.epoch_ = it->epoch_;
-    ws.path_ = it->path_;    
+    // skip_ is still set if no record was parsed
+    ws.begin_ = it.first->skip_ ? 0 : it.first->parsed_;
+    ws.end_ = it.first->end_;
+    ws.epoch_ = it.first->epoch_;
+    ws.path_ = it.second;
     worker_states.push_back(ws);
   }
 
@@ -21,6 +21,7 @@ limitations under the License.
 #include <list>
 #include <string>
 #include <atomic>
+#include <unordered_map>
 
 #include "xdl/core/lib/blocking_queue.h"
 #include "xdl/data_io/constant.h"
@@ -51,6 +52,9 @@ class GlobalScheduler: public Scheduler {
                   size_t worker_id = 0);
 
   bool SetEpochIsolate(bool value);
+  /// the files are queued as 'path#begin-end' ranges, those in the last
+  /// kTailRatio of the bytes eight times smaller to spread the epoch end
+  bool SetSplit(size_t split_size) override;
 
   bool Schedule() override;
   ReadParam *Acquire() override;
@@ -59,8 +63,15 @@ class GlobalScheduler: public Scheduler {
   bool Restore(const DSState &ds_state) override;
 
  protected:
+  static constexpr double kTailRatio = 0.05;
+
+  /// the queued names of the paths, ranges of the large ones
+  std::vector<std::string> Split();
+
   std::string name_;
-  std::unordered_set<ReadParam*> using_;
+  /// the queued name of each rparam read
+  std::unordered_map<ReadParam*, std::string> using_;
+  size_t split_size_ = 0;
   ps::client::BaseClient* client_;
   bool epoch_isolate_;
   size_t worker_id_;
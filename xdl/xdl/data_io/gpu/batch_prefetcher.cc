@@ -0,0 +1,115 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/data_io/gpu/batch_prefetcher.h"
+
+#include "xdl/core/utils/logging.h"
+
+namespace xdl {
+namespace io {
+
+namespace {
+
+/// apart from the converter streams -1 and -2
+const int kStream = -3;
+
+}  // namespace
+
+BatchPrefetcher::BatchPrefetcher(GpuDevice *dev)
+    : dev_(dev), stream_(CudaStreamManager::Instance()->GetCudaStream(kStream)) {
+  for (auto &slot : slots_) {
+    CudaStream::RunOrAbort(
+        cudaEventCreateWithFlags(&slot.event, cudaEventDisableTiming),
+        "cudaEventCreate error");
+  }
+}
+
+BatchPrefetcher::~BatchPrefetcher() {
+  CudaStream::RunOrAbort(cudaStreamSynchronize(stream_->GetInternal()),
+                         "cudaStreamSynchronize error");
+  for (auto &slot : slots_) {
+    cudaEventDestroy(slot.event);
+  }
+}
+
+BatchPrefetcher::Slot *BatchPrefetcher::Find(const Batch *batch) {
+  for (auto &slot : slots_) {
+    if (slot.batch == batch) {
+      return &slot;
+    }
+  }
+  return nullptr;
+}
+
+void BatchPrefetcher::Start(const Batch *batch) {
+  std::unique_lock<std::mutex> lck(mu_);
+  if (Find(batch) != nullptr) {
+    return;
+  }
+  Slot *slot = Find(nullptr);
+  XDL_CHECK(slot != nullptr) << "more than " << kSlots << " batches in flight";
+  slot->batch = batch;
+  for (auto &kv : batch->blocks()) {
+    for (int i = 0; i < Block::kTypes; ++i) {
+      const Tensor *src = kv.second.ts_[i];
+      if (src == nullptr || !src->Initialized() ||
+          slot->tensors.count(src) != 0) {
+        continue;
+      }
+      Tensor dst(dev_, src->Shape(), src->Type());
+      size_t size = src->GetBuffer()->size();
+      if (size > 0) {
+        CudaStream::RunOrAbort(
+            cudaMemcpyAsync(dst.GetBuffer()->begin(), src->GetBuffer()->begin(),
+                            size, cudaMemcpyHostToDevice,
+                            stream_->GetInternal()),
+            "cudaMemcpyAsync error");
+      }
+      slot->tensors.emplace(src, dst);
+    }
+  }
+  CudaStream::RunOrAbort(cudaEventRecord(slot->event, stream_->GetInternal()),
+                         "cudaEventRecord error");
+}
+
+std::unordered_map<const Tensor *, Tensor> BatchPrefetcher::Take(const Batch *batch) {
+  Start(batch);
+  std::unique_lock<std::mutex> lck(mu_);
+  Slot *slot = Find(batch);
+  /// only this batch's copies, the next one's stay in flight
+  CudaStream::RunOrAbort(cudaEventSynchronize(slot->event),
+                         "cudaEventSynchronize error");
+  std::unordered_map<const Tensor *, Tensor> tensors;
+  tensors.swap(slot->tensors);
+  slot->batch = nullptr;
+  return tensors;
+}
+
+Tensor BatchPrefetcher::Copy(const Tensor &tensor) {
+  Tensor dst(dev_, tensor.Shape(), tensor.Type());
+  size_t size = tensor.GetBuffer()->size();
+  if (size > 0) {
+    CudaStream::RunOrAbort(
+        cudaMemcpyAsync(dst.GetBuffer()->begin(), tensor.GetBuffer()->begin(),
+                        size, cudaMemcpyHostToDevice, stream_->GetInternal()),
+        "cudaMemcpyAsync error");
+    CudaStream::RunOrAbort(cudaStreamSynchronize(stream_->GetInternal()),
+                           "cudaStreamSynchronize error");
+  }
+  return dst;
+}
+
+}  // namespace io
+}  // namespace xdl
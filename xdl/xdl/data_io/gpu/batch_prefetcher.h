@@ -0,0 +1,66 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XDL_IO_GPU_BATCH_PREFETCHER_H_
+#define XDL_IO_GPU_BATCH_PREFETCHER_H_
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "cuda_runtime.h"
+#include "xdl/data_io/batch.h"
+#include "xdl/core/framework/gpu/gpu_device.h"
+
+namespace xdl {
+namespace io {
+
+/// Copies the tensors of a batch to the gpu on a stream of its own, the
+/// next batch is copied while the step of the current one runs. With the
+/// batches on pinned memory the copies are dma ones overlapping the kernels.
+class BatchPrefetcher {
+ public:
+  explicit BatchPrefetcher(GpuDevice *dev);
+  ~BatchPrefetcher();
+
+  /// starts copying the blocks of batch, at most kSlots batches at a time
+  void Start(const Batch *batch);
+  /// waits for the copy of batch, started now if it wasn't, the result
+  /// maps the cpu tensors of the batch to their gpu copies
+  std::unordered_map<const Tensor *, Tensor> Take(const Batch *batch);
+  /// a synchronous copy, for the tensors made by the op itself
+  Tensor Copy(const Tensor &tensor);
+
+  static constexpr size_t kSlots = 2;
+
+ private:
+  struct Slot {
+    const Batch *batch = nullptr;
+    std::unordered_map<const Tensor *, Tensor> tensors;
+    cudaEvent_t event;
+  };
+
+  Slot *Find(const Batch *batch);
+
+  GpuDevice *dev_;
+  CudaStream *stream_;
+  std::mutex mu_;
+  Slot slots_[kSlots];
+};
+
+}  // namespace io
+}  // namespace xdl
+
+#endif  // XDL_IO_GPU_BATCH_PREFETCHER_H_
@@ -16,8 +16,13 @@ limitations under the License.
 #include "xdl/data_io/merger/merger.h"
 #include "xdl/core/lib/unique.h"
 
+#include <stdlib.h>
+#include <algorithm>
+#include <thread>
+
 #include "xdl/data_io/constant.h"
 #include "xdl/core/framework/cpu_device.h"
+#include "xdl/core/lib/thread_pool.h"
 #include "xdl/core/lib/timer.h"
 #include "xdl/core/utils/logging.h"
 
@@ -26,41 +31,88 @@ limitations under the License.
 namespace xdl {
 namespace io {
 
+namespace {
+
+ThreadPool *UniquePool() {
+  static ThreadPool pool([] {
+    const char *env = getenv("XDL_IO_MERGER_THREADS");
+    size_t threads = env == nullptr ? std::thread::hardware_concurrency()
+                                    : strtoul(env, nullptr, 10);
+    return std::max<size_t>(1, threads);
+  }());
+  return &pool;
+}
+
+}  // namespace
+
 Merger::Merger(const Schema *schema, Device *dev)
     : schema_(schema), dev_(dev) {
 }
 
+Merger::~Merger() {
+  Wait();
+}
+
 bool Merger::Init() {
   return true;
 }
 
 Batch *Merger::Run(Batch *batch) {
   //XDL_TIMER_SCOPE(merger_run);
+  Start(batch);
+  return Wait();
+}
+
+void Merger::Start(Batch *batch) {
+  XDL_CHECK(batch_ == nullptr) << "the last batch is not waited";
   auto &blocks = batch->blocks();
   XDL_CHECK(blocks.size() != 0);
+  std::vector<Block *> keyed;
   for (auto &kv : blocks) {
-    auto &name = kv.first;
-    auto &blk = kv.second;
-    if (blk.ts_[Block::kKey] == nullptr) {
-      continue;
-    }
-    if (blk.ts_[Block::kIndex] == nullptr) {
-      blk.ts_[Block::kIndex] = new Tensor();
-    }
-    if (blk.ts_[Block::kUKey] == nullptr) {
-      blk.ts_[Block::kUKey] = new Tensor();
+    if (kv.second.ts_[Block::kKey] != nullptr) {
+      keyed.push_back(&kv.second);
     }
-    if (blk.ts_[Block::kSIndex] == nullptr) {
-      blk.ts_[Block::kSIndex] = new Tensor();
-    }
-    if (blk.ts_[Block::kSSegment] == nullptr) {
-      blk.ts_[Block::kSSegment] = new Tensor();
-    }
-    auto fn = functor::UniqueFunctor<CpuDevice, int64_t, int32_t>();
-    fn((CpuDevice *)dev_, *blk.ts_[Block::kKey], *blk.ts_[Block::kSegment], blk.ts_[Block::kUKey], blk.ts_[Block::kIndex], blk.ts_[Block::kSIndex], blk.ts_[Block::kSSegment]);
   }
+  std::unique_lock<std::mutex> lck(mu_);
+  batch_ = batch;
+  pending_ = keyed.size();
+  for (auto blk : keyed) {
+    UniquePool()->Schedule([this, blk] {
+      Unique(blk);
+      std::unique_lock<std::mutex> lck(mu_);
+      if (--pending_ == 0) {
+        cv_.notify_all();
+      }
+    });
+  }
+}
+
+Batch *Merger::Wait() {
+  std::unique_lock<std::mutex> lck(mu_);
+  cv_.wait(lck, [this] { return pending_ == 0; });
+  Batch *batch = batch_;
+  batch_ = nullptr;
   return batch;
 }
 
+void Merger::Unique(Block *blk) {
+  if (blk->ts_[Block::kIndex] == nullptr) {
+    blk->ts_[Block::kIndex] = new Tensor();
+  }
+  if (blk->ts_[Block::kUKey] == nullptr) {
+    blk->ts_[Block::kUKey] = new Tensor();
+  }
+  if (blk->ts_[Block::kSIndex] == nullptr) {
+    blk->ts_[Block::kSIndex] = new Tensor();
+  }
+  if (blk->ts_[Block::kSSegment] == nullptr) {
+    blk->ts_[Block::kSSegment] = new Tensor();
+  }
+  auto fn = functor::UniqueFunctor<CpuDevice, int64_t, int32_t>();
+  fn((CpuDevice *)dev_, *blk->ts_[Block::kKey], *blk->ts_[Block::kSegment],
+     blk->ts_[Block::kUKey], blk->ts_[Block::kIndex],
+     blk->ts_[Block::kSIndex], blk->ts_[Block::kSSegment]);
+}
+
 }  // namespace io
 }  // namespace xdl
@@ -24,20 +24,37 @@ limitations under the License.
 #include "xdl/core/framework/tensor.h"
 #include "xdl/core/framework/device_converter.h"
 
+#include <condition_variable>
+#include <mutex>
+
 namespace xdl {
 namespace io {
 
+/// Uniques the keys of each feature of a batch, the features run as tasks
+/// on a pool of XDL_IO_MERGER_THREADS threads.
 class Merger {
  public:
   Merger(const Schema *schema, Device *dev);
-  virtual ~Merger() {}
+  virtual ~Merger();
 
   bool Init();
   Batch *Run(Batch *batch);
+  /// starts the unique of batch and returns, for the caller to pack the
+  /// next one meanwhile, one batch at a time
+  void Start(Batch *batch);
+  /// the batch started last once done, nullptr if none
+  Batch *Wait();
 
  private:
+  void Unique(Block *blk);
+
   const Schema *schema_;
   Device *dev_;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  Batch *batch_ = nullptr;
+  size_t pending_ = 0;
 };
 
 }  // namespace io
@@ -41,8 +41,31 @@ void ExprGraph::ParseDsl(const DslUnitMap &dsl_unit_map) {
     const DslUnit &dsl_unit = iter.second;
     ExprNode output_node;
     expr_parser_.Parse(dsl_unit.expr, output_node);
-    output_nodes_map_.insert(std::make_pair(dsl_unit.name, internal_nodes_.nodes().size()));
+    Plan plan;
+    plan.name = dsl_unit.name;
+    plan.output = internal_nodes_.nodes().size();
     internal_nodes_.mutable_nodes()->push_back(output_node);
+    Compile(plan.output, &plan.steps);
+    plans_.push_back(std::move(plan));
+  }
+}
+
+void ExprGraph::Compile(int index, std::vector<int> *steps) const {
+  for (int pre : internal_nodes_.nodes()[index].pres)  Compile(pre, steps);
+  steps->push_back(index);
+}
+
+void ExprGraph::set_feature_name_map(const FeatureNameMap *feature_name_map) {
+  feature_name_map_ = feature_name_map;
+  const std::vector<ExprNode> &nodes = internal_nodes_.nodes();
+  source_tables_.assign(nodes.size(), -1);
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (nodes[i].type != FeaOpType::kSourceFeatureOp)  continue;
+    const SourceFeatureOp *op = reinterpret_cast<const SourceFeatureOp *>(nodes[i].op);
+    const auto &iter = feature_name_map_->find(op->name());
+    XDL_CHECK(iter != feature_name_map_->end());
+    XDL_CHECK(iter->second >= 0);
+    source_tables_[i] = iter->second;
   }
 }
 
@@ -56,39 +79,38 @@ void ExprGraph::Execute(const std::vector<const FeatureMap *> &feature_map_arr,
     for (auto &iter : *feature_cache)  iter.second.clear();
   }
   auto mutable_features = feature_line->mutable_features();
-  mutable_features->Reserve(feature_line->features_size() + output_nodes_map_.size());
-  for (const auto &iter : output_nodes_map_) {
-    ExprNode &output_node = local_internal_nodes->node(iter.second);
+  mutable_features->Reserve(feature_line->features_size() + plans_.size());
+  for (const Plan &plan : plans_) {
+    ExprNode &output_node = local_internal_nodes->node(plan.output);
     Feature *feature = reinterpret_cast<Feature *>(output_node.result);
     // TODO: 该output如果source缺的话就不用算了
-    if (TraversalExecute(feature_map_arr, local_internal_nodes, output_node, feature_cache, is_clear_result_feature)) {
-      if (!feature->has_name())  feature->set_name(iter.first);
+    // only the output node reuses the results of the previous sample
+    bool ok = true;
+    for (int index : plan.steps) {
+      ok = ExecuteNode(feature_map_arr, local_internal_nodes, index,
+                       index != plan.output || is_clear_result_feature);
+      if (!ok)  break;
+    }
+    if (ok) {
+      if (!feature->has_name())  feature->set_name(plan.name);
       mutable_features->AddAllocated(feature);
       output_node.result = new Feature();
     }
   }
 }
 
-bool ExprGraph::TraversalExecute(const std::vector<const FeatureMap *> &feature_map_arr,
-                                 InternalNodes *internal_nodes,
-                                 ExprNode &node,
-                                 FeatureCacheMap *feature_cache,
-                                 bool is_clear_result_feature) {
-  for (int pre : node.pres) {
-    if (TraversalExecute(feature_map_arr, internal_nodes, internal_nodes->node(pre), feature_cache) == false) {
-      return false;
-    }
-  }
+bool ExprGraph::ExecuteNode(const std::vector<const FeatureMap *> &feature_map_arr,
+                            InternalNodes *internal_nodes, int index,
+                            bool is_clear_result_feature) {
+  ExprNode &node = internal_nodes->node(index);
   if (node.type == FeaOpType::kSourceFeatureOp) {
     XDL_CHECK(node.pres.size() == 0);
     if (!is_clear_result_feature && node.table_id > 0)  return true;
     SourceFeatureOp *op = reinterpret_cast<SourceFeatureOp *>(node.op);
-    const auto &iter = feature_name_map_->find(op->name());
-    XDL_CHECK(iter != feature_name_map_->end());
-    XDL_CHECK(iter->second >= 0);
-    if (iter->second >= feature_map_arr.size())  return false;
-    if (op->Run(feature_map_arr[iter->second], node.result) == false)  return false;
-    node.table_id = iter->second;
+    const int table_id = source_tables_[index];
+    if (table_id >= feature_map_arr.size())  return false;
+    if (op->Run(feature_map_arr[table_id], node.result) == false)  return false;
+    node.table_id = table_id;
   } else {
     if (is_clear_result_feature || node.table_id == 0) {
       node.clear();
@@ -37,23 +37,31 @@ class ExprGraph {
                FeatureLine *feature_line, bool is_clear_result_feature = true);
 
   const FeatureNameVec &feature_name_vec() const { return expr_parser_.feature_name_vec(); }
-  inline void set_feature_name_map(const FeatureNameMap *feature_name_map) {
-    feature_name_map_ = feature_name_map;
-  }
+  /// also resolves the table of every source node
+  void set_feature_name_map(const FeatureNameMap *feature_name_map);
 
  protected:
   ExprGraph(const std::vector<std::string> &dsl_arr, bool is_cache = false);
 
+  /// The nodes of an output in post order, so that its dsl is evaluated in
+  /// one pass over the steps instead of walking the tree for every sample.
+  struct Plan {
+    std::string name;
+    int output;
+    std::vector<int> steps;
+  };
+
   void ParseDsl(const DslUnitMap &dsl_unit_map);
-  bool TraversalExecute(const std::vector<const FeatureMap *> &feature_map_arr,
-                        InternalNodes *internal_nodes,
-                        ExprNode &node,
-                        FeatureCacheMap *feature_cache = nullptr,
-                        bool is_clear_result_feature = true);
+  void Compile(int index, std::vector<int> *steps) const;
+  bool ExecuteNode(const std::vector<const FeatureMap *> &feature_map_arr,
+                   InternalNodes *internal_nodes, int index,
+                   bool is_clear_result_feature = true);
 
  private:
   InternalNodes internal_nodes_;
-  std::unordered_map<std::string, int> output_nodes_map_;
+  std::vector<Plan> plans_;
+  /// table of each source node by node index, -1 for the other nodes
+  std::vector<int> source_tables_;
   const FeatureNameMap *feature_name_map_;
   ExprParser expr_parser_;
   DslParser *dsl_parser_ = nullptr;
@@ -93,12 +93,15 @@ bool FeatureOP::Run(SampleGroup *sample_group) {
     FeatureTable *feature_table = sample_group->mutable_feature_tables(feature_table_id);
     size_t feature_maps_size = feature_table_id == 0 ? 0 : feature_table->feature_lines_size();
     std::vector<FeatureMap> feature_maps(feature_maps_size);
+    const FeatureNameVec &feature_name_vec = feature_name_vecs_[feature_table_id];
+    // reused by the lines of table 0, which keep their buckets
+    FeatureMap feature_map(feature_name_vec.size());
 
     for (int i = 0, j = 0; j < feature_table->feature_lines_size(); ++j) {
       FeatureLine *feature_line = feature_table->mutable_feature_lines(j);
-      const FeatureNameVec &feature_name_vec = feature_name_vecs_[feature_table_id];
       // bind
-      FeatureMap feature_map(feature_name_vec.size());
+      feature_map.clear();
+      feature_map.reserve(feature_name_vec.size());
       int begin = 0;
       for (const std::string &feature_name : feature_name_vec) {
         const int index = BinarySearch(feature_line, feature_name, begin);
@@ -16,7 +16,10 @@ limitations under the License.
 
 #pragma once
 
+#include "xdl/data_io/op/feature_op/expr/expr_node.h"
+#include "xdl/data_io/op/feature_op/expr/internal_feature.h"
 #include "xdl/data_io/op/feature_op/multi_feature_op/multi_feature/multi_feature.h"
+#include "xdl/proto/sample.pb.h"
 
 namespace xdl {
 namespace io {
@@ -24,7 +27,69 @@ namespace io {
 class CrossFeature : public MultiFeature {
  public:
   virtual bool Combine(std::vector<const ExprNode *> &source_nodes, ExprNode *result_node) override;
+
+ protected:
+  /// Each source is read once into a flat array, the products are reserved
+  /// up front and the combine functions are inlined when they are known.
+  template <typename KeyFunc, typename ValueFunc>
+  static bool Cross(const std::vector<const ExprNode *> &source_nodes, ExprNode *result_node,
+                    const KeyFunc &combine_key, const ValueFunc &combine_value);
 };
 
+/// CrossFeature with the combine functions of Func called directly instead
+/// of through std::function.
+template <typename Func>
+class FuncCrossFeature : public CrossFeature {
+ public:
+  virtual bool Combine(std::vector<const ExprNode *> &source_nodes, ExprNode *result_node) override {
+    return Cross(source_nodes, result_node, Func::CombineKey, Func::CombineValue);
+  }
+};
+
+template <typename KeyFunc, typename ValueFunc>
+bool CrossFeature::Cross(const std::vector<const ExprNode *> &source_nodes, ExprNode *result_node,
+                         const KeyFunc &combine_key, const ValueFunc &combine_value) {
+  InternalFeature result_feature, source_feature, tmp_feature;
+  for (const ExprNode *source_node : source_nodes) {
+    const int source_values_size = source_node->values_size();
+    if (source_values_size == 0)  return false;
+    source_feature.clear();
+    source_feature.reserve(source_values_size);
+    int64_t source_key;
+    float source_value;
+    for (int k = 0; k < source_values_size; ++k) {
+      source_node->get(k, source_key, source_value);
+      if (source_key < 0)  continue;
+      source_feature.push_back(source_key, source_value);
+    }
+    if (result_feature.values_size() == 0) {
+      result_feature.swap(source_feature);
+      continue;
+    }
+    tmp_feature.clear();
+    tmp_feature.reserve(result_feature.values_size() * source_feature.values_size());
+    for (const InternalValue &result_value : result_feature.values()) {
+      for (const InternalValue &value : source_feature.values()) {
+        tmp_feature.push_back(combine_key(result_value.key(), value.key()),
+                              combine_value(result_value.value(), value.value()));
+      }
+    }
+    result_feature.swap(tmp_feature);
+  }  // end for source_nodes
+  if (result_node->output) {
+    Feature *result = reinterpret_cast<Feature *>(result_node->result);
+    result->mutable_values()->Reserve(result->values_size() + result_feature.values_size());
+    for (const InternalValue &internal_value : result_feature.values()) {
+      FeatureValue *feature_value = result->add_values();
+      if (internal_value.has_key())  feature_value->set_key(internal_value.key());
+      feature_value->set_value(internal_value.value());
+    }
+  } else {
+    InternalFeature *result = reinterpret_cast<InternalFeature *>(result_node->result);
+    result->swap(result_feature);
+  }
+  return true;
+}
+
 }  // namespace io
 }  // namespace xdl
\ No newline at end of file
@@ -23,11 +23,22 @@ limitations under the License.
 #include "xdl/data_io/op/feature_op/multi_feature_op/multi_feature/merge_feature.h"
 #include "xdl/data_io/op/feature_op/multi_feature_op/multi_feature/vector_feature.h"
 #include "xdl/data_io/op/feature_op/multi_feature_op/multi_feature/multi_feature.h"
+#include "xdl/data_io/op/feature_op/multi_feature_op/multi_feature_func/cartesian_product.h"
 #include "xdl/proto/sample.pb.h"
 
 namespace xdl {
 namespace io {
 
+namespace {
+
+template <typename FuncType, typename Func>
+bool IsFunc(const std::function<FuncType> &func, Func *target) {
+  Func *const *ptr = func.template target<Func *>();
+  return ptr != nullptr && *ptr == target;
+}
+
+}  // namespace
+
 bool MultiFeatureOp::Init(MultiFeaOpType multi_fea_op_type,
                           CombineKeyFunc combine_key_func,
                           CombineValueFunc combine_value_func) {
@@ -36,7 +47,12 @@ bool MultiFeatureOp::Init(MultiFeaOpType multi_fea_op_type,
   switch (multi_fea_op_type) {
    case MultiFeaOpType::kCrossFeatureOp:
     XDL_CHECK(combine_key_func != nullptr);
-    multi_feature_ = new CrossFeature();
+    if (IsFunc(combine_key_func, CartesianProduct::CombineKey) &&
+        IsFunc(combine_value_func, CartesianProduct::CombineValue)) {
+      multi_feature_ = new FuncCrossFeature<CartesianProduct>();
+    } else {
+      multi_feature_ = new CrossFeature();
+    }
     break;
    case MultiFeaOpType::kMergeFeatureOp:
     XDL_CHECK(combine_key_func != nullptr);
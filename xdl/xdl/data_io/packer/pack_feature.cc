@@ -21,6 +21,7 @@ bool PackFeature::Init(Batch *batch) {
   Pack::Init(batch);
 
   InitStats();
+  sgroups_ = 0;
 
   return true;
 }
@@ -162,6 +163,21 @@ std::pair<int, int> PackFeature::Stat(const PParam &pparam) {
   XDL_DCHECK(ktable < table_stats_.size());
   auto &tstat = table_stats_[ktable];
 
+  if (pparam.isgroup_ >= begins_.size()) {
+    begins_.resize(pparam.isgroup_ + 1);
+  }
+  auto &begins = begins_[pparam.isgroup_];
+  if (begins.size() < table_stats_.size()) {
+    begins.resize(table_stats_.size());
+  }
+  auto &tbegin = begins[ktable];
+  tbegin.off_ = tstat.n_;
+  tbegin.offs_.resize(tstat.seq_.size());
+  for (size_t i = 0; i < tstat.seq_.size(); ++i) {
+    tbegin.offs_[i] = tstat.seq_[i]->n_;
+  }
+  sgroups_ = pparam.isgroup_ + 1;
+
   for (int n = begin; n < end; ++n) {
     auto &fl = ftable->feature_lines(n);
     if (ktable < schema_->ntable() - 1) {
@@ -204,7 +220,7 @@ std::pair<int, int> PackFeature::Stat(const PParam &pparam) {
   return {ref_l, ref_r+1};
 }
 
-size_t PackFeature::OnFeature(FStat *stat, off_t offset, const Feature &f, int cutoff) {
+size_t PackFeature::OnFeature(FStat *stat, off_t *off, off_t offset, const Feature &f, int cutoff) {
   auto blk = stat->blk_;
 
   /// foreach feature value
@@ -227,21 +243,21 @@ size_t PackFeature::OnFeature(FStat *stat, off_t offset, const Feature &f, int c
       XDL_CHECK(blk->ts_[Block::kKey] != nullptr && blk->ts_[Block::kSegment] != nullptr);
       auto keys = blk->ts_[Block::kKey]->Raw<int64_t >();
       if (stat->opt_->serialized()) {
-        keys[stat->off_] = v.key();
+        keys[*off] = v.key();
       } else {
-        keys[stat->off_*2] = v.hkey();
-        keys[stat->off_*2+1] = v.key();
+        keys[(*off)*2] = v.hkey();
+        keys[(*off)*2+1] = v.key();
       }
       sparse = true;
     } else {
-      XDL_CHECK(stat->off_ <= offset) << "feature=" << stat->opt_->name() <<
-          " stat.off=" << stat->off_ << " != table.off=" << offset;
+      XDL_CHECK(*off <= offset) << "feature=" << stat->opt_->name() <<
+          " stat.off=" << *off << " != table.off=" << offset;
     }
 
     if (v.has_value()) {
       XDL_CHECK(blk->ts_[Block::kValue] != nullptr);
       auto values = blk->ts_[Block::kValue]->Raw<float>();
-      values[stat->off_] = v.value();
+      values[*off] = v.value();
     } else if (v.vector_size() > 0) {
       XDL_CHECK(blk->ts_[Block::kValue] != nullptr);
       XDL_DCHECK(stat->opt_->nvec() == v.vector_size()) 
@@ -261,35 +277,35 @@ size_t PackFeature::OnFeature(FStat *stat, off_t offset, const Feature &f, int c
     } else if (!v.has_value()) {
       XDL_CHECK(blk->ts_[Block::kValue] != nullptr);
       auto values = blk->ts_[Block::kValue]->Raw<float>();
-      values[stat->off_] = 1.0;
+      values[*off] = 1.0;
     }
-    ++stat->off_;
+    ++*off;
   }  // feature_value
 
   if (sparse) {
     auto segments = blk->ts_[Block::kSegment]->Raw<int32_t>();
-    segments[offset] = stat->off_;
+    segments[offset] = *off;
   }
 
   return vcount;
 }
 
-bool PackFeature::FeaturePad(FStat *stat, size_t offset, size_t end) {
+bool PackFeature::FeaturePad(FStat *stat, off_t off, size_t offset, size_t end) {
   XDL_DCHECK(offset < end) << "offset=" << offset << " end=" << end;
   if (stat->opt_->type() == kSparse) {
-    XDL_CHECK(stat->off_ <= stat->n_) << "feature=" << stat->opt_->name()
-        << " off=" << stat->off_ << " n=" << stat->n_ << " end=" << end;
+    XDL_CHECK(off <= stat->n_) << "feature=" << stat->opt_->name()
+        << " off=" << off << " n=" << stat->n_ << " end=" << end;
 
     auto segment = stat->blk_->ts_[Block::kSegment];
     XDL_DCHECK(segment != nullptr && end <= segment->Shape()[0])
         << "shape=(" << segment->Shape()[0] << ") end=" << end;
     auto segments = segment->Raw<int32_t>();
     for (int p = offset; p < end; ++p) {
-      segments[p] = stat->off_;
+      segments[p] = off;
     }
   } else {
-    XDL_CHECK(stat->off_ <= offset) << "feature=" << stat->opt_->name()
-        << " stat.off=" << stat->off_ << " != offset=" << offset;
+    XDL_CHECK(off <= offset) << "feature=" << stat->opt_->name()
+        << " stat.off=" << off << " != offset=" << offset;
 
     auto value = stat->blk_->ts_[Block::kValue];
     XDL_DCHECK(value != nullptr && end <= value->Shape()[0] && value->Shape()[1] == stat->w_);
@@ -304,25 +320,25 @@ bool PackFeature::FeaturePad(FStat *stat, size_t offset, size_t end) {
   return true;
 }
 
-bool PackFeature::OnIndicator(TStat *stat, const FeatureLine &fl) {
+bool PackFeature::OnIndicator(TStat *stat, off_t offset, off_t next, const FeatureLine &fl) {
   auto indicator = stat->blk_->ts_[Block::kIndex];
   XDL_DCHECK(indicator != nullptr && indicator->Shape()[0]>= stat->n_)
       << "tstat.n=" << stat->n_ << " > indicator."
       << stat->k_ << "(" << indicator->Shape()[0] << ")";
   auto indicators = indicator->Raw<uint32_t>();
-  indicators[stat->off_] = stat[1].off_ + fl.refer(); 
+  indicators[offset] = next + fl.refer();
   return true;
 }
 
-bool PackFeature::IndicatorPad(TStat *stat, off_t end) {
+bool PackFeature::IndicatorPad(TStat *stat, off_t offset, off_t end) {
   auto indicator = stat->blk_->ts_[Block::kIndex];
   XDL_DCHECK(indicator != nullptr && end <= indicator->Shape()[0])
       << indicator->Shape()[0] << " != " << end;
   auto indicators = indicator->Raw<uint32_t>();
-  int padding_refer = indicators[stat->off_-1]+1;
-  for (int i = stat->off_; i < end; ++i) {
+  int padding_refer = indicators[offset-1]+1;
+  for (int i = offset; i < end; ++i) {
     //indicators[i] = padding_refer;
-    indicators[i] = indicators[stat->off_-1];  // TODO: should be indicators[i] = padding_refer;
+    indicators[i] = indicators[offset-1];  // TODO: should be indicators[i] = padding_refer;
   }
   return true;
 }
@@ -346,6 +362,13 @@ std::pair<int, int> PackFeature::Run(const PParam &pparam) {
   XDL_DCHECK(ktable < table_stats_.size());
   auto &tstat = table_stats_[ktable];
 
+  /// the offsets of this sgroup, the next table's for the indicator
+  XDL_CHECK(pparam.isgroup_ < sgroups_) << "sgroup " << pparam.isgroup_ << " not stated";
+  auto &begins = begins_[pparam.isgroup_];
+  off_t toff = begins[ktable].off_;
+  off_t next = ktable + 1 < begins.size() ? begins[ktable + 1].off_ : 0;
+  std::vector<off_t> offs(begins[ktable].offs_);
+
   for (int n = begin; n < end; ++n) {
     auto &fl = ftable->feature_lines(n);
     if (fl.has_refer()) {
@@ -370,7 +393,7 @@ std::pair<int, int> PackFeature::Run(const PParam &pparam) {
       XDL_CHECK(stat.seq_ < feature_hits.size());
       feature_hits[stat.seq_] = 1;
 
-      size_t vcount = OnFeature(&stat, tstat.off_, f, stat.opt_->cutoff()!=0?stat.opt_->cutoff():INT_MAX);
+      size_t vcount = OnFeature(&stat, &offs[stat.seq_], toff, f, stat.opt_->cutoff()!=0?stat.opt_->cutoff():INT_MAX);
     }  // feature
 
     // miss
@@ -384,35 +407,37 @@ std::pair<int, int> PackFeature::Run(const PParam &pparam) {
       auto &stat = *(table_stats_[ktable].seq_[i]);
 
       //XDL_LOG(DEBUG) << "missed feature["<< stat.seq_ << "]=" << stat.opt_->name() << " stat.off_=" << stat.off_;
-      XDL_CHECK(FeaturePad(&stat, tstat.off_, tstat.off_+1));
+      XDL_CHECK(FeaturePad(&stat, offs[i], toff, toff+1));
     }
 
     if (fl.has_refer()) {
       XDL_CHECK(ktable < kTablesMax - 1 && TableN(ktable+1) > 0) 
           << "tstats[" << ktable << "].n=" << TableN(ktable) << " -> "
           << "tstats[" << ktable+1 << "].n=" << TableN(ktable+1);
-      XDL_CHECK(OnIndicator(&tstat, fl));
+      XDL_CHECK(OnIndicator(&tstat, toff, next, fl));
     }
 
-    ++tstat.off_;
-    //XDL_LOG(DEBUG) << "table[" << ktable << "].off=" << table_stats_[ktable].off_;
+    ++toff;
+    //XDL_LOG(DEBUG) << "table[" << ktable << "].off=" << toff;
   } /// for each feature_line
 
 
-  /// padding main table & indicator
-  if (tstat.off_ == tstat.n_) {
+  /// padding main table & indicator, by the last sgroup, which runs after
+  /// the others as the indicator padding reads their last line
+  if (pparam.isgroup_ + 1 == sgroups_) {
+    XDL_CHECK(toff == tstat.n_) << "table[" << ktable << "].off=" << toff << " n=" << tstat.n_;
     if (/* ktable == 0 && */schema_->padding_ && tstat.n_ < table_size) {
       XDL_LOG(DEBUG) << "batch finish, ktable=" << ktable 
           << " padding " << tstat.n_ << " -> " << table_size;
 
       for (auto &kv: tstat.seq_) {
         auto &stat = *kv;
-        XDL_CHECK(FeaturePad(&stat, tstat.off_, table_size));
+        XDL_CHECK(FeaturePad(&stat, offs[stat.seq_], toff, table_size));
       }  /// for each stat in tstat.seq_
 
       /// padding indicator to the padding line
       if (TableN(ktable + 1) > 0) {
-        XDL_CHECK(IndicatorPad(&tstat, table_size));
+        XDL_CHECK(IndicatorPad(&tstat, toff, table_size));
       }
     }
   }
@@ -47,11 +47,9 @@ class PackFeature : public Pack {
   struct Stat {
     inline void Reset() {
       n_ = 0;
-      off_ = 0;
       blk_ = nullptr;
     }
     size_t n_ = 0;                        // count of feature value in feature, group size, table size, counting while <Stat>
-    off_t off_ = 0;                       // inner offset of state, updating while <Run>
     Block *blk_ = nullptr;                // block for feature, coordinates, indicator, updating while <Run>
   };
 
@@ -75,6 +73,13 @@ class PackFeature : public Pack {
     unsigned k_ = 0;                      // ktable
   };
 
+  /// the offsets of a table before a sgroup, recorded while <Stat>, so that
+  /// the sgroups run apart from each other
+  struct Begin {
+    off_t off_ = 0;                       // table line
+    std::vector<off_t> offs_;             // feature value, by feature seq
+  };
+
   inline size_t TableN(const FStat &stat) const;
   inline size_t TableN(size_t ktable) const;
   inline size_t TableSize(const FStat &stat) const;
@@ -83,10 +88,12 @@ class PackFeature : public Pack {
 
   bool InitStats();
   /// return value count
-  size_t OnFeature(FStat *stat, off_t offset, const Feature &f, int cutoff);
-  bool FeaturePad(FStat *stat, size_t offset, size_t end);
-  bool OnIndicator(TStat *stat, const FeatureLine &fl);
-  bool IndicatorPad(TStat *stat, off_t end);
+  /// off is the value offset of the feature, offset the table line
+  size_t OnFeature(FStat *stat, off_t *off, off_t offset, const Feature &f, int cutoff);
+  bool FeaturePad(FStat *stat, off_t off, size_t offset, size_t end);
+  /// refer is offset by next, the line of the next table before the sgroup
+  bool OnIndicator(TStat *stat, off_t offset, off_t next, const FeatureLine &fl);
+  bool IndicatorPad(TStat *stat, off_t offset, off_t end);
 
   //size_t tables_n_[kTablesMax];
   //size_t tables_off_[kTablesMax];
@@ -94,6 +101,10 @@ class PackFeature : public Pack {
 
   std::vector<TStat> table_stats_;
   std::unordered_map<std::string, FStat> feature_stats_;
+
+  /// begins_[isgroup][ktable], grown only, sgroups_ of them stated
+  std::vector<std::vector<Begin>> begins_;
+  size_t sgroups_ = 0;
 };
 
 inline size_t PackFeature::TableN(const FStat &stat) const {
@@ -115,12 +126,12 @@ inline size_t PackFeature::TableSize(const FStat &stat) const {
 }
 
 inline size_t PackFeature::TableSize(size_t ktable) const {
-  if (ktable == 0 && schema_->padding_) {
-    return schema_->batch_size_;
-  }
   XDL_CHECK(ktable < table_stats_.size());
+  if (ktable == 0) {
+    return schema_->PaddedRows(table_stats_[0].n_);
+  }
   size_t bs = table_stats_[ktable].n_;
-  if (ktable > 0 && table_stats_[0].n_ < schema_->batch_size_ && table_stats_[ktable].n_ < schema_->batch_size_ && schema_->padding_) {
+  if (schema_->PaddedRows(table_stats_[0].n_) > table_stats_[0].n_ && table_stats_[ktable].n_ < schema_->batch_size_) {
     XDL_DLOG(DEBUG) << "extend a zero line for padding, ktable=" << ktable
         << " table.n=" << table_stats_[ktable].n_;
     bs += 1;
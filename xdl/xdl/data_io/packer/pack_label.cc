@@ -29,6 +29,12 @@ std::pair<int, int> PackLabel::Stat(const PParam &pparam) {
   XDL_CHECK(end - begin <= schema_->batch_size_) << "n=" << (end - begin)
       << " schema.batch_size=" << schema_->batch_size_;
 
+  if (pparam.isgroup_ >= begins_.size()) {
+    begins_.resize(pparam.isgroup_ + 1);
+  }
+  begins_[pparam.isgroup_] = n_;
+  sgroups_ = pparam.isgroup_ + 1;
+
   for (int n = begin; n < end; ++n) {
     auto &label = labels->Get(n);
     size_t label_count = label.values_size();
@@ -52,13 +58,13 @@ std::pair<int, int> PackLabel::Stat(const PParam &pparam) {
 bool PackLabel::Init(Batch *batch) {
   Pack::Init(batch);
   n_ = 0;
-  offset_ = 0;
+  sgroups_ = 0;
   return true;
 }
 
 bool PackLabel::Setup() {
   XDL_CHECK(label_count_ != 0);
-  size_t batch_size = schema_->padding_?schema_->batch_size_:n_;
+  size_t batch_size = schema_->PaddedRows(n_);
 
   auto blk = batch_->GetMutable(kLabelName);
   if (blk->ts_[Block::kValue] != nullptr) {
@@ -74,7 +80,9 @@ bool PackLabel::Setup() {
 
 std::pair<int, int> PackLabel::Run(const PParam &pparam) {
   XDL_CHECK(pparam.labels_ != nullptr && label_count_ > 0 && blk_ != nullptr);
-  size_t batch_size = schema_->padding_?schema_->batch_size_:n_;
+  XDL_CHECK(pparam.isgroup_ < sgroups_) << "sgroup " << pparam.isgroup_ << " not stated";
+  size_t batch_size = schema_->PaddedRows(n_);
+  off_t offset = begins_[pparam.isgroup_] * label_count_;
 
   XDL_CHECK(blk_->ts_[Block::kValue] != nullptr);
   auto value = (blk_->ts_[Block::kValue]->Raw<float>());
@@ -86,19 +94,20 @@ std::pair<int, int> PackLabel::Run(const PParam &pparam) {
   for (int n = begin; n < end; ++n) {
     auto &label = labels->Get(n);
     XDL_CHECK(label.values_size() == label_count_);
-    for (int v = 0; v < label_count_; ++v, ++offset_) {
-      XDL_CHECK(offset_ <= n_ * label_count_);
+    for (int v = 0; v < label_count_; ++v, ++offset) {
+      XDL_CHECK(offset <= n_ * label_count_);
       auto val = label.values(v);
-      value[offset_] = val;
+      value[offset] = val;
     }
   }
 
-  //padding
-  if (schema_->padding_ && offset_== n_*label_count_ && n_ < batch_size) {
+  //padding, by the last sgroup
+  if (schema_->padding_ && pparam.isgroup_ + 1 == sgroups_ && n_ < batch_size) {
+    XDL_CHECK(offset == n_ * label_count_) << offset << " " << n_;
     for (int n = n_; n < batch_size; ++n) {
-      for (int v = 0; v < label_count_; ++v, ++offset_) {
-        XDL_CHECK(offset_ <= batch_size * label_count_);
-        value[offset_] = 0;
+      for (int v = 0; v < label_count_; ++v, ++offset) {
+        XDL_CHECK(offset <= batch_size * label_count_);
+        value[offset] = 0;
       }
     }
   }
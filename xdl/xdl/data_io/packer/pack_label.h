@@ -42,7 +42,9 @@ class PackLabel : public Pack {
  protected:
   size_t n_ = 0;
   size_t label_count_ = 0;
-  off_t offset_ = 0;
+  /// the samples before each sgroup, recorded while <Stat>
+  std::vector<size_t> begins_;
+  size_t sgroups_ = 0;
   Block *blk_ = nullptr;
 };
 
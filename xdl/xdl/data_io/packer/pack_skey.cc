@@ -14,11 +14,86 @@ limitations under the License.
 ==============================================================================*/
 
 #include "xdl/data_io/packer/pack_skey.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <mutex>
+#include <unordered_set>
+
 #include "xdl/core/utils/logging.h"
 
 namespace xdl {
 namespace io {
 
+int64_t PackSKey::Hash(const char *skey, size_t len) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= (uint8_t)skey[i];
+    hash *= 1099511628211ULL;
+  }
+  return (int64_t)hash;
+}
+
+namespace {
+
+struct SKeyDict {
+  FILE *file = nullptr;
+  /// the hashes written to file
+  std::unordered_set<int64_t> ids;
+};
+
+std::mutex &DictsMutex() {
+  static std::mutex mu;
+  return mu;
+}
+
+/// by path, guarded by DictsMutex
+std::map<std::string, SKeyDict> &Dicts() {
+  static std::map<std::string, SKeyDict> dicts;
+  return dicts;
+}
+
+void OpenDict(const std::string &path, SKeyDict *dict) {
+  if (dict->file != nullptr) {
+    fclose(dict->file);
+  }
+  dict->ids.clear();
+  dict->file = fopen(path.c_str(), "w");
+  XDL_CHECK(dict->file != nullptr) << "open skey dict " << path
+      << " failed, " << strerror(errno);
+}
+
+}  // namespace
+
+void PackSKey::ResetDict(const std::string &path) {
+  std::unique_lock<std::mutex> lck(DictsMutex());
+  OpenDict(path, &Dicts()[path]);
+}
+
+void PackSKey::AppendDict(const std::vector<std::pair<int64_t, const std::string *>> &keys,
+                          bool flush) {
+  const std::string &path = schema_->skey_dict_;
+  std::unique_lock<std::mutex> lck(DictsMutex());
+  auto &dict = Dicts()[path];
+  if (dict.file == nullptr) {
+    OpenDict(path, &dict);
+  }
+  std::string lines;
+  for (auto &key : keys) {
+    if (dict.ids.insert(key.first).second) {
+      lines.append(std::to_string(key.first)).append(1, '\t')
+          .append(*key.second).append(1, '\n');
+    }
+  }
+  XDL_CHECK(fwrite(lines.data(), 1, lines.size(), dict.file) == lines.size())
+      << "write skey dict " << path << " failed";
+  if (flush) {
+    fflush(dict.file);
+  }
+}
+
 std::pair<int, int> PackSKey::Stat(const PParam &pparam) {
   XDL_CHECK(pparam.sample_ids_ != nullptr);
 
@@ -26,6 +101,12 @@ std::pair<int, int> PackSKey::Stat(const PParam &pparam) {
   int begin = std::max(pparam.begin_, 0);
   int end = std::min(pparam.end_, sample_ids->size());
 
+  if (pparam.isgroup_ >= begins_.size()) {
+    begins_.resize(pparam.isgroup_ + 1);
+  }
+  begins_[pparam.isgroup_] = n_;
+  sgroups_ = pparam.isgroup_ + 1;
+
   for (int n = begin; n < end; ++n) {
     auto &skey = sample_ids->Get(n);
     skey_len_max_ = std::max(skey_len_max_, skey.size() + 1);
@@ -40,12 +121,12 @@ bool PackSKey::Init(Batch *batch) {
   Pack::Init(batch);
   skey_len_max_ = 1;
   n_ = 0;
-  offset_ = 0;
+  sgroups_ = 0;
   return true;
 };
 
 bool PackSKey::Setup() {
-  size_t batch_size = schema_->padding_?schema_->batch_size_:n_;
+  size_t batch_size = schema_->PaddedRows(n_);
 
   auto blk = batch_->GetMutable(kSKeyName);
   XDL_CHECK(blk != nullptr);
@@ -53,7 +134,8 @@ bool PackSKey::Setup() {
   if (blk->ts_[Block::kSBuf] != nullptr) {
     delete blk->ts_[Block::kSBuf];
   }
-  blk->ts_[Block::kSBuf] = new Tensor(dev_, TensorShape({batch_size, skey_len_max_}), types::kInt8);
+  size_t width = schema_->skey_hash_ ? sizeof(int64_t) : skey_len_max_;
+  blk->ts_[Block::kSBuf] = new Tensor(dev_, TensorShape({batch_size, width}), types::kInt8);
 
   blk_ = blk;
   blk_->ts_count_ = 1;
@@ -64,7 +146,9 @@ bool PackSKey::Setup() {
 std::pair<int, int> PackSKey::Run(const PParam &pparam) {
   XDL_CHECK(pparam.sample_ids_ != nullptr && skey_len_max_ > 0 && blk_ != nullptr)
       << "skey_len_max=" << skey_len_max_ << ", blk=" << (void *)blk_;
-  size_t batch_size = schema_->padding_?schema_->batch_size_:n_;
+  XDL_CHECK(pparam.isgroup_ < sgroups_) << "sgroup " << pparam.isgroup_ << " not stated";
+  size_t batch_size = schema_->PaddedRows(n_);
+  off_t offset = begins_[pparam.isgroup_];
 
   auto sbuf = (char *)blk_->ts_[Block::kSBuf]->Raw<int8_t>();
 
@@ -72,18 +156,38 @@ std::pair<int, int> PackSKey::Run(const PParam &pparam) {
   int begin = std::max(pparam.begin_, 0);
   int end = std::min(pparam.end_, sample_ids->size());
 
-  for (int n = begin; n < end; ++n) {
-    XDL_CHECK(offset_ <= n_) << offset_ << " " << n_;
-    auto &skey = sample_ids->Get(n);
-    XDL_CHECK(skey.size() < skey_len_max_);
-    strcpy(&sbuf[skey_len_max_*offset_], skey.c_str());
-    ++ offset_;
+  if (schema_->skey_hash_) {
+    std::vector<std::pair<int64_t, const std::string *>> keys;
+    for (int n = begin; n < end; ++n) {
+      XDL_CHECK(offset <= n_) << offset << " " << n_;
+      auto &skey = sample_ids->Get(n);
+      int64_t id = Hash(skey.data(), skey.size());
+      memcpy(&sbuf[sizeof(id)*offset], &id, sizeof(id));
+      if (!schema_->skey_dict_.empty()) {
+        keys.push_back(std::make_pair(id, &skey));
+      }
+      ++ offset;
+    }
+    bool last = pparam.isgroup_ + 1 == sgroups_;
+    if (!keys.empty() || (last && !schema_->skey_dict_.empty())) {
+      AppendDict(keys, last);
+    }
+  } else {
+    for (int n = begin; n < end; ++n) {
+      XDL_CHECK(offset <= n_) << offset << " " << n_;
+      auto &skey = sample_ids->Get(n);
+      XDL_CHECK(skey.size() < skey_len_max_);
+      strcpy(&sbuf[skey_len_max_*offset], skey.c_str());
+      ++ offset;
+    }
   }
 
-  //padding
-  if (schema_->padding_ && offset_ == n_ && n_ < batch_size) {
-    for (; offset_ < batch_size; ++offset_) {
-      sbuf[skey_len_max_*offset_] = '\0';
+  //padding, by the last sgroup
+  if (schema_->padding_ && pparam.isgroup_ + 1 == sgroups_ && n_ < batch_size) {
+    XDL_CHECK(offset == n_) << offset << " " << n_;
+    size_t width = schema_->skey_hash_ ? sizeof(int64_t) : skey_len_max_;
+    for (; offset < batch_size; ++offset) {
+      memset(&sbuf[width*offset], 0, schema_->skey_hash_ ? width : 1);
     }
   }
 
@@ -39,10 +39,26 @@ class PackSKey : public Pack {
   /// 4. run each sgroup
   virtual std::pair<int, int> Run(const PParam &pparam) override;
 
+  /// the 64 bits fnv-1a hash of the sample key, which the batches hold
+  /// as 8 int8 each with schema skey_hash
+  static int64_t Hash(const char *skey, size_t len);
+
+  /// truncate the skey dict at path, a key is written to it once from then
+  /// on. A dict not reset is truncated when the process first writes it.
+  static void ResetDict(const std::string &path);
+
  protected:
+  /// append the keys not in the skey dict yet as lines of hash and key, the
+  /// dict is shared by the packers and flushed with the last sgroup of a
+  /// batch
+  void AppendDict(const std::vector<std::pair<int64_t, const std::string *>> &keys,
+                  bool flush);
+
   size_t skey_len_max_ = 1;
   size_t n_ = 0;
-  off_t offset_ = 0;
+  /// the samples before each sgroup, recorded while <Stat>
+  std::vector<size_t> begins_;
+  size_t sgroups_ = 0;
   Block *blk_ = nullptr;
 };
 
@@ -18,15 +18,44 @@ limitations under the License.
 #include "xdl/data_io/packer/pack_label.h"
 #include "xdl/data_io/packer/pack_feature.h"
 
+#include <stdlib.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include "xdl/data_io/constant.h"
 #include "xdl/data_io/pool.h"
 
+#include "xdl/core/lib/thread_pool.h"
 #include "xdl/core/lib/timer.h"
 #include "xdl/core/utils/logging.h"
 
 namespace xdl {
 namespace io {
 
+namespace {
+
+/// the samples of a batch a packing task takes at least
+const size_t kPackTaskSamples = 2048;
+
+size_t PackThreads() {
+  static size_t threads = [] {
+    const char *env = getenv("XDL_IO_PACK_THREADS");
+    size_t threads = env == nullptr ? std::thread::hardware_concurrency()
+                                    : strtoul(env, nullptr, 10);
+    return std::max<size_t>(1, threads);
+  }();
+  return threads;
+}
+
+ThreadPool *PackPool() {
+  static ThreadPool pool(PackThreads());
+  return &pool;
+}
+
+}  // namespace
+
 Packer::Packer(const Schema *schema, Device *dev) 
     : schema_(schema), dev_(dev) {
   packs_[kPackSKey] = new PackSKey(dev_, schema_);
@@ -52,6 +81,7 @@ Batch *Packer::Run(std::vector<SGroup*> *sgroups, size_t *total_size_p) {
   }
 
   batch->ts_count_ = 0;
+  batch->size_ = total_size;
   for (int i = 0; i < kPackCount; ++i) {
     packs_[i]->Init(batch);
   }
@@ -110,31 +140,51 @@ Batch *Packer::Run(std::vector<SGroup*> *sgroups, size_t *total_size_p) {
     packs_[p]->Setup();
   }
 
-  /// run
-  for (int i = 0; i < sgroups->size(); ++i) {
-    auto sgroup = sgroups->at(i);
-    auto sg = sgroup->Get();
-
-    pparam.ntable_ = sg->feature_tables_size();
-    pparam.begin_ = sgroup->begin_;
-    pparam.end_ = sgroup->end_;
-    pparam.isgroup_ = i;
-
-    pparam.sample_ids_ = &sg->sample_ids();
-    packs_[kPackSKey]->Run(pparam);
-
-    pparam.labels_ = &sg->labels();
-    packs_[kPackLabel]->Run(pparam);
+  /// run, the sgroups write apart from each other at the offsets stated,
+  /// the last one pads the batch after the others
+  size_t last = sgroups->size() - 1;
+  size_t tasks = std::min(PackThreads(), batch->size_ / kPackTaskSamples);
+  tasks = std::min(tasks, last);
+  if (tasks > 1) {
+    /// split the sgroups before the last by samples
+    std::vector<size_t> bounds(1, 0);
+    size_t samples = batch->size_ - (sgroups->back()->end_ - sgroups->back()->begin_);
+    size_t acc = 0;
+    for (size_t i = 0; i < last; ++i) {
+      acc += sgroups->at(i)->end_ - sgroups->at(i)->begin_;
+      if (acc * tasks >= samples * bounds.size() || i + 1 == last) {
+        bounds.push_back(i + 1);
+      }
+    }
 
-    XDL_CHECK(sg->feature_tables_size() == schema_->ntable());
-    for (int k = 0; k < sg->feature_tables_size(); ++k) {
-      pparam.ftable_ = &sg->feature_tables(k);
-      pparam.ktable_ = k;
-      auto range = packs_[kPackFeature]->Run(pparam);
-      pparam.begin_ = range.first;
-      pparam.end_ = range.second;
+    std::mutex mu;
+    std::condition_variable cv;
+    size_t pending = bounds.size() - 2;
+    for (size_t t = 1; t + 1 < bounds.size(); ++t) {
+      size_t begin = bounds[t], end = bounds[t+1];
+      PackPool()->Schedule([this, sgroups, begin, end, &mu, &cv, &pending] {
+        for (size_t i = begin; i < end; ++i) {
+          Run(sgroups->at(i), i);
+        }
+        std::unique_lock<std::mutex> lck(mu);
+        if (--pending == 0) {
+          cv.notify_all();
+        }
+      });
+    }
+    for (size_t i = bounds[0]; i < bounds[1]; ++i) {
+      Run(sgroups->at(i), i);
+    }
+    std::unique_lock<std::mutex> lck(mu);
+    cv.wait(lck, [&pending] { return pending == 0; });
+  } else {
+    for (size_t i = 0; i < last; ++i) {
+      Run(sgroups->at(i), i);
     }
+  }
+  Run(sgroups->at(last), last);
 
+  for (auto sgroup : *sgroups) {
     if (schema_->keep_sgroup_) {
       batch->Keep(sgroup);
     } else {
@@ -148,6 +198,31 @@ Batch *Packer::Run(std::vector<SGroup*> *sgroups, size_t *total_size_p) {
   return batch;
 }
 
+void Packer::Run(SGroup *sgroup, int isgroup) {
+  auto sg = sgroup->Get();
+
+  PParam pparam;
+  pparam.ntable_ = sg->feature_tables_size();
+  pparam.begin_ = sgroup->begin_;
+  pparam.end_ = sgroup->end_;
+  pparam.isgroup_ = isgroup;
+
+  pparam.sample_ids_ = &sg->sample_ids();
+  packs_[kPackSKey]->Run(pparam);
+
+  pparam.labels_ = &sg->labels();
+  packs_[kPackLabel]->Run(pparam);
+
+  XDL_CHECK(sg->feature_tables_size() == schema_->ntable());
+  for (int k = 0; k < sg->feature_tables_size(); ++k) {
+    pparam.ftable_ = &sg->feature_tables(k);
+    pparam.ktable_ = k;
+    auto range = packs_[kPackFeature]->Run(pparam);
+    pparam.begin_ = range.first;
+    pparam.end_ = range.second;
+  }
+}
+
 std::vector<Batch *>Packer::Run(SGroup *sgroup) {
   std::vector<Batch *> out;
   assert(sgroup != nullptr);
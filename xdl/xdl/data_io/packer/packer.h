@@ -44,6 +44,7 @@ class Pack {
   /// 1. init each new batch
   virtual bool Init(Batch *batch) {
     batch_ = batch;
+    return true;
   }
 
   /// 2. run each sgroup
@@ -75,6 +76,10 @@ class Packer {
   std::vector<Batch *>Run(SGroup *sgroup);
 
  protected:
+  /* run the packs of the sgroup of index isgroup after the stat, the sgroups
+   * but the last may run in parallel, XDL_IO_PACK_THREADS of them */
+  void Run(SGroup *sgroup, int isgroup);
+
   Device *dev_ = nullptr;
   const Schema *schema_ = nullptr;
 
@@ -0,0 +1,618 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/data_io/parser/columnar.h"
+
+#include <algorithm>
+#include <bitset>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "xdl/data_io/pool.h"
+#include "xdl/core/utils/logging.h"
+
+namespace xdl {
+namespace io {
+
+namespace {
+
+/// owns a mapping, freed with the last buffer on it
+class MappedFile : public Allocator {
+ public:
+  explicit MappedFile(size_t size) : size_(size) {}
+  void* Allocate(size_t size) override { return nullptr; }
+  void Deallocate(void* buf) override { munmap(buf, size_); }
+ private:
+  size_t size_;
+};
+
+template <typename T>
+void Append(std::string *out, T value) {
+  out->append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+bool Take(const char **data, const char *end, T *value) {
+  if (end - *data < (ptrdiff_t)sizeof(T)) {
+    return false;
+  }
+  memcpy(value, *data, sizeof(T));
+  *data += sizeof(T);
+  return true;
+}
+
+/// values per row of a dense feature or per key of a sparse one, as packed
+size_t Width(const FeatureOption *opt) {
+  if (opt->has_mask()) {
+    return std::bitset<kNVecMax>(opt->mask()).count();
+  }
+  return opt->has_nvec() ? opt->nvec() : 1;
+}
+
+const size_t kTrailerSize = sizeof(uint64_t) + sizeof(ColumnarMeta::kMagic);
+/// skipping less than this costs more than reading through
+const uint64_t kColumnGap = 256 * 1024;
+
+}  // namespace
+
+const char ColumnarMeta::kMagic[8] = {'X', 'D', 'L', 'C', 'O', 'L', '0', '1'};
+
+std::string ColumnarMeta::Encode() const {
+  std::string out;
+  Append<uint32_t>(&out, kVersion);
+  Append<uint32_t>(&out, label_count);
+  Append<uint32_t>(&out, features.size());
+  size_t nsparse = 0;
+  for (auto &f : features) {
+    Append<uint32_t>(&out, f.name.size());
+    out += f.name;
+    Append<uint32_t>(&out, f.type);
+    Append<uint32_t>(&out, f.nvec);
+    Append<uint32_t>(&out, f.flags);
+    nsparse += f.type == kSparse ? 1 : 0;
+  }
+  Append<uint64_t>(&out, chunks.size());
+  for (auto &c : chunks) {
+    XDL_CHECK(c.nnz.size() == nsparse);
+    Append<uint64_t>(&out, c.offset);
+    Append<uint32_t>(&out, c.rows);
+    Append<uint32_t>(&out, c.skey_width);
+    for (auto nnz : c.nnz) {
+      Append<uint64_t>(&out, nnz);
+    }
+  }
+  return out;
+}
+
+bool ColumnarMeta::Decode(const char *data, size_t size) {
+  const char *end = data + size;
+  uint32_t version, nfeature;
+  if (!Take(&data, end, &version) || version != kVersion ||
+      !Take(&data, end, &label_count) || !Take(&data, end, &nfeature)) {
+    return false;
+  }
+  features.resize(nfeature);
+  size_t nsparse = 0;
+  for (auto &f : features) {
+    uint32_t len;
+    if (!Take(&data, end, &len) || end - data < len) {
+      return false;
+    }
+    f.name.assign(data, len);
+    data += len;
+    if (!Take(&data, end, &f.type) || !Take(&data, end, &f.nvec) ||
+        !Take(&data, end, &f.flags)) {
+      return false;
+    }
+    nsparse += f.type == kSparse ? 1 : 0;
+  }
+  uint64_t nchunk;
+  if (!Take(&data, end, &nchunk)) {
+    return false;
+  }
+  chunks.clear();
+  for (uint64_t i = 0; i < nchunk; ++i) {
+    Chunk c;
+    if (!Take(&data, end, &c.offset) || !Take(&data, end, &c.rows) ||
+        !Take(&data, end, &c.skey_width)) {
+      return false;
+    }
+    c.nnz.resize(nsparse);
+    for (auto &nnz : c.nnz) {
+      if (!Take(&data, end, &nnz)) {
+        return false;
+      }
+    }
+    chunks.push_back(std::move(c));
+  }
+  return data == end;
+}
+
+std::vector<ColumnarMeta::Column> ColumnarMeta::Columns(const Chunk &chunk) const {
+  std::vector<Column> columns;
+  uint64_t offset = chunk.offset;
+  auto add = [&columns, &offset](uint64_t size) {
+    offset = Align(offset);
+    columns.push_back(Column{offset, size});
+    offset += size;
+  };
+  add((uint64_t)chunk.rows * chunk.skey_width);
+  add((uint64_t)chunk.rows * label_count * sizeof(float));
+  size_t k = 0;
+  for (auto &f : features) {
+    if (f.type == kSparse) {
+      uint64_t nnz = chunk.nnz[k++];
+      add((uint64_t)chunk.rows * sizeof(int32_t));
+      add(nnz * (f.flags & kSerialized ? 1 : 2) * sizeof(int64_t));
+      add(f.flags & kHasValue ? nnz * f.nvec * sizeof(float) : 0);
+    } else {
+      add((uint64_t)chunk.rows * f.nvec * sizeof(float));
+    }
+  }
+  return columns;
+}
+
+uint64_t ColumnarMeta::End(const Chunk &chunk) const {
+  auto columns = Columns(chunk);
+  return columns.back().offset + columns.back().size;
+}
+
+ColumnarWriter::ColumnarWriter(IOAnt *ant, const Schema *schema)
+    : ant_(ant), schema_(schema) {
+  XDL_CHECK(ant_ != nullptr);
+  XDL_CHECK(Put(ColumnarMeta::kMagic, sizeof(ColumnarMeta::kMagic)));
+}
+
+ColumnarWriter::~ColumnarWriter() {
+  if (!closed_) {
+    Close();
+  }
+}
+
+bool ColumnarWriter::Put(const void *data, size_t size) {
+  if (size == 0) {
+    return true;
+  }
+  if (ant_->Write((const char *)data, size) != (ssize_t)size) {
+    return false;
+  }
+  offset_ += size;
+  return true;
+}
+
+bool ColumnarWriter::PadTo(uint64_t offset) {
+  static const char zeros[ColumnarMeta::kAlign] = {0};
+  XDL_CHECK(offset >= offset_ && offset - offset_ <= ColumnarMeta::kAlign);
+  return Put(zeros, offset - offset_);
+}
+
+bool ColumnarWriter::Write(const Batch *batch) {
+  XDL_CHECK(!closed_);
+  auto label = batch->GetTensor(kLabelName, Block::kValue);
+  XDL_CHECK(label != nullptr && label->Shape().Size() == 2);
+  // the padding rows of a packed batch are left out
+  size_t rows = label->Shape()[0];
+  if (batch->size_ > 0 && batch->size_ < rows) {
+    rows = batch->size_;
+  }
+  if (meta_.chunks.empty()) {
+    meta_.label_count = label->Shape()[1];
+    for (auto &it : schema_->feature_opts()) {
+      auto opt = it.second;
+      XDL_CHECK(opt->table() == 0) << "columnar file only holds table 0, feature="
+          << opt->name();
+      auto value = batch->GetTensor(opt->name(), Block::kValue);
+      XDL_CHECK(value != nullptr) << "feature=" << opt->name() << " not in batch";
+      ColumnarMeta::Feature f;
+      f.name = opt->name();
+      f.type = opt->type();
+      f.nvec = value->Shape()[1];
+      f.flags = ColumnarMeta::kHasValue | (opt->serialized() ? ColumnarMeta::kSerialized : 0);
+      meta_.features.push_back(f);
+    }
+  }
+  XDL_CHECK(label->Shape()[1] == meta_.label_count);
+
+  ColumnarMeta::Chunk chunk;
+  chunk.offset = ColumnarMeta::Align(offset_);
+  chunk.rows = rows;
+  chunk.skey_width = 0;
+  auto skey = batch->GetTensor(kSKeyName, Block::kSBuf);
+  if (skey != nullptr && skey->Shape().Size() == 2 && skey->Shape()[0] >= rows) {
+    chunk.skey_width = skey->Shape()[1];
+  }
+
+  std::vector<const Tensor *> data = {chunk.skey_width > 0 ? skey : nullptr, label};
+  for (auto &f : meta_.features) {
+    auto blk = batch->Get(f.name);
+    XDL_CHECK(blk != nullptr) << "feature=" << f.name << " not in batch";
+    auto value = blk->ts_[Block::kValue];
+    XDL_CHECK(value != nullptr && value->Shape()[1] == f.nvec);
+    if (f.type == kSparse) {
+      auto segment = blk->ts_[Block::kSegment];
+      auto key = blk->ts_[Block::kKey];
+      XDL_CHECK(segment != nullptr && segment->Shape()[0] >= rows) << "feature=" << f.name;
+      XDL_CHECK(key != nullptr && key->Shape()[0] == value->Shape()[0]) << "feature=" << f.name;
+      size_t nnz = key->Shape()[0];
+      if (segment->Shape()[0] > rows) {
+        nnz = segment->Raw<int32_t>()[rows - 1];
+        XDL_CHECK(nnz <= key->Shape()[0]) << "feature=" << f.name;
+      }
+      chunk.nnz.push_back(nnz);
+      data.push_back(segment);
+      data.push_back(key);
+      data.push_back(value);
+    } else {
+      XDL_CHECK(value->Shape()[0] >= rows) << "feature=" << f.name;
+      data.push_back(value);
+    }
+  }
+
+  auto columns = meta_.Columns(chunk);
+  XDL_CHECK(columns.size() == data.size());
+  for (size_t i = 0; i < columns.size(); ++i) {
+    if (columns[i].size == 0) {
+      continue;
+    }
+    XDL_CHECK(data[i]->Shape().NumElements() * SizeOfType(data[i]->Type()) >= columns[i].size);
+    if (!PadTo(columns[i].offset) ||
+        !Put(data[i]->Raw<char>(), columns[i].size)) {
+      return false;
+    }
+  }
+  meta_.chunks.push_back(std::move(chunk));
+  return true;
+}
+
+bool ColumnarWriter::Close() {
+  XDL_CHECK(!closed_);
+  closed_ = true;
+  std::string footer = meta_.Encode();
+  uint64_t size = footer.size();
+  return Put(footer.data(), footer.size()) && Put(&size, sizeof(size)) &&
+      Put(ColumnarMeta::kMagic, sizeof(ColumnarMeta::kMagic));
+}
+
+ColumnarReader::ColumnarReader(const Schema *schema, Device *dev, bool mmap)
+    : schema_(schema), dev_(dev), mmap_(mmap), running_(true) {
+  for (auto &it : schema_->feature_opts()) {
+    auto opt = it.second;
+    XDL_CHECK(opt->table() == 0) << "columnar file only holds table 0, feature="
+        << opt->name();
+    XDL_CHECK(!opt->has_cutoff() || opt->cutoff() == 0)
+        << "cutoff is applied while writing the columnar file, feature=" << opt->name();
+    opts_.push_back(opt);
+  }
+}
+
+ColumnarReader::~ColumnarReader() {
+  Close();
+}
+
+bool ColumnarReader::Open(ReadParam *rparam) {
+  Close();
+  rparam_ = rparam;
+  XDL_CHECK(rparam_->end_ != ULONG_MAX) << "columnar file can't be compressed, path="
+      << rparam_->path_;
+  if (!ReadMeta()) {
+    XDL_LOG(ERROR) << "invalid columnar file " << rparam_->path_;
+    return false;
+  }
+
+  std::vector<size_t> column(meta_.features.size()), sparse(meta_.features.size());
+  size_t c = 2, k = 0;
+  for (size_t i = 0; i < meta_.features.size(); ++i) {
+    column[i] = c;
+    sparse[i] = k;
+    bool is_sparse = meta_.features[i].type == kSparse;
+    c += is_sparse ? 3 : 1;
+    k += is_sparse ? 1 : 0;
+  }
+  features_.clear();
+  for (auto opt : opts_) {
+    size_t i = 0;
+    while (i < meta_.features.size() && meta_.features[i].name != opt->name()) {
+      ++i;
+    }
+    XDL_CHECK(i < meta_.features.size()) << "feature=" << opt->name()
+        << " not in columnar file " << rparam_->path_;
+    auto &f = meta_.features[i];
+    size_t width = Width(opt);
+    XDL_CHECK(f.type == opt->type() && f.nvec == width &&
+              (f.type != kSparse || !(f.flags & ColumnarMeta::kSerialized) == !opt->serialized()))
+        << "feature=" << opt->name() << " mismatches columnar file " << rparam_->path_;
+    features_.push_back({column[i], sparse[i]});
+  }
+  used_ = {0, 1};
+  for (auto &f : features_) {
+    size_t i = 0;
+    while (column[i] != f.first) {
+      ++i;
+    }
+    size_t n = meta_.features[i].type == kSparse ? 3 : 1;
+    for (size_t k = 0; k < n; ++k) {
+      used_.push_back(f.first + k);
+    }
+  }
+  std::sort(used_.begin(), used_.end());
+
+  size_t first = 0;
+  while (first < meta_.chunks.size() &&
+         meta_.chunks[first].offset < rparam_->begin_) {
+    ++first;
+  }
+  order_.clear();
+  for (size_t i = first; i < meta_.chunks.size(); ++i) {
+    order_.push_back(i);
+  }
+  if (shuffle_) {
+    std::random_shuffle(order_.begin(), order_.end());
+  }
+  next_ = 0;
+  chunk_ = order_.empty() ? meta_.chunks.size() : order_[0];
+  row_ = 0;
+  loaded_ = false;
+  return true;
+}
+
+bool ColumnarReader::ReadMeta() {
+  uint64_t size = rparam_->end_;
+  if (size < sizeof(ColumnarMeta::kMagic) + kTrailerSize) {
+    return false;
+  }
+  std::string trailer(kTrailerSize, '\0');
+  if (mmap_) {
+    int fd = open(rparam_->path_, O_RDONLY);
+    XDL_CHECK(fd >= 0) << "open " << rparam_->path_ << " failed";
+    // private, so the batches may be written in place
+    void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    XDL_CHECK(addr != MAP_FAILED) << "mmap " << rparam_->path_ << " failed";
+    madvise(addr, size, MADV_SEQUENTIAL);
+    MappedFile *file = new MappedFile(size);
+    buffer_ = RefCountedPtr<Buffer>::Create(file, addr, size, true);
+    file->UnRef();
+    base_ = 0;
+    memcpy(&trailer[0], (char *)addr + size - kTrailerSize, kTrailerSize);
+  } else {
+    rparam_->ant_->Seek(size - kTrailerSize);
+    if (rparam_->ant_->Read(&trailer[0], kTrailerSize) != (ssize_t)kTrailerSize) {
+      return false;
+    }
+  }
+  uint64_t footer_size;
+  memcpy(&footer_size, trailer.data(), sizeof(footer_size));
+  if (memcmp(trailer.data() + sizeof(footer_size), ColumnarMeta::kMagic,
+             sizeof(ColumnarMeta::kMagic)) != 0 ||
+      footer_size > size - sizeof(ColumnarMeta::kMagic) - kTrailerSize) {
+    return false;
+  }
+  uint64_t footer_offset = size - kTrailerSize - footer_size;
+  std::string footer(footer_size, '\0');
+  if (mmap_) {
+    memcpy(&footer[0], (char *)buffer_->begin() + footer_offset, footer_size);
+  } else {
+    rparam_->ant_->Seek(footer_offset);
+    size_t read = 0;
+    while (read < footer_size) {
+      ssize_t n = rparam_->ant_->Read(&footer[read], footer_size - read);
+      if (n <= 0) {
+        return false;
+      }
+      read += n;
+    }
+  }
+  if (!meta_.Decode(footer.data(), footer.size())) {
+    return false;
+  }
+  for (auto &c : meta_.chunks) {
+    if (c.offset % ColumnarMeta::kAlign != 0 || meta_.End(c) > footer_offset) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ColumnarReader::LoadChunk() {
+  if (chunk_ >= meta_.chunks.size()) {
+    return false;
+  }
+  auto &chunk = meta_.chunks[chunk_];
+  columns_ = meta_.Columns(chunk);
+  if (!mmap_) {
+    size_t size = meta_.End(chunk) - chunk.offset;
+    buffer_ = RefCountedPtr<Buffer>::Create(dev_->GetAllocator(), size);
+    base_ = chunk.offset;
+    /// the used columns closer than kColumnGap are read in one go
+    uint64_t begin = 0, end = 0;
+    for (auto c : used_) {
+      auto &column = columns_[c];
+      if (column.size == 0) {
+        continue;
+      }
+      if (end > begin && column.offset > end + kColumnGap) {
+        ReadRange(begin, end - begin);
+        begin = end = 0;
+      }
+      if (end == begin) {
+        begin = column.offset;
+      }
+      end = column.offset + column.size;
+    }
+    if (end > begin) {
+      ReadRange(begin, end - begin);
+    }
+  }
+  row_ = 0;
+  loaded_ = true;
+  return true;
+}
+
+void ColumnarReader::ReadRange(uint64_t offset, uint64_t size) {
+  rparam_->ant_->Seek(offset);
+  size_t read = 0;
+  while (read < size) {
+    ssize_t n = rparam_->ant_->Read((char *)buffer_->begin() + (offset - base_) + read,
+                                    size - read);
+    XDL_CHECK(n > 0) << "read columnar chunk failed, path=" << rparam_->path_
+        << " offset=" << offset + read;
+    read += n;
+  }
+}
+
+Batch *ColumnarReader::Next() {
+  while (running_) {
+    if (!loaded_ && !LoadChunk()) {
+      return nullptr;
+    }
+    auto &chunk = meta_.chunks[chunk_];
+    if (row_ >= chunk.rows) {
+      chunk_ = ++next_ < order_.size() ? order_[next_] : meta_.chunks.size();
+      loaded_ = false;
+      /// a restored state resumes from the next chunk
+      rparam_->begin_ = chunk_ < meta_.chunks.size() ? meta_.chunks[chunk_].offset
+          : rparam_->end_;
+      rparam_->parsed_ = rparam_->begin_;
+      continue;
+    }
+    size_t end = chunk.rows;
+    if (schema_->batch_size_ > 0) {
+      end = std::min<size_t>(row_ + schema_->batch_size_, chunk.rows);
+    }
+    Batch *batch = Assemble(row_, end);
+    row_ = end;
+    return batch;
+  }
+  return nullptr;
+}
+
+void ColumnarReader::Close() {
+  buffer_ = RefCountedPtr<Buffer>();
+  columns_.clear();
+  loaded_ = false;
+  rparam_ = nullptr;
+}
+
+Tensor *ColumnarReader::Slice(uint64_t offset, const TensorShape &shape, DataType type) {
+  char *data = (char *)buffer_->begin() + (offset - base_);
+  Buffer *buf = new Buffer(data, shape.NumElements() * SizeOfType(type), buffer_.get());
+  Tensor *tensor = new Tensor(shape, type, buf);
+  buf->UnRef();
+  return tensor;
+}
+
+Tensor *ColumnarReader::Copy(uint64_t offset, size_t rows, size_t width,
+                             size_t padded_rows, DataType type) {
+  Tensor *tensor = new Tensor(dev_, TensorShape({padded_rows, width}), type);
+  size_t row_size = width * SizeOfType(type);
+  char *data = (char *)buffer_->begin() + (offset - base_);
+  memcpy(tensor->Raw<char>(), data, rows * row_size);
+  memset(tensor->Raw<char>() + rows * row_size, 0, (padded_rows - rows) * row_size);
+  return tensor;
+}
+
+void ColumnarReader::Set(Block *blk, Block::Type type, Tensor *tensor) {
+  delete blk->ts_[type];
+  blk->ts_[type] = tensor;
+}
+
+Batch *ColumnarReader::Assemble(size_t begin, size_t end) {
+  auto &chunk = meta_.chunks[chunk_];
+  size_t n = end - begin;
+  size_t padded = schema_->PaddedRows(n);
+  auto rows = [&](uint64_t offset, size_t width, DataType type) {
+    offset += begin * width * SizeOfType(type);
+    return padded == n ? Slice(offset, TensorShape({n, width}), type)
+        : Copy(offset, n, width, padded, type);
+  };
+
+  Batch *batch = BatchPool::Get()->Acquire();
+  batch->ts_count_ = 0;
+  batch->size_ = n;
+  if (chunk.skey_width > 0) {
+    auto blk = batch->GetMutable(kSKeyName);
+    Set(blk, Block::kSBuf, rows(columns_[0].offset, chunk.skey_width, types::kInt8));
+    blk->ts_count_ = 1;
+    batch->ts_count_ += 1;
+  } else {
+    auto blk = batch->GetMutable(kSKeyName);
+    Set(blk, Block::kSBuf, nullptr);
+    batch->blocks().erase(kSKeyName);
+  }
+
+  auto blk = batch->GetMutable(kLabelName);
+  Set(blk, Block::kValue, rows(columns_[1].offset, meta_.label_count, types::kFloat));
+  blk->ts_count_ = 1;
+  batch->ts_count_ += 1;
+
+  for (size_t i = 0; i < opts_.size(); ++i) {
+    auto opt = opts_[i];
+    size_t c = features_[i].first;
+    blk = batch->GetMutable(opt->name());
+    blk->valid_ = true;
+    size_t width = Width(opt);
+    if (opt->type() != kSparse) {
+      Set(blk, Block::kValue, rows(columns_[c].offset, width, types::kFloat));
+      blk->ts_count_ = 1;
+      batch->ts_count_ += 1;
+      continue;
+    }
+
+    const int32_t *segments = (const int32_t *)((char *)buffer_->begin() +
+                                                (columns_[c].offset - base_));
+    size_t lo = begin == 0 ? 0 : segments[begin - 1];
+    size_t hi = segments[end - 1];
+    XDL_CHECK(lo <= hi && hi <= chunk.nnz[features_[i].second])
+        << "bad segments of feature=" << opt->name();
+    if (lo == 0 && padded == n) {
+      Set(blk, Block::kSegment, Slice(columns_[c].offset + begin * sizeof(int32_t),
+                                      TensorShape({n}), types::kInt32));
+    } else {
+      Tensor *segment = new Tensor(dev_, TensorShape({padded}), types::kInt32);
+      int32_t *out = segment->Raw<int32_t>();
+      for (size_t r = 0; r < n; ++r) {
+        out[r] = segments[begin + r] - lo;
+      }
+      for (size_t r = n; r < padded; ++r) {
+        out[r] = hi - lo;
+      }
+      Set(blk, Block::kSegment, segment);
+    }
+
+    size_t nnz = hi - lo;
+    if (opt->serialized()) {
+      Set(blk, Block::kKey, Slice(columns_[c + 1].offset + lo * sizeof(int64_t),
+                                  TensorShape({nnz}), types::kInt64));
+    } else {
+      Set(blk, Block::kKey, Slice(columns_[c + 1].offset + lo * 2 * sizeof(int64_t),
+                                  TensorShape({nnz, 2}), types::kInt64));
+    }
+    if (columns_[c + 2].size > 0) {
+      Set(blk, Block::kValue, Slice(columns_[c + 2].offset + lo * width * sizeof(float),
+                                    TensorShape({nnz, width}), types::kFloat));
+    } else {
+      Set(blk, Block::kValue, nullptr);
+    }
+    blk->ts_count_ = 3;
+    batch->ts_count_ += 3;
+  }
+  return batch;
+}
+
+}  // namespace io
+}  // namespace xdl
@@ -0,0 +1,181 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XDL_CORE_IO_COLUMNAR_H_
+#define XDL_CORE_IO_COLUMNAR_H_
+
+#include "xdl/data_io/batch.h"
+#include "xdl/data_io/schema.h"
+#include "xdl/data_io/parser/parser.h"
+#include "xdl/core/framework/device.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace xdl {
+namespace io {
+
+/* Columnar sample file, the batches point into the file data as it is.
+ *
+ *   magic | chunk ... | footer | u64 footer size | magic
+ *
+ * A chunk holds the columns of its rows, each one kAlign aligned in the
+ * file, in this order:
+ *   skey            int8  [rows, skey_width]    if skey_width > 0
+ *   label           float [rows, label_count]
+ *   for each feature of the footer
+ *     sparse  segment  int32 [rows]             row end offsets, as packed
+ *             key      int64 [nnz] or [nnz, 2]  [nnz] if serialized
+ *             value    float [nnz, nvec]        if has_value
+ *     dense   value    float [rows, nvec]
+ *
+ * The footer is
+ *   u32 version | u32 label_count | u32 nfeature
+ *   for each feature: u32 name size | name | u32 type | u32 nvec | u32 flags
+ *   u64 nchunk
+ *   for each chunk: u64 offset | u32 rows | u32 skey_width
+ *                   | u64 nnz for each sparse feature
+ */
+struct ColumnarMeta {
+  static const char kMagic[8];
+  static const uint32_t kVersion = 1;
+  static const size_t kAlign = 64;
+  enum Flag {
+    kSerialized = 0x1,
+    kHasValue = 0x2,
+  };
+
+  struct Feature {
+    std::string name;
+    uint32_t type;
+    uint32_t nvec;
+    uint32_t flags;
+  };
+
+  struct Chunk {
+    uint64_t offset;
+    uint32_t rows;
+    uint32_t skey_width;
+    std::vector<uint64_t> nnz;
+  };
+
+  struct Column {
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  uint32_t label_count = 0;
+  std::vector<Feature> features;
+  std::vector<Chunk> chunks;
+
+  std::string Encode() const;
+  bool Decode(const char *data, size_t size);
+  /// offsets are in the file, columns of features without values are empty
+  std::vector<Column> Columns(const Chunk &chunk) const;
+  /// end of the chunk in the file
+  uint64_t End(const Chunk &chunk) const;
+
+  static uint64_t Align(uint64_t offset) {
+    return (offset + kAlign - 1) / kAlign * kAlign;
+  }
+};
+
+/// Writes packed batches, one chunk each, without their padding rows.
+class ColumnarWriter {
+ public:
+  ColumnarWriter(IOAnt *ant, const Schema *schema);
+  ~ColumnarWriter();
+
+  bool Write(const Batch *batch);
+  bool Close();
+
+  /// bytes written so far
+  uint64_t size() const { return offset_; }
+  const ColumnarMeta &meta() const { return meta_; }
+
+ private:
+  bool Put(const void *data, size_t size);
+  bool PadTo(uint64_t offset);
+
+  IOAnt *ant_;
+  const Schema *schema_;
+  ColumnarMeta meta_;
+  uint64_t offset_ = 0;
+  bool closed_ = false;
+};
+
+/// Assembles at most batch_size rows of a chunk into a batch, the block
+/// tensors are slices of the chunk, which is mmap'd for local files and
+/// otherwise read a run of the columns of the schema at a time, skipping the
+/// columns of the other features. Only the padding and the segments of a batch
+/// not starting a chunk are copied. Ops and keep sgroup need the sample
+/// groups and aren't supported.
+class ColumnarReader {
+ public:
+  ColumnarReader(const Schema *schema, Device *dev, bool mmap);
+  ~ColumnarReader();
+
+  /// resumes from the first chunk at or after rparam->begin_
+  bool Open(ReadParam *rparam);
+  /// nullptr at the end of the file
+  Batch *Next();
+  void Close();
+  void Shutdown() { running_ = false; }
+  /// reads the chunks of a file in a random order, a file resumed from a
+  /// restored state may then skip or repeat chunks
+  void set_shuffle(bool shuffle) { shuffle_ = shuffle; }
+
+ private:
+  bool ReadMeta();
+  bool LoadChunk();
+  void ReadRange(uint64_t offset, uint64_t size);
+  Batch *Assemble(size_t begin, size_t end);
+  Tensor *Slice(uint64_t offset, const TensorShape &shape, DataType type);
+  Tensor *Copy(uint64_t offset, size_t rows, size_t width, size_t padded_rows,
+               DataType type);
+  void Set(Block *blk, Block::Type type, Tensor *tensor);
+
+  const Schema *schema_;
+  Device *dev_;
+  bool mmap_;
+  bool shuffle_ = false;
+  std::atomic<bool> running_;
+
+  ReadParam *rparam_ = nullptr;
+  ColumnarMeta meta_;
+  /// first column and sparse index of each schema feature
+  std::vector<std::pair<size_t, size_t>> features_;
+  std::vector<const FeatureOption *> opts_;
+  /// the columns read in a chunk, ascending
+  std::vector<size_t> used_;
+
+  /// the mapped file or the current chunk
+  RefCountedPtr<Buffer> buffer_;
+  /// file offset of buffer_
+  uint64_t base_ = 0;
+  size_t chunk_ = 0;
+  /// the chunks to read and the position of chunk_ in them
+  std::vector<size_t> order_;
+  size_t next_ = 0;
+  size_t row_ = 0;
+  bool loaded_ = false;
+  std::vector<ColumnarMeta::Column> columns_;
+};
+
+}  // namespace io
+}  // namespace xdl
+
+#endif  // XDL_CORE_IO_COLUMNAR_H_
@@ -40,9 +40,34 @@ SGroup *ParsePB::Run(const char *str, size_t len) {
   SampleGroup *sg = sgroup->New();
   XDL_CHECK(sg->ParseFromArray(str + sizeof(uint32_t), len - sizeof(uint32_t)))
       << "parse sample group failed, len=" << len;
+  if (schema_->projection_) {
+    Project(sg);
+  }
   sgroup->Reset();
   return sgroup;
 }
 
+void ParsePB::Project(SampleGroup *sg) {
+  for (int t = 0; t < sg->feature_tables_size(); ++t) {
+    auto tab = sg->mutable_feature_tables(t);
+    for (int l = 0; l < tab->feature_lines_size(); ++l) {
+      auto features = tab->mutable_feature_lines(l)->mutable_features();
+      int kept = 0;
+      for (int i = 0; i < features->size(); ++i) {
+        if (!schema_->Projected(features->Get(i).name())) {
+          continue;
+        }
+        if (kept != i) {
+          features->SwapElements(kept, i);
+        }
+        ++kept;
+      }
+      while (features->size() > kept) {
+        features->RemoveLast();
+      }
+    }
+  }
+}
+
 }  // namespace xdl
 }  // namespace io
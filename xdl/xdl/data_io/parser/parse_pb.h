@@ -31,6 +31,9 @@ class ParsePB : public Parse {
   virtual ssize_t GetSize(const char *str, size_t len) override;
 
  protected:
+  /// drops the features out of the schema, parsed with the group as the
+  /// sample proto has no lazy fields
+  void Project(SampleGroup *sg);
 };
 
 }  // namespace io
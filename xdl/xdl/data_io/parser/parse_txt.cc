@@ -16,14 +16,18 @@ limitations under the License.
 #include "xdl/data_io/parser/parse_txt.h"
 
 #include <assert.h>
+#include <algorithm>
 #include <functional>
 
+#include "xdl/data_io/parser/txt_scan.h"
 #include "xdl/data_io/pool.h"
 #include "xdl/core/utils/logging.h"
 
 namespace xdl {
 namespace io {
 
+static const size_t kScanBatch = 256;
+
 int ParseTxt::Tokenize(const char *ptrs[], size_t lens[], const char *str, size_t len, char c, size_t max_count) {
   if (len == 0) {
     return 0;
@@ -50,19 +54,24 @@ int ParseTxt::Tokenize(const char *str, size_t len, char c, size_t max_count, Cl
   if (len == 0) {
     return 0;
   }
-  size_t i;
-  for (i = 0; i < max_count; ++i) {
-    const char *tok = (const char *)memchr(str, c, len);
-    if (tok == nullptr) {
+  /// the delimiters are found a batch at a time
+  uint32_t pos[kScanBatch];
+  size_t i = 0;
+  while (i < max_count) {
+    size_t batch = std::min(kScanBatch, max_count - i);
+    size_t k = FindChars(str, len, c, pos, batch);
+    size_t off = 0;
+    for (size_t j = 0; j < k; ++j, ++i) {
+      closure(str + off, pos[j] - off, i);
+      off = pos[j] + 1;
+      XDL_CHECK(off < len) << "str=" << str << ", c=" << c << ", len=" << len - off;
+    }
+    str += off;
+    len -= off;
+    if (k < batch) {
       closure(str, len, i);
       break;
     }
-    XDL_CHECK(i != max_count);
-    size_t n = tok - str;
-    closure(str, n, i);
-    str = tok+1;
-    len -= n+1;
-    XDL_CHECK(len > 0) << "str=" << str << ", c=" << c << ", len=" << len;
   }
   return i+1;
 }
@@ -147,7 +156,7 @@ SGroup *ParseTxt::Run(const char *str, size_t len) {
 
 inline bool ParseTxt::OnSparse(FeatureValue *fv, const char *s, size_t n) {
   char *end;
-  int64_t k = strtol(s, &end, 10);
+  int64_t k = ParseInt64(s, &end);
   if (end - s == n) {
     fv->set_key(k);
     fv->set_value(1);
@@ -156,7 +165,7 @@ inline bool ParseTxt::OnSparse(FeatureValue *fv, const char *s, size_t n) {
     return false;
   }
   fv->set_key(k);
-  float v = strtof(end+1, &end);
+  float v = ParseFloat(end+1, &end);
   if (end - s != n) {
     return false;
   }
@@ -166,7 +175,7 @@ inline bool ParseTxt::OnSparse(FeatureValue *fv, const char *s, size_t n) {
 
 inline bool ParseTxt::OnDense(FeatureValue *fv, const char *s, size_t n) {
   char *end;
-  float v = strtof(s, &end);
+  float v = ParseFloat(s, &end);
   if (end - s != n) {
     return false;
   }
@@ -179,6 +188,11 @@ inline bool ParseTxt::OnDense(FeatureValue *fv, const char *s, size_t n) {
 bool ParseTxt::OnFeatureLine(FeatureLine *fl, const char *str, size_t len, FeatureType type) {
   size_t n = Tokenize(str, len, kFEA, MAX_NUM_FEA,
                       [this, &fl, type](const char *s, size_t n, size_t i) mutable {
+                        /// the features out of the schema aren't tokenized
+                        const char *tok = (const char *)memchr(s, kNAM, n);
+                        if (tok != nullptr && !schema_->Projected(s, tok - s)) {
+                          return;
+                        }
                         Feature *f = fl->add_features();
                         this->OnFeature(f, s, n, type);
                       });
@@ -191,7 +205,7 @@ bool ParseTxt::OnLabel(Label *l, const char *str, size_t len) {
   size_t n = Tokenize(str, len, kVAL, MAX_NUM_LAB,
                       [this, &l](const char *s, size_t n, size_t i) mutable {
                         char *end;
-                        float v = strtof(s, &end);
+                        float v = ParseFloat(s, &end);
                         XDL_CHECK(end == s + n);
                         l->add_values(v);
                       });
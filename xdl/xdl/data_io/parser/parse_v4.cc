@@ -40,9 +40,11 @@ bool ParseV4::InitMeta(const std::string &contents) {
       XDL_LOG(FATAL) << "unknown meta type=" << bm.data_block_type();
     }
     XDL_CHECK(bm.feature_group_meta_size() > 0);
+    auto &projected = bm.data_block_type() == v4::kNCommonFeature ? ncomm_projected_ : comm_projected_;
     for (int j = 0; j < bm.feature_group_meta_size(); ++j) {
       auto &fgm = bm.feature_group_meta(j);
       fea->push_back(fgm.feature_group_name());
+      projected.push_back(schema_->Projected(fgm.feature_group_name()));
     }
   }
 
@@ -134,11 +136,14 @@ bool ParseV4::OnSKey(const v4::DataBlock &block, SampleGroup *sg) {
 
 bool ParseV4::OnTable(const v4::DataBlock &block, FeatureTable *tab) {
   std::vector<std::string> *names = nullptr;
+  std::vector<bool> *projected = nullptr;
   if (block.data_block_type() == v4::kNCommonFeature) {
     names = &ncomm_;
+    projected = &ncomm_projected_;
   } else if (block.data_block_type() == v4::kCommonFeature) {
     XDL_CHECK(block.feature_block_size() == 1);
     names = &comm_;
+    projected = &comm_projected_;
   }
 
   for (int i = 0; i < block.feature_block_size(); ++i) {
@@ -146,10 +151,13 @@ bool ParseV4::OnTable(const v4::DataBlock &block, FeatureTable *tab) {
     auto fl_ = tab->add_feature_lines();
     for (int j = 0; j < fb.feature_group_size(); ++j) {
       auto &fg = fb.feature_group(j);
-      auto fg_ = fl_->add_features();
-      fg_->set_type(kSparse);
       unsigned fi = fg.feature_index();
       XDL_CHECK(fi < names->size());
+      if (!projected->at(fi)) {
+        continue;
+      }
+      auto fg_ = fl_->add_features();
+      fg_->set_type(kSparse);
       fg_->set_name(names->at(fi));
       for (int k = 0; k < fg.kv_feature_size(); ++k) {
         auto &kv = fg.kv_feature(k);
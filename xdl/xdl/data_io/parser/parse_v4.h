@@ -36,6 +36,9 @@ class ParseV4 : public Parse {
   v4::SampleMeta meta_;
   std::vector<std::string> ncomm_;
   std::vector<std::string> comm_;
+  /// if the schema uses the feature of each index
+  std::vector<bool> ncomm_projected_;
+  std::vector<bool> comm_projected_;
 
   bool OnLabel(const v4::DataBlock &block, SampleGroup *sg);
   bool OnSKey(const v4::DataBlock &block, SampleGroup *sg);
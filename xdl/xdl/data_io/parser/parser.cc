@@ -132,6 +132,24 @@ again:
 
   XDL_CHECK(size > 0) << "size=" << size;
 
+  if (rparam_->skip_) {
+    /// the end of the record the range starts in, the previous range reads it
+    rparam_->skip_ = false;
+    rparam_->parsed_ += size;
+    begin_ += size;
+    goto again;
+  }
+
+  if (rparam_->limit_ != 0 && rparam_->parsed_ >= rparam_->limit_) {
+    XDL_LOG(DEBUG) << "rparam range over, path=" << rparam_->path_
+        << " limit=" << rparam_->limit_ << " parsed=" << rparam_->parsed_;
+    SGroup *sgroup = parse_->Run(nullptr, 0);
+    if (sgroup == nullptr) {
+      return (SGroup *)END;
+    }
+    return sgroup;
+  }
+
   rparam_->parsed_ += size;
   SGroup *sgroup = parse_->Run(buf_+begin_, size);
   XDL_LOG(DEBUG) << "Run=" << sgroup << " begin=" << begin_ << " end=" << end_ << std::endl;
@@ -35,6 +35,10 @@ struct ReadParam {
   size_t begin_ = 0;
   size_t parsed_ = 0;
   size_t end_ = 0;
+  /// records starting at or after limit_ belong to the next range, 0 for none
+  size_t limit_ = 0;
+  /// the read starts in a record of the previous range, to skip
+  bool skip_ = false;
   unsigned epoch_ = 0;
   unsigned pathid_ = 0;
   const char *path_ = nullptr;
@@ -44,6 +48,7 @@ struct ReadParam {
     std::stringstream ss;
     ss << " begin=" << std::to_string(begin_)
        << " end=" << std::to_string(end_)
+       << " limit=" << std::to_string(limit_)
        << " parsed=" << std::to_string(parsed_)
        << " epoch=" << std::to_string(epoch_)
        << " path=" << path_
@@ -0,0 +1,120 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/data_io/parser/txt_scan.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace xdl {
+namespace io {
+
+namespace {
+
+typedef size_t (*FindCharsFn)(const char *, size_t, char, uint32_t *, size_t);
+
+FindCharsFn DetectFindChars() {
+  if (getenv("XDL_TXT_DISABLE_SIMD") != nullptr) {
+    return FindCharsScalar;
+  }
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? FindCharsAvx2 : FindCharsScalar;
+}
+
+inline bool IsDigit(char c) {
+  return (unsigned)(c - '0') < 10;
+}
+
+/// exact in float, so is a single division by them
+const float kPow10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+const int kMaxFrac = 10;
+const uint64_t kMaxExactMantissa = 1 << 24;
+const int kMaxDigits = 18;
+
+}  // namespace
+
+size_t FindChars(const char *str, size_t len, char c, uint32_t *pos, size_t max) {
+  static const FindCharsFn fn = DetectFindChars();
+  return fn(str, len, c, pos, max);
+}
+
+size_t FindCharsScalar(const char *str, size_t len, char c, uint32_t *pos, size_t max) {
+  size_t k = 0;
+  const char *p = str, *end = str + len;
+  while (k < max && p < end) {
+    p = (const char *)memchr(p, c, end - p);
+    if (p == nullptr) {
+      break;
+    }
+    pos[k++] = p - str;
+    ++p;
+  }
+  return k;
+}
+
+int64_t ParseInt64(const char *s, char **end) {
+  const char *p = s;
+  bool neg = *p == '-';
+  if (*p == '-' || *p == '+') {
+    ++p;
+  }
+  uint64_t v = 0;
+  const char *digits = p;
+  while (IsDigit(*p)) {
+    v = v * 10 + (*p - '0');
+    ++p;
+  }
+  if (p == digits || p - digits > kMaxDigits) {
+    return strtol(s, end, 10);
+  }
+  *end = (char *)p;
+  return neg ? -(int64_t)v : (int64_t)v;
+}
+
+float ParseFloat(const char *s, char **end) {
+  const char *p = s;
+  bool neg = *p == '-';
+  if (*p == '-' || *p == '+') {
+    ++p;
+  }
+  uint64_t m = 0;
+  int ndigit = 0, nfrac = 0;
+  while (IsDigit(*p) && ndigit <= kMaxDigits) {
+    m = m * 10 + (*p - '0');
+    ++p;
+    ++ndigit;
+  }
+  if (*p == '.') {
+    ++p;
+    while (IsDigit(*p) && ndigit <= kMaxDigits) {
+      m = m * 10 + (*p - '0');
+      ++p;
+      ++ndigit;
+      ++nfrac;
+    }
+  }
+  /// exponents, hex, long or inexact mantissas go to strtof
+  if (ndigit == 0 || ndigit > kMaxDigits || nfrac > kMaxFrac ||
+      m > kMaxExactMantissa || IsDigit(*p) || *p == 'e' || *p == 'E' ||
+      *p == 'x' || *p == 'X') {
+    return strtof(s, end);
+  }
+  *end = (char *)p;
+  float v = (float)m / kPow10[nfrac];
+  return neg ? -v : v;
+}
+
+}  // namespace io
+}  // namespace xdl
@@ -0,0 +1,40 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XDL_CORE_IO_TXT_SCAN_H_
+#define XDL_CORE_IO_TXT_SCAN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace xdl {
+namespace io {
+
+/// Offsets of the first (at most) max bytes c in str[0, len), returns how
+/// many were found. Uses avx2 when the cpu has it, unless
+/// XDL_TXT_DISABLE_SIMD is set.
+size_t FindChars(const char *str, size_t len, char c, uint32_t *pos, size_t max);
+size_t FindCharsScalar(const char *str, size_t len, char c, uint32_t *pos, size_t max);
+size_t FindCharsAvx2(const char *str, size_t len, char c, uint32_t *pos, size_t max);
+
+/// Same results and end as strtol(s, end, 10) and strtof(s, end), plain
+/// decimals are parsed inline and the rest falls back to them.
+int64_t ParseInt64(const char *s, char **end);
+float ParseFloat(const char *s, char **end);
+
+}  // namespace io
+}  // namespace xdl
+
+#endif  // XDL_CORE_IO_TXT_SCAN_H_
@@ -0,0 +1,45 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Compiled with -mavx2, only called after a runtime cpu check.
+
+#include "xdl/data_io/parser/txt_scan.h"
+
+#include <immintrin.h>
+
+namespace xdl {
+namespace io {
+
+size_t FindCharsAvx2(const char *str, size_t len, char c, uint32_t *pos, size_t max) {
+  size_t k = 0, i = 0;
+  const __m256i needle = _mm256_set1_epi8(c);
+  for (; i + 32 <= len && k < max; i += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)(str + i));
+    uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+    while (mask != 0 && k < max) {
+      pos[k++] = i + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  for (; i < len && k < max; ++i) {
+    if (str[i] == c) {
+      pos[k++] = i;
+    }
+  }
+  return k;
+}
+
+}  // namespace io
+}  // namespace xdl
@@ -26,6 +26,13 @@ namespace xdl {
 namespace io {
 
 class SGroupPool: public ObjectPool<SGroup>, public Singleton<SGroupPool> {
+ public:
+  using ObjectPool<SGroup>::Release;
+  /// the arena of the sample group is reset right away
+  void Release(SGroup *sgroup) override {
+    sgroup->Clear();
+    ObjectPool<SGroup>::Release(sgroup);
+  }
 };
 
 class BatchPool: public ObjectPool<Batch>, public Singleton<BatchPool> {
@@ -16,19 +16,31 @@ limitations under the License.
 #include "xdl/data_io/scheduler.h"
 #include "xdl/core/utils/logging.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 namespace xdl {
 namespace io {
 
+namespace {
+
+size_t LookaheadFiles() {
+  const char *env = getenv("XDL_IO_PREFETCH_FILES");
+  return env == nullptr ? 1 : strtoul(env, nullptr, 10);
+}
+
+}  // namespace
+
 Scheduler::Scheduler(FileSystem *fs, size_t epochs) 
-    : epochs_(epochs), finished_(true), rparams_(kSchedCap) {
+    : epochs_(epochs), finished_(true),
+      lookahead_(LookaheadFiles()), rparams_(kSchedCap) {
   XDL_CHECK(fs != nullptr);
   fs_ = fs;
 }
 
 Scheduler::Scheduler(FSType fs_type, const std::string &namenode, size_t epochs)
-    : epochs_(epochs), finished_(true), rparams_(kSchedCap) {
+    : epochs_(epochs), finished_(true),
+      lookahead_(LookaheadFiles()), rparams_(kSchedCap) {
   fs_ = GetFileSystem(fs_type, namenode.empty()?nullptr:namenode.c_str());
 }
 
@@ -125,12 +137,9 @@ ReadParam *Scheduler::Acquire() {
     finished_ = true;
     return nullptr;
   }
-  if (rparam->ant_ == nullptr) {
-    rparam->ant_ = fs_->GetZAnt(rparam->path_, ztype_);
-    rparam->ant_->Seek(rparam->begin_);
-  }
+  Open(rparam);
   if (rparam->end_ == 0) {
-    if (ztype_ == kZLib) {
+    if (ztype_ == kZLib || ztype_ == kBgzf) {
       rparam->end_ = ULONG_MAX;
     } else {
       rparam->end_ = fs_->Size(rparam->path_);
@@ -138,12 +147,35 @@ ReadParam *Scheduler::Acquire() {
     XDL_CHECK(rparam->end_ > rparam->begin_);
   }
 
-  std::unique_lock<std::mutex> lck(mutex_);
-  using_.insert(rparam);
-  XDL_LOG(DEBUG) << "acquire " << rparam->DebugString();
+  {
+    std::unique_lock<std::mutex> lck(mutex_);
+    using_.insert(rparam);
+    XDL_LOG(DEBUG) << "acquire " << rparam->DebugString();
+  }
+  Lookahead();
   return rparam;
 }
 
+void Scheduler::Open(ReadParam *rparam) {
+  if (rparam->ant_ == nullptr) {
+    rparam->ant_ = fs_->GetZAnt(rparam->path_, ztype_);
+    rparam->ant_->Seek(rparam->begin_);
+  }
+}
+
+void Scheduler::Lookahead() {
+  if (lookahead_ == 0) {
+    return;
+  }
+  // with the queue locked, the rparams can't be acquired meanwhile
+  rparams_.Travel([this](ReadParam *rparam, size_t i) {
+                  if (rparam != nullptr && i < lookahead_) {
+                    Open(rparam);
+                    rparam->ant_->Prefetch();
+                  }
+                  });
+}
+
 void Scheduler::Release(ReadParam *rparam) {
   XDL_LOG(DEBUG) << "release " << rparam->DebugString();
   XDL_CHECK(rparam != nullptr);
@@ -183,7 +215,8 @@ bool Scheduler::Store(DSState *ds_state) {
   ds_state->set_epochs(epochs_);
   for (auto &rparam : using_) {
     auto state = ds_state->add_states();
-    state->set_begin(rparam->parsed_);
+    state->set_begin(rparam->ant_ != nullptr ? rparam->ant_->Position(rparam->parsed_)
+                     : rparam->parsed_);
     state->set_end(rparam->end_);
     state->set_epoch(rparam->epoch_);
     state->set_pathid(rparam->pathid_);
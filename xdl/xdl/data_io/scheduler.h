@@ -42,6 +42,9 @@ class Scheduler {
   virtual bool SetEpochs(size_t epochs);
   virtual bool SetZType(ZType ztype);
   virtual bool SetShuffle(bool shuffle);
+  /// reads files larger than split_size in ranges of about that size, for
+  /// formats finding the end of a record from any of its bytes
+  virtual bool SetSplit(size_t split_size) { return false; }
 
   virtual bool Store(DSState *ds_state);
   virtual bool Restore(const DSState &ds_state);
@@ -52,6 +55,11 @@ class Scheduler {
   virtual bool finished() const;
   virtual void Clear();
  protected:
+  /// opens the ant of rparam if not yet, seeked to begin_
+  void Open(ReadParam *rparam);
+  /// starts reading the next lookahead_ files of the queue
+  void Lookahead();
+
   bool restored_ = false;
   bool shuffle_ = false;
   size_t epochs_ = 1;
@@ -60,6 +68,8 @@ class Scheduler {
   std::vector<std::string> paths_;
 
   std::atomic<bool> finished_;
+  /// XDL_IO_PREFETCH_FILES, 1 by default
+  size_t lookahead_;
   std::mutex mutex_;
   std::set<ReadParam *> using_;
   BlockingQueue<ReadParam *> rparams_;
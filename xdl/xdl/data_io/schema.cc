@@ -14,6 +14,9 @@ limitations under the License.
 ==============================================================================*/
 
 #include "xdl/data_io/schema.h"
+
+#include <algorithm>
+
 #include "xdl/core/utils/logging.h"
 
 namespace xdl {
@@ -30,6 +33,31 @@ const FeatureOption *Schema::Get(const std::string &name, int table) const {
   return it == feature_table_[table].end() ? nullptr : it->second;
 }
 
+bool Schema::Projected(const char *name, size_t len) const {
+  if (!projection_) {
+    return true;
+  }
+  /// keeps the lookup from allocating once warm
+  static thread_local std::string key;
+  key.assign(name, len);
+  return feature_opts_.find(key) != feature_opts_.end();
+}
+
+bool Schema::Projected(const std::string &name) const {
+  return !projection_ || feature_opts_.find(name) != feature_opts_.end();
+}
+
+size_t Schema::PaddedRows(size_t n) const {
+  if (!padding_ || n >= batch_size_) {
+    return n;
+  }
+  if (pad_multiple_ == 0) {
+    return batch_size_;
+  }
+  size_t rows = (n + pad_multiple_ - 1) / pad_multiple_ * pad_multiple_;
+  return std::min(rows, batch_size_);
+}
+
 bool Schema::Add(const FeatureOption *opt) {
   auto it = feature_opts_.find(opt->name());
   XDL_CHECK(it == feature_opts_.end()) << opt->name() <<  " existed"; 
@@ -20,6 +20,7 @@ limitations under the License.
 #include "xdl/core/lib/singleton.h"
 
 #include <map>
+#include <string>
 
 namespace xdl {
 namespace io {
@@ -37,6 +38,14 @@ class Schema {
   const FeatureOption *Get(const std::string &name, int table) const;
 
   bool Add(const FeatureOption *option);
+
+  /// if the parsers keep the feature of name, all of them without projection
+  bool Projected(const char *name, size_t len) const;
+  bool Projected(const std::string &name) const;
+
+  /// the rows of a batch of n samples, n without padding, else batch size
+  /// or n rounded up to pad multiple, the padding rows at the end
+  size_t PaddedRows(size_t n) const;
   
   const FeatureOptionMap &feature_opts() const;
   const std::vector<FeatureOptionMap> &feature_table() const;
@@ -49,8 +58,18 @@ class Schema {
   size_t label_count_ = 1;
   bool keep_sgroup_ = false;
   bool keep_skey_ = false;
+  /// pack the sample keys as their int64 hash, see PackSKey::Hash
+  bool skey_hash_ = false;
+  /// the local file the hash and key of each sample key packed are appended
+  /// to, none if empty
+  std::string skey_dict_;
   bool padding_ = true;
+  /// pad the batches to a multiple of it only, 0 to the batch size
+  size_t pad_multiple_ = 0;
   bool split_group_ = true;
+  /// the parsers skip the features not in the schema, set by DataIO when no
+  /// op or kept sgroup reads them
+  bool projection_ = false;
  protected:
   FeatureOptionMap feature_opts_;
   std::vector<FeatureOptionMap> feature_table_;
@@ -16,18 +16,55 @@ limitations under the License.
 #include "xdl/data_io/sgroup.h"
 #include "xdl/data_io/pool.h"
 
+#include <memory>
+#include <type_traits>
+
 #include "xdl/core/utils/logging.h"
 
 namespace xdl {
 namespace io {
 
+namespace {
+
+/// a steady state sample group fits in the first block, so reusing the
+/// sgroup doesn't allocate
+const size_t kArenaBlockSize = 64 * 1024;
+
+google::protobuf::ArenaOptions ArenaOptions(char *block) {
+  google::protobuf::ArenaOptions options;
+  options.initial_block = block;
+  options.initial_block_size = kArenaBlockSize;
+  return options;
+}
+
+/// the repeated fields go to the arena too when sample.proto enables arenas
+template <typename T>
+T *CreateMessage(google::protobuf::Arena *arena, std::true_type) {
+  return google::protobuf::Arena::CreateMessage<T>(arena);
+}
+
+template <typename T>
+T *CreateMessage(google::protobuf::Arena *arena, std::false_type) {
+  return google::protobuf::Arena::Create<T>(arena);
+}
+
+}  // namespace
+
+struct SGroup::Storage {
+  Storage() : block(new char[kArenaBlockSize]), arena(ArenaOptions(block.get())) {}
+  std::unique_ptr<char[]> block;
+  google::protobuf::Arena arena;
+};
+
 SGroup::SGroup() {
 }
 
+SGroup::~SGroup() {
+  Clear();
+  delete storage_;
+}
+
 SGroup::SGroup(const SGroup &sgroup) {
-  if (sg_ != nullptr && own_) {
-    delete sg_;
-  }
   own_ = false;
   sg_ = sgroup.sg_;
   size_ = sgroup.size_;
@@ -36,10 +73,11 @@ SGroup::SGroup(const SGroup &sgroup) {
 }
 
 void SGroup::CloneTail(SGroup *sgroup, int end) {
-  if (sg_ != nullptr && own_) {
-    delete sg_;
-  }
+  Clear();
+  Storage *storage = storage_;
   *this = *sgroup;
+  /// the owner keeps the storage of the sample group
+  sgroup->storage_ = storage;
   sgroup->own_ = false;
   Reset(sgroup->end_, end==0?sgroup->size_:end);
 }
@@ -64,14 +102,25 @@ bool SGroup::Reuse() {
 }
 
 SampleGroup *SGroup::New() {
-  if (sg_ != nullptr && own_) {
-    delete sg_;
+  Clear();
+  if (storage_ == nullptr) {
+    storage_ = new Storage();
   }
-  sg_ = new SampleGroup();
+  sg_ = CreateMessage<SampleGroup>(
+      &storage_->arena,
+      google::protobuf::Arena::is_arena_constructable<SampleGroup>());
   own_ = true;
   return sg_;
 }
 
+void SGroup::Clear() {
+  if (sg_ != nullptr && own_) {
+    storage_->arena.Reset();
+  }
+  sg_ = nullptr;
+  own_ = false;
+}
+
 SampleGroup *SGroup::Get() {
   XDL_CHECK(sg_ != nullptr);
   return sg_;
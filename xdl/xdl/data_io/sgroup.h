@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef XDL_IO_DATA_SGROUP_H_
 #define XDL_IO_DATA_SGROUP_H_
 
+#include <google/protobuf/arena.h>
+
 #include "xdl/proto/sample.pb.h"
 
 namespace xdl {
@@ -24,6 +26,7 @@ namespace io {
 class SGroup {
  public:
   SGroup();
+  ~SGroup();
   SampleGroup *Get();
   const SampleGroup *Get() const;
   SampleGroup *New();
@@ -33,13 +36,19 @@ class SGroup {
   void CloneTail(SGroup *sg, int end=0);
 
   bool Reuse();
+  /// frees the sample group if it's owned, on release to the pool
+  void Clear();
 
   int size_ = 0;
   int begin_ = 0;
   int end_ = 0;
   int own_ = false;
  private:
-  SampleGroup *sg_;
+  /// the owned sample group is allocated in it, it moves with the sample
+  /// group on CloneTail
+  struct Storage;
+  Storage *storage_ = nullptr;
+  SampleGroup *sg_ = nullptr;
   SGroup(const SGroup &sgroup);
 };
 
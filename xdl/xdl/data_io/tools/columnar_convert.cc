@@ -0,0 +1,372 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+/* Converts txt/pb/v4 samples to columnar files, see ColumnarReader.
+ *
+ *   columnar_convert --parser=v4 --meta=<meta> --features=a:sparse,b:dense:4
+ *       --output=<dir> [--threads=8] [--rows_per_file=1000000] ... <input> ...
+ *
+ * Each thread parses the inputs it takes from the scheduler, buffers their
+ * sample groups up to rows_per_file rows, sorts them by sample key and
+ * packs them without padding into the chunks of one output file, so many
+ * small inputs are compacted into a few files. part-<thread>-<n>.col.stats
+ * holds the statistics of each file, the distinct keys tell how much the
+ * unique merger saves on it.
+ */
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "xdl/data_io/constant.h"
+#include "xdl/data_io/pool.h"
+#include "xdl/data_io/scheduler.h"
+#include "xdl/data_io/packer/packer.h"
+#include "xdl/data_io/parser/columnar.h"
+#include "xdl/data_io/parser/parser.h"
+#include "xdl/core/framework/cpu_device.h"
+#include "xdl/core/utils/logging.h"
+
+namespace xdl {
+namespace io {
+namespace {
+
+struct Options {
+  ParserType parser_type = kPB;
+  FSType fs_type = kLocal;
+  std::string namenode;
+  std::string meta;
+  std::string features;
+  std::string output;
+  size_t label_count = 2;
+  size_t threads = 8;
+  size_t rows_per_chunk = 1024;
+  size_t rows_per_file = 1 << 20;
+  bool keep_skey = false;
+  bool sort = true;
+  std::vector<std::string> inputs;
+};
+
+std::vector<std::string> Split(const std::string &str, char sep) {
+  std::vector<std::string> ret;
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, sep)) {
+    if (!item.empty()) {
+      ret.push_back(item);
+    }
+  }
+  return ret;
+}
+
+/// name:sparse[:nvec][:serialized] or name:dense:nvec, comma separated
+void AddFeatures(const std::string &spec, Schema *schema) {
+  for (auto &item : Split(spec, ',')) {
+    auto fields = Split(item, ':');
+    XDL_CHECK(fields.size() >= 2) << "invalid feature " << item;
+    FeatureOption *opt = new FeatureOption();
+    opt->set_name(fields[0]);
+    opt->set_table(0);
+    if (fields[1] == "sparse") {
+      opt->set_type(kSparse);
+    } else {
+      XDL_CHECK(fields[1] == "dense") << "invalid feature type " << item;
+      opt->set_type(kDense);
+    }
+    for (size_t i = 2; i < fields.size(); ++i) {
+      if (fields[i] == "serialized") {
+        opt->set_serialized(true);
+      } else {
+        opt->set_nvec(std::stoi(fields[i]));
+      }
+    }
+    XDL_CHECK(opt->type() == kSparse || opt->nvec() > 0) << "dense nvec " << item;
+    schema->Add(opt);
+  }
+}
+
+class Converter {
+ public:
+  Converter(const Options &options, const Schema *schema, Scheduler *sched,
+            FileSystem *fs, const std::string &meta, size_t tid)
+      : options_(options), schema_(schema), sched_(sched), fs_(fs),
+        tid_(tid), packer_(schema, new CpuDevice()),
+        parser_(new Parser(options.parser_type, schema)) {
+    XDL_CHECK(parser_->InitMeta(meta));
+  }
+
+  void Run() {
+    while (true) {
+      ReadParam *rparam = sched_->Acquire();
+      if (rparam == nullptr) {
+        break;
+      }
+      parser_->Init(rparam);
+      while (true) {
+        SGroup *sgroup = parser_->Run();
+        if (sgroup == END) {
+          break;
+        }
+        XDL_CHECK(sgroup != nullptr);
+        XDL_CHECK(sgroup->Get()->feature_tables_size() <= 1)
+            << "columnar file only holds table 0, path=" << rparam->path_;
+        sgroups_.push_back(sgroup);
+        rows_ += sgroup->end_ - sgroup->begin_;
+        if (rows_ >= options_.rows_per_file) {
+          Flush();
+        }
+      }
+      sched_->Release(rparam);
+    }
+    Flush();
+  }
+
+ private:
+  struct FeatureStat {
+    uint64_t nnz = 0;
+    std::unordered_set<int64_t> keys;
+  };
+
+  static const std::string &SKey(const SGroup *sgroup) {
+    static const std::string empty;
+    auto sg = sgroup->Get();
+    return sg->sample_ids_size() > sgroup->begin_ ? sg->sample_ids(sgroup->begin_) : empty;
+  }
+
+  void Flush() {
+    if (sgroups_.empty()) {
+      return;
+    }
+    if (options_.sort) {
+      std::stable_sort(sgroups_.begin(), sgroups_.end(),
+                       [](const SGroup *lhs, const SGroup *rhs) {
+                         return SKey(lhs) < SKey(rhs);
+                       });
+    }
+
+    std::string path = options_.output + "/part-" + std::to_string(tid_) +
+        "-" + std::to_string(files_++) + ".col";
+    std::unique_ptr<IOAnt> ant(fs_->GetAnt(path.c_str(), 'w'));
+    XDL_CHECK(ant != nullptr) << "open " << path << " failed";
+    ColumnarWriter writer(ant.get(), schema_);
+    stats_.clear();
+    for (auto sgroup : sgroups_) {
+      for (auto batch : packer_.Run(sgroup)) {
+        Write(&writer, batch, path);
+      }
+    }
+    for (auto batch : packer_.Run((SGroup *)END)) {
+      Write(&writer, batch, path);
+    }
+    XDL_CHECK(writer.Close()) << "write " << path << " failed";
+    ant.reset();
+
+    fs_->Write(path + ".stats", Stats(writer));
+    XDL_LOG(INFO) << "converted " << path << " rows=" << rows_
+        << " bytes=" << writer.size();
+    sgroups_.clear();
+    rows_ = 0;
+  }
+
+  void Write(ColumnarWriter *writer, Batch *batch, const std::string &path) {
+    if (batch == nullptr || batch == END) {
+      return;
+    }
+    XDL_CHECK(writer->Write(batch)) << "write " << path << " failed";
+    for (auto &it : schema_->feature_opts()) {
+      auto opt = it.second;
+      if (opt->type() != kSparse) {
+        continue;
+      }
+      auto key = batch->GetTensor(opt->name(), Block::kKey);
+      auto &stat = stats_[opt->name()];
+      size_t nnz = key->Shape()[0];
+      stat.nnz += nnz;
+      const int64_t *keys = key->Raw<int64_t>();
+      for (size_t i = 0; i < nnz; ++i) {
+        stat.keys.insert(opt->serialized() ? keys[i]
+                         : (keys[2 * i] * 1000003) ^ keys[2 * i + 1]);
+      }
+    }
+    batch->Reuse();
+  }
+
+  std::string Stats(const ColumnarWriter &writer) {
+    auto &meta = writer.meta();
+    std::stringstream ss;
+    ss << "rows " << rows_ << "\n"
+       << "chunks " << meta.chunks.size() << "\n"
+       << "bytes " << writer.size() << "\n"
+       << "label_count " << meta.label_count << "\n";
+    for (auto &f : meta.features) {
+      ss << "feature " << f.name << " " << (f.type == kSparse ? "sparse" : "dense")
+         << " nvec=" << f.nvec;
+      auto it = stats_.find(f.name);
+      if (it != stats_.end()) {
+        ss << " nnz=" << it->second.nnz << " distinct=" << it->second.keys.size();
+      }
+      ss << "\n";
+    }
+    return ss.str();
+  }
+
+  const Options &options_;
+  const Schema *schema_;
+  Scheduler *sched_;
+  FileSystem *fs_;
+  size_t tid_;
+  Packer packer_;
+  /// holds a large read buffer, so it's on the heap
+  std::unique_ptr<Parser> parser_;
+
+  std::vector<SGroup *> sgroups_;
+  size_t rows_ = 0;
+  size_t files_ = 0;
+  std::map<std::string, FeatureStat> stats_;
+};
+
+void Usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s --parser=pb|txt|v4|spb --features=<spec> --output=<dir>\n"
+          "    [--meta=<path>] [--fs=local|hdfs] [--namenode=<addr>]\n"
+          "    [--label_count=2] [--threads=8] [--rows_per_chunk=1024]\n"
+          "    [--rows_per_file=1048576] [--keep_skey] [--no_sort] <input> ...\n"
+          "  features: name:sparse[:nvec][:serialized] or name:dense:nvec, comma separated\n",
+          name);
+}
+
+bool ParseOptions(int argc, char **argv, Options *options) {
+  static struct option long_options[] = {
+    {"parser", required_argument, nullptr, 'p'},
+    {"fs", required_argument, nullptr, 'f'},
+    {"namenode", required_argument, nullptr, 'n'},
+    {"meta", required_argument, nullptr, 'm'},
+    {"features", required_argument, nullptr, 'F'},
+    {"output", required_argument, nullptr, 'o'},
+    {"label_count", required_argument, nullptr, 'l'},
+    {"threads", required_argument, nullptr, 't'},
+    {"rows_per_chunk", required_argument, nullptr, 'c'},
+    {"rows_per_file", required_argument, nullptr, 'r'},
+    {"keep_skey", no_argument, nullptr, 'k'},
+    {"no_sort", no_argument, nullptr, 's'},
+    {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "", long_options, nullptr)) != -1) {
+    std::string arg = optarg == nullptr ? "" : optarg;
+    switch (c) {
+     case 'p':
+      if (arg == "pb") {
+        options->parser_type = kPB;
+      } else if (arg == "txt") {
+        options->parser_type = kTxt;
+      } else if (arg == "v4") {
+        options->parser_type = kV4;
+      } else if (arg == "spb") {
+        options->parser_type = kSPB;
+      } else {
+        return false;
+      }
+      break;
+     case 'f':
+      if (arg == "local") {
+        options->fs_type = kLocal;
+      } else if (arg == "hdfs") {
+        options->fs_type = kHdfs;
+      } else {
+        return false;
+      }
+      break;
+     case 'n': options->namenode = arg; break;
+     case 'm': options->meta = arg; break;
+     case 'F': options->features = arg; break;
+     case 'o': options->output = arg; break;
+     case 'l': options->label_count = std::stoul(arg); break;
+     case 't': options->threads = std::stoul(arg); break;
+     case 'c': options->rows_per_chunk = std::stoul(arg); break;
+     case 'r': options->rows_per_file = std::stoul(arg); break;
+     case 'k': options->keep_skey = true; break;
+     case 's': options->sort = false; break;
+     default: return false;
+    }
+  }
+  for (int i = optind; i < argc; ++i) {
+    options->inputs.push_back(argv[i]);
+  }
+  return !options->features.empty() && !options->output.empty() &&
+      !options->inputs.empty() && options->threads > 0 &&
+      options->rows_per_chunk > 0 && options->rows_per_file > 0;
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace xdl
+
+int main(int argc, char **argv) {
+  using namespace xdl::io;
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  Schema schema;
+  AddFeatures(options.features, &schema);
+  schema.label_count_ = options.label_count;
+  schema.batch_size_ = options.rows_per_chunk;
+  schema.padding_ = false;
+  schema.split_group_ = true;
+  schema.keep_skey_ = options.keep_skey;
+
+  FileSystem *fs = GetFileSystem(options.fs_type, options.namenode.empty() ?
+                                 nullptr : options.namenode.c_str());
+  std::string meta = options.meta.empty() ? "" : fs->Read(options.meta);
+  Scheduler sched(fs, 1);
+  for (auto &input : options.inputs) {
+    if (fs->IsDir(input.c_str())) {
+      for (auto &name : fs->Dir(input.c_str())) {
+        if (name.empty() || name[0] == '.') {
+          continue;
+        }
+        /// the local fs lists the names only
+        sched.AddPath(name.find('/') == std::string::npos ? input + "/" + name : name);
+      }
+    } else {
+      sched.AddPath(input);
+    }
+  }
+  sched.Schedule();
+
+  std::vector<std::unique_ptr<Converter>> converters;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < options.threads; ++i) {
+    converters.emplace_back(new Converter(options, &schema, &sched, fs, meta, i));
+  }
+  for (auto &converter : converters) {
+    Converter *c = converter.get();
+    threads.emplace_back([c]() { c->Run(); });
+  }
+  for (auto &th : threads) {
+    th.join();
+  }
+  return 0;
+}
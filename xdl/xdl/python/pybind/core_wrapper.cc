@@ -22,6 +22,7 @@ limitations under the License.
 
 #include "xdl/core/lib/status.h"
 #include "xdl/core/framework/tensor.h"
+#include "xdl/core/framework/caching_allocator.h"
 
 #define ONE_ARG(...) __VA_ARGS__
 PYBIND11_MAKE_OPAQUE(ONE_ARG(std::unordered_map<std::string, std::string>));
@@ -81,6 +82,9 @@ void CorePybind(pybind11::module& m) {
 
   pybind11::bind_map<std::unordered_map<std::string, std::string>>(
       m, "StringStringMap");
+
+  m.def("allocator_stats", &CachingAllocator::Report,
+        "Bytes in use, fragmentation and cache hit rate of the caching allocators");
 }
 
 }  // namespace python_lib
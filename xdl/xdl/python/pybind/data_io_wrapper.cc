@@ -43,7 +43,8 @@ void DataIOPybind(pybind11::module& m) {
     .value("pb", kPB)
     .value("txt", kTxt)
     .value("spb", kSPB)
-    .value("v4", kV4);  
+    .value("v4", kV4)
+    .value("columnar", kColumnar);
 
   pybind11::enum_<FeatureType>(m, "features")
     .value("sparse", kSparse)
@@ -51,7 +52,8 @@ void DataIOPybind(pybind11::module& m) {
 
   pybind11::enum_<ZType>(m, "ztype")
     .value("raw", kRaw)
-    .value("zlib", kZLib);
+    .value("zlib", kZLib)
+    .value("bgzf", kBgzf);
 
   pybind11::class_<FileSystem>(m, "FileSystem")
     .def("get_ant", &FileSystem::GetAnt)
@@ -93,15 +95,26 @@ void DataIOPybind(pybind11::module& m) {
     .def("add_op", &DataIO::AddOp)
     .def("batch_size", &DataIO::SetBatchSize)
     .def("shuffle", &DataIO::SetShuffle, "set shuffle", pybind11::arg("shuffle")=true)
+    .def("split", &DataIO::SetSplit, "read large txt files as ranges across the workers")
+    .def("shuffle_buffer", &DataIO::SetShuffleBuffer, "shuffle sgroups between parse and pack",
+         pybind11::arg("samples"),
+         pybind11::arg("seed")=0)
     .def("pad", &DataIO::SetPadding, "set padding", pybind11::arg("pad")=true)
+    .def("pad_multiple", &DataIO::SetPadMultiple, "set padding to a multiple of rows",
+         pybind11::arg("multiple")=0)
     .def("epochs", &DataIO::SetEpochs)
+    .def("cache", &DataIO::SetCache, "cache the first epoch in a local dir", pybind11::arg("dir"))
     .def("z", &DataIO::SetZType, "set compression type", pybind11::arg("type")=kZLib)
     .def("label_count", &DataIO::SetLabelCount)
     .def("split_group", &DataIO::SetSplitGroup)
     .def("unique_ids", &DataIO::SetUniqueIds)
+    .def("projection", &DataIO::SetProjection, "parse only the features added", pybind11::arg("projection")=true)
+    .def("pin_memory", &DataIO::SetPinMemory, "allocate the batches on pinned memory for get_batch on gpu", pybind11::arg("pin")=true)
     .def("finish_delay", &DataIO::SetFinishDelay)
     .def("keep_sample", &DataIO::SetKeepSGroup)
     .def("keep_skey", &DataIO::SetKeepSKey)
+    .def("skey_hash", &DataIO::SetSKeyHash, "pack the sample keys as int64 hashes",
+         pybind11::arg("hash")=true, pybind11::arg("dict")="")
     .def("pause", &DataIO::SetPause, 
          "pause reading after read limit sg, not exactly wait all sg exausted by default",
          pybind11::arg("limit"),
@@ -109,6 +122,12 @@ void DataIOPybind(pybind11::module& m) {
     .def("threads", &DataIO::SetThreads, "set threads", 
          pybind11::arg("threads"),
          pybind11::arg("threads_read")=8)
+    .def("op_threads", &DataIO::SetOpThreads, "run the ops in threads of their own between parse and pack",
+         pybind11::arg("threads"))
+    .def("autotune", &DataIO::SetAutotune, "tune threads up to the bounds",
+         pybind11::arg("max_threads"),
+         pybind11::arg("max_threads_read"),
+         pybind11::arg("seconds")=300)
     .def("start_time", &DataIO::SetStartTime)
     .def("end_time", &DataIO::SetEndTime)
     .def("duration", &DataIO::SetDuration)
@@ -118,6 +137,7 @@ void DataIOPybind(pybind11::module& m) {
     .def("dense_list", &DataIO::dense_list)
     .def("ntable", &DataIO::ntable)
     .def("name", &DataIO::name)
+    .def("queue_stats", &DataIO::QueueStats, "depth and wait times of the data io queues")
     .def("fs", &DataIO::fs, pybind11::return_value_policy::reference_internal)
     .def("get_batch", &DataIO::GetBatch, pybind11::return_value_policy::reference)
     .def("serialize_state", [](DataIO *io){ return pybind11::bytes(io->Store()); })
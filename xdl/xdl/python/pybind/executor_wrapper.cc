@@ -23,6 +23,8 @@ limitations under the License.
 
 #include "xdl/core/framework/graph_def.h"
 #include "xdl/core/framework/executor.h"
+#include "xdl/core/framework/profiler.h"
+#include "ps-plus/common/tracer.h"
 
 #define ONE_ARG(...) __VA_ARGS__
 PYBIND11_MAKE_OPAQUE(ONE_ARG(std::unordered_map<std::string, std::string>));
@@ -68,6 +70,7 @@ struct ExecuteLoopSpec {
   GraphDef def;
   std::vector<OutputSpec> outputs;
   int id;
+  bool pipeline;
 };
 
 ExecuteResult Execute(const GraphDef& def, 
@@ -95,9 +98,43 @@ ExecuteResult Execute(const GraphDef& def,
   return ret;
 }
 
+// Runs steps steps without returning to python between them, the gil
+// released but for hook, called as hook(step, outputs) after every
+// every-th step and the last one, e.g. to aggregate the metrics, which
+// stops the steps if it returns false. Stops at the first step failed,
+// e.g. out of range at the end of the data, whose status is returned with
+// the outputs of the last step run.
+ExecuteResult ExecuteSteps(const GraphDef& def,
+                           const OutputSpec& output,
+                           const RunOption& run_option,
+                           int64_t steps,
+                           int64_t every,
+                           const pybind11::object& hook) {
+  ExecuteResult ret;
+  for (int64_t step = 1; step <= steps; ++step) {
+    ExecuteResult result = Execute(def, output, run_option);
+    ret.status = result.status;
+    if (!result.status.IsOk()) {
+      break;
+    }
+    ret.outputs = std::move(result.outputs);
+    ret.run_statistic = std::move(result.run_statistic);
+    if (hook.is_none() || every <= 0 || (step % every != 0 && step != steps)) {
+      continue;
+    }
+    pybind11::gil_scoped_acquire acquire;
+    pybind11::object next = hook(step, ret.outputs);
+    if (!next.is_none() && !next.cast<bool>()) {
+      break;
+    }
+  }
+  return ret;
+}
+
 void ExecuteLoopImpl(ExecuteLoopSpec* spec) {
   static Executor executor(ThreadPool::Global());
   RunOption run_option;
+  run_option.pipeline = spec->pipeline;
   ExecutorInstance::Instance()->executor()->Run(spec->def, spec->outputs[spec->id], run_option,
   [spec](Status st, const std::vector<Tensor>& outputs,
 	      const std::unordered_map<std::string, Any>& extra_info) {
@@ -120,9 +157,14 @@ void ExecuteLoopImpl(ExecuteLoopSpec* spec) {
   });
 }
 
-void ExecuteLoop(const GraphDef& def, const std::vector<OutputSpec>& outputs) {
-  ExecuteLoopSpec* spec = new ExecuteLoopSpec{.def = def, .outputs = outputs, .id = 0};
-  ExecuteLoopImpl(spec);
+// depth steps are kept in flight, only a loop over a single output spec
+// is pipelined since the runs of different graphs are not ordered.
+void ExecuteLoop(const GraphDef& def, const std::vector<OutputSpec>& outputs, int depth) {
+  bool pipeline = depth > 1 && outputs.size() == 1;
+  ExecuteLoopSpec* spec = new ExecuteLoopSpec{.def = def, .outputs = outputs, .id = 0, .pipeline = pipeline};
+  for (int i = 0; i < (pipeline ? depth : 1); i++) {
+    ExecuteLoopImpl(spec);
+  }
 }
 
 Status ExecuteLoopWait() {
@@ -253,11 +295,52 @@ void ExecutorPybind(pybind11::module& m) {
   pybind11::bind_map<std::unordered_map<std::string, AttrValue>>(
       m, "StringAttrValueMap");
 
-  m.def("execute", &Execute, "Execute the GraphDef");
-
-  m.def("execute_loop", &ExecuteLoop, "Execute the GraphDef on loop");
-
-  m.def("execute_loop_wait", &ExecuteLoopWait, "Wait execute_loop error");
+  // the steps wait without the gil, which the pyfunc ops take to run
+  m.def("execute", &Execute, "Execute the GraphDef",
+        pybind11::call_guard<pybind11::gil_scoped_release>());
+
+  m.def("execute_steps", &ExecuteSteps,
+        "Execute the GraphDef steps times without returning to python",
+        pybind11::arg("def"), pybind11::arg("output"), pybind11::arg("run_option"),
+        pybind11::arg("steps"), pybind11::arg("every") = 0,
+        pybind11::arg("hook") = pybind11::none(),
+        pybind11::call_guard<pybind11::gil_scoped_release>());
+
+  m.def("execute_loop", &ExecuteLoop, "Execute the GraphDef on loop",
+        pybind11::arg("def"), pybind11::arg("outputs"), pybind11::arg("depth") = 1);
+
+  m.def("execute_loop_wait", &ExecuteLoopWait, "Wait execute_loop error",
+        pybind11::call_guard<pybind11::gil_scoped_release>());
+
+  m.def("start_profiler",
+        [](double sample_rate, size_t max_spans) {
+          Profiler::Get()->Start(sample_rate, max_spans);
+        },
+        "Profile a sampled fraction of the following steps",
+        pybind11::arg("sample_rate") = 1.0,
+        pybind11::arg("max_spans") = Profiler::kDefaultMaxSpans);
+
+  m.def("stop_profiler", []() { Profiler::Get()->Stop(); },
+        "Stop profiling, the collected statistics are kept");
+
+  m.def("clear_profiler", []() { Profiler::Get()->Clear(); },
+        "Drop the collected statistics");
+
+  m.def("profiler_chrome_trace", []() { return Profiler::Get()->ChromeTrace(); },
+        "The profiled timeline in chrome trace json");
+
+  m.def("profiler_summary", []() { return Profiler::Get()->Summary(); },
+        "The per op statistics of the profiled steps");
+
+  m.def("set_trace_file",
+        [](const std::string& path, const std::string& process) {
+          ps::common::Tracer::Instance()->SetExportFile(path);
+          if (!process.empty()) {
+            ps::common::Tracer::Instance()->SetProcessName(process);
+          }
+        },
+        "Trace the profiled steps to the ps servers into path, empty stops it",
+        pybind11::arg("path"), pybind11::arg("process") = "");
 }
 
 }  // namespace python_lib
@@ -20,6 +20,7 @@ limitations under the License.
 #include "xdl/python/pybind/pyfunc_op.h"
 #include "xdl/python/pybind/data_io_wrapper.h"
 #include "xdl/python/pybind/model_server_wrapper.h"
+#include "xdl/python/pybind/ps_wrapper.h"
 
 using namespace xdl::python_lib;
 
@@ -38,6 +39,8 @@ PYBIND11_MODULE(libxdl_python_pybind, m) {
 
 #ifdef USE_PS_PLUS
   ModelServerPybind(m);
+
+  PsPybind(m);
 #endif
 }
 
@@ -0,0 +1,90 @@
+/* Copyright (C) 2016-2018 Alibaba Group Holding Limited
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xdl/python/pybind/ps_wrapper.h"
+
+#include <future>
+#include <stdexcept>
+
+#include "pybind11/stl.h"
+#include "pybind11/stl_bind.h"
+
+#include "xdl/core/ops/ps_ops/client.h"
+#include "ps-plus/message/variable_stats.h"
+
+PYBIND11_MAKE_OPAQUE(std::vector<std::string>);
+PYBIND11_MAKE_OPAQUE(std::vector<size_t>);
+
+namespace xdl {
+namespace python_lib {
+
+namespace {
+
+// Raises RuntimeError if the client is not connected or a server fails.
+ps::ClusterStats ClusterStats() {
+  ps::client::BaseClient* client;
+  Status st = GetClient(&client);
+  if (!st.IsOk()) {
+    throw std::runtime_error(st.Msg());
+  }
+  ps::ClusterStats stats;
+  std::promise<ps::Status> result;
+  ps::Status ps_st;
+  {
+    pybind11::gil_scoped_release release;
+    client->GetClusterStats(&stats, [&result](const ps::Status& st) {
+      result.set_value(st);
+    });
+    ps_st = result.get_future().get();
+  }
+  if (!ps_st.IsOk()) {
+    throw std::runtime_error(ps_st.ToString());
+  }
+  return stats;
+}
+
+}  // namespace
+
+void PsPybind(pybind11::module& m) {
+  pybind11::class_<ps::VariableStats>(m, "VariableStats")
+    .def_readonly("name", &ps::VariableStats::name)
+    .def_readonly("rows", &ps::VariableStats::rows)
+    .def_readonly("data_bytes", &ps::VariableStats::data_bytes)
+    .def_readonly("slot_names", &ps::VariableStats::slot_names)
+    .def_readonly("slot_bytes", &ps::VariableStats::slot_bytes)
+    .def_readonly("hashmap_bytes", &ps::VariableStats::hashmap_bytes)
+    .def_readonly("pull_rows", &ps::VariableStats::pull_rows)
+    .def_readonly("pull_bytes", &ps::VariableStats::pull_bytes)
+    .def_readonly("push_rows", &ps::VariableStats::push_rows)
+    .def_readonly("push_bytes", &ps::VariableStats::push_bytes)
+    .def_readonly("micros", &ps::VariableStats::micros)
+    .def("total_bytes", &ps::VariableStats::TotalBytes)
+    .def("rate", &ps::VariableStats::Rate,
+         "Per second rate of a traffic counter since the variable was created");
+
+  pybind11::class_<ps::ServerStats>(m, "ServerStats")
+    .def_readonly("server_id", &ps::ServerStats::server_id)
+    .def_readonly("variables", &ps::ServerStats::variables);
+
+  pybind11::class_<ps::ClusterStats>(m, "ClusterStats")
+    .def_readonly("servers", &ps::ClusterStats::servers)
+    .def_readonly("variables", &ps::ClusterStats::variables);
+
+  m.def("ps_cluster_stats", &ClusterStats,
+        "Memory and traffic of the variables on every ps server and summed over the cluster");
+}
+
+}  // namespace python_lib
+}  // namespace xdl
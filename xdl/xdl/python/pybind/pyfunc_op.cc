@@ -69,11 +69,23 @@ class PyObjectManager : public Singleton<PyObjectManager> {
   int64_t counter_;
 };
 
+// The executor runs the steps without the gil, see execute in
+// executor_wrapper.cc, so the op takes it to call python, before the
+// object manager mutex as python does.
 class _PyFuncOp : public OpKernel {
  public:
+  ~_PyFuncOp() {
+    if (Py_IsInitialized()) {
+      pybind11::gil_scoped_acquire acquire;
+      obj_ = pybind11::object();
+    } else {
+      obj_.release();
+    }
+  }
   Status Init(OpKernelConstruction* ctx) override {
     int64_t handle;
     XDL_CHECK_STATUS(ctx->GetAttr("handle", &handle));
+    pybind11::gil_scoped_acquire acquire;
     XDL_CHECK_STATUS(PyObjectManager::Instance()->Get(handle, &obj_));
     XDL_CHECK_STATUS(ctx->GetAttr("input_type", &input_type_));
     XDL_CHECK_STATUS(ctx->GetAttr("output_type", &output_type_));
@@ -82,6 +94,7 @@ class _PyFuncOp : public OpKernel {
   Status Compute(OpKernelContext* ctx) override {
     std::vector<Tensor> inputs;
     XDL_CHECK_STATUS(ctx->GetInputList("input", &inputs));
+    pybind11::gil_scoped_acquire acquire;
     std::unique_lock<std::mutex> lock(PyObjectManager::Instance()->Mutex());
     pybind11::object obj_result = obj_(inputs);
     PyFuncResult* result = pybind11::cast<PyFuncResult*>(obj_result);